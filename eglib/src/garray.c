@@ -50,7 +50,9 @@ ensure_capacity (GArrayPriv *priv, guint capacity)
 	if (capacity <= priv->capacity)
 		return;
 	
-	new_capacity = (capacity + 63) & ~63;
+	/* Grow geometrically, so appending one element at a time doesn't copy the array every 64 elements */
+	new_capacity = MAX (capacity, priv->capacity * 2);
+	new_capacity = (new_capacity + 63) & ~63;
 	
 	priv->array.data = g_realloc (priv->array.data, element_length (priv, new_capacity));
 	
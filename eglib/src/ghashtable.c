@@ -25,36 +25,77 @@
  * OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
  * WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
+/*
+ * The table uses open addressing: keys and values are stored inline in one
+ * array, so inserting doesn't allocate unless the table grows. Every entry has
+ * a control byte, which is either EMPTY, DELETED or, for a full entry, the low
+ * 7 bits of the hash of its key. Lookups compare the control bytes of a group
+ * of entries at once, with SSE2 where available, otherwise 8 at a time in a
+ * 64 bit word, and only call the equal function on entries whose control byte
+ * matches.
+ *
+ * Removing an entry leaves a DELETED marker, so a table can be changed while
+ * it is iterated with a GHashTableIter as long as nothing is inserted. Removals
+ * never resize the table, except for g_hash_table_foreach_remove/steal, which
+ * shrink it if it became mostly empty.
+ */
 #include <stdio.h>
+#include <string.h>
 #include <math.h>
 #include <glib.h>
 
-typedef struct _Slot Slot;
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GROUP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define CTRL_EMPTY   ((gint8) -128)
+#define CTRL_DELETED ((gint8) -2)
+
+#define CTRL_IS_FULL(c) ((c) >= 0)
+
+#ifdef GROUP_SSE2
+#define GROUP_SIZE 16
+/* One bit per control byte */
+#define GROUP_SHIFT 0
+typedef guint32 GroupMask;
+#else
+#define GROUP_SIZE 8
+/* The high bit of each control byte */
+#define GROUP_SHIFT 3
+typedef guint64 GroupMask;
+#endif
+
+/* At most 7/8 of the entries are used */
+#define MAX_LOAD(capacity) ((capacity) - (capacity) / 8)
 
-struct _Slot {
+typedef struct {
 	gpointer key;
 	gpointer value;
-	Slot    *next;
-};
-
-static gpointer KEYMARKER_REMOVED = &KEYMARKER_REMOVED;
+} Entry;
 
 struct _GHashTable {
 	GHashFunc      hash_func;
 	GEqualFunc     key_equal_func;
 
-	Slot **table;
-	int   table_size;
-	int   in_use;
-	int   threshold;
-	int   last_rehash;
+	/* @capacity is 0 or a power of 2, not less than GROUP_SIZE */
+	Entry *entries;
+	/* @capacity + GROUP_SIZE bytes, the last GROUP_SIZE mirror the first ones */
+	gint8 *ctrl;
+	int    capacity;
+	int    in_use;
+	/* Number of EMPTY entries which can still be used before growing */
+	int    growth_left;
 	GDestroyNotify value_destroy_func, key_destroy_func;
 };
 
 typedef struct {
 	GHashTable *ht;
-	int slot_index;
-	Slot *slot;
+	int index;
 } Iter;
 
 static const guint prime_tbl[] = {
@@ -104,164 +145,331 @@ g_spaced_primes_closest (guint x)
 	return calc_prime (x);
 }
 
-GHashTable *
-g_hash_table_new (GHashFunc hash_func, GEqualFunc key_equal_func)
+/*
+ * Group operations, each returns a mask with a bit set for each matching
+ * control byte in the GROUP_SIZE bytes starting at @ctrl.
+ */
+#ifdef GROUP_SSE2
+
+static inline GroupMask
+group_match (const gint8 *ctrl, gint8 h2)
 {
-	GHashTable *hash;
+	__m128i group = _mm_loadu_si128 ((const __m128i *) ctrl);
 
-	if (hash_func == NULL)
-		hash_func = g_direct_hash;
-	if (key_equal_func == NULL)
-		key_equal_func = g_direct_equal;
-	hash = g_new0 (GHashTable, 1);
+	return (GroupMask) _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_set1_epi8 (h2), group));
+}
 
-	hash->hash_func = hash_func;
-	hash->key_equal_func = key_equal_func;
+static inline GroupMask
+group_match_empty (const gint8 *ctrl)
+{
+	return group_match (ctrl, CTRL_EMPTY);
+}
 
-	hash->table_size = g_spaced_primes_closest (1);
-	hash->table = g_new0 (Slot *, hash->table_size);
-	hash->last_rehash = hash->table_size;
-	
-	return hash;
+static inline GroupMask
+group_match_empty_or_deleted (const gint8 *ctrl)
+{
+	/* Only EMPTY and DELETED have the high bit set */
+	return (GroupMask) _mm_movemask_epi8 (_mm_loadu_si128 ((const __m128i *) ctrl));
 }
 
-GHashTable *
-g_hash_table_new_full (GHashFunc hash_func, GEqualFunc key_equal_func,
-		       GDestroyNotify key_destroy_func, GDestroyNotify value_destroy_func)
+#else
+
+#define LSBS ((guint64) 0x0101010101010101ULL)
+#define MSBS ((guint64) 0x8080808080808080ULL)
+
+static inline guint64
+group_load (const gint8 *ctrl)
 {
-	GHashTable *hash = g_hash_table_new (hash_func, key_equal_func);
-	if (hash == NULL)
-		return NULL;
-	
-	hash->key_destroy_func = key_destroy_func;
-	hash->value_destroy_func = value_destroy_func;
-	
-	return hash;
+	guint64 group;
+
+	memcpy (&group, ctrl, sizeof (group));
+	return GUINT64_FROM_LE (group);
 }
 
-#if 0
-static void
-dump_hash_table (GHashTable *hash)
+static inline GroupMask
+group_match (const gint8 *ctrl, gint8 h2)
 {
-	int i;
+	/* Sets the high bit of the bytes equal to @h2, with rare false positives which are caught by the key comparison */
+	guint64 x = group_load (ctrl) ^ (LSBS * (guint8) h2);
+
+	return (x - LSBS) & ~x & MSBS;
+}
+
+static inline GroupMask
+group_match_empty (const gint8 *ctrl)
+{
+	guint64 group = group_load (ctrl);
+
+	/* EMPTY is the only value with the high bit set and bit 1 clear */
+	return group & (~group << 6) & MSBS;
+}
+
+static inline GroupMask
+group_match_empty_or_deleted (const gint8 *ctrl)
+{
+	return group_load (ctrl) & MSBS;
+}
+
+#endif
+
+/* Return the offset in the group of the first match in @mask, which is not 0 */
+static inline int
+group_mask_first (GroupMask mask)
+{
+#if defined(__GNUC__)
+	return (sizeof (GroupMask) == 8 ? __builtin_ctzll (mask) : __builtin_ctz ((guint32) mask)) >> GROUP_SHIFT;
+#elif defined(_MSC_VER) && defined(GROUP_SSE2)
+	unsigned long index;
+
+	_BitScanForward (&index, (unsigned long) mask);
+	return (int) index;
+#else
+	int index = 0;
+
+	while (!(mask & 1)) {
+		mask >>= 1;
+		index++;
+	}
+	return index >> GROUP_SHIFT;
+#endif
+}
 
-	for (i = 0; i < hash->table_size; i++) {
-		Slot *s;
+static inline guint
+hash_key (GHashTable *hash, gconstpointer key)
+{
+	guint h = (*hash->hash_func) (key);
+
+	/*
+	 * Many hash functions, like g_direct_hash, have their entropy in a few
+	 * bits, while the table uses the low bits for the control byte and the
+	 * next ones for the position, so mix them (the murmur3 finalizer).
+	 */
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+	return h;
+}
+
+#define HASH_H1(h) ((h) >> 7)
+#define HASH_H2(h) ((gint8) ((h) & 0x7f))
+
+static inline void
+set_ctrl (GHashTable *hash, int index, gint8 c)
+{
+	hash->ctrl [index] = c;
+	/* Keep the copy used by groups which wrap around in sync */
+	if (index < GROUP_SIZE)
+		hash->ctrl [hash->capacity + index] = c;
+}
+
+/*
+ * Probe the groups of the table in the order in which @h would be inserted,
+ * jumping by 1, 2, 3... groups, which visits every group since the capacity
+ * is a power of 2.
+ */
+static int
+find_entry (GHashTable *hash, gconstpointer key, guint h)
+{
+	GEqualFunc equal = hash->key_equal_func;
+	int mask = hash->capacity - 1;
+	int pos = HASH_H1 (h) & mask;
+	int step = 0;
+	gint8 h2 = HASH_H2 (h);
 
-		for (s = hash->table [i]; s != NULL; s = s->next){
-			guint hashcode = (*hash->hash_func) (s->key);
-			guint slot = (hashcode) % hash->table_size;
-			printf ("key %p hash %x on slot %d correct slot %d tb size %d\n", s->key, hashcode, i, slot, hash->table_size);
+	if (hash->capacity == 0)
+		return -1;
+
+	while (TRUE) {
+		GroupMask matches = group_match (hash->ctrl + pos, h2);
+
+		while (matches) {
+			int index = (pos + group_mask_first (matches)) & mask;
+
+			if ((*equal) (hash->entries [index].key, key))
+				return index;
+			matches &= matches - 1;
 		}
+		/* The key would have been inserted in the first EMPTY entry */
+		if (group_match_empty (hash->ctrl + pos))
+			return -1;
+		step += GROUP_SIZE;
+		pos = (pos + step) & mask;
+	}
+}
+
+/* Return the first EMPTY or DELETED entry in the probe sequence of @h */
+static int
+find_free (GHashTable *hash, guint h)
+{
+	int mask = hash->capacity - 1;
+	int pos = HASH_H1 (h) & mask;
+	int step = 0;
+
+	while (TRUE) {
+		GroupMask free_entries = group_match_empty_or_deleted (hash->ctrl + pos);
+
+		if (free_entries)
+			return (pos + group_mask_first (free_entries)) & mask;
+		step += GROUP_SIZE;
+		pos = (pos + step) & mask;
 	}
 }
-#endif
 
-#ifdef SANITY_CHECK
 static void
-sanity_check (GHashTable *hash)
+resize (GHashTable *hash, int new_capacity)
 {
+	Entry *old_entries = hash->entries;
+	gint8 *old_ctrl = hash->ctrl;
+	int old_capacity = hash->capacity;
 	int i;
 
-	for (i = 0; i < hash->table_size; i++) {
-		Slot *s;
-
-		for (s = hash->table [i]; s != NULL; s = s->next){
-			guint hashcode = (*hash->hash_func) (s->key);
-			guint slot = (hashcode) % hash->table_size;
-			if (slot != i) {
-				dump_hashcode_func = 1;
-				hashcode = (*hash->hash_func) (s->key);
-				dump_hashcode_func = 0;
-				g_error ("Key %p (bucket %d) on invalid bucket %d (hashcode %x) (tb size %d)", s->key, slot, i, hashcode, hash->table_size);
-			}
-		}
+	/* One block for the entries followed by the control bytes */
+	hash->entries = (Entry *) g_malloc (new_capacity * sizeof (Entry) + new_capacity + GROUP_SIZE);
+	hash->ctrl = (gint8 *) (hash->entries + new_capacity);
+	memset (hash->ctrl, (guint8) CTRL_EMPTY, new_capacity + GROUP_SIZE);
+	hash->capacity = new_capacity;
+	hash->growth_left = MAX_LOAD (new_capacity) - hash->in_use;
+
+	for (i = 0; i < old_capacity; i++) {
+		guint h;
+		int index;
+
+		if (!CTRL_IS_FULL (old_ctrl [i]))
+			continue;
+		h = hash_key (hash, old_entries [i].key);
+		index = find_free (hash, h);
+		set_ctrl (hash, index, HASH_H2 (h));
+		hash->entries [index] = old_entries [i];
 	}
+	g_free (old_entries);
 }
-#else
 
-#define sanity_check(HASH) do {}while(0)
+/* Smallest capacity which holds @count entries */
+static int
+capacity_for (int count)
+{
+	int capacity = GROUP_SIZE;
 
-#endif
+	while (MAX_LOAD (capacity) < count)
+		capacity *= 2;
+	return capacity;
+}
 
+/* Make room for one more entry */
 static void
-do_rehash (GHashTable *hash)
-{
-	int current_size, i;
-	Slot **table;
-
-	/* printf ("Resizing diff=%d slots=%d\n", hash->in_use - hash->last_rehash, hash->table_size); */
-	hash->last_rehash = hash->table_size;
-	current_size = hash->table_size;
-	hash->table_size = g_spaced_primes_closest (hash->in_use);
-	/* printf ("New size: %d\n", hash->table_size); */
-	table = hash->table;
-	hash->table = g_new0 (Slot *, hash->table_size);
-	
-	for (i = 0; i < current_size; i++){
-		Slot *s, *next;
-
-		for (s = table [i]; s != NULL; s = next){
-			guint hashcode = ((*hash->hash_func) (s->key)) % hash->table_size;
-			next = s->next;
+reserve_one (GHashTable *hash)
+{
+	if (hash->capacity == 0) {
+		resize (hash, GROUP_SIZE);
+		return;
+	}
+	/*
+	 * If most of the used entries are DELETED, rehashing at the same size
+	 * reclaims them.
+	 */
+	if (hash->in_use < MAX_LOAD (hash->capacity) / 2)
+		resize (hash, hash->capacity);
+	else
+		resize (hash, hash->capacity * 2);
+}
 
-			s->next = hash->table [hashcode];
-			hash->table [hashcode] = s;
-		}
+static void
+remove_entry (GHashTable *hash, int index, gboolean notify)
+{
+	if (notify) {
+		if (hash->key_destroy_func != NULL)
+			(*hash->key_destroy_func)(hash->entries [index].key);
+		if (hash->value_destroy_func != NULL)
+			(*hash->value_destroy_func)(hash->entries [index].value);
 	}
-	g_free (table);
+	/* Later entries of the probe sequence might have passed over this one */
+	set_ctrl (hash, index, CTRL_DELETED);
+	hash->in_use--;
 }
 
+/* Shrink the table after bulk removals */
 static void
-rehash (GHashTable *hash)
+maybe_shrink (GHashTable *hash)
 {
-	int diff = ABS (hash->last_rehash - hash->in_use);
+	int capacity = capacity_for (hash->in_use);
 
-	/* These are the factors to play with to change the rehashing strategy */
-	/* I played with them with a large range, and could not really get */
-	/* something that was too good, maybe the tests are not that great */
-	if (!(diff * 0.75 > hash->table_size * 2))
-		return;
-	do_rehash (hash);
-	sanity_check (hash);
+	if (hash->capacity > GROUP_SIZE && capacity * 4 <= hash->capacity)
+		resize (hash, capacity);
+}
+
+GHashTable *
+g_hash_table_new (GHashFunc hash_func, GEqualFunc key_equal_func)
+{
+	GHashTable *hash;
+
+	if (hash_func == NULL)
+		hash_func = g_direct_hash;
+	if (key_equal_func == NULL)
+		key_equal_func = g_direct_equal;
+	hash = g_new0 (GHashTable, 1);
+
+	hash->hash_func = hash_func;
+	hash->key_equal_func = key_equal_func;
+
+	/* Many tables stay empty, the entries are allocated by the first insert */
+	return hash;
+}
+
+GHashTable *
+g_hash_table_new_full (GHashFunc hash_func, GEqualFunc key_equal_func,
+		       GDestroyNotify key_destroy_func, GDestroyNotify value_destroy_func)
+{
+	GHashTable *hash = g_hash_table_new (hash_func, key_equal_func);
+	if (hash == NULL)
+		return NULL;
+	
+	hash->key_destroy_func = key_destroy_func;
+	hash->value_destroy_func = value_destroy_func;
+	
+	return hash;
 }
 
 void
 g_hash_table_insert_replace (GHashTable *hash, gpointer key, gpointer value, gboolean replace)
 {
-	guint hashcode;
-	Slot *s;
-	GEqualFunc equal;
+	guint h;
+	int index;
 	
 	g_return_if_fail (hash != NULL);
-	sanity_check (hash);
-
-	equal = hash->key_equal_func;
-	if (hash->in_use >= hash->threshold)
-		rehash (hash);
-
-	hashcode = ((*hash->hash_func) (key)) % hash->table_size;
-	for (s = hash->table [hashcode]; s != NULL; s = s->next){
-		if ((*equal) (s->key, key)){
-			if (replace){
-				if (hash->key_destroy_func != NULL)
-					(*hash->key_destroy_func)(s->key);
-				s->key = key;
-			}
-			if (hash->value_destroy_func != NULL)
-				(*hash->value_destroy_func) (s->value);
-			s->value = value;
-			sanity_check (hash);
-			return;
+
+	h = hash_key (hash, key);
+	index = find_entry (hash, key, h);
+	if (index != -1) {
+		Entry *e = &hash->entries [index];
+
+		if (replace){
+			if (hash->key_destroy_func != NULL)
+				(*hash->key_destroy_func)(e->key);
+			e->key = key;
 		}
+		if (hash->value_destroy_func != NULL)
+			(*hash->value_destroy_func) (e->value);
+		e->value = value;
+		return;
 	}
-	s = g_new (Slot, 1);
-	s->key = key;
-	s->value = value;
-	s->next = hash->table [hashcode];
-	hash->table [hashcode] = s;
+
+	if (hash->capacity == 0) {
+		reserve_one (hash);
+	} else {
+		index = find_free (hash, h);
+		/* Reusing a DELETED entry doesn't reduce growth_left */
+		if (hash->ctrl [index] == CTRL_EMPTY && hash->growth_left == 0)
+			reserve_one (hash);
+	}
+	index = find_free (hash, h);
+	if (hash->ctrl [index] == CTRL_EMPTY)
+		hash->growth_left--;
+	set_ctrl (hash, index, HASH_H2 (h));
+	hash->entries [index].key = key;
+	hash->entries [index].value = value;
 	hash->in_use++;
-	sanity_check (hash);
 }
 
 GList*
@@ -306,37 +514,33 @@ g_hash_table_size (GHashTable *hash)
 gpointer
 g_hash_table_lookup (GHashTable *hash, gconstpointer key)
 {
-	gpointer orig_key, value;
-	
-	if (g_hash_table_lookup_extended (hash, key, &orig_key, &value))
-		return value;
-	else
+	int index;
+
+	g_return_val_if_fail (hash != NULL, NULL);
+
+	if (hash->in_use == 0)
 		return NULL;
+	index = find_entry (hash, key, hash_key (hash, key));
+	return index != -1 ? hash->entries [index].value : NULL;
 }
 
 gboolean
 g_hash_table_lookup_extended (GHashTable *hash, gconstpointer key, gpointer *orig_key, gpointer *value)
 {
-	GEqualFunc equal;
-	Slot *s;
-	guint hashcode;
+	int index;
 	
 	g_return_val_if_fail (hash != NULL, FALSE);
-	sanity_check (hash);
-	equal = hash->key_equal_func;
 
-	hashcode = ((*hash->hash_func) (key)) % hash->table_size;
-	
-	for (s = hash->table [hashcode]; s != NULL; s = s->next){
-		if ((*equal)(s->key, key)){
-			if (orig_key)
-				*orig_key = s->key;
-			if (value)
-				*value = s->value;
-			return TRUE;
-		}
-	}
-	return FALSE;
+	if (hash->in_use == 0)
+		return FALSE;
+	index = find_entry (hash, key, hash_key (hash, key));
+	if (index == -1)
+		return FALSE;
+	if (orig_key)
+		*orig_key = hash->entries [index].key;
+	if (value)
+		*value = hash->entries [index].value;
+	return TRUE;
 }
 
 void
@@ -347,11 +551,9 @@ g_hash_table_foreach (GHashTable *hash, GHFunc func, gpointer user_data)
 	g_return_if_fail (hash != NULL);
 	g_return_if_fail (func != NULL);
 
-	for (i = 0; i < hash->table_size; i++){
-		Slot *s;
-
-		for (s = hash->table [i]; s != NULL; s = s->next)
-			(*func)(s->key, s->value, user_data);
+	for (i = 0; i < hash->capacity; i++){
+		if (CTRL_IS_FULL (hash->ctrl [i]))
+			(*func)(hash->entries [i].key, hash->entries [i].value, user_data);
 	}
 }
 
@@ -363,12 +565,9 @@ g_hash_table_find (GHashTable *hash, GHRFunc predicate, gpointer user_data)
 	g_return_val_if_fail (hash != NULL, NULL);
 	g_return_val_if_fail (predicate != NULL, NULL);
 
-	for (i = 0; i < hash->table_size; i++){
-		Slot *s;
-
-		for (s = hash->table [i]; s != NULL; s = s->next)
-			if ((*predicate)(s->key, s->value, user_data))
-				return s->value;
+	for (i = 0; i < hash->capacity; i++){
+		if (CTRL_IS_FULL (hash->ctrl [i]) && (*predicate)(hash->entries [i].key, hash->entries [i].value, user_data))
+			return hash->entries [i].value;
 	}
 	return NULL;
 }
@@ -380,48 +579,30 @@ g_hash_table_remove_all (GHashTable *hash)
 	
 	g_return_if_fail (hash != NULL);
 
-	for (i = 0; i < hash->table_size; i++){
-		Slot *s;
-
-		while (hash->table [i]) {
-			s = hash->table [i];
-			g_hash_table_remove (hash, s->key);
-		}
+	for (i = 0; i < hash->capacity; i++){
+		if (CTRL_IS_FULL (hash->ctrl [i]))
+			remove_entry (hash, i, TRUE);
+	}
+	if (hash->capacity) {
+		memset (hash->ctrl, (guint8) CTRL_EMPTY, hash->capacity + GROUP_SIZE);
+		hash->growth_left = MAX_LOAD (hash->capacity);
 	}
 }
 
 gboolean
 g_hash_table_remove (GHashTable *hash, gconstpointer key)
 {
-	GEqualFunc equal;
-	Slot *s, *last;
-	guint hashcode;
+	int index;
 	
 	g_return_val_if_fail (hash != NULL, FALSE);
-	sanity_check (hash);
-	equal = hash->key_equal_func;
 
-	hashcode = ((*hash->hash_func)(key)) % hash->table_size;
-	last = NULL;
-	for (s = hash->table [hashcode]; s != NULL; s = s->next){
-		if ((*equal)(s->key, key)){
-			if (hash->key_destroy_func != NULL)
-				(*hash->key_destroy_func)(s->key);
-			if (hash->value_destroy_func != NULL)
-				(*hash->value_destroy_func)(s->value);
-			if (last == NULL)
-				hash->table [hashcode] = s->next;
-			else
-				last->next = s->next;
-			g_free (s);
-			hash->in_use--;
-			sanity_check (hash);
-			return TRUE;
-		}
-		last = s;
-	}
-	sanity_check (hash);
-	return FALSE;
+	if (hash->in_use == 0)
+		return FALSE;
+	index = find_entry (hash, key, hash_key (hash, key));
+	if (index == -1)
+		return FALSE;
+	remove_entry (hash, index, TRUE);
+	return TRUE;
 }
 
 guint
@@ -433,71 +614,31 @@ g_hash_table_foreach_remove (GHashTable *hash, GHRFunc func, gpointer user_data)
 	g_return_val_if_fail (hash != NULL, 0);
 	g_return_val_if_fail (func != NULL, 0);
 
-	sanity_check (hash);
-	for (i = 0; i < hash->table_size; i++){
-		Slot *s, *last;
-
-		last = NULL;
-		for (s = hash->table [i]; s != NULL; ){
-			if ((*func)(s->key, s->value, user_data)){
-				Slot *n;
-
-				if (hash->key_destroy_func != NULL)
-					(*hash->key_destroy_func)(s->key);
-				if (hash->value_destroy_func != NULL)
-					(*hash->value_destroy_func)(s->value);
-				if (last == NULL){
-					hash->table [i] = s->next;
-					n = s->next;
-				} else  {
-					last->next = s->next;
-					n = last->next;
-				}
-				g_free (s);
-				hash->in_use--;
-				count++;
-				s = n;
-			} else {
-				last = s;
-				s = s->next;
-			}
+	for (i = 0; i < hash->capacity; i++){
+		if (CTRL_IS_FULL (hash->ctrl [i]) && (*func)(hash->entries [i].key, hash->entries [i].value, user_data)) {
+			remove_entry (hash, i, TRUE);
+			count++;
 		}
 	}
-	sanity_check (hash);
 	if (count > 0)
-		rehash (hash);
+		maybe_shrink (hash);
 	return count;
 }
 
 gboolean
 g_hash_table_steal (GHashTable *hash, gconstpointer key)
 {
-	GEqualFunc equal;
-	Slot *s, *last;
-	guint hashcode;
+	int index;
 	
 	g_return_val_if_fail (hash != NULL, FALSE);
-	sanity_check (hash);
-	equal = hash->key_equal_func;
-	
-	hashcode = ((*hash->hash_func)(key)) % hash->table_size;
-	last = NULL;
-	for (s = hash->table [hashcode]; s != NULL; s = s->next){
-		if ((*equal)(s->key, key)) {
-			if (last == NULL)
-				hash->table [hashcode] = s->next;
-			else
-				last->next = s->next;
-			g_free (s);
-			hash->in_use--;
-			sanity_check (hash);
-			return TRUE;
-		}
-		last = s;
-	}
-	sanity_check (hash);
-	return FALSE;
-	
+
+	if (hash->in_use == 0)
+		return FALSE;
+	index = find_entry (hash, key, hash_key (hash, key));
+	if (index == -1)
+		return FALSE;
+	remove_entry (hash, index, FALSE);
+	return TRUE;
 }
 
 guint
@@ -509,35 +650,14 @@ g_hash_table_foreach_steal (GHashTable *hash, GHRFunc func, gpointer user_data)
 	g_return_val_if_fail (hash != NULL, 0);
 	g_return_val_if_fail (func != NULL, 0);
 
-	sanity_check (hash);
-	for (i = 0; i < hash->table_size; i++){
-		Slot *s, *last;
-
-		last = NULL;
-		for (s = hash->table [i]; s != NULL; ){
-			if ((*func)(s->key, s->value, user_data)){
-				Slot *n;
-
-				if (last == NULL){
-					hash->table [i] = s->next;
-					n = s->next;
-				} else  {
-					last->next = s->next;
-					n = last->next;
-				}
-				g_free (s);
-				hash->in_use--;
-				count++;
-				s = n;
-			} else {
-				last = s;
-				s = s->next;
-			}
+	for (i = 0; i < hash->capacity; i++){
+		if (CTRL_IS_FULL (hash->ctrl [i]) && (*func)(hash->entries [i].key, hash->entries [i].value, user_data)) {
+			remove_entry (hash, i, FALSE);
+			count++;
 		}
 	}
-	sanity_check (hash);
 	if (count > 0)
-		rehash (hash);
+		maybe_shrink (hash);
 	return count;
 }
 
@@ -548,20 +668,17 @@ g_hash_table_destroy (GHashTable *hash)
 	
 	g_return_if_fail (hash != NULL);
 
-	for (i = 0; i < hash->table_size; i++){
-		Slot *s, *next;
-
-		for (s = hash->table [i]; s != NULL; s = next){
-			next = s->next;
-			
+	if (hash->key_destroy_func != NULL || hash->value_destroy_func != NULL) {
+		for (i = 0; i < hash->capacity; i++){
+			if (!CTRL_IS_FULL (hash->ctrl [i]))
+				continue;
 			if (hash->key_destroy_func != NULL)
-				(*hash->key_destroy_func)(s->key);
+				(*hash->key_destroy_func)(hash->entries [i].key);
 			if (hash->value_destroy_func != NULL)
-				(*hash->value_destroy_func)(s->value);
-			g_free (s);
+				(*hash->value_destroy_func)(hash->entries [i].value);
 		}
 	}
-	g_free (hash->table);
+	g_free (hash->entries);
 	
 	g_free (hash);
 }
@@ -569,22 +686,38 @@ g_hash_table_destroy (GHashTable *hash)
 void
 g_hash_table_print_stats (GHashTable *table)
 {
-	int i, max_chain_index, chain_size, max_chain_size;
-	Slot *node;
-
-	max_chain_size = 0;
-	max_chain_index = -1;
-	for (i = 0; i < table->table_size; i++) {
-		chain_size = 0;
-		for (node = table->table [i]; node; node = node->next)
-			chain_size ++;
-		if (chain_size > max_chain_size) {
-			max_chain_size = chain_size;
-			max_chain_index = i;
+	int i, deleted, probe, max_probe, max_probe_index;
+
+	deleted = 0;
+	max_probe = 0;
+	max_probe_index = -1;
+	for (i = 0; i < table->capacity; i++) {
+		int mask = table->capacity - 1;
+		int pos, step;
+		guint h;
+
+		if (table->ctrl [i] == CTRL_DELETED)
+			deleted++;
+		if (!CTRL_IS_FULL (table->ctrl [i]))
+			continue;
+
+		/* Number of groups probed to find the entry */
+		h = hash_key (table, table->entries [i].key);
+		pos = HASH_H1 (h) & mask;
+		step = 0;
+		probe = 1;
+		while (((i - pos) & mask) >= GROUP_SIZE) {
+			step += GROUP_SIZE;
+			pos = (pos + step) & mask;
+			probe++;
+		}
+		if (probe > max_probe) {
+			max_probe = probe;
+			max_probe_index = i;
 		}
 	}
 
-	printf ("Size: %d Table Size: %d Max Chain Length: %d at %d\n", table->in_use, table->table_size, max_chain_size, max_chain_index);
+	printf ("Size: %d Table Size: %d Deleted: %d Max Probe Length: %d at %d\n", table->in_use, table->capacity, deleted, max_probe, max_probe_index);
 }
 
 void
@@ -594,7 +727,7 @@ g_hash_table_iter_init (GHashTableIter *it, GHashTable *hash_table)
 
 	memset (iter, 0, sizeof (Iter));
 	iter->ht = hash_table;
-	iter->slot_index = -1;
+	iter->index = -1;
 }
 
 gboolean g_hash_table_iter_next (GHashTableIter *it, gpointer *key, gpointer *value)
@@ -603,27 +736,23 @@ gboolean g_hash_table_iter_next (GHashTableIter *it, gpointer *key, gpointer *va
 
 	GHashTable *hash = iter->ht;
 
-	g_assert (iter->slot_index != -2);
+	g_assert (iter->index != -2);
 	g_assert (sizeof (Iter) <= sizeof (GHashTableIter));
 
-	if (!iter->slot) {
-		while (TRUE) {
-			iter->slot_index ++;
-			if (iter->slot_index >= hash->table_size) {
-				iter->slot_index = -2;
-				return FALSE;
-			}
-			if (hash->table [iter->slot_index])
-				break;
+	while (TRUE) {
+		iter->index ++;
+		if (iter->index >= hash->capacity) {
+			iter->index = -2;
+			return FALSE;
 		}
-		iter->slot = hash->table [iter->slot_index];
+		if (CTRL_IS_FULL (hash->ctrl [iter->index]))
+			break;
 	}
 
 	if (key)
-		*key = iter->slot->key;
+		*key = hash->entries [iter->index].key;
 	if (value)
-		*value = iter->slot->value;
-	iter->slot = iter->slot->next;
+		*value = hash->entries [iter->index].value;
 
 	return TRUE;
 }
@@ -658,14 +787,35 @@ g_str_equal (gconstpointer v1, gconstpointer v2)
 	return strcmp (v1, v2) == 0;
 }
 
+static inline guint64
+str_hash_mix (guint64 h, guint64 w)
+{
+	h = (h ^ w) * ((guint64) 0xbf58476d1ce4e5b9ULL);
+	return h ^ (h >> 31);
+}
+
+/*
+ * Hashes 8 bytes at a time after finding the length with strlen (), which
+ * libc implements with vector instructions. The value is not stable across
+ * platforms, use mono_metadata_str_hash () for hashes which are saved.
+ */
 guint
 g_str_hash (gconstpointer v1)
 {
-	guint hash = 0;
-	char *p = (char *) v1;
-
-	while (*p++)
-		hash = (hash << 5) - (hash + *p);
+	const char *p = (const char *) v1;
+	size_t len = strlen (p);
+	guint64 h = len * ((guint64) 0x9e3779b97f4a7c15ULL);
+	guint64 w;
 
-	return hash;
+	for (; len >= sizeof (w); len -= sizeof (w), p += sizeof (w)) {
+		memcpy (&w, p, sizeof (w));
+		h = str_hash_mix (h, w);
+	}
+	if (len > 0) {
+		w = 0;
+		memcpy (&w, p, len);
+		h = str_hash_mix (h, w);
+	}
+	h *= (guint64) 0x94d049bb133111ebULL;
+	return (guint) (h ^ (h >> 32));
 }
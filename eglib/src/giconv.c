@@ -883,6 +883,31 @@ g_utf8_to_ucs4_fast (const gchar *str, glong len, glong *items_written)
 	return outbuf;
 }
 
+/*
+ * utf8_ascii_prefix_len:
+ *
+ *   Returns the number of leading ASCII characters in STR, stopping at the first NUL
+ * unless INCLUDE_NULS is set. The characters are checked eight at a time.
+ */
+static glong
+utf8_ascii_prefix_len (const gchar *str, glong len, gboolean include_nuls)
+{
+	guint64 w;
+	glong i;
+
+	for (i = 0; i + 8 <= len; i += 8) {
+		memcpy (&w, str + i, sizeof (w));
+		/* Stop at a block containing a non ASCII or a NUL character */
+		if ((w & 0x8080808080808080ULL) || (!include_nuls && ((w - 0x0101010101010101ULL) & ~w & 0x8080808080808080ULL)))
+			break;
+	}
+
+	while (i < len && !(str [i] & 0x80) && (str [i] || include_nuls))
+		i++;
+
+	return i;
+}
+
 static gunichar2 *
 eg_utf8_to_utf16_general (const gchar *str, glong len, glong *items_read, glong *items_written, gboolean include_nuls, GError **err)
 {
@@ -891,6 +916,7 @@ eg_utf8_to_utf16_general (const gchar *str, glong len, glong *items_read, glong
 	size_t inleft;
 	char *inptr;
 	gunichar c;
+	glong ascii_len, i;
 	int u, n;
 	
 	g_return_val_if_fail (str != NULL, NULL);
@@ -904,8 +930,12 @@ eg_utf8_to_utf16_general (const gchar *str, glong len, glong *items_read, glong
 		len = strlen (str);
 	}
 	
-	inptr = (char *) str;
-	inleft = len;
+	/* The ASCII prefix maps 1:1 to UTF-16 */
+	ascii_len = utf8_ascii_prefix_len (str, len, include_nuls);
+	outlen = ascii_len;
+	
+	inptr = (char *) str + ascii_len;
+	inleft = len - ascii_len;
 	
 	while (inleft > 0) {
 		if ((n = decode_utf8 (inptr, inleft, &c)) < 0)
@@ -931,8 +961,11 @@ eg_utf8_to_utf16_general (const gchar *str, glong len, glong *items_read, glong
 		*items_written = outlen;
 	
 	outptr = outbuf = g_malloc ((outlen + 1) * sizeof (gunichar2));
-	inptr = (char *) str;
-	inleft = len;
+	for (i = 0; i < ascii_len; i++)
+		outptr [i] = (guchar) str [i];
+	outptr += ascii_len;
+	inptr = (char *) str + ascii_len;
+	inleft = len - ascii_len;
 	
 	while (inleft > 0) {
 		if ((n = decode_utf8 (inptr, inleft, &c)) < 0)
@@ -1054,6 +1087,31 @@ g_utf8_to_ucs4 (const gchar *str, glong len, glong *items_read, glong *items_wri
 	return outbuf;
 }
 
+/*
+ * utf16_ascii_prefix_len:
+ *
+ *   Returns the number of leading non-NUL ASCII characters in STR. The characters
+ * are checked four at a time since most strings converted at runtime are ASCII.
+ */
+static glong
+utf16_ascii_prefix_len (const gunichar2 *str, glong len)
+{
+	guint64 w;
+	glong i;
+
+	for (i = 0; i + 4 <= len; i += 4) {
+		memcpy (&w, str + i, sizeof (w));
+		/* Stop at a block containing a non ASCII or a NUL character */
+		if ((w & 0xff80ff80ff80ff80ULL) || ((w - 0x0001000100010001ULL) & ~w & 0x8000800080008000ULL))
+			break;
+	}
+
+	while (i < len && str [i] && str [i] < 0x80)
+		i++;
+
+	return i;
+}
+
 gchar *
 g_utf16_to_utf8 (const gunichar2 *str, glong len, glong *items_read, glong *items_written, GError **err)
 {
@@ -1061,6 +1119,7 @@ g_utf16_to_utf8 (const gunichar2 *str, glong len, glong *items_read, glong *item
 	size_t outlen = 0;
 	size_t inleft;
 	gunichar c;
+	glong ascii_len, i;
 	int n;
 	
 	g_return_val_if_fail (str != NULL, NULL);
@@ -1071,8 +1130,12 @@ g_utf16_to_utf8 (const gunichar2 *str, glong len, glong *items_read, glong *item
 			len++;
 	}
 	
-	inptr = (char *) str;
-	inleft = len * 2;
+	/* The ASCII prefix maps 1:1 to UTF-8 */
+	ascii_len = utf16_ascii_prefix_len (str, len);
+	outlen = ascii_len;
+	
+	inptr = (char *) (str + ascii_len);
+	inleft = (len - ascii_len) * 2;
 	
 	while (inleft > 0) {
 		if ((n = decode_utf16 (inptr, inleft, &c)) < 0) {
@@ -1115,8 +1178,11 @@ g_utf16_to_utf8 (const gunichar2 *str, glong len, glong *items_read, glong *item
 		*items_written = outlen;
 	
 	outptr = outbuf = g_malloc (outlen + 1);
-	inptr = (char *) str;
-	inleft = len * 2;
+	for (i = 0; i < ascii_len; i++)
+		*outptr++ = (char) str [i];
+	
+	inptr = (char *) (str + ascii_len);
+	inleft = (len - ascii_len) * 2;
 	
 	while (inleft > 0) {
 		if ((n = decode_utf16 (inptr, inleft, &c)) < 0)
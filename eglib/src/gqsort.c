@@ -38,10 +38,12 @@
 typedef struct _QSortStack {
 	char *array;
 	size_t count;
+	/* Partitioning steps left before falling back to heap sort */
+	int depth;
 } QSortStack;
 
-#define QSORT_PUSH(sp, a, c) (sp->array = a, sp->count = c, sp++)
-#define QSORT_POP(sp, a, c) (sp--, a = sp->array, c = sp->count)
+#define QSORT_PUSH(sp, a, c, d) (sp->array = a, sp->count = c, sp->depth = d, sp++)
+#define QSORT_POP(sp, a, c, d) (sp--, a = sp->array, c = sp->count, d = sp->depth)
 
 #define SWAPTYPE(TYPE, a, b) {              \
 	long __n = size / sizeof (TYPE);    \
@@ -65,6 +67,40 @@ typedef struct _QSortStack {
  * of sizeof (long) */
 #define SWAP_INIT() swaplong = (((char *) base) - ((char *) 0)) % sizeof (long) == 0 && (size % sizeof (long)) == 0
 
+static void
+sift_down (char *base, size_t root, size_t n, size_t size, GCompareDataFunc compare, gpointer user_data, int swaplong)
+{
+	size_t child;
+
+	while ((child = 2 * root + 1) < n) {
+		if (child + 1 < n && compare (base + child * size, base + (child + 1) * size, user_data) < 0)
+			child++;
+		if (compare (base + root * size, base + child * size, user_data) >= 0)
+			return;
+		SWAP (base + root * size, base + child * size);
+		root = child;
+	}
+}
+
+static void
+heap_sort (char *base, size_t n, size_t size, GCompareDataFunc compare, gpointer user_data, int swaplong)
+{
+	size_t i;
+
+	for (i = n / 2; i > 0; i--)
+		sift_down (base, i - 1, n, size, compare, user_data, swaplong);
+	for (i = n - 1; i > 0; i--) {
+		SWAP (base, base + i * size);
+		sift_down (base, 0, i, size, compare, user_data, swaplong);
+	}
+}
+
+/*
+ * An introsort: a quicksort which switches to heap sort for the segments
+ * which got partitioned too many times, so inputs which defeat the median of
+ * three pivot, like many equal elements, are still sorted in O(n log n).
+ */
+
 void
 g_qsort_with_data (gpointer base, size_t nmemb, size_t size, GCompareDataFunc compare, gpointer user_data)
 {
@@ -72,19 +108,24 @@ g_qsort_with_data (gpointer base, size_t nmemb, size_t size, GCompareDataFunc co
 	register char *i, *k, *mid;
 	size_t n, n1, n2;
 	char *lo, *hi;
-	int swaplong;
+	int swaplong, depth;
 	
 	if (nmemb <= 1)
 		return;
 	
 	SWAP_INIT ();
 	
+	/* allow 2 * log2 (nmemb) partitioning steps */
+	depth = 0;
+	for (n = nmemb; n > 1; n >>= 1)
+		depth += 2;
+	
 	/* initialize our stack */
 	sp = stack;
-	QSORT_PUSH (sp, base, nmemb);
+	QSORT_PUSH (sp, base, nmemb, depth);
 	
 	do {
-		QSORT_POP (sp, lo, n);
+		QSORT_POP (sp, lo, n, depth);
 		
 		hi = lo + (n - 1) * size;
 		
@@ -97,6 +138,12 @@ g_qsort_with_data (gpointer base, size_t nmemb, size_t size, GCompareDataFunc co
 			continue;
 		}
 		
+		if (depth == 0) {
+			heap_sort (lo, n, size, compare, user_data, swaplong);
+			continue;
+		}
+		depth--;
+		
 		/* calculate the middle element */
 		mid = lo + (n / 2) * size;
 		
@@ -155,11 +202,11 @@ g_qsort_with_data (gpointer base, size_t nmemb, size_t size, GCompareDataFunc co
 		/* push our partitions onto the stack, largest first
 		 * (to make sure we don't run out of stack space) */
 		if (n2 > n1) {
-			if (n2 > 1) QSORT_PUSH (sp, k + size, n2);
-			if (n1 > 1) QSORT_PUSH (sp, lo, n1);
+			if (n2 > 1) QSORT_PUSH (sp, k + size, n2, depth);
+			if (n1 > 1) QSORT_PUSH (sp, lo, n1, depth);
 		} else {
-			if (n1 > 1) QSORT_PUSH (sp, lo, n1);
-			if (n2 > 1) QSORT_PUSH (sp, k + size, n2);
+			if (n1 > 1) QSORT_PUSH (sp, lo, n1, depth);
+			if (n2 > 1) QSORT_PUSH (sp, k + size, n2, depth);
 		}
 	} while (sp > stack);
 }
@@ -202,7 +202,7 @@ g_strconcat (const gchar *first, ...)
 {
 	va_list args;
 	size_t total = 0;
-	char *s, *ret;
+	char *s, *r, *ret;
 	g_return_val_if_fail (first != NULL, NULL);
 
 	total += strlen (first);
@@ -217,22 +217,28 @@ g_strconcat (const gchar *first, ...)
 		return NULL;
 
 	ret [total] = 0;
-	strcpy (ret, first);
+	/* Append at the end instead of using strcat, which rescans the result every time */
+	r = g_stpcpy (ret, first);
 	va_start (args, first);
 	for (s = va_arg (args, char *); s != NULL; s = va_arg(args, char *)){
-		strcat (ret, s);
+		r = g_stpcpy (r, s);
 	}
 	va_end (args);
 
 	return ret;
 }
 
+/*
+ * Store @token as element @size - 1 of @vector, keeping room for the NULL
+ * terminator. The vector grows by doubling, @capacity is its current size.
+ */
 static void
-add_to_vector (gchar ***vector, int size, gchar *token)
+add_to_vector (gchar ***vector, int size, int *capacity, gchar *token)
 {
-	*vector = *vector == NULL ? 
-		(gchar **)g_malloc(2 * sizeof(*vector)) :
-		(gchar **)g_realloc(*vector, (size + 1) * sizeof(*vector));
+	if (size + 1 > *capacity) {
+		*capacity = MAX (size + 1, *capacity * 2);
+		*vector = (gchar **)g_realloc (*vector, *capacity * sizeof (**vector));
+	}
 		
 	(*vector)[size - 1] = token;
 }
@@ -242,30 +248,35 @@ g_strsplit (const gchar *string, const gchar *delimiter, gint max_tokens)
 {
 	const gchar *c;
 	gchar *token, **vector;
-	gint size = 1;
+	gint size = 1, capacity = 0;
+	size_t delimiter_len;
 	
 	g_return_val_if_fail (string != NULL, NULL);
 	g_return_val_if_fail (delimiter != NULL, NULL);
 	g_return_val_if_fail (delimiter[0] != 0, NULL);
+
+	delimiter_len = strlen (delimiter);
+	vector = NULL;
 	
-	if (strncmp (string, delimiter, strlen (delimiter)) == 0) {
-		vector = (gchar **)g_malloc (2 * sizeof(vector));
-		vector[0] = g_strdup ("");
+	if (strncmp (string, delimiter, delimiter_len) == 0) {
+		add_to_vector (&vector, size, &capacity, g_strdup (""));
 		size++;
-		string += strlen (delimiter);
-	} else {
-		vector = NULL;
+		string += delimiter_len;
 	}
 
 	while (*string && !(max_tokens > 0 && size >= max_tokens)) {
 		c = string;
-		if (strncmp (string, delimiter, strlen (delimiter)) == 0) {
+		if (strncmp (string, delimiter, delimiter_len) == 0) {
 			token = g_strdup ("");
-			string += strlen (delimiter);
+			string += delimiter_len;
 		} else {
-			while (*string && strncmp (string, delimiter, strlen (delimiter)) != 0) {
-				string++;
-			}
+			/* The libc functions scan more than a byte at a time */
+			if (delimiter_len == 1)
+				string = strchr (string, delimiter [0]);
+			else
+				string = strstr (string, delimiter);
+			if (!string)
+				string = c + strlen (c);
 
 			if (*string) {
 				gsize toklen = (string - c);
@@ -275,24 +286,24 @@ g_strsplit (const gchar *string, const gchar *delimiter, gint max_tokens)
 				 * token if the delimiter is the last
 				 * part of the string
 				 */
-				if (strcmp (string, delimiter) != 0) {
-					string += strlen (delimiter);
+				if (string [delimiter_len] != 0) {
+					string += delimiter_len;
 				}
 			} else {
 				token = g_strdup (c);
 			}
 		}
 			
-		add_to_vector (&vector, size, token);
+		add_to_vector (&vector, size, &capacity, token);
 		size++;
 	}
 
 	if (*string) {
 		if (strcmp (string, delimiter) == 0)
-			add_to_vector (&vector, size, g_strdup (""));
+			add_to_vector (&vector, size, &capacity, g_strdup (""));
 		else {
 			/* Add the rest of the string as the last element */
-			add_to_vector (&vector, size, g_strdup (string));
+			add_to_vector (&vector, size, &capacity, g_strdup (string));
 		}
 		size++;
 	}
@@ -325,36 +336,38 @@ g_strsplit_set (const gchar *string, const gchar *delimiter, gint max_tokens)
 {
 	const gchar *c;
 	gchar *token, **vector;
-	gint size = 1;
+	gint size = 1, capacity = 0;
+	gsize toklen;
 	
 	g_return_val_if_fail (string != NULL, NULL);
 	g_return_val_if_fail (delimiter != NULL, NULL);
 	g_return_val_if_fail (delimiter[0] != 0, NULL);
 	
+	vector = NULL;
 	if (charcmp (*string, delimiter)) {
-		vector = (gchar **)g_malloc (2 * sizeof(vector));
-		vector[0] = g_strdup ("");
+		add_to_vector (&vector, size, &capacity, g_strdup (""));
 		size++;
 		string++;
-	} else {
-		vector = NULL;
 	}
 
 	c = string;
 	while (*string && !(max_tokens > 0 && size >= max_tokens)) {
-		if (charcmp (*string, delimiter)) {
-			gsize toklen = (string - c);
-			if (toklen == 0) {
-				token = g_strdup ("");
-			} else {
-				token = g_strndup (c, toklen);
-			}
+		/* Skip to the next delimiter */
+		string += strcspn (string, delimiter);
+		if (!*string)
+			break;
+
+		toklen = (string - c);
+		if (toklen == 0) {
+			token = g_strdup ("");
+		} else {
+			token = g_strndup (c, toklen);
+		}
 			
-			c = string + 1;
+		c = string + 1;
 			
-			add_to_vector (&vector, size, token);
-			size++;
-		}
+		add_to_vector (&vector, size, &capacity, token);
+		size++;
 
 		string++;
 	}
@@ -362,19 +375,19 @@ g_strsplit_set (const gchar *string, const gchar *delimiter, gint max_tokens)
 	if (max_tokens > 0 && size >= max_tokens) {
 		if (*string) {
 			/* Add the rest of the string as the last element */
-			add_to_vector (&vector, size, g_strdup (string));
+			add_to_vector (&vector, size, &capacity, g_strdup (string));
 			size++;
 		}
 	} else {
 		if (*c) {
 			/* Fill in the trailing last token */
-			add_to_vector (&vector, size, g_strdup (c));
+			add_to_vector (&vector, size, &capacity, g_strdup (c));
 			size++;
 		} else {
 			/* Need to leave a trailing empty token if the
 			 * delimiter is the last part of the string
 			 */
-			add_to_vector (&vector, size, g_strdup (""));
+			add_to_vector (&vector, size, &capacity, g_strdup (""));
 			size++;
 		}
 	}
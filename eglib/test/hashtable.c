@@ -163,6 +163,61 @@ RESULT hash_iter (void)
 #endif
 }
 
+static gboolean
+is_odd (gpointer key, gpointer value, gpointer user_data)
+{
+	return (GPOINTER_TO_UINT (key) & 1) != 0;
+}
+
+RESULT hash_remove (void)
+{
+	GHashTable *hash = g_hash_table_new (NULL, NULL);
+	GHashTableIter iter;
+	gpointer key;
+	int i, count;
+
+	/* Remove and insert again to leave deleted entries behind */
+	for (i = 0; i < 10000; i++) {
+		g_hash_table_insert (hash, GUINT_TO_POINTER (i), GUINT_TO_POINTER (i + 1));
+		if ((i % 3) == 0)
+			g_hash_table_remove (hash, GUINT_TO_POINTER (i / 2));
+	}
+	for (i = 0; i < 10000; i++) {
+		gpointer value = g_hash_table_lookup (hash, GUINT_TO_POINTER (i));
+		/* Removed when inserting 2 * i or 2 * i + 1 */
+		gboolean removed = i < 5000 && ((2 * i) % 3 == 0 || (2 * i + 1) % 3 == 0);
+
+		if (removed && value != NULL)
+			return FAILED ("Found removed key %d", i);
+		if (!removed && value != GUINT_TO_POINTER (i + 1))
+			return FAILED ("Did not find key %d", i);
+	}
+
+	/* Removing the current key while iterating */
+	count = 0;
+	g_hash_table_iter_init (&iter, hash);
+	while (g_hash_table_iter_next (&iter, &key, NULL)) {
+		count++;
+		if ((GPOINTER_TO_UINT (key) % 5) == 0)
+			g_hash_table_remove (hash, key);
+	}
+	if (count != 6666)
+		return FAILED ("Iterated over %d keys", count);
+
+	g_hash_table_foreach_remove (hash, is_odd, NULL);
+	count = 0;
+	g_hash_table_foreach (hash, counter, &count);
+	if (count != g_hash_table_size (hash))
+		return FAILED ("Foreach count %d does not match the size %d", count, g_hash_table_size (hash));
+	for (i = 0; i < 10000; i++) {
+		if ((i & 1) && g_hash_table_lookup (hash, GUINT_TO_POINTER (i)))
+			return FAILED ("Found odd key %d", i);
+	}
+
+	g_hash_table_destroy (hash);
+	return NULL;
+}
+
 static Test hashtable_tests [] = {
 	{"t1", hash_t1},
 	{"t2", hash_t2},
@@ -170,6 +225,7 @@ static Test hashtable_tests [] = {
 	{"default", hash_default},
 	{"null_lookup", hash_null_lookup},
 	{"iter", hash_iter},
+	{"remove", hash_remove},
 	{NULL, NULL}
 };
 
@@ -85,7 +85,9 @@ RESULT
 test_utf16_to_utf8 ()
 {
 	const gchar *src0 = "", *src1 = "ABCDE", *src2 = "\xE5\xB9\xB4\x27", *src3 = "\xEF\xBC\xA1", *src4 = "\xEF\xBD\x81", *src5 = "\xF0\x90\x90\x80";
+	const gchar *src6 = "ABCDEFGHIJ\xE5\xB9\xB4", *src7 = "AB";
 	gunichar2 str0 [] = {0}, str1 [6], str2 [] = {0x5E74, 39, 0}, str3 [] = {0xFF21, 0}, str4 [] = {0xFF41, 0}, str5 [] = {0xD801, 0xDC00, 0};
+	gunichar2 str6 [] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 0x5E74, 0}, str7 [] = {'A', 'B', 0, 'C', 'D', 'E', 0};
 	RESULT result;
 
 	gchar_to_gunichar2 (str1, src1);
@@ -108,6 +110,14 @@ test_utf16_to_utf8 ()
 	if (result != OK)
 		return result;
 	result = compare_utf16_to_utf8 (src5, str5, 2, 4);
+	if (result != OK)
+		return result;
+	/* ASCII prefix longer than a block, followed by a non ASCII character */
+	result = compare_utf16_to_utf8 (src6, str6, 11, 13);
+	if (result != OK)
+		return result;
+	/* embedded NUL inside the first block */
+	result = compare_utf16_to_utf8_explicit (src7, str7, 2, 2, 6);
 	if (result != OK)
 		return result;
 
@@ -235,6 +245,9 @@ test_utf8_to_utf16 ()
 {
 	const gchar *src0 = "", *src1 = "ABCDE", *src2 = "\xE5\xB9\xB4\x27", *src3 = "\xEF\xBC\xA1", *src4 = "\xEF\xBD\x81";
 	gunichar2 str0 [] = {0}, str1 [6], str2 [] = {0x5E74, 39, 0}, str3 [] = {0xFF21, 0}, str4 [] = {0xFF41, 0};
+	/* an ASCII prefix longer than a word followed by a multi byte sequence */
+	const gchar *src5 = "ABCDEFGHIJ\xE5\xB9\xB4";
+	gunichar2 str5 [] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 0x5E74, 0};
 	RESULT result;
 
 	gchar_to_gunichar2 (str1, src1);
@@ -254,6 +267,9 @@ test_utf8_to_utf16 ()
 	if (result != OK)
 		return result;
 	result = compare_utf8_to_utf16 (str4, src4, 3, 1);
+	if (result != OK)
+		return result;
+	result = compare_utf8_to_utf16 (str5, src5, 13, 11);
 	if (result != OK)
 		return result;
 
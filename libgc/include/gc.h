@@ -422,6 +422,11 @@ GC_API size_t GC_get_free_bytes GC_PROTO((void));
 /* Return the number of bytes allocated since the last collection.	*/
 GC_API size_t GC_get_bytes_since_gc GC_PROTO((void));
 
+/* Return the number of threads used for marking, including the one	*/
+/* running the collection.  1 unless the collector is built with	*/
+/* PARALLEL_MARK and GC_parallel is set.				*/
+GC_API long GC_get_markers GC_PROTO((void));
+
 /* Return the total number of bytes allocated in this process.		*/
 /* Never decreases, except due to wrapping.				*/
 GC_API size_t GC_get_total_bytes GC_PROTO((void));
@@ -460,6 +465,18 @@ GC_API void GC_enable GC_PROTO((void));
 /* before any GC_local_gcj_malloc() calls.	*/
 GC_API void GC_enable_incremental GC_PROTO((void));
 
+/* Record that a pointer may have been stored at p.  Only needed	*/
+/* when the collector was built with MANUAL_VDB, where incremental	*/
+/* and generational collection depend on the client calling it	*/
+/* (or marking the card table) after every heap pointer store.	*/
+GC_API void GC_dirty GC_PROTO((GC_PTR p));
+
+/* Return the card table maintained by GC_dirty, or 0 if dirty bits	*/
+/* are not client maintained.  A store at p is recorded by setting	*/
+/* table [(p >> *shift_bits) & *mask] to a nonzero value.		*/
+GC_API unsigned char * GC_get_card_table GC_PROTO((int * shift_bits,
+						   GC_word * mask));
+
 /* Does incremental mode write-protect pages?  Returns zero or	*/
 /* more of the following, or'ed together:			*/
 #define GC_PROTECTS_POINTER_HEAP  1 /* May protect non-atomic objs.	*/
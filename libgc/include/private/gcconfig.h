@@ -2289,7 +2289,14 @@
 #   undef MPROTECT_VDB  /* For now.	*/
 # endif
 
-# if !defined(PCR_VDB) && !defined(PROC_VDB) && !defined(MPROTECT_VDB)
+# ifdef MANUAL_VDB
+#   undef MPROTECT_VDB  /* The client's write barrier tracks dirty pages. */
+#   undef PROC_VDB
+#   undef PCR_VDB
+# endif
+
+# if !defined(PCR_VDB) && !defined(PROC_VDB) && !defined(MPROTECT_VDB) \
+     && !defined(MANUAL_VDB)
 #   define DEFAULT_VDB
 # endif
 
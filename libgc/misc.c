@@ -471,6 +471,17 @@ size_t GC_get_total_bytes GC_PROTO(())
     return ((size_t) WORDS_TO_BYTES(GC_words_allocd+GC_words_allocd_before_gc));
 }
 
+long GC_get_markers GC_PROTO(())
+{
+#ifdef PARALLEL_MARK
+	extern long GC_markers;
+
+	if (GC_parallel)
+		return GC_markers;
+#endif
+	return 1;
+}
+
 int GC_get_suspend_signal GC_PROTO(())
 {
 #if defined(SIG_SUSPEND) && defined(GC_PTHREADS) && !defined(GC_MACOSX_THREADS) && !defined(GC_OPENBSD_THREADS)
@@ -719,7 +719,7 @@ word GC_page_size;
 #   endif
 # endif
 
-/* 
+/*
  * Find the base of the stack. 
  * Used only in single-threaded environment.
  * With threads, GC_mark_roots needs to know how to do this.
@@ -2366,6 +2366,108 @@ GC_bool is_ptrfree;
 # endif /* DEFAULT_VDB */
 
 
+# ifdef MANUAL_VDB
+
+/*
+ * The client's write barrier records dirty pages, either by calling
+ * GC_dirty or by storing a nonzero byte directly into the card table
+ * returned by GC_get_card_table.  Cards are indexed with PHT_HASH, so
+ * collisions only cause extra pages to be treated as dirty.
+ * See DEFAULT_VDB for interface descriptions.
+ */
+
+VOLATILE unsigned char GC_dirty_cards[PHT_ENTRIES];
+static unsigned char GC_grungy_cards[PHT_ENTRIES];
+
+void GC_dirty_init()
+{
+#   ifdef PRINTSTATS
+      GC_printf0("Initializing MANUAL_VDB...\n");
+#   endif
+    GC_dirty_maintained = TRUE;
+}
+
+void GC_read_dirty()
+{
+    register word i;
+
+    /* Mutators may still be marking cards.  Only clear the cards	*/
+    /* we have seen set, so that a concurrent update is never lost.	*/
+    for (i = 0; i < PHT_ENTRIES; i++) {
+	if (GC_dirty_cards[i]) {
+	    GC_dirty_cards[i] = 0;
+	    GC_grungy_cards[i] = 1;
+	} else {
+	    GC_grungy_cards[i] = 0;
+	}
+    }
+}
+
+GC_bool GC_page_was_dirty(h)
+struct hblk * h;
+{
+    return(HDR(h) == 0 || GC_grungy_cards[PHT_HASH(h)]);
+}
+
+/*ARGSUSED*/
+GC_bool GC_page_was_ever_dirty(h)
+struct hblk *h;
+{
+    return(TRUE);
+}
+
+/*ARGSUSED*/
+void GC_is_fresh(h, n)
+struct hblk *h;
+word n;
+{
+}
+
+/* Nothing is protected, and freshly allocated objects are unmarked,	*/
+/* so they are found through whatever points to them.			*/
+/*ARGSUSED*/
+void GC_remove_protection(h, nblocks, is_ptrfree)
+struct hblk *h;
+word nblocks;
+GC_bool is_ptrfree;
+{
+}
+
+void GC_dirty(p)
+GC_PTR p;
+{
+    GC_dirty_cards[PHT_HASH(p)] = 1;
+}
+
+unsigned char * GC_get_card_table(shift_bits, mask)
+int * shift_bits;
+GC_word * mask;
+{
+    *shift_bits = LOG_HBLKSIZE;
+    *mask = PHT_ENTRIES - 1;
+    return((unsigned char *)GC_dirty_cards);
+}
+
+# else /* !MANUAL_VDB */
+
+/*ARGSUSED*/
+void GC_dirty(p)
+GC_PTR p;
+{
+}
+
+/* No card table: writes are tracked by the VDB implementation itself.	*/
+/*ARGSUSED*/
+unsigned char * GC_get_card_table(shift_bits, mask)
+int * shift_bits;
+GC_word * mask;
+{
+    return(0);
+}
+
+# endif /* MANUAL_VDB */
+
+
 # ifdef MPROTECT_VDB
 
 /*
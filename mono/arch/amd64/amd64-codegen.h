@@ -1126,6 +1126,82 @@ typedef union {
 
 #define amd64_sse_prefetch_reg_membase(inst, arg, basereg, disp) emit_sse_reg_membase_op2((inst), (arg), (basereg), (disp), 0x0f, 0x18)
 
+/* AVX defines, VEX encoded. The L bit selects 128 (0) or 256 (1) bit operands. */
+
+#define AMD64_VEX_PP_NONE 0
+#define AMD64_VEX_PP_66 1
+#define AMD64_VEX_PP_F3 2
+#define AMD64_VEX_PP_F2 3
+
+#define AMD64_VEX_MAP_0F 1
+#define AMD64_VEX_MAP_0F38 2
+#define AMD64_VEX_MAP_0F3A 3
+
+/* VREG is the extra source operand encoded in VEX.vvvv, 0 if unused */
+#define amd64_vex_prefix(inst,reg,vreg,rm,l,pp,map,w) do { \
+	if ((map) == AMD64_VEX_MAP_0F && !(w) && !((rm) & 0x8)) { \
+		*(inst)++ = (unsigned char)0xc5; \
+		*(inst)++ = (unsigned char)((((reg) & 0x8) ? 0 : 0x80) | ((~(vreg) & 0xf) << 3) | ((l) << 2) | (pp)); \
+	} else { \
+		*(inst)++ = (unsigned char)0xc4; \
+		*(inst)++ = (unsigned char)((((reg) & 0x8) ? 0 : 0x80) | 0x40 | (((rm) & 0x8) ? 0 : 0x20) | (map)); \
+		*(inst)++ = (unsigned char)(((w) << 7) | ((~(vreg) & 0xf) << 3) | ((l) << 2) | (pp)); \
+	} \
+} while (0)
+
+#define emit_vex_reg_reg_reg(inst,dreg,sreg1,sreg2,l,pp,map,op) do { \
+    amd64_codegen_pre(inst); \
+    amd64_vex_prefix ((inst), (dreg), (sreg1), (sreg2), (l), (pp), (map), 0); \
+    *(inst)++ = (unsigned char)(op); \
+    x86_reg_emit ((inst), (dreg) & 0x7, (sreg2) & 0x7); \
+    amd64_codegen_post(inst); \
+} while (0)
+
+#define emit_vex_reg_membase(inst,reg,basereg,disp,l,pp,map,op) do { \
+    amd64_codegen_pre(inst); \
+    amd64_vex_prefix ((inst), (reg), 0, (basereg), (l), (pp), (map), 0); \
+    *(inst)++ = (unsigned char)(op); \
+    amd64_membase_emit ((inst), (reg), (basereg), (disp)); \
+    amd64_codegen_post(inst); \
+} while (0)
+
+#define amd64_vzeroupper(inst) do { \
+    amd64_codegen_pre(inst); \
+    *(inst)++ = (unsigned char)0xc5; \
+    *(inst)++ = (unsigned char)0xf8; \
+    *(inst)++ = (unsigned char)0x77; \
+    amd64_codegen_post(inst); \
+} while (0)
+
+#define amd64_avx_vmovups_ymm_membase(inst,dreg,basereg,disp) emit_vex_reg_membase ((inst), (dreg), (basereg), (disp), 1, AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x10)
+#define amd64_avx_vmovups_membase_ymm(inst,basereg,disp,reg) emit_vex_reg_membase ((inst), (reg), (basereg), (disp), 1, AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x11)
+#define amd64_avx_vmovaps_ymm_ymm(inst,dreg,reg) emit_vex_reg_reg_reg ((inst), (dreg), 0, (reg), 1, AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x28)
+
+#define amd64_avx_vaddps_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x58)
+#define amd64_avx_vsubps_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x5c)
+#define amd64_avx_vmulps_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x59)
+#define amd64_avx_vdivps_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_NONE, AMD64_VEX_MAP_0F, 0x5e)
+
+/* AVX2 */
+
+#define amd64_avx2_vpaddb_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xfc)
+#define amd64_avx2_vpaddw_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xfd)
+#define amd64_avx2_vpaddd_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xfe)
+#define amd64_avx2_vpsubb_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xf8)
+#define amd64_avx2_vpsubw_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xf9)
+#define amd64_avx2_vpsubd_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xfa)
+#define amd64_avx2_vpand_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xdb)
+#define amd64_avx2_vpor_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xeb)
+#define amd64_avx2_vpxor_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xef)
+#define amd64_avx2_vpmullw_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F, 0xd5)
+#define amd64_avx2_vpmulld_ymm(inst,dreg,sreg1,sreg2) emit_vex_reg_reg_reg ((inst), (dreg), (sreg1), (sreg2), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F38, 0x40)
+
+/* Broadcast the low element of the xmm register REG */
+#define amd64_avx2_vpbroadcastb_ymm_xmm(inst,dreg,reg) emit_vex_reg_reg_reg ((inst), (dreg), 0, (reg), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F38, 0x78)
+#define amd64_avx2_vpbroadcastw_ymm_xmm(inst,dreg,reg) emit_vex_reg_reg_reg ((inst), (dreg), 0, (reg), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F38, 0x79)
+#define amd64_avx2_vpbroadcastd_ymm_xmm(inst,dreg,reg) emit_vex_reg_reg_reg ((inst), (dreg), 0, (reg), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F38, 0x58)
+#define amd64_avx2_vbroadcastss_ymm_xmm(inst,dreg,reg) emit_vex_reg_reg_reg ((inst), (dreg), 0, (reg), 1, AMD64_VEX_PP_66, AMD64_VEX_MAP_0F38, 0x18)
+
 /* Generated from x86-codegen.h */
 
 #define amd64_breakpoint_size(inst,size) do { x86_breakpoint(inst); } while (0)
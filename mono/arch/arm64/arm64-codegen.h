@@ -440,6 +440,12 @@ arm_encode_imm7 (int imm, int size)
 #define arm_stlxrx(p, rs, rt, rn) arm_format_stlxr ((p), 0x3, (rs), (rn), (rt))
 #define arm_stlxrw(p, rs, rt, rn) arm_format_stlxr ((p), 0x2, (rs), (rn), (rt))
 
+/* C6.2.39 CASAL: Compare and Swap with acquire and release semantics (ARMv8.1 LSE) */
+#define arm_format_casal(p, size, rs, rt, rn) arm_emit ((p), ((size) << 30) | (0x8 << 24) | (0x1 << 23) | (0x1 << 22) | (0x1 << 21) | ((rs) << 16) | (0x1 << 15) | (0x1f << 10) | ((rn) << 5) | ((rt) << 0))
+
+#define arm_casalx(p, rs, rt, rn) arm_format_casal ((p), ARMSIZE_X, (rs), (rt), (rn))
+#define arm_casalw(p, rs, rt, rn) arm_format_casal ((p), ARMSIZE_W, (rs), (rt), (rn))
+
 /* Load/Store SIMD&FP */
 
 /* C6.3.285 STR (immediate, SIMD&FP) */
@@ -0,0 +1,107 @@
+#!/usr/bin/env python
+#
+# Measures the startup time of a hello world program and of a large app,
+# running them with --trace-startup to break the time down by phase.
+#
+# Warm starts are timed after a first run has brought the runtime, the
+# assemblies and the AOT images into the page cache. Cold starts drop the page
+# cache before every run, which needs root; without --cold only warm starts
+# are measured.
+#
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+from optparse import OptionParser
+
+parser = OptionParser (usage = "Usage: %prog [options] HELLO-EXE [LARGE-APP-EXE [LARGE-APP-ARGS...]]")
+parser.add_option ('--mono', dest = 'mono', default = 'mono', help = "runtime to start the programs with")
+parser.add_option ('--runs', dest = 'runs', type = 'int', default = 10, help = "number of timed runs of each program")
+parser.add_option ('--cold', action = 'store_true', dest = 'cold', help = "also measure cold starts, drops the page cache")
+parser.add_option ('--json', dest = 'json', help = "also write the results as JSON to this file")
+parser.disable_interspersed_args ()
+(options, args) = parser.parse_args ()
+
+if len (args) < 1:
+    parser.print_help ()
+    sys.exit (1)
+
+def drop_caches ():
+    subprocess.check_call (['sync'])
+    try:
+        with open ('/proc/sys/vm/drop_caches', 'w') as f:
+            f.write ('3\n')
+    except IOError as e:
+        sys.stderr.write ('Error: cannot drop the page cache for cold starts: %s\n' % e)
+        sys.exit (1)
+
+def run (program, cold):
+    if cold:
+        drop_caches ()
+    trace = tempfile.NamedTemporaryFile (suffix = '.json', delete = False)
+    trace.close ()
+    try:
+        start = time.time ()
+        with open (os.devnull, 'w') as devnull:
+            ret = subprocess.call ([options.mono, '--trace-startup=' + trace.name] + program, stdout = devnull)
+        elapsed = (time.time () - start) * 1000.0
+        if ret != 0:
+            sys.stderr.write ('Error: `%s` exited with %d.\n' % (' '.join (program), ret))
+            sys.exit (1)
+        with open (trace.name) as f:
+            return elapsed, json.load (f)
+    finally:
+        os.unlink (trace.name)
+
+def median (values):
+    values = sorted (values)
+    return values [len (values) // 2]
+
+def measure (name, program, cold):
+    if not cold:
+        # Bring everything into the page cache
+        run (program, False)
+    totals = []
+    startups = []
+    phases = {}
+    for i in range (options.runs):
+        elapsed, trace = run (program, cold)
+        totals.append (elapsed)
+        startups.append (trace ['wall_ms'])
+        for phase, data in trace ['phases'].items ():
+            phases.setdefault (phase, []).append (data ['wall_ms'])
+    return {
+        'program': name,
+        'start': 'cold' if cold else 'warm',
+        'process_ms': median (totals),
+        'startup_ms': median (startups),
+        'startup_min_ms': min (startups),
+        'startup_max_ms': max (startups),
+        'phases_ms': dict ((phase, median (times)) for phase, times in phases.items ()),
+    }
+
+programs = [('hello', [args [0]])]
+if len (args) > 1:
+    programs.append ((os.path.basename (args [1]), args [1:]))
+
+results = []
+for name, program in programs:
+    for cold in ([False, True] if options.cold else [False]):
+        results.append (measure (name, program, cold))
+
+phase_names = ['runtime_init', 'assembly_load', 'aot_load', 'class_init', 'jit']
+sys.stdout.write ('%-16s %5s %11s %11s' % ('program', 'start', 'process ms', 'startup ms'))
+for phase in phase_names:
+    sys.stdout.write (' %13s' % phase)
+sys.stdout.write ('\n')
+for r in results:
+    sys.stdout.write ('%-16s %5s %11.2f %11.2f' % (r ['program'], r ['start'], r ['process_ms'], r ['startup_ms']))
+    for phase in phase_names:
+        sys.stdout.write (' %13.2f' % r ['phases_ms'].get (phase, 0.0))
+    sys.stdout.write ('\n')
+
+if options.json:
+    with open (options.json, 'w') as f:
+        json.dump ({'runs': options.runs, 'results': results}, f, indent = 4)
@@ -0,0 +1,8 @@
+using System;
+
+class Hello {
+	static int Main () {
+		Console.WriteLine ("Hello, World!");
+		return 0;
+	}
+}
@@ -151,6 +151,181 @@ mono_btls_bio_mono_initialize (BIO *bio, const void *instance,
 	bio->init = 1;
 }
 
+/*
+ * Buffer BIO: instead of calling back into managed code for every record,
+ * reads and writes go straight to buffers the managed side has pinned. A
+ * whole batch of received ciphertext is handed over at once and consumed in
+ * place, and the records produced by the handshake or by several writes are
+ * accumulated in the output buffer, to be sent with a single socket write.
+ * When the input runs out or the output is full, the BIO asks to be retried,
+ * so the SSL calls never block and the managed side can await the socket.
+ */
+typedef struct {
+	const uint8_t *in;
+	int in_len;
+	int in_pos;
+	uint8_t *out;
+	int out_size;
+	int out_len;
+} MonoBtlsBioBuffer;
+
+static int
+buffer_read (BIO *bio, char *out, int outl)
+{
+	MonoBtlsBioBuffer *buffer = (MonoBtlsBioBuffer *)bio->ptr;
+	int len;
+
+	BIO_clear_retry_flags (bio);
+	if (!buffer || outl < 0)
+		return -1;
+
+	len = buffer->in_len - buffer->in_pos;
+	if (!len) {
+		BIO_set_retry_read (bio);
+		return -1;
+	}
+	if (len > outl)
+		len = outl;
+	memcpy (out, buffer->in + buffer->in_pos, len);
+	buffer->in_pos += len;
+	return len;
+}
+
+static int
+buffer_write (BIO *bio, const char *in, int inl)
+{
+	MonoBtlsBioBuffer *buffer = (MonoBtlsBioBuffer *)bio->ptr;
+	int len;
+
+	BIO_clear_retry_flags (bio);
+	if (!buffer || inl < 0)
+		return -1;
+
+	len = buffer->out_size - buffer->out_len;
+	if (!len) {
+		BIO_set_retry_write (bio);
+		return -1;
+	}
+	if (len > inl)
+		len = inl;
+	memcpy (buffer->out + buffer->out_len, in, len);
+	buffer->out_len += len;
+	return len;
+}
+
+static int64_t
+buffer_ctrl (BIO *bio, int cmd, int64_t num, void *ptr)
+{
+	MonoBtlsBioBuffer *buffer = (MonoBtlsBioBuffer *)bio->ptr;
+
+	if (!buffer)
+		return 0;
+
+	switch (cmd) {
+		case BIO_CTRL_FLUSH:
+			// The output is sent by the caller when the SSL call returns
+			return 1;
+		case BIO_CTRL_PENDING:
+			return buffer->in_len - buffer->in_pos;
+		case BIO_CTRL_WPENDING:
+			return buffer->out_len;
+		default:
+			return 0;
+	}
+}
+
+static int
+buffer_new (BIO *bio)
+{
+	bio->init = 0;
+	bio->num = -1;
+	bio->flags = 0;
+	return 1;
+}
+
+static int
+buffer_free (BIO *bio)
+{
+	if (bio->ptr) {
+		free (bio->ptr);
+		bio->ptr = NULL;
+	}
+	return 1;
+}
+
+static const BIO_METHOD buffer_method = {
+	BIO_TYPE_NONE, "mono-buffer", buffer_write, buffer_read,
+	NULL, NULL, buffer_ctrl, buffer_new, buffer_free, NULL
+};
+
+MONO_API BIO *
+mono_btls_bio_buffer_new (void)
+{
+	BIO *bio;
+	MonoBtlsBioBuffer *buffer;
+
+	bio = BIO_new (&buffer_method);
+	if (!bio)
+		return NULL;
+
+	buffer = calloc (1, sizeof (MonoBtlsBioBuffer));
+	if (!buffer) {
+		BIO_free (bio);
+		return NULL;
+	}
+
+	bio->ptr = buffer;
+	bio->init = 1;
+
+	return bio;
+}
+
+/*
+ * Hand @len bytes of received ciphertext at @data over to the BIO. The memory
+ * must stay pinned until the next call, or until this is called with NULL.
+ */
+MONO_API void
+mono_btls_bio_buffer_set_input (BIO *bio, const void *data, int len)
+{
+	MonoBtlsBioBuffer *buffer = (MonoBtlsBioBuffer *)bio->ptr;
+
+	buffer->in = data;
+	buffer->in_len = data ? len : 0;
+	buffer->in_pos = 0;
+}
+
+/* How much of the input has been consumed, the rest must be handed over again */
+MONO_API int
+mono_btls_bio_buffer_get_input_consumed (BIO *bio)
+{
+	MonoBtlsBioBuffer *buffer = (MonoBtlsBioBuffer *)bio->ptr;
+
+	return buffer->in_pos;
+}
+
+/*
+ * Write the outgoing records to the @size bytes at @data, which must stay
+ * pinned until the next call, or until this is called with NULL.
+ */
+MONO_API void
+mono_btls_bio_buffer_set_output (BIO *bio, void *data, int size)
+{
+	MonoBtlsBioBuffer *buffer = (MonoBtlsBioBuffer *)bio->ptr;
+
+	buffer->out = data;
+	buffer->out_size = data ? size : 0;
+	buffer->out_len = 0;
+}
+
+/* How many bytes have been written to the output and have to be sent */
+MONO_API int
+mono_btls_bio_buffer_get_output_length (BIO *bio)
+{
+	MonoBtlsBioBuffer *buffer = (MonoBtlsBioBuffer *)bio->ptr;
+
+	return buffer->out_len;
+}
+
 MONO_API int
 mono_btls_bio_read (BIO *bio, void *data, int len)
 {
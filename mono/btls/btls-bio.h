@@ -28,6 +28,21 @@ mono_btls_bio_mono_initialize (BIO *bio, const void *instance,
 			      MonoBtlsReadFunc read_func, MonoBtlsWriteFunc write_func,
 			      MonoBtlsControlFunc control_func);
 
+BIO *
+mono_btls_bio_buffer_new (void);
+
+void
+mono_btls_bio_buffer_set_input (BIO *bio, const void *data, int len);
+
+int
+mono_btls_bio_buffer_get_input_consumed (BIO *bio);
+
+void
+mono_btls_bio_buffer_set_output (BIO *bio, void *data, int size);
+
+int
+mono_btls_bio_buffer_get_output_length (BIO *bio);
+
 int
 mono_btls_bio_read (BIO *bio, void *data, int len);
 
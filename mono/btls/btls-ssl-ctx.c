@@ -8,6 +8,9 @@
 
 #include <btls-ssl-ctx.h>
 #include <btls-x509-verify-param.h>
+#include <btls-x509-cache.h>
+#include <openssl/rand.h>
+#include <pthread.h>
 
 struct MonoBtlsSslCtx {
 	CRYPTO_refcount_t references;
@@ -29,6 +32,35 @@ do { if (mono_btls_ssl_ctx_is_debug_enabled(ptr)) \
 mono_btls_ssl_ctx_debug_printf (ptr, "%s:%d:%s(): " fmt, __FILE__, __LINE__, \
 	__func__, __VA_ARGS__); } while (0)
 
+/*
+ * Server side session cache shared by all the contexts that opt into it, so
+ * that a session established through one SslStream's context can be resumed
+ * through another one. BoringSSL still checks that the session id context,
+ * version and cipher of a cached session match before resuming it.
+ */
+#define SHARED_CACHE_BUCKETS 4096
+#define SHARED_CACHE_DEFAULT_SIZE (20 * 1024)
+
+typedef struct SharedSession SharedSession;
+struct SharedSession {
+	SharedSession *next;
+	/* Insertion order, for eviction */
+	SharedSession *older, *newer;
+	SSL_SESSION *session;
+	unsigned id_len;
+	uint8_t id [SSL_MAX_SSL_SESSION_ID_LENGTH];
+};
+
+static pthread_mutex_t shared_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static SharedSession *shared_cache [SHARED_CACHE_BUCKETS];
+static SharedSession *shared_cache_oldest, *shared_cache_newest;
+static int shared_cache_count;
+static int shared_cache_size = SHARED_CACHE_DEFAULT_SIZE;
+
+static pthread_once_t ticket_keys_once = PTHREAD_ONCE_INIT;
+static uint8_t ticket_keys [48];
+static int ticket_keys_ok;
+
 void ssl_cipher_preference_list_free (struct ssl_cipher_preference_list_st *cipher_list);
 
 MONO_API int
@@ -113,7 +145,7 @@ cert_verify_callback (X509_STORE_CTX *storeCtx, void *arg)
 	int ret;
 
 	debug_printf (ptr, "cert_verify_callback(): %p\n", ptr->verify_func);
-	ret = X509_verify_cert (storeCtx);
+	ret = mono_btls_x509_cache_verify_cert (storeCtx);
 	debug_printf (ptr, "cert_verify_callback() #1: %d\n", ret);
 
 	if (ptr->verify_func)
@@ -253,3 +285,214 @@ mono_btls_ssl_ctx_set_verify_param (MonoBtlsSslCtx *ctx, const MonoBtlsX509Verif
 	return SSL_CTX_set1_param (ctx->ctx, mono_btls_x509_verify_param_peek_param (param));
 }
 
+static unsigned
+shared_cache_hash (const uint8_t *id, unsigned id_len)
+{
+	unsigned hash = 0, i;
+
+	/* Session ids are random */
+	for (i = 0; i < id_len && i < 4; i++)
+		hash = (hash << 8) | id [i];
+	return hash & (SHARED_CACHE_BUCKETS - 1);
+}
+
+/* Must be called with shared_cache_mutex held, returns the session to free */
+static SSL_SESSION *
+shared_cache_unlink (SharedSession **link)
+{
+	SharedSession *entry = *link;
+	SSL_SESSION *session = entry->session;
+
+	*link = entry->next;
+	if (entry->older)
+		entry->older->newer = entry->newer;
+	else
+		shared_cache_oldest = entry->newer;
+	if (entry->newer)
+		entry->newer->older = entry->older;
+	else
+		shared_cache_newest = entry->older;
+	shared_cache_count--;
+	OPENSSL_free (entry);
+	return session;
+}
+
+static SharedSession **
+shared_cache_find (const uint8_t *id, unsigned id_len)
+{
+	SharedSession **link;
+
+	for (link = &shared_cache [shared_cache_hash (id, id_len)]; *link; link = &(*link)->next) {
+		if ((*link)->id_len == id_len && !memcmp ((*link)->id, id, id_len))
+			return link;
+	}
+	return NULL;
+}
+
+static int
+shared_cache_new_cb (SSL *ssl, SSL_SESSION *session)
+{
+	SharedSession *entry, **link;
+	SSL_SESSION *evicted [2] = { NULL, NULL };
+	const uint8_t *id;
+	unsigned id_len;
+
+	id = SSL_SESSION_get_id (session, &id_len);
+	if (!id_len || id_len > SSL_MAX_SSL_SESSION_ID_LENGTH)
+		return 0;
+
+	entry = OPENSSL_malloc (sizeof (SharedSession));
+	if (!entry)
+		return 0;
+	memset (entry, 0, sizeof (SharedSession));
+	memcpy (entry->id, id, id_len);
+	entry->id_len = id_len;
+	entry->session = session;
+	SSL_SESSION_up_ref (session);
+
+	pthread_mutex_lock (&shared_cache_mutex);
+	link = shared_cache_find (id, id_len);
+	if (link)
+		evicted [0] = shared_cache_unlink (link);
+	if (shared_cache_count >= shared_cache_size && shared_cache_oldest)
+		evicted [1] = shared_cache_unlink (shared_cache_find (shared_cache_oldest->id, shared_cache_oldest->id_len));
+
+	link = &shared_cache [shared_cache_hash (id, id_len)];
+	entry->next = *link;
+	*link = entry;
+	entry->older = shared_cache_newest;
+	if (shared_cache_newest)
+		shared_cache_newest->newer = entry;
+	else
+		shared_cache_oldest = entry;
+	shared_cache_newest = entry;
+	shared_cache_count++;
+	pthread_mutex_unlock (&shared_cache_mutex);
+
+	/* Freeing a session can call back into the cache */
+	SSL_SESSION_free (evicted [0]);
+	SSL_SESSION_free (evicted [1]);
+
+	/* We took our own reference */
+	return 0;
+}
+
+static SSL_SESSION *
+shared_cache_get_cb (SSL *ssl, uint8_t *id, int id_len, int *out_copy)
+{
+	SharedSession **link;
+	SSL_SESSION *session = NULL;
+
+	/* The reference is taken under the lock, so that an eviction can't free the session first */
+	*out_copy = 0;
+
+	pthread_mutex_lock (&shared_cache_mutex);
+	link = shared_cache_find (id, (unsigned)id_len);
+	if (link) {
+		session = (*link)->session;
+		SSL_SESSION_up_ref (session);
+	}
+	pthread_mutex_unlock (&shared_cache_mutex);
+
+	return session;
+}
+
+static void
+shared_cache_remove_cb (SSL_CTX *ssl_ctx, SSL_SESSION *session)
+{
+	SharedSession **link;
+	SSL_SESSION *removed = NULL;
+	const uint8_t *id;
+	unsigned id_len;
+
+	id = SSL_SESSION_get_id (session, &id_len);
+
+	pthread_mutex_lock (&shared_cache_mutex);
+	link = shared_cache_find (id, id_len);
+	if (link && (*link)->session == session)
+		removed = shared_cache_unlink (link);
+	pthread_mutex_unlock (&shared_cache_mutex);
+
+	SSL_SESSION_free (removed);
+}
+
+/*
+ * Enable session resumption on @ctx. Servers must pass an @id_context which
+ * identifies the configuration sessions can be resumed with, typically a hash
+ * of the certificate and of the client certificate requirements. With
+ * MONO_BTLS_SESSION_CACHE_SHARED, server sessions go to the process-wide cache
+ * instead of the context's own one. @timeout is in seconds, 0 keeps the default.
+ */
+MONO_API int
+mono_btls_ssl_ctx_set_session_cache (MonoBtlsSslCtx *ctx, int mode, const void *id_context, int id_context_len, int timeout)
+{
+	int cache_mode = SSL_SESS_CACHE_OFF;
+
+	if (mode & MONO_BTLS_SESSION_CACHE_CLIENT)
+		cache_mode |= SSL_SESS_CACHE_CLIENT;
+	if (mode & (MONO_BTLS_SESSION_CACHE_SERVER | MONO_BTLS_SESSION_CACHE_SHARED))
+		cache_mode |= SSL_SESS_CACHE_SERVER;
+	if (mode & MONO_BTLS_SESSION_CACHE_SHARED) {
+		cache_mode |= SSL_SESS_CACHE_NO_INTERNAL;
+		SSL_CTX_sess_set_new_cb (ctx->ctx, shared_cache_new_cb);
+		SSL_CTX_sess_set_get_cb (ctx->ctx, shared_cache_get_cb);
+		SSL_CTX_sess_set_remove_cb (ctx->ctx, shared_cache_remove_cb);
+	}
+
+	if (id_context && id_context_len > 0) {
+		if (!SSL_CTX_set_session_id_context (ctx->ctx, id_context, id_context_len))
+			return 0;
+	}
+	if (timeout > 0)
+		SSL_CTX_set_timeout (ctx->ctx, timeout);
+
+	debug_printf (ctx, "mono_btls_ssl_ctx_set_session_cache(): %x\n", cache_mode);
+	SSL_CTX_set_session_cache_mode (ctx->ctx, cache_mode);
+	return 1;
+}
+
+/*
+ * Limit the number of sessions in the process-wide cache, the oldest ones are
+ * evicted first.
+ */
+MONO_API void
+mono_btls_ssl_ctx_set_shared_session_cache_size (int size)
+{
+	pthread_mutex_lock (&shared_cache_mutex);
+	shared_cache_size = size > 0 ? size : SHARED_CACHE_DEFAULT_SIZE;
+	pthread_mutex_unlock (&shared_cache_mutex);
+}
+
+static void
+init_ticket_keys (void)
+{
+	ticket_keys_ok = RAND_bytes (ticket_keys, sizeof (ticket_keys));
+}
+
+/*
+ * Configure session tickets on @ctx. @keys are the 48 bytes of the ticket key
+ * name, HMAC and AES keys; when NULL, all the contexts share random keys
+ * generated once per process, so that any of them can decrypt the tickets
+ * issued by another. @len == 0 with non NULL @keys disables tickets.
+ */
+MONO_API int
+mono_btls_ssl_ctx_set_ticket_keys (MonoBtlsSslCtx *ctx, const void *keys, int len)
+{
+	if (keys && !len) {
+		SSL_CTX_set_options (ctx->ctx, SSL_OP_NO_TICKET);
+		return 1;
+	}
+
+	SSL_CTX_clear_options (ctx->ctx, SSL_OP_NO_TICKET);
+	if (!keys) {
+		pthread_once (&ticket_keys_once, init_ticket_keys);
+		if (!ticket_keys_ok)
+			return 0;
+		keys = ticket_keys;
+		len = sizeof (ticket_keys);
+	}
+	if (len != 48)
+		return 0;
+
+	return (int)SSL_CTX_set_tlsext_ticket_keys (ctx->ctx, (void *)keys, len);
+}
@@ -29,6 +29,13 @@ typedef struct MonoBtlsPkcs12 MonoBtlsPkcs12;
 typedef struct MonoBtlsSsl MonoBtlsSsl;
 typedef struct MonoBtlsSslCtx MonoBtlsSslCtx;
 
+typedef enum {
+	MONO_BTLS_SESSION_CACHE_OFF	= 0,
+	MONO_BTLS_SESSION_CACHE_CLIENT	= 1,
+	MONO_BTLS_SESSION_CACHE_SERVER	= 2,
+	MONO_BTLS_SESSION_CACHE_SHARED	= 4
+} MonoBtlsSessionCacheMode;
+
 typedef int (* MonoBtlsVerifyFunc) (void *instance, int preverify_ok, X509_STORE_CTX *ctx);
 typedef int (* MonoBtlsSelectFunc) (void *instance);
 
@@ -81,4 +88,13 @@ mono_btls_ssl_ctx_set_ciphers (MonoBtlsSslCtx *ctx, int count, const uint16_t *d
 int
 mono_btls_ssl_ctx_set_verify_param (MonoBtlsSslCtx *ctx, const MonoBtlsX509VerifyParam *param);
 
+int
+mono_btls_ssl_ctx_set_session_cache (MonoBtlsSslCtx *ctx, int mode, const void *id_context, int id_context_len, int timeout);
+
+void
+mono_btls_ssl_ctx_set_shared_session_cache_size (int size);
+
+int
+mono_btls_ssl_ctx_set_ticket_keys (MonoBtlsSslCtx *ctx, const void *keys, int len);
+
 #endif /* __btls_ssl_ctx__btls_ssl_ctx__ */
@@ -37,6 +37,8 @@ mono_btls_ssl_new (MonoBtlsSslCtx *ctx)
 	ptr->ssl = SSL_new (mono_btls_ssl_ctx_get_ctx (ptr->ctx));
 
 	SSL_set_options (ptr->ssl, SSL_OP_NO_SSLv2 | SSL_OP_NO_SSLv3);
+	// Pinned buffers can move between a call that wants to be retried and its retry
+	SSL_set_mode (ptr->ssl, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
 
 	return ptr;
 }
@@ -111,6 +113,39 @@ mono_btls_ssl_handshake (MonoBtlsSsl *ptr)
 	return SSL_do_handshake (ptr->ssl);
 }
 
+/*
+ * Run the handshake until it completes or it has to wait, without blocking:
+ * with a buffer BIO, the caller awaits the socket and calls this again.
+ * Returns 1 when done, 0 when *want tells what to wait for and -1 on error.
+ */
+MONO_API int
+mono_btls_ssl_handshake_async (MonoBtlsSsl *ptr, int *want)
+{
+	int ret;
+
+	*want = MONO_BTLS_SSL_WANT_NOTHING;
+	ret = SSL_do_handshake (ptr->ssl);
+	if (ret == 1)
+		return 1;
+
+	switch (SSL_get_error (ptr->ssl, ret)) {
+	case SSL_ERROR_WANT_READ:
+		*want = MONO_BTLS_SSL_WANT_READ;
+		break;
+	case SSL_ERROR_WANT_WRITE:
+		*want = MONO_BTLS_SSL_WANT_WRITE;
+		break;
+	case SSL_ERROR_WANT_X509_LOOKUP:
+		// The certificate select callback returned -1
+		*want = MONO_BTLS_SSL_WANT_CERTIFICATE;
+		break;
+	default:
+		debug_printf (ptr, "mono_btls_ssl_handshake_async(): %d\n", ret);
+		return -1;
+	}
+	return 0;
+}
+
 MONO_API int
 mono_btls_ssl_read (MonoBtlsSsl *ptr, void *buf, int count)
 {
@@ -213,3 +248,28 @@ mono_btls_ssl_get_server_name (MonoBtlsSsl *ptr)
 {
 	return SSL_get_servername (ptr->ssl, TLSEXT_NAMETYPE_host_name);
 }
+
+/* The session to resume the next connection to the same server with */
+MONO_API SSL_SESSION *
+mono_btls_ssl_get_session (MonoBtlsSsl *ptr)
+{
+	return SSL_get1_session (ptr->ssl);
+}
+
+MONO_API int
+mono_btls_ssl_set_session (MonoBtlsSsl *ptr, SSL_SESSION *session)
+{
+	return SSL_set_session (ptr->ssl, session);
+}
+
+MONO_API int
+mono_btls_ssl_session_reused (MonoBtlsSsl *ptr)
+{
+	return SSL_session_reused (ptr->ssl);
+}
+
+MONO_API void
+mono_btls_ssl_session_free (SSL_SESSION *session)
+{
+	SSL_SESSION_free (session);
+}
@@ -11,6 +11,13 @@
 
 #include <btls-ssl-ctx.h>
 
+typedef enum {
+	MONO_BTLS_SSL_WANT_NOTHING	= 0,
+	MONO_BTLS_SSL_WANT_READ		= 1,
+	MONO_BTLS_SSL_WANT_WRITE	= 2,
+	MONO_BTLS_SSL_WANT_CERTIFICATE	= 3
+} MonoBtlsSslWant;
+
 MonoBtlsSsl *
 mono_btls_ssl_new (MonoBtlsSslCtx *ctx);
 
@@ -32,6 +39,9 @@ mono_btls_ssl_connect (MonoBtlsSsl *ptr);
 int
 mono_btls_ssl_handshake (MonoBtlsSsl *ptr);
 
+int
+mono_btls_ssl_handshake_async (MonoBtlsSsl *ptr, int *want);
+
 void
 mono_btls_ssl_print_errors_cb (ERR_print_errors_callback_t callback, void *ctx);
 
@@ -80,6 +90,18 @@ mono_btls_ssl_set_server_name (MonoBtlsSsl *ptr, const char *name);
 const char *
 mono_btls_ssl_get_server_name (MonoBtlsSsl *ptr);
 
+SSL_SESSION *
+mono_btls_ssl_get_session (MonoBtlsSsl *ptr);
+
+int
+mono_btls_ssl_set_session (MonoBtlsSsl *ptr, SSL_SESSION *session);
+
+int
+mono_btls_ssl_session_reused (MonoBtlsSsl *ptr);
+
+void
+mono_btls_ssl_session_free (SSL_SESSION *session);
+
 void
 mono_btls_ssl_destroy (MonoBtlsSsl *ptr);
 
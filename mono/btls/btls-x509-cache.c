@@ -0,0 +1,310 @@
+//
+//  btls-x509-cache.c
+//  MonoBtls
+//
+//  Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//
+
+#include <btls-x509-cache.h>
+#include <openssl/sha.h>
+#include <pthread.h>
+#include <time.h>
+
+/*
+ * Process-wide caches for clients that connect to the same endpoints over and
+ * over again:
+ *
+ * - Parsed certificates, keyed by the SHA-256 of their DER encoding, so the
+ *   trust anchors and intermediates the managed side hands over are parsed
+ *   once and the same X509 is shared by every context.
+ *
+ * - Successfully verified chains, keyed by the SHA-256 of the store, the
+ *   verification parameters, the leaf and the untrusted certificates. On a
+ *   hit, X509_verify_cert () still runs, but the issuers come from the cached
+ *   chain instead of the store lookups (which may call back into managed
+ *   code) and the signatures aren't checked again. Host name, purpose, trust
+ *   and validity period checks are still done for every verification.
+ *
+ * Both tables are direct mapped, a new entry replaces the one in its slot.
+ * Verified chains expire after a TTL, so changes to the trust anchors the
+ * managed lookups return are picked up eventually, or right away after a
+ * mono_btls_x509_cache_clear (). The verification cache is disabled until a
+ * TTL is set.
+ */
+#define PARSED_CACHE_SIZE 1024
+#define VERIFY_CACHE_SIZE 1024
+
+typedef struct {
+	uint8_t key [SHA256_DIGEST_LENGTH];
+	X509 *x509;
+} ParsedCert;
+
+typedef struct {
+	uint8_t key [SHA256_DIGEST_LENGTH];
+	X509_STORE *store;
+	STACK_OF(X509) *chain;
+	time_t expires;
+} VerifiedChain;
+
+typedef struct CachedVerify CachedVerify;
+struct CachedVerify {
+	X509_STORE_CTX *ctx;
+	STACK_OF(X509) *chain;
+	int (*verify) (X509_STORE_CTX *ctx);
+	int (*get_issuer) (X509 **issuer, X509_STORE_CTX *ctx, X509 *x);
+	CachedVerify *previous;
+};
+
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ParsedCert parsed_certs [PARSED_CACHE_SIZE];
+static VerifiedChain verified_chains [VERIFY_CACHE_SIZE];
+static int verify_ttl;
+
+static pthread_once_t cached_verify_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cached_verify_key;
+
+static unsigned
+key_slot (const uint8_t *key, unsigned size)
+{
+	return (((unsigned)key [0] << 8) | key [1]) & (size - 1);
+}
+
+static void
+free_verified_chain (VerifiedChain *entry)
+{
+	if (entry->chain)
+		sk_X509_pop_free (entry->chain, X509_free);
+	if (entry->store)
+		X509_STORE_free (entry->store);
+}
+
+MONO_API X509 *
+mono_btls_x509_cache_parse (const void *buf, int len)
+{
+	uint8_t key [SHA256_DIGEST_LENGTH];
+	const uint8_t *p = buf;
+	ParsedCert *slot;
+	X509 *x509, *replaced;
+
+	SHA256 (buf, len, key);
+	slot = &parsed_certs [key_slot (key, PARSED_CACHE_SIZE)];
+
+	pthread_mutex_lock (&cache_mutex);
+	if (slot->x509 && !memcmp (slot->key, key, sizeof (key))) {
+		x509 = X509_up_ref (slot->x509);
+		pthread_mutex_unlock (&cache_mutex);
+		return x509;
+	}
+	pthread_mutex_unlock (&cache_mutex);
+
+	x509 = d2i_X509 (NULL, &p, len);
+	if (!x509)
+		return NULL;
+
+	pthread_mutex_lock (&cache_mutex);
+	replaced = slot->x509;
+	memcpy (slot->key, key, sizeof (key));
+	slot->x509 = X509_up_ref (x509);
+	pthread_mutex_unlock (&cache_mutex);
+
+	X509_free (replaced);
+	return x509;
+}
+
+static int
+verify_cache_key (X509_STORE_CTX *ctx, uint8_t *key)
+{
+	SHA256_CTX sha;
+	uint8_t md [SHA256_DIGEST_LENGTH];
+	unsigned md_len;
+	size_t i;
+	struct {
+		const X509_STORE *store;
+		unsigned long flags;
+		int purpose;
+		int trust;
+		int depth;
+	} header;
+
+	memset (&header, 0, sizeof (header));
+	header.store = ctx->ctx;
+	header.flags = X509_VERIFY_PARAM_get_flags (ctx->param);
+	header.purpose = ctx->param->purpose;
+	header.trust = ctx->param->trust;
+	header.depth = X509_VERIFY_PARAM_get_depth (ctx->param);
+
+	SHA256_Init (&sha);
+	SHA256_Update (&sha, &header, sizeof (header));
+	if (!X509_digest (ctx->cert, EVP_sha256 (), md, &md_len))
+		return 0;
+	SHA256_Update (&sha, md, md_len);
+	for (i = 0; ctx->untrusted && i < sk_X509_num (ctx->untrusted); i++) {
+		if (!X509_digest (sk_X509_value (ctx->untrusted, i), EVP_sha256 (), md, &md_len))
+			return 0;
+		SHA256_Update (&sha, md, md_len);
+	}
+	SHA256_Final (key, &sha);
+	return 1;
+}
+
+static void
+cached_verify_init (void)
+{
+	pthread_key_create (&cached_verify_key, NULL);
+}
+
+static CachedVerify *
+cached_verify_get (X509_STORE_CTX *ctx)
+{
+	CachedVerify *state = pthread_getspecific (cached_verify_key);
+
+	while (state && state->ctx != ctx)
+		state = state->previous;
+	return state;
+}
+
+static int
+cached_get_issuer (X509 **issuer, X509_STORE_CTX *ctx, X509 *x)
+{
+	CachedVerify *state = cached_verify_get (ctx);
+	size_t i, count = sk_X509_num (state->chain);
+
+	/*
+	 * Only the issuers that were found in the store the first time are asked
+	 * for, the others still come from the same untrusted certificates.
+	 */
+	for (i = 0; i < count; i++) {
+		if (X509_cmp (sk_X509_value (state->chain, i), x))
+			continue;
+		if (i + 1 < count) {
+			*issuer = X509_up_ref (sk_X509_value (state->chain, i + 1));
+			return 1;
+		}
+		// The trust anchor, which is looked up again when it was sent by the peer
+		if (X509_check_issued (x, x) == X509_V_OK) {
+			*issuer = X509_up_ref (x);
+			return 1;
+		}
+		break;
+	}
+	return state->get_issuer (issuer, ctx, x);
+}
+
+static int
+cached_verify (X509_STORE_CTX *ctx)
+{
+	CachedVerify *state = cached_verify_get (ctx);
+	size_t i, count = sk_X509_num (ctx->chain);
+
+	if (count != sk_X509_num (state->chain))
+		return state->verify (ctx);
+	for (i = 0; i < count; i++) {
+		X509 *x = sk_X509_value (ctx->chain, i);
+
+		if (X509_cmp (x, sk_X509_value (state->chain, i)))
+			return state->verify (ctx);
+		// Let the full verification report the right error
+		if (X509_cmp_current_time (X509_get_notBefore (x)) >= 0 ||
+		    X509_cmp_current_time (X509_get_notAfter (x)) <= 0)
+			return state->verify (ctx);
+	}
+	return 1;
+}
+
+/*
+ * Same as X509_verify_cert (), with the verified chain cache described above.
+ */
+MONO_API int
+mono_btls_x509_cache_verify_cert (X509_STORE_CTX *ctx)
+{
+	uint8_t key [SHA256_DIGEST_LENGTH];
+	VerifiedChain *slot, replaced;
+	CachedVerify state;
+	STACK_OF(X509) *chain = NULL;
+	time_t now;
+	int ttl, ret;
+
+	ttl = verify_ttl;
+	if (ttl <= 0 || !ctx->cert || !ctx->ctx)
+		return X509_verify_cert (ctx);
+	// Cached chains are only checked against the current time
+	if (X509_VERIFY_PARAM_get_flags (ctx->param) & X509_V_FLAG_USE_CHECK_TIME)
+		return X509_verify_cert (ctx);
+	if (!verify_cache_key (ctx, key))
+		return X509_verify_cert (ctx);
+
+	now = time (NULL);
+	slot = &verified_chains [key_slot (key, VERIFY_CACHE_SIZE)];
+
+	pthread_mutex_lock (&cache_mutex);
+	if (slot->chain && !memcmp (slot->key, key, sizeof (key)) && slot->expires > now)
+		chain = X509_chain_up_ref (slot->chain);
+	pthread_mutex_unlock (&cache_mutex);
+
+	if (chain) {
+		pthread_once (&cached_verify_once, cached_verify_init);
+		memset (&state, 0, sizeof (state));
+		state.ctx = ctx;
+		state.chain = chain;
+		state.verify = ctx->verify;
+		state.get_issuer = ctx->get_issuer;
+		state.previous = pthread_getspecific (cached_verify_key);
+		pthread_setspecific (cached_verify_key, &state);
+		ctx->verify = cached_verify;
+		ctx->get_issuer = cached_get_issuer;
+
+		ret = X509_verify_cert (ctx);
+
+		ctx->verify = state.verify;
+		ctx->get_issuer = state.get_issuer;
+		pthread_setspecific (cached_verify_key, state.previous);
+		sk_X509_pop_free (chain, X509_free);
+		return ret;
+	}
+
+	ret = X509_verify_cert (ctx);
+	if (ret != 1 || X509_STORE_CTX_get_error (ctx) != X509_V_OK || !ctx->chain)
+		return ret;
+
+	chain = X509_chain_up_ref (ctx->chain);
+	if (!chain)
+		return ret;
+
+	pthread_mutex_lock (&cache_mutex);
+	replaced = *slot;
+	memcpy (slot->key, key, sizeof (key));
+	slot->chain = chain;
+	slot->store = ctx->ctx;
+	CRYPTO_refcount_inc (&slot->store->references);
+	slot->expires = now + ttl;
+	pthread_mutex_unlock (&cache_mutex);
+
+	free_verified_chain (&replaced);
+	return ret;
+}
+
+/*
+ * How long verified chains are cached for, in seconds. 0 disables the cache.
+ */
+MONO_API void
+mono_btls_x509_cache_set_verify_ttl (int seconds)
+{
+	verify_ttl = seconds > 0 ? seconds : 0;
+	if (!verify_ttl)
+		mono_btls_x509_cache_clear ();
+}
+
+/*
+ * Forget all the verified chains, to be called when the trust anchors change.
+ */
+MONO_API void
+mono_btls_x509_cache_clear (void)
+{
+	int i;
+
+	pthread_mutex_lock (&cache_mutex);
+	for (i = 0; i < VERIFY_CACHE_SIZE; i++)
+		free_verified_chain (&verified_chains [i]);
+	memset (verified_chains, 0, sizeof (verified_chains));
+	pthread_mutex_unlock (&cache_mutex);
+}
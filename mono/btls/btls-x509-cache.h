@@ -0,0 +1,26 @@
+//
+//  btls-x509-cache.h
+//  MonoBtls
+//
+//  Licensed under the MIT license. See LICENSE file in the project root for full license information.
+//
+
+#ifndef __btls__btls_x509_cache__
+#define __btls__btls_x509_cache__
+
+#include <stdio.h>
+#include <btls-ssl.h>
+
+X509 *
+mono_btls_x509_cache_parse (const void *buf, int len);
+
+int
+mono_btls_x509_cache_verify_cert (X509_STORE_CTX *ctx);
+
+void
+mono_btls_x509_cache_set_verify_ttl (int seconds);
+
+void
+mono_btls_x509_cache_clear (void);
+
+#endif /* defined(__btls__btls_x509_cache__) */
@@ -7,6 +7,7 @@
 //
 
 #include <btls-x509-store-ctx.h>
+#include <btls-x509-cache.h>
 
 struct MonoBtlsX509StoreCtx {
 	int owns;
@@ -160,7 +161,7 @@ mono_btls_x509_store_ctx_set_param (MonoBtlsX509StoreCtx *ctx, MonoBtlsX509Verif
 MONO_API int
 mono_btls_x509_store_ctx_verify_cert (MonoBtlsX509StoreCtx *ctx)
 {
-	return X509_verify_cert (ctx->ctx);
+	return mono_btls_x509_cache_verify_cert (ctx->ctx);
 }
 
 MONO_API X509 *
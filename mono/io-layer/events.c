@@ -18,6 +18,7 @@
 #include <mono/io-layer/io-trace.h>
 #include <mono/utils/mono-once.h>
 #include <mono/utils/mono-logger-internals.h>
+#include <mono/utils/mono-memory-model.h>
 #include <mono/utils/w32handle.h>
 
 static void event_signal(gpointer handle);
@@ -394,6 +395,15 @@ gboolean ResetEvent(gpointer handle)
 	MONO_TRACE (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_LAYER, "%s: resetting %s handle %p",
 		__func__, event_handle_type_to_string (type), handle);
 
+	/* Resetting an event which isn't signalled doesn't change its state, as set_count
+	 * is already 0, so there is no need to take the handle lock */
+	mono_memory_barrier ();
+	if (!mono_w32handle_issignalled (handle)) {
+		MONO_TRACE (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_LAYER, "%s: no need to reset %s handle %p",
+			__func__, event_handle_type_to_string (type), handle);
+		return TRUE;
+	}
+
 	thr_ret = mono_w32handle_lock_handle (handle);
 	g_assert (thr_ret == 0);
 
@@ -458,6 +468,16 @@ gboolean SetEvent(gpointer handle)
 	MONO_TRACE (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_LAYER, "%s: setting %s handle %p",
 		__func__, event_handle_type_to_string (type), handle);
 
+	/* Setting an event which is already signalled doesn't change its state, as
+	 * set_count is already 1, and nobody can be waiting on it, so there is no
+	 * need to take the handle lock */
+	mono_memory_barrier ();
+	if (mono_w32handle_issignalled (handle)) {
+		MONO_TRACE (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_LAYER, "%s: no need to set %s handle %p",
+			__func__, event_handle_type_to_string (type), handle);
+		return TRUE;
+	}
+
 	thr_ret = mono_w32handle_lock_handle (handle);
 	g_assert (thr_ret == 0);
 
@@ -375,207 +375,139 @@ GDir *_wapi_g_dir_open (const gchar *path, guint flags, GError **error)
 }
 
 
-static gint
-file_compare (gconstpointer a, gconstpointer b)
+static DIR *
+wapi_opendir (const gchar *path)
 {
-	gchar *astr = *(gchar **) a;
-	gchar *bstr = *(gchar **) b;
+	DIR *ret;
+	gchar *located_filename;
+
+	ret = opendir (path);
+	if (ret == NULL &&
+	    (errno == ENOENT || errno == ENOTDIR || errno == ENAMETOOLONG) &&
+	    IS_PORTABILITY_SET) {
+		gint saved_errno = errno;
+
+		located_filename = mono_portability_find_file (path, TRUE);
+		if (located_filename == NULL) {
+			errno = saved_errno;
+			return(NULL);
+		}
+
+		ret = opendir (located_filename);
+		g_free (located_filename);
+	}
 
-	return strcmp (astr, bstr);
+	return(ret);
 }
 
+typedef struct {
+	gchar *name;
+	guchar type;
+} ScandirEntry;
+
 static gint
-get_errno_from_g_file_error (gint error)
+entry_compare (gconstpointer a, gconstpointer b, gpointer user_data)
 {
-	switch (error) {
-#ifdef EACCESS
-	case G_FILE_ERROR_ACCES:
-		error = EACCES;
-		break;
-#endif
-#ifdef ENAMETOOLONG
-	case G_FILE_ERROR_NAMETOOLONG:
-		error = ENAMETOOLONG;
-		break;
-#endif
-#ifdef ENOENT
-	case G_FILE_ERROR_NOENT:
-		error = ENOENT;
-		break;
-#endif
-#ifdef ENOTDIR
-	case G_FILE_ERROR_NOTDIR:
-		error = ENOTDIR;
-		break;
-#endif
-#ifdef ENXIO
-	case G_FILE_ERROR_NXIO:
-		error = ENXIO;
-		break;
-#endif
-#ifdef ENODEV
-	case G_FILE_ERROR_NODEV:
-		error = ENODEV;
-		break;
-#endif
-#ifdef EROFS
-	case G_FILE_ERROR_ROFS:
-		error = EROFS;
-		break;
-#endif
-#ifdef ETXTBSY
-	case G_FILE_ERROR_TXTBSY:
-		error = ETXTBSY;
-		break;
-#endif
-#ifdef EFAULT
-	case G_FILE_ERROR_FAULT:
-		error = EFAULT;
-		break;
-#endif
-#ifdef ELOOP
-	case G_FILE_ERROR_LOOP:
-		error = ELOOP;
-		break;
-#endif
-#ifdef ENOSPC
-	case G_FILE_ERROR_NOSPC:
-		error = ENOSPC;
-		break;
-#endif
-#ifdef ENOMEM
-	case G_FILE_ERROR_NOMEM:
-		error = ENOMEM;
-		break;
-#endif
-#ifdef EMFILE
-	case G_FILE_ERROR_MFILE:
-		error = EMFILE;
-		break;
-#endif
-#ifdef ENFILE
-	case G_FILE_ERROR_NFILE:
-		error = ENFILE;
-		break;
-#endif
-#ifdef EBADF
-	case G_FILE_ERROR_BADF:
-		error = EBADF;
-		break;
-#endif
-#ifdef EINVAL
-	case G_FILE_ERROR_INVAL:
-		error = EINVAL;
-		break;
-#endif
-#ifdef EPIPE
-	case G_FILE_ERROR_PIPE:
-		error = EPIPE;
-		break;
-#endif
-#ifdef EAGAIN
-	case G_FILE_ERROR_AGAIN:
-		error = EAGAIN;
-		break;
-#endif
-#ifdef EINTR
-	case G_FILE_ERROR_INTR:
-		error = EINTR;
-		break;
-#endif
-#ifdef EWIO
-	case G_FILE_ERROR_IO:
-		error = EIO;
-		break;
-#endif
-#ifdef EPERM
-	case G_FILE_ERROR_PERM:
-		error = EPERM;
-		break;
-#endif
-	case G_FILE_ERROR_FAILED:
-		error = ERROR_INVALID_PARAMETER;
-		break;
-	}
-
-	return error;
+	return strcmp (((ScandirEntry *) a)->name, ((ScandirEntry *) b)->name);
 }
 
-/* scandir using glib */
+/*
+ * scandir with one readdir () pass over the directory.  The entry types
+ * from the directory itself are returned in @typelist (DT_UNKNOWN if the
+ * file system doesn't provide them), so callers only need to stat the
+ * entries when they want more than the file type.
+ */
 gint _wapi_io_scandir (const gchar *dirname, const gchar *pattern,
-		       gchar ***namelist)
+		       gchar ***namelist, guchar **typelist)
 {
-	GError *error = NULL;
-	GDir *dir;
-	GPtrArray *names;
-	gint result;
-	wapi_glob_t glob_buf;
+	DIR *dir;
+	struct dirent *entry;
+	GArray *entries;
+	wapi_glob_matcher_t matcher, matcher2;
+	gboolean has_matcher2;
 	int flags = 0, i;
-	
-	dir = _wapi_g_dir_open (dirname, 0, &error);
-	if (dir == NULL) {
-		/* g_dir_open returns ENOENT on directories on which we don't
-		 * have read/x permission */
-		gint errnum = get_errno_from_g_file_error (error->code);
-		g_error_free (error);
-		if (errnum == ENOENT &&
-		    !_wapi_access (dirname, F_OK) &&
-		    _wapi_access (dirname, R_OK|X_OK)) {
-			errnum = EACCES;
-		}
+	gint result;
 
-		errno = errnum;
+	dir = wapi_opendir (dirname);
+	if (dir == NULL)
 		return -1;
-	}
 
 	if (IS_PORTABILITY_CASE) {
 		flags = WAPI_GLOB_IGNORECASE;
 	}
-	
-	result = _wapi_glob (dir, pattern, flags, &glob_buf);
-	if (g_str_has_suffix (pattern, ".*")) {
-		/* Special-case the patterns ending in '.*', as
-		 * windows also matches entries with no extension with
-		 * this pattern.
-		 * 
-		 * TODO: should this be a MONO_IOMAP option?
-		 */
+
+	_wapi_glob_matcher_init (&matcher, pattern, flags);
+
+	/* Special-case the patterns ending in '.*', as windows also
+	 * matches entries with no extension with this pattern.
+	 *
+	 * TODO: should this be a MONO_IOMAP option?
+	 */
+	has_matcher2 = g_str_has_suffix (pattern, ".*");
+	if (has_matcher2) {
 		gchar *pattern2 = g_strndup (pattern, strlen (pattern) - 2);
-		gint result2;
-		
-		g_dir_rewind (dir);
-		result2 = _wapi_glob (dir, pattern2, flags | WAPI_GLOB_APPEND | WAPI_GLOB_UNIQUE, &glob_buf);
 
+		_wapi_glob_matcher_init (&matcher2, pattern2, flags);
 		g_free (pattern2);
-
-		if (result != 0) {
-			result = result2;
-		}
 	}
-	
-	g_dir_close (dir);
-	if (glob_buf.gl_pathc == 0) {
-		return(0);
-	} else if (result != 0) {
-		return(-1);
+
+	entries = g_array_new (FALSE, FALSE, sizeof (ScandirEntry));
+	for (;;) {
+		ScandirEntry e;
+		size_t len;
+
+		errno = 0;
+		entry = readdir (dir);
+		if (entry == NULL)
+			break;
+
+		/* Like g_dir_read_name () */
+		if (entry->d_name [0] == '.' && (entry->d_name [1] == 0 || (entry->d_name [1] == '.' && entry->d_name [2] == 0)))
+			continue;
+
+		len = strlen (entry->d_name);
+		if (!_wapi_glob_matcher_match (&matcher, entry->d_name, len) &&
+		    !(has_matcher2 && _wapi_glob_matcher_match (&matcher2, entry->d_name, len)))
+			continue;
+
+		e.name = g_strndup (entry->d_name, len);
+#ifdef DT_UNKNOWN
+		e.type = entry->d_type;
+#else
+		e.type = 0;
+#endif
+		g_array_append_val (entries, e);
 	}
-	
-	names = g_ptr_array_new ();
-	for (i = 0; i < glob_buf.gl_pathc; i++) {
-		g_ptr_array_add (names, g_strdup (glob_buf.gl_pathv[i]));
+	result = errno;
+
+	closedir (dir);
+	_wapi_glob_matcher_free (&matcher);
+	if (has_matcher2)
+		_wapi_glob_matcher_free (&matcher2);
+
+	if (result != 0) {
+		for (i = 0; i < entries->len; i++)
+			g_free (((ScandirEntry *) entries->data) [i].name);
+		g_array_free (entries, TRUE);
+		errno = result;
+		return -1;
 	}
 
-	_wapi_globfree (&glob_buf);
-
-	result = names->len;
+	result = entries->len;
 	if (result > 0) {
-		g_ptr_array_sort (names, file_compare);
-		g_ptr_array_set_size (names, result + 1);
+		ScandirEntry *sorted = (ScandirEntry *) entries->data;
 
-		*namelist = (gchar **) g_ptr_array_free (names, FALSE);
-	} else {
-		g_ptr_array_free (names, TRUE);
+		g_qsort_with_data (sorted, result, sizeof (ScandirEntry), entry_compare, NULL);
+
+		*namelist = g_new (gchar *, result + 1);
+		*typelist = g_new (guchar, result);
+		for (i = 0; i < result; i++) {
+			(*namelist) [i] = sorted [i].name;
+			(*typelist) [i] = sorted [i].type;
+		}
+		(*namelist) [result] = NULL;
 	}
+	g_array_free (entries, TRUE);
 
 	return result;
 }
@@ -42,6 +42,8 @@ struct _WapiHandle_file
 struct _WapiHandle_find
 {
 	gchar **namelist;
+	/* d_type of each entry, DT_UNKNOWN if the file system didn't say */
+	guchar *typelist;
 	gchar *dir_part;
 	int num;
 	size_t count;
@@ -30,11 +30,17 @@
 #include <sys/types.h>
 #include <stdio.h>
 #include <utime.h>
+#ifdef HAVE_DIRENT_H
+#include <dirent.h>
+#endif
 #ifdef __linux__
 #include <sys/ioctl.h>
 #include <linux/fs.h>
 #include <mono/utils/linux_magic.h>
 #endif
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
 
 #include <mono/io-layer/wapi.h>
 #include <mono/io-layer/wapi-private.h>
@@ -2029,14 +2035,89 @@ gboolean MoveFile (const gunichar2 *name, const gunichar2 *dest_name)
 	return(ret);
 }
 
+/*
+ * Copy from the current offset of @src_fd to @dest_fd without going through
+ * user space, with copy_file_range () or sendfile (). Returns FALSE with errno
+ * set if there was an error, and sets @done to FALSE if the kernel can't copy
+ * between these files, in which case the caller copies the rest itself. The
+ * file offsets are advanced by whatever was copied.
+ */
+static gboolean
+kernel_copy_file (int src_fd, int dest_fd, struct stat *st_src, gboolean *done)
+{
+#if defined(__linux__) && (defined(HAVE_COPY_FILE_RANGE) || defined(HAVE_SENDFILE))
+	MonoThreadInfo *info = mono_thread_info_current ();
+	gboolean use_copy_file_range;
+	ssize_t n;
+
+	*done = FALSE;
+	if (!S_ISREG (st_src->st_mode))
+		return TRUE;
+
+#ifdef HAVE_COPY_FILE_RANGE
+	use_copy_file_range = TRUE;
+#else
+	use_copy_file_range = FALSE;
+#endif
+	for (;;) {
+#ifdef HAVE_COPY_FILE_RANGE
+		if (use_copy_file_range)
+			n = copy_file_range (src_fd, NULL, dest_fd, NULL, 0x40000000, 0);
+		else
+#endif
+#ifdef HAVE_SENDFILE
+			n = sendfile (dest_fd, src_fd, NULL, 0x40000000);
+#else
+			n = -1, errno = ENOSYS;
+#endif
+		if (n > 0)
+			continue;
+		if (n == 0) {
+			*done = TRUE;
+			return TRUE;
+		}
+		if (errno == EINTR && !mono_thread_info_is_interrupt_state (info))
+			continue;
+
+		switch (errno) {
+		case EXDEV:
+		case ENOSYS:
+		case EINVAL:
+		case EOPNOTSUPP:
+			/* Not supported for this pair of files, see if sendfile () is */
+			if (use_copy_file_range) {
+				use_copy_file_range = FALSE;
+				continue;
+			}
+			return TRUE;
+		default:
+			return FALSE;
+		}
+	}
+#else
+	*done = FALSE;
+	return TRUE;
+#endif
+}
+
 static gboolean
 write_file (int src_fd, int dest_fd, struct stat *st_src, gboolean report_errors)
 {
 	int remain, n;
 	char *buf, *wbuf;
 	int buf_size = st_src->st_blksize;
+	gboolean done;
 	MonoThreadInfo *info = mono_thread_info_current ();
 
+	if (!kernel_copy_file (src_fd, dest_fd, st_src, &done)) {
+		if (report_errors)
+			_wapi_set_last_error_from_errno ();
+		MONO_TRACE (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_LAYER, "%s: kernel copy failed: %s", __func__, strerror (errno));
+		return FALSE;
+	}
+	if (done)
+		return TRUE;
+
 	buf_size = buf_size < 8192 ? 8192 : (buf_size > 65536 ? 65536 : buf_size);
 	buf = (char *) g_malloc (buf_size);
 
@@ -2865,8 +2946,9 @@ gpointer FindFirstFile (const gunichar2 *pattern, WapiFindData *find_data)
 	 */
 
 	find_handle.namelist = NULL;
+	find_handle.typelist = NULL;
 	result = _wapi_io_scandir (dir_part, entry_part,
-				   &find_handle.namelist);
+				   &find_handle.namelist, &find_handle.typelist);
 	
 	if (result == 0) {
 		/* No files, which windows seems to call
@@ -2918,7 +3000,82 @@ gpointer FindFirstFile (const gunichar2 *pattern, WapiFindData *find_data)
 	return (handle);
 }
 
-gboolean FindNextFile (gpointer handle, WapiFindData *find_data)
+/* Whether a directory entry of @type can be described without stat ()ing it */
+static gboolean
+find_type_is_known (guchar type)
+{
+#ifdef DT_UNKNOWN
+	return type != DT_UNKNOWN && type != DT_LNK;
+#else
+	return FALSE;
+#endif
+}
+
+static gboolean
+find_set_name (WapiFindData *find_data, const gchar *utf8_basename)
+{
+	gunichar2 *utf16_basename;
+	glong bytes;
+
+	utf16_basename = g_utf8_to_utf16 (utf8_basename, -1, NULL, &bytes,
+					  NULL);
+	if(utf16_basename==NULL)
+		return FALSE;
+
+	/* utf16 is 2 * utf8 */
+	bytes *= 2;
+
+	memset (find_data->cFileName, '\0', (MAX_PATH*2));
+
+	/* Truncating a utf16 string like this might leave the last
+	 * char incomplete
+	 */
+	memcpy (find_data->cFileName, utf16_basename,
+		bytes<(MAX_PATH*2)-2?bytes:(MAX_PATH*2)-2);
+
+	find_data->cAlternateFileName [0] = 0;	/* not used */
+
+	g_free (utf16_basename);
+	return TRUE;
+}
+
+/*
+ * Fill @find_data from the directory entry type alone.  Only the
+ * directory and hidden attributes are meaningful, the times and the
+ * size are left as zero.
+ */
+static gboolean
+find_next_basic (const gchar *name, guchar type, WapiFindData *find_data)
+{
+	gchar *utf8_name;
+	gboolean ret;
+
+	utf8_name = mono_utf8_from_external (name);
+	if (utf8_name == NULL) {
+		g_warning ("%s: Bad encoding for '%s'\nConsider using MONO_EXTERNAL_ENCODINGS\n", __func__, name);
+		return FALSE;
+	}
+
+	MONO_TRACE (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_LAYER, "%s: Found [%s]", __func__, utf8_name);
+
+	memset (find_data, 0, G_STRUCT_OFFSET (WapiFindData, cFileName));
+#ifdef DT_DIR
+	if (type == DT_DIR)
+		find_data->dwFileAttributes = FILE_ATTRIBUTE_DIRECTORY;
+#endif
+	if (utf8_name [0] == '.')
+		find_data->dwFileAttributes |= FILE_ATTRIBUTE_HIDDEN;
+	if (find_data->dwFileAttributes == 0)
+		find_data->dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+
+	ret = find_set_name (find_data, utf8_name);
+	g_free (utf8_name);
+
+	return ret;
+}
+
+static gboolean
+find_next_file (gpointer handle, WapiFindData *find_data, gboolean basic)
 {
 	struct _WapiHandle_find *find_handle;
 	gboolean ok;
@@ -2926,9 +3083,8 @@ gboolean FindNextFile (gpointer handle, WapiFindData *find_data)
 	int result;
 	gchar *filename;
 	gchar *utf8_filename, *utf8_basename;
-	gunichar2 *utf16_basename;
 	time_t create_time;
-	glong bytes;
+	guchar type;
 	int thr_ret;
 	gboolean ret = FALSE;
 	
@@ -2950,6 +3106,15 @@ retry:
 		goto cleanup;
 	}
 
+	type = find_handle->typelist ? find_handle->typelist [find_handle->count] : 0;
+
+	if (basic && find_type_is_known (type)) {
+		if (!find_next_basic (find_handle->namelist [find_handle->count ++], type, find_data))
+			goto retry;
+		ret = TRUE;
+		goto cleanup;
+	}
+
 	/* stat next match */
 
 	filename = g_build_filename (find_handle->dir_part, find_handle->namelist[find_handle->count ++], NULL);
@@ -2968,12 +3133,15 @@ retry:
 	}
 
 #ifndef __native_client__
-	result = _wapi_lstat (filename, &linkbuf);
-	if (result != 0) {
-		MONO_TRACE (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_LAYER, "%s: lstat failed: %s", __func__, filename);
-
-		g_free (filename);
-		goto retry;
+	/* The directory already told us whether it's a symlink */
+	if (!find_type_is_known (type)) {
+		result = _wapi_lstat (filename, &linkbuf);
+		if (result != 0) {
+			MONO_TRACE (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_LAYER, "%s: lstat failed: %s", __func__, filename);
+
+			g_free (filename);
+			goto retry;
+		}
 	}
 #endif
 
@@ -3002,7 +3170,7 @@ retry:
 #ifdef __native_client__
 	find_data->dwFileAttributes = _wapi_stat_to_file_attributes (utf8_filename, &buf, NULL);
 #else
-	find_data->dwFileAttributes = _wapi_stat_to_file_attributes (utf8_filename, &buf, &linkbuf);
+	find_data->dwFileAttributes = _wapi_stat_to_file_attributes (utf8_filename, &buf, find_type_is_known (type) ? NULL : &linkbuf);
 #endif
 
 	_wapi_time_t_to_filetime (create_time, &find_data->ftCreationTime);
@@ -3021,31 +3189,15 @@ retry:
 	find_data->dwReserved1 = 0;
 
 	utf8_basename = _wapi_basename (utf8_filename);
-	utf16_basename = g_utf8_to_utf16 (utf8_basename, -1, NULL, &bytes,
-					  NULL);
-	if(utf16_basename==NULL) {
+	if (!find_set_name (find_data, utf8_basename)) {
 		g_free (utf8_basename);
 		g_free (utf8_filename);
 		goto retry;
 	}
 	ret = TRUE;
-	
-	/* utf16 is 2 * utf8 */
-	bytes *= 2;
-
-	memset (find_data->cFileName, '\0', (MAX_PATH*2));
-
-	/* Truncating a utf16 string like this might leave the last
-	 * char incomplete
-	 */
-	memcpy (find_data->cFileName, utf16_basename,
-		bytes<(MAX_PATH*2)-2?bytes:(MAX_PATH*2)-2);
-
-	find_data->cAlternateFileName [0] = 0;	/* not used */
 
 	g_free (utf8_basename);
 	g_free (utf8_filename);
-	g_free (utf16_basename);
 
 cleanup:
 	thr_ret = mono_w32handle_unlock_handle (handle);
@@ -3054,6 +3206,32 @@ cleanup:
 	return(ret);
 }
 
+gboolean FindNextFile (gpointer handle, WapiFindData *find_data)
+{
+	return find_next_file (handle, find_data, FALSE);
+}
+
+/**
+ * FindNextFileBasic:
+ * @handle: a find handle returned by FindFirstFile ()
+ * @find_data: where to store the next entry
+ * @attr_mask: the attributes the caller is going to look at
+ *
+ * Like FindNextFile (), but when only the directory and hidden
+ * attributes are in @attr_mask, entries whose type the directory
+ * already reported are returned without a stat (), with zero times
+ * and size. Enumerating large directories then doesn't need a system
+ * call per entry.
+ *
+ * Return value: %TRUE on success, %FALSE otherwise.
+ */
+gboolean FindNextFileBasic (gpointer handle, WapiFindData *find_data, guint32 attr_mask)
+{
+	gboolean basic = (attr_mask & ~(FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_HIDDEN)) == 0;
+
+	return find_next_file (handle, find_data, basic);
+}
+
 /**
  * FindClose:
  * @wapi_handle: the find handle to close.
@@ -3086,6 +3264,7 @@ gboolean FindClose (gpointer handle)
 	g_assert (thr_ret == 0);
 	
 	g_strfreev (find_handle->namelist);
+	g_free (find_handle->typelist);
 	g_free (find_handle->dir_part);
 
 	thr_ret = mono_w32handle_unlock_handle (handle);
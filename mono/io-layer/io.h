@@ -191,6 +191,8 @@ extern gboolean FileTimeToSystemTime(const WapiFileTime *file_time,
 extern gpointer FindFirstFile (const gunichar2 *pattern,
 			       WapiFindData *find_data);
 extern gboolean FindNextFile (gpointer handle, WapiFindData *find_data);
+extern gboolean FindNextFileBasic (gpointer handle, WapiFindData *find_data,
+				   guint32 attr_mask);
 extern gboolean FindClose (gpointer handle);
 extern gboolean CreateDirectory (const gunichar2 *name,
 				 WapiSecurityAttributes *security);
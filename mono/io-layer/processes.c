@@ -2755,6 +2755,7 @@ process_wait (gpointer handle, guint32 timeout, gboolean *alerted)
 	WapiHandle_process *process_handle;
 	pid_t pid G_GNUC_UNUSED, ret;
 	int status;
+	int thr_ret;
 	gint64 start, now;
 	struct MonoProcess *mp;
 
@@ -2868,8 +2869,15 @@ process_wait (gpointer handle, guint32 timeout, gboolean *alerted)
 	MONO_TRACE (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_LAYER, "%s (%p, %u): Setting pid %d signalled, exit status %d",
 		   __func__, handle, timeout, process_handle->id, process_handle->exitstatus);
 
+	/* The handle lock protects the threads waiting for multiple handles */
+	thr_ret = mono_w32handle_lock_handle (handle);
+	g_assert (thr_ret == 0);
+
 	mono_w32handle_set_signal_state (handle, TRUE, TRUE);
 
+	thr_ret = mono_w32handle_unlock_handle (handle);
+	g_assert (thr_ret == 0);
+
 	return WAIT_OBJECT_0;
 }
 
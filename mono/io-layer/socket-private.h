@@ -22,6 +22,7 @@ struct _WapiHandle_socket
 	int protocol;
 	int saved_error;
 	int still_readable;
+	int zerocopy; /* SO_ZEROCOPY: 0 not tried yet, 1 enabled, -1 unsupported */
 };
 
 void
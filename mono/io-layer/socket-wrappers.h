@@ -86,6 +86,20 @@ extern int _wapi_FD_ISSET(guint32 handle, fd_set *set);
 extern void _wapi_FD_SET(guint32 handle, fd_set *set);
 #endif
 
+/* Batched datagrams, return the number of datagrams transferred */
+extern int _wapi_sendmmsg(guint32 handle, WapiWSABuf *buffers,
+			  struct sockaddr **to, socklen_t *tolen,
+			  guint32 *sent, guint32 count, int send_flags);
+extern int _wapi_recvmmsg(guint32 handle, WapiWSABuf *buffers,
+			  struct sockaddr **from, socklen_t *fromlen,
+			  guint32 *received, guint32 count, int recv_flags);
+
+extern int _wapi_send_zerocopy(guint32 handle, WapiWSABuf *buffers,
+			       guint32 count, guint32 *sent, int send_flags,
+			       gboolean *zerocopy);
+extern int _wapi_zerocopy_completion(guint32 handle, guint32 *first,
+				     guint32 *last, gboolean *copied);
+
 extern void _wapi_cleanup_networking (void);
 #endif /* HOST_WIN32 */
 
@@ -55,6 +55,10 @@
 #ifdef HAVE_NETDB_H
 #include <netdb.h>
 #endif
+#if defined(SO_ZEROCOPY) && defined(MSG_ZEROCOPY) && defined(HAVE_LINUX_ERRQUEUE_H)
+#include <linux/errqueue.h>
+#define WAPI_ZEROCOPY 1
+#endif
 
 static guint32 in_cleanup = 0;
 
@@ -972,16 +976,57 @@ static gboolean wapi_disconnectex (guint32 fd, WapiOverlapped *overlapped,
 }
 
 #define SF_BUFFER_SIZE	16384
+
+/* Copy the rest of @file to @socket through a user space buffer */
 static gint
-wapi_sendfile (guint32 socket, gpointer fd, guint32 bytes_to_write, guint32 bytes_per_send, guint32 flags)
+wapi_sendfile_copy (guint32 socket, gint file)
 {
 	MonoThreadInfo *info = mono_thread_info_current ();
-#if defined(HAVE_SENDFILE) && (defined(__linux__) || defined(DARWIN))
+	gchar *buffer;
+	gssize n, sent, res;
+
+	buffer = g_malloc (SF_BUFFER_SIZE);
+	for (;;) {
+		do {
+			n = read (file, buffer, SF_BUFFER_SIZE);
+		} while (n == -1 && errno == EINTR && !mono_thread_info_is_interrupt_state (info));
+		if (n <= 0)
+			break;
+
+		for (sent = 0; sent < n; sent += res) {
+			do {
+				res = send (socket, buffer + sent, n - sent, 0);
+			} while (res == -1 && errno == EINTR && !mono_thread_info_is_interrupt_state (info));
+			if (res == -1)
+				break;
+		}
+		if (res == -1) {
+			n = -1;
+			break;
+		}
+	}
+
+	if (n == -1) {
+		gint errnum = errno;
+		errnum = errno_to_WSA (errnum, __func__);
+		WSASetLastError (errnum);
+		g_free (buffer);
+		return SOCKET_ERROR;
+	}
+	g_free (buffer);
+	return 0;
+}
+
+static gint
+wapi_sendfile (guint32 socket, gpointer fd, guint32 bytes_to_write, guint32 bytes_per_send, guint32 flags)
+{
 	gint file = GPOINTER_TO_INT (fd);
+#if defined(HAVE_SENDFILE) && (defined(__linux__) || defined(DARWIN))
+	MonoThreadInfo *info = mono_thread_info_current ();
 	gint n;
 	gint errnum;
-	gssize res;
 	struct stat statbuf;
+	off_t offset, remaining;
 
 	n = fstat (file, &statbuf);
 	if (n == -1) {
@@ -990,53 +1035,54 @@ wapi_sendfile (guint32 socket, gpointer fd, guint32 bytes_to_write, guint32 byte
 		WSASetLastError (errnum);
 		return SOCKET_ERROR;
 	}
-	do {
+	if (!S_ISREG (statbuf.st_mode))
+		return wapi_sendfile_copy (socket, file);
+
+	/* sendfile () can return after a partial send, keep going until the whole file is in the socket */
+	offset = 0;
+	remaining = statbuf.st_size;
+	while (remaining > 0) {
 #ifdef __linux__
-		res = sendfile (socket, file, NULL, statbuf.st_size);
+		gssize res;
+
+		do {
+			res = sendfile (socket, file, &offset, MIN (remaining, 0x40000000));
+		} while (res == -1 && errno == EINTR && !mono_thread_info_is_interrupt_state (info));
+		if (res == 0)
+			break;
 #elif defined(DARWIN)
-		/* TODO: header/tail could be sent in the 5th argument */
-		/* TODO: Might not send the entire file for non-blocking sockets */
-		res = sendfile (file, socket, 0, &statbuf.st_size, NULL, 0);
-#endif
-	} while (res != -1 && errno == EINTR && !mono_thread_info_is_interrupt_state (info));
-	if (res == -1) {
-		errnum = errno;
-		errnum = errno_to_WSA (errnum, __func__);
-		WSASetLastError (errnum);
-		return SOCKET_ERROR;
-	}
-#else
-	/* Default implementation */
-	gint file = GPOINTER_TO_INT (fd);
-	gchar *buffer;
-	gint n;
+		off_t len = remaining;
+		gint res;
 
-	buffer = g_malloc (SF_BUFFER_SIZE);
-	do {
+		/* TODO: header/tail could be sent in the 5th argument */
 		do {
-			n = read (file, buffer, SF_BUFFER_SIZE);
-		} while (n == -1 && errno == EINTR && !mono_thread_info_is_interrupt_state (info));
-		if (n == -1)
+			res = sendfile (file, socket, offset, &len, NULL, 0);
+			/* The length is updated with what was sent even on EINTR/EAGAIN */
+			offset += len;
+			remaining -= len;
+			len = remaining;
+		} while (res == -1 && errno == EINTR && !mono_thread_info_is_interrupt_state (info));
+		if (res == 0)
 			break;
-		if (n == 0) {
-			g_free (buffer);
-			return 0; /* We're done reading */
+#endif
+		if (res == -1) {
+			errnum = errno;
+			/* Not supported for this file or socket, copy whatever is left */
+			if ((errnum == EINVAL || errnum == ENOSYS || errnum == EOPNOTSUPP) && lseek (file, offset, SEEK_SET) != -1)
+				return wapi_sendfile_copy (socket, file);
+			errnum = errno_to_WSA (errnum, __func__);
+			WSASetLastError (errnum);
+			return SOCKET_ERROR;
 		}
-		do {
-			n = send (socket, buffer, n, 0); /* short sends? enclose this in a loop? */
-		} while (n == -1 && errno == EINTR && !mono_thread_info_is_interrupt_state (info));
-	} while (n != -1 && errno == EINTR && !mono_thread_info_is_interrupt_state (info));
-
-	if (n == -1) {
-		gint errnum = errno;
-		errnum = errno_to_WSA (errnum, __func__);
-		WSASetLastError (errnum);
-		g_free (buffer);
-		return SOCKET_ERROR;
-	}
-	g_free (buffer);
+#ifdef __linux__
+		remaining -= res;
 #endif
+	}
 	return 0;
+#else
+	/* Default implementation */
+	return wapi_sendfile_copy (socket, file);
+#endif
 }
 
 gboolean
@@ -1454,4 +1500,282 @@ int WSASend (guint32 fd, WapiWSABuf *buffers, guint32 count, guint32 *sent,
 	return 0;
 }
 
+/* Datagrams per sendmmsg/recvmmsg call, which bounds the stack usage */
+#define MMSG_BATCH 64
+
+/*
+ * Send @count datagrams, @to [i] (if @to is not NULL) is the destination of
+ * @buffers [i] and @sent [i] receives the number of bytes sent. Like a short
+ * write, an error after the first datagram just ends the batch.
+ */
+int _wapi_sendmmsg(guint32 fd, WapiWSABuf *buffers, struct sockaddr **to,
+		   socklen_t *tolen, guint32 *sent, guint32 count,
+		   int send_flags)
+{
+	gpointer handle = GUINT_TO_POINTER (fd);
+	guint32 done = 0;
+	int ret = 0;
+	MonoThreadInfo *info = mono_thread_info_current ();
+
+	if (mono_w32handle_get_type (handle) != MONO_W32HANDLE_SOCKET) {
+		WSASetLastError (WSAENOTSOCK);
+		return(SOCKET_ERROR);
+	}
+
+#ifdef HAVE_SENDMMSG
+	while (done < count) {
+		struct mmsghdr msgs [MMSG_BATCH];
+		struct iovec iovs [MMSG_BATCH];
+		guint32 i, n = MIN (count - done, MMSG_BATCH);
+
+		memset (msgs, 0, n * sizeof (struct mmsghdr));
+		for (i = 0; i < n; i++) {
+			iovs [i].iov_base = buffers [done + i].buf;
+			iovs [i].iov_len = buffers [done + i].len;
+			msgs [i].msg_hdr.msg_iov = &iovs [i];
+			msgs [i].msg_hdr.msg_iovlen = 1;
+			if (to && to [done + i]) {
+				msgs [i].msg_hdr.msg_name = to [done + i];
+				msgs [i].msg_hdr.msg_namelen = tolen [done + i];
+			}
+		}
+
+		do {
+			ret = sendmmsg (fd, msgs, n, send_flags);
+		} while (ret == -1 && errno == EINTR &&
+			 !mono_thread_info_is_interrupt_state (info));
+
+		if (ret == -1)
+			break;
+		for (i = 0; i < (guint32) ret; i++)
+			sent [done + i] = msgs [i].msg_len;
+		done += ret;
+		/* The socket buffer is full */
+		if ((guint32) ret < n)
+			break;
+	}
+#else
+	while (done < count) {
+		do {
+			ret = sendto (fd, buffers [done].buf, buffers [done].len, send_flags,
+				      to ? to [done] : NULL, to && to [done] ? tolen [done] : 0);
+		} while (ret == -1 && errno == EINTR &&
+			 !mono_thread_info_is_interrupt_state (info));
+
+		if (ret == -1)
+			break;
+		sent [done++] = ret;
+	}
+#endif
+
+	if (ret == -1 && done == 0) {
+		gint errnum = errno;
+		MONO_TRACE (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_LAYER, "%s: sendmmsg error: %s", __func__, strerror (errno));
+
+		errnum = errno_to_WSA (errnum, __func__);
+		WSASetLastError (errnum);
+
+		return(SOCKET_ERROR);
+	}
+	return(done);
+}
+
+/*
+ * Receive up to @count datagrams, waiting only for the first one. @from [i]
+ * (if @from is not NULL) receives the source address of @buffers [i], and
+ * @fromlen [i] its length.
+ */
+int _wapi_recvmmsg(guint32 fd, WapiWSABuf *buffers, struct sockaddr **from,
+		   socklen_t *fromlen, guint32 *received, guint32 count,
+		   int recv_flags)
+{
+	gpointer handle = GUINT_TO_POINTER (fd);
+	int ret;
+	MonoThreadInfo *info = mono_thread_info_current ();
+
+	if (mono_w32handle_get_type (handle) != MONO_W32HANDLE_SOCKET) {
+		WSASetLastError (WSAENOTSOCK);
+		return(SOCKET_ERROR);
+	}
+
+	if (count == 0)
+		return(0);
+
+#if defined(HAVE_RECVMMSG) && defined(MSG_WAITFORONE)
+	{
+		struct mmsghdr msgs [MMSG_BATCH];
+		struct iovec iovs [MMSG_BATCH];
+		guint32 i, n = MIN (count, MMSG_BATCH);
+
+		memset (msgs, 0, n * sizeof (struct mmsghdr));
+		for (i = 0; i < n; i++) {
+			iovs [i].iov_base = buffers [i].buf;
+			iovs [i].iov_len = buffers [i].len;
+			msgs [i].msg_hdr.msg_iov = &iovs [i];
+			msgs [i].msg_hdr.msg_iovlen = 1;
+			if (from) {
+				msgs [i].msg_hdr.msg_name = from [i];
+				msgs [i].msg_hdr.msg_namelen = fromlen [i];
+			}
+		}
+
+		do {
+			ret = recvmmsg (fd, msgs, n, recv_flags | MSG_WAITFORONE, NULL);
+		} while (ret == -1 && errno == EINTR &&
+			 !mono_thread_info_is_interrupt_state (info));
+
+		for (i = 0; ret > 0 && i < (guint32) ret; i++) {
+			received [i] = msgs [i].msg_len;
+			if (from)
+				fromlen [i] = msgs [i].msg_hdr.msg_namelen;
+		}
+	}
+#else
+	do {
+		ret = recvfrom (fd, buffers [0].buf, buffers [0].len, recv_flags,
+				from ? from [0] : NULL, from ? &fromlen [0] : NULL);
+	} while (ret == -1 && errno == EINTR &&
+		 !mono_thread_info_is_interrupt_state (info));
+
+	if (ret != -1) {
+		received [0] = ret;
+		ret = 1;
+	}
+#endif
+
+	if (ret == -1) {
+		gint errnum = errno;
+		MONO_TRACE (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_LAYER, "%s: recvmmsg error: %s", __func__, strerror (errno));
+
+		errnum = errno_to_WSA (errnum, __func__);
+		WSASetLastError (errnum);
+
+		return(SOCKET_ERROR);
+	}
+	return(ret);
+}
+
+/*
+ * Send @buffers with MSG_ZEROCOPY where supported. If *@zerocopy is set, the
+ * kernel may still be reading from the buffers, which must not change until
+ * _wapi_zerocopy_completion () reports the send as completed.
+ */
+int _wapi_send_zerocopy(guint32 fd, WapiWSABuf *buffers, guint32 count,
+			guint32 *sent, int send_flags, gboolean *zerocopy)
+{
+	gpointer handle = GUINT_TO_POINTER (fd);
+	int ret;
+
+	*zerocopy = FALSE;
+
+	if (mono_w32handle_get_type (handle) != MONO_W32HANDLE_SOCKET) {
+		WSASetLastError (WSAENOTSOCK);
+		return(SOCKET_ERROR);
+	}
+
+#ifdef WAPI_ZEROCOPY
+	{
+		struct _WapiHandle_socket *socket_handle;
+		gboolean ok;
+
+		ok = mono_w32handle_lookup (handle, MONO_W32HANDLE_SOCKET,
+					  (gpointer *)&socket_handle);
+		if (ok == FALSE) {
+			g_warning ("%s: error looking up socket handle %p",
+				   __func__, handle);
+			WSASetLastError (WSAENOTSOCK);
+			return(SOCKET_ERROR);
+		}
+
+		/* This fails on older kernels and on sockets without support, the data is then copied */
+		if (socket_handle->zerocopy == 0) {
+			int one = 1;
+
+			if (setsockopt (fd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof (one)) == 0)
+				socket_handle->zerocopy = 1;
+			else
+				socket_handle->zerocopy = -1;
+		}
+
+		if (socket_handle->zerocopy == 1) {
+			send_flags |= MSG_ZEROCOPY;
+			*zerocopy = TRUE;
+		}
+	}
+#endif
+
+	ret = WSASend (fd, buffers, count, sent, send_flags, NULL, NULL);
+	if (ret == SOCKET_ERROR)
+		*zerocopy = FALSE;
+	return(ret);
+}
+
+/*
+ * Dequeue a completion of the zero copy sends of @fd, which covers the sends
+ * numbered @first to @last, counting from 0. *@copied is set if the kernel
+ * copied the data anyway. Return 0 without waiting if there are none.
+ */
+int _wapi_zerocopy_completion(guint32 fd, guint32 *first, guint32 *last,
+			      gboolean *copied)
+{
+#ifdef WAPI_ZEROCOPY
+	gpointer handle = GUINT_TO_POINTER (fd);
+	char control [CMSG_SPACE (sizeof (struct sock_extended_err) + sizeof (struct sockaddr_in6))];
+	struct msghdr msg;
+	struct cmsghdr *cm;
+	int ret;
+
+	if (mono_w32handle_get_type (handle) != MONO_W32HANDLE_SOCKET) {
+		WSASetLastError (WSAENOTSOCK);
+		return(SOCKET_ERROR);
+	}
+
+	while (TRUE) {
+		memset (&msg, 0, sizeof (msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof (control);
+
+		/* Reading the error queue never blocks */
+		do {
+			ret = recvmsg (fd, &msg, MSG_ERRQUEUE);
+		} while (ret == -1 && errno == EINTR);
+
+		if (ret == -1) {
+			gint errnum = errno;
+
+			if (errnum == EAGAIN || errnum == EWOULDBLOCK)
+				return(0);
+
+			MONO_TRACE (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_LAYER, "%s: recvmsg error: %s", __func__, strerror (errno));
+
+			errnum = errno_to_WSA (errnum, __func__);
+			WSASetLastError (errnum);
+
+			return(SOCKET_ERROR);
+		}
+
+		/* Other errors, like ICMP errors of datagram sockets, are skipped */
+		for (cm = CMSG_FIRSTHDR (&msg); cm; cm = CMSG_NXTHDR (&msg, cm)) {
+			struct sock_extended_err *serr;
+
+			if (!(cm->cmsg_level == IPPROTO_IP && cm->cmsg_type == IP_RECVERR) &&
+			    !(cm->cmsg_level == IPPROTO_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+				continue;
+
+			serr = (struct sock_extended_err *) CMSG_DATA (cm);
+			if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+				continue;
+
+			*first = serr->ee_info;
+			*last = serr->ee_data;
+			*copied = (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+			return(1);
+		}
+	}
+#else
+	WSASetLastError (WSAEOPNOTSUPP);
+	return(SOCKET_ERROR);
+#endif
+}
+
 #endif /* ifndef DISABLE_SOCKETS */
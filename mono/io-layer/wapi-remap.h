@@ -38,6 +38,7 @@
 #define FileTimeToSystemTime wapi_FileTimeToSystemTime
 #define FindFirstFile wapi_FindFirstFile 
 #define FindNextFile wapi_FindNextFile 
+#define FindNextFileBasic wapi_FindNextFileBasic
 #define FindClose wapi_FindClose 
 #define CreateDirectory wapi_CreateDirectory 
 #define RemoveDirectory wapi_RemoveDirectory 
@@ -350,6 +350,129 @@ match(const gchar *name, gchar *pat, gchar *patend, gboolean ignorecase)
 	return(*name == EOS);
 }
 
+/*
+ * Matchers test names one at a time against a pattern compiled once, for
+ * callers that read the directory themselves.  The common shapes ("*",
+ * "name", "prefix*", "*.ext", "*part*") are reduced to memcmp()/strstr()
+ * on the literal part, which libc vectorizes, and everything else goes
+ * through match().
+ */
+void
+_wapi_glob_matcher_init(wapi_glob_matcher_t *matcher, const char *pattern,
+	int flags)
+{
+	const char *p;
+	size_t len = strlen (pattern);
+	int stars = 0;
+	gboolean general = FALSE;
+
+	for (p = pattern; *p != EOS; p++) {
+		if (*p == STAR)
+			stars++;
+		else if (*p == QUESTION || *p == QUOTE)
+			general = TRUE;
+	}
+
+	matcher->ignorecase = (flags & WAPI_GLOB_IGNORECASE) != 0;
+	matcher->pattern = NULL;
+	matcher->len = 0;
+
+	if (!general && stars == len && len > 0) {
+		matcher->kind = WAPI_GLOB_MATCH_ALL;
+	} else if (!general && stars == 0) {
+		matcher->kind = WAPI_GLOB_MATCH_LITERAL;
+		matcher->pattern = g_strdup (pattern);
+		matcher->len = len;
+	} else if (!general && stars == 1 && pattern [len - 1] == STAR) {
+		matcher->kind = WAPI_GLOB_MATCH_PREFIX;
+		matcher->pattern = g_strndup (pattern, len - 1);
+		matcher->len = len - 1;
+	} else if (!general && stars == 1 && pattern [0] == STAR) {
+		matcher->kind = WAPI_GLOB_MATCH_SUFFIX;
+		matcher->pattern = g_strdup (pattern + 1);
+		matcher->len = len - 1;
+	} else if (!general && !matcher->ignorecase && stars == 2 &&
+		   pattern [0] == STAR && pattern [len - 1] == STAR) {
+		matcher->kind = WAPI_GLOB_MATCH_CONTAINS;
+		matcher->pattern = g_strndup (pattern + 1, len - 2);
+		matcher->len = len - 2;
+	} else {
+		gchar *bufnext;
+		int c;
+
+		/* Same translation as _wapi_glob() and glob0() */
+		matcher->kind = WAPI_GLOB_MATCH_GENERAL;
+		matcher->pattern = bufnext = g_malloc (len + 1);
+		for (p = pattern; (c = *p++) != EOS;) {
+			if (c == QUOTE) {
+				if ((c = *p++) == EOS) {
+					c = QUOTE;
+					--p;
+				}
+				*bufnext++ = CHAR(c | M_PROTECT);
+			} else if (c == QUESTION) {
+				*bufnext++ = M_ONE;
+			} else if (c == STAR) {
+				if (bufnext == matcher->pattern || bufnext[-1] != M_ALL)
+					*bufnext++ = M_ALL;
+			} else {
+				*bufnext++ = CHAR(c);
+			}
+		}
+		*bufnext = EOS;
+		matcher->len = bufnext - matcher->pattern;
+	}
+}
+
+static gboolean
+literal_equal(const gchar *a, const gchar *b, size_t len, gboolean ignorecase)
+{
+	size_t i;
+
+	if (!ignorecase)
+		return memcmp (a, b, len) == 0;
+	for (i = 0; i < len; i++) {
+		if (g_ascii_tolower (a [i]) != g_ascii_tolower (b [i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* Whether @name, which is @len bytes long, matches @matcher's pattern. */
+gboolean
+_wapi_glob_matcher_match(const wapi_glob_matcher_t *matcher, const gchar *name,
+	size_t len)
+{
+	switch (matcher->kind) {
+	case WAPI_GLOB_MATCH_ALL:
+		return len > 0;
+	case WAPI_GLOB_MATCH_LITERAL:
+		return len == matcher->len &&
+			literal_equal (name, matcher->pattern, len, matcher->ignorecase);
+	case WAPI_GLOB_MATCH_PREFIX:
+		return len >= matcher->len &&
+			literal_equal (name, matcher->pattern, matcher->len, matcher->ignorecase);
+	case WAPI_GLOB_MATCH_SUFFIX:
+		return len >= matcher->len &&
+			literal_equal (name + len - matcher->len, matcher->pattern, matcher->len, matcher->ignorecase);
+	case WAPI_GLOB_MATCH_CONTAINS:
+		return strstr (name, matcher->pattern) != NULL;
+	default:
+		/* A null pathname is invalid -- POSIX 1003.1 sect. 2.4. */
+		if (matcher->len == 0)
+			return FALSE;
+		return match (name, matcher->pattern, matcher->pattern + matcher->len,
+			      matcher->ignorecase);
+	}
+}
+
+void
+_wapi_glob_matcher_free(wapi_glob_matcher_t *matcher)
+{
+	g_free (matcher->pattern);
+	matcher->pattern = NULL;
+}
+
 /* Free allocated data belonging to a wapi_glob_t structure. */
 void
 _wapi_globfree(wapi_glob_t *pglob)
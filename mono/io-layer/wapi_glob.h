@@ -60,9 +60,28 @@ typedef struct {
 #define WAPI_GLOB_IGNORECASE 0x4000	/* Ignore case when matching */
 #define WAPI_GLOB_ABEND	WAPI_GLOB_ABORTED /* backward compatibility */
 
+enum {
+	WAPI_GLOB_MATCH_ALL,
+	WAPI_GLOB_MATCH_LITERAL,
+	WAPI_GLOB_MATCH_PREFIX,
+	WAPI_GLOB_MATCH_SUFFIX,
+	WAPI_GLOB_MATCH_CONTAINS,
+	WAPI_GLOB_MATCH_GENERAL
+};
+
+typedef struct {
+	int kind;		/* One of WAPI_GLOB_MATCH_* */
+	gboolean ignorecase;
+	gchar *pattern;		/* Literal part, or the compiled pattern. */
+	size_t len;		/* Length of pattern. */
+} wapi_glob_matcher_t;
+
 G_BEGIN_DECLS
 int	_wapi_glob(GDir *dir, const char *, int, wapi_glob_t *);
 void	_wapi_globfree(wapi_glob_t *);
+void	_wapi_glob_matcher_init(wapi_glob_matcher_t *, const char *, int);
+gboolean _wapi_glob_matcher_match(const wapi_glob_matcher_t *, const gchar *, size_t);
+void	_wapi_glob_matcher_free(wapi_glob_matcher_t *);
 G_END_DECLS
 
 #endif /* !_WAPI_GLOB_H_ */
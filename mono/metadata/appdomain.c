@@ -53,6 +53,7 @@
 #include <mono/metadata/attach.h>
 #include <mono/metadata/file-io.h>
 #include <mono/metadata/lock-tracer.h>
+#include <mono/metadata/lock-contention.h>
 #include <mono/metadata/console-io.h>
 #include <mono/metadata/threads-types.h>
 #include <mono/metadata/tokentype.h>
@@ -256,6 +257,7 @@ mono_runtime_init_checked (MonoDomain *domain, MonoThreadStartCB start_cb, MonoT
 	
 	mono_gc_base_init ();
 	mono_monitor_init ();
+	mono_lock_contention_init ();
 	mono_marshal_init ();
 
 	mono_install_assembly_preload_hook (mono_domain_assembly_preload, GUINT_TO_POINTER (FALSE));
@@ -414,6 +416,8 @@ mono_runtime_cleanup (MonoDomain *domain)
 	mono_type_initialization_cleanup ();
 
 	mono_monitor_cleanup ();
+
+	mono_lock_contention_cleanup ();
 }
 
 static MonoDomainFunc quit_function = NULL;
@@ -1819,7 +1823,9 @@ try_load_from (MonoAssembly **assembly, const gchar *path1, const gchar *path2,
 	*assembly = NULL;
 	fullpath = g_build_filename (path1, path2, path3, path4, NULL);
 
-	if (IS_PORTABILITY_SET) {
+	if (!mono_assembly_probe_file_may_exist (fullpath)) {
+		found = FALSE;
+	} else if (IS_PORTABILITY_SET) {
 		gchar *new_fullpath = mono_portability_find_file (fullpath, TRUE);
 		if (new_fullpath) {
 			g_free (fullpath);
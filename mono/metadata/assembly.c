@@ -28,6 +28,7 @@
 #include <mono/metadata/reflection-internals.h>
 #include <mono/metadata/mono-endian.h>
 #include <mono/metadata/mono-debug.h>
+#include <mono/metadata/threads-types.h>
 #include <mono/io-layer/io-layer.h>
 #include <mono/utils/mono-uri.h>
 #include <mono/metadata/mono-config.h>
@@ -41,6 +42,9 @@
 #include <mono/utils/mono-io-portability.h>
 #include <mono/utils/atomic.h>
 #include <mono/utils/mono-os-mutex.h>
+#include <mono/utils/mono-coop-mutex.h>
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-startup-trace.h>
 
 #ifndef HOST_WIN32
 #include <sys/types.h>
@@ -508,6 +512,143 @@ mono_assembly_names_equal (MonoAssemblyName *l, MonoAssemblyName *r)
 	return TRUE;
 }
 
+/*
+ * Cache of the contents of the directories assemblies are probed in, so looking
+ * for an assembly in a directory which doesn't have it costs no failed open ()
+ * (and with MONO_IOMAP, no scan of the directory) for each candidate path.
+ *
+ * A directory is listed the first time a file is probed in it, and listed again
+ * when its modification time changes. Directories which don't exist are
+ * remembered for the lifetime of the process. Only negative answers come from
+ * the cache, files which are listed are still opened normally.
+ */
+typedef struct {
+	/* NULL if the directory doesn't exist */
+	GHashTable *files;
+	time_t mtime;
+	/* Whenever the listing was taken after the last change to the directory */
+	gboolean stable;
+} ProbeDir;
+
+static mono_mutex_t probe_dirs_mutex;
+static GHashTable *probe_dirs;
+static gint32 assembly_probes_skipped;
+
+static void
+probe_dir_free (gpointer data)
+{
+	ProbeDir *entry = (ProbeDir *)data;
+
+	if (entry->files)
+		g_hash_table_destroy (entry->files);
+	g_free (entry);
+}
+
+/* LOCKING: Assumes probe_dirs_mutex is held */
+static gboolean
+probe_dir_list (ProbeDir *entry, const char *dir, time_t mtime)
+{
+	const char *name;
+	GDir *gdir;
+
+	gdir = g_dir_open (dir, 0, NULL);
+	if (!gdir)
+		return FALSE;
+
+	if (entry->files)
+		g_hash_table_remove_all (entry->files);
+	else
+		entry->files = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	while ((name = g_dir_read_name (gdir)))
+		g_hash_table_insert (entry->files, IS_PORTABILITY_CASE ? g_utf8_strdown (name, -1) : g_strdup (name), GINT_TO_POINTER (1));
+	g_dir_close (gdir);
+
+	entry->mtime = mtime;
+	/* Files added in the same second wouldn't change the modification time */
+	entry->stable = time (NULL) > mtime;
+	return TRUE;
+}
+
+/*
+ * mono_assembly_probe_file_may_exist:
+ *
+ *   Return FALSE if the file at PATH is known not to exist, using the probing
+ * cache described above. A TRUE return doesn't mean the file exists.
+ */
+gboolean
+mono_assembly_probe_file_may_exist (const char *path)
+{
+#ifdef HOST_WIN32
+	return TRUE;
+#else
+	ProbeDir *entry;
+	struct stat st;
+	char *dir, *name;
+	gboolean res = TRUE;
+
+	/* Bundled assemblies are looked up by path, and drive letters are mapped by MONO_IOMAP */
+	if (bundles || IS_PORTABILITY_DRIVE || !probe_dirs)
+		return TRUE;
+
+	dir = g_path_get_dirname (path);
+	name = g_path_get_basename (path);
+	if (IS_PORTABILITY_CASE) {
+		char *lower = g_utf8_strdown (name, -1);
+		g_free (name);
+		name = lower;
+	}
+
+	mono_os_mutex_lock (&probe_dirs_mutex);
+
+	entry = (ProbeDir *)g_hash_table_lookup (probe_dirs, dir);
+	if (entry && !entry->files) {
+		res = FALSE;
+	} else if (stat (dir, &st) == -1 || !S_ISDIR (st.st_mode)) {
+		/* With MONO_IOMAP the directory might exist with another case */
+		if (errno == ENOENT && !IS_PORTABILITY_CASE) {
+			if (!entry) {
+				entry = g_new0 (ProbeDir, 1);
+				g_hash_table_insert (probe_dirs, g_strdup (dir), entry);
+			}
+			res = FALSE;
+		}
+	} else {
+		if (!entry) {
+			entry = g_new0 (ProbeDir, 1);
+			g_hash_table_insert (probe_dirs, g_strdup (dir), entry);
+		}
+		if (entry->files && entry->stable && entry->mtime == st.st_mtime)
+			res = g_hash_table_lookup (entry->files, name) != NULL;
+		else if (probe_dir_list (entry, dir, st.st_mtime))
+			res = g_hash_table_lookup (entry->files, name) != NULL;
+		else
+			g_hash_table_remove (probe_dirs, dir);
+	}
+
+	mono_os_mutex_unlock (&probe_dirs_mutex);
+
+	if (!res) {
+		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_ASSEMBLY, "Assembly Loader skipping missing location: '%s'.", path);
+		InterlockedIncrement (&assembly_probes_skipped);
+	}
+
+	g_free (dir);
+	g_free (name);
+	return res;
+#endif
+}
+
+static MonoAssembly *
+probe_assembly (const char *fullpath, MonoImageOpenStatus *status, gboolean refonly)
+{
+	if (!mono_assembly_probe_file_may_exist (fullpath)) {
+		if (status)
+			*status = MONO_IMAGE_ERROR_ERRNO;
+		return NULL;
+	}
+	return mono_assembly_open_full (fullpath, status, refonly);
+}
+
 static MonoAssembly *
 load_in_path (const char *basename, const char** search_path, MonoImageOpenStatus *status, MonoBoolean refonly)
 {
@@ -517,7 +658,7 @@ load_in_path (const char *basename, const char** search_path, MonoImageOpenStatu
 
 	for (i = 0; search_path [i]; ++i) {
 		fullpath = g_build_filename (search_path [i], basename, NULL);
-		result = mono_assembly_open_full (fullpath, status, refonly);
+		result = probe_assembly (fullpath, status, refonly);
 		g_free (fullpath);
 		if (result)
 			return result;
@@ -760,6 +901,253 @@ mono_set_rootdir (void)
 #endif
 }
 
+/*
+ * Preloading of the reference closure, see mono_assembly_set_preload_threads ().
+ * The preload threads only open the images, which maps and validates them and
+ * registers them in the image cache. The assemblies are still created and
+ * registered by the threads which load them, in the same order as without
+ * preloading, and they find their images already opened.
+ */
+#define ASSEMBLY_PRELOAD_MAX_THREADS 16
+
+typedef struct {
+	MonoImage *image;
+	/* Whenever the reference held by the item is kept in assembly_preload_images */
+	gboolean preloaded;
+} AssemblyPreloadItem;
+
+static int assembly_preload_threads;
+static gint32 assembly_preload_threads_started;
+static MonoCoopMutex assembly_preload_mutex;
+static MonoCoopCond assembly_preload_cond;
+/* AssemblyPreloadItems whose references need to be preloaded, protected by assembly_preload_mutex */
+static GQueue *assembly_preload_queue;
+/* The names of the assemblies which were preloaded or loaded, protected by assembly_preload_mutex */
+static GHashTable *assembly_preload_names;
+/* The images opened by the preload threads which were not loaded yet, protected by assembly_preload_mutex */
+static GHashTable *assembly_preload_images;
+static gint32 assembly_images_preloaded;
+
+/*
+ * mono_assembly_set_preload_threads:
+ *
+ *   Open the images of the assemblies referenced by the loaded assemblies on COUNT
+ * background threads, 0 disables preloading. Must be called before mono_assemblies_init ().
+ */
+void
+mono_assembly_set_preload_threads (int count)
+{
+	assembly_preload_threads = CLAMP (count, 0, ASSEMBLY_PRELOAD_MAX_THREADS);
+}
+
+/*
+ * preload_find_image:
+ *
+ *   Return the path of the file the assembly NAME referenced by IMAGE would be loaded from,
+ * probing the same directories as mono_assembly_load_full_nosearch (), except for the GAC.
+ */
+static char*
+preload_find_image (MonoImage *image, const char *name)
+{
+	char *basedir = g_path_get_dirname (image->name);
+	int len = strlen (name);
+	int ext_index, i;
+
+	for (ext_index = 0; ext_index < 2; ext_index ++) {
+		char *filename;
+		char *fullpath = NULL;
+
+		if (len > 4 && (!strcmp (name + len - 4, ".dll") || !strcmp (name + len - 4, ".exe"))) {
+			filename = g_strdup (name);
+			ext_index++;
+		} else {
+			filename = g_strconcat (name, ext_index == 0 ? ".dll" : ".exe", NULL);
+		}
+
+		for (i = 0; assemblies_path && assemblies_path [i] && !fullpath; ++i) {
+			fullpath = g_build_filename (assemblies_path [i], filename, NULL);
+			if (!mono_assembly_probe_file_may_exist (fullpath) || !g_file_test (fullpath, G_FILE_TEST_IS_REGULAR)) {
+				g_free (fullpath);
+				fullpath = NULL;
+			}
+		}
+		if (!fullpath) {
+			fullpath = g_build_filename (basedir, filename, NULL);
+			if (!mono_assembly_probe_file_may_exist (fullpath) || !g_file_test (fullpath, G_FILE_TEST_IS_REGULAR)) {
+				g_free (fullpath);
+				fullpath = NULL;
+			}
+		}
+		for (i = 0; default_path [i] && !fullpath; ++i) {
+			fullpath = g_build_filename (default_path [i], filename, NULL);
+			if (!mono_assembly_probe_file_may_exist (fullpath) || !g_file_test (fullpath, G_FILE_TEST_IS_REGULAR)) {
+				g_free (fullpath);
+				fullpath = NULL;
+			}
+		}
+		g_free (filename);
+		if (fullpath) {
+			g_free (basedir);
+			return fullpath;
+		}
+	}
+	g_free (basedir);
+	return NULL;
+}
+
+/*
+ * preload_references:
+ *
+ *   Open the images referenced by IMAGE which were not seen yet, and queue them so
+ * their own references are preloaded too.
+ */
+static void
+preload_references (MonoImage *image)
+{
+	int i;
+
+	for (i = 0; i < image->tables [MONO_TABLE_ASSEMBLYREF].rows && !mono_runtime_is_shutting_down (); ++i) {
+		MonoAssemblyName aname;
+		MonoImageOpenStatus status;
+		MonoImage *ref_image;
+		AssemblyPreloadItem *item;
+		char *path;
+		gboolean seen;
+
+		memset (&aname, 0, sizeof (aname));
+		mono_assembly_get_assemblyref (image, i, &aname);
+		/* Satellite assemblies are looked up in subdirectories */
+		if (aname.culture && aname.culture [0])
+			continue;
+
+		mono_coop_mutex_lock (&assembly_preload_mutex);
+		seen = g_hash_table_lookup (assembly_preload_names, aname.name) != NULL;
+		if (!seen)
+			g_hash_table_insert (assembly_preload_names, g_strdup (aname.name), GINT_TO_POINTER (1));
+		mono_coop_mutex_unlock (&assembly_preload_mutex);
+		if (seen)
+			continue;
+
+		path = preload_find_image (image, aname.name);
+		if (!path)
+			continue;
+		ref_image = mono_image_open_full (path, &status, FALSE);
+		g_free (path);
+		if (!ref_image)
+			continue;
+		InterlockedIncrement (&assembly_images_preloaded);
+
+		item = g_new0 (AssemblyPreloadItem, 1);
+		item->image = ref_image;
+		item->preloaded = TRUE;
+
+		mono_coop_mutex_lock (&assembly_preload_mutex);
+		g_queue_push_tail (assembly_preload_queue, item);
+		mono_coop_cond_signal (&assembly_preload_cond);
+		mono_coop_mutex_unlock (&assembly_preload_mutex);
+	}
+}
+
+static guint32
+assembly_preload_thread (gpointer unused)
+{
+	MonoError error;
+	AssemblyPreloadItem *item;
+
+	mono_thread_set_name_internal (mono_thread_internal_current (), mono_string_new (mono_get_root_domain (), "Assembly preload"), FALSE, &error);
+	mono_error_assert_ok (&error);
+
+	while (!mono_runtime_is_shutting_down ()) {
+		gboolean release = TRUE;
+
+		mono_coop_mutex_lock (&assembly_preload_mutex);
+		while (g_queue_is_empty (assembly_preload_queue) && !mono_runtime_is_shutting_down ())
+			mono_coop_cond_wait (&assembly_preload_cond, &assembly_preload_mutex);
+		item = (AssemblyPreloadItem *)g_queue_pop_head (assembly_preload_queue);
+		mono_coop_mutex_unlock (&assembly_preload_mutex);
+
+		if (!item)
+			continue;
+
+		preload_references (item->image);
+
+		if (item->preloaded) {
+			mono_coop_mutex_lock (&assembly_preload_mutex);
+			/* Keep the image alive until its assembly is loaded, unless that already happened */
+			if (!item->image->assembly) {
+				g_hash_table_insert (assembly_preload_images, item->image, item->image);
+				release = FALSE;
+			}
+			mono_coop_mutex_unlock (&assembly_preload_mutex);
+		}
+		if (release)
+			mono_image_close (item->image);
+		g_free (item);
+	}
+
+	return 0;
+}
+
+static void
+assembly_preload_load_hook (MonoAssembly *assembly, gpointer user_data)
+{
+	MonoError error;
+	MonoImage *image = assembly->image;
+	AssemblyPreloadItem *item;
+	gboolean preloaded;
+	int i;
+
+	if (!image || image_is_dynamic (image) || assembly->ref_only || !image->name)
+		return;
+	/* Threads can't be created before the runtime is up */
+	if (!mono_thread_internal_current ())
+		return;
+
+	if (InterlockedCompareExchange (&assembly_preload_threads_started, TRUE, FALSE) == FALSE) {
+		for (i = 0; i < assembly_preload_threads; ++i) {
+			/* Created as threadpool threads so they are background threads which don't keep the runtime alive */
+			if (!mono_thread_create_internal (mono_get_root_domain (), assembly_preload_thread, NULL, TRUE, 0, &error))
+				g_error ("assembly_preload_load_hook: mono_thread_create_internal () failed due to %s", mono_error_get_message (&error));
+		}
+	}
+
+	mono_coop_mutex_lock (&assembly_preload_mutex);
+	if (!g_hash_table_lookup (assembly_preload_names, assembly->aname.name))
+		g_hash_table_insert (assembly_preload_names, g_strdup (assembly->aname.name), GINT_TO_POINTER (1));
+	/* The references of preloaded images were already queued */
+	preloaded = g_hash_table_remove (assembly_preload_images, image);
+	if (!preloaded) {
+		mono_image_addref (image);
+		item = g_new0 (AssemblyPreloadItem, 1);
+		item->image = image;
+		g_queue_push_tail (assembly_preload_queue, item);
+		mono_coop_cond_signal (&assembly_preload_cond);
+	}
+	mono_coop_mutex_unlock (&assembly_preload_mutex);
+
+	/* The assembly holds its own reference */
+	if (preloaded)
+		mono_image_close (image);
+}
+
+static void
+assembly_preload_init (void)
+{
+	if (!assembly_preload_threads)
+		return;
+
+	mono_coop_mutex_init (&assembly_preload_mutex);
+	mono_coop_cond_init (&assembly_preload_cond);
+	assembly_preload_queue = g_queue_new ();
+	assembly_preload_names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	g_hash_table_insert (assembly_preload_names, g_strdup ("mscorlib"), GINT_TO_POINTER (1));
+	assembly_preload_images = g_hash_table_new (NULL, NULL);
+
+	mono_counters_register ("Assembly images preloaded", MONO_COUNTER_INT|MONO_COUNTER_RUNTIME, &assembly_images_preloaded);
+
+	mono_install_assembly_load_hook (assembly_preload_load_hook, NULL);
+}
+
 /**
  * mono_assemblies_init:
  *
@@ -780,6 +1168,12 @@ mono_assemblies_init (void)
 
 	mono_os_mutex_init_recursive (&assemblies_mutex);
 	mono_os_mutex_init (&assembly_binding_mutex);
+
+	mono_os_mutex_init (&probe_dirs_mutex);
+	probe_dirs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, probe_dir_free);
+	mono_counters_register ("Assembly probes skipped", MONO_COUNTER_INT|MONO_COUNTER_RUNTIME, &assembly_probes_skipped);
+
+	assembly_preload_init ();
 }
 
 static void
@@ -1594,6 +1988,9 @@ mono_assembly_open_from_bundle (const char *filename, MonoImageOpenStatus *statu
 	return NULL;
 }
 
+static MonoAssembly *
+assembly_open_full (const char *filename, MonoImageOpenStatus *status, gboolean refonly);
+
 /**
  * mono_assemblies_open_full:
  * @filename: the file to load
@@ -1621,6 +2018,21 @@ mono_assembly_open_from_bundle (const char *filename, MonoImageOpenStatus *statu
  */
 MonoAssembly *
 mono_assembly_open_full (const char *filename, MonoImageOpenStatus *status, gboolean refonly)
+{
+	MonoStartupTraceStamp trace_stamp;
+	MonoAssembly *res;
+
+	if (G_LIKELY (!mono_startup_trace_enabled))
+		return assembly_open_full (filename, status, refonly);
+
+	mono_startup_trace_begin (MONO_STARTUP_ASSEMBLY_LOAD, &trace_stamp);
+	res = assembly_open_full (filename, status, refonly);
+	mono_startup_trace_end (MONO_STARTUP_ASSEMBLY_LOAD, &trace_stamp, filename);
+	return res;
+}
+
+static MonoAssembly *
+assembly_open_full (const char *filename, MonoImageOpenStatus *status, gboolean refonly)
 {
 	MonoImage *image;
 	MonoAssembly *ass;
@@ -3140,7 +3552,7 @@ mono_assembly_load_from_gac (MonoAssemblyName *aname,  gchar *filename, MonoImag
 		paths = extra_gac_paths;
 		while (!result && *paths) {
 			fullpath = g_build_path (G_DIR_SEPARATOR_S, *paths, "lib", "mono", "gac", subpath, NULL);
-			result = mono_assembly_open_full (fullpath, status, refonly);
+			result = probe_assembly (fullpath, status, refonly);
 			g_free (fullpath);
 			paths++;
 		}
@@ -3154,7 +3566,7 @@ mono_assembly_load_from_gac (MonoAssemblyName *aname,  gchar *filename, MonoImag
 
 	fullpath = g_build_path (G_DIR_SEPARATOR_S, mono_assembly_getrootdir (),
 			"mono", "gac", subpath, NULL);
-	result = mono_assembly_open_full (fullpath, status, refonly);
+	result = probe_assembly (fullpath, status, refonly);
 	g_free (fullpath);
 
 	if (result)
@@ -3296,7 +3708,7 @@ mono_assembly_load_full_nosearch (MonoAssemblyName *aname,
 
 		if (basedir) {
 			fullpath = g_build_filename (basedir, filename, NULL);
-			result = mono_assembly_open_full (fullpath, status, refonly);
+			result = probe_assembly (fullpath, status, refonly);
 			g_free (fullpath);
 			if (result) {
 				result->in_gac = FALSE;
@@ -3545,6 +3957,12 @@ mono_assemblies_cleanup (void)
 	mono_os_mutex_destroy (&assemblies_mutex);
 	mono_os_mutex_destroy (&assembly_binding_mutex);
 
+	mono_os_mutex_lock (&probe_dirs_mutex);
+	g_hash_table_destroy (probe_dirs);
+	probe_dirs = NULL;
+	mono_os_mutex_unlock (&probe_dirs_mutex);
+	mono_os_mutex_destroy (&probe_dirs_mutex);
+
 	for (l = loaded_assembly_bindings; l; l = l->next) {
 		MonoAssemblyBindingInfo *info = (MonoAssemblyBindingInfo *)l->data;
 
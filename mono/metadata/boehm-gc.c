@@ -33,9 +33,14 @@
 #include <mono/utils/gc_wrapper.h>
 #include <mono/utils/mono-os-mutex.h>
 #include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-codeman.h>
 
 #if HAVE_BOEHM_GC
 
+#ifdef MONO_SMALL_OBJECT_HEADER
+#error "Small object headers need the lock word table of SGen"
+#endif
+
 #undef TRUE
 #undef FALSE
 #define THREAD_LOCAL_ALLOC 1
@@ -53,6 +58,109 @@ void *pthread_get_stackaddr_np(pthread_t);
 static gboolean gc_initialized = FALSE;
 static mono_mutex_t mono_gc_lock;
 
+static gint32 marker_threads;
+static gint64 mark_start_time, reclaim_start_time;
+static guint64 mark_time, reclaim_time;
+
+/*
+ * In incremental mode libgc takes its dirty pages from this card table, so every
+ * store of a reference into the heap must mark the card covering it.  NULL when
+ * incremental collection is disabled.
+ */
+static guint8 *card_table;
+static int card_table_shift_bits;
+static GC_word card_table_mask;
+
+static inline void
+mark_card (gpointer ptr)
+{
+	if (card_table)
+		card_table [((gsize)ptr >> card_table_shift_bits) & card_table_mask] = 1;
+}
+
+static inline void
+mark_card_range (gpointer ptr, size_t size)
+{
+	gsize addr, end;
+
+	if (!card_table || !size)
+		return;
+
+	end = (gsize)ptr + size - 1;
+	for (addr = (gsize)ptr; (addr >> card_table_shift_bits) <= (end >> card_table_shift_bits); addr += (gsize)1 << card_table_shift_bits)
+		mark_card ((gpointer)addr);
+}
+
+/*
+ * mono_gc_alloc_fixed () memory holds runtime structures like domains and static
+ * data, which the runtime stores references into without write barriers.  In
+ * incremental mode these allocations are recorded here, and all their cards are
+ * marked when the world is stopped to finish a collection, so they are always
+ * rescanned.  The entries are disappearing links, which libgc clears when the
+ * memory is collected.
+ */
+#define FIXED_ALLOC_CHUNK_SIZE	1024
+#define FIXED_ALLOC_MAX_CHUNKS	4096
+
+static GC_word *fixed_alloc_chunks [FIXED_ALLOC_MAX_CHUNKS];
+static volatile int num_fixed_alloc_chunks;
+static int fixed_alloc_hint;
+static mono_mutex_t fixed_alloc_lock;
+
+static void
+register_fixed_alloc (void *p)
+{
+	GC_word *entry = NULL;
+	int i, n, index = 0;
+
+	mono_os_mutex_lock (&fixed_alloc_lock);
+
+	n = num_fixed_alloc_chunks * FIXED_ALLOC_CHUNK_SIZE;
+	for (i = 0; i < n; ++i) {
+		index = (fixed_alloc_hint + i) % n;
+		if (!fixed_alloc_chunks [index / FIXED_ALLOC_CHUNK_SIZE][index % FIXED_ALLOC_CHUNK_SIZE]) {
+			entry = &fixed_alloc_chunks [index / FIXED_ALLOC_CHUNK_SIZE][index % FIXED_ALLOC_CHUNK_SIZE];
+			break;
+		}
+	}
+
+	if (!entry) {
+		if (num_fixed_alloc_chunks == FIXED_ALLOC_MAX_CHUNKS)
+			g_error ("Too many fixed allocations for incremental collection");
+		fixed_alloc_chunks [num_fixed_alloc_chunks] = g_new0 (GC_word, FIXED_ALLOC_CHUNK_SIZE);
+		/* The collector can read the chunk as soon as it's counted. */
+		mono_memory_write_barrier ();
+		index = num_fixed_alloc_chunks * FIXED_ALLOC_CHUNK_SIZE;
+		entry = fixed_alloc_chunks [num_fixed_alloc_chunks];
+		++num_fixed_alloc_chunks;
+	}
+
+	*entry = HIDE_POINTER (p);
+	GC_GENERAL_REGISTER_DISAPPEARING_LINK ((void**)entry, p);
+	fixed_alloc_hint = index + 1;
+
+	mono_os_mutex_unlock (&fixed_alloc_lock);
+}
+
+/* Called with the world stopped, before libgc reads the dirty cards. */
+static void
+mark_fixed_alloc_cards (void)
+{
+	int i, j;
+
+	for (i = 0; i < num_fixed_alloc_chunks; ++i) {
+		for (j = 0; j < FIXED_ALLOC_CHUNK_SIZE; ++j) {
+			GC_word hidden = fixed_alloc_chunks [i][j];
+			void *p;
+
+			if (!hidden)
+				continue;
+			p = REVEAL_POINTER (hidden);
+			mark_card_range (p, GC_size (p));
+		}
+	}
+}
+
 static void*
 boehm_thread_register (MonoThreadInfo* info, void *baseptr);
 static void
@@ -197,8 +305,34 @@ mono_gc_base_init (void)
 		}
 	}
 
+	/*
+	 * libgc picks the number of parallel marker threads from GC_MARKERS when it starts
+	 * up, defaulting to the number of processors.
+	 */
+	if ((env = g_getenv ("MONO_GC_PARAMS"))) {
+		char **ptr, **opts = g_strsplit (env, ",", -1);
+		for (ptr = opts; *ptr; ++ptr) {
+			char *opt = *ptr;
+			if (g_str_has_prefix (opt, "markers=")) {
+				opt = strchr (opt, '=') + 1;
+				if (atoi (opt) < 1) {
+					fprintf (stderr, "markers must be a positive integer.\n");
+					exit (1);
+				}
+				g_setenv ("GC_MARKERS", opt, TRUE);
+			}
+		}
+		g_strfreev (opts);
+	}
+
 	GC_init ();
 
+	/* Set by libgc's thread support from the processor count or GC_MARKERS */
+	marker_threads = (gint32)GC_get_markers ();
+	mono_counters_register ("Boehm marker threads", MONO_COUNTER_GC | MONO_COUNTER_INT, &marker_threads);
+	mono_counters_register ("Boehm mark time", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_TIME, &mark_time);
+	mono_counters_register ("Boehm reclaim time", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_TIME, &reclaim_time);
+
 	GC_set_warn_proc (mono_gc_warning);
 	GC_finalize_on_demand = 1;
 	GC_finalizer_notifier = mono_gc_finalize_notify;
@@ -210,7 +344,19 @@ mono_gc_base_init (void)
 		char **ptr, **opts = g_strsplit (env, ",", -1);
 		for (ptr = opts; *ptr; ++ptr) {
 			char *opt = *ptr;
-			if (g_str_has_prefix (opt, "max-heap-size=")) {
+			if (!strcmp (opt, "incremental")) {
+				/*
+				 * This has to happen before the first thread local gcj allocation, and
+				 * before any method is JITted, so the code gets write barriers.
+				 */
+				card_table = GC_get_card_table (&card_table_shift_bits, &card_table_mask);
+				if (card_table) {
+					mono_os_mutex_init (&fixed_alloc_lock);
+					GC_enable_incremental ();
+				} else
+					g_warning ("The incremental Boehm mode needs a libgc built with MANUAL_VDB, ignoring it.");
+				continue;
+			} else if (g_str_has_prefix (opt, "max-heap-size=")) {
 				size_t max_heap;
 
 				opt = strchr (opt, '=') + 1;
@@ -225,6 +371,9 @@ mono_gc_base_init (void)
 					exit (1);
 				}
 				continue;
+			} else if (g_str_has_prefix (opt, "markers=")) {
+				/* Handled before GC_init () */
+				continue;
 			} else if (g_str_has_prefix (opt, "toggleref-test")) {
 				register_test_toggleref_callback ();
 				continue;
@@ -233,6 +382,7 @@ mono_gc_base_init (void)
 				/*
 				fprintf (stderr, "MONO_GC_PARAMS must be a comma-delimited list of one or more of the following:\n");
 				fprintf (stderr, "  max-heap-size=N (where N is an integer, possibly with a k, m or a g suffix)\n");
+				fprintf (stderr, "  incremental\n");
 				exit (1);
 				*/
 			}
@@ -460,6 +610,24 @@ on_gc_notification (GC_EventType event)
 		gc_start_time = mono_100ns_ticks ();
 		break;
 
+	case MONO_GC_EVENT_MARK_START:
+		mark_start_time = mono_100ns_ticks ();
+		if (card_table)
+			mark_fixed_alloc_cards ();
+		break;
+
+	case MONO_GC_EVENT_MARK_END:
+		mark_time += mono_100ns_ticks () - mark_start_time;
+		break;
+
+	case MONO_GC_EVENT_RECLAIM_START:
+		reclaim_start_time = mono_100ns_ticks ();
+		break;
+
+	case MONO_GC_EVENT_RECLAIM_END:
+		reclaim_time += mono_100ns_ticks () - reclaim_start_time;
+		break;
+
 	case MONO_GC_EVENT_END:
 		MONO_GC_END (1);
 #if defined(ENABLE_DTRACE) && defined(__sun__)
@@ -495,6 +663,7 @@ on_gc_notification (GC_EventType event)
 		break;
 	case MONO_GC_EVENT_POST_START_WORLD:
 		mono_thread_info_suspend_unlock ();
+		mono_code_manager_safepoint ();
 		mono_profiler_gc_event (MONO_GC_EVENT_POST_START_WORLD_UNLOCKED, 0);
 		break;
 	default:
@@ -621,10 +790,16 @@ mono_gc_alloc_fixed (size_t size, void *descr, MonoGCRootSource source, const ch
 		return GC_MALLOC (size);
 	*/
 
+	void *p;
+
 	if (descr)
-		return GC_MALLOC_EXPLICITLY_TYPED (size, (GC_descr)descr);
+		p = GC_MALLOC_EXPLICITLY_TYPED (size, (GC_descr)descr);
 	else
-		return GC_MALLOC (size);
+		p = GC_MALLOC (size);
+
+	if (card_table && p)
+		register_fixed_alloc (p);
+	return p;
 }
 
 void
@@ -788,41 +963,49 @@ void
 mono_gc_wbarrier_set_field (MonoObject *obj, gpointer field_ptr, MonoObject* value)
 {
 	*(void**)field_ptr = value;
+	mark_card (field_ptr);
 }
 
 void
 mono_gc_wbarrier_set_arrayref (MonoArray *arr, gpointer slot_ptr, MonoObject* value)
 {
 	*(void**)slot_ptr = value;
+	mark_card (slot_ptr);
 }
 
 void
 mono_gc_wbarrier_arrayref_copy (gpointer dest_ptr, gpointer src_ptr, int count)
 {
 	mono_gc_memmove_aligned (dest_ptr, src_ptr, count * sizeof (gpointer));
+	mark_card_range (dest_ptr, count * sizeof (gpointer));
 }
 
 void
 mono_gc_wbarrier_generic_store (gpointer ptr, MonoObject* value)
 {
 	*(void**)ptr = value;
+	mark_card (ptr);
 }
 
 void
 mono_gc_wbarrier_generic_store_atomic (gpointer ptr, MonoObject *value)
 {
 	InterlockedWritePointer ((volatile gpointer *)ptr, value);
+	mark_card (ptr);
 }
 
 void
 mono_gc_wbarrier_generic_nostore (gpointer ptr)
 {
+	mark_card (ptr);
 }
 
 void
 mono_gc_wbarrier_value_copy (gpointer dest, gpointer src, int count, MonoClass *klass)
 {
 	mono_gc_memmove_atomic (dest, src, count * mono_class_value_size (klass, NULL));
+	if (klass->has_references)
+		mark_card_range (dest, count * mono_class_value_size (klass, NULL));
 }
 
 void
@@ -831,6 +1014,7 @@ mono_gc_wbarrier_object_copy (MonoObject* obj, MonoObject *src)
 	/* do not copy the sync state */
 	mono_gc_memmove_aligned ((char*)obj + sizeof (MonoObject), (char*)src + sizeof (MonoObject),
 			mono_object_class (obj)->instance_size - sizeof (MonoObject));
+	mark_card_range ((char*)obj + sizeof (MonoObject), mono_object_class (obj)->instance_size - sizeof (MonoObject));
 }
 
 void
@@ -882,7 +1066,7 @@ create_allocator (int atype, int tls_key, gboolean slowpath)
 {
 	int index_var, bytes_var, my_fl_var, my_entry_var;
 	guint32 no_freelist_branch, not_small_enough_branch = 0;
-	guint32 size_overflow_branch = 0;
+	guint32 size_overflow_branch = 0, no_descriptor_branch = 0;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
 	MonoMethodSignature *csig;
@@ -920,6 +1104,17 @@ create_allocator (int atype, int tls_key, gboolean slowpath)
 	if (slowpath)
 		goto always_slowpath;
 
+	if (atype == ATYPE_GCJ) {
+		/* Vtables without a gcj descriptor are allocated with GC_MALLOC () by the runtime */
+		/* if (vtable->gc_descr == GC_NO_DESCRIPTOR) jump slow_path; */
+		mono_mb_emit_ldarg (mb, 0);
+		mono_mb_emit_icon (mb, G_STRUCT_OFFSET (MonoVTable, gc_descr));
+		mono_mb_emit_byte (mb, MONO_CEE_ADD);
+		mono_mb_emit_byte (mb, MONO_CEE_LDIND_I);
+		mono_mb_emit_icon (mb, GPOINTER_TO_INT (GC_NO_DESCRIPTOR));
+		no_descriptor_branch = mono_mb_emit_branch (mb, MONO_CEE_BEQ);
+	}
+
 	bytes_var = mono_mb_add_local (mb, &mono_defaults.int32_class->byval_arg);
 	if (atype == ATYPE_STRING) {
 		/* a string alloator method takes the args: (vtable, len) */
@@ -1078,6 +1273,8 @@ create_allocator (int atype, int tls_key, gboolean slowpath)
 		mono_mb_patch_short_branch (mb, not_small_enough_branch);
 	if (size_overflow_branch > 0)
 		mono_mb_patch_short_branch (mb, size_overflow_branch);
+	if (no_descriptor_branch > 0)
+		mono_mb_patch_branch (mb, no_descriptor_branch);
 
 	/* the slow path: we just call back into the runtime */
  always_slowpath:
@@ -1156,16 +1353,16 @@ mono_gc_get_managed_allocator (MonoClass *klass, gboolean for_box, gboolean know
 			atype = ATYPE_FREEPTR_FOR_BOX;
 		else
 			atype = ATYPE_FREEPTR;
+	} else if (!card_table) {
+		/*
+		 * Objects on the gcj free lists come back cleared, so only the vtable needs
+		 * to be stored.  Whether the vtable has a gcj descriptor is checked by the
+		 * allocator itself, since it can differ between appdomains.  In incremental
+		 * mode libgc keeps the thread local gcj free lists empty.
+		 */
+		atype = ATYPE_GCJ;
 	} else {
 		return NULL;
-		/*
-		 * disabled because we currently do a runtime choice anyway, to
-		 * deal with multiple appdomains.
-		if (vtable->gc_descr != GC_NO_DESCRIPTOR)
-			atype = ATYPE_GCJ;
-		else
-			atype = ATYPE_NORMAL;
-		*/
 	}
 	return mono_gc_get_managed_allocator_by_type (atype, MANAGED_ALLOCATOR_REGULAR);
 }
@@ -1306,6 +1503,12 @@ mono_gc_is_moving (void)
 	return FALSE;
 }
 
+gboolean
+mono_gc_needs_write_barriers (void)
+{
+	return card_table != NULL;
+}
+
 gboolean
 mono_gc_is_disabled (void)
 {
@@ -1318,27 +1521,34 @@ mono_gc_is_disabled (void)
 void
 mono_gc_wbarrier_value_copy_bitmap (gpointer _dest, gpointer _src, int size, unsigned bitmap)
 {
-	g_assert_not_reached ();
+	/* The cards cover the whole copy, so the reference bitmap isn't needed */
+	mono_gc_memmove_atomic (_dest, _src, size);
+	mark_card_range (_dest, size);
 }
 
 
 guint8*
 mono_gc_get_card_table (int *shift_bits, gpointer *card_mask)
 {
-	g_assert_not_reached ();
-	return NULL;
+	if (!card_table)
+		return NULL;
+	*shift_bits = card_table_shift_bits;
+	*card_mask = (gpointer)card_table_mask;
+	return card_table;
 }
 
 gboolean
 mono_gc_card_table_nursery_check (void)
 {
-	g_assert_not_reached ();
-	return TRUE;
+	/* There is no nursery, every reference store marks its card */
+	return FALSE;
 }
 
 void*
 mono_gc_get_nursery (int *shift_bits, size_t *size)
 {
+	*shift_bits = 0;
+	*size = 0;
 	return NULL;
 }
 
@@ -1654,7 +1864,7 @@ handle_data_grow (HandleData *handles, gboolean track)
 	} else {
 		gpointer *entries;
 		entries = (void **)mono_gc_alloc_fixed (sizeof (*handles->entries) * new_size, NULL, MONO_ROOT_SOURCE_GC_HANDLE, "gc handles table");
-		mono_gc_memmove_aligned (entries, handles->entries, sizeof (*handles->entries) * handles->size);
+		mono_gc_wbarrier_arrayref_copy (entries, handles->entries, handles->size);
 		mono_gc_free_fixed (handles->entries);
 		handles->entries = entries;
 	}
@@ -1686,7 +1896,7 @@ alloc_handle (HandleData *handles, MonoObject *obj, gboolean track)
 		if (obj)
 			mono_gc_weak_link_add (&(handles->entries [slot]), obj, track);
 	} else {
-		handles->entries [slot] = obj;
+		mono_gc_wbarrier_generic_store (&handles->entries [slot], obj);
 	}
 
 #ifndef DISABLE_PERFCOUNTERS
@@ -1803,7 +2013,7 @@ mono_gchandle_set_target (guint32 gchandle, MonoObject *obj)
 			/*FIXME, what to use when obj == null?*/
 			handles->domain_ids [slot] = (obj ? mono_object_get_domain (obj) : mono_domain_get ())->domain_id;
 		} else {
-			handles->entries [slot] = obj;
+			mono_gc_wbarrier_generic_store (&handles->entries [slot], obj);
 		}
 	} else {
 		/* print a warning? */
@@ -254,6 +254,9 @@ typedef struct {
 	MonoFieldDefaultValue *prop_def_values;
 
 	GList      *nested_classes;
+
+	/* Loaded on demand by mono_marshal_load_type_info (), only for the marshalled types */
+	MonoMarshalType *marshal_info;
 } MonoClassExt;
 
 struct _MonoClass {
@@ -377,9 +380,6 @@ struct _MonoClass {
 	/* A GC handle pointing to the corresponding type builder/generic param builder */
 	guint32 ref_info_handle;
 
-	/* loaded on demand */
-	MonoMarshalType *marshal_info;
-
 	/*
 	 * Field information: Type and location from object base
 	 */
@@ -417,6 +417,9 @@ int mono_class_interface_match (const uint8_t *bitmap, int id);
 #define mono_class_interface_match(bmap,uiid) ((bmap) [(uiid) >> 3] & (1 << ((uiid)&7)))
 #endif
 
+/* The MonoMarshalType of KLASS, NULL if mono_marshal_load_type_info () was not called for it */
+#define mono_class_get_marshal_info(klass) ((klass)->ext ? (klass)->ext->marshal_info : NULL)
+
 #define MONO_CLASS_IMPLEMENTS_INTERFACE(k,uiid) (((uiid) <= (k)->max_interface_id) && mono_class_interface_match ((k)->interface_bitmap, (uiid)))
 
 #define MONO_VTABLE_AVAILABLE_GC_BITS 4
@@ -468,6 +471,8 @@ struct MonoVTable {
 
 	guint32     imt_collisions_bitmap;
 	MonoRuntimeGenericContext *runtime_generic_context;
+	/* code of the Activator.CreateInstance<T> () wrapper for klass, filled lazily by the JIT */
+	gpointer    create_instance;
 	/* do not add any fields after vtable, the structure is dynamically extended */
 	/* vtable contains function pointers to methods or their trampolines, at the
 	 end there may be a slot containing the pointer to the static fields */
@@ -777,6 +782,7 @@ typedef struct {
 	size_t jit_info_table_insert_count;
 	size_t jit_info_table_remove_count;
 	size_t jit_info_table_lookup_count;
+	size_t jit_info_table_cache_hit_count;
 	size_t generics_sharable_methods;
 	size_t generics_unsharable_methods;
 	size_t generics_shared_methods;
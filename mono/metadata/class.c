@@ -1096,10 +1096,8 @@ mono_class_inflate_generic_method_full_checked (MonoMethod *method, MonoClass *k
 
 	MonoImageSet *set = mono_metadata_get_image_set_for_method (iresult);
 
-	// check cache
-	mono_image_set_lock (set);
-	cached = (MonoMethodInflated *)g_hash_table_lookup (set->gmethod_cache, iresult);
-	mono_image_set_unlock (set);
+	// check cache, lookups don't need the set lock
+	cached = (MonoMethodInflated *)mono_conc_hashtable_lookup (set->gmethod_cache, iresult);
 
 	if (cached) {
 		g_free (iresult);
@@ -1173,10 +1171,11 @@ mono_class_inflate_generic_method_full_checked (MonoMethod *method, MonoClass *k
 
 	// check cache
 	mono_image_set_lock (set);
-	cached = (MonoMethodInflated *)g_hash_table_lookup (set->gmethod_cache, iresult);
+	cached = (MonoMethodInflated *)mono_conc_hashtable_lookup (set->gmethod_cache, iresult);
 	if (!cached) {
-		g_hash_table_insert (set->gmethod_cache, iresult, iresult);
+		/* Initialize it before it becomes visible to lock free lookups */
 		iresult->owner = set;
+		mono_conc_hashtable_insert (set->gmethod_cache, iresult, iresult);
 		cached = iresult;
 	}
 	mono_image_set_unlock (set);
@@ -1846,6 +1845,180 @@ type_has_references (MonoClass *klass, MonoType *ftype)
 	return FALSE;
 }
 
+/*
+ * class_has_compact_layout:
+ *
+ *   Whenever the instance fields of KLASS are laid out by layout_fields_compact ().
+ * Corlib is left alone since it has auto layout classes whose layout is known to
+ * the runtime.
+ */
+static gboolean
+class_has_compact_layout (MonoClass *klass)
+{
+	return !klass->valuetype && (klass->flags & TYPE_ATTRIBUTE_LAYOUT_MASK) == TYPE_ATTRIBUTE_AUTO_LAYOUT &&
+		klass->image != mono_defaults.corlib;
+}
+
+/*
+ * class_used_size:
+ *
+ *   Return the end of the last instance field of KLASS and its parents. When
+ * KLASS has a compact layout, the fields of its subclasses can go after that,
+ * in the padding at the end of KLASS.
+ */
+static guint32
+class_used_size (MonoClass *klass)
+{
+	guint32 used = sizeof (MonoObject);
+
+	for (; klass; klass = klass->parent) {
+		int i;
+
+		if (!class_has_compact_layout (klass))
+			return MAX (used, klass->instance_size);
+
+		for (i = 0; i < klass->field.count; ++i) {
+			MonoClassField *field = &klass->fields [i];
+			gint32 align;
+
+			if (mono_field_is_deleted (field) || (field->type->attrs & FIELD_ATTRIBUTE_STATIC))
+				continue;
+			used = MAX (used, field->offset + mono_type_size (field->type, &align));
+		}
+	}
+	return used;
+}
+
+#define ALIGN_TO(val,align) ((((guint64)val) + ((align) - 1)) & ~((align) - 1))
+
+typedef struct {
+	int index;
+	gint32 align;
+	guint32 size;
+} FieldLayoutInfo;
+
+typedef struct {
+	guint32 start;
+	guint32 end;
+} FieldLayoutGap;
+
+static int
+compare_field_layout_info (const void *a, const void *b)
+{
+	const FieldLayoutInfo *f1 = (const FieldLayoutInfo *)a;
+	const FieldLayoutInfo *f2 = (const FieldLayoutInfo *)b;
+
+	if (f1->align != f2->align)
+		return f2->align - f1->align;
+	if (f1->size != f2->size)
+		return f2->size > f1->size ? 1 : -1;
+	return f1->index - f2->index;
+}
+
+/*
+ * layout_fields_compact:
+ *
+ *   Lay out the instance fields of KLASS starting at START. References come
+ * first, so they form a single run in the GC descriptor, then the other fields
+ * by decreasing alignment, each one in the first gap left by alignment which
+ * can hold it. Returns the end of the last field.
+ */
+static guint32
+layout_fields_compact (MonoClass *klass, guint32 start)
+{
+	const int top = klass->field.count;
+	FieldLayoutInfo *others = g_new (FieldLayoutInfo, top);
+	FieldLayoutGap *gaps = g_new (FieldLayoutGap, top + 1);
+	int i, j, num_others = 0, num_gaps = 0;
+	guint32 end = start;
+
+	for (i = 0; i < top; i++) {
+		MonoClassField *field = &klass->fields [i];
+		MonoType *ftype;
+		gint32 align;
+		guint32 size;
+
+		if (mono_field_is_deleted (field))
+			continue;
+		if (field->type->attrs & FIELD_ATTRIBUTE_STATIC)
+			continue;
+
+		size = mono_type_size (field->type, &align);
+		align = klass->packing_size ? MIN (klass->packing_size, align): align;
+		if (!align)
+			align = 1;
+
+		ftype = mono_type_get_underlying_type (field->type);
+		ftype = mono_type_get_basic_type_from_generic (ftype);
+		if (!type_has_references (klass, ftype)) {
+			others [num_others].index = i;
+			others [num_others].align = align;
+			others [num_others].size = size;
+			num_others++;
+			continue;
+		}
+
+		align = MAX (align, sizeof (gpointer));
+		klass->min_align = MAX (align, klass->min_align);
+		field->offset = ALIGN_TO (end, align);
+		if (field->offset > end) {
+			gaps [num_gaps].start = end;
+			gaps [num_gaps].end = field->offset;
+			num_gaps++;
+		}
+		end = field->offset + size;
+	}
+
+	qsort (others, num_others, sizeof (FieldLayoutInfo), compare_field_layout_info);
+
+	for (i = 0; i < num_others; i++) {
+		MonoClassField *field = &klass->fields [others [i].index];
+		gint32 align = others [i].align;
+		guint32 size = others [i].size;
+
+		klass->min_align = MAX (align, klass->min_align);
+
+		for (j = 0; j < num_gaps; j++) {
+			guint32 offset = ALIGN_TO (gaps [j].start, align);
+
+			if (offset + size <= gaps [j].end)
+				break;
+		}
+
+		if (j < num_gaps) {
+			FieldLayoutGap gap = gaps [j];
+
+			field->offset = ALIGN_TO (gap.start, align);
+			/* Whatever is left on either side of the field stays a gap */
+			gaps [j] = gaps [--num_gaps];
+			if (field->offset > gap.start) {
+				gaps [num_gaps].start = gap.start;
+				gaps [num_gaps].end = field->offset;
+				num_gaps++;
+			}
+			if (field->offset + size < gap.end) {
+				gaps [num_gaps].start = field->offset + size;
+				gaps [num_gaps].end = gap.end;
+				num_gaps++;
+			}
+		} else {
+			field->offset = ALIGN_TO (end, align);
+			if (field->offset > end) {
+				gaps [num_gaps].start = end;
+				gaps [num_gaps].end = field->offset;
+				num_gaps++;
+			}
+			end = field->offset + size;
+		}
+		/*TypeBuilders produce all sort of weird things*/
+		g_assert (image_is_dynamic (klass->image) || field->offset > 0);
+	}
+
+	g_free (others);
+	g_free (gaps);
+	return end;
+}
+
 /*
  * mono_class_layout_fields:
  * @class: a class
@@ -1966,6 +2139,19 @@ mono_class_layout_fields (MonoClass *klass, int instance_size)
 			real_size = sizeof (MonoObject);
 		}
 
+		if (class_has_compact_layout (klass)) {
+			if (klass->parent)
+				real_size = class_used_size (klass->parent);
+			real_size = layout_fields_compact (klass, real_size);
+
+			instance_size = MAX (real_size, instance_size);
+			if (instance_size & (klass->min_align - 1)) {
+				instance_size += klass->min_align - 1;
+				instance_size &= ~(klass->min_align - 1);
+			}
+			break;
+		}
+
 		for (pass = 0; pass < passes; ++pass) {
 			for (i = 0; i < top; i++){
 				gint32 align;
@@ -3865,6 +4051,18 @@ mono_class_setup_vtable_full (MonoClass *klass, GList *in_setup)
 	if (g_list_find (in_setup, klass))
 		return;
 
+	/*
+	 * Same as in mono_class_setup_vtable_general (), but done before taking the loader lock,
+	 * so it is not held while setting up the vtables of the whole hierarchy.
+	 */
+	if (klass->parent && !klass->parent->vtable) {
+		GList *parent_in_setup = g_list_prepend (in_setup, klass);
+
+		mono_class_init (klass->parent);
+		mono_class_setup_vtable_full (klass->parent, parent_in_setup);
+		g_list_remove (parent_in_setup, klass);
+	}
+
 	mono_loader_lock ();
 
 	if (klass->vtable) {
@@ -5106,6 +5304,14 @@ mono_class_init (MonoClass *klass)
 
 	/*g_print ("Init class %s\n", mono_type_get_full_name (klass));*/
 
+	/*
+	 * Initialize the parent first, so the loader lock is not held while initializing
+	 * the whole hierarchy, letting other threads initialize unrelated classes in between.
+	 * The initialization of a parent never depends on its subclasses.
+	 */
+	if (klass->parent && !klass->parent->inited)
+		mono_class_init (klass->parent);
+
 	/* We do everything inside the lock to prevent races */
 	mono_loader_lock ();
 
@@ -7675,6 +7881,67 @@ find_nocase (gpointer key, gpointer value, gpointer user_data)
 		data->value = value;
 }
 
+/*
+ * fold_type_name:
+ *
+ *   Return the key of NSPACE.NAME in image->name_case_cache, which is g_malloc'd.
+ */
+static char*
+fold_type_name (const char *nspace, const char *name)
+{
+	char *full_name = g_strconcat (nspace, ".", name, NULL);
+	char *res;
+
+	/* Matches mono_utf8_strcasecmp () */
+	res = g_ascii_strdown (full_name, -1);
+	g_free (full_name);
+	return res;
+}
+
+/*
+ * get_name_case_cache:
+ *
+ *   Return the case insensitive name cache of IMAGE, initializing it if needed.
+ */
+static GHashTable*
+get_name_case_cache (MonoImage *image)
+{
+	MonoTableInfo  *t = &image->tables [MONO_TABLE_TYPEDEF];
+	guint32 cols [MONO_TYPEDEF_SIZE];
+	GHashTable *name_case_cache;
+	guint32 i, visib;
+	char *key;
+
+	if (image->name_case_cache)
+		return image->name_case_cache;
+
+	name_case_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	for (i = 1; i <= t->rows; ++i) {
+		mono_metadata_decode_row (t, i - 1, cols, MONO_TYPEDEF_SIZE);
+		visib = cols [MONO_TYPEDEF_FLAGS] & TYPE_ATTRIBUTE_VISIBILITY_MASK;
+		/* Same as mono_image_init_name_cache () */
+		if (visib >= TYPE_ATTRIBUTE_NESTED_PUBLIC && visib <= TYPE_ATTRIBUTE_NESTED_FAM_OR_ASSEM)
+			continue;
+		key = fold_type_name (mono_metadata_string_heap (image, cols [MONO_TYPEDEF_NAMESPACE]), mono_metadata_string_heap (image, cols [MONO_TYPEDEF_NAME]));
+		/* The first type with a given name wins, like in the linear search */
+		if (g_hash_table_lookup (name_case_cache, key))
+			g_free (key);
+		else
+			g_hash_table_insert (name_case_cache, key, GUINT_TO_POINTER (i));
+	}
+
+	mono_image_lock (image);
+	if (image->name_case_cache) {
+		/* Somebody initialized it before us */
+		g_hash_table_destroy (name_case_cache);
+	} else {
+		mono_atomic_store_release (&image->name_case_cache, name_case_cache);
+	}
+	mono_image_unlock (image);
+
+	return image->name_case_cache;
+}
+
 /**
  * mono_class_from_name_case:
  * @image: The MonoImage where the type is looked up in
@@ -7716,8 +7983,10 @@ mono_class_from_name_case_checked (MonoImage *image, const char *name_space, con
 {
 	MonoTableInfo  *t = &image->tables [MONO_TABLE_TYPEDEF];
 	guint32 cols [MONO_TYPEDEF_SIZE];
+	GHashTable *name_case_cache;
 	const char *n;
 	const char *nspace;
+	char *key;
 	guint32 i, visib;
 
 	mono_error_init (error);
@@ -7754,7 +8023,20 @@ mono_class_from_name_case_checked (MonoImage *image, const char *name_space, con
 
 	}
 
-	/* add a cache if needed */
+	name_case_cache = get_name_case_cache (image);
+	key = fold_type_name (name_space, name);
+	i = GPOINTER_TO_UINT (g_hash_table_lookup (name_case_cache, key));
+	g_free (key);
+	if (!i)
+		return NULL;
+
+	/* Different names can produce the same key, since the namespace and the name are joined with a '.' */
+	mono_metadata_decode_row (t, i - 1, cols, MONO_TYPEDEF_SIZE);
+	n = mono_metadata_string_heap (image, cols [MONO_TYPEDEF_NAME]);
+	nspace = mono_metadata_string_heap (image, cols [MONO_TYPEDEF_NAMESPACE]);
+	if (mono_utf8_strcasecmp (n, name) == 0 && mono_utf8_strcasecmp (nspace, name_space) == 0)
+		return mono_class_get_checked (image, MONO_TOKEN_TYPE_DEF | i, error);
+
 	for (i = 1; i <= t->rows; ++i) {
 		mono_metadata_decode_row (t, i - 1, cols, MONO_TYPEDEF_SIZE);
 		visib = cols [MONO_TYPEDEF_FLAGS] & TYPE_ATTRIBUTE_VISIBILITY_MASK;
@@ -10573,6 +10855,10 @@ mono_generic_class_is_generic_type_definition (MonoGenericClass *gklass)
 void
 mono_class_setup_interface_id (MonoClass *klass)
 {
+	/* interface_id is only written once, so it can be checked without locks */
+	if (!MONO_CLASS_IS_INTERFACE (klass) || klass->interface_id)
+		return;
+
 	mono_loader_lock ();
 	if (MONO_CLASS_IS_INTERFACE (klass) && !klass->interface_id)
 		klass->interface_id = mono_get_unique_iid (klass);
@@ -1077,6 +1077,38 @@ mono_custom_attrs_from_index (MonoImage *image, guint32 idx)
 	mono_error_cleanup (&error);
 	return result;
 }
+/*
+ * cache_custom_attrs:
+ *
+ *   Add AINFO, the attributes of the parent with coded index IDX, to the custom
+ * attribute cache of IMAGE, so the CustomAttribute table doesn't have to be decoded
+ * again for the same parent. AINFO can be NULL if the parent has no attributes.
+ * Cached infos have their 'cached' flag set, so mono_custom_attrs_free () doesn't
+ * free them, they are freed with the image.
+ * Returns the cached info, which might have been added by another thread.
+ */
+static MonoCustomAttrInfo*
+cache_custom_attrs (MonoImage *image, guint32 idx, MonoCustomAttrInfo *ainfo)
+{
+	gpointer cached;
+
+	if (ainfo)
+		ainfo->cached = 1;
+
+	mono_image_lock (image);
+	if (!image->cattr_cache)
+		image->cattr_cache = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+	if (g_hash_table_lookup_extended (image->cattr_cache, GUINT_TO_POINTER (idx), NULL, &cached)) {
+		g_free (ainfo);
+		ainfo = (MonoCustomAttrInfo *)cached;
+	} else {
+		g_hash_table_insert (image->cattr_cache, GUINT_TO_POINTER (idx), ainfo);
+	}
+	mono_image_unlock (image);
+
+	return ainfo;
+}
+
 /**
  * mono_custom_attrs_from_index_checked:
  *
@@ -1092,14 +1124,25 @@ mono_custom_attrs_from_index_checked (MonoImage *image, guint32 idx, gboolean ig
 	GList *tmp, *list = NULL;
 	const char *data;
 	MonoCustomAttrEntry* attr;
+	gboolean complete = TRUE;
+	gpointer cached;
 
 	mono_error_init (error);
 
+	mono_image_lock (image);
+	if (image->cattr_cache && g_hash_table_lookup_extended (image->cattr_cache, GUINT_TO_POINTER (idx), NULL, &cached)) {
+		mono_image_unlock (image);
+		return (MonoCustomAttrInfo *)cached;
+	}
+	mono_image_unlock (image);
+
 	ca = &image->tables [MONO_TABLE_CUSTOMATTRIBUTE];
 
 	i = mono_metadata_custom_attrs_from_index (image, idx);
-	if (!i)
+	if (!i) {
+		cache_custom_attrs (image, idx, NULL);
 		return NULL;
+	}
 	i --;
 	while (i < ca->rows) {
 		if (mono_metadata_decode_row_col (ca, i, MONO_CUSTOM_ATTR_PARENT) != idx)
@@ -1131,6 +1174,7 @@ mono_custom_attrs_from_index_checked (MonoImage *image, guint32 idx, gboolean ig
 		attr->ctor = mono_get_method_checked (image, mtoken, NULL, NULL, error);
 		if (!attr->ctor) {
 			g_warning ("Can't find custom attr constructor image: %s mtoken: 0x%08x due to: %s", image->name, mtoken, mono_error_get_message (error));
+			complete = FALSE;
 			if (ignore_missing) {
 				mono_error_cleanup (error);
 				mono_error_init (error);
@@ -1154,6 +1198,10 @@ mono_custom_attrs_from_index_checked (MonoImage *image, guint32 idx, gboolean ig
 	}
 	g_list_free (list);
 
+	/* The result depends on IGNORE_MISSING if a constructor is missing */
+	if (complete)
+		ainfo = cache_custom_attrs (image, idx, ainfo);
+
 	return ainfo;
 }
 
@@ -33,6 +33,14 @@
 
 #define min(a, b) (((a) < (b)) ? (a) : (b))
 
+// 64x64->128 bit multiplies and 128/64 bit divides compile to one or two
+// instructions on 64-bit targets, instead of the 32-bit limb arithmetic
+// below.
+#if defined(__SIZEOF_INT128__)
+#define HAVE_UINT128 1
+typedef unsigned __int128 uint128_t;
+#endif
+
 typedef enum {
 	MONO_DECIMAL_OK,
 	MONO_DECIMAL_OVERFLOW,
@@ -206,6 +214,14 @@ DivMod64by32(int64_t num, int32_t den)
 static uint64_t
 UInt64x64To128(SPLIT64 op1, SPLIT64 op2, uint64_t *hi)
 {
+#if defined(HAVE_UINT128)
+	uint128_t prod = (uint128_t)op1.int64 * op2.int64;
+
+	*hi = (uint64_t)(prod >> 64);
+	return (uint64_t)prod;
+#elif defined(_MSC_VER) && defined(_M_X64)
+	return _umul128(op1.int64, op2.int64, hi);
+#else
 	SPLIT64  tmp1;
 	SPLIT64  tmp2;
 	SPLIT64  tmp3;
@@ -224,6 +240,7 @@ UInt64x64To128(SPLIT64 op1, SPLIT64 op2, uint64_t *hi)
 
 	*hi = tmp3.int64;
 	return tmp1.int64;
+#endif
 }
 
 /**
@@ -666,6 +683,23 @@ mono_decimal_multiply_result(MonoDecimal * left, MonoDecimal * right, MonoDecima
 
 	scale = left->u.u.scale + right->u.u.scale;
 
+	if ((left->Hi32 | right->Hi32) == 0 && scale <= DEC_SCALE_MAX) {
+		// Both operands fit in 64 bits and the scale doesn't need to be
+		// reduced, which covers most amounts, prices and rates.  If the
+		// non-zero 128-bit product fits in 96 bits it is the result.
+		//
+		tmp.int64 = DECIMAL_LO64_GET(*left);
+		tmp2.int64 = DECIMAL_LO64_GET(*right);
+		tmp.int64 = UInt64x64To128(tmp, tmp2, &tmp3.int64);
+		if (tmp3.u.Hi == 0 && (tmp.int64 | tmp3.u.Lo) != 0) {
+			DECIMAL_LO64_SET(*result, tmp.int64);
+			DECIMAL_HI32(*result) = tmp3.u.Lo;
+			result->u.u.sign = right->u.u.sign ^ left->u.u.sign;
+			result->u.u.scale = (char)scale;
+			return MONO_DECIMAL_OK;
+		}
+	}
+
 	if ((left->Hi32 | left->v.v.Mid32 | right->Hi32 | right->v.v.Mid32) == 0) {
 		// Upper 64 bits are zero.
 		//
@@ -1332,6 +1366,104 @@ OverflowUnscale (uint32_t *quo, gboolean remainder)
 	}
 }
 
+#if defined(HAVE_UINT128)
+/**
+ * DivideBy64:
+ *
+ * Entry:
+ *   quo      - Receives the 96-bit quotient, least-sig first
+ *   left     - Dividend
+ *   den      - Divisor, at most 64 bits and not zero
+ *   scale    - Natural scale of the quotient, updated
+ *   unscale  - Set to TRUE if the quotient got a non-zero remainder
+ *
+ * Purpose:
+ *   Same as the 32 and 64-bit divisor loops of mono_decimal_divide, with
+ *   the dividend and remainder in 128-bit integers: a single divide gives
+ *   the quotient and the remainder instead of normalizing the divisor and
+ *   going through Div96By64 32 bits at a time.  The steps (SearchScale, the
+ *   rounding and OverflowUnscale) are the same, so is the result.
+ *
+ * Exit:
+ *   Returns FALSE on overflow.
+ */
+static gboolean
+DivideBy64(uint32_t *quo, MonoDecimal *left, uint64_t den, int *scale, gboolean *unscale)
+{
+	uint128_t q;
+	uint128_t tmp;
+	uint64_t  rem;
+	uint32_t  pwr;
+	int       cur_scale;
+	gboolean  sticky;
+
+	q = ((uint128_t)DECIMAL_HI32(*left) << 64) | DECIMAL_LO64_GET(*left);
+	rem = (uint64_t)(q % den);
+	q /= den;
+
+	for (;;) {
+		if (rem == 0) {
+			if (*scale < 0) {
+				cur_scale = min(9, -*scale);
+				goto HaveScale;
+			}
+			break;
+		}
+		// We need to unscale if and only if we have a non-zero remainder
+		*unscale = TRUE;
+
+		cur_scale = SearchScale((uint32_t)(q >> 64), (uint32_t)(q >> 32), (uint32_t)q, *scale);
+		if (cur_scale == 0) {
+			// No more scaling to be done, but remainder is non-zero.
+			// Round quotient.
+			//
+			if (rem >= den - rem && (rem > den - rem || (q & 1))) {
+				q++;
+				if (q >> 96) {
+					sticky = TRUE;
+					goto Overflow;
+				}
+			}
+			break;
+		}
+
+		if (cur_scale < 0)
+			return FALSE;
+
+	HaveScale:
+		pwr = power10[cur_scale];
+		*scale += cur_scale;
+
+		q *= pwr;
+		if (q >> 96)
+			return FALSE;
+
+		tmp = (uint128_t)rem * pwr;
+		q += tmp / den;
+		rem = (uint64_t)(tmp % den);
+		if (q >> 96) {
+			sticky = rem != 0;
+			goto Overflow;
+		}
+	}
+
+	quo[0] = (uint32_t)q;
+	quo[1] = (uint32_t)(q >> 32);
+	quo[2] = (uint32_t)(q >> 64);
+	return TRUE;
+
+Overflow:
+	if (*scale == 0)
+		return FALSE;
+	(*scale)--;
+	quo[0] = (uint32_t)q;
+	quo[1] = (uint32_t)(q >> 32);
+	quo[2] = (uint32_t)(q >> 64);
+	OverflowUnscale(quo, sticky);
+	return TRUE;
+}
+#endif
+
 // mono_decimal_divide - Decimal divide
 static MonoDecimalStatus G_GNUC_UNUSED
 mono_decimal_divide_result(MonoDecimal *left, MonoDecimal *right, MonoDecimal *result)
@@ -2659,6 +2791,16 @@ mono_decimal_divide (MonoDecimal *left, MonoDecimal *right)
 	divisor[1] = DECIMAL_MID32(*right);
 	divisor[2] = DECIMAL_HI32(*right);
 
+#if defined(HAVE_UINT128)
+	if (divisor[2] == 0 && (divisor[1] | divisor[0]) != 0) {
+		// Divisor is at most 64 bits, division by zero is reported below.
+		//
+		if (!DivideBy64(quo, left, DECIMAL_LO64_GET(*right), &scale, &unscale)) {
+			mono_set_pending_exception (mono_get_exception_overflow ());
+			return;
+		}
+	} else
+#endif
 	if (divisor[1] == 0 && divisor[2] == 0) {
 		// Divisor is only 32 bits.  Easy divide.
 		//
@@ -13,6 +13,8 @@
 #include <mono/metadata/mono-hash.h>
 #include <mono/utils/mono-compiler.h>
 #include <mono/utils/mono-internal-hash.h>
+#include <mono/utils/mono-conc-hashtable.h>
+#include <mono/utils/lock-free-hashtable.h>
 #include <mono/io-layer/io-layer.h>
 #include <mono/metadata/mempool-internals.h>
 
@@ -55,6 +57,8 @@ typedef struct _MonoJitInfoTable MonoJitInfoTable;
 typedef struct _MonoJitInfoTableChunk MonoJitInfoTableChunk;
 
 #define MONO_JIT_INFO_TABLE_CHUNK_SIZE		64
+/* Number of entries in the lookup cache of a MonoJitInfoTable, a power of two */
+#define MONO_JIT_INFO_TABLE_CACHE_SIZE		512
 
 struct _MonoJitInfoTableChunk
 {
@@ -69,6 +73,11 @@ struct _MonoJitInfoTable
 {
 	MonoDomain	       *domain;
 	int			num_chunks;
+	/*
+	 * Maps blocks of code addresses to the chunk and the position of the last
+	 * MonoJitInfo found in them, see jit_info_table_find () in jit-info.c.
+	 */
+	volatile gsize		cache [MONO_JIT_INFO_TABLE_CACHE_SIZE];
 	MonoJitInfoTableChunk  *chunks [MONO_ZERO_LEN_ARRAY];
 };
 
@@ -193,10 +202,6 @@ typedef enum {
 } MonoJitInfoFlags;
 
 struct _MonoJitInfo {
-	/* NOTE: These first two elements (method and
-	   next_jit_code_hash) must be in the same order and at the
-	   same offset as in RuntimeMethod, because of the jit_code_hash
-	   internal hash table in MonoDomain. */
 	union {
 		MonoMethod *method;
 		MonoImage *image;
@@ -204,7 +209,6 @@ struct _MonoJitInfo {
 		gpointer tramp_info;
 	} d;
 	union {
-		struct _MonoJitInfo *next_jit_code_hash;
 		struct _MonoJitInfo *next_tombstone;
 	} n;
 	gpointer    code_start;
@@ -347,9 +351,8 @@ struct _MonoDomain {
 	GPtrArray          *class_vtable_array;
 	/* maps remote class key -> MonoRemoteClass */
 	GHashTable         *proxy_vtable_hash;
-	/* Protected by 'jit_code_hash_lock' */
-	MonoInternalHashTable jit_code_hash;
-	mono_mutex_t    jit_code_hash_lock;
+	/* Maps methods to their MonoJitInfo, lookups and modifications are lock free */
+	MonoLockFreeHashTable *jit_code_hash;
 	int		    num_jit_info_tables;
 	MonoJitInfoTable * 
 	  volatile          jit_info_table;
@@ -427,6 +430,18 @@ struct _MonoDomain {
 	gboolean throw_unobserved_task_exceptions;
 
 	guint32 execution_context_field_offset;
+
+	/*
+	 * Maps the user string signatures of images to the interned strings loaded from them.
+	 * The strings are pinned and kept alive by ldstr_table. Protected by the ldstr lock.
+	 */
+	GHashTable *ldstr_sig_hash;
+	/*
+	 * Lock-free caches in front of type_hash and refobject_hash, holding the pinned
+	 * reflection objects kept alive by those tables. Written under the domain lock.
+	 */
+	MonoConcurrentHashTable *type_cache;
+	MonoConcurrentHashTable *refobject_cache;
 };
 
 typedef struct  {
@@ -442,8 +457,6 @@ typedef struct  {
 
 #define mono_domain_assemblies_lock(domain) mono_locks_os_acquire(&(domain)->assemblies_lock, DomainAssembliesLock)
 #define mono_domain_assemblies_unlock(domain) mono_locks_os_release(&(domain)->assemblies_lock, DomainAssembliesLock)
-#define mono_domain_jit_code_hash_lock(domain) mono_locks_os_acquire(&(domain)->jit_code_hash_lock, DomainJitCodeHashLock)
-#define mono_domain_jit_code_hash_unlock(domain) mono_locks_os_release(&(domain)->jit_code_hash_lock, DomainJitCodeHashLock)
 
 typedef MonoDomain* (*MonoLoadFunc) (const char *filename, const char *runtime_version);
 
@@ -524,6 +537,9 @@ mono_domain_code_reserve (MonoDomain *domain, int size) MONO_LLVM_INTERNAL;
 void*
 mono_domain_code_reserve_align (MonoDomain *domain, int size, int alignment);
 
+void*
+mono_domain_code_reserve_cold (MonoDomain *domain, int size);
+
 void
 mono_domain_code_commit (MonoDomain *domain, void *data, int size, int newsize);
 
@@ -552,8 +568,8 @@ mono_jit_info_get_thunk_info (MonoJitInfo *ji);
 typedef MonoJitInfo *(*MonoJitInfoFindInAot)         (MonoDomain *domain, MonoImage *image, gpointer addr);
 void          mono_install_jit_info_find_in_aot (MonoJitInfoFindInAot func);
 
-void
-mono_jit_code_hash_init (MonoInternalHashTable *jit_code_hash);
+MonoLockFreeHashTable*
+mono_jit_code_hash_new (void);
 
 MonoAppDomain *
 ves_icall_System_AppDomain_getCurDomain            (void);
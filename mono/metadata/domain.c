@@ -27,6 +27,7 @@
 #include <mono/utils/mono-tls.h>
 #include <mono/utils/mono-mmap.h>
 #include <mono/utils/mono-threads.h>
+#include <mono/utils/mono-startup-trace.h>
 #include <mono/metadata/object.h>
 #include <mono/metadata/object-internals.h>
 #include <mono/metadata/domain-internals.h>
@@ -94,8 +95,8 @@ static gboolean debug_domain_unload;
 
 gboolean mono_dont_free_domains;
 
-#define mono_appdomains_lock() mono_coop_mutex_lock (&appdomains_mutex)
-#define mono_appdomains_unlock() mono_coop_mutex_unlock (&appdomains_mutex)
+#define mono_appdomains_lock() mono_locks_coop_acquire (&appdomains_mutex, DomainsLock)
+#define mono_appdomains_unlock() mono_locks_coop_release (&appdomains_mutex, DomainsLock)
 static MonoCoopMutex appdomains_mutex;
 
 static MonoDomain *mono_root_domain = NULL;
@@ -105,6 +106,22 @@ static int max_domain_code_size = 0;
 static int max_domain_code_alloc = 0;
 static int total_domain_code_alloc = 0;
 
+/*
+ * The mempools of unloaded domains can be big, so they are destroyed by a
+ * background thread while the unloading thread goes on.
+ */
+typedef struct _DeadMemPool DeadMemPool;
+struct _DeadMemPool {
+	MonoMemPool *mp;
+	DeadMemPool *next;
+};
+
+static mono_mutex_t mempool_reaper_mutex;
+static mono_cond_t mempool_reaper_cond;
+static MonoNativeThreadId mempool_reaper_thread;
+static gboolean mempool_reaper_running;
+static DeadMemPool *dead_mempools;
+
 /* AppConfigInfo: Information about runtime versions supported by an 
  * aplication.
  */
@@ -300,7 +317,15 @@ mono_string_hash (MonoString *s)
 	int i, len = mono_string_length (s);
 	guint h = 0;
 
-	for (i = 0; i < len; i++) {
+	/*
+	 * Same as h = h * 31 + c for each character, but four characters at a time,
+	 * which shortens the chain of dependent multiplications.
+	 */
+	for (i = 0; i + 4 <= len; i += 4) {
+		h = h * 923521 + (guint)p [0] * 29791 + (guint)p [1] * 961 + (guint)p [2] * 31 + p [3];
+		p += 4;
+	}
+	for (; i < len; i++) {
 		h = (h << 5) - h + *p;
 		p++;
 	}
@@ -455,8 +480,9 @@ mono_domain_create (void)
 	domain->class_vtable_array = g_ptr_array_new ();
 	domain->proxy_vtable_hash = g_hash_table_new ((GHashFunc)mono_ptrarray_hash, (GCompareFunc)mono_ptrarray_equal);
 	domain->static_data_array = NULL;
-	mono_jit_code_hash_init (&domain->jit_code_hash);
+	domain->jit_code_hash = mono_jit_code_hash_new ();
 	domain->ldstr_table = mono_g_hash_table_new_type ((GHashFunc)mono_string_hash, (GCompareFunc)mono_string_equal, MONO_HASH_KEY_VALUE_GC, MONO_ROOT_SOURCE_DOMAIN, "domain string constants table");
+	domain->ldstr_sig_hash = g_hash_table_new (NULL, NULL);
 	domain->num_jit_info_tables = 1;
 	domain->jit_info_table = mono_jit_info_table_new (domain);
 	domain->jit_info_free_queue = NULL;
@@ -466,7 +492,6 @@ mono_domain_create (void)
 	mono_coop_mutex_init_recursive (&domain->lock);
 
 	mono_os_mutex_init_recursive (&domain->assemblies_lock);
-	mono_os_mutex_init_recursive (&domain->jit_code_hash_lock);
 	mono_os_mutex_init_recursive (&domain->finalizable_objects_hash_lock);
 
 	domain->method_rgctx_hash = NULL;
@@ -511,6 +536,7 @@ mono_init_internal (const char *filename, const char *exe_filename, const char *
 	MonoImageOpenStatus status = MONO_IMAGE_OK;
 	const MonoRuntimeInfo* runtimes [G_N_ELEMENTS (supported_runtimes) + 1];
 	int n, dummy;
+	MonoStartupTraceStamp trace_stamp;
 
 #ifdef DEBUG_DOMAIN_UNLOAD
 	debug_domain_unload = TRUE;
@@ -519,6 +545,9 @@ mono_init_internal (const char *filename, const char *exe_filename, const char *
 	if (domain)
 		g_assert_not_reached ();
 
+	if (mono_startup_trace_enabled)
+		mono_startup_trace_begin (MONO_STARTUP_RUNTIME_INIT, &trace_stamp);
+
 #ifdef HOST_WIN32
 	/* Avoid system error message boxes. */
 	SetErrorMode (SEM_FAILCRITICALERRORS | SEM_NOOPENFILEERRORBOX);
@@ -545,6 +574,8 @@ mono_init_internal (const char *filename, const char *exe_filename, const char *
 	mono_native_tls_alloc (&appdomain_thread_id, NULL);
 
 	mono_coop_mutex_init_recursive (&appdomains_mutex);
+	mono_os_mutex_init (&mempool_reaper_mutex);
+	mono_os_cond_init (&mempool_reaper_cond);
 
 	mono_metadata_init ();
 	mono_images_init ();
@@ -808,6 +839,9 @@ mono_init_internal (const char *filename, const char *exe_filename, const char *
 
 	mono_profiler_appdomain_name (domain, domain->friendly_name);
 
+	if (mono_startup_trace_enabled)
+		mono_startup_trace_end (MONO_STARTUP_RUNTIME_INIT, &trace_stamp, "mono_init_internal");
+
 	return domain;
 }
 
@@ -1056,6 +1090,59 @@ unregister_vtable_reflection_type (MonoVTable *vtable)
 		MONO_GC_UNREGISTER_ROOT_IF_MOVING (vtable->type);
 }
 
+static void*
+mempool_reaper_thread_func (void *arg)
+{
+	mono_native_thread_set_name (mono_native_thread_id_get (), "Domain mempool reaper");
+
+	for (;;) {
+		DeadMemPool *dead;
+
+		mono_os_mutex_lock (&mempool_reaper_mutex);
+		while (!dead_mempools)
+			mono_os_cond_wait (&mempool_reaper_cond, &mempool_reaper_mutex);
+		dead = dead_mempools;
+		dead_mempools = NULL;
+		mono_os_mutex_unlock (&mempool_reaper_mutex);
+
+		while (dead) {
+			DeadMemPool *next = dead->next;
+
+			mono_mempool_destroy (dead->mp);
+			g_free (dead);
+			dead = next;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Destroy MP on the reaper thread, or right away if that thread can't be
+ * started.
+ */
+static void
+mempool_destroy_in_background (MonoMemPool *mp)
+{
+	DeadMemPool *dead;
+
+	mono_os_mutex_lock (&mempool_reaper_mutex);
+	if (!mempool_reaper_running)
+		mempool_reaper_running = mono_native_thread_create (&mempool_reaper_thread, mempool_reaper_thread_func, NULL);
+	if (!mempool_reaper_running) {
+		mono_os_mutex_unlock (&mempool_reaper_mutex);
+		mono_mempool_destroy (mp);
+		return;
+	}
+
+	dead = g_new (DeadMemPool, 1);
+	dead->mp = mp;
+	dead->next = dead_mempools;
+	dead_mempools = dead;
+	mono_os_cond_signal (&mempool_reaper_cond);
+	mono_os_mutex_unlock (&mempool_reaper_mutex);
+}
+
 /**
  * mono_domain_free:
  * @domain: the domain to release
@@ -1104,6 +1191,8 @@ mono_domain_free (MonoDomain *domain, gboolean force)
 	 */
 	mono_g_hash_table_destroy (domain->ldstr_table);
 	domain->ldstr_table = NULL;
+	g_hash_table_destroy (domain->ldstr_sig_hash);
+	domain->ldstr_sig_hash = NULL;
 
 	mono_g_hash_table_destroy (domain->env);
 	domain->env = NULL;
@@ -1117,6 +1206,10 @@ mono_domain_free (MonoDomain *domain, gboolean force)
 			unregister_vtable_reflection_type ((MonoVTable *)g_ptr_array_index (domain->class_vtable_array, i));
 	}
 
+	if (domain->type_cache) {
+		mono_conc_hashtable_destroy (domain->type_cache);
+		domain->type_cache = NULL;
+	}
 	if (domain->type_hash) {
 		mono_g_hash_table_destroy (domain->type_hash);
 		domain->type_hash = NULL;
@@ -1206,7 +1299,8 @@ mono_domain_free (MonoDomain *domain, gboolean force)
 		domain->static_data_class_array = NULL;
 	}
 
-	mono_internal_hash_table_destroy (&domain->jit_code_hash);
+	mono_lock_free_hashtable_destroy (domain->jit_code_hash);
+	domain->jit_code_hash = NULL;
 
 	/*
 	 * There might still be jit info tables of this domain which
@@ -1234,7 +1328,11 @@ mono_domain_free (MonoDomain *domain, gboolean force)
 #ifndef DISABLE_PERFCOUNTERS
 		mono_perfcounters->loader_bytes -= mono_mempool_get_allocated (domain->mp);
 #endif
-		mono_mempool_destroy (domain->mp);
+		/* The runtime is shutting down when the root domain is freed */
+		if (domain == mono_root_domain)
+			mono_mempool_destroy (domain->mp);
+		else
+			mempool_destroy_in_background (domain->mp);
 		domain->mp = NULL;
 		mono_code_manager_destroy (domain->code_mp);
 		domain->code_mp = NULL;
@@ -1263,7 +1361,6 @@ mono_domain_free (MonoDomain *domain, gboolean force)
 
 	mono_os_mutex_destroy (&domain->finalizable_objects_hash_lock);
 	mono_os_mutex_destroy (&domain->assemblies_lock);
-	mono_os_mutex_destroy (&domain->jit_code_hash_lock);
 
 	mono_coop_mutex_destroy (&domain->lock);
 
@@ -1413,6 +1510,24 @@ mono_domain_code_reserve_align (MonoDomain *domain, int size, int alignment)
 	return res;
 }
 
+/*
+ * mono_domain_code_reserve_cold:
+ *
+ *   Allocate memory for rarely executed code, see mono_code_manager_reserve_cold ().
+ * LOCKING: Acquires the domain lock.
+ */
+void*
+mono_domain_code_reserve_cold (MonoDomain *domain, int size)
+{
+	gpointer res;
+
+	mono_domain_lock (domain);
+	res = mono_code_manager_reserve_cold (domain->code_mp, size);
+	mono_domain_unlock (domain);
+
+	return res;
+}
+
 /*
  * mono_domain_code_commit:
  *
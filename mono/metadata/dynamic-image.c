@@ -316,7 +316,7 @@ mono_dynamic_image_create (MonoDynamicAssembly *assembly, char *assembly_name, c
 
 #if HAVE_BOEHM_GC
 	/* The MonoGHashTable's need GC tracking */
-	image = (MonoDynamicImage *)GC_MALLOC (sizeof (MonoDynamicImage));
+	image = (MonoDynamicImage *)mono_gc_alloc_fixed (sizeof (MonoDynamicImage), MONO_GC_DESCRIPTOR_NULL, MONO_ROOT_SOURCE_REFLECTION, "dynamic image");
 #else
 	image = g_new0 (MonoDynamicImage, 1);
 #endif
@@ -555,7 +555,7 @@ mono_dynamic_image_free_image (MonoDynamicImage *image)
 {
 	/* See create_dynamic_mono_image () */
 #if HAVE_BOEHM_GC
-	/* Allocated using GC_MALLOC */
+	/* Allocated using mono_gc_alloc_fixed (), which returns GC memory with Boehm */
 #else
 	g_free (image);
 #endif
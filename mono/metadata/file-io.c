@@ -313,6 +313,11 @@ get_search_dir (const gunichar2 *pattern)
 	return result;
 }
 
+#ifdef HOST_WIN32
+/* FindNextFile () already doesn't stat on Windows */
+#define FindNextFileBasic(handle, find_data, attr_mask) FindNextFile ((handle), (find_data))
+#endif
+
 static GPtrArray *
 get_filesystem_entries (const gunichar2 *path,
 						 const gunichar2 *path_with_pattern,
@@ -371,7 +376,7 @@ get_filesystem_entries (const gunichar2 *path,
 
 			g_free (utf8_result);
 		}
-	} while(FindNextFile (find_handle, &data));
+	} while(FindNextFileBasic (find_handle, &data, mask));
 
 	if (FindClose (find_handle) == FALSE) {
 		*error = GetLastError ();
@@ -136,9 +136,56 @@ int ves_icall_System_IO_InotifyWatcher_RemoveWatch (int fd, gint32 watch_descrip
 {
 	return -1;
 }
+
+gpointer ves_icall_System_IO_InotifyWatcher_OpenTree (MonoString *root, gint32 mask, MonoBoolean recursive)
+{
+	return NULL;
+}
+
+int ves_icall_System_IO_InotifyWatcher_ReadTree (gpointer tree, gpointer buffer, int length)
+{
+	return -1;
+}
+
+void ves_icall_System_IO_InotifyWatcher_CloseTree (gpointer tree)
+{
+}
 #else
 #include <sys/inotify.h>
+#include <sys/stat.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <string.h>
+
+static void
+set_inotify_last_error (void)
+{
+	switch (errno) {
+	case EACCES:
+		errno = ERROR_ACCESS_DENIED;
+		break;
+	case EBADF:
+		errno = ERROR_INVALID_HANDLE;
+		break;
+	case EFAULT:
+		errno = ERROR_INVALID_ACCESS;
+		break;
+	case EINVAL:
+		errno = ERROR_INVALID_DATA;
+		break;
+	case ENOMEM:
+		errno = ERROR_NOT_ENOUGH_MEMORY;
+		break;
+	case ENOSPC:
+		errno = ERROR_TOO_MANY_OPEN_FILES;
+		break;
+	default:
+		errno = ERROR_GEN_FAILURE;
+		break;
+	}
+	mono_marshal_set_last_error ();
+}
 
 int
 ves_icall_System_IO_InotifyWatcher_GetInotifyInstance ()
@@ -164,32 +211,8 @@ ves_icall_System_IO_InotifyWatcher_AddWatch (int fd, MonoString *name, gint32 ma
 		path = str;
 
 	retval = inotify_add_watch (fd, path, mask);
-	if (retval < 0) {
-		switch (errno) {
-		case EACCES:
-			errno = ERROR_ACCESS_DENIED;
-			break;
-		case EBADF:
-			errno = ERROR_INVALID_HANDLE;
-			break;
-		case EFAULT:
-			errno = ERROR_INVALID_ACCESS;
-			break;
-		case EINVAL:
-			errno = ERROR_INVALID_DATA;
-			break;
-		case ENOMEM:
-			errno = ERROR_NOT_ENOUGH_MEMORY;
-			break;
-		case ENOSPC:
-			errno = ERROR_TOO_MANY_OPEN_FILES;
-			break;
-		default:
-			errno = ERROR_GEN_FAILURE;
-			break;
-		}
-		mono_marshal_set_last_error ();
-	}
+	if (retval < 0)
+		set_inotify_last_error ();
 	if (path != str)
 		g_free (path);
 	g_free (str);
@@ -201,6 +224,436 @@ ves_icall_System_IO_InotifyWatcher_RemoveWatch (int fd, gint32 watch_descriptor)
 {
 	return inotify_rm_watch (fd, watch_descriptor);
 }
+
+/*
+ * Tree watchers.
+ *
+ * Adding a watch per directory from managed code and reading the events one
+ * at a time doesn't scale to big trees with lots of changes. An InotifyTree
+ * keeps the watches of a whole tree on the native side, and ReadTree ()
+ * returns all the pending events in one call, draining the inotify fd with as
+ * few read () calls as possible. Runs of IN_MODIFY, IN_ATTRIB and
+ * IN_CLOSE_WRITE events for the same file in one call are coalesced into one
+ * record, other events are returned in order.
+ *
+ * Each record is an InotifyTreeRecord followed by the UTF-8 path relative to
+ * the root, padded to 4 bytes. New subdirectories of recursive trees are
+ * watched as soon as they show up, and IN_CREATE records are made up for the
+ * entries which were created in them before the watch was added. A record
+ * with IN_Q_OVERFLOW and an empty path means events were lost, and the tree
+ * needs to be scanned again.
+ */
+#define COALESCED_EVENTS (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE)
+#define INOTIFY_TREE_BUFFER_SIZE (64 * 1024)
+
+typedef struct {
+	guint32 mask;
+	guint32 cookie;
+	gint32 length;
+} InotifyTreeRecord;
+
+typedef struct {
+	guint32 mask;
+	char *path;
+} PendingEvent;
+
+typedef struct {
+	int fd;
+	/* Written to to interrupt the poll () in ReadTree () */
+	int wakeup [2];
+	guint32 mask;
+	gboolean recursive;
+	char *root;
+	/* watch descriptor -> path of the directory relative to the root */
+	GHashTable *dirs;
+	/* PendingEvents, returned before the rest of the events */
+	GQueue *pending;
+	char *events;
+	int events_start, events_end;
+} InotifyTree;
+
+typedef struct {
+	char *buffer;
+	int length;
+	int pos;
+	/* path -> offset of the last record which can be coalesced with */
+	GHashTable *coalesced;
+} TreeOutput;
+
+static char *
+tree_path (const char *dir, const char *name)
+{
+	return dir [0] ? g_build_filename (dir, name, NULL) : g_strdup (name);
+}
+
+static void
+tree_queue_event (InotifyTree *tree, guint32 mask, const char *path)
+{
+	PendingEvent *ev = g_new0 (PendingEvent, 1);
+
+	ev->mask = mask;
+	ev->path = g_strdup (path);
+	g_queue_push_tail (tree->pending, ev);
+}
+
+/*
+ * tree_add_dir:
+ *
+ *   Watch the directory REL and, for recursive trees, everything below it.
+ * When SYNTHESIZE is set, queue IN_CREATE events for the entries found.
+ * Returns FALSE when REL or one of its subdirectories couldn't be watched for
+ * other reasons than having gone away already.
+ */
+static gboolean
+tree_add_dir (InotifyTree *tree, const char *rel, gboolean synthesize)
+{
+	char *path = rel [0] ? g_build_filename (tree->root, rel, NULL) : g_strdup (tree->root);
+	guint32 mask = tree->mask | IN_ONLYDIR | IN_DONT_FOLLOW;
+	gboolean res = TRUE;
+	const char *name;
+	GDir *dir;
+	int wd;
+
+	if (tree->recursive)
+		mask |= IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+	wd = inotify_add_watch (tree->fd, path, mask);
+	if (wd < 0) {
+		g_free (path);
+		return rel [0] && (errno == ENOENT || errno == ENOTDIR || errno == EACCES);
+	}
+	g_hash_table_replace (tree->dirs, GINT_TO_POINTER (wd), g_strdup (rel));
+
+	if (!tree->recursive) {
+		g_free (path);
+		return TRUE;
+	}
+
+	dir = g_dir_open (path, 0, NULL);
+	while (dir && res && (name = g_dir_read_name (dir))) {
+		char *child = g_build_filename (path, name, NULL);
+		char *child_rel = tree_path (rel, name);
+		struct stat buf;
+		gboolean is_dir = lstat (child, &buf) == 0 && S_ISDIR (buf.st_mode);
+
+		if (synthesize && (tree->mask & IN_CREATE))
+			tree_queue_event (tree, IN_CREATE | (is_dir ? IN_ISDIR : 0), child_rel);
+		if (is_dir)
+			res = tree_add_dir (tree, child_rel, synthesize);
+		g_free (child_rel);
+		g_free (child);
+	}
+	if (dir)
+		g_dir_close (dir);
+	g_free (path);
+	return res;
+}
+
+typedef struct {
+	int fd;
+	const char *path;
+} RemoveDirData;
+
+static gboolean
+remove_dir_watch (gpointer key, gpointer value, gpointer user_data)
+{
+	RemoveDirData *data = (RemoveDirData *)user_data;
+	const char *rel = (const char *)value;
+	size_t len = strlen (data->path);
+
+	if (strncmp (rel, data->path, len) || (rel [len] && rel [len] != G_DIR_SEPARATOR))
+		return FALSE;
+	inotify_rm_watch (data->fd, GPOINTER_TO_INT (key));
+	return TRUE;
+}
+
+/* Stop watching the directory REL, which was moved away or deleted, and everything below it */
+static void
+tree_remove_dir (InotifyTree *tree, const char *rel)
+{
+	RemoveDirData data;
+
+	data.fd = tree->fd;
+	data.path = rel;
+	g_hash_table_foreach_remove (tree->dirs, remove_dir_watch, &data);
+}
+
+/* Returns FALSE if there is no room left in OUT */
+static gboolean
+tree_emit (TreeOutput *out, guint32 mask, guint32 cookie, const char *path)
+{
+	InotifyTreeRecord record;
+	gboolean coalesce = !(mask & ~(COALESCED_EVENTS | IN_ISDIR));
+	int len = strlen (path);
+	int size = sizeof (record) + ((len + 3) & ~3);
+	gpointer offset;
+
+	if (coalesce && g_hash_table_lookup_extended (out->coalesced, path, NULL, &offset)) {
+		memcpy (&record, out->buffer + GPOINTER_TO_INT (offset), sizeof (record));
+		record.mask |= mask;
+		memcpy (out->buffer + GPOINTER_TO_INT (offset), &record, sizeof (record));
+		return TRUE;
+	}
+
+	if (out->pos + size > out->length)
+		return FALSE;
+
+	record.mask = mask;
+	record.cookie = cookie;
+	record.length = len;
+	memcpy (out->buffer + out->pos, &record, sizeof (record));
+	memcpy (out->buffer + out->pos + sizeof (record), path, len);
+	memset (out->buffer + out->pos + sizeof (record) + len, 0, size - sizeof (record) - len);
+
+	if (coalesce)
+		g_hash_table_replace (out->coalesced, g_strdup (path), GINT_TO_POINTER (out->pos));
+	else
+		/* Later events for PATH mustn't be merged into records before this one */
+		g_hash_table_remove (out->coalesced, path);
+	out->pos += size;
+	return TRUE;
+}
+
+/* Returns FALSE if EV didn't fit in OUT, in which case it has to be processed again */
+static gboolean
+tree_process_event (InotifyTree *tree, struct inotify_event *ev, TreeOutput *out)
+{
+	const char *dir;
+	char *path;
+
+	if (ev->mask & IN_Q_OVERFLOW)
+		return tree_emit (out, IN_Q_OVERFLOW, 0, "");
+	if (ev->mask & IN_IGNORED) {
+		g_hash_table_remove (tree->dirs, GINT_TO_POINTER (ev->wd));
+		return TRUE;
+	}
+
+	dir = (const char *)g_hash_table_lookup (tree->dirs, GINT_TO_POINTER (ev->wd));
+	if (!dir)
+		return TRUE;
+
+	path = ev->len ? tree_path (dir, ev->name) : g_strdup (dir);
+	if ((ev->mask & tree->mask) && !tree_emit (out, ev->mask, ev->cookie, path)) {
+		g_free (path);
+		return FALSE;
+	}
+
+	if (tree->recursive && ev->len && (ev->mask & IN_ISDIR)) {
+		if (ev->mask & (IN_MOVED_FROM | IN_DELETE))
+			tree_remove_dir (tree, path);
+		if ((ev->mask & (IN_CREATE | IN_MOVED_TO)) && !tree_add_dir (tree, path, TRUE))
+			/* Probably out of watches, the managed side reports it */
+			tree_queue_event (tree, IN_Q_OVERFLOW, "");
+	}
+	g_free (path);
+	return TRUE;
+}
+
+/*
+ * tree_flush:
+ *
+ *   Write the pending events and the ones left from the last read () to OUT.
+ * Returns FALSE if OUT filled up before all of them were written.
+ */
+static gboolean
+tree_flush (InotifyTree *tree, TreeOutput *out)
+{
+	for (;;) {
+		while (!g_queue_is_empty (tree->pending)) {
+			PendingEvent *ev = (PendingEvent *)g_queue_pop_head (tree->pending);
+
+			if (!tree_emit (out, ev->mask, 0, ev->path)) {
+				g_queue_push_head (tree->pending, ev);
+				return FALSE;
+			}
+			g_free (ev->path);
+			g_free (ev);
+		}
+
+		if (tree->events_start == tree->events_end)
+			return TRUE;
+
+		if (!tree_process_event (tree, (struct inotify_event *)(tree->events + tree->events_start), out))
+			return FALSE;
+		tree->events_start += sizeof (struct inotify_event) + ((struct inotify_event *)(tree->events + tree->events_start))->len;
+	}
+}
+
+static void
+tree_free (InotifyTree *tree)
+{
+	PendingEvent *ev;
+
+	if (tree->fd != -1)
+		close (tree->fd);
+	if (tree->wakeup [0] != -1)
+		close (tree->wakeup [0]);
+	if (tree->wakeup [1] != -1)
+		close (tree->wakeup [1]);
+	while ((ev = (PendingEvent *)g_queue_pop_head (tree->pending))) {
+		g_free (ev->path);
+		g_free (ev);
+	}
+	g_queue_free (tree->pending);
+	g_hash_table_destroy (tree->dirs);
+	g_free (tree->events);
+	g_free (tree->root);
+	g_free (tree);
+}
+
+/*
+ * ves_icall_System_IO_InotifyWatcher_OpenTree:
+ *
+ *   Start watching ROOT for the events in MASK, and all of its subdirectories
+ * if RECURSIVE is set. Returns NULL and sets the last error on failure.
+ */
+gpointer
+ves_icall_System_IO_InotifyWatcher_OpenTree (MonoString *root, gint32 mask, MonoBoolean recursive)
+{
+	MonoError error;
+	InotifyTree *tree;
+	char *str, *path;
+	int saved_errno;
+
+	if (root == NULL)
+		return NULL;
+
+	str = mono_string_to_utf8_checked (root, &error);
+	if (mono_error_set_pending_exception (&error))
+		return NULL;
+	path = mono_portability_find_file (str, TRUE);
+	if (path)
+		g_free (str);
+	else
+		path = str;
+
+	tree = g_new0 (InotifyTree, 1);
+	tree->fd = -1;
+	tree->wakeup [0] = tree->wakeup [1] = -1;
+	tree->mask = mask;
+	tree->recursive = recursive;
+	tree->root = path;
+	tree->dirs = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+	tree->pending = g_queue_new ();
+	tree->events = (char *)g_malloc (INOTIFY_TREE_BUFFER_SIZE);
+
+	tree->fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+	if (tree->fd == -1 || pipe (tree->wakeup) == -1 || !tree_add_dir (tree, "", FALSE)) {
+		saved_errno = errno;
+		tree_free (tree);
+		errno = saved_errno;
+		set_inotify_last_error ();
+		return NULL;
+	}
+	fcntl (tree->wakeup [0], F_SETFL, O_NONBLOCK);
+	fcntl (tree->wakeup [1], F_SETFL, O_NONBLOCK);
+
+	return tree;
+}
+
+static void
+interrupt_tree_read (gpointer data)
+{
+	InotifyTree *tree = (InotifyTree *)data;
+	char c = 0;
+
+	while (write (tree->wakeup [1], &c, 1) == -1 && errno == EINTR)
+		;
+}
+
+/*
+ * ves_icall_System_IO_InotifyWatcher_ReadTree:
+ *
+ *   Wait for events on TREE and write as many of them as fit to BUFFER, in
+ * the format described above. Returns the number of bytes written, 0 if the
+ * wait was interrupted, or -1 and sets the last error on failure.
+ */
+int
+ves_icall_System_IO_InotifyWatcher_ReadTree (gpointer handle, gpointer buffer, int length)
+{
+	InotifyTree *tree = (InotifyTree *)handle;
+	struct pollfd fds [2];
+	TreeOutput out;
+	gboolean interrupted;
+	char c;
+	int res = 0, ready;
+	ssize_t n;
+
+	out.buffer = (char *)buffer;
+	out.length = length;
+	out.pos = 0;
+	out.coalesced = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	mono_thread_info_install_interrupt (interrupt_tree_read, tree, &interrupted);
+	if (interrupted) {
+		g_hash_table_destroy (out.coalesced);
+		return 0;
+	}
+
+	for (;;) {
+		if (!tree_flush (tree, &out)) {
+			if (!out.pos) {
+				errno = ERROR_INSUFFICIENT_BUFFER;
+				mono_marshal_set_last_error ();
+				res = -1;
+			}
+			break;
+		}
+
+		/* Everything was written, read more without blocking */
+		n = read (tree->fd, tree->events, INOTIFY_TREE_BUFFER_SIZE);
+		if (n > 0) {
+			tree->events_start = 0;
+			tree->events_end = n;
+			continue;
+		}
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n < 0 && errno != EAGAIN) {
+			set_inotify_last_error ();
+			res = -1;
+			break;
+		}
+		if (out.pos)
+			break;
+
+		fds [0].fd = tree->fd;
+		fds [0].events = POLLIN;
+		fds [1].fd = tree->wakeup [0];
+		fds [1].events = POLLIN;
+
+		MONO_ENTER_GC_SAFE;
+		ready = poll (fds, 2, -1);
+		MONO_EXIT_GC_SAFE;
+
+		if (ready < 0 && errno != EINTR) {
+			set_inotify_last_error ();
+			res = -1;
+			break;
+		}
+		if (ready > 0 && fds [1].revents) {
+			while (read (tree->wakeup [0], &c, 1) == 1)
+				;
+			break;
+		}
+	}
+
+	mono_thread_info_uninstall_interrupt (&interrupted);
+	g_hash_table_destroy (out.coalesced);
+
+	return res == -1 ? -1 : out.pos;
+}
+
+/*
+ * ves_icall_System_IO_InotifyWatcher_CloseTree:
+ *
+ *   Stop watching TREE. The thread reading from it has to be interrupted and
+ * done with ReadTree () first.
+ */
+void
+ves_icall_System_IO_InotifyWatcher_CloseTree (gpointer handle)
+{
+	tree_free ((InotifyTree *)handle);
+}
 #endif
 
 #if HAVE_KQUEUE
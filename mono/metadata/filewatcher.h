@@ -31,6 +31,9 @@ gboolean ves_icall_System_IO_FAMW_InternalFAMNextEvent (gpointer conn,
 int ves_icall_System_IO_InotifyWatcher_GetInotifyInstance (void);
 int ves_icall_System_IO_InotifyWatcher_AddWatch (int fd, MonoString *directory, gint32 mask);
 int ves_icall_System_IO_InotifyWatcher_RemoveWatch (int fd, gint32 watch_descriptor);
+gpointer ves_icall_System_IO_InotifyWatcher_OpenTree (MonoString *root, gint32 mask, MonoBoolean recursive);
+int ves_icall_System_IO_InotifyWatcher_ReadTree (gpointer tree, gpointer buffer, int length);
+void ves_icall_System_IO_InotifyWatcher_CloseTree (gpointer tree);
 
 int ves_icall_System_IO_KqueueMonitor_kevent_notimeout (int *kq, gpointer changelist, int nchanges, gpointer eventlist, int nevents);
 
@@ -286,6 +286,11 @@ void mono_gc_set_desktop_mode (void);
  */
 gboolean mono_gc_is_moving (void);
 
+/*
+ * Return whenever JITted code must emit write barriers for reference stores
+ */
+gboolean mono_gc_needs_write_barriers (void);
+
 typedef void* (*MonoGCLockedCallbackFunc) (void *data);
 
 void* mono_gc_invoke_with_gc_lock (MonoGCLockedCallbackFunc func, void *data);
@@ -360,6 +365,14 @@ BOOL APIENTRY mono_gc_dllmain (HMODULE module_handle, DWORD reason, LPVOID reser
 
 guint mono_gc_get_vtable_bits (MonoClass *klass);
 
+#ifdef MONO_SMALL_OBJECT_HEADER
+/*
+ * Objects don't have a synchronisation field, their lock words are kept in a
+ * side table by the GC.
+ */
+MonoThreadsSync * volatile *mono_gc_get_lock_word_address (MonoObject *obj, gboolean create);
+#endif
+
 void mono_gc_register_altstack (gpointer stack, gint32 stack_size, gpointer altstack, gint32 altstack_size);
 
 /* If set, print debugging messages around finalizers. */
@@ -578,7 +578,10 @@ ICALL(FILEW_4, "InternalSupportsFSW", ves_icall_System_IO_FSW_SupportsFSW)
 
 ICALL_TYPE(INOW, "System.IO.InotifyWatcher", INOW_1)
 ICALL(INOW_1, "AddWatch", ves_icall_System_IO_InotifyWatcher_AddWatch)
+ICALL(INOW_4, "CloseTree", ves_icall_System_IO_InotifyWatcher_CloseTree)
 ICALL(INOW_2, "GetInotifyInstance", ves_icall_System_IO_InotifyWatcher_GetInotifyInstance)
+ICALL(INOW_5, "OpenTree", ves_icall_System_IO_InotifyWatcher_OpenTree)
+ICALL(INOW_6, "ReadTree", ves_icall_System_IO_InotifyWatcher_ReadTree)
 ICALL(INOW_3, "RemoveWatch", ves_icall_System_IO_InotifyWatcher_RemoveWatch)
 
 ICALL_TYPE(KQUEM, "System.IO.KqueueMonitor", KQUEM_1)
@@ -702,18 +705,22 @@ ICALL(SOCK_9, "Listen_internal(intptr,int,int&)", ves_icall_System_Net_Sockets_S
 ICALL(SOCK_10, "LocalEndPoint_internal(intptr,int,int&)", ves_icall_System_Net_Sockets_Socket_LocalEndPoint_internal)
 ICALL(SOCK_11, "Poll_internal", ves_icall_System_Net_Sockets_Socket_Poll_internal)
 ICALL(SOCK_13, "ReceiveFrom_internal(intptr,byte[],int,int,System.Net.Sockets.SocketFlags,System.Net.SocketAddress&,int&)", ves_icall_System_Net_Sockets_Socket_ReceiveFrom_internal)
+ICALL(SOCK_13a, "ReceiveMessages_internal(intptr,System.Net.Sockets.Socket/WSABUF[],System.Net.SocketAddress[],int[],System.Net.Sockets.SocketFlags,int&)", ves_icall_System_Net_Sockets_Socket_ReceiveMessages_internal)
 ICALL(SOCK_11a, "Receive_internal(intptr,System.Net.Sockets.Socket/WSABUF[],System.Net.Sockets.SocketFlags,int&)", ves_icall_System_Net_Sockets_Socket_Receive_array_internal)
 ICALL(SOCK_12, "Receive_internal(intptr,byte[],int,int,System.Net.Sockets.SocketFlags,int&)", ves_icall_System_Net_Sockets_Socket_Receive_internal)
 ICALL(SOCK_14, "RemoteEndPoint_internal(intptr,int,int&)", ves_icall_System_Net_Sockets_Socket_RemoteEndPoint_internal)
 ICALL(SOCK_15, "Select_internal(System.Net.Sockets.Socket[]&,int,int&)", ves_icall_System_Net_Sockets_Socket_Select_internal)
 ICALL(SOCK_15a, "SendFile_internal(intptr,string,byte[],byte[],System.Net.Sockets.TransmitFileOptions)", ves_icall_System_Net_Sockets_Socket_SendFile_internal)
+ICALL(SOCK_15b, "SendMessages_internal(intptr,System.Net.Sockets.Socket/WSABUF[],System.Net.SocketAddress[],int[],System.Net.Sockets.SocketFlags,int&)", ves_icall_System_Net_Sockets_Socket_SendMessages_internal)
 ICALL(SOCK_16, "SendTo_internal(intptr,byte[],int,int,System.Net.Sockets.SocketFlags,System.Net.SocketAddress,int&)", ves_icall_System_Net_Sockets_Socket_SendTo_internal)
+ICALL(SOCK_16b, "SendZeroCopy_internal(intptr,System.Net.Sockets.Socket/WSABUF[],System.Net.Sockets.SocketFlags,bool&,int&)", ves_icall_System_Net_Sockets_Socket_SendZeroCopy_internal)
 ICALL(SOCK_16a, "Send_internal(intptr,System.Net.Sockets.Socket/WSABUF[],System.Net.Sockets.SocketFlags,int&)", ves_icall_System_Net_Sockets_Socket_Send_array_internal)
 ICALL(SOCK_17, "Send_internal(intptr,byte[],int,int,System.Net.Sockets.SocketFlags,int&)", ves_icall_System_Net_Sockets_Socket_Send_internal)
 ICALL(SOCK_18, "SetSocketOption_internal(intptr,System.Net.Sockets.SocketOptionLevel,System.Net.Sockets.SocketOptionName,object,byte[],int,int&)", ves_icall_System_Net_Sockets_Socket_SetSocketOption_internal)
 ICALL(SOCK_19, "Shutdown_internal(intptr,System.Net.Sockets.SocketShutdown,int&)", ves_icall_System_Net_Sockets_Socket_Shutdown_internal)
 ICALL(SOCK_20, "Socket_internal(System.Net.Sockets.AddressFamily,System.Net.Sockets.SocketType,System.Net.Sockets.ProtocolType,int&)", ves_icall_System_Net_Sockets_Socket_Socket_internal)
 ICALL(SOCK_20a, "SupportsPortReuse", ves_icall_System_Net_Sockets_Socket_SupportPortReuse)
+ICALL(SOCK_20b, "ZeroCopyCompletion_internal(intptr,uint&,uint&,bool&,int&)", ves_icall_System_Net_Sockets_Socket_ZeroCopyCompletion_internal)
 ICALL(SOCK_21a, "cancel_blocking_socket_operation", icall_cancel_blocking_socket_operation)
 
 ICALL_TYPE(SOCKEX, "System.Net.Sockets.SocketException", SOCKEX_1)
@@ -721,8 +728,14 @@ ICALL(SOCKEX_1, "WSAGetLastError_internal", ves_icall_System_Net_Sockets_SocketE
 #endif /* !DISABLE_SOCKETS */
 
 ICALL_TYPE(NUMBER, "System.Number", NUMBER_1)
-ICALL(NUMBER_1, "NumberBufferToDecimal", mono_decimal_from_number)
-ICALL(NUMBER_2, "NumberBufferToDouble", mono_double_from_number)
+ICALL(NUMBER_1, "DoubleToStringInvariant", ves_icall_System_Number_DoubleToStringInvariant)
+ICALL(NUMBER_2, "FormatDoubleInvariant", mono_number_format_double)
+ICALL(NUMBER_3, "FormatInt64Invariant", mono_number_format_int64)
+ICALL(NUMBER_4, "FormatUInt64Invariant", mono_number_format_uint64)
+ICALL(NUMBER_5, "Int64ToStringInvariant", ves_icall_System_Number_Int64ToStringInvariant)
+ICALL(NUMBER_6, "NumberBufferToDecimal", mono_decimal_from_number)
+ICALL(NUMBER_7, "NumberBufferToDouble", mono_double_from_number)
+ICALL(NUMBER_8, "ParseInt64Invariant", ves_icall_System_Number_ParseInt64Invariant)
 
 ICALL_TYPE(NUMBER_FORMATTER, "System.NumberFormatter", NUMBER_FORMATTER_1)
 ICALL(NUMBER_FORMATTER_1, "GetFormatterTables", ves_icall_System_NumberFormatter_GetFormatterTables)
@@ -3260,6 +3260,25 @@ ves_icall_InternalInvoke (MonoReflectionMethod *method, MonoObject *this_arg, Mo
 			return (MonoObject*)arr;
 		}
 	}
+
+	/*
+	 * Methods invoked repeatedly are called through a wrapper which unpacks the
+	 * arguments in managed code. Remoted receivers need the slow path.
+	 */
+	if (obj == this_arg && !(this_arg && mono_object_class (this_arg) == mono_defaults.transparent_proxy_class)) {
+		MonoMethod *invoke = mono_marshal_lookup_reflection_invoke_wrapper (m);
+
+		if (invoke) {
+			gpointer args [2];
+
+			args [0] = this_arg;
+			args [1] = params;
+			MonoObject *result = mono_runtime_invoke_checked (invoke, NULL, args, &error);
+			mono_error_set_pending_exception (&error);
+			return result;
+		}
+	}
+
 	MonoObject *result = mono_runtime_invoke_array_checked (m, obj, params, &error);
 	mono_error_set_pending_exception (&error);
 	return result;
@@ -7745,6 +7764,48 @@ ves_icall_System_Runtime_InteropServices_Marshal_PrelinkAll (MonoReflectionType
 	}
 }
 
+/*
+ * Invariant culture fast paths, the string is allocated with its final length
+ * and the digits are formatted on the stack.
+ */
+ICALL_EXPORT MonoString *
+ves_icall_System_Number_Int64ToStringInvariant (gint64 value)
+{
+	MonoError error;
+	MonoString *result;
+	gunichar2 buffer [MONO_NUMBER_FORMAT_BUFFER_SIZE];
+	gint32 len;
+
+	len = mono_number_format_int64 (value, buffer);
+	result = mono_string_new_size_checked (mono_domain_get (), len, &error);
+	if (mono_error_set_pending_exception (&error))
+		return NULL;
+	memcpy (mono_string_chars (result), buffer, len * sizeof (gunichar2));
+	return result;
+}
+
+ICALL_EXPORT MonoString *
+ves_icall_System_Number_DoubleToStringInvariant (gdouble value)
+{
+	MonoError error;
+	MonoString *result;
+	gunichar2 buffer [MONO_NUMBER_FORMAT_BUFFER_SIZE];
+	gint32 len;
+
+	len = mono_number_format_double (value, buffer);
+	result = mono_string_new_size_checked (mono_domain_get (), len, &error);
+	if (mono_error_set_pending_exception (&error))
+		return NULL;
+	memcpy (mono_string_chars (result), buffer, len * sizeof (gunichar2));
+	return result;
+}
+
+ICALL_EXPORT MonoBoolean
+ves_icall_System_Number_ParseInt64Invariant (const gunichar2 *s, gint32 length, gint64 *result)
+{
+	return mono_number_parse_int64 (s, length, result);
+}
+
 /* These parameters are "readonly" in corlib/System/NumberFormatter.cs */
 ICALL_EXPORT void
 ves_icall_System_NumberFormatter_GetFormatterTables (guint64 const **mantissas,
@@ -31,6 +31,7 @@
 #include <mono/utils/mono-logger-internals.h>
 #include <mono/utils/mono-path.h>
 #include <mono/utils/mono-mmap.h>
+#include <mono/utils/mono-mmap-internals.h>
 #include <mono/utils/mono-io-portability.h>
 #include <mono/utils/atomic.h>
 #include <mono/metadata/class-internals.h>
@@ -1087,6 +1088,13 @@ do_mono_image_load (MonoImage *image, MonoImageOpenStatus *status,
 	if (!mono_image_load_cli_data (image))
 		goto invalid_image;
 
+	/*
+	 * The tables and heaps are accessed right away, start reading them in the background.
+	 * The rest of the file, like method bodies and resources, is only faulted in on access.
+	 */
+	if (image->raw_buffer_used && !image->fileio_used && image->raw_metadata)
+		mono_vprefetch (image->raw_metadata, iinfo->cli_cli_header.ch_metadata.size);
+
 	if (image->loader == &pe_loader && !image->metadata_only && !mono_verifier_verify_table_data (image, &errors))
 		goto invalid_image;
 
@@ -1645,12 +1653,19 @@ mono_wrapper_caches_free (MonoWrapperCaches *cache)
 	free_hash (cache->native_wrapper_aot_check_cache);
 
 	free_hash (cache->native_func_wrapper_aot_cache);
+	free_hash (cache->native_shared_wrapper_cache);
 	free_hash (cache->remoting_invoke_cache);
 	free_hash (cache->synchronized_cache);
 	free_hash (cache->unbox_wrapper_cache);
 	free_hash (cache->cominterop_invoke_cache);
 	free_hash (cache->cominterop_wrapper_cache);
 	free_hash (cache->thunk_invoke_cache);
+	free_hash (cache->thunk_invoke_unboxed_cache);
+	free_hash (cache->reflection_invoke_cache);
+	free_hash (cache->reflection_invoke_count_cache);
+	free_hash (cache->valuetype_equals_cache);
+	free_hash (cache->valuetype_hash_cache);
+	free_hash (cache->create_instance_cache);
 }
 
 /*
@@ -1767,6 +1782,8 @@ mono_image_close_except_pools (MonoImage *image)
 		g_free (image->raw_data);
 	}
 
+	mono_verifier_cache_close (image);
+
 	if (debug_assembly_unload) {
 		image->name = g_strdup_printf ("%s - UNLOADED", image->name);
 	} else {
@@ -1794,6 +1811,14 @@ mono_image_close_except_pools (MonoImage *image)
 		g_hash_table_foreach (image->name_cache, free_hash_table, NULL);
 		g_hash_table_destroy (image->name_cache);
 	}
+	if (image->name_case_cache)
+		g_hash_table_destroy (image->name_case_cache);
+	if (image->cattr_cache)
+		g_hash_table_destroy (image->cattr_cache);
+	for (i = 0; i < MONO_TABLE_NUM; ++i) {
+		if (image->sorted_table_index [i] && image->sorted_table_index [i] != REFERENCE_MISSING)
+			g_hash_table_destroy (image->sorted_table_index [i]);
+	}
 
 	free_hash (image->delegate_bound_static_invoke_cache);
 	free_hash (image->runtime_invoke_vcall_cache);
@@ -1852,6 +1877,8 @@ mono_image_close_except_pools (MonoImage *image)
 		g_free (image->image_info);
 	}
 
+	mono_metadata_free_decoded_rows (image);
+
 	for (i = 0; i < image->module_count; ++i) {
 		if (image->modules [i]) {
 			if (!mono_image_close_except_pools (image->modules [i]))
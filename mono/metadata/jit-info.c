@@ -59,6 +59,21 @@ static MonoJitInfoFindInAot jit_info_find_in_aot_func = NULL;
 #define JIT_INFO_TABLE_HAZARD_INDEX		0
 #define JIT_INFO_HAZARD_INDEX			1
 
+/*
+ * The lookup cache of a table is indexed by the code address shifted by
+ * JIT_INFO_CACHE_BLOCK_SHIFT. An entry holds the block number in its upper bits, then
+ * the chunk index, then the position inside the chunk. The block number is truncated
+ * on 32 bit platforms, and the chunk index might not fit, so entries are only hints
+ * which are verified before use. JIT_INFO_CACHE_POS_BITS has to be able to hold
+ * MONO_JIT_INFO_TABLE_CHUNK_SIZE - 1.
+ */
+#define JIT_INFO_CACHE_BLOCK_SHIFT		8
+#define JIT_INFO_CACHE_POS_BITS			6
+#define JIT_INFO_CACHE_CHUNK_BITS		14
+#define JIT_INFO_CACHE_TAG_SHIFT		(JIT_INFO_CACHE_POS_BITS + JIT_INFO_CACHE_CHUNK_BITS)
+#define JIT_INFO_CACHE_INDEX(addr)		(((gsize)(addr) >> JIT_INFO_CACHE_BLOCK_SHIFT) & (MONO_JIT_INFO_TABLE_CACHE_SIZE - 1))
+#define JIT_INFO_CACHE_TAG(addr)		(((gsize)(addr) >> JIT_INFO_CACHE_BLOCK_SHIFT) << JIT_INFO_CACHE_TAG_SHIFT)
+
 static int
 jit_info_table_num_elements (MonoJitInfoTable *table)
 {
@@ -208,12 +223,55 @@ jit_info_table_chunk_index (MonoJitInfoTableChunk *chunk, MonoThreadHazardPointe
 	return left;
 }
 
+/*
+ * jit_info_table_find_cached:
+ *
+ *   Look up ADDR using the lookup cache of TABLE. Profilers and stack walks look up the
+ * same few methods over and over, so this usually avoids both binary searches. The
+ * entries are written without any synchronization, possibly from signal handlers, so
+ * the hinted element is only returned if it is not a tombstone and it contains ADDR.
+ * Code ranges of live methods don't overlap, so it is the right answer then.
+ */
+static MonoJitInfo*
+jit_info_table_find_cached (MonoJitInfoTable *table, MonoThreadHazardPointers *hp, gint8 *addr)
+{
+	MonoJitInfoTableChunk *chunk;
+	MonoJitInfo *ji;
+	gsize entry;
+	int chunk_pos, pos;
+
+	entry = table->cache [JIT_INFO_CACHE_INDEX (addr)];
+	if ((entry >> JIT_INFO_CACHE_TAG_SHIFT) != (JIT_INFO_CACHE_TAG (addr) >> JIT_INFO_CACHE_TAG_SHIFT))
+		return NULL;
+
+	chunk_pos = (entry >> JIT_INFO_CACHE_POS_BITS) & ((1 << JIT_INFO_CACHE_CHUNK_BITS) - 1);
+	pos = entry & ((1 << JIT_INFO_CACHE_POS_BITS) - 1);
+	if (chunk_pos >= table->num_chunks)
+		return NULL;
+	chunk = table->chunks [chunk_pos];
+	if (pos >= chunk->num_elements)
+		return NULL;
+
+	ji = (MonoJitInfo *)mono_get_hazardous_pointer ((gpointer volatile*)&chunk->data [pos], hp, JIT_INFO_HAZARD_INDEX);
+	if (hp)
+		mono_hazard_pointer_clear (hp, JIT_INFO_HAZARD_INDEX);
+	if (!IS_JIT_INFO_TOMBSTONE (ji) && addr >= (gint8*)ji->code_start && addr < (gint8*)ji->code_start + ji->code_size)
+		return ji;
+	return NULL;
+}
+
 static MonoJitInfo*
 jit_info_table_find (MonoJitInfoTable *table, MonoThreadHazardPointers *hp, gint8 *addr)
 {
 	MonoJitInfo *ji;
 	int chunk_pos, pos;
 
+	ji = jit_info_table_find_cached (table, hp, addr);
+	if (ji) {
+		++mono_stats.jit_info_table_cache_hit_count;
+		return ji;
+	}
+
 	chunk_pos = jit_info_table_index (table, (gint8*)addr);
 	g_assert (chunk_pos < table->num_chunks);
 
@@ -239,6 +297,8 @@ jit_info_table_find (MonoJitInfoTable *table, MonoThreadHazardPointers *hp, gint
 			if ((gint8*)addr >= (gint8*)ji->code_start
 					&& (gint8*)addr < (gint8*)ji->code_start + ji->code_size) {
 				mono_hazard_pointer_clear (hp, JIT_INFO_HAZARD_INDEX);
+				if (chunk_pos < (1 << JIT_INFO_CACHE_CHUNK_BITS))
+					table->cache [JIT_INFO_CACHE_INDEX (addr)] = JIT_INFO_CACHE_TAG (addr) | (chunk_pos << JIT_INFO_CACHE_POS_BITS) | (pos - 1);
 				return ji;
 			}
 
@@ -394,7 +454,7 @@ jit_info_table_realloc (MonoJitInfoTable *old)
 	}
 	g_assert (num_chunks > 0);
 
-	result = (MonoJitInfoTable *)g_malloc (MONO_SIZEOF_JIT_INFO_TABLE + sizeof (MonoJitInfoTableChunk*) * num_chunks);
+	result = (MonoJitInfoTable *)g_malloc0 (MONO_SIZEOF_JIT_INFO_TABLE + sizeof (MonoJitInfoTableChunk*) * num_chunks);
 	result->domain = old->domain;
 	result->num_chunks = num_chunks;
 
@@ -463,7 +523,7 @@ jit_info_table_split_chunk (MonoJitInfoTableChunk *chunk, MonoJitInfoTableChunk
 static MonoJitInfoTable*
 jit_info_table_copy_and_split_chunk (MonoJitInfoTable *table, MonoJitInfoTableChunk *chunk)
 {
-	MonoJitInfoTable *new_table = (MonoJitInfoTable *)g_malloc (MONO_SIZEOF_JIT_INFO_TABLE
+	MonoJitInfoTable *new_table = (MonoJitInfoTable *)g_malloc0 (MONO_SIZEOF_JIT_INFO_TABLE
 		+ sizeof (MonoJitInfoTableChunk*) * (table->num_chunks + 1));
 	int i, j;
 
@@ -511,7 +571,7 @@ jit_info_table_purify_chunk (MonoJitInfoTableChunk *old)
 static MonoJitInfoTable*
 jit_info_table_copy_and_purify_chunk (MonoJitInfoTable *table, MonoJitInfoTableChunk *chunk)
 {
-	MonoJitInfoTable *new_table = (MonoJitInfoTable *)g_malloc (MONO_SIZEOF_JIT_INFO_TABLE
+	MonoJitInfoTable *new_table = (MonoJitInfoTable *)g_malloc0 (MONO_SIZEOF_JIT_INFO_TABLE
 		+ sizeof (MonoJitInfoTableChunk*) * table->num_chunks);
 	int i, j;
 
@@ -872,29 +932,17 @@ mono_jit_info_get_method (MonoJitInfo* ji)
 	return ji->d.method;
 }
 
-static gpointer
-jit_info_key_extract (gpointer value)
-{
-	MonoJitInfo *info = (MonoJitInfo*)value;
-
-	return info->d.method;
-}
-
-static gpointer*
-jit_info_next_value (gpointer value)
-{
-	MonoJitInfo *info = (MonoJitInfo*)value;
-
-	return (gpointer*)&info->n.next_jit_code_hash;
-}
-
-void
-mono_jit_code_hash_init (MonoInternalHashTable *jit_code_hash)
+/*
+ * mono_jit_code_hash_new:
+ *
+ *   Create the table mapping methods to their MonoJitInfo. Neither lookups nor
+ * modifications need any locks, so threads which create delegates, resolve ldftn
+ * targets or publish newly compiled methods at the same time don't serialize on it.
+ */
+MonoLockFreeHashTable*
+mono_jit_code_hash_new (void)
 {
-	mono_internal_hash_table_init (jit_code_hash,
-				       mono_aligned_addr_hash,
-				       jit_info_key_extract,
-				       jit_info_next_value);
+	return mono_lock_free_hashtable_new (mono_aligned_addr_hash, NULL);
 }
 
 MonoGenericJitInfo*
@@ -0,0 +1,507 @@
+/*
+ * lock-contention.c: Lock contention profiler
+ *
+ * When MONO_LOCK_CONTENTION=SECONDS[:FILE] is set, every contended acquisition
+ * of a monitor or of a runtime lock taken through the lock-tracer.h macros
+ * records how long the thread waited, which thread held the lock and where
+ * it was acquired from. The waits are aggregated per lock and call site into
+ * a histogram which is written to FILE (stderr by default) every SECONDS
+ * seconds and at shutdown.
+ *
+ * Monitor owners are exact. For runtime locks the owner is the last thread
+ * which acquired the lock, which is only a best effort guess since the table
+ * remembering it is shared between locks.
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_DLFCN_H
+#include <dlfcn.h>
+#endif
+
+#ifdef HAVE_EXECINFO_H
+#include <execinfo.h>
+#endif
+
+#include <mono/metadata/lock-contention.h>
+#include <mono/metadata/lock-tracer.h>
+#include <mono/metadata/class-internals.h>
+#include <mono/metadata/object-internals.h>
+#include <mono/metadata/debug-helpers.h>
+#include <mono/utils/mono-compiler.h>
+#include <mono/utils/mono-membar.h>
+#include <mono/utils/mono-os-semaphore.h>
+#include <mono/utils/mono-threads.h>
+#include <mono/utils/mono-time.h>
+
+/* Distinct (lock, call site) pairs, sites past this are only counted */
+#define CONTENTION_SITES 1024
+/* Wait time buckets: < 1us, then powers of two up to ~8s */
+#define CONTENTION_BUCKETS 24
+#define LOCK_OWNERS 256
+#define MONITOR_KIND -1
+
+typedef struct {
+	gint32 kind;
+	/* Native caller for runtime locks, method for monitors */
+	gpointer site;
+	/* Caller of site for runtime locks, class of the object for monitors */
+	gpointer caller;
+	char *name;
+	guint64 count;
+	/* In 100ns ticks */
+	guint64 total;
+	guint64 max;
+	gint32 last_owner;
+	guint32 histogram [CONTENTION_BUCKETS];
+} ContentionSite;
+
+typedef struct {
+	gpointer lock;
+	gint32 owner;
+} LockOwner;
+
+gboolean mono_lock_contention_enabled;
+
+static ContentionSite sites [CONTENTION_SITES];
+static gint32 dropped_count;
+static mono_mutex_t sites_mutex;
+static LockOwner lock_owners [LOCK_OWNERS];
+
+static FILE *dump_file;
+static int dump_interval;
+static gint64 start_time;
+static MonoSemType dumper_sem;
+static MonoNativeThreadId dumper_thread;
+static gboolean dumper_running;
+static volatile gboolean dumper_stop;
+
+static const char *lock_names [] = {
+	"InvalidLock",
+	"LoaderLock",
+	"ImageDataLock",
+	"DomainLock",
+	"DomainAssembliesLock",
+	"DomainJitCodeHashLock",
+	"IcallLock",
+	"AssemblyBindingLock",
+	"MarshalLock",
+	"ClassesLock",
+	"LoaderGlobalDataLock",
+	"ThreadsLock",
+	"JitLock",
+	"DomainsLock",
+};
+
+static const char*
+kind_name (gint32 kind)
+{
+	if (kind == MONITOR_KIND)
+		return "Monitor";
+	if (kind >= 0 && kind < (gint32) G_N_ELEMENTS (lock_names))
+		return lock_names [kind];
+	return "Unknown";
+}
+
+static guint32
+site_hash (gint32 kind, gpointer site, gpointer caller)
+{
+	return (guint32) (((gsize) site >> 3) * 31 + ((gsize) caller >> 3) * 17 + kind);
+}
+
+static ContentionSite*
+find_site (gint32 kind, gpointer site, gpointer caller, gboolean *full)
+{
+	guint32 i, start = site_hash (kind, site, caller) % CONTENTION_SITES;
+
+	*full = TRUE;
+	i = start;
+	do {
+		ContentionSite *s = &sites [i];
+
+		if (!s->name) {
+			*full = FALSE;
+			return NULL;
+		}
+		if (s->kind == kind && s->site == site && s->caller == caller)
+			return s;
+		i = (i + 1) % CONTENTION_SITES;
+	} while (i != start);
+
+	return NULL;
+}
+
+static ContentionSite*
+add_site (gint32 kind, gpointer site, gpointer caller, char *name)
+{
+	guint32 i = site_hash (kind, site, caller) % CONTENTION_SITES;
+
+	while (sites [i].name) {
+		if (sites [i].kind == kind && sites [i].site == site && sites [i].caller == caller) {
+			/* Another thread added it while we were computing the name */
+			g_free (name);
+			return &sites [i];
+		}
+		i = (i + 1) % CONTENTION_SITES;
+	}
+
+	sites [i].kind = kind;
+	sites [i].site = site;
+	sites [i].caller = caller;
+	sites [i].name = name;
+	return &sites [i];
+}
+
+static char*
+native_site_name (gpointer ip)
+{
+#ifdef HAVE_DLADDR
+	Dl_info di;
+
+	if (ip && dladdr (ip, &di) && di.dli_sname)
+		return g_strdup_printf ("%s+0x%x", di.dli_sname, (int) ((char *) ip - (char *) di.dli_saddr));
+#endif
+	return g_strdup_printf ("%p", ip);
+}
+
+static char*
+site_name (gint32 kind, gpointer site, gpointer caller)
+{
+	char *name, *caller_name, *res;
+
+	if (kind == MONITOR_KIND) {
+		/* Computed outside of sites_mutex since it can take runtime locks */
+		name = site ? mono_method_full_name ((MonoMethod *) site, TRUE) : g_strdup ("(unmanaged)");
+		res = g_strdup_printf ("%s.%s in %s", ((MonoClass *) caller)->name_space, ((MonoClass *) caller)->name, name);
+		g_free (name);
+		return res;
+	}
+
+	name = native_site_name (site);
+	if (!caller)
+		return name;
+	caller_name = native_site_name (caller);
+	res = g_strdup_printf ("%s from %s", name, caller_name);
+	g_free (name);
+	g_free (caller_name);
+	return res;
+}
+
+static int
+wait_bucket (guint64 wait)
+{
+	/* wait is in 100ns ticks, buckets are in microseconds */
+	guint64 us = wait / 10;
+	int bucket = 0;
+
+	while (us && bucket < CONTENTION_BUCKETS - 1) {
+		us >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+static void
+record_wait (gint32 kind, gpointer site, gpointer caller, guint64 wait, gint32 owner)
+{
+	ContentionSite *s;
+	gboolean full;
+	char *name;
+
+	mono_os_mutex_lock (&sites_mutex);
+	s = find_site (kind, site, caller, &full);
+	if (!s) {
+		if (full) {
+			dropped_count++;
+			mono_os_mutex_unlock (&sites_mutex);
+			return;
+		}
+		mono_os_mutex_unlock (&sites_mutex);
+		name = site_name (kind, site, caller);
+		mono_os_mutex_lock (&sites_mutex);
+		s = find_site (kind, site, caller, &full);
+		if (!s && full) {
+			dropped_count++;
+			mono_os_mutex_unlock (&sites_mutex);
+			g_free (name);
+			return;
+		}
+		if (!s)
+			s = add_site (kind, site, caller, name);
+		else
+			g_free (name);
+	}
+
+	s->count++;
+	s->total += wait;
+	if (wait > s->max)
+		s->max = wait;
+	s->last_owner = owner;
+	s->histogram [wait_bucket (wait)]++;
+	mono_os_mutex_unlock (&sites_mutex);
+}
+
+static LockOwner*
+lock_owner (gpointer lock)
+{
+	return &lock_owners [((gsize) lock >> 4) % LOCK_OWNERS];
+}
+
+static gint32
+get_owner (gpointer lock)
+{
+	LockOwner *o = lock_owner (lock);
+	gint32 owner = o->owner;
+
+	return o->lock == lock ? owner : -1;
+}
+
+static void
+set_owner (gpointer lock)
+{
+	LockOwner *o = lock_owner (lock);
+
+	o->owner = mono_thread_info_get_small_id ();
+	o->lock = lock;
+}
+
+/*
+ * The call sites of a runtime lock: the function the acquire macro was
+ * expanded in, and its caller, since that's often a mono_foo_lock () wrapper.
+ */
+static MONO_NEVER_INLINE void
+get_call_sites (gpointer *site, gpointer *caller)
+{
+#ifdef HAVE_EXECINFO_H
+	gpointer frames [4];
+	int n = backtrace (frames, G_N_ELEMENTS (frames));
+
+	/* frames [0] is us, frames [1] mono_lock_contention_*_acquire () */
+	*site = n > 2 ? frames [2] : NULL;
+	*caller = n > 3 ? frames [3] : NULL;
+#elif defined(__GNUC__)
+	*site = __builtin_return_address (1);
+	*caller = NULL;
+#else
+	*site = NULL;
+	*caller = NULL;
+#endif
+}
+
+void
+mono_lock_contention_os_acquire (mono_mutex_t *lock, RuntimeLocks kind)
+{
+	gpointer site, caller;
+	gint64 start;
+	gint32 owner;
+
+	if (mono_os_mutex_trylock (lock) != 0) {
+		owner = get_owner (lock);
+		start = mono_100ns_ticks ();
+		mono_os_mutex_lock (lock);
+		get_call_sites (&site, &caller);
+		record_wait (kind, site, caller, mono_100ns_ticks () - start, owner);
+	}
+	set_owner (lock);
+}
+
+void
+mono_lock_contention_coop_acquire (MonoCoopMutex *lock, RuntimeLocks kind)
+{
+	gpointer site, caller;
+	gint64 start;
+	gint32 owner;
+
+	if (mono_coop_mutex_trylock (lock) != 0) {
+		owner = get_owner (lock);
+		start = mono_100ns_ticks ();
+		mono_coop_mutex_lock (lock);
+		get_call_sites (&site, &caller);
+		record_wait (kind, site, caller, mono_100ns_ticks () - start, owner);
+	}
+	set_owner (lock);
+}
+
+static gboolean
+find_monitor_caller (MonoMethod *method, gint32 native_offset, gint32 il_offset, gboolean managed, gpointer data)
+{
+	MonoMethod **dest = (MonoMethod **) data;
+
+	if (method->wrapper_type != MONO_WRAPPER_NONE || method->klass == mono_defaults.monitor_class)
+		return FALSE;
+	*dest = method;
+	return TRUE;
+}
+
+/**
+ * mono_lock_contention_monitor:
+ *
+ *   Record a contended acquisition of the monitor of @obj, which started
+ * waiting at @start (in 100ns ticks) while it was held by the thread with
+ * small id @owner.
+ */
+void
+mono_lock_contention_monitor (MonoObject *obj, gint64 start, gint32 owner)
+{
+	guint64 wait = mono_100ns_ticks () - start;
+	MonoMethod *method = NULL;
+
+	mono_stack_walk_no_il (find_monitor_caller, &method);
+	record_wait (MONITOR_KIND, method, mono_object_class (obj), wait, owner);
+}
+
+static int
+compare_sites (const void *a, const void *b)
+{
+	const ContentionSite *sa = *(const ContentionSite **) a;
+	const ContentionSite *sb = *(const ContentionSite **) b;
+
+	if (sa->total == sb->total)
+		return 0;
+	return sa->total < sb->total ? 1 : -1;
+}
+
+static void
+dump_histogram (FILE *f, ContentionSite *s)
+{
+	int i;
+
+	fprintf (f, "\t\twaits:");
+	for (i = 0; i < CONTENTION_BUCKETS; ++i) {
+		if (!s->histogram [i])
+			continue;
+		if (i == 0)
+			fprintf (f, " <1us:%u", s->histogram [i]);
+		else if (i == CONTENTION_BUCKETS - 1)
+			fprintf (f, " >=%uus:%u", 1u << (i - 1), s->histogram [i]);
+		else
+			fprintf (f, " %u-%uus:%u", 1u << (i - 1), 1u << i, s->histogram [i]);
+	}
+	fprintf (f, "\n");
+}
+
+/**
+ * mono_lock_contention_dump:
+ *
+ *   Write the contention collected since startup, the sites which waited
+ * the longest first.
+ */
+void
+mono_lock_contention_dump (void)
+{
+	ContentionSite **sorted;
+	ContentionSite *s;
+	FILE *f = dump_file ? dump_file : stderr;
+	int i, count = 0;
+
+	if (!mono_lock_contention_enabled)
+		return;
+
+	sorted = g_new (ContentionSite*, CONTENTION_SITES);
+
+	mono_os_mutex_lock (&sites_mutex);
+	for (i = 0; i < CONTENTION_SITES; ++i) {
+		if (sites [i].name && sites [i].count)
+			sorted [count++] = &sites [i];
+	}
+	qsort (sorted, count, sizeof (ContentionSite*), compare_sites);
+
+	fprintf (f, "Lock contention after %.3f secs:\n", (mono_100ns_ticks () - start_time) / 10000000.0);
+	for (i = 0; i < count; ++i) {
+		s = sorted [i];
+		fprintf (f, "\t%s at %s\n", kind_name (s->kind), s->name);
+		fprintf (f, "\t\tcount: %llu, total: %.3f ms, max: %.3f ms, last owner: %d\n",
+			(unsigned long long) s->count, s->total / 10000.0, s->max / 10000.0, s->last_owner);
+		dump_histogram (f, s);
+	}
+	if (dropped_count)
+		fprintf (f, "\t%d waits at untracked sites were dropped\n", dropped_count);
+	fflush (f);
+	mono_os_mutex_unlock (&sites_mutex);
+
+	g_free (sorted);
+}
+
+static void*
+dumper_thread_func (void *arg)
+{
+	mono_native_thread_set_name (mono_native_thread_id_get (), "Lock contention dumper");
+
+	while (!dumper_stop) {
+		if (mono_os_sem_timedwait (&dumper_sem, dump_interval * 1000, MONO_SEM_FLAGS_NONE) == MONO_SEM_TIMEDWAIT_RET_TIMEDOUT)
+			mono_lock_contention_dump ();
+	}
+
+	return NULL;
+}
+
+/**
+ * mono_lock_contention_init:
+ *
+ *   Enable the contention profiler if MONO_LOCK_CONTENTION is set.
+ */
+void
+mono_lock_contention_init (void)
+{
+	const char *env = g_getenv ("MONO_LOCK_CONTENTION");
+	char *end;
+
+	if (!env)
+		return;
+
+	dump_interval = strtol (env, &end, 10);
+	if (dump_interval <= 0)
+		dump_interval = 10;
+	if (*end == ':' && end [1]) {
+		dump_file = fopen (end + 1, "w");
+		if (!dump_file)
+			g_warning ("Could not open lock contention file '%s'", end + 1);
+	}
+
+	mono_os_mutex_init (&sites_mutex);
+	mono_os_sem_init (&dumper_sem, 0);
+	start_time = mono_100ns_ticks ();
+#ifdef HAVE_EXECINFO_H
+	{
+		/* The first call can allocate while loading the unwinder, do it now */
+		gpointer frames [1];
+		backtrace (frames, 1);
+	}
+#endif
+
+	mono_memory_barrier ();
+	mono_lock_contention_enabled = TRUE;
+
+	dumper_stop = FALSE;
+	dumper_running = mono_native_thread_create (&dumper_thread, dumper_thread_func, NULL);
+}
+
+/**
+ * mono_lock_contention_cleanup:
+ *
+ *   Stop the dumper thread and write the final results.
+ */
+void
+mono_lock_contention_cleanup (void)
+{
+	if (!mono_lock_contention_enabled)
+		return;
+
+	if (dumper_running) {
+		dumper_stop = TRUE;
+		mono_os_sem_post (&dumper_sem);
+		mono_native_thread_join (dumper_thread);
+		dumper_running = FALSE;
+	}
+
+	mono_lock_contention_dump ();
+	if (dump_file) {
+		fclose (dump_file);
+		dump_file = NULL;
+	}
+}
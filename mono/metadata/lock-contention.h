@@ -0,0 +1,30 @@
+/*
+ * lock-contention.h: Lock contention profiler
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#ifndef __MONO_METADATA_LOCK_CONTENTION_H__
+#define __MONO_METADATA_LOCK_CONTENTION_H__
+
+/*This is a private header*/
+#include <glib.h>
+#include <mono/metadata/object.h>
+
+G_BEGIN_DECLS
+
+void
+mono_lock_contention_init (void);
+
+void
+mono_lock_contention_cleanup (void);
+
+void
+mono_lock_contention_dump (void);
+
+void
+mono_lock_contention_monitor (MonoObject *obj, gint64 start, gint32 owner);
+
+G_END_DECLS
+
+#endif /* __MONO_METADATA_LOCK_CONTENTION_H__ */
@@ -35,6 +35,7 @@
  *  - change mono_coop_mutex_lock(mutex) to mono_locks_coop_acquire (mutex, LockName)
  *  - change mono_coop_mutex_unlock(mutex) to mono_locks_coop_release (mutex, LockName)
  *  - change the decoder to understand the new lock kind.
+ *  - add its name to lock_names in lock-contention.c
  *
  * TODO:
  * 	- Use unbuffered IO without fsync
@@ -22,6 +22,9 @@ typedef enum {
 	ClassesLock,
 	LoaderGlobalDataLock,
 	ThreadsLock,
+	JitLock,
+	DomainsLock,
+	NumRuntimeLocks
 } RuntimeLocks;
 
 #ifdef LOCK_TRACER
@@ -40,9 +43,18 @@ void mono_locks_lock_released (RuntimeLocks kind, gpointer lock);
 
 #endif
 
+/* Set by MONO_LOCK_CONTENTION, see lock-contention.c */
+extern gboolean mono_lock_contention_enabled;
+
+void mono_lock_contention_os_acquire (mono_mutex_t *lock, RuntimeLocks kind);
+void mono_lock_contention_coop_acquire (MonoCoopMutex *lock, RuntimeLocks kind);
+
 #define mono_locks_os_acquire(LOCK,NAME)	\
 	do {	\
-		mono_os_mutex_lock (LOCK);	\
+		if (G_UNLIKELY (mono_lock_contention_enabled))	\
+			mono_lock_contention_os_acquire (LOCK, NAME);	\
+		else	\
+			mono_os_mutex_lock (LOCK);	\
 		mono_locks_lock_acquired (NAME, LOCK);	\
 	} while (0)
 
@@ -54,7 +66,10 @@ void mono_locks_lock_released (RuntimeLocks kind, gpointer lock);
 
 #define mono_locks_coop_acquire(LOCK,NAME)	\
 	do {	\
-		mono_coop_mutex_lock (LOCK);	\
+		if (G_UNLIKELY (mono_lock_contention_enabled))	\
+			mono_lock_contention_coop_acquire (LOCK, NAME);	\
+		else	\
+			mono_coop_mutex_lock (LOCK);	\
 		mono_locks_lock_acquired (NAME, LOCK);	\
 	} while (0)
 
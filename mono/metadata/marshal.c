@@ -63,6 +63,12 @@ enum {
 };
 #undef OPDEF
 
+/* Strings shorter than this are marshalled into a buffer on the stack of pinvoke wrappers */
+#define STACK_STRING_MAX_LEN 256
+
+/* Multicast delegate invoke wrappers call up to this many targets without looping */
+#define MULTICAST_INVOKE_UNROLL 4
+
 /* 
  * This mutex protects the various marshalling related caches in MonoImage
  * and a few other data structures static to this file.
@@ -109,6 +115,9 @@ mono_marshal_string_to_utf16_copy (MonoString *s);
 static gpointer
 mono_string_to_lpstr (MonoString *string_obj);
 
+static gpointer
+mono_string_to_lpstr_buf (MonoString *string_obj, char *buf, int size);
+
 static MonoStringBuilder *
 mono_string_utf8_to_builder2 (char *text);
 
@@ -215,6 +224,8 @@ static GENERATE_GET_CLASS_WITH_CACHE (string_builder, System.Text, StringBuilder
 static GENERATE_GET_CLASS_WITH_CACHE (date_time, System, DateTime)
 static GENERATE_TRY_GET_CLASS_WITH_CACHE (unmanaged_function_pointer_attribute, System.Runtime.InteropServices, UnmanagedFunctionPointerAttribute)
 static GENERATE_TRY_GET_CLASS_WITH_CACHE (icustom_marshaler, System.Runtime.InteropServices, ICustomMarshaler)
+static GENERATE_GET_CLASS_WITH_CACHE (activator, System, Activator)
+static GENERATE_GET_CLASS_WITH_CACHE (target_invocation_exception, System.Reflection, TargetInvocationException)
 
 /* MonoMethod pointers to SafeHandle::DangerousAddRef and ::DangerousRelease */
 static MonoMethod *sh_dangerous_add_ref;
@@ -304,6 +315,7 @@ mono_marshal_init (void)
 		register_icall (mono_string_new_len_wrapper, "mono_string_new_len_wrapper", "obj ptr int", FALSE);
 		register_icall (ves_icall_mono_string_to_utf8, "ves_icall_mono_string_to_utf8", "ptr obj", FALSE);
 		register_icall (mono_string_to_lpstr, "mono_string_to_lpstr", "ptr obj", FALSE);
+		register_icall (mono_string_to_lpstr_buf, "mono_string_to_lpstr_buf", "ptr obj ptr int32", FALSE);
 		register_icall (mono_string_to_ansibstr, "mono_string_to_ansibstr", "ptr object", FALSE);
 		register_icall (mono_string_builder_to_utf8, "mono_string_builder_to_utf8", "ptr object", FALSE);
 		register_icall (mono_string_builder_to_utf16, "mono_string_builder_to_utf16", "ptr object", FALSE);
@@ -348,6 +360,7 @@ mono_marshal_init (void)
 		register_icall (mono_icall_start, "mono_icall_start", "ptr ptr ptr", TRUE);
 		register_icall (mono_icall_end, "mono_icall_end", "void ptr ptr ptr", TRUE);
 		register_icall (mono_handle_new, "mono_handle_new", "ptr ptr", TRUE);
+		register_icall (mono_string_hash, "mono_string_hash", "int32 obj", TRUE);
 
 		mono_cominterop_init ();
 		mono_remoting_init ();
@@ -1113,6 +1126,47 @@ mono_string_to_lpstr (MonoString *s)
 #endif
 }	
 
+/*
+ * mono_string_to_lpstr_buf:
+ *
+ *   Same as mono_string_to_lpstr (), but convert S into BUF, which has room for SIZE
+ * bytes. SIZE should be at least 3 * length + 1, the maximum UTF-8 size of S.
+ * This is a JIT icall, it sets the pending exception and returns NULL on error.
+ */
+static gpointer
+mono_string_to_lpstr_buf (MonoString *s, char *buf, int size)
+{
+	gunichar2 *chars = mono_string_chars (s);
+	int i, len = mono_string_length (s);
+	GError *gerror = NULL;
+	glong written;
+	char *tmp;
+
+	g_assert (size > len * 3);
+
+	/* Fast path for ASCII strings without embedded NULs */
+	for (i = 0; i < len; ++i) {
+		if (chars [i] >= 0x80 || chars [i] == 0)
+			break;
+		buf [i] = (char) chars [i];
+	}
+	if (i == len) {
+		buf [len] = '\0';
+		return buf;
+	}
+
+	tmp = g_utf16_to_utf8 (chars, len, NULL, &written, &gerror);
+	if (gerror) {
+		mono_set_pending_exception (mono_get_exception_argument ("string", gerror->message));
+		g_error_free (gerror);
+		return NULL;
+	}
+	g_assert (written < size);
+	memcpy (buf, tmp, written + 1);
+	g_free (tmp);
+	return buf;
+}
+
 gpointer
 mono_string_to_ansibstr (MonoString *string_obj)
 {
@@ -3268,8 +3322,9 @@ mono_marshal_get_delegate_invoke_internal (MonoMethod *method, gboolean callvirt
 	SignaturePointerPair key;
 	SignaturePointerPair *new_key;
 	int local_i, local_len, local_delegates, local_d, local_target, local_res;
-	int pos0, pos1, pos2;
+	int pos0, pos1, pos2, pos3, n, j;
 	char *name;
+	MonoMethod *multicast_invoke;
 	MonoClass *target_class = NULL;
 	gboolean closed_over_null = FALSE;
 	MonoGenericContext *ctx = NULL;
@@ -3517,12 +3572,50 @@ mono_marshal_get_delegate_invoke_internal (MonoMethod *method, gboolean callvirt
 	/* else [delegates != null] */
 	mono_mb_patch_branch (mb, pos2);
 
+	if (!ctx) {
+		multicast_invoke = method;
+	} else {
+		MonoError error;
+		multicast_invoke = mono_class_inflate_generic_method_checked (method, &container->context, &error);
+		g_assert (mono_error_ok (&error)); /* FIXME don't swallow the error */
+	}
+
 	/* len = delegates.Length; */
 	mono_mb_emit_ldloc (mb, local_delegates);
 	mono_mb_emit_byte (mb, CEE_LDLEN);
 	mono_mb_emit_byte (mb, CEE_CONV_I4);
 	mono_mb_emit_stloc (mb, local_len);
 
+	/*
+	 * Most multicast delegates, like event handlers, only have a few targets,
+	 * which are called without the loop below:
+	 *
+	 * if (len == 2) {
+	 *     this.delegates [0].Invoke ( args .. );
+	 *     return this.delegates [1].Invoke ( args .. );
+	 * }
+	 * if (len == 3) ...
+	 */
+	for (n = 2; n <= MULTICAST_INVOKE_UNROLL; ++n) {
+		mono_mb_emit_ldloc (mb, local_len);
+		mono_mb_emit_icon (mb, n);
+		pos3 = mono_mb_emit_branch (mb, CEE_BNE_UN);
+
+		for (j = 0; j < n; ++j) {
+			mono_mb_emit_ldloc (mb, local_delegates);
+			mono_mb_emit_icon (mb, j);
+			mono_mb_emit_byte (mb, CEE_LDELEM_REF);
+			for (i = 0; i < sig->param_count; i++)
+				mono_mb_emit_ldarg (mb, i + 1);
+			mono_mb_emit_op (mb, CEE_CALLVIRT, multicast_invoke);
+			if (!void_ret && j < n - 1)
+				mono_mb_emit_byte (mb, CEE_POP);
+		}
+		mono_mb_emit_byte (mb, CEE_RET);
+
+		mono_mb_patch_branch (mb, pos3);
+	}
+
 	/* i = 0; */
 	mono_mb_emit_icon (mb, 0);
 	mono_mb_emit_stloc (mb, local_i);
@@ -3539,13 +3632,7 @@ mono_marshal_get_delegate_invoke_internal (MonoMethod *method, gboolean callvirt
 	mono_mb_emit_ldloc (mb, local_d);
 	for (i = 0; i < sig->param_count; i++)
 		mono_mb_emit_ldarg (mb, i + 1);
-	if (!ctx) {
-		mono_mb_emit_op (mb, CEE_CALLVIRT, method);
-	} else {
-		MonoError error;
-		mono_mb_emit_op (mb, CEE_CALLVIRT, mono_class_inflate_generic_method_checked (method, &container->context, &error));
-		g_assert (mono_error_ok (&error)); /* FIXME don't swallow the error */
-	}
+	mono_mb_emit_op (mb, CEE_CALLVIRT, multicast_invoke);
 	if (!void_ret)
 		mono_mb_emit_stloc (mb, local_res);
 
@@ -5199,6 +5286,7 @@ emit_marshal_string (EmitMarshalContext *m, int argnum, MonoType *t,
 	MonoMethodBuilder *mb = m->mb;
 	MonoMarshalNative encoding = mono_marshal_get_string_encoding (m->piinfo, spec);
 	MonoMarshalConv conv = mono_marshal_get_string_to_ptr_conv (m->piinfo, spec);
+	gboolean stack_buf = !t->byref && conv == MONO_MARSHAL_CONV_STR_LPSTR;
 	gboolean need_free;
 
 	switch (action) {
@@ -5206,6 +5294,66 @@ emit_marshal_string (EmitMarshalContext *m, int argnum, MonoType *t,
 		*conv_arg_type = &mono_defaults.int_class->byval_arg;
 		conv_arg = mono_mb_add_local (mb, &mono_defaults.int_class->byval_arg);
 
+		if (stack_buf) {
+			int len_var, buf_var, pos_null, pos_heap, pos_done;
+
+			/*
+			 * The native string only needs to live during the call, so convert short
+			 * strings into a buffer allocated on the stack of the wrapper:
+			 *
+			 * if (s != null) {
+			 *   if (s.Length < STACK_STRING_MAX_LEN)
+			 *     conv_arg = mono_string_to_lpstr_buf (s, localloc (s.Length * 3 + 1), s.Length * 3 + 1);
+			 *   else
+			 *     conv_arg = mono_string_to_lpstr (s);
+			 * }
+			 * The buffer is stored in orig_conv_args so CONV_OUT knows not to free it.
+			 */
+			len_var = mono_mb_add_local (mb, &mono_defaults.int32_class->byval_arg);
+			buf_var = mono_mb_add_local (mb, &mono_defaults.int_class->byval_arg);
+			m->orig_conv_args [argnum] = buf_var;
+
+			mono_mb_emit_ldarg (mb, argnum);
+			pos_null = mono_mb_emit_branch (mb, CEE_BRFALSE);
+
+			mono_mb_emit_ldarg (mb, argnum);
+			mono_mb_emit_ldflda (mb, MONO_STRUCT_OFFSET (MonoString, length));
+			mono_mb_emit_byte (mb, CEE_LDIND_I4);
+			mono_mb_emit_stloc (mb, len_var);
+
+			mono_mb_emit_ldloc (mb, len_var);
+			mono_mb_emit_icon (mb, STACK_STRING_MAX_LEN);
+			pos_heap = mono_mb_emit_branch (mb, CEE_BGE_UN);
+
+			mono_mb_emit_ldloc (mb, len_var);
+			mono_mb_emit_icon (mb, 3);
+			mono_mb_emit_byte (mb, CEE_MUL);
+			mono_mb_emit_byte (mb, CEE_LDC_I4_1);
+			mono_mb_emit_byte (mb, CEE_ADD);
+			mono_mb_emit_stloc (mb, len_var);
+
+			mono_mb_emit_ldloc (mb, len_var);
+			mono_mb_emit_byte (mb, CEE_PREFIX1);
+			mono_mb_emit_byte (mb, CEE_LOCALLOC);
+			mono_mb_emit_stloc (mb, buf_var);
+
+			mono_mb_emit_ldarg (mb, argnum);
+			mono_mb_emit_ldloc (mb, buf_var);
+			mono_mb_emit_ldloc (mb, len_var);
+			mono_mb_emit_icall (mb, mono_string_to_lpstr_buf);
+			mono_mb_emit_stloc (mb, conv_arg);
+			pos_done = mono_mb_emit_branch (mb, CEE_BR);
+
+			mono_mb_patch_branch (mb, pos_heap);
+			mono_mb_emit_ldarg (mb, argnum);
+			mono_mb_emit_icall (mb, conv_to_icall (conv, NULL));
+			mono_mb_emit_stloc (mb, conv_arg);
+
+			mono_mb_patch_branch (mb, pos_null);
+			mono_mb_patch_branch (mb, pos_done);
+			break;
+		}
+
 		if (t->byref) {
 			if (t->attrs & PARAM_ATTRIBUTE_OUT)
 				break;
@@ -5269,7 +5417,17 @@ emit_marshal_string (EmitMarshalContext *m, int argnum, MonoType *t,
 			need_free = TRUE;
 		}
 
-		if (need_free) {
+		if (need_free && stack_buf) {
+			int pos;
+
+			/* Only free strings which didn't fit into the stack buffer */
+			mono_mb_emit_ldloc (mb, conv_arg);
+			mono_mb_emit_ldloc (mb, m->orig_conv_args [argnum]);
+			pos = mono_mb_emit_branch (mb, CEE_BEQ);
+			mono_mb_emit_ldloc (mb, conv_arg);
+			mono_mb_emit_icall (mb, mono_marshal_free);
+			mono_mb_patch_branch (mb, pos);
+		} else if (need_free) {
 			mono_mb_emit_ldloc (mb, conv_arg);
 			if (conv == MONO_MARSHAL_CONV_BSTR_STR)
 				mono_mb_emit_icall (mb, mono_free_bstr);
@@ -7336,6 +7494,9 @@ emit_marshal (EmitMarshalContext *m, int argnum, MonoType *t,
 }
 
 #ifndef DISABLE_JIT
+static void
+emit_native_wrapper_full (MonoImage *image, MonoMethodBuilder *mb, MonoMethodSignature *sig, MonoMethodPInvoke *piinfo, MonoMarshalSpec **mspecs, gpointer func, gboolean aot, gboolean check_exceptions, gboolean func_param, gboolean skip_gc_transition);
+
 /**
  * mono_marshal_emit_native_wrapper:
  * @image: the image to use for looking up custom marshallers
@@ -7351,6 +7512,18 @@ emit_marshal (EmitMarshalContext *m, int argnum, MonoType *t,
  */
 void
 mono_marshal_emit_native_wrapper (MonoImage *image, MonoMethodBuilder *mb, MonoMethodSignature *sig, MonoMethodPInvoke *piinfo, MonoMarshalSpec **mspecs, gpointer func, gboolean aot, gboolean check_exceptions, gboolean func_param)
+{
+	emit_native_wrapper_full (image, mb, sig, piinfo, mspecs, func, aot, check_exceptions, func_param, FALSE);
+}
+
+/*
+ * emit_native_wrapper_full:
+ *
+ *   Same as mono_marshal_emit_native_wrapper (), but if @skip_gc_transition is
+ * TRUE, the native call is made without switching to GC safe mode.
+ */
+static void
+emit_native_wrapper_full (MonoImage *image, MonoMethodBuilder *mb, MonoMethodSignature *sig, MonoMethodPInvoke *piinfo, MonoMarshalSpec **mspecs, gpointer func, gboolean aot, gboolean check_exceptions, gboolean func_param, gboolean skip_gc_transition)
 {
 	EmitMarshalContext m;
 	MonoMethodSignature *csig;
@@ -7358,6 +7531,7 @@ mono_marshal_emit_native_wrapper (MonoImage *image, MonoMethodBuilder *mb, MonoM
 	int i, argnum, *tmp_locals;
 	int type, param_shift = 0;
 	int coop_gc_stack_dummy, coop_gc_var;
+	gboolean gc_transition = mono_threads_is_coop_enabled () && !skip_gc_transition;
 
 	memset (&m, 0, sizeof (m));
 	m.mb = mb;
@@ -7395,7 +7569,7 @@ mono_marshal_emit_native_wrapper (MonoImage *image, MonoMethodBuilder *mb, MonoM
 		mono_mb_add_local (mb, sig->ret);
 	}
 
-	if (mono_threads_is_coop_enabled ()) {
+	if (gc_transition) {
 		/* local 4, dummy local used to get a stack address for suspend funcs */
 		coop_gc_stack_dummy = mono_mb_add_local (mb, &mono_defaults.int_class->byval_arg);
 		/* local 5, the local to be used when calling the suspend funcs */
@@ -7436,7 +7610,7 @@ mono_marshal_emit_native_wrapper (MonoImage *image, MonoMethodBuilder *mb, MonoM
 	}
 
 	// In coop mode need to register blocking state during native call
-	if (mono_threads_is_coop_enabled ()) {
+	if (gc_transition) {
 		// Perform an extra, early lookup of the function address, so any exceptions
 		// potentially resulting from the lookup occur before entering blocking mode.
 		if (!func_param && !MONO_CLASS_IS_IMPORT (mb->method->klass) && aot) {
@@ -7521,7 +7695,7 @@ mono_marshal_emit_native_wrapper (MonoImage *image, MonoMethodBuilder *mb, MonoM
 	}
 
 	/* Unblock before converting the result, since that can involve calls into the runtime */
-	if (mono_threads_is_coop_enabled ()) {
+	if (gc_transition) {
 		mono_mb_emit_ldloc (mb, coop_gc_var);
 		mono_mb_emit_ldloc_addr (mb, coop_gc_stack_dummy);
 		mono_mb_emit_icall (mb, mono_threads_exit_gc_safe_region_unbalanced);
@@ -7621,6 +7795,126 @@ mono_marshal_emit_native_wrapper (MonoImage *image, MonoMethodBuilder *mb, MonoM
 }
 #endif /* DISABLE_JIT */
 
+static gboolean
+is_primitive_native_type (MonoType *t)
+{
+	if (t->byref)
+		return FALSE;
+
+	switch (t->type) {
+	case MONO_TYPE_I1:
+	case MONO_TYPE_U1:
+	case MONO_TYPE_I2:
+	case MONO_TYPE_U2:
+	case MONO_TYPE_I4:
+	case MONO_TYPE_U4:
+	case MONO_TYPE_I8:
+	case MONO_TYPE_U8:
+	case MONO_TYPE_I:
+	case MONO_TYPE_U:
+	case MONO_TYPE_R4:
+	case MONO_TYPE_R8:
+	case MONO_TYPE_PTR:
+	case MONO_TYPE_FNPTR:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+/*
+ * pinvoke_needs_no_marshalling:
+ *
+ *   Returns whenever the pinvoke wrapper of METHOD reduces to passing its arguments
+ * unchanged to the native function, i.e. its signature only contains blittable
+ * primitive types and it doesn't need SetLastError or marshalling directives.
+ */
+static gboolean
+pinvoke_needs_no_marshalling (MonoMethod *method)
+{
+	MonoMethodPInvoke *piinfo = (MonoMethodPInvoke *) method;
+	MonoMethodSignature *sig;
+	MonoMarshalSpec **mspecs;
+	gboolean res;
+	int i;
+
+	if (!(method->flags & METHOD_ATTRIBUTE_PINVOKE_IMPL) || (method->iflags & METHOD_IMPL_ATTRIBUTE_INTERNAL_CALL))
+		return FALSE;
+	if (MONO_CLASS_IS_IMPORT (method->klass) || (piinfo->piflags & PINVOKE_ATTRIBUTE_SUPPORTS_LAST_ERROR))
+		return FALSE;
+
+	sig = mono_method_signature (method);
+	if (!sig || sig->hasthis)
+		return FALSE;
+	if (!MONO_TYPE_IS_VOID (sig->ret) && !is_primitive_native_type (sig->ret))
+		return FALSE;
+	for (i = 0; i < sig->param_count; ++i) {
+		if (!is_primitive_native_type (sig->params [i]))
+			return FALSE;
+	}
+
+	/* Marshalling directives can turn primitive types into conversions */
+	res = TRUE;
+	mspecs = g_new0 (MonoMarshalSpec*, sig->param_count + 1);
+	mono_method_get_marshal_info (method, mspecs);
+	for (i = sig->param_count; i >= 0; i--) {
+		if (mspecs [i]) {
+			res = FALSE;
+			mono_metadata_free_marshal_spec (mspecs [i]);
+		}
+	}
+	g_free (mspecs);
+
+	return res;
+}
+
+/**
+ * mono_marshal_method_suppresses_gc_transition:
+ * @method: a pinvoke method
+ *
+ *   Returns whenever calls to @method can skip the GC safe transition and the
+ * interrupt checkpoint done by the pinvoke wrapper. This is the case for methods
+ * with a SuppressGCTransitionAttribute whose signature only contains blittable
+ * primitive types, so the wrapper reduces to a plain native call.
+ */
+gboolean
+mono_marshal_method_suppresses_gc_transition (MonoMethod *method)
+{
+	MonoCustomAttrInfo *cinfo;
+	MonoError error;
+	gboolean res;
+	int i;
+
+	if (!pinvoke_needs_no_marshalling (method))
+		return FALSE;
+
+	/*
+	 * The attribute is not part of our corlib, so match it by name, user code
+	 * can define its own copy.
+	 */
+	res = FALSE;
+	cinfo = mono_custom_attrs_from_method_checked (method, &error);
+	if (!mono_error_ok (&error)) {
+		mono_error_cleanup (&error);
+		return FALSE;
+	}
+	if (cinfo) {
+		for (i = 0; i < cinfo->num_attrs; ++i) {
+			MonoClass *attr_klass = cinfo->attrs [i].ctor ? cinfo->attrs [i].ctor->klass : NULL;
+
+			if (attr_klass && !strcmp (attr_klass->name, "SuppressGCTransitionAttribute") &&
+				!strcmp (attr_klass->name_space, "System.Runtime.InteropServices")) {
+				res = TRUE;
+				break;
+			}
+		}
+		if (!cinfo->cached)
+			mono_custom_attrs_free (cinfo);
+	}
+
+	return res;
+}
+
 /**
  * mono_marshal_get_native_wrapper:
  * @method: The MonoMethod to wrap.
@@ -7639,6 +7933,7 @@ mono_marshal_get_native_wrapper (MonoMethod *method, gboolean check_exceptions,
 	MonoMethod *res;
 	GHashTable *cache;
 	gboolean pinvoke = FALSE;
+	gboolean suppress_gc_transition;
 	gpointer iter;
 	int i;
 	const char *exc_class = "MissingMethodException";
@@ -7745,7 +8040,13 @@ mono_marshal_get_native_wrapper (MonoMethod *method, gboolean check_exceptions,
 
 	mb = mono_mb_new (method->klass, method->name, MONO_WRAPPER_MANAGED_TO_NATIVE);
 
-	mb->method->save_lmf = 1;
+	/*
+	 * Calls which don't leave GC unsafe mode can't be interrupted or call back
+	 * into managed code, so they don't need an LMF either.
+	 */
+	suppress_gc_transition = pinvoke && (piinfo->addr || aot) && mono_marshal_method_suppresses_gc_transition (method);
+	if (!suppress_gc_transition)
+		mb->method->save_lmf = 1;
 
 	/*
 	 * In AOT mode and embedding scenarios, it is possible that the icall is not
@@ -7909,7 +8210,10 @@ mono_marshal_get_native_wrapper (MonoMethod *method, gboolean check_exceptions,
 	mspecs = g_new (MonoMarshalSpec*, sig->param_count + 1);
 	mono_method_get_marshal_info (method, mspecs);
 
-	mono_marshal_emit_native_wrapper (mb->method->klass->image, mb, sig, piinfo, mspecs, piinfo->addr, aot, check_exceptions, FALSE);
+	if (suppress_gc_transition)
+		emit_native_wrapper_full (mb->method->klass->image, mb, sig, piinfo, mspecs, piinfo->addr, aot, FALSE, FALSE, TRUE);
+	else
+		mono_marshal_emit_native_wrapper (mb->method->klass->image, mb, sig, piinfo, mspecs, piinfo->addr, aot, check_exceptions, FALSE);
 #endif
 	info = mono_wrapper_info_create (mb, WRAPPER_SUBTYPE_PINVOKE);
 	info->d.managed_to_native.method = method;
@@ -7990,44 +8294,218 @@ mono_marshal_get_native_func_wrapper (MonoImage *image, MonoMethodSignature *sig
 	return res;
 }
 
+static gboolean
+native_shared_signature_equal (MonoMethodSignature *sig1, MonoMethodSignature *sig2)
+{
+	return sig1->call_convention == sig2->call_convention && mono_metadata_signature_equal (sig1, sig2);
+}
+
+static MonoType*
+get_native_shared_type (MonoType *t)
+{
+	switch (t->type) {
+	case MONO_TYPE_VOID:
+		return &mono_defaults.void_class->byval_arg;
+	case MONO_TYPE_I:
+	case MONO_TYPE_U:
+	case MONO_TYPE_PTR:
+	case MONO_TYPE_FNPTR:
+		return &mono_defaults.int_class->byval_arg;
+	default:
+		return &mono_class_from_mono_type (t)->byval_arg;
+	}
+}
+
+#ifndef DISABLE_JIT
 /*
- * The wrapper receives the native function as a boxed IntPtr as its 'this' argument. This is easier to support in
- * AOT.
+ * emit_native_shared_wrapper:
+ *
+ *   Emit a call to the native function passed in the first argument, passing it
+ * the remaining arguments unchanged. CSIG is the signature of the native function.
  */
-MonoMethod*
-mono_marshal_get_native_func_wrapper_aot (MonoClass *klass)
+static void
+emit_native_shared_wrapper (MonoMethodBuilder *mb, MonoMethodSignature *csig)
 {
-	MonoMethodSignature *sig, *csig;
+	int i, ret_var = -1;
+	int coop_gc_stack_dummy = -1, coop_gc_var = -1;
+
+	if (!MONO_TYPE_IS_VOID (csig->ret))
+		ret_var = mono_mb_add_local (mb, csig->ret);
+
+	if (mono_threads_is_coop_enabled ()) {
+		coop_gc_stack_dummy = mono_mb_add_local (mb, &mono_defaults.int_class->byval_arg);
+		coop_gc_var = mono_mb_add_local (mb, &mono_defaults.int_class->byval_arg);
+
+		mono_mb_emit_ldloc_addr (mb, coop_gc_stack_dummy);
+		mono_mb_emit_icall (mb, mono_threads_enter_gc_safe_region_unbalanced);
+		mono_mb_emit_stloc (mb, coop_gc_var);
+	}
+
+	for (i = 0; i < csig->param_count; ++i)
+		mono_mb_emit_ldarg (mb, i + 1);
+	mono_mb_emit_ldarg (mb, 0);
+	mono_mb_emit_calli (mb, csig);
+	if (ret_var != -1)
+		mono_mb_emit_stloc (mb, ret_var);
+
+	if (mono_threads_is_coop_enabled ()) {
+		mono_mb_emit_ldloc (mb, coop_gc_var);
+		mono_mb_emit_ldloc_addr (mb, coop_gc_stack_dummy);
+		mono_mb_emit_icall (mb, mono_threads_exit_gc_safe_region_unbalanced);
+	}
+
+	emit_thread_interrupt_checkpoint (mb);
+
+	if (ret_var != -1)
+		mono_mb_emit_ldloc (mb, ret_var);
+	mono_mb_emit_byte (mb, CEE_RET);
+}
+#endif
+
+/**
+ * mono_marshal_get_native_shared_wrapper_for_sig:
+ * @sig: a native signature as returned by mono_marshal_get_native_shared_sig ()
+ *
+ *   Returns the managed-to-native wrapper used by all pinvokes whose signature
+ * normalizes to @sig. The wrapper takes the address of the native function as its
+ * first argument, followed by the arguments of the pinvoke.
+ */
+MonoMethod *
+mono_marshal_get_native_shared_wrapper_for_sig (MonoMethodSignature *sig)
+{
+	MonoMethodSignature *csig, *wsig;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
+	MonoImage *image;
 	GHashTable *cache;
-	char *name;
 	WrapperInfo *info;
-	MonoMethodPInvoke mpiinfo;
-	MonoMethodPInvoke *piinfo = &mpiinfo;
-	MonoMarshalSpec **mspecs;
-	MonoMethod *invoke = mono_get_delegate_invoke (klass);
-	MonoImage *image = invoke->klass->image;
+	char *name;
 	int i;
 
-	// FIXME: include UnmanagedFunctionPointerAttribute info
-
-	/*
-	 * The wrapper is associated with the delegate type, to pick up the marshalling info etc.
-	 */
-	cache = get_cache (&mono_method_get_wrapper_cache (invoke)->native_func_wrapper_aot_cache, mono_aligned_addr_hash, NULL);
+	image = mono_defaults.corlib;
+	cache = get_cache (&image->wrapper_caches.native_shared_wrapper_cache, (GHashFunc)mono_signature_hash,
+					   (GCompareFunc)native_shared_signature_equal);
 
-	if ((res = mono_marshal_find_in_cache (cache, invoke)))
+	if ((res = mono_marshal_find_in_cache (cache, sig)))
 		return res;
 
-	memset (&mpiinfo, 0, sizeof (mpiinfo));
-	parse_unmanaged_function_pointer_attr (klass, &mpiinfo);
+	/* The key needs to live as long as the cache */
+	csig = mono_metadata_signature_dup_full (image, sig);
+	csig->pinvoke = 1;
 
-	mspecs = g_new0 (MonoMarshalSpec*, mono_method_signature (invoke)->param_count + 1);
-	mono_method_get_marshal_info (invoke, mspecs);
-	/* Freed below so don't alloc from mempool */
-	sig = mono_metadata_signature_dup (mono_method_signature (invoke));
-	sig->hasthis = 0;
+	wsig = mono_metadata_signature_alloc (image, csig->param_count + 1);
+	wsig->ret = csig->ret;
+	wsig->params [0] = &mono_defaults.int_class->byval_arg;
+	for (i = 0; i < csig->param_count; ++i)
+		wsig->params [i + 1] = csig->params [i];
+
+	name = mono_signature_to_name (csig, "native_shared");
+	mb = mono_mb_new (mono_defaults.object_class, name, MONO_WRAPPER_MANAGED_TO_NATIVE);
+	g_free (name);
+	mb->method->save_lmf = 1;
+
+#ifndef DISABLE_JIT
+	emit_native_shared_wrapper (mb, csig);
+#endif
+
+	info = mono_wrapper_info_create (mb, WRAPPER_SUBTYPE_NATIVE_SHARED);
+	info->d.managed_to_native.sig = csig;
+
+	res = mono_mb_create_and_cache_full (cache, csig, mb, wsig, wsig->param_count + 16, info, NULL);
+	mono_mb_free (mb);
+
+	return res;
+}
+
+/**
+ * mono_marshal_get_native_shared_sig:
+ * @method: a pinvoke method
+ *
+ *   Returns the normalized native signature of @method, with all pointer sized types
+ * replaced by IntPtr, or NULL if the wrapper of @method needs to marshal anything.
+ * Pinvokes with the same normalized signature can share one wrapper. The result
+ * should be freed with g_free ().
+ */
+MonoMethodSignature *
+mono_marshal_get_native_shared_sig (MonoMethod *method)
+{
+	MonoMethodSignature *sig, *res;
+	int i;
+
+	if (!pinvoke_needs_no_marshalling (method))
+		return NULL;
+
+	sig = mono_method_signature (method);
+	res = mono_metadata_signature_dup (sig);
+	res->pinvoke = 1;
+	res->ret = get_native_shared_type (sig->ret);
+	for (i = 0; i < sig->param_count; ++i)
+		res->params [i] = get_native_shared_type (sig->params [i]);
+
+	return res;
+}
+
+/**
+ * mono_marshal_get_native_shared_wrapper:
+ * @method: a pinvoke method
+ *
+ *   Returns the wrapper shared by all pinvokes with the same signature shape as
+ * @method, or NULL if @method can't use one.
+ * See mono_marshal_get_native_shared_wrapper_for_sig ().
+ */
+MonoMethod *
+mono_marshal_get_native_shared_wrapper (MonoMethod *method)
+{
+	MonoMethodSignature *sig;
+	MonoMethod *res;
+
+	sig = mono_marshal_get_native_shared_sig (method);
+	if (!sig)
+		return NULL;
+	res = mono_marshal_get_native_shared_wrapper_for_sig (sig);
+	g_free (sig);
+
+	return res;
+}
+
+/*
+ * The wrapper receives the native function as a boxed IntPtr as its 'this' argument. This is easier to support in
+ * AOT.
+ */
+MonoMethod*
+mono_marshal_get_native_func_wrapper_aot (MonoClass *klass)
+{
+	MonoMethodSignature *sig, *csig;
+	MonoMethodBuilder *mb;
+	MonoMethod *res;
+	GHashTable *cache;
+	char *name;
+	WrapperInfo *info;
+	MonoMethodPInvoke mpiinfo;
+	MonoMethodPInvoke *piinfo = &mpiinfo;
+	MonoMarshalSpec **mspecs;
+	MonoMethod *invoke = mono_get_delegate_invoke (klass);
+	MonoImage *image = invoke->klass->image;
+	int i;
+
+	// FIXME: include UnmanagedFunctionPointerAttribute info
+
+	/*
+	 * The wrapper is associated with the delegate type, to pick up the marshalling info etc.
+	 */
+	cache = get_cache (&mono_method_get_wrapper_cache (invoke)->native_func_wrapper_aot_cache, mono_aligned_addr_hash, NULL);
+
+	if ((res = mono_marshal_find_in_cache (cache, invoke)))
+		return res;
+
+	memset (&mpiinfo, 0, sizeof (mpiinfo));
+	parse_unmanaged_function_pointer_attr (klass, &mpiinfo);
+
+	mspecs = g_new0 (MonoMarshalSpec*, mono_method_signature (invoke)->param_count + 1);
+	mono_method_get_marshal_info (invoke, mspecs);
+	/* Freed below so don't alloc from mempool */
+	sig = mono_metadata_signature_dup (mono_method_signature (invoke));
+	sig->hasthis = 0;
 
 	name = g_strdup_printf ("wrapper_aot_native");
 	mb = mono_mb_new (invoke->klass, name, MONO_WRAPPER_MANAGED_TO_NATIVE);
@@ -8707,13 +9185,17 @@ mono_marshal_get_vtfixup_ftnptr (MonoImage *image, guint32 token, guint16 type)
  * This function takes a new method builder with 0 locals and adds two locals
  * to create multiple out-branches and the fall through state of having the object
  * on the stack after a cache miss
+ *
+ * The cache has MONO_CAST_CACHE_ENTRIES entries, so polymorphic call sites
+ * don't go to the slow path every time the type of the object changes.
  */
 static void
 generate_check_cache (int obj_arg_position, int class_arg_position, int cache_arg_position, // In-parameters
 											int *null_obj, int *cache_hit_neg, int *cache_hit_pos, // Out-parameters
 											MonoMethodBuilder *mb)
 {
-	int cache_miss_pos;
+	int cache_hit [MONO_CAST_CACHE_ENTRIES];
+	int cache_miss_pos, slow_path_pos, i;
 
 	/* allocate local 0 (pointer) obj_vtable */
 	mono_mb_add_local (mb, &mono_defaults.int_class->byval_arg);
@@ -8730,21 +9212,32 @@ generate_check_cache (int obj_arg_position, int class_arg_position, int cache_ar
 	mono_mb_emit_byte (mb, CEE_LDIND_I);
 	mono_mb_emit_stloc (mb, 0);
 
-	/* cached_vtable = *cache*/
-	mono_mb_emit_ldarg (mb, cache_arg_position);
-	mono_mb_emit_byte (mb, CEE_LDIND_I);
-	mono_mb_emit_stloc (mb, 1);
+	for (i = 0; i < MONO_CAST_CACHE_ENTRIES; ++i) {
+		/* cached_vtable = cache [i]*/
+		mono_mb_emit_ldarg (mb, cache_arg_position);
+		if (i) {
+			mono_mb_emit_icon (mb, i * sizeof (gpointer));
+			mono_mb_emit_byte (mb, CEE_ADD);
+		}
+		mono_mb_emit_byte (mb, CEE_LDIND_I);
+		mono_mb_emit_stloc (mb, 1);
 
-	mono_mb_emit_ldloc (mb, 1);
-	mono_mb_emit_byte (mb, CEE_LDC_I4);
-	mono_mb_emit_i4 (mb, ~0x1);
-	mono_mb_emit_byte (mb, CEE_CONV_I);
-	mono_mb_emit_byte (mb, CEE_AND);
-	mono_mb_emit_ldloc (mb, 0);
-	/*if ((cached_vtable & ~0x1)== obj_vtable)*/
-	cache_miss_pos = mono_mb_emit_branch (mb, CEE_BNE_UN);
+		mono_mb_emit_ldloc (mb, 1);
+		mono_mb_emit_byte (mb, CEE_LDC_I4);
+		mono_mb_emit_i4 (mb, ~0x1);
+		mono_mb_emit_byte (mb, CEE_CONV_I);
+		mono_mb_emit_byte (mb, CEE_AND);
+		mono_mb_emit_ldloc (mb, 0);
+		/*if ((cached_vtable & ~0x1)== obj_vtable)*/
+		cache_miss_pos = mono_mb_emit_branch (mb, CEE_BNE_UN);
+		cache_hit [i] = mono_mb_emit_branch (mb, CEE_BR);
+		mono_mb_patch_branch (mb, cache_miss_pos);
+	}
+	slow_path_pos = mono_mb_emit_branch (mb, CEE_BR);
 
 	/*return (cached_vtable & 0x1) ? NULL : obj;*/
+	for (i = 0; i < MONO_CAST_CACHE_ENTRIES; ++i)
+		mono_mb_patch_branch (mb, cache_hit [i]);
 	mono_mb_emit_ldloc (mb, 1);
 	mono_mb_emit_byte(mb, CEE_LDC_I4_1);
 	mono_mb_emit_byte (mb, CEE_CONV_U);
@@ -8753,7 +9246,7 @@ generate_check_cache (int obj_arg_position, int class_arg_position, int cache_ar
 	*cache_hit_pos = mono_mb_emit_branch (mb, CEE_BR);
 
 	// slow path
-	mono_mb_patch_branch (mb, cache_miss_pos);
+	mono_mb_patch_branch (mb, slow_path_pos);
 
 	// if isinst
 	mono_mb_emit_ldarg (mb, obj_arg_position);
@@ -8840,15 +9333,36 @@ mono_marshal_isinst_with_cache (MonoObject *obj, MonoClass *klass, uintptr_t *ca
 		return isinst;
 #endif
 
-	uintptr_t cache_update = (uintptr_t)obj->vtable;
-	if (!isinst)
-		cache_update = cache_update | 0x1;
-
-	*cache = cache_update;
+	mono_marshal_cast_cache_update ((gpointer *)cache, obj->vtable, isinst != NULL);
 
 	return isinst;
 }
 
+/*
+ * mono_marshal_cast_cache_update:
+ *
+ *   Remember in CACHE, which has MONO_CAST_CACHE_ENTRIES entries, whenever objects with
+ * VTABLE pass the cast. Empty entries are filled first, then the entry selected by VTABLE
+ * is replaced. Entries are read without locking, so each one is written with a single store.
+ */
+void
+mono_marshal_cast_cache_update (gpointer *cache, MonoVTable *vtable, gboolean is_inst)
+{
+	uintptr_t cache_update = (uintptr_t)vtable;
+	int i;
+
+	if (!is_inst)
+		cache_update = cache_update | 0x1;
+
+	for (i = 0; i < MONO_CAST_CACHE_ENTRIES; ++i) {
+		if (!cache [i]) {
+			cache [i] = (gpointer)cache_update;
+			return;
+		}
+	}
+	cache [(cache_update >> 4) % MONO_CAST_CACHE_ENTRIES] = (gpointer)cache_update;
+}
+
 /*
  * This does the equivalent of mono_object_isinst_with_cache.
  */
@@ -9122,8 +9636,8 @@ mono_marshal_get_struct_to_ptr (MonoClass *klass)
 
 	mono_marshal_load_type_info (klass);
 
-	if (klass->marshal_info->str_to_ptr)
-		return klass->marshal_info->str_to_ptr;
+	if (mono_class_get_marshal_info (klass)->str_to_ptr)
+		return mono_class_get_marshal_info (klass)->str_to_ptr;
 
 	if (!stoptr) 
 		stoptr = mono_class_get_method_from_name (mono_defaults.marshal_class, "StructureToPtr", 3);
@@ -9169,10 +9683,10 @@ mono_marshal_get_struct_to_ptr (MonoClass *klass)
 	mono_mb_free (mb);
 
 	mono_marshal_lock ();
-	if (!klass->marshal_info->str_to_ptr)
-		klass->marshal_info->str_to_ptr = res;
+	if (!mono_class_get_marshal_info (klass)->str_to_ptr)
+		mono_class_get_marshal_info (klass)->str_to_ptr = res;
 	else
-		res = klass->marshal_info->str_to_ptr;
+		res = mono_class_get_marshal_info (klass)->str_to_ptr;
 	mono_marshal_unlock ();
 	return res;
 }
@@ -9195,8 +9709,8 @@ mono_marshal_get_ptr_to_struct (MonoClass *klass)
 
 	mono_marshal_load_type_info (klass);
 
-	if (klass->marshal_info->ptr_to_str)
-		return klass->marshal_info->ptr_to_str;
+	if (mono_class_get_marshal_info (klass)->ptr_to_str)
+		return mono_class_get_marshal_info (klass)->ptr_to_str;
 
 	if (!ptostr) {
 		MonoMethodSignature *sig;
@@ -9247,10 +9761,10 @@ mono_marshal_get_ptr_to_struct (MonoClass *klass)
 	mono_mb_free (mb);
 
 	mono_marshal_lock ();
-	if (!klass->marshal_info->ptr_to_str)
-		klass->marshal_info->ptr_to_str = res;
+	if (!mono_class_get_marshal_info (klass)->ptr_to_str)
+		mono_class_get_marshal_info (klass)->ptr_to_str = res;
 	else
-		res = klass->marshal_info->ptr_to_str;
+		res = mono_class_get_marshal_info (klass)->ptr_to_str;
 	mono_marshal_unlock ();
 	return res;
 }
@@ -11217,7 +11731,7 @@ mono_marshal_is_loading_type_info (MonoClass *klass)
 /**
  * mono_marshal_load_type_info:
  *
- *  Initialize klass->marshal_info using information from metadata. This function can
+ *  Initialize the marshal info of KLASS using information from metadata. This function can
  * recursively call itself, and the caller is responsible to avoid that by calling 
  * mono_marshal_is_loading_type_info () beforehand.
  *
@@ -11236,14 +11750,14 @@ mono_marshal_load_type_info (MonoClass* klass)
 
 	g_assert (klass != NULL);
 
-	if (klass->marshal_info)
-		return klass->marshal_info;
+	if (mono_class_get_marshal_info (klass))
+		return mono_class_get_marshal_info (klass);
 
 	if (!klass->inited)
 		mono_class_init (klass);
 
-	if (klass->marshal_info)
-		return klass->marshal_info;
+	if (mono_class_get_marshal_info (klass))
+		return mono_class_get_marshal_info (klass);
 
 	/*
 	 * This function can recursively call itself, so we keep the list of classes which are
@@ -11364,15 +11878,17 @@ mono_marshal_load_type_info (MonoClass* klass)
 	loads_list = g_slist_remove (loads_list, klass);
 	mono_native_tls_set_value (load_type_info_tls_id, loads_list);
 
+	mono_class_alloc_ext (klass);
+
 	mono_marshal_lock ();
-	if (!klass->marshal_info) {
+	if (!klass->ext->marshal_info) {
 		/*We do double-checking locking on marshal_info */
 		mono_memory_barrier ();
-		klass->marshal_info = info;
+		klass->ext->marshal_info = info;
 	}
 	mono_marshal_unlock ();
 
-	return klass->marshal_info;
+	return klass->ext->marshal_info;
 }
 
 /**
@@ -11385,7 +11901,7 @@ mono_marshal_load_type_info (MonoClass* klass)
 gint32
 mono_class_native_size (MonoClass *klass, guint32 *align)
 {	
-	if (!klass->marshal_info) {
+	if (!mono_class_get_marshal_info (klass)) {
 		if (mono_marshal_is_loading_type_info (klass)) {
 			if (align)
 				*align = 0;
@@ -11396,9 +11912,9 @@ mono_class_native_size (MonoClass *klass, guint32 *align)
 	}
 
 	if (align)
-		*align = klass->marshal_info->min_align;
+		*align = mono_class_get_marshal_info (klass)->min_align;
 
-	return klass->marshal_info->native_size;
+	return mono_class_get_marshal_info (klass)->native_size;
 }
 
 /*
@@ -11823,6 +12339,20 @@ mono_marshal_find_nonzero_bit_offset (guint8 *buf, int len, int *byte_offset, gu
 
 MonoMethod *
 mono_marshal_get_thunk_invoke_wrapper (MonoMethod *method)
+{
+	return mono_marshal_get_thunk_invoke_wrapper_full (method, FALSE);
+}
+
+/*
+ * mono_marshal_get_thunk_invoke_wrapper_full:
+ *
+ *   Same as mono_marshal_get_thunk_invoke_wrapper (), but if UNBOXED is TRUE,
+ * value type arguments are passed as pointers to their unboxed data, and a value
+ * type return value is stored into a buffer passed as an extra argument before
+ * the exception argument, so calling the wrapper doesn't need to allocate.
+ */
+MonoMethod *
+mono_marshal_get_thunk_invoke_wrapper_full (MonoMethod *method, gboolean unboxed)
 {
 	MonoMethodBuilder *mb;
 	MonoMethodSignature *sig, *csig;
@@ -11831,7 +12361,8 @@ mono_marshal_get_thunk_invoke_wrapper (MonoMethod *method)
 	MonoClass *klass;
 	GHashTable *cache;
 	MonoMethod *res;
-	int i, param_count, sig_size, pos_leave;
+	int i, param_count, arg_count, sig_size, pos_leave;
+	gboolean ret_buf;
 
 	g_assert (method);
 
@@ -11841,7 +12372,10 @@ mono_marshal_get_thunk_invoke_wrapper (MonoMethod *method)
 	klass = method->klass;
 	image = method->klass->image;
 
-	cache = get_cache (&mono_method_get_wrapper_cache (method)->thunk_invoke_cache, mono_aligned_addr_hash, NULL);
+	if (unboxed)
+		cache = get_cache (&mono_method_get_wrapper_cache (method)->thunk_invoke_unboxed_cache, mono_aligned_addr_hash, NULL);
+	else
+		cache = get_cache (&mono_method_get_wrapper_cache (method)->thunk_invoke_cache, mono_aligned_addr_hash, NULL);
 
 	if ((res = mono_marshal_find_in_cache (cache, method)))
 		return res;
@@ -11849,8 +12383,10 @@ mono_marshal_get_thunk_invoke_wrapper (MonoMethod *method)
 	sig = mono_method_signature (method);
 	mb = mono_mb_new (klass, method->name, MONO_WRAPPER_NATIVE_TO_MANAGED);
 
-	/* add "this" and exception param */
-	param_count = sig->param_count + sig->hasthis + 1;
+	/* add "this", the return buffer and the exception param */
+	arg_count = sig->param_count + sig->hasthis;
+	ret_buf = unboxed && MONO_TYPE_ISSTRUCT (sig->ret);
+	param_count = arg_count + (ret_buf ? 1 : 0) + 1;
 
 	/* dup & extend signature */
 	csig = mono_metadata_signature_alloc (image, param_count);
@@ -11875,8 +12411,14 @@ mono_marshal_get_thunk_invoke_wrapper (MonoMethod *method)
 	csig->params [param_count - 1]->byref = 1;
 	csig->params [param_count - 1]->attrs = PARAM_ATTRIBUTE_OUT;
 
+	/* the return buffer is a pointer to the unboxed return value */
+	if (ret_buf)
+		csig->params [arg_count] = &mono_defaults.int_class->byval_arg;
+
 	/* convert struct return to object */
-	if (MONO_TYPE_ISSTRUCT (sig->ret))
+	if (ret_buf)
+		csig->ret = &mono_defaults.void_class->byval_arg;
+	else if (MONO_TYPE_ISSTRUCT (sig->ret))
 		csig->ret = &mono_defaults.object_class->byval_arg;
 
 #ifndef DISABLE_JIT
@@ -11897,7 +12439,7 @@ mono_marshal_get_thunk_invoke_wrapper (MonoMethod *method)
 	clause->try_offset = mono_mb_get_label (mb);
 
 	/* push method's args */
-	for (i = 0; i < param_count - 1; i++) {
+	for (i = 0; i < arg_count; i++) {
 		MonoType *type;
 		MonoClass *klass;
 
@@ -11907,8 +12449,17 @@ mono_marshal_get_thunk_invoke_wrapper (MonoMethod *method)
 		klass = mono_class_from_mono_type (csig->params [i]);
 		type = &klass->byval_arg;
 
-		/* unbox struct args */
-		if (MONO_TYPE_ISSTRUCT (type)) {
+		if (unboxed && MONO_TYPE_ISSTRUCT (type)) {
+			/* byref args are already pointers, other struct args point to the data */
+			if (csig->params [i]->byref)
+				continue;
+
+			if (!(i == 0 && sig->hasthis))
+				mono_mb_emit_op (mb, CEE_LDOBJ, klass);
+
+			csig->params [i] = &mono_defaults.int_class->byval_arg;
+		} else if (MONO_TYPE_ISSTRUCT (type)) {
+			/* unbox struct args */
 			mono_mb_emit_op (mb, CEE_UNBOX, klass);
 
 			/* byref args & and the "this" arg must remain a ptr.
@@ -11953,7 +12504,12 @@ mono_marshal_get_thunk_invoke_wrapper (MonoMethod *method)
 	mono_mb_patch_branch (mb, pos_leave);
 	/* end-try */
 
-	if (!MONO_TYPE_IS_VOID (sig->ret)) {
+	if (ret_buf) {
+		/* store the return value into the return buffer */
+		mono_mb_emit_ldarg (mb, arg_count);
+		mono_mb_emit_ldloc (mb, 1);
+		mono_mb_emit_op (mb, CEE_STOBJ, mono_class_from_mono_type (sig->ret));
+	} else if (!MONO_TYPE_IS_VOID (sig->ret)) {
 		mono_mb_emit_ldloc (mb, 1);
 
 		/* box the return value */
@@ -11970,6 +12526,875 @@ mono_marshal_get_thunk_invoke_wrapper (MonoMethod *method)
 	return res;
 }
 
+/* Number of reflection invokes of a method before a specialized invoke wrapper is created for it */
+#define REFLECTION_INVOKE_WRAPPER_THRESHOLD 8
+
+/*
+ * reflection_invoke_wrapper_supported:
+ *
+ *   Returns whenever the arguments of METHOD can be unpacked from an object array by the
+ * wrapper created by mono_marshal_get_reflection_invoke_wrapper (), with the same results
+ * as mono_runtime_invoke_array (). Constructors, byref and pointer arguments, valuetype
+ * and remoted receivers need the special handling done by mono_runtime_invoke_array ().
+ */
+static gboolean
+reflection_invoke_wrapper_supported (MonoMethod *method)
+{
+	MonoMethodSignature *sig;
+	MonoClass *klass = method->klass;
+	int i;
+
+	if (use_aot_wrappers || method->wrapper_type != MONO_WRAPPER_NONE)
+		return FALSE;
+	if (method->is_generic || klass->generic_container || klass->valuetype || klass->rank || klass->marshalbyref || klass->contextbound)
+		return FALSE;
+	if (method->flags & METHOD_ATTRIBUTE_ABSTRACT)
+		return FALSE;
+	if (!strcmp (method->name, ".ctor") || !strcmp (method->name, ".cctor"))
+		return FALSE;
+
+	sig = mono_method_signature (method);
+	if (!sig || sig->has_type_parameters || sig->call_convention == MONO_CALL_VARARG)
+		return FALSE;
+
+	for (i = -1; i < sig->param_count; ++i) {
+		MonoType *t = i == -1 ? sig->ret : sig->params [i];
+
+		if (t->byref)
+			return FALSE;
+		switch (t->type) {
+		case MONO_TYPE_PTR:
+		case MONO_TYPE_FNPTR:
+		case MONO_TYPE_TYPEDBYREF:
+		case MONO_TYPE_VAR:
+		case MONO_TYPE_MVAR:
+			return FALSE;
+		default:
+			break;
+		}
+	}
+
+	return TRUE;
+}
+
+/*
+ * mono_marshal_get_reflection_invoke_wrapper:
+ *
+ *   Return a wrapper with the signature 'object invoke (object this, object[] params)'
+ * which unpacks the arguments of METHOD from PARAMS, calls METHOD non-virtually and boxes
+ * the result. This avoids the per-call argument conversion done by
+ * mono_runtime_invoke_array (). Returns NULL if METHOD can't be invoked this way.
+ */
+MonoMethod *
+mono_marshal_get_reflection_invoke_wrapper (MonoMethod *method)
+{
+	MonoMethodSignature *sig, *csig;
+	MonoMethodBuilder *mb;
+	MonoMethod *res;
+	GHashTable *cache;
+	WrapperInfo *info;
+	int i, pos;
+
+	cache = get_cache (&mono_method_get_wrapper_cache (method)->reflection_invoke_cache, mono_aligned_addr_hash, NULL);
+
+	if ((res = mono_marshal_find_in_cache (cache, method)))
+		return res;
+
+	if (!reflection_invoke_wrapper_supported (method))
+		return NULL;
+
+	sig = mono_method_signature (method);
+
+	csig = mono_metadata_signature_alloc (method->klass->image, 2);
+	csig->ret = &mono_defaults.object_class->byval_arg;
+	csig->params [0] = &mono_defaults.object_class->byval_arg;
+	csig->params [1] = &mono_defaults.array_class->byval_arg;
+
+	mb = mono_mb_new (method->klass, method->name, MONO_WRAPPER_UNKNOWN);
+
+#ifndef DISABLE_JIT
+	if (sig->hasthis)
+		mono_mb_emit_ldarg (mb, 0);
+
+	for (i = 0; i < sig->param_count; ++i) {
+		MonoClass *klass = mono_class_from_mono_type (sig->params [i]);
+
+		if (!klass->valuetype) {
+			mono_mb_emit_ldarg (mb, 1);
+			mono_mb_emit_icon (mb, i);
+			mono_mb_emit_byte (mb, CEE_LDELEM_REF);
+		} else if (mono_class_is_nullable (klass)) {
+			/* The boxed vtype is converted into a Nullable structure */
+			mono_mb_emit_ldarg (mb, 1);
+			mono_mb_emit_icon (mb, i);
+			mono_mb_emit_byte (mb, CEE_LDELEM_REF);
+			mono_mb_emit_op (mb, CEE_UNBOX_ANY, klass);
+		} else {
+			int tmp_var = mono_mb_add_local (mb, sig->params [i]);
+
+			/* Like mono_runtime_invoke_array (), replace null arguments with a new object */
+			mono_mb_emit_ldarg (mb, 1);
+			mono_mb_emit_icon (mb, i);
+			mono_mb_emit_byte (mb, CEE_LDELEM_REF);
+			pos = mono_mb_emit_branch (mb, CEE_BRTRUE);
+			mono_mb_emit_ldarg (mb, 1);
+			mono_mb_emit_icon (mb, i);
+			mono_mb_emit_ldloc_addr (mb, tmp_var);
+			mono_mb_emit_op (mb, CEE_INITOBJ, klass);
+			mono_mb_emit_ldloc (mb, tmp_var);
+			mono_mb_emit_op (mb, CEE_BOX, klass);
+			mono_mb_emit_byte (mb, CEE_STELEM_REF);
+			mono_mb_patch_branch (mb, pos);
+
+			/* Pass the unboxed data without a type check, same as mono_object_unbox () */
+			mono_mb_emit_ldarg (mb, 1);
+			mono_mb_emit_icon (mb, i);
+			mono_mb_emit_byte (mb, CEE_LDELEM_REF);
+			mono_mb_emit_icon (mb, sizeof (MonoObject));
+			mono_mb_emit_byte (mb, CEE_ADD);
+			mono_mb_emit_op (mb, CEE_LDOBJ, klass);
+		}
+	}
+
+	mono_mb_emit_op (mb, CEE_CALL, method);
+
+	if (MONO_TYPE_IS_VOID (sig->ret))
+		mono_mb_emit_byte (mb, CEE_LDNULL);
+	else if (mono_class_from_mono_type (sig->ret)->valuetype)
+		mono_mb_emit_op (mb, CEE_BOX, mono_class_from_mono_type (sig->ret));
+	mono_mb_emit_byte (mb, CEE_RET);
+#endif
+
+	info = mono_wrapper_info_create (mb, WRAPPER_SUBTYPE_REFLECTION_INVOKE);
+	info->d.reflection_invoke.method = method;
+
+	res = mono_mb_create_and_cache_full (cache, method, mb, csig, sig->param_count + 16, info, NULL);
+	mono_mb_free (mb);
+
+	return res;
+}
+
+/*
+ * mono_marshal_lookup_reflection_invoke_wrapper:
+ *
+ *   Called on every reflection invoke of METHOD. Returns the wrapper created by
+ * mono_marshal_get_reflection_invoke_wrapper () once METHOD has been invoked
+ * REFLECTION_INVOKE_WRAPPER_THRESHOLD times, NULL before that, so methods which are
+ * only invoked a few times don't pay for compiling a wrapper.
+ */
+MonoMethod *
+mono_marshal_lookup_reflection_invoke_wrapper (MonoMethod *method)
+{
+	GHashTable *cache, *counts;
+	MonoMethod *res;
+	int count;
+
+	cache = get_cache (&mono_method_get_wrapper_cache (method)->reflection_invoke_cache, mono_aligned_addr_hash, NULL);
+	if ((res = mono_marshal_find_in_cache (cache, method)))
+		return res;
+
+	counts = get_cache (&mono_method_get_wrapper_cache (method)->reflection_invoke_count_cache, mono_aligned_addr_hash, NULL);
+
+	/* A count of -1 marks methods which can't use a wrapper */
+	mono_marshal_lock ();
+	count = GPOINTER_TO_INT (g_hash_table_lookup (counts, method));
+	if (count != -1 && count < REFLECTION_INVOKE_WRAPPER_THRESHOLD)
+		g_hash_table_insert (counts, method, GINT_TO_POINTER (count + 1));
+	mono_marshal_unlock ();
+
+	if (count == -1 || count < REFLECTION_INVOKE_WRAPPER_THRESHOLD)
+		return NULL;
+
+	res = mono_marshal_get_reflection_invoke_wrapper (method);
+	if (!res) {
+		mono_marshal_lock ();
+		g_hash_table_insert (counts, method, GINT_TO_POINTER (-1));
+		mono_marshal_unlock ();
+	}
+	return res;
+}
+
+/*
+ * Specialized versions of ValueType.Equals () and ValueType.GetHashCode ().
+ *
+ * The ValueType methods handle primitive and string fields in
+ * ves_icall_System_ValueType_Equals ()/InternalGetHashCode (), and return every other
+ * field boxed in an object array which the managed side then compares or hashes one by one.
+ * For structs used as dictionary keys without overriding these methods, this boxes all
+ * reference and struct fields on every call. The wrappers below do the same thing for one
+ * given struct type without boxing: adjacent integer fields are compared a word at a time,
+ * the fields of nested structs which don't override the methods are handled inline, and
+ * only reference fields and structs with overrides are called into.
+ */
+
+enum {
+	VTYPE_FIELD_BLIT,	/* integer or enum, compared bitwise */
+	VTYPE_FIELD_R4,
+	VTYPE_FIELD_R8,
+	VTYPE_FIELD_I4,		/* hashed by value */
+	VTYPE_FIELD_STRING,
+	VTYPE_FIELD_REF,
+	VTYPE_FIELD_CALL,	/* struct which defines the method, called with a pointer to the field */
+	VTYPE_FIELD_BOX,	/* struct whose method is defined in Enum, called on a boxed copy */
+	VTYPE_FIELD_SEED	/* the hash of a nested struct starts with the same seed */
+};
+
+typedef struct {
+	int kind;
+	int offset;
+	int size;
+	MonoClass *klass;
+	MonoMethod *method;
+} VTypeField;
+
+static MonoMethod *object_equals_method, *object_get_hash_code_method, *string_equality_method;
+
+static void
+init_valuetype_methods (void)
+{
+	if (string_equality_method)
+		return;
+	object_equals_method = mono_class_get_method_from_name (mono_defaults.object_class, "Equals", 1);
+	g_assert (object_equals_method);
+	object_get_hash_code_method = mono_class_get_method_from_name (mono_defaults.object_class, "GetHashCode", 0);
+	g_assert (object_get_hash_code_method);
+	mono_memory_barrier ();
+	string_equality_method = mono_class_get_method_from_name (mono_defaults.string_class, "op_Equality", 2);
+	g_assert (string_equality_method);
+}
+
+/*
+ * Return the method which implements OBJECT_METHOD in the valuetype KLASS, or NULL
+ * if KLASS can't be loaded.
+ */
+static MonoMethod *
+get_valuetype_override (MonoClass *klass, MonoMethod *object_method)
+{
+	int slot = mono_method_get_vtable_slot (object_method);
+
+	mono_class_setup_vtable (klass);
+	if (mono_class_has_failure (klass) || !klass->vtable || slot < 0)
+		return NULL;
+	return klass->vtable [slot];
+}
+
+/*
+ * collect_valuetype_fields:
+ *
+ *   Add the instance fields of KLASS, which starts at OFFSET in the outermost struct,
+ * to FIELDS, the same way ves_icall_System_ValueType_Equals () (if EQUALS is TRUE)
+ * or ves_icall_System_ValueType_InternalGetHashCode () and the managed code which
+ * handles the boxed fields would look at them. Returns FALSE if a field has a type
+ * the wrappers don't handle.
+ */
+static gboolean
+collect_valuetype_fields (MonoClass *klass, int offset, gboolean equals, GArray *fields)
+{
+	MonoClassField *field;
+	gpointer iter = NULL;
+
+	while ((field = mono_class_get_fields (klass, &iter))) {
+		MonoType *type = field->type;
+		MonoClass *fklass;
+		MonoMethod *method;
+		VTypeField f;
+
+		if (type->attrs & FIELD_ATTRIBUTE_STATIC)
+			continue;
+		if (mono_field_is_deleted (field))
+			continue;
+		if (type->byref)
+			return FALSE;
+
+		memset (&f, 0, sizeof (f));
+		f.offset = offset + field->offset - sizeof (MonoObject);
+		fklass = mono_class_from_mono_type (type);
+
+		switch (type->type) {
+		case MONO_TYPE_STRING:
+			f.kind = VTYPE_FIELD_STRING;
+			break;
+		case MONO_TYPE_CLASS:
+		case MONO_TYPE_OBJECT:
+		case MONO_TYPE_SZARRAY:
+		case MONO_TYPE_ARRAY:
+			f.kind = VTYPE_FIELD_REF;
+			break;
+		case MONO_TYPE_GENERICINST:
+			if (!fklass->valuetype) {
+				f.kind = VTYPE_FIELD_REF;
+				break;
+			}
+			/* fall through */
+		case MONO_TYPE_BOOLEAN:
+		case MONO_TYPE_CHAR:
+		case MONO_TYPE_I1:
+		case MONO_TYPE_U1:
+		case MONO_TYPE_I2:
+		case MONO_TYPE_U2:
+		case MONO_TYPE_I4:
+		case MONO_TYPE_U4:
+		case MONO_TYPE_I8:
+		case MONO_TYPE_U8:
+		case MONO_TYPE_I:
+		case MONO_TYPE_U:
+		case MONO_TYPE_R4:
+		case MONO_TYPE_R8:
+		case MONO_TYPE_VALUETYPE: {
+			MonoType *basetype = mono_type_get_underlying_type (type);
+
+			if (!basetype)
+				return FALSE;
+			method = get_valuetype_override (fklass, equals ? object_equals_method : object_get_hash_code_method);
+			if (!method)
+				return FALSE;
+
+			if (method->klass == mono_defaults.enum_class->parent) {
+				/* A struct which doesn't override the method either */
+				if (!equals) {
+					f.kind = VTYPE_FIELD_SEED;
+					g_array_append_val (fields, f);
+				}
+				if (!collect_valuetype_fields (fklass, f.offset, equals, fields))
+					return FALSE;
+				continue;
+			}
+
+			if (!equals) {
+				if (type->type == MONO_TYPE_I4) {
+					f.kind = VTYPE_FIELD_I4;
+				} else {
+					f.kind = method->klass == fklass ? VTYPE_FIELD_CALL : VTYPE_FIELD_BOX;
+					f.klass = fklass;
+					f.method = method;
+				}
+				break;
+			}
+
+			/* Primitive types and enums are compared by value, like the icall and Enum.Equals () */
+			switch (basetype->type) {
+			case MONO_TYPE_BOOLEAN:
+			case MONO_TYPE_I1:
+			case MONO_TYPE_U1:
+				f.kind = VTYPE_FIELD_BLIT;
+				f.size = 1;
+				break;
+			case MONO_TYPE_CHAR:
+			case MONO_TYPE_I2:
+			case MONO_TYPE_U2:
+				f.kind = VTYPE_FIELD_BLIT;
+				f.size = 2;
+				break;
+			case MONO_TYPE_I4:
+			case MONO_TYPE_U4:
+				f.kind = VTYPE_FIELD_BLIT;
+				f.size = 4;
+				break;
+			case MONO_TYPE_I8:
+			case MONO_TYPE_U8:
+				f.kind = VTYPE_FIELD_BLIT;
+				f.size = 8;
+				break;
+			case MONO_TYPE_I:
+			case MONO_TYPE_U:
+				f.kind = VTYPE_FIELD_BLIT;
+				f.size = sizeof (gpointer);
+				break;
+			case MONO_TYPE_R4:
+				f.kind = basetype == type ? VTYPE_FIELD_R4 : VTYPE_FIELD_BOX;
+				break;
+			case MONO_TYPE_R8:
+				f.kind = basetype == type ? VTYPE_FIELD_R8 : VTYPE_FIELD_BOX;
+				break;
+			default:
+				if (method->klass != fklass)
+					return FALSE;
+				f.kind = VTYPE_FIELD_CALL;
+				break;
+			}
+			f.klass = fklass;
+			f.method = method;
+			break;
+		}
+		default:
+			return FALSE;
+		}
+		g_array_append_val (fields, f);
+	}
+	return TRUE;
+}
+
+static int
+compare_vtype_field_offsets (const void *a, const void *b)
+{
+	const VTypeField *fa = (const VTypeField *)a;
+	const VTypeField *fb = (const VTypeField *)b;
+
+	return fa->offset - fb->offset;
+}
+
+#ifndef DISABLE_JIT
+/* Push the address of the data at OFFSET in the struct in argument ARG (or local LOCAL if ARG is -1) */
+static void
+emit_vtype_field_addr (MonoMethodBuilder *mb, int arg, int local, int offset)
+{
+	if (arg != -1)
+		mono_mb_emit_ldarg (mb, arg);
+	else
+		mono_mb_emit_ldloc (mb, local);
+	if (offset)
+		mono_mb_emit_ldflda (mb, offset);
+}
+
+static void
+emit_vtype_field_load (MonoMethodBuilder *mb, int arg, int local, int offset, guint8 ldind)
+{
+	emit_vtype_field_addr (mb, arg, local, offset);
+	mono_mb_emit_byte (mb, ldind);
+}
+#endif
+
+static MonoWrapperCaches*
+get_class_wrapper_caches (MonoClass *klass)
+{
+	if (klass->generic_class)
+		return &klass->generic_class->owner->wrapper_caches;
+	return &klass->image->wrapper_caches;
+}
+
+/*
+ * mono_marshal_get_valuetype_equals_wrapper:
+ *
+ *   Return a wrapper with the signature 'bool equals (ref KLASS this, object obj)' which
+ * returns the same as ValueType.Equals () called on a boxed copy of THIS, or NULL if
+ * KLASS has fields the wrapper can't handle.
+ */
+MonoMethod *
+mono_marshal_get_valuetype_equals_wrapper (MonoClass *klass)
+{
+	MonoMethodSignature *csig;
+	MonoMethodBuilder *mb;
+	MonoMethod *res;
+	GHashTable *cache;
+	WrapperInfo *info;
+	GArray *fields;
+	GSList *false_branches = NULL, *l;
+	guint32 align;
+	int i, that_var, pos, pos2;
+
+	cache = get_cache (&get_class_wrapper_caches (klass)->valuetype_equals_cache, mono_aligned_addr_hash, NULL);
+
+	if ((res = mono_marshal_find_in_cache (cache, klass)))
+		return res;
+
+	if (use_aot_wrappers || !klass->valuetype || klass->enumtype || klass->generic_container || mono_class_is_nullable (klass))
+		return NULL;
+
+	init_valuetype_methods ();
+
+	fields = g_array_new (FALSE, FALSE, sizeof (VTypeField));
+	if (!collect_valuetype_fields (klass, 0, TRUE, fields)) {
+		g_array_free (fields, TRUE);
+		return NULL;
+	}
+	mono_class_value_size (klass, &align);
+
+	csig = mono_metadata_signature_alloc (klass->image, 2);
+	csig->ret = &mono_defaults.boolean_class->byval_arg;
+	csig->params [0] = &klass->this_arg;
+	csig->params [1] = &mono_defaults.object_class->byval_arg;
+
+	mb = mono_mb_new (klass, "Equals", MONO_WRAPPER_UNKNOWN);
+
+#ifndef DISABLE_JIT
+	that_var = mono_mb_add_local (mb, &klass->this_arg);
+
+	/* Like the icall, OBJ has to be a boxed KLASS */
+	mono_mb_emit_ldarg (mb, 1);
+	false_branches = g_slist_prepend (false_branches, GUINT_TO_POINTER (mono_mb_emit_branch (mb, CEE_BRFALSE)));
+	mono_mb_emit_ldarg (mb, 1);
+	mono_mb_emit_ldflda (mb, MONO_STRUCT_OFFSET (MonoObject, vtable));
+	mono_mb_emit_byte (mb, CEE_LDIND_I);
+	mono_mb_emit_ldflda (mb, MONO_STRUCT_OFFSET (MonoVTable, klass));
+	mono_mb_emit_byte (mb, CEE_LDIND_I);
+	mono_mb_emit_ptr (mb, klass);
+	false_branches = g_slist_prepend (false_branches, GUINT_TO_POINTER (mono_mb_emit_branch (mb, CEE_BNE_UN)));
+	mono_mb_emit_ldarg (mb, 1);
+	mono_mb_emit_op (mb, CEE_UNBOX, klass);
+	mono_mb_emit_stloc (mb, that_var);
+
+	/*
+	 * The icall compares primitive and string fields before the managed code compares the
+	 * boxed ones, so compare everything which can be done inline first. Integer fields are
+	 * merged into spans of adjacent bytes, which are compared in aligned chunks of up to a
+	 * word, like a memcmp () which skips the padding.
+	 */
+	qsort (fields->data, fields->len, sizeof (VTypeField), compare_vtype_field_offsets);
+	for (i = 0; i < fields->len;) {
+		VTypeField *f = &g_array_index (fields, VTypeField, i);
+		int start, end;
+
+		if (f->kind != VTYPE_FIELD_BLIT) {
+			i++;
+			continue;
+		}
+		start = f->offset;
+		end = f->offset + f->size;
+		for (i++; i < fields->len; i++) {
+			VTypeField *next = &g_array_index (fields, VTypeField, i);
+
+			if (next->kind != VTYPE_FIELD_BLIT || next->offset > end)
+				break;
+			end = MAX (end, next->offset + next->size);
+		}
+
+		while (start < end) {
+			int size = MIN (sizeof (gpointer), align);
+			guint8 ldind;
+
+			while (size > end - start || start % size)
+				size /= 2;
+			switch (size) {
+			case 8: ldind = CEE_LDIND_I8; break;
+			case 4: ldind = CEE_LDIND_I4; break;
+			case 2: ldind = CEE_LDIND_I2; break;
+			default: ldind = CEE_LDIND_I1; break;
+			}
+			emit_vtype_field_load (mb, 0, -1, start, ldind);
+			emit_vtype_field_load (mb, -1, that_var, start, ldind);
+			false_branches = g_slist_prepend (false_branches, GUINT_TO_POINTER (mono_mb_emit_branch (mb, CEE_BNE_UN)));
+			start += size;
+		}
+	}
+
+	for (i = 0; i < fields->len; i++) {
+		VTypeField *f = &g_array_index (fields, VTypeField, i);
+
+		switch (f->kind) {
+		case VTYPE_FIELD_R4:
+		case VTYPE_FIELD_R8: {
+			guint8 ldind = f->kind == VTYPE_FIELD_R4 ? CEE_LDIND_R4 : CEE_LDIND_R8;
+
+			/* Same as the != in the icall, NaN is not equal to itself */
+			emit_vtype_field_load (mb, 0, -1, f->offset, ldind);
+			emit_vtype_field_load (mb, -1, that_var, f->offset, ldind);
+			false_branches = g_slist_prepend (false_branches, GUINT_TO_POINTER (mono_mb_emit_branch (mb, CEE_BNE_UN)));
+			break;
+		}
+		case VTYPE_FIELD_STRING:
+			emit_vtype_field_load (mb, 0, -1, f->offset, CEE_LDIND_REF);
+			emit_vtype_field_load (mb, -1, that_var, f->offset, CEE_LDIND_REF);
+			mono_mb_emit_managed_call (mb, string_equality_method, NULL);
+			false_branches = g_slist_prepend (false_branches, GUINT_TO_POINTER (mono_mb_emit_branch (mb, CEE_BRFALSE)));
+			break;
+		default:
+			break;
+		}
+	}
+
+	/* The fields the managed code would get boxed */
+	for (i = 0; i < fields->len; i++) {
+		VTypeField *f = &g_array_index (fields, VTypeField, i);
+
+		switch (f->kind) {
+		case VTYPE_FIELD_REF:
+			/* this.f == null ? obj.f == null : this.f.Equals (obj.f) */
+			emit_vtype_field_load (mb, 0, -1, f->offset, CEE_LDIND_REF);
+			pos = mono_mb_emit_branch (mb, CEE_BRTRUE);
+			emit_vtype_field_load (mb, -1, that_var, f->offset, CEE_LDIND_REF);
+			false_branches = g_slist_prepend (false_branches, GUINT_TO_POINTER (mono_mb_emit_branch (mb, CEE_BRTRUE)));
+			pos2 = mono_mb_emit_branch (mb, CEE_BR);
+			mono_mb_patch_branch (mb, pos);
+			emit_vtype_field_load (mb, 0, -1, f->offset, CEE_LDIND_REF);
+			emit_vtype_field_load (mb, -1, that_var, f->offset, CEE_LDIND_REF);
+			mono_mb_emit_op (mb, CEE_CALLVIRT, object_equals_method);
+			false_branches = g_slist_prepend (false_branches, GUINT_TO_POINTER (mono_mb_emit_branch (mb, CEE_BRFALSE)));
+			mono_mb_patch_branch (mb, pos2);
+			break;
+		case VTYPE_FIELD_CALL:
+			/* The boxed copy of obj.f is the only allocation left */
+			emit_vtype_field_addr (mb, 0, -1, f->offset);
+			emit_vtype_field_addr (mb, -1, that_var, f->offset);
+			mono_mb_emit_op (mb, CEE_LDOBJ, f->klass);
+			mono_mb_emit_op (mb, CEE_BOX, f->klass);
+			mono_mb_emit_op (mb, CEE_CALL, f->method);
+			false_branches = g_slist_prepend (false_branches, GUINT_TO_POINTER (mono_mb_emit_branch (mb, CEE_BRFALSE)));
+			break;
+		case VTYPE_FIELD_BOX:
+			emit_vtype_field_addr (mb, 0, -1, f->offset);
+			mono_mb_emit_op (mb, CEE_LDOBJ, f->klass);
+			mono_mb_emit_op (mb, CEE_BOX, f->klass);
+			emit_vtype_field_addr (mb, -1, that_var, f->offset);
+			mono_mb_emit_op (mb, CEE_LDOBJ, f->klass);
+			mono_mb_emit_op (mb, CEE_BOX, f->klass);
+			mono_mb_emit_op (mb, CEE_CALLVIRT, object_equals_method);
+			false_branches = g_slist_prepend (false_branches, GUINT_TO_POINTER (mono_mb_emit_branch (mb, CEE_BRFALSE)));
+			break;
+		default:
+			break;
+		}
+	}
+
+	mono_mb_emit_icon (mb, 1);
+	mono_mb_emit_byte (mb, CEE_RET);
+
+	for (l = false_branches; l; l = l->next)
+		mono_mb_patch_branch (mb, GPOINTER_TO_UINT (l->data));
+	mono_mb_emit_icon (mb, 0);
+	mono_mb_emit_byte (mb, CEE_RET);
+	g_slist_free (false_branches);
+#endif
+	g_array_free (fields, TRUE);
+
+	info = mono_wrapper_info_create (mb, WRAPPER_SUBTYPE_VALUETYPE_EQUALS);
+	info->d.valuetype.klass = klass;
+
+	res = mono_mb_create_and_cache_full (cache, klass, mb, csig, 16, info, NULL);
+	mono_mb_free (mb);
+
+	return res;
+}
+
+/*
+ * mono_marshal_get_valuetype_hash_wrapper:
+ *
+ *   Return a wrapper with the signature 'int hash (ref KLASS this)' which returns the
+ * same as ValueType.GetHashCode () called on a boxed copy of THIS, or NULL if KLASS
+ * has fields the wrapper can't handle.
+ */
+MonoMethod *
+mono_marshal_get_valuetype_hash_wrapper (MonoClass *klass)
+{
+	MonoMethodSignature *csig;
+	MonoMethodBuilder *mb;
+	MonoMethod *res;
+	GHashTable *cache;
+	WrapperInfo *info;
+	GArray *fields;
+	int i, pos;
+
+	cache = get_cache (&get_class_wrapper_caches (klass)->valuetype_hash_cache, mono_aligned_addr_hash, NULL);
+
+	if ((res = mono_marshal_find_in_cache (cache, klass)))
+		return res;
+
+	if (use_aot_wrappers || !klass->valuetype || klass->enumtype || klass->generic_container || mono_class_is_nullable (klass))
+		return NULL;
+
+	init_valuetype_methods ();
+
+	fields = g_array_new (FALSE, FALSE, sizeof (VTypeField));
+	if (!collect_valuetype_fields (klass, 0, FALSE, fields)) {
+		g_array_free (fields, TRUE);
+		return NULL;
+	}
+
+	csig = mono_metadata_signature_alloc (klass->image, 1);
+	csig->ret = &mono_defaults.int32_class->byval_arg;
+	csig->params [0] = &klass->this_arg;
+
+	mb = mono_mb_new (klass, "GetHashCode", MONO_WRAPPER_UNKNOWN);
+
+#ifndef DISABLE_JIT
+	/* The seed used by the icall, the fields are xor-ed into it */
+	mono_mb_emit_icon (mb, (int)(gsize)mono_defaults.int32_class);
+
+	for (i = 0; i < fields->len; i++) {
+		VTypeField *f = &g_array_index (fields, VTypeField, i);
+
+		switch (f->kind) {
+		case VTYPE_FIELD_SEED:
+			mono_mb_emit_icon (mb, (int)(gsize)mono_defaults.int32_class);
+			break;
+		case VTYPE_FIELD_I4:
+			emit_vtype_field_load (mb, 0, -1, f->offset, CEE_LDIND_I4);
+			break;
+		case VTYPE_FIELD_STRING:
+		case VTYPE_FIELD_REF:
+			/* Null fields don't change the hash */
+			emit_vtype_field_load (mb, 0, -1, f->offset, CEE_LDIND_REF);
+			pos = mono_mb_emit_branch (mb, CEE_BRFALSE);
+			emit_vtype_field_load (mb, 0, -1, f->offset, CEE_LDIND_REF);
+			if (f->kind == VTYPE_FIELD_STRING)
+				mono_mb_emit_icall (mb, mono_string_hash);
+			else
+				mono_mb_emit_op (mb, CEE_CALLVIRT, object_get_hash_code_method);
+			mono_mb_emit_byte (mb, CEE_XOR);
+			mono_mb_patch_branch (mb, pos);
+			continue;
+		case VTYPE_FIELD_CALL:
+			emit_vtype_field_addr (mb, 0, -1, f->offset);
+			mono_mb_emit_op (mb, CEE_CALL, f->method);
+			break;
+		case VTYPE_FIELD_BOX:
+			emit_vtype_field_addr (mb, 0, -1, f->offset);
+			mono_mb_emit_op (mb, CEE_LDOBJ, f->klass);
+			mono_mb_emit_op (mb, CEE_BOX, f->klass);
+			mono_mb_emit_op (mb, CEE_CALLVIRT, object_get_hash_code_method);
+			break;
+		default:
+			g_assert_not_reached ();
+		}
+		mono_mb_emit_byte (mb, CEE_XOR);
+	}
+
+	mono_mb_emit_byte (mb, CEE_RET);
+#endif
+	g_array_free (fields, TRUE);
+
+	info = mono_wrapper_info_create (mb, WRAPPER_SUBTYPE_VALUETYPE_HASH);
+	info->d.valuetype.klass = klass;
+
+	res = mono_mb_create_and_cache_full (cache, klass, mb, csig, 16, info, NULL);
+	mono_mb_free (mb);
+
+	return res;
+}
+
+/*
+ * mono_marshal_get_valuetype_method_wrapper:
+ *
+ *   Return the wrapper to call instead of METHOD, ValueType.Equals () or
+ * ValueType.GetHashCode (), for the valuetype KLASS, or NULL.
+ */
+MonoMethod *
+mono_marshal_get_valuetype_method_wrapper (MonoClass *klass, MonoMethod *method)
+{
+	if (method->klass != mono_defaults.enum_class->parent)
+		return NULL;
+	if (!strcmp (method->name, "Equals") && mono_method_signature (method)->param_count == 1)
+		return mono_marshal_get_valuetype_equals_wrapper (klass);
+	if (!strcmp (method->name, "GetHashCode") && mono_method_signature (method)->param_count == 0)
+		return mono_marshal_get_valuetype_hash_wrapper (klass);
+	return NULL;
+}
+
+/*
+ * Return the public default constructor of KLASS if Activator.CreateInstance<KLASS> ()
+ * only needs to call it, or NULL if it does something else, like throwing an exception
+ * or going through the remoting activation.
+ */
+static MonoMethod *
+get_create_instance_ctor (MonoClass *klass)
+{
+	MonoMethod *ctor;
+
+	if (klass->valuetype || klass->rank || klass == mono_defaults.string_class)
+		return NULL;
+	if (klass->flags & (TYPE_ATTRIBUTE_ABSTRACT | TYPE_ATTRIBUTE_INTERFACE))
+		return NULL;
+	if (klass->generic_container || klass->marshalbyref || klass->contextbound || MONO_CLASS_IS_IMPORT (klass))
+		return NULL;
+	if (image_is_dynamic (klass->image) || klass->image->assembly->ref_only)
+		return NULL;
+
+	ctor = mono_class_get_method_from_name_flags (klass, ".ctor", 0, 0);
+	if (!ctor || (ctor->flags & METHOD_ATTRIBUTE_STATIC) || (ctor->flags & METHOD_ATTRIBUTE_MEMBER_ACCESS_MASK) != METHOD_ATTRIBUTE_PUBLIC)
+		return NULL;
+	return ctor;
+}
+
+/*
+ * mono_marshal_get_create_instance_wrapper:
+ *
+ *   Return a wrapper with the signature 'object create ()' which returns the same as
+ * Activator.CreateInstance<KLASS> () for the reference type KLASS. It calls the public
+ * default constructor of KLASS directly, wrapping the exceptions it throws in a
+ * TargetInvocationException like the reflection invoke does. For the other classes, it
+ * calls Activator.CreateInstance<KLASS> () itself.
+ */
+MonoMethod *
+mono_marshal_get_create_instance_wrapper (MonoClass *klass)
+{
+	static MonoMethod *create_instance_method, *tie_ctor;
+	MonoMethodSignature *csig;
+	MonoMethodBuilder *mb;
+	MonoMethod *res, *ctor, *inflated = NULL;
+	MonoExceptionClause *clause;
+	GHashTable *cache;
+	WrapperInfo *info;
+	int pos_leave;
+
+	cache = get_cache (&get_class_wrapper_caches (klass)->create_instance_cache, mono_aligned_addr_hash, NULL);
+
+	if ((res = mono_marshal_find_in_cache (cache, klass)))
+		return res;
+
+	g_assert (!klass->valuetype);
+
+	if (!tie_ctor) {
+		MonoMethod *m = mono_class_get_method_from_name (mono_class_get_activator_class (), "CreateInstance", 0);
+
+		g_assert (m && m->is_generic);
+		create_instance_method = m;
+		m = mono_class_get_method_from_name (mono_class_get_target_invocation_exception_class (), ".ctor", 1);
+		g_assert (m);
+		mono_memory_barrier ();
+		tie_ctor = m;
+	}
+
+	ctor = get_create_instance_ctor (klass);
+	if (!ctor) {
+		MonoError error;
+		MonoGenericContext ctx;
+		MonoType *type_argv [1];
+
+		memset (&ctx, 0, sizeof (ctx));
+		type_argv [0] = &klass->byval_arg;
+		ctx.method_inst = mono_metadata_get_generic_inst (1, type_argv);
+		inflated = mono_class_inflate_generic_method_checked (create_instance_method, &ctx, &error);
+		g_assert (mono_error_ok (&error)); /* FIXME don't swallow the error */
+	}
+
+	csig = mono_metadata_signature_alloc (klass->image, 0);
+	csig->ret = &mono_defaults.object_class->byval_arg;
+
+	mb = mono_mb_new (klass, "CreateInstance", MONO_WRAPPER_UNKNOWN);
+
+#ifndef DISABLE_JIT
+	if (ctor) {
+		/* local 0 (temp for result) */
+		mono_mb_add_local (mb, &mono_defaults.object_class->byval_arg);
+
+		/* try */
+		clause = (MonoExceptionClause *)mono_image_alloc0 (klass->image, sizeof (MonoExceptionClause));
+		clause->try_offset = mono_mb_get_label (mb);
+
+		mono_mb_emit_op (mb, CEE_NEWOBJ, ctor);
+		mono_mb_emit_stloc (mb, 0);
+		pos_leave = mono_mb_emit_branch (mb, CEE_LEAVE);
+
+		/* catch */
+		clause->flags = MONO_EXCEPTION_CLAUSE_NONE;
+		clause->try_len = mono_mb_get_pos (mb) - clause->try_offset;
+		clause->data.catch_class = mono_defaults.exception_class;
+
+		clause->handler_offset = mono_mb_get_label (mb);
+		mono_mb_emit_op (mb, CEE_NEWOBJ, tie_ctor);
+		mono_mb_emit_byte (mb, CEE_THROW);
+		clause->handler_len = mono_mb_get_pos (mb) - clause->handler_offset;
+
+		mono_mb_set_clauses (mb, 1, clause);
+
+		mono_mb_patch_branch (mb, pos_leave);
+		/* end-try */
+
+		mono_mb_emit_ldloc (mb, 0);
+	} else {
+		mono_mb_emit_op (mb, CEE_CALL, inflated);
+	}
+	mono_mb_emit_byte (mb, CEE_RET);
+#endif
+
+	info = mono_wrapper_info_create (mb, WRAPPER_SUBTYPE_CREATE_INSTANCE);
+	info->d.create_instance.klass = klass;
+
+	res = mono_mb_create_and_cache_full (cache, klass, mb, csig, 16, info, NULL);
+	mono_mb_free (mb);
+
+	return res;
+}
+
 /*
  * mono_marshal_free_dynamic_wrappers:
  *
@@ -11991,6 +13416,10 @@ mono_marshal_free_dynamic_wrappers (MonoMethod *method)
 	 */
 	if (image->wrapper_caches.runtime_invoke_direct_cache)
 		g_hash_table_remove (image->wrapper_caches.runtime_invoke_direct_cache, method);
+	if (image->wrapper_caches.reflection_invoke_cache)
+		g_hash_table_remove (image->wrapper_caches.reflection_invoke_cache, method);
+	if (image->wrapper_caches.reflection_invoke_count_cache)
+		g_hash_table_remove (image->wrapper_caches.reflection_invoke_count_cache, method);
 	if (image->wrapper_caches.delegate_abstract_invoke_cache)
 		g_hash_table_foreach_remove (image->wrapper_caches.delegate_abstract_invoke_cache, signature_pointer_pair_matches_pointer, method);
 	// FIXME: Need to clear the caches in other images as well
@@ -29,6 +29,12 @@
 		mono_marshal_find_nonzero_bit_offset ((guint8*)&tmp, sizeof (tmp), (byte_offset), (bitmask)); \
 	} while (0)
 
+/*
+ * The number of vtables remembered by the cache of a castclass/isinst call site, see
+ * mono_marshal_get_castclass_with_cache (). The low bit of an entry is set if the cast fails.
+ */
+#define MONO_CAST_CACHE_ENTRIES 4
+
 /*
  * This structure holds the state kept by the emit_ marshalling functions.
  * This is exported so it can be used by cominterop.c.
@@ -108,6 +114,7 @@ typedef enum {
 	WRAPPER_SUBTYPE_ICALL_WRAPPER,
 	WRAPPER_SUBTYPE_NATIVE_FUNC_AOT,
 	WRAPPER_SUBTYPE_PINVOKE,
+	WRAPPER_SUBTYPE_NATIVE_SHARED,
 	/* Subtypes of MONO_WRAPPER_UNKNOWN */
 	WRAPPER_SUBTYPE_SYNCHRONIZED_INNER,
 	WRAPPER_SUBTYPE_GSHAREDVT_IN,
@@ -121,6 +128,10 @@ typedef enum {
 	/* Subtypes of MONO_WRAPPER_UNKNOWN */
 	WRAPPER_SUBTYPE_GSHAREDVT_IN_SIG,
 	WRAPPER_SUBTYPE_GSHAREDVT_OUT_SIG,
+	WRAPPER_SUBTYPE_REFLECTION_INVOKE,
+	WRAPPER_SUBTYPE_VALUETYPE_EQUALS,
+	WRAPPER_SUBTYPE_VALUETYPE_HASH,
+	WRAPPER_SUBTYPE_CREATE_INSTANCE,
 } WrapperSubtype;
 
 typedef struct {
@@ -148,6 +159,8 @@ typedef struct {
 
 typedef struct {
 	MonoMethod *method;
+	/* For WRAPPER_SUBTYPE_NATIVE_SHARED */
+	MonoMethodSignature *sig;
 } ManagedToNativeWrapperInfo;
 
 typedef struct {
@@ -195,6 +208,18 @@ typedef struct {
 	MonoMethod *method;
 } DelegateInvokeWrapperInfo;
 
+typedef struct {
+	MonoMethod *method;
+} ReflectionInvokeWrapperInfo;
+
+typedef struct {
+	MonoClass *klass;
+} ValuetypeWrapperInfo;
+
+typedef struct {
+	MonoClass *klass;
+} CreateInstanceWrapperInfo;
+
 /*
  * This structure contains additional information to uniquely identify a given wrapper
  * method. It can be retrieved by mono_marshal_get_wrapper_info () for certain types
@@ -237,6 +262,12 @@ typedef struct {
 		GsharedvtWrapperInfo gsharedvt;
 		/* DELEGATE_INVOKE */
 		DelegateInvokeWrapperInfo delegate_invoke;
+		/* REFLECTION_INVOKE */
+		ReflectionInvokeWrapperInfo reflection_invoke;
+		/* VALUETYPE_EQUALS/VALUETYPE_HASH */
+		ValuetypeWrapperInfo valuetype;
+		/* CREATE_INSTANCE */
+		CreateInstanceWrapperInfo create_instance;
 	} d;
 } WrapperInfo;
 
@@ -341,6 +372,18 @@ mono_marshal_get_icall_wrapper (MonoMethodSignature *sig, const char *name, gcon
 MonoMethod *
 mono_marshal_get_native_wrapper (MonoMethod *method, gboolean check_exceptions, gboolean aot);
 
+gboolean
+mono_marshal_method_suppresses_gc_transition (MonoMethod *method);
+
+MonoMethodSignature *
+mono_marshal_get_native_shared_sig (MonoMethod *method);
+
+MonoMethod *
+mono_marshal_get_native_shared_wrapper (MonoMethod *method);
+
+MonoMethod *
+mono_marshal_get_native_shared_wrapper_for_sig (MonoMethodSignature *sig);
+
 MonoMethod *
 mono_marshal_get_native_func_wrapper (MonoImage *image, MonoMethodSignature *sig, MonoMethodPInvoke *piinfo, MonoMarshalSpec **mspecs, gpointer func);
 
@@ -368,6 +411,9 @@ mono_marshal_get_castclass_with_cache (void);
 MonoMethod *
 mono_marshal_get_isinst_with_cache (void);
 
+void
+mono_marshal_cast_cache_update (gpointer *cache, MonoVTable *vtable, gboolean is_inst);
+
 MonoMethod *
 mono_marshal_get_isinst (MonoClass *klass);
 
@@ -396,6 +442,27 @@ mono_marshal_get_generic_array_helper (MonoClass *klass, MonoClass *iface,
 MonoMethod *
 mono_marshal_get_thunk_invoke_wrapper (MonoMethod *method);
 
+MonoMethod *
+mono_marshal_get_thunk_invoke_wrapper_full (MonoMethod *method, gboolean unboxed);
+
+MonoMethod *
+mono_marshal_get_reflection_invoke_wrapper (MonoMethod *method);
+
+MonoMethod *
+mono_marshal_lookup_reflection_invoke_wrapper (MonoMethod *method);
+
+MonoMethod *
+mono_marshal_get_valuetype_equals_wrapper (MonoClass *klass);
+
+MonoMethod *
+mono_marshal_get_valuetype_hash_wrapper (MonoClass *klass);
+
+MonoMethod *
+mono_marshal_get_valuetype_method_wrapper (MonoClass *klass, MonoMethod *method);
+
+MonoMethod *
+mono_marshal_get_create_instance_wrapper (MonoClass *klass);
+
 MonoMethod*
 mono_marshal_get_gsharedvt_in_wrapper (void);
 
@@ -60,4 +60,7 @@ g_slist_append_mempool (MonoMemPool *mp, GSList *list, gpointer data)
 long
 mono_mempool_get_bytes_allocated (void);
 
+MonoMemPool*
+mono_mempool_reset (MonoMemPool *pool, guint32 max_size);
+
 #endif
@@ -19,6 +19,7 @@
 
 #include "mempool.h"
 #include "mempool-internals.h"
+#include <mono/utils/atomic.h>
 
 /*
  * MonoMemPool is for fast allocation of memory. We free
@@ -67,6 +68,9 @@ struct _MonoMemPool {
 	// Used in "initial block" only: End of current free space in mempool (ie, the first byte following the end of usable space)
 	guint8 *end;
 
+	// Used in "initial block" only: Number of bytes left unused at the end of the blocks which are no longer the current one
+	guint32 abandoned;
+
 	union {
 		// Unused: Imposing floating point memory rules on _MonoMemPool's final field ensures proper alignment of whole header struct
 		double pad;
@@ -78,6 +82,61 @@ struct _MonoMemPool {
 
 static long total_bytes_allocated = 0;
 
+#ifndef INDIVIDUAL_ALLOCATIONS
+/*
+ * Blocks of MONO_MEMPOOL_PAGESIZE bytes, the size of the initial block of mono_mempool_new ()
+ * and of most of the blocks added to growing mempools, are kept in a small global cache
+ * when their mempool is destroyed, so the mempools created later reuse them instead of
+ * going through malloc, which reduces the fragmentation caused by the many short lived
+ * mempools. Each slot is owned by whoever exchanges its content, so no lock is needed.
+ */
+#define BLOCK_CACHE_SIZE 64
+
+static gpointer volatile block_cache [BLOCK_CACHE_SIZE];
+/* Approximate number of blocks in the cache, to avoid scanning it when it is empty */
+static gint32 block_cache_count;
+
+static gpointer
+alloc_block (guint32 size)
+{
+	int i;
+
+	if (size == MONO_MEMPOOL_PAGESIZE && block_cache_count > 0) {
+		for (i = 0; i < BLOCK_CACHE_SIZE; ++i) {
+			gpointer block;
+
+			if (!block_cache [i])
+				continue;
+			block = InterlockedExchangePointer (&block_cache [i], NULL);
+			if (block) {
+				InterlockedDecrement (&block_cache_count);
+				return block;
+			}
+		}
+	}
+	return g_malloc (size);
+}
+
+static void
+free_block (MonoMemPool *block)
+{
+	int i;
+
+	if (block->size == MONO_MEMPOOL_PAGESIZE && block_cache_count < BLOCK_CACHE_SIZE) {
+		for (i = 0; i < BLOCK_CACHE_SIZE; ++i) {
+			if (!block_cache [i] && InterlockedCompareExchangePointer (&block_cache [i], block, NULL) == NULL) {
+				InterlockedIncrement (&block_cache_count);
+				return;
+			}
+		}
+	}
+	g_free (block);
+}
+#else
+#define alloc_block(size) g_malloc (size)
+#define free_block(block) g_free (block)
+#endif
+
 /**
  * mono_mempool_new:
  *
@@ -108,9 +167,10 @@ mono_mempool_new_size (int initial_size)
 		initial_size = MONO_MEMPOOL_MINSIZE;
 #endif
 
-	pool = (MonoMemPool *)g_malloc (initial_size);
+	pool = (MonoMemPool *)alloc_block (initial_size);
 
 	pool->next = NULL;
+	pool->abandoned = 0;
 	pool->pos = (guint8*)pool + SIZEOF_MEM_POOL; // Start after header
 	pool->end = (guint8*)pool + initial_size;    // End at end of allocated space 
 	pool->d.allocated = pool->size = initial_size;
@@ -134,11 +194,53 @@ mono_mempool_destroy (MonoMemPool *pool)
 	p = pool;
 	while (p) {
 		n = p->next;
-		g_free (p);
+		free_block (p);
 		p = n;
 	}
 }
 
+/**
+ * mono_mempool_reset:
+ * @pool: the memory pool to reset
+ * @max_size: the maximum amount of memory kept by the memory pool
+ *
+ * Free everything allocated from @pool, so it can be used again like a new memory
+ * pool without going through malloc and free for each use. The memory is kept as a
+ * single block as large as the whole pool was, up to @max_size bytes, so the pool
+ * can satisfy a similar amount of allocations without growing.
+ *
+ * Returns: the memory pool to use instead of @pool.
+ */
+MonoMemPool*
+mono_mempool_reset (MonoMemPool *pool, guint32 max_size)
+{
+	MonoMemPool *p, *n;
+	guint32 size = MIN (pool->d.allocated, max_size);
+
+	p = pool->next;
+	while (p) {
+		n = p->next;
+		total_bytes_allocated -= p->size;
+		free_block (p);
+		p = n;
+	}
+	pool->next = NULL;
+
+#ifndef INDIVIDUAL_ALLOCATIONS
+	if (size > pool->size) {
+		total_bytes_allocated -= pool->size;
+		free_block (pool);
+		return mono_mempool_new_size (size);
+	}
+#endif
+
+	pool->abandoned = 0;
+	pool->pos = (guint8*)pool + SIZEOF_MEM_POOL;
+	pool->end = (guint8*)pool + pool->size;
+	pool->d.allocated = pool->size;
+	return pool;
+}
+
 /**
  * mono_mempool_invalidate:
  * @pool: the memory pool to invalidate
@@ -172,7 +274,7 @@ mono_mempool_stats (MonoMemPool *pool)
 {
 	MonoMemPool *p;
 	int count = 0;
-	guint32 still_free;
+	guint32 still_free, used;
 
 	p = pool;
 	while (p) {
@@ -181,10 +283,13 @@ mono_mempool_stats (MonoMemPool *pool)
 	}
 	if (pool) {
 		still_free = pool->end - pool->pos;
+		used = pool->d.allocated - count * SIZEOF_MEM_POOL - pool->abandoned - still_free;
 		g_print ("Mempool %p stats:\n", pool);
 		g_print ("Total mem allocated: %d\n", pool->d.allocated);
 		g_print ("Num chunks: %d\n", count);
 		g_print ("Free memory: %d\n", still_free);
+		g_print ("Unused memory at the end of chunks: %d\n", pool->abandoned);
+		g_print ("Utilization: %.1f%%\n", pool->d.allocated ? (used * 100.0) / pool->d.allocated : 0.0);
 	}
 }
 
@@ -281,7 +386,7 @@ mono_mempool_alloc (MonoMemPool *pool, guint size)
 		// (In individual allocation mode, the constant will be 0 and this path will always be taken)
 		if (size >= MONO_MEMPOOL_PREFER_INDIVIDUAL_ALLOCATION_SIZE) {
 			guint new_size = SIZEOF_MEM_POOL + size;
-			MonoMemPool *np = (MonoMemPool *)g_malloc (new_size);
+			MonoMemPool *np = (MonoMemPool *)alloc_block (new_size);
 
 			np->next = pool->next;
 			np->size = new_size;
@@ -293,8 +398,9 @@ mono_mempool_alloc (MonoMemPool *pool, guint size)
 		} else {
 			// Notice: any unused memory at the end of the old head becomes simply abandoned in this case until the mempool is freed (see Bugzilla #35136)
 			guint new_size = get_next_size (pool, size);
-			MonoMemPool *np = (MonoMemPool *)g_malloc (new_size);
+			MonoMemPool *np = (MonoMemPool *)alloc_block (new_size);
 
+			pool->abandoned += pool->end - pool->pos;
 			np->next = pool->next;
 			np->size = new_size;
 			pool->next = np;
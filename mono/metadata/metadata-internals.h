@@ -112,6 +112,7 @@ typedef struct {
 	GHashTable *runtime_invoke_cache;
 	GHashTable *runtime_invoke_vtype_cache;
 	GHashTable *runtime_invoke_sig_cache;
+	GHashTable *native_shared_wrapper_cache;
 
 	/*
 	 * indexed by SignaturePointerPair
@@ -137,6 +138,17 @@ typedef struct {
 	GHashTable *cominterop_invoke_cache;
 	GHashTable *cominterop_wrapper_cache; /* LOCKING: marshal lock */
 	GHashTable *thunk_invoke_cache;
+	GHashTable *thunk_invoke_unboxed_cache;
+	GHashTable *reflection_invoke_cache;
+	GHashTable *reflection_invoke_count_cache;
+
+	/*
+	 * indexed by MonoClass pointers
+	 * Protected by the marshal lock
+	 */
+	GHashTable *valuetype_equals_cache;
+	GHashTable *valuetype_hash_cache;
+	GHashTable *create_instance_cache;
 } MonoWrapperCaches;
 
 typedef struct {
@@ -160,6 +172,12 @@ struct _MonoTableInfo {
 	 * we only need 4, but 8 is aligned no shift required. 
 	 */
 	guint32   size_bitfield;
+
+	/*
+	 * For the most frequently accessed tables, an array of pointers to blocks of
+	 * decoded rows, which are created on demand. NULL if the rows are not cached.
+	 */
+	gpointer *decoded_rows;
 };
 
 #define REFERENCE_MISSING ((gpointer) -1)
@@ -232,6 +250,8 @@ struct _MonoImage {
 	char *version;
 	gint16 md_version_major, md_version_minor;
 	char *guid;
+	/* Verification results cached on disk, see verify.c */
+	void *verify_cache;
 	void *image_info;
 	MonoMemPool         *mempool; /*protected by the image lock*/
 
@@ -306,6 +326,32 @@ struct _MonoImage {
 	 */
 	GHashTable *name_cache;  /*protected by the image lock*/
 
+	/*
+	 * Maps the lowercase full names of the toplevel types in the TypeDef table to
+	 * their typedef index, for the case insensitive lookups.
+	 */
+	GHashTable *name_case_cache;
+
+	/*
+	 * Maps the coded index of a custom attribute parent to its MonoCustomAttrInfo,
+	 * or NULL if it has no attributes.
+	 */
+	GHashTable *cattr_cache; /*protected by the image lock*/
+
+	/*
+	 * Memory used for the types and methods of this image outside of its mempool, in
+	 * bytes, for the --stats=memory report. The vtables are allocated from the domains.
+	 */
+	gint32 vtables_size;
+	gint32 jit_code_size;
+
+	/*
+	 * Indexed by table, maps the key column of some of the sorted tables to the 1-based
+	 * index of the first row with that key. Created on demand by sorted_table_lookup () in
+	 * metadata.c, REFERENCE_MISSING if the table is not sorted.
+	 */
+	GHashTable *sorted_table_index [MONO_TABLE_NUM];
+
 	/*
 	 * Indexed by MonoClass
 	 */
@@ -418,7 +464,9 @@ typedef struct {
 	MonoImage **images;
 
 	// Generic-specific caches
-	GHashTable *gclass_cache, *ginst_cache, *gmethod_cache, *gsignature_cache;
+	GHashTable *gclass_cache, *gsignature_cache;
+	/* Looked up without holding the lock */
+	MonoConcurrentHashTable *ginst_cache, *gmethod_cache;
 
 	MonoWrapperCaches wrapper_caches;
 
@@ -716,6 +764,8 @@ mono_metadata_cleanup (void);
 const char *   mono_meta_table_name              (int table);
 void           mono_metadata_compute_table_bases (MonoImage *meta);
 
+void           mono_metadata_free_decoded_rows (MonoImage *meta);
+
 gboolean
 mono_metadata_interfaces_from_typedef_full  (MonoImage             *image,
 											 guint32                table_index,
@@ -784,6 +834,8 @@ mono_metadata_generic_param_equal (MonoGenericParam *p1, MonoGenericParam *p2);
 void mono_dynamic_stream_reset  (MonoDynamicStream* stream);
 MONO_API void mono_assembly_addref       (MonoAssembly *assembly);
 void mono_assembly_load_friends (MonoAssembly* ass);
+void mono_assembly_set_preload_threads (int count);
+gboolean mono_assembly_probe_file_may_exist (const char *path);
 gboolean mono_assembly_has_skip_verification (MonoAssembly* ass);
 
 void mono_assembly_release_gc_roots (MonoAssembly *assembly);
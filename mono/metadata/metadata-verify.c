@@ -3963,11 +3963,17 @@ mono_verifier_verify_table_data (MonoImage *image, GSList **error_list)
 	if (!mono_verifier_is_enabled_for_image (image))
 		return TRUE;
 
+	if (mono_verifier_cache_tables_verified (image))
+		return TRUE;
+
 	init_verify_context (&ctx, image, error_list != NULL);
 	ctx.stage = STAGE_TABLES;
 
 	verify_tables_data (&ctx);
 
+	if (ctx.valid)
+		mono_verifier_cache_add_tables (image);
+
 	return cleanup_context (&ctx, error_list);
 }
 
@@ -881,6 +881,31 @@ mono_metadata_compute_size (MonoImage *meta, int tableindex, guint32 *result_bit
 	return size;
 }
 
+/*
+ * The rows of the tables which are decoded the most often while loading classes and
+ * methods are cached in decoded form, in blocks of DECODED_ROWS_BLOCK_SIZE rows which
+ * are created the first time one of their rows is accessed, so the column sizes
+ * don't have to be extracted from the size bitfield again on every access.
+ */
+#define DECODED_ROWS_BLOCK_SHIFT 8
+#define DECODED_ROWS_BLOCK_SIZE (1 << DECODED_ROWS_BLOCK_SHIFT)
+
+static gboolean
+table_has_decoded_rows (int table)
+{
+	switch (table) {
+	case MONO_TABLE_TYPEREF:
+	case MONO_TABLE_TYPEDEF:
+	case MONO_TABLE_FIELD:
+	case MONO_TABLE_METHOD:
+	case MONO_TABLE_MEMBERREF:
+	case MONO_TABLE_CUSTOMATTRIBUTE:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
 /**
  * mono_metadata_compute_table_bases:
  * @meta: metadata context to compute table values
@@ -902,6 +927,31 @@ mono_metadata_compute_table_bases (MonoImage *meta)
 		table->row_size = mono_metadata_compute_size (meta, i, &table->size_bitfield);
 		table->base = base;
 		base += table->rows * table->row_size;
+
+		if (table_has_decoded_rows (i))
+			table->decoded_rows = g_new0 (gpointer, (table->rows + DECODED_ROWS_BLOCK_SIZE - 1) / DECODED_ROWS_BLOCK_SIZE);
+	}
+}
+
+/*
+ * mono_metadata_free_decoded_rows:
+ *
+ *   Free the decoded rows cached by mono_metadata_decode_row () for the tables of META.
+ */
+void
+mono_metadata_free_decoded_rows (MonoImage *meta)
+{
+	int i, j;
+
+	for (i = 0; i < MONO_TABLE_NUM; i++) {
+		MonoTableInfo *table = &meta->tables [i];
+
+		if (!table->decoded_rows)
+			continue;
+		for (j = 0; j < (table->rows + DECODED_ROWS_BLOCK_SIZE - 1) / DECODED_ROWS_BLOCK_SIZE; ++j)
+			g_free (table->decoded_rows [j]);
+		g_free (table->decoded_rows);
+		table->decoded_rows = NULL;
 	}
 }
 
@@ -1008,27 +1058,12 @@ dword_align (const unsigned char *ptr)
 #endif
 }
 
-/**
- * mono_metadata_decode_row:
- * @t: table to extract information from.
- * @idx: index in table.
- * @res: array of @res_size cols to store the results in
- *
- * This decompresses the metadata element @idx in table @t
- * into the guint32 @res array that has res_size elements
- */
-void
-mono_metadata_decode_row (const MonoTableInfo *t, int idx, guint32 *res, int res_size)
+static inline void
+decode_row_raw (const MonoTableInfo *t, int idx, guint32 *res)
 {
 	guint32 bitfield = t->size_bitfield;
 	int i, count = mono_metadata_table_count (bitfield);
-	const char *data;
-
-	g_assert (idx < t->rows);
-	g_assert (idx >= 0);
-	data = t->base + idx * t->row_size;
-	
-	g_assert (res_size == count);
+	const char *data = t->base + idx * t->row_size;
 
 	for (i = 0; i < count; i++) {
 		int n = mono_metadata_table_size (bitfield, i);
@@ -1047,6 +1082,61 @@ mono_metadata_decode_row (const MonoTableInfo *t, int idx, guint32 *res, int res
 	}
 }
 
+/*
+ * get_decoded_row:
+ *
+ *   Return the decoded columns of row IDX of T, decoding the block containing it
+ * if needed.
+ */
+static const guint32*
+get_decoded_row (const MonoTableInfo *t, int idx)
+{
+	int count = mono_metadata_table_count (t->size_bitfield);
+	int block = idx >> DECODED_ROWS_BLOCK_SHIFT;
+	guint32 *rows;
+
+	rows = (guint32 *)InterlockedReadPointer (&t->decoded_rows [block]);
+	if (!rows) {
+		int i, start = block << DECODED_ROWS_BLOCK_SHIFT;
+		int nrows = MIN (DECODED_ROWS_BLOCK_SIZE, t->rows - start);
+
+		rows = g_new (guint32, nrows * count);
+		for (i = 0; i < nrows; ++i)
+			decode_row_raw (t, start + i, rows + (i * count));
+		/* Another thread might have decoded the same block */
+		if (InterlockedCompareExchangePointer (&t->decoded_rows [block], rows, NULL) != NULL) {
+			g_free (rows);
+			rows = (guint32 *)t->decoded_rows [block];
+		}
+	}
+	return rows + ((idx & (DECODED_ROWS_BLOCK_SIZE - 1)) * count);
+}
+
+/**
+ * mono_metadata_decode_row:
+ * @t: table to extract information from.
+ * @idx: index in table.
+ * @res: array of @res_size cols to store the results in
+ *
+ * This decompresses the metadata element @idx in table @t
+ * into the guint32 @res array that has res_size elements
+ */
+void
+mono_metadata_decode_row (const MonoTableInfo *t, int idx, guint32 *res, int res_size)
+{
+	guint32 bitfield = t->size_bitfield;
+	int count = mono_metadata_table_count (bitfield);
+
+	g_assert (idx < t->rows);
+	g_assert (idx >= 0);
+	g_assert (res_size == count);
+
+	if (t->decoded_rows)
+		memcpy (res, get_decoded_row (t, idx), count * sizeof (guint32));
+	else
+		decode_row_raw (t, idx, res);
+}
+
 /**
  * mono_metadata_decode_row_col:
  * @t: table to extract information from.
@@ -1066,6 +1156,10 @@ mono_metadata_decode_row_col (const MonoTableInfo *t, int idx, guint col)
 	
 	g_assert (idx < t->rows);
 	g_assert (col < mono_metadata_table_count (bitfield));
+
+	if (t->decoded_rows)
+		return get_decoded_row (t, idx) [col];
+
 	data = t->base + idx * t->row_size;
 
 	n = mono_metadata_table_size (bitfield, 0);
@@ -2373,8 +2467,9 @@ get_image_set (MonoImage **images, int nimages)
 		for (i = 0; i < nimages; ++i)
 			set->images [i] = images [i];
 		set->gclass_cache = g_hash_table_new_full (mono_generic_class_hash, mono_generic_class_equal, NULL, (GDestroyNotify)free_generic_class);
-		set->ginst_cache = g_hash_table_new_full (mono_metadata_generic_inst_hash, mono_metadata_generic_inst_equal, NULL, (GDestroyNotify)free_generic_inst);
-		set->gmethod_cache = g_hash_table_new_full (inflated_method_hash, inflated_method_equal, NULL, (GDestroyNotify)free_inflated_method);
+		/* Their entries are freed by mono_metadata_clean_for_image () */
+		set->ginst_cache = mono_conc_hashtable_new (mono_metadata_generic_inst_hash, mono_metadata_generic_inst_equal);
+		set->gmethod_cache = mono_conc_hashtable_new (inflated_method_hash, inflated_method_equal);
 		set->gsignature_cache = g_hash_table_new_full (inflated_signature_hash, inflated_signature_equal, NULL, (GDestroyNotify)free_inflated_signature);
 
 		for (i = 0; i < nimages; ++i)
@@ -2399,8 +2494,8 @@ delete_image_set (MonoImageSet *set)
 	int i;
 
 	g_hash_table_destroy (set->gclass_cache);
-	g_hash_table_destroy (set->ginst_cache);
-	g_hash_table_destroy (set->gmethod_cache);
+	mono_conc_hashtable_destroy (set->ginst_cache);
+	mono_conc_hashtable_destroy (set->gmethod_cache);
 	g_hash_table_destroy (set->gsignature_cache);
 
 	mono_wrapper_caches_free (&set->wrapper_caches);
@@ -2660,7 +2755,7 @@ steal_gclass_in_image (gpointer key, gpointer value, gpointer data)
 	return TRUE;
 }
 
-static gboolean
+static void
 steal_ginst_in_image (gpointer key, gpointer value, gpointer data)
 {
 	MonoGenericInst *ginst = (MonoGenericInst *)key;
@@ -2670,14 +2765,14 @@ steal_ginst_in_image (gpointer key, gpointer value, gpointer data)
 	//g_assert (ginst_in_image (ginst, user_data->image));
 
 	user_data->list = g_slist_prepend (user_data->list, ginst);
-	return TRUE;
 }
 
-static gboolean
+static void
 inflated_method_in_image (gpointer key, gpointer value, gpointer data)
 {
-	MonoImage *image = (MonoImage *)data;
 	MonoMethodInflated *method = (MonoMethodInflated *)key;
+	CleanForImageUserData *user_data = (CleanForImageUserData *)data;
+	MonoImage *image = user_data->image;
 
 	// FIXME:
 	// https://bugzilla.novell.com/show_bug.cgi?id=458168
@@ -2685,7 +2780,7 @@ inflated_method_in_image (gpointer key, gpointer value, gpointer data)
 		(method->context.class_inst && ginst_in_image (method->context.class_inst, image)) ||
 			  (method->context.method_inst && ginst_in_image (method->context.method_inst, image)) || (((MonoMethod*)method)->signature && signature_in_image (mono_method_signature ((MonoMethod*)method), image)));
 
-	return TRUE;
+	user_data->list = g_slist_prepend (user_data->list, method);
 }
 
 static gboolean
@@ -2731,7 +2826,7 @@ check_image_sets (MonoImage *image)
 		MonoImageSet *set = (MonoImageSet *)g_ptr_array_index (image_sets, i);
 
 		if (!g_slist_find (l, set)) {
-			g_hash_table_foreach (set->gmethod_cache, check_gmethod, image);
+			mono_conc_hashtable_foreach (set->gmethod_cache, check_gmethod, image);
 		}
 	}
 }
@@ -2739,7 +2834,7 @@ check_image_sets (MonoImage *image)
 void
 mono_metadata_clean_for_image (MonoImage *image)
 {
-	CleanForImageUserData ginst_data, gclass_data;
+	CleanForImageUserData ginst_data, gclass_data, gmethod_data;
 	GSList *l, *set_list;
 
 	//check_image_sets (image);
@@ -2748,23 +2843,33 @@ mono_metadata_clean_for_image (MonoImage *image)
 	 * The data structures could reference each other so we delete them in two phases.
 	 * This is required because of the hashing functions in gclass/ginst_cache.
 	 */
-	ginst_data.image = gclass_data.image = image;
-	ginst_data.list = gclass_data.list = NULL;
+	ginst_data.image = gclass_data.image = gmethod_data.image = image;
+	ginst_data.list = gclass_data.list = gmethod_data.list = NULL;
 
-	/* Collect the items to delete */
+	/*
+	 * Collect the items to delete.
+	 * The ginst and gmethod caches are looked up without holding the set lock, but
+	 * the caches of a set are only looked up for instances which reference all the
+	 * images of the set, so there are no lookups once one of its images is unloaded.
+	 * The sets are deleted below, so their concurrent hash tables don't need to be
+	 * emptied.
+	 */
 	/* delete_image_set () modifies the lists so make a copy */
 	for (l = image->image_sets; l; l = l->next) {
 		MonoImageSet *set = (MonoImageSet *)l->data;
 
 		mono_image_set_lock (set);
 		g_hash_table_foreach_steal (set->gclass_cache, steal_gclass_in_image, &gclass_data);
-		g_hash_table_foreach_steal (set->ginst_cache, steal_ginst_in_image, &ginst_data);
-		g_hash_table_foreach_remove (set->gmethod_cache, inflated_method_in_image, image);
+		mono_conc_hashtable_foreach (set->ginst_cache, steal_ginst_in_image, &ginst_data);
+		mono_conc_hashtable_foreach (set->gmethod_cache, inflated_method_in_image, &gmethod_data);
 		g_hash_table_foreach_remove (set->gsignature_cache, inflated_signature_in_image, image);
 		mono_image_set_unlock (set);
 	}
 
 	/* Delete the removed items */
+	for (l = gmethod_data.list; l; l = l->next)
+		free_inflated_method ((MonoMethodInflated *)l->data);
+	g_slist_free (gmethod_data.list);
 	for (l = ginst_data.list; l; l = l->next)
 		free_generic_inst ((MonoGenericInst *)l->data);
 	for (l = gclass_data.list; l; l = l->next)
@@ -2884,7 +2989,7 @@ mono_metadata_get_image_set_for_method (MonoMethodInflated *method)
 MonoGenericInst *
 mono_metadata_get_generic_inst (int type_argc, MonoType **type_argv)
 {
-	MonoGenericInst *ginst;
+	MonoGenericInst *ginst, *cached;
 	gboolean is_open;
 	int i;
 	int size = MONO_SIZEOF_GENERIC_INST + type_argc * sizeof (MonoType *);
@@ -2910,9 +3015,14 @@ mono_metadata_get_generic_inst (int type_argc, MonoType **type_argv)
 
 	collect_data_free (&data);
 
+	/* Lock free lookup, insertions are done with the set lock held */
+	cached = (MonoGenericInst *)mono_conc_hashtable_lookup (set->ginst_cache, ginst);
+	if (cached)
+		return cached;
+
 	mono_image_set_lock (set);
 
-	ginst = (MonoGenericInst *)g_hash_table_lookup (set->ginst_cache, ginst);
+	ginst = (MonoGenericInst *)mono_conc_hashtable_lookup (set->ginst_cache, ginst);
 	if (!ginst) {
 		ginst = (MonoGenericInst *)mono_image_set_alloc0 (set, size);
 #ifndef MONO_SMALL_CONFIG
@@ -2924,7 +3034,7 @@ mono_metadata_get_generic_inst (int type_argc, MonoType **type_argv)
 		for (i = 0; i < type_argc; ++i)
 			ginst->type_argv [i] = mono_metadata_type_dup (NULL, type_argv [i]);
 
-		g_hash_table_insert (set->ginst_cache, ginst, ginst);
+		mono_conc_hashtable_insert (set->ginst_cache, ginst, ginst);
 	}
 
 	mono_image_set_unlock (set);
@@ -4127,6 +4237,84 @@ search_ptr_table (MonoImage *image, int table, int idx)
 		return idx;
 }
 
+/*
+ * Tables with fewer rows are always binary searched, since building the index would
+ * cost more than the searches.
+ */
+#define SORTED_TABLE_INDEX_MIN_ROWS 64
+
+static GHashTable*
+get_sorted_table_index (MonoImage *image, int table, int col)
+{
+	MonoTableInfo *t = &image->tables [table];
+	GHashTable *index;
+	guint32 i, key, prev_key = 0;
+
+	index = (GHashTable *)InterlockedReadPointer ((gpointer *)&image->sorted_table_index [table]);
+	if (!index) {
+		if (image_is_dynamic (image) || t->rows < SORTED_TABLE_INDEX_MIN_ROWS)
+			return NULL;
+
+		index = g_hash_table_new (NULL, NULL);
+		for (i = 0; i < t->rows; ++i) {
+			key = mono_metadata_decode_row_col (t, i, col);
+			if (key < prev_key) {
+				/* Keep using the binary search, which handles unsorted tables the same way as before */
+				g_hash_table_destroy (index);
+				index = (GHashTable *)REFERENCE_MISSING;
+				break;
+			}
+			if (i == 0 || key != prev_key)
+				g_hash_table_insert (index, GUINT_TO_POINTER (key), GUINT_TO_POINTER (i + 1));
+			prev_key = key;
+		}
+
+		/* Another thread might have created the index */
+		if (InterlockedCompareExchangePointer ((gpointer *)&image->sorted_table_index [table], index, NULL) != NULL) {
+			if (index != REFERENCE_MISSING)
+				g_hash_table_destroy (index);
+			index = image->sorted_table_index [table];
+		}
+	}
+	return index == REFERENCE_MISSING ? NULL : index;
+}
+
+/*
+ * sorted_table_lookup:
+ *
+ *   Return the 1-based index of the first row of TABLE, which must be sorted by column COL,
+ * whose column COL is KEY, or 0 if there is no such row. The rows with each key are
+ * looked up in a hash table built the first time TABLE is searched, falling back to
+ * a binary search for small or unsorted tables.
+ */
+static guint32
+sorted_table_lookup (MonoImage *image, int table, int col, guint32 key)
+{
+	MonoTableInfo *t = &image->tables [table];
+	GHashTable *index;
+	locator_t loc;
+
+	if (!t->base)
+		return 0;
+
+	index = get_sorted_table_index (image, table, col);
+	if (index)
+		return GPOINTER_TO_UINT (g_hash_table_lookup (index, GUINT_TO_POINTER (key)));
+
+	loc.idx = key;
+	loc.col_idx = col;
+	loc.t = t;
+
+	if (!mono_binary_search (&loc, t->base, t->rows, t->row_size, table_locator))
+		return 0;
+
+	/* Find the first entry by searching backwards */
+	while ((loc.result > 0) && (mono_metadata_decode_row_col (t, loc.result - 1, col) == key))
+		loc.result --;
+
+	return loc.result + 1;
+}
+
 /**
  * mono_metadata_typedef_from_field:
  * @meta: metadata context
@@ -4208,8 +4396,7 @@ gboolean
 mono_metadata_interfaces_from_typedef_full (MonoImage *meta, guint32 index, MonoClass ***interfaces, guint *count, gboolean heap_alloc_result, MonoGenericContext *context, MonoError *error)
 {
 	MonoTableInfo *tdef = &meta->tables [MONO_TABLE_INTERFACEIMPL];
-	locator_t loc;
-	guint32 start, pos;
+	guint32 start, pos, class_index;
 	guint32 cols [MONO_INTERFACEIMPL_SIZE];
 	MonoClass **result;
 
@@ -4221,27 +4408,16 @@ mono_metadata_interfaces_from_typedef_full (MonoImage *meta, guint32 index, Mono
 	if (!tdef->base)
 		return TRUE;
 
-	loc.idx = mono_metadata_token_index (index);
-	loc.col_idx = MONO_INTERFACEIMPL_CLASS;
-	loc.t = tdef;
-
-	if (!mono_binary_search (&loc, tdef->base, tdef->rows, tdef->row_size, table_locator))
+	class_index = mono_metadata_token_index (index);
+	start = sorted_table_lookup (meta, MONO_TABLE_INTERFACEIMPL, MONO_INTERFACEIMPL_CLASS, class_index);
+	if (!start)
 		return TRUE;
+	start--;
 
-	start = loc.result;
-	/*
-	 * We may end up in the middle of the rows... 
-	 */
-	while (start > 0) {
-		if (loc.idx == mono_metadata_decode_row_col (tdef, start - 1, MONO_INTERFACEIMPL_CLASS))
-			start--;
-		else
-			break;
-	}
 	pos = start;
 	while (pos < tdef->rows) {
 		mono_metadata_decode_row (tdef, pos, cols, MONO_INTERFACEIMPL_SIZE);
-		if (cols [MONO_INTERFACEIMPL_CLASS] != loc.idx)
+		if (cols [MONO_INTERFACEIMPL_CLASS] != class_index)
 			break;
 		++pos;
 	}
@@ -4256,7 +4432,7 @@ mono_metadata_interfaces_from_typedef_full (MonoImage *meta, guint32 index, Mono
 		MonoClass *iface;
 		
 		mono_metadata_decode_row (tdef, pos, cols, MONO_INTERFACEIMPL_SIZE);
-		if (cols [MONO_INTERFACEIMPL_CLASS] != loc.idx)
+		if (cols [MONO_INTERFACEIMPL_CLASS] != class_index)
 			break;
 		iface = mono_class_get_and_inflate_typespec_checked (
 			meta, mono_metadata_token_from_dor (cols [MONO_INTERFACEIMPL_INTERFACE]), context, error);
@@ -4312,20 +4488,13 @@ guint32
 mono_metadata_nested_in_typedef (MonoImage *meta, guint32 index)
 {
 	MonoTableInfo *tdef = &meta->tables [MONO_TABLE_NESTEDCLASS];
-	locator_t loc;
-	
-	if (!tdef->base)
-		return 0;
-
-	loc.idx = mono_metadata_token_index (index);
-	loc.col_idx = MONO_NESTED_CLASS_NESTED;
-	loc.t = tdef;
+	guint32 row;
 
-	if (!mono_binary_search (&loc, tdef->base, tdef->rows, tdef->row_size, table_locator))
+	row = sorted_table_lookup (meta, MONO_TABLE_NESTEDCLASS, MONO_NESTED_CLASS_NESTED, mono_metadata_token_index (index));
+	if (!row)
 		return 0;
 
-	/* loc_result is 0..1, needs to be mapped to table index (that is +1) */
-	return mono_metadata_decode_row_col (tdef, loc.result, MONO_NESTED_CLASS_ENCLOSING) | MONO_TOKEN_TYPE_DEF;
+	return mono_metadata_decode_row_col (tdef, row - 1, MONO_NESTED_CLASS_ENCLOSING) | MONO_TOKEN_TYPE_DEF;
 }
 
 /*
@@ -4410,27 +4579,9 @@ mono_metadata_packing_from_typedef (MonoImage *meta, guint32 index, guint32 *pac
 guint32
 mono_metadata_custom_attrs_from_index (MonoImage *meta, guint32 index)
 {
-	MonoTableInfo *tdef = &meta->tables [MONO_TABLE_CUSTOMATTRIBUTE];
-	locator_t loc;
-	
-	if (!tdef->base)
-		return 0;
-
-	loc.idx = index;
-	loc.col_idx = MONO_CUSTOM_ATTR_PARENT;
-	loc.t = tdef;
-
 	/* FIXME: Index translation */
 
-	if (!mono_binary_search (&loc, tdef->base, tdef->rows, tdef->row_size, table_locator))
-		return 0;
-
-	/* Find the first entry by searching backwards */
-	while ((loc.result > 0) && (mono_metadata_decode_row_col (tdef, loc.result - 1, MONO_CUSTOM_ATTR_PARENT) == index))
-		loc.result --;
-
-	/* loc_result is 0..1, needs to be mapped to table index (that is +1) */
-	return loc.result + 1;
+	return sorted_table_lookup (meta, MONO_TABLE_CUSTOMATTRIBUTE, MONO_CUSTOM_ATTR_PARENT, index);
 }
 
 /*
@@ -5307,7 +5458,6 @@ guint32
 mono_metadata_get_constant_index (MonoImage *meta, guint32 token, guint32 hint)
 {
 	MonoTableInfo *tdef;
-	locator_t loc;
 	guint32 index = mono_metadata_token_index (token);
 
 	tdef = &meta->tables [MONO_TABLE_CONSTANT];
@@ -5326,19 +5476,13 @@ mono_metadata_get_constant_index (MonoImage *meta, guint32 token, guint32 hint)
 		g_warning ("Not a valid token for the constant table: 0x%08x", token);
 		return 0;
 	}
-	loc.idx = index;
-	loc.col_idx = MONO_CONSTANT_PARENT;
-	loc.t = tdef;
 
 	/* FIXME: Index translation */
 
 	if ((hint > 0) && (hint < tdef->rows) && (mono_metadata_decode_row_col (tdef, hint - 1, MONO_CONSTANT_PARENT) == index))
 		return hint;
 
-	if (tdef->base && mono_binary_search (&loc, tdef->base, tdef->rows, tdef->row_size, table_locator)) {
-		return loc.result + 1;
-	}
-	return 0;
+	return sorted_table_lookup (meta, MONO_TABLE_CONSTANT, MONO_CONSTANT_PARENT, index);
 }
 
 /*
@@ -6136,7 +6280,6 @@ guint32
 mono_metadata_get_generic_param_row (MonoImage *image, guint32 token, guint32 *owner)
 {
 	MonoTableInfo *tdef  = &image->tables [MONO_TABLE_GENERICPARAM];
-	locator_t loc;
 
 	g_assert (owner);
 	if (!tdef->base)
@@ -6152,18 +6295,7 @@ mono_metadata_get_generic_param_row (MonoImage *image, guint32 token, guint32 *o
 	}
 	*owner |= mono_metadata_token_index (token) << MONO_TYPEORMETHOD_BITS;
 
-	loc.idx = *owner;
-	loc.col_idx = MONO_GENERICPARAM_OWNER;
-	loc.t = tdef;
-
-	if (!mono_binary_search (&loc, tdef->base, tdef->rows, tdef->row_size, table_locator))
-		return 0;
-
-	/* Find the first entry by searching backwards */
-	while ((loc.result > 0) && (mono_metadata_decode_row_col (tdef, loc.result - 1, MONO_GENERICPARAM_OWNER) == loc.idx))
-		loc.result --;
-
-	return loc.result + 1;
+	return sorted_table_lookup (image, MONO_TABLE_GENERICPARAM, MONO_GENERICPARAM_OWNER, *owner);
 }
 
 gboolean
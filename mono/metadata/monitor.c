@@ -27,8 +27,12 @@
 #include <mono/metadata/tabledefs.h>
 #include <mono/metadata/marshal.h>
 #include <mono/utils/mono-threads.h>
+#include <mono/utils/mono-threads-coop.h>
 #include <mono/metadata/profiler-private.h>
+#include <mono/metadata/lock-contention.h>
+#include <mono/metadata/lock-tracer.h>
 #include <mono/utils/mono-time.h>
+#include <mono/utils/mono-proclib.h>
 #include <mono/utils/atomic.h>
 
 /*
@@ -84,6 +88,30 @@ static MonoThreadsSync *monitor_freelist;
 static MonitorArray *monitor_allocated;
 static int array_size = 16;
 
+/* Upper bound for the number of spin iterations done before blocking on a contended monitor */
+#define MONITOR_SPIN_MAX 1000
+
+/* Whenever spinning can help, i.e. the owner of a lock can run concurrently */
+static gboolean monitor_can_spin;
+
+/*
+ * Biased locking: the first thread locking a free object reserves it, after which it
+ * can enter and exit the lock with plain stores to the lock word instead of atomic
+ * operations. Another thread touching the lock has to revoke the bias first by
+ * suspending the owner, see mon_revoke_bias ().
+ */
+#if SIZEOF_REGISTER == 8
+#define LOCK_WORD_BIASED ((guint64)1 << 63)
+#else
+#define LOCK_WORD_BIASED 0
+#endif
+
+/* Number of revocations after which no new objects are biased since the locks are shared */
+#define MONITOR_BIAS_REVOCATION_LIMIT 1000
+
+static gboolean monitor_biased_locking;
+static gint32 monitor_bias_revocations;
+
 /* MonoThreadsSync status helpers */
 
 static inline guint32
@@ -246,10 +274,81 @@ lock_word_new_flat (gint32 owner)
 	return lw;
 }
 
+static inline gboolean
+lock_word_is_biased (LockWord lw)
+{
+	return (lw.lock_word & LOCK_WORD_BIASED) != 0;
+}
+
+static inline gint32
+lock_word_get_biased_owner (LockWord lw)
+{
+	return (gint32) ((lw.lock_word & ~LOCK_WORD_BIASED) >> LOCK_WORD_OWNER_SHIFT);
+}
+
+static inline gint32
+lock_word_get_biased_count (LockWord lw)
+{
+	/* Unlike flat locks, the count of biased locks starts from 0 */
+	return (lw.lock_word & LOCK_WORD_NEST_MASK) >> LOCK_WORD_NEST_SHIFT;
+}
+
+static inline LockWord
+lock_word_new_biased (gint32 owner)
+{
+	LockWord lw = lock_word_new_flat (owner);
+	lw.lock_word |= LOCK_WORD_BIASED;
+	return lw;
+}
+
+/* Convert a biased lock word to the equivalent free or flat lock word */
+static inline LockWord
+lock_word_unbias (LockWord lw)
+{
+	LockWord nlw;
+	gint32 count = lock_word_get_biased_count (lw);
+
+	if (count == 0) {
+		nlw.lock_word = 0;
+	} else {
+		nlw = lock_word_new_flat (lock_word_get_biased_owner (lw));
+		nlw.lock_word |= (count - 1) << LOCK_WORD_NEST_SHIFT;
+	}
+	return nlw;
+}
+
+/*
+ * The lock word of an object is its synchronisation field, or with small
+ * object headers, an entry in a side table kept up to date by the GC.
+ * Return its address, or NULL if OBJ doesn't have one yet and CREATE is FALSE.
+ */
+static inline volatile gpointer *
+mon_lock_word_address_full (MonoObject *obj, gboolean create)
+{
+#ifdef MONO_SMALL_OBJECT_HEADER
+	return (volatile gpointer *)mono_gc_get_lock_word_address (obj, create);
+#else
+	return (volatile gpointer *)&obj->synchronisation;
+#endif
+}
+
+#define mon_lock_word_address(obj) mon_lock_word_address_full ((obj), TRUE)
+
+static inline MonoThreadsSync *
+mon_lock_word_load (MonoObject *obj)
+{
+	volatile gpointer *addr = mon_lock_word_address_full (obj, FALSE);
+
+	return addr ? (MonoThreadsSync *)*addr : NULL;
+}
+
 void
 mono_monitor_init (void)
 {
 	mono_os_mutex_init_recursive (&monitor_mutex);
+	monitor_can_spin = mono_cpu_count () > 1;
+	/* Revocation suspends the owner, which doesn't stop threads in blocking state under coop */
+	monitor_biased_locking = LOCK_WORD_BIASED && g_getenv ("MONO_BIASED_LOCKING") && !mono_threads_is_coop_enabled ();
 }
  
 void
@@ -442,6 +541,7 @@ mon_new (gsize id)
 	new_->status = mon_status_init_entry_count (new_->status);
 	new_->nest = 1;
 	new_->data = NULL;
+	new_->spin_count = 0;
 	
 #ifndef DISABLE_PERFCOUNTERS
 	mono_perfcounters->gc_sync_blocks++;
@@ -472,6 +572,158 @@ discard_mon (MonoThreadsSync *mon)
 	mono_monitor_allocator_unlock ();
 }
 
+typedef struct {
+	MonoObject *obj;
+	gint32 owner;
+} RevokeBiasData;
+
+static SuspendThreadResult
+revoke_bias_cb (MonoThreadInfo *info, gpointer user_data)
+{
+	RevokeBiasData *data = (RevokeBiasData *)user_data;
+	volatile gpointer *addr;
+	LockWord lw, tmp_lw;
+
+	/* The owner is in the middle of updating the lock word, the caller will try again */
+	if (info->monitor_bias_busy)
+		return MonoResumeThread;
+
+	/* Don't add a lock word, which takes the GC lock the suspended thread might hold */
+	addr = mon_lock_word_address_full (data->obj, FALSE);
+	if (!addr)
+		return MonoResumeThread;
+
+	lw.sync = (MonoThreadsSync *)*addr;
+	if (lock_word_is_biased (lw) && lock_word_get_biased_owner (lw) == data->owner) {
+		tmp_lw.sync = (MonoThreadsSync *)InterlockedCompareExchangePointer (addr, lock_word_unbias (lw).sync, lw.sync);
+		if (tmp_lw.sync == lw.sync && InterlockedIncrement (&monitor_bias_revocations) >= MONITOR_BIAS_REVOCATION_LIMIT)
+			monitor_biased_locking = FALSE;
+	}
+	return MonoResumeThread;
+}
+
+static gboolean
+mon_find_thread (gint32 small_id, MonoNativeThreadId *tid)
+{
+	gboolean found = FALSE;
+
+	FOREACH_THREAD_SAFE (info) {
+		if (info->small_id == small_id) {
+			*tid = mono_thread_info_get_tid (info);
+			found = TRUE;
+			break;
+		}
+	} FOREACH_THREAD_SAFE_END
+
+	return found;
+}
+
+/*
+ * mon_revoke_bias:
+ *
+ *   Convert the lock word of OBJ to a free or flat lock word if it is biased and
+ * return it. The owner of a biased lock updates it with plain stores, so another
+ * thread can only change the lock word while the owner is suspended outside of
+ * such an update, as flagged by monitor_bias_busy.
+ */
+static LockWord
+mon_revoke_bias (MonoObject *obj)
+{
+	LockWord lw;
+	gint32 id = mono_thread_info_get_small_id ();
+
+	for (;;) {
+		MonoNativeThreadId tid;
+		RevokeBiasData data;
+
+		lw.sync = mon_lock_word_load (obj);
+		if (!lock_word_is_biased (lw))
+			return lw;
+
+		data.obj = obj;
+		data.owner = lock_word_get_biased_owner (lw);
+		if (data.owner != id && mon_find_thread (data.owner, &tid)) {
+			mono_thread_info_safe_suspend_and_run (tid, FALSE, revoke_bias_cb, &data);
+			lw.sync = mon_lock_word_load (obj);
+			if (lock_word_is_biased (lw))
+				mono_thread_info_yield ();
+		} else {
+			/* Our own bias, or the owner is gone, so nobody stores to the lock word without a CAS */
+			InterlockedCompareExchangePointer (mon_lock_word_address (obj), lock_word_unbias (lw).sync, lw.sync);
+		}
+	}
+}
+
+/*
+ * mon_read_lock_word:
+ *
+ *   Return the lock word of OBJ, revoking its bias first.
+ */
+static inline LockWord
+mon_read_lock_word (MonoObject *obj)
+{
+	LockWord lw;
+
+	lw.sync = mon_lock_word_load (obj);
+	if (G_UNLIKELY (lock_word_is_biased (lw)))
+		lw = mon_revoke_bias (obj);
+	return lw;
+}
+
+/*
+ * mon_biased_enter:
+ *
+ *   Try to enter the lock of OBJ biased towards the current thread with a plain store.
+ */
+static inline gboolean
+mon_biased_enter (MonoObject *obj, gint32 id)
+{
+	MonoThreadInfo *info = mono_thread_info_current_unchecked ();
+	volatile gpointer *sync = mon_lock_word_address (obj);
+	LockWord lw;
+	gboolean res = FALSE;
+
+	if (!info)
+		return FALSE;
+
+	/* The volatile accesses keep the update of the lock word inside the busy window */
+	info->monitor_bias_busy = 1;
+	lw.sync = (MonoThreadsSync *)*sync;
+	if (lock_word_is_biased (lw) && lock_word_get_biased_owner (lw) == id && !lock_word_is_max_nest (lw)) {
+		*sync = lock_word_increment_nest (lw).sync;
+		res = TRUE;
+	}
+	info->monitor_bias_busy = 0;
+	return res;
+}
+
+/*
+ * mon_biased_exit:
+ *
+ *   Try to exit the lock of OBJ biased towards and held by the current thread with a plain store.
+ */
+static inline gboolean
+mon_biased_exit (MonoObject *obj, gint32 id)
+{
+	MonoThreadInfo *info = mono_thread_info_current_unchecked ();
+	volatile gpointer *sync = mon_lock_word_address (obj);
+	LockWord lw;
+	gboolean res = FALSE;
+
+	if (!info)
+		return FALSE;
+
+	/* The volatile accesses keep the update of the lock word inside the busy window */
+	info->monitor_bias_busy = 1;
+	lw.sync = (MonoThreadsSync *)*sync;
+	if (lock_word_is_biased (lw) && lock_word_get_biased_owner (lw) == id && lock_word_get_biased_count (lw) > 0) {
+		*sync = lock_word_decrement_nest (lw).sync;
+		res = TRUE;
+	}
+	info->monitor_bias_busy = 0;
+	return res;
+}
+
 static void
 mono_monitor_inflate_owned (MonoObject *obj, int id)
 {
@@ -479,7 +731,7 @@ mono_monitor_inflate_owned (MonoObject *obj, int id)
 	LockWord nlw, old_lw, tmp_lw;
 	guint32 nest;
 
-	old_lw.sync = obj->synchronisation;
+	old_lw.sync = mon_lock_word_load (obj);
 	LOCK_DEBUG (g_message ("%s: (%d) Inflating owned lock object %p; LW = %p", __func__, id, obj, old_lw.sync));
 
 	if (lock_word_is_inflated (old_lw)) {
@@ -495,7 +747,7 @@ mono_monitor_inflate_owned (MonoObject *obj, int id)
 	nlw = lock_word_new_inflated (mon);
 
 	mono_memory_write_barrier ();
-	tmp_lw.sync = (MonoThreadsSync *)InterlockedCompareExchangePointer ((gpointer*)&obj->synchronisation, nlw.sync, old_lw.sync);
+	tmp_lw.sync = (MonoThreadsSync *)InterlockedCompareExchangePointer (mon_lock_word_address (obj), nlw.sync, old_lw.sync);
 	if (tmp_lw.sync != old_lw.sync) {
 		/* Someone else inflated the lock in the meantime */
 		discard_mon (mon);
@@ -508,19 +760,22 @@ mono_monitor_inflate (MonoObject *obj)
 	MonoThreadsSync *mon;
 	LockWord nlw, old_lw;
 
-	LOCK_DEBUG (g_message ("%s: (%d) Inflating lock object %p; LW = %p", __func__, mono_thread_info_get_small_id (), obj, obj->synchronisation));
+	LOCK_DEBUG (g_message ("%s: (%d) Inflating lock object %p; LW = %p", __func__, mono_thread_info_get_small_id (), obj, mon_lock_word_load (obj)));
 
 	mon = alloc_mon (obj, 0);
 
 	nlw = lock_word_new_inflated (mon);
 
-	old_lw.sync = obj->synchronisation;
+	old_lw.sync = mon_lock_word_load (obj);
 
 	for (;;) {
 		LockWord tmp_lw;
 
 		if (lock_word_is_inflated (old_lw)) {
 			break;
+		} else if (lock_word_is_biased (old_lw)) {
+			old_lw = mon_revoke_bias (obj);
+			continue;
 		}
 #ifdef HAVE_MOVING_COLLECTOR
 		 else if (lock_word_has_hash (old_lw)) {
@@ -538,7 +793,7 @@ mono_monitor_inflate (MonoObject *obj)
 			mon->nest = lock_word_get_nest (old_lw);
 		}
 		mono_memory_write_barrier ();
-		tmp_lw.sync = (MonoThreadsSync *)InterlockedCompareExchangePointer ((gpointer*)&obj->synchronisation, nlw.sync, old_lw.sync);
+		tmp_lw.sync = (MonoThreadsSync *)InterlockedCompareExchangePointer (mon_lock_word_address (obj), nlw.sync, old_lw.sync);
 		if (tmp_lw.sync == old_lw.sync) {
 			/* Successfully inflated the lock */
 			return;
@@ -567,9 +822,9 @@ mono_object_hash (MonoObject* obj)
 	unsigned int hash;
 	if (!obj)
 		return 0;
-	lw.sync = obj->synchronisation;
+	lw = mon_read_lock_word (obj);
 
-	LOCK_DEBUG (g_message("%s: (%d) Get hash for object %p; LW = %p", __func__, mono_thread_info_get_small_id (), obj, obj->synchronisation));
+	LOCK_DEBUG (g_message("%s: (%d) Get hash for object %p; LW = %p", __func__, mono_thread_info_get_small_id (), obj, mon_lock_word_load (obj)));
 
 	if (lock_word_has_hash (lw)) {
 		if (lock_word_is_inflated (lw)) {
@@ -594,7 +849,7 @@ mono_object_hash (MonoObject* obj)
 		LockWord old_lw;
 		lw = lock_word_new_thin_hash (hash);
 
-		old_lw.sync = (MonoThreadsSync *)InterlockedCompareExchangePointer ((gpointer*)&obj->synchronisation, lw.sync, NULL);
+		old_lw.sync = (MonoThreadsSync *)InterlockedCompareExchangePointer (mon_lock_word_address (obj), lw.sync, NULL);
 		if (old_lw.sync == NULL) {
 			return hash;
 		}
@@ -605,21 +860,21 @@ mono_object_hash (MonoObject* obj)
 		}
 			
 		mono_monitor_inflate (obj);
-		lw.sync = obj->synchronisation;
+		lw.sync = mon_lock_word_load (obj);
 	} else if (lock_word_is_flat (lw)) {
 		int id = mono_thread_info_get_small_id ();
 		if (lock_word_get_owner (lw) == id)
 			mono_monitor_inflate_owned (obj, id);
 		else
 			mono_monitor_inflate (obj);
-		lw.sync = obj->synchronisation;
+		lw.sync = mon_lock_word_load (obj);
 	}
 
 	/* At this point, the lock is inflated */
 	lock_word_get_inflated_lock (lw)->hash_code = hash;
 	lw = lock_word_set_has_hash (lw);
 	mono_memory_write_barrier ();
-	obj->synchronisation = lw.sync;
+	*mon_lock_word_address (obj) = lw.sync;
 	return hash;
 #else
 /*
@@ -656,7 +911,7 @@ mono_monitor_exit_inflated (MonoObject *obj)
 	MonoThreadsSync *mon;
 	guint32 nest;
 
-	lw.sync = obj->synchronisation;
+	lw.sync = mon_lock_word_load (obj);
 	mon = lock_word_get_inflated_lock (lw);
 
 	nest = mon->nest - 1;
@@ -710,13 +965,13 @@ mono_monitor_exit_flat (MonoObject *obj, LockWord old_lw)
 	else
 		new_lw.lock_word = 0;
 
-	tmp_lw.sync = (MonoThreadsSync *)InterlockedCompareExchangePointer ((gpointer*)&obj->synchronisation, new_lw.sync, old_lw.sync);
+	tmp_lw.sync = (MonoThreadsSync *)InterlockedCompareExchangePointer (mon_lock_word_address (obj), new_lw.sync, old_lw.sync);
 	if (old_lw.sync != tmp_lw.sync) {
 		/* Someone inflated the lock in the meantime */
 		mono_monitor_exit_inflated (obj);
 	}
 
-	LOCK_DEBUG (g_message ("%s: (%d) Object %p is now locked %d times; LW = %p", __func__, mono_thread_info_get_small_id (), obj, lock_word_get_nest (new_lw), obj->synchronisation));
+	LOCK_DEBUG (g_message ("%s: (%d) Object %p is now locked %d times; LW = %p", __func__, mono_thread_info_get_small_id (), obj, lock_word_get_nest (new_lw), mon_lock_word_load (obj)));
 }
 
 static void
@@ -736,6 +991,40 @@ mon_decrement_entry_count (MonoThreadsSync *mon)
 	}
 }
 
+/*
+ * mon_spin_enter:
+ *
+ *   Spin for a while waiting for the owner of MON to release it, since locks are usually
+ * held for a short time and blocking on the semaphore means two context switches. The number
+ * of iterations adapts to how long it took to acquire MON in the past, so monitors which are
+ * held for a long time stop wasting CPU time. Returns whenever the lock was acquired.
+ */
+static gboolean
+mon_spin_enter (MonoThreadsSync *mon, guint32 id)
+{
+	guint32 new_status, old_status;
+	gint32 i, max_spin;
+
+	if (!monitor_can_spin)
+		return FALSE;
+
+	max_spin = MIN (mon->spin_count * 2 + 10, MONITOR_SPIN_MAX);
+	for (i = 0; i < max_spin; ++i) {
+		mono_cpu_relax ();
+		old_status = mon->status;
+		if (mon_status_get_owner (old_status) == 0) {
+			new_status = mon_status_set_owner (old_status, id);
+			if (InterlockedCompareExchange ((gint32*)&mon->status, new_status, old_status) == old_status) {
+				/* The updates of spin_count are racy, but it is only a heuristic */
+				mon->spin_count += (i - mon->spin_count) / 8;
+				return TRUE;
+			}
+		}
+	}
+	mon->spin_count += (max_spin - mon->spin_count) / 8;
+	return FALSE;
+}
+
 /* If allow_interruption==TRUE, the method will be interrumped if abort or suspend
  * is requested. In this case it returns -1.
  */ 
@@ -751,6 +1040,8 @@ mono_monitor_try_enter_inflated (MonoObject *obj, guint32 ms, gboolean allow_int
 	MonoSemTimedwaitRet wait_ret;
 	MonoInternalThread *thread;
 	gboolean interrupted = FALSE;
+	gint64 contention_start = 0;
+	gint32 contention_owner = 0;
 
 	LOCK_DEBUG (g_message("%s: (%d) Trying to lock object %p (%d ms)", __func__, id, obj, ms));
 
@@ -759,7 +1050,7 @@ mono_monitor_try_enter_inflated (MonoObject *obj, guint32 ms, gboolean allow_int
 		return FALSE;
 	}
 
-	lw.sync = obj->synchronisation;
+	lw.sync = mon_lock_word_load (obj);
 	mon = lock_word_get_inflated_lock (lw);
 retry:
 	/* This case differs from Dice's case 3 because we don't
@@ -800,8 +1091,18 @@ retry:
 		return 0;
 	}
 
+	if (mon_spin_enter (mon, id)) {
+		g_assert (mon->nest == 1);
+		return 1;
+	}
+
 	mono_profiler_monitor_event (obj, MONO_PROFILER_MONITOR_CONTENTION);
 
+	if (G_UNLIKELY (mono_lock_contention_enabled)) {
+		contention_start = mono_100ns_ticks ();
+		contention_owner = mon_status_get_owner (mon->status);
+	}
+
 	/* The slow path begins here. */
 retry_contended:
 	/* a small amount of duplicated code, but it allows us to insert the profiler
@@ -824,6 +1125,8 @@ retry_contended:
 			/* Success */
 			g_assert (mon->nest == 1);
 			mono_profiler_monitor_event (obj, MONO_PROFILER_MONITOR_DONE);
+			if (G_UNLIKELY (contention_start))
+				mono_lock_contention_monitor (obj, contention_start, contention_owner);
 			return 1;
 		}
 	}
@@ -832,6 +1135,8 @@ retry_contended:
 	if (mon_status_get_owner (old_status) == id) {
 		mon->nest++;
 		mono_profiler_monitor_event (obj, MONO_PROFILER_MONITOR_DONE);
+		if (G_UNLIKELY (contention_start))
+			mono_lock_contention_monitor (obj, contention_start, contention_owner);
 		return 1;
 	}
 
@@ -949,14 +1254,29 @@ mono_monitor_try_enter_internal (MonoObject *obj, guint32 ms, gboolean allow_int
 {
 	LockWord lw;
 	int id = mono_thread_info_get_small_id ();
+	gboolean bias = monitor_biased_locking;
 
 	LOCK_DEBUG (g_message("%s: (%d) Trying to lock object %p (%d ms)", __func__, id, obj, ms));
 
-	lw.sync = obj->synchronisation;
+	lw.sync = mon_lock_word_load (obj);
+
+	if (G_UNLIKELY (lock_word_is_biased (lw))) {
+		if (mon_biased_enter (obj, id))
+			return 1;
+		/* Don't bias the object towards us right after revoking the bias of another thread */
+		lw = mon_revoke_bias (obj);
+		bias = FALSE;
+	}
 
 	if (G_LIKELY (lock_word_is_free (lw))) {
 		LockWord nlw = lock_word_new_flat (id);
-		if (InterlockedCompareExchangePointer ((gpointer*)&obj->synchronisation, nlw.sync, NULL) == NULL) {
+		if (G_UNLIKELY (bias)) {
+			MonoThreadInfo *info = mono_thread_info_current_unchecked ();
+			/* Revocation only finds threads which are not tools threads */
+			if (info && !info->tools_thread)
+				nlw = lock_word_increment_nest (lock_word_new_biased (id));
+		}
+		if (InterlockedCompareExchangePointer (mon_lock_word_address (obj), nlw.sync, NULL) == NULL) {
 			return 1;
 		} else {
 			/* Someone acquired it in the meantime or put a hash */
@@ -973,7 +1293,7 @@ mono_monitor_try_enter_internal (MonoObject *obj, guint32 ms, gboolean allow_int
 			} else {
 				LockWord nlw, old_lw;
 				nlw = lock_word_increment_nest (lw);
-				old_lw.sync = (MonoThreadsSync *)InterlockedCompareExchangePointer ((gpointer*)&obj->synchronisation, nlw.sync, lw.sync);
+				old_lw.sync = (MonoThreadsSync *)InterlockedCompareExchangePointer (mon_lock_word_address (obj), nlw.sync, lw.sync);
 				if (old_lw.sync != lw.sync) {
 					/* Someone else inflated it in the meantime */
 					g_assert (lock_word_is_inflated (old_lw));
@@ -1037,7 +1357,13 @@ mono_monitor_exit (MonoObject *obj)
 		return;
 	}
 
-	lw.sync = obj->synchronisation;
+	lw.sync = mon_lock_word_load (obj);
+
+	if (G_UNLIKELY (lock_word_is_biased (lw))) {
+		if (mon_biased_exit (obj, mono_thread_info_get_small_id ()))
+			return;
+		lw = mon_revoke_bias (obj);
+	}
 
 	if (!mono_monitor_ensure_owned (lw, mono_thread_info_get_small_id ()))
 		return;
@@ -1053,7 +1379,7 @@ mono_monitor_get_object_monitor_gchandle (MonoObject *object)
 {
 	LockWord lw;
 
-	lw.sync = object->synchronisation;
+	lw.sync = mon_lock_word_load (object);
 
 	if (lock_word_is_inflated (lw)) {
 		MonoThreadsSync *mon = lock_word_get_inflated_lock (lw);
@@ -1141,9 +1467,11 @@ ves_icall_System_Threading_Monitor_Monitor_test_owner (MonoObject *obj)
 
 	LOCK_DEBUG (g_message ("%s: Testing if %p is owned by thread %d", __func__, obj, mono_thread_info_get_small_id()));
 
-	lw.sync = obj->synchronisation;
+	lw.sync = mon_lock_word_load (obj);
 
-	if (lock_word_is_flat (lw)) {
+	if (lock_word_is_biased (lw)) {
+		return lock_word_get_biased_owner (lw) == mono_thread_info_get_small_id () && lock_word_get_biased_count (lw) > 0;
+	} else if (lock_word_is_flat (lw)) {
 		return lock_word_get_owner (lw) == mono_thread_info_get_small_id ();
 	} else if (lock_word_is_inflated (lw)) {
 		return mon_status_get_owner (lock_word_get_inflated_lock (lw)->status) == mono_thread_info_get_small_id ();
@@ -1159,9 +1487,11 @@ ves_icall_System_Threading_Monitor_Monitor_test_synchronised (MonoObject *obj)
 
 	LOCK_DEBUG (g_message("%s: (%d) Testing if %p is owned by any thread", __func__, mono_thread_info_get_small_id (), obj));
 
-	lw.sync = obj->synchronisation;
+	lw.sync = mon_lock_word_load (obj);
 
-	if (lock_word_is_flat (lw)) {
+	if (lock_word_is_biased (lw)) {
+		return lock_word_get_biased_count (lw) > 0;
+	} else if (lock_word_is_flat (lw)) {
 		return !lock_word_is_free (lw);
 	} else if (lock_word_is_inflated (lw)) {
 		return mon_status_get_owner (lock_word_get_inflated_lock (lw)->status) != 0;
@@ -1185,7 +1515,7 @@ ves_icall_System_Threading_Monitor_Monitor_pulse (MonoObject *obj)
 	LOCK_DEBUG (g_message ("%s: (%d) Pulsing %p", __func__, mono_thread_info_get_small_id (), obj));
 	
 	id = mono_thread_info_get_small_id ();
-	lw.sync = obj->synchronisation;
+	lw = mon_read_lock_word (obj);
 
 	if (!mono_monitor_ensure_owned (lw, id))
 		return;
@@ -1217,7 +1547,7 @@ ves_icall_System_Threading_Monitor_Monitor_pulse_all (MonoObject *obj)
 	LOCK_DEBUG (g_message("%s: (%d) Pulsing all %p", __func__, mono_thread_info_get_small_id (), obj));
 
 	id = mono_thread_info_get_small_id ();
-	lw.sync = obj->synchronisation;
+	lw = mon_read_lock_word (obj);
 
 	if (!mono_monitor_ensure_owned (lw, id))
 		return;
@@ -1254,14 +1584,14 @@ ves_icall_System_Threading_Monitor_Monitor_wait (MonoObject *obj, guint32 ms)
 
 	LOCK_DEBUG (g_message ("%s: (%d) Trying to wait for %p with timeout %dms", __func__, mono_thread_info_get_small_id (), obj, ms));
 
-	lw.sync = obj->synchronisation;
+	lw = mon_read_lock_word (obj);
 
 	if (!mono_monitor_ensure_owned (lw, id))
 		return FALSE;
 
 	if (!lock_word_is_inflated (lw)) {
 		mono_monitor_inflate_owned (obj, id);
-		lw.sync = obj->synchronisation;
+		lw.sync = mon_lock_word_load (obj);
 	}
 
 	mon = lock_word_get_inflated_lock (lw);
@@ -43,6 +43,8 @@ struct _MonoThreadsSync
 	GSList *wait_list;
 	void *data;
 	MonoCoopSem *entry_sem;
+	/* Running average of the spin iterations needed to acquire the lock, see mon_spin_enter () */
+	gint32 spin_count;
 };
 
 /*
@@ -74,6 +76,11 @@ struct _MonoThreadsSync
  * count starts from 0 for the lock word (just valid thread ID in the lock word
  * means that the thread holds the lock once, although nest is 0).
  * FIXME Have the same convention on inflated locks
+ *
+ * On 64-bit, if biased locking is enabled (MONO_BIASED_LOCKING), the top bit of a flat
+ * lock word marks it as biased towards its owner, and the nest field then holds the
+ * number of times the owner holds the lock, starting from 0:
+ *          LOCK_WORD_BIASED:    [biased:1 | unused:21 | owner:32 | count:8 | status:2]
  */
 
 typedef union {
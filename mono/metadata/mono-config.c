@@ -19,6 +19,12 @@
 #include "mono/metadata/metadata-internals.h"
 #include "mono/metadata/object-internals.h"
 #include "mono/utils/mono-logger-internals.h"
+#include "mono/utils/mono-digest.h"
+#include "mono/utils/mono-mmap.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #if defined(TARGET_PS3)
 #define CONFIG_OS "CellOS"
@@ -475,19 +481,327 @@ mono_config_cleanup (void)
 
 /* FIXME: error handling */
 
+static gboolean
+mono_config_parse_xml_with_parser (const GMarkupParser *parser, gpointer user_data, const char *text, gsize len)
+{
+	GMarkupParseContext *context;
+	gboolean res = FALSE;
+
+	context = g_markup_parse_context_new (parser, (GMarkupParseFlags)0, user_data, NULL);
+	if (g_markup_parse_context_parse (context, text, len, NULL))
+		res = g_markup_parse_context_end_parse (context, NULL);
+	g_markup_parse_context_free (context);
+	return res;
+}
+
 static void
 mono_config_parse_xml_with_context (ParseState *state, const char *text, gsize len)
 {
-	GMarkupParseContext *context;
+	if (!inited)
+		mono_config_init ();
+
+	mono_config_parse_xml_with_parser (&mono_parser, state, text, len);
+}
+
+/*
+ * Compiled configuration files.
+ *
+ * With MONO_CONFIG_CACHE set to a directory, each configuration file is parsed
+ * as XML once, and the parser events it produced are saved to a binary file in
+ * that directory. Later runs map the binary file and replay the events through
+ * the same handlers, without going through gmarkup. The compiled file records
+ * the path, size and modification time of its source, and is ignored when they
+ * don't match.
+ *
+ * A compiled file is a CompiledConfigHeader, the path of the source, and the
+ * events, each one a tag byte followed by:
+ * - CONFIG_EVENT_START: the element name and a guint32 attribute count, followed
+ *   by the name and value of each attribute.
+ * - CONFIG_EVENT_END: the element name.
+ * - CONFIG_EVENT_TEXT: the text.
+ * Strings are a guint32 length, followed by the characters and a nul.
+ */
+
+#define COMPILED_CONFIG_MAGIC "MCFG"
+#define COMPILED_CONFIG_VERSION 1
+
+enum {
+	CONFIG_EVENT_START = 1,
+	CONFIG_EVENT_END,
+	CONFIG_EVENT_TEXT
+};
+
+typedef struct {
+	char magic [4];
+	guint32 version;
+	guint64 source_size;
+	gint64 source_mtime;
+	guint32 path_len;
+} CompiledConfigHeader;
+
+typedef struct {
+	ParseState *state;
+	GByteArray *events;
+} RecordState;
+
+static const char *compiled_config_dir;
+static gboolean compiled_config_dir_inited;
+
+static const char*
+get_compiled_config_dir (void)
+{
+	if (!compiled_config_dir_inited) {
+		const char *dir = g_getenv ("MONO_CONFIG_CACHE");
+
+		compiled_config_dir = dir && *dir ? dir : NULL;
+		compiled_config_dir_inited = TRUE;
+	}
+	return compiled_config_dir;
+}
+
+static char*
+compiled_config_path (const char *filename)
+{
+	guchar digest [16];
+	char name [40];
+	int i;
+
+	mono_md5_get_digest ((const guchar *)filename, strlen (filename), digest);
+	for (i = 0; i < 16; ++i)
+		sprintf (name + i * 2, "%02x", digest [i]);
+	strcpy (name + 32, ".mcfg");
+	return g_build_filename (get_compiled_config_dir (), name, NULL);
+}
+
+static void
+record_string (GByteArray *events, const char *str, gsize len)
+{
+	guint32 len32 = (guint32)len;
+
+	g_byte_array_append (events, (const guint8 *)&len32, sizeof (len32));
+	g_byte_array_append (events, (const guint8 *)str, len);
+	g_byte_array_append (events, (const guint8 *)"", 1);
+}
+
+static void
+record_start_element (GMarkupParseContext *context, const gchar *element_name, const gchar **attribute_names,
+					  const gchar **attribute_values, gpointer user_data, GError **error)
+{
+	RecordState *rs = (RecordState *)user_data;
+	guint8 tag = CONFIG_EVENT_START;
+	guint32 i, count = 0;
+
+	while (attribute_names [count])
+		count++;
+
+	g_byte_array_append (rs->events, &tag, 1);
+	record_string (rs->events, element_name, strlen (element_name));
+	g_byte_array_append (rs->events, (const guint8 *)&count, sizeof (count));
+	for (i = 0; i < count; ++i) {
+		record_string (rs->events, attribute_names [i], strlen (attribute_names [i]));
+		record_string (rs->events, attribute_values [i], strlen (attribute_values [i]));
+	}
+
+	start_element (context, element_name, attribute_names, attribute_values, rs->state, error);
+}
+
+static void
+record_end_element (GMarkupParseContext *context, const gchar *element_name, gpointer user_data, GError **error)
+{
+	RecordState *rs = (RecordState *)user_data;
+	guint8 tag = CONFIG_EVENT_END;
+
+	g_byte_array_append (rs->events, &tag, 1);
+	record_string (rs->events, element_name, strlen (element_name));
+
+	end_element (context, element_name, rs->state, error);
+}
+
+static void
+record_text (GMarkupParseContext *context, const gchar *text, gsize text_len, gpointer user_data, GError **error)
+{
+	RecordState *rs = (RecordState *)user_data;
+	guint8 tag = CONFIG_EVENT_TEXT;
+
+	g_byte_array_append (rs->events, &tag, 1);
+	record_string (rs->events, text, text_len);
+
+	parse_text (context, text, text_len, rs->state, error);
+}
+
+static void
+record_error (GMarkupParseContext *context, GError *error, gpointer user_data)
+{
+	parse_error (context, error, ((RecordState *)user_data)->state);
+}
+
+static const GMarkupParser
+record_parser = {
+	record_start_element,
+	record_end_element,
+	record_text,
+	passthrough,
+	record_error
+};
+
+static gboolean
+read_string (const guint8 **p, const guint8 *end, const char **str, gsize *len)
+{
+	guint32 len32;
+
+	if (end - *p < sizeof (len32))
+		return FALSE;
+	memcpy (&len32, *p, sizeof (len32));
+	*p += sizeof (len32);
+	if (end - *p < (gssize)len32 + 1 || (*p) [len32] != '\0')
+		return FALSE;
+	*str = (const char *)*p;
+	*len = len32;
+	*p += len32 + 1;
+	return TRUE;
+}
+
+/*
+ * Go through the events in [P, END), passing them to the handlers of STATE, or
+ * only checking that they are well formed if STATE is NULL.
+ */
+static gboolean
+replay_events (ParseState *state, const guint8 *p, const guint8 *end)
+{
+	const char *name, *str;
+	const gchar **names, **values;
+	gsize len;
+	guint32 i, count;
+
+	while (p < end) {
+		switch (*p++) {
+		case CONFIG_EVENT_START:
+			if (!read_string (&p, end, &name, &len) || end - p < sizeof (count))
+				return FALSE;
+			memcpy (&count, p, sizeof (count));
+			p += sizeof (count);
+			if (count > (end - p) / 2)
+				return FALSE;
+			names = g_new (const gchar *, count + 1);
+			values = g_new (const gchar *, count + 1);
+			for (i = 0; i < count; ++i) {
+				if (!read_string (&p, end, &names [i], &len) || !read_string (&p, end, &values [i], &len)) {
+					g_free (names);
+					g_free (values);
+					return FALSE;
+				}
+			}
+			names [count] = values [count] = NULL;
+			if (state)
+				start_element (NULL, name, names, values, state, NULL);
+			g_free (names);
+			g_free (values);
+			break;
+		case CONFIG_EVENT_END:
+			if (!read_string (&p, end, &name, &len))
+				return FALSE;
+			if (state)
+				end_element (NULL, name, state, NULL);
+			break;
+		case CONFIG_EVENT_TEXT:
+			if (!read_string (&p, end, &str, &len))
+				return FALSE;
+			if (state)
+				parse_text (NULL, str, len, state, NULL);
+			break;
+		default:
+			return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+/*
+ * Replay the compiled form of FILENAME, whose current attributes are in ST,
+ * through STATE. Returns FALSE if there is no up to date compiled form.
+ */
+static gboolean
+load_compiled_config (ParseState *state, const char *filename, struct stat *st)
+{
+	CompiledConfigHeader header;
+	MonoFileMap *fmap;
+	const guint8 *data, *events, *end;
+	void *handle;
+	guint64 size;
+	char *path;
+	gboolean res = FALSE;
+
+	path = compiled_config_path (filename);
+	fmap = mono_file_map_open (path);
+	g_free (path);
+	if (!fmap)
+		return FALSE;
+
+	size = mono_file_map_size (fmap);
+	if (size < sizeof (header) || size > G_MAXINT32) {
+		mono_file_map_close (fmap);
+		return FALSE;
+	}
+	data = (const guint8 *)mono_file_map ((size_t)size, MONO_MMAP_READ|MONO_MMAP_PRIVATE, mono_file_map_fd (fmap), 0, &handle);
+	mono_file_map_close (fmap);
+	if (!data)
+		return FALSE;
+
+	end = data + size;
+	memcpy (&header, data, sizeof (header));
+	if (!memcmp (header.magic, COMPILED_CONFIG_MAGIC, 4) && header.version == COMPILED_CONFIG_VERSION &&
+		header.source_size == (guint64)st->st_size && header.source_mtime == (gint64)st->st_mtime &&
+		header.path_len == strlen (filename) && header.path_len <= size - sizeof (header) &&
+		!memcmp (data + sizeof (header), filename, header.path_len)) {
+		events = data + sizeof (header) + header.path_len;
+		res = replay_events (NULL, events, end);
+	}
+	if (res) {
+		mono_trace (G_LOG_LEVEL_INFO, MONO_TRACE_CONFIG, "Config using compiled form of: '%s'.", filename);
+		if (!inited)
+			mono_config_init ();
+		replay_events (state, events, end);
+	}
+
+	mono_file_unmap ((void *)data, handle);
+	return res;
+}
+
+/*
+ * Parse the XML in TEXT, and save the events it produced as the compiled form
+ * of FILENAME.
+ */
+static void
+parse_and_compile_config (ParseState *state, const char *filename, struct stat *st, const char *text, gsize len)
+{
+	CompiledConfigHeader header;
+	RecordState rs;
+	char *path;
 
 	if (!inited)
 		mono_config_init ();
 
-	context = g_markup_parse_context_new (&mono_parser, (GMarkupParseFlags)0, state, NULL);
-	if (g_markup_parse_context_parse (context, text, len, NULL)) {
-		g_markup_parse_context_end_parse (context, NULL);
+	rs.state = state;
+	rs.events = g_byte_array_new ();
+
+	memset (&header, 0, sizeof (header));
+	memcpy (header.magic, COMPILED_CONFIG_MAGIC, 4);
+	header.version = COMPILED_CONFIG_VERSION;
+	header.source_size = st->st_size;
+	header.source_mtime = st->st_mtime;
+	header.path_len = strlen (filename);
+	g_byte_array_append (rs.events, (const guint8 *)&header, sizeof (header));
+	g_byte_array_append (rs.events, (const guint8 *)filename, header.path_len);
+
+	/* A file changed in the same second as it was parsed could keep its modification time */
+	if (mono_config_parse_xml_with_parser (&record_parser, &rs, text, len) && st->st_mtime < time (NULL)) {
+		path = compiled_config_path (filename);
+		if (!g_file_set_contents (path, (const gchar *)rs.events->data, rs.events->len, NULL))
+			mono_trace (G_LOG_LEVEL_INFO, MONO_TRACE_CONFIG, "Config could not save compiled form to: '%s'.", path);
+		g_free (path);
 	}
-	g_markup_parse_context_free (context);
+
+	g_byte_array_free (rs.events, TRUE);
 }
 
 /* If assembly is NULL, parse in the global context */
@@ -497,19 +811,28 @@ mono_config_parse_file_with_context (ParseState *state, const char *filename)
 	gchar *text;
 	gsize len;
 	gint offset;
+	struct stat st;
+	gboolean compile;
 
 	mono_trace (G_LOG_LEVEL_INFO, MONO_TRACE_CONFIG,
 			"Config attempting to parse: '%s'.", filename);
 
+	compile = get_compiled_config_dir () && stat (filename, &st) == 0;
+	if (state->user_data == NULL)
+		state->user_data = (gpointer) filename;
+	if (compile && load_compiled_config (state, filename, &st))
+		return 1;
+
 	if (!g_file_get_contents (filename, &text, &len, NULL))
 		return 0;
 
 	offset = 0;
 	if (len > 3 && text [0] == '\xef' && text [1] == (gchar) '\xbb' && text [2] == '\xbf')
 		offset = 3; /* Skip UTF-8 BOM */
-	if (state->user_data == NULL)
-		state->user_data = (gpointer) filename;
-	mono_config_parse_xml_with_context (state, text + offset, len - offset);
+	if (compile)
+		parse_and_compile_config (state, filename, &st, text + offset, len - offset);
+	else
+		mono_config_parse_xml_with_context (state, text + offset, len - offset);
 	g_free (text);
 	return 1;
 }
@@ -38,10 +38,13 @@
 #define mg_new0(type,n)  ((type *) GC_MALLOC(sizeof(type) * (n)))
 #define mg_new(type,n)   ((type *) GC_MALLOC(sizeof(type) * (n)))
 #define mg_free(x)       do { } while (0)
+/* In incremental mode, stores into GC_MALLOCed memory must dirty its card */
+#define mg_dirty(p)      mono_gc_wbarrier_generic_nostore (p)
 #else
 #define mg_new0(x,n)     g_new0(x,n)
 #define mg_new(type,n)   g_new(type,n)
 #define mg_free(x)       g_free(x)
+#define mg_dirty(p)      do { } while (0)
 #endif
 
 typedef struct _Slot Slot;
@@ -186,6 +189,7 @@ do_rehash (void *_data)
 	/* printf ("New size: %d\n", hash->table_size); */
 	table = hash->table;
 	hash->table = data->table;
+	mg_dirty (&hash->table);
 
 	for (i = 0; i < current_size; i++){
 		Slot *s, *next;
@@ -195,7 +199,9 @@ do_rehash (void *_data)
 			next = s->next;
 
 			s->next = hash->table [hashcode];
+			mg_dirty (&s->next);
 			hash->table [hashcode] = s;
+			mg_dirty (&hash->table [hashcode]);
 		}
 	}
 	return table;
@@ -323,10 +329,13 @@ mono_g_hash_table_remove (MonoGHashTable *hash, gconstpointer key)
 				(*hash->key_destroy_func)(s->key);
 			if (hash->value_destroy_func != NULL)
 				(*hash->value_destroy_func)(s->value);
-			if (last == NULL)
+			if (last == NULL) {
 				hash->table [hashcode] = s->next;
-			else
+				mg_dirty (&hash->table [hashcode]);
+			} else {
 				last->next = s->next;
+				mg_dirty (&last->next);
+			}
 			free_slot (hash, s);
 			hash->in_use--;
 			return TRUE;
@@ -359,9 +368,11 @@ mono_g_hash_table_foreach_remove (MonoGHashTable *hash, GHRFunc func, gpointer u
 					(*hash->value_destroy_func)(s->value);
 				if (last == NULL){
 					hash->table [i] = s->next;
+					mg_dirty (&hash->table [i]);
 					n = s->next;
 				} else  {
 					last->next = s->next;
+					mg_dirty (&last->next);
 					n = last->next;
 				}
 				free_slot (hash, s);
@@ -427,10 +438,12 @@ mono_g_hash_table_insert_replace (MonoGHashTable *hash, gpointer key, gpointer v
 				if (hash->key_destroy_func != NULL)
 					(*hash->key_destroy_func)(s->key);
 				s->key = (MonoObject *)key;
+				mg_dirty (&s->key);
 			}
 			if (hash->value_destroy_func != NULL)
 				(*hash->value_destroy_func) (s->value);
 			s->value = (MonoObject *)value;
+			mg_dirty (&s->value);
 			return;
 		}
 	}
@@ -438,7 +451,10 @@ mono_g_hash_table_insert_replace (MonoGHashTable *hash, gpointer key, gpointer v
 	s->key = (MonoObject *)key;
 	s->value = (MonoObject *)value;
 	s->next = hash->table [hashcode];
+	mg_dirty (&s->key);
+	mg_dirty (&s->next);
 	hash->table [hashcode] = s;
+	mg_dirty (&hash->table [hashcode]);
 	hash->in_use++;
 }
 
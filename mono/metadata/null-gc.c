@@ -412,6 +412,12 @@ mono_gc_is_moving (void)
 	return FALSE;
 }
 
+gboolean
+mono_gc_needs_write_barriers (void)
+{
+	return FALSE;
+}
+
 gboolean
 mono_gc_is_disabled (void)
 {
@@ -18,6 +18,7 @@
 // Ported from C++ to C and adjusted to Mono runtime
 
 #include <glib.h>
+#include <string.h>
 
 #include "number-ms.h"
 
@@ -328,3 +329,411 @@ mono_double_from_number (gpointer from, MonoDouble *target)
 	*target = res.s;
 	return 1;
 }
+
+/*
+ * Invariant culture fast paths for formatting and parsing numbers, which
+ * write to a caller provided buffer instead of going through a MonoNumber
+ * and the NumberFormatInfo of the current culture.
+ */
+
+static const char digit_pairs [] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+/*
+ * mono_number_format_uint64:
+ *
+ *   Write @value in decimal to @buffer, which must have room for
+ * MONO_NUMBER_FORMAT_BUFFER_SIZE characters. Returns the number of
+ * characters written.
+ */
+gint32
+mono_number_format_uint64 (guint64 value, gunichar2 *buffer)
+{
+	gunichar2 tmp [20];
+	gint32 pos = 20, i;
+
+	while (value >= 100) {
+		guint pair = (guint) (value % 100) * 2;
+
+		value /= 100;
+		tmp [--pos] = digit_pairs [pair + 1];
+		tmp [--pos] = digit_pairs [pair];
+	}
+	if (value >= 10) {
+		tmp [--pos] = digit_pairs [value * 2 + 1];
+		tmp [--pos] = digit_pairs [value * 2];
+	} else {
+		tmp [--pos] = (gunichar2) ('0' + value);
+	}
+
+	for (i = 0; pos < 20; ++i, ++pos)
+		buffer [i] = tmp [pos];
+	return i;
+}
+
+gint32
+mono_number_format_int64 (gint64 value, gunichar2 *buffer)
+{
+	if (value >= 0)
+		return mono_number_format_uint64 ((guint64) value, buffer);
+
+	buffer [0] = '-';
+	return 1 + mono_number_format_uint64 (0 - (guint64) value, buffer + 1);
+}
+
+/*
+ * Grisu2, from "Printing Floating-Point Numbers Quickly and Accurately with
+ * Integers" by Florian Loitsch. It always produces digits that parse back to
+ * the same double and, in all but a few rare cases, the shortest ones.
+ */
+
+typedef struct {
+	guint64 f;
+	gint e;
+} DiyFp;
+
+#define DP_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFULL
+#define DP_EXPONENT_MASK 0x7FF0000000000000ULL
+#define DP_HIDDEN_BIT 0x0010000000000000ULL
+#define DP_EXPONENT_BIAS (0x3FF + 52)
+
+/* 10^-348, 10^-340, ..., 10^340 as normalized DiyFp */
+static const guint64 cached_powers_f [] = {
+	0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+	0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+	0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+	0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+	0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+	0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+	0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+	0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+	0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+	0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+	0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+	0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+	0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+	0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+	0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+	0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+	0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+	0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+	0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+	0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+	0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+	0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+	0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+	0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+	0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+	0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+	0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+	0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+	0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+static const gint16 cached_powers_e [] = {
+	-1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+	-954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+	-688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+	-422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+	-157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+	109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+	375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+	641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+	907, 933, 960, 986, 1013, 1039, 1066,
+};
+
+static DiyFp
+diy_fp_multiply (DiyFp x, DiyFp y)
+{
+	const guint64 m32 = 0xFFFFFFFFULL;
+	guint64 a = x.f >> 32, b = x.f & m32, c = y.f >> 32, d = y.f & m32;
+	guint64 ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+	guint64 tmp = (bd >> 32) + (ad & m32) + (bc & m32);
+	DiyFp r;
+
+	/* Round */
+	tmp += 1U << 31;
+	r.f = ac + (ad >> 32) + (bc >> 32) + (tmp >> 32);
+	r.e = x.e + y.e + 64;
+	return r;
+}
+
+static DiyFp
+diy_fp_normalize (DiyFp x, guint64 top_bit, int shift)
+{
+	while (!(x.f & top_bit)) {
+		x.f <<= 1;
+		x.e--;
+	}
+	x.f <<= shift;
+	x.e -= shift;
+	return x;
+}
+
+static DiyFp
+diy_fp_cached_power (gint e, gint *k)
+{
+	gdouble dk = (-61 - e) * 0.30102999566398114 + 347;
+	gint ik = (gint) dk;
+	guint index;
+	DiyFp r;
+
+	if (dk - ik > 0.0)
+		ik++;
+	index = (guint) ((ik >> 3) + 1);
+	*k = -(-348 + (gint) index * 8);
+	r.f = cached_powers_f [index];
+	r.e = cached_powers_e [index];
+	return r;
+}
+
+static void
+grisu_round (char *buffer, gint len, guint64 delta, guint64 rest, guint64 ten_kappa, guint64 wp_w)
+{
+	while (rest < wp_w && delta - rest >= ten_kappa &&
+		(rest + ten_kappa < wp_w || wp_w - rest > rest + ten_kappa - wp_w)) {
+		buffer [len - 1]--;
+		rest += ten_kappa;
+	}
+}
+
+static const guint64 pow10_table [] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+	1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+	100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+	1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static void
+grisu_digit_gen (DiyFp w, DiyFp mp, guint64 delta, char *buffer, gint *len, gint *k)
+{
+	DiyFp one;
+	guint64 wp_w = mp.f - w.f, p2, tmp;
+	guint32 p1;
+	gint kappa;
+
+	one.f = 1ULL << -mp.e;
+	one.e = mp.e;
+	p1 = (guint32) (mp.f >> -one.e);
+	p2 = mp.f & (one.f - 1);
+
+	for (kappa = 1; kappa < 10 && p1 >= pow10_table [kappa]; ++kappa)
+		;
+
+	*len = 0;
+	while (kappa > 0) {
+		guint32 d = (guint32) (p1 / pow10_table [kappa - 1]);
+
+		p1 %= (guint32) pow10_table [kappa - 1];
+		if (d || *len)
+			buffer [(*len)++] = (char) ('0' + d);
+		kappa--;
+		tmp = ((guint64) p1 << -one.e) + p2;
+		if (tmp <= delta) {
+			*k += kappa;
+			grisu_round (buffer, *len, delta, tmp, pow10_table [kappa] << -one.e, wp_w);
+			return;
+		}
+	}
+
+	for (;;) {
+		char d;
+
+		p2 *= 10;
+		delta *= 10;
+		d = (char) (p2 >> -one.e);
+		if (d || *len)
+			buffer [(*len)++] = (char) ('0' + d);
+		p2 &= one.f - 1;
+		kappa--;
+		if (p2 < delta) {
+			*k += kappa;
+			grisu_round (buffer, *len, delta, p2, one.f, -kappa < 20 ? wp_w * pow10_table [-kappa] : 0);
+			return;
+		}
+	}
+}
+
+/* Digits of a finite, positive @value, which is digits * 10^k */
+static void
+grisu2 (gdouble value, char *buffer, gint *len, gint *k)
+{
+	guint64 bits, significand;
+	gint biased_e;
+	DiyFp v, w, plus, minus, c_mk;
+
+	memcpy (&bits, &value, sizeof (bits));
+	biased_e = (gint) ((bits & DP_EXPONENT_MASK) >> 52);
+	significand = bits & DP_SIGNIFICAND_MASK;
+	if (biased_e) {
+		v.f = significand + DP_HIDDEN_BIT;
+		v.e = biased_e - DP_EXPONENT_BIAS;
+	} else {
+		v.f = significand;
+		v.e = 1 - DP_EXPONENT_BIAS;
+	}
+
+	/* The boundaries halfway to the neighbouring doubles */
+	plus.f = (v.f << 1) + 1;
+	plus.e = v.e - 1;
+	plus = diy_fp_normalize (plus, DP_HIDDEN_BIT << 1, 64 - 52 - 2);
+	if (v.f == DP_HIDDEN_BIT) {
+		minus.f = (v.f << 2) - 1;
+		minus.e = v.e - 2;
+	} else {
+		minus.f = (v.f << 1) - 1;
+		minus.e = v.e - 1;
+	}
+	minus.f <<= minus.e - plus.e;
+	minus.e = plus.e;
+
+	c_mk = diy_fp_cached_power (plus.e, k);
+	w = diy_fp_multiply (diy_fp_normalize (v, DP_HIDDEN_BIT, 64 - 52 - 1), c_mk);
+	plus = diy_fp_multiply (plus, c_mk);
+	minus = diy_fp_multiply (minus, c_mk);
+	minus.f++;
+	plus.f--;
+	grisu_digit_gen (w, plus, plus.f - minus.f, buffer, len, k);
+}
+
+static gint32
+write_ascii (gunichar2 *buffer, const char *s)
+{
+	gint32 i;
+
+	for (i = 0; s [i]; ++i)
+		buffer [i] = s [i];
+	return i;
+}
+
+/*
+ * mono_number_format_double:
+ *
+ *   Write the shortest string that parses back to @value to @buffer, which
+ * must have room for MONO_NUMBER_FORMAT_BUFFER_SIZE characters, using the
+ * invariant culture and the layout of the "R" format: scientific notation
+ * (1E+15, 1.5E-05) for exponents of 15 and more or of -5 and less, and NaN,
+ * Infinity and -Infinity. Returns the number of characters written.
+ */
+gint32
+mono_number_format_double (gdouble value, gunichar2 *buffer)
+{
+	MonoDouble_double u;
+	char digits [20];
+	gint32 pos = 0, i, len, k, point, exponent;
+
+	if (value != value)
+		return write_ascii (buffer, "NaN");
+	if (value < 0 || (value == 0 && 1 / value < 0)) {
+		buffer [pos++] = '-';
+		value = -value;
+	}
+	if (value == 0) {
+		buffer [pos++] = '0';
+		return pos;
+	}
+	u.d = value;
+	if (u.s.exp == 0x7ff)
+		return pos + write_ascii (buffer + pos, "Infinity");
+
+	grisu2 (value, digits, &len, &k);
+	/* Number of digits before the decimal point */
+	point = len + k;
+	exponent = point - 1;
+
+	if (exponent >= 15 || exponent < -4) {
+		buffer [pos++] = digits [0];
+		if (len > 1) {
+			buffer [pos++] = '.';
+			for (i = 1; i < len; ++i)
+				buffer [pos++] = digits [i];
+		}
+		buffer [pos++] = 'E';
+		buffer [pos++] = exponent < 0 ? '-' : '+';
+		if (exponent < 0)
+			exponent = -exponent;
+		if (exponent >= 100)
+			buffer [pos++] = (gunichar2) ('0' + exponent / 100);
+		buffer [pos++] = digit_pairs [(exponent % 100) * 2];
+		buffer [pos++] = digit_pairs [(exponent % 100) * 2 + 1];
+	} else if (point <= 0) {
+		buffer [pos++] = '0';
+		buffer [pos++] = '.';
+		for (i = point; i < 0; ++i)
+			buffer [pos++] = '0';
+		for (i = 0; i < len; ++i)
+			buffer [pos++] = digits [i];
+	} else {
+		for (i = 0; i < len || i < point; ++i) {
+			if (i == point)
+				buffer [pos++] = '.';
+			buffer [pos++] = i < len ? digits [i] : '0';
+		}
+	}
+	return pos;
+}
+
+static gboolean
+is_white (gunichar2 c)
+{
+	return c == 0x20 || (c >= 0x09 && c <= 0x0D);
+}
+
+/*
+ * mono_number_parse_int64:
+ *
+ *   Parse @length characters at @s as an invariant culture integer with the
+ * NumberStyles.Integer style: optional white space, an optional sign and
+ * decimal digits. Returns FALSE when @s has another form or overflows, the
+ * general parser then reports the error.
+ */
+gboolean
+mono_number_parse_int64 (const gunichar2 *s, gint32 length, gint64 *result)
+{
+	const gunichar2 *end = s + length;
+	gboolean negative = FALSE;
+	guint64 value = 0;
+	const gunichar2 *start;
+
+	while (s < end && is_white (*s))
+		s++;
+	while (end > s && is_white (end [-1]))
+		end--;
+	if (s < end && (*s == '-' || *s == '+')) {
+		negative = *s == '-';
+		s++;
+	}
+	if (s == end)
+		return FALSE;
+
+	for (start = s; s < end; ++s) {
+		guint d = *s - '0';
+
+		if (d > 9)
+			return FALSE;
+		/* 19 digits always fit */
+		if (s - start >= 19 && value > (G_MAXUINT64 - d) / 10)
+			return FALSE;
+		value = value * 10 + d;
+	}
+
+	if (negative) {
+		if (value > (guint64) G_MAXINT64 + 1)
+			return FALSE;
+		*result = (gint64) (0 - value);
+	} else {
+		if (value > G_MAXINT64)
+			return FALSE;
+		*result = (gint64) value;
+	}
+	return TRUE;
+}
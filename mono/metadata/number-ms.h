@@ -60,4 +60,19 @@ typedef struct  {
 gint
 mono_double_from_number (gpointer from, MonoDouble *target);
 
+/* Large enough for any of the invariant formats below */
+#define MONO_NUMBER_FORMAT_BUFFER_SIZE 32
+
+gint32
+mono_number_format_uint64 (guint64 value, gunichar2 *buffer);
+
+gint32
+mono_number_format_int64 (gint64 value, gunichar2 *buffer);
+
+gint32
+mono_number_format_double (gdouble value, gunichar2 *buffer);
+
+gboolean
+mono_number_parse_int64 (const gunichar2 *s, gint32 length, gint64 *result);
+
 #endif
@@ -573,6 +573,7 @@ typedef struct {
 	gpointer (*get_vtable_trampoline) (MonoVTable *vtable, int slot_index);
 	gpointer (*get_imt_trampoline) (MonoVTable *vtable, int imt_slot_index);
 	gboolean (*imt_entry_inited) (MonoVTable *vtable, int imt_slot_index);
+	gboolean (*get_imt_slot_methods) (MonoClass *klass, int imt_slot_index, GPtrArray *methods, GArray *vt_slots);
 	void     (*set_cast_details) (MonoClass *from, MonoClass *to);
 	void     (*debug_log) (int level, MonoString *category, MonoString *message);
 	gboolean (*debug_log_is_enabled) (void);
@@ -677,6 +678,9 @@ mono_thread_get_tls_key    (void);
 gint32
 mono_thread_get_tls_offset (void);
 
+gint32
+mono_thread_get_static_data_tls_offset (void);
+
 MonoNativeTlsKey
 mono_domain_get_tls_key    (void);
 
@@ -1450,6 +1454,13 @@ MonoArray*
 ves_icall_array_new_specific (MonoVTable *vtable, uintptr_t n);
 
 #ifndef DISABLE_REMOTING
+/*
+ * Cleared when the MONO_NO_REMOTING environment variable says that no transparent
+ * proxies will be created, so the JIT leaves out the checks for them. Creating a
+ * proxy then fails with a NotSupportedException.
+ */
+extern gboolean mono_remoting_in_use;
+
 MonoObject *
 mono_remoting_invoke (MonoObject *real_proxy, MonoMethodMessage *msg, MonoObject **exc, MonoArray **out_args, MonoError *error);
 
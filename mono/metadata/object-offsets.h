@@ -54,7 +54,9 @@ DECL_SIZE(gpointer)
 #ifndef DISABLE_METADATA_OFFSETS
 //object offsets
 DECL_OFFSET(MonoObject, vtable)
+#ifndef MONO_SMALL_OBJECT_HEADER
 DECL_OFFSET(MonoObject, synchronisation)
+#endif
 
 DECL_OFFSET(MonoObjectHandlePayload, __obj)
 
@@ -78,6 +80,7 @@ DECL_OFFSET(MonoVTable, vtable)
 DECL_OFFSET(MonoVTable, rank)
 DECL_OFFSET(MonoVTable, type)
 DECL_OFFSET(MonoVTable, runtime_generic_context)
+DECL_OFFSET(MonoVTable, create_instance)
 
 DECL_OFFSET(MonoDomain, stack_overflow_ex)
 
@@ -48,6 +48,7 @@
 #include <mono/utils/checked-build.h>
 #include <mono/utils/mono-threads.h>
 #include <mono/utils/mono-threads-coop.h>
+#include <mono/utils/mono-startup-trace.h>
 #include "cominterop.h"
 
 static void
@@ -432,11 +433,23 @@ mono_runtime_class_init_full (MonoVTable *vtable, MonoError *error)
 
 	if (do_initialization) {
 		MonoException *exc = NULL;
+		MonoStartupTraceStamp trace_stamp;
+		gboolean traced = mono_startup_trace_enabled;
+
+		if (G_UNLIKELY (traced))
+			mono_startup_trace_begin (MONO_STARTUP_CLASS_INIT, &trace_stamp);
 
 		mono_threads_begin_abort_protected_block ();
 		mono_runtime_try_invoke (method, NULL, NULL, (MonoObject**) &exc, error);
 		mono_threads_end_abort_protected_block ();
 
+		if (G_UNLIKELY (traced)) {
+			char *name = mono_type_get_full_name (klass);
+
+			mono_startup_trace_end (MONO_STARTUP_CLASS_INIT, &trace_stamp, name);
+			g_free (name);
+		}
+
 		//exception extracted, error will be set to the right value later
 		if (exc == NULL && !mono_error_ok (error))//invoking failed but exc was not set
 			exc = mono_error_convert_to_exception (error);
@@ -1387,11 +1400,29 @@ build_imt_slots (MonoClass *klass, MonoVTable *vt, MonoDomain *domain, gpointer*
 	int method_count = 0;
 	gboolean record_method_count_for_max_collisions = FALSE;
 	gboolean has_generic_virtual = FALSE, has_variant_iface = FALSE;
+	gboolean cached = FALSE;
 
 #if DEBUG_IMT
 	printf ("Building IMT for class %s.%s slot %d\n", klass->name_space, klass->name, slot_num);
 #endif
-	for (i = 0; i < klass->interface_offsets_count; ++i) {
+	if (slot_num >= 0 && !extra_interfaces && callbacks.get_imt_slot_methods) {
+		/*
+		 * The AOT compiler might have precomputed the interface methods in this slot,
+		 * this avoids computing the imt slot of every interface method of the class.
+		 */
+		GPtrArray *methods = g_ptr_array_new ();
+		GArray *vt_slots = g_array_new (FALSE, FALSE, sizeof (int));
+
+		if (callbacks.get_imt_slot_methods (klass, slot_num, methods, vt_slots)) {
+			for (i = 0; i < methods->len; ++i)
+				add_imt_builder_entry (imt_builder, (MonoMethod *)g_ptr_array_index (methods, i), &imt_collisions_bitmap, g_array_index (vt_slots, int, i), slot_num);
+			cached = TRUE;
+		}
+		g_ptr_array_free (methods, TRUE);
+		g_array_free (vt_slots, TRUE);
+	}
+
+	for (i = 0; !cached && i < klass->interface_offsets_count; ++i) {
 		MonoClass *iface = klass->interfaces_packed [i];
 		int interface_offset = klass->interface_offsets_packed [i];
 		int method_slot_in_interface, vt_slot;
@@ -1561,6 +1592,11 @@ mono_vtable_build_imt_slot (MonoVTable* vtable, int imt_slot)
 }
 
 #define THUNK_THRESHOLD		10
+/*
+ * Cases called at least this many times are added to the thunk when it is rebuilt
+ * for another case, so instances which are used together don't each cause a rebuild.
+ */
+#define THUNK_WARM_THRESHOLD	(THUNK_THRESHOLD / 2)
 
 /**
  * mono_method_alloc_generic_virtual_thunk:
@@ -1623,7 +1659,7 @@ get_generic_virtual_entries (MonoDomain *domain, gpointer *vtable_slot)
  	for (; list; list = list->next) {
  		MonoImtBuilderEntry *entry;
  
- 		if (list->count < THUNK_THRESHOLD)
+ 		if (list->count < THUNK_WARM_THRESHOLD)
  			continue;
  
  		entry = g_new0 (MonoImtBuilderEntry, 1);
@@ -1652,7 +1688,8 @@ get_generic_virtual_entries (MonoDomain *domain, gpointer *vtable_slot)
  * Registers a call via unmanaged code to a generic virtual method
  * instantiation or variant interface method.  If the number of calls reaches a threshold
  * (THUNK_THRESHOLD), the method is added to the vtable slot's generic
- * virtual method thunk.
+ * virtual method thunk, along with the other instances which are close to it
+ * (THUNK_WARM_THRESHOLD).
  */
 void
 mono_method_add_generic_virtual_invocation (MonoDomain *domain, MonoVTable *vtable,
@@ -1668,6 +1705,7 @@ mono_method_add_generic_virtual_invocation (MonoDomain *domain, MonoVTable *vtab
 	MonoImtBuilderEntry *entries;
 	int i;
 	GPtrArray *sorted;
+	gpointer thunk;
 
 	mono_domain_lock (domain);
 	if (!domain->generic_virtual_cases)
@@ -1717,8 +1755,11 @@ mono_method_add_generic_virtual_invocation (MonoDomain *domain, MonoVTable *vtab
 
 			sorted = imt_sort_slot_entries (entries);
 
-			*vtable_slot = imt_thunk_builder (NULL, domain, (MonoIMTCheckItem**)sorted->pdata, sorted->len,
+			thunk = imt_thunk_builder (NULL, domain, (MonoIMTCheckItem**)sorted->pdata, sorted->len,
 											  vtable_trampoline);
+			/* Callers read the slot without locking, so the code of the thunk has to be visible first */
+			mono_memory_barrier ();
+			*vtable_slot = thunk;
 
 			while (entries) {
 				MonoImtBuilderEntry *next = entries->next;
@@ -1927,6 +1968,7 @@ mono_class_create_runtime_vtable (MonoDomain *domain, MonoClass *klass, MonoErro
 
 	mono_stats.used_class_count++;
 	mono_stats.class_vtable_size += vtable_size;
+	InterlockedAdd (&klass->image->vtables_size, vtable_size);
 
 	interface_offsets = alloc_vtable (domain, vtable_size, imt_table_bytes);
 	vt = (MonoVTable*) ((char*)interface_offsets + imt_table_bytes);
@@ -2174,6 +2216,8 @@ mono_class_create_runtime_vtable (MonoDomain *domain, MonoClass *klass, MonoErro
 }
 
 #ifndef DISABLE_REMOTING
+gboolean mono_remoting_in_use = TRUE;
+
 /**
  * mono_class_proxy_vtable:
  * @domain: the application domain
@@ -2208,6 +2252,12 @@ mono_class_proxy_vtable (MonoDomain *domain, MonoRemoteClass *remote_class, Mono
 
 	mono_error_init (error);
 
+	/* Code JITted so far doesn't check for proxies */
+	if (!mono_remoting_in_use) {
+		mono_error_set_not_supported (error, "Transparent proxies can't be created when MONO_NO_REMOTING is set");
+		return NULL;
+	}
+
 	vt = mono_class_vtable (domain, klass);
 	g_assert (vt); /*FIXME property handle failure*/
 	max_interface_id = vt->max_interface_id;
@@ -2257,6 +2307,7 @@ mono_class_proxy_vtable (MonoDomain *domain, MonoRemoteClass *remote_class, Mono
 	vtsize = imt_table_bytes + MONO_SIZEOF_VTABLE + klass->vtable_size * sizeof (gpointer);
 
 	mono_stats.class_vtable_size += vtsize + extra_interface_vtsize;
+	InterlockedAdd (&klass->image->vtables_size, vtsize + extra_interface_vtsize);
 
 	interface_offsets = alloc_vtable (domain, vtsize + extra_interface_vtsize, imt_table_bytes);
 	pvt = (MonoVTable*) ((char*)interface_offsets + imt_table_bytes);
@@ -3048,6 +3099,43 @@ mono_method_get_unmanaged_thunk (MonoMethod *method)
 	return res;
 }
 
+/**
+ * mono_method_get_unmanaged_thunk_unboxed:
+ * @method: method to generate a thunk for.
+ *
+ * Same as mono_method_get_unmanaged_thunk (), but value types are not boxed,
+ * so calls through the thunk don't allocate:
+ *
+ * - value type arguments, including a value type "this", are passed as
+ *   pointers to their unboxed data.
+ * - a value type return value is stored into a buffer passed as an extra
+ *   argument just before the exception argument, the thunk returns void.
+ *
+ * C#: public static Rectangle Intersect (Rectangle a, Rectangle b);
+ * C:  typedef void (*Intersect)(Rectangle *a, Rectangle *b, Rectangle *ret, MonoException **ex);
+ *
+ * The thunk is created once per method and cached.
+ */
+gpointer
+mono_method_get_unmanaged_thunk_unboxed (MonoMethod *method)
+{
+	MONO_REQ_GC_NEUTRAL_MODE;
+	MONO_REQ_API_ENTRYPOINT;
+
+	MonoError error;
+	gpointer res;
+
+	g_assert (!mono_threads_is_coop_enabled ());
+
+	MONO_ENTER_GC_UNSAFE;
+	method = mono_marshal_get_thunk_invoke_wrapper_full (method, TRUE);
+	res = mono_compile_method_checked (method, &error);
+	mono_error_cleanup (&error);
+	MONO_EXIT_GC_UNSAFE;
+
+	return res;
+}
+
 void
 mono_copy_value (MonoType *type, void *dest, void *value, int deref_pointer)
 {
@@ -6135,6 +6223,52 @@ mono_string_new_len (MonoDomain *domain, const char *text, guint length)
 	return result;
 }
 
+/*
+ * utf8_is_ascii:
+ *
+ *   Returns whenever the LENGTH bytes at TEXT are all ASCII characters. The bytes are
+ * checked eight at a time, since most strings created from native code are ASCII.
+ */
+static gboolean
+utf8_is_ascii (const char *text, guint length)
+{
+	guint64 w;
+	guint i;
+
+	for (i = 0; i + 8 <= length; i += 8) {
+		memcpy (&w, text + i, sizeof (w));
+		if (w & 0x8080808080808080ULL)
+			return FALSE;
+	}
+	for (; i < length; i++) {
+		if (text [i] & 0x80)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * string_new_ascii:
+ *
+ *   Create a string from the LENGTH ASCII characters at TEXT, widening them in place
+ * instead of converting them into a temporary UTF-16 buffer first.
+ */
+static MonoString*
+string_new_ascii (MonoDomain *domain, const char *text, guint length, MonoError *error)
+{
+	MonoString *s;
+	guint16 *dest;
+	guint i;
+
+	s = mono_string_new_size_checked (domain, length, error);
+	if (s) {
+		dest = mono_string_chars (s);
+		for (i = 0; i < length; i++)
+			dest [i] = (guchar) text [i];
+	}
+	return s;
+}
+
 /**
  * mono_string_new_len_checked:
  * @text: a pointer to an utf8 string
@@ -6156,6 +6290,9 @@ mono_string_new_len_checked (MonoDomain *domain, const char *text, guint length,
 	guint16 *ut = NULL;
 	glong items_written;
 
+	if (utf8_is_ascii (text, length))
+		return string_new_ascii (domain, text, length, error);
+
 	ut = eg_utf8_to_utf16_with_nuls (text, length, NULL, &items_written, &eg_error);
 
 	if (!eg_error)
@@ -6210,6 +6347,9 @@ mono_string_new_checked (MonoDomain *domain, const char *text, MonoError *error)
     mono_error_init (error);
 
     l = strlen (text);
+
+    if (utf8_is_ascii (text, l))
+	    return string_new_ascii (domain, text, l, error);
    
     ut = g_utf8_to_utf16 (text, l, NULL, &items_written, &eg_error);
 
@@ -6796,9 +6936,26 @@ mono_ldstr_checked (MonoDomain *domain, MonoImage *image, guint32 idx, MonoError
 		MonoString *str = (MonoString *)mono_lookup_dynamic_token (image, MONO_TOKEN_STRING | idx, NULL, error);
 		return str;
 	} else {
+		const char *sig;
+		MonoString *str;
+
 		if (!mono_verifier_verify_string_signature (image, idx, NULL))
 			return NULL; /*FIXME we should probably be raising an exception here*/
-		MonoString *str = mono_ldstr_metadata_sig (domain, mono_metadata_user_string (image, idx), error);
+		sig = mono_metadata_user_string (image, idx);
+
+		/* Fast path: the literal was already loaded in this domain, avoid creating and hashing a new string */
+		ldstr_lock ();
+		str = (MonoString *)g_hash_table_lookup (domain->ldstr_sig_hash, sig);
+		ldstr_unlock ();
+		if (str)
+			return str;
+
+		str = mono_ldstr_metadata_sig (domain, sig, error);
+		if (str) {
+			ldstr_lock ();
+			g_hash_table_insert (domain->ldstr_sig_hash, (gpointer)sig, str);
+			ldstr_unlock ();
+		}
 		return str;
 	}
 }
@@ -26,9 +26,15 @@ typedef struct _MonoDynamicImage MonoDynamicImage;
 typedef struct _MonoReflectionMethodBody MonoReflectionMethodBody;
 typedef struct _MonoAppContext MonoAppContext;
 
+/*
+ * Mono built with --enable-small-object-header doesn't have the synchronisation
+ * field, embedders have to define MONO_SMALL_OBJECT_HEADER as well.
+ */
 typedef struct _MonoObject {
 	MonoVTable *vtable;
+#ifndef MONO_SMALL_OBJECT_HEADER
 	MonoThreadsSync *synchronisation;
+#endif
 } MonoObject;
 
 typedef MonoObject* (*MonoInvokeFunc)	     (MonoMethod *method, void *obj, void **params, MonoObject **exc, MonoError *error);
@@ -277,6 +283,9 @@ mono_runtime_invoke_array   (MonoMethod *method, void *obj, MonoArray *params,
 MONO_API void*
 mono_method_get_unmanaged_thunk (MonoMethod *method);
 
+MONO_API void*
+mono_method_get_unmanaged_thunk_unboxed (MonoMethod *method);
+
 MONO_RT_EXTERNAL_ONLY
 MONO_API MonoArray*
 mono_runtime_get_main_args  (void);
@@ -21,6 +21,7 @@
 #include "mono/metadata/class-internals.h"
 #include "mono/metadata/domain-internals.h"
 #include "mono/metadata/gc-internals.h"
+#include "mono/metadata/object-internals.h"
 #include "mono/metadata/mono-config-dirs.h"
 #include "mono/io-layer/io-layer.h"
 #include "mono/utils/mono-dl.h"
@@ -328,6 +329,98 @@ mono_profiler_get_sampling_mode (void)
 	return sampling_mode;
 }
 
+typedef struct {
+	void **ips;
+	int max_frames;
+	int count;
+} StackCaptureData;
+
+static gboolean
+capture_stack_frame (MonoStackFrameInfo *frame, MonoContext *ctx, gpointer data)
+{
+	StackCaptureData *d = (StackCaptureData *)data;
+
+	if (frame->type != FRAME_TYPE_MANAGED || !frame->ji)
+		return FALSE;
+
+	d->ips [d->count++] = (guint8*)frame->ji->code_start + frame->native_offset;
+	return d->count == d->max_frames;
+}
+
+/**
+ * mono_profiler_capture_stack_async_safe:
+ * @sig_context the signal context to start from, or NULL to start from the caller.
+ * @ips the buffer receiving the native IPs of the managed frames, innermost first.
+ * @max_frames the number of entries in @ips.
+ *
+ * Capture the managed stack of the current thread without allocating memory, taking locks
+ * or resolving methods, so it can be called from a sampling signal handler. Use
+ * mono_profiler_resolve_ips () later, outside the signal handler, to map the IPs to methods.
+ *
+ * Returns: the number of IPs stored into @ips.
+ */
+int
+mono_profiler_capture_stack_async_safe (void *sig_context, void **ips, int max_frames)
+{
+	StackCaptureData data;
+	MonoContext ctx;
+
+	if (max_frames <= 0)
+		return 0;
+
+	data.ips = ips;
+	data.max_frames = max_frames;
+	data.count = 0;
+
+	if (sig_context) {
+		mono_sigctx_to_monoctx (sig_context, &ctx);
+		mono_get_eh_callbacks ()->mono_walk_stack_with_ctx (capture_stack_frame, &ctx, MONO_UNWIND_SIGNAL_SAFE, &data);
+	} else {
+		mono_get_eh_callbacks ()->mono_walk_stack_with_ctx (capture_stack_frame, NULL, MONO_UNWIND_SIGNAL_SAFE, &data);
+	}
+	return data.count;
+}
+
+/**
+ * mono_profiler_resolve_ips:
+ * @domain the domain which was current when the IPs were captured, or NULL for the current domain.
+ * @ips the IPs returned by mono_profiler_capture_stack_async_safe ().
+ * @count the number of entries in @ips.
+ * @methods receives the method containing each IP, or NULL if it is not known.
+ * @offsets if not NULL, receives the native offset of each IP inside its method.
+ *
+ * Resolve a batch of IPs to methods. Consecutive IPs inside the same method, like the ones of
+ * recursive calls or of samples taken in a loop, are resolved with a single lookup.
+ *
+ * Returns: the number of IPs which could be resolved.
+ */
+int
+mono_profiler_resolve_ips (MonoDomain *domain, void **ips, int count, MonoMethod **methods, int *offsets)
+{
+	MonoJitInfo *ji = NULL;
+	int i, resolved = 0;
+
+	if (!domain)
+		domain = mono_domain_get ();
+
+	for (i = 0; i < count; ++i) {
+		guint8 *ip = (guint8 *)ips [i];
+
+		if (!ji || ip < (guint8*)ji->code_start || ip >= (guint8*)ji->code_start + ji->code_size) {
+			ji = mono_jit_info_table_find_internal (domain, (char *)ip, TRUE, FALSE);
+			if (!ji && domain != mono_get_root_domain ())
+				ji = mono_jit_info_table_find_internal (mono_get_root_domain (), (char *)ip, TRUE, FALSE);
+		}
+
+		methods [i] = ji ? mono_jit_info_get_method (ji) : NULL;
+		if (offsets)
+			offsets [i] = ji ? ip - (guint8*)ji->code_start : 0;
+		if (ji)
+			resolved++;
+	}
+	return resolved;
+}
+
 void 
 mono_profiler_install_statistical_call_chain (MonoProfileStatCallChainFunc callback, int call_chain_depth, MonoProfilerCallChainStrategy call_chain_strategy) {
 	if (!prof_list)
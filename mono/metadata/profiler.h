@@ -67,7 +67,25 @@ typedef enum {
 	MONO_GC_EVENT_PRE_START_WORLD,
 	MONO_GC_EVENT_POST_START_WORLD,
 	MONO_GC_EVENT_PRE_STOP_WORLD_LOCKED,
-	MONO_GC_EVENT_POST_START_WORLD_UNLOCKED
+	MONO_GC_EVENT_POST_START_WORLD_UNLOCKED,
+	/*
+	 * Phases of a collection, reported by SGen while the world is stopped.
+	 * A phase can be entered more than once in a collection. The phases
+	 * don't overlap, but the PIN through DRAIN_GRAY phases happen between
+	 * MARK_START and MARK_END.
+	 */
+	MONO_GC_EVENT_PIN_START,
+	MONO_GC_EVENT_PIN_END,
+	MONO_GC_EVENT_SCAN_REMSETS_START,
+	MONO_GC_EVENT_SCAN_REMSETS_END,
+	MONO_GC_EVENT_SCAN_ROOTS_START,
+	MONO_GC_EVENT_SCAN_ROOTS_END,
+	MONO_GC_EVENT_DRAIN_GRAY_START,
+	MONO_GC_EVENT_DRAIN_GRAY_END,
+	MONO_GC_EVENT_FINALIZATION_START,
+	MONO_GC_EVENT_FINALIZATION_END,
+	MONO_GC_EVENT_BRIDGE_START,
+	MONO_GC_EVENT_BRIDGE_END
 } MonoGCEvent;
 
 /* coverage info */
@@ -238,6 +256,9 @@ typedef enum {
 
 MONO_API void mono_profiler_set_statistical_mode (MonoProfileSamplingMode mode, int64_t sampling_frequency_hz);
 
+MONO_API int mono_profiler_capture_stack_async_safe (void *sig_context, void **ips, int max_frames);
+MONO_API int mono_profiler_resolve_ips (MonoDomain *domain, void **ips, int count, MonoMethod **methods, int *offsets);
+
 MONO_END_DECLS
 
 #endif /* __MONO_PROFILER_H__ */
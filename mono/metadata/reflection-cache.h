@@ -27,6 +27,9 @@ reflected_equal (gconstpointer a, gconstpointer b);
 guint
 reflected_hash (gconstpointer a);
 
+void
+reflected_cache_publish (MonoDomain *domain, gpointer item, MonoClass *refclass, gpointer obj);
+
 #ifdef HAVE_BOEHM_GC
 /* ReflectedEntry doesn't need to be GC tracked */
 #define ALLOC_REFENTRY g_new0 (ReflectedEntry, 1)
@@ -39,7 +42,11 @@ reflected_hash (gconstpointer a);
 #endif
 
 
-#define CACHE_OBJECT(t,p,o,k)	\
+/*
+ * If PINNED is TRUE, O is a pinned object which is also published in
+ * domain->refobject_cache, so CHECK_OBJECT can find it without locking.
+ */
+#define CACHE_OBJECT_FULL(t,p,o,k,pinned)	\
 	do {	\
 		t _obj;	\
         ReflectedEntry pe; \
@@ -54,18 +61,24 @@ reflected_hash (gconstpointer a);
 		    e->item = (p);	\
 		    e->refclass = (k);	\
 		    mono_g_hash_table_insert (domain->refobject_hash, e,o);	\
+		    if (pinned)	\
+			    reflected_cache_publish (domain, (p), (k), (o));	\
             _obj = o; \
         } \
 		mono_domain_unlock (domain);	\
         return _obj; \
 	} while (0)
 
+#define CACHE_OBJECT(t,p,o,k) CACHE_OBJECT_FULL(t,p,o,k,FALSE)
+
 #define CHECK_OBJECT(t,p,k)	\
 	do {	\
 		t _obj;	\
 		ReflectedEntry e; 	\
 		e.item = (p);	\
 		e.refclass = (k);	\
+		if (domain->refobject_cache && (_obj = (t)mono_conc_hashtable_lookup (domain->refobject_cache, &e)))	\
+			return _obj;	\
 		mono_domain_lock (domain);	\
 		if (!domain->refobject_hash)	\
 			domain->refobject_hash = mono_g_hash_table_new_type (reflected_hash, reflected_equal, MONO_HASH_VALUE_GC, MONO_ROOT_SOURCE_DOMAIN, "domain reflection objects table");	\
@@ -136,6 +136,51 @@ reflected_hash (gconstpointer a) {
 	return mono_aligned_addr_hash (ea->item);
 }
 
+/*
+ * reflected_cache_publish:
+ *
+ *   Add the pinned reflection object OBJ for ITEM and REFCLASS to the lock-free
+ * refobject_cache of DOMAIN. OBJ is kept alive by refobject_hash, and the entries
+ * are only freed together with the domain. Called with the domain lock held.
+ */
+void
+reflected_cache_publish (MonoDomain *domain, gpointer item, MonoClass *refclass, gpointer obj)
+{
+	ReflectedEntry *e;
+
+	if (!domain->refobject_cache) {
+		MonoConcurrentHashTable *cache = mono_conc_hashtable_new (reflected_hash, reflected_equal);
+		mono_memory_barrier ();
+		domain->refobject_cache = cache;
+	}
+
+	e = (ReflectedEntry *)mono_domain_alloc (domain, sizeof (ReflectedEntry));
+	e->item = item;
+	e->refclass = refclass;
+	mono_conc_hashtable_insert (domain->refobject_cache, e, obj);
+}
+
+/*
+ * type_cache_publish:
+ *
+ *   Add the reflection type RES of TYPE to the lock-free type_cache of DOMAIN. Only
+ * the pinned RuntimeType objects of non dynamic types are added, since sre.c modifies
+ * the type_hash entries of TypeBuilders. Called with the domain lock held.
+ */
+static void
+type_cache_publish (MonoDomain *domain, MonoType *type, MonoReflectionType *res)
+{
+	if (res->object.vtable->klass != mono_defaults.runtimetype_class || image_is_dynamic (mono_class_from_mono_type (type)->image))
+		return;
+
+	if (!domain->type_cache) {
+		MonoConcurrentHashTable *cache = mono_conc_hashtable_new ((GHashFunc)mono_metadata_type_hash, (GEqualFunc)mono_metadata_type_equal);
+		mono_memory_barrier ();
+		domain->type_cache = cache;
+	}
+	mono_conc_hashtable_insert (domain->type_cache, type, res);
+}
+
 
 static void
 clear_cached_object (MonoDomain *domain, gpointer o, MonoClass *klass)
@@ -174,6 +219,10 @@ mono_reflection_cleanup_domain (MonoDomain *domain)
 		mono_g_hash_table_destroy (domain->refobject_hash);
 		domain->refobject_hash = NULL;
 	}
+	if (domain->refobject_cache) {
+		mono_conc_hashtable_destroy (domain->refobject_cache);
+		domain->refobject_cache = NULL;
+	}
 }
 
 
@@ -450,6 +499,9 @@ mono_type_get_object_checked (MonoDomain *domain, MonoType *type, MonoError *err
 			return (MonoReflectionType *)vtable->type;
 	}
 
+	if (domain->type_cache && (res = (MonoReflectionType *)mono_conc_hashtable_lookup (domain->type_cache, type)))
+		return res;
+
 	mono_loader_lock (); /*FIXME mono_class_init and mono_class_vtable acquire it*/
 	mono_domain_lock (domain);
 	if (!domain->type_hash)
@@ -474,6 +526,7 @@ mono_type_get_object_checked (MonoDomain *domain, MonoType *type, MonoError *err
 		if (!mono_error_ok (error))
 			return NULL;
 		mono_g_hash_table_insert (domain->type_hash, type, res);
+		type_cache_publish (domain, type, res);
 		mono_domain_unlock (domain);
 		mono_loader_unlock ();
 		return res;
@@ -525,6 +578,7 @@ mono_type_get_object_checked (MonoDomain *domain, MonoType *type, MonoError *err
 
 	res->type = type;
 	mono_g_hash_table_insert (domain->type_hash, type, res);
+	type_cache_publish (domain, type, res);
 
 	if (type->type == MONO_TYPE_VOID)
 		domain->typeof_void = (MonoObject*)res;
@@ -572,6 +626,8 @@ mono_method_get_object_checked (MonoDomain *domain, MonoMethod *method, MonoClas
 	MonoReflectionType *rt;
 	MonoClass *klass;
 	MonoReflectionMethod *ret;
+	/* The objects of dynamic methods are freed together with them, see mono_method_clear_object () */
+	gboolean pinned = !method_is_dynamic (method);
 
 	mono_error_init (error);
 
@@ -586,7 +642,10 @@ mono_method_get_object_checked (MonoDomain *domain, MonoMethod *method, MonoClas
 		} else {
 			klass = mono_class_get_mono_generic_method_class ();
 		}
-		gret = (MonoReflectionGenericMethod*)mono_object_new_checked (domain, klass, error);
+		if (pinned)
+			gret = (MonoReflectionGenericMethod*)mono_object_new_pinned (domain, klass, error);
+		else
+			gret = (MonoReflectionGenericMethod*)mono_object_new_checked (domain, klass, error);
 		if (!mono_error_ok (error))
 			goto leave;
 		gret->method.method = method;
@@ -599,7 +658,7 @@ mono_method_get_object_checked (MonoDomain *domain, MonoMethod *method, MonoClas
 
 		MONO_OBJECT_SETREF (gret, method.reftype, rt);
 
-		CACHE_OBJECT (MonoReflectionMethod *, method, (MonoReflectionMethod*)gret, refclass);
+		CACHE_OBJECT_FULL (MonoReflectionMethod *, method, (MonoReflectionMethod*)gret, refclass, pinned);
 	}
 
 	if (!refclass)
@@ -612,7 +671,10 @@ mono_method_get_object_checked (MonoDomain *domain, MonoMethod *method, MonoClas
 	else {
 		klass = mono_class_get_mono_method_class ();
 	}
-	ret = (MonoReflectionMethod*)mono_object_new_checked (domain, klass, error);
+	if (pinned)
+		ret = (MonoReflectionMethod*)mono_object_new_pinned (domain, klass, error);
+	else
+		ret = (MonoReflectionMethod*)mono_object_new_checked (domain, klass, error);
 	if (!mono_error_ok (error))
 		goto leave;
 	ret->method = method;
@@ -623,7 +685,7 @@ mono_method_get_object_checked (MonoDomain *domain, MonoMethod *method, MonoClas
 
 	MONO_OBJECT_SETREF (ret, reftype, rt);
 
-	CACHE_OBJECT (MonoReflectionMethod *, method, ret, refclass);
+	CACHE_OBJECT_FULL (MonoReflectionMethod *, method, ret, refclass, pinned);
 
 leave:
 	g_assert (!mono_error_ok (error));
@@ -693,7 +755,7 @@ mono_field_get_object_checked (MonoDomain *domain, MonoClass *klass, MonoClassFi
 	mono_error_init (error);
 
 	CHECK_OBJECT (MonoReflectionField *, field, klass);
-	res = (MonoReflectionField *)mono_object_new_checked (domain, mono_class_get_mono_field_class (), error);
+	res = (MonoReflectionField *)mono_object_new_pinned (domain, mono_class_get_mono_field_class (), error);
 	if (!res)
 		return NULL;
 	res->klass = klass;
@@ -708,7 +770,7 @@ mono_field_get_object_checked (MonoDomain *domain, MonoClass *klass, MonoClassFi
 		MONO_OBJECT_SETREF (res, type, rt);
 	}
 	res->attrs = mono_field_get_flags (field);
-	CACHE_OBJECT (MonoReflectionField *, field, res, klass);
+	CACHE_OBJECT_FULL (MonoReflectionField *, field, res, klass, TRUE);
 }
 
 /*
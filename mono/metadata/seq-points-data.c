@@ -315,6 +315,18 @@ mono_seq_point_iterator_init (SeqPointIterator* it, MonoSeqPointInfo* info)
 	memset(&it->seq_point, 0, sizeof(SeqPoint));
 }
 
+/*
+ * mono_seq_point_info_has_debug_data:
+ *
+ *   Return whenever INFO contains the data needed by the debugger, i.e. the method was
+ * compiled with sdb sequence points.
+ */
+gboolean
+mono_seq_point_info_has_debug_data (MonoSeqPointInfo* info)
+{
+	return seq_point_info_inflate (info).has_debug_data;
+}
+
 int
 mono_seq_point_info_write (MonoSeqPointInfo* info, guint8* buffer)
 {
@@ -52,6 +52,9 @@ mono_seq_point_iterator_init (SeqPointIterator* it, MonoSeqPointInfo* info);
 void
 mono_seq_point_init_next (MonoSeqPointInfo* info, SeqPoint sp, SeqPoint* next);
 
+gboolean
+mono_seq_point_info_has_debug_data (MonoSeqPointInfo* info);
+
 int
 mono_seq_point_info_write (MonoSeqPointInfo* info, guint8* buffer);
 
@@ -85,6 +85,7 @@ extern void mono_sgen_init_stw (void);
 enum {
 	INTERNAL_MEM_EPHEMERON_LINK = INTERNAL_MEM_FIRST_CLIENT,
 	INTERNAL_MEM_MOVED_OBJECT,
+	INTERNAL_MEM_LOCK_WORDS,
 	INTERNAL_MEM_MAX
 };
 
@@ -177,10 +178,19 @@ sgen_client_array_length (GCObject *obj)
 	return mono_array_length_fast ((MonoArray*)obj);
 }
 
+#ifdef MONO_SMALL_OBJECT_HEADER
+extern GCVTable sgen_array_fill_vtable;
+#endif
+
 static MONO_ALWAYS_INLINE gboolean G_GNUC_UNUSED
 sgen_client_object_is_array_fill (GCObject *o)
 {
+#ifdef MONO_SMALL_OBJECT_HEADER
+	/* There is no synchronisation field to mark filler objects with */
+	return ((mword)((MonoObject*)o)->vtable & ~(mword)SGEN_VTABLE_BITS_MASK) == (mword)sgen_array_fill_vtable;
+#else
 	return ((MonoObject*)o)->synchronisation == GINT_TO_POINTER (-1);
+#endif
 }
 
 static MONO_ALWAYS_INLINE void G_GNUC_UNUSED
@@ -414,6 +424,32 @@ sgen_client_binary_protocol_reclaim_end (int generation)
 	mono_profiler_gc_event (MONO_GC_EVENT_RECLAIM_END, generation);
 }
 
+static void G_GNUC_UNUSED
+sgen_client_gc_phase_start (int generation, SgenGCPhase phase)
+{
+	switch (phase) {
+	case SGEN_GC_PHASE_PIN: mono_profiler_gc_event (MONO_GC_EVENT_PIN_START, generation); break;
+	case SGEN_GC_PHASE_SCAN_REMSETS: mono_profiler_gc_event (MONO_GC_EVENT_SCAN_REMSETS_START, generation); break;
+	case SGEN_GC_PHASE_SCAN_ROOTS: mono_profiler_gc_event (MONO_GC_EVENT_SCAN_ROOTS_START, generation); break;
+	case SGEN_GC_PHASE_DRAIN_GRAY: mono_profiler_gc_event (MONO_GC_EVENT_DRAIN_GRAY_START, generation); break;
+	case SGEN_GC_PHASE_FINALIZATION: mono_profiler_gc_event (MONO_GC_EVENT_FINALIZATION_START, generation); break;
+	case SGEN_GC_PHASE_BRIDGE: mono_profiler_gc_event (MONO_GC_EVENT_BRIDGE_START, generation); break;
+	}
+}
+
+static void G_GNUC_UNUSED
+sgen_client_gc_phase_end (int generation, SgenGCPhase phase)
+{
+	switch (phase) {
+	case SGEN_GC_PHASE_PIN: mono_profiler_gc_event (MONO_GC_EVENT_PIN_END, generation); break;
+	case SGEN_GC_PHASE_SCAN_REMSETS: mono_profiler_gc_event (MONO_GC_EVENT_SCAN_REMSETS_END, generation); break;
+	case SGEN_GC_PHASE_SCAN_ROOTS: mono_profiler_gc_event (MONO_GC_EVENT_SCAN_ROOTS_END, generation); break;
+	case SGEN_GC_PHASE_DRAIN_GRAY: mono_profiler_gc_event (MONO_GC_EVENT_DRAIN_GRAY_END, generation); break;
+	case SGEN_GC_PHASE_FINALIZATION: mono_profiler_gc_event (MONO_GC_EVENT_FINALIZATION_END, generation); break;
+	case SGEN_GC_PHASE_BRIDGE: mono_profiler_gc_event (MONO_GC_EVENT_BRIDGE_END, generation); break;
+	}
+}
+
 static void
 mono_binary_protocol_alloc_generic (gpointer obj, gpointer vtable, size_t size, gboolean pinned)
 {
@@ -762,4 +798,8 @@ gboolean sgen_has_managed_allocator (void);
 void sgen_scan_for_registered_roots_in_domain (MonoDomain *domain, int root_type);
 void sgen_null_links_for_domain (MonoDomain *domain);
 
+#ifdef MONO_SMALL_OBJECT_HEADER
+void sgen_mono_clear_lock_words (char *start, char *end, ScanCopyContext ctx);
+#endif
+
 #endif
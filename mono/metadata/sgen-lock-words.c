@@ -0,0 +1,291 @@
+/*
+ * sgen-lock-words.c: Side table for the lock words of objects with small headers
+ *
+ * Copyright 2016 Xamarin, Inc.
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include "config.h"
+
+#ifdef HAVE_SGEN_GC
+
+#include "sgen/sgen-gc.h"
+#include "sgen/sgen-client.h"
+#include "metadata/gc-internals.h"
+#include "utils/hazard-pointer.h"
+
+#ifdef MONO_SMALL_OBJECT_HEADER
+
+/*
+ * With MONO_SMALL_OBJECT_HEADER objects only have a vtable pointer, so the lock
+ * word (hash code, thin lock or inflated monitor, see monitor.c) of the few
+ * objects which need one is kept here instead.
+ *
+ * Lock words live in slots which never move, so the monitor code can keep the
+ * address of a lock word and update it with atomic operations. The slots are
+ * found through an open addressing index keyed by the object address:
+ *
+ * - Lookups don't take any lock. The index is protected by a hazard pointer so
+ *   it isn't freed under the reader when it grows.
+ *
+ * - New slots are added with the GC lock held, so a collection never sees an
+ *   index which is being filled.
+ *
+ * - At the end of each collection, the slots of dead objects are freed and the
+ *   ones of objects that moved are updated, after which the index is rebuilt in
+ *   place. A mutator which was suspended in the middle of a lookup can miss its
+ *   slot afterwards, but it never finds a wrong one, and a miss is checked again
+ *   with the GC lock held.
+ */
+
+typedef struct _LockWordSlot LockWordSlot;
+struct _LockWordSlot {
+	MonoThreadsSync * volatile lock_word;
+	/* NULL for free slots, which are linked through next_free */
+	GCObject *obj;
+	LockWordSlot *next_free;
+};
+
+typedef struct {
+	guint32 size;
+	LockWordSlot *entries [MONO_ZERO_LEN_ARRAY];
+} LockWordIndex;
+
+#define LOCK_WORD_CHUNK_SIZE	1024
+#define LOCK_WORD_MIN_INDEX_SIZE	256
+
+static LockWordIndex * volatile lock_word_index;
+static LockWordSlot **slot_chunks;
+static int num_slot_chunks;
+static int slot_chunks_capacity;
+static LockWordSlot *free_slots;
+static guint32 num_used_slots;
+
+static inline guint32
+hash_object (GCObject *obj)
+{
+	return (guint32)(((mword)obj >> 3) * 2654435761u);
+}
+
+static LockWordSlot *
+index_lookup (LockWordIndex *index, GCObject *obj)
+{
+	guint32 mask = index->size - 1;
+	guint32 i = hash_object (obj) & mask;
+	LockWordSlot *slot;
+
+	while ((slot = index->entries [i])) {
+		if (slot->obj == obj)
+			return slot;
+		i = (i + 1) & mask;
+	}
+	return NULL;
+}
+
+static void
+index_insert (LockWordIndex *index, LockWordSlot *slot)
+{
+	guint32 mask = index->size - 1;
+	guint32 i = hash_object (slot->obj) & mask;
+
+	while (index->entries [i])
+		i = (i + 1) & mask;
+	index->entries [i] = slot;
+}
+
+static size_t
+index_alloc_size (guint32 size)
+{
+	return G_STRUCT_OFFSET (LockWordIndex, entries) + size * sizeof (LockWordSlot*);
+}
+
+static LockWordIndex*
+index_new (guint32 size)
+{
+	LockWordIndex *index = (LockWordIndex *)sgen_alloc_internal_dynamic (index_alloc_size (size), INTERNAL_MEM_LOCK_WORDS, TRUE);
+
+	index->size = size;
+	return index;
+}
+
+static void
+index_free (gpointer p)
+{
+	LockWordIndex *index = (LockWordIndex *)p;
+
+	sgen_free_internal_dynamic (index, index_alloc_size (index->size), INTERNAL_MEM_LOCK_WORDS);
+}
+
+/* Add the slots of all the live objects to INDEX, which must be empty */
+static void
+index_fill (LockWordIndex *index)
+{
+	int i, j;
+
+	for (i = 0; i < num_slot_chunks; ++i) {
+		for (j = 0; j < LOCK_WORD_CHUNK_SIZE; ++j) {
+			if (slot_chunks [i][j].obj)
+				index_insert (index, &slot_chunks [i][j]);
+		}
+	}
+}
+
+/* LOCKING: Assumes the GC lock is held */
+static LockWordSlot*
+alloc_slot (void)
+{
+	LockWordSlot *slot;
+	int i;
+
+	if (!free_slots) {
+		LockWordSlot *chunk;
+
+		if (num_slot_chunks == slot_chunks_capacity) {
+			int new_capacity = slot_chunks_capacity ? slot_chunks_capacity * 2 : 16;
+			LockWordSlot **new_chunks = (LockWordSlot **)sgen_alloc_internal_dynamic (new_capacity * sizeof (LockWordSlot*), INTERNAL_MEM_LOCK_WORDS, TRUE);
+
+			/* Only the GC and this function, both with the GC lock held, go through the chunks */
+			if (slot_chunks) {
+				memcpy (new_chunks, slot_chunks, num_slot_chunks * sizeof (LockWordSlot*));
+				sgen_free_internal_dynamic (slot_chunks, slot_chunks_capacity * sizeof (LockWordSlot*), INTERNAL_MEM_LOCK_WORDS);
+			}
+			slot_chunks = new_chunks;
+			slot_chunks_capacity = new_capacity;
+		}
+
+		chunk = (LockWordSlot *)sgen_alloc_internal_dynamic (LOCK_WORD_CHUNK_SIZE * sizeof (LockWordSlot), INTERNAL_MEM_LOCK_WORDS, TRUE);
+		for (i = LOCK_WORD_CHUNK_SIZE - 1; i >= 0; --i) {
+			chunk [i].next_free = free_slots;
+			free_slots = &chunk [i];
+		}
+		slot_chunks [num_slot_chunks++] = chunk;
+	}
+
+	slot = free_slots;
+	free_slots = slot->next_free;
+	slot->next_free = NULL;
+	++num_used_slots;
+	return slot;
+}
+
+static LockWordSlot*
+lookup_slot (GCObject *obj)
+{
+	MonoThreadHazardPointers *hp = mono_hazard_pointer_get ();
+	LockWordIndex *index;
+	LockWordSlot *slot = NULL;
+
+	index = (LockWordIndex *)mono_get_hazardous_pointer ((gpointer volatile*)&lock_word_index, hp, 0);
+	if (index)
+		slot = index_lookup (index, obj);
+	mono_hazard_pointer_clear (hp, 0);
+	return slot;
+}
+
+static LockWordSlot*
+add_slot (GCObject *obj)
+{
+	LockWordIndex *index;
+	LockWordSlot *slot;
+
+	sgen_gc_lock ();
+
+	index = lock_word_index;
+	slot = index ? index_lookup (index, obj) : NULL;
+	if (slot) {
+		sgen_gc_unlock ();
+		return slot;
+	}
+
+	if (!index || (num_used_slots + 1) * 2 > index->size) {
+		LockWordIndex *old_index = index;
+		guint32 size = old_index ? old_index->size * 2 : LOCK_WORD_MIN_INDEX_SIZE;
+
+		index = index_new (size);
+		index_fill (index);
+		mono_memory_write_barrier ();
+		lock_word_index = index;
+		if (old_index)
+			mono_thread_hazardous_try_free (old_index, index_free);
+	}
+
+	slot = alloc_slot ();
+	slot->lock_word = NULL;
+	slot->obj = obj;
+	/* Lookups which find the slot must see the object */
+	mono_memory_write_barrier ();
+	index_insert (index, slot);
+
+	sgen_gc_unlock ();
+	return slot;
+}
+
+/*
+ * mono_gc_get_lock_word_address:
+ *
+ *   Return the address of the lock word of OBJ, adding one if OBJ doesn't have
+ * it yet and CREATE is TRUE, or NULL otherwise. The address is valid as long
+ * as OBJ is alive, even if it moves.
+ */
+MonoThreadsSync * volatile *
+mono_gc_get_lock_word_address (MonoObject *obj, gboolean create)
+{
+	LockWordSlot *slot = lookup_slot ((GCObject*)obj);
+
+	if (!slot && create)
+		slot = add_slot ((GCObject*)obj);
+	return slot ? &slot->lock_word : NULL;
+}
+
+/*
+ * Called with the world stopped, after the last chance of resurrecting objects
+ * in [START, END) for finalization.
+ */
+void
+sgen_mono_clear_lock_words (char *start, char *end, ScanCopyContext ctx)
+{
+	CopyOrMarkObjectFunc copy_func = ctx.ops->copy_or_mark_object;
+	SgenGrayQueue *queue = ctx.queue;
+	gboolean changed = FALSE;
+	int i, j;
+
+	if (!num_used_slots)
+		return;
+
+	SGEN_LOG (4, "Clearing lock words %d", num_used_slots);
+
+	for (i = 0; i < num_slot_chunks; ++i) {
+		for (j = 0; j < LOCK_WORD_CHUNK_SIZE; ++j) {
+			LockWordSlot *slot = &slot_chunks [i][j];
+			GCObject *obj = slot->obj;
+
+			if (!obj || (char*)obj < start || (char*)obj >= end)
+				continue;
+
+			if (sgen_gc_is_object_ready_for_finalization (obj)) {
+				/* An inflated monitor is recycled once its weak link is cleared */
+				slot->obj = NULL;
+				slot->lock_word = NULL;
+				slot->next_free = free_slots;
+				free_slots = slot;
+				--num_used_slots;
+				changed = TRUE;
+			} else {
+				copy_func (&slot->obj, queue);
+				if (slot->obj != obj)
+					changed = TRUE;
+			}
+		}
+	}
+	sgen_drain_gray_stack (ctx);
+
+	if (changed) {
+		memset (lock_word_index->entries, 0, lock_word_index->size * sizeof (LockWordSlot*));
+		index_fill (lock_word_index);
+	}
+}
+
+#endif
+
+#endif
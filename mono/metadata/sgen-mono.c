@@ -354,12 +354,16 @@ mono_gc_get_write_barrier (void)
  */
 
 /* Vtable of the objects used to fill out nursery fragments before a collection */
-static GCVTable array_fill_vtable;
+#ifdef MONO_SMALL_OBJECT_HEADER
+GCVTable sgen_array_fill_vtable;
+#else
+static GCVTable sgen_array_fill_vtable;
+#endif
 
 static GCVTable
 get_array_fill_vtable (void)
 {
-	if (!array_fill_vtable) {
+	if (!sgen_array_fill_vtable) {
 		static MonoClass klass;
 		static char _vtable[sizeof(MonoVTable)+8];
 		MonoVTable* vtable = (MonoVTable*) ALIGN_TO((mword)_vtable, 8);
@@ -379,9 +383,9 @@ get_array_fill_vtable (void)
 		vtable->gc_descr = mono_gc_make_descr_for_array (TRUE, &bmap, 0, 1);
 		vtable->rank = 1;
 
-		array_fill_vtable = vtable;
+		sgen_array_fill_vtable = vtable;
 	}
-	return array_fill_vtable;
+	return sgen_array_fill_vtable;
 }
 
 gboolean
@@ -396,8 +400,10 @@ sgen_client_array_fill_range (char *start, size_t size)
 
 	o = (MonoArray*)start;
 	o->obj.vtable = (MonoVTable*)get_array_fill_vtable ();
+#ifndef MONO_SMALL_OBJECT_HEADER
 	/* Mark this as not a real object */
 	o->obj.synchronisation = (MonoThreadsSync *)GINT_TO_POINTER (-1);
+#endif
 	o->bounds = NULL;
 	o->max_length = (mono_array_size_t)(size - MONO_SIZEOF_MONO_ARRAY);
 
@@ -648,6 +654,21 @@ sgen_client_clear_unreachable_ephemerons (ScanCopyContext ctx)
 	}
 }
 
+/*
+ * Lock words of objects with small headers live in a side table, see
+ * sgen-lock-words.c.  The hook is defined here rather than there so the static
+ * runtime always links it.
+ *
+ * LOCKING: requires that the GC lock is held
+ */
+void
+sgen_client_clear_lock_words (char *start, char *end, ScanCopyContext ctx)
+{
+#ifdef MONO_SMALL_OBJECT_HEADER
+	sgen_mono_clear_lock_words (start, end, ctx);
+#endif
+}
+
 /*
 LOCKING: requires that the GC lock is held
 
@@ -744,6 +765,24 @@ mono_gc_set_current_thread_appdomain (MonoDomain *domain)
 	}
 }
 
+/*
+ * The major heap blocks are tagged with the domains of their objects, so unloading a
+ * domain only walks the blocks which might have some of its objects.  Domain ids are
+ * folded into the 16 available tags.
+ */
+#define DOMAIN_REGION_TAG(domain)	((guint16)(1 << ((domain)->domain_id & 15)))
+
+guint16
+sgen_client_vtable_get_region_tag (MonoVTable *vt)
+{
+#ifndef DISABLE_REMOTING
+	/* Proxies may point to objects in other domains, see process_object_for_domain_clearing () */
+	if (G_UNLIKELY (mono_defaults.real_proxy_class && mono_defaults.real_proxy_class->supertypes && mono_class_has_parent_fast (vt->klass, mono_defaults.real_proxy_class)))
+		return 0xffff;
+#endif
+	return DOMAIN_REGION_TAG (vt->domain);
+}
+
 static gboolean
 need_remove_object_for_domain (GCObject *start, MonoDomain *domain)
 {
@@ -785,7 +824,7 @@ clear_domain_process_object (GCObject *obj, MonoDomain *domain)
 	process_object_for_domain_clearing (obj, domain);
 	remove = need_remove_object_for_domain (obj, domain);
 
-	if (remove && obj->synchronisation) {
+	if (remove) {
 		guint32 dislink = mono_monitor_get_object_monitor_gchandle (obj);
 		if (dislink)
 			mono_gchandle_free (dislink);
@@ -827,7 +866,8 @@ clear_domain_free_major_pinned_object_callback (GCObject *obj, size_t size, Mono
  * When appdomains are unloaded we can easily remove objects that have finalizers,
  * but all the others could still be present in random places on the heap.
  * We need a sweep to get rid of them even though it's going to be costly
- * with big heaps.
+ * with big heaps, which is why only the major blocks tagged with the domain
+ * are visited.
  * The reason we need to remove them is because we access the vtable and class
  * structures to know the object size and the reference bitmap: once the domain is
  * unloaded the point to random memory.
@@ -836,6 +876,7 @@ void
 mono_gc_clear_domain (MonoDomain * domain)
 {
 	LOSObject *bigobj, *prev;
+	guint16 tag = DOMAIN_REGION_TAG (domain);
 	int i;
 
 	LOCK_GC;
@@ -878,7 +919,7 @@ mono_gc_clear_domain (MonoDomain * domain)
 	   objects with major-mark&sweep), but we might need to
 	   dereference a pointer from an object to another object if
 	   the first object is a proxy. */
-	major_collector.iterate_objects (ITERATE_OBJECTS_SWEEP_ALL, (IterateObjectCallbackFunc)clear_domain_process_major_object_callback, domain);
+	major_collector.iterate_objects_with_tags (ITERATE_OBJECTS_SWEEP_ALL, tag, (IterateObjectCallbackFunc)clear_domain_process_major_object_callback, domain);
 	for (bigobj = los_object_list; bigobj; bigobj = bigobj->next)
 		clear_domain_process_object ((GCObject*)bigobj->data, domain);
 
@@ -898,8 +939,8 @@ mono_gc_clear_domain (MonoDomain * domain)
 		prev = bigobj;
 		bigobj = bigobj->next;
 	}
-	major_collector.iterate_objects (ITERATE_OBJECTS_SWEEP_NON_PINNED, (IterateObjectCallbackFunc)clear_domain_free_major_non_pinned_object_callback, domain);
-	major_collector.iterate_objects (ITERATE_OBJECTS_SWEEP_PINNED, (IterateObjectCallbackFunc)clear_domain_free_major_pinned_object_callback, domain);
+	major_collector.iterate_objects_with_tags (ITERATE_OBJECTS_SWEEP_NON_PINNED, tag, (IterateObjectCallbackFunc)clear_domain_free_major_non_pinned_object_callback, domain);
+	major_collector.iterate_objects_with_tags (ITERATE_OBJECTS_SWEEP_PINNED, tag, (IterateObjectCallbackFunc)clear_domain_free_major_pinned_object_callback, domain);
 
 	if (domain == mono_get_root_domain ()) {
 		sgen_pin_stats_report ();
@@ -1041,7 +1082,7 @@ create_allocator (int atype, ManagedAllocatorVariant variant)
 {
 	int p_var, size_var, thread_var G_GNUC_UNUSED;
 	gboolean slowpath = variant == MANAGED_ALLOCATOR_SLOW_PATH;
-	guint32 slowpath_branch, max_size_branch;
+	guint32 slowpath_branch, max_size_branch, pretenure_branch;
 	MonoMethodBuilder *mb;
 	MonoMethod *res;
 	MonoMethodSignature *csig;
@@ -1268,6 +1309,27 @@ create_allocator (int atype, ManagedAllocatorVariant variant)
 		max_size_branch = mono_mb_emit_short_branch (mb, MONO_CEE_BGT_UN_S);
 	}
 
+	/* if (vtable->gc_bits & SGEN_GC_BIT_PRETENURE) goto slowpath */
+	if (pretenuring_enabled) {
+		static int byte_offset = -1;
+		static guint8 bitmask;
+
+		if (byte_offset < 0) {
+			MonoVTable tmp;
+			memset (&tmp, 0, sizeof (tmp));
+			tmp.gc_bits = SGEN_GC_BIT_PRETENURE;
+			mono_marshal_find_nonzero_bit_offset ((guint8*)&tmp, sizeof (tmp), &byte_offset, &bitmask);
+		}
+
+		mono_mb_emit_ldarg (mb, 0);
+		mono_mb_emit_icon (mb, byte_offset);
+		mono_mb_emit_byte (mb, CEE_ADD);
+		mono_mb_emit_byte (mb, CEE_LDIND_U1);
+		mono_mb_emit_icon (mb, bitmask);
+		mono_mb_emit_byte (mb, CEE_AND);
+		pretenure_branch = mono_mb_emit_short_branch (mb, MONO_CEE_BRTRUE_S);
+	}
+
 	/*
 	 * We need to modify tlab_next, but the JIT only supports reading, so we read
 	 * another tls var holding its address instead.
@@ -1300,6 +1362,8 @@ create_allocator (int atype, ManagedAllocatorVariant variant)
 	/* Slowpath */
 	if (atype != ATYPE_SMALL)
 		mono_mb_patch_short_branch (mb, max_size_branch);
+	if (pretenuring_enabled)
+		mono_mb_patch_short_branch (mb, pretenure_branch);
 
 	mono_mb_emit_byte (mb, MONO_CUSTOM_PREFIX);
 	mono_mb_emit_byte (mb, CEE_MONO_NOT_TAKEN);
@@ -1543,63 +1607,6 @@ sgen_has_managed_allocator (void)
  * Cardtable scanning
  */
 
-#define MWORD_MASK (sizeof (mword) - 1)
-
-static inline int
-find_card_offset (mword card)
-{
-/*XXX Use assembly as this generates some pretty bad code */
-#if defined(__i386__) && defined(__GNUC__)
-	return  (__builtin_ffs (card) - 1) / 8;
-#elif defined(__x86_64__) && defined(__GNUC__)
-	return (__builtin_ffsll (card) - 1) / 8;
-#elif defined(__s390x__)
-	return (__builtin_ffsll (GUINT64_TO_LE(card)) - 1) / 8;
-#else
-	int i;
-	guint8 *ptr = (guint8 *) &card;
-	for (i = 0; i < sizeof (mword); ++i) {
-		if (ptr[i])
-			return i;
-	}
-	return 0;
-#endif
-}
-
-static guint8*
-find_next_card (guint8 *card_data, guint8 *end)
-{
-	mword *cards, *cards_end;
-	mword card;
-
-	while ((((mword)card_data) & MWORD_MASK) && card_data < end) {
-		if (*card_data)
-			return card_data;
-		++card_data;
-	}
-
-	if (card_data == end)
-		return end;
-
-	cards = (mword*)card_data;
-	cards_end = (mword*)((mword)end & ~MWORD_MASK);
-	while (cards < cards_end) {
-		card = *cards;
-		if (card)
-			return (guint8*)cards + find_card_offset (card);
-		++cards;
-	}
-
-	card_data = (guint8*)cards_end;
-	while (card_data < end) {
-		if (*card_data)
-			return card_data;
-		++card_data;
-	}
-
-	return end;
-}
-
 #define ARRAY_OBJ_INDEX(ptr,array,elem_size) (((char*)(ptr) - ((char*)(array) + G_STRUCT_OFFSET (MonoArray, vector))) / (elem_size))
 
 gboolean
@@ -1656,8 +1663,8 @@ sgen_client_cardtable_scan_object (GCObject *obj, mword block_obj_size, guint8 *
 LOOP_HEAD:
 #endif
 
-		card_data = find_next_card (card_data, card_data_end);
-		for (; card_data < card_data_end; card_data = find_next_card (card_data + 1, card_data_end)) {
+		card_data = sgen_card_table_find_marked_card (card_data, card_data_end);
+		for (; card_data < card_data_end; card_data = sgen_card_table_find_marked_card (card_data + 1, card_data_end)) {
 			size_t index;
 			size_t idx = (card_data - card_base) + extra_idx;
 			char *start = (char*)(obj_start + idx * CARD_SIZE_IN_BYTES);
@@ -2055,6 +2062,8 @@ static void *moved_objects [MOVED_OBJECTS_NUM];
 static int moved_objects_idx = 0;
 
 static SgenPointerQueue moved_objects_queue = SGEN_POINTER_QUEUE_INIT (INTERNAL_MEM_MOVED_OBJECT);
+/* Parallel nursery collections have more than one worker thread adding to the queue. */
+static mono_mutex_t moved_objects_queue_lock;
 
 void
 mono_sgen_register_moved_object (void *obj, void *destination)
@@ -2065,13 +2074,14 @@ mono_sgen_register_moved_object (void *obj, void *destination)
 	 * events and send them later when the main GC thread calls
 	 * mono_sgen_gc_event_moves ().
 	 *
-	 * TODO: Once SGen has multiple worker threads, we need to switch to a
-	 * lock-free data structure for the queue as multiple threads will be
-	 * adding to it at the same time.
+	 * Multiple worker threads can be adding to the queue at the same time, so
+	 * the pair is added under a lock.
 	 */
 	if (sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ())) {
+		mono_os_mutex_lock (&moved_objects_queue_lock);
 		sgen_pointer_queue_add (&moved_objects_queue, obj);
 		sgen_pointer_queue_add (&moved_objects_queue, destination);
+		mono_os_mutex_unlock (&moved_objects_queue_lock);
 	} else {
 		if (moved_objects_idx == MOVED_OBJECTS_NUM) {
 			mono_profiler_gc_moves (moved_objects, moved_objects_idx);
@@ -2558,6 +2568,12 @@ mono_gc_is_moving (void)
 	return TRUE;
 }
 
+gboolean
+mono_gc_needs_write_barriers (void)
+{
+	return TRUE;
+}
+
 gboolean
 mono_gc_is_disabled (void)
 {
@@ -2803,6 +2819,7 @@ sgen_client_description_for_internal_mem_type (int type)
 	switch (type) {
 	case INTERNAL_MEM_EPHEMERON_LINK: return "ephemeron-link";
 	case INTERNAL_MEM_MOVED_OBJECT: return "moved-object";
+	case INTERNAL_MEM_LOCK_WORDS: return "lock-words";
 	default:
 		return NULL;
 	}
@@ -2835,6 +2852,18 @@ sgen_client_vtable_get_name (MonoVTable *vt)
 	return vt->klass->name;
 }
 
+gboolean
+sgen_client_vtable_is_pretenured (MonoVTable *vt)
+{
+	return (vt->gc_bits & SGEN_GC_BIT_PRETENURE) == SGEN_GC_BIT_PRETENURE;
+}
+
+void
+sgen_client_vtable_set_pretenured (MonoVTable *vt)
+{
+	vt->gc_bits |= SGEN_GC_BIT_PRETENURE;
+}
+
 /*
  * Initialization
  */
@@ -2862,6 +2891,8 @@ sgen_client_init (void)
 
 	mono_sgen_init_stw ();
 
+	mono_os_mutex_init (&moved_objects_queue_lock);
+
 #ifndef HAVE_KW_THREAD
 	mono_native_tls_alloc (&thread_info_key, NULL);
 #if defined(TARGET_OSX) || defined(TARGET_WIN32) || defined(TARGET_ANDROID) || defined(TARGET_IOS)
@@ -2918,6 +2949,7 @@ void
 sgen_client_print_gc_params_usage (void)
 {
 	fprintf (stderr, "  stack-mark=MARK-METHOD (where MARK-METHOD is 'precise' or 'conservative')\n");
+	fprintf (stderr, "                   ('precise' is experimental and falls back to 'conservative' on targets without GC maps)\n");
 }
 
 gboolean
@@ -25,6 +25,7 @@
 #include "metadata/sgen-bridge-internals.h"
 #include "metadata/gc-internals.h"
 #include "utils/mono-threads.h"
+#include "utils/mono-codeman.h"
 
 #define TV_DECLARE SGEN_TV_DECLARE
 #define TV_GETTIME SGEN_TV_GETTIME
@@ -35,6 +36,11 @@ static void sgen_unified_suspend_stop_world (void);
 
 static TV_DECLARE (end_of_last_stw);
 
+static guint64 time_to_safepoint;
+static guint64 stw_threads_suspended;
+static guint64 stw_straggler_threads;
+static guint64 stw_suspend_rounds;
+
 guint64 mono_time_since_last_stw ()
 {
 	if (end_of_last_stw == 0)
@@ -142,6 +148,9 @@ restart_threads_until_none_in_managed_allocator (void)
 		if (restart_count == 0)
 			break;
 
+		stw_straggler_threads += restart_count;
+		++stw_suspend_rounds;
+
 		/* wait for the threads to signal their restart */
 		sgen_wait_for_suspend_ack (restart_count);
 
@@ -285,6 +294,9 @@ sgen_client_restart_world (int generation, gint64 *stw_time)
 	 */
 	release_gc_locks ();
 
+	/* Every thread went through a suspend and restart, freed dynamic code can be reused */
+	mono_code_manager_safepoint ();
+
 	mono_profiler_gc_event (MONO_GC_EVENT_POST_START_WORLD_UNLOCKED, generation);
 
 	*stw_time = usec;
@@ -295,6 +307,10 @@ mono_sgen_init_stw (void)
 {
 	mono_counters_register ("World stop", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_TIME, &time_stop_world);
 	mono_counters_register ("World restart", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_TIME, &time_restart_world);
+	mono_counters_register ("World stop time to safepoint", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_TIME, &time_to_safepoint);
+	mono_counters_register ("World stop threads suspended", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stw_threads_suspended);
+	mono_counters_register ("World stop straggler threads", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stw_straggler_threads);
+	mono_counters_register ("World stop suspend rounds", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stw_suspend_rounds);
 }
 
 /* Unified suspend code */
@@ -360,6 +376,10 @@ sgen_unified_suspend_stop_world (void)
 {
 	int restart_counter;
 	int sleep_duration = -1;
+	TV_DECLARE (begin_suspend);
+	TV_DECLARE (end_suspend);
+
+	TV_GETTIME (begin_suspend);
 
 	mono_threads_begin_global_suspend ();
 	THREADS_STW_DEBUG ("[GC-STW-BEGIN] *** BEGIN SUSPEND *** \n");
@@ -370,6 +390,8 @@ sgen_unified_suspend_stop_world (void)
 		info->client_info.suspend_done = FALSE;
 		if (sgen_is_thread_in_current_stw (info, &reason)) {
 			info->client_info.skip = !mono_thread_info_begin_suspend (info);
+			if (!info->client_info.skip)
+				++stw_threads_suspended;
 			THREADS_STW_DEBUG ("[GC-STW-BEGIN-SUSPEND] SUSPEND thread %p skip %d\n", mono_thread_info_get_tid (info), info->client_info.skip);
 		} else {
 			THREADS_STW_DEBUG ("[GC-STW-BEGIN-SUSPEND] IGNORE thread %p skip %d reason %d\n", mono_thread_info_get_tid (info), info->client_info.skip, reason);
@@ -414,6 +436,8 @@ sgen_unified_suspend_stop_world (void)
 
 		if (restart_counter == 0)
 			break;
+		stw_straggler_threads += restart_counter;
+		++stw_suspend_rounds;
 		mono_threads_wait_pending_operations ();
 
 		if (sleep_duration < 0) {
@@ -442,6 +466,9 @@ sgen_unified_suspend_stop_world (void)
 		mono_threads_wait_pending_operations ();
 	}
 
+	TV_GETTIME (end_suspend);
+	time_to_safepoint += TV_ELAPSED (begin_suspend, end_suspend);
+
 	FOREACH_THREAD (info) {
 		int reason = 0;
 		if (sgen_is_thread_in_current_stw (info, &reason)) {
@@ -21,6 +21,7 @@
 #include "sgen-bridge-internals.h"
 #include "tabledefs.h"
 #include "utils/mono-logger-internals.h"
+#include "utils/mono-counters.h"
 
 #include "sgen-dynarray.h"
 
@@ -192,6 +193,8 @@ static int num_sccs;
 static int xref_count;
 
 static size_t setup_time, tarjan_time, scc_setup_time, gather_xref_time, xref_setup_time, cleanup_time;
+/* Accumulated over all collections, for the counters. */
+static guint64 total_setup_time, total_tarjan_time, total_scc_setup_time, total_gather_xref_time, total_xref_setup_time, total_cleanup_time;
 static SgenBridgeProcessor *bridge_processor;
 
 #define BUCKET_SIZE 8184
@@ -987,6 +990,9 @@ processing_stw_step (void)
 
 	tarjan_time = step_timer (&curtime);
 
+	total_setup_time += setup_time;
+	total_tarjan_time += tarjan_time;
+
 #if defined (DUMP_GRAPH)
 	printf ("----summary----\n");
 	printf ("bridges:\n");
@@ -1139,6 +1145,10 @@ processing_build_callback_data (int generation)
 	g_assert (xref_count == xref_index);
 	xref_setup_time = step_timer (&curtime);
 
+	total_scc_setup_time += scc_setup_time;
+	total_gather_xref_time += gather_xref_time;
+	total_xref_setup_time += xref_setup_time;
+
 #if defined (DUMP_GRAPH)
 	printf ("---xrefs:\n");
 	for (int i = 0; i < xref_count; ++i)
@@ -1167,6 +1177,7 @@ processing_after_callback (int generation)
 	cleanup ();
 
 	cleanup_time = step_timer (&curtime);
+	total_cleanup_time += cleanup_time;
 
 	mono_trace (G_LOG_LEVEL_INFO, MONO_TRACE_GC, "GC_TAR_BRIDGE bridges %d objects %d opaque %d colors %d colors-bridged %d colors-visible %d xref %d cache-hit %d cache-%s %d cache-miss %d setup %.2fms tarjan %.2fms scc-setup %.2fms gather-xref %.2fms xref-setup %.2fms cleanup %.2fms",
 		bridge_count, object_count, ignored_objects,
@@ -1214,6 +1225,28 @@ set_config (const SgenBridgeProcessorConfig *config)
 	}
 }
 
+/*
+ * The setup and tarjan phases run while the world is stopped, the others after it has
+ * been restarted, but still holding the GC lock.
+ */
+static void
+register_counters (void)
+{
+	static gboolean inited = FALSE;
+
+	if (inited)
+		return;
+
+	mono_counters_register ("Tarjan bridge setup", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_TIME, &total_setup_time);
+	mono_counters_register ("Tarjan bridge tarjan", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_TIME, &total_tarjan_time);
+	mono_counters_register ("Tarjan bridge scc setup", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_TIME, &total_scc_setup_time);
+	mono_counters_register ("Tarjan bridge gather xref", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_TIME, &total_gather_xref_time);
+	mono_counters_register ("Tarjan bridge xref setup", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_TIME, &total_xref_setup_time);
+	mono_counters_register ("Tarjan bridge cleanup", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_TIME, &total_cleanup_time);
+
+	inited = TRUE;
+}
+
 void
 sgen_tarjan_bridge_init (SgenBridgeProcessor *collector)
 {
@@ -1231,6 +1264,8 @@ sgen_tarjan_bridge_init (SgenBridgeProcessor *collector)
 	g_assert (sizeof (ColorBucket) <= BUCKET_SIZE);
 	g_assert (API_INDEX_BITS + INCOMING_COLORS_BITS <= 31);
 	bridge_processor = collector;
+
+	register_counters ();
 }
 
 #endif
@@ -1781,6 +1781,334 @@ ves_icall_System_Net_Sockets_Socket_SendTo_internal (SOCKET sock, MonoArray *buf
 	return ret;
 }
 
+#ifdef HOST_WIN32
+/* Windows has no batched datagram calls or MSG_ZEROCOPY */
+
+static int
+_wapi_sendmmsg (SOCKET sock, WSABUF *buffers, struct sockaddr **to, socklen_t *tolen, guint32 *sent, guint32 count, int send_flags)
+{
+	guint32 done;
+	int ret;
+
+	for (done = 0; done < count; done++) {
+		ret = sendto (sock, buffers [done].buf, buffers [done].len, send_flags, to ? to [done] : NULL, to && to [done] ? tolen [done] : 0);
+		if (ret == SOCKET_ERROR)
+			return done > 0 ? done : SOCKET_ERROR;
+		sent [done] = ret;
+	}
+	return done;
+}
+
+static int
+_wapi_recvmmsg (SOCKET sock, WSABUF *buffers, struct sockaddr **from, socklen_t *fromlen, guint32 *received, guint32 count, int recv_flags)
+{
+	int ret;
+
+	if (count == 0)
+		return 0;
+	ret = recvfrom (sock, buffers [0].buf, buffers [0].len, recv_flags, from ? from [0] : NULL, from ? &fromlen [0] : NULL);
+	if (ret == SOCKET_ERROR)
+		return SOCKET_ERROR;
+	received [0] = ret;
+	return 1;
+}
+
+static int
+_wapi_send_zerocopy (SOCKET sock, WSABUF *buffers, guint32 count, guint32 *sent, int send_flags, gboolean *zerocopy)
+{
+	*zerocopy = FALSE;
+	return WSASend (sock, buffers, count, (DWORD *) sent, send_flags, NULL, NULL);
+}
+
+static int
+_wapi_zerocopy_completion (SOCKET sock, guint32 *first, guint32 *last, gboolean *copied)
+{
+	WSASetLastError (WSAEOPNOTSUPP);
+	return SOCKET_ERROR;
+}
+#endif
+
+/*
+ * The batched and zero copy icalls take WSABUFs like Send_array_internal, so the
+ * caller pins the buffers once for as long as it reuses them, instead of the
+ * runtime pinning a byte[] for every call.
+ */
+
+/*
+ * Sends each buffer as one datagram, to the address at the same index of
+ * @sockaddrs, or to the connected peer if @sockaddrs or the address is null.
+ * @sent receives the size of each datagram sent. Returns the number of
+ * datagrams sent, which is less than the number of buffers if the socket
+ * buffer filled up.
+ */
+gint32
+ves_icall_System_Net_Sockets_Socket_SendMessages_internal (SOCKET sock, MonoArray *buffers, MonoArray *sockaddrs, MonoArray *sent, gint32 flags, gint32 *werror)
+{
+	MonoError error;
+	WSABUF *wsabufs;
+	struct sockaddr **sas = NULL;
+	socklen_t *sa_sizes = NULL;
+	guint32 *sizes;
+	int ret, count, i;
+	int sendflags = 0;
+	gboolean interrupted;
+
+	*werror = 0;
+
+	wsabufs = mono_array_addr (buffers, WSABUF, 0);
+	count = MIN (mono_array_length (buffers), mono_array_length (sent));
+
+	sendflags = convert_socketflags (flags);
+	if (sendflags == -1) {
+		*werror = WSAEOPNOTSUPP;
+		return 0;
+	}
+
+	sizes = g_new0 (guint32, count);
+	if (sockaddrs) {
+		sas = g_new0 (struct sockaddr *, count);
+		sa_sizes = g_new0 (socklen_t, count);
+		for (i = 0; i < count && i < mono_array_length (sockaddrs); i++) {
+			MonoObject *sockaddr = mono_array_get (sockaddrs, MonoObject *, i);
+
+			if (!sockaddr)
+				continue;
+			sas [i] = create_sockaddr_from_object (sockaddr, &sa_sizes [i], werror, &error);
+			if (*werror != 0) {
+				ret = 0;
+				goto done;
+			}
+			if (!mono_error_ok (&error)) {
+				mono_error_set_pending_exception (&error);
+				ret = 0;
+				goto done;
+			}
+		}
+	}
+
+	mono_thread_info_install_interrupt (abort_syscall, (gpointer) (gsize) mono_native_thread_id_get (), &interrupted);
+	if (interrupted) {
+		*werror = WSAEINTR;
+		ret = 0;
+		goto done;
+	}
+
+	MONO_ENTER_GC_SAFE;
+
+	ret = _wapi_sendmmsg (sock, wsabufs, sas, sa_sizes, sizes, count, sendflags);
+
+	MONO_EXIT_GC_SAFE;
+
+	if (ret == SOCKET_ERROR)
+		*werror = WSAGetLastError ();
+
+	mono_thread_info_uninstall_interrupt (&interrupted);
+	if (interrupted)
+		*werror = WSAEINTR;
+
+	if (*werror) {
+		ret = 0;
+		goto done;
+	}
+
+	for (i = 0; i < ret; i++)
+		mono_array_set (sent, gint32, i, sizes [i]);
+
+done:
+	if (sas) {
+		for (i = 0; i < count; i++)
+			g_free (sas [i]);
+		g_free (sas);
+		g_free (sa_sizes);
+	}
+	g_free (sizes);
+	return ret;
+}
+
+/*
+ * Receives up to one datagram per buffer, waiting only for the first one.
+ * @received receives the size of each datagram and, if it's not null,
+ * @sockaddrs its source address. Returns the number of datagrams received.
+ */
+gint32
+ves_icall_System_Net_Sockets_Socket_ReceiveMessages_internal (SOCKET sock, MonoArray *buffers, MonoArray *sockaddrs, MonoArray *received, gint32 flags, gint32 *werror)
+{
+	MonoError error;
+	WSABUF *wsabufs;
+	struct sockaddr_storage *storage = NULL;
+	struct sockaddr **sas = NULL;
+	socklen_t *sa_sizes = NULL;
+	guint32 *sizes;
+	int ret, count, i;
+	int recvflags = 0;
+	gboolean interrupted;
+
+	*werror = 0;
+
+	wsabufs = mono_array_addr (buffers, WSABUF, 0);
+	count = MIN (mono_array_length (buffers), mono_array_length (received));
+	if (sockaddrs)
+		count = MIN (count, mono_array_length (sockaddrs));
+
+	recvflags = convert_socketflags (flags);
+	if (recvflags == -1) {
+		*werror = WSAEOPNOTSUPP;
+		return 0;
+	}
+
+	sizes = g_new0 (guint32, count);
+	if (sockaddrs) {
+		storage = g_new0 (struct sockaddr_storage, count);
+		sas = g_new0 (struct sockaddr *, count);
+		sa_sizes = g_new0 (socklen_t, count);
+		for (i = 0; i < count; i++) {
+			sas [i] = (struct sockaddr *) &storage [i];
+			sa_sizes [i] = sizeof (struct sockaddr_storage);
+		}
+	}
+
+	mono_thread_info_install_interrupt (abort_syscall, (gpointer) (gsize) mono_native_thread_id_get (), &interrupted);
+	if (interrupted) {
+		*werror = WSAEINTR;
+		ret = 0;
+		goto done;
+	}
+
+	MONO_ENTER_GC_SAFE;
+
+	ret = _wapi_recvmmsg (sock, wsabufs, sas, sa_sizes, sizes, count, recvflags);
+
+	MONO_EXIT_GC_SAFE;
+
+	if (ret == SOCKET_ERROR)
+		*werror = WSAGetLastError ();
+
+	mono_thread_info_uninstall_interrupt (&interrupted);
+	if (interrupted)
+		*werror = WSAEINTR;
+
+	if (*werror) {
+		ret = 0;
+		goto done;
+	}
+
+	for (i = 0; i < ret; i++) {
+		mono_array_set (received, gint32, i, sizes [i]);
+		if (sockaddrs) {
+			MonoObject *sockaddr = NULL;
+
+			/* Connected sockets might not return an address */
+			if (sa_sizes [i]) {
+				sockaddr = create_object_from_sockaddr (sas [i], sa_sizes [i], werror, &error);
+				if (!mono_error_ok (&error)) {
+					mono_error_set_pending_exception (&error);
+					ret = 0;
+					goto done;
+				}
+			}
+			mono_array_setref (sockaddrs, i, sockaddr);
+		}
+	}
+
+done:
+	g_free (storage);
+	g_free (sas);
+	g_free (sa_sizes);
+	g_free (sizes);
+	return ret;
+}
+
+/* Below this, copying the data is cheaper than the zero copy page pinning and completion */
+#define ZEROCOPY_MIN_SIZE (16 * 1024)
+
+/*
+ * Like Send_array_internal, but large sends use MSG_ZEROCOPY where the kernel
+ * supports it. *@zerocopy is set for those, and the buffers must then stay
+ * pinned and unchanged until ZeroCopyCompletion_internal reports the send.
+ * Sends are numbered from 0, counting only the ones which set *@zerocopy.
+ */
+gint32
+ves_icall_System_Net_Sockets_Socket_SendZeroCopy_internal (SOCKET sock, MonoArray *buffers, gint32 flags, MonoBoolean *zerocopy, gint32 *werror)
+{
+	int ret, count, i;
+	guint32 sent = 0;
+	gsize total = 0;
+	WSABUF *wsabufs;
+	int sendflags = 0;
+	gboolean interrupted, used_zerocopy = FALSE;
+
+	*werror = 0;
+	*zerocopy = FALSE;
+
+	wsabufs = mono_array_addr (buffers, WSABUF, 0);
+	count = mono_array_length (buffers);
+	for (i = 0; i < count; i++)
+		total += wsabufs [i].len;
+
+	sendflags = convert_socketflags (flags);
+	if (sendflags == -1) {
+		*werror = WSAEOPNOTSUPP;
+		return 0;
+	}
+
+	mono_thread_info_install_interrupt (abort_syscall, (gpointer) (gsize) mono_native_thread_id_get (), &interrupted);
+	if (interrupted) {
+		*werror = WSAEINTR;
+		return 0;
+	}
+
+	MONO_ENTER_GC_SAFE;
+
+	if (total >= ZEROCOPY_MIN_SIZE)
+		ret = _wapi_send_zerocopy (sock, wsabufs, count, &sent, sendflags, &used_zerocopy);
+	else
+		ret = WSASend (sock, wsabufs, count, &sent, sendflags, NULL, NULL);
+
+	MONO_EXIT_GC_SAFE;
+
+	if (ret == SOCKET_ERROR)
+		*werror = WSAGetLastError ();
+
+	mono_thread_info_uninstall_interrupt (&interrupted);
+	if (interrupted)
+		*werror = WSAEINTR;
+
+	if (*werror)
+		return 0;
+
+	*zerocopy = used_zerocopy;
+	return sent;
+}
+
+/*
+ * Dequeues one completion of the zero copy sends of @sock, covering the sends
+ * numbered *@first to *@last. *@copied is set if the kernel had to copy the
+ * data, in which case zero copy sends aren't worth it for this socket. Returns
+ * FALSE without waiting if there are no completions.
+ */
+MonoBoolean
+ves_icall_System_Net_Sockets_Socket_ZeroCopyCompletion_internal (SOCKET sock, guint32 *first, guint32 *last, MonoBoolean *copied, gint32 *werror)
+{
+	gboolean was_copied = FALSE;
+	int ret;
+
+	*werror = 0;
+	*first = *last = 0;
+	*copied = FALSE;
+
+	MONO_ENTER_GC_SAFE;
+	ret = _wapi_zerocopy_completion (sock, first, last, &was_copied);
+	MONO_EXIT_GC_SAFE;
+
+	if (ret == SOCKET_ERROR) {
+		*werror = WSAGetLastError ();
+		return FALSE;
+	}
+
+	*copied = was_copied;
+	return ret == 1;
+}
+
 static SOCKET
 Socket_to_SOCKET (MonoObject *sockobj)
 {
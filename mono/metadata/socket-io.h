@@ -176,6 +176,10 @@ extern gint32 ves_icall_System_Net_Sockets_Socket_ReceiveFrom_internal(SOCKET so
 extern gint32 ves_icall_System_Net_Sockets_Socket_Send_internal(SOCKET sock, MonoArray *buffer, gint32 offset, gint32 count, gint32 flags, gint32 *error);
 extern gint32 ves_icall_System_Net_Sockets_Socket_Send_array_internal(SOCKET sock, MonoArray *buffers, gint32 flags, gint32 *error);
 extern gint32 ves_icall_System_Net_Sockets_Socket_SendTo_internal(SOCKET sock, MonoArray *buffer, gint32 offset, gint32 count, gint32 flags, MonoObject *sockaddr, gint32 *error);
+extern gint32 ves_icall_System_Net_Sockets_Socket_SendMessages_internal(SOCKET sock, MonoArray *buffers, MonoArray *sockaddrs, MonoArray *sent, gint32 flags, gint32 *error);
+extern gint32 ves_icall_System_Net_Sockets_Socket_ReceiveMessages_internal(SOCKET sock, MonoArray *buffers, MonoArray *sockaddrs, MonoArray *received, gint32 flags, gint32 *error);
+extern gint32 ves_icall_System_Net_Sockets_Socket_SendZeroCopy_internal(SOCKET sock, MonoArray *buffers, gint32 flags, MonoBoolean *zerocopy, gint32 *error);
+extern MonoBoolean ves_icall_System_Net_Sockets_Socket_ZeroCopyCompletion_internal(SOCKET sock, guint32 *first, guint32 *last, MonoBoolean *copied, gint32 *error);
 extern void ves_icall_System_Net_Sockets_Socket_Select_internal(MonoArray **sockets, gint32 timeout, gint32 *error);
 extern void ves_icall_System_Net_Sockets_Socket_Shutdown_internal(SOCKET sock, gint32 how, gint32 *error);
 extern void ves_icall_System_Net_Sockets_Socket_GetSocketOption_obj_internal(SOCKET sock, gint32 level, gint32 name, MonoObject **obj_val, gint32 *error);
@@ -43,6 +43,11 @@ mono_sre_generic_param_table_entry_free (GenericParamTableEntry *entry)
 }
 
 static GENERATE_GET_CLASS_WITH_CACHE (marshal_as_attribute, System.Runtime.InteropServices, MarshalAsAttribute);
+#ifndef DISABLE_REFLECTION_EMIT
+static GENERATE_GET_CLASS_WITH_CACHE (mono_method, System.Reflection, MonoMethod);
+static GENERATE_GET_CLASS_WITH_CACHE (mono_cmethod, System.Reflection, MonoCMethod);
+static GENERATE_GET_CLASS_WITH_CACHE (mono_field, System.Reflection, MonoField);
+#endif
 
 #ifndef DISABLE_REFLECTION_EMIT
 static guint32 mono_image_get_methodref_token (MonoDynamicImage *assembly, MonoMethod *method, gboolean create_typespec);
@@ -1812,7 +1817,7 @@ mono_reflection_dynimage_basic_init (MonoReflectionAssemblyBuilder *assemblyb)
 
 #if HAVE_BOEHM_GC
 	/* assembly->assembly.image might be GC allocated */
-	assembly = assemblyb->dynamic_assembly = (MonoDynamicAssembly *)GC_MALLOC (sizeof (MonoDynamicAssembly));
+	assembly = assemblyb->dynamic_assembly = (MonoDynamicAssembly *)mono_gc_alloc_fixed (sizeof (MonoDynamicAssembly), MONO_GC_DESCRIPTOR_NULL, MONO_ROOT_SOURCE_REFLECTION, "dynamic assembly");
 #else
 	assembly = assemblyb->dynamic_assembly = g_new0 (MonoDynamicAssembly, 1);
 #endif
@@ -3187,7 +3192,13 @@ reflection_methodbuilder_to_mono_method (MonoClass *klass,
 	if (!dynamic)
 		g_assert (!klass->generic_class);
 
-	mono_loader_lock ();
+	/*
+	 * The loader lock protects the image mempool. Dynamic methods are malloc'd and
+	 * not visible to other threads until we return, so they don't need it, which
+	 * avoids serializing code that creates lots of them on several threads.
+	 */
+	if (!dynamic)
+		mono_loader_lock ();
 
 	if ((rmb->attrs & METHOD_ATTRIBUTE_PINVOKE_IMPL) ||
 			(rmb->iattrs & METHOD_IMPL_ATTRIBUTE_INTERNAL_CALL))
@@ -3226,10 +3237,16 @@ reflection_methodbuilder_to_mono_method (MonoClass *klass,
 		
 		((MonoMethodPInvoke*)m)->piflags = (rmb->native_cc << 8) | (rmb->charset ? (rmb->charset - 1) * 2 : 0) | rmb->extra_flags;
 
-		if (image_is_dynamic (klass->image))
+		if (image_is_dynamic (klass->image)) {
+			if (dynamic)
+				mono_loader_lock ();
 			g_hash_table_insert (((MonoDynamicImage*)klass->image)->method_aux_hash, m, method_aux);
+			if (dynamic)
+				mono_loader_unlock ();
+		}
 
-		mono_loader_unlock ();
+		if (!dynamic)
+			mono_loader_unlock ();
 
 		return m;
 	} else if (!(m->flags & METHOD_ATTRIBUTE_ABSTRACT) &&
@@ -3413,7 +3430,8 @@ reflection_methodbuilder_to_mono_method (MonoClass *klass,
 					specs [pb->position] = 
 						mono_marshal_spec_from_builder (image, klass->image->assembly, pb->marshal_info, error);
 					if (!is_ok (error)) {
-						mono_loader_unlock ();
+						if (!dynamic)
+							mono_loader_unlock ();
 						image_g_free (image, specs);
 						/* FIXME: if image is NULL, this leaks all the other stuff we alloc'd in this function */
 						return NULL;
@@ -3427,10 +3445,16 @@ reflection_methodbuilder_to_mono_method (MonoClass *klass,
 		method_aux->param_marshall = specs;
 	}
 
-	if (image_is_dynamic (klass->image) && method_aux)
+	if (image_is_dynamic (klass->image) && method_aux) {
+		if (dynamic)
+			mono_loader_lock ();
 		g_hash_table_insert (((MonoDynamicImage*)klass->image)->method_aux_hash, m, method_aux);
+		if (dynamic)
+			mono_loader_unlock ();
+	}
 
-	mono_loader_unlock ();
+	if (!dynamic)
+		mono_loader_unlock ();
 
 	return m;
 }	
@@ -4447,6 +4471,39 @@ free_dynamic_method (void *dynamic_method)
 	g_free (data);
 }
 
+/*
+ * resolve_dynamic_method_ref:
+ *
+ *   Same as mono_reflection_resolve_object () without a generic context, with
+ * fast paths for the kinds of objects DynamicMethods usually reference, which
+ * are recognized by their class instead of a chain of name comparisons.
+ */
+static gpointer
+resolve_dynamic_method_ref (MonoImage *image, MonoObject *obj, MonoClass **handle_class, MonoError *error)
+{
+	MonoClass *klass = obj->vtable->klass;
+
+	mono_error_init (error);
+
+	if (klass == mono_defaults.string_class) {
+		*handle_class = mono_defaults.string_class;
+		return mono_string_intern_checked ((MonoString*)obj, error);
+	} else if (klass == mono_class_get_mono_method_class () || klass == mono_class_get_mono_cmethod_class ()) {
+		*handle_class = mono_defaults.methodhandle_class;
+		return ((MonoReflectionMethod*)obj)->method;
+	} else if (klass == mono_class_get_mono_field_class ()) {
+		MonoClassField *field = ((MonoReflectionField*)obj)->field;
+
+		/* ensure_complete_type () only has work to do for these */
+		if (!image_is_dynamic (field->parent->image) && !field->parent->generic_class) {
+			*handle_class = mono_defaults.fieldhandle_class;
+			return field;
+		}
+	}
+
+	return mono_reflection_resolve_object (image, obj, handle_class, NULL, error);
+}
+
 static gboolean
 reflection_create_dynamic_method (MonoReflectionDynamicMethod *mb, MonoError *error)
 {
@@ -4513,7 +4570,7 @@ reflection_create_dynamic_method (MonoReflectionDynamicMethod *mb, MonoError *er
 			handle_class = mono_defaults.methodhandle_class;
 		} else {
 			MonoException *ex = NULL;
-			ref = mono_reflection_resolve_object (mb->module->image, obj, &handle_class, NULL, error);
+			ref = resolve_dynamic_method_ref (mb->module->image, obj, &handle_class, error);
 			if (!is_ok  (error)) {
 				g_free (rmb.refs);
 				return FALSE;
@@ -9,14 +9,21 @@
 #endif
 
 #define EPOLL_NEVENTS 128
+/* The event buffer of a selector grows up to this size while epoll_wait () fills it */
+#define EPOLL_NEVENTS_MAX 4096
 
-static gint epoll_fd;
-static struct epoll_event *epoll_events;
+typedef struct {
+	gint fd;
+	struct epoll_event *events;
+	gint nevents;
+} EpollSelector;
 
-static gboolean
+static gpointer
 epoll_init (gint wakeup_pipe_fd)
 {
+	EpollSelector *selector;
 	struct epoll_event event;
+	gint epoll_fd;
 
 #ifdef EPOOL_CLOEXEC
 	epoll_fd = epoll_create1 (EPOLL_CLOEXEC);
@@ -31,7 +38,7 @@ epoll_init (gint wakeup_pipe_fd)
 #else
 		g_error ("epoll_init: epoll (256) failed, error (%d) %s\n", errno, g_strerror (errno));
 #endif
-		return FALSE;
+		return NULL;
 	}
 
 	event.events = EPOLLIN;
@@ -39,53 +46,61 @@ epoll_init (gint wakeup_pipe_fd)
 	if (epoll_ctl (epoll_fd, EPOLL_CTL_ADD, event.data.fd, &event) == -1) {
 		g_error ("epoll_init: epoll_ctl () failed, error (%d) %s", errno, g_strerror (errno));
 		close (epoll_fd);
-		return FALSE;
+		return NULL;
 	}
 
-	epoll_events = g_new0 (struct epoll_event, EPOLL_NEVENTS);
+	selector = g_new0 (EpollSelector, 1);
+	selector->fd = epoll_fd;
+	selector->nevents = EPOLL_NEVENTS;
+	selector->events = g_new0 (struct epoll_event, selector->nevents);
 
-	return TRUE;
+	return selector;
 }
 
 static void
-epoll_register_fd (gint fd, gint events, gboolean is_new)
+epoll_register_fd (gpointer data, gint fd, gint events, gboolean is_new)
 {
+	EpollSelector *selector = (EpollSelector *)data;
 	struct epoll_event event;
 
-#ifndef EPOLLONESHOT
-/* it was only defined on android in May 2013 */
-#define EPOLLONESHOT 0x40000000
-#endif
-
+	/*
+	 * The registration is edge triggered and persistent, so events don't need to be armed
+	 * again after being reported. Registering again on new jobs makes epoll report the
+	 * events which are already pending.
+	 */
 	event.data.fd = fd;
-	event.events = EPOLLONESHOT;
+	event.events = EPOLLET;
 	if ((events & EVENT_IN) != 0)
 		event.events |= EPOLLIN;
 	if ((events & EVENT_OUT) != 0)
 		event.events |= EPOLLOUT;
 
-	if (epoll_ctl (epoll_fd, is_new ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, event.data.fd, &event) == -1)
+	if (epoll_ctl (selector->fd, is_new ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, event.data.fd, &event) == -1)
 		g_error ("epoll_register_fd: epoll_ctl(%s) failed, error (%d) %s", is_new ? "EPOLL_CTL_ADD" : "EPOLL_CTL_MOD", errno, g_strerror (errno));
 }
 
 static void
-epoll_remove_fd (gint fd)
+epoll_remove_fd (gpointer data, gint fd)
 {
-	if (epoll_ctl (epoll_fd, EPOLL_CTL_DEL, fd, NULL) == -1)
+	EpollSelector *selector = (EpollSelector *)data;
+
+	if (epoll_ctl (selector->fd, EPOLL_CTL_DEL, fd, NULL) == -1)
 			g_error ("epoll_remove_fd: epoll_ctl (EPOLL_CTL_DEL) failed, error (%d) %s", errno, g_strerror (errno));
 }
 
 static gint
-epoll_event_wait (void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data)
+epoll_event_wait (gpointer data, void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data)
 {
+	EpollSelector *selector = (EpollSelector *)data;
+	struct epoll_event *epoll_events = selector->events;
 	gint i, ready;
 
-	memset (epoll_events, 0, sizeof (struct epoll_event) * EPOLL_NEVENTS);
+	memset (epoll_events, 0, sizeof (struct epoll_event) * selector->nevents);
 
 	mono_gc_set_skip_thread (TRUE);
 
 	MONO_ENTER_GC_SAFE;
-	ready = epoll_wait (epoll_fd, epoll_events, EPOLL_NEVENTS, -1);
+	ready = epoll_wait (selector->fd, epoll_events, selector->nevents, -1);
 	MONO_EXIT_GC_SAFE;
 
 	mono_gc_set_skip_thread (FALSE);
@@ -117,6 +132,12 @@ epoll_event_wait (void (*callback) (gint fd, gint events, gpointer user_data), g
 		callback (fd, events, user_data);
 	}
 
+	/* A full buffer means more events are likely pending, so fetch more of them at once */
+	if (ready == selector->nevents && selector->nevents < EPOLL_NEVENTS_MAX) {
+		selector->nevents *= 2;
+		selector->events = g_renew (struct epoll_event, selector->events, selector->nevents);
+	}
+
 	return 0;
 }
 
@@ -125,6 +146,7 @@ static ThreadPoolIOBackend backend_epoll = {
 	.register_fd = epoll_register_fd,
 	.remove_fd = epoll_remove_fd,
 	.event_wait = epoll_event_wait,
+	.edge_triggered = TRUE,
 };
 
 #endif
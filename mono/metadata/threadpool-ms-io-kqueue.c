@@ -11,78 +11,95 @@
 #endif
 
 #define KQUEUE_NEVENTS 128
+/* The event buffer of a selector grows up to this size while kevent () fills it */
+#define KQUEUE_NEVENTS_MAX 4096
 
-static gint kqueue_fd;
-static struct kevent *kqueue_events;
+typedef struct {
+	gint fd;
+	struct kevent *events;
+	gint nevents;
+} KqueueSelector;
 
 static gint
-KQUEUE_INIT_FD (gint fd, gint events, gint flags)
+KQUEUE_INIT_FD (gint kqueue_fd, gint fd, gint events, gint flags)
 {
 	struct kevent event;
 	EV_SET (&event, fd, events, flags, 0, 0, 0);
 	return kevent (kqueue_fd, &event, 1, NULL, 0, NULL);
 }
 
-static gboolean
+static gpointer
 kqueue_init (gint wakeup_pipe_fd)
 {
+	KqueueSelector *selector;
+	gint kqueue_fd;
+
 	kqueue_fd = kqueue ();
 	if (kqueue_fd == -1) {
 		g_error ("kqueue_init: kqueue () failed, error (%d) %s", errno, g_strerror (errno));
-		return FALSE;
+		return NULL;
 	}
 
-	if (KQUEUE_INIT_FD (wakeup_pipe_fd, EVFILT_READ, EV_ADD | EV_ENABLE) == -1) {
+	if (KQUEUE_INIT_FD (kqueue_fd, wakeup_pipe_fd, EVFILT_READ, EV_ADD | EV_ENABLE) == -1) {
 		g_error ("kqueue_init: kevent () failed, error (%d) %s", errno, g_strerror (errno));
 		close (kqueue_fd);
-		return FALSE;
+		return NULL;
 	}
 
-	kqueue_events = g_new0 (struct kevent, KQUEUE_NEVENTS);
+	selector = g_new0 (KqueueSelector, 1);
+	selector->fd = kqueue_fd;
+	selector->nevents = KQUEUE_NEVENTS;
+	selector->events = g_new0 (struct kevent, selector->nevents);
 
-	return TRUE;
+	return selector;
 }
 
 static void
-kqueue_register_fd (gint fd, gint events, gboolean is_new)
+kqueue_register_fd (gpointer data, gint fd, gint events, gboolean is_new)
 {
+	KqueueSelector *selector = (KqueueSelector *)data;
+
 	if (events & EVENT_IN) {
-		if (KQUEUE_INIT_FD (fd, EVFILT_READ, EV_ADD | EV_ENABLE) == -1)
+		if (KQUEUE_INIT_FD (selector->fd, fd, EVFILT_READ, EV_ADD | EV_ENABLE) == -1)
 			g_error ("kqueue_register_fd: kevent(read,enable) failed, error (%d) %s", errno, g_strerror (errno));
 	} else {
-		if (KQUEUE_INIT_FD (fd, EVFILT_READ, EV_ADD | EV_DISABLE) == -1)
+		if (KQUEUE_INIT_FD (selector->fd, fd, EVFILT_READ, EV_ADD | EV_DISABLE) == -1)
 			g_error ("kqueue_register_fd: kevent(read,disable) failed, error (%d) %s", errno, g_strerror (errno));
 	}
 	if (events & EVENT_OUT) {
-		if (KQUEUE_INIT_FD (fd, EVFILT_WRITE, EV_ADD | EV_ENABLE) == -1)
+		if (KQUEUE_INIT_FD (selector->fd, fd, EVFILT_WRITE, EV_ADD | EV_ENABLE) == -1)
 			g_error ("kqueue_register_fd: kevent(write,enable) failed, error (%d) %s", errno, g_strerror (errno));
 	} else {
-		if (KQUEUE_INIT_FD (fd, EVFILT_WRITE, EV_ADD | EV_DISABLE) == -1)
+		if (KQUEUE_INIT_FD (selector->fd, fd, EVFILT_WRITE, EV_ADD | EV_DISABLE) == -1)
 			g_error ("kqueue_register_fd: kevent(write,disable) failed, error (%d) %s", errno, g_strerror (errno));
 	}
 }
 
 static void
-kqueue_remove_fd (gint fd)
+kqueue_remove_fd (gpointer data, gint fd)
 {
+	KqueueSelector *selector = (KqueueSelector *)data;
+
 	/* FIXME: a race between closing and adding operation in the Socket managed code trigger a ENOENT error */
-	if (KQUEUE_INIT_FD (fd, EVFILT_READ, EV_DELETE) == -1)
+	if (KQUEUE_INIT_FD (selector->fd, fd, EVFILT_READ, EV_DELETE) == -1)
 		g_error ("kqueue_register_fd: kevent(read,delete) failed, error (%d) %s", errno, g_strerror (errno));
-	if (KQUEUE_INIT_FD (fd, EVFILT_WRITE, EV_DELETE) == -1)
+	if (KQUEUE_INIT_FD (selector->fd, fd, EVFILT_WRITE, EV_DELETE) == -1)
 		g_error ("kqueue_register_fd: kevent(write,delete) failed, error (%d) %s", errno, g_strerror (errno));
 }
 
 static gint
-kqueue_event_wait (void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data)
+kqueue_event_wait (gpointer data, void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data)
 {
+	KqueueSelector *selector = (KqueueSelector *)data;
+	struct kevent *kqueue_events = selector->events;
 	gint i, ready;
 
-	memset (kqueue_events, 0, sizeof (struct kevent) * KQUEUE_NEVENTS);
+	memset (kqueue_events, 0, sizeof (struct kevent) * selector->nevents);
 
 	mono_gc_set_skip_thread (TRUE);
 
 	MONO_ENTER_GC_SAFE;
-	ready = kevent (kqueue_fd, NULL, 0, kqueue_events, KQUEUE_NEVENTS, NULL);
+	ready = kevent (selector->fd, NULL, 0, kqueue_events, selector->nevents, NULL);
 	MONO_EXIT_GC_SAFE;
 
 	mono_gc_set_skip_thread (FALSE);
@@ -114,6 +131,12 @@ kqueue_event_wait (void (*callback) (gint fd, gint events, gpointer user_data),
 		callback (fd, events, user_data);
 	}
 
+	/* A full buffer means more events are likely pending, so fetch more of them at once */
+	if (ready == selector->nevents && selector->nevents < KQUEUE_NEVENTS_MAX) {
+		selector->nevents *= 2;
+		selector->events = g_renew (struct kevent, selector->events, selector->nevents);
+	}
+
 	return 0;
 }
 
@@ -1,9 +1,11 @@
 
 #include "utils/mono-poll.h"
 
-static mono_pollfd *poll_fds;
-static guint poll_fds_capacity;
-static guint poll_fds_size;
+typedef struct {
+	mono_pollfd *fds;
+	guint capacity;
+	guint size;
+} PollSelector;
 
 static inline void
 POLL_INIT_FD (mono_pollfd *poll_fd, gint fd, gint events)
@@ -13,29 +15,33 @@ POLL_INIT_FD (mono_pollfd *poll_fd, gint fd, gint events)
 	poll_fd->revents = 0;
 }
 
-static gboolean
+static gpointer
 poll_init (gint wakeup_pipe_fd)
 {
+	PollSelector *selector;
+
 	g_assert (wakeup_pipe_fd >= 0);
 
-	poll_fds_size = 1;
-	poll_fds_capacity = 64;
+	selector = g_new0 (PollSelector, 1);
+	selector->size = 1;
+	selector->capacity = 64;
 
-	poll_fds = g_new0 (mono_pollfd, poll_fds_capacity);
+	selector->fds = g_new0 (mono_pollfd, selector->capacity);
 
-	POLL_INIT_FD (&poll_fds [0], wakeup_pipe_fd, MONO_POLLIN);
+	POLL_INIT_FD (&selector->fds [0], wakeup_pipe_fd, MONO_POLLIN);
 
-	return TRUE;
+	return selector;
 }
 
 static void
-poll_register_fd (gint fd, gint events, gboolean is_new)
+poll_register_fd (gpointer data, gint fd, gint events, gboolean is_new)
 {
+	PollSelector *selector = (PollSelector *)data;
 	gint i;
 	gint poll_event;
 
 	g_assert (fd >= 0);
-	g_assert (poll_fds_size <= poll_fds_capacity);
+	g_assert (selector->size <= selector->capacity);
 
 	g_assert ((events & ~(EVENT_IN | EVENT_OUT)) == 0);
 
@@ -45,62 +51,63 @@ poll_register_fd (gint fd, gint events, gboolean is_new)
 	if (events & EVENT_OUT)
 		poll_event |= MONO_POLLOUT;
 
-	for (i = 0; i < poll_fds_size; ++i) {
-		if (poll_fds [i].fd == fd) {
+	for (i = 0; i < selector->size; ++i) {
+		if (selector->fds [i].fd == fd) {
 			g_assert (!is_new);
-			POLL_INIT_FD (&poll_fds [i], fd, poll_event);
+			POLL_INIT_FD (&selector->fds [i], fd, poll_event);
 			return;
 		}
 	}
 
 	g_assert (is_new);
 
-	for (i = 0; i < poll_fds_size; ++i) {
-		if (poll_fds [i].fd == -1) {
-			POLL_INIT_FD (&poll_fds [i], fd, poll_event);
+	for (i = 0; i < selector->size; ++i) {
+		if (selector->fds [i].fd == -1) {
+			POLL_INIT_FD (&selector->fds [i], fd, poll_event);
 			return;
 		}
 	}
 
-	poll_fds_size += 1;
+	selector->size += 1;
 
-	if (poll_fds_size > poll_fds_capacity) {
-		poll_fds_capacity *= 2;
-		g_assert (poll_fds_size <= poll_fds_capacity);
+	if (selector->size > selector->capacity) {
+		selector->capacity *= 2;
+		g_assert (selector->size <= selector->capacity);
 
-		poll_fds = (mono_pollfd *)g_renew (mono_pollfd, poll_fds, poll_fds_capacity);
+		selector->fds = (mono_pollfd *)g_renew (mono_pollfd, selector->fds, selector->capacity);
 	}
 
-	POLL_INIT_FD (&poll_fds [poll_fds_size - 1], fd, poll_event);
+	POLL_INIT_FD (&selector->fds [selector->size - 1], fd, poll_event);
 }
 
 static void
-poll_remove_fd (gint fd)
+poll_remove_fd (gpointer data, gint fd)
 {
+	PollSelector *selector = (PollSelector *)data;
 	gint i;
 
 	g_assert (fd >= 0);
 
-	for (i = 0; i < poll_fds_size; ++i) {
-		if (poll_fds [i].fd == fd) {
-			POLL_INIT_FD (&poll_fds [i], -1, 0);
+	for (i = 0; i < selector->size; ++i) {
+		if (selector->fds [i].fd == fd) {
+			POLL_INIT_FD (&selector->fds [i], -1, 0);
 			break;
 		}
 	}
 
-	/* if we don't find the fd in poll_fds,
+	/* if we don't find the fd in selector->fds,
 	 * it means we try to delete it twice */
-	g_assert (i < poll_fds_size);
+	g_assert (i < selector->size);
 
 	/* if we find it again, it means we added
 	 * it twice */
-	for (; i < poll_fds_size; ++i)
-		g_assert (poll_fds [i].fd != fd);
+	for (; i < selector->size; ++i)
+		g_assert (selector->fds [i].fd != fd);
 
-	/* reduce the value of poll_fds_size so we
+	/* reduce the value of selector->size so we
 	 * do not keep it too big */
-	while (poll_fds_size > 1 && poll_fds [poll_fds_size - 1].fd == -1)
-		poll_fds_size -= 1;
+	while (selector->size > 1 && selector->fds [selector->size - 1].fd == -1)
+		selector->size -= 1;
 }
 
 static inline gint
@@ -134,17 +141,18 @@ poll_mark_bad_fds (mono_pollfd *poll_fds, gint poll_fds_size)
 }
 
 static gint
-poll_event_wait (void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data)
+poll_event_wait (gpointer data, void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data)
 {
+	PollSelector *selector = (PollSelector *)data;
 	gint i, ready;
 
-	for (i = 0; i < poll_fds_size; ++i)
-		poll_fds [i].revents = 0;
+	for (i = 0; i < selector->size; ++i)
+		selector->fds [i].revents = 0;
 
 	mono_gc_set_skip_thread (TRUE);
 
 	MONO_ENTER_GC_SAFE;
-	ready = mono_poll (poll_fds, poll_fds_size, -1);
+	ready = mono_poll (selector->fds, selector->size, -1);
 	MONO_EXIT_GC_SAFE;
 
 	mono_gc_set_skip_thread (FALSE);
@@ -185,7 +193,7 @@ poll_event_wait (void (*callback) (gint fd, gint events, gpointer user_data), gp
 		case WSAEBADF:
 #endif
 		{
-			ready = poll_mark_bad_fds (poll_fds, poll_fds_size);
+			ready = poll_mark_bad_fds (selector->fds, selector->size);
 			break;
 		}
 		default:
@@ -205,20 +213,20 @@ poll_event_wait (void (*callback) (gint fd, gint events, gpointer user_data), gp
 
 	g_assert (ready > 0);
 
-	for (i = 0; i < poll_fds_size; ++i) {
+	for (i = 0; i < selector->size; ++i) {
 		gint fd, events = 0;
 
-		if (poll_fds [i].fd == -1)
+		if (selector->fds [i].fd == -1)
 			continue;
-		if (poll_fds [i].revents == 0)
+		if (selector->fds [i].revents == 0)
 			continue;
 
-		fd = poll_fds [i].fd;
-		if (poll_fds [i].revents & (MONO_POLLIN | MONO_POLLERR | MONO_POLLHUP | MONO_POLLNVAL))
+		fd = selector->fds [i].fd;
+		if (selector->fds [i].revents & (MONO_POLLIN | MONO_POLLERR | MONO_POLLHUP | MONO_POLLNVAL))
 			events |= EVENT_IN;
-		if (poll_fds [i].revents & (MONO_POLLOUT | MONO_POLLERR | MONO_POLLHUP | MONO_POLLNVAL))
+		if (selector->fds [i].revents & (MONO_POLLOUT | MONO_POLLERR | MONO_POLLHUP | MONO_POLLNVAL))
 			events |= EVENT_OUT;
-		if (poll_fds [i].revents & (MONO_POLLERR | MONO_POLLHUP | MONO_POLLNVAL))
+		if (selector->fds [i].revents & (MONO_POLLERR | MONO_POLLHUP | MONO_POLLNVAL))
 			events |= EVENT_ERR;
 
 		callback (fd, events, user_data);
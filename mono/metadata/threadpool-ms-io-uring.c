@@ -0,0 +1,369 @@
+
+#if defined(HAVE_LINUX_IO_URING_H) && HAVE_DECL_IORING_POLL_ADD_MULTI
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+
+#if defined(HOST_WIN32)
+/* We assume that io_uring is not available on windows */
+#error
+#endif
+
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+
+#define HAVE_IO_URING 1
+
+#define IO_URING_ENTRIES 256
+
+/* The fd is in the low half of the user data and the generation of its registration in the high half */
+#define IO_URING_USER_DATA(fd,generation) (((guint64)(guint32)(generation) << 32) | (guint32)(fd))
+#define IO_URING_USER_DATA_FD(user_data) ((gint)(guint32)(user_data))
+#define IO_URING_USER_DATA_GENERATION(user_data) ((guint32)((user_data) >> 32))
+/* Completions of poll removals carry no generation, which is never the one of a registration */
+#define IO_URING_USER_DATA_REMOVE 0
+
+typedef struct {
+	guint32 generation;
+	gint events;
+} IoUringRegistration;
+
+typedef struct {
+	gint fd;
+
+	guint32 *sq_head;
+	guint32 *sq_tail;
+	guint32 sq_mask;
+	guint32 sq_entries;
+	guint32 *sq_array;
+	struct io_uring_sqe *sqes;
+	/* Number of queued sqes not yet handed to the kernel */
+	guint32 sq_pending;
+
+	guint32 *cq_head;
+	guint32 *cq_tail;
+	guint32 cq_mask;
+	struct io_uring_cqe *cqes;
+
+	gpointer sq_ring;
+	gsize sq_ring_size;
+	gpointer cq_ring;
+	gsize cq_ring_size;
+	gsize sqes_size;
+
+	/* Maps fds to their IoUringRegistration, only accessed by the selector thread */
+	GHashTable *registrations;
+	guint32 generation;
+} IoUringSelector;
+
+static gint
+io_uring_setup (guint32 entries, struct io_uring_params *params)
+{
+	return (gint) syscall (__NR_io_uring_setup, entries, params);
+}
+
+static gint
+io_uring_enter (gint fd, guint32 to_submit, guint32 min_complete, guint32 flags)
+{
+	return (gint) syscall (__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+/*
+ * io_uring_available:
+ *
+ *   Returns whenever the kernel supports io_uring, which can be disabled even
+ * when the headers are present.
+ */
+static gboolean
+io_uring_available (void)
+{
+	struct io_uring_params params;
+	gint fd;
+
+	memset (&params, 0, sizeof (params));
+	fd = io_uring_setup (1, &params);
+	if (fd == -1)
+		return FALSE;
+
+	close (fd);
+	return TRUE;
+}
+
+static void
+io_uring_flush (IoUringSelector *selector)
+{
+	while (selector->sq_pending > 0) {
+		gint submitted = io_uring_enter (selector->fd, selector->sq_pending, 0, 0);
+		if (submitted == -1) {
+			if (errno == EINTR || errno == EAGAIN || errno == EBUSY)
+				continue;
+			g_error ("io_uring_flush: io_uring_enter () failed, error (%d) %s", errno, g_strerror (errno));
+		}
+		selector->sq_pending -= submitted;
+	}
+}
+
+/*
+ * io_uring_get_sqe:
+ *
+ *   Returns a cleared submission queue entry. It is only handed to the kernel with
+ * the following io_uring_enter (), so all the registration changes made between two
+ * waits are submitted at once.
+ */
+static struct io_uring_sqe*
+io_uring_get_sqe (IoUringSelector *selector)
+{
+	struct io_uring_sqe *sqe;
+	guint32 tail, index;
+
+	tail = *selector->sq_tail;
+	if (tail - *(volatile guint32*) selector->sq_head == selector->sq_entries) {
+		io_uring_flush (selector);
+		g_assert (tail - *(volatile guint32*) selector->sq_head < selector->sq_entries);
+	}
+
+	index = tail & selector->sq_mask;
+	sqe = &selector->sqes [index];
+	memset (sqe, 0, sizeof (struct io_uring_sqe));
+	selector->sq_array [index] = index;
+
+	/* The kernel must see the sqe before the new tail */
+	mono_memory_write_barrier ();
+	*(volatile guint32*) selector->sq_tail = tail + 1;
+	selector->sq_pending ++;
+
+	return sqe;
+}
+
+static void
+io_uring_prep_poll_add (IoUringSelector *selector, gint fd, gint events, guint32 generation)
+{
+	struct io_uring_sqe *sqe;
+	guint32 poll_events = 0;
+
+	if ((events & EVENT_IN) != 0)
+		poll_events |= POLLIN;
+	if ((events & EVENT_OUT) != 0)
+		poll_events |= POLLOUT;
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+	poll_events = (poll_events << 16) | (poll_events >> 16);
+#endif
+
+	sqe = io_uring_get_sqe (selector);
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = poll_events;
+	/* The poll stays armed and posts a completion for each readiness change */
+	sqe->len = IORING_POLL_ADD_MULTI;
+	sqe->user_data = IO_URING_USER_DATA (fd, generation);
+}
+
+static void
+io_uring_prep_poll_remove (IoUringSelector *selector, gint fd, guint32 generation)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = io_uring_get_sqe (selector);
+	sqe->opcode = IORING_OP_POLL_REMOVE;
+	sqe->fd = -1;
+	sqe->addr = IO_URING_USER_DATA (fd, generation);
+	sqe->user_data = IO_URING_USER_DATA_REMOVE;
+}
+
+static void
+io_uring_arm (IoUringSelector *selector, gint fd, gint events)
+{
+	IoUringRegistration *registration;
+
+	registration = (IoUringRegistration *)g_hash_table_lookup (selector->registrations, GINT_TO_POINTER (fd));
+	if (!registration) {
+		registration = g_new0 (IoUringRegistration, 1);
+		g_hash_table_insert (selector->registrations, GINT_TO_POINTER (fd), registration);
+	} else if (registration->events) {
+		io_uring_prep_poll_remove (selector, fd, registration->generation);
+	}
+
+	/* A new generation makes the completions of the previous poll stale */
+	registration->generation = ++ selector->generation;
+	if (registration->generation == 0)
+		registration->generation = ++ selector->generation;
+	registration->events = events;
+
+	if (events)
+		io_uring_prep_poll_add (selector, fd, events, registration->generation);
+}
+
+static gpointer
+uring_init (gint wakeup_pipe_fd)
+{
+	IoUringSelector *selector;
+	struct io_uring_params params;
+	gint fd;
+
+	memset (&params, 0, sizeof (params));
+	fd = io_uring_setup (IO_URING_ENTRIES, &params);
+	if (fd == -1) {
+		g_error ("uring_init: io_uring_setup () failed, error (%d) %s", errno, g_strerror (errno));
+		return NULL;
+	}
+
+	selector = g_new0 (IoUringSelector, 1);
+	selector->fd = fd;
+
+	selector->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof (guint32);
+	selector->sq_ring = mmap (NULL, selector->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if (selector->sq_ring == MAP_FAILED)
+		g_error ("uring_init: mmap (IORING_OFF_SQ_RING) failed, error (%d) %s", errno, g_strerror (errno));
+
+	selector->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof (struct io_uring_cqe);
+	selector->cq_ring = mmap (NULL, selector->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	if (selector->cq_ring == MAP_FAILED)
+		g_error ("uring_init: mmap (IORING_OFF_CQ_RING) failed, error (%d) %s", errno, g_strerror (errno));
+
+	selector->sqes_size = params.sq_entries * sizeof (struct io_uring_sqe);
+	selector->sqes = (struct io_uring_sqe *)mmap (NULL, selector->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if (selector->sqes == MAP_FAILED)
+		g_error ("uring_init: mmap (IORING_OFF_SQES) failed, error (%d) %s", errno, g_strerror (errno));
+
+	selector->sq_head = (guint32 *)((gchar *)selector->sq_ring + params.sq_off.head);
+	selector->sq_tail = (guint32 *)((gchar *)selector->sq_ring + params.sq_off.tail);
+	selector->sq_mask = *(guint32 *)((gchar *)selector->sq_ring + params.sq_off.ring_mask);
+	selector->sq_entries = *(guint32 *)((gchar *)selector->sq_ring + params.sq_off.ring_entries);
+	selector->sq_array = (guint32 *)((gchar *)selector->sq_ring + params.sq_off.array);
+
+	selector->cq_head = (guint32 *)((gchar *)selector->cq_ring + params.cq_off.head);
+	selector->cq_tail = (guint32 *)((gchar *)selector->cq_ring + params.cq_off.tail);
+	selector->cq_mask = *(guint32 *)((gchar *)selector->cq_ring + params.cq_off.ring_mask);
+	selector->cqes = (struct io_uring_cqe *)((gchar *)selector->cq_ring + params.cq_off.cqes);
+
+	selector->registrations = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+
+	io_uring_arm (selector, wakeup_pipe_fd, EVENT_IN);
+
+	return selector;
+}
+
+static void
+uring_register_fd (gpointer data, gint fd, gint events, gboolean is_new)
+{
+	IoUringSelector *selector = (IoUringSelector *)data;
+
+	g_assert (!is_new || !g_hash_table_lookup (selector->registrations, GINT_TO_POINTER (fd)));
+
+	io_uring_arm (selector, fd, events);
+}
+
+static void
+uring_remove_fd (gpointer data, gint fd)
+{
+	IoUringSelector *selector = (IoUringSelector *)data;
+	IoUringRegistration *registration;
+
+	registration = (IoUringRegistration *)g_hash_table_lookup (selector->registrations, GINT_TO_POINTER (fd));
+	if (!registration)
+		g_error ("uring_remove_fd: fd %d is not registered", fd);
+
+	/* The poll holds a reference to the file, so it has to be removed before the fd is closed */
+	if (registration->events)
+		io_uring_prep_poll_remove (selector, fd, registration->generation);
+
+	g_hash_table_remove (selector->registrations, GINT_TO_POINTER (fd));
+}
+
+static gint
+uring_event_wait (gpointer data, void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data)
+{
+	IoUringSelector *selector = (IoUringSelector *)data;
+	guint32 head, tail;
+	gint res;
+
+	mono_gc_set_skip_thread (TRUE);
+
+	/* Submit all the queued registration changes and wait for a completion with a single call */
+	MONO_ENTER_GC_SAFE;
+	res = io_uring_enter (selector->fd, selector->sq_pending, 1, IORING_ENTER_GETEVENTS);
+	MONO_EXIT_GC_SAFE;
+
+	mono_gc_set_skip_thread (FALSE);
+
+	if (res == -1) {
+		switch (errno) {
+		case EINTR:
+			mono_thread_internal_check_for_interruption_critical (mono_thread_internal_current ());
+			res = 0;
+			break;
+		case EAGAIN:
+		case EBUSY:
+			/* The completion queue is full, reap it before submitting more */
+			res = 0;
+			break;
+		default:
+			g_error ("uring_event_wait: io_uring_enter () failed, error (%d) %s", errno, g_strerror (errno));
+			break;
+		}
+	}
+
+	if (res == -1)
+		return -1;
+
+	selector->sq_pending -= res;
+
+	head = *selector->cq_head;
+	tail = *(volatile guint32*) selector->cq_tail;
+	/* The cqes must be read after the tail */
+	mono_memory_read_barrier ();
+
+	for (; head != tail; ++head) {
+		struct io_uring_cqe *cqe = &selector->cqes [head & selector->cq_mask];
+		IoUringRegistration *registration;
+		guint64 cqe_user_data = cqe->user_data;
+		gint cqe_res = cqe->res;
+		guint32 cqe_flags = cqe->flags;
+		gint fd, events = 0;
+
+		if (cqe_user_data == IO_URING_USER_DATA_REMOVE)
+			continue;
+
+		fd = IO_URING_USER_DATA_FD (cqe_user_data);
+		registration = (IoUringRegistration *)g_hash_table_lookup (selector->registrations, GINT_TO_POINTER (fd));
+		if (!registration || registration->generation != IO_URING_USER_DATA_GENERATION (cqe_user_data))
+			continue;
+
+		if (cqe_res < 0) {
+			if (cqe_res == -ECANCELED)
+				continue;
+			/* Let the jobs run and observe the error, like epoll does for EPOLLERR */
+			events = EVENT_IN | EVENT_OUT;
+		} else {
+			if (cqe_res & (POLLIN | POLLERR | POLLHUP))
+				events |= EVENT_IN;
+			if (cqe_res & (POLLOUT | POLLERR | POLLHUP))
+				events |= EVENT_OUT;
+		}
+
+		/* Kernels without multishot poll, or a multishot poll which overflowed, end the poll */
+		if (!(cqe_flags & IORING_CQE_F_MORE) && cqe_res >= 0)
+			io_uring_arm (selector, fd, registration->events);
+
+		callback (fd, events, user_data);
+	}
+
+	/* Hand the cqes back to the kernel once they are consumed */
+	mono_memory_barrier ();
+	*(volatile guint32*) selector->cq_head = head;
+
+	return 0;
+}
+
+static ThreadPoolIOBackend backend_uring = {
+	.init = uring_init,
+	.register_fd = uring_register_fd,
+	.remove_fd = uring_remove_fd,
+	.event_wait = uring_event_wait,
+	.edge_triggered = TRUE,
+};
+
+#endif
+
+#endif
@@ -21,6 +21,10 @@
 #include <fcntl.h>
 #endif
 
+#if defined(HAVE_SYS_EVENTFD_H)
+#include <sys/eventfd.h>
+#endif
+
 #include <mono/metadata/gc-internals.h>
 #include <mono/metadata/mono-mlist.h>
 #include <mono/metadata/threadpool-ms.h>
@@ -30,11 +34,18 @@
 #include <mono/utils/mono-lazy-init.h>
 #include <mono/utils/mono-logger-internals.h>
 
+/* init () returns the state of one backend instance, which is passed to the other functions */
 typedef struct {
-	gboolean (*init) (gint wakeup_pipe_fd);
-	void     (*register_fd) (gint fd, gint events, gboolean is_new);
-	void     (*remove_fd) (gint fd);
-	gint     (*event_wait) (void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data);
+	gpointer (*init) (gint wakeup_pipe_fd);
+	void     (*register_fd) (gpointer data, gint fd, gint events, gboolean is_new);
+	void     (*remove_fd) (gpointer data, gint fd);
+	gint     (*event_wait) (gpointer data, void (*callback) (gint fd, gint events, gpointer user_data), gpointer user_data);
+	/*
+	 * Whenever registrations persist across events, so the fd doesn't need to be
+	 * registered again after an event. Registering it again for a new job still has
+	 * to report the events which are already pending.
+	 */
+	gboolean edge_triggered;
 } ThreadPoolIOBackend;
 
 /* Keep in sync with System.IOOperation in mcs/class/System/System/IOSelector.cs */
@@ -45,11 +56,15 @@ enum MonoIOOperation {
 };
 
 #include "threadpool-ms-io-epoll.c"
+#include "threadpool-ms-io-uring.c"
 #include "threadpool-ms-io-kqueue.c"
 #include "threadpool-ms-io-poll.c"
 
 #define UPDATES_CAPACITY 128
 
+/* Upper bound for MONO_THREADPOOL_IO_SELECTORS */
+#define SELECTORS_MAX 64
+
 /* Keep in sync with System.IOSelectorJob in mcs/class/System/System/IOSelector.cs */
 struct _MonoIOSelectorJob {
 	MonoObject object;
@@ -88,23 +103,36 @@ typedef struct {
 } ThreadPoolIOUpdate;
 
 typedef struct {
-	ThreadPoolIOBackend backend;
+	gpointer backend_data;
 
 	ThreadPoolIOUpdate updates [UPDATES_CAPACITY];
 	gint updates_size;
 	MonoCoopMutex updates_lock;
 	MonoCoopCond updates_cond;
 
+	/* Only accessed by the selector thread */
+	MonoGHashTable *states;
+
 #if !defined(HOST_WIN32)
 	gint wakeup_pipes [2];
+	/* Both wakeup_pipes are the same eventfd */
+	gboolean wakeup_eventfd;
 #else
 	SOCKET wakeup_pipes [2];
 #endif
+} ThreadPoolIOSelector;
+
+typedef struct {
+	ThreadPoolIOBackend backend;
+
+	/* Each selector has its own thread and handles the sockets whose fd maps to it, see selector_for_fd () */
+	ThreadPoolIOSelector *selectors;
+	gint selectors_count;
 } ThreadPoolIO;
 
 static mono_lazy_init_t io_status = MONO_LAZY_INIT_STATUS_NOT_INITIALIZED;
 
-static gboolean io_selector_running = FALSE;
+static gint32 io_selectors_running = 0;
 
 static ThreadPoolIO* threadpool_io;
 
@@ -138,15 +166,30 @@ get_operations_for_jobs (MonoMList *list)
 	return operations;
 }
 
+static inline ThreadPoolIOSelector*
+selector_for_fd (gint fd)
+{
+	return &threadpool_io->selectors [(guint) fd % threadpool_io->selectors_count];
+}
+
 static void
-selector_thread_wakeup (void)
+selector_thread_wakeup (ThreadPoolIOSelector *selector)
 {
 	gchar msg = 'c';
 	gint written;
 
+#if defined(HAVE_SYS_EVENTFD_H)
+	if (selector->wakeup_eventfd) {
+		/* Writes to an eventfd add to its counter, so several wakeups only cost one read in the selector */
+		if (eventfd_write (selector->wakeup_pipes [1], 1) == -1)
+			g_warning ("selector_thread_wakeup: eventfd_write () failed, error (%d) %s\n", errno, g_strerror (errno));
+		return;
+	}
+#endif
+
 	for (;;) {
 #if !defined(HOST_WIN32)
-		written = write (threadpool_io->wakeup_pipes [1], &msg, 1);
+		written = write (selector->wakeup_pipes [1], &msg, 1);
 		if (written == 1)
 			break;
 		if (written == -1) {
@@ -154,7 +197,7 @@ selector_thread_wakeup (void)
 			break;
 		}
 #else
-		written = send (threadpool_io->wakeup_pipes [1], &msg, 1, 0);
+		written = send (selector->wakeup_pipes [1], &msg, 1, 0);
 		if (written == 1)
 			break;
 		if (written == SOCKET_ERROR) {
@@ -166,14 +209,24 @@ selector_thread_wakeup (void)
 }
 
 static void
-selector_thread_wakeup_drain_pipes (void)
+selector_thread_wakeup_drain_pipes (ThreadPoolIOSelector *selector)
 {
 	gchar buffer [128];
 	gint received;
 
+#if defined(HAVE_SYS_EVENTFD_H)
+	if (selector->wakeup_eventfd) {
+		eventfd_t value;
+		/* This resets the counter, so there's nothing left to drain */
+		if (eventfd_read (selector->wakeup_pipes [0], &value) == -1 && errno != EINTR && errno != EAGAIN)
+			g_warning ("selector_thread_wakeup_drain_pipes: eventfd_read () failed, error (%d) %s\n", errno, g_strerror (errno));
+		return;
+	}
+#endif
+
 	for (;;) {
 #if !defined(HOST_WIN32)
-		received = read (threadpool_io->wakeup_pipes [0], buffer, sizeof (buffer));
+		received = read (selector->wakeup_pipes [0], buffer, sizeof (buffer));
 		if (received == 0)
 			break;
 		if (received == -1) {
@@ -182,7 +235,7 @@ selector_thread_wakeup_drain_pipes (void)
 			break;
 		}
 #else
-		received = recv (threadpool_io->wakeup_pipes [0], buffer, sizeof (buffer), 0);
+		received = recv (selector->wakeup_pipes [0], buffer, sizeof (buffer), 0);
 		if (received == 0)
 			break;
 		if (received == SOCKET_ERROR) {
@@ -246,23 +299,24 @@ static void
 wait_callback (gint fd, gint events, gpointer user_data)
 {
 	MonoError error;
+	ThreadPoolIOSelector *selector;
 
 	if (mono_runtime_is_shutting_down ())
 		return;
 
-	if (fd == threadpool_io->wakeup_pipes [0]) {
+	g_assert (user_data);
+	selector = (ThreadPoolIOSelector *)user_data;
+
+	if (fd == selector->wakeup_pipes [0]) {
 		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: wke");
-		selector_thread_wakeup_drain_pipes ();
+		selector_thread_wakeup_drain_pipes (selector);
 	} else {
-		MonoGHashTable *states;
+		MonoGHashTable *states = selector->states;
 		MonoMList *list = NULL;
 		gpointer k;
 		gboolean remove_fd = FALSE;
 		gint operations;
 
-		g_assert (user_data);
-		states = (MonoGHashTable *)user_data;
-
 		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: cal fd %3d, events = %2s | %2s | %3s",
 			fd, (events & EVENT_IN) ? "RD" : "..", (events & EVENT_OUT) ? "WR" : "..", (events & EVENT_ERR) ? "ERR" : "...");
 
@@ -291,43 +345,101 @@ wait_callback (gint fd, gint events, gpointer user_data)
 
 			operations = get_operations_for_jobs (list);
 
-			mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: res fd %3d, events = %2s | %2s | %3s",
-				fd, (operations & EVENT_IN) ? "RD" : "..", (operations & EVENT_OUT) ? "WR" : "..", (operations & EVENT_ERR) ? "ERR" : "...");
+			/*
+			 * Edge triggered registrations are still armed, but only one job is dispatched
+			 * per event, so they have to be registered again to get a new edge for the jobs
+			 * left waiting on an event which fired, in case the first job doesn't drain the fd.
+			 */
+			if (!threadpool_io->backend.edge_triggered || (operations & events & (EVENT_IN | EVENT_OUT))) {
+				mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: res fd %3d, events = %2s | %2s | %3s",
+					fd, (operations & EVENT_IN) ? "RD" : "..", (operations & EVENT_OUT) ? "WR" : "..", (operations & EVENT_ERR) ? "ERR" : "...");
 
-			threadpool_io->backend.register_fd (fd, operations, FALSE);
+				threadpool_io->backend.register_fd (selector->backend_data, fd, operations, FALSE);
+			}
 		} else {
 			mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: err fd %d", fd);
 
 			mono_g_hash_table_remove (states, GINT_TO_POINTER (fd));
 
-			threadpool_io->backend.remove_fd (fd);
+			threadpool_io->backend.remove_fd (selector->backend_data, fd);
+		}
+	}
+}
+
+typedef struct {
+	gint fd;
+	gboolean is_new;
+} ThreadPoolIODirtyFd;
+
+/*
+ * dirty_fds_add:
+ *
+ *   Record that the registration of FD has to be updated once the current batch of
+ * updates is applied, so several updates of the same fd only cost one backend call.
+ */
+static void
+dirty_fds_add (ThreadPoolIODirtyFd *dirty_fds, gint *dirty_fds_size, gint fd, gboolean is_new)
+{
+	gint i;
+
+	for (i = 0; i < *dirty_fds_size; ++i) {
+		if (dirty_fds [i].fd == fd)
+			return;
+	}
+
+	g_assert (*dirty_fds_size < UPDATES_CAPACITY);
+	dirty_fds [*dirty_fds_size].fd = fd;
+	dirty_fds [*dirty_fds_size].is_new = is_new;
+	(*dirty_fds_size) ++;
+}
+
+/*
+ * dirty_fds_remove:
+ *
+ *   Forget about FD, returning whenever it has been registered with the backend.
+ */
+static gboolean
+dirty_fds_remove (ThreadPoolIODirtyFd *dirty_fds, gint *dirty_fds_size, gint fd)
+{
+	gint i;
+
+	for (i = 0; i < *dirty_fds_size; ++i) {
+		if (dirty_fds [i].fd == fd) {
+			gboolean registered = !dirty_fds [i].is_new;
+			dirty_fds [i] = dirty_fds [-- (*dirty_fds_size)];
+			return registered;
 		}
 	}
+
+	return TRUE;
 }
 
 static void
 selector_thread (gpointer data)
 {
 	MonoError error;
+	ThreadPoolIOSelector *selector = (ThreadPoolIOSelector *)data;
 	MonoGHashTable *states;
-
-	io_selector_running = TRUE;
+	ThreadPoolIODirtyFd dirty_fds [UPDATES_CAPACITY];
+	gint dirty_fds_size;
 
 	if (mono_runtime_is_shutting_down ()) {
-		io_selector_running = FALSE;
+		InterlockedDecrement (&io_selectors_running);
 		return;
 	}
 
-	states = mono_g_hash_table_new_type (g_direct_hash, g_direct_equal, MONO_HASH_VALUE_GC, MONO_ROOT_SOURCE_THREAD_POOL, "i/o thread pool states table");
+	states = selector->states = mono_g_hash_table_new_type (g_direct_hash, g_direct_equal, MONO_HASH_VALUE_GC, MONO_ROOT_SOURCE_THREAD_POOL, "i/o thread pool states table");
 
 	for (;;) {
 		gint i, j;
 		gint res;
 
-		mono_coop_mutex_lock (&threadpool_io->updates_lock);
+		mono_coop_mutex_lock (&selector->updates_lock);
+
+		dirty_fds_size = 0;
 
-		for (i = 0; i < threadpool_io->updates_size; ++i) {
-			ThreadPoolIOUpdate *update = &threadpool_io->updates [i];
+		for (i = 0; i < selector->updates_size; ++i) {
+			ThreadPoolIOUpdate *update = &selector->updates [i];
 
 			switch (update->type) {
 			case UPDATE_EMPTY:
@@ -356,7 +468,7 @@ selector_thread (gpointer data)
 				mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: %3s fd %3d, operations = %2s | %2s | %3s",
 					exists ? "mod" : "add", fd, (operations & EVENT_IN) ? "RD" : "..", (operations & EVENT_OUT) ? "WR" : "..", (operations & EVENT_ERR) ? "ERR" : "...");
 
-				threadpool_io->backend.register_fd (fd, operations, !exists);
+				dirty_fds_add (dirty_fds, &dirty_fds_size, fd, !exists);
 
 				break;
 			}
@@ -371,8 +483,8 @@ selector_thread (gpointer data)
 				if (mono_g_hash_table_lookup_extended (states, GINT_TO_POINTER (fd), &k, (gpointer*) &list)) {
 					mono_g_hash_table_remove (states, GINT_TO_POINTER (fd));
 
-					for (j = i + 1; j < threadpool_io->updates_size; ++j) {
-						ThreadPoolIOUpdate *update = &threadpool_io->updates [j];
+					for (j = i + 1; j < selector->updates_size; ++j) {
+						ThreadPoolIOUpdate *update = &selector->updates [j];
 						if (update->type == UPDATE_ADD && update->data.add.fd == fd)
 							memset (update, 0, sizeof (ThreadPoolIOUpdate));
 					}
@@ -383,7 +495,8 @@ selector_thread (gpointer data)
 					}
 
 					mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: del fd %3d", fd);
-					threadpool_io->backend.remove_fd (fd);
+					if (dirty_fds_remove (dirty_fds, &dirty_fds_size, fd))
+						threadpool_io->backend.remove_fd (selector->backend_data, fd);
 				}
 
 				break;
@@ -397,8 +510,8 @@ selector_thread (gpointer data)
 				FilterSockaresForDomainData user_data = { .domain = domain, .states = states };
 				mono_g_hash_table_foreach (states, filter_jobs_for_domain, &user_data);
 
-				for (j = i + 1; j < threadpool_io->updates_size; ++j) {
-					ThreadPoolIOUpdate *update = &threadpool_io->updates [j];
+				for (j = i + 1; j < selector->updates_size; ++j) {
+					ThreadPoolIOUpdate *update = &selector->updates [j];
 					if (update->type == UPDATE_ADD && mono_object_domain (update->data.add.job) == domain)
 						memset (update, 0, sizeof (ThreadPoolIOUpdate));
 				}
@@ -410,56 +523,75 @@ selector_thread (gpointer data)
 			}
 		}
 
-		mono_coop_cond_broadcast (&threadpool_io->updates_cond);
+		for (i = 0; i < dirty_fds_size; ++i) {
+			gint fd = dirty_fds [i].fd;
+			gpointer k;
+			MonoMList *list = NULL;
 
-		if (threadpool_io->updates_size > 0) {
-			threadpool_io->updates_size = 0;
-			memset (&threadpool_io->updates, 0, UPDATES_CAPACITY * sizeof (ThreadPoolIOUpdate));
+			if (mono_g_hash_table_lookup_extended (states, GINT_TO_POINTER (fd), &k, (gpointer*) &list))
+				threadpool_io->backend.register_fd (selector->backend_data, fd, get_operations_for_jobs (list), dirty_fds [i].is_new);
 		}
 
-		mono_coop_mutex_unlock (&threadpool_io->updates_lock);
+		mono_coop_cond_broadcast (&selector->updates_cond);
+
+		if (selector->updates_size > 0) {
+			selector->updates_size = 0;
+			memset (&selector->updates, 0, UPDATES_CAPACITY * sizeof (ThreadPoolIOUpdate));
+		}
+
+		mono_coop_mutex_unlock (&selector->updates_lock);
 
 		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_IO_THREADPOOL, "io threadpool: wai");
 
-		res = threadpool_io->backend.event_wait (wait_callback, states);
+		res = threadpool_io->backend.event_wait (selector->backend_data, wait_callback, selector);
 
 		if (res == -1 || mono_runtime_is_shutting_down ())
 			break;
 	}
 
 	mono_g_hash_table_destroy (states);
+	selector->states = NULL;
 
-	io_selector_running = FALSE;
+	InterlockedDecrement (&io_selectors_running);
 }
 
-/* Locking: threadpool_io->updates_lock must be held */
+/* Locking: selector->updates_lock must be held */
 static ThreadPoolIOUpdate*
-update_get_new (void)
+update_get_new (ThreadPoolIOSelector *selector)
 {
 	ThreadPoolIOUpdate *update = NULL;
-	g_assert (threadpool_io->updates_size <= UPDATES_CAPACITY);
+	g_assert (selector->updates_size <= UPDATES_CAPACITY);
 
-	while (threadpool_io->updates_size == UPDATES_CAPACITY) {
+	while (selector->updates_size == UPDATES_CAPACITY) {
 		/* we wait for updates to be applied in the selector_thread and we loop
 		 * as long as none are available. if it happends too much, then we need
 		 * to increase UPDATES_CAPACITY */
-		mono_coop_cond_wait (&threadpool_io->updates_cond, &threadpool_io->updates_lock);
+		mono_coop_cond_wait (&selector->updates_cond, &selector->updates_lock);
 	}
 
-	g_assert (threadpool_io->updates_size < UPDATES_CAPACITY);
+	g_assert (selector->updates_size < UPDATES_CAPACITY);
 
-	update = &threadpool_io->updates [threadpool_io->updates_size ++];
+	update = &selector->updates [selector->updates_size ++];
 
 	return update;
 }
 
 static void
-wakeup_pipes_init (void)
+wakeup_pipes_init (ThreadPoolIOSelector *selector)
 {
 #if !defined(HOST_WIN32)
-	if (pipe (threadpool_io->wakeup_pipes) == -1)
+#if defined(HAVE_SYS_EVENTFD_H)
+	selector->wakeup_pipes [0] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (selector->wakeup_pipes [0] != -1) {
+		selector->wakeup_pipes [1] = selector->wakeup_pipes [0];
+		selector->wakeup_eventfd = TRUE;
+		return;
+	}
+	/* Fall back to a pipe on kernels without eventfd */
+#endif
+	if (pipe (selector->wakeup_pipes) == -1)
 		g_error ("wakeup_pipes_init: pipe () failed, error (%d) %s\n", errno, g_strerror (errno));
-	if (fcntl (threadpool_io->wakeup_pipes [0], F_SETFL, O_NONBLOCK) == -1)
+	if (fcntl (selector->wakeup_pipes [0], F_SETFL, O_NONBLOCK) == -1)
 		g_error ("wakeup_pipes_init: fcntl () failed, error (%d) %s\n", errno, g_strerror (errno));
 #else
 	struct sockaddr_in client;
@@ -470,8 +602,8 @@ wakeup_pipes_init (void)
 
 	server_sock = socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
 	g_assert (server_sock != INVALID_SOCKET);
-	threadpool_io->wakeup_pipes [1] = socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
-	g_assert (threadpool_io->wakeup_pipes [1] != INVALID_SOCKET);
+	selector->wakeup_pipes [1] = socket (AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	g_assert (selector->wakeup_pipes [1] != INVALID_SOCKET);
 
 	server.sin_family = AF_INET;
 	server.sin_addr.s_addr = inet_addr ("127.0.0.1");
@@ -490,18 +622,18 @@ wakeup_pipes_init (void)
 		closesocket (server_sock);
 		g_error ("wakeup_pipes_init: listen () failed, error (%d)\n", WSAGetLastError ());
 	}
-	if (connect ((SOCKET) threadpool_io->wakeup_pipes [1], (SOCKADDR*) &server, sizeof (server)) == SOCKET_ERROR) {
+	if (connect ((SOCKET) selector->wakeup_pipes [1], (SOCKADDR*) &server, sizeof (server)) == SOCKET_ERROR) {
 		closesocket (server_sock);
 		g_error ("wakeup_pipes_init: connect () failed, error (%d)\n", WSAGetLastError ());
 	}
 
 	size = sizeof (client);
-	threadpool_io->wakeup_pipes [0] = accept (server_sock, (SOCKADDR *) &client, &size);
-	g_assert (threadpool_io->wakeup_pipes [0] != INVALID_SOCKET);
+	selector->wakeup_pipes [0] = accept (server_sock, (SOCKADDR *) &client, &size);
+	g_assert (selector->wakeup_pipes [0] != INVALID_SOCKET);
 
 	arg = 1;
-	if (ioctlsocket (threadpool_io->wakeup_pipes [0], FIONBIO, &arg) == SOCKET_ERROR) {
-		closesocket (threadpool_io->wakeup_pipes [0]);
+	if (ioctlsocket (selector->wakeup_pipes [0], FIONBIO, &arg) == SOCKET_ERROR) {
+		closesocket (selector->wakeup_pipes [0]);
 		closesocket (server_sock);
 		g_error ("wakeup_pipes_init: ioctlsocket () failed, error (%d)\n", WSAGetLastError ());
 	}
@@ -513,16 +645,13 @@ wakeup_pipes_init (void)
 static void
 initialize (void)
 {
+	const gchar *selectors_env;
+	gint i;
+
 	g_assert (!threadpool_io);
 	threadpool_io = g_new0 (ThreadPoolIO, 1);
 	g_assert (threadpool_io);
 
-	mono_coop_mutex_init (&threadpool_io->updates_lock);
-	mono_coop_cond_init (&threadpool_io->updates_cond);
-	mono_gc_register_root ((char *)&threadpool_io->updates [0], sizeof (threadpool_io->updates), MONO_GC_DESCRIPTOR_NULL, MONO_ROOT_SOURCE_THREAD_POOL, "i/o thread pool updates list");
-
-	threadpool_io->updates_size = 0;
-
 	threadpool_io->backend = backend_poll;
 	if (g_getenv ("MONO_ENABLE_AIO") != NULL) {
 #if defined(HAVE_EPOLL)
@@ -531,26 +660,52 @@ initialize (void)
 		threadpool_io->backend = backend_kqueue;
 #endif
 	}
+#if defined(HAVE_IO_URING)
+	/* io_uring can be compiled in but disabled in the running kernel */
+	if (g_getenv ("MONO_ENABLE_IO_URING") != NULL && io_uring_available ())
+		threadpool_io->backend = backend_uring;
+#endif
 
-	wakeup_pipes_init ();
+	/* A single selector thread can't keep up with the readiness events of many busy sockets */
+	threadpool_io->selectors_count = 1;
+	if ((selectors_env = g_getenv ("MONO_THREADPOOL_IO_SELECTORS")) != NULL)
+		threadpool_io->selectors_count = CLAMP (atoi (selectors_env), 1, SELECTORS_MAX);
 
-	if (!threadpool_io->backend.init (threadpool_io->wakeup_pipes [0]))
-		g_error ("initialize: backend->init () failed");
+	threadpool_io->selectors = g_new0 (ThreadPoolIOSelector, threadpool_io->selectors_count);
+	io_selectors_running = threadpool_io->selectors_count;
 
-	MonoError error;
-	if (!mono_thread_create_internal (mono_get_root_domain (), selector_thread, NULL, TRUE, SMALL_STACK, &error))
-		g_error ("initialize: mono_thread_create_internal () failed due to %s", mono_error_get_message (&error));
+	for (i = 0; i < threadpool_io->selectors_count; ++i) {
+		ThreadPoolIOSelector *selector = &threadpool_io->selectors [i];
+		MonoError error;
+
+		mono_coop_mutex_init (&selector->updates_lock);
+		mono_coop_cond_init (&selector->updates_cond);
+		mono_gc_register_root ((char *)&selector->updates [0], sizeof (selector->updates), MONO_GC_DESCRIPTOR_NULL, MONO_ROOT_SOURCE_THREAD_POOL, "i/o thread pool updates list");
+
+		selector->updates_size = 0;
+
+		wakeup_pipes_init (selector);
+
+		if (!(selector->backend_data = threadpool_io->backend.init (selector->wakeup_pipes [0])))
+			g_error ("initialize: backend->init () failed");
+
+		if (!mono_thread_create_internal (mono_get_root_domain (), selector_thread, selector, TRUE, SMALL_STACK, &error))
+			g_error ("initialize: mono_thread_create_internal () failed due to %s", mono_error_get_message (&error));
+	}
 }
 
 static void
 cleanup (void)
 {
+	gint i;
+
 	/* we make the assumption along the code that we are
 	 * cleaning up only if the runtime is shutting down */
 	g_assert (mono_runtime_is_shutting_down ());
 
-	selector_thread_wakeup ();
-	while (io_selector_running)
+	for (i = 0; i < threadpool_io->selectors_count; ++i)
+		selector_thread_wakeup (&threadpool_io->selectors [i]);
+	while (io_selectors_running > 0)
 		mono_thread_info_usleep (1000);
 }
 
@@ -563,6 +718,7 @@ mono_threadpool_ms_io_cleanup (void)
 void
 ves_icall_System_IOSelector_Add (gpointer handle, MonoIOSelectorJob *job)
 {
+	ThreadPoolIOSelector *selector;
 	ThreadPoolIOUpdate *update;
 
 	g_assert (handle);
@@ -577,17 +733,21 @@ ves_icall_System_IOSelector_Add (gpointer handle, MonoIOSelectorJob *job)
 
 	mono_lazy_initialize (&io_status, initialize);
 
-	mono_coop_mutex_lock (&threadpool_io->updates_lock);
+	selector = selector_for_fd (GPOINTER_TO_INT (handle));
 
-	update = update_get_new ();
+	mono_coop_mutex_lock (&selector->updates_lock);
+
+	update = update_get_new (selector);
 	update->type = UPDATE_ADD;
 	update->data.add.fd = GPOINTER_TO_INT (handle);
 	update->data.add.job = job;
 	mono_memory_barrier (); /* Ensure this is safely published before we wake up the selector */
 
-	selector_thread_wakeup ();
+	/* The selector applies all the queued updates once woken up */
+	if (selector->updates_size == 1)
+		selector_thread_wakeup (selector);
 
-	mono_coop_mutex_unlock (&threadpool_io->updates_lock);
+	mono_coop_mutex_unlock (&selector->updates_lock);
 }
 
 void
@@ -599,45 +759,57 @@ ves_icall_System_IOSelector_Remove (gpointer handle)
 void
 mono_threadpool_ms_io_remove_socket (int fd)
 {
+	ThreadPoolIOSelector *selector;
 	ThreadPoolIOUpdate *update;
 
 	if (!mono_lazy_is_initialized (&io_status))
 		return;
 
-	mono_coop_mutex_lock (&threadpool_io->updates_lock);
+	selector = selector_for_fd (fd);
+
+	mono_coop_mutex_lock (&selector->updates_lock);
 
-	update = update_get_new ();
+	update = update_get_new (selector);
 	update->type = UPDATE_REMOVE_SOCKET;
 	update->data.add.fd = fd;
 	mono_memory_barrier (); /* Ensure this is safely published before we wake up the selector */
 
-	selector_thread_wakeup ();
+	/* The selector applies all the queued updates once woken up */
+	if (selector->updates_size == 1)
+		selector_thread_wakeup (selector);
 
-	mono_coop_cond_wait (&threadpool_io->updates_cond, &threadpool_io->updates_lock);
+	mono_coop_cond_wait (&selector->updates_cond, &selector->updates_lock);
 
-	mono_coop_mutex_unlock (&threadpool_io->updates_lock);
+	mono_coop_mutex_unlock (&selector->updates_lock);
 }
 
 void
 mono_threadpool_ms_io_remove_domain_jobs (MonoDomain *domain)
 {
-	ThreadPoolIOUpdate *update;
+	gint i;
 
 	if (!mono_lazy_is_initialized (&io_status))
 		return;
 
-	mono_coop_mutex_lock (&threadpool_io->updates_lock);
+	/* The jobs of the domain can be registered in any of the selectors */
+	for (i = 0; i < threadpool_io->selectors_count; ++i) {
+		ThreadPoolIOSelector *selector = &threadpool_io->selectors [i];
+		ThreadPoolIOUpdate *update;
 
-	update = update_get_new ();
-	update->type = UPDATE_REMOVE_DOMAIN;
-	update->data.remove_domain.domain = domain;
-	mono_memory_barrier (); /* Ensure this is safely published before we wake up the selector */
+		mono_coop_mutex_lock (&selector->updates_lock);
 
-	selector_thread_wakeup ();
+		update = update_get_new (selector);
+		update->type = UPDATE_REMOVE_DOMAIN;
+		update->data.remove_domain.domain = domain;
+		mono_memory_barrier (); /* Ensure this is safely published before we wake up the selector */
 
-	mono_coop_cond_wait (&threadpool_io->updates_cond, &threadpool_io->updates_lock);
+		if (selector->updates_size == 1)
+			selector_thread_wakeup (selector);
 
-	mono_coop_mutex_unlock (&threadpool_io->updates_lock);
+		mono_coop_cond_wait (&selector->updates_cond, &selector->updates_lock);
+
+		mono_coop_mutex_unlock (&selector->updates_lock);
+	}
 }
 
 #else
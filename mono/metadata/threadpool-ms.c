@@ -35,6 +35,8 @@
 #include <mono/metadata/threadpool-ms-io.h>
 #include <mono/utils/atomic.h>
 #include <mono/utils/mono-compiler.h>
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-coop-semaphore.h>
 #include <mono/utils/mono-complex.h>
 #include <mono/utils/mono-lazy-init.h>
 #include <mono/utils/mono-logger.h>
@@ -52,6 +54,13 @@
 
 #define WORKER_CREATION_MAX_PER_SEC 10
 
+/* Number of requests a worker claims in a row from its current domain before going
+ * through domains_lock again, so other domains still get their turn */
+#define WORKER_LOCAL_REQUESTS_MAX 32
+
+/* Number of iterations a worker without request spins for a new one before parking */
+#define WORKER_SPIN_ITERATIONS 2000
+
 /* The exponent to apply to the gain. 1.0 means to use linear gain,
  * higher values will enhance large moves and damp small ones.
  * default: 2.0 */
@@ -74,6 +83,11 @@
 #define HILL_CLIMBING_ERROR_SMOOTHING_FACTOR 0.01
 #define HILL_CLIMBING_MAX_SAMPLE_ERROR_PERCENT 0.15
 
+#define QUEUE_LATENCY_TARGET 20 // ms
+
+/* A worker blocked for longer than this while requests are outstanding gets replaced */
+#define BLOCKING_THRESHOLD 100 // ms
+
 typedef union {
 	struct {
 		gint16 max_working; /* determined by heuristic */
@@ -86,11 +100,19 @@ typedef union {
 
 typedef struct {
 	MonoDomain *domain;
+	/* Incremented and decremented atomically, a worker running in the domain claims
+	 * requests without domains_lock */
 	gint32 outstanding_request;
 } ThreadPoolDomain;
 
 typedef MonoInternalThread ThreadPoolWorkingThread;
 
+typedef struct {
+	MonoCoopSem sem;
+	/* Set when the thread is unparked, it is then not in threadpool->parked_threads anymore */
+	gboolean signaled;
+} ThreadPoolParkedThread;
+
 typedef struct {
 	gint32 wave_period;
 	gint32 samples_to_measure;
@@ -131,10 +153,14 @@ typedef struct {
 	MonoCoopMutex domains_lock;
 
 	GPtrArray *working_threads; // ThreadPoolWorkingThread* []
-	gint32 parked_threads_count;
-	MonoCoopCond parked_threads_cond;
+	GPtrArray *parked_threads; // ThreadPoolParkedThread* [], the last one parked is unparked first
 	MonoCoopMutex active_threads_lock; /* protect access to working_threads and parked_threads */
 
+	/* incremented by each request, so spinning workers notice new requests without domains_lock */
+	gint32 requests_generation;
+	gint32 spinning_workers;
+	gint32 spinning_workers_max;
+
 	guint32 worker_creation_current_second;
 	guint32 worker_creation_current_count;
 	MonoCoopMutex worker_creation_lock;
@@ -147,6 +173,16 @@ typedef struct {
 	ThreadPoolHillClimbing heuristic_hill_climbing;
 	MonoCoopMutex heuristic_lock;
 
+	gint64 heuristic_last_claim; // ms, last time a worker started serving a request
+	gint32 heuristic_queue_latency; // ms, how long the outstanding requests have been waiting
+	gint32 heuristic_queue_latency_target; // ms
+	gint32 heuristic_injected; // threads injected by the monitor thread
+	gint32 heuristic_retired; // threads given back by the queue latency heuristic
+	gint32 monitor_interval; // ms
+
+	gint32 blocking_threshold; // ms, 0 if blocked workers are not replaced
+	gint32 blocking_replaced; // threads injected to replace blocked workers
+
 	gint32 limit_worker_min;
 	gint32 limit_worker_max;
 	gint32 limit_io_min;
@@ -176,6 +212,17 @@ typedef enum {
 	TRANSITION_UNDEFINED,
 } ThreadPoolHeuristicStateTransition;
 
+typedef struct {
+	const gchar *name;
+	/* Returns the new maximum number of working threads after a sample of SAMPLE_DURATION ms
+	 * with COMPLETIONS work items, and sets the length of the next sample */
+	gint16   (*update) (gint16 current_thread_count, guint32 sample_duration, gint32 completions, gint64 *adjustment_interval);
+	/* Notifies the heuristic that the monitor thread changed the maximum number of working threads, optional */
+	void     (*force_change) (gint16 new_thread_count, ThreadPoolHeuristicStateTransition transition);
+	/* Returns whenever the monitor thread should inject a thread for the outstanding requests */
+	gboolean (*should_inject) (void);
+} ThreadPoolHeuristic;
+
 static mono_lazy_init_t status = MONO_LAZY_INIT_STATUS_NOT_INITIALIZED;
 
 enum {
@@ -188,6 +235,13 @@ static gint32 monitor_status = MONITOR_STATUS_NOT_RUNNING;
 
 static ThreadPool* threadpool;
 
+static const ThreadPoolHeuristic *heuristic;
+
+static void heuristic_init (void);
+
+/* The ThreadPoolDomain the current worker is running a callback in, it can't be freed meanwhile */
+static MonoNativeTlsKey worker_tpdomain_key;
+
 #define COUNTER_CHECK(counter) \
 	do { \
 		g_assert (counter._.max_working > 0); \
@@ -261,12 +315,15 @@ initialize (void)
 
 	threadpool->domains = g_ptr_array_new ();
 	mono_coop_mutex_init (&threadpool->domains_lock);
+	mono_native_tls_alloc (&worker_tpdomain_key, NULL);
 
-	threadpool->parked_threads_count = 0;
-	mono_coop_cond_init (&threadpool->parked_threads_cond);
+	threadpool->parked_threads = g_ptr_array_new ();
 	threadpool->working_threads = g_ptr_array_new ();
 	mono_coop_mutex_init (&threadpool->active_threads_lock);
 
+	/* Spinning only helps if a request can be made while the worker spins */
+	threadpool->spinning_workers_max = mono_cpu_count () / 2;
+
 	threadpool->worker_creation_current_second = -1;
 	mono_coop_mutex_init (&threadpool->worker_creation_lock);
 
@@ -322,9 +379,12 @@ initialize (void)
 	threadpool->cpu_usage_state = g_new0 (MonoCpuUsageState, 1);
 
 	threadpool->suspended = FALSE;
+
+	heuristic_init ();
 }
 
 static void worker_kill (ThreadPoolWorkingThread *thread);
+static void worker_unpark_all (void);
 
 static void
 cleanup (void)
@@ -345,7 +405,7 @@ cleanup (void)
 		worker_kill ((ThreadPoolWorkingThread*) g_ptr_array_index (threadpool->working_threads, i));
 
 	/* unpark all threadpool->parked_threads */
-	mono_coop_cond_broadcast (&threadpool->parked_threads_cond);
+	worker_unpark_all ();
 
 	mono_coop_mutex_unlock (&threadpool->active_threads_lock);
 }
@@ -507,14 +567,54 @@ domain_get_next (ThreadPoolDomain *current)
 	return tpdomain;
 }
 
+/*
+ * domain_try_claim_request:
+ *
+ *   Atomically consume one of the outstanding requests of TPDOMAIN, returning FALSE
+ * if there are none left. The caller either holds domains_lock or is a worker
+ * running in TPDOMAIN, so TPDOMAIN can't be freed.
+ */
+static gboolean
+domain_try_claim_request (ThreadPoolDomain *tpdomain)
+{
+	gint32 outstanding_request;
+
+	do {
+		outstanding_request = InterlockedRead (&tpdomain->outstanding_request);
+		g_assert (outstanding_request >= 0);
+		if (outstanding_request == 0)
+			return FALSE;
+	} while (InterlockedCompareExchange (&tpdomain->outstanding_request, outstanding_request - 1, outstanding_request) != outstanding_request);
+
+	return TRUE;
+}
+
+/* LOCKING: threadpool->active_threads_lock must be held */
 static void
-worker_wait_interrupt (gpointer data)
+worker_unpark (ThreadPoolParkedThread *parked)
+{
+	g_assert (!parked->signaled);
+	parked->signaled = TRUE;
+	mono_coop_sem_post (&parked->sem);
+}
+
+static void
+worker_unpark_all (void)
 {
 	mono_coop_mutex_lock (&threadpool->active_threads_lock);
-	mono_coop_cond_signal (&threadpool->parked_threads_cond);
+	while (threadpool->parked_threads->len > 0)
+		worker_unpark ((ThreadPoolParkedThread*) g_ptr_array_remove_index (threadpool->parked_threads, threadpool->parked_threads->len - 1));
 	mono_coop_mutex_unlock (&threadpool->active_threads_lock);
 }
 
+static void
+worker_wait_interrupt (gpointer data)
+{
+	/* The interrupt might be delivered once the worker stopped parking, so it can't refer to
+	 * its ThreadPoolParkedThread. The other workers go back to parking after finding no request. */
+	worker_unpark_all ();
+}
+
 /* return TRUE if timeout, FALSE otherwise (worker unpark or interrupt) */
 static gboolean
 worker_park (void)
@@ -530,6 +630,8 @@ worker_park (void)
 	if (!mono_runtime_is_shutting_down ()) {
 		static gpointer rand_handle = NULL;
 		MonoInternalThread *thread_internal;
+		ThreadPoolParkedThread parked;
+		MonoSemTimedwaitRet res = MONO_SEM_TIMEDWAIT_RET_SUCCESS;
 		gboolean interrupted = FALSE;
 
 		if (!rand_handle)
@@ -539,21 +641,33 @@ worker_park (void)
 		thread_internal = mono_thread_internal_current ();
 		g_assert (thread_internal);
 
-		threadpool->parked_threads_count += 1;
+		/* Each parked worker waits on its own semaphore, so an unpark wakes exactly one thread */
+		mono_coop_sem_init (&parked.sem, 0);
+		parked.signaled = FALSE;
+
+		g_ptr_array_add (threadpool->parked_threads, &parked);
 		g_ptr_array_remove_fast (threadpool->working_threads, thread_internal);
 
 		mono_thread_info_install_interrupt (worker_wait_interrupt, NULL, &interrupted);
 		if (interrupted)
 			goto done;
 
-		if (mono_coop_cond_timedwait (&threadpool->parked_threads_cond, &threadpool->active_threads_lock, rand_next (&rand_handle, 5 * 1000, 60 * 1000)) != 0)
-			timeout = TRUE;
+		mono_coop_mutex_unlock (&threadpool->active_threads_lock);
+		res = mono_coop_sem_timedwait (&parked.sem, rand_next (&rand_handle, 5 * 1000, 60 * 1000), MONO_SEM_FLAGS_NONE);
+		mono_coop_mutex_lock (&threadpool->active_threads_lock);
 
 		mono_thread_info_uninstall_interrupt (&interrupted);
 
 done:
+		/* A worker unparked while timing out still has a request to serve */
+		if (!parked.signaled) {
+			g_ptr_array_remove (threadpool->parked_threads, &parked);
+			if (res == MONO_SEM_TIMEDWAIT_RET_TIMEDOUT)
+				timeout = TRUE;
+		}
+		mono_coop_sem_destroy (&parked.sem);
+
 		g_ptr_array_add (threadpool->working_threads, thread_internal);
-		threadpool->parked_threads_count -= 1;
 	}
 
 	mono_coop_mutex_unlock (&threadpool->active_threads_lock);
@@ -568,13 +682,23 @@ done:
 static gboolean
 worker_try_unpark (void)
 {
+	ThreadPoolCounter counter;
 	gboolean res = FALSE;
 
 	mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] try unpark worker", mono_native_thread_id_get ());
 
+	/* A worker increments the counter before looking for requests one last time and parking,
+	 * so there's no need to take active_threads_lock when it's 0 */
+	counter.as_gint64 = COUNTER_READ ();
+	if (counter._.parked == 0) {
+		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] try unpark worker, success? no", mono_native_thread_id_get ());
+		return FALSE;
+	}
+
 	mono_coop_mutex_lock (&threadpool->active_threads_lock);
-	if (threadpool->parked_threads_count > 0) {
-		mono_coop_cond_signal (&threadpool->parked_threads_cond);
+	if (threadpool->parked_threads->len > 0) {
+		/* The last parked worker is the most likely to still have a warm cache */
+		worker_unpark ((ThreadPoolParkedThread*) g_ptr_array_remove_index (threadpool->parked_threads, threadpool->parked_threads->len - 1));
 		res = TRUE;
 	}
 	mono_coop_mutex_unlock (&threadpool->active_threads_lock);
@@ -593,6 +717,131 @@ worker_kill (ThreadPoolWorkingThread *thread)
 	mono_thread_internal_stop ((MonoInternalThread*) thread);
 }
 
+/*
+ * worker_spin:
+ *
+ *   Spin for a short while waiting for a new request instead of parking right away,
+ * which is expensive for both the parking worker and the thread waking it up later.
+ * Returns whenever a request was made meanwhile.
+ *
+ * LOCKING: threadpool->domains_lock must be held, it is released while spinning
+ */
+static gboolean
+worker_spin (void)
+{
+	gint32 generation;
+	gboolean found = FALSE;
+	gint i;
+
+	if (InterlockedIncrement (&threadpool->spinning_workers) > threadpool->spinning_workers_max) {
+		InterlockedDecrement (&threadpool->spinning_workers);
+		return FALSE;
+	}
+
+	/* A request made before reading the generation is visible in its domain */
+	generation = InterlockedRead (&threadpool->requests_generation);
+	if (domain_any_has_request ()) {
+		InterlockedDecrement (&threadpool->spinning_workers);
+		return TRUE;
+	}
+
+	mono_coop_mutex_unlock (&threadpool->domains_lock);
+
+	for (i = 0; i < WORKER_SPIN_ITERATIONS && !mono_runtime_is_shutting_down (); ++i) {
+		if (InterlockedRead (&threadpool->requests_generation) != generation) {
+			found = TRUE;
+			break;
+		}
+		mono_cpu_relax ();
+	}
+
+	InterlockedDecrement (&threadpool->spinning_workers);
+
+	/* worker_request () skips waking up a worker if it sees this one spinning, so check one
+	 * last time after leaving, the interlocked operations order both sides */
+	if (!found && InterlockedRead (&threadpool->requests_generation) != generation)
+		found = TRUE;
+
+	mono_coop_mutex_lock (&threadpool->domains_lock);
+
+	return found;
+}
+
+/*
+ * worker_run:
+ *
+ *   Run the managed callback of a request of TPDOMAIN, which dequeues and executes
+ * the queued work items. Set RETIRE if the managed side asks the worker to stop.
+ */
+static void
+worker_run (MonoInternalThread *thread, ThreadPoolDomain *tpdomain, gboolean *retire)
+{
+	MonoError error;
+	MonoThreadInfo *info = (MonoThreadInfo *)thread->thread_info;
+
+	mono_native_tls_set_value (worker_tpdomain_key, tpdomain);
+
+	/* Only blocking in work items counts, not parking */
+	if (threadpool->blocking_threshold > 0)
+		info->track_blocking = TRUE;
+
+	mono_thread_push_appdomain_ref (tpdomain->domain);
+	if (mono_domain_set (tpdomain->domain, FALSE)) {
+		MonoObject *exc = NULL, *res;
+
+		res = mono_runtime_try_invoke (mono_defaults.threadpool_perform_wait_callback_method, NULL, NULL, &exc, &error);
+		if (exc || !mono_error_ok(&error)) {
+			if (exc == NULL)
+				exc = (MonoObject *) mono_error_convert_to_exception (&error);
+			else
+				mono_error_cleanup (&error);
+			mono_thread_internal_unhandled_exception (exc);
+		} else if (res && *(MonoBoolean*) mono_object_unbox (res) == FALSE)
+			*retire = TRUE;
+
+		mono_thread_clr_state (thread, (MonoThreadState)~ThreadState_Background);
+		if (!mono_thread_test_state (thread , ThreadState_Background))
+			ves_icall_System_Threading_Thread_SetState (thread, ThreadState_Background);
+
+		mono_domain_set (mono_get_root_domain (), TRUE);
+	}
+	mono_thread_pop_appdomain_ref ();
+
+	info->track_blocking = FALSE;
+	info->blocking_since = 0;
+
+	mono_native_tls_set_value (worker_tpdomain_key, NULL);
+}
+
+/*
+ * worker_try_claim_local_request:
+ *
+ *   Claim the next request of TPDOMAIN, the domain the worker just ran a callback in,
+ * without going through domains_lock. Requests queued from a worker are the common
+ * case for fine grained tasks, and are served by the same worker.
+ */
+static gboolean
+worker_try_claim_local_request (MonoInternalThread *thread, ThreadPoolDomain *tpdomain, gboolean retire, gint *local_requests)
+{
+	if (retire || *local_requests >= WORKER_LOCAL_REQUESTS_MAX)
+		return FALSE;
+	if (mono_runtime_is_shutting_down () || mono_domain_is_unloading (tpdomain->domain))
+		return FALSE;
+	/* The interruption checkpoint is done with domains_lock released, in the main loop */
+	if ((thread->state & (ThreadState_StopRequested | ThreadState_SuspendRequested)) != 0)
+		return FALSE;
+	if (!domain_try_claim_request (tpdomain))
+		return FALSE;
+
+	*local_requests += 1;
+	threadpool->heuristic_last_claim = mono_msec_ticks ();
+
+	mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] worker running in domain %p, local request",
+		mono_native_thread_id_get (), tpdomain->domain);
+
+	return TRUE;
+}
+
 static void
 worker_thread (gpointer data)
 {
@@ -601,6 +850,7 @@ worker_thread (gpointer data)
 	ThreadPoolDomain *tpdomain, *previous_tpdomain;
 	ThreadPoolCounter counter;
 	gboolean retire = FALSE;
+	gint local_requests;
 
 	mono_trace (G_LOG_LEVEL_INFO, MONO_TRACE_THREADPOOL, "[%p] worker starting", mono_native_thread_id_get ());
 
@@ -632,6 +882,11 @@ worker_thread (gpointer data)
 		if (retire || !(tpdomain = domain_get_next (previous_tpdomain))) {
 			gboolean timeout;
 
+			if (!retire && worker_spin ()) {
+				previous_tpdomain = NULL;
+				continue;
+			}
+
 			COUNTER_ATOMIC (counter, {
 				counter._.working --;
 				counter._.parked ++;
@@ -658,11 +913,16 @@ worker_thread (gpointer data)
 			continue;
 		}
 
-		tpdomain->outstanding_request --;
-		g_assert (tpdomain->outstanding_request >= 0);
+		/* Another worker might have claimed the request without domains_lock */
+		if (!domain_try_claim_request (tpdomain)) {
+			previous_tpdomain = tpdomain;
+			continue;
+		}
+
+		threadpool->heuristic_last_claim = mono_msec_ticks ();
 
 		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] worker running in domain %p",
-			mono_native_thread_id_get (), tpdomain->domain, tpdomain->outstanding_request);
+			mono_native_thread_id_get (), tpdomain->domain);
 
 		g_assert (tpdomain->domain);
 		g_assert (tpdomain->domain->threadpool_jobs >= 0);
@@ -670,27 +930,11 @@ worker_thread (gpointer data)
 
 		mono_coop_mutex_unlock (&threadpool->domains_lock);
 
-		mono_thread_push_appdomain_ref (tpdomain->domain);
-		if (mono_domain_set (tpdomain->domain, FALSE)) {
-			MonoObject *exc = NULL, *res;
-
-			res = mono_runtime_try_invoke (mono_defaults.threadpool_perform_wait_callback_method, NULL, NULL, &exc, &error);
-			if (exc || !mono_error_ok(&error)) {
-				if (exc == NULL)
-					exc = (MonoObject *) mono_error_convert_to_exception (&error);
-				else
-					mono_error_cleanup (&error);
-				mono_thread_internal_unhandled_exception (exc);
-			} else if (res && *(MonoBoolean*) mono_object_unbox (res) == FALSE)
-				retire = TRUE;
-
-			mono_thread_clr_state (thread, (MonoThreadState)~ThreadState_Background);
-			if (!mono_thread_test_state (thread , ThreadState_Background))
-				ves_icall_System_Threading_Thread_SetState (thread, ThreadState_Background);
-
-			mono_domain_set (mono_get_root_domain (), TRUE);
-		}
-		mono_thread_pop_appdomain_ref ();
+		/* threadpool_jobs stays the same for the requests claimed from the same domain */
+		local_requests = 0;
+		do {
+			worker_run (thread, tpdomain, &retire);
+		} while (worker_try_claim_local_request (thread, tpdomain, retire, &local_requests));
 
 		mono_coop_mutex_lock (&threadpool->domains_lock);
 
@@ -810,28 +1054,48 @@ worker_request (MonoDomain *domain)
 	if (mono_runtime_is_shutting_down ())
 		return FALSE;
 
-	mono_coop_mutex_lock (&threadpool->domains_lock);
+	/*
+	 * A worker running in DOMAIN keeps its ThreadPoolDomain alive, and if the domain starts
+	 * unloading meanwhile the worker drops the domain along with its requests once done.
+	 */
+	tpdomain = (ThreadPoolDomain *)mono_native_tls_get_value (worker_tpdomain_key);
+	if (tpdomain && tpdomain->domain == domain && !mono_domain_is_unloading (domain)) {
+		InterlockedIncrement (&tpdomain->outstanding_request);
+
+		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] request worker from worker, domain = %p, outstanding_request = %d",
+			mono_native_thread_id_get (), tpdomain->domain, tpdomain->outstanding_request);
+	} else {
+		mono_coop_mutex_lock (&threadpool->domains_lock);
 
-	/* synchronize check with worker_thread */
-	if (mono_domain_is_unloading (domain)) {
-		mono_coop_mutex_unlock (&threadpool->domains_lock);
-		return FALSE;
-	}
+		/* synchronize check with worker_thread */
+		if (mono_domain_is_unloading (domain)) {
+			mono_coop_mutex_unlock (&threadpool->domains_lock);
+			return FALSE;
+		}
 
-	tpdomain = domain_get (domain, TRUE);
-	g_assert (tpdomain);
-	tpdomain->outstanding_request ++;
+		tpdomain = domain_get (domain, TRUE);
+		g_assert (tpdomain);
+		InterlockedIncrement (&tpdomain->outstanding_request);
 
-	mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] request worker, domain = %p, outstanding_request = %d",
-		mono_native_thread_id_get (), tpdomain->domain, tpdomain->outstanding_request);
+		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] request worker, domain = %p, outstanding_request = %d",
+			mono_native_thread_id_get (), tpdomain->domain, tpdomain->outstanding_request);
 
-	mono_coop_mutex_unlock (&threadpool->domains_lock);
+		mono_coop_mutex_unlock (&threadpool->domains_lock);
+	}
+
+	InterlockedIncrement (&threadpool->requests_generation);
 
 	if (threadpool->suspended)
 		return FALSE;
 
 	monitor_ensure_running ();
 
+	/* The spinning worker picks up the request */
+	if (InterlockedRead (&threadpool->spinning_workers) > 0) {
+		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] request worker, spinning worker", mono_native_thread_id_get ());
+		return TRUE;
+	}
+
 	if (worker_try_unpark ()) {
 		mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] request worker, unparked", mono_native_thread_id_get ());
 		return TRUE;
@@ -904,6 +1168,45 @@ monitor_sufficient_delay_since_last_dequeue (void)
 	return mono_msec_ticks () >= threadpool->heuristic_last_dequeue + threshold;
 }
 
+/*
+ * monitor_has_blocked_worker:
+ *
+ *   Returns whenever a worker has been in a GC safe region, i.e. blocked in a wait
+ * or in a syscall, for longer than the blocking threshold. The regions are tracked
+ * by mono_threads_enter_gc_safe_region () for the workers running work items.
+ */
+static gboolean
+monitor_has_blocked_worker (void)
+{
+	gboolean res = FALSE;
+	gint64 now;
+	guint i;
+
+	if (threadpool->blocking_threshold == 0)
+		return FALSE;
+
+	now = mono_msec_ticks ();
+
+	mono_coop_mutex_lock (&threadpool->active_threads_lock);
+	for (i = 0; i < threadpool->working_threads->len; ++i) {
+		ThreadPoolWorkingThread *thread = (ThreadPoolWorkingThread *)g_ptr_array_index (threadpool->working_threads, i);
+		MonoThreadInfo *info = (MonoThreadInfo *)thread->thread_info;
+		gint64 blocking_since;
+
+		if (!info)
+			continue;
+
+		blocking_since = info->blocking_since;
+		if (blocking_since != 0 && now - blocking_since >= threadpool->blocking_threshold) {
+			res = TRUE;
+			break;
+		}
+	}
+	mono_coop_mutex_unlock (&threadpool->active_threads_lock);
+
+	return res;
+}
+
 static void hill_climbing_force_change (gint16 new_thread_count, ThreadPoolHeuristicStateTransition transition);
 
 static void
@@ -918,8 +1221,8 @@ monitor_thread (void)
 
 	do {
 		ThreadPoolCounter counter;
-		gboolean limit_worker_max_reached;
-		gint32 interval_left = MONITOR_INTERVAL;
+		gboolean limit_worker_max_reached, blocked;
+		gint32 interval_left = threadpool->monitor_interval;
 		gint32 awake = 0; /* number of spurious awakes we tolerate before doing a round of rebalancing */
 
 		g_assert (monitor_status != MONITOR_STATUS_NOT_RUNNING);
@@ -955,13 +1258,20 @@ monitor_thread (void)
 		mono_coop_mutex_lock (&threadpool->domains_lock);
 		if (!domain_any_has_request ()) {
 			mono_coop_mutex_unlock (&threadpool->domains_lock);
+			threadpool->heuristic_queue_latency = 0;
 			continue;
 		}
 		mono_coop_mutex_unlock (&threadpool->domains_lock);
 
+		/* Nothing made progress on the queued work since the last dequeue or request served */
+		threadpool->heuristic_queue_latency = (gint32) (mono_msec_ticks () - MAX (threadpool->heuristic_last_dequeue, threadpool->heuristic_last_claim));
+
 		threadpool->cpu_usage = mono_cpu_usage (threadpool->cpu_usage_state);
 
-		if (!monitor_sufficient_delay_since_last_dequeue ())
+		/* A blocked worker doesn't make the requests wait long enough for the heuristic yet,
+		 * if the other workers keep dequeuing, but it will be blocked for long */
+		blocked = monitor_has_blocked_worker ();
+		if (!blocked && !heuristic->should_inject ())
 			continue;
 
 		limit_worker_max_reached = FALSE;
@@ -977,7 +1287,14 @@ monitor_thread (void)
 		if (limit_worker_max_reached)
 			continue;
 
-		hill_climbing_force_change (counter._.max_working, TRANSITION_STARVATION);
+		InterlockedIncrement (&threadpool->heuristic_injected);
+		if (blocked) {
+			mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_THREADPOOL, "[%p] monitor thread, replacing blocked worker", mono_native_thread_id_get ());
+			InterlockedIncrement (&threadpool->blocking_replaced);
+		}
+
+		if (heuristic->force_change)
+			heuristic->force_change (counter._.max_working, TRANSITION_STARVATION);
 
 		for (i = 0; i < 5; ++i) {
 			if (mono_runtime_is_shutting_down ())
@@ -1295,6 +1612,115 @@ hill_climbing_update (gint16 current_thread_count, guint32 sample_duration, gint
 	return new_thread_count;
 }
 
+/*
+ * queue_latency_update:
+ *
+ *   The queue latency heuristic injects threads from the monitor thread as soon as
+ * the outstanding requests wait for longer than the latency target, which suits
+ * workloads blocking their workers. It gives threads back as soon as workers are
+ * parked, as there is then more concurrency than work.
+ */
+static gint16
+queue_latency_update (gint16 current_thread_count, guint32 sample_duration, gint32 completions, gint64 *adjustment_interval)
+{
+	ThreadPoolCounter counter;
+
+	*adjustment_interval = threadpool->heuristic_queue_latency_target;
+
+	counter.as_gint64 = COUNTER_READ ();
+	if (counter._.parked > 0 && current_thread_count > threadpool->limit_worker_min) {
+		mono_trace (G_LOG_LEVEL_INFO, MONO_TRACE_THREADPOOL, "[%p] queue latency, retire thread, max number of threads %d", mono_native_thread_id_get (), current_thread_count - 1);
+		InterlockedIncrement (&threadpool->heuristic_retired);
+		return current_thread_count - 1;
+	}
+
+	return current_thread_count;
+}
+
+static gboolean
+queue_latency_should_inject (void)
+{
+	return threadpool->heuristic_queue_latency >= threadpool->heuristic_queue_latency_target;
+}
+
+static const ThreadPoolHeuristic heuristic_hill_climbing = {
+	.name = "hill-climbing",
+	.update = hill_climbing_update,
+	.force_change = hill_climbing_force_change,
+	.should_inject = monitor_sufficient_delay_since_last_dequeue,
+};
+
+static const ThreadPoolHeuristic heuristic_queue_latency = {
+	.name = "queue-latency",
+	.update = queue_latency_update,
+	.should_inject = queue_latency_should_inject,
+};
+
+static gint
+heuristic_get_max_working (void)
+{
+	ThreadPoolCounter counter;
+	counter.as_gint64 = COUNTER_READ ();
+	return counter._.max_working;
+}
+
+static gint
+heuristic_get_working (void)
+{
+	ThreadPoolCounter counter;
+	counter.as_gint64 = COUNTER_READ ();
+	return counter._.working;
+}
+
+/*
+ * heuristic_init:
+ *
+ *   Select the heuristic controlling the number of working threads with the
+ * MONO_THREADPOOL_HEURISTIC environment variable, and register its counters.
+ */
+static void
+heuristic_init (void)
+{
+	const gchar *heuristic_env, *latency_target_env, *blocking_threshold_env;
+
+	g_assert (threadpool);
+
+	heuristic = &heuristic_hill_climbing;
+	threadpool->monitor_interval = MONITOR_INTERVAL;
+
+	if ((heuristic_env = g_getenv ("MONO_THREADPOOL_HEURISTIC"))) {
+		if (strcmp (heuristic_env, heuristic_queue_latency.name) == 0)
+			heuristic = &heuristic_queue_latency;
+		else if (strcmp (heuristic_env, heuristic_hill_climbing.name) != 0)
+			g_warning ("Unknown threadpool heuristic '%s', using '%s'", heuristic_env, heuristic->name);
+	}
+
+	threadpool->heuristic_queue_latency_target = QUEUE_LATENCY_TARGET;
+	if ((latency_target_env = g_getenv ("MONO_THREADPOOL_LATENCY_TARGET")))
+		threadpool->heuristic_queue_latency_target = CLAMP (atoi (latency_target_env), 1, MONITOR_INTERVAL);
+
+	if (heuristic == &heuristic_queue_latency) {
+		/* Check often enough to notice requests waiting for longer than the target */
+		threadpool->monitor_interval = MAX (threadpool->heuristic_queue_latency_target / 2, 1);
+		threadpool->heuristic_adjustment_interval = threadpool->heuristic_queue_latency_target;
+	}
+
+	threadpool->blocking_threshold = BLOCKING_THRESHOLD;
+	if ((blocking_threshold_env = g_getenv ("MONO_THREADPOOL_BLOCKING_THRESHOLD")))
+		threadpool->blocking_threshold = MAX (atoi (blocking_threshold_env), 0);
+
+	/* Notice blocked workers soon after they cross the threshold */
+	if (threadpool->blocking_threshold > 0)
+		threadpool->monitor_interval = MAX (MIN (threadpool->monitor_interval, threadpool->blocking_threshold / 2), 1);
+
+	mono_counters_register ("Threadpool max working threads", MONO_COUNTER_RUNTIME | MONO_COUNTER_INT | MONO_COUNTER_COUNT | MONO_COUNTER_VARIABLE | MONO_COUNTER_CALLBACK, heuristic_get_max_working);
+	mono_counters_register ("Threadpool working threads", MONO_COUNTER_RUNTIME | MONO_COUNTER_INT | MONO_COUNTER_COUNT | MONO_COUNTER_VARIABLE | MONO_COUNTER_CALLBACK, heuristic_get_working);
+	mono_counters_register ("Threadpool queue latency (ms)", MONO_COUNTER_RUNTIME | MONO_COUNTER_INT | MONO_COUNTER_RAW | MONO_COUNTER_VARIABLE, &threadpool->heuristic_queue_latency);
+	mono_counters_register ("Threadpool threads injected", MONO_COUNTER_RUNTIME | MONO_COUNTER_INT | MONO_COUNTER_COUNT | MONO_COUNTER_MONOTONIC, &threadpool->heuristic_injected);
+	mono_counters_register ("Threadpool threads retired", MONO_COUNTER_RUNTIME | MONO_COUNTER_INT | MONO_COUNTER_COUNT | MONO_COUNTER_MONOTONIC, &threadpool->heuristic_retired);
+	mono_counters_register ("Threadpool blocked workers replaced", MONO_COUNTER_RUNTIME | MONO_COUNTER_INT | MONO_COUNTER_COUNT | MONO_COUNTER_MONOTONIC, &threadpool->blocking_replaced);
+}
+
 static void
 heuristic_notify_work_completed (void)
 {
@@ -1334,7 +1760,7 @@ heuristic_adjust (void)
 			gint16 new_thread_count;
 
 			counter.as_gint64 = COUNTER_READ ();
-			new_thread_count = hill_climbing_update (counter._.max_working, sample_duration, completions, &threadpool->heuristic_adjustment_interval);
+			new_thread_count = heuristic->update (counter._.max_working, sample_duration, completions, &threadpool->heuristic_adjustment_interval);
 
 			COUNTER_ATOMIC (counter, { counter._.max_working = new_thread_count; });
 
@@ -129,6 +129,16 @@ static mono_mutex_t joinable_threads_mutex;
 static StaticDataInfo thread_static_info;
 static StaticDataInfo context_static_info;
 
+/*
+ * Thread static data of exited threads, cleared and kept to be reused by threads
+ * attaching later, so short lived threads don't register and unregister GC roots
+ * each time. Protected by thread_static_data_pool_mutex.
+ */
+#define THREAD_STATIC_DATA_POOL_SIZE 16
+static gpointer *thread_static_data_pool [THREAD_STATIC_DATA_POOL_SIZE];
+static int thread_static_data_pool_count;
+static mono_mutex_t thread_static_data_pool_mutex;
+
 /* The hash of existing threads (key is thread ID, value is
  * MonoInternalThread*) that need joining before exit
  */
@@ -152,6 +162,11 @@ static MonoGHashTable *threads_starting_up = NULL;
 /* The TLS key that holds the MonoObject assigned to each thread */
 static MonoNativeTlsKey current_object_key;
 
+/* The TLS key that holds the static_data array of the current thread, so
+ * JITted code can reach thread static fields without going through the
+ * MonoInternalThread */
+static MonoNativeTlsKey current_static_data_key;
+
 /* Contains tids */
 /* Protected by the threads lock */
 static GHashTable *joinable_threads;
@@ -167,9 +182,15 @@ MONO_FAST_TLS_DECLARE(tls_current_object);
 	mono_native_tls_set_value (current_object_key, x); \
 } while (FALSE)
 #define GET_CURRENT_OBJECT() ((MonoInternalThread*) MONO_FAST_TLS_GET (tls_current_object))
+MONO_FAST_TLS_DECLARE(tls_current_static_data);
+#define SET_CURRENT_STATIC_DATA(x) do { \
+	MONO_FAST_TLS_SET (tls_current_static_data, x); \
+	mono_native_tls_set_value (current_static_data_key, x); \
+} while (FALSE)
 #else
 #define SET_CURRENT_OBJECT(x) mono_native_tls_set_value (current_object_key, x)
 #define GET_CURRENT_OBJECT() (MonoInternalThread*) mono_native_tls_get_value (current_object_key)
+#define SET_CURRENT_STATIC_DATA(x) mono_native_tls_set_value (current_static_data_key, x)
 #endif
 
 /* function called at thread start */
@@ -187,6 +208,8 @@ static guint32 default_stacksize = 0;
 
 static void context_adjust_static_data (MonoAppContext *ctx);
 static void mono_free_static_data (gpointer* static_data);
+static gpointer* thread_static_data_pool_get (void);
+static void thread_static_data_pool_put (gpointer *static_data);
 static void mono_init_static_data_info (StaticDataInfo *static_data);
 static guint32 mono_alloc_static_data_slot (StaticDataInfo *static_data, guint32 size, guint32 align);
 static gboolean mono_thread_resume (MonoInternalThread* thread);
@@ -255,6 +278,20 @@ mono_thread_get_tls_offset (void)
 	return offset;
 }
 
+gint32
+mono_thread_get_static_data_tls_offset (void)
+{
+	int offset = -1;
+
+#ifdef HOST_WIN32
+	if (current_static_data_key)
+		offset = current_static_data_key;
+#else
+	MONO_THREAD_VAR_OFFSET (tls_current_static_data,offset);
+#endif
+	return offset;
+}
+
 static inline MonoNativeThreadId
 thread_get_tid (MonoInternalThread *thread)
 {
@@ -318,6 +355,7 @@ is_threadabort_exception (MonoClass *klass)
 static void thread_cleanup (MonoInternalThread *thread)
 {
 	gboolean ret;
+	gpointer *static_data;
 
 	g_assert (thread != NULL);
 
@@ -432,8 +470,12 @@ static void thread_cleanup (MonoInternalThread *thread)
 
 	thread->cached_culture_info = NULL;
 
-	mono_free_static_data (thread->static_data);
+	static_data = thread->static_data;
 	thread->static_data = NULL;
+	if (thread == mono_thread_internal_current ())
+		SET_CURRENT_STATIC_DATA (NULL);
+	mono_memory_write_barrier ();
+	thread_static_data_pool_put (static_data);
 	ref_stack_destroy (thread->appdomain_refs);
 	thread->appdomain_refs = NULL;
 
@@ -614,6 +656,11 @@ mono_thread_attach_internal (MonoThread *thread, gboolean force_attach, gboolean
 		return FALSE;
 	}
 
+	/* Reuse the thread static data of an exited thread if possible, outside of the
+	 * threads lock. The missing chunks, if any, are allocated below. */
+	if (!internal->static_data)
+		internal->static_data = thread_static_data_pool_get ();
+
 	mono_threads_lock ();
 
 	if (threads_starting_up)
@@ -634,8 +681,10 @@ mono_thread_attach_internal (MonoThread *thread, gboolean force_attach, gboolean
 	mono_g_hash_table_insert (threads, (gpointer)(gsize)(internal->tid), internal);
 
 	/* We have to do this here because mono_thread_start_cb
-	 * requires that root_domain_thread is set up. */
-	if (thread_static_info.offset || thread_static_info.idx > 0) {
+	 * requires that root_domain_thread is set up. The top level array is
+	 * always allocated, as its address is published in TLS below and
+	 * never changes while the thread is alive. */
+	{
 		/* get the current allocated size */
 		guint32 offset = MAKE_SPECIAL_STATIC_OFFSET (thread_static_info.idx, thread_static_info.offset, 0);
 		mono_alloc_static_data (&internal->static_data, offset, TRUE);
@@ -643,6 +692,8 @@ mono_thread_attach_internal (MonoThread *thread, gboolean force_attach, gboolean
 
 	mono_threads_unlock ();
 
+	SET_CURRENT_STATIC_DATA (internal->static_data);
+
 	root_domain = mono_get_root_domain ();
 
 	g_assert (!internal->root_domain_thread);
@@ -810,6 +861,7 @@ static guint32 WINAPI start_wrapper_internal(StartInfo *start_info, gsize *stack
 	 * to TLS data.)
 	 */
 	SET_CURRENT_OBJECT (NULL);
+	SET_CURRENT_STATIC_DATA (NULL);
 
 	return(0);
 }
@@ -1055,6 +1107,7 @@ mono_thread_detach_internal (MonoInternalThread *thread)
 	thread_cleanup (thread);
 
 	SET_CURRENT_OBJECT (NULL);
+	SET_CURRENT_STATIC_DATA (NULL);
 	mono_domain_unset ();
 
 	/* Don't need to close the handle to this thread, even though we took a
@@ -1102,6 +1155,7 @@ mono_thread_exit (void)
 
 	thread_cleanup (thread);
 	SET_CURRENT_OBJECT (NULL);
+	SET_CURRENT_STATIC_DATA (NULL);
 	mono_domain_unset ();
 
 	/* we could add a callback here for embedders to use. */
@@ -2866,6 +2920,8 @@ mono_thread_init_tls (void)
 {
 	MONO_FAST_TLS_INIT (tls_current_object);
 	mono_native_tls_alloc (&current_object_key, NULL);
+	MONO_FAST_TLS_INIT (tls_current_static_data);
+	mono_native_tls_alloc (&current_static_data_key, NULL);
 }
 
 void mono_thread_init (MonoThreadStartCB start_cb,
@@ -2875,6 +2931,7 @@ void mono_thread_init (MonoThreadStartCB start_cb,
 
 	mono_os_mutex_init_recursive(&interlocked_mutex);
 	mono_os_mutex_init_recursive(&joinable_threads_mutex);
+	mono_os_mutex_init (&thread_static_data_pool_mutex);
 	
 	background_change_event = CreateEvent (NULL, TRUE, FALSE, NULL);
 	g_assert(background_change_event != NULL);
@@ -4057,6 +4114,66 @@ mono_free_static_data (gpointer* static_data)
 	mono_gc_free_fixed (static_data);
 }
 
+/*
+ * thread_static_data_pool_get:
+ *
+ *   Return cleared thread static data from the pool, or NULL if it is empty.
+ */
+static gpointer*
+thread_static_data_pool_get (void)
+{
+	gpointer *static_data = NULL;
+
+	mono_os_mutex_lock (&thread_static_data_pool_mutex);
+	if (thread_static_data_pool_count > 0)
+		static_data = thread_static_data_pool [--thread_static_data_pool_count];
+	mono_os_mutex_unlock (&thread_static_data_pool_mutex);
+
+	return static_data;
+}
+
+/*
+ * thread_static_data_pool_put:
+ *
+ *   Clear STATIC_DATA and keep it for a thread attaching later, or free it if
+ * the pool is full. The blocks stay registered with the GC while in the pool, so
+ * they are cleared atomically. Clearing them costs no more than the zeroing a
+ * new allocation would do.
+ */
+static void
+thread_static_data_pool_put (gpointer *static_data)
+{
+	int i;
+
+	if (!static_data)
+		return;
+
+	mono_os_mutex_lock (&thread_static_data_pool_mutex);
+	if (thread_static_data_pool_count == THREAD_STATIC_DATA_POOL_SIZE) {
+		mono_os_mutex_unlock (&thread_static_data_pool_mutex);
+		mono_free_static_data (static_data);
+		return;
+	}
+	mono_os_mutex_unlock (&thread_static_data_pool_mutex);
+
+	/* The first chunk starts with the array of chunks */
+	mono_gc_bzero_atomic (static_data + NUM_STATIC_DATA_IDX, static_data_size [0] - sizeof (gpointer) * NUM_STATIC_DATA_IDX);
+	for (i = 1; i < NUM_STATIC_DATA_IDX; ++i) {
+		if (static_data [i])
+			mono_gc_bzero_atomic (static_data [i], static_data_size [i]);
+	}
+
+	mono_os_mutex_lock (&thread_static_data_pool_mutex);
+	if (thread_static_data_pool_count < THREAD_STATIC_DATA_POOL_SIZE) {
+		thread_static_data_pool [thread_static_data_pool_count++] = static_data;
+		static_data = NULL;
+	}
+	mono_os_mutex_unlock (&thread_static_data_pool_mutex);
+
+	if (static_data)
+		mono_free_static_data (static_data);
+}
+
 /*
  *  mono_init_static_data_info
  *
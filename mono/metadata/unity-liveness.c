@@ -7,8 +7,17 @@
 #include <mono/metadata/class-internals.h>
 #include <mono/metadata/domain-internals.h>
 #include <mono/utils/mono-error.h>
+#include <mono/utils/mono-mmap.h>
+#include <mono/utils/mono-memory-model.h>
+#include <mono/utils/atomic.h>
+#include <mono/utils/mono-os-mutex.h>
+#include <mono/utils/mono-proclib.h>
+#include <mono/utils/mono-threads.h>
 
 typedef struct _LivenessState LivenessState;
+typedef struct _LivenessParallel LivenessParallel;
+typedef struct _LivenessVisitedSet LivenessVisitedSet;
+typedef struct _LivenessClassTable LivenessClassTable;
 
 typedef struct _GPtrArray custom_growable_array;
 #define array_at_index(array,index) (array)->pdata[(index)]
@@ -70,6 +79,10 @@ void array_grow(custom_growable_array* array)
 }
 
 typedef void (*register_object_callback)(gpointer* arr, int size, void* callback_userdata);
+typedef void (*register_filtered_objects_callback)(gint filter_index, gpointer* arr, int size, void* callback_userdata);
+
+/* Size of the batches handed to the callbacks */
+#define LIVENESS_BATCH_SIZE 64
 struct _LivenessState
 {
 	gint                first_index_in_all_objects;
@@ -83,6 +96,110 @@ struct _LivenessState
 	void*               callback_userdata;
 
 	register_object_callback filter_callback;
+
+	/* Set by mono_unity_liveness_allocate_struct_multi (), the objects are bucketed by all filters
+	 * during a single traversal. batches/batch_counts hold LIVENESS_BATCH_SIZE objects per filter. */
+	MonoClass**         filters;
+	gint                num_filters;
+	register_filtered_objects_callback filtered_callback;
+	gpointer*           batches;
+	gint*               batch_counts;
+
+	/* Shared by all workers */
+	LivenessVisitedSet* visited;
+	LivenessClassTable* classes;
+
+	/* Set when the heap is traversed by several threads, see mono_traverse_objects_parallel ()
+	 * process_lock protects process_array against other workers stealing from it. */
+	LivenessParallel*   parallel;
+	mono_mutex_t        process_lock;
+};
+
+/* Upper bound for the number of threads traversing the heap, including the calling thread */
+#define LIVENESS_MAX_WORKERS 8
+/* Most objects taken from another worker's process_array at once */
+#define LIVENESS_STEAL_BATCH 256
+
+struct _LivenessParallel
+{
+	/* workers [0] is the LivenessState of the calling thread, the others have their own thread */
+	LivenessState**     workers;
+	MonoNativeThreadId* threads;
+	gint                num_workers;
+
+	mono_mutex_t        lock;
+	mono_cond_t         cond;
+	guint               job;
+	gboolean            shutdown;
+	gboolean            running;
+	/* Worker threads which haven't finished the current traversal yet */
+	gint                active;
+	volatile gint       idle;
+
+	/* A worker ran out of space, everybody parks until the calling thread has grown the arrays */
+	volatile gint       grow_requested;
+	gint                parked;
+	guint               grow_generation;
+};
+
+static gint liveness_max_workers = -1;
+
+/*
+ * Visited objects are recorded in a side bitmap instead of the object header, one bit per
+ * LIVENESS_GRANULE bytes: objects are at least that big, so no two of them start in the same
+ * granule.  The bitmaps are allocated per LIVENESS_REGION_SIZE aligned region of the address
+ * space the first time an object in it is visited, which works the same for SGen's and Boehm's
+ * heap sections.  They are mmapped, so they can be created while the world is stopped.
+ */
+#define LIVENESS_GRANULE_BITS 3
+#define LIVENESS_REGION_BITS 22
+#define LIVENESS_REGION_SIZE ((gsize)1 << LIVENESS_REGION_BITS)
+#define LIVENESS_WORD_BITS (sizeof (gsize) * 8)
+#define LIVENESS_BITMAP_SIZE ((LIVENESS_REGION_SIZE >> LIVENESS_GRANULE_BITS) / 8)
+/* Enough for 192GB worth of regions before the table is 3/4 full */
+#define LIVENESS_REGION_TABLE_SIZE (1 << 16)
+
+typedef struct
+{
+	/* region index plus one, 0 marks a free slot, set after bitmap */
+	volatile gsize      key;
+	gsize*              bitmap;
+} LivenessRegion;
+
+struct _LivenessVisitedSet
+{
+	LivenessRegion*     regions;
+	gint                num_regions;
+	/* serializes adding regions, lookups don't take it */
+	mono_mutex_t        lock;
+};
+
+/*
+ * Reference bitmaps of the classes seen during the traversal, one bit per pointer sized
+ * slot from the start of the object, see liveness_compute_class_bitmap ().  The bitmaps
+ * live in mmapped chunks, like the visited bitmaps.  Classes which don't fit fall back to
+ * walking their fields.
+ */
+#define LIVENESS_CLASS_TABLE_SIZE (1 << 13)
+#define LIVENESS_CLASS_CHUNK_SIZE (64 * 1024)
+
+typedef struct
+{
+	/* set after bitmap and num_bits */
+	MonoClass* volatile klass;
+	gsize*              bitmap;
+	/* index of the highest set bit plus one, 0 for classes without references */
+	gint32              num_bits;
+} LivenessClassBitmap;
+
+struct _LivenessClassTable
+{
+	LivenessClassBitmap* entries;
+	gint                 num_entries;
+	/* chunks are linked through their first word */
+	gsize*               chunk;
+	gsize                chunk_used;
+	mono_mutex_t         lock;
 };
 
 /* Liveness calculation */
@@ -95,52 +212,159 @@ MONO_API void           mono_unity_liveness_free_struct (LivenessState* state);
 MONO_API LivenessState* mono_unity_liveness_calculation_begin (MonoClass* filter, guint max_count, register_object_callback callback, void* callback_userdata);
 MONO_API void           mono_unity_liveness_calculation_end (LivenessState* state);
 
+MONO_API LivenessState* mono_unity_liveness_allocate_struct_multi (MonoClass** filters, gint num_filters, guint max_count, register_filtered_objects_callback callback, void* callback_userdata);
+MONO_API LivenessState* mono_unity_liveness_calculation_begin_multi (MonoClass** filters, gint num_filters, guint max_count, register_filtered_objects_callback callback, void* callback_userdata);
+
 MONO_API void           mono_unity_liveness_calculation_from_root (MonoObject* root, LivenessState* state);
 MONO_API void           mono_unity_liveness_calculation_from_statics (LivenessState* state);
 
-#define MARK_OBJ(obj) \
-	do { \
-		(obj)->vtable = (MonoVTable*)(((gsize)(obj)->vtable) | (gsize)1); \
-	} while (0)
+MONO_API void           mono_unity_liveness_set_max_workers (gint count);
 
-#define CLEAR_OBJ(obj) \
-	do { \
-		(obj)->vtable = (MonoVTable*)(((gsize)(obj)->vtable) & ~(gsize)1); \
-	} while (0)
+#define GET_VTABLE(obj) \
+	((obj)->vtable)
 
-#define IS_MARKED(obj) \
-	(((gsize)(obj)->vtable) & (gsize)1)
+static LivenessVisitedSet* liveness_visited_new (void)
+{
+	LivenessVisitedSet* visited = g_new0(LivenessVisitedSet, 1);
 
-#define GET_VTABLE(obj) \
-	((MonoVTable*)(((gsize)(obj)->vtable) & ~(gsize)1))
+	visited->regions = g_new0(LivenessRegion, LIVENESS_REGION_TABLE_SIZE);
+	mono_os_mutex_init (&visited->lock);
+	return visited;
+}
+
+/* Drop all the bitmaps, forgetting every visited object */
+static void liveness_visited_clear (LivenessVisitedSet* visited)
+{
+	int i;
+
+	for (i = 0; i < LIVENESS_REGION_TABLE_SIZE; i++)
+	{
+		if (visited->regions[i].key)
+			mono_vfree (visited->regions[i].bitmap, LIVENESS_BITMAP_SIZE);
+	}
+	memset (visited->regions, 0, sizeof (LivenessRegion) * LIVENESS_REGION_TABLE_SIZE);
+	visited->num_regions = 0;
+}
+
+static void liveness_visited_free (LivenessVisitedSet* visited)
+{
+	liveness_visited_clear (visited);
+	mono_os_mutex_destroy (&visited->lock);
+	g_free(visited->regions);
+	g_free(visited);
+}
+
+static gsize* liveness_region_bitmap (LivenessVisitedSet* visited, gpointer addr, gboolean create)
+{
+	gsize key = ((gsize)addr >> LIVENESS_REGION_BITS) + 1;
+	guint i = (guint)(key * 2654435761u) & (LIVENESS_REGION_TABLE_SIZE - 1);
+	gsize* bitmap;
+
+	for (;; i = (i + 1) & (LIVENESS_REGION_TABLE_SIZE - 1))
+	{
+		gsize slot_key = visited->regions[i].key;
+		if (slot_key == key)
+		{
+			mono_memory_read_barrier ();
+			return visited->regions[i].bitmap;
+		}
+		if (slot_key)
+			continue;
+		if (!create)
+			return NULL;
+
+		mono_os_mutex_lock (&visited->lock);
+		if (visited->regions[i].key)
+		{
+			// somebody else took the slot, it could still be our region
+			mono_os_mutex_unlock (&visited->lock);
+			i = (i - 1) & (LIVENESS_REGION_TABLE_SIZE - 1);
+			continue;
+		}
+		if (visited->num_regions >= LIVENESS_REGION_TABLE_SIZE / 4 * 3)
+			g_error ("The liveness calculation ran out of heap regions");
+		bitmap = (gsize*)mono_valloc (NULL, LIVENESS_BITMAP_SIZE, MONO_MMAP_READ | MONO_MMAP_WRITE | MONO_MMAP_PRIVATE | MONO_MMAP_ANON);
+		g_assert (bitmap);
+		visited->regions[i].bitmap = bitmap;
+		mono_memory_write_barrier ();
+		visited->regions[i].key = key;
+		visited->num_regions++;
+		mono_os_mutex_unlock (&visited->lock);
+		return bitmap;
+	}
+}
+
+static gboolean liveness_is_visited (LivenessState* state, MonoObject* obj)
+{
+	gsize* bitmap = liveness_region_bitmap (state->visited, obj, FALSE);
+	gsize bit = ((gsize)obj & (LIVENESS_REGION_SIZE - 1)) >> LIVENESS_GRANULE_BITS;
+
+	return bitmap && (bitmap [bit / LIVENESS_WORD_BITS] & ((gsize)1 << (bit % LIVENESS_WORD_BITS)));
+}
+
+/* Returns FALSE if OBJ was visited already */
+static gboolean liveness_visit (LivenessState* state, MonoObject* obj)
+{
+	gsize* bitmap = liveness_region_bitmap (state->visited, obj, TRUE);
+	gsize bit = ((gsize)obj & (LIVENESS_REGION_SIZE - 1)) >> LIVENESS_GRANULE_BITS;
+	volatile gsize* word = &bitmap [bit / LIVENESS_WORD_BITS];
+	gsize mask = (gsize)1 << (bit % LIVENESS_WORD_BITS);
+	gsize old;
+
+	if (!state->parallel)
+	{
+		if (*word & mask)
+			return FALSE;
+		*word |= mask;
+		return TRUE;
+	}
+
+	do
+	{
+		old = *word;
+		if (old & mask)
+			return FALSE;
+	} while (InterlockedCompareExchangePointer ((volatile gpointer*)word, (gpointer)(old | mask), (gpointer)old) != (gpointer)old);
+	return TRUE;
+}
 
 
 void mono_filter_objects(LivenessState* state);
 
 void mono_reset_state(LivenessState* state)
 {
+	int i;
+
 	state->first_index_in_all_objects = state->all_objects->len;
 	array_clear(state->process_array);
+
+	if (state->parallel)
+	{
+		for (i = 1; i < state->parallel->num_workers; i++)
+		{
+			LivenessState* worker = state->parallel->workers[i];
+			worker->first_index_in_all_objects = worker->all_objects->len;
+			array_clear(worker->process_array);
+		}
+	}
 }
 
+static void liveness_parallel_park (LivenessState* state);
+
 void array_safe_grow(LivenessState* state, custom_growable_array* array)
 {
-	// if all_objects run out of space, run through list
-	// clear bit in vtable, start the world, reallocate, stop the world and continue
-	int i;
-	for (i = 0; i < state->all_objects->len; i++)
+	// if all_objects run out of space, start the world, reallocate, stop the world and continue
+	if (state->parallel && state->parallel->running)
 	{
-		MonoObject* object = array_at_index(state->all_objects,i);
-		CLEAR_OBJ(object);
+		// the other workers could be using the arrays, so growing has to wait for all of them
+		InterlockedWrite (&state->parallel->grow_requested, TRUE);
+		liveness_parallel_park (state);
+		return;
 	}
+
 	LIVENESS_START_WORLD ();
 	array_grow(array);
 	LIVENESS_STOP_WORLD ();
-	for (i = 0; i < state->all_objects->len; i++)
-	{
-		MonoObject* object = array_at_index(state->all_objects,i);
-		MARK_OBJ(object);
-	}
 }
 
 static gboolean should_process_value (MonoObject* val, MonoClass* filter)
@@ -153,8 +377,23 @@ static gboolean should_process_value (MonoObject* val, MonoClass* filter)
 	return TRUE;
 }
 
+/* Objects are recorded in all_objects if they match the filter, or any of the filters of a multi query */
+static gboolean should_record_value (MonoObject* val, LivenessState* state)
+{
+	int i;
+
+	if (!state->filters)
+		return should_process_value (val, state->filter);
+
+	for (i = 0; i < state->num_filters; i++)
+		if (should_process_value (val, state->filters[i]))
+			return TRUE;
+	return FALSE;
+}
+
 static void mono_traverse_array (MonoArray* array, LivenessState* state);
 static void mono_traverse_object (MonoObject* object, LivenessState* state);
+static void mono_traverse_object_internal (MonoObject* object, gboolean isStruct, MonoClass* klass, LivenessState* state);
 static void mono_traverse_gc_desc (MonoObject* object, LivenessState* state);
 static void mono_traverse_objects (LivenessState* state);
 
@@ -175,17 +414,67 @@ static void mono_traverse_generic_object( MonoObject* object, LivenessState* sta
 }
 
 
+static void process_array_push (LivenessState* state, MonoObject* object)
+{
+	if (!state->parallel)
+	{
+		array_push_back(state->process_array, object);
+		return;
+	}
+
+	mono_os_mutex_lock (&state->process_lock);
+	array_push_back(state->process_array, object);
+	mono_os_mutex_unlock (&state->process_lock);
+}
+
+static MonoObject* process_array_pop (LivenessState* state)
+{
+	MonoObject* object = NULL;
+
+	if (!state->parallel)
+		return state->process_array->len > 0 ? array_pop_back(state->process_array) : NULL;
+
+	mono_os_mutex_lock (&state->process_lock);
+	if (state->process_array->len > 0)
+		object = array_pop_back(state->process_array);
+	mono_os_mutex_unlock (&state->process_lock);
+	return object;
+}
+
+static void mono_add_process_object_parallel (MonoObject* object, LivenessState* state, gboolean has_references)
+{
+	if (array_is_full(state->all_objects))
+		array_safe_grow(state, state->all_objects);
+	if (has_references && array_is_full(state->process_array))
+		array_safe_grow(state, state->process_array);
+
+	// several workers can reach the same object, whoever sets the visited bit owns it
+	if (!liveness_visit (state, object))
+		return;
+
+	array_push_back(state->all_objects, object);
+	if (has_references)
+		process_array_push(state, object);
+}
+
 static void mono_add_process_object (MonoObject* object, LivenessState* state)
 {
-	if (object && !IS_MARKED(object))
+	if (object && !liveness_is_visited(state, object))
 	{
 		gboolean has_references = GET_VTABLE(object)->klass->has_references;
-		if(has_references || should_process_value(object,state->filter))
+		if (state->parallel && state->parallel->running)
+		{
+			// objects which are processed are always recorded in all_objects as well
+			if (has_references || should_record_value(object,state))
+				mono_add_process_object_parallel (object, state, has_references);
+			return;
+		}
+		if(has_references || should_record_value(object,state))
 		{
 			if (array_is_full(state->all_objects))
 				array_safe_grow(state, state->all_objects);
 			array_push_back(state->all_objects, object);
-			MARK_OBJ(object);
+			liveness_visit(state, object);
 		}
 		// Check if klass has further references - if not skip adding
 		if (has_references)
@@ -208,7 +497,152 @@ static gboolean mono_field_can_contain_references(MonoClassField* field)
 	return MONO_TYPE_IS_REFERENCE(field->type);
 }
 
-static void mono_traverse_object_internal (MonoObject* object, gboolean isStruct, MonoClass* klass, LivenessState* state)
+static void liveness_compute_class_bitmap (MonoClass* klass, gsize* bitmap, int offset, gint32 max_bits, gint32* num_bits)
+{
+	int i;
+	MonoClassField *field;
+	MonoClass *p;
+
+	// the same fields mono_traverse_object_fields () looks at
+	for (p = klass; p != NULL; p = p->parent)
+	{
+		if (p->size_inited == 0)
+			continue;
+		for (i = 0; i < p->field.count; i++)
+		{
+			int pos;
+
+			field = &p->fields[i];
+			if (field->type->attrs & FIELD_ATTRIBUTE_STATIC)
+				continue;
+
+			if(!mono_field_can_contain_references(field))
+				continue;
+
+			pos = offset + field->offset / (int)sizeof (gpointer);
+			if (MONO_TYPE_ISSTRUCT(field->type))
+			{
+				MonoClass* field_class;
+				if (field->type->type == MONO_TYPE_GENERICINST)
+				{
+					g_assert(field->type->data.generic_class->cached_class);
+					field_class = field->type->data.generic_class->cached_class;
+				}
+				else
+					field_class = field->type->data.klass;
+				// the field offsets of the struct include the object header
+				liveness_compute_class_bitmap (field_class, bitmap, pos - (int)(sizeof (MonoObject) / sizeof (gpointer)), max_bits, num_bits);
+				continue;
+			}
+
+			g_assert (field->offset != -1);
+			g_assert (pos >= 0 && pos < max_bits);
+			bitmap [pos / LIVENESS_WORD_BITS] |= (gsize)1 << (pos % LIVENESS_WORD_BITS);
+			*num_bits = MAX (*num_bits, pos + 1);
+		}
+	}
+}
+
+static LivenessClassTable* liveness_classes_new (void)
+{
+	LivenessClassTable* classes = g_new0(LivenessClassTable, 1);
+
+	classes->entries = g_new0(LivenessClassBitmap, LIVENESS_CLASS_TABLE_SIZE);
+	mono_os_mutex_init (&classes->lock);
+	return classes;
+}
+
+static void liveness_classes_free (LivenessClassTable* classes)
+{
+	gsize* chunk = classes->chunk;
+
+	while (chunk)
+	{
+		gsize* next = (gsize*)chunk [0];
+		mono_vfree (chunk, LIVENESS_CLASS_CHUNK_SIZE);
+		chunk = next;
+	}
+	mono_os_mutex_destroy (&classes->lock);
+	g_free(classes->entries);
+	g_free(classes);
+}
+
+/* Returns NULL if KLASS has to be traversed through its fields */
+static LivenessClassBitmap* liveness_class_bitmap (LivenessClassTable* classes, MonoClass* klass)
+{
+	guint i = (guint)(((gsize)klass >> 3) * 2654435761u) & (LIVENESS_CLASS_TABLE_SIZE - 1);
+	LivenessClassBitmap* entry;
+	gint32 max_bits;
+	gsize words;
+
+	for (;; i = (i + 1) & (LIVENESS_CLASS_TABLE_SIZE - 1))
+	{
+		MonoClass* entry_klass;
+
+		entry = &classes->entries[i];
+		entry_klass = entry->klass;
+		if (entry_klass == klass)
+		{
+			mono_memory_read_barrier ();
+			return entry;
+		}
+		if (entry_klass)
+			continue;
+
+		mono_os_mutex_lock (&classes->lock);
+		if (entry->klass)
+		{
+			// somebody else took the slot, it could still be our class
+			mono_os_mutex_unlock (&classes->lock);
+			i = (i - 1) & (LIVENESS_CLASS_TABLE_SIZE - 1);
+			continue;
+		}
+		break;
+	}
+
+	max_bits = klass->instance_size / sizeof (gpointer);
+	words = (max_bits + LIVENESS_WORD_BITS - 1) / LIVENESS_WORD_BITS;
+	if (classes->num_entries >= LIVENESS_CLASS_TABLE_SIZE / 4 * 3 || (words + 1) * sizeof (gsize) > LIVENESS_CLASS_CHUNK_SIZE)
+	{
+		mono_os_mutex_unlock (&classes->lock);
+		return NULL;
+	}
+	if (!classes->chunk || (classes->chunk_used + words) * sizeof (gsize) > LIVENESS_CLASS_CHUNK_SIZE)
+	{
+		gsize* chunk = (gsize*)mono_valloc (NULL, LIVENESS_CLASS_CHUNK_SIZE, MONO_MMAP_READ | MONO_MMAP_WRITE | MONO_MMAP_PRIVATE | MONO_MMAP_ANON);
+		g_assert (chunk);
+		chunk [0] = (gsize)classes->chunk;
+		classes->chunk = chunk;
+		classes->chunk_used = 1;
+	}
+
+	entry->bitmap = classes->chunk + classes->chunk_used;
+	classes->chunk_used += words;
+	entry->num_bits = 0;
+	liveness_compute_class_bitmap (klass, entry->bitmap, 0, max_bits, &entry->num_bits);
+	mono_memory_write_barrier ();
+	entry->klass = klass;
+	classes->num_entries++;
+	mono_os_mutex_unlock (&classes->lock);
+	return entry;
+}
+
+static void liveness_traverse_bitmap (char* base, LivenessClassBitmap* info, LivenessState* state)
+{
+	int i, j;
+
+	for (i = 0; i < info->num_bits; i += LIVENESS_WORD_BITS)
+	{
+		gsize word = info->bitmap [i / LIVENESS_WORD_BITS];
+		for (j = i; word; j++, word >>= 1)
+		{
+			if (word & 1)
+				mono_add_process_object (*(MonoObject**)(base + j * sizeof (gpointer)), state);
+		}
+	}
+}
+
+static void mono_traverse_object_fields (MonoObject* object, gboolean isStruct, MonoClass* klass, LivenessState* state)
 {
 	int i;
 	MonoClassField *field;
@@ -259,6 +693,22 @@ static void mono_traverse_object_internal (MonoObject* object, gboolean isStruct
 	}
 }
 
+static void mono_traverse_object_internal (MonoObject* object, gboolean isStruct, MonoClass* klass, LivenessState* state)
+{
+	LivenessClassBitmap* info = liveness_class_bitmap (state->classes, klass);
+
+	g_assert (object);
+
+	if (!info)
+	{
+		mono_traverse_object_fields (object, isStruct, klass, state);
+		return;
+	}
+
+	// the bitmap is relative to the object header, which structs don't have
+	liveness_traverse_bitmap (isStruct ? (char*)object - sizeof (MonoObject) : (char*)object, info, state);
+}
+
 static void mono_traverse_object (MonoObject* object, LivenessState* state)
 {
 	mono_traverse_object_internal (object, FALSE, GET_VTABLE(object)->klass, state);
@@ -283,16 +733,210 @@ static void mono_traverse_gc_desc (MonoObject* object, LivenessState* state)
 	}
 }
 
+/*
+ * Parallel traversal
+ *
+ * The world stays stopped for the whole traversal, the helper threads are not registered
+ * with the runtime so they keep running.  Each worker drains its own process_array and
+ * steals half of another worker's when it runs out.  The traversal is over once every
+ * worker is idle, since only the owner of a process_array pushes to it.
+ */
+
+static gboolean liveness_steal_work (LivenessState* state)
+{
+	LivenessParallel* p = state->parallel;
+	MonoObject* stolen [LIVENESS_STEAL_BATCH];
+	int i, j, n;
+
+	for (i = 0; i < p->num_workers; i++)
+	{
+		LivenessState* victim = p->workers[i];
+		if (victim == state || victim->process_array->len < 2)
+			continue;
+
+		mono_os_mutex_lock (&victim->process_lock);
+		// only the owner pushes to an array, so our free space can only grow meanwhile
+		n = MIN (victim->process_array->len / 2, LIVENESS_STEAL_BATCH);
+		n = MIN (n, (int)(g_ptr_array_reserved_size(state->process_array) - state->process_array->len));
+		for (j = 0; j < n; j++)
+			stolen [j] = array_pop_back(victim->process_array);
+		mono_os_mutex_unlock (&victim->process_lock);
+
+		if (n <= 0)
+			continue;
+
+		mono_os_mutex_lock (&state->process_lock);
+		for (j = 0; j < n; j++)
+			array_push_back(state->process_array, stolen [j]);
+		mono_os_mutex_unlock (&state->process_lock);
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static gboolean liveness_has_work (LivenessParallel* p)
+{
+	int i;
+
+	for (i = 0; i < p->num_workers; i++)
+	{
+		if (p->workers[i]->process_array->len > 0)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void liveness_parallel_grow (LivenessParallel* p)
+{
+	int i;
+
+	LIVENESS_START_WORLD ();
+	for (i = 0; i < p->num_workers; i++)
+	{
+		if (array_is_full(p->workers[i]->all_objects))
+			array_grow(p->workers[i]->all_objects);
+		if (array_is_full(p->workers[i]->process_array))
+			array_grow(p->workers[i]->process_array);
+	}
+	LIVENESS_STOP_WORLD ();
+}
+
+/*
+ * liveness_parallel_park:
+ *
+ *   Wait for a pending grow request to be served.  The calling thread grows the arrays
+ * once all workers are parked, as it is the one which stopped the world.
+ */
+static void liveness_parallel_park (LivenessState* state)
+{
+	LivenessParallel* p = state->parallel;
+	guint generation;
+
+	mono_os_mutex_lock (&p->lock);
+	if (!p->grow_requested)
+	{
+		mono_os_mutex_unlock (&p->lock);
+		return;
+	}
+	generation = p->grow_generation;
+	p->parked++;
+	mono_os_cond_broadcast (&p->cond);
+	if (state == p->workers[0])
+	{
+		while (p->parked < p->num_workers)
+			mono_os_cond_wait (&p->cond, &p->lock);
+		liveness_parallel_grow (p);
+		InterlockedWrite (&p->grow_requested, FALSE);
+		p->grow_generation++;
+		mono_os_cond_broadcast (&p->cond);
+	}
+	else
+	{
+		while (p->grow_generation == generation)
+			mono_os_cond_wait (&p->cond, &p->lock);
+	}
+	p->parked--;
+	mono_os_mutex_unlock (&p->lock);
+}
+
+static void liveness_worker_run (LivenessState* state)
+{
+	LivenessParallel* p = state->parallel;
+	MonoObject* object;
+
+	for (;;)
+	{
+		if (p->grow_requested)
+		{
+			liveness_parallel_park (state);
+			continue;
+		}
+
+		object = process_array_pop (state);
+		if (object)
+		{
+			mono_traverse_generic_object(object, state);
+			continue;
+		}
+
+		if (liveness_steal_work (state))
+			continue;
+
+		InterlockedIncrement (&p->idle);
+		for (;;)
+		{
+			if (InterlockedRead (&p->idle) == p->num_workers)
+				return;
+			if (p->grow_requested || liveness_has_work (p))
+			{
+				InterlockedDecrement (&p->idle);
+				break;
+			}
+			mono_thread_info_yield ();
+		}
+	}
+}
+
+static mono_native_thread_return_t liveness_worker_thread (void* arg)
+{
+	LivenessState* state = (LivenessState*)arg;
+	LivenessParallel* p = state->parallel;
+	guint job = 0;
+
+	mono_os_mutex_lock (&p->lock);
+	for (;;)
+	{
+		while (p->job == job && !p->shutdown)
+			mono_os_cond_wait (&p->cond, &p->lock);
+		if (p->shutdown)
+			break;
+		job = p->job;
+		mono_os_mutex_unlock (&p->lock);
+
+		liveness_worker_run (state);
+
+		mono_os_mutex_lock (&p->lock);
+		p->active--;
+		mono_os_cond_broadcast (&p->cond);
+	}
+	mono_os_mutex_unlock (&p->lock);
+
+	return (mono_native_thread_return_t)0;
+}
+
+static void mono_traverse_objects_parallel (LivenessState* state)
+{
+	LivenessParallel* p = state->parallel;
+
+	mono_os_mutex_lock (&p->lock);
+	p->running = TRUE;
+	p->idle = 0;
+	p->active = p->num_workers - 1;
+	p->job++;
+	mono_os_cond_broadcast (&p->cond);
+	mono_os_mutex_unlock (&p->lock);
+
+	liveness_worker_run (state);
+
+	mono_os_mutex_lock (&p->lock);
+	while (p->active > 0)
+		mono_os_cond_wait (&p->cond, &p->lock);
+	p->running = FALSE;
+	mono_os_mutex_unlock (&p->lock);
+}
+
 static void mono_traverse_objects (LivenessState* state)
 {
-	int i = 0;
 	MonoObject* object = NULL;
 
-	while (state->process_array->len > 0)
+	if (state->parallel && !state->parallel->running)
 	{
-		object = array_pop_back(state->process_array);
-		mono_traverse_generic_object(object, state);
+		mono_traverse_objects_parallel (state);
+		return;
 	}
+
+	while ((object = process_array_pop (state)))
+		mono_traverse_generic_object(object, state);
 }
 
 static void mono_traverse_array (MonoArray* array, LivenessState* state)
@@ -301,6 +945,7 @@ static void mono_traverse_array (MonoArray* array, LivenessState* state)
 	gboolean has_references;
 	MonoObject* object = (MonoObject*)array;
 	MonoClass* element_class;
+	LivenessClassBitmap* element_info = NULL;
 	size_t elementClassSize;
 	size_t array_length;
 	
@@ -312,9 +957,19 @@ static void mono_traverse_array (MonoArray* array, LivenessState* state)
 	has_references = !mono_class_is_valuetype(element_class);
 	g_assert(element_class->size_inited != 0);
 	
-	for (i = 0; i < element_class->field.count; i++)
+	if (!has_references)
 	{
-		has_references |= mono_field_can_contain_references(&element_class->fields[i]);
+		// arrays of structs without references are skipped wholesale
+		element_info = liveness_class_bitmap (state->classes, element_class);
+		if (element_info)
+			has_references = element_info->num_bits > 0;
+		else
+		{
+			for (i = 0; i < element_class->field.count; i++)
+			{
+				has_references |= mono_field_can_contain_references(&element_class->fields[i]);
+			}
+		}
 	}
 	
 	if (!has_references)
@@ -327,7 +982,10 @@ static void mono_traverse_array (MonoArray* array, LivenessState* state)
 		for (i = 0; i < array_length; i++)
 		{
 			MonoObject* object = (MonoObject*)mono_array_addr_with_size (array, elementClassSize, i);
-			mono_traverse_object_internal (object, 1, element_class, state);
+			if (element_info)
+				liveness_traverse_bitmap ((char*)object - sizeof (MonoObject), element_info, state);
+			else
+				mono_traverse_object_internal (object, 1, element_class, state);
 			
 			// Add 128 objects at a time and then traverse, 64 seems not be enough
 			if( ((i+1) & 127) == 0)
@@ -349,21 +1007,69 @@ static void mono_traverse_array (MonoArray* array, LivenessState* state)
 }
 
 
+static void liveness_flush_batch (LivenessState* state, gint filter_index)
+{
+	if (state->batch_counts[filter_index] == 0)
+		return;
+	state->filtered_callback(filter_index, state->batches + filter_index * LIVENESS_BATCH_SIZE, state->batch_counts[filter_index], state->callback_userdata);
+	state->batch_counts[filter_index] = 0;
+}
+
+/* Every object is handed to each filter it matches, full batches are delivered as soon as they fill up */
+static void mono_filter_objects_multi(LivenessState* state)
+{
+	gint num_workers = state->parallel ? state->parallel->num_workers : 1;
+	int w, f;
+
+	for (w = 0; w < num_workers; w++)
+	{
+		LivenessState* worker = state->parallel ? state->parallel->workers[w] : state;
+		int i = worker->first_index_in_all_objects;
+		for ( ; i < worker->all_objects->len; i++)
+		{
+			MonoObject* object = worker->all_objects->pdata[i];
+			for (f = 0; f < state->num_filters; f++)
+			{
+				if (!should_process_value (object, state->filters[f]))
+					continue;
+				state->batches[f * LIVENESS_BATCH_SIZE + state->batch_counts[f]++] = object;
+				if (state->batch_counts[f] == LIVENESS_BATCH_SIZE)
+					liveness_flush_batch (state, f);
+			}
+		}
+	}
+
+	for (f = 0; f < state->num_filters; f++)
+		liveness_flush_batch (state, f);
+}
+
 void mono_filter_objects(LivenessState* state)
 {
-	gpointer filtered_objects[64];
+	gpointer filtered_objects[LIVENESS_BATCH_SIZE];
 	gint num_objects = 0;
+	gint num_workers = state->parallel ? state->parallel->num_workers : 1;
+	int w;
 
-	int i = state->first_index_in_all_objects;
-	for ( ; i < state->all_objects->len; i++)
+	if (state->filters)
 	{
-		MonoObject* object = state->all_objects->pdata[i];
-		if (should_process_value (object, state->filter))
-			filtered_objects[num_objects++] = object;
-		if (num_objects == 64)
+		mono_filter_objects_multi (state);
+		return;
+	}
+
+	for (w = 0; w < num_workers; w++)
+	{
+		LivenessState* worker = state->parallel ? state->parallel->workers[w] : state;
+		int i = worker->first_index_in_all_objects;
+		for ( ; i < worker->all_objects->len; i++)
 		{
-			state->filter_callback(filtered_objects, 64, state->callback_userdata);
-			num_objects = 0;
+			MonoObject* object = worker->all_objects->pdata[i];
+			if (should_process_value (object, state->filter))
+				filtered_objects[num_objects++] = object;
+			if (num_objects == LIVENESS_BATCH_SIZE)
+			{
+				state->filter_callback(filtered_objects, LIVENESS_BATCH_SIZE, state->callback_userdata);
+				num_objects = 0;
+			}
 		}
 	}
 
@@ -549,15 +1255,105 @@ gpointer mono_unity_liveness_calculation_from_root_managed(gpointer root_handle,
 	return (gpointer)mono_gchandle_new ((MonoObject*)res, FALSE);
 }
 
-LivenessState* mono_unity_liveness_allocate_struct (MonoClass* filter, guint max_count, register_object_callback callback, void* callback_userdata)
+/**
+ * mono_unity_liveness_set_max_workers:
+ *
+ * Set the number of threads, including the calling one, that traverse the heap in
+ * subsequent liveness calculations.  1 keeps the traversal on the calling thread.
+ * Defaults to the number of processors, up to LIVENESS_MAX_WORKERS.
+ */
+void mono_unity_liveness_set_max_workers (gint count)
+{
+	liveness_max_workers = CLAMP (count, 1, LIVENESS_MAX_WORKERS);
+}
+
+static LivenessState* liveness_allocate_state (MonoClass* filter, guint max_count)
+{
+	LivenessState* state = g_new0(LivenessState, 1);
+
+	state->all_objects = array_create_and_initialize(max_count*4);
+	state->process_array = array_create_and_initialize (max_count);
+	state->filter = filter;
+	return state;
+}
+
+static void liveness_free_worker_state (LivenessState* state)
+{
+	mono_os_mutex_destroy (&state->process_lock);
+	array_destroy(state->all_objects);
+	array_destroy(state->process_array);
+	g_free(state);
+}
+
+/* The helper threads are started while the world is still running, they wait for mono_traverse_objects_parallel () */
+static void liveness_start_workers (LivenessState* state, MonoClass* filter, guint max_count, gint num_workers)
+{
+	LivenessParallel* p = g_new0(LivenessParallel, 1);
+	int i;
+
+	p->num_workers = num_workers;
+	p->workers = g_new0(LivenessState*, num_workers);
+	p->threads = g_new0(MonoNativeThreadId, num_workers);
+	mono_os_mutex_init (&p->lock);
+	mono_os_cond_init (&p->cond);
+
+	p->workers[0] = state;
+	for (i = 1; i < num_workers; i++)
+		p->workers[i] = liveness_allocate_state (filter, max_count);
+	for (i = 0; i < num_workers; i++)
+	{
+		p->workers[i]->parallel = p;
+		p->workers[i]->visited = state->visited;
+		p->workers[i]->classes = state->classes;
+		p->workers[i]->filters = state->filters;
+		p->workers[i]->num_filters = state->num_filters;
+		mono_os_mutex_init (&p->workers[i]->process_lock);
+	}
+
+	for (i = 1; i < num_workers; i++)
+	{
+		if (!mono_native_thread_create (&p->threads[i], liveness_worker_thread, p->workers[i]))
+			break;
+	}
+	// fewer threads than planned is fine, the traversal only waits for those which exist
+	p->num_workers = i;
+	for (; i < num_workers; i++)
+		liveness_free_worker_state (p->workers[i]);
+}
+
+static void liveness_stop_workers (LivenessState* state)
+{
+	LivenessParallel* p = state->parallel;
+	int i;
+
+	mono_os_mutex_lock (&p->lock);
+	p->shutdown = TRUE;
+	mono_os_cond_broadcast (&p->cond);
+	mono_os_mutex_unlock (&p->lock);
+
+	for (i = 1; i < p->num_workers; i++)
+		mono_native_thread_join (p->threads[i]);
+
+	mono_os_mutex_destroy (&state->process_lock);
+	for (i = 1; i < p->num_workers; i++)
+		liveness_free_worker_state (p->workers[i]);
+	mono_os_cond_destroy (&p->cond);
+	mono_os_mutex_destroy (&p->lock);
+	g_free(p->workers);
+	g_free(p->threads);
+	g_free(p);
+	state->parallel = NULL;
+}
+
+static LivenessState* liveness_allocate_struct (MonoClass* filter, MonoClass** filters, gint num_filters, guint max_count, void* callback_userdata)
 {
 	LivenessState* state = NULL;
 
 	// construct liveness_state;
 	// allocate memory for the following structs
-	// all_objects: contains a list of all referenced objects to be able to clean the vtable bits after the traversal
+	// all_objects: contains a list of all referenced objects, to be filtered and reported after the traversal
 	// process_array. array that contains the objcets that should be processed. this should run depth first to reduce memory usage
-	// if all_objects run out of space, run through list, add objects that match the filter, clear bit in vtable and then clear the array.
+	// visited: side bitmap of the objects reached so far, the objects themselves are never modified
 
 	state = g_new(LivenessState, 1);
 	max_count = max_count < 1000 ? 1000 : max_count;
@@ -568,24 +1364,73 @@ LivenessState* mono_unity_liveness_allocate_struct (MonoClass* filter, guint max
 	state->filter = filter;
 
 	state->callback_userdata = callback_userdata;
+	state->filter_callback = NULL;
+	state->filtered_callback = NULL;
+	state->filters = NULL;
+	state->num_filters = 0;
+	state->batches = NULL;
+	state->batch_counts = NULL;
+	if (filters)
+	{
+		// the batches are allocated here, nothing can be allocated once the world is stopped
+		state->filters = g_new(MonoClass*, num_filters);
+		memcpy (state->filters, filters, num_filters * sizeof (MonoClass*));
+		state->num_filters = num_filters;
+		state->batches = g_new(gpointer, num_filters * LIVENESS_BATCH_SIZE);
+		state->batch_counts = g_new0(gint, num_filters);
+	}
+	state->parallel = NULL;
+	state->visited = liveness_visited_new ();
+	state->classes = liveness_classes_new ();
+
+	if (liveness_max_workers == -1)
+		liveness_max_workers = CLAMP (mono_cpu_count (), 1, LIVENESS_MAX_WORKERS);
+	if (liveness_max_workers > 1)
+		liveness_start_workers (state, filter, max_count, liveness_max_workers);
+
+	return state;
+}
+
+LivenessState* mono_unity_liveness_allocate_struct (MonoClass* filter, guint max_count, register_object_callback callback, void* callback_userdata)
+{
+	LivenessState* state = liveness_allocate_struct (filter, NULL, 0, max_count, callback_userdata);
 	state->filter_callback = callback;
+	return state;
+}
+
+/**
+ * mono_unity_liveness_allocate_struct_multi:
+ *
+ * Like mono_unity_liveness_allocate_struct (), but the reachable objects are bucketed by
+ * each of the @num_filters classes in @filters during the same traversal. A NULL entry matches
+ * all objects. The objects deriving from filters [i] are delivered to @callback in batches,
+ * with i as the filter index.
+ */
+LivenessState* mono_unity_liveness_allocate_struct_multi (MonoClass** filters, gint num_filters, guint max_count, register_filtered_objects_callback callback, void* callback_userdata)
+{
+	LivenessState* state;
 
+	g_assert (filters && num_filters > 0);
+	state = liveness_allocate_struct (NULL, filters, num_filters, max_count, callback_userdata);
+	state->filtered_callback = callback;
 	return state;
 }
 
 void mono_unity_liveness_finalize (LivenessState* state)
 {
-	int i;
-	for (i = 0; i < state->all_objects->len; i++)
-	{
-		MonoObject* object = g_ptr_array_index(state->all_objects,i);
-		CLEAR_OBJ(object);
-	}
+	liveness_visited_clear (state->visited);
 }
 
 void mono_unity_liveness_free_struct (LivenessState* state)
 {
 	//cleanup the liveness_state
+	if (state->parallel)
+		liveness_stop_workers (state);
+	liveness_visited_free (state->visited);
+	liveness_classes_free (state->classes);
+	g_free(state->filters);
+	g_free(state->batches);
+	g_free(state->batch_counts);
 	array_destroy(state->all_objects);
 	array_destroy(state->process_array);
 	g_free(state);
@@ -610,6 +1455,14 @@ LivenessState* mono_unity_liveness_calculation_begin (MonoClass* filter, guint m
 	return state;
 }
 
+LivenessState* mono_unity_liveness_calculation_begin_multi (MonoClass** filters, gint num_filters, guint max_count, register_filtered_objects_callback callback, void* callback_userdata)
+{
+	LivenessState* state = mono_unity_liveness_allocate_struct_multi (filters, num_filters, max_count, callback, callback_userdata);
+	mono_unity_liveness_stop_gc_world ();
+	// no allocations can happen beyond this point
+	return state;
+}
+
 void mono_unity_liveness_calculation_end (LivenessState* state)
 {
 	mono_unity_liveness_finalize(state);
@@ -100,6 +100,9 @@ unsigned mono_unity_get_all_classes_with_name_case (MonoImage *image, const char
 	/* (yoinked from icall.c) we start the count from 1 because we skip the special type <Module> */
 	for (i = 1; i < tdef->rows; ++i)
 	{
+		/* Compare the name in the metadata first, to avoid creating the classes which don't match */
+		if (0 != mono_utf8_strcasecmp (mono_metadata_string_heap (image, mono_metadata_decode_row_col (tdef, i, MONO_TYPEDEF_NAME)), name))
+			continue;
 		klass = mono_class_get (image, (i + 1) | MONO_TOKEN_TYPE_DEF);
 		if (klass && klass->name && 0 == mono_utf8_strcasecmp (klass->name, name))
 		{
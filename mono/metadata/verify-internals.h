@@ -31,6 +31,10 @@ gboolean mono_verifier_verify_class (MonoClass *klass);
 
 GSList* mono_method_verify_with_current_settings (MonoMethod *method, gboolean skip_visibility, gboolean is_fulltrust);
 
+gboolean mono_verifier_cache_tables_verified (MonoImage *image);
+void mono_verifier_cache_add_tables (MonoImage *image);
+void mono_verifier_cache_close (MonoImage *image);
+
 gboolean mono_verifier_verify_pe_data (MonoImage *image, GSList **error_list);
 gboolean mono_verifier_verify_cli_data (MonoImage *image, GSList **error_list);
 gboolean mono_verifier_verify_table_data (MonoImage *image, GSList **error_list);
@@ -31,6 +31,9 @@
 #include <mono/metadata/class-internals.h>
 #include <mono/utils/mono-counters.h>
 #include <mono/utils/monobitset.h>
+#include <mono/utils/mono-digest.h>
+#include <mono/utils/mono-lazy-init.h>
+#include <mono/utils/mono-os-mutex.h>
 #include <string.h>
 #include <ctype.h>
 
@@ -6075,13 +6078,258 @@ mono_verifier_is_class_full_trust (MonoClass *klass)
 	return verifier_mode < MONO_VERIFIER_MODE_VERIFIABLE || trusted_location || klass->image == mono_defaults.corlib;
 }
 
+/*
+ * On-disk cache of verification results, enabled by setting MONO_VERIFY_CACHE
+ * to a directory.
+ *
+ * Each image gets a file named after its GUID and the MD5 of its contents,
+ * which starts with a header describing the verifier settings, followed by
+ * one line per result: 'T' when the metadata tables were verified, and
+ * 'M <token> <level>' for each method which verified without errors at the
+ * given level. Results are appended as they are produced and the file is
+ * reset when the header doesn't match, so the cache never needs to be written
+ * out at shutdown.
+ *
+ * Only the contents of the image itself and of corlib are part of the key, a
+ * change to another dependency which makes a cached method unverifiable
+ * requires clearing the cache directory.
+ */
+
+#define VERIFIER_CACHE_VERSION 1
+
+typedef struct {
+	/* Method token -> mask of the levels it verified at */
+	GHashTable *methods;
+	FILE *log;
+	gboolean tables_verified;
+} VerifierCache;
+
+static mono_lazy_init_t verifier_cache_status = MONO_LAZY_INIT_STATUS_NOT_INITIALIZED;
+static mono_mutex_t verifier_cache_mutex;
+static char *verifier_cache_dir;
+
+static void
+verifier_cache_initialize (void)
+{
+	const char *dir = g_getenv ("MONO_VERIFY_CACHE");
+
+	mono_os_mutex_init (&verifier_cache_mutex);
+	if (dir && *dir)
+		verifier_cache_dir = g_strdup (dir);
+}
+
+/* The levels passed to mono_method_verify () by mono_method_verify_with_current_settings () */
+static int
+verifier_cache_level_bit (int level)
+{
+	return 1 << ((level & (MONO_VERIFY_FAIL_FAST | MONO_VERIFY_NON_STRICT | MONO_VERIFY_SKIP_VISIBILITY)) >> 4);
+}
+
+static char*
+verifier_cache_header (void)
+{
+	return g_strdup_printf ("mono-verify-cache %d %d %d %d %s\n", VERIFIER_CACHE_VERSION, verifier_mode, verify_all,
+		mono_security_core_clr_enabled (), mono_defaults.corlib ? mono_defaults.corlib->guid : "-");
+}
+
+static void
+verifier_cache_load (VerifierCache *cache, FILE *f)
+{
+	char line [256];
+	guint32 token;
+	int level;
+
+	while (fgets (line, sizeof (line), f)) {
+		if (line [0] == 'T') {
+			cache->tables_verified = TRUE;
+		} else if (sscanf (line, "M %x %d", &token, &level) == 2) {
+			int mask = GPOINTER_TO_INT (g_hash_table_lookup (cache->methods, GUINT_TO_POINTER (token)));
+
+			g_hash_table_insert (cache->methods, GUINT_TO_POINTER (token), GINT_TO_POINTER (mask | verifier_cache_level_bit (level)));
+		}
+	}
+}
+
+/*
+ * Return the cache of IMAGE, or NULL if the cache is disabled or not usable
+ * for it.
+ * LOCKING: Assumes verifier_cache_mutex is held.
+ */
+static VerifierCache*
+verifier_cache_get (MonoImage *image)
+{
+	VerifierCache *cache;
+	guchar digest [16];
+	char hash [33];
+	char *fname, *path, *header;
+	char line [256];
+	FILE *f;
+	int i;
+
+	if (image->verify_cache)
+		return image->verify_cache == image ? NULL : (VerifierCache *)image->verify_cache;
+
+	/* Mark the image as not cached in case we fail below */
+	image->verify_cache = image;
+	if (!verifier_cache_dir || image_is_dynamic (image) || !image->raw_data || !image->guid)
+		return NULL;
+
+	mono_md5_get_digest ((const guchar *)image->raw_data, image->raw_data_len, digest);
+	for (i = 0; i < 16; ++i)
+		sprintf (hash + i * 2, "%02x", digest [i]);
+	fname = g_strdup_printf ("%s-%s", image->guid, hash);
+	path = g_build_filename (verifier_cache_dir, fname, NULL);
+	g_free (fname);
+
+	cache = g_new0 (VerifierCache, 1);
+	cache->methods = g_hash_table_new (NULL, NULL);
+	header = verifier_cache_header ();
+
+	f = fopen (path, "r");
+	if (f) {
+		if (fgets (line, sizeof (line), f) && !strcmp (line, header))
+			verifier_cache_load (cache, f);
+		fclose (f);
+	}
+
+	if (cache->tables_verified || g_hash_table_size (cache->methods)) {
+		cache->log = fopen (path, "a");
+	} else {
+		/* A new file, or one written with other settings */
+		cache->log = fopen (path, "w");
+		if (cache->log) {
+			fputs (header, cache->log);
+			fflush (cache->log);
+		}
+	}
+	g_free (header);
+	g_free (path);
+
+	image->verify_cache = cache;
+	return cache;
+}
+
+static gboolean
+verifier_cache_lookup_method (MonoMethod *method, int level)
+{
+	VerifierCache *cache;
+	gboolean res = FALSE;
+
+	if (method->wrapper_type != MONO_WRAPPER_NONE || method->is_inflated || !method->token)
+		return FALSE;
+
+	mono_lazy_initialize (&verifier_cache_status, verifier_cache_initialize);
+	if (!verifier_cache_dir)
+		return FALSE;
+
+	mono_os_mutex_lock (&verifier_cache_mutex);
+	cache = verifier_cache_get (method->klass->image);
+	if (cache)
+		res = (GPOINTER_TO_INT (g_hash_table_lookup (cache->methods, GUINT_TO_POINTER (method->token))) & verifier_cache_level_bit (level)) != 0;
+	mono_os_mutex_unlock (&verifier_cache_mutex);
+	return res;
+}
+
+static void
+verifier_cache_add_method (MonoMethod *method, int level)
+{
+	VerifierCache *cache;
+
+	if (method->wrapper_type != MONO_WRAPPER_NONE || method->is_inflated || !method->token || !verifier_cache_dir)
+		return;
+
+	mono_os_mutex_lock (&verifier_cache_mutex);
+	cache = verifier_cache_get (method->klass->image);
+	if (cache) {
+		int mask = GPOINTER_TO_INT (g_hash_table_lookup (cache->methods, GUINT_TO_POINTER (method->token)));
+
+		g_hash_table_insert (cache->methods, GUINT_TO_POINTER (method->token), GINT_TO_POINTER (mask | verifier_cache_level_bit (level)));
+		if (cache->log) {
+			fprintf (cache->log, "M %x %d\n", method->token, level);
+			fflush (cache->log);
+		}
+	}
+	mono_os_mutex_unlock (&verifier_cache_mutex);
+}
+
+/*
+ * mono_verifier_cache_tables_verified:
+ *
+ *   Return whenever the metadata tables of IMAGE were verified by a previous run.
+ */
+gboolean
+mono_verifier_cache_tables_verified (MonoImage *image)
+{
+	VerifierCache *cache;
+	gboolean res = FALSE;
+
+	mono_lazy_initialize (&verifier_cache_status, verifier_cache_initialize);
+	if (!verifier_cache_dir)
+		return FALSE;
+
+	mono_os_mutex_lock (&verifier_cache_mutex);
+	cache = verifier_cache_get (image);
+	if (cache)
+		res = cache->tables_verified;
+	mono_os_mutex_unlock (&verifier_cache_mutex);
+	return res;
+}
+
+void
+mono_verifier_cache_add_tables (MonoImage *image)
+{
+	VerifierCache *cache;
+
+	if (!verifier_cache_dir)
+		return;
+
+	mono_os_mutex_lock (&verifier_cache_mutex);
+	cache = verifier_cache_get (image);
+	if (cache && !cache->tables_verified) {
+		cache->tables_verified = TRUE;
+		if (cache->log) {
+			fputs ("T\n", cache->log);
+			fflush (cache->log);
+		}
+	}
+	mono_os_mutex_unlock (&verifier_cache_mutex);
+}
+
+/*
+ * mono_verifier_cache_close:
+ *
+ *   Free the verification cache of IMAGE, called when the image is closed.
+ */
+void
+mono_verifier_cache_close (MonoImage *image)
+{
+	VerifierCache *cache = (VerifierCache *)image->verify_cache;
+
+	image->verify_cache = NULL;
+	if (!cache || cache == (VerifierCache *)image)
+		return;
+
+	if (cache->log)
+		fclose (cache->log);
+	g_hash_table_destroy (cache->methods);
+	g_free (cache);
+}
+
 GSList*
 mono_method_verify_with_current_settings (MonoMethod *method, gboolean skip_visibility, gboolean is_fulltrust)
 {
-	return mono_method_verify (method, 
-			(verifier_mode != MONO_VERIFIER_MODE_STRICT ? MONO_VERIFY_NON_STRICT: 0)
+	int level = (verifier_mode != MONO_VERIFIER_MODE_STRICT ? MONO_VERIFY_NON_STRICT: 0)
 			| (!is_fulltrust && !mono_verifier_is_method_full_trust (method) ? MONO_VERIFY_FAIL_FAST : 0)
-			| (skip_visibility ? MONO_VERIFY_SKIP_VISIBILITY : 0));
+			| (skip_visibility ? MONO_VERIFY_SKIP_VISIBILITY : 0);
+	GSList *res;
+
+	if (verifier_cache_lookup_method (method, level))
+		return NULL;
+
+	res = mono_method_verify (method, level);
+	if (!res)
+		verifier_cache_add_method (method, level);
+	return res;
 }
 
 static int
@@ -6374,6 +6622,23 @@ mono_method_verify_with_current_settings (MonoMethod *method, gboolean skip_visi
 	return NULL;
 }
 
+gboolean
+mono_verifier_cache_tables_verified (MonoImage *image)
+{
+	/* The verifier was disabled at compile time */
+	return FALSE;
+}
+
+void
+mono_verifier_cache_add_tables (MonoImage *image)
+{
+}
+
+void
+mono_verifier_cache_close (MonoImage *image)
+{
+}
+
 gboolean
 mono_verifier_is_class_full_trust (MonoClass *klass)
 {
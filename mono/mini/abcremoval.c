@@ -18,7 +18,10 @@
 
 #ifndef DISABLE_JIT
 
+#include <mono/metadata/abi-details.h>
+
 #include "abcremoval.h"
+#include "ir-emit.h"
 
 #if SIZEOF_VOID_P == 8
 #define OP_PCONST OP_I8CONST
@@ -307,6 +310,20 @@ get_relation_from_ins (MonoVariableRelationsEvaluationArea *area, MonoInst *ins,
 		value->value.variable.delta = 0;
 		value_kind = MONO_UNSIGNED_INTEGER_VALUE_SIZE_4;
 		break;
+	case OP_IAND_IMM:
+		/* Masking with a non-negative constant gives 0 <= x <= mask */
+		if (ins->inst_imm >= 0) {
+			result->relation = MONO_LE_RELATION;
+			value->type = MONO_CONSTANT_SUMMARIZED_VALUE;
+			value->value.constant.value = ins->inst_imm;
+			value_kind = MONO_UNSIGNED_INTEGER_VALUE_SIZE_4;
+		}
+		break;
+	case OP_ISHR_UN_IMM:
+		/* Shifting in a zero bit gives a non-negative result */
+		if ((ins->inst_imm & 0x1f) > 0)
+			value_kind = MONO_UNSIGNED_INTEGER_VALUE_SIZE_4;
+		break;
 	case OP_LDLEN:
 		/*
 		 * We represent arrays by their length, so r1<-ldlen r2 is stored
@@ -1380,4 +1397,751 @@ mono_perform_abc_removal (MonoCompile *cfg)
 	process_block (cfg, cfg->bblocks [0], &area);
 }
 
+/*
+ * Loop versioning
+ *
+ * The relation graph can't prove accesses whose range is only known at runtime,
+ * like a [i + 1] in a loop running up to a.Length - 1, or b [j] with j stepping
+ * together with the loop counter. mono_abc_version_loops () handles counted loops
+ *
+ *   for (; i < n; ++i, ++j)
+ *       ... a [i + c] ... b [j] ...
+ *
+ * where the arrays and the bound are not changed by the loop, and every induction
+ * variable is incremented once per iteration by the latch. The indexes of each
+ * access cover a range which is known on loop entry, so a single check in front
+ * of the loop selects between a copy of the loop without these bounds checks and
+ * the original loop, which keeps them, and handles null arrays and exceptions.
+ * It runs before the conversion to SSA form, like the vectorizer.
+ */
+
+static gboolean
+abc_loop_contains (MonoAbcLoop *loop, MonoBasicBlock *bb)
+{
+	int i;
+
+	for (i = 0; i < loop->nbblocks; ++i)
+		if (loop->bblocks [i] == bb)
+			return TRUE;
+	return FALSE;
+}
+
+static inline gboolean
+abc_loop_is_var (MonoAbcLoop *loop, int vreg)
+{
+	return vreg >= 0 && vreg < loop->nvregs && get_vreg_to_inst (loop->cfg, vreg) != NULL;
+}
+
+static gboolean
+abc_loop_is_invariant_var (MonoAbcLoop *loop, int vreg)
+{
+	if (!abc_loop_is_var (loop, vreg) || loop->defs [vreg])
+		return FALSE;
+	return !(get_vreg_to_inst (loop->cfg, vreg)->flags & (MONO_INST_VOLATILE | MONO_INST_INDIRECT));
+}
+
+static gboolean
+abc_loop_is_invariant_array (MonoAbcLoop *loop, int vreg)
+{
+	return abc_loop_is_invariant_var (loop, vreg) && get_vreg_to_inst (loop->cfg, vreg)->type == STACK_OBJ;
+}
+
+static inline gboolean
+abc_loop_is_iv (MonoAbcLoop *loop, int vreg)
+{
+	return abc_loop_is_var (loop, vreg) && loop->iv_inc [vreg];
+}
+
+static void
+abc_loop_add_array (MonoAbcLoop *loop, int vreg)
+{
+	if (!g_slist_find (loop->arrays, GINT_TO_POINTER (vreg)))
+		loop->arrays = g_slist_append_mempool (loop->cfg->mempool, loop->arrays, GINT_TO_POINTER (vreg));
+}
+
+/*
+ * Whenever the vreg in the register bank BANK can be used in a copy of the loop.
+ * Local vregs are renamed, which is only done for the integer and float banks.
+ */
+static gboolean
+abc_loop_can_rename (MonoAbcLoop *loop, int vreg, char bank)
+{
+	if (vreg < 0 || abc_loop_is_var (loop, vreg))
+		return TRUE;
+	if (bank == 'f')
+		return vreg >= MONO_MAX_FREGS;
+#if SIZEOF_REGISTER == 8
+	if (bank == 'l')
+		return vreg >= MONO_MAX_IREGS;
+#endif
+	return bank == 'i' && vreg >= MONO_MAX_IREGS;
+}
+
+static gboolean
+abc_loop_can_clone (MonoAbcLoop *loop, MonoInst *ins)
+{
+	const char *spec = INS_INFO (ins->opcode);
+
+	if (MONO_IS_CALL (ins) || MONO_IS_JUMP_TABLE (ins))
+		return FALSE;
+
+	switch (ins->opcode) {
+	case OP_DYN_CALL:
+	case OP_OUTARG_VT:
+	case OP_OUTARG_VTRETADDR:
+	case OP_LOCALLOC:
+	case OP_LOCALLOC_IMM:
+	case OP_SWITCH:
+	case OP_BR_REG:
+	case OP_JMP:
+	case OP_CALL_HANDLER:
+	case OP_START_HANDLER:
+	case OP_ENDFILTER:
+	case OP_ENDFINALLY:
+	case OP_SEQ_POINT:
+		return FALSE;
+	default:
+		break;
+	}
+
+	if (spec [MONO_INST_DEST] != ' ' && !abc_loop_can_rename (loop, ins->dreg, spec [MONO_INST_DEST]))
+		return FALSE;
+	if (spec [MONO_INST_SRC1] != ' ' && !abc_loop_can_rename (loop, ins->sreg1, spec [MONO_INST_SRC1]))
+		return FALSE;
+	if (spec [MONO_INST_SRC2] != ' ' && !abc_loop_can_rename (loop, ins->sreg2, spec [MONO_INST_SRC2]))
+		return FALSE;
+	if (spec [MONO_INST_SRC3] != ' ' && !abc_loop_can_rename (loop, ins->sreg3, spec [MONO_INST_SRC3]))
+		return FALSE;
+	return TRUE;
+}
+
+/*
+ * Whenever the local vreg VREG of the header holds a value computed from loop
+ * invariant values, which can be recomputed in front of the loop.
+ */
+static gboolean
+abc_loop_is_invariant_bound (MonoAbcLoop *loop, int vreg, int depth)
+{
+	MonoInst *def;
+
+	if (abc_loop_is_var (loop, vreg))
+		return abc_loop_is_invariant_var (loop, vreg) && get_vreg_to_inst (loop->cfg, vreg)->type == STACK_I4;
+	if (vreg < 0 || vreg >= loop->nvregs || depth > 8)
+		return FALSE;
+	def = loop->bound_defs [vreg];
+	if (!def)
+		return FALSE;
+
+	switch (def->opcode) {
+	case OP_ICONST:
+		return TRUE;
+	case OP_MOVE:
+	case OP_IADD_IMM:
+	case OP_ISUB_IMM:
+		return abc_loop_is_invariant_bound (loop, def->sreg1, depth + 1);
+	case OP_LDLEN:
+		if (!abc_loop_is_invariant_array (loop, def->sreg1))
+			return FALSE;
+		abc_loop_add_array (loop, def->sreg1);
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static inline void
+abc_loop_set_affine (MonoAbcLoop *loop, int vreg, int iv, int offset, gboolean extended)
+{
+	/* Keep the offsets small so computing the range can't overflow */
+	if (offset < -0x10000 || offset > 0x10000)
+		iv = -1;
+	loop->aff_iv [vreg] = iv;
+	loop->aff_offset [vreg] = offset;
+	loop->aff_extended [vreg] = extended;
+}
+
+/*
+ * Compute which local vregs of BB hold an induction variable plus a constant,
+ * and collect the bounds checks of the accesses indexed by them. INCREMENTED
+ * tracks the induction variables already incremented by the latch.
+ */
+static void
+abc_loop_process_bblock (MonoAbcLoop *loop, MonoBasicBlock *bb, gboolean *incremented)
+{
+	MonoInst *ins;
+
+	for (ins = bb->code; ins; ins = ins->next) {
+		const char *spec = INS_INFO (ins->opcode);
+		int dreg = ins->dreg;
+		int src = ins->sreg1;
+
+		if (spec [MONO_INST_DEST] != ' ' && !MONO_IS_STORE_MEMBASE (ins) && !MONO_IS_STORE_MEMINDEX (ins) && dreg >= 0 && dreg < loop->nvregs && !abc_loop_is_var (loop, dreg)) {
+			loop->aff_iv [dreg] = -1;
+			loop->array_src [dreg] = -1;
+
+			switch (ins->opcode) {
+			case OP_IADD_IMM:
+			case OP_ISUB_IMM: {
+				int delta = ins->opcode == OP_IADD_IMM ? ins->inst_imm : -ins->inst_imm;
+
+				if (abc_loop_is_iv (loop, src))
+					abc_loop_set_affine (loop, dreg, src, delta + (incremented [src] ? 1 : 0), FALSE);
+				else if (src >= 0 && src < loop->nvregs && !abc_loop_is_var (loop, src) && loop->aff_iv [src] != -1 && !loop->aff_extended [src])
+					abc_loop_set_affine (loop, dreg, loop->aff_iv [src], loop->aff_offset [src] + delta, FALSE);
+				break;
+			}
+			case OP_MOVE:
+			case OP_SEXT_I4:
+				if (abc_loop_is_iv (loop, src))
+					abc_loop_set_affine (loop, dreg, src, incremented [src] ? 1 : 0, ins->opcode == OP_SEXT_I4);
+				else if (src >= 0 && src < loop->nvregs && !abc_loop_is_var (loop, src) && loop->aff_iv [src] != -1)
+					abc_loop_set_affine (loop, dreg, loop->aff_iv [src], loop->aff_offset [src], loop->aff_extended [src] || ins->opcode == OP_SEXT_I4);
+				if (ins->opcode == OP_MOVE) {
+					if (abc_loop_is_invariant_array (loop, src))
+						loop->array_src [dreg] = src;
+					else if (src >= 0 && src < loop->nvregs && !abc_loop_is_var (loop, src))
+						loop->array_src [dreg] = loop->array_src [src];
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
+		/* The header also runs once more with the final value of the induction variables */
+		if (ins->opcode == OP_BOUNDS_CHECK && bb != loop->header && ins->inst_imm == MONO_STRUCT_OFFSET (MonoArray, max_length) && loop->naccesses < MONO_ABC_LOOP_MAX_ACCESSES) {
+			int array = -1, iv = -1, offset = 0, i;
+
+			if (abc_loop_is_invariant_array (loop, ins->sreg1))
+				array = ins->sreg1;
+			else if (ins->sreg1 >= 0 && ins->sreg1 < loop->nvregs && !abc_loop_is_var (loop, ins->sreg1))
+				array = loop->array_src [ins->sreg1];
+
+			if (abc_loop_is_iv (loop, ins->sreg2)) {
+				iv = ins->sreg2;
+				offset = incremented [iv] ? 1 : 0;
+			} else if (ins->sreg2 >= 0 && ins->sreg2 < loop->nvregs && !abc_loop_is_var (loop, ins->sreg2)) {
+				iv = loop->aff_iv [ins->sreg2];
+				offset = loop->aff_offset [ins->sreg2];
+			}
+
+			if (array != -1 && iv != -1) {
+				for (i = 0; i < loop->naccesses; ++i) {
+					if (loop->accesses [i].array == array && loop->accesses [i].iv == iv && loop->accesses [i].offset == offset)
+						break;
+				}
+				if (i == loop->naccesses) {
+					loop->accesses [i].array = array;
+					loop->accesses [i].iv = iv;
+					loop->accesses [i].offset = offset;
+					loop->naccesses ++;
+					abc_loop_add_array (loop, array);
+				}
+				loop->checks = g_slist_prepend_mempool (loop->cfg->mempool, loop->checks, ins);
+			}
+		}
+
+		if (bb == loop->latch && abc_loop_is_var (loop, dreg) && loop->iv_inc [dreg] == ins)
+			incremented [dreg] = TRUE;
+	}
+}
+
+static MonoAbcLoop*
+abc_analyze_loop (MonoCompile *cfg, MonoBasicBlock *header)
+{
+	MonoAbcLoop *loop;
+	MonoBasicBlock *bb, *latch, *preheader, *body;
+	MonoInst *ins, *branch, *cmp, *var;
+	gboolean *incremented;
+	int i, ninstrs;
+
+	if (g_list_length (header->loop_blocks) > MONO_ABC_LOOP_MAX_BBLOCKS)
+		return NULL;
+
+	loop = (MonoAbcLoop *)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoAbcLoop));
+	loop->cfg = cfg;
+	loop->header = header;
+	loop->nvregs = cfg->next_vreg;
+	/* Keep the layout order of the bblocks in the copy */
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		if (!g_list_find (header->loop_blocks, bb))
+			continue;
+		if (bb->region != -1 || (bb->flags & (BB_EXCEPTION_HANDLER | BB_INDIRECT_JUMP_TARGET)) || bb->try_start)
+			return NULL;
+		loop->bblocks [loop->nbblocks ++] = bb;
+	}
+
+	/* A single preheader and a single latch */
+	if (header->in_count != 2 || header->out_count != 2)
+		return NULL;
+	if (abc_loop_contains (loop, header->in_bb [0]) && !abc_loop_contains (loop, header->in_bb [1])) {
+		latch = header->in_bb [0];
+		preheader = header->in_bb [1];
+	} else if (abc_loop_contains (loop, header->in_bb [1]) && !abc_loop_contains (loop, header->in_bb [0])) {
+		latch = header->in_bb [1];
+		preheader = header->in_bb [0];
+	} else {
+		return NULL;
+	}
+	if (latch == header || latch->out_count != 1)
+		return NULL;
+	if (latch->last_ins && MONO_IS_BRANCH_OP (latch->last_ins)) {
+		if (latch->last_ins->opcode != OP_BR)
+			return NULL;
+	} else if (latch->next_bb != header) {
+		return NULL;
+	}
+	if (preheader == cfg->bb_entry || preheader->out_count != 1 || preheader->region != header->region)
+		return NULL;
+	if (preheader->last_ins && MONO_IS_BRANCH_OP (preheader->last_ins)) {
+		if (preheader->last_ins->opcode != OP_BR)
+			return NULL;
+	} else if (preheader->next_bb != header) {
+		return NULL;
+	}
+	loop->latch = latch;
+	loop->preheader = preheader;
+
+	/* The loop condition, i < n */
+	branch = header->last_ins;
+	if (!branch || (branch->opcode != OP_IBLT && branch->opcode != OP_IBGE) || !branch->inst_true_bb || !branch->inst_false_bb)
+		return NULL;
+	cmp = branch->prev;
+	if (!cmp || (cmp->opcode != OP_ICOMPARE && cmp->opcode != OP_ICOMPARE_IMM))
+		return NULL;
+	body = branch->opcode == OP_IBLT ? branch->inst_true_bb : branch->inst_false_bb;
+	if (!abc_loop_contains (loop, body) || abc_loop_contains (loop, branch->opcode == OP_IBLT ? branch->inst_false_bb : branch->inst_true_bb))
+		return NULL;
+
+	loop->defs = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * loop->nvregs);
+	loop->iv_inc = (MonoInst **)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoInst*) * loop->nvregs);
+	loop->aff_iv = (int *)mono_mempool_alloc (cfg->mempool, sizeof (int) * loop->nvregs);
+	loop->aff_offset = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * loop->nvregs);
+	loop->aff_extended = (gboolean *)mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * loop->nvregs);
+	loop->array_src = (int *)mono_mempool_alloc (cfg->mempool, sizeof (int) * loop->nvregs);
+	loop->bound_defs = (MonoInst **)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoInst*) * loop->nvregs);
+	incremented = (gboolean *)mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * loop->nvregs);
+	for (i = 0; i < loop->nvregs; ++i)
+		loop->aff_iv [i] = loop->array_src [i] = -1;
+
+	ninstrs = 0;
+	for (i = 0; i < loop->nbblocks; ++i) {
+		for (ins = loop->bblocks [i]->code; ins; ins = ins->next) {
+			const char *spec = INS_INFO (ins->opcode);
+
+			if (++ninstrs > MONO_ABC_LOOP_MAX_INS || !abc_loop_can_clone (loop, ins))
+				return NULL;
+			if (spec [MONO_INST_DEST] != ' ' && !MONO_IS_STORE_MEMBASE (ins) && !MONO_IS_STORE_MEMINDEX (ins) && ins->dreg >= 0 && ins->dreg < loop->nvregs) {
+				loop->defs [ins->dreg] ++;
+				if (loop->bblocks [i] == header)
+					loop->bound_defs [ins->dreg] = ins;
+			}
+		}
+	}
+
+	/* The induction variables, incremented by one once per iteration by the latch */
+	for (ins = latch->code; ins; ins = ins->next) {
+		MonoInst *def;
+
+		if (!abc_loop_is_var (loop, ins->dreg) || loop->defs [ins->dreg] != 1)
+			continue;
+		var = get_vreg_to_inst (cfg, ins->dreg);
+		if (var->type != STACK_I4 || (var->flags & (MONO_INST_VOLATILE | MONO_INST_INDIRECT)))
+			continue;
+		if (ins->opcode == OP_IADD_IMM && ins->sreg1 == ins->dreg && ins->inst_imm == 1) {
+			loop->iv_inc [ins->dreg] = ins;
+		} else if (ins->opcode == OP_MOVE && !abc_loop_is_var (loop, ins->sreg1)) {
+			for (def = ins->prev; def; def = def->prev) {
+				if (def->dreg == ins->sreg1 && INS_INFO (def->opcode) [MONO_INST_DEST] != ' ')
+					break;
+			}
+			if (def && def->opcode == OP_IADD_IMM && def->sreg1 == ins->dreg && def->inst_imm == 1)
+				loop->iv_inc [ins->dreg] = ins;
+		}
+	}
+
+	/* The primary induction variable, possibly copied to a local vreg */
+	loop->iv = cmp->sreg1;
+	if (!abc_loop_is_var (loop, loop->iv) && loop->iv >= 0 && loop->iv < loop->nvregs && loop->bound_defs [loop->iv] && loop->bound_defs [loop->iv]->opcode == OP_MOVE)
+		loop->iv = loop->bound_defs [loop->iv]->sreg1;
+	if (!abc_loop_is_iv (loop, loop->iv))
+		return NULL;
+
+	if (cmp->opcode == OP_ICOMPARE_IMM) {
+		loop->bound_reg = -1;
+		loop->bound_imm = cmp->inst_imm;
+	} else {
+		if (!abc_loop_is_invariant_bound (loop, cmp->sreg2, 0))
+			return NULL;
+		loop->bound_reg = cmp->sreg2;
+	}
+
+	/* Process the latch last, the increments are only seen by its later instructions */
+	for (i = 0; i < loop->nbblocks; ++i) {
+		if (loop->bblocks [i] != latch)
+			abc_loop_process_bblock (loop, loop->bblocks [i], incremented);
+	}
+	abc_loop_process_bblock (loop, latch, incremented);
+
+	if (!loop->naccesses)
+		return NULL;
+	return loop;
+}
+
+static MonoBasicBlock*
+abc_new_bblock (MonoAbcLoop *loop, MonoBasicBlock **prev)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoBasicBlock *bb = (MonoBasicBlock *)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoBasicBlock));
+
+	bb->block_num = cfg->num_bblocks++;
+	bb->region = loop->header->region;
+	bb->real_offset = loop->header->real_offset;
+	bb->next_bb = (*prev)->next_bb;
+	(*prev)->next_bb = bb;
+	*prev = bb;
+	return bb;
+}
+
+static void
+abc_emit_br (MonoCompile *cfg, MonoBasicBlock *target)
+{
+	MonoInst *ins;
+
+	MONO_INST_NEW (cfg, ins, OP_BR);
+	ins->inst_target_bb = target;
+	MONO_ADD_INS (cfg->cbb, ins);
+	mono_link_bblock (cfg, cfg->cbb, target);
+}
+
+/*
+ * Branch to the original loop if the preceding compare succeeds, continue in a new
+ * bblock otherwise.
+ */
+static void
+abc_emit_slow_branch (MonoAbcLoop *loop, int opcode, MonoBasicBlock **prev)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoBasicBlock *next = abc_new_bblock (loop, prev);
+
+	MONO_EMIT_NEW_BRANCH_BLOCK2 (cfg, opcode, loop->header, next);
+	cfg->cbb = next;
+}
+
+static int
+abc_new_int_var (MonoCompile *cfg)
+{
+	return mono_compile_create_var (cfg, &mono_defaults.int32_class->byval_arg, OP_LOCAL)->dreg;
+}
+
+/* Recompute the loop bound VREG in front of the loop */
+static int
+abc_emit_bound (MonoAbcLoop *loop, int vreg)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *def, *ins;
+	int sreg, dreg;
+
+	if (abc_loop_is_var (loop, vreg))
+		return vreg;
+
+	def = loop->bound_defs [vreg];
+	switch (def->opcode) {
+	case OP_ICONST:
+		dreg = alloc_ireg (cfg);
+		MONO_EMIT_NEW_ICONST (cfg, dreg, def->inst_c0);
+		return dreg;
+	case OP_MOVE:
+		return abc_emit_bound (loop, def->sreg1);
+	case OP_IADD_IMM:
+	case OP_ISUB_IMM:
+		sreg = abc_emit_bound (loop, def->sreg1);
+		dreg = alloc_ireg (cfg);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, def->opcode, dreg, sreg, def->inst_imm);
+		return dreg;
+	case OP_LDLEN:
+		MONO_INST_NEW (cfg, ins, OP_LDLEN);
+		ins->dreg = alloc_ireg (cfg);
+		ins->sreg1 = def->sreg1;
+		ins->type = STACK_I4;
+		MONO_ADD_INS (cfg->cbb, ins);
+		cfg->cbb->has_array_access = TRUE;
+		return ins->dreg;
+	default:
+		g_assert_not_reached ();
+		return -1;
+	}
+}
+
+static inline int
+abc_clone_vreg (MonoAbcLoop *loop, int *map, int vreg, char bank)
+{
+	if (vreg < 0 || vreg >= loop->nvregs || abc_loop_is_var (loop, vreg))
+		return vreg;
+	if (bank == 'f' ? vreg < MONO_MAX_FREGS : vreg < MONO_MAX_IREGS)
+		return vreg;
+	if (map [vreg] == -1)
+		map [vreg] = bank == 'f' ? mono_alloc_freg (loop->cfg) : mono_alloc_ireg_copy (loop->cfg, vreg);
+	return map [vreg];
+}
+
+static MonoBasicBlock*
+abc_clone_target (MonoAbcLoop *loop, MonoBasicBlock **clones, MonoBasicBlock *target)
+{
+	int i;
+
+	for (i = 0; i < loop->nbblocks; ++i)
+		if (loop->bblocks [i] == target)
+			return clones [i];
+	return target;
+}
+
+static void
+abc_clone_bblock (MonoAbcLoop *loop, MonoBasicBlock **clones, int *map, int index)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoBasicBlock *bb = loop->bblocks [index];
+	MonoBasicBlock *clone = clones [index];
+	MonoInst *ins, *copy;
+	int i;
+
+	clone->cil_code = bb->cil_code;
+	clone->real_offset = bb->real_offset;
+	clone->has_array_access = bb->has_array_access;
+
+	for (ins = bb->code; ins; ins = ins->next) {
+		const char *spec = INS_INFO (ins->opcode);
+
+		/* The bounds checks proven by the check in front of the loop */
+		if (ins->opcode == OP_IL_SEQ_POINT || (ins->opcode == OP_BOUNDS_CHECK && g_slist_find (loop->checks, ins)))
+			continue;
+
+		MONO_INST_NEW (cfg, copy, ins->opcode);
+		*copy = *ins;
+		copy->next = copy->prev = NULL;
+		if (spec [MONO_INST_DEST] != ' ')
+			copy->dreg = abc_clone_vreg (loop, map, ins->dreg, spec [MONO_INST_DEST]);
+		if (spec [MONO_INST_SRC1] != ' ')
+			copy->sreg1 = abc_clone_vreg (loop, map, ins->sreg1, spec [MONO_INST_SRC1]);
+		if (spec [MONO_INST_SRC2] != ' ')
+			copy->sreg2 = abc_clone_vreg (loop, map, ins->sreg2, spec [MONO_INST_SRC2]);
+		if (spec [MONO_INST_SRC3] != ' ')
+			copy->sreg3 = abc_clone_vreg (loop, map, ins->sreg3, spec [MONO_INST_SRC3]);
+		if (MONO_IS_COND_BRANCH_OP (ins)) {
+			copy->inst_many_bb = (MonoBasicBlock **)mono_mempool_alloc (cfg->mempool, sizeof (gpointer) * 2);
+			copy->inst_true_bb = abc_clone_target (loop, clones, ins->inst_true_bb);
+			copy->inst_false_bb = abc_clone_target (loop, clones, ins->inst_false_bb);
+		} else if (ins->opcode == OP_BR) {
+			copy->inst_target_bb = abc_clone_target (loop, clones, ins->inst_target_bb);
+		}
+		MONO_ADD_INS (clone, copy);
+	}
+
+	/* The copy is not laid out next to the fall through target */
+	if (!(bb->last_ins && MONO_IS_BRANCH_OP (bb->last_ins)) && bb->out_count == 1) {
+		MONO_INST_NEW (cfg, copy, OP_BR);
+		copy->inst_target_bb = abc_clone_target (loop, clones, bb->out_bb [0]);
+		MONO_ADD_INS (clone, copy);
+	}
+
+	for (i = 0; i < bb->out_count; ++i)
+		mono_link_bblock (cfg, clone, abc_clone_target (loop, clones, bb->out_bb [i]));
+}
+
+/*
+ * abc_emit_versioned_loop:
+ *
+ *   Add a copy of LOOP without the bounds checks of its accesses between the
+ * preheader and the header:
+ *
+ *   if (a == null || b == null ...)
+ *       goto loop;
+ *   count = n - i;
+ *   if (i >= n)
+ *       goto loop;
+ *   for each access a [iv + c]:
+ *       start = iv + c;
+ *       if ((uint)start > (uint)a.Length || (uint)count > (uint)(a.Length - start))
+ *           goto loop;
+ *   <the copy of the loop>
+ * loop:
+ *   <the original loop>
+ *
+ * The accesses of the copy use the indexes start to start + count - 1, computed
+ * with the same wrap around as the loop itself. Both comparisons are unsigned:
+ * the first one ensures start is between 0 and a.Length, so the subtraction in
+ * the second one can't overflow.
+ */
+static void
+abc_emit_versioned_loop (MonoAbcLoop *loop)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoBasicBlock *prev, *first, *old_cbb;
+	MonoBasicBlock **clones;
+	GSList *l;
+	int *map, *len_regs, *start_regs, *room_regs;
+	int narrays = g_slist_length (loop->arrays);
+	int bound, count, i, j;
+
+	old_cbb = cfg->cbb;
+
+	/* mono_bb_ordering () sets num_bblocks to the number of reachable bblocks */
+	cfg->num_bblocks = MAX (cfg->num_bblocks, cfg->max_block_num);
+
+	prev = loop->preheader;
+	first = abc_new_bblock (loop, &prev);
+	cfg->cbb = first;
+
+	for (l = loop->arrays; l; l = l->next) {
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, GPOINTER_TO_INT (l->data), 0);
+		abc_emit_slow_branch (loop, OP_PBEQ, &prev);
+	}
+
+	if (loop->bound_reg != -1) {
+		bound = abc_new_int_var (cfg);
+		MONO_EMIT_NEW_UNALU (cfg, OP_MOVE, bound, abc_emit_bound (loop, loop->bound_reg));
+	} else {
+		bound = abc_new_int_var (cfg);
+		MONO_EMIT_NEW_ICONST (cfg, bound, loop->bound_imm);
+	}
+	count = abc_new_int_var (cfg);
+	MONO_EMIT_NEW_BIALU (cfg, OP_ISUB, count, bound, loop->iv);
+
+	len_regs = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * narrays);
+	for (l = loop->arrays, i = 0; l; l = l->next, ++i) {
+		MonoInst *ins;
+
+		MONO_INST_NEW (cfg, ins, OP_LDLEN);
+		ins->dreg = abc_new_int_var (cfg);
+		ins->sreg1 = GPOINTER_TO_INT (l->data);
+		ins->type = STACK_I4;
+		MONO_ADD_INS (cfg->cbb, ins);
+		cfg->cbb->has_array_access = TRUE;
+		len_regs [i] = ins->dreg;
+	}
+	cfg->flags |= MONO_CFG_HAS_ARRAY_ACCESS;
+
+	start_regs = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * loop->naccesses);
+	room_regs = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * loop->naccesses);
+	for (i = 0; i < loop->naccesses; ++i) {
+		MonoAbcLoopAccess *access = &loop->accesses [i];
+		int len = len_regs [g_slist_index (loop->arrays, GINT_TO_POINTER (access->array))];
+
+		if (access->offset) {
+			start_regs [i] = abc_new_int_var (cfg);
+			MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, start_regs [i], access->iv, access->offset);
+		} else {
+			start_regs [i] = access->iv;
+		}
+		room_regs [i] = abc_new_int_var (cfg);
+		MONO_EMIT_NEW_BIALU (cfg, OP_ISUB, room_regs [i], len, start_regs [i]);
+	}
+
+	MONO_EMIT_NEW_BIALU (cfg, OP_ICOMPARE, -1, loop->iv, bound);
+	abc_emit_slow_branch (loop, OP_IBGE, &prev);
+	for (i = 0; i < loop->naccesses; ++i) {
+		int len = len_regs [g_slist_index (loop->arrays, GINT_TO_POINTER (loop->accesses [i].array))];
+
+		MONO_EMIT_NEW_BIALU (cfg, OP_ICOMPARE, -1, start_regs [i], len);
+		abc_emit_slow_branch (loop, OP_IBGT_UN, &prev);
+		MONO_EMIT_NEW_BIALU (cfg, OP_ICOMPARE, -1, count, room_regs [i]);
+		abc_emit_slow_branch (loop, OP_IBGT_UN, &prev);
+	}
+
+	/* The copy of the loop */
+	clones = (MonoBasicBlock **)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoBasicBlock*) * loop->nbblocks);
+	for (i = 0; i < loop->nbblocks; ++i)
+		clones [i] = abc_new_bblock (loop, &prev);
+	map = (int *)mono_mempool_alloc (cfg->mempool, sizeof (int) * loop->nvregs);
+	for (j = 0; j < loop->nvregs; ++j)
+		map [j] = -1;
+	for (i = 0; i < loop->nbblocks; ++i)
+		abc_clone_bblock (loop, clones, map, i);
+
+	abc_emit_br (cfg, clones [0]);
+
+	/* Enter the checks from the preheader */
+	mono_unlink_bblock (cfg, loop->preheader, loop->header);
+	if (loop->preheader->last_ins && loop->preheader->last_ins->opcode == OP_BR) {
+		loop->preheader->last_ins->inst_target_bb = first;
+		mono_link_bblock (cfg, loop->preheader, first);
+	} else {
+		cfg->cbb = loop->preheader;
+		abc_emit_br (cfg, first);
+	}
+
+	cfg->cbb = old_cbb;
+}
+
+static gint
+abc_compare_loop_depth (gconstpointer a, gconstpointer b)
+{
+	const MonoBasicBlock *bb1 = (const MonoBasicBlock *)a;
+	const MonoBasicBlock *bb2 = (const MonoBasicBlock *)b;
+
+	return bb2->nesting - bb1->nesting;
+}
+
+/*
+ * mono_abc_version_loops:
+ *
+ *   Add copies without bounds checks of the counted array loops of the method,
+ * guarded by a check of the range of the accessed indexes. This requires the loop
+ * info computed by mono_compute_natural_loops (). Returns whenever the cfg changed,
+ * in which case the caller has to recompute the dominators and the loops.
+ */
+gboolean
+mono_abc_version_loops (MonoCompile *cfg)
+{
+	MonoBasicBlock *bb;
+	MonoAbcLoop *loop;
+	GSList *headers = NULL, *l;
+	MonoBasicBlock *old_cbb = cfg->cbb;
+	gboolean *touched;
+	gboolean changed = FALSE;
+	int nbblocks, i;
+
+	if (COMPILE_LLVM (cfg) || cfg->gsharedvt || cfg->gen_sdb_seq_points)
+		return FALSE;
+
+	nbblocks = 0;
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		nbblocks = MAX (nbblocks, bb->block_num + 1);
+		if (bb->loop_blocks && bb->loop_blocks->data == bb)
+			headers = g_slist_prepend (headers, bb);
+	}
+	/* Inner loops first, outer loops containing a versioned loop are skipped */
+	headers = g_slist_sort (headers, abc_compare_loop_depth);
+	touched = (gboolean *)mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * nbblocks);
+
+	for (l = headers; l; l = l->next) {
+		gboolean skip = FALSE;
+		bb = (MonoBasicBlock *)l->data;
+
+		loop = abc_analyze_loop (cfg, bb);
+		cfg->cbb = old_cbb;
+		if (!loop)
+			continue;
+
+		for (i = 0; i < loop->nbblocks; ++i)
+			skip |= loop->bblocks [i]->block_num >= nbblocks || touched [loop->bblocks [i]->block_num];
+		skip |= loop->preheader->block_num >= nbblocks || touched [loop->preheader->block_num];
+		if (skip)
+			continue;
+		for (i = 0; i < loop->nbblocks; ++i)
+			touched [loop->bblocks [i]->block_num] = TRUE;
+		touched [loop->preheader->block_num] = TRUE;
+
+		abc_emit_versioned_loop (loop);
+		cfg->stat_abc_versioned_loops++;
+		changed = TRUE;
+
+		if (cfg->verbose_level > 1)
+			printf ("VERSIONED LOOP BB%d: %d bounds checks removed\n", bb->block_num, g_slist_length (loop->checks));
+	}
+	g_slist_free (headers);
+
+	return changed;
+}
+
 #endif /* DISABLE_JIT */
@@ -347,5 +347,67 @@ typedef struct MonoAdditionalVariableRelationsForBB {
 	MonoAdditionalVariableRelation relation2;
 } MonoAdditionalVariableRelationsForBB;
 
+/**
+ * An array access inside a loop versioned by mono_abc_version_loops ().
+ * The index of the access in iteration k is the value of the induction
+ * variable on loop entry plus k plus offset.
+ * array: the variable holding the array, which is not changed by the loop
+ * iv: the induction variable
+ * offset: the constant offset from the induction variable
+ */
+typedef struct MonoAbcLoopAccess {
+	int array;
+	int iv;
+	int offset;
+} MonoAbcLoopAccess;
+
+#define MONO_ABC_LOOP_MAX_BBLOCKS 16
+#define MONO_ABC_LOOP_MAX_INS 256
+#define MONO_ABC_LOOP_MAX_ACCESSES 8
+
+/**
+ * A counted loop whose bounds checks can be hoisted by versioning.
+ * header: the bblock containing the test of the primary induction variable
+ * latch: the single bblock branching back to the header, it contains the
+ *        increments of all the induction variables
+ * preheader: the single bblock entering the loop from outside
+ * bblocks: the bblocks of the loop
+ * iv: the primary induction variable, compared against the bound in the header
+ * bound_reg: the vreg of the bound in the header, or -1 if it is bound_imm
+ * defs: the number of definitions of every vreg inside the loop
+ * iv_inc: for induction variables, the instruction incrementing them
+ * aff_iv/aff_offset: the induction variable and offset of local vregs which
+ *                    hold an induction variable plus a constant
+ * aff_extended: whenever the value was sign extended, so it can't take
+ *               further 32 bit arithmetic
+ * array_src: the loop invariant array variable copied to a local vreg
+ * bound_defs: the definitions of the local vregs computing the bound
+ * checks: the bounds checks proven by the accesses
+ * arrays: the arrays which have to be non-null for the fast loop to run
+ */
+typedef struct MonoAbcLoop {
+	MonoCompile *cfg;
+	MonoBasicBlock *header;
+	MonoBasicBlock *latch;
+	MonoBasicBlock *preheader;
+	MonoBasicBlock *bblocks [MONO_ABC_LOOP_MAX_BBLOCKS];
+	int nbblocks;
+	int nvregs;
+	int iv;
+	int bound_reg;
+	int bound_imm;
+	int *defs;
+	MonoInst **iv_inc;
+	int *aff_iv;
+	int *aff_offset;
+	gboolean *aff_extended;
+	int *array_src;
+	MonoInst **bound_defs;
+	GSList *checks;
+	GSList *arrays;
+	MonoAbcLoopAccess accesses [MONO_ABC_LOOP_MAX_ACCESSES];
+	int naccesses;
+} MonoAbcLoop;
+
 
 #endif /* __MONO_ABCREMOVAL_H__ */
@@ -54,6 +54,7 @@
 #include <mono/utils/mono-rand.h>
 #include <mono/utils/json.h>
 #include <mono/utils/mono-threads-coop.h>
+#include <mono/utils/mono-digest.h>
 
 #include "aot-compiler.h"
 #include "seq-points.h"
@@ -121,9 +122,11 @@ typedef struct MonoAotOptions {
 	gboolean no_direct_calls;
 	gboolean use_trampolines_page;
 	gboolean no_instances;
+	gboolean specialize_vt_collections;
 	gboolean gnu_asm;
 	gboolean llvm;
 	gboolean llvm_only;
+	int llvm_split;
 	int nthreads;
 	int ntrampolines;
 	int nrgctx_trampolines;
@@ -140,6 +143,8 @@ typedef struct MonoAotOptions {
 	char *instances_logfile_path;
 	char *logfile;
 	gboolean dump_json;
+	gboolean incremental;
+	char *dedup_include;
 #if defined(PLATFORM_IPHONE_XCOMP)
 	gboolean ficall;
 #endif 
@@ -162,6 +167,7 @@ typedef struct MonoAotStats {
 	int got_slot_types [MONO_PATCH_INFO_NUM];
 	int got_slot_info_sizes [MONO_PATCH_INFO_NUM];
 	int jit_time, gen_time, link_time;
+	int dedup_skipped, dedup_included;
 } MonoAotStats;
 
 typedef struct GotInfo {
@@ -267,6 +273,14 @@ typedef struct MonoAotCompile {
 	FILE *data_outfile;
 	int datafile_offset;
 	int gc_name_offset;
+	/* Maps MonoImage* -> hash table mapping the method names in its AOT profile to their order */
+	GHashTable *profile_data;
+	/* The number of entries at the start of method_order which were ordered by the profile */
+	int nprofiled_methods;
+	/* Whenever to leave dedupable methods to the dedup container */
+	gboolean dedup_skip;
+	/* Whenever this image is the dedup container */
+	gboolean dedup_container;
 } MonoAotCompile;
 
 typedef struct {
@@ -282,6 +296,13 @@ typedef struct {
 /* This points to the current acfg in LLVM mode */
 static MonoAotCompile *llvm_acfg;
 
+/*
+ * Methods skipped by the images compiled with dedup-include= so far, they are
+ * compiled into the dedup container instead.
+ */
+static GHashTable *dedup_methods;
+static gboolean dedup_container_compiled;
+
 #ifdef HAVE_ARRAY_ELEM_INIT
 #define MSGSTRFIELD(line) MSGSTRFIELD1(line)
 #define MSGSTRFIELD1(line) str##line
@@ -3148,6 +3169,8 @@ encode_method_ref (MonoAotCompile *acfg, MonoMethod *method, guint8 *buf, guint8
 				p += strlen (method->name) + 1;
 			} else if (info->subtype == WRAPPER_SUBTYPE_NATIVE_FUNC_AOT) {
 				encode_method_ref (acfg, info->d.managed_to_native.method, p, &p);
+			} else if (info->subtype == WRAPPER_SUBTYPE_NATIVE_SHARED) {
+				encode_signature (acfg, info->d.managed_to_native.sig, p, &p);
 			} else {
 				g_assert (info->subtype == WRAPPER_SUBTYPE_NONE || info->subtype == WRAPPER_SUBTYPE_PINVOKE);
 				encode_method_ref (acfg, info->d.managed_to_native.method, p, &p);
@@ -4129,6 +4152,13 @@ add_wrappers (MonoAotCompile *acfg)
 			(method->iflags & METHOD_IMPL_ATTRIBUTE_INTERNAL_CALL)) {
 			add_method (acfg, mono_marshal_get_native_wrapper (method, TRUE, TRUE));
 		}
+
+		/* JITted callers of pinvokes with a simple signature call a wrapper shared by signature */
+		if (method->flags & METHOD_ATTRIBUTE_PINVOKE_IMPL) {
+			m = mono_marshal_get_native_shared_wrapper (method);
+			if (m)
+				add_extra_method (acfg, m);
+		}
 	}
  
 	/* native-to-managed wrappers */
@@ -4493,8 +4523,10 @@ add_generic_class_with_depth (MonoAotCompile *acfg, MonoClass *klass, int depth,
 	/*
 	 * Use gsharedvt for generic collections with vtype arguments to avoid code blowup.
 	 * Enable this only for some classes since gsharedvt might not support all methods.
+	 * With specialize-vt-collections, the instances are compiled fully specialized instead,
+	 * trading code size for avoiding the gsharedvt in/out transitions on every call.
 	 */
-	if ((acfg->opts & MONO_OPT_GSHAREDVT) && klass->image == mono_defaults.corlib && klass->generic_class && klass->generic_class->context.class_inst && is_vt_inst (klass->generic_class->context.class_inst) &&
+	if ((acfg->opts & MONO_OPT_GSHAREDVT) && !acfg->aot_opts.specialize_vt_collections && klass->image == mono_defaults.corlib && klass->generic_class && klass->generic_class->context.class_inst && is_vt_inst (klass->generic_class->context.class_inst) &&
 		(!strcmp (klass->name, "Dictionary`2") || !strcmp (klass->name, "List`1") || !strcmp (klass->name, "ReadOnlyCollection`1")))
 		use_gsharedvt = TRUE;
 
@@ -6269,6 +6301,109 @@ emit_exception_debug_info (MonoAotCompile *acfg, MonoCompile *cfg, gboolean stor
 	g_free (buf);
 }
 
+typedef struct {
+	MonoClass *iface;
+	int method_index, slot;
+} ImtSlotEntry;
+
+/*
+ * emit_klass_imt_info:
+ *
+ *   Emit the interface methods implemented by KLASS grouped by their IMT slot, so the
+ * runtime can fill in one slot of the IMT of KLASS without computing the IMT slot of
+ * every interface method, see mono_aot_get_imt_slot_methods (). Return the offset of
+ * the info in the blob plus one, or 0 if it's not emitted.
+ */
+static guint32
+emit_klass_imt_info (MonoAotCompile *acfg, MonoClass *klass)
+{
+	GSList *slots [MONO_IMT_SIZE];
+	guint32 slot_offsets [MONO_IMT_SIZE];
+	ImtSlotEntry *entries;
+	GSList *l;
+	guint8 *p, *buf;
+	int i, j, n, nentries, buf_size, res;
+
+	if (MONO_CLASS_IS_INTERFACE (klass) || !klass->interface_offsets_count)
+		return 0;
+
+	nentries = 0;
+	for (i = 0; i < klass->interface_offsets_count; ++i) {
+		MonoClass *iface = klass->interfaces_packed [i];
+
+		/* The runtime needs to go through all interface methods in these cases */
+		if (mono_class_has_variant_generic_params (iface))
+			return 0;
+		mono_class_setup_methods (iface);
+		if (mono_class_has_failure (iface))
+			return 0;
+		for (j = 0; j < iface->method.count; ++j) {
+			if (iface->methods [j]->is_generic)
+				return 0;
+		}
+		nentries += iface->method.count;
+	}
+
+	/* Same as build_imt_slots () in object.c */
+	memset (slots, 0, sizeof (slots));
+	entries = g_new0 (ImtSlotEntry, nentries);
+	n = 0;
+	for (i = 0; i < klass->interface_offsets_count; ++i) {
+		MonoClass *iface = klass->interfaces_packed [i];
+		int slot = 0;
+
+		for (j = 0; j < iface->method.count; ++j) {
+			MonoMethod *method = iface->methods [j];
+			int imt_slot;
+
+			if (method->flags & METHOD_ATTRIBUTE_STATIC)
+				continue;
+			imt_slot = mono_method_get_imt_slot (method);
+			entries [n].iface = iface;
+			entries [n].method_index = j;
+			entries [n].slot = slot;
+			slots [imt_slot] = g_slist_prepend (slots [imt_slot], &entries [n]);
+			n ++;
+			slot ++;
+		}
+	}
+
+	for (i = 0; i < MONO_IMT_SIZE; ++i) {
+		slot_offsets [i] = 0;
+		if (!slots [i])
+			continue;
+		slots [i] = g_slist_reverse (slots [i]);
+
+		buf_size = 10240 + (g_slist_length (slots [i]) * 32);
+		p = buf = (guint8 *)g_malloc (buf_size);
+		encode_value (g_slist_length (slots [i]), p, &p);
+		for (l = slots [i]; l; l = l->next) {
+			ImtSlotEntry *entry = (ImtSlotEntry *)l->data;
+
+			encode_klass_ref (acfg, entry->iface, p, &p);
+			encode_value (entry->method_index, p, &p);
+			encode_value (entry->slot, p, &p);
+		}
+		g_assert (p - buf < buf_size);
+		acfg->stats.class_info_size += p - buf;
+		slot_offsets [i] = add_to_blob (acfg, buf, p - buf) + 1;
+		g_free (buf);
+		g_slist_free (slots [i]);
+	}
+	g_free (entries);
+
+	buf_size = MONO_IMT_SIZE * 5;
+	p = buf = (guint8 *)g_malloc (buf_size);
+	for (i = 0; i < MONO_IMT_SIZE; ++i)
+		encode_value (slot_offsets [i], p, &p);
+	g_assert (p - buf <= buf_size);
+	acfg->stats.class_info_size += p - buf;
+	res = add_to_blob (acfg, buf, p - buf);
+	g_free (buf);
+
+	return res + 1;
+}
+
 static guint32
 emit_klass_info (MonoAotCompile *acfg, guint32 token)
 {
@@ -6340,6 +6475,7 @@ emit_klass_info (MonoAotCompile *acfg, guint32 token)
 		encode_value (mono_class_data_size (klass), p, &p);
 		encode_value (klass->packing_size, p, &p);
 		encode_value (klass->min_align, p, &p);
+		encode_value (emit_klass_imt_info (acfg, klass), p, &p);
 
 		for (i = 0; i < klass->vtable_size; ++i) {
 			MonoMethod *cm = klass->vtable [i];
@@ -7116,6 +7252,10 @@ mono_aot_parse_options (const char *aot_options, MonoAotOptions *opts)
 			opts->mode = MONO_AOT_MODE_HYBRID;			
 		} else if (str_begins_with (arg, "threads=")) {
 			opts->nthreads = atoi (arg + strlen ("threads="));
+		} else if (str_begins_with (arg, "incremental")) {
+			opts->incremental = TRUE;
+		} else if (str_begins_with (arg, "dedup-include=")) {
+			opts->dedup_include = g_strdup (arg + strlen ("dedup-include="));
 		} else if (str_begins_with (arg, "static")) {
 			opts->static_link = TRUE;
 			opts->no_dlsym = TRUE;
@@ -7169,6 +7309,8 @@ mono_aot_parse_options (const char *aot_options, MonoAotOptions *opts)
 			opts->stats = TRUE;
 		} else if (str_begins_with (arg, "no-instances")) {
 			opts->no_instances = TRUE;
+		} else if (str_begins_with (arg, "specialize-vt-collections")) {
+			opts->specialize_vt_collections = TRUE;
 		} else if (str_begins_with (arg, "log-generics")) {
 			opts->log_generics = TRUE;
 		} else if (str_begins_with (arg, "log-instances=")) {
@@ -7180,6 +7322,8 @@ mono_aot_parse_options (const char *aot_options, MonoAotOptions *opts)
 			opts->logfile = g_strdup (arg + strlen ("internal-logfile="));
 		} else if (str_begins_with (arg, "mtriple=")) {
 			opts->mtriple = g_strdup (arg + strlen ("mtriple="));
+		} else if (str_begins_with (arg, "llvm-split=")) {
+			opts->llvm_split = atoi (arg + strlen ("llvm-split="));
 		} else if (str_begins_with (arg, "llvm-path=")) {
 			opts->llvm_path = clean_path (g_strdup (arg + strlen ("llvm-path=")));
 		} else if (!strcmp (arg, "llvm")) {
@@ -7204,6 +7348,7 @@ mono_aot_parse_options (const char *aot_options, MonoAotOptions *opts)
 			printf ("    outfile=\n");
 			printf ("    llvm-outfile=\n");
 			printf ("    llvm-path=\n");
+			printf ("    llvm-split=\n");
 			printf ("    temp-path=\n");
 			printf ("    save-temps\n");
 			printf ("    keep-temps\n");
@@ -7212,6 +7357,8 @@ mono_aot_parse_options (const char *aot_options, MonoAotOptions *opts)
 			printf ("    bind-to-runtime-version\n");
 			printf ("    full\n");
 			printf ("    threads=\n");
+			printf ("    incremental\n");
+			printf ("    dedup-include=\n");
 			printf ("    static\n");
 			printf ("    asmonly\n");
 			printf ("    asmwriter\n");
@@ -7228,6 +7375,7 @@ mono_aot_parse_options (const char *aot_options, MonoAotOptions *opts)
 			printf ("    gc-maps\n");
 			printf ("    print-skipped\n");
 			printf ("    no-instances\n");
+			printf ("    specialize-vt-collections\n");
 			printf ("    stats\n");
 			printf ("    dump\n");
 			printf ("    info\n");
@@ -7487,6 +7635,31 @@ mono_method_marked_as_wrapperless(MonoMethod* method);
  *   AOT compile a given method.
  * This function might be called by multiple threads, so it must be thread-safe.
  */
+/*
+ * can_dedup:
+ *
+ *   Return whenever the code for METHOD doesn't depend on the image it is compiled
+ * into, so the copies emitted by each image which references it can be replaced by
+ * one copy in the dedup container. The runtime finds these methods using the
+ * extra method tables of all loaded AOT images, see find_aot_method ().
+ */
+static gboolean
+can_dedup (MonoAotCompile *acfg, MonoMethod *method)
+{
+	if (method->wrapper_type != MONO_WRAPPER_NONE) {
+		WrapperInfo *info;
+
+		if (method->wrapper_type != MONO_WRAPPER_UNKNOWN)
+			return FALSE;
+		/* These only depend on their signature */
+		info = mono_marshal_get_wrapper_info (method);
+		return info && (info->subtype == WRAPPER_SUBTYPE_GSHAREDVT_IN_SIG || info->subtype == WRAPPER_SUBTYPE_GSHAREDVT_OUT_SIG);
+	}
+
+	/* Instances of generic definitions in other images, i.e. List<int> outside of mscorlib */
+	return method->is_inflated && method->klass->image != acfg->image;
+}
+
 static void
 compile_method (MonoAotCompile *acfg, MonoMethod *method)
 {
@@ -7538,6 +7711,14 @@ compile_method (MonoAotCompile *acfg, MonoMethod *method)
 	if (method->wrapper_type == MONO_WRAPPER_COMINTEROP)
 		return;
 
+	if (acfg->dedup_skip && can_dedup (acfg, method)) {
+		mono_acfg_lock (acfg);
+		g_hash_table_insert (dedup_methods, method, method);
+		mono_acfg_unlock (acfg);
+		InterlockedIncrement (&acfg->stats.dedup_skipped);
+		return;
+	}
+
 	InterlockedIncrement (&acfg->stats.mcount);
 
 #if 0
@@ -7870,39 +8051,161 @@ compile_method (MonoAotCompile *acfg, MonoMethod *method)
 	InterlockedIncrement (&acfg->stats.ccount);
 }
  
+/*
+ * A queue of methods shared by the compiler threads, ordered by decreasing estimated
+ * compilation cost. Each thread takes the next method when it is done with its current
+ * one, so a few expensive methods don't leave the other threads idle at the end.
+ */
+typedef struct {
+	MonoDomain *domain;
+	MonoAotCompile *acfg;
+	MonoMethod **methods;
+	int len;
+	gint32 next;
+} CompileQueue;
+
+typedef struct {
+	MonoMethod *method;
+	int cost, index;
+} CompileQueueItem;
+
+/*
+ * estimate_compile_cost:
+ *
+ *   Return an estimate of the cost of compiling METHOD, based on the size of its IL.
+ */
+static int
+estimate_compile_cost (MonoMethod *method)
+{
+	MonoError error;
+	MonoMethodHeader *header;
+	int cost;
+
+	if ((method->iflags & (METHOD_IMPL_ATTRIBUTE_INTERNAL_CALL | METHOD_IMPL_ATTRIBUTE_RUNTIME)) ||
+		(method->flags & (METHOD_ATTRIBUTE_PINVOKE_IMPL | METHOD_ATTRIBUTE_ABSTRACT)))
+		return 1;
+
+	header = mono_method_get_header_checked (method, &error);
+	if (!header) {
+		mono_error_cleanup (&error);
+		return 1;
+	}
+	cost = header->code_size + 1;
+	mono_metadata_free_mh (header);
+
+	/* Generic instances often need generic sharing, which makes them more expensive */
+	if (method->is_inflated)
+		cost *= 2;
+	return cost;
+}
+
+static int
+compile_queue_item_compare (const void *a, const void *b)
+{
+	const CompileQueueItem *ia = (const CompileQueueItem *)a;
+	const CompileQueueItem *ib = (const CompileQueueItem *)b;
+
+	/* Ties are broken by position, so the order is deterministic */
+	if (ia->cost != ib->cost)
+		return ib->cost - ia->cost;
+	return ia->index - ib->index;
+}
+
 static gsize WINAPI
 compile_thread_main (gpointer user_data)
 {
-	MonoDomain *domain = ((MonoDomain **)user_data) [0];
-	MonoAotCompile *acfg = ((MonoAotCompile **)user_data) [1];
-	GPtrArray *methods = ((GPtrArray **)user_data) [2];
+	CompileQueue *queue = (CompileQueue *)user_data;
+	MonoAotCompile *acfg = queue->acfg;
 	int i;
 
 	MonoError error;
-	MonoThread *thread = mono_thread_attach (domain);
+	MonoThread *thread = mono_thread_attach (queue->domain);
 	mono_thread_set_name_internal (thread->internal_thread, mono_string_new (mono_get_root_domain (), "AOT compiler"), TRUE, &error);
 	mono_error_assert_ok (&error);
 
-	for (i = 0; i < methods->len; ++i)
-		compile_method (acfg, (MonoMethod *)g_ptr_array_index (methods, i));
+	while ((i = InterlockedIncrement (&queue->next) - 1) < queue->len)
+		compile_method (acfg, queue->methods [i]);
 
 	return 0;
 }
 
+/*
+ * compile_methods_parallel:
+ *
+ *   Compile the methods in acfg->methods [START..END) using acfg->aot_opts.nthreads threads.
+ */
 static void
-load_profile_files (MonoAotCompile *acfg)
+compile_methods_parallel (MonoAotCompile *acfg, int start, int end)
+{
+	CompileQueue queue;
+	CompileQueueItem *items;
+	GPtrArray *threads;
+	HANDLE handle;
+	MonoThreadParm tp;
+	int i, len = end - start;
+
+	/* Make a copy since acfg->methods is modified by compile_method () */
+	items = g_new0 (CompileQueueItem, len);
+	for (i = 0; i < len; ++i) {
+		items [i].method = (MonoMethod *)g_ptr_array_index (acfg->methods, start + i);
+		items [i].cost = estimate_compile_cost (items [i].method);
+		items [i].index = i;
+	}
+	qsort (items, len, sizeof (CompileQueueItem), compile_queue_item_compare);
+
+	memset (&queue, 0, sizeof (queue));
+	queue.domain = mono_domain_get ();
+	queue.acfg = acfg;
+	queue.methods = g_new0 (MonoMethod*, len);
+	queue.len = len;
+	for (i = 0; i < len; ++i)
+		queue.methods [i] = items [i].method;
+	g_free (items);
+
+	threads = g_ptr_array_new ();
+	for (i = 0; i < acfg->aot_opts.nthreads; ++i) {
+		tp.priority = MONO_THREAD_PRIORITY_NORMAL;
+		tp.stack_size = 0;
+		tp.creation_flags = 0;
+		handle = mono_threads_create_thread (compile_thread_main, (gpointer) &queue, &tp, NULL);
+		g_ptr_array_add (threads, handle);
+	}
+
+	for (i = 0; i < threads->len; ++i) {
+		WaitForSingleObjectEx (g_ptr_array_index (threads, i), INFINITE, FALSE);
+		mono_threads_close_thread_handle (g_ptr_array_index (threads, i));
+	}
+	g_ptr_array_free (threads, TRUE);
+	g_free (queue.methods);
+}
+
+/*
+ * get_profile_names:
+ *
+ *   Return a hash table mapping the names of the methods of IMAGE recorded by the
+ * AOT profiler to their 1 based position in the profile. If NAMES is not NULL, add
+ * the names in profile order to it.
+ */
+static GHashTable*
+get_profile_names (MonoAotCompile *acfg, MonoImage *image, GPtrArray *names)
 {
 	FILE *infile;
 	char *tmp;
-	int file_index, res, method_index, i;
+	int file_index, res;
 	char ver [256];
-	guint32 token;
-	GList *unordered, *l;
-	gboolean found;
+	GHashTable *ranks;
+
+	ranks = (GHashTable *)g_hash_table_lookup (acfg->profile_data, image);
+	if (ranks && !names)
+		return ranks;
+	g_assert (!ranks);
+
+	ranks = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	g_hash_table_insert (acfg->profile_data, image, ranks);
 
 	file_index = 0;
 	while (TRUE) {
-		tmp = g_strdup_printf ("%s/.mono/aot-profile-data/%s-%d", g_get_home_dir (), acfg->image->assembly_name, file_index);
+		tmp = g_strdup_printf ("%s/.mono/aot-profile-data/%s-%d", g_get_home_dir (), image->assembly_name, file_index);
 
 		if (!g_file_test (tmp, G_FILE_TEST_IS_REGULAR)) {
 			g_free (tmp);
@@ -7926,8 +8229,6 @@ load_profile_files (MonoAotCompile *acfg)
 
 		while (TRUE) {
 			char name [1024];
-			MonoMethodDesc *desc;
-			MonoMethod *method;
 
 			if (fgets (name, 1023, infile) == NULL)
 				break;
@@ -7936,46 +8237,154 @@ load_profile_files (MonoAotCompile *acfg)
 			if (strlen (name) > 0)
 				name [strlen (name) - 1] = '\0';
 
-			desc = mono_method_desc_new (name, TRUE);
+			if (g_hash_table_lookup (ranks, name))
+				continue;
+			g_hash_table_insert (ranks, g_strdup (name), GUINT_TO_POINTER (g_hash_table_size (ranks) + 1));
+			if (names)
+				g_ptr_array_add (names, g_strdup (name));
+		}
+		fclose (infile);
+	}
+
+	return ranks;
+}
+
+static void
+load_profile_files (MonoAotCompile *acfg)
+{
+	GPtrArray *names;
+	GHashTable *added;
+	int method_index, i;
+	guint32 token;
+
+	names = g_ptr_array_new ();
+	get_profile_names (acfg, acfg->image, names);
 
-			method = mono_method_desc_search_in_image (desc, acfg->image);
+	/* Methods in the profile come first, in the order they were first executed */
+	added = g_hash_table_new (NULL, NULL);
+	for (i = 0; i < names->len; ++i) {
+		char *name = (char *)g_ptr_array_index (names, i);
+		MonoMethodDesc *desc;
+		MonoMethod *method;
 
-			if (method && mono_method_get_token (method)) {
-				token = mono_method_get_token (method);
-				method_index = mono_metadata_token_index (token) - 1;
+		desc = mono_method_desc_new (name, TRUE);
 
-				found = FALSE;
-				for (i = 0; i < acfg->method_order->len; ++i) {
-					if (g_ptr_array_index (acfg->method_order, i) == GUINT_TO_POINTER (method_index)) {
-						found = TRUE;
-						break;
-					}
-				}
-				if (!found)
-					g_ptr_array_add (acfg->method_order, GUINT_TO_POINTER (method_index));
-			} else {
-				//printf ("No method found matching '%s'.\n", name);
+		method = desc ? mono_method_desc_search_in_image (desc, acfg->image) : NULL;
+
+		if (method && mono_method_get_token (method)) {
+			token = mono_method_get_token (method);
+			method_index = mono_metadata_token_index (token) - 1;
+
+			if (!g_hash_table_lookup (added, GUINT_TO_POINTER (method_index + 1))) {
+				g_hash_table_insert (added, GUINT_TO_POINTER (method_index + 1), GUINT_TO_POINTER (1));
+				g_ptr_array_add (acfg->method_order, GUINT_TO_POINTER (method_index));
 			}
+		} else {
+			//printf ("No method found matching '%s'.\n", name);
 		}
-		fclose (infile);
+		if (desc)
+			mono_method_desc_free (desc);
+		g_free (name);
 	}
+	g_ptr_array_free (names, TRUE);
+	acfg->nprofiled_methods = acfg->method_order->len;
 
 	/* Add missing methods */
-	unordered = NULL;
 	for (method_index = 0; method_index < acfg->image->tables [MONO_TABLE_METHOD].rows; ++method_index) {
-		found = FALSE;
-		for (i = 0; i < acfg->method_order->len; ++i) {
-			if (g_ptr_array_index (acfg->method_order, i) == GUINT_TO_POINTER (method_index)) {
-				found = TRUE;
-				break;
-			}
+		if (!g_hash_table_lookup (added, GUINT_TO_POINTER (method_index + 1)))
+			g_ptr_array_add (acfg->method_order, GUINT_TO_POINTER (method_index));
+	}
+	g_hash_table_destroy (added);
+}
+
+typedef struct {
+	guint32 index;
+	guint32 rank;
+	guint32 order;
+} ProfiledMethod;
+
+static int
+compare_profiled_methods (const void *a, const void *b)
+{
+	const ProfiledMethod *m1 = (const ProfiledMethod *)a;
+	const ProfiledMethod *m2 = (const ProfiledMethod *)b;
+
+	if (m1->rank != m2->rank)
+		return m1->rank < m2->rank ? -1 : 1;
+	return m1->order < m2->order ? -1 : (m1->order > m2->order ? 1 : 0);
+}
+
+/*
+ * order_extra_methods_by_profile:
+ *
+ *   load_profile_files () only orders the methods defined in the image, the extra
+ * methods, i.e. generic instances and wrappers, are appended in the order they were
+ * discovered, after the unprofiled methods. Move the extra methods which appear in
+ * the profile of the image defining them next to the profiled methods, so the code
+ * executed at startup is emitted together at the start of the text section, and the
+ * cold code ends up at the end.
+ */
+static void
+order_extra_methods_by_profile (MonoAotCompile *acfg)
+{
+	GArray *hot;
+	GPtrArray *order;
+	GHashTable *hot_set;
+	int oindex, i;
+
+	if (!acfg->nprofiled_methods)
+		/* No profile for this image */
+		return;
+
+	hot = g_array_new (FALSE, FALSE, sizeof (ProfiledMethod));
+	for (oindex = acfg->nprofiled_methods; oindex < acfg->method_order->len; ++oindex) {
+		MonoCompile *cfg;
+		ProfiledMethod entry;
+		char *name;
+
+		i = GPOINTER_TO_UINT (g_ptr_array_index (acfg->method_order, oindex));
+		cfg = acfg->cfgs [i];
+		if (!cfg || i < acfg->image->tables [MONO_TABLE_METHOD].rows)
+			continue;
+
+		name = mono_method_full_name (cfg->orig_method, TRUE);
+		entry.rank = GPOINTER_TO_UINT (g_hash_table_lookup (get_profile_names (acfg, cfg->orig_method->klass->image, NULL), name));
+		g_free (name);
+		if (!entry.rank)
+			continue;
+		entry.index = i;
+		entry.order = oindex;
+		g_array_append_val (hot, entry);
+	}
+
+	if (hot->len) {
+		qsort (hot->data, hot->len, sizeof (ProfiledMethod), compare_profiled_methods);
+
+		hot_set = g_hash_table_new (NULL, NULL);
+		order = g_ptr_array_new ();
+		for (oindex = 0; oindex < acfg->nprofiled_methods; ++oindex)
+			g_ptr_array_add (order, g_ptr_array_index (acfg->method_order, oindex));
+		for (i = 0; i < hot->len; ++i) {
+			ProfiledMethod *entry = &g_array_index (hot, ProfiledMethod, i);
+
+			g_ptr_array_add (order, GUINT_TO_POINTER (entry->index));
+			g_hash_table_insert (hot_set, GUINT_TO_POINTER (entry->index + 1), GUINT_TO_POINTER (1));
+		}
+		for (oindex = acfg->nprofiled_methods; oindex < acfg->method_order->len; ++oindex) {
+			gpointer index = g_ptr_array_index (acfg->method_order, oindex);
+
+			if (!g_hash_table_lookup (hot_set, GUINT_TO_POINTER (GPOINTER_TO_UINT (index) + 1)))
+				g_ptr_array_add (order, index);
 		}
-		if (!found)
-			unordered = g_list_prepend (unordered, GUINT_TO_POINTER (method_index));
+		g_assert (order->len == acfg->method_order->len);
+
+		g_ptr_array_free (acfg->method_order, TRUE);
+		acfg->method_order = order;
+		acfg->nprofiled_methods += hot->len;
+		g_hash_table_destroy (hot_set);
 	}
-	unordered = g_list_reverse (unordered);
-	for (l = unordered; l; l = l->next)
-		g_ptr_array_add (acfg->method_order, l->data);
+
+	g_array_free (hot, TRUE);
 }
  
 /* Used by the LLVM backend */
@@ -8294,6 +8703,165 @@ execute_system (const char * command)
 
 #ifdef ENABLE_LLVM
 
+static char*
+get_llvm_only_cc_command (const char *ofile, const char *bcfile)
+{
+	/* Use the stock clang from xcode */
+	// FIXME: arch
+	return g_strdup_printf ("clang++ -fexceptions -march=x86-64 -fpic -msse -msse2 -msse3 -msse4 -O2 -fno-optimize-sibling-calls -Wno-override-module -c -o \"%s\" \"%s\"", ofile, bcfile);
+}
+
+typedef struct {
+	MonoAotCompile *acfg;
+	char **commands;
+	int len;
+	gint32 next;
+	gint32 failed;
+} ToolQueue;
+
+static gsize WINAPI
+tool_thread_main (gpointer user_data)
+{
+	ToolQueue *queue = (ToolQueue *)user_data;
+	int i;
+
+	while ((i = InterlockedIncrement (&queue->next) - 1) < queue->len) {
+		aot_printf (queue->acfg, "Executing clang: %s\n", queue->commands [i]);
+		if (execute_system (queue->commands [i]) != 0)
+			InterlockedExchange (&queue->failed, 1);
+	}
+
+	return 0;
+}
+
+/*
+ * execute_system_parallel:
+ *
+ *   Execute the LEN commands in COMMANDS using NTHREADS threads. Return whenever all of
+ * them succeeded.
+ */
+static gboolean
+execute_system_parallel (MonoAotCompile *acfg, char **commands, int len, int nthreads)
+{
+	ToolQueue queue;
+	HANDLE *threads;
+	MonoThreadParm tp;
+	int i;
+
+	memset (&queue, 0, sizeof (queue));
+	queue.acfg = acfg;
+	queue.commands = commands;
+	queue.len = len;
+
+	nthreads = MIN (nthreads, len);
+	threads = g_new0 (HANDLE, nthreads);
+	for (i = 0; i < nthreads; ++i) {
+		tp.priority = MONO_THREAD_PRIORITY_NORMAL;
+		tp.stack_size = 0;
+		tp.creation_flags = 0;
+		threads [i] = mono_threads_create_thread (tool_thread_main, (gpointer) &queue, &tp, NULL);
+	}
+
+	for (i = 0; i < nthreads; ++i) {
+		WaitForSingleObjectEx (threads [i], INFINITE, FALSE);
+		mono_threads_close_thread_handle (threads [i]);
+	}
+	g_free (threads);
+
+	return !queue.failed;
+}
+
+/*
+ * emit_llvm_split_file:
+ *
+ *   Compile the optimized LLVM module in llvmonly mode by splitting it into
+ * acfg->aot_opts.llvm_split modules which are compiled in parallel, then combined into
+ * acfg->llvm_ofile using a relocatable link. The runtime computes the boundaries of the
+ * LLVM code using the llvm_code_start/llvm_code_end functions (see
+ * compute_llvm_code_range () in aot-runtime.c), so those are extracted into separate
+ * modules which are linked first and last, keeping the rest of the code between them.
+ */
+static gboolean
+emit_llvm_split_file (MonoAotCompile *acfg)
+{
+	char *command, *code_start, *code_end;
+	char **commands;
+	GString *objfiles;
+	int i, nparts = acfg->aot_opts.llvm_split;
+	gboolean res;
+
+	code_start = g_strdup_printf ("%s_llvm_code_start", acfg->global_prefix);
+	code_end = g_strdup_printf ("%s_llvm_code_end", acfg->global_prefix);
+
+	command = g_strdup_printf ("\"%sllvm-extract\" -func=%s -o \"%s.start.bc\" \"%s.opt.bc\"", acfg->aot_opts.llvm_path, code_start, acfg->tmpbasename, acfg->tmpbasename);
+	aot_printf (acfg, "Executing llvm-extract: %s\n", command);
+	res = execute_system (command) == 0;
+	g_free (command);
+
+	if (res) {
+		command = g_strdup_printf ("\"%sllvm-extract\" -func=%s -o \"%s.end.bc\" \"%s.opt.bc\"", acfg->aot_opts.llvm_path, code_end, acfg->tmpbasename, acfg->tmpbasename);
+		aot_printf (acfg, "Executing llvm-extract: %s\n", command);
+		res = execute_system (command) == 0;
+		g_free (command);
+	}
+
+	if (res) {
+		command = g_strdup_printf ("\"%sllvm-extract\" -delete -func=%s -func=%s -o \"%s.body.bc\" \"%s.opt.bc\"", acfg->aot_opts.llvm_path, code_start, code_end, acfg->tmpbasename, acfg->tmpbasename);
+		aot_printf (acfg, "Executing llvm-extract: %s\n", command);
+		res = execute_system (command) == 0;
+		g_free (command);
+	}
+
+	g_free (code_start);
+	g_free (code_end);
+
+	if (res) {
+		/* This creates <tmpbasename>.body.bc.0 ... <tmpbasename>.body.bc.<nparts - 1> */
+		command = g_strdup_printf ("\"%sllvm-split\" -j %d -o \"%s.body.bc.\" \"%s.body.bc\"", acfg->aot_opts.llvm_path, nparts, acfg->tmpbasename, acfg->tmpbasename);
+		aot_printf (acfg, "Executing llvm-split: %s\n", command);
+		res = execute_system (command) == 0;
+		g_free (command);
+	}
+
+	if (!res)
+		return FALSE;
+
+	/* The object files are linked in this order */
+	commands = g_new0 (char*, nparts + 2);
+	objfiles = g_string_new ("");
+	for (i = 0; i < nparts + 2; ++i) {
+		char *bcfile, *ofile;
+
+		if (i == 0)
+			bcfile = g_strdup_printf ("%s.start.bc", acfg->tmpbasename);
+		else if (i == nparts + 1)
+			bcfile = g_strdup_printf ("%s.end.bc", acfg->tmpbasename);
+		else
+			bcfile = g_strdup_printf ("%s.body.bc.%d", acfg->tmpbasename, i - 1);
+		ofile = g_strdup_printf ("%s.llvm.%d.o", acfg->tmpbasename, i);
+		commands [i] = get_llvm_only_cc_command (ofile, bcfile);
+		g_string_append_printf (objfiles, " \"%s\"", ofile);
+		g_free (bcfile);
+		g_free (ofile);
+	}
+
+	res = execute_system_parallel (acfg, commands, nparts + 2, nparts);
+
+	for (i = 0; i < nparts + 2; ++i)
+		g_free (commands [i]);
+	g_free (commands);
+
+	if (res) {
+		command = g_strdup_printf ("clang++ -r -nostdlib -o \"%s\"%s", acfg->llvm_ofile, objfiles->str);
+		aot_printf (acfg, "Executing the native linker: %s\n", command);
+		res = execute_system (command) == 0;
+		g_free (command);
+	}
+	g_string_free (objfiles, TRUE);
+
+	return res;
+}
+
 /*
  * emit_llvm_file:
  *
@@ -8361,9 +8929,10 @@ emit_llvm_file (MonoAotCompile *acfg)
 		return TRUE;
 
 	if (acfg->aot_opts.llvm_only) {
-		/* Use the stock clang from xcode */
-		// FIXME: arch
-		command = g_strdup_printf ("clang++ -fexceptions -march=x86-64 -fpic -msse -msse2 -msse3 -msse4 -O2 -fno-optimize-sibling-calls -Wno-override-module -c -o \"%s\" \"%s.opt.bc\"", acfg->llvm_ofile, acfg->tmpbasename);
+		if (acfg->aot_opts.llvm_split > 1)
+			return emit_llvm_split_file (acfg);
+
+		command = get_llvm_only_cc_command (acfg->llvm_ofile, optbc);
 
 		aot_printf (acfg, "Executing clang: %s\n", command);
 		if (execute_system (command) != 0)
@@ -9859,70 +10428,52 @@ collect_methods (MonoAotCompile *acfg)
 	return TRUE;
 }
 
+static void
+add_dedup_method_cb (gpointer key, gpointer value, gpointer user_data)
+{
+	MonoAotCompile *acfg = (MonoAotCompile *)user_data;
+
+	/* These are already converted to their shared versions by add_extra_method () */
+	add_method_full (acfg, (MonoMethod *)key, TRUE, 0);
+	acfg->stats.dedup_included ++;
+}
+
+/*
+ * add_dedup_methods:
+ *
+ *   Add the methods skipped by the images compiled before the dedup container.
+ */
+static void
+add_dedup_methods (MonoAotCompile *acfg)
+{
+	if (dedup_methods)
+		g_hash_table_foreach (dedup_methods, add_dedup_method_cb, acfg);
+}
+
+/*
+ * Compiling methods adds new methods to acfg->methods, they are compiled in parallel
+ * too as long as there are enough of them.
+ */
+#define MIN_PARALLEL_METHODS_PER_THREAD 16
+
 static void
 compile_methods (MonoAotCompile *acfg)
 {
 	int i, methods_len;
 
+	methods_len = 0;
 	if (acfg->aot_opts.nthreads > 0) {
-		GPtrArray *frag;
-		int len, j;
-		GPtrArray *threads;
-		HANDLE handle;
-		gpointer *user_data;
-		MonoMethod **methods;
-		MonoThreadParm tp;
-
-		methods_len = acfg->methods->len;
-
-		len = acfg->methods->len / acfg->aot_opts.nthreads;
-		g_assert (len > 0);
-		/* 
-		 * Partition the list of methods into fragments, and hand it to threads to
-		 * process.
-		 */
-		threads = g_ptr_array_new ();
-		/* Make a copy since acfg->methods is modified by compile_method () */
-		methods = g_new0 (MonoMethod*, methods_len);
-		//memcpy (methods, g_ptr_array_index (acfg->methods, 0), sizeof (MonoMethod*) * methods_len);
-		for (i = 0; i < methods_len; ++i)
-			methods [i] = (MonoMethod *)g_ptr_array_index (acfg->methods, i);
-		i = 0;
-		while (i < methods_len) {
-			frag = g_ptr_array_new ();
-			for (j = 0; j < len; ++j) {
-				if (i < methods_len) {
-					g_ptr_array_add (frag, methods [i]);
-					i ++;
-				}
-			}
+		while (acfg->methods->len - methods_len >= acfg->aot_opts.nthreads * MIN_PARALLEL_METHODS_PER_THREAD) {
+			int len = acfg->methods->len;
 
-			user_data = g_new0 (gpointer, 3);
-			user_data [0] = mono_domain_get ();
-			user_data [1] = acfg;
-			user_data [2] = frag;
-			
-			tp.priority = MONO_THREAD_PRIORITY_NORMAL;
-			tp.stack_size = 0;
-			tp.creation_flags = 0;
-			handle = mono_threads_create_thread (compile_thread_main, (gpointer) user_data, &tp, NULL);
-			g_ptr_array_add (threads, handle);
-		}
-		g_free (methods);
-
-		for (i = 0; i < threads->len; ++i) {
-			WaitForSingleObjectEx (g_ptr_array_index (threads, i), INFINITE, FALSE);
-			mono_threads_close_thread_handle (g_ptr_array_index (threads, i));
+			compile_methods_parallel (acfg, methods_len, len);
+			methods_len = len;
 		}
-	} else {
-		methods_len = 0;
 	}
 
-	/* Compile methods added by compile_method () or all methods if nthreads == 0 */
-	for (i = methods_len; i < acfg->methods->len; ++i) {
-		/* This can new methods to acfg->methods */
+	/* Compile the remaining methods, this can add new methods to acfg->methods */
+	for (i = methods_len; i < acfg->methods->len; ++i)
 		compile_method (acfg, (MonoMethod *)g_ptr_array_index (acfg->methods, i));
-	}
 }
 
 static int
@@ -10176,6 +10727,7 @@ acfg_create (MonoAssembly *ass, guint32 opts)
 	acfg->unwind_ops = g_ptr_array_new ();
 	acfg->method_label_hash = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 	acfg->method_order = g_ptr_array_new ();
+	acfg->profile_data = g_hash_table_new_full (NULL, NULL, NULL, (GDestroyNotify)g_hash_table_destroy);
 	acfg->export_names = g_hash_table_new (NULL, NULL);
 	acfg->klass_blob_hash = g_hash_table_new (NULL, NULL);
 	acfg->method_blob_hash = g_hash_table_new (NULL, NULL);
@@ -10238,6 +10790,7 @@ acfg_free (MonoAotCompile *acfg)
 	if (acfg->typespec_classes)
 		g_hash_table_destroy (acfg->typespec_classes);
 	g_hash_table_destroy (acfg->export_names);
+	g_hash_table_destroy (acfg->profile_data);
 	g_hash_table_destroy (acfg->plt_entry_debug_sym_cache);
 	g_hash_table_destroy (acfg->klass_blob_hash);
 	g_hash_table_destroy (acfg->method_blob_hash);
@@ -10472,6 +11025,126 @@ add_preinit_got_slots (MonoAotCompile *acfg)
 	acfg->nshared_got_entries = acfg->got_offset;
 }
 
+/*
+ * is_dedup_container:
+ *
+ *   Return whenever IMAGE is the assembly named by the dedup-include= option.
+ */
+static gboolean
+is_dedup_container (MonoImage *image, MonoAotOptions *opts)
+{
+	char *basename;
+	gboolean res;
+
+	if (!opts->dedup_include)
+		return FALSE;
+	basename = g_path_get_basename (image->name);
+	res = !strcmp (basename, opts->dedup_include) || !strcmp (image->assembly_name, opts->dedup_include);
+	g_free (basename);
+	return res;
+}
+
+/*
+ * mono_aot_is_dedup_container:
+ *
+ *   Return whenever ASS is the dedup container named by AOT_OPTIONS. Set DEDUP to
+ * whenever AOT_OPTIONS enables deduplication at all.
+ */
+gboolean
+mono_aot_is_dedup_container (MonoAssembly *ass, const char *aot_options, gboolean *dedup)
+{
+	MonoAotOptions opts;
+
+	memset (&opts, 0, sizeof (opts));
+	mono_aot_parse_options (aot_options, &opts);
+	*dedup = opts.dedup_include != NULL;
+	return is_dedup_container (ass->image, &opts);
+}
+
+/*
+ * get_aot_output_file_name:
+ *
+ *   Return the name of the file which will be produced by compiling ACFG's image.
+ */
+static char*
+get_aot_output_file_name (MonoAotCompile *acfg)
+{
+	if (acfg->aot_opts.outfile)
+		return g_strdup (acfg->aot_opts.outfile);
+	if (acfg->aot_opts.asm_only)
+		return g_strdup_printf ("%s.s", acfg->image->name);
+	if (acfg->aot_opts.static_link)
+		return g_strdup_printf ("%s.o", acfg->image->name);
+	return g_strdup_printf ("%s%s", acfg->image->name, MONO_SOLIB_EXT);
+}
+
+/*
+ * compute_incremental_stamp:
+ *
+ *   Compute a hash of everything the AOT output of ACFG's image depends on: the
+ * contents of the image, the guids of the images it references, the runtime
+ * version, the optimization flags and the AOT options. Return it as a hex string.
+ */
+static char*
+compute_incremental_stamp (MonoAotCompile *acfg, const char *aot_options)
+{
+	MonoImage *image = acfg->image;
+	MonoImageOpenStatus status;
+	MonoSHA1Context ctx;
+	guchar digest [20];
+	GString *str;
+	char *build_info;
+	int i;
+
+	mono_sha1_init (&ctx);
+	mono_sha1_update (&ctx, (guchar*)image->raw_data, image->raw_data_len);
+
+	mono_assembly_load_references (image, &status);
+	for (i = 0; i < image->nreferences; ++i) {
+		MonoAssembly *ref = image->references [i];
+
+		/* Missing references would make the compilation fail anyway */
+		if (ref && ref != REFERENCE_MISSING && ref->image->guid)
+			mono_sha1_update (&ctx, (guchar*)ref->image->guid, strlen (ref->image->guid));
+	}
+
+	build_info = mono_get_runtime_build_info ();
+	str = g_string_new (build_info);
+	g_string_append_printf (str, "|%d|%x|%d|%s", MONO_AOT_FILE_VERSION, acfg->opts, (int)sizeof (gpointer), aot_options ? aot_options : "");
+	mono_sha1_update (&ctx, (guchar*)str->str, str->len);
+	g_string_free (str, TRUE);
+	g_free (build_info);
+
+	mono_sha1_final (&ctx, digest);
+
+	str = g_string_new ("");
+	for (i = 0; i < 20; ++i)
+		g_string_append_printf (str, "%02x", digest [i]);
+	return g_string_free (str, FALSE);
+}
+
+/*
+ * incremental_stamp_is_current:
+ *
+ *   Return whether OUTFILE exists and was produced from the same inputs as
+ * described by STAMP.
+ */
+static gboolean
+incremental_stamp_is_current (const char *outfile, const char *stamp_file, const char *stamp)
+{
+	char *contents;
+	gsize len;
+	gboolean res;
+
+	if (!g_file_test (outfile, G_FILE_TEST_EXISTS))
+		return FALSE;
+	if (!g_file_get_contents (stamp_file, &contents, &len, NULL))
+		return FALSE;
+	res = len == strlen (stamp) && !strncmp (contents, stamp, len);
+	g_free (contents);
+	return res;
+}
+
 int
 mono_compile_assembly (MonoAssembly *ass, guint32 opts, const char *aot_options)
 {
@@ -10480,6 +11153,7 @@ mono_compile_assembly (MonoAssembly *ass, guint32 opts, const char *aot_options)
 	gint64 all_sizes;
 	MonoAotCompile *acfg;
 	char *outfile_name, *tmp_outfile_name, *p;
+	char *stamp_file = NULL, *stamp = NULL;
 	char llvm_stats_msg [256];
 	TV_DECLARE (atv);
 	TV_DECLARE (btv);
@@ -10505,6 +11179,63 @@ mono_compile_assembly (MonoAssembly *ass, guint32 opts, const char *aot_options)
 		acfg->logfile = fopen (acfg->aot_opts.logfile, "a+");
 	}
 
+	if (acfg->aot_opts.incremental) {
+		/*
+		 * The output only depends on the inputs hashed into the stamp, so if they
+		 * didn't change since the last compilation, the old output can be reused.
+		 * LLVM and separate data files produce additional outputs which are not
+		 * tracked, and dedup needs every image to be compiled to collect the
+		 * dedupable methods, so those always recompile.
+		 */
+		if (acfg->aot_opts.llvm || acfg->aot_opts.llvm_only || acfg->aot_opts.data_outfile || acfg->aot_opts.dedup_include) {
+			aot_printf (acfg, "The 'incremental' option is not supported together with llvm, data-outfile or dedup-include, ignoring it.\n");
+		} else {
+			outfile_name = get_aot_output_file_name (acfg);
+			stamp_file = g_strdup_printf ("%s.stamp", outfile_name);
+			stamp = compute_incremental_stamp (acfg, aot_options);
+			if (incremental_stamp_is_current (outfile_name, stamp_file, stamp)) {
+				aot_printf (acfg, "Output file '%s' is up to date.\n", outfile_name);
+				g_free (outfile_name);
+				g_free (stamp_file);
+				g_free (stamp);
+				acfg_free (acfg);
+				return 0;
+			}
+			/* Invalidate the stamp so a failed compilation is not treated as up to date */
+			unlink (stamp_file);
+			g_free (outfile_name);
+		}
+	}
+
+	if (acfg->aot_opts.llvm_split > 1 && (!acfg->aot_opts.llvm_only || acfg->aot_opts.asm_only)) {
+		/*
+		 * In llvm mode, llc emits the EH info into a single mono_eh_frame table whose
+		 * layout the runtime depends on, so the module can't be split.
+		 */
+		aot_printf (acfg, "The 'llvm-split' option is only supported in llvmonly mode without asmonly, ignoring it.\n");
+		acfg->aot_opts.llvm_split = 0;
+	}
+
+	if (acfg->aot_opts.dedup_include) {
+		/*
+		 * Dedupable methods are not compiled into the other images, they are collected
+		 * into dedup_methods, and compiled into the container. So the container has to
+		 * be compiled last, see main_thread_handler () in driver.c.
+		 */
+		if (is_dedup_container (image, &acfg->aot_opts)) {
+			acfg->dedup_container = TRUE;
+			acfg->flags = (MonoAotFileFlags)(acfg->flags | MONO_AOT_FILE_FLAG_DEDUP);
+		} else {
+			if (dedup_container_compiled) {
+				aot_printerrf (acfg, "The dedup container '%s' needs to be compiled after all other assemblies.\n", acfg->aot_opts.dedup_include);
+				return 1;
+			}
+			acfg->dedup_skip = TRUE;
+			if (!dedup_methods)
+				dedup_methods = g_hash_table_new (NULL, NULL);
+		}
+	}
+
 	if (acfg->aot_opts.data_outfile) {
 		acfg->data_outfile = fopen (acfg->aot_opts.data_outfile, "w+");
 		if (!acfg->data_outfile) {
@@ -10666,6 +11397,9 @@ mono_compile_assembly (MonoAssembly *ass, guint32 opts, const char *aot_options)
 	if (!res)
 		return 1;
 
+	if (acfg->dedup_container)
+		add_dedup_methods (acfg);
+
 	acfg->cfgs_size = acfg->methods->len + 32;
 	acfg->cfgs = g_new0 (MonoCompile*, acfg->cfgs_size);
 
@@ -10688,6 +11422,8 @@ mono_compile_assembly (MonoAssembly *ass, guint32 opts, const char *aot_options)
 
 	acfg->stats.jit_time = TV_ELAPSED (atv, btv);
 
+	order_extra_methods_by_profile (acfg);
+
 	TV_GETTIME (atv);
 
 #ifdef ENABLE_LLVM
@@ -10870,6 +11606,10 @@ mono_compile_assembly (MonoAssembly *ass, guint32 opts, const char *aot_options)
 			llvm_stats_msg,
 			acfg->stats.methods_without_got_slots, acfg->stats.mcount ? (acfg->stats.methods_without_got_slots * 100) / acfg->stats.mcount : 100,
 			acfg->stats.direct_calls, acfg->stats.all_calls ? (acfg->stats.direct_calls * 100) / acfg->stats.all_calls : 100);
+	if (acfg->stats.dedup_skipped)
+		aot_printf (acfg, "%d methods left to the dedup container\n", acfg->stats.dedup_skipped);
+	if (acfg->stats.dedup_included)
+		aot_printf (acfg, "%d methods included from other images for dedup\n", acfg->stats.dedup_included);
 	if (acfg->stats.genericcount)
 		aot_printf (acfg, "%d methods are generic (%d%%)\n", acfg->stats.genericcount, acfg->stats.mcount ? (acfg->stats.genericcount * 100) / acfg->stats.mcount : 100);
 	if (acfg->stats.abscount)
@@ -10914,6 +11654,16 @@ mono_compile_assembly (MonoAssembly *ass, guint32 opts, const char *aot_options)
 	if (acfg->aot_opts.dump_json)
 		aot_dump (acfg);
 
+	if (acfg->dedup_container)
+		dedup_container_compiled = TRUE;
+
+	if (stamp) {
+		if (!g_file_set_contents (stamp_file, stamp, strlen (stamp), NULL))
+			aot_printerrf (acfg, "Unable to write file '%s': %s\n", stamp_file, strerror (errno));
+		g_free (stamp_file);
+		g_free (stamp);
+	}
+
 	acfg_free (acfg);
 	
 	return 0;
@@ -10935,6 +11685,13 @@ mono_compile_assembly (MonoAssembly *ass, guint32 opts, const char *aot_options)
 	return 0;
 }
 
+gboolean
+mono_aot_is_dedup_container (MonoAssembly *ass, const char *aot_options, gboolean *dedup)
+{
+	*dedup = FALSE;
+	return FALSE;
+}
+
 gboolean
 mono_aot_is_shared_got_offset (int offset)
 {
@@ -4,6 +4,7 @@
 #include "mini.h"
 
 int mono_compile_assembly (MonoAssembly *ass, guint32 opts, const char *aot_options);
+gboolean mono_aot_is_dedup_container (MonoAssembly *ass, const char *aot_options, gboolean *dedup);
 void* mono_aot_readonly_field_override (MonoClassField *field);
 gboolean mono_aot_is_shared_got_offset (int offset) MONO_LLVM_INTERNAL;
 
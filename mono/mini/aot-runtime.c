@@ -58,6 +58,8 @@
 #include <mono/utils/mono-counters.h>
 #include <mono/utils/mono-digest.h>
 #include <mono/utils/mono-threads-coop.h>
+#include <mono/utils/mono-coop-mutex.h>
+#include <mono/utils/mono-startup-trace.h>
 
 #include "mini.h"
 #include "seq-points.h"
@@ -84,6 +86,26 @@ typedef struct {
 	MonoJitInfo *jinfo;
 } JitInfoMap;
 
+/* The code range covered by one entry in MethodAddressIndex:buckets */
+#define METHOD_ADDRESS_BUCKET_SHIFT 9
+
+typedef struct MethodAddressIndex {
+	/* Sorted array of method addresses */
+	gpointer *methods;
+	/* Method indexes for each method in methods */
+	int *method_indexes;
+	/* The length of the two tables above */
+	int len;
+	/*
+	 * Maps each METHOD_ADDRESS_BUCKET_SHIFT sized chunk of the code starting at
+	 * bucket_base to the position of the last method starting at or before the
+	 * chunk, or -1. NULL if the code is too sparse for the buckets to pay off.
+	 */
+	gint32 *buckets;
+	guint8 *bucket_base;
+	int nbuckets;
+} MethodAddressIndex;
+
 typedef struct MonoAotModule {
 	char *aot_name;
 	/* Pointer to the Global Offset Table */
@@ -115,12 +137,8 @@ typedef struct MonoAotModule {
 	guint8 *blob;
 	/* Maps method indexes to their code */
 	gpointer *methods;
-	/* Sorted array of method addresses */
-	gpointer *sorted_methods;
-	/* Method indexes for each method in sorted_methods */
-	int *sorted_method_indexes;
-	/* The length of the two tables above */
-	int sorted_methods_len;
+	/* Maps code addresses to method indexes, computed lazily */
+	struct MethodAddressIndex *method_address_index;
 	guint32 *method_info_offsets;
 	guint32 *ex_info_offsets;
 	guint32 *class_info_offsets;
@@ -173,6 +191,12 @@ static mono_mutex_t aot_mutex;
  */
 static GHashTable *static_aot_modules;
 
+/*
+ * The AOT module compiled with MONO_AOT_FILE_FLAG_DEDUP, it contains the generic
+ * instances and wrappers which were left out of the other modules.
+ */
+static MonoAotModule *dedup_aot_module;
+
 /*
  * Maps MonoJitInfo* to the aot module they belong to, this can be different
  * from ji->method->klass->image's aot module for generic instances.
@@ -187,6 +211,9 @@ static gboolean enable_aot_cache = FALSE;
 
 static gboolean mscorlib_aot_loaded;
 
+/* Whenever an image compiled with sequence points was loaded */
+static gboolean debug_aot_loaded;
+
 /* For debugging */
 static gint32 mono_last_aot_method = -1;
 
@@ -200,9 +227,29 @@ static gsize aot_code_high_addr = 0;
 
 /* Stats */
 static gint32 async_jit_info_size;
+/* The number of GOT slots referenced by loaded methods which were already resolved/needed resolving */
+static gint32 aot_got_slots_shared, aot_got_slots_resolved;
+/* Number of IMT slots filled in using the IMT info in the AOT image */
+static gint32 aot_imt_slots_cached;
 
 static GHashTable *aot_jit_icall_hash;
 
+#define AOT_PRELOAD_MAX_THREADS 16
+
+typedef struct {
+	MonoAotModule *amodule;
+	int index;
+} PreloadItem;
+
+/* The number of threads loading the dependencies of AOT modules in the background */
+static int aot_preload_threads;
+static gint32 aot_preload_threads_started;
+static MonoCoopMutex aot_preload_mutex;
+static MonoCoopCond aot_preload_cond;
+/* PreloadItems, protected by aot_preload_mutex */
+static GQueue *aot_preload_queue;
+static gint32 aot_images_preloaded;
+
 #ifdef MONOTOUCH
 #define USE_PAGE_TRAMPOLINES ((MonoAotModule*)mono_defaults.corlib->aot_module)->use_page_trampolines
 #else
@@ -1077,6 +1124,17 @@ decode_method_ref_with_target (MonoAotModule *module, MethodRef *ref, MonoMethod
 				if (strcmp (target->name, name) != 0)
 					return FALSE;
 				ref->method = target;
+			} else if (subtype == WRAPPER_SUBTYPE_NATIVE_SHARED) {
+				MonoMethodSignature *sig;
+
+				sig = decode_signature_with_target (module, NULL, p, &p);
+				if (!sig)
+					return FALSE;
+				m = mono_marshal_get_native_shared_wrapper_for_sig (sig);
+				g_free (sig);
+				if (target && target != m)
+					return FALSE;
+				ref->method = m;
 			} else {
 				m = decode_resolve_method_ref (module, p, &p, error);
 				if (!m)
@@ -1813,6 +1871,12 @@ check_usable (MonoAssembly *assembly, MonoAotFileInfo *info, guint8 *blob, char
 		}
 	}
 
+	if (!mono_gc_is_moving () && mono_gc_needs_write_barriers ()) {
+		/* See mini_gc_init_cfg () */
+		msg = g_strdup_printf ("compiled without write barriers, which the current GC requires.\n");
+		usable = FALSE;
+	}
+
 	safepoints = info->flags & MONO_AOT_FILE_FLAG_SAFEPOINTS;
 
 	if (!safepoints && mono_threads_is_coop_enabled ()) {
@@ -1923,8 +1987,79 @@ init_amodule_got (MonoAotModule *amodule)
 	mono_mempool_destroy (mp);
 }
 
+static guint32
+preload_thread (gpointer unused)
+{
+	MonoError error;
+	PreloadItem *item;
+
+	mono_thread_set_name_internal (mono_thread_internal_current (), mono_string_new (mono_get_root_domain (), "AOT preload"), FALSE, &error);
+	mono_error_assert_ok (&error);
+
+	while (!mono_runtime_is_shutting_down ()) {
+		mono_coop_mutex_lock (&aot_preload_mutex);
+		while (g_queue_is_empty (aot_preload_queue) && !mono_runtime_is_shutting_down ())
+			mono_coop_cond_wait (&aot_preload_cond, &aot_preload_mutex);
+		item = (PreloadItem *)g_queue_pop_head (aot_preload_queue);
+		mono_coop_mutex_unlock (&aot_preload_mutex);
+
+		if (!item)
+			continue;
+
+		/* This runs load_aot_module () for the dependency, which queues its own dependencies */
+		if (!item->amodule->image_table [item->index]) {
+			if (load_image (item->amodule, item->index, &error))
+				InterlockedIncrement (&aot_images_preloaded);
+			mono_error_cleanup (&error);
+		}
+		g_free (item);
+	}
+
+	return 0;
+}
+
+/*
+ * preload_dependencies:
+ *
+ *   Queue the images referenced by AMODULE for loading by the preload threads.
+ * Return whenever they were queued.
+ */
+static gboolean
+preload_dependencies (MonoAotModule *amodule)
+{
+	MonoError error;
+	int i;
+
+	/* Threads can't be created before the runtime is up, and assemblies loaded by the threads end up in the root domain */
+	if (!aot_preload_threads || !mono_thread_internal_current () || mono_domain_get () != mono_get_root_domain ())
+		return FALSE;
+
+	if (InterlockedCompareExchange (&aot_preload_threads_started, TRUE, FALSE) == FALSE) {
+		for (i = 0; i < aot_preload_threads; ++i) {
+			/* Created as threadpool threads so they are background threads which don't keep the runtime alive */
+			if (!mono_thread_create_internal (mono_get_root_domain (), preload_thread, NULL, TRUE, 0, &error))
+				g_error ("preload_dependencies: mono_thread_create_internal () failed due to %s", mono_error_get_message (&error));
+		}
+	}
+
+	mono_coop_mutex_lock (&aot_preload_mutex);
+	for (i = 0; i < amodule->image_table_len; ++i) {
+		PreloadItem *item;
+
+		if (amodule->image_table [i])
+			continue;
+		item = g_new0 (PreloadItem, 1);
+		item->amodule = amodule;
+		item->index = i;
+		g_queue_push_tail (aot_preload_queue, item);
+	}
+	mono_coop_cond_broadcast (&aot_preload_cond);
+	mono_coop_mutex_unlock (&aot_preload_mutex);
+	return TRUE;
+}
+
 static void
-load_aot_module (MonoAssembly *assembly, gpointer user_data)
+load_aot_module_inner (MonoAssembly *assembly, gpointer user_data)
 {
 	char *aot_name;
 	MonoAotModule *amodule;
@@ -2222,6 +2357,10 @@ load_aot_module (MonoAssembly *assembly, gpointer user_data)
 	}
 
 	g_hash_table_insert (aot_modules, assembly, amodule);
+	if (info->flags & MONO_AOT_FILE_FLAG_DEBUG)
+		debug_aot_loaded = TRUE;
+	if (info->flags & MONO_AOT_FILE_FLAG_DEDUP)
+		dedup_aot_module = amodule;
 	mono_aot_unlock ();
 
 	if (amodule->jit_code_start)
@@ -2270,10 +2409,24 @@ load_aot_module (MonoAssembly *assembly, gpointer user_data)
 	}
 #endif
 	if (do_load_image) {
-		for (i = 0; i < amodule->image_table_len; ++i) {
-			MonoError error;
-			load_image (amodule, i, &error);
-			mono_error_cleanup (&error); /* FIXME don't swallow the error */
+		if (preload_dependencies (amodule)) {
+			/*
+			 * The preload threads load the dependencies from the start of the table, and
+			 * queue their dependencies in turn, while this thread loads them from the end,
+			 * so the dependencies are mapped and validated in parallel. This still has to
+			 * wait for all of them to be loaded, see the comment above.
+			 */
+			for (i = amodule->image_table_len - 1; i >= 0; --i) {
+				MonoError error;
+				load_image (amodule, i, &error);
+				mono_error_cleanup (&error); /* FIXME don't swallow the error */
+			}
+		} else {
+			for (i = 0; i < amodule->image_table_len; ++i) {
+				MonoError error;
+				load_image (amodule, i, &error);
+				mono_error_cleanup (&error); /* FIXME don't swallow the error */
+			}
 		}
 	}
 
@@ -2286,6 +2439,21 @@ load_aot_module (MonoAssembly *assembly, gpointer user_data)
 		mono_trace (G_LOG_LEVEL_INFO, MONO_TRACE_AOT, "AOT: loaded AOT Module for %s.\n", assembly->image->name);
 }
 
+static void
+load_aot_module (MonoAssembly *assembly, gpointer user_data)
+{
+	MonoStartupTraceStamp trace_stamp;
+
+	if (G_LIKELY (!mono_startup_trace_enabled)) {
+		load_aot_module_inner (assembly, user_data);
+		return;
+	}
+
+	mono_startup_trace_begin (MONO_STARTUP_AOT_LOAD, &trace_stamp);
+	load_aot_module_inner (assembly, user_data);
+	mono_startup_trace_end (MONO_STARTUP_AOT_LOAD, &trace_stamp, assembly->aname.name);
+}
+
 /*
  * mono_aot_register_module:
  *
@@ -2333,6 +2501,13 @@ mono_aot_init (void)
 	mono_install_assembly_load_hook (load_aot_module, NULL);
 #endif
 	mono_counters_register ("Async JIT info size", MONO_COUNTER_INT|MONO_COUNTER_JIT, &async_jit_info_size);
+	mono_counters_register ("AOT GOT slots resolved", MONO_COUNTER_INT|MONO_COUNTER_JIT, &aot_got_slots_resolved);
+	mono_counters_register ("AOT GOT slots already resolved", MONO_COUNTER_INT|MONO_COUNTER_JIT, &aot_got_slots_shared);
+	mono_counters_register ("AOT IMT slots from cached info", MONO_COUNTER_INT|MONO_COUNTER_JIT, &aot_imt_slots_cached);
+	mono_counters_register ("AOT images preloaded", MONO_COUNTER_INT|MONO_COUNTER_JIT, &aot_images_preloaded);
+	mono_coop_mutex_init (&aot_preload_mutex);
+	mono_coop_cond_init (&aot_preload_cond);
+	aot_preload_queue = g_queue_new ();
 
 	if (g_getenv ("MONO_LASTAOT"))
 		mono_last_aot_method = atoi (g_getenv ("MONO_LASTAOT"));
@@ -2348,11 +2523,17 @@ mono_aot_cleanup (void)
 		g_hash_table_destroy (aot_modules);
 }
 
+/*
+ * decode_cached_class_info:
+ *
+ *   Decode the class info emitted by emit_klass_info () in aot-compiler.c. If IMT_INFO
+ * is not NULL, set it to the offset of the IMT info of the class plus one, or 0.
+ */
 static gboolean
-decode_cached_class_info (MonoAotModule *module, MonoCachedClassInfo *info, guint8 *buf, guint8 **endbuf)
+decode_cached_class_info (MonoAotModule *module, MonoCachedClassInfo *info, guint32 *imt_info, guint8 *buf, guint8 **endbuf)
 {
 	MonoError error;
-	guint32 flags;
+	guint32 flags, imt;
 	MethodRef ref;
 	gboolean res;
 
@@ -2391,6 +2572,9 @@ decode_cached_class_info (MonoAotModule *module, MonoCachedClassInfo *info, guin
 	info->class_size = decode_value (buf, &buf);
 	info->packing_size = decode_value (buf, &buf);
 	info->min_align = decode_value (buf, &buf);
+	imt = decode_value (buf, &buf);
+	if (imt_info)
+		*imt_info = imt;
 
 	*endbuf = buf;
 
@@ -2419,7 +2603,7 @@ mono_aot_get_method_from_vt_slot (MonoDomain *domain, MonoVTable *vtable, int sl
 	info = &amodule->blob [mono_aot_get_offset (amodule->class_info_offsets, mono_metadata_token_index (klass->type_token) - 1)];
 	p = info;
 
-	err = decode_cached_class_info (amodule, &class_info, p, &p);
+	err = decode_cached_class_info (amodule, &class_info, NULL, p, &p);
 	if (!err)
 		return NULL;
 
@@ -2454,13 +2638,76 @@ mono_aot_get_cached_class_info (MonoClass *klass, MonoCachedClassInfo *res)
 
 	p = (guint8*)&amodule->blob [mono_aot_get_offset (amodule->class_info_offsets, mono_metadata_token_index (klass->type_token) - 1)];
 
-	err = decode_cached_class_info (amodule, res, p, &p);
+	err = decode_cached_class_info (amodule, res, NULL, p, &p);
 	if (!err)
 		return FALSE;
 
 	return TRUE;
 }
 
+/*
+ * mono_aot_get_imt_slot_methods:
+ *
+ *   Add the interface methods of KLASS which are in IMT slot IMT_SLOT to METHODS, and
+ * their vtable slots to VT_SLOTS, using the info emitted by emit_klass_imt_info () in
+ * aot-compiler.c. Return FALSE if the info is not available.
+ */
+gboolean
+mono_aot_get_imt_slot_methods (MonoClass *klass, int imt_slot, GPtrArray *methods, GArray *vt_slots)
+{
+	MonoAotModule *amodule = (MonoAotModule *)klass->image->aot_module;
+	MonoCachedClassInfo class_info;
+	MonoError error;
+	guint32 imt_info, slot_info;
+	guint8 *p;
+	int i, n;
+
+	if (klass->rank || klass->generic_class || !amodule)
+		return FALSE;
+
+	p = (guint8*)&amodule->blob [mono_aot_get_offset (amodule->class_info_offsets, mono_metadata_token_index (klass->type_token) - 1)];
+	if (!decode_cached_class_info (amodule, &class_info, &imt_info, p, &p) || !imt_info)
+		return FALSE;
+
+	p = (guint8*)&amodule->blob [imt_info - 1];
+	for (i = 0; i < imt_slot; ++i)
+		decode_value (p, &p);
+	slot_info = decode_value (p, &p);
+	if (!slot_info)
+		/* No methods in this slot */
+		return TRUE;
+
+	p = (guint8*)&amodule->blob [slot_info - 1];
+	n = decode_value (p, &p);
+	for (i = 0; i < n; ++i) {
+		MonoClass *iface;
+		MonoMethod *method;
+		int method_index, slot, offset;
+
+		iface = decode_klass_ref (amodule, p, &p, &error);
+		if (!iface) {
+			mono_error_cleanup (&error);
+			return FALSE;
+		}
+		method_index = decode_value (p, &p);
+		slot = decode_value (p, &p);
+
+		offset = mono_class_interface_offset (klass, iface);
+		if (offset < 0)
+			return FALSE;
+		method = mono_class_get_method_by_index (iface, method_index);
+		if (!method)
+			return FALSE;
+		g_ptr_array_add (methods, method);
+		offset += slot;
+		g_array_append_val (vt_slots, offset);
+	}
+
+	InterlockedIncrement (&aot_imt_slots_cached);
+
+	return TRUE;
+}
+
 /**
  * mono_aot_get_class_from_name:
  *
@@ -3209,6 +3456,116 @@ msort_method_addresses (gpointer *array, int *indexes, int len)
 	g_free (scratch_indexes);
 }
 
+static inline guint8*
+method_code_end (MonoAotModule *amodule, guint8 *code)
+{
+	if (code >= amodule->jit_code_start && code < amodule->jit_code_end)
+		return amodule->jit_code_end;
+	else
+		return amodule->llvm_code_end;
+}
+
+/*
+ * create_method_address_index:
+ *
+ *   Create a table mapping code addresses to the methods of AMODULE. The methods
+ * are distributed into fixed size buckets by their address, which sorts them in
+ * linear time since each bucket only holds a few methods, and the buckets give
+ * O(1) lookups afterwards. If the code is too sparse, i.e. the llvm and jit code
+ * ranges are far apart, fall back to sorting and binary searching.
+ */
+static MethodAddressIndex*
+create_method_address_index (MonoAotModule *amodule)
+{
+	MethodAddressIndex *index = g_new0 (MethodAddressIndex, 1);
+	int nmethods = amodule->info.nmethods;
+	gpointer *methods = g_new0 (gpointer, nmethods);
+	int *method_indexes = g_new0 (int, nmethods);
+	int methods_len = 0, i, j, b, pos, nbuckets;
+	guint8 *lo, *hi;
+	gint32 *buckets = NULL;
+
+	lo = (guint8 *)-1;
+	hi = NULL;
+	for (i = 0; i < nmethods; ++i) {
+		guint8 *code = (guint8 *)amodule->methods [i];
+
+		/* Skip the -1 entries to speed up sorting */
+		if (code == GINT_TO_POINTER (-1))
+			continue;
+		lo = MIN (lo, code);
+		hi = MAX (hi, method_code_end (amodule, code));
+		methods_len ++;
+	}
+
+	nbuckets = methods_len ? ((hi - lo) >> METHOD_ADDRESS_BUCKET_SHIFT) + 1 : 0;
+	if (methods_len && nbuckets <= methods_len * 8 + 1024) {
+		/* Counting sort by bucket, buckets [b + 1] is the number of methods in bucket B */
+		buckets = g_new0 (gint32, nbuckets + 1);
+		for (i = 0; i < nmethods; ++i) {
+			guint8 *code = (guint8 *)amodule->methods [i];
+
+			if (code != GINT_TO_POINTER (-1))
+				buckets [((code - lo) >> METHOD_ADDRESS_BUCKET_SHIFT) + 1] ++;
+		}
+		for (b = 0; b < nbuckets; ++b)
+			buckets [b + 1] += buckets [b];
+		/* buckets [b] is now the next free position in bucket B */
+		for (i = 0; i < nmethods; ++i) {
+			guint8 *code = (guint8 *)amodule->methods [i];
+
+			if (code == GINT_TO_POINTER (-1))
+				continue;
+			pos = buckets [(code - lo) >> METHOD_ADDRESS_BUCKET_SHIFT] ++;
+			methods [pos] = code;
+			method_indexes [pos] = i;
+		}
+		/* Every bucket is small, sort them using insertion sort */
+		for (i = 1; i < methods_len; ++i) {
+			gpointer m = methods [i];
+			int mi = method_indexes [i];
+
+			for (j = i; j > 0 && methods [j - 1] > m; --j) {
+				methods [j] = methods [j - 1];
+				method_indexes [j] = method_indexes [j - 1];
+			}
+			methods [j] = m;
+			method_indexes [j] = mi;
+		}
+		/* Compute the method covering the start of each bucket */
+		pos = -1;
+		for (b = 0; b < nbuckets; ++b) {
+			guint8 *bucket_start = lo + ((gsize)b << METHOD_ADDRESS_BUCKET_SHIFT);
+
+			while (pos + 1 < methods_len && (guint8 *)methods [pos + 1] <= bucket_start)
+				pos ++;
+			buckets [b] = pos;
+		}
+	} else {
+		methods_len = 0;
+		for (i = 0; i < nmethods; ++i) {
+			if (amodule->methods [i] == GINT_TO_POINTER (-1))
+				continue;
+			methods [methods_len] = amodule->methods [i];
+			method_indexes [methods_len] = i;
+			methods_len ++;
+		}
+		/* Use a merge sort as this is mostly sorted */
+		msort_method_addresses (methods, method_indexes, methods_len);
+	}
+	for (i = 0; i < methods_len - 1; ++i)
+		g_assert (methods [i] <= methods [i + 1]);
+
+	index->methods = methods;
+	index->method_indexes = method_indexes;
+	index->len = methods_len;
+	index->buckets = buckets;
+	index->bucket_base = lo;
+	index->nbuckets = nbuckets;
+	mono_memory_barrier ();
+	return index;
+}
+
 /*
  * mono_aot_find_jit_info:
  *
@@ -3228,17 +3585,15 @@ mono_aot_find_jit_info (MonoDomain *domain, MonoImage *image, gpointer addr)
 	MonoJitInfo *jinfo;
 	guint8 *code, *ex_info, *p;
 	guint32 *table;
-	int nmethods;
 	gpointer *methods;
 	guint8 *code1, *code2;
 	int methods_len, i;
 	gboolean async;
+	MethodAddressIndex *index;
 
 	if (!amodule)
 		return NULL;
 
-	nmethods = amodule->info.nmethods;
-
 	if (domain != mono_get_root_domain ())
 		/* FIXME: */
 		return NULL;
@@ -3249,64 +3604,63 @@ mono_aot_find_jit_info (MonoDomain *domain, MonoImage *image, gpointer addr)
 	async = mono_thread_info_is_async_context ();
 
 	/* Compute a sorted table mapping code to method indexes. */
-	if (!amodule->sorted_methods) {
+	if (!amodule->method_address_index) {
 		// FIXME: async
-		gpointer *methods = g_new0 (gpointer, nmethods);
-		int *method_indexes = g_new0 (int, nmethods);
-		int methods_len = 0;
-
-		for (i = 0; i < nmethods; ++i) {
-			/* Skip the -1 entries to speed up sorting */
-			if (amodule->methods [i] == GINT_TO_POINTER (-1))
-				continue;
-			methods [methods_len] = amodule->methods [i];
-			method_indexes [methods_len] = i;
-			methods_len ++;
-		}
-		/* Use a merge sort as this is mostly sorted */
-		msort_method_addresses (methods, method_indexes, methods_len);
-		for (i = 0; i < methods_len -1; ++i)
-			g_assert (methods [i] <= methods [i + 1]);
-		amodule->sorted_methods_len = methods_len;
-		if (InterlockedCompareExchangePointer ((gpointer*)&amodule->sorted_methods, methods, NULL) != NULL)
-			/* Somebody got in before us */
-			g_free (methods);
-		if (InterlockedCompareExchangePointer ((gpointer*)&amodule->sorted_method_indexes, method_indexes, NULL) != NULL)
+		index = create_method_address_index (amodule);
+		if (InterlockedCompareExchangePointer ((gpointer*)&amodule->method_address_index, index, NULL) != NULL) {
 			/* Somebody got in before us */
-			g_free (method_indexes);
+			g_free (index->methods);
+			g_free (index->method_indexes);
+			g_free (index->buckets);
+			g_free (index);
+		}
 	}
 
-	/* Binary search in the sorted_methods table */
-	methods = amodule->sorted_methods;
-	methods_len = amodule->sorted_methods_len;
+	index = amodule->method_address_index;
+	methods = index->methods;
+	methods_len = index->len;
+	if (!methods_len)
+		return NULL;
 	code = (guint8 *)addr;
-	left = 0;
-	right = methods_len;
-	while (TRUE) {
-		pos = (left + right) / 2;
+	if (index->buckets) {
+		/* Start from the method covering the start of the bucket containing CODE, and scan forward */
+		if (code < index->bucket_base || ((code - index->bucket_base) >> METHOD_ADDRESS_BUCKET_SHIFT) >= index->nbuckets)
+			return NULL;
+		pos = index->buckets [(code - index->bucket_base) >> METHOD_ADDRESS_BUCKET_SHIFT];
+		if (pos == -1)
+			return NULL;
+		while (pos + 1 < methods_len && code >= (guint8 *)methods [pos + 1])
+			pos ++;
+	} else {
+		/* Binary search in the sorted methods table */
+		left = 0;
+		right = methods_len;
+		while (TRUE) {
+			pos = (left + right) / 2;
+
+			code1 = (guint8 *)methods [pos];
+			if (pos + 1 == methods_len) {
+				if (code1 >= amodule->jit_code_start && code1 < amodule->jit_code_end)
+					code2 = amodule->jit_code_end;
+				else
+					code2 = amodule->llvm_code_end;
+			} else {
+				code2 = (guint8 *)methods [pos + 1];
+			}
 
-		code1 = (guint8 *)methods [pos];
-		if (pos + 1 == methods_len) {
-			if (code1 >= amodule->jit_code_start && code1 < amodule->jit_code_end)
-				code2 = amodule->jit_code_end;
+			if (code < code1)
+				right = pos;
+			else if (code >= code2)
+				left = pos + 1;
 			else
-				code2 = amodule->llvm_code_end;
-		} else {
-			code2 = (guint8 *)methods [pos + 1];
+				break;
 		}
-
-		if (code < code1)
-			right = pos;
-		else if (code >= code2)
-			left = pos + 1;
-		else
-			break;
 	}
 
 	g_assert (addr >= methods [pos]);
 	if (pos + 1 < methods_len)
 		g_assert (addr < methods [pos + 1]);
-	method_index = amodule->sorted_method_indexes [pos];
+	method_index = index->method_indexes [pos];
 
 	/* In async mode, jinfo is not added to the normal jit info table, so have to cache it ourselves */
 	if (async) {
@@ -3952,6 +4306,14 @@ load_method (MonoDomain *domain, MonoAotModule *amodule, MonoImage *image, MonoM
 
 	amodule_unlock (amodule);
 
+	if (mono_jit_map_is_enabled ()) {
+		/* AOT images usually have no symbols for their methods */
+		MonoJitInfo *ji = mono_jit_info_table_find (domain, (char*)code);
+
+		if (ji)
+			mono_emit_jit_map (ji);
+	}
+
 	if (mono_profiler_get_events () & MONO_PROFILE_JIT_COMPILATION) {
 		MonoJitInfo *jinfo;
 
@@ -4099,6 +4461,15 @@ find_aot_method (MonoMethod *method, MonoAotModule **out_amodule)
 	if (index != 0xffffff)
 		return index;
 
+	/* Try the dedup module next, since most of the methods not in their own module are there */
+	if (dedup_aot_module && dedup_aot_module != method->klass->image->aot_module) {
+		index = find_aot_method_in_amodule (dedup_aot_module, method, hash);
+		if (index != 0xffffff) {
+			*out_amodule = dedup_aot_module;
+			return index;
+		}
+	}
+
 	/* 
 	 * Try all other modules.
 	 * This is needed because generic instances klass->image points to the image
@@ -4116,7 +4487,7 @@ find_aot_method (MonoMethod *method, MonoAotModule **out_amodule)
 	for (i = 0; i < modules->len; ++i) {
 		MonoAotModule *amodule = (MonoAotModule *)g_ptr_array_index (modules, i);
 
-		if (amodule != method->klass->image->aot_module)
+		if (amodule != method->klass->image->aot_module && amodule != dedup_aot_module)
 			index = find_aot_method_in_amodule (amodule, method, hash);
 		if (index != 0xffffff) {
 			*out_amodule = amodule;
@@ -4169,73 +4540,100 @@ init_method (MonoAotModule *amodule, guint32 method_index, MonoMethod *method, M
 
 	if (n_patches) {
 		MonoJumpInfo *patches;
-		guint32 *got_slots;
-		gboolean llvm;
+		guint32 got_slots_buf [64];
+		guint32 *got_slots, *got_info_offsets;
+		gboolean llvm, res = TRUE;
 		gpointer *got;
-
-		mp = mono_mempool_new ();
+		int n_unresolved;
 
 		if ((gpointer)code >= amodule->info.jit_code_start && (gpointer)code <= amodule->info.jit_code_end) {
 			llvm = FALSE;
 			got = amodule->got;
+			got_info_offsets = amodule->got_info_offsets;
 		} else {
 			llvm = TRUE;
 			got = amodule->llvm_got;
+			got_info_offsets = amodule->llvm_got_info_offsets;
 			g_assert (got);
 		}
 
-		patches = load_patch_info (amodule, mp, n_patches, llvm, &got_slots, p, &p);
-		if (patches == NULL) {
-			mono_mempool_destroy (mp);
-			goto cleanup;
+		/*
+		 * Most GOT slots are shared with the methods loaded earlier, so only collect
+		 * the slots which still need to be resolved, this avoids decoding their patches
+		 * and creating a mempool when a method only references resolved slots.
+		 */
+		got_slots = n_patches <= G_N_ELEMENTS (got_slots_buf) ? got_slots_buf : g_new (guint32, n_patches);
+		n_unresolved = 0;
+		for (pindex = 0; pindex < n_patches; ++pindex) {
+			guint32 got_slot = decode_value (p, &p);
+
+			/* See below for SFLDA */
+			if (got [got_slot] && decode_value (amodule->blob + mono_aot_get_offset (got_info_offsets, got_slot), NULL) != MONO_PATCH_INFO_SFLDA)
+				continue;
+			got_slots [n_unresolved ++] = got_slot;
 		}
+		InterlockedExchangeAdd (&aot_got_slots_shared, n_patches - n_unresolved);
+		InterlockedExchangeAdd (&aot_got_slots_resolved, n_unresolved);
 
-		for (pindex = 0; pindex < n_patches; ++pindex) {
-			MonoJumpInfo *ji = &patches [pindex];
-			gpointer addr;
+		if (n_unresolved) {
+			mp = mono_mempool_new ();
 
-			/*
-			 * For SFLDA, we need to call resolve_patch_target () since the GOT slot could have
-			 * been initialized by load_method () for a static cctor before the cctor has
-			 * finished executing (#23242).
-			 */
-			if (!got [got_slots [pindex]] || ji->type == MONO_PATCH_INFO_SFLDA) {
-				/* In llvm-only made, we might encounter shared methods */
-				if (mono_llvm_only && ji->type == MONO_PATCH_INFO_METHOD && mono_method_check_context_used (ji->data.method)) {
-					g_assert (context);
-					ji->data.method = mono_class_inflate_generic_method_checked (ji->data.method, context, error);
+			patches = decode_patches (amodule, mp, n_unresolved, llvm, got_slots);
+			if (patches == NULL) {
+				mono_mempool_destroy (mp);
+				if (got_slots != got_slots_buf)
+					g_free (got_slots);
+				goto cleanup;
+			}
+
+			for (pindex = 0; pindex < n_unresolved; ++pindex) {
+				MonoJumpInfo *ji = &patches [pindex];
+				gpointer addr;
+
+				/*
+				 * For SFLDA, we need to call resolve_patch_target () since the GOT slot could have
+				 * been initialized by load_method () for a static cctor before the cctor has
+				 * finished executing (#23242).
+				 */
+				if (!got [got_slots [pindex]] || ji->type == MONO_PATCH_INFO_SFLDA) {
+					/* In llvm-only made, we might encounter shared methods */
+					if (mono_llvm_only && ji->type == MONO_PATCH_INFO_METHOD && mono_method_check_context_used (ji->data.method)) {
+						g_assert (context);
+						ji->data.method = mono_class_inflate_generic_method_checked (ji->data.method, context, error);
+						if (!mono_error_ok (error)) {
+							res = FALSE;
+							break;
+						}
+					}
+					/* This cannot be resolved in mono_resolve_patch_target () */
+					if (ji->type == MONO_PATCH_INFO_AOT_JIT_INFO) {
+						// FIXME: Lookup using the index
+						jinfo = mono_aot_find_jit_info (domain, amodule->assembly->image, code);
+						ji->type = MONO_PATCH_INFO_ABS;
+						ji->data.target = jinfo;
+					}
+					addr = mono_resolve_patch_target (method, domain, code, ji, TRUE, error);
 					if (!mono_error_ok (error)) {
-						g_free (got_slots);
-						mono_mempool_destroy (mp);
-						return FALSE;
+						res = FALSE;
+						break;
 					}
+					if (ji->type == MONO_PATCH_INFO_METHOD_JUMP)
+						addr = mono_create_ftnptr (domain, addr);
+					mono_memory_barrier ();
+					got [got_slots [pindex]] = addr;
+					if (ji->type == MONO_PATCH_INFO_METHOD_JUMP)
+						register_jump_target_got_slot (domain, ji->data.method, &(got [got_slots [pindex]]));
 				}
-				/* This cannot be resolved in mono_resolve_patch_target () */
-				if (ji->type == MONO_PATCH_INFO_AOT_JIT_INFO) {
-					// FIXME: Lookup using the index
-					jinfo = mono_aot_find_jit_info (domain, amodule->assembly->image, code);
-					ji->type = MONO_PATCH_INFO_ABS;
-					ji->data.target = jinfo;
-				}
-				addr = mono_resolve_patch_target (method, domain, code, ji, TRUE, error);
-				if (!mono_error_ok (error)) {
-					g_free (got_slots);
-					mono_mempool_destroy (mp);
-					return FALSE;
-				}
-				if (ji->type == MONO_PATCH_INFO_METHOD_JUMP)
-					addr = mono_create_ftnptr (domain, addr);
-				mono_memory_barrier ();
-				got [got_slots [pindex]] = addr;
-				if (ji->type == MONO_PATCH_INFO_METHOD_JUMP)
-					register_jump_target_got_slot (domain, ji->data.method, &(got [got_slots [pindex]]));
+				ji->type = MONO_PATCH_INFO_NONE;
 			}
-			ji->type = MONO_PATCH_INFO_NONE;
-		}
 
-		g_free (got_slots);
+			mono_mempool_destroy (mp);
+		}
 
-		mono_mempool_destroy (mp);
+		if (got_slots != got_slots_buf)
+			g_free (got_slots);
+		if (!res)
+			return FALSE;
 	}
 
 	if (mini_get_debug_options ()->load_aot_jit_info_eagerly)
@@ -5727,6 +6125,18 @@ mono_aot_get_gsharedvt_arg_trampoline (gpointer arg, gpointer addr)
 	return mono_create_ftnptr (mono_domain_get (), code);
 }
  
+/*
+ * mono_aot_set_preload_threads:
+ *
+ *   Set the number of threads used to load the dependencies of AOT modules in the
+ * background, 0 disables preloading.
+ */
+void
+mono_aot_set_preload_threads (int count)
+{
+	aot_preload_threads = CLAMP (count, 0, AOT_PRELOAD_MAX_THREADS);
+}
+
 /*
  * mono_aot_set_make_unreadable:
  *
@@ -5779,6 +6189,32 @@ find_module_for_addr (void *ptr)
 	return data.module;
 }
 
+/*
+ * mono_aot_has_debug_images:
+ *
+ *   Return whenever AOT code containing sequence points might be executed.
+ */
+gboolean
+mono_aot_has_debug_images (void)
+{
+	return debug_aot_loaded || mono_aot_only;
+}
+
+/*
+ * mono_aot_get_image_code_size:
+ *
+ *   Return the size of the memory mapped for the AOT code of IMAGE, 0 if it has none.
+ */
+guint32
+mono_aot_get_image_code_size (MonoImage *image)
+{
+	MonoAotModule *amodule = (MonoAotModule *)image->aot_module;
+
+	if (!amodule)
+		return 0;
+	return amodule->mem_end - amodule->mem_begin;
+}
+
 /*
  * mono_aot_is_pagefault:
  *
@@ -5885,6 +6321,12 @@ mono_aot_get_cached_class_info (MonoClass *klass, MonoCachedClassInfo *res)
 	return FALSE;
 }
 
+gboolean
+mono_aot_get_imt_slot_methods (MonoClass *klass, int imt_slot, GPtrArray *methods, GArray *vt_slots)
+{
+	return FALSE;
+}
+
 gboolean
 mono_aot_get_class_from_name (MonoImage *image, const char *name_space, const char *name, MonoClass **klass)
 {
@@ -5993,11 +6435,28 @@ mono_aot_get_gsharedvt_arg_trampoline (gpointer arg, gpointer addr)
 	return NULL;
 }
 
+void
+mono_aot_set_preload_threads (int count)
+{
+}
+
 void
 mono_aot_set_make_unreadable (gboolean unreadable)
 {
 }
 
+gboolean
+mono_aot_has_debug_images (void)
+{
+	return FALSE;
+}
+
+guint32
+mono_aot_get_image_code_size (MonoImage *image)
+{
+	return 0;
+}
+
 gboolean
 mono_aot_is_pagefault (void *ptr)
 {
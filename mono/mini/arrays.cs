@@ -548,6 +548,43 @@ class Tests
 		return 0;
 	}
 
+	public static int test_0_rank_3_4_array_access () {
+		int[,,] a = (int[,,]) Array.CreateInstance (typeof (int), new int[] { 2, 3, 4 }, new int[] { 1, -1, 5 });
+		long[,,,] b = new long [2, 3, 4, 5];
+
+		for (int i = 1; i < 3; ++i)
+			for (int j = -1; j < 2; ++j)
+				for (int k = 5; k < 9; ++k)
+					a [i, j, k] = i * 100 + j * 10 + k;
+		if (a [2, 1, 8] != 218 || a [1, -1, 5] != 95)
+			return 1;
+		if ((int) a.GetValue (new int [] { 2, 0, 6 }) != 206)
+			return 2;
+
+		for (int i = 0; i < 2; ++i)
+			for (int j = 0; j < 3; ++j)
+				for (int k = 0; k < 4; ++k)
+					for (int l = 0; l < 5; ++l)
+						b [i, j, k, l] = ((i * 3 + j) * 4 + k) * 5 + l;
+		for (int i = 0; i < b.Length; ++i)
+			if ((long) b.GetValue (i / 60, (i / 20) % 3, (i / 5) % 4, i % 5) != i)
+				return 3;
+
+		try {
+			a [1, 2, 5] = 0;
+			return 4;
+		} catch (IndexOutOfRangeException) { }
+		try {
+			a [1, 0, 4] = 0;
+			return 5;
+		} catch (IndexOutOfRangeException) { }
+		try {
+			b [0, 0, 0, 5] = 0;
+			return 6;
+		} catch (IndexOutOfRangeException) { }
+		return 0;
+	}
+
 	public static int test_0_multidym_array_with_negative_lower_bound () {
 		int[,] x = (int[,]) Array.CreateInstance(typeof (int), new int[] { 2, 2 }, new int[] { -2, -3 });
 
@@ -806,6 +843,164 @@ class Tests
 			arr [i] = 1;
 		return llvm_ldlen_licm (arr);
 	}
+
+	/* Loops the vectorizer handles, see vectorize.c */
+
+	static void vec_add (int[] a, int[] b, int[] c) {
+		for (int i = 0; i < a.Length; ++i)
+			c [i] = a [i] + b [i];
+	}
+
+	static void vec_mul_add_const (int[] a, int[] c, int k) {
+		for (int i = 0; i < a.Length; ++i)
+			c [i] = a [i] * k + 7;
+	}
+
+	static void vec_sub_short (short[] a, short[] b, short[] c) {
+		for (int i = 0; i < a.Length; ++i)
+			c [i] = (short)(a [i] - b [i]);
+	}
+
+	static void vec_xor_byte (byte[] a, byte[] b, byte[] c) {
+		for (int i = 0; i < a.Length; ++i)
+			c [i] = (byte)(a [i] ^ b [i]);
+	}
+
+	static void vec_mul_float (float[] a, float[] b, float[] c) {
+		for (int i = 0; i < a.Length; ++i)
+			c [i] = a [i] * b [i];
+	}
+
+	/* Covers several vector iterations followed by 0 to 31 scalar ones */
+	const int vec_max_len = 70;
+
+	public static int test_0_vectorize_int_add () {
+		for (int len = 0; len < vec_max_len; ++len) {
+			int[] a = new int [len], b = new int [len], c = new int [len];
+			for (int i = 0; i < len; ++i) {
+				a [i] = i;
+				b [i] = 2 * i - 1000;
+			}
+			vec_add (a, b, c);
+			for (int i = 0; i < len; ++i) {
+				if (c [i] != 3 * i - 1000)
+					return len * 100 + i + 1;
+			}
+		}
+		return 0;
+	}
+
+	public static int test_0_vectorize_mul_add_const () {
+		for (int len = 0; len < vec_max_len; ++len) {
+			int[] a = new int [len], c = new int [len];
+			for (int i = 0; i < len; ++i)
+				a [i] = i - 10;
+			vec_mul_add_const (a, c, -3);
+			for (int i = 0; i < len; ++i) {
+				if (c [i] != (i - 10) * -3 + 7)
+					return len * 100 + i + 1;
+			}
+		}
+		return 0;
+	}
+
+	public static int test_0_vectorize_short_sub_wraps () {
+		for (int len = 0; len < vec_max_len; ++len) {
+			short[] a = new short [len], b = new short [len], c = new short [len];
+			for (int i = 0; i < len; ++i) {
+				a [i] = (short)(short.MinValue + i);
+				b [i] = (short)(i * 3 + 1);
+			}
+			vec_sub_short (a, b, c);
+			for (int i = 0; i < len; ++i) {
+				if (c [i] != (short)(a [i] - b [i]))
+					return len * 100 + i + 1;
+			}
+		}
+		return 0;
+	}
+
+	public static int test_0_vectorize_byte_xor () {
+		for (int len = 0; len < vec_max_len; ++len) {
+			byte[] a = new byte [len], b = new byte [len], c = new byte [len];
+			for (int i = 0; i < len; ++i) {
+				a [i] = (byte)(i * 7);
+				b [i] = (byte)(0xa5 + i);
+			}
+			vec_xor_byte (a, b, c);
+			for (int i = 0; i < len; ++i) {
+				if (c [i] != (byte)(a [i] ^ b [i]))
+					return len * 100 + i + 1;
+			}
+		}
+		return 0;
+	}
+
+	public static int test_0_vectorize_float_mul () {
+		for (int len = 0; len < vec_max_len; ++len) {
+			float[] a = new float [len], b = new float [len], c = new float [len];
+			for (int i = 0; i < len; ++i) {
+				a [i] = i + 0.5f;
+				b [i] = -0.25f * i;
+			}
+			vec_mul_float (a, b, c);
+			for (int i = 0; i < len; ++i) {
+				if (c [i] != a [i] * b [i])
+					return len * 100 + i + 1;
+			}
+		}
+		return 0;
+	}
+
+	public static int test_0_vectorize_aliased () {
+		for (int len = 0; len < vec_max_len; ++len) {
+			int[] a = new int [len], b = new int [len];
+
+			/* The destination is also both sources */
+			for (int i = 0; i < len; ++i)
+				a [i] = i;
+			vec_add (a, a, a);
+			for (int i = 0; i < len; ++i) {
+				if (a [i] != 2 * i)
+					return len * 100 + i + 1;
+			}
+
+			/* The destination is one of the sources */
+			for (int i = 0; i < len; ++i) {
+				a [i] = i;
+				b [i] = 5;
+			}
+			vec_add (a, b, b);
+			for (int i = 0; i < len; ++i) {
+				if (b [i] != i + 5)
+					return 10000 + len * 100 + i + 1;
+			}
+		}
+		return 0;
+	}
+
+	public static int test_0_vectorize_short_source_throws () {
+		for (int len = 1; len < vec_max_len; ++len) {
+			int[] a = new int [len], b = new int [len - 1], c = new int [len];
+			for (int i = 0; i < len; ++i)
+				a [i] = i;
+			for (int i = 0; i < len - 1; ++i)
+				b [i] = 1;
+			try {
+				vec_add (a, b, c);
+				return len * 100 + 99;
+			} catch (IndexOutOfRangeException) {
+			}
+			/* Every element before the faulting one is stored, none after it */
+			for (int i = 0; i < len - 1; ++i) {
+				if (c [i] != i + 1)
+					return len * 100 + i + 1;
+			}
+			if (c [len - 1] != 0)
+				return len * 100 + 98;
+		}
+		return 0;
+	}
 }
 
 
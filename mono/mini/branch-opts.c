@@ -9,6 +9,7 @@
  * Licensed under the MIT license. See LICENSE file in the project root for full license information.
  */
  #include "mini.h"
+#include "ir-emit.h"
 
 #ifndef DISABLE_JIT
  
@@ -1478,4 +1479,377 @@ mono_optimize_branches (MonoCompile *cfg)
 	} while (changed && (niterations > 0));
 }
 
+/* A case of a compare chain, the chain branches to TARGET if the value is VALUE */
+typedef struct {
+	gint32 value;
+	MonoBasicBlock *target;
+	/* Position of the test in the chain */
+	int order;
+	/* Whenever the case is handled by a bit test */
+	gboolean bit_test;
+} ChainCase;
+
+/* Minimum number of cases with the same target which are lowered to a bit test */
+#define CHAIN_MIN_BIT_TEST_CASES 3
+/* Minimum number of cases which are lowered to a binary search */
+#define CHAIN_MIN_BINARY_SEARCH_CASES 8
+/* Binary search leaves with at most this many cases are tested linearly */
+#define CHAIN_MAX_LINEAR_CASES 3
+
+/*
+ * chain_get_test:
+ *
+ *   If BB ends with a 'value == imm' test, return the compare, and set OUT_VALUE,
+ * OUT_TARGET and OUT_NEXT to the constant, the bblock branched to if the test succeeds,
+ * and the one branched to otherwise.
+ */
+static MonoInst*
+chain_get_test (MonoBasicBlock *bb, gint32 *out_value, MonoBasicBlock **out_target, MonoBasicBlock **out_next)
+{
+	MonoInst *branch = bb->last_ins;
+	MonoInst *cmp;
+
+	if (!branch || !(branch->opcode == OP_IBEQ || branch->opcode == OP_IBNE_UN))
+		return NULL;
+	cmp = branch->prev;
+	if (!cmp || cmp->opcode != OP_ICOMPARE_IMM)
+		return NULL;
+	if (!branch->inst_true_bb || !branch->inst_false_bb || branch->inst_true_bb == branch->inst_false_bb)
+		return NULL;
+
+	*out_value = (gint32)cmp->inst_imm;
+	if (branch->opcode == OP_IBEQ) {
+		*out_target = branch->inst_true_bb;
+		*out_next = branch->inst_false_bb;
+	} else {
+		*out_target = branch->inst_false_bb;
+		*out_next = branch->inst_true_bb;
+	}
+	return cmp;
+}
+
+/*
+ * chain_is_test_bblock:
+ *
+ *   Return whenever BB contains nothing but the test ending it, so it can be removed
+ * when the chain it belongs to is lowered.
+ */
+static gboolean
+chain_is_test_bblock (MonoBasicBlock *bb, MonoInst *cmp)
+{
+	MonoInst *ins;
+
+	for (ins = bb->code; ins != cmp; ins = ins->next) {
+		if (ins->opcode != OP_NOP && ins->opcode != OP_IL_SEQ_POINT)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static int
+chain_case_compare (const void *a, const void *b)
+{
+	const ChainCase *ca = (const ChainCase *)a;
+	const ChainCase *cb = (const ChainCase *)b;
+
+	return ca->value < cb->value ? -1 : (ca->value > cb->value ? 1 : 0);
+}
+
+static int
+chain_case_compare_order (const void *a, const void *b)
+{
+	const ChainCase *ca = (const ChainCase *)a;
+	const ChainCase *cb = (const ChainCase *)b;
+
+	return ca->order - cb->order;
+}
+
+static MonoBasicBlock*
+chain_new_bblock (MonoCompile *cfg, MonoBasicBlock *head, MonoBasicBlock **prev)
+{
+	MonoBasicBlock *bb = (MonoBasicBlock *)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoBasicBlock));
+
+	bb->block_num = cfg->num_bblocks++;
+	bb->region = head->region;
+	bb->real_offset = head->real_offset;
+	bb->next_bb = (*prev)->next_bb;
+	(*prev)->next_bb = bb;
+	*prev = bb;
+	return bb;
+}
+
+/*
+ * chain_emit_bit_test:
+ *
+ *   Emit a test branching to TARGET if SREG is one of the N sorted CASES, which span
+ * less than 32 values, and continue in a new bblock otherwise.
+ */
+static void
+chain_emit_bit_test (MonoCompile *cfg, MonoBasicBlock *head, MonoBasicBlock **prev, int sreg, ChainCase *cases, int n, MonoBasicBlock *target)
+{
+	MonoBasicBlock *test_bb, *next_bb;
+	guint32 mask = 0;
+	gint32 min = cases [0].value;
+	int i, index_reg, one_reg, bit_reg;
+
+	for (i = 0; i < n; ++i)
+		mask |= 1U << (cases [i].value - min);
+
+	test_bb = chain_new_bblock (cfg, head, prev);
+	next_bb = chain_new_bblock (cfg, head, prev);
+
+	/* Local vregs can't be used in more than one bblock at this point, so compute the index twice */
+	index_reg = alloc_ireg (cfg);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISUB_IMM, index_reg, sreg, min);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, index_reg, cases [n - 1].value - min);
+	MONO_EMIT_NEW_BRANCH_BLOCK2 (cfg, OP_IBGT_UN, next_bb, test_bb);
+
+	cfg->cbb = test_bb;
+	index_reg = alloc_ireg (cfg);
+	one_reg = alloc_ireg (cfg);
+	bit_reg = alloc_ireg (cfg);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISUB_IMM, index_reg, sreg, min);
+	MONO_EMIT_NEW_ICONST (cfg, one_reg, 1);
+	MONO_EMIT_NEW_BIALU (cfg, OP_ISHL, bit_reg, one_reg, index_reg);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IAND_IMM, bit_reg, bit_reg, mask);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, bit_reg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK2 (cfg, OP_IBNE_UN, target, next_bb);
+
+	cfg->cbb = next_bb;
+}
+
+/*
+ * chain_emit_linear:
+ *
+ *   Emit a test for each of the N CASES in order, branching to DEFAULT_BB if none
+ * matches SREG.
+ */
+static void
+chain_emit_linear (MonoCompile *cfg, MonoBasicBlock *head, MonoBasicBlock **prev, int sreg, ChainCase *cases, int n, MonoBasicBlock *default_bb)
+{
+	MonoBasicBlock *next_bb;
+	MonoInst *ins;
+	int i;
+
+	if (n == 0) {
+		MONO_INST_NEW (cfg, ins, OP_BR);
+		ins->inst_target_bb = default_bb;
+		MONO_ADD_INS (cfg->cbb, ins);
+		mono_link_bblock (cfg, cfg->cbb, default_bb);
+		return;
+	}
+
+	for (i = 0; i < n; ++i) {
+		next_bb = (i == n - 1) ? default_bb : chain_new_bblock (cfg, head, prev);
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, sreg, cases [i].value);
+		MONO_EMIT_NEW_BRANCH_BLOCK2 (cfg, OP_IBEQ, cases [i].target, next_bb);
+		cfg->cbb = next_bb;
+	}
+}
+
+/*
+ * chain_emit_search:
+ *
+ *   Emit code branching to the target of the case of the N sorted CASES matching SREG,
+ * or to DEFAULT_BB if there is none. This is a binary search on the case values,
+ * with linear tests at the leaves.
+ */
+static void
+chain_emit_search (MonoCompile *cfg, MonoBasicBlock *head, MonoBasicBlock **prev, int sreg, ChainCase *cases, int n, MonoBasicBlock *default_bb)
+{
+	MonoBasicBlock *left_bb, *right_bb;
+	int mid;
+
+	if (n <= CHAIN_MAX_LINEAR_CASES) {
+		chain_emit_linear (cfg, head, prev, sreg, cases, n, default_bb);
+		return;
+	}
+
+	mid = n / 2;
+	left_bb = chain_new_bblock (cfg, head, prev);
+	right_bb = chain_new_bblock (cfg, head, prev);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, sreg, cases [mid].value);
+	MONO_EMIT_NEW_BRANCH_BLOCK2 (cfg, OP_IBLT, left_bb, right_bb);
+
+	cfg->cbb = left_bb;
+	chain_emit_search (cfg, head, prev, sreg, cases, mid, default_bb);
+	cfg->cbb = right_bb;
+	chain_emit_search (cfg, head, prev, sreg, cases + mid, n - mid, default_bb);
+}
+
+/*
+ * lower_compare_chain:
+ *
+ *   Lower the chain of 'x == imm' tests starting at the end of HEAD if it is long
+ * enough, and return whenever it was lowered. Cases with the same target which span
+ * less than 32 values are tested using one bit test. If enough cases remain, they are
+ * found using a binary search, otherwise they are tested in their original order.
+ * The values are distinct, so the order of the tests doesn't change the result.
+ */
+static gboolean
+lower_compare_chain (MonoCompile *cfg, MonoBasicBlock *head)
+{
+	MonoInst *head_cmp;
+	MonoBasicBlock *bb, *target, *next, *default_bb, *prev;
+	GPtrArray *chain;
+	GHashTable *removed;
+	ChainCase *cases, *rest;
+	gint32 value;
+	int i, j, k, n, ngroup, nrest, sreg;
+	gboolean has_bit_test;
+
+	head_cmp = chain_get_test (head, &value, &target, &next);
+	if (!head_cmp)
+		return FALSE;
+	sreg = head_cmp->sreg1;
+
+	/* The bblocks after the head must contain only their test, and only be reachable from the chain */
+	chain = g_ptr_array_new ();
+	g_ptr_array_add (chain, head);
+	bb = next;
+	while (bb != head && bb != cfg->bb_exit && bb->in_count == 1 && bb->region == head->region && !bb->out_of_line) {
+		MonoInst *cmp;
+		MonoBasicBlock *bb_target, *bb_next;
+
+		cmp = chain_get_test (bb, &value, &bb_target, &bb_next);
+		if (!cmp || cmp->sreg1 != sreg || !chain_is_test_bblock (bb, cmp))
+			break;
+		g_ptr_array_add (chain, bb);
+		bb = bb_next;
+	}
+	default_bb = bb;
+
+	n = chain->len;
+	if (n < CHAIN_MIN_BIT_TEST_CASES) {
+		g_ptr_array_free (chain, TRUE);
+		return FALSE;
+	}
+
+	/* Later tests of the same value are never taken */
+	cases = (ChainCase *)mono_mempool_alloc0 (cfg->mempool, sizeof (ChainCase) * n);
+	k = 0;
+	for (i = 0; i < n; ++i) {
+		chain_get_test ((MonoBasicBlock *)g_ptr_array_index (chain, i), &value, &target, &next);
+		for (j = 0; j < k; ++j) {
+			if (cases [j].value == value)
+				break;
+		}
+		if (j == k) {
+			cases [k].value = value;
+			cases [k].target = target;
+			cases [k].order = k;
+			k ++;
+		}
+	}
+	n = k;
+	qsort (cases, n, sizeof (ChainCase), chain_case_compare);
+
+	/* Group the cases into bit tests */
+	has_bit_test = FALSE;
+	nrest = n;
+	for (i = 0; i < n; ++i) {
+		if (cases [i].bit_test)
+			continue;
+		ngroup = 0;
+		for (j = i; j < n && (gint64)cases [j].value - cases [i].value < 32; ++j) {
+			if (!cases [j].bit_test && cases [j].target == cases [i].target)
+				ngroup ++;
+		}
+		if (ngroup < CHAIN_MIN_BIT_TEST_CASES)
+			continue;
+		for (j = i; j < n && (gint64)cases [j].value - cases [i].value < 32; ++j) {
+			if (!cases [j].bit_test && cases [j].target == cases [i].target)
+				cases [j].bit_test = TRUE;
+		}
+		has_bit_test = TRUE;
+		nrest -= ngroup;
+	}
+
+	if (!has_bit_test && nrest < CHAIN_MIN_BINARY_SEARCH_CASES) {
+		g_ptr_array_free (chain, TRUE);
+		return FALSE;
+	}
+
+	if (cfg->verbose_level > 2)
+		g_print ("lowering compare chain of %d cases at BB%d\n", n, head->block_num);
+
+	/* Remove the old tests */
+	removed = g_hash_table_new (NULL, NULL);
+	for (i = 0; i < chain->len; ++i) {
+		bb = (MonoBasicBlock *)g_ptr_array_index (chain, i);
+		while (bb->out_count)
+			mono_unlink_bblock (cfg, bb, bb->out_bb [0]);
+		if (i > 0)
+			g_hash_table_insert (removed, bb, bb);
+	}
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		while (bb->next_bb && g_hash_table_lookup (removed, bb->next_bb)) {
+			next = bb->next_bb;
+			bb->next_bb = next->next_bb;
+			mono_nullify_basic_block (next);
+		}
+	}
+	g_hash_table_destroy (removed);
+	g_ptr_array_free (chain, TRUE);
+
+	head->last_ins = head_cmp->prev;
+	if (head->last_ins)
+		head->last_ins->next = NULL;
+	else
+		head->code = NULL;
+
+	/* Emit the new tests */
+	cfg->cbb = head;
+	prev = head;
+	rest = (ChainCase *)mono_mempool_alloc (cfg->mempool, sizeof (ChainCase) * n);
+	for (i = 0; i < n; ++i) {
+		if (cases [i].bit_test && cases [i].target) {
+			target = cases [i].target;
+			ngroup = 0;
+			for (j = i; j < n && (gint64)cases [j].value - cases [i].value < 32; ++j) {
+				if (cases [j].bit_test && cases [j].target == target) {
+					rest [ngroup ++] = cases [j];
+					cases [j].target = NULL;
+				}
+			}
+			chain_emit_bit_test (cfg, head, &prev, sreg, rest, ngroup, target);
+		}
+	}
+
+	k = 0;
+	for (i = 0; i < n; ++i) {
+		if (!cases [i].bit_test)
+			rest [k ++] = cases [i];
+	}
+	g_assert (k == nrest);
+	if (nrest < CHAIN_MIN_BINARY_SEARCH_CASES) {
+		qsort (rest, nrest, sizeof (ChainCase), chain_case_compare_order);
+		chain_emit_linear (cfg, head, &prev, sreg, rest, nrest, default_bb);
+	} else {
+		chain_emit_search (cfg, head, &prev, sreg, rest, nrest, default_bb);
+	}
+
+	cfg->stat_lowered_compare_chains++;
+	return TRUE;
+}
+
+/*
+ * mono_lower_compare_chains:
+ *
+ *   Lower the chains of 'x == imm' tests which the C# compiler generates for sparse
+ * switch statements to bit tests and binary searches.
+ */
+void
+mono_lower_compare_chains (MonoCompile *cfg)
+{
+	MonoBasicBlock *bb;
+
+	for (bb = cfg->bb_entry->next_bb; bb; bb = bb->next_bb) {
+		/* dont touch code inside exception clauses */
+		if (bb->region != -1 || bb->extended)
+			continue;
+		lower_compare_chain (cfg, bb);
+	}
+}
+
 #endif /* DISABLE_JIT */
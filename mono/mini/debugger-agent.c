@@ -114,6 +114,7 @@ typedef struct {
 	gboolean defer;
 	int keepalive;
 	gboolean setpgid;
+	gboolean lazy_seq_points;
 } AgentConfig;
 
 typedef struct
@@ -562,6 +563,8 @@ typedef struct {
 	int last_line;
 	/* Whenever single stepping is performed using start/stop_single_stepping () */
 	gboolean global;
+	/* Whenever single stepping is performed for THREAD only, see start_thread_single_stepping () */
+	gboolean thread_local;
 	/* The list of breakpoints used to implement step-over */
 	GSList *bps;
 	/* The number of frames at the start of a step-over */
@@ -843,6 +846,7 @@ print_usage (void)
 	fprintf (stderr, "  server=y/n\t\t\tWhether to listen for a client connection.\n");
 	fprintf (stderr, "  keepalive=<n>\t\t\tSend keepalive events every n milliseconds.\n");
 	fprintf (stderr, "  setpgid=y/n\t\t\tWhether to call setpid(0, 0) after startup.\n");
+	fprintf (stderr, "  lazy-seq-points=y/n\t\tOnly generate debugger sequence points after a client connects.\n");
 	fprintf (stderr, "  help\t\t\t\tPrint this help.\n");
 }
 
@@ -921,6 +925,8 @@ mono_debugger_agent_parse_options (char *options)
 			agent_config.keepalive = atoi (arg + 10);
 		} else if (strncmp (arg, "setpgid=", 8) == 0) {
 			agent_config.setpgid = parse_flag ("setpgid", arg + 8);
+		} else if (strncmp (arg, "lazy-seq-points=", 16) == 0) {
+			agent_config.lazy_seq_points = parse_flag ("lazy-seq-points", arg + 16);
 		} else {
 			print_usage ();
 			exit (1);
@@ -1019,7 +1025,13 @@ mono_debugger_agent_init (void)
 	breakpoints_init ();
 	suspend_init ();
 
-	mini_get_debug_options ()->gen_sdb_seq_points = TRUE;
+	/*
+	 * With lazy-seq-points=y, this is delayed until a client connects, see
+	 * transport_handshake (). Breakpoints and single stepping won't work in the
+	 * methods compiled before that.
+	 */
+	if (!agent_config.lazy_seq_points)
+		mini_get_debug_options ()->gen_sdb_seq_points = TRUE;
 	/* 
 	 * This is needed because currently we don't handle liveness info.
 	 */
@@ -1593,6 +1605,10 @@ transport_handshake (void)
 
 	set_keepalive ();
 #endif
+
+	/* Methods compiled from now on can have breakpoints */
+	if (agent_config.lazy_seq_points)
+		mini_get_debug_options ()->gen_sdb_seq_points = TRUE;
 	
 	disconnected = FALSE;
 	return TRUE;
@@ -4125,6 +4141,12 @@ insert_breakpoint (MonoSeqPointInfo *seq_points, MonoDomain *domain, MonoJitInfo
 	if (error)
 		mono_error_init (error);
 
+	if (!mono_seq_point_info_has_debug_data (seq_points)) {
+		/* Compiled before the debugger connected with lazy-seq-points=y, the code has no breakpoint sites */
+		DEBUG_PRINTF (1, "[dbg] Not inserting breakpoint into %s, it was compiled without debugger sequence points.\n", mono_method_full_name (jinfo_get_method (ji), TRUE));
+		return;
+	}
+
 	mono_seq_point_iterator_init (&it, seq_points);
 	while (mono_seq_point_iterator_next (&it)) {
 		if (it.seq_point.il_offset == bp->il_offset) {
@@ -5074,6 +5096,46 @@ stop_single_stepping (void)
 #endif
 }
 
+/*
+ * start_thread_single_stepping:
+ *
+ *   Turn on single stepping for the JITted code running on THREAD only, so the other
+ * threads don't take the single step trampoline at every sequence point. Return FALSE
+ * if this is not possible, global single stepping should be used then.
+ */
+static gboolean
+start_thread_single_stepping (MonoInternalThread *thread)
+{
+#ifdef MONO_ARCH_HAVE_THREAD_SINGLE_STEP
+	MonoJitTlsData *jit_tls;
+
+	/* AOT code only checks the global state */
+	if (mono_aot_has_debug_images ())
+		return FALSE;
+	if (!thread || !thread->thread_info)
+		return FALSE;
+	jit_tls = (MonoJitTlsData *)((MonoThreadInfo*)thread->thread_info)->jit_data;
+	if (!jit_tls)
+		return FALSE;
+	return mono_arch_start_single_stepping_thread (jit_tls);
+#else
+	return FALSE;
+#endif
+}
+
+static void
+stop_thread_single_stepping (MonoInternalThread *thread)
+{
+#ifdef MONO_ARCH_HAVE_THREAD_SINGLE_STEP
+	MonoJitTlsData *jit_tls = (MonoJitTlsData *)((MonoThreadInfo*)thread->thread_info)->jit_data;
+
+	if (jit_tls)
+		mono_arch_stop_single_stepping_thread (jit_tls);
+#else
+	g_assert_not_reached ();
+#endif
+}
+
 /*
  * ss_stop:
  *
@@ -5093,8 +5155,12 @@ ss_stop (SingleStepReq *ss_req)
 	}
 
 	if (ss_req->global) {
-		stop_single_stepping ();
+		if (ss_req->thread_local)
+			stop_thread_single_stepping (ss_req->thread);
+		else
+			stop_single_stepping ();
 		ss_req->global = FALSE;
+		ss_req->thread_local = FALSE;
 	}
 }
 
@@ -5341,14 +5407,15 @@ ss_start (SingleStepReq *ss_req, MonoMethod *method, SeqPoint* sp, MonoSeqPointI
 		invalidate_frames (tls);
 	}
 
-	if (enable_global) {
-		DEBUG_PRINTF (1, "[dbg] Turning on global single stepping.\n");
-		ss_req->global = TRUE;
-		start_single_stepping ();
-	} else if (!ss_req->bps) {
-		DEBUG_PRINTF (1, "[dbg] Turning on global single stepping.\n");
+	if (enable_global || !ss_req->bps) {
 		ss_req->global = TRUE;
-		start_single_stepping ();
+		if (start_thread_single_stepping (ss_req->thread)) {
+			DEBUG_PRINTF (1, "[dbg] Turning on single stepping for thread %p.\n", ss_req->thread);
+			ss_req->thread_local = TRUE;
+		} else {
+			DEBUG_PRINTF (1, "[dbg] Turning on global single stepping.\n");
+			start_single_stepping ();
+		}
 	} else {
 		ss_req->global = FALSE;
 	}
@@ -1543,6 +1543,19 @@ mono_decompose_array_access_opts (MonoCompile *cfg)
 						dest->dreg = ins->dreg;
 					}
 					break;
+				case OP_NEWOBJ: {
+					MonoVTable *vtable = (MonoVTable *)ins->inst_p0;
+					MonoMethod *managed_alloc = mono_gc_get_managed_allocator (vtable->klass, FALSE, TRUE);
+
+					g_assert (managed_alloc); /*This shall not fail since we check for this condition on OP_NEWOBJ creation*/
+					NEW_VTABLECONST (cfg, iargs [0], vtable);
+					MONO_ADD_INS (cfg->cbb, iargs [0]);
+					EMIT_NEW_ICONST (cfg, iargs [1], mono_class_instance_size (vtable->klass));
+
+					dest = mono_emit_method_call (cfg, managed_alloc, iargs, NULL);
+					dest->dreg = ins->dreg;
+					break;
+				}
 				case OP_STRLEN:
 					MONO_EMIT_NEW_LOAD_MEMBASE_OP_FLAGS (cfg, OP_LOADI4_MEMBASE, ins->dreg,
 														 ins->sreg1, MONO_STRUCT_OFFSET (MonoString, length), ins->flags | MONO_INST_INVARIANT_LOAD);
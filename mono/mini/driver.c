@@ -53,6 +53,7 @@
 #include "mono/utils/mono-hwcap.h"
 #include "mono/utils/mono-logger-internals.h"
 #include "mono/utils/w32handle.h"
+#include "mono/utils/mono-startup-trace.h"
 
 #include "mini.h"
 #include "jit.h"
@@ -322,6 +323,7 @@ opt_sets [] = {
        MONO_OPT_SIMD,
        MONO_OPT_SSE2,
        MONO_OPT_SIMD | MONO_OPT_SSE2,
+       MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_SIMD | MONO_OPT_VECTORIZE,
 #endif
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_INTRINS,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_INTRINS | MONO_OPT_ALIAS_ANALYSIS,
@@ -333,6 +335,8 @@ opt_sets [] = {
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_TAILC,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_SSA,
+       MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_SSA | MONO_OPT_ESCAPE,
+       MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_EXCEPTION | MONO_OPT_SSA | MONO_OPT_GVN,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_EXCEPTION,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_EXCEPTION | MONO_OPT_CMOV,
        MONO_OPT_BRANCH | MONO_OPT_PEEPHOLE | MONO_OPT_LINEARS | MONO_OPT_COPYPROP | MONO_OPT_CONSPROP | MONO_OPT_DEADCE | MONO_OPT_LOOP | MONO_OPT_INLINE | MONO_OPT_INTRINS | MONO_OPT_EXCEPTION | MONO_OPT_ABCREM,
@@ -373,8 +377,8 @@ mini_regression_step (MonoImage *image, int verbose, int *total_run, int *total,
 	if (domain_jit_info (domain)) {
 		g_hash_table_destroy (domain_jit_info (domain)->jit_trampoline_hash);
 		domain_jit_info (domain)->jit_trampoline_hash = g_hash_table_new (mono_aligned_addr_hash, NULL);
-		mono_internal_hash_table_destroy (&(domain->jit_code_hash));
-		mono_jit_code_hash_init (&(domain->jit_code_hash));
+		mono_lock_free_hashtable_destroy (domain->jit_code_hash);
+		domain->jit_code_hash = mono_jit_code_hash_new ();
 	}
 
 	g_timer_start (timer);
@@ -1025,6 +1029,9 @@ mono_jit_exec (MonoDomain *domain, MonoAssembly *assembly, int argc, char *argv[
 		mono_environment_exitcode_set (1);
 		return 1;
 	}
+
+	/* Startup ends when the entry point runs */
+	mono_startup_trace_finish ();
 	
 	if (mono_llvm_only) {
 		MonoObject *exc = NULL;
@@ -1067,7 +1074,9 @@ static void main_thread_handler (gpointer user_data)
 	MonoAssembly *assembly;
 
 	if (mono_compile_aot) {
-		int i, res;
+		int i, res, dedup_container_index = -1;
+		gboolean dedup = FALSE;
+		MonoAssembly *dedup_container = NULL;
 
 		/* Treat the other arguments as assemblies to compile too */
 		for (i = 0; i < main_args->argc; ++i) {
@@ -1087,12 +1096,30 @@ static void main_thread_handler (gpointer user_data)
 					exit (1);
 				}
 			}
+			if (mono_aot_is_dedup_container (assembly, main_args->aot_options, &dedup)) {
+				/* Compiled last, since it receives the dedupable methods of the other assemblies */
+				dedup_container = assembly;
+				dedup_container_index = i;
+				continue;
+			}
 			res = mono_compile_assembly (assembly, main_args->opts, main_args->aot_options);
 			if (res != 0) {
 				fprintf (stderr, "AOT of image %s failed.\n", main_args->argv [i]);
 				exit (1);
 			}
 		}
+
+		if (dedup && !dedup_container) {
+			fprintf (stderr, "The assembly given by the dedup-include= AOT option is not among the assemblies to compile.\n");
+			exit (1);
+		}
+		if (dedup_container) {
+			res = mono_compile_assembly (dedup_container, main_args->opts, main_args->aot_options);
+			if (res != 0) {
+				fprintf (stderr, "AOT of image %s failed.\n", main_args->argv [dedup_container_index]);
+				exit (1);
+			}
+		}
 	} else {
 		assembly = mono_domain_assembly_open (main_args->domain, main_args->file);
 		if (!assembly){
@@ -1210,6 +1237,8 @@ mini_usage_jitdeveloper (void)
 		 "    --single-method=OPTS   Runs regressions with only one method optimized with OPTS at any time\n"
 		 "    --statfile FILE        Sets the stat file to FILE\n"
 		 "    --stats                Print statistics about the JIT operations\n"
+		 "    --stats=memory         Same as --stats, also print the memory used by each image\n"
+		 "    --jit-stats=top[,N]    Print the N methods (default: 20) and the JIT passes which took the most JIT time\n"
 		 "    --wapi=hps|semdel|seminfo IO-layer maintenance\n"
 		 "    --inject-async-exc METHOD OFFSET Inject an asynchronous exception at METHOD\n"
 		 "    --verify-all           Run the verifier on all assemblies and methods\n"
@@ -1250,6 +1279,8 @@ mini_usage (void)
 		"    --profile[=profiler]   Runs in profiling mode with the specified profiler module\n"
 		"    --trace[=EXPR]         Enable tracing, use --help-trace for details\n"
 		"    --jitmap               Output a jit method map to /tmp/perf-PID.map\n"
+		"    --jitdump              Output the jitted code in the perf jitdump format to /tmp/jit-PID.dump\n"
+		"    --trace-startup[=FILE] Write the time spent in each startup phase as JSON to FILE or stdout\n"
 		"    --help-devel           Shows more options available to developers\n"
 		"\n"
 		"Runtime:\n"
@@ -1260,6 +1291,23 @@ mini_usage (void)
 		"    --runtime=VERSION      Use the VERSION runtime, instead of autodetecting\n"
 		"    --optimize=OPT         Turns on or off a specific optimization\n"
 		"                           Use --list-opt to get a list of optimizations\n"
+		"    --tiered[=N[,M[,O]]]   Compile methods with few optimizations first, and again with\n"
+		"                           all of them after N calls or M loop iterations, running\n"
+		"                           methods switch to the new code after O loop iterations\n"
+		"                           With --llvm, only the second compilation uses LLVM\n"
+		"    --jit-preload          JIT the methods recorded by the AOT profiler in a previous\n"
+		"                           run on background JIT threads\n"
+		"    --jit-threads=N        Use N threads for --jit-preload, the default is 1\n"
+		"    --aot-preload=N        Load and validate the AOT images of referenced assemblies\n"
+		"                           on N background threads\n"
+		"    --assembly-preload=N   Open and validate the images of the assemblies referenced by\n"
+		"                           the program on N background threads\n"
+		"    --startup-snapshot=FILE Record the assemblies and classes loaded by this run into\n"
+		"                           FILE, or load them on a background thread if FILE exists\n"
+		"    --startup-snapshot-delay=N\n"
+		"                           Record the snapshot after N seconds instead of at exit\n"
+		"    --code-region=N        Allocate JITted code from a N MB region reserved at startup\n"
+		"                           and backed by huge pages when possible\n"
 #ifndef DISABLE_SECURITY
 		"    --security[=mode]      Turns on the unsupported security manager (off by default)\n"
 		"                           mode is one of cas, core-clr, verifiable or validil\n"
@@ -1422,10 +1470,38 @@ mono_jit_parse_options (int argc, char * argv[])
 			MonoDebugOptions *opt = mini_get_debug_options ();
 
 			opt->break_on_exc = TRUE;
+		} else if (strcmp (argv [i], "--tiered") == 0) {
+			mono_tiered_enable (NULL);
+		} else if (strncmp (argv [i], "--tiered=", 9) == 0) {
+			mono_tiered_enable (argv [i] + 9);
+		} else if (strncmp (argv [i], "--jit-threads=", 14) == 0) {
+			mono_compile_queue_set_threads (atoi (argv [i] + 14));
+		} else if (strcmp (argv [i], "--jit-preload") == 0) {
+			mono_compile_queue_enable_preload ();
+		} else if (strncmp (argv [i], "--aot-preload=", 14) == 0) {
+			mono_aot_set_preload_threads (atoi (argv [i] + 14));
+		} else if (strncmp (argv [i], "--assembly-preload=", 19) == 0) {
+			mono_assembly_set_preload_threads (atoi (argv [i] + 19));
+		} else if (strncmp (argv [i], "--startup-snapshot=", 19) == 0) {
+			mono_startup_snapshot_set_file (argv [i] + 19);
+		} else if (strncmp (argv [i], "--startup-snapshot-delay=", 25) == 0) {
+			mono_startup_snapshot_set_delay (atoi (argv [i] + 25));
+		} else if (strncmp (argv [i], "--code-region=", 14) == 0) {
+			mono_code_manager_set_region_size ((size_t)atoi (argv [i] + 14) * 1024 * 1024);
 		} else if (strcmp (argv [i], "--stats") == 0) {
 			mono_counters_enable (-1);
 			mono_stats.enabled = TRUE;
 			mono_jit_stats.enabled = TRUE;
+		} else if (strcmp (argv [i], "--stats=memory") == 0) {
+			mono_counters_enable (-1);
+			mono_stats.enabled = TRUE;
+			mono_jit_stats.enabled = TRUE;
+			mono_jit_stats.memory_report = TRUE;
+		} else if (strncmp (argv [i], "--jit-stats=", 12) == 0) {
+			if (!mono_jit_stats_enable_top (argv [i] + 12)) {
+				fprintf (stderr, "Invalid --jit-stats option `%s', use --jit-stats=top[,N]\n", argv [i] + 12);
+				exit (1);
+			}
 		} else if (strcmp (argv [i], "--break") == 0) {
 			if (i+1 >= argc){
 				fprintf (stderr, "Missing method name in --break command line option\n");
@@ -1759,10 +1835,38 @@ mono_main (int argc, char* argv[])
 			mono_jit_set_aot_mode (MONO_AOT_MODE_HYBRID);
 		} else if (strcmp (argv [i], "--print-vtable") == 0) {
 			mono_print_vtable = TRUE;
+		} else if (strcmp (argv [i], "--tiered") == 0) {
+			mono_tiered_enable (NULL);
+		} else if (strncmp (argv [i], "--tiered=", 9) == 0) {
+			mono_tiered_enable (argv [i] + 9);
+		} else if (strncmp (argv [i], "--jit-threads=", 14) == 0) {
+			mono_compile_queue_set_threads (atoi (argv [i] + 14));
+		} else if (strcmp (argv [i], "--jit-preload") == 0) {
+			mono_compile_queue_enable_preload ();
+		} else if (strncmp (argv [i], "--aot-preload=", 14) == 0) {
+			mono_aot_set_preload_threads (atoi (argv [i] + 14));
+		} else if (strncmp (argv [i], "--assembly-preload=", 19) == 0) {
+			mono_assembly_set_preload_threads (atoi (argv [i] + 19));
+		} else if (strncmp (argv [i], "--startup-snapshot=", 19) == 0) {
+			mono_startup_snapshot_set_file (argv [i] + 19);
+		} else if (strncmp (argv [i], "--startup-snapshot-delay=", 25) == 0) {
+			mono_startup_snapshot_set_delay (atoi (argv [i] + 25));
+		} else if (strncmp (argv [i], "--code-region=", 14) == 0) {
+			mono_code_manager_set_region_size ((size_t)atoi (argv [i] + 14) * 1024 * 1024);
 		} else if (strcmp (argv [i], "--stats") == 0) {
 			mono_counters_enable (-1);
 			mono_stats.enabled = TRUE;
 			mono_jit_stats.enabled = TRUE;
+		} else if (strcmp (argv [i], "--stats=memory") == 0) {
+			mono_counters_enable (-1);
+			mono_stats.enabled = TRUE;
+			mono_jit_stats.enabled = TRUE;
+			mono_jit_stats.memory_report = TRUE;
+		} else if (strncmp (argv [i], "--jit-stats=", 12) == 0) {
+			if (!mono_jit_stats_enable_top (argv [i] + 12)) {
+				fprintf (stderr, "Invalid --jit-stats option `%s', use --jit-stats=top[,N]\n", argv [i] + 12);
+				exit (1);
+			}
 #ifndef DISABLE_AOT
 		} else if (strcmp (argv [i], "--aot") == 0) {
 			error_if_aot_unsupported ();
@@ -1781,6 +1885,12 @@ mono_main (int argc, char* argv[])
 			forced_version = &argv [i][10];
 		} else if (strcmp (argv [i], "--jitmap") == 0) {
 			mono_enable_jit_map ();
+		} else if (strcmp (argv [i], "--jitdump") == 0) {
+			mono_enable_jit_dump ();
+		} else if (strcmp (argv [i], "--trace-startup") == 0) {
+			mono_startup_trace_init (NULL);
+		} else if (strncmp (argv [i], "--trace-startup=", 16) == 0) {
+			mono_startup_trace_init (&argv [i][16]);
 		} else if (strcmp (argv [i], "--profile") == 0) {
 			enable_profile = TRUE;
 			profile_options = NULL;
@@ -1272,6 +1272,57 @@ class Tests
 		c.throw_catch_t ();
 		return 0;
 	}
+
+	class CtorClass {
+		public int i = 42;
+	}
+
+	class GenericCtorClass<T> {
+		public T t;
+		public int i;
+
+		public GenericCtorClass () {
+			i = 43;
+		}
+	}
+
+	class ThrowingCtorClass {
+		public ThrowingCtorClass () {
+			throw new NotSupportedException ();
+		}
+	}
+
+	abstract class AbstractCtorClass {
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static T create_new_t<T> () where T : new () {
+		return new T ();
+	}
+
+	public static int test_0_gshared_new_t () {
+		for (int i = 0; i < 2; ++i) {
+			if (create_new_t<CtorClass> ().i != 42)
+				return 1;
+			if (create_new_t<GenericCtorClass<string>> ().i != 43)
+				return 2;
+			if (create_new_t<CtorClass> () == create_new_t<CtorClass> ())
+				return 3;
+			try {
+				create_new_t<ThrowingCtorClass> ();
+				return 4;
+			} catch (System.Reflection.TargetInvocationException e) {
+				if (!(e.InnerException is NotSupportedException))
+					return 5;
+			}
+			try {
+				Activator.CreateInstance<AbstractCtorClass> ();
+				return 6;
+			} catch (MissingMethodException) {
+			}
+		}
+		return 0;
+	}
 }
 
 #if !__MOBILE__
@@ -1247,6 +1247,7 @@ mono_object_castclass_with_cache (MonoObject *obj, MonoClass *klass, gpointer *c
 	MonoError error;
 	MonoJitTlsData *jit_tls = NULL;
 	gpointer cached_vtable, obj_vtable;
+	int i;
 
 	if (mini_get_debug_options ()->better_cast_details) {
 		jit_tls = (MonoJitTlsData *)mono_native_tls_get_value (mono_jit_tls_id);
@@ -1256,14 +1257,16 @@ mono_object_castclass_with_cache (MonoObject *obj, MonoClass *klass, gpointer *c
 	if (!obj)
 		return NULL;
 
-	cached_vtable = *cache;
 	obj_vtable = obj->vtable;
 
-	if (cached_vtable == obj_vtable)
-		return obj;
+	for (i = 0; i < MONO_CAST_CACHE_ENTRIES; ++i) {
+		cached_vtable = cache [i];
+		if (cached_vtable == obj_vtable)
+			return obj;
+	}
 
 	if (mono_object_isinst_checked (obj, klass, &error)) {
-		*cache = obj_vtable;
+		mono_marshal_cast_cache_update (cache, obj->vtable, TRUE);
 		return obj;
 	}
 	if (mono_error_set_pending_exception (&error))
@@ -1285,25 +1288,28 @@ mono_object_isinst_with_cache (MonoObject *obj, MonoClass *klass, gpointer *cach
 {
 	MonoError error;
 	size_t cached_vtable, obj_vtable;
+	int i;
 
 	if (!obj)
 		return NULL;
 
-	cached_vtable = (size_t)*cache;
 	obj_vtable = (size_t)obj->vtable;
 
-	if ((cached_vtable & ~0x1) == obj_vtable) {
-		return (cached_vtable & 0x1) ? NULL : obj;
+	for (i = 0; i < MONO_CAST_CACHE_ENTRIES; ++i) {
+		cached_vtable = (size_t)cache [i];
+		if ((cached_vtable & ~0x1) == obj_vtable) {
+			return (cached_vtable & 0x1) ? NULL : obj;
+		}
 	}
 
 	if (mono_object_isinst_checked (obj, klass, &error)) {
-		*cache = (gpointer)obj_vtable;
+		mono_marshal_cast_cache_update (cache, obj->vtable, TRUE);
 		return obj;
 	} else {
 		if (mono_error_set_pending_exception (&error))
 			return NULL;
 		/*negative cache*/
-		*cache = (gpointer)(obj_vtable | 0x1);
+		mono_marshal_cast_cache_update (cache, obj->vtable, FALSE);
 		return NULL;
 	}
 }
@@ -1451,6 +1457,25 @@ mono_generic_class_init (MonoVTable *vtable)
 	mono_error_set_pending_exception (&error);
 }
 
+#ifdef MONO_ARCH_HAVE_PATCHABLE_CLASS_INIT
+/*
+ * mono_generic_class_init_patch:
+ *
+ *   Same as mono_generic_class_init (), called from the OP_GENERIC_CLASS_INIT
+ * sequence between SITE and END of a method where VTABLE is a constant. Once
+ * the class is initialized the check in the sequence can never fail again, so
+ * it is replaced with a jump over it.
+ */
+void
+mono_generic_class_init_patch (MonoVTable *vtable, guint8 *site, guint8 *end)
+{
+	mono_generic_class_init (vtable);
+
+	if (vtable->initialized)
+		mono_arch_patch_class_init_site (site, end);
+}
+#endif
+
 void
 ves_icall_mono_delegate_ctor (MonoObject *this_obj, MonoObject *target, gpointer addr)
 {
@@ -1487,6 +1512,219 @@ mono_fill_method_rgctx (MonoMethodRuntimeGenericContext *mrgctx, int index)
 	return res;
 }
 
+/*
+ * mono_rgctx_ic_update:
+ *
+ *   Called on a miss of the RGCTX fetch inline cache CACHE to cache VALUE, which was
+ * fetched from RGCTX.
+ */
+void
+mono_rgctx_ic_update (MonoRgctxInlineCache *cache, gpointer rgctx, gpointer value)
+{
+	MonoRgctxInlineCacheEntry *entry;
+
+	if (InterlockedIncrement (&cache->updates) > MONO_RGCTX_IC_MAX_UPDATES)
+		return;
+
+	entry = (MonoRgctxInlineCacheEntry *)mono_domain_alloc (mono_domain_get (), sizeof (MonoRgctxInlineCacheEntry));
+	entry->rgctx = rgctx;
+	entry->value = value;
+	mono_memory_barrier ();
+	cache->entry = entry;
+}
+
+/*
+ * mono_iface_ic_update:
+ *
+ *   Called on a miss of the interface call inline cache CACHE to cache the code called
+ * when calling IMT_METHOD on THIS_OBJ. Receivers whose calls need more than an unbox
+ * trampoline are left to the IMT thunk.
+ */
+void
+mono_iface_ic_update (MonoIfaceInlineCache *cache, MonoObject *this_obj, MonoMethod *imt_method)
+{
+	MonoError error;
+	MonoVTable *vt;
+	MonoMethod *impl_method, *variant_iface = NULL;
+	MonoIfaceInlineCacheEntry *entry;
+	gpointer *imt, addr, compiled_method, aot_addr;
+	gboolean need_rgctx_tramp = FALSE;
+	int i;
+
+	if (InterlockedIncrement (&cache->updates) > MONO_IFACE_IC_MAX_UPDATES)
+		return;
+	if (!this_obj || mono_object_is_transparent_proxy (this_obj))
+		return;
+
+	vt = this_obj->vtable;
+	imt = (gpointer*)vt - MONO_IMT_SIZE;
+
+	mini_resolve_imt_method (vt, imt + mono_method_get_imt_slot (imt_method), imt_method, &impl_method, &aot_addr, &need_rgctx_tramp, &variant_iface, &error);
+	if (!is_ok (&error)) {
+		/* The IMT call made after this will report the error */
+		mono_error_cleanup (&error);
+		return;
+	}
+	if (need_rgctx_tramp || variant_iface)
+		return;
+
+	if (aot_addr) {
+		addr = mono_create_ftnptr (mono_domain_get (), aot_addr);
+	} else {
+		if (impl_method->iflags & METHOD_IMPL_ATTRIBUTE_SYNCHRONIZED)
+			impl_method = mono_marshal_get_synchronized_wrapper (impl_method);
+
+		compiled_method = mono_jit_compile_method (impl_method, &error);
+		if (!compiled_method) {
+			mono_error_cleanup (&error);
+			return;
+		}
+		/* Tier 0 code is replaced later, so keep calling it through the IMT thunk */
+		if (mono_tiered_is_tier0_code (compiled_method))
+			return;
+
+		addr = mini_add_method_trampoline (impl_method, compiled_method, FALSE, impl_method->klass->valuetype);
+	}
+
+	entry = (MonoIfaceInlineCacheEntry *)mono_domain_alloc (mono_domain_get (), sizeof (MonoIfaceInlineCacheEntry));
+	entry->vtable = vt;
+	entry->code = addr;
+	mono_memory_barrier ();
+	for (i = 0; i < MONO_IFACE_IC_SIZE; ++i) {
+		if (!InterlockedCompareExchangePointer ((gpointer*)&cache->entries [i], entry, NULL))
+			break;
+	}
+}
+
+static gboolean
+is_generic_method_definition (MonoMethod *m)
+{
+	MonoGenericContext *context;
+	if (m->is_generic)
+		return TRUE;
+	if (!m->is_inflated)
+		return FALSE;
+
+	context = mono_method_get_context (m);
+	if (!context->method_inst)
+		return FALSE;
+	if (context->method_inst == mono_method_get_generic_container (((MonoMethodInflated*)m)->declaring)->context.method_inst)
+		return TRUE;
+	return FALSE;
+}
+
+/*
+ * mono_gvm_ic_update:
+ *
+ *   Called on a miss of the generic virtual call inline cache CACHE to cache the code
+ * called when calling the generic virtual method instance IMT_METHOD on THIS_OBJ. The
+ * cached code is what the generic virtual thunk of the slot calls, i.e. it includes
+ * the static rgctx and unbox trampolines the instance needs.
+ */
+void
+mono_gvm_ic_update (MonoIfaceInlineCache *cache, MonoObject *this_obj, MonoMethod *imt_method)
+{
+	MonoError error;
+	MonoVTable *vt;
+	MonoMethod *impl_method, *variant_iface = NULL;
+	MonoIfaceInlineCacheEntry *entry;
+	gpointer *imt, addr, compiled_method, aot_addr = NULL;
+	gboolean need_rgctx_tramp = FALSE;
+	int i;
+
+	if (InterlockedIncrement (&cache->updates) > MONO_IFACE_IC_MAX_UPDATES)
+		return;
+	if (!this_obj || mono_object_is_transparent_proxy (this_obj))
+		return;
+
+	vt = this_obj->vtable;
+
+	if (imt_method->klass->flags & TYPE_ATTRIBUTE_INTERFACE) {
+		imt = (gpointer*)vt - MONO_IMT_SIZE;
+		mini_resolve_imt_method (vt, imt + mono_method_get_imt_slot (imt_method), imt_method, &impl_method, &aot_addr, &need_rgctx_tramp, &variant_iface, &error);
+		if (!is_ok (&error)) {
+			/* The call made after this will report the error */
+			mono_error_cleanup (&error);
+			return;
+		}
+		if (variant_iface || aot_addr)
+			return;
+	} else {
+		/* Same as in resolve_vcall () */
+		MonoGenericContext context = { NULL, NULL };
+		MonoMethod *m, *declaring;
+
+		m = mono_class_get_vtable_entry (vt->klass, mono_method_get_vtable_index (imt_method));
+		if (!m || !is_generic_method_definition (m))
+			return;
+
+		declaring = m->is_inflated ? mono_method_get_declaring_generic_method (m) : m;
+		if (m->klass->generic_class)
+			context.class_inst = m->klass->generic_class->context.class_inst;
+		context.method_inst = ((MonoMethodInflated*)imt_method)->context.method_inst;
+
+		impl_method = mono_class_inflate_generic_method_checked (declaring, &context, &error);
+		if (!is_ok (&error)) {
+			mono_error_cleanup (&error);
+			return;
+		}
+		need_rgctx_tramp = mono_method_needs_static_rgctx_invoke (impl_method, FALSE);
+	}
+
+	if (impl_method->iflags & METHOD_IMPL_ATTRIBUTE_SYNCHRONIZED)
+		impl_method = mono_marshal_get_synchronized_wrapper (impl_method);
+
+	compiled_method = mono_jit_compile_method (impl_method, &error);
+	if (!compiled_method) {
+		mono_error_cleanup (&error);
+		return;
+	}
+	/* Tier 0 code is replaced later, so keep calling it through the thunk */
+	if (mono_tiered_is_tier0_code (compiled_method))
+		return;
+
+	addr = mini_add_method_trampoline (impl_method, compiled_method, need_rgctx_tramp, vt->klass->valuetype);
+
+	entry = (MonoIfaceInlineCacheEntry *)mono_domain_alloc (mono_domain_get (), sizeof (MonoIfaceInlineCacheEntry));
+	entry->vtable = vt;
+	entry->code = addr;
+	mono_memory_barrier ();
+	for (i = 0; i < MONO_IFACE_IC_SIZE; ++i) {
+		if (!InterlockedCompareExchangePointer ((gpointer*)&cache->entries [i], entry, NULL))
+			break;
+	}
+}
+
+/*
+ * mono_get_create_instance_code:
+ *
+ *   Return the code of the wrapper returned by mono_marshal_get_create_instance_wrapper ()
+ * for the class of VTABLE, caching it in the vtable. Called by the code emitted for
+ * Activator.CreateInstance<T> () in shared code the first time T is VTABLE's class.
+ */
+gpointer
+mono_get_create_instance_code (MonoVTable *vtable)
+{
+	MonoError error;
+	MonoMethod *wrapper;
+	gpointer code;
+
+	if (vtable->create_instance)
+		return vtable->create_instance;
+
+	wrapper = mono_marshal_get_create_instance_wrapper (vtable->klass);
+	code = mono_compile_method_checked (wrapper, &error);
+	if (mono_error_set_pending_exception (&error))
+		return NULL;
+	/* Tier 0 code is replaced later, so keep asking for the code until then */
+	if (mono_tiered_is_tier0_code (code))
+		return code;
+
+	mono_memory_barrier ();
+	vtable->create_instance = code;
+	return code;
+}
+
 /*
  * resolve_iface_call:
  *
@@ -1556,23 +1794,6 @@ mono_resolve_iface_call_gsharedvt (MonoObject *this_obj, int imt_slot, MonoMetho
 	return res;
 }
 
-static gboolean
-is_generic_method_definition (MonoMethod *m)
-{
-	MonoGenericContext *context;
-	if (m->is_generic)
-		return TRUE;
-	if (!m->is_inflated)
-		return FALSE;
-
-	context = mono_method_get_context (m);
-	if (!context->method_inst)
-		return FALSE;
-	if (context->method_inst == mono_method_get_generic_container (((MonoMethodInflated*)m)->declaring)->context.method_inst)
-		return TRUE;
-	return FALSE;
-}
-
 /*
  * resolve_vcall:
  *
@@ -192,6 +192,9 @@ ves_icall_runtime_class_init (MonoVTable *vtable);
 void
 mono_generic_class_init (MonoVTable *vtable);
 
+void
+mono_generic_class_init_patch (MonoVTable *vtable, guint8 *site, guint8 *end);
+
 void
 ves_icall_mono_delegate_ctor (MonoObject *this_obj, MonoObject *target, gpointer addr);
 
@@ -204,6 +207,14 @@ gpointer mono_fill_class_rgctx (MonoVTable *vtable, int index);
 
 gpointer mono_fill_method_rgctx (MonoMethodRuntimeGenericContext *mrgctx, int index);
 
+void mono_rgctx_ic_update (MonoRgctxInlineCache *cache, gpointer rgctx, gpointer value);
+
+void mono_iface_ic_update (MonoIfaceInlineCache *cache, MonoObject *this_obj, MonoMethod *imt_method);
+
+void mono_gvm_ic_update (MonoIfaceInlineCache *cache, MonoObject *this_obj, MonoMethod *imt_method);
+
+gpointer mono_get_create_instance_code (MonoVTable *vtable);
+
 gpointer mono_resolve_iface_call_gsharedvt (MonoObject *this_obj, int imt_slot, MonoMethod *imt_method, gpointer *out_arg);
 
 gpointer mono_resolve_vcall_gsharedvt (MonoObject *this_obj, int imt_slot, MonoMethod *imt_method, gpointer *out_arg);
@@ -0,0 +1,531 @@
+/*
+ * jitdump.c: Support for emitting JITted code in the perf jitdump format.
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+/*
+ * Linux perf can symbolize and unwind JITted code using the records written to
+ * /tmp/jit-<pid>.dump (see tools/perf/Documentation/jitdump-specification.txt in
+ * the kernel tree). Unlike the /tmp/perf-<pid>.map file, the records contain a copy
+ * of the code, its unwind info and its line numbers, so perf can show the code of
+ * the methods and unwind through them without frame pointers. Usage:
+ *
+ *   perf record -k mono mono --jitdump foo.exe
+ *   perf inject --jit -i perf.data -o perf.jit.data
+ *   perf report -i perf.jit.data
+ *
+ * The records are appended to a memory buffer, which is written out by a background
+ * thread, so the threads registering code don't have to wait for the file.
+ */
+
+#include "config.h"
+#include <glib.h>
+#include "mini.h"
+
+#ifdef ENABLE_JIT_MAP
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <elf.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include <mono/metadata/mono-debug.h>
+#include <mono/metadata/debug-mono-symfile.h>
+#include <mono/utils/atomic.h>
+#include <mono/utils/mono-os-mutex.h>
+#include <mono/utils/mono-os-semaphore.h>
+#include <mono/utils/mono-threads.h>
+
+#define JITDUMP_MAGIC 0x4A695444
+#define JITDUMP_VERSION 1
+
+enum {
+	JIT_CODE_LOAD = 0,
+	JIT_CODE_MOVE = 1,
+	JIT_CODE_DEBUG_INFO = 2,
+	JIT_CODE_CLOSE = 3,
+	JIT_CODE_UNWINDING_INFO = 4
+};
+
+/* DWARF pointer encodings used in the .eh_frame data */
+#define DW_EH_PE_udata4 0x03
+#define DW_EH_PE_sdata4 0x0b
+#define DW_EH_PE_pcrel 0x10
+#define DW_EH_PE_datarel 0x30
+
+#define EH_FRAME_HDR_SIZE 20
+
+/* How often the writer thread writes out the pending records, in ms */
+#define JITDUMP_WRITER_INTERVAL 100
+/* Wake up the writer thread early if this many bytes are pending */
+#define JITDUMP_FLUSH_SIZE (256 * 1024)
+
+typedef struct {
+	guint32 magic;
+	guint32 version;
+	guint32 total_size;
+	guint32 elf_mach;
+	guint32 pad1;
+	guint32 pid;
+	guint64 timestamp;
+	guint64 flags;
+} JitDumpHeader;
+
+typedef struct {
+	guint32 id;
+	guint32 total_size;
+	guint64 timestamp;
+} JitDumpRecord;
+
+typedef struct {
+	JitDumpRecord header;
+	guint32 pid;
+	guint32 tid;
+	guint64 vma;
+	guint64 code_addr;
+	guint64 code_size;
+	guint64 code_index;
+	/* Followed by the NUL terminated name and the code */
+} JitDumpCodeLoad;
+
+typedef struct {
+	JitDumpRecord header;
+	guint64 code_addr;
+	guint64 nr_entry;
+	/* Followed by nr_entry JitDumpDebugEntry structures */
+} JitDumpDebugInfo;
+
+typedef struct {
+	guint64 addr;
+	gint32 lineno;
+	gint32 discrim;
+	/* Followed by the NUL terminated file name */
+} JitDumpDebugEntry;
+
+typedef struct {
+	JitDumpRecord header;
+	guint64 unwinding_size;
+	guint64 eh_frame_hdr_size;
+	guint64 mapped_size;
+	/* Followed by the .eh_frame and .eh_frame_hdr data */
+} JitDumpUnwindingInfo;
+
+static int dump_fd = -1;
+static void *dump_marker;
+static guint64 code_index;
+
+/* Records which are not written to the file yet, protected by dump_mutex */
+static GByteArray *pending;
+static mono_mutex_t dump_mutex;
+/* Serializes the writes to the file */
+static mono_mutex_t write_mutex;
+static MonoSemType writer_sem;
+static MonoNativeThreadId writer_thread;
+static gboolean writer_running;
+
+static guint64
+get_timestamp (void)
+{
+	struct timespec ts;
+
+	/* perf record -k mono uses the same clock */
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (guint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static guint32
+get_elf_mach (void)
+{
+#if defined(TARGET_AMD64)
+	return EM_X86_64;
+#elif defined(TARGET_X86)
+	return EM_386;
+#elif defined(TARGET_ARM64)
+	return EM_AARCH64;
+#elif defined(TARGET_ARM)
+	return EM_ARM;
+#elif defined(TARGET_POWERPC64)
+	return EM_PPC64;
+#elif defined(TARGET_POWERPC)
+	return EM_PPC;
+#elif defined(TARGET_S390X)
+	return EM_S390;
+#elif defined(TARGET_MIPS)
+	return EM_MIPS;
+#else
+	return EM_NONE;
+#endif
+}
+
+static void
+write_all (const guint8 *buf, gsize len)
+{
+	while (len) {
+		ssize_t res = write (dump_fd, buf, len);
+
+		if (res < 0) {
+			if (errno == EINTR)
+				continue;
+			return;
+		}
+		buf += res;
+		len -= res;
+	}
+}
+
+static void
+flush_pending (void)
+{
+	GByteArray *data;
+
+	mono_os_mutex_lock (&write_mutex);
+
+	mono_os_mutex_lock (&dump_mutex);
+	data = pending;
+	pending = g_byte_array_new ();
+	mono_os_mutex_unlock (&dump_mutex);
+
+	write_all (data->data, data->len);
+	g_byte_array_free (data, TRUE);
+
+	mono_os_mutex_unlock (&write_mutex);
+}
+
+static void*
+writer_thread_func (void *arg)
+{
+	mono_native_thread_set_name (mono_native_thread_id_get (), "JIT dump writer");
+
+	while (TRUE) {
+		mono_os_sem_timedwait (&writer_sem, JITDUMP_WRITER_INTERVAL, MONO_SEM_FLAGS_NONE);
+		flush_pending ();
+	}
+
+	return NULL;
+}
+
+static void
+close_at_exit (void)
+{
+	JitDumpRecord rec;
+
+	rec.id = JIT_CODE_CLOSE;
+	rec.total_size = sizeof (rec);
+	rec.timestamp = get_timestamp ();
+
+	mono_os_mutex_lock (&dump_mutex);
+	g_byte_array_append (pending, (guint8*)&rec, sizeof (rec));
+	mono_os_mutex_unlock (&dump_mutex);
+
+	flush_pending ();
+}
+
+/*
+ * mono_jitdump_open:
+ *
+ *   Create /tmp/jit-<pid>.dump and start the thread writing to it. Return whenever
+ * the file could be created.
+ */
+gboolean
+mono_jitdump_open (void)
+{
+	JitDumpHeader header;
+	char name [64];
+
+	g_snprintf (name, sizeof (name), "/tmp/jit-%d.dump", getpid ());
+	dump_fd = open (name, O_CREAT | O_TRUNC | O_RDWR, 0666);
+	if (dump_fd == -1)
+		return FALSE;
+
+	/*
+	 * perf finds the file through this mapping: perf inject looks for mmap events
+	 * of jit-<pid>.dump files.
+	 */
+	dump_marker = mmap (NULL, sysconf (_SC_PAGESIZE), PROT_READ | PROT_EXEC, MAP_PRIVATE, dump_fd, 0);
+	if (dump_marker == MAP_FAILED) {
+		close (dump_fd);
+		dump_fd = -1;
+		return FALSE;
+	}
+
+	memset (&header, 0, sizeof (header));
+	header.magic = JITDUMP_MAGIC;
+	header.version = JITDUMP_VERSION;
+	header.total_size = sizeof (header);
+	header.elf_mach = get_elf_mach ();
+	header.pid = getpid ();
+	header.timestamp = get_timestamp ();
+	write_all ((guint8*)&header, sizeof (header));
+
+	mono_os_mutex_init (&dump_mutex);
+	mono_os_mutex_init (&write_mutex);
+	mono_os_sem_init (&writer_sem, 0);
+	pending = g_byte_array_new ();
+	atexit (close_at_exit);
+
+	writer_running = mono_native_thread_create (&writer_thread, writer_thread_func, NULL);
+	return TRUE;
+}
+
+static void
+append_bytes (GByteArray *buf, const void *data, guint len)
+{
+	g_byte_array_append (buf, (const guint8*)data, len);
+}
+
+static void
+append_byte (GByteArray *buf, guint8 val)
+{
+	g_byte_array_append (buf, &val, 1);
+}
+
+static void
+append_uleb128 (GByteArray *buf, guint32 val)
+{
+	do {
+		guint8 b = val & 0x7f;
+
+		val >>= 7;
+		if (val)
+			b |= 0x80;
+		append_byte (buf, b);
+	} while (val);
+}
+
+static void
+append_sleb128 (GByteArray *buf, gint32 val)
+{
+	gboolean more;
+
+	do {
+		guint8 b = val & 0x7f;
+
+		val >>= 7;
+		more = !((val == 0 && !(b & 0x40)) || (val == -1 && (b & 0x40)));
+		if (more)
+			b |= 0x80;
+		append_byte (buf, b);
+	} while (more);
+}
+
+static void
+set_int32 (GByteArray *buf, guint offset, gint32 val)
+{
+	memcpy (buf->data + offset, &val, sizeof (val));
+}
+
+/* Pad an .eh_frame entry starting at START with DW_CFA_nop, and fill in its length */
+static void
+finish_eh_frame_entry (GByteArray *buf, guint start)
+{
+	while ((buf->len - start) % 8)
+		append_byte (buf, 0);
+	set_int32 (buf, start, buf->len - start - 4);
+}
+
+/*
+ * build_unwinding_info:
+ *
+ *   Build the .eh_frame and .eh_frame_hdr sections describing a function of CODE_SIZE
+ * bytes, whose unwind ops are UW_INFO. perf inject places the .eh_frame section after
+ * the code, aligned to 8 bytes, followed by the .eh_frame_hdr section, so the
+ * relative addresses are computed for that layout.
+ */
+static GByteArray*
+build_unwinding_info (guint32 code_size, guint8 *uw_info, guint32 uw_info_len)
+{
+	GByteArray *buf = g_byte_array_new ();
+	gint32 code_offset = -(gint32)((code_size + 7) & ~7);
+	guint cie_start, fde_start, hdr_start;
+	gint32 zero = 0;
+
+	/* CIE, the unwind ops of each method begin with the state at the call */
+	cie_start = buf->len;
+	append_bytes (buf, &zero, 4);
+	append_bytes (buf, &zero, 4);
+	append_byte (buf, 1);
+	append_bytes (buf, "zR", 3);
+	append_uleb128 (buf, 1);
+	append_sleb128 (buf, mono_unwind_get_dwarf_data_align ());
+	append_byte (buf, mono_unwind_get_dwarf_pc_reg ());
+	append_uleb128 (buf, 1);
+	append_byte (buf, DW_EH_PE_pcrel | DW_EH_PE_sdata4);
+	finish_eh_frame_entry (buf, cie_start);
+
+	/* FDE */
+	fde_start = buf->len;
+	append_bytes (buf, &zero, 4);
+	append_bytes (buf, &zero, 4);
+	set_int32 (buf, fde_start + 4, fde_start + 4 - cie_start);
+	append_bytes (buf, &zero, 4);
+	/* pc_begin is relative to its own location */
+	set_int32 (buf, fde_start + 8, code_offset - (gint32)(fde_start + 8));
+	append_bytes (buf, &code_size, 4);
+	append_uleb128 (buf, 0);
+	append_bytes (buf, uw_info, uw_info_len);
+	finish_eh_frame_entry (buf, fde_start);
+
+	/* Terminator */
+	append_bytes (buf, &zero, 4);
+
+	/* .eh_frame_hdr with a single entry binary search table */
+	hdr_start = buf->len;
+	append_byte (buf, 1);
+	append_byte (buf, DW_EH_PE_pcrel | DW_EH_PE_sdata4);
+	append_byte (buf, DW_EH_PE_udata4);
+	append_byte (buf, DW_EH_PE_datarel | DW_EH_PE_sdata4);
+	append_bytes (buf, &zero, 4);
+	/* eh_frame_ptr, relative to its own location */
+	set_int32 (buf, hdr_start + 4, -(gint32)(hdr_start + 4));
+	{
+		guint32 fde_count = 1;
+		gint32 initial_loc = code_offset - (gint32)hdr_start;
+		gint32 fde_addr = (gint32)fde_start - (gint32)hdr_start;
+
+		append_bytes (buf, &fde_count, 4);
+		append_bytes (buf, &initial_loc, 4);
+		append_bytes (buf, &fde_addr, 4);
+	}
+	g_assert (buf->len - hdr_start == EH_FRAME_HDR_SIZE);
+
+	return buf;
+}
+
+static void
+append_unwinding_info (GByteArray *buf, guint32 code_size, guint8 *uw_info, guint32 uw_info_len)
+{
+	JitDumpUnwindingInfo rec;
+	GByteArray *data = build_unwinding_info (code_size, uw_info, uw_info_len);
+	guint32 size = sizeof (rec) + data->len;
+	guint64 pad = 0;
+
+	rec.header.id = JIT_CODE_UNWINDING_INFO;
+	rec.header.total_size = (size + 7) & ~7;
+	rec.header.timestamp = get_timestamp ();
+	rec.unwinding_size = data->len;
+	rec.eh_frame_hdr_size = EH_FRAME_HDR_SIZE;
+	rec.mapped_size = data->len;
+
+	append_bytes (buf, &rec, sizeof (rec));
+	append_bytes (buf, data->data, data->len);
+	append_bytes (buf, &pad, rec.header.total_size - size);
+	g_byte_array_free (data, TRUE);
+}
+
+static void
+append_debug_info (GByteArray *buf, MonoJitInfo *jinfo)
+{
+	MonoMethod *method = jinfo_get_method (jinfo);
+	MonoDebugMethodJitInfo *dmji;
+	MonoDebugMethodInfo *minfo;
+	JitDumpDebugInfo rec;
+	guint rec_start, nentries = 0;
+	int i;
+
+	minfo = mono_debug_lookup_method (method);
+	if (!minfo)
+		return;
+	dmji = mono_debug_find_method (method, mono_domain_get ());
+	if (!dmji)
+		return;
+
+	rec_start = buf->len;
+	memset (&rec, 0, sizeof (rec));
+	append_bytes (buf, &rec, sizeof (rec));
+
+	for (i = 0; i < dmji->num_line_numbers; ++i) {
+		MonoDebugLineNumberEntry *lne = &dmji->line_numbers [i];
+		MonoDebugSourceLocation *loc = mono_debug_method_lookup_location (minfo, lne->il_offset);
+		JitDumpDebugEntry entry;
+
+		if (!loc)
+			continue;
+		entry.addr = (gsize)jinfo->code_start + lne->native_offset;
+		entry.lineno = loc->row;
+		entry.discrim = 0;
+		append_bytes (buf, &entry, sizeof (entry));
+		append_bytes (buf, loc->source_file, strlen (loc->source_file) + 1);
+		mono_debug_free_source_location (loc);
+		nentries++;
+	}
+	mono_debug_free_method_jit_info (dmji);
+
+	if (!nentries) {
+		g_byte_array_set_size (buf, rec_start);
+		return;
+	}
+
+	while ((buf->len - rec_start) % 8)
+		append_byte (buf, 0);
+
+	rec.header.id = JIT_CODE_DEBUG_INFO;
+	rec.header.total_size = buf->len - rec_start;
+	rec.header.timestamp = get_timestamp ();
+	rec.code_addr = (gsize)jinfo->code_start;
+	rec.nr_entry = nentries;
+	memcpy (buf->data + rec_start, &rec, sizeof (rec));
+}
+
+/*
+ * mono_jitdump_emit_code:
+ *
+ *   Queue the records describing the SIZE bytes of code at START. JINFO is used to
+ * look up line numbers, and can be NULL. UW_INFO is the encoded unwind info of the
+ * code, if any.
+ */
+void
+mono_jitdump_emit_code (MonoJitInfo *jinfo, void *start, int size, const char *name, guint8 *uw_info, guint32 uw_info_len)
+{
+	GByteArray *buf;
+	JitDumpCodeLoad rec;
+	guint32 rec_size;
+	gboolean flush;
+
+	if (dump_fd == -1 || !size)
+		return;
+
+	/* Format the records outside of the lock */
+	buf = g_byte_array_new ();
+
+	/* The debug and unwinding info for a piece of code precede its load record */
+	if (jinfo && !jinfo->is_trampoline && jinfo_get_method (jinfo))
+		append_debug_info (buf, jinfo);
+	if (uw_info && uw_info_len)
+		append_unwinding_info (buf, size, uw_info, uw_info_len);
+
+	rec_size = sizeof (rec) + strlen (name) + 1 + size;
+	rec.header.id = JIT_CODE_LOAD;
+	rec.header.total_size = rec_size;
+	rec.header.timestamp = get_timestamp ();
+	rec.pid = getpid ();
+	rec.tid = syscall (SYS_gettid);
+	rec.vma = (gsize)start;
+	rec.code_addr = (gsize)start;
+	rec.code_size = size;
+	rec.code_index = InterlockedIncrement64 ((gint64*)&code_index);
+	append_bytes (buf, &rec, sizeof (rec));
+	append_bytes (buf, name, strlen (name) + 1);
+	append_bytes (buf, start, size);
+
+	mono_os_mutex_lock (&dump_mutex);
+	g_byte_array_append (pending, buf->data, buf->len);
+	flush = pending->len >= JITDUMP_FLUSH_SIZE;
+	mono_os_mutex_unlock (&dump_mutex);
+
+	if (!writer_running)
+		flush_pending ();
+	else if (flush)
+		mono_os_sem_post (&writer_sem);
+
+	g_byte_array_free (buf, TRUE);
+}
+
+#endif
@@ -13,6 +13,7 @@
 #ifndef DISABLE_JIT
 
 static void mono_linear_scan2 (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_mask);
+static gboolean mono_graph_coloring (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_mask);
 
 GList *
 mono_varlist_insert_sorted (MonoCompile *cfg, GList *list, MonoMethodVar *mv, int sort_type)
@@ -81,7 +82,8 @@ mono_linear_scan (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_ma
 	gboolean cost_driven;
 
 	if (!cfg->disable_reuse_registers && vars && (((MonoMethodVar*)vars->data)->interval != NULL)) {
-		mono_linear_scan2 (cfg, vars, regs, used_mask);
+		if (!mono_graph_coloring (cfg, vars, regs, used_mask))
+			mono_linear_scan2 (cfg, vars, regs, used_mask);
 		g_list_free (regs);
 		g_list_free (vars);
 		return;
@@ -279,6 +281,259 @@ regalloc_cost (MonoCompile *cfg, MonoMethodVar *vmv)
 	return (ins->opcode == OP_ARG) ? 1 : 0;
 }
 
+/*
+ * assign_regvars:
+ *
+ *   Turn the variables in VARS which were assigned a register into register variables
+ * if it is worth it. During allocation, the reg field of the variables is an index
+ * into REGS, and GAINS contains the spill costs saved by each register.
+ */
+static void
+assign_regvars (MonoCompile *cfg, GList *vars, GList *regs, gint32 *gains, regmask_t *used_mask)
+{
+	GList *l;
+	MonoMethodVar *vmv;
+	regmask_t used_regs = 0;
+	int n_regs, n_regvars, i;
+
+	n_regs = g_list_length (regs);
+
+	/* Decrease the gains by the cost of saving+restoring the register */
+	for (i = 0; i < n_regs; ++i) {
+		if (gains [i]) {
+			/* FIXME: This is x86 only */
+			gains [i] -= cfg->method->save_lmf ? 1 : 2;
+			if (gains [i] < 0)
+				gains [i] = 0;
+		}
+	}
+
+	/* Do the actual register assignment */
+	n_regvars = 0;
+	for (l = vars; l; l = l->next) {
+		vmv = (MonoMethodVar *)l->data;
+
+		if (vmv->reg >= 0) {
+			int reg_index = vmv->reg;
+
+			/* During allocation, vmv->reg is an index into the regs list */
+			vmv->reg = GPOINTER_TO_INT (g_list_nth_data (regs, vmv->reg));
+
+			if ((gains [reg_index] > regalloc_cost (cfg, vmv)) && (cfg->varinfo [vmv->idx]->opcode != OP_REGVAR)) {
+				if (cfg->verbose_level > 2)
+					printf ("REGVAR R%d G%d C%d %s\n", cfg->varinfo [vmv->idx]->dreg, gains [reg_index], regalloc_cost (cfg, vmv), mono_arch_regname (vmv->reg));
+				cfg->varinfo [vmv->idx]->opcode = OP_REGVAR;
+				cfg->varinfo [vmv->idx]->dreg = vmv->reg;
+				n_regvars ++;
+			}
+			else {
+				if (cfg->verbose_level > 2)
+					printf ("COSTLY: %s R%d G%d C%d %s\n", mono_method_full_name (cfg->method, TRUE), cfg->varinfo [vmv->idx]->dreg, gains [reg_index], regalloc_cost (cfg, vmv), mono_arch_regname (vmv->reg));
+				vmv->reg = -1;
+			}
+		}
+	}
+
+	cfg->stat_n_regvars = n_regvars;
+
+	/* Compute used regs */
+	used_regs = 0;
+	for (l = vars; l; l = l->next) {
+		vmv = (MonoMethodVar *)l->data;
+		
+		if (vmv->reg >= 0)
+			used_regs |= 1LL << vmv->reg;
+	}
+
+	*used_mask |= used_regs;
+}
+
+/* The maximum number of variables allocated by mono_graph_coloring () */
+#define MAX_COLORING_VARS 512
+
+#define interferes(matrix,n,i,j) ((matrix) [((i) * (n) + (j)) >> 5] & (1 << (((i) * (n) + (j)) & 31)))
+#define set_interferes(matrix,n,i,j) ((matrix) [((i) * (n) + (j)) >> 5] |= (1 << (((i) * (n) + (j)) & 31)))
+
+/*
+ * mono_graph_coloring:
+ *
+ *   Allocate the variables in VARS to the registers in REGS by coloring their
+ * interference graph, which is built from the live intervals computed by the liveness
+ * pass. Variables are removed from the graph in the Chaitin-Briggs order, spilling the
+ * ones with the smallest spill cost per neighbor optimistically when no variable has
+ * fewer neighbors than there are registers. Variables connected by moves get the same
+ * register when it is free, so the moves become nops. Returns FALSE if the method has
+ * too many variables, in which case the caller falls back to mono_linear_scan2 ().
+ */
+static gboolean
+mono_graph_coloring (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_mask)
+{
+	MonoMethodVar **nodes;
+	MonoBasicBlock *bb;
+	MonoInst *ins;
+	GSList **moves, *m;
+	GList *l;
+	guint32 *matrix;
+	int *idx_to_node, *degree, *cur_degree, **adj, *stack, *color;
+	gboolean *removed;
+	gint32 gains [sizeof (regmask_t) * 8];
+	guint64 reg_used = 0;
+	int n, n_regs, i, j, k;
+
+	n_regs = g_list_length (regs);
+	if (n_regs == 0 || n_regs > 64)
+		return FALSE;
+
+	n = 0;
+	for (l = vars; l; l = l->next) {
+		MonoMethodVar *vmv = (MonoMethodVar *)l->data;
+
+		if (vmv->interval->range)
+			n ++;
+	}
+	if (n > MAX_COLORING_VARS)
+		return FALSE;
+
+	nodes = (MonoMethodVar **)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoMethodVar*) * (n + 1));
+	idx_to_node = (int *)mono_mempool_alloc (cfg->mempool, sizeof (int) * cfg->num_varinfo);
+	for (i = 0; i < cfg->num_varinfo; ++i)
+		idx_to_node [i] = -1;
+	n = 0;
+	for (l = vars; l; l = l->next) {
+		MonoMethodVar *vmv = (MonoMethodVar *)l->data;
+
+		if (vmv->interval->range) {
+			idx_to_node [vmv->idx] = n;
+			nodes [n ++] = vmv;
+		}
+	}
+
+	/* Build the interference graph */
+	matrix = (guint32 *)mono_mempool_alloc0 (cfg->mempool, sizeof (guint32) * ((n * n + 31) / 32));
+	degree = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * (n + 1));
+	for (i = 0; i < n; ++i) {
+		for (j = i + 1; j < n; ++j) {
+			if (mono_linterval_get_intersect_pos (nodes [i]->interval, nodes [j]->interval) != -1) {
+				set_interferes (matrix, n, i, j);
+				set_interferes (matrix, n, j, i);
+				degree [i] ++;
+				degree [j] ++;
+			}
+		}
+	}
+	adj = (int **)mono_mempool_alloc0 (cfg->mempool, sizeof (int*) * (n + 1));
+	for (i = 0; i < n; ++i) {
+		adj [i] = (int *)mono_mempool_alloc (cfg->mempool, sizeof (int) * (degree [i] + 1));
+		k = 0;
+		for (j = 0; j < n; ++j) {
+			if (interferes (matrix, n, i, j))
+				adj [i][k ++] = j;
+		}
+	}
+
+	/* Collect the moves between variables which don't interfere */
+	moves = (GSList **)mono_mempool_alloc0 (cfg->mempool, sizeof (GSList*) * (n + 1));
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		for (ins = bb->code; ins; ins = ins->next) {
+			MonoInst *dvar, *svar;
+			int d, s;
+
+			if (ins->opcode != OP_MOVE)
+				continue;
+			dvar = get_vreg_to_inst (cfg, ins->dreg);
+			svar = get_vreg_to_inst (cfg, ins->sreg1);
+			if (!dvar || !svar || dvar == svar)
+				continue;
+			d = idx_to_node [dvar->inst_c0];
+			s = idx_to_node [svar->inst_c0];
+			if (d == -1 || s == -1 || interferes (matrix, n, d, s))
+				continue;
+			moves [d] = g_slist_prepend_mempool (cfg->mempool, moves [d], GINT_TO_POINTER (s));
+			moves [s] = g_slist_prepend_mempool (cfg->mempool, moves [s], GINT_TO_POINTER (d));
+		}
+	}
+
+	/* Simplify */
+	cur_degree = (int *)mono_mempool_alloc (cfg->mempool, sizeof (int) * (n + 1));
+	memcpy (cur_degree, degree, sizeof (int) * n);
+	removed = (gboolean *)mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * (n + 1));
+	stack = (int *)mono_mempool_alloc (cfg->mempool, sizeof (int) * (n + 1));
+	for (k = 0; k < n; ++k) {
+		int pick = -1;
+
+		for (i = 0; i < n; ++i) {
+			if (!removed [i] && cur_degree [i] < n_regs) {
+				pick = i;
+				break;
+			}
+		}
+		if (pick == -1) {
+			/* Choose a spill candidate, it might still get a register */
+			for (i = 0; i < n; ++i) {
+				if (removed [i])
+					continue;
+				if (pick == -1 || (gint64)nodes [i]->spill_costs * (cur_degree [pick] + 1) < (gint64)nodes [pick]->spill_costs * (cur_degree [i] + 1))
+					pick = i;
+			}
+		}
+
+		removed [pick] = TRUE;
+		stack [k] = pick;
+		for (j = 0; j < degree [pick]; ++j)
+			cur_degree [adj [pick][j]] --;
+	}
+
+	/* Select */
+	color = (int *)mono_mempool_alloc (cfg->mempool, sizeof (int) * (n + 1));
+	for (i = 0; i < n; ++i)
+		color [i] = -1;
+	for (k = n - 1; k >= 0; --k) {
+		guint64 busy = 0;
+		int c = -1;
+
+		i = stack [k];
+		for (j = 0; j < degree [i]; ++j) {
+			if (color [adj [i][j]] >= 0)
+				busy |= (guint64)1 << color [adj [i][j]];
+		}
+
+		/* Prefer the register of a variable this one is copied from or to */
+		for (m = moves [i]; m; m = m->next) {
+			int p = GPOINTER_TO_INT (m->data);
+
+			if (color [p] >= 0 && !(busy & ((guint64)1 << color [p]))) {
+				c = color [p];
+				break;
+			}
+		}
+		/* Then the registers which are already used, since each new one needs to be saved */
+		for (j = 0; j < n_regs && c == -1; ++j) {
+			if (!(busy & ((guint64)1 << j)) && (reg_used & ((guint64)1 << j)))
+				c = j;
+		}
+		for (j = 0; j < n_regs && c == -1; ++j) {
+			if (!(busy & ((guint64)1 << j)))
+				c = j;
+		}
+
+		color [i] = c;
+		if (c != -1)
+			reg_used |= (guint64)1 << c;
+		LSCAN_DEBUG (printf ("COLOR R%d: %d (degree %d cost %d)\n", cfg->varinfo [nodes [i]->idx]->dreg, c, degree [i], nodes [i]->spill_costs));
+	}
+
+	memset (gains, 0, sizeof (gains));
+	for (i = 0; i < n; ++i) {
+		nodes [i]->reg = color [i];
+		if (color [i] >= 0)
+			gains [color [i]] += nodes [i]->spill_costs;
+	}
+
+	assign_regvars (cfg, vars, regs, gains, used_mask);
+
+	return TRUE;
+}
+
 void
 mono_linear_scan2 (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_mask)
 {
@@ -286,8 +541,7 @@ mono_linear_scan2 (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_m
 	MonoMethodVar *vmv;
 	gint32 free_pos [sizeof (regmask_t) * 8];
 	gint32 gains [sizeof (regmask_t) * 8];
-	regmask_t used_regs = 0;
-	int n_regs, n_regvars, i;
+	int n_regs, i;
 
 	for (l = vars; l; l = l->next) {
 		vmv = (MonoMethodVar *)l->data;
@@ -459,54 +713,7 @@ mono_linear_scan2 (MonoCompile *cfg, GList *vars, GList *regs, regmask_t *used_m
 		}
 	}
 
-	/* Decrease the gains by the cost of saving+restoring the register */
-	for (i = 0; i < n_regs; ++i) {
-		if (gains [i]) {
-			/* FIXME: This is x86 only */
-			gains [i] -= cfg->method->save_lmf ? 1 : 2;
-			if (gains [i] < 0)
-				gains [i] = 0;
-		}
-	}
-
-	/* Do the actual register assignment */
-	n_regvars = 0;
-	for (l = vars; l; l = l->next) {
-		vmv = (MonoMethodVar *)l->data;
-
-		if (vmv->reg >= 0) {
-			int reg_index = vmv->reg;
-
-			/* During allocation, vmv->reg is an index into the regs list */
-			vmv->reg = GPOINTER_TO_INT (g_list_nth_data (regs, vmv->reg));
-
-			if ((gains [reg_index] > regalloc_cost (cfg, vmv)) && (cfg->varinfo [vmv->idx]->opcode != OP_REGVAR)) {
-				if (cfg->verbose_level > 2)
-					printf ("REGVAR R%d G%d C%d %s\n", cfg->varinfo [vmv->idx]->dreg, gains [reg_index], regalloc_cost (cfg, vmv), mono_arch_regname (vmv->reg));
-				cfg->varinfo [vmv->idx]->opcode = OP_REGVAR;
-				cfg->varinfo [vmv->idx]->dreg = vmv->reg;
-				n_regvars ++;
-			}
-			else {
-				if (cfg->verbose_level > 2)
-					printf ("COSTLY: %s R%d G%d C%d %s\n", mono_method_full_name (cfg->method, TRUE), cfg->varinfo [vmv->idx]->dreg, gains [reg_index], regalloc_cost (cfg, vmv), mono_arch_regname (vmv->reg));
-				vmv->reg = -1;
-			}
-		}
-	}
-
-	cfg->stat_n_regvars = n_regvars;
-
-	/* Compute used regs */
-	used_regs = 0;
-	for (l = vars; l; l = l->next) {
-		vmv = (MonoMethodVar *)l->data;
-		
-		if (vmv->reg >= 0)
-			used_regs |= 1LL << vmv->reg;
-	}
-
-	*used_mask |= used_regs;
+	assign_regvars (cfg, vars, regs, gains, used_mask);
 
 	g_list_free (active);
 	g_list_free (inactive);
@@ -80,6 +80,11 @@
 #define BRANCH_COST 10
 #define INLINE_LENGTH_LIMIT 20
 
+/* Element addresses of multi-dimensional arrays up to this rank are computed inline */
+#define MONO_INLINE_ARRAY_RANK_MAX 4
+
+#define ALIGN_TO(val,align) (((val) + ((align) - 1)) & ~((align) - 1))
+
 /* These have 'cfg' as an implicit argument */
 #define INLINE_FAILURE(msg) do {									\
 	if ((cfg->method != cfg->current_method) && (cfg->current_method->wrapper_type == MONO_WRAPPER_NONE)) { \
@@ -138,6 +143,16 @@
 /* Determine whenever 'ins' represents a load of the 'this' argument */
 #define MONO_CHECK_THIS(ins) (mono_method_signature (cfg->method)->hasthis && ((ins)->opcode == OP_MOVE) && ((ins)->sreg1 == cfg->args [0]->dreg))
 
+/*
+ * Whether the code needs to handle transparent proxies. AOT code can run in
+ * processes which create them.
+ */
+#ifndef DISABLE_REMOTING
+#define MINI_CHECK_PROXIES(cfg) (mono_remoting_in_use || (cfg)->compile_aot)
+#else
+#define MINI_CHECK_PROXIES(cfg) FALSE
+#endif
+
 static int ldind_to_load_membase (int opcode);
 static int stind_to_store_membase (int opcode);
 
@@ -155,6 +170,7 @@ emit_llvmonly_virtual_call (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSig
 static MonoMethodSignature *helper_sig_domain_get;
 static MonoMethodSignature *helper_sig_rgctx_lazy_fetch_trampoline;
 static MonoMethodSignature *helper_sig_llvmonly_imt_thunk;
+static MonoMethodSignature *helper_sig_create_instance;
 
 
 /* type loading helpers */
@@ -365,6 +381,7 @@ mono_create_helper_signatures (void)
 	helper_sig_domain_get = mono_create_icall_signature ("ptr");
 	helper_sig_rgctx_lazy_fetch_trampoline = mono_create_icall_signature ("ptr ptr");
 	helper_sig_llvmonly_imt_thunk = mono_create_icall_signature ("ptr ptr ptr");
+	helper_sig_create_instance = mono_create_icall_signature ("object");
 }
 
 static MONO_NEVER_INLINE void
@@ -2135,6 +2152,98 @@ emit_instrumentation_call (MonoCompile *cfg, void *func)
 	}
 }
 
+/*
+ * emit_tier0_counter:
+ *
+ *   Count down COUNTER, which belongs to cfg->tier0_info, and have the method promoted
+ * to tier 1 when it drops below zero. The counter is updated without atomics, losing a
+ * few counts to races is harmless.
+ */
+static void
+emit_tier0_counter (MonoCompile *cfg, gint32 *counter)
+{
+	MonoBasicBlock *cont_bb;
+	MonoInst *args [1];
+	int addr_reg, count_reg;
+
+	addr_reg = alloc_preg (cfg);
+	count_reg = alloc_ireg (cfg);
+
+	MONO_EMIT_NEW_PCONST (cfg, addr_reg, counter);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, count_reg, addr_reg, 0);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISUB_IMM, count_reg, count_reg, 1);
+	MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, addr_reg, 0, count_reg);
+
+	NEW_BBLOCK (cfg, cont_bb);
+
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, count_reg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBGE, cont_bb);
+
+	EMIT_NEW_PCONST (cfg, args [0], cfg->tier0_info);
+	mono_emit_jit_icall (cfg, mono_tiered_promote, args);
+
+	MONO_START_BB (cfg, cont_bb);
+}
+
+/*
+ * emit_tier0_call_site_counter:
+ *
+ *   Count the executions of the call at IL_OFFSET, see mono_tiered_get_inline_limit ().
+ */
+static void
+emit_tier0_call_site_counter (MonoCompile *cfg, int il_offset)
+{
+	int addr_reg, count_reg;
+
+	addr_reg = alloc_preg (cfg);
+	count_reg = alloc_ireg (cfg);
+
+	MONO_EMIT_NEW_PCONST (cfg, addr_reg, mono_tiered_get_call_site (cfg->tier0_info, il_offset));
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, count_reg, addr_reg, MONO_STRUCT_OFFSET (MonoTieredCallSite, count));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, count_reg, count_reg, 1);
+	MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, addr_reg, MONO_STRUCT_OFFSET (MonoTieredCallSite, count), count_reg);
+}
+
+/*
+ * emit_tier0_receiver_profile:
+ *
+ *   Record the vtable of THIS_INS in the profile of the virtual call at IL_OFFSET: the
+ * first receiver is stored, calls on other receivers are counted as misses.
+ */
+static void
+emit_tier0_receiver_profile (MonoCompile *cfg, int il_offset, MonoInst *this_ins)
+{
+	MonoBasicBlock *miss_bb, *done_bb;
+	int site_reg, vtable_reg, receiver_reg, misses_reg;
+
+	site_reg = alloc_preg (cfg);
+	vtable_reg = alloc_preg (cfg);
+	receiver_reg = alloc_preg (cfg);
+	misses_reg = alloc_ireg (cfg);
+
+	NEW_BBLOCK (cfg, miss_bb);
+	NEW_BBLOCK (cfg, done_bb);
+
+	MONO_EMIT_NEW_PCONST (cfg, site_reg, mono_tiered_get_call_site (cfg->tier0_info, il_offset));
+	MONO_EMIT_NEW_LOAD_MEMBASE_FAULT (cfg, vtable_reg, this_ins->dreg, MONO_STRUCT_OFFSET (MonoObject, vtable));
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, receiver_reg, site_reg, MONO_STRUCT_OFFSET (MonoTieredCallSite, receiver));
+	MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, vtable_reg, receiver_reg);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, done_bb);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, receiver_reg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBNE_UN, miss_bb);
+
+	/* First receiver */
+	MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STORE_MEMBASE_REG, site_reg, MONO_STRUCT_OFFSET (MonoTieredCallSite, receiver), vtable_reg);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, done_bb);
+
+	MONO_START_BB (cfg, miss_bb);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, misses_reg, site_reg, MONO_STRUCT_OFFSET (MonoTieredCallSite, receiver_misses));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, misses_reg, misses_reg, 1);
+	MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, site_reg, MONO_STRUCT_OFFSET (MonoTieredCallSite, receiver_misses), misses_reg);
+
+	MONO_START_BB (cfg, done_bb);
+}
+
 static int
 ret_type_to_call_opcode (MonoCompile *cfg, MonoType *type, int calli, int virt)
 {
@@ -2774,6 +2883,143 @@ emit_get_rgctx_method (MonoCompile *cfg, int context_used, MonoMethod *cmethod,
 static MonoInst*
 emit_get_rgctx_klass (MonoCompile *cfg, int context_used, MonoClass *klass, MonoRgctxInfoType rgctx_type);
 
+/*
+ * emit_stat_counter_inc:
+ *
+ *   Increment the jit stats counter COUNTER at runtime. The counter is updated without
+ * atomics, it is only used when --stats is enabled.
+ */
+static void
+emit_stat_counter_inc (MonoCompile *cfg, gint32 *counter)
+{
+	int addr_reg, count_reg;
+
+	addr_reg = alloc_preg (cfg);
+	count_reg = alloc_ireg (cfg);
+
+	MONO_EMIT_NEW_PCONST (cfg, addr_reg, counter);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, count_reg, addr_reg, 0);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, count_reg, count_reg, 1);
+	MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, addr_reg, 0, count_reg);
+}
+
+/*
+ * emit_iface_call_ic:
+ *
+ *   Emit a polymorphic inline cache for calling the interface method METHOD on
+ * THIS_INS, and return the address to call. The cache holds the code called for the
+ * last MONO_IFACE_IC_SIZE receiver vtables seen at this call site, so calls on classes
+ * with IMT collisions don't have to search the IMT thunk. Misses call through the
+ * IMT slot, so the call still needs the IMT argument. This has to be emitted
+ * before the arguments of the call, since the slowpath makes a call.
+ *
+ * Calls to the generic virtual method instance METHOD use the same cache. Their
+ * misses call through the vtable slot, or the IMT slot for interface methods, which
+ * points to the generic virtual thunk once the instance has been called often enough.
+ */
+static MonoInst*
+emit_iface_call_ic (MonoCompile *cfg, MonoMethod *method, MonoInst *this_ins)
+{
+	MonoIfaceInlineCache *ic;
+	MonoBasicBlock *hit_bb, *miss_bb, *megamorphic_bb, *end_bb;
+	MonoInst *cache, *method_ins, *res, *args [3];
+	int vtable_reg, entry_reg, key_reg, updates_reg, target_reg, i, slot_offset;
+	gboolean gvm = mono_method_signature (method)->generic_param_count > 0;
+	gint32 *hits, *misses, *megamorphic_misses;
+
+	ic = (MonoIfaceInlineCache *)mono_domain_alloc0 (cfg->domain, sizeof (MonoIfaceInlineCache));
+	if (gvm) {
+		cfg->stat_gvm_inline_caches++;
+		hits = &mono_jit_stats.gvm_ic_hits;
+		misses = &mono_jit_stats.gvm_ic_misses;
+		megamorphic_misses = &mono_jit_stats.gvm_ic_megamorphic_misses;
+	} else {
+		cfg->stat_iface_inline_caches++;
+		hits = &mono_jit_stats.iface_ic_hits;
+		misses = &mono_jit_stats.iface_ic_misses;
+		megamorphic_misses = &mono_jit_stats.iface_ic_megamorphic_misses;
+	}
+
+	if (method->klass->flags & TYPE_ATTRIBUTE_INTERFACE)
+		slot_offset = ((gint32)mono_method_get_imt_slot (method) - MONO_IMT_SIZE) * SIZEOF_VOID_P;
+	else
+		slot_offset = MONO_STRUCT_OFFSET (MonoVTable, vtable) + (mono_method_get_vtable_index (method) * SIZEOF_VOID_P);
+
+	NEW_BBLOCK (cfg, hit_bb);
+	NEW_BBLOCK (cfg, miss_bb);
+	NEW_BBLOCK (cfg, megamorphic_bb);
+	NEW_BBLOCK (cfg, end_bb);
+
+	vtable_reg = alloc_preg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE_FAULT (cfg, vtable_reg, this_ins->dreg, MONO_STRUCT_OFFSET (MonoObject, vtable));
+
+	EMIT_NEW_PCONST (cfg, cache, ic);
+
+	target_reg = alloc_preg (cfg);
+
+	/* Fastpath, entries are filled in order, so the first empty one ends the search */
+	for (i = 0; i < MONO_IFACE_IC_SIZE; ++i) {
+		MonoBasicBlock *next_bb;
+
+		NEW_BBLOCK (cfg, next_bb);
+
+		entry_reg = alloc_preg (cfg);
+		MONO_EMIT_NEW_LOAD_MEMBASE (cfg, entry_reg, cache->dreg, MONO_STRUCT_OFFSET (MonoIfaceInlineCache, entries) + (i * SIZEOF_VOID_P));
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, entry_reg, 0);
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, miss_bb);
+		key_reg = alloc_preg (cfg);
+		MONO_EMIT_NEW_LOAD_MEMBASE (cfg, key_reg, entry_reg, MONO_STRUCT_OFFSET (MonoIfaceInlineCacheEntry, vtable));
+		MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, key_reg, vtable_reg);
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBNE_UN, next_bb);
+		MONO_EMIT_NEW_LOAD_MEMBASE (cfg, target_reg, entry_reg, MONO_STRUCT_OFFSET (MonoIfaceInlineCacheEntry, code));
+		MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, hit_bb);
+
+		MONO_START_BB (cfg, next_bb);
+	}
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, miss_bb);
+
+	MONO_START_BB (cfg, hit_bb);
+	if (mono_jit_stats.enabled)
+		emit_stat_counter_inc (cfg, hits);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+
+	/* Slowpath, update the cache while it has updates left */
+	MONO_START_BB (cfg, miss_bb);
+	updates_reg = alloc_ireg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, updates_reg, cache->dreg, MONO_STRUCT_OFFSET (MonoIfaceInlineCache, updates));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, updates_reg, MONO_IFACE_IC_MAX_UPDATES);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBGE, megamorphic_bb);
+	if (mono_jit_stats.enabled)
+		emit_stat_counter_inc (cfg, misses);
+	EMIT_NEW_METHODCONST (cfg, method_ins, method);
+	args [0] = cache;
+	args [1] = this_ins;
+	args [2] = method_ins;
+	if (gvm)
+		mono_emit_jit_icall (cfg, mono_gvm_ic_update, args);
+	else
+		mono_emit_jit_icall (cfg, mono_iface_ic_update, args);
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, target_reg, vtable_reg, slot_offset);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+
+	/* Megamorphic call site, only use the IMT thunk */
+	MONO_START_BB (cfg, megamorphic_bb);
+	if (mono_jit_stats.enabled)
+		emit_stat_counter_inc (cfg, megamorphic_misses);
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, target_reg, vtable_reg, slot_offset);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+
+	MONO_START_BB (cfg, end_bb);
+
+	MONO_INST_NEW (cfg, res, OP_MOVE);
+	res->dreg = alloc_preg (cfg);
+	res->sreg1 = target_reg;
+	res->type = STACK_PTR;
+	MONO_ADD_INS (cfg->cbb, res);
+
+	return res;
+}
+
 static MonoInst*
 mono_emit_method_call_full (MonoCompile *cfg, MonoMethod *method, MonoMethodSignature *sig, gboolean tail,
 							MonoInst **args, MonoInst *this_ins, MonoInst *imt_arg, MonoInst *rgctx_arg)
@@ -2812,7 +3058,7 @@ mono_emit_method_call_full (MonoCompile *cfg, MonoMethod *method, MonoMethodSign
 	context_used = mini_method_check_context_used (cfg, method);
 
 #ifndef DISABLE_REMOTING
-	might_be_remote = this_ins && sig->hasthis &&
+	might_be_remote = MINI_CHECK_PROXIES (cfg) && this_ins && sig->hasthis &&
 		(mono_class_is_marshalbyref (method->klass) || method->klass == mono_defaults.object_class) &&
 		!(method->flags & METHOD_ATTRIBUTE_VIRTUAL) && (!MONO_CHECK_THIS (this_ins) || context_used);
 
@@ -2830,6 +3076,18 @@ mono_emit_method_call_full (MonoCompile *cfg, MonoMethod *method, MonoMethodSign
 	if (cfg->llvm_only && !call_target && virtual_ && (method->flags & METHOD_ATTRIBUTE_VIRTUAL))
 		return emit_llvmonly_virtual_call (cfg, method, sig, 0, args);
 
+	/*
+	 * The inline cache is allocated in the domain, so it can't be used by AOT or domain
+	 * neutral code. Calls in shared code pass the IMT method in IMT_ARG and go through
+	 * the IMT thunk. Generic virtual calls have an IMT_ARG too, but when the instance
+	 * doesn't depend on the generic context, it is the same for every call.
+	 */
+	if (virtual_ && (method->flags & METHOD_ATTRIBUTE_VIRTUAL) &&
+		(((method->klass->flags & TYPE_ATTRIBUTE_INTERFACE) && !imt_arg) || (imt_arg && sig->generic_param_count && method->is_inflated)) &&
+		!context_used && !cfg->compile_aot && !COMPILE_LLVM (cfg) && !cfg->gsharedvt &&
+		!(cfg->opt & MONO_OPT_SHARED) && !cfg->after_method_to_ir && cfg->cbb != cfg->bb_init)
+		call_target = emit_iface_call_ic (cfg, method, this_ins);
+
 	need_unbox_trampoline = method->klass == mono_defaults.object_class || (method->klass->flags & TYPE_ATTRIBUTE_INTERFACE);
 
 	call = mono_emit_call_args (cfg, sig, args, FALSE, virtual_, tail, rgctx_arg ? TRUE : FALSE, need_unbox_trampoline);
@@ -2887,7 +3145,7 @@ mono_emit_method_call_full (MonoCompile *cfg, MonoMethod *method, MonoMethodSign
 			 * and then we can call the method directly.
 			 */
 #ifndef DISABLE_REMOTING
-			if (mono_class_is_marshalbyref (method->klass) || method->klass == mono_defaults.object_class) {
+			if (MINI_CHECK_PROXIES (cfg) && (mono_class_is_marshalbyref (method->klass) || method->klass == mono_defaults.object_class)) {
 				/* 
 				 * The check above ensures method is not gshared, this is needed since
 				 * gshared methods can't have wrappers.
@@ -2916,6 +3174,9 @@ mono_emit_method_call_full (MonoCompile *cfg, MonoMethod *method, MonoMethodSign
 			call->inst.opcode = callvirt_to_call_reg (call->inst.opcode);
 			call->inst.sreg1 = call_target->dreg;
 			call->inst.flags &= !MONO_INST_HAS_METHOD;
+			/* Inline cache misses call the IMT thunk or the generic virtual thunk */
+			if ((method->klass->flags & TYPE_ATTRIBUTE_INTERFACE) || imt_arg)
+				emit_imt_argument (cfg, call, call->method, imt_arg);
 		} else {
 			vtable_reg = alloc_preg (cfg);
 			MONO_EMIT_NEW_LOAD_MEMBASE_FAULT (cfg, vtable_reg, this_reg, MONO_STRUCT_OFFSET (MonoObject, vtable));
@@ -3215,13 +3476,20 @@ emit_write_barrier (MonoCompile *cfg, MonoInst *ptr, MonoInst *value)
 	MonoInst *dummy_use;
 	int nursery_shift_bits;
 	size_t nursery_size;
+	gpointer nursery_start;
+	gboolean nursery_check;
 
 	if (!cfg->gen_write_barriers)
 		return;
 
+	/* Storing null never needs a barrier. */
+	if (value->opcode == OP_PCONST && value->inst_c0 == 0)
+		return;
+
 	card_table = mono_gc_get_card_table (&card_table_shift_bits, &card_table_mask);
 
-	mono_gc_get_nursery (&nursery_shift_bits, &nursery_size);
+	nursery_start = mono_gc_get_nursery (&nursery_shift_bits, &nursery_size);
+	nursery_check = mono_gc_card_table_nursery_check ();
 
 	if (cfg->backend->have_card_table_wb && !cfg->compile_aot && card_table && nursery_shift_bits > 0 && !COMPILE_LLVM (cfg)) {
 		MonoInst *wbarrier;
@@ -3230,12 +3498,25 @@ emit_write_barrier (MonoCompile *cfg, MonoInst *ptr, MonoInst *value)
 		wbarrier->sreg1 = ptr->dreg;
 		wbarrier->sreg2 = value->dreg;
 		MONO_ADD_INS (cfg->cbb, wbarrier);
-	} else if (card_table && !cfg->compile_aot && !mono_gc_card_table_nursery_check ()) {
+	} else if (card_table && !cfg->compile_aot && (!nursery_check || nursery_shift_bits > 0)) {
 		int offset_reg = alloc_preg (cfg);
 		int card_reg;
 		MonoInst *ins;
+		MonoBasicBlock *done_bb = NULL;
 
-		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_SHR_UN_IMM, offset_reg, ptr->dreg, card_table_shift_bits);
+		if (nursery_check) {
+			/* Only stores of nursery pointers need their card marked. */
+			int shifted_value_reg = alloc_preg (cfg);
+			int shifted_nursery_reg = alloc_preg (cfg);
+
+			NEW_BBLOCK (cfg, done_bb);
+			MONO_EMIT_NEW_BIALU_IMM (cfg, OP_PSHR_UN_IMM, shifted_value_reg, value->dreg, nursery_shift_bits);
+			MONO_EMIT_NEW_PCONST (cfg, shifted_nursery_reg, (gpointer)((gsize)nursery_start >> nursery_shift_bits));
+			MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, shifted_value_reg, shifted_nursery_reg);
+			MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBNE_UN, done_bb);
+		}
+
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_PSHR_UN_IMM, offset_reg, ptr->dreg, card_table_shift_bits);
 		if (card_table_mask)
 			MONO_EMIT_NEW_BIALU_IMM (cfg, OP_PAND_IMM, offset_reg, offset_reg, card_table_mask);
 
@@ -3247,6 +3528,9 @@ emit_write_barrier (MonoCompile *cfg, MonoInst *ptr, MonoInst *value)
 
 		MONO_EMIT_NEW_BIALU (cfg, OP_PADD, offset_reg, offset_reg, card_reg);
 		MONO_EMIT_NEW_STORE_MEMBASE_IMM (cfg, OP_STOREI1_MEMBASE_IMM, offset_reg, 0, 1);
+
+		if (done_bb)
+			MONO_START_BB (cfg, done_bb);
 	} else {
 		MonoMethod *write_barrier = mono_gc_get_write_barrier ();
 		mono_emit_method_call (cfg, write_barrier, &ptr, NULL);
@@ -3660,6 +3944,67 @@ emit_rgctx_fetch_inline (MonoCompile *cfg, MonoInst *rgctx, MonoJumpInfoRgctxEnt
 #endif
 }
 
+/*
+ * emit_rgctx_fetch_ic:
+ *
+ *   Same as emit_rgctx_fetch (), but check an inline cache holding the last (rgctx, value)
+ * pair seen at this call site first. Shared code mostly runs with a few instantiations, so
+ * most fetches become a few loads instead of a call to the lazy fetch trampoline, which
+ * also clobbers the caller saved registers.
+ */
+static MonoInst*
+emit_rgctx_fetch_ic (MonoCompile *cfg, MonoInst *rgctx, MonoJumpInfoRgctxEntry *entry)
+{
+	MonoRgctxInlineCache *ic;
+	MonoBasicBlock *miss_bb, *end_bb;
+	MonoInst *cache, *res, *call, *args [3];
+	int entry_reg, key_reg, updates_reg, res_reg;
+
+	ic = (MonoRgctxInlineCache *)mono_domain_alloc0 (cfg->domain, sizeof (MonoRgctxInlineCache));
+	cfg->stat_rgctx_inline_caches++;
+
+	NEW_BBLOCK (cfg, miss_bb);
+	NEW_BBLOCK (cfg, end_bb);
+
+	EMIT_NEW_PCONST (cfg, cache, ic);
+
+	/* Fastpath */
+	entry_reg = alloc_preg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, entry_reg, cache->dreg, MONO_STRUCT_OFFSET (MonoRgctxInlineCache, entry));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, entry_reg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, miss_bb);
+	key_reg = alloc_preg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, key_reg, entry_reg, MONO_STRUCT_OFFSET (MonoRgctxInlineCacheEntry, rgctx));
+	MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, key_reg, rgctx->dreg);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBNE_UN, miss_bb);
+	res_reg = alloc_preg (cfg);
+	MONO_INST_NEW (cfg, res, OP_LOAD_MEMBASE);
+	res->dreg = res_reg;
+	res->inst_basereg = entry_reg;
+	res->inst_offset = MONO_STRUCT_OFFSET (MonoRgctxInlineCacheEntry, value);
+	res->type = STACK_PTR;
+	MONO_ADD_INS (cfg->cbb, res);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+
+	/* Slowpath, update the cache while it has updates left */
+	MONO_START_BB (cfg, miss_bb);
+	call = mono_emit_abs_call (cfg, MONO_PATCH_INFO_RGCTX_FETCH, entry, helper_sig_rgctx_lazy_fetch_trampoline, &rgctx);
+	MONO_EMIT_NEW_UNALU (cfg, OP_MOVE, res_reg, call->dreg);
+	updates_reg = alloc_ireg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, updates_reg, cache->dreg, MONO_STRUCT_OFFSET (MonoRgctxInlineCache, updates));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, updates_reg, MONO_RGCTX_IC_MAX_UPDATES);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBGE, end_bb);
+	args [0] = cache;
+	args [1] = rgctx;
+	args [2] = call;
+	mono_emit_jit_icall (cfg, mono_rgctx_ic_update, args);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+
+	MONO_START_BB (cfg, end_bb);
+
+	return res;
+}
+
 /*
  * emit_rgctx_fetch:
  *
@@ -3671,6 +4016,13 @@ emit_rgctx_fetch (MonoCompile *cfg, MonoInst *rgctx, MonoJumpInfoRgctxEntry *ent
 {
 	if (cfg->llvm_only)
 		return emit_rgctx_fetch_inline (cfg, rgctx, entry);
+	/*
+	 * The inline cache is allocated in the domain, so it can't be used by AOT or domain
+	 * neutral code. It needs new bblocks, which can't be added to the init bblock, or
+	 * during decompose.
+	 */
+	else if (!cfg->compile_aot && !(cfg->opt & MONO_OPT_SHARED) && !cfg->after_method_to_ir && cfg->cbb != cfg->bb_init)
+		return emit_rgctx_fetch_ic (cfg, rgctx, entry);
 	else
 		return mono_emit_abs_call (cfg, MONO_PATCH_INFO_RGCTX_FETCH, entry, helper_sig_rgctx_lazy_fetch_trampoline, &rgctx);
 }
@@ -3883,6 +4235,11 @@ emit_class_init (MonoCompile *cfg, MonoClass *klass)
 		 */
 		MONO_INST_NEW (cfg, ins, OP_GENERIC_CLASS_INIT);
 		ins->sreg1 = vtable_arg->dreg;
+		/*
+		 * Whenever the vtable is a constant, the backend can remove the check once the
+		 * class is initialized. AOT code is not writable and is shared between domains.
+		 */
+		ins->inst_c0 = !context_used && !cfg->compile_aot && !(cfg->opt & MONO_OPT_SHARED);
 		MONO_ADD_INS (cfg->cbb, ins);
 	} else {
 		static int byte_offset = -1;
@@ -4208,6 +4565,36 @@ handle_unbox_gsharedvt (MonoCompile *cfg, MonoClass *klass, MonoInst *obj)
 	return ins;
 }
 
+/* The largest objects considered by mono_ssa_scalar_replace () */
+#define SCALAR_REPLACE_MAX_SIZE 128
+
+/*
+ * is_scalar_replace_candidate:
+ *
+ *   Return whenever the allocation of KLASS can be emitted as an OP_NEWOBJ, so the
+ * object can be replaced by its fields if it doesn't escape the method.
+ */
+static gboolean
+is_scalar_replace_candidate (MonoCompile *cfg, MonoClass *klass)
+{
+	MonoClass *k;
+
+	if (!(cfg->opt & MONO_OPT_ESCAPE) || !(cfg->opt & MONO_OPT_SSA) || cfg->disable_ssa || COMPILE_LLVM (cfg))
+		return FALSE;
+	if (klass->valuetype || klass->rank || klass == mono_defaults.string_class || klass->has_finalize)
+		return FALSE;
+	if (mono_class_is_marshalbyref (klass) || mono_class_is_contextbound (klass))
+		return FALSE;
+	if (mono_class_instance_size (klass) > SCALAR_REPLACE_MAX_SIZE)
+		return FALSE;
+	/* Overlapping fields can't be replaced by separate variables */
+	for (k = klass; k; k = k->parent) {
+		if ((k->flags & TYPE_ATTRIBUTE_LAYOUT_MASK) == TYPE_ATTRIBUTE_EXPLICIT_LAYOUT)
+			return FALSE;
+	}
+	return TRUE;
+}
+
 /*
  * Returns NULL and set the cfg exception on error.
  */
@@ -4282,6 +4669,24 @@ handle_alloc (MonoCompile *cfg, MonoClass *klass, gboolean for_box, int context_
 			if (size < sizeof (MonoObject))
 				g_error ("Invalid size %d for class %s", size, mono_type_get_full_name (klass));
 
+			if (!for_box && is_scalar_replace_candidate (cfg, klass)) {
+				MonoInst *ins;
+
+				/* Decomposed later, after mono_ssa_scalar_replace () */
+				MONO_INST_NEW (cfg, ins, OP_NEWOBJ);
+				ins->dreg = alloc_ireg_ref (cfg);
+				ins->inst_p0 = vtable;
+				ins->klass = klass;
+				ins->type = STACK_OBJ;
+				MONO_ADD_INS (cfg->cbb, ins);
+				cfg->flags |= MONO_CFG_HAS_ARRAY_ACCESS;
+				cfg->cbb->has_array_access = TRUE;
+
+				/* Needed so mono_emit_load_get_addr () gets called */
+				mono_get_got_var (cfg);
+				return ins;
+			}
+
 			EMIT_NEW_VTABLECONST (cfg, iargs [0], vtable);
 			EMIT_NEW_ICONST (cfg, iargs [1], size);
 			return mono_emit_method_call (cfg, managed_alloc, iargs, NULL);
@@ -4587,8 +4992,8 @@ handle_castclass (MonoCompile *cfg, MonoClass *klass, MonoInst *src, int context
 			/* obj */
 			args [0] = src;
 
-			/* klass - it's the second element of the cache entry*/
-			EMIT_NEW_LOAD_MEMBASE (cfg, args [1], OP_LOAD_MEMBASE, alloc_preg (cfg), cache_ins->dreg, sizeof (gpointer));
+			/* klass - it's stored after the entries of the cache*/
+			EMIT_NEW_LOAD_MEMBASE (cfg, args [1], OP_LOAD_MEMBASE, alloc_preg (cfg), cache_ins->dreg, sizeof (gpointer) * MONO_CAST_CACHE_ENTRIES);
 
 			/* cache */
 			args [2] = cache_ins;
@@ -4663,8 +5068,8 @@ handle_isinst (MonoCompile *cfg, MonoClass *klass, MonoInst *src, int context_us
 
 			args [0] = src; /* obj */
 
-			/* klass - it's the second element of the cache entry*/
-			EMIT_NEW_LOAD_MEMBASE (cfg, args [1], OP_LOAD_MEMBASE, alloc_preg (cfg), cache_ins->dreg, sizeof (gpointer));
+			/* klass - it's stored after the entries of the cache*/
+			EMIT_NEW_LOAD_MEMBASE (cfg, args [1], OP_LOAD_MEMBASE, alloc_preg (cfg), cache_ins->dreg, sizeof (gpointer) * MONO_CAST_CACHE_ENTRIES);
 
 			args [2] = cache_ins; /* cache */
 			return emit_isinst_with_cache (cfg, klass, args);
@@ -5301,11 +5706,17 @@ mono_emit_load_got_addr (MonoCompile *cfg)
 static int inline_limit;
 static gboolean inline_limit_inited;
 
+/*
+ * mono_method_check_inlining:
+ *
+ *   Return whenever METHOD can be inlined at the call at IP.
+ */
 static gboolean
-mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method)
+mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method, guint8 *ip)
 {
 	MonoMethodHeaderSummary header;
 	MonoVTable *vtable;
+	int limit;
 #ifdef MONO_ARCH_SOFT_FLOAT_FALLBACK
 	MonoMethodSignature *sig = mono_method_signature (method);
 	int i;
@@ -5325,7 +5736,7 @@ mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method)
 	/*runtime, icall and pinvoke are checked by summary call*/
 	if ((method->iflags & METHOD_IMPL_ATTRIBUTE_NOINLINING) ||
 	    (method->iflags & METHOD_IMPL_ATTRIBUTE_SYNCHRONIZED) ||
-	    (mono_class_is_marshalbyref (method->klass)) ||
+	    (MINI_CHECK_PROXIES (cfg) && mono_class_is_marshalbyref (method->klass)) ||
 	    header.has_clauses)
 		return FALSE;
 
@@ -5338,7 +5749,11 @@ mono_method_check_inlining (MonoCompile *cfg, MonoMethod *method)
 			inline_limit = INLINE_LENGTH_LIMIT;
 		inline_limit_inited = TRUE;
 	}
-	if (header.code_size >= inline_limit && !(method->iflags & METHOD_IMPL_ATTRIBUTE_AGGRESSIVE_INLINING))
+	limit = inline_limit;
+	/* The call site counts only cover the calls made by the method itself */
+	if (cfg->call_profile && cfg->inline_depth == 0)
+		limit = mono_tiered_get_inline_limit (cfg->call_profile, ip - cfg->cil_start, limit);
+	if (header.code_size >= limit && !(method->iflags & METHOD_IMPL_ATTRIBUTE_AGGRESSIVE_INLINING))
 		return FALSE;
 
 	/*
@@ -5516,69 +5931,73 @@ mini_emit_ldelema_1_ins (MonoCompile *cfg, MonoClass *klass, MonoInst *arr, Mono
 	return ins;
 }
 
+/*
+ * mini_emit_ldelema_n_ins:
+ *
+ *   Emit the address computation of an element of a multi-dimensional array of
+ * rank RANK, with the indexes in INDEXES. The offset is computed with Horner's
+ * rule, ((i0 * len1 + i1) * len2 + i2) ..., so there is a single multiplication
+ * per dimension and one scaling by the element size. The bounds of an array
+ * never change, so their loads are marked invariant, which allows them to be
+ * shared between accesses by gvn and to be hoisted out of loops by LLVM.
+ */
 static MonoInst*
-mini_emit_ldelema_2_ins (MonoCompile *cfg, MonoClass *klass, MonoInst *arr, MonoInst *index_ins1, MonoInst *index_ins2)
+mini_emit_ldelema_n_ins (MonoCompile *cfg, MonoClass *klass, MonoInst *arr, MonoInst **indexes, int rank)
 {
 	int bounds_reg = alloc_preg (cfg);
 	int add_reg = alloc_ireg_mp (cfg);
-	int mult_reg = alloc_preg (cfg);
 	int mult2_reg = alloc_preg (cfg);
-	int low1_reg = alloc_preg (cfg);
-	int low2_reg = alloc_preg (cfg);
-	int high1_reg = alloc_preg (cfg);
-	int high2_reg = alloc_preg (cfg);
-	int realidx1_reg = alloc_preg (cfg);
-	int realidx2_reg = alloc_preg (cfg);
-	int sum_reg = alloc_preg (cfg);
-	int index1, index2, tmpreg;
+	int sum_reg = -1;
+	int index, tmpreg, low_reg, high_reg, realidx_reg, mult_reg, dim;
 	MonoInst *ins;
 	guint32 size;
 
+	g_assert (rank >= 2 && rank <= MONO_INLINE_ARRAY_RANK_MAX);
+
 	mono_class_init (klass);
 	size = mono_class_array_element_size (klass);
 
-	index1 = index_ins1->dreg;
-	index2 = index_ins2->dreg;
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, bounds_reg, 
+				       arr->dreg, MONO_STRUCT_OFFSET (MonoArray, bounds));
+
+	for (dim = 0; dim < rank; ++dim) {
+		index = indexes [dim]->dreg;
 
 #if SIZEOF_REGISTER == 8
-	/* The array reg is 64 bits but the index reg is only 32 */
-	if (COMPILE_LLVM (cfg)) {
-		/* Not needed */
-	} else {
-		tmpreg = alloc_preg (cfg);
-		MONO_EMIT_NEW_UNALU (cfg, OP_SEXT_I4, tmpreg, index1);
-		index1 = tmpreg;
-		tmpreg = alloc_preg (cfg);
-		MONO_EMIT_NEW_UNALU (cfg, OP_SEXT_I4, tmpreg, index2);
-		index2 = tmpreg;
-	}
+		/* The array reg is 64 bits but the index reg is only 32 */
+		if (!COMPILE_LLVM (cfg)) {
+			tmpreg = alloc_preg (cfg);
+			MONO_EMIT_NEW_UNALU (cfg, OP_SEXT_I4, tmpreg, index);
+			index = tmpreg;
+		}
 #else
-	// FIXME: Do we need to do something here for i8 indexes, like in ldelema_1_ins ?
-	tmpreg = -1;
+		// FIXME: Do we need to do something here for i8 indexes, like in ldelema_1_ins ?
+		tmpreg = -1;
 #endif
 
-	/* range checking */
-	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, bounds_reg, 
-				       arr->dreg, MONO_STRUCT_OFFSET (MonoArray, bounds));
+		/* range checking */
+		low_reg = alloc_preg (cfg);
+		high_reg = alloc_preg (cfg);
+		realidx_reg = alloc_preg (cfg);
+		MONO_EMIT_NEW_LOAD_MEMBASE_OP_INVARIANT (cfg, OP_LOADI4_MEMBASE, low_reg, 
+					       bounds_reg, dim * sizeof (MonoArrayBounds) + MONO_STRUCT_OFFSET (MonoArrayBounds, lower_bound));
+		MONO_EMIT_NEW_BIALU (cfg, OP_PSUB, realidx_reg, index, low_reg);
+		MONO_EMIT_NEW_LOAD_MEMBASE_OP_INVARIANT (cfg, OP_LOADI4_MEMBASE, high_reg, 
+					       bounds_reg, dim * sizeof (MonoArrayBounds) + MONO_STRUCT_OFFSET (MonoArrayBounds, length));
+		MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, high_reg, realidx_reg);
+		MONO_EMIT_NEW_COND_EXC (cfg, LE_UN, "IndexOutOfRangeException");
+
+		if (dim == 0) {
+			sum_reg = realidx_reg;
+		} else {
+			mult_reg = alloc_preg (cfg);
+			tmpreg = alloc_preg (cfg);
+			MONO_EMIT_NEW_BIALU (cfg, OP_PMUL, mult_reg, sum_reg, high_reg);
+			MONO_EMIT_NEW_BIALU (cfg, OP_PADD, tmpreg, mult_reg, realidx_reg);
+			sum_reg = tmpreg;
+		}
+	}
 
-	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, low1_reg, 
-				       bounds_reg, MONO_STRUCT_OFFSET (MonoArrayBounds, lower_bound));
-	MONO_EMIT_NEW_BIALU (cfg, OP_PSUB, realidx1_reg, index1, low1_reg);
-	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, high1_reg, 
-				       bounds_reg, MONO_STRUCT_OFFSET (MonoArrayBounds, length));
-	MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, high1_reg, realidx1_reg);
-	MONO_EMIT_NEW_COND_EXC (cfg, LE_UN, "IndexOutOfRangeException");
-
-	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, low2_reg, 
-				       bounds_reg, sizeof (MonoArrayBounds) + MONO_STRUCT_OFFSET (MonoArrayBounds, lower_bound));
-	MONO_EMIT_NEW_BIALU (cfg, OP_PSUB, realidx2_reg, index2, low2_reg);
-	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, high2_reg, 
-				       bounds_reg, sizeof (MonoArrayBounds) + MONO_STRUCT_OFFSET (MonoArrayBounds, length));
-	MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, high2_reg, realidx2_reg);
-	MONO_EMIT_NEW_COND_EXC (cfg, LE_UN, "IndexOutOfRangeException");
-
-	MONO_EMIT_NEW_BIALU (cfg, OP_PMUL, mult_reg, high2_reg, realidx1_reg);
-	MONO_EMIT_NEW_BIALU (cfg, OP_PADD, sum_reg, mult_reg, realidx2_reg);
 	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_PMUL_IMM, mult2_reg, sum_reg, size);
 	MONO_EMIT_NEW_BIALU (cfg, OP_PADD, add_reg, mult2_reg, arr->dreg);
 	NEW_BIALU_IMM (cfg, ins, OP_PADD_IMM, add_reg, add_reg, MONO_STRUCT_OFFSET (MonoArray, vector));
@@ -5604,9 +6023,9 @@ mini_emit_ldelema_ins (MonoCompile *cfg, MonoMethod *cmethod, MonoInst **sp, uns
 	if (rank == 1)
 		return mini_emit_ldelema_1_ins (cfg, eclass, sp [0], sp [1], TRUE);
 
-	/* emit_ldelema_2 depends on OP_LMUL */
-	if (!cfg->backend->emulate_mul_div && rank == 2 && (cfg->opt & MONO_OPT_INTRINS) && !mini_is_gsharedvt_variable_klass (eclass)) {
-		return mini_emit_ldelema_2_ins (cfg, eclass, sp [0], sp [1], sp [2]);
+	/* emit_ldelema_n depends on OP_LMUL */
+	if (!cfg->backend->emulate_mul_div && rank <= MONO_INLINE_ARRAY_RANK_MAX && (cfg->opt & MONO_OPT_INTRINS) && !mini_is_gsharedvt_variable_klass (eclass)) {
+		return mini_emit_ldelema_n_ins (cfg, eclass, sp [0], sp + 1, rank);
 	}
 
 	if (mini_is_gsharedvt_variable_klass (eclass))
@@ -5970,6 +6389,74 @@ mini_emit_inst_for_sharable_method (MonoCompile *cfg, MonoMethod *cmethod, MonoM
 	return NULL;
 }
 
+static gboolean
+is_create_instance_wrapper (MonoMethod *method)
+{
+	WrapperInfo *info;
+
+	if (method->wrapper_type != MONO_WRAPPER_UNKNOWN)
+		return FALSE;
+	info = mono_marshal_get_wrapper_info (method);
+	return info && info->subtype == WRAPPER_SUBTYPE_CREATE_INSTANCE;
+}
+
+/*
+ * emit_create_instance:
+ *
+ *   Emit Activator.CreateInstance<T> (), i.e. new T (), for a reference type T as a call
+ * to the wrapper returned by mono_marshal_get_create_instance_wrapper (), which allocates
+ * the object and calls its default constructor without going through reflection. In
+ * shared code, the code of the wrapper is cached in the vtable of T, which is fetched
+ * from the rgctx.
+ */
+static MonoInst*
+emit_create_instance (MonoCompile *cfg, MonoMethodSignature *fsig)
+{
+	MonoClass *klass;
+	MonoBasicBlock *init_bb, *end_bb;
+	MonoInst *vtable_ins, *code_ins, *ins;
+	int context_used, code_reg;
+
+	if (cfg->compile_aot || cfg->llvm_only || !mini_type_is_reference (fsig->ret) || mini_is_gsharedvt_type (fsig->ret))
+		return NULL;
+	/* The reflection path checks the access of the caller */
+	if (mono_security_core_clr_enabled ())
+		return NULL;
+	/* The wrapper calls Activator.CreateInstance<T> () itself for the classes it can't create */
+	if (is_create_instance_wrapper (cfg->method) || is_create_instance_wrapper (cfg->current_method))
+		return NULL;
+
+	klass = mono_class_from_mono_type (fsig->ret);
+	context_used = mini_class_check_context_used (cfg, klass);
+	if (!context_used)
+		return mono_emit_method_call (cfg, mono_marshal_get_create_instance_wrapper (klass), NULL, NULL);
+
+	vtable_ins = emit_get_rgctx_klass (cfg, context_used, klass, MONO_RGCTX_INFO_VTABLE);
+
+	NEW_BBLOCK (cfg, init_bb);
+	NEW_BBLOCK (cfg, end_bb);
+
+	code_reg = alloc_preg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE (cfg, code_reg, vtable_ins->dreg, MONO_STRUCT_OFFSET (MonoVTable, create_instance));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, code_reg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBNE_UN, end_bb);
+
+	/* Slowpath, the first time with this T */
+	MONO_START_BB (cfg, init_bb);
+	ins = mono_emit_jit_icall (cfg, mono_get_create_instance_code, &vtable_ins);
+	MONO_EMIT_NEW_UNALU (cfg, OP_MOVE, code_reg, ins->dreg);
+
+	MONO_START_BB (cfg, end_bb);
+
+	MONO_INST_NEW (cfg, code_ins, OP_MOVE);
+	code_ins->dreg = alloc_preg (cfg);
+	code_ins->sreg1 = code_reg;
+	code_ins->type = STACK_PTR;
+	MONO_ADD_INS (cfg->cbb, code_ins);
+
+	return mono_emit_calli (cfg, helper_sig_create_instance, NULL, code_ins, NULL, NULL);
+}
+
 static MonoInst*
 mini_emit_inst_for_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig, MonoInst **args)
 {
@@ -6151,6 +6638,67 @@ mini_emit_inst_for_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSign
 			MONO_START_BB (cfg, end_bb);
 			return ins;
 		}
+
+		/* With small object headers the lock word isn't part of the object */
+#ifndef MONO_SMALL_OBJECT_HEADER
+		if (!strcmp (cmethod->name, "Exit") && fsig->param_count == 1) {
+			MonoInst *thread_ins = mono_get_thread_intrinsic (cfg);
+			int cas_opcode = SIZEOF_REGISTER == 8 ? OP_ATOMIC_CAS_I8 : OP_ATOMIC_CAS_I4;
+
+			/*
+			 * Inline version of the common case of mono_monitor_exit (): the lock word is flat,
+			 * owned by the current thread and not nested, so releasing the lock is a single CAS
+			 * back to 0. Everything else, including inflated locks and errors, is handled by the
+			 * icall. The acquire side stays in mono_monitor_enter_fast (), so a thread abort can't
+			 * arrive between taking the lock and setting lockTaken.
+			 */
+			if (thread_ins && mono_arch_opcode_supported (cas_opcode)) {
+				MonoBasicBlock *slow_bb, *end_bb;
+				int id_reg, lw_reg, cur_reg, addr_reg, zero_reg;
+
+				if (cas_opcode == OP_ATOMIC_CAS_I4)
+					cfg->has_atomic_cas_i4 = TRUE;
+
+				NEW_BBLOCK (cfg, slow_bb);
+				NEW_BBLOCK (cfg, end_bb);
+
+				MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, args [0]->dreg, 0);
+				MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, slow_bb);
+
+				/* The lock word of a flat lock held once by this thread */
+				MONO_ADD_INS (cfg->cbb, thread_ins);
+				id_reg = alloc_preg (cfg);
+				MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADU4_MEMBASE, id_reg, thread_ins->dreg, MONO_STRUCT_OFFSET (MonoInternalThread, small_id));
+				lw_reg = alloc_preg (cfg);
+				MONO_EMIT_NEW_BIALU_IMM (cfg, OP_SHL_IMM, lw_reg, id_reg, LOCK_WORD_OWNER_SHIFT);
+
+				cur_reg = alloc_preg (cfg);
+				MONO_EMIT_NEW_LOAD_MEMBASE (cfg, cur_reg, args [0]->dreg, MONO_STRUCT_OFFSET (MonoObject, synchronisation));
+				MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, cur_reg, lw_reg);
+				MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBNE_UN, slow_bb);
+
+				addr_reg = alloc_preg (cfg);
+				MONO_EMIT_NEW_BIALU_IMM (cfg, OP_PADD_IMM, addr_reg, args [0]->dreg, MONO_STRUCT_OFFSET (MonoObject, synchronisation));
+				zero_reg = alloc_preg (cfg);
+				MONO_EMIT_NEW_PCONST (cfg, zero_reg, NULL);
+
+				/* Fails if another thread inflated the lock in the meantime */
+				MONO_INST_NEW (cfg, ins, cas_opcode);
+				ins->dreg = alloc_preg (cfg);
+				ins->sreg1 = addr_reg;
+				ins->sreg2 = zero_reg;
+				ins->sreg3 = lw_reg;
+				MONO_ADD_INS (cfg->cbb, ins);
+				MONO_EMIT_NEW_BIALU (cfg, OP_COMPARE, -1, ins->dreg, lw_reg);
+				MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, end_bb);
+
+				MONO_START_BB (cfg, slow_bb);
+				ins = mono_emit_jit_icall (cfg, mono_monitor_exit, args);
+				MONO_START_BB (cfg, end_bb);
+				return ins;
+			}
+		}
+#endif
 	} else if (cmethod->klass == mono_defaults.thread_class) {
 		if (strcmp (cmethod->name, "SpinWait_nop") == 0 && fsig->param_count == 0) {
 			MONO_INST_NEW (cfg, ins, OP_RELAXED_NOP);
@@ -6774,6 +7322,11 @@ mini_emit_inst_for_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSign
 			EMIT_NEW_ICONST (cfg, ins, 0);
 #endif
 		}
+	} else if (cmethod->klass->image == mono_defaults.corlib &&
+			   (strcmp (cmethod->klass->name_space, "System") == 0) &&
+			   (strcmp (cmethod->klass->name, "Activator") == 0)) {
+		if (!strcmp (cmethod->name, "CreateInstance") && fsig->param_count == 0 && cmethod->is_inflated && mono_method_get_context (cmethod)->method_inst)
+			return emit_create_instance (cfg, fsig);
 	} else if (cmethod->klass->image == mono_defaults.corlib &&
 			   (strcmp (cmethod->klass->name_space, "System.Reflection") == 0) &&
 			   (strcmp (cmethod->klass->name, "Assembly") == 0)) {
@@ -7285,6 +7838,182 @@ inline_method (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fsig,
 	return 0;
 }
 
+/*
+ * get_exact_devirt_target:
+ *
+ *   Return the method called by the virtual call to CMETHOD when the receiver is an
+ * instance of exactly KLASS, or NULL if it can't be called directly.
+ */
+static MonoMethod*
+get_exact_devirt_target (MonoCompile *cfg, MonoMethod *cmethod, MonoClass *klass)
+{
+	MonoMethod *target;
+	MonoGenericContext *context;
+	int slot, ioffset = 0;
+
+	/* Valuetype receivers would need to be unboxed, proxies go through remoting */
+	if (klass->valuetype || klass->rank || mono_class_is_marshalbyref (klass) || klass == mono_defaults.transparent_proxy_class)
+		return NULL;
+	if (!(cmethod->flags & METHOD_ATTRIBUTE_VIRTUAL))
+		return NULL;
+
+	slot = mono_method_get_vtable_slot (cmethod);
+	if (slot == -1)
+		return NULL;
+	if (cmethod->klass->flags & TYPE_ATTRIBUTE_INTERFACE) {
+		ioffset = mono_class_interface_offset (klass, cmethod->klass);
+		if (ioffset == -1)
+			return NULL;
+	}
+	if (!klass->vtable || ioffset + slot >= klass->vtable_size)
+		return NULL;
+
+	target = klass->vtable [ioffset + slot];
+	if (!target || (target->flags & METHOD_ATTRIBUTE_ABSTRACT) || target->wrapper_type != MONO_WRAPPER_NONE)
+		return NULL;
+	/* Generic methods need an mrgctx */
+	context = mono_method_get_context (target);
+	if (target->is_generic || (context && context->method_inst))
+		return NULL;
+	if (target->iflags & (METHOD_IMPL_ATTRIBUTE_INTERNAL_CALL | METHOD_IMPL_ATTRIBUTE_RUNTIME))
+		return NULL;
+	return target;
+}
+
+/*
+ * get_guarded_devirt_target:
+ *
+ *   Return the method called by the virtual call to CMETHOD when the receiver has VTABLE,
+ * or NULL if it can't be called directly.
+ */
+static MonoMethod*
+get_guarded_devirt_target (MonoCompile *cfg, MonoMethod *cmethod, MonoVTable *vtable)
+{
+	return get_exact_devirt_target (cfg, cmethod, vtable->klass);
+}
+
+/*
+ * get_default_comparer_class:
+ *
+ *   If CMETHOD is EqualityComparer<T>.get_Default and the class of the comparer it returns
+ * is known at compile time, return that class. EqualityComparer<T>.CreateComparer () returns
+ * a GenericEqualityComparer<T> for every T other than byte which implements IEquatable<T>.
+ * Only valuetypes and sealed classes are handled, since the calls made by that comparer
+ * to T's Equals ()/GetHashCode () can then be devirtualized and inlined as well.
+ */
+static MonoClass*
+get_default_comparer_class (MonoCompile *cfg, MonoMethod *cmethod)
+{
+	MonoClass *klass = cmethod->klass;
+	MonoClass *tclass, *iface, *gcomparer;
+	MonoGenericContext ctx;
+	MonoType *args [1];
+	MonoError error;
+
+	if (klass->image != mono_defaults.corlib || !klass->generic_class || strcmp (cmethod->name, "get_Default") ||
+		strcmp (klass->name, "EqualityComparer`1") || strcmp (klass->name_space, "System.Collections.Generic"))
+		return NULL;
+	/* In shared code, the type argument is only known at runtime */
+	if (mono_class_check_context_used (klass))
+		return NULL;
+
+	tclass = mono_class_from_mono_type (klass->generic_class->context.class_inst->type_argv [0]);
+	if (tclass == mono_defaults.byte_class || mono_class_is_nullable (tclass))
+		return NULL;
+	if (!tclass->valuetype && !(tclass->flags & TYPE_ATTRIBUTE_SEALED))
+		return NULL;
+
+	iface = mono_class_try_load_from_name (mono_defaults.corlib, "System", "IEquatable`1");
+	gcomparer = mono_class_try_load_from_name (mono_defaults.corlib, "System.Collections.Generic", "GenericEqualityComparer`1");
+	if (!iface || !gcomparer)
+		return NULL;
+
+	memset (&ctx, 0, sizeof (ctx));
+	args [0] = &tclass->byval_arg;
+	ctx.class_inst = mono_metadata_get_generic_inst (1, args);
+
+	iface = mono_class_inflate_generic_class_checked (iface, &ctx, &error);
+	if (!is_ok (&error)) {
+		mono_error_cleanup (&error);
+		return NULL;
+	}
+	if (!mono_class_is_assignable_from (iface, tclass))
+		return NULL;
+
+	gcomparer = mono_class_inflate_generic_class_checked (gcomparer, &ctx, &error);
+	if (!is_ok (&error)) {
+		mono_error_cleanup (&error);
+		return NULL;
+	}
+	mono_class_init (gcomparer);
+	mono_class_setup_vtable (gcomparer);
+	if (mono_class_has_failure (gcomparer))
+		return NULL;
+	return gcomparer;
+}
+
+/*
+ * emit_guarded_devirt_call:
+ *
+ *   Emit the virtual call to CMETHOD at IP as a vtable check for VTABLE, the dominant
+ * receiver at the call site, followed by a direct or inlined call to TARGET, with the
+ * virtual call as the fallback.
+ */
+static MonoInst*
+emit_guarded_devirt_call (MonoCompile *cfg, MonoMethod *cmethod, MonoMethod *target, MonoVTable *vtable, MonoMethodSignature *fsig,
+						  MonoInst **sp, guchar *ip, int *inline_costs)
+{
+	MonoBasicBlock *fallback_bb, *end_bb;
+	MonoInst *ins, *store, *ret_var = NULL;
+	MonoInst **args;
+	int vtable_reg, n, costs = 0;
+
+	n = fsig->param_count + fsig->hasthis;
+	if (!MONO_TYPE_IS_VOID (fsig->ret))
+		ret_var = mono_compile_create_var (cfg, fsig->ret, OP_LOCAL);
+
+	NEW_BBLOCK (cfg, fallback_bb);
+	NEW_BBLOCK (cfg, end_bb);
+
+	vtable_reg = alloc_preg (cfg);
+	MONO_EMIT_NEW_LOAD_MEMBASE_FAULT (cfg, vtable_reg, sp [0]->dreg, MONO_STRUCT_OFFSET (MonoObject, vtable));
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, vtable_reg, vtable);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBNE_UN, fallback_bb);
+
+	/* Dominant receiver */
+	if ((cfg->opt & MONO_OPT_INLINE) && !(target->flags & METHOD_ATTRIBUTE_PINVOKE_IMPL) && mono_method_check_inlining (cfg, target, ip)) {
+		/* inline_method () stores the result into args [0] */
+		args = (MonoInst **)mono_mempool_alloc (cfg->mempool, sizeof (MonoInst*) * n);
+		memcpy (args, sp, sizeof (MonoInst*) * n);
+		costs = inline_method (cfg, target, fsig, args, ip, cfg->real_offset, FALSE);
+		if (costs) {
+			*inline_costs += costs;
+			if (ret_var)
+				EMIT_NEW_TEMPSTORE (cfg, store, ret_var->inst_c0, args [0]);
+		}
+	}
+	if (!costs) {
+		ins = mono_emit_method_call_full (cfg, target, fsig, FALSE, sp, NULL, NULL, NULL);
+		if (ret_var)
+			EMIT_NEW_TEMPSTORE (cfg, store, ret_var->inst_c0, ins);
+	}
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+
+	/* Other receivers */
+	MONO_START_BB (cfg, fallback_bb);
+	ins = mono_emit_method_call_full (cfg, cmethod, fsig, FALSE, sp, sp [0], NULL, NULL);
+	if (ret_var)
+		EMIT_NEW_TEMPSTORE (cfg, store, ret_var->inst_c0, ins);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_BR, end_bb);
+
+	MONO_START_BB (cfg, end_bb);
+	if (ret_var)
+		EMIT_NEW_TEMPLOAD (cfg, ins, ret_var->inst_c0);
+
+	cfg->stat_guarded_devirt_calls++;
+	return ins;
+}
+
 /*
  * Some of these comments may well be out-of-date.
  * Design decisions: we do a single pass over the IL code (and we do bblock 
@@ -7332,13 +8061,14 @@ static int
 get_basic_blocks (MonoCompile *cfg, MonoMethodHeader* header, guint real_offset, unsigned char *start, unsigned char *end, unsigned char **pos)
 {
 	unsigned char *ip = start;
-	unsigned char *target;
+	unsigned char *target, *op_start;
 	int i;
 	guint cli_addr;
 	MonoBasicBlock *bblock;
 	const MonoOpcode *opcode;
 
 	while (ip < end) {
+		op_start = ip;
 		cli_addr = ip - start;
 		i = mono_opcode_value ((const guint8 **)&ip, end);
 		if (i < 0)
@@ -7368,6 +8098,8 @@ get_basic_blocks (MonoCompile *cfg, MonoMethodHeader* header, guint real_offset,
 		case MonoShortInlineBrTarget:
 			target = start + cli_addr + 2 + (signed char)ip [1];
 			GET_BBLOCK (cfg, bblock, target);
+			if (target <= op_start)
+				bblock->flags |= BB_BACKWARD_BRANCH_TARGET;
 			ip += 2;
 			if (ip < end)
 				GET_BBLOCK (cfg, bblock, ip);
@@ -7375,6 +8107,8 @@ get_basic_blocks (MonoCompile *cfg, MonoMethodHeader* header, guint real_offset,
 		case MonoInlineBrTarget:
 			target = start + cli_addr + 5 + (gint32)read32 (ip + 1);
 			GET_BBLOCK (cfg, bblock, target);
+			if (target <= op_start)
+				bblock->flags |= BB_BACKWARD_BRANCH_TARGET;
 			ip += 5;
 			if (ip < end)
 				GET_BBLOCK (cfg, bblock, ip);
@@ -7390,6 +8124,8 @@ get_basic_blocks (MonoCompile *cfg, MonoMethodHeader* header, guint real_offset,
 			for (j = 0; j < n; ++j) {
 				target = start + cli_addr + (gint32)read32 (ip);
 				GET_BBLOCK (cfg, bblock, target);
+				if (target <= op_start)
+					bblock->flags |= BB_BACKWARD_BRANCH_TARGET;
 				ip += 4;
 			}
 			break;
@@ -8062,7 +8798,7 @@ handle_ctor_call (MonoCompile *cfg, MonoMethod *cmethod, MonoMethodSignature *fs
 		g_assert (MONO_TYPE_IS_VOID (fsig->ret));
 		CHECK_CFG_EXCEPTION;
 	} else if ((cfg->opt & MONO_OPT_INLINE) && cmethod && !context_used && !vtable_arg &&
-			   mono_method_check_inlining (cfg, cmethod) &&
+			   mono_method_check_inlining (cfg, cmethod, ip) &&
 			   !mono_class_is_subclass_of (cmethod->klass, mono_defaults.exception_class, FALSE)) {
 		int costs;
 
@@ -8149,6 +8885,204 @@ emit_setret (MonoCompile *cfg, MonoInst *val)
 	}
 }
 
+/*
+ * tier0_method_can_osr:
+ *
+ *   Return whenever the tier 0 code of the method being compiled can transfer to OSR code,
+ * see mini-tiered.c. The OSR code gets copies of the locals, so the method must not create
+ * pointers to its frame.
+ */
+static gboolean
+tier0_method_can_osr (MonoCompile *cfg, MonoMethodHeader *header, MonoMethodSignature *sig)
+{
+	const unsigned char *ip = header->code;
+	const unsigned char *end = ip + header->code_size;
+
+	if (!mono_tiered_osr_enabled () || sig->call_convention == MONO_CALL_VARARG || mono_arch_is_soft_float ())
+		return FALSE;
+
+	while (ip < end) {
+		const unsigned char *p = ip;
+		int op, size;
+
+		size = mono_opcode_value_and_size (&p, end, &op);
+		if (size < 0)
+			return FALSE;
+
+		switch (op) {
+		case MONO_CEE_LDLOCA:
+		case MONO_CEE_LDLOCA_S:
+		case MONO_CEE_LDARGA:
+		case MONO_CEE_LDARGA_S:
+		case MONO_CEE_LOCALLOC:
+		case MONO_CEE_ARGLIST:
+		case MONO_CEE_JMP:
+			return FALSE;
+		default:
+			break;
+		}
+		ip += size;
+	}
+	return TRUE;
+}
+
+static gboolean
+il_offset_in_clause (MonoMethodHeader *header, int offset)
+{
+	int i;
+
+	for (i = 0; i < header->num_clauses; ++i) {
+		MonoExceptionClause *clause = &header->clauses [i];
+
+		if (MONO_OFFSET_IN_CLAUSE (clause, offset) || MONO_OFFSET_IN_HANDLER (clause, offset) || MONO_OFFSET_IN_FILTER (clause, offset))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * osr_state_layout:
+ *
+ *   Compute the offsets of the arguments and then the locals of the method being compiled
+ * in the buffer passed from tier 0 code to OSR code. Returns the size of the buffer.
+ */
+static int
+osr_state_layout (MonoCompile *cfg, MonoMethodHeader *header, MonoMethodSignature *sig, int *offsets)
+{
+	int nargs = sig->hasthis + sig->param_count;
+	int i, offset = 0;
+
+	for (i = 0; i < nargs + header->num_locals; ++i) {
+		MonoType *t = i < nargs ? cfg->arg_types [i] : header->locals [i - nargs];
+		int size, align;
+
+		size = mono_type_size (t, &align);
+		offset = ALIGN_TO (offset, MAX (align, 1));
+		offsets [i] = offset;
+		offset += size;
+	}
+	return MAX (ALIGN_TO (offset, sizeof (mgreg_t)), sizeof (mgreg_t));
+}
+
+/*
+ * emit_tier0_osr_check:
+ *
+ *   Count down the OSR counter of the tier 0 code at the loop header at IL_OFFSET, and
+ * transfer to the OSR code entered at IL_OFFSET when it runs out and the code is
+ * available: pass the arguments and locals to it and return its result.
+ */
+static void
+emit_tier0_osr_check (MonoCompile *cfg, MonoMethodHeader *header, MonoMethodSignature *sig, int il_offset, MonoBasicBlock *end_bblock)
+{
+	MonoBasicBlock *cont_bb;
+	MonoInst *ins, *store, *code, *state, *call;
+	MonoInst *iargs [2];
+	MonoInst **args;
+	int nargs = sig->hasthis + sig->param_count;
+	int *offsets;
+	int i, addr_reg, count_reg, size;
+
+	addr_reg = alloc_preg (cfg);
+	count_reg = alloc_ireg (cfg);
+
+	MONO_EMIT_NEW_PCONST (cfg, addr_reg, &cfg->tier0_info->osr_backedges);
+	MONO_EMIT_NEW_LOAD_MEMBASE_OP (cfg, OP_LOADI4_MEMBASE, count_reg, addr_reg, 0);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ISUB_IMM, count_reg, count_reg, 1);
+	MONO_EMIT_NEW_STORE_MEMBASE (cfg, OP_STOREI4_MEMBASE_REG, addr_reg, 0, count_reg);
+
+	NEW_BBLOCK (cfg, cont_bb);
+
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, count_reg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_IBGE, cont_bb);
+
+	EMIT_NEW_PCONST (cfg, iargs [0], cfg->tier0_info);
+	EMIT_NEW_ICONST (cfg, iargs [1], il_offset);
+	code = mono_emit_jit_icall (cfg, mono_tiered_osr_get_code, iargs);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, code->dreg, 0);
+	MONO_EMIT_NEW_BRANCH_BLOCK (cfg, OP_PBEQ, cont_bb);
+
+	/* Copy the arguments and locals to a buffer in this frame, which is scanned conservatively */
+	offsets = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * (nargs + header->num_locals));
+	size = osr_state_layout (cfg, header, sig, offsets);
+
+	MONO_INST_NEW (cfg, state, OP_LOCALLOC_IMM);
+	state->dreg = alloc_preg (cfg);
+	state->inst_imm = size;
+	state->type = STACK_PTR;
+	MONO_ADD_INS (cfg->cbb, state);
+	cfg->flags |= MONO_CFG_HAS_ALLOCA;
+
+	for (i = 0; i < nargs; ++i) {
+		EMIT_NEW_ARGLOAD (cfg, ins, i);
+		EMIT_NEW_STORE_MEMBASE_TYPE (cfg, store, cfg->arg_types [i], state->dreg, offsets [i], ins->dreg);
+	}
+	for (i = 0; i < header->num_locals; ++i) {
+		EMIT_NEW_LOCLOAD (cfg, ins, i);
+		EMIT_NEW_STORE_MEMBASE_TYPE (cfg, store, header->locals [i], state->dreg, offsets [nargs + i], ins->dreg);
+	}
+	iargs [0] = state;
+	mono_emit_jit_icall (cfg, mono_tiered_osr_set_state, iargs);
+
+	/* The OSR code overwrites the arguments with the copies */
+	args = (MonoInst **)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoInst*) * (nargs + 1));
+	for (i = 0; i < nargs; ++i)
+		EMIT_NEW_ARGLOAD (cfg, args [i], i);
+	call = mono_emit_calli (cfg, sig, args, code, NULL, NULL);
+
+	emit_instrumentation_call (cfg, mono_profiler_method_leave);
+	if (cfg->lmf_var && !cfg->llvm_only)
+		emit_pop_lmf (cfg);
+	if (cfg->ret)
+		emit_setret (cfg, call);
+
+	MONO_INST_NEW (cfg, ins, OP_BR);
+	ins->inst_target_bb = end_bblock;
+	MONO_ADD_INS (cfg->cbb, ins);
+	link_bblock (cfg, cfg->cbb, end_bblock);
+
+	MONO_START_BB (cfg, cont_bb);
+}
+
+/*
+ * emit_osr_entry:
+ *
+ *   Emit the entry of OSR code at the end of INIT_LOCALSBB: load the arguments and locals
+ * passed by the tier 0 code, and branch to the loop header at cfg->osr_il_offset instead
+ * of the start of the method.
+ */
+static void
+emit_osr_entry (MonoCompile *cfg, MonoMethodHeader *header, MonoMethodSignature *sig, MonoBasicBlock *init_localsbb)
+{
+	MonoBasicBlock *target = cfg->cil_offset_to_bb [cfg->osr_il_offset];
+	MonoBasicBlock *first_bb = cfg->cil_offset_to_bb [0];
+	MonoInst *ins, *store, *state;
+	int nargs = sig->hasthis + sig->param_count;
+	int *offsets;
+	int i;
+
+	g_assert (target && first_bb);
+	g_assert (cfg->cbb == init_localsbb);
+
+	offsets = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * (nargs + header->num_locals));
+	osr_state_layout (cfg, header, sig, offsets);
+
+	state = mono_emit_jit_icall (cfg, mono_tiered_osr_take_state, NULL);
+	for (i = 0; i < nargs; ++i) {
+		EMIT_NEW_LOAD_MEMBASE_TYPE (cfg, ins, cfg->arg_types [i], state->dreg, offsets [i]);
+		EMIT_NEW_ARGSTORE (cfg, store, i, ins);
+	}
+	for (i = 0; i < header->num_locals; ++i) {
+		EMIT_NEW_LOAD_MEMBASE_TYPE (cfg, ins, header->locals [i], state->dreg, offsets [nargs + i]);
+		EMIT_NEW_LOCSTORE (cfg, store, i, ins);
+	}
+
+	mono_unlink_bblock (cfg, init_localsbb, first_bb);
+	MONO_INST_NEW (cfg, ins, OP_BR);
+	ins->inst_target_bb = target;
+	MONO_ADD_INS (cfg->cbb, ins);
+	link_bblock (cfg, cfg->cbb, target);
+}
+
 /*
  * mono_method_to_ir:
  *
@@ -8184,6 +9118,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 	int context_used;
 	gboolean init_locals, seq_points, skip_dead_blocks;
 	gboolean sym_seq_points = FALSE;
+	gboolean tier0_osr = FALSE;
 	MonoDebugMethodInfo *minfo;
 	MonoBitSet *seq_point_locs = NULL;
 	MonoBitSet *seq_point_set_locs = NULL;
@@ -8595,6 +9530,9 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 		MONO_EMIT_NEW_CHECK_THIS (cfg, arg_ins->dreg);
 	}
 
+	if (cfg->tier0_info && method == cfg->method)
+		tier0_osr = tier0_method_can_osr (cfg, header, sig);
+
 	skip_dead_blocks = !dont_verify;
 	if (skip_dead_blocks) {
 		original_bb = bb = mono_basic_block_split (method, &cfg->error, header);
@@ -8656,6 +9594,22 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			}
 		}
 
+		/*
+		 * Tier 0 code counts its calls at the start of the method and its loop iterations at
+		 * the targets of backward branches.
+		 */
+		if (cfg->tier0_info && method == cfg->method) {
+			gboolean loop_header = (cfg->cbb->flags & BB_BACKWARD_BRANCH_TARGET) != 0;
+
+			cfg->cbb->flags &= ~BB_BACKWARD_BRANCH_TARGET;
+			if (ip == header->code)
+				emit_tier0_counter (cfg, &cfg->tier0_info->calls);
+			if (loop_header)
+				emit_tier0_counter (cfg, &cfg->tier0_info->backedges);
+			if (loop_header && tier0_osr && sp == stack_start && !il_offset_in_clause (header, ip - header->code))
+				emit_tier0_osr_check (cfg, header, sig, ip - header->code, end_bblock);
+		}
+
 		if (skip_dead_blocks) {
 			int ip_offset = ip - header->code;
 
@@ -9230,6 +10184,9 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			gboolean delegate_invoke = FALSE;
 			gboolean direct_icall = FALSE;
 			gboolean constrained_partial_call = FALSE;
+			MonoMethod *shared_native_wrapper = NULL;
+			MonoMethod *vtype_wrapper = NULL;
+			MonoClass *default_comparer_class = NULL;
 			MonoMethod *cil_method;
 
 			CHECK_OPSIZE (5);
@@ -9237,6 +10194,9 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 
 			ins = NULL;
 
+			if (cfg->tier0_info && method == cfg->method)
+				emit_tier0_call_site_counter (cfg, ip - header->code);
+
 			cmethod = mini_get_method (cfg, method, token, NULL, generic_context);
 			CHECK_CFG_ERROR;
 
@@ -9326,6 +10286,17 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			} else if (fsig->pinvoke) {
 				MonoMethod *wrapper = mono_marshal_get_native_wrapper (cmethod, TRUE, cfg->compile_aot);
 				fsig = mono_method_signature (wrapper);
+				/* Wrappers without a GC transition are just a native call, inline them like direct icalls */
+				if (direct_icalls_enabled (cfg) && mono_marshal_method_suppresses_gc_transition (cmethod))
+					direct_icall = TRUE;
+				else if (!cfg->compile_aot && ((MonoMethodPInvoke *)cmethod)->addr) {
+					/*
+					 * Call the native function through a wrapper shared by all pinvokes with the same
+					 * signature shape, so each pinvoke doesn't need its own JITted wrapper.
+					 * In AOT mode the address can't be resolved when the caller is loaded.
+					 */
+					shared_native_wrapper = mono_marshal_get_native_shared_wrapper (cmethod);
+				}
 			} else if (constrained_class) {
 			} else {
 				fsig = mono_method_get_signature_checked (cmethod, image, token, generic_context, &cfg->error);
@@ -9465,6 +10436,16 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 						ins = (MonoInst*)mono_emit_calli (cfg, fsig, sp, addr, NULL, NULL);
 						goto call_end;
 					}
+				} else if (constrained_class->valuetype && cmethod->klass == mono_defaults.enum_class->parent &&
+						   (cfg->opt & MONO_OPT_INTRINS) && !cfg->compile_aot && !mono_class_check_context_used (constrained_class) &&
+						   (vtype_wrapper = mono_marshal_get_valuetype_method_wrapper (constrained_class, cmethod))) {
+					/*
+					 * ValueType.Equals ()/GetHashCode () on a valuetype which doesn't override
+					 * them, call a version specialized for the type which doesn't box `this'
+					 * or its fields.
+					 */
+					ins = mono_emit_method_call (cfg, vtype_wrapper, sp, NULL);
+					goto call_end;
 				} else if (constrained_class->valuetype && (cmethod->klass == mono_defaults.object_class || cmethod->klass == mono_defaults.enum_class->parent || cmethod->klass == mono_defaults.enum_class)) {
 					/*
 					 * The type parameter is instantiated as a valuetype,
@@ -9516,6 +10497,25 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				constrained_class = NULL;
 			}
 
+			/*
+			 * Calls made on the result of EqualityComparer<T>.Default, like the ones in
+			 * EqualityComparer<T>.Default.Equals (a, b), go to the known comparer class
+			 * directly, so they can be inlined.
+			 */
+			if ((cfg->opt & MONO_OPT_INTRINS) && !cfg->full_aot) {
+				if (virtual_ && cfg->default_comparer && sp [0] == cfg->default_comparer) {
+					MonoMethod *target = get_exact_devirt_target (cfg, cmethod, cfg->default_comparer_class);
+
+					if (target) {
+						cmethod = target;
+						fsig = mono_method_signature (target);
+						virtual_ = 0;
+						cfg->stat_devirt_comparer_calls++;
+					}
+				}
+				default_comparer_class = get_default_comparer_class (cfg, cmethod);
+			}
+
 			if (check_call_signature (cfg, fsig, sp))
 				UNVERIFIED;
 
@@ -9705,7 +10705,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			/* Inlining */
 			if ((cfg->opt & MONO_OPT_INLINE) &&
 				(!virtual_ || !(cmethod->flags & METHOD_ATTRIBUTE_VIRTUAL) || MONO_METHOD_IS_FINAL (cmethod)) &&
-			    mono_method_check_inlining (cfg, cmethod)) {
+			    mono_method_check_inlining (cfg, cmethod, ip)) {
 				int costs;
 				gboolean always = FALSE;
 
@@ -9898,6 +10898,19 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 
 				goto call_end;
 			}
+
+			/* Calls to pinvokes through a wrapper shared by signature */
+			if (shared_native_wrapper) {
+				MonoInst **args;
+
+				args = (MonoInst **)mono_mempool_alloc (cfg->mempool, sizeof (MonoInst*) * (fsig->param_count + 1));
+				EMIT_NEW_PCONST (cfg, args [0], ((MonoMethodPInvoke *)cmethod)->addr);
+				for (i = 0; i < fsig->param_count; ++i)
+					args [i + 1] = sp [i];
+
+				ins = mono_emit_method_call (cfg, shared_native_wrapper, args, NULL);
+				goto call_end;
+			}
 	      				
 			/* Array methods */
 			if (array_rank) {
@@ -10012,6 +11025,27 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				goto call_end;
 			}
 
+			/*
+			 * Virtual calls at hot call sites of tier 0 code which mostly see receivers of one
+			 * class, see mini-tiered.c.
+			 */
+			if (virtual_ && (cmethod->flags & METHOD_ATTRIBUTE_VIRTUAL) && !MONO_METHOD_IS_FINAL (cmethod) &&
+				!tail_call && !imt_arg && !vtable_arg && !context_used && !constrained_class && !fsig->generic_param_count &&
+				method == cfg->method && !mono_class_is_marshalbyref (cmethod->klass) &&
+				cmethod->klass->parent != mono_defaults.multicastdelegate_class) {
+				if (cfg->tier0_info) {
+					emit_tier0_receiver_profile (cfg, ip - header->code, sp [0]);
+				} else if (cfg->call_profile && !cfg->gshared) {
+					MonoVTable *receiver = mono_tiered_get_dominant_receiver (cfg->call_profile, ip - header->code);
+					MonoMethod *target = receiver ? get_guarded_devirt_target (cfg, cmethod, receiver) : NULL;
+
+					if (target) {
+						ins = emit_guarded_devirt_call (cfg, cmethod, target, receiver, fsig, sp, ip, &inline_costs);
+						goto call_end;
+					}
+				}
+			}
+
 			/* Common call */
 			INLINE_FAILURE ("call");
 			ins = mono_emit_method_call_full (cfg, cmethod, fsig, tail_call, sp, virtual_ ? sp [0] : NULL,
@@ -10045,6 +11079,11 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 					*sp++ = ins;
 			}
 
+			if (default_comparer_class) {
+				cfg->default_comparer = sp [-1];
+				cfg->default_comparer_class = default_comparer_class;
+			}
+
 			if (keep_this_alive) {
 				MonoInst *dummy_use;
 
@@ -10834,6 +11873,9 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			fsig = mono_method_get_signature_checked (cmethod, image, token, generic_context, &cfg->error);
 			CHECK_CFG_ERROR;
 
+			if (cfg->tier0_info && method == cfg->method)
+				emit_tier0_call_site_counter (cfg, ip - header->code);
+
 			mono_save_token_info (cfg, image, token, cmethod);
 
 			if (!mono_class_init (cmethod->klass))
@@ -11253,7 +12295,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			gboolean is_special_static;
 			MonoType *ftype;
 			MonoInst *store_val = NULL;
-			MonoInst *thread_ins;
+			MonoInst *thread_ins, *static_data_ins;
 
 			op = *ip;
 			is_instance = (op == CEE_LDFLD || op == CEE_LDFLDA || op == CEE_STFLD);
@@ -11334,7 +12376,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				if (target_type_is_incompatible (cfg, field->type, sp [1]))
 					UNVERIFIED;
 #ifndef DISABLE_REMOTING
-				if ((mono_class_is_marshalbyref (klass) && !MONO_CHECK_THIS (sp [0])) || mono_class_is_contextbound (klass) || klass == mono_defaults.marshalbyrefobject_class) {
+				if (MINI_CHECK_PROXIES (cfg) && ((mono_class_is_marshalbyref (klass) && !MONO_CHECK_THIS (sp [0])) || mono_class_is_contextbound (klass) || klass == mono_defaults.marshalbyrefobject_class)) {
 					MonoMethod *stfld_wrapper = mono_marshal_get_stfld_wrapper (field->type); 
 					MonoInst *iargs [5];
 
@@ -11413,7 +12455,7 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 			}
 
 #ifndef DISABLE_REMOTING
-			if (is_instance && ((mono_class_is_marshalbyref (klass) && !MONO_CHECK_THIS (sp [0])) || mono_class_is_contextbound (klass) || klass == mono_defaults.marshalbyrefobject_class)) {
+			if (is_instance && MINI_CHECK_PROXIES (cfg) && ((mono_class_is_marshalbyref (klass) && !MONO_CHECK_THIS (sp [0])) || mono_class_is_contextbound (klass) || klass == mono_defaults.marshalbyrefobject_class)) {
 				MonoMethod *wrapper = (op == CEE_LDFLDA) ? mono_marshal_get_ldflda_wrapper (field->type) : mono_marshal_get_ldfld_wrapper (field->type); 
 				MonoInst *iargs [4];
 
@@ -11529,13 +12571,17 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 
 			is_special_static = mono_class_field_is_special_static (field);
 
-			if (is_special_static && ((gsize)addr & 0x80000000) == 0)
-				thread_ins = mono_get_thread_intrinsic (cfg);
-			else
-				thread_ins = NULL;
+			thread_ins = NULL;
+			static_data_ins = NULL;
+			if (is_special_static && ((gsize)addr & 0x80000000) == 0) {
+				/* Prefer loading the static data array directly from TLS */
+				static_data_ins = mono_create_tls_get (cfg, TLS_KEY_THREAD_STATIC_DATA);
+				if (!static_data_ins)
+					thread_ins = mono_get_thread_intrinsic (cfg);
+			}
 
 			/* Generate IR to compute the field address */
-			if (is_special_static && ((gsize)addr & 0x80000000) == 0 && thread_ins && !(cfg->opt & MONO_OPT_SHARED) && !context_used) {
+			if (is_special_static && ((gsize)addr & 0x80000000) == 0 && (static_data_ins || thread_ins) && !(cfg->opt & MONO_OPT_SHARED) && !context_used) {
 				/*
 				 * Fast access to TLS data
 				 * Inline version of get_thread_static_data () in
@@ -11547,9 +12593,14 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 				if (context_used && cfg->gsharedvt && mini_is_gsharedvt_klass (klass))
 					GSHAREDVT_FAILURE (op);
 
-				MONO_ADD_INS (cfg->cbb, thread_ins);
-				static_data_reg = alloc_ireg (cfg);
-				MONO_EMIT_NEW_LOAD_MEMBASE (cfg, static_data_reg, thread_ins->dreg, MONO_STRUCT_OFFSET (MonoInternalThread, static_data));
+				if (static_data_ins) {
+					MONO_ADD_INS (cfg->cbb, static_data_ins);
+					static_data_reg = static_data_ins->dreg;
+				} else {
+					MONO_ADD_INS (cfg->cbb, thread_ins);
+					static_data_reg = alloc_ireg (cfg);
+					MONO_EMIT_NEW_LOAD_MEMBASE (cfg, static_data_reg, thread_ins->dreg, MONO_STRUCT_OFFSET (MonoInternalThread, static_data));
+				}
 
 				if (cfg->compile_aot) {
 					int offset_reg, offset2_reg, idx_reg;
@@ -13656,6 +14707,9 @@ mono_method_to_ir (MonoCompile *cfg, MonoMethod *method, MonoBasicBlock *start_b
 	cfg->cbb = init_localsbb;
 	emit_instrumentation_call (cfg, mono_profiler_method_enter);
 
+	if (cfg->osr_il_offset != -1 && cfg->method == method)
+		emit_osr_entry (cfg, header, sig, init_localsbb);
+
 	if (seq_points) {
 		MonoBasicBlock *bb;
 
@@ -15117,7 +16171,7 @@ mono_decompose_typecheck (MonoCompile *cfg, MonoBasicBlock *bb, MonoInst *ins)
 			ret = emit_isinst_with_cache_nonshared (cfg, source, klass);
 		else
 			ret = emit_castclass_with_cache_nonshared (cfg, source, klass);
-	} else if (!context_used && (mono_class_is_marshalbyref (klass) || klass->flags & TYPE_ATTRIBUTE_INTERFACE)) {
+	} else if (!context_used && MINI_CHECK_PROXIES (cfg) && (mono_class_is_marshalbyref (klass) || klass->flags & TYPE_ATTRIBUTE_INTERFACE)) {
 		MonoInst *iargs [1];
 		int costs;
 
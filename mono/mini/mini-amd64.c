@@ -1277,6 +1277,15 @@ mono_arch_cpu_enumerate_simd_versions (void)
 	if (mono_hwcap_x86_has_sse4a)
 		sse_opts |= SIMD_VERSION_SSE4a;
 
+	if (mono_hwcap_x86_has_avx)
+		sse_opts |= SIMD_VERSION_AVX;
+
+	if (mono_hwcap_x86_has_avx2)
+		sse_opts |= SIMD_VERSION_AVX2;
+
+	if (mono_hwcap_x86_has_avx512f && mono_hwcap_x86_has_avx512bw && mono_hwcap_x86_has_avx512vl)
+		sse_opts |= SIMD_VERSION_AVX512;
+
 	return sse_opts;
 }
 
@@ -2916,6 +2925,15 @@ emit_call_body (MonoCompile *cfg, guint8 *code, MonoJumpInfoType patch_type, gco
 			amd64_call_code (code, 0);
 		}
 		else {
+			/*
+			 * Align the 64 bit immediate of the mov to 8 bytes, so the call trampolines
+			 * can patch it atomically while other threads execute this code, see
+			 * mono_arch_patch_callsite ().
+			 */
+			if (!no_patch && patch_type == MONO_PATCH_INFO_METHOD && ((guint32)(code + 2 - cfg->native_code) % 8) != 0) {
+				guint32 pad_size = 8 - ((guint32)(code + 2 - cfg->native_code) % 8);
+				amd64_padding (code, pad_size);
+			}
 			mono_add_patch_info (cfg, code - cfg->native_code, patch_type, data);
 			amd64_set_reg_template (code, GP_SCRATCH_REG);
 			amd64_call_reg (code, GP_SCRATCH_REG);
@@ -4903,18 +4921,34 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 		case OP_GENERIC_CLASS_INIT: {
 			static int byte_offset = -1;
 			static guint8 bitmask;
-			guint8 *jump;
+			guint8 *site, *jump, *site_lea, *end_lea;
 
 			g_assert (ins->sreg1 == MONO_AMD64_ARG_REG1);
 
 			if (byte_offset < 0)
 				mono_marshal_find_bitfield_offset (MonoVTable, initialized, &byte_offset, &bitmask);
 
+			/* The first two bytes of the check are overwritten with a jump, see mono_arch_patch_class_init_site () */
+			if (ins->inst_c0 && ((code - cfg->native_code) & 1))
+				x86_nop (code);
+			site = code;
+
 			amd64_test_membase_imm_size (code, ins->sreg1, byte_offset, bitmask, 1);
 			jump = code;
 			amd64_branch8 (code, X86_CC_NZ, -1, 1);
 
-			code = emit_call (cfg, code, MONO_PATCH_INFO_INTERNAL_METHOD, "mono_generic_class_init", FALSE);
+			if (ins->inst_c0) {
+				/* Pass the start and the end of the sequence */
+				amd64_lea_membase (code, MONO_AMD64_ARG_REG2, AMD64_RIP, 0);
+				site_lea = code;
+				amd64_lea_membase (code, MONO_AMD64_ARG_REG3, AMD64_RIP, 0);
+				end_lea = code;
+				code = emit_call (cfg, code, MONO_PATCH_INFO_INTERNAL_METHOD, "mono_generic_class_init_patch", FALSE);
+				*(gint32*)(site_lea - 4) = (gint32)(site - site_lea);
+				*(gint32*)(end_lea - 4) = (gint32)(code - end_lea);
+			} else {
+				code = emit_call (cfg, code, MONO_PATCH_INFO_INTERNAL_METHOD, "mono_generic_class_init", FALSE);
+			}
 			ins->flags |= MONO_INST_GC_CALLSITE;
 			ins->backend.pc_offset = code - cfg->native_code;
 
@@ -6569,6 +6603,85 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 			amd64_sse_movsd_reg_reg (code, ins->dreg, ins->sreg1);
 			amd64_sse_pshufd_reg_reg_imm (code, ins->dreg, ins->dreg, 0x44);
 			break;
+
+		case OP_LOADY_MEMBASE:
+			amd64_avx_vmovups_ymm_membase (code, ins->dreg, ins->sreg1, ins->inst_offset);
+			break;
+		case OP_STOREY_MEMBASE:
+			amd64_avx_vmovups_membase_ymm (code, ins->dreg, ins->inst_offset, ins->sreg1);
+			break;
+		case OP_YMOVE:
+			if (ins->dreg != ins->sreg1)
+				amd64_avx_vmovaps_ymm_ymm (code, ins->dreg, ins->sreg1);
+			break;
+		case OP_YPADDB:
+			amd64_avx2_vpaddb_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YPADDW:
+			amd64_avx2_vpaddw_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YPADDD:
+			amd64_avx2_vpaddd_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YPSUBB:
+			amd64_avx2_vpsubb_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YPSUBW:
+			amd64_avx2_vpsubw_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YPSUBD:
+			amd64_avx2_vpsubd_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YPAND:
+			amd64_avx2_vpand_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YPOR:
+			amd64_avx2_vpor_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YPXOR:
+			amd64_avx2_vpxor_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YPMULW:
+			amd64_avx2_vpmullw_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YPMULD:
+			amd64_avx2_vpmulld_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YADDPS:
+			amd64_avx_vaddps_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YSUBPS:
+			amd64_avx_vsubps_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YMULPS:
+			amd64_avx_vmulps_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YDIVPS:
+			amd64_avx_vdivps_ymm (code, ins->dreg, ins->sreg1, ins->sreg2);
+			break;
+		case OP_YEXPAND_I1:
+			amd64_movd_xreg_reg_size (code, ins->dreg, ins->sreg1, 4);
+			amd64_avx2_vpbroadcastb_ymm_xmm (code, ins->dreg, ins->dreg);
+			break;
+		case OP_YEXPAND_I2:
+			amd64_movd_xreg_reg_size (code, ins->dreg, ins->sreg1, 4);
+			amd64_avx2_vpbroadcastw_ymm_xmm (code, ins->dreg, ins->dreg);
+			break;
+		case OP_YEXPAND_I4:
+			amd64_movd_xreg_reg_size (code, ins->dreg, ins->sreg1, 4);
+			amd64_avx2_vpbroadcastd_ymm_xmm (code, ins->dreg, ins->dreg);
+			break;
+		case OP_YEXPAND_R4:
+			if (cfg->r4fp) {
+				amd64_avx2_vbroadcastss_ymm_xmm (code, ins->dreg, ins->sreg1);
+			} else {
+				amd64_sse_cvtsd2ss_reg_reg (code, ins->dreg, ins->sreg1);
+				amd64_avx2_vbroadcastss_ymm_xmm (code, ins->dreg, ins->dreg);
+			}
+			break;
+		case OP_VZEROUPPER:
+			amd64_vzeroupper (code);
+			break;
 #endif
 		case OP_LIVERANGE_START: {
 			if (cfg->verbose_level > 1)
@@ -6593,6 +6706,10 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 			amd64_patch (br[0], code);
 			break;
 		}
+		case OP_GC_POLL_PAGE:
+			/* Faults while a suspend is requested, see handle_polling_page_fault () */
+			amd64_test_membase_imm_size (code, ins->sreg1, 0, 1, 4);
+			break;
 
 		case OP_GC_LIVENESS_DEF:
 		case OP_GC_LIVENESS_USE:
@@ -7167,7 +7284,13 @@ mono_arch_emit_prolog (MonoCompile *cfg)
 			ins = (MonoInst *)cfg->arch.ss_tramp_var;
 			g_assert (ins->opcode == OP_REGOFFSET);
 
-			amd64_mov_reg_imm (code, AMD64_R11, (guint64)&ss_trampoline);
+			if (mono_get_jit_tls_offset () != -1) {
+				/* Point it to the per-thread slot, so single stepping can be enabled for one thread only */
+				code = mono_amd64_emit_tls_get (code, AMD64_R11, mono_get_jit_tls_offset ());
+				amd64_alu_reg_imm (code, X86_ADD, AMD64_R11, MONO_STRUCT_OFFSET (MonoJitTlsData, ss_trampoline));
+			} else {
+				amd64_mov_reg_imm (code, AMD64_R11, (guint64)&ss_trampoline);
+			}
 			amd64_mov_membase_reg (code, ins->inst_basereg, ins->inst_offset, AMD64_R11, 8);
 
 			/* Initialize bp_tramp_var */
@@ -8372,6 +8495,31 @@ mono_arch_skip_breakpoint (MonoContext *ctx, MonoJitInfo *ji)
 	g_assert_not_reached ();
 }
 	
+static void
+update_thread_ss_trampoline (MonoJitTlsData *jit_tls)
+{
+	if (ss_trampoline || jit_tls->thread_single_stepping)
+		jit_tls->ss_trampoline = mini_get_single_step_trampoline ();
+	else
+		jit_tls->ss_trampoline = NULL;
+}
+
+/*
+ * update_thread_ss_trampolines:
+ *
+ *   Propagate the global single stepping state to the per-thread slots checked by JITted code.
+ */
+static void
+update_thread_ss_trampolines (void)
+{
+	FOREACH_THREAD_SAFE (info) {
+		MonoJitTlsData *jit_tls = (MonoJitTlsData *)mono_thread_info_tls_get (info, TLS_KEY_JIT_TLS);
+
+		if (jit_tls)
+			update_thread_ss_trampoline (jit_tls);
+	} FOREACH_THREAD_SAFE_END
+}
+
 /*
  * mono_arch_start_single_stepping:
  *
@@ -8381,6 +8529,7 @@ void
 mono_arch_start_single_stepping (void)
 {
 	ss_trampoline = mini_get_single_step_trampoline ();
+	update_thread_ss_trampolines ();
 }
 	
 /*
@@ -8392,6 +8541,49 @@ void
 mono_arch_stop_single_stepping (void)
 {
 	ss_trampoline = NULL;
+	update_thread_ss_trampolines ();
+}
+
+/*
+ * mono_arch_init_single_stepping_thread:
+ *
+ *   Initialize the single step slot of JIT_TLS, which belongs to a newly attached thread.
+ */
+void
+mono_arch_init_single_stepping_thread (MonoJitTlsData *jit_tls)
+{
+	update_thread_ss_trampoline (jit_tls);
+}
+
+/*
+ * mono_arch_start_single_stepping_thread:
+ *
+ *   Start single stepping the JITted code running on the thread owning JIT_TLS only,
+ * the other threads keep skipping their sequence points. Return FALSE if this is not
+ * supported, the caller should fall back to mono_arch_start_single_stepping () then.
+ * AOT code always checks the global slot.
+ */
+gboolean
+mono_arch_start_single_stepping_thread (MonoJitTlsData *jit_tls)
+{
+	if (mono_get_jit_tls_offset () == -1)
+		return FALSE;
+
+	jit_tls->thread_single_stepping = TRUE;
+	update_thread_ss_trampoline (jit_tls);
+	return TRUE;
+}
+
+/*
+ * mono_arch_stop_single_stepping_thread:
+ *
+ *   Stop single stepping started by mono_arch_start_single_stepping_thread ().
+ */
+void
+mono_arch_stop_single_stepping_thread (MonoJitTlsData *jit_tls)
+{
+	jit_tls->thread_single_stepping = FALSE;
+	update_thread_ss_trampoline (jit_tls);
 }
 
 /*
@@ -80,6 +80,8 @@ struct sigcontext {
 
 #ifndef DISABLE_SIMD
 #define MONO_ARCH_SIMD_INTRINSICS 1
+/* 256 bit AVX2 vector ops used by the loop vectorizer */
+#define MONO_ARCH_SIMD256 1
 #define MONO_ARCH_NEED_SIMD_BANK 1
 #define MONO_ARCH_USE_SHARED_FP_SIMD_BANK 1
 #endif
@@ -393,6 +395,7 @@ typedef struct {
 
 #define MONO_ARCH_AOT_SUPPORTED 1
 #define MONO_ARCH_SOFT_DEBUG_SUPPORTED 1
+#define MONO_ARCH_HAVE_THREAD_SINGLE_STEP 1
 
 #define MONO_ARCH_SUPPORT_TASKLETS 1
 
@@ -408,6 +411,9 @@ typedef struct {
 #define MONO_ARCH_GC_MAPS_SUPPORTED 1
 #define MONO_ARCH_HAVE_CONTEXT_SET_INT_REG 1
 #define MONO_ARCH_HAVE_SETUP_ASYNC_CALLBACK 1
+#ifndef HOST_WIN32
+#define MONO_ARCH_HAVE_GC_POLLING_PAGE 1
+#endif
 #define MONO_ARCH_HAVE_CREATE_LLVM_NATIVE_THUNK 1
 #define MONO_ARCH_HAVE_OP_TAIL_CALL 1
 #define MONO_ARCH_HAVE_TRANSLATE_TLS_OFFSET 1
@@ -415,6 +421,7 @@ typedef struct {
 #define MONO_ARCH_HAVE_SDB_TRAMPOLINES 1
 #define MONO_ARCH_HAVE_PATCH_CODE_NEW 1
 #define MONO_ARCH_HAVE_OP_GENERIC_CLASS_INIT 1
+#define MONO_ARCH_HAVE_PATCHABLE_CLASS_INIT 1
 #define MONO_ARCH_HAVE_GENERAL_RGCTX_LAZY_FETCH_TRAMPOLINE 1
 
 #if defined(TARGET_OSX) || defined(__linux__)
@@ -22,6 +22,7 @@
 #include <mono/arch/arm64/arm64-codegen.h>
 #include <mono/utils/mono-mmap.h>
 #include <mono/utils/mono-memory-model.h>
+#include <mono/utils/mono-hwcap.h>
 #include <mono/metadata/abi-details.h>
 
 /*
@@ -921,7 +922,16 @@ create_thunk (MonoCompile *cfg, MonoDomain *domain, guchar *code, const guchar *
 			g_assert_not_reached ();
 		}
 
-		emit_thunk (target_thunk, target);
+		if (((guint32*)target_thunk) [0] == 0) {
+			emit_thunk (target_thunk, target);
+		} else {
+			/*
+			 * The thunk might be executing on another thread, only change the target
+			 * address, which is aligned, so the 64 bit store is single-copy atomic.
+			 */
+			InterlockedExchangePointer ((gpointer*)(target_thunk + 8), (gpointer)target);
+			mono_arch_flush_icache (target_thunk + 8, sizeof (gpointer));
+		}
 
 		mono_domain_unlock (domain);
 
@@ -3712,6 +3722,15 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 			guint8 *buf [16];
 
 			/* sreg2 is the value, sreg3 is the comparand */
+			if (mono_hwcap_arm64_has_lse && !cfg->compile_aot) {
+				/* AOT code can run on cpus without LSE */
+				arm_movx (code, ARMREG_IP0, ins->sreg3);
+				arm_casalw (code, ARMREG_IP0, sreg2, sreg1);
+				arm_dmb (code, 0);
+				arm_movx (code, dreg, ARMREG_IP0);
+				break;
+			}
+
 			buf [0] = code;
 			arm_ldxrw (code, ARMREG_IP0, sreg1);
 			arm_cmpw (code, ARMREG_IP0, ins->sreg3);
@@ -3728,6 +3747,14 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 		case OP_ATOMIC_CAS_I8: {
 			guint8 *buf [16];
 
+			if (mono_hwcap_arm64_has_lse && !cfg->compile_aot) {
+				arm_movx (code, ARMREG_IP0, ins->sreg3);
+				arm_casalx (code, ARMREG_IP0, sreg2, sreg1);
+				arm_dmb (code, 0);
+				arm_movx (code, dreg, ARMREG_IP0);
+				break;
+			}
+
 			buf [0] = code;
 			arm_ldxrx (code, ARMREG_IP0, sreg1);
 			arm_cmpx (code, ARMREG_IP0, ins->sreg3);
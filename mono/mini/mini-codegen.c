@@ -127,6 +127,22 @@ static const int regbank_spill_var_size[] = {
 	16 /*FIXME make this a constant. Maybe MONO_ARCH_SIMD_VECTOR_SIZE? */
 };
 
+#ifdef MONO_ARCH_SIMD256
+/*
+ * Methods which use 256 bit vectors (see vectorize.c) keep full ymm registers
+ * in the SIMD bank, so their spills and copies need to preserve the upper half.
+ */
+#define spill_load_op(cfg,bank) (((bank) == MONO_REG_SIMD && (cfg)->uses_simd256) ? OP_LOADY_MEMBASE : regbank_load_ops [(bank)])
+#define spill_store_op(cfg,bank) (((bank) == MONO_REG_SIMD && (cfg)->uses_simd256) ? OP_STOREY_MEMBASE : regbank_store_ops [(bank)])
+#define spill_move_op(cfg,bank) (((bank) == MONO_REG_SIMD && (cfg)->uses_simd256) ? OP_YMOVE : regbank_move_ops [(bank)])
+#define spill_var_size(cfg,bank) (((bank) == MONO_REG_SIMD && (cfg)->uses_simd256) ? 32 : regbank_spill_var_size [(bank)])
+#else
+#define spill_load_op(cfg,bank) (regbank_load_ops [(bank)])
+#define spill_store_op(cfg,bank) (regbank_store_ops [(bank)])
+#define spill_move_op(cfg,bank) (regbank_move_ops [(bank)])
+#define spill_var_size(cfg,bank) (regbank_spill_var_size [(bank)])
+#endif
+
 #define DEBUG(a) MINI_DEBUG(cfg->verbose_level, 3, a;)
 
 static inline void
@@ -330,7 +346,7 @@ mono_spillvar_offset (MonoCompile *cfg, int spillvar, int bank)
 
 		g_assert (bank < MONO_NUM_REGBANKS);
 		if (G_UNLIKELY (bank))
-			size = regbank_spill_var_size [bank];
+			size = spill_var_size (cfg, bank);
 		else
 			size = sizeof (mgreg_t);
 
@@ -867,7 +883,7 @@ spill_vreg (MonoCompile *cfg, MonoBasicBlock *bb, MonoInst **last, MonoInst *ins
 	else
 		mono_regstate_free_int (rs, sel);
 	/* we need to create a spill var and insert a load to sel after the current instruction */
-	MONO_INST_NEW (cfg, load, regbank_load_ops [bank]);
+	MONO_INST_NEW (cfg, load, spill_load_op (cfg, bank));
 	load->dreg = sel;
 	load->inst_basereg = cfg->frame_reg;
 	load->inst_offset = mono_spillvar_offset (cfg, spill, get_vreg_bank (cfg, reg, bank));
@@ -950,7 +966,7 @@ get_register_spilling (MonoCompile *cfg, MonoBasicBlock *bb, MonoInst **last, Mo
 	}
 
 	/* we need to create a spill var and insert a load to sel after the current instruction */
-	MONO_INST_NEW (cfg, load, regbank_load_ops [bank]);
+	MONO_INST_NEW (cfg, load, spill_load_op (cfg, bank));
 	load->dreg = sel;
 	load->inst_basereg = cfg->frame_reg;
 	load->inst_offset = mono_spillvar_offset (cfg, spill, get_vreg_bank (cfg, i, bank));
@@ -993,7 +1009,7 @@ create_copy_ins (MonoCompile *cfg, MonoBasicBlock *bb, MonoInst **last, int dest
 {
 	MonoInst *copy;
 
-	MONO_INST_NEW (cfg, copy, regbank_move_ops [bank]);
+	MONO_INST_NEW (cfg, copy, spill_move_op (cfg, bank));
 
 	copy->dreg = dest;
 	copy->sreg1 = src;
@@ -1024,7 +1040,7 @@ create_spilled_store (MonoCompile *cfg, MonoBasicBlock *bb, int spill, int reg,
 	
 	bank = get_vreg_bank (cfg, prev_reg, bank);
 
-	MONO_INST_NEW (cfg, store, regbank_store_ops [bank]);
+	MONO_INST_NEW (cfg, store, spill_store_op (cfg, bank));
 	store->sreg1 = reg;
 	store->inst_destbasereg = cfg->frame_reg;
 	store->inst_offset = mono_spillvar_offset (cfg, spill, bank);
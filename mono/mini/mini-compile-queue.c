@@ -0,0 +1,472 @@
+/*
+ * mini-compile-queue.c: Background JIT compilation
+ *
+ * With --jit-preload, the methods which were JITted by a previous run and are listed in
+ * the profile files written by the AOT profiler (~/.mono/aot-profile-data/<assembly>-<n>)
+ * are queued for compilation by a pool of compiler threads, see mono_compile_queue_add ().
+ * --jit-threads only sets the size of the pool, nothing else feeds the queue.
+ *
+ * A thread which needs a method which is being compiled by a compiler thread waits for
+ * that specific compilation to finish, see mono_compile_queue_wait (). If the method is
+ * queued but not yet being compiled, the thread takes it over and compiles it itself.
+ *
+ * The compiler threads never run class constructors, the code they produce checks
+ * for class initialization itself, and the thread which receives the code from
+ * mono_jit_compile_method () initializes the class as usual.
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <mono/metadata/appdomain.h>
+#include <mono/metadata/assembly.h>
+#include <mono/metadata/debug-helpers.h>
+#include <mono/metadata/metadata-internals.h>
+#include <mono/metadata/threads-types.h>
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-coop-mutex.h>
+
+#include "mini.h"
+
+#define COMPILE_QUEUE_MAX_THREADS 16
+
+enum {
+	COMPILE_QUEUE_QUEUED,
+	COMPILE_QUEUE_COMPILING,
+	COMPILE_QUEUE_DONE
+};
+
+typedef struct {
+	MonoMethod *method;
+	MonoDomain *domain;
+	gint32 state;
+	/* One for the queue, one for each waiter */
+	gint32 refcount;
+	MonoCoopCond cond;
+} CompileQueueItem;
+
+typedef struct {
+	MonoImage *image;
+	MonoDomain *domain;
+} PreloadImage;
+
+static int compile_queue_threads;
+static gboolean compile_queue_preload;
+static guint32 compile_queue_opts;
+
+/* Protects the fields below */
+static MonoCoopMutex queue_mutex;
+static MonoCoopCond queue_cond;
+/* The CompileQueueItems which are queued or being compiled, keyed by domain and method */
+static GHashTable *queue_items;
+static GQueue *queue;
+/* Images whose profile data still needs to be read */
+static GSList *preload_images;
+
+static gint32 threads_started;
+
+static gint32 background_compiled;
+static gint32 taken_over;
+static gint32 waited;
+
+/*
+ * mono_compile_queue_set_threads:
+ *   Set the number of compiler threads used by --jit-preload, 0 disables background compilation.
+ *   Set the number of compiler threads, 0 disables background compilation.
+ */
+void
+mono_compile_queue_set_threads (int count)
+{
+	compile_queue_threads = CLAMP (count, 0, COMPILE_QUEUE_MAX_THREADS);
+}
+
+/*
+ * mono_compile_queue_enable_preload:
+ *
+ *   Queue the methods listed in the AOT profiler's output for each loaded assembly.
+ */
+void
+mono_compile_queue_enable_preload (void)
+{
+	compile_queue_preload = TRUE;
+	if (!compile_queue_threads)
+		compile_queue_threads = 1;
+}
+
+#ifndef DISABLE_JIT
+
+static guint
+item_hash (gconstpointer key)
+{
+	const CompileQueueItem *item = (const CompileQueueItem *)key;
+
+	return mono_aligned_addr_hash (item->method) ^ mono_aligned_addr_hash (item->domain);
+}
+
+static gboolean
+item_equal (gconstpointer a, gconstpointer b)
+{
+	const CompileQueueItem *item1 = (const CompileQueueItem *)a;
+	const CompileQueueItem *item2 = (const CompileQueueItem *)b;
+
+	return item1->method == item2->method && item1->domain == item2->domain;
+}
+
+static CompileQueueItem*
+lookup_item (MonoDomain *domain, MonoMethod *method)
+{
+	CompileQueueItem key;
+
+	key.method = method;
+	key.domain = domain;
+	return (CompileQueueItem *)g_hash_table_lookup (queue_items, &key);
+}
+
+static void
+item_unref (CompileQueueItem *item)
+{
+	if (--item->refcount == 0) {
+		mono_coop_cond_destroy (&item->cond);
+		g_free (item);
+	}
+}
+
+static gboolean
+method_can_be_queued (MonoMethod *method)
+{
+	if (method->wrapper_type != MONO_WRAPPER_NONE || method->dynamic)
+		return FALSE;
+	if ((method->iflags & (METHOD_IMPL_ATTRIBUTE_INTERNAL_CALL | METHOD_IMPL_ATTRIBUTE_RUNTIME | METHOD_IMPL_ATTRIBUTE_SYNCHRONIZED)) ||
+		(method->flags & (METHOD_ATTRIBUTE_PINVOKE_IMPL | METHOD_ATTRIBUTE_ABSTRACT)))
+		return FALSE;
+	/* Open generic methods can't be compiled */
+	if (method->is_generic || method->klass->generic_container)
+		return FALSE;
+	return TRUE;
+}
+
+static void
+compile_item (CompileQueueItem *item)
+{
+	MonoError error;
+
+	if (mono_jit_find_compiled_method (item->domain, item->method))
+		return;
+
+	mono_jit_compile_method_inner (item->method, item->domain, mono_get_optimizations_for_method (item->method, compile_queue_opts), (JitFlags)0, &error);
+	if (is_ok (&error))
+		InterlockedIncrement (&background_compiled);
+	/* The caller which needs the method will report the error */
+	mono_error_cleanup (&error);
+}
+
+static void
+preload_image (PreloadImage *preload)
+{
+	MonoImage *image = preload->image;
+	int file_index;
+
+	for (file_index = 0; ; file_index++) {
+		char *fname = g_strdup_printf ("%s/.mono/aot-profile-data/%s-%d", g_get_home_dir (), image->assembly_name, file_index);
+		char line [1024];
+		FILE *infile;
+
+		infile = fopen (fname, "r");
+		g_free (fname);
+		if (!infile)
+			break;
+
+		if (!fgets (line, sizeof (line), infile) || strcmp (line, "#VER:2\n") != 0) {
+			fclose (infile);
+			continue;
+		}
+
+		while (fgets (line, sizeof (line), infile)) {
+			MonoMethodDesc *desc;
+			MonoMethod *method;
+
+			/* Kill the newline */
+			if (strlen (line) > 0)
+				line [strlen (line) - 1] = '\0';
+
+			desc = mono_method_desc_new (line, TRUE);
+			if (!desc)
+				continue;
+			method = mono_method_desc_search_in_image (desc, image);
+			mono_method_desc_free (desc);
+			if (method)
+				mono_compile_queue_add (preload->domain, method);
+		}
+		fclose (infile);
+	}
+}
+
+static guint32
+compiler_thread (gpointer unused)
+{
+	MonoError error;
+	CompileQueueItem *item;
+	PreloadImage *preload;
+
+	mono_thread_set_name_internal (mono_thread_internal_current (), mono_string_new (mono_get_root_domain (), "JIT compiler"), FALSE, &error);
+	mono_error_assert_ok (&error);
+
+	while (!mono_runtime_is_shutting_down ()) {
+		mono_coop_mutex_lock (&queue_mutex);
+		while (g_queue_is_empty (queue) && !preload_images && !mono_runtime_is_shutting_down ())
+			mono_coop_cond_wait (&queue_cond, &queue_mutex);
+
+		if (preload_images) {
+			preload = (PreloadImage *)preload_images->data;
+			preload_images = g_slist_delete_link (preload_images, preload_images);
+			mono_coop_mutex_unlock (&queue_mutex);
+
+			if (mono_domain_set (preload->domain, FALSE)) {
+				preload_image (preload);
+				mono_domain_set (mono_get_root_domain (), TRUE);
+			}
+			g_free (preload);
+			continue;
+		}
+
+		item = (CompileQueueItem *)g_queue_pop_head (queue);
+		if (!item) {
+			mono_coop_mutex_unlock (&queue_mutex);
+			break;
+		}
+		/* Taken over by a caller, or its domain is being unloaded */
+		if (item->state == COMPILE_QUEUE_DONE) {
+			item_unref (item);
+			mono_coop_mutex_unlock (&queue_mutex);
+			continue;
+		}
+		item->state = COMPILE_QUEUE_COMPILING;
+		mono_coop_mutex_unlock (&queue_mutex);
+
+		if (mono_domain_set (item->domain, FALSE)) {
+			compile_item (item);
+			mono_domain_set (mono_get_root_domain (), TRUE);
+		}
+
+		mono_coop_mutex_lock (&queue_mutex);
+		item->state = COMPILE_QUEUE_DONE;
+		g_hash_table_remove (queue_items, item);
+		mono_coop_cond_broadcast (&item->cond);
+		item_unref (item);
+		mono_coop_mutex_unlock (&queue_mutex);
+	}
+
+	return 0;
+}
+
+static void
+start_threads (void)
+{
+	MonoError error;
+	int i;
+
+	/* Threads can't be created before the runtime is up, the early assemblies are picked up later */
+	if (threads_started || !mono_thread_internal_current ())
+		return;
+	if (InterlockedCompareExchange (&threads_started, TRUE, FALSE) != FALSE)
+		return;
+
+	for (i = 0; i < compile_queue_threads; i++) {
+		/* Created as threadpool threads so they are background threads which don't keep the runtime alive */
+		if (!mono_thread_create_internal (mono_get_root_domain (), compiler_thread, NULL, TRUE, 0, &error))
+			g_error ("start_threads: mono_thread_create_internal () failed due to %s", mono_error_get_message (&error));
+	}
+}
+
+static void
+compile_queue_assembly_loaded (MonoAssembly *assembly, gpointer user_data)
+{
+	PreloadImage *preload = g_new0 (PreloadImage, 1);
+
+	preload->image = mono_assembly_get_image (assembly);
+	preload->domain = mono_domain_get ();
+
+	mono_coop_mutex_lock (&queue_mutex);
+	preload_images = g_slist_append (preload_images, preload);
+	mono_coop_cond_broadcast (&queue_cond);
+	mono_coop_mutex_unlock (&queue_mutex);
+
+	start_threads ();
+}
+
+/*
+ * mono_compile_queue_add:
+ *
+ *   Queue METHOD for compilation in DOMAIN by the compiler threads, if it is not compiled or
+ * queued already.
+ */
+void
+mono_compile_queue_add (MonoDomain *domain, MonoMethod *method)
+{
+	CompileQueueItem *item;
+
+	if (!queue_items || !method_can_be_queued (method))
+		return;
+	if (mono_jit_find_compiled_method (domain, method))
+		return;
+
+	mono_coop_mutex_lock (&queue_mutex);
+	if (!lookup_item (domain, method)) {
+		item = g_new0 (CompileQueueItem, 1);
+		item->method = method;
+		item->domain = domain;
+		item->state = COMPILE_QUEUE_QUEUED;
+		item->refcount = 1;
+		mono_coop_cond_init (&item->cond);
+
+		g_hash_table_insert (queue_items, item, item);
+		g_queue_push_tail (queue, item);
+		mono_coop_cond_signal (&queue_cond);
+	}
+	mono_coop_mutex_unlock (&queue_mutex);
+
+	start_threads ();
+}
+
+/*
+ * mono_compile_queue_wait:
+ *
+ *   Called before METHOD is compiled for DOMAIN. If a compiler thread is compiling it,
+ * wait for it to finish and return TRUE, the caller should look up the method again. If
+ * it is only queued, remove it from the queue and return FALSE, so the caller compiles
+ * it itself.
+ */
+gboolean
+mono_compile_queue_wait (MonoDomain *domain, MonoMethod *method)
+{
+	CompileQueueItem *item;
+
+	if (!queue_items)
+		return FALSE;
+
+	mono_coop_mutex_lock (&queue_mutex);
+	item = lookup_item (domain, method);
+	if (!item) {
+		mono_coop_mutex_unlock (&queue_mutex);
+		return FALSE;
+	}
+
+	if (item->state == COMPILE_QUEUE_QUEUED) {
+		/* The compiler thread drops it when it reaches it */
+		item->state = COMPILE_QUEUE_DONE;
+		g_hash_table_remove (queue_items, item);
+		mono_coop_mutex_unlock (&queue_mutex);
+		InterlockedIncrement (&taken_over);
+		return FALSE;
+	}
+
+	/* The compiler thread might need the loader lock */
+	if (mono_loader_lock_is_owned_by_self ()) {
+		mono_coop_mutex_unlock (&queue_mutex);
+		return FALSE;
+	}
+
+	item->refcount++;
+	while (item->state != COMPILE_QUEUE_DONE)
+		mono_coop_cond_wait (&item->cond, &queue_mutex);
+	item_unref (item);
+	mono_coop_mutex_unlock (&queue_mutex);
+
+	InterlockedIncrement (&waited);
+	return TRUE;
+}
+
+static gboolean
+item_in_domain (gpointer key, gpointer value, gpointer user_data)
+{
+	return ((CompileQueueItem *)value)->domain == (MonoDomain *)user_data;
+}
+
+/*
+ * mono_compile_queue_free_domain:
+ *
+ *   Drop the queued methods of DOMAIN and wait for the ones being compiled.
+ */
+void
+mono_compile_queue_free_domain (MonoDomain *domain)
+{
+	GSList *l, *next;
+	CompileQueueItem *item;
+
+	if (!queue_items)
+		return;
+
+	mono_coop_mutex_lock (&queue_mutex);
+	for (l = preload_images; l; l = next) {
+		next = l->next;
+		if (((PreloadImage *)l->data)->domain == domain) {
+			g_free (l->data);
+			preload_images = g_slist_delete_link (preload_images, l);
+		}
+	}
+
+	while ((item = (CompileQueueItem *)g_hash_table_find (queue_items, item_in_domain, domain))) {
+		if (item->state == COMPILE_QUEUE_QUEUED) {
+			item->state = COMPILE_QUEUE_DONE;
+			g_hash_table_remove (queue_items, item);
+			continue;
+		}
+		item->refcount++;
+		while (item->state != COMPILE_QUEUE_DONE)
+			mono_coop_cond_wait (&item->cond, &queue_mutex);
+		item_unref (item);
+	}
+	mono_coop_mutex_unlock (&queue_mutex);
+}
+
+void
+mono_compile_queue_init (guint32 default_opt)
+{
+	if (!compile_queue_threads || mono_aot_only)
+		return;
+	if (!compile_queue_preload) {
+		g_warning ("--jit-threads has no effect without --jit-preload, background JIT compilation is disabled.");
+		return;
+	}
+
+	mono_coop_mutex_init (&queue_mutex);
+	mono_coop_cond_init (&queue_cond);
+	queue_items = g_hash_table_new (item_hash, item_equal);
+	queue = g_queue_new ();
+	compile_queue_opts = default_opt;
+
+	mono_counters_register ("Background compiled methods", MONO_COUNTER_JIT | MONO_COUNTER_INT, &background_compiled);
+	mono_counters_register ("Queued methods compiled by callers", MONO_COUNTER_JIT | MONO_COUNTER_INT, &taken_over);
+	mono_counters_register ("Waits for background compilation", MONO_COUNTER_JIT | MONO_COUNTER_INT, &waited);
+
+	if (compile_queue_preload)
+		mono_install_assembly_load_hook (compile_queue_assembly_loaded, NULL);
+}
+
+#else /* DISABLE_JIT */
+
+void
+mono_compile_queue_init (guint32 default_opt)
+{
+}
+
+void
+mono_compile_queue_add (MonoDomain *domain, MonoMethod *method)
+{
+}
+
+gboolean
+mono_compile_queue_wait (MonoDomain *domain, MonoMethod *method)
+{
+	return FALSE;
+}
+
+void
+mono_compile_queue_free_domain (MonoDomain *domain)
+{
+}
+
+#endif /* DISABLE_JIT */
@@ -1319,14 +1319,83 @@ build_native_trace (MonoError *error)
 #endif
 }
 
+/*
+ * The (ip, generic info) pairs collected by the first pass of exception handling for
+ * the stack trace of the exception. Shallow traces fit into BUF, so collecting them
+ * doesn't need allocations.
+ */
+typedef struct {
+	gpointer *ips;
+	int len, size;
+	gpointer buf [32];
+} TraceIps;
+
 static void
-setup_stack_trace (MonoException *mono_ex, GSList *dynamic_methods, MonoArray *initial_trace_ips, GList **trace_ips)
+trace_ips_init (TraceIps *trace_ips)
+{
+	trace_ips->ips = trace_ips->buf;
+	trace_ips->len = 0;
+	trace_ips->size = G_N_ELEMENTS (trace_ips->buf);
+}
+
+static void
+trace_ips_add (TraceIps *trace_ips, gpointer ip, gpointer generic_info)
+{
+	if (trace_ips->len + 2 > trace_ips->size) {
+		gpointer *ips = g_new (gpointer, trace_ips->size * 2);
+
+		memcpy (ips, trace_ips->ips, trace_ips->len * sizeof (gpointer));
+		if (trace_ips->ips != trace_ips->buf)
+			g_free (trace_ips->ips);
+		trace_ips->ips = ips;
+		trace_ips->size *= 2;
+	}
+	trace_ips->ips [trace_ips->len ++] = ip;
+	trace_ips->ips [trace_ips->len ++] = generic_info;
+}
+
+static void
+trace_ips_free (TraceIps *trace_ips)
+{
+	if (trace_ips->ips != trace_ips->buf)
+		g_free (trace_ips->ips);
+	trace_ips_init (trace_ips);
+}
+
+/*
+ * The frames unwound by the first pass of exception handling. Most exceptions are
+ * caught in one of the first few frames, so the second pass can replay them instead
+ * of unwinding and looking up the jit info of every frame again.
+ */
+#define MAX_UNWOUND_FRAMES 4
+
+typedef struct {
+	gboolean unwind_res;
+	MonoStackFrameType type;
+	MonoJitInfo *ji;
+	MonoContext new_ctx;
+	MonoLMF *lmf;
+} UnwoundFrame;
+
+typedef struct {
+	UnwoundFrame frames [MAX_UNWOUND_FRAMES];
+	int nframes;
+	/* Set when the first pass ran managed code, which might invalidate the frames */
+	gboolean invalid;
+} UnwoundFrames;
+
+static void
+setup_stack_trace (MonoException *mono_ex, GSList *dynamic_methods, MonoArray *initial_trace_ips, TraceIps *trace_ips)
 {
 	if (mono_ex && !initial_trace_ips) {
-		*trace_ips = g_list_reverse (*trace_ips);
 		MonoError error;
-		MonoArray *ips_arr = mono_glist_to_array (*trace_ips, mono_defaults.int_class, &error);
+		MonoArray *ips_arr;
+		int i;
+
+		ips_arr = mono_array_new_checked (mono_domain_get (), mono_defaults.int_class, trace_ips->len, &error);
 		mono_error_assert_ok (&error);
+		for (i = 0; i < trace_ips->len; ++i)
+			mono_array_set (ips_arr, gpointer, i, trace_ips->ips [i]);
 		MONO_OBJECT_SETREF (mono_ex, trace_ips, ips_arr);
 		MONO_OBJECT_SETREF (mono_ex, native_trace_ips, build_native_trace (&error));
 		mono_error_assert_ok (&error);
@@ -1356,8 +1425,7 @@ setup_stack_trace (MonoException *mono_ex, GSList *dynamic_methods, MonoArray *i
 			MONO_OBJECT_SETREF (mono_ex, dynamic_methods, list);
 		}
 	}
-	g_list_free (*trace_ips);
-	*trace_ips = NULL;
+	trace_ips_free (trace_ips);
 }
 
 /*
@@ -1366,9 +1434,10 @@ setup_stack_trace (MonoException *mono_ex, GSList *dynamic_methods, MonoArray *i
  *   The first pass of exception handling. Unwind the stack until a catch clause which can catch
  * OBJ is found. Run the index of the filter clause which caught the exception into
  * OUT_FILTER_IDX. Return TRUE if the exception is caught, FALSE otherwise.
+ * If UNWOUND is not NULL, the first frames are saved into it.
  */
 static gboolean
-mono_handle_exception_internal_first_pass (MonoContext *ctx, MonoObject *obj, gint32 *out_filter_idx, MonoJitInfo **out_ji, MonoJitInfo **out_prev_ji, MonoObject *non_exception)
+mono_handle_exception_internal_first_pass (MonoContext *ctx, MonoObject *obj, gint32 *out_filter_idx, MonoJitInfo **out_ji, MonoJitInfo **out_prev_ji, MonoObject *non_exception, UnwoundFrames *unwound)
 {
 	MonoError error;
 	MonoDomain *domain = mono_domain_get ();
@@ -1377,7 +1446,7 @@ mono_handle_exception_internal_first_pass (MonoContext *ctx, MonoObject *obj, gi
 	MonoJitTlsData *jit_tls = (MonoJitTlsData *)mono_native_tls_get_value (mono_jit_tls_id);
 	MonoLMF *lmf = mono_get_lmf ();
 	MonoArray *initial_trace_ips = NULL;
-	GList *trace_ips = NULL;
+	TraceIps trace_ips;
 	GSList *dynamic_methods = NULL;
 	MonoException *mono_ex;
 	gboolean stack_overflow = FALSE;
@@ -1390,6 +1459,8 @@ mono_handle_exception_internal_first_pass (MonoContext *ctx, MonoObject *obj, gi
 
 	g_assert (ctx != NULL);
 
+	trace_ips_init (&trace_ips);
+
 	if (obj == (MonoObject *)domain->stack_overflow_ex)
 		stack_overflow = TRUE;
 
@@ -1431,6 +1502,15 @@ mono_handle_exception_internal_first_pass (MonoContext *ctx, MonoObject *obj, gi
 			*out_prev_ji = ji;
 
 		unwind_res = mono_find_jit_info_ext (domain, jit_tls, NULL, ctx, &new_ctx, NULL, &lmf, NULL, &frame);
+		if (unwound && !unwound->invalid && unwound->nframes < MAX_UNWOUND_FRAMES) {
+			UnwoundFrame *uframe = &unwound->frames [unwound->nframes ++];
+
+			uframe->unwind_res = unwind_res;
+			uframe->type = frame.type;
+			uframe->ji = frame.ji;
+			uframe->new_ctx = new_ctx;
+			uframe->lmf = lmf;
+		}
 		if (unwind_res) {
 			if (frame.type == FRAME_TYPE_DEBUGGER_INVOKE ||
 					frame.type == FRAME_TYPE_MANAGED_TO_NATIVE ||
@@ -1465,9 +1545,7 @@ mono_handle_exception_internal_first_pass (MonoContext *ctx, MonoObject *obj, gi
 			 * overflow.
 			 */
 			if (!initial_trace_ips && (frame_count < 1000)) {
-				trace_ips = g_list_prepend (trace_ips, MONO_CONTEXT_GET_IP (ctx));
-				trace_ips = g_list_prepend (trace_ips,
-											get_generic_info_from_stack_frame (ji, ctx));
+				trace_ips_add (&trace_ips, MONO_CONTEXT_GET_IP (ctx), get_generic_info_from_stack_frame (ji, ctx));
 			}
 		}
 
@@ -1546,6 +1624,8 @@ mono_handle_exception_internal_first_pass (MonoContext *ctx, MonoObject *obj, gi
 						MONO_CONTEXT_SET_LLVM_EH_SELECTOR_REG (ctx, ei->clause_index);
 #endif
 
+					if (unwound)
+						unwound->invalid = TRUE;
 					mono_debugger_agent_begin_exception_filter (mono_ex, ctx, &initial_ctx);
 					filtered = call_filter (ctx, ei->data.filter);
 					mono_debugger_agent_end_exception_filter (mono_ex, ctx, &initial_ctx);
@@ -1612,6 +1692,8 @@ mono_handle_exception_internal (MonoContext *ctx, MonoObject *obj, gboolean resu
 	int i;
 	MonoObject *ex_obj;
 	MonoObject *non_exception = NULL;
+	UnwoundFrames unwound, *unwound_ptr;
+	int unwound_index = 0;
 
 	g_assert (ctx != NULL);
 	if (!obj) {
@@ -1689,6 +1771,9 @@ mono_handle_exception_internal (MonoContext *ctx, MonoObject *obj, gboolean resu
 	 */
 	memcpy (&jit_tls->orig_ex_ctx, ctx, sizeof (MonoContext));
 
+	unwound.nframes = 0;
+	unwound.invalid = FALSE;
+
 	if (!resume) {
 		gboolean res;
 
@@ -1730,7 +1815,16 @@ mono_handle_exception_internal (MonoContext *ctx, MonoObject *obj, gboolean resu
 		mono_profiler_exception_thrown (obj);
 		jit_tls->orig_ex_ctx_set = FALSE;
 
-		res = mono_handle_exception_internal_first_pass (&ctx_cp, obj, &first_filter_idx, &ji, &prev_ji, non_exception);
+		/*
+		 * The debugger can change the state of the frames before the second pass. Don't save
+		 * frames during a stack overflow, to save stack space.
+		 */
+		unwound_ptr = (stack_overflow || mini_get_debug_options ()->gen_sdb_seq_points) ? NULL : &unwound;
+
+		res = mono_handle_exception_internal_first_pass (&ctx_cp, obj, &first_filter_idx, &ji, &prev_ji, non_exception, unwound_ptr);
+		/* Unhandled exceptions run managed code before the second pass */
+		if (unwound.invalid || !res)
+			unwound.nframes = 0;
 
 		if (!res) {
 			if (mini_get_debug_options ()->break_on_exc)
@@ -1787,6 +1881,23 @@ mono_handle_exception_internal (MonoContext *ctx, MonoObject *obj, gboolean resu
 			lmf = jit_tls->resume_state.lmf;
 			first_filter_idx = jit_tls->resume_state.first_filter_idx;
 			filter_idx = jit_tls->resume_state.filter_idx;
+		} else if (unwound_index < unwound.nframes) {
+			/* Replay the frames unwound by the first pass */
+			UnwoundFrame *uframe = &unwound.frames [unwound_index ++];
+
+			unwind_res = uframe->unwind_res;
+			new_ctx = uframe->new_ctx;
+			lmf = uframe->lmf;
+			if (unwind_res) {
+				if (uframe->type == FRAME_TYPE_DEBUGGER_INVOKE ||
+						uframe->type == FRAME_TYPE_MANAGED_TO_NATIVE ||
+						uframe->type == FRAME_TYPE_TRAMPOLINE) {
+					*ctx = new_ctx;
+					continue;
+				}
+				g_assert (uframe->type == FRAME_TYPE_MANAGED);
+				ji = uframe->ji;
+			}
 		} else {
 			StackFrameInfo frame;
 
@@ -35,10 +35,9 @@ get_provenance_func (void)
 	return provenance;
 }
 
-#if 0
-//#if defined(MONO_ARCH_GC_MAPS_SUPPORTED)
+#if defined(MONO_ARCH_GC_MAPS_SUPPORTED)
 
-#include <mono/metadata/sgen-conf.h>
+#include <mono/sgen/sgen-conf.h>
 #include <mono/metadata/gc-internals.h>
 #include <mono/utils/mono-counters.h>
 
@@ -234,18 +233,11 @@ typedef struct {
 	//guint8 encoded_size;
 
 	/*
-	 * The arrays below are embedded after the struct.
-	 * Their address needs to be computed.
+	 * The fixed fields of the GCMap encoded using LEB128, followed by an array of
+	 * ncallsites entries, each entry callsite_entry_size bytes long, and the GC
+	 * bitmaps.  Their addresses need to be computed while decoding.
 	 */
-
-	/* The fixed fields of the GCMap encoded using LEB128 */
 	guint8 encoded [MONO_ZERO_LEN_ARRAY];
-
-	/* An array of ncallsites entries, each entry is callsite_entry_size bytes long */
-	guint8 callsites [MONO_ZERO_LEN_ARRAY];
-
-	/* The GC bitmaps */
-	guint8 bitmaps [MONO_ZERO_LEN_ARRAY];
 } GCEncodedMap;
 
 static int precise_frame_count [2], precise_frame_limit = -1;
@@ -623,6 +615,10 @@ thread_suspend_func (gpointer user_data, void *sigctx, MonoContext *ctx)
 		return;
 	}
 
+	/* The unwind state is only needed by the precise pass. */
+	if (!mono_gc_precise_stack_mark_enabled ())
+		return;
+
 	if (tls->tid != mono_native_thread_id_get ()) {
 		/* Happens on osx because threads are not suspended using signals */
 #ifndef TARGET_WIN32
@@ -702,9 +698,9 @@ get_frame_pointer (MonoContext *ctx, int frame_reg)
 {
 #if defined(TARGET_AMD64)
 		if (frame_reg == AMD64_RSP)
-			return ctx->rsp;
+			return (mgreg_t)MONO_CONTEXT_GET_SP (ctx);
 		else if (frame_reg == AMD64_RBP)
-			return ctx->rbp;
+			return (mgreg_t)MONO_CONTEXT_GET_BP (ctx);
 #elif defined(TARGET_X86)
 		if (frame_reg == X86_ESP)
 			return ctx->esp;
@@ -2621,6 +2617,9 @@ mini_gc_init_cfg (MonoCompile *cfg)
 	if (mono_gc_is_moving ()) {
 		cfg->disable_ref_noref_stack_slot_share = TRUE;
 		cfg->gen_write_barriers = TRUE;
+	} else if (mono_gc_needs_write_barriers () && !cfg->compile_aot) {
+		/* The non-moving collectors only have a card table for JITted code */
+		cfg->gen_write_barriers = TRUE;
 	}
 
 	mini_gc_init_gc_map (cfg);
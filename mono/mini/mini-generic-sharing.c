@@ -893,9 +893,9 @@ class_type_info (MonoDomain *domain, MonoClass *klass, MonoRgctxInfoType info_ty
 		return vtable;
 	}
 	case MONO_RGCTX_INFO_CAST_CACHE: {
-		/*First slot is the cache itself, the second the vtable.*/
-		gpointer **cache_data = (gpointer **)mono_domain_alloc0 (domain, sizeof (gpointer) * 2);
-		cache_data [1] = (gpointer *)klass;
+		/*The first MONO_CAST_CACHE_ENTRIES slots are the cache itself, the next one the class.*/
+		gpointer **cache_data = (gpointer **)mono_domain_alloc0 (domain, sizeof (gpointer) * (MONO_CAST_CACHE_ENTRIES + 1));
+		cache_data [MONO_CAST_CACHE_ENTRIES] = (gpointer *)klass;
 		return cache_data;
 	}
 	case MONO_RGCTX_INFO_ARRAY_ELEMENT_SIZE:
@@ -1060,7 +1060,8 @@ tramp_info_hash (gconstpointer key)
 {
 	GSharedVtTrampInfo *tramp = (GSharedVtTrampInfo *)key;
 
-	return (gsize)tramp->addr;
+	/* Calli trampolines have no address, so include the signatures */
+	return (gsize)tramp->addr ^ mono_aligned_addr_hash (tramp->sig) ^ (mono_aligned_addr_hash (tramp->gsig) << 1);
 }
 
 static gboolean
@@ -1423,6 +1424,56 @@ mini_get_gsharedvt_out_sig_wrapper_signature (gboolean has_this, gboolean has_re
 	return sig;
 }
 
+/*
+ * get_gsharedvt_call_info:
+ *
+ *   Return the arch specific call info used by the gsharedvt trampoline to translate the call
+ * described by TINFO. The argument maps only depend on the signatures, so they are computed
+ * once per signature and copied for each new target address.
+ */
+static gpointer
+get_gsharedvt_call_info (MonoDomain *domain, GSharedVtTrampInfo *tinfo)
+{
+#ifdef MONO_ARCH_GSHAREDVT_SUPPORTED
+	MonoJitDomainInfo *domain_info = domain_jit_info (domain);
+	GSharedVtTrampInfo key, *new_key;
+	GSharedVtCallInfo *template_info, *info;
+	int size;
+
+	memcpy (&key, tinfo, sizeof (GSharedVtTrampInfo));
+	key.addr = NULL;
+
+	mono_domain_lock (domain);
+	if (!domain_info->gsharedvt_call_info_hash)
+		domain_info->gsharedvt_call_info_hash = g_hash_table_new (tramp_info_hash, tramp_info_equal);
+	template_info = (GSharedVtCallInfo *)g_hash_table_lookup (domain_info->gsharedvt_call_info_hash, &key);
+	mono_domain_unlock (domain);
+
+	if (!template_info) {
+		template_info = (GSharedVtCallInfo *)mono_arch_get_gsharedvt_call_info (NULL, tinfo->sig, tinfo->gsig, tinfo->is_in, tinfo->vcall_offset, tinfo->calli);
+
+		new_key = (GSharedVtTrampInfo *)mono_domain_alloc0 (domain, sizeof (GSharedVtTrampInfo));
+		memcpy (new_key, &key, sizeof (GSharedVtTrampInfo));
+
+		mono_domain_lock (domain);
+		/* Duplicates are not a problem */
+		g_hash_table_insert (domain_info->gsharedvt_call_info_hash, new_key, template_info);
+		mono_domain_unlock (domain);
+	}
+
+	if (!tinfo->addr)
+		return template_info;
+
+	size = sizeof (GSharedVtCallInfo) + (template_info->map_count * 2 * sizeof (int));
+	info = (GSharedVtCallInfo *)mono_domain_alloc0 (domain, size);
+	memcpy (info, template_info, size);
+	info->addr = tinfo->addr;
+	return info;
+#else
+	return mono_arch_get_gsharedvt_call_info (tinfo->addr, tinfo->sig, tinfo->gsig, tinfo->is_in, tinfo->vcall_offset, tinfo->calli);
+#endif
+}
+
 /*
  * mini_get_gsharedvt_wrapper:
  *
@@ -1478,7 +1529,7 @@ mini_get_gsharedvt_wrapper (gboolean gsharedvt_in, gpointer addr, MonoMethodSign
 	if (res)
 		return res;
 
-	info = mono_arch_get_gsharedvt_call_info (addr, normal_sig, gsharedvt_sig, gsharedvt_in, vcall_offset, calli);
+	info = get_gsharedvt_call_info (domain, &tinfo);
 
 	if (gsharedvt_in) {
 		static gpointer tramp_addr;
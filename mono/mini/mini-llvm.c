@@ -2556,10 +2556,14 @@ emit_llvm_code_start (MonoLLVMModule *module)
 {
 	LLVMModuleRef lmodule = module->lmodule;
 	LLVMValueRef func;
+	char *name;
 	LLVMBasicBlockRef entry_bb;
 	LLVMBuilderRef builder;
 
-	func = LLVMAddFunction (lmodule, "llvm_code_start", LLVMFunctionType (LLVMVoidType (), NULL, 0, FALSE));
+	/* Prefixed since llvm-split=<n> can make this a global symbol, see emit_llvm_split_file () in aot-compiler.c */
+	name = g_strdup_printf ("%s_llvm_code_start", module->global_prefix);
+	func = LLVMAddFunction (lmodule, name, LLVMFunctionType (LLVMVoidType (), NULL, 0, FALSE));
+	g_free (name);
 	LLVMSetLinkage (func, LLVMInternalLinkage);
 	LLVMAddFunctionAttr (func, LLVMNoUnwindAttribute);
 	module->code_start = func;
@@ -2664,10 +2668,14 @@ emit_llvm_code_end (MonoLLVMModule *module)
 {
 	LLVMModuleRef lmodule = module->lmodule;
 	LLVMValueRef func;
+	char *name;
 	LLVMBasicBlockRef entry_bb;
 	LLVMBuilderRef builder;
 
-	func = LLVMAddFunction (lmodule, "llvm_code_end", LLVMFunctionType (LLVMVoidType (), NULL, 0, FALSE));
+	/* Prefixed since llvm-split=<n> can make this a global symbol, see emit_llvm_split_file () in aot-compiler.c */
+	name = g_strdup_printf ("%s_llvm_code_end", module->global_prefix);
+	func = LLVMAddFunction (lmodule, name, LLVMFunctionType (LLVMVoidType (), NULL, 0, FALSE));
+	g_free (name);
 	LLVMSetLinkage (func, LLVMInternalLinkage);
 	LLVMAddFunctionAttr (func, LLVMNoUnwindAttribute);
 	module->code_end = func;
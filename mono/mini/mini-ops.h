@@ -704,6 +704,7 @@ MINI_OP(OP_ROUND,   "round", FREG, FREG, NONE)
 /* to optimize strings */
 MINI_OP(OP_STRLEN, "strlen", IREG, IREG, NONE)
 MINI_OP(OP_NEWARR, "newarr", IREG, IREG, NONE)
+MINI_OP(OP_NEWOBJ, "newobj", IREG, NONE, NONE)
 MINI_OP(OP_LDLEN, "ldlen", IREG, IREG, NONE)
 MINI_OP(OP_BOUNDS_CHECK, "bounds_check", NONE, IREG, IREG)
 /* type checks */
@@ -947,6 +948,37 @@ MINI_OP(OP_CVTPS2PD, "cvtps2pd", XREG, XREG, NONE)
 MINI_OP(OP_CVTTPD2DQ, "cvttpd2dq", XREG, XREG, NONE)
 MINI_OP(OP_CVTTPS2DQ, "cvttps2dq", XREG, XREG, NONE)
 
+#if defined(TARGET_AMD64)
+/* 256 bit AVX/AVX2 ops, only emitted by the loop vectorizer */
+MINI_OP(OP_LOADY_MEMBASE, "loady_membase", XREG, IREG, NONE)
+MINI_OP(OP_STOREY_MEMBASE, "storey_membase", IREG, XREG, NONE)
+MINI_OP(OP_YMOVE, "ymove", XREG, XREG, NONE)
+
+MINI_OP(OP_YPADDB, "ypaddb", XREG, XREG, XREG)
+MINI_OP(OP_YPADDW, "ypaddw", XREG, XREG, XREG)
+MINI_OP(OP_YPADDD, "ypaddd", XREG, XREG, XREG)
+MINI_OP(OP_YPSUBB, "ypsubb", XREG, XREG, XREG)
+MINI_OP(OP_YPSUBW, "ypsubw", XREG, XREG, XREG)
+MINI_OP(OP_YPSUBD, "ypsubd", XREG, XREG, XREG)
+MINI_OP(OP_YPAND, "ypand", XREG, XREG, XREG)
+MINI_OP(OP_YPOR, "ypor", XREG, XREG, XREG)
+MINI_OP(OP_YPXOR, "ypxor", XREG, XREG, XREG)
+MINI_OP(OP_YPMULW, "ypmulw", XREG, XREG, XREG)
+MINI_OP(OP_YPMULD, "ypmuld", XREG, XREG, XREG)
+
+MINI_OP(OP_YADDPS, "yaddps", XREG, XREG, XREG)
+MINI_OP(OP_YSUBPS, "ysubps", XREG, XREG, XREG)
+MINI_OP(OP_YMULPS, "ymulps", XREG, XREG, XREG)
+MINI_OP(OP_YDIVPS, "ydivps", XREG, XREG, XREG)
+
+MINI_OP(OP_YEXPAND_I1, "yexpand_i1", XREG, IREG, NONE)
+MINI_OP(OP_YEXPAND_I2, "yexpand_i2", XREG, IREG, NONE)
+MINI_OP(OP_YEXPAND_I4, "yexpand_i4", XREG, IREG, NONE)
+MINI_OP(OP_YEXPAND_R4, "yexpand_r4", XREG, FREG, NONE)
+
+MINI_OP(OP_VZEROUPPER, "vzeroupper", NONE, NONE, NONE)
+#endif
+
 #endif
 
 MINI_OP(OP_XMOVE,   "xmove", XREG, XREG, NONE)
@@ -1073,6 +1105,8 @@ MINI_OP(OP_GC_SPILL_SLOT_LIVENESS_DEF, "gc_spill_slot_liveness_def", NONE, NONE,
 MINI_OP(OP_GC_PARAM_SLOT_LIVENESS_DEF, "gc_param_slot_liveness_def", NONE, NONE, NONE)
 
 MINI_OP(OP_GC_SAFE_POINT, "gc_safe_point", NONE, IREG, NONE)
+/* Safepoint which reads mono_polling_page, see MONO_ARCH_HAVE_GC_POLLING_PAGE */
+MINI_OP(OP_GC_POLL_PAGE, "gc_poll_page", NONE, IREG, NONE)
 
 /*
  * Check if the class given by sreg1 was inited, if not, call
@@ -51,6 +51,7 @@
 #include <mono/metadata/runtime.h>
 #include <mono/metadata/reflection-internals.h>
 #include <mono/metadata/monitor.h>
+#include <mono/metadata/lock-tracer.h>
 #include <mono/utils/mono-math.h>
 #include <mono/utils/mono-compiler.h>
 #include <mono/utils/mono-counters.h>
@@ -66,6 +67,7 @@
 #include <mono/utils/mono-threads-coop.h>
 #include <mono/utils/checked-build.h>
 #include <mono/utils/w32handle.h>
+#include <mono/utils/mono-startup-trace.h>
 #include <mono/io-layer/io-layer.h>
 
 #include "mini.h"
@@ -116,8 +118,8 @@ int mini_verbose = 0;
  */
 gboolean mono_use_llvm = FALSE;
 
-#define mono_jit_lock() mono_os_mutex_lock (&jit_mutex)
-#define mono_jit_unlock() mono_os_mutex_unlock (&jit_mutex)
+#define mono_jit_lock() mono_locks_os_acquire (&jit_mutex, JitLock)
+#define mono_jit_unlock() mono_locks_os_release (&jit_mutex, JitLock)
 static mono_mutex_t jit_mutex;
 
 static MonoCodeManager *global_codeman;
@@ -490,7 +492,7 @@ mono_tramp_info_register (MonoTrampInfo *info, MonoDomain *domain)
 		register_trampoline_jit_info (domain, copy);
 
 	if (mono_jit_map_is_enabled ())
-		mono_emit_jit_tramp (info->code, info->code_size, info->name);
+		mono_emit_jit_tramp_unwind (info->code, info->code_size, info->name, copy->uw_info, copy->uw_info_len);
 
 	mono_tramp_info_free (info);
 }
@@ -955,6 +957,10 @@ setup_jit_tls_data (gpointer stack_start, gpointer abort_func)
 
 	mono_setup_altstack (jit_tls);
 
+#ifdef MONO_ARCH_HAVE_THREAD_SINGLE_STEP
+	mono_arch_init_single_stepping_thread (jit_tls);
+#endif
+
 	return jit_tls;
 }
 
@@ -964,6 +970,9 @@ free_jit_tls_data (MonoJitTlsData *jit_tls)
 	mono_arch_free_jit_tls_data (jit_tls);
 	mono_free_altstack (jit_tls);
 
+	if (jit_tls->jit_mempool)
+		mono_mempool_destroy (jit_tls->jit_mempool);
+
 	g_free (jit_tls->first_lmf);
 	g_free (jit_tls);
 }
@@ -1051,6 +1060,9 @@ mini_get_tls_offset (MonoTlsKey key)
 	case TLS_KEY_THREAD:
 		offset = mono_thread_get_tls_offset ();
 		break;
+	case TLS_KEY_THREAD_STATIC_DATA:
+		offset = mono_thread_get_static_data_tls_offset ();
+		break;
 	case TLS_KEY_JIT_TLS:
 		offset = mono_get_jit_tls_offset ();
 		break;
@@ -1627,7 +1639,7 @@ mono_resolve_patch_target (MonoMethod *method, MonoDomain *domain, guint8 *code,
 		break;
 	}
 	case MONO_PATCH_INFO_CASTCLASS_CACHE: {
-		target = mono_domain_alloc0 (domain, sizeof (gpointer));
+		target = mono_domain_alloc0 (domain, sizeof (gpointer) * MONO_CAST_CACHE_ENTRIES);
 		break;
 	}
 	case MONO_PATCH_INFO_JIT_TLS_ID: {
@@ -1706,21 +1718,20 @@ mini_init_gsctx (MonoDomain *domain, MonoMemPool *mp, MonoGenericContext *contex
 }
 
 /*
- * LOCKING: Acquires the jit code hash lock.
+ * LOCKING: Lock free, see mono_jit_code_hash_new ().
  */
 MonoJitInfo*
 mini_lookup_method (MonoDomain *domain, MonoMethod *method, MonoMethod *shared)
 {
 	MonoJitInfo *ji;
 	static gboolean inited = FALSE;
-	static int lookups = 0;
-	static int failed_lookups = 0;
+	static gint32 lookups = 0;
+	static gint32 failed_lookups = 0;
 
-	mono_domain_jit_code_hash_lock (domain);
-	ji = (MonoJitInfo *)mono_internal_hash_table_lookup (&domain->jit_code_hash, method);
+	ji = (MonoJitInfo *)mono_lock_free_hashtable_lookup (domain->jit_code_hash, method);
 	if (!ji && shared) {
 		/* Try generic sharing */
-		ji = (MonoJitInfo *)mono_internal_hash_table_lookup (&domain->jit_code_hash, shared);
+		ji = (MonoJitInfo *)mono_lock_free_hashtable_lookup (domain->jit_code_hash, shared);
 		if (ji && !ji->has_generic_jit_info)
 			ji = NULL;
 		if (!inited) {
@@ -1729,11 +1740,10 @@ mini_lookup_method (MonoDomain *domain, MonoMethod *method, MonoMethod *shared)
 			inited = TRUE;
 		}
 
-		++lookups;
+		InterlockedIncrement (&lookups);
 		if (!ji)
-			++failed_lookups;
+			InterlockedIncrement (&failed_lookups);
 	}
-	mono_domain_jit_code_hash_unlock (domain);
 
 	return ji;
 }
@@ -1764,6 +1774,7 @@ mono_get_jit_info_from_method (MonoDomain *domain, MonoMethod *method)
 
 #if ENABLE_JIT_MAP
 static FILE* perf_map_file;
+static gboolean jit_dump_enabled;
 
 void
 mono_enable_jit_map (void)
@@ -1776,19 +1787,46 @@ mono_enable_jit_map (void)
 	}
 }
 
+/*
+ * mono_enable_jit_dump:
+ *
+ *   Write the JITted code to /tmp/jit-PID.dump, see jitdump.c.
+ */
 void
-mono_emit_jit_tramp (void *start, int size, const char *desc)
+mono_enable_jit_dump (void)
+{
+	if (!jit_dump_enabled)
+		jit_dump_enabled = mono_jitdump_open ();
+}
+
+void
+mono_emit_jit_tramp_unwind (void *start, int size, const char *desc, guint8 *uw_info, guint32 uw_info_len)
 {
 	if (perf_map_file)
 		fprintf (perf_map_file, "%llx %x %s\n", (long long unsigned int)(gsize)start, size, desc);
+	if (jit_dump_enabled)
+		mono_jitdump_emit_code (NULL, start, size, desc, uw_info, uw_info_len);
+}
+
+void
+mono_emit_jit_tramp (void *start, int size, const char *desc)
+{
+	mono_emit_jit_tramp_unwind (start, size, desc, NULL, 0);
 }
 
 void
 mono_emit_jit_map (MonoJitInfo *jinfo)
 {
-	if (perf_map_file) {
+	if (perf_map_file || jit_dump_enabled) {
 		char *name = mono_method_full_name (jinfo_get_method (jinfo), TRUE);
-		mono_emit_jit_tramp (jinfo->code_start, jinfo->code_size, name);
+		if (perf_map_file)
+			fprintf (perf_map_file, "%llx %x %s\n", (long long unsigned int)(gsize)jinfo->code_start, jinfo->code_size, name);
+		if (jit_dump_enabled) {
+			guint32 uw_info_len;
+			guint8 *uw_info = mono_jinfo_get_unwind_info (jinfo, &uw_info_len);
+
+			mono_jitdump_emit_code (jinfo, jinfo->code_start, jinfo->code_size, name, uw_info, uw_info_len);
+		}
 		g_free (name);
 	}
 }
@@ -1796,7 +1834,7 @@ mono_emit_jit_map (MonoJitInfo *jinfo)
 gboolean
 mono_jit_map_is_enabled (void)
 {
-	return perf_map_file != NULL;
+	return perf_map_file != NULL || jit_dump_enabled;
 }
 
 #endif
@@ -1919,8 +1957,23 @@ mono_jit_compile_method_with_opt (MonoMethod *method, guint32 opt, MonoError *er
 		}
 	}
 
-	if (!code)
-		code = mono_jit_compile_method_inner (method, target_domain, opt, error);
+	if (!code) {
+		/* A compiler thread is working on it, see mini-compile-queue.c */
+		if (mono_compile_queue_wait (target_domain, method))
+			return mono_jit_compile_method_with_opt (method, opt, error);
+		if (G_UNLIKELY (mono_startup_trace_enabled)) {
+			MonoStartupTraceStamp trace_stamp;
+			char *name;
+
+			mono_startup_trace_begin (MONO_STARTUP_JIT, &trace_stamp);
+			code = mono_jit_compile_method_inner (method, target_domain, opt, JIT_FLAG_RUN_CCTORS, error);
+			name = mono_method_full_name (method, TRUE);
+			mono_startup_trace_end (MONO_STARTUP_JIT, &trace_stamp, name);
+			g_free (name);
+		} else {
+			code = mono_jit_compile_method_inner (method, target_domain, opt, JIT_FLAG_RUN_CCTORS, error);
+		}
+	}
 	if (!mono_error_ok (error))
 		return NULL;
 
@@ -2004,9 +2057,7 @@ mono_jit_free_method (MonoDomain *domain, MonoMethod *method)
 
 	mono_domain_lock (domain);
 	g_hash_table_remove (domain_jit_info (domain)->dynamic_code_hash, method);
-	mono_domain_jit_code_hash_lock (domain);
-	mono_internal_hash_table_remove (&domain->jit_code_hash, method);
-	mono_domain_jit_code_hash_unlock (domain);
+	mono_lock_free_hashtable_remove (domain->jit_code_hash, method);
 	g_hash_table_remove (domain_jit_info (domain)->jump_trampoline_hash, method);
 
 	/* requires the domain lock - took above */
@@ -2807,6 +2858,29 @@ MONO_SIG_HANDLER_FUNC (, mono_sigill_signal_handler)
 #define HAVE_SIG_INFO
 #endif
 
+#ifdef MONO_ARCH_HAVE_GC_POLLING_PAGE
+/*
+ * handle_polling_page_fault:
+ *
+ *   Called on the faulting thread's stack in place of the read of the polling
+ * page. The registers of the managed frame are copied to our own frame so the
+ * GC scans them while we are suspended. Once the global suspend is over the
+ * page is readable again and the load is restarted.
+ */
+static void
+handle_polling_page_fault (gpointer user_data)
+{
+	MonoJitTlsData *jit_tls = (MonoJitTlsData *)mono_native_tls_get_value (mono_jit_tls_id);
+	MonoContext ctx;
+
+	memcpy (&ctx, &jit_tls->ex_ctx, sizeof (MonoContext));
+
+	mono_threads_state_poll ();
+
+	mono_restore_context (&ctx);
+}
+#endif
+
 MONO_SIG_HANDLER_FUNC (, mono_sigsegv_signal_handler)
 {
 	MonoJitInfo *ji;
@@ -2836,6 +2910,16 @@ MONO_SIG_HANDLER_FUNC (, mono_sigsegv_signal_handler)
 		mono_aot_handle_pagefault (info->si_addr);
 		return;
 	}
+#ifdef MONO_ARCH_HAVE_GC_POLLING_PAGE
+	if (mono_threads_is_polling_page_fault (info->si_addr) && jit_tls) {
+		MonoContext mctx;
+
+		mono_sigctx_to_monoctx (ctx, &mctx);
+		mono_setup_async_callback (&mctx, handle_polling_page_fault, NULL);
+		mono_monoctx_to_sigctx (&mctx, ctx);
+		return;
+	}
+#endif
 #endif
 
 	/* The thread might no be registered with the runtime */
@@ -3277,6 +3361,12 @@ mini_get_addr_from_ftnptr (gpointer descr)
 #endif
 }
 
+static gint64
+get_mempools_size (void)
+{
+	return mono_mempool_get_bytes_allocated ();
+}
+
 static void
 register_jit_stats (void)
 {
@@ -3295,6 +3385,7 @@ register_jit_stats (void)
 	mono_counters_register ("JIT/handle_global_vregs (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_handle_global_vregs);
 	mono_counters_register ("JIT/local_deadce (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_local_deadce);
 	mono_counters_register ("JIT/local_alias_analysis (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_local_alias_analysis);
+	mono_counters_register ("JIT/lower_compare_chains (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_lower_compare_chains);
 	mono_counters_register ("JIT/if_conversion (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_if_conversion);
 	mono_counters_register ("JIT/bb_ordering (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_bb_ordering);
 	mono_counters_register ("JIT/compile_dominator_info (sec)", MONO_COUNTER_JIT | MONO_COUNTER_DOUBLE, &mono_jit_stats.jit_compile_dominator_info);
@@ -3331,16 +3422,38 @@ register_jit_stats (void)
 	mono_counters_register ("Allocated seq points size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.allocated_seq_points_size);
 	mono_counters_register ("Inlineable methods", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.inlineable_methods);
 	mono_counters_register ("Inlined methods", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.inlined_methods);
+	mono_counters_register ("Guarded devirtualized calls", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.guarded_devirt_calls);
+	mono_counters_register ("Vectorized loops", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.vectorized_loops);
+	mono_counters_register ("Scalar replaced objects", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.scalar_replaced_objects);
+	mono_counters_register ("GVN eliminated instructions", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.gvn_eliminated);
+	mono_counters_register ("Bounds check versioned loops", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.abc_versioned_loops);
 	mono_counters_register ("Regvars", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.regvars);
 	mono_counters_register ("Locals stack size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.locals_stack_size);
 	mono_counters_register ("Method cache lookups", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.methods_lookups);
 	mono_counters_register ("Compiled CIL code size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.cil_code_size);
 	mono_counters_register ("Native code size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.native_code_size);
+	mono_counters_register ("Mempools size", MONO_COUNTER_METADATA | MONO_COUNTER_LONG | MONO_COUNTER_CALLBACK, get_mempools_size);
 	mono_counters_register ("Aliases found", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.alias_found);
 	mono_counters_register ("Aliases eliminated", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.alias_removed);
 	mono_counters_register ("Aliased loads eliminated", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.loads_eliminated);
 	mono_counters_register ("Aliased stores eliminated", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.stores_eliminated);
 	mono_counters_register ("Optimized immediate divisions", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.optimized_divisions);
+	mono_counters_register ("JIT mempool bytes", MONO_COUNTER_JIT | MONO_COUNTER_LONG | MONO_COUNTER_BYTES, &mono_jit_stats.mempool_bytes);
+	mono_counters_register ("Max JIT mempool size", MONO_COUNTER_JIT | MONO_COUNTER_INT | MONO_COUNTER_BYTES, &mono_jit_stats.max_mempool_size);
+	mono_counters_register ("Reused JIT mempools", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.mempools_reused);
+	mono_counters_register ("RGCTX inline caches", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.rgctx_inline_caches);
+	mono_counters_register ("Interface inline caches", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.iface_inline_caches);
+	mono_counters_register ("Interface inline cache hits", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.iface_ic_hits);
+	mono_counters_register ("Interface inline cache misses", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.iface_ic_misses);
+	mono_counters_register ("Megamorphic interface inline cache misses", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.iface_ic_megamorphic_misses);
+	mono_counters_register ("Generic virtual inline caches", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.gvm_inline_caches);
+	mono_counters_register ("Generic virtual inline cache hits", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.gvm_ic_hits);
+	mono_counters_register ("Generic virtual inline cache misses", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.gvm_ic_misses);
+	mono_counters_register ("Megamorphic generic virtual inline cache misses", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.gvm_ic_megamorphic_misses);
+	mono_counters_register ("Lowered compare chains", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.lowered_compare_chains);
+	mono_counters_register ("Devirtualized EqualityComparer calls", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.devirt_comparer_calls);
+	mono_counters_register ("IR instructions", MONO_COUNTER_JIT | MONO_COUNTER_LONG, &mono_jit_stats.ir_instructions);
+	mono_counters_register ("Max IR instructions", MONO_COUNTER_JIT | MONO_COUNTER_INT, &mono_jit_stats.max_ir_instructions);
 }
 
 static void runtime_invoke_info_free (gpointer value);
@@ -3369,7 +3482,7 @@ mini_create_jit_domain_info (MonoDomain *domain)
 
 	info->jump_trampoline_hash = g_hash_table_new (mono_aligned_addr_hash, NULL);
 	info->jit_trampoline_hash = g_hash_table_new (mono_aligned_addr_hash, NULL);
-	info->delegate_trampoline_hash = g_hash_table_new (class_method_pair_hash, class_method_pair_equal);
+	info->delegate_trampoline_hash = mono_conc_hashtable_new (class_method_pair_hash, class_method_pair_equal);
 	info->llvm_vcall_trampoline_hash = g_hash_table_new (mono_aligned_addr_hash, NULL);
 	info->runtime_invoke_hash = mono_conc_hashtable_new_full (mono_aligned_addr_hash, NULL, NULL, runtime_invoke_info_free);
 	info->seq_points = g_hash_table_new_full (mono_aligned_addr_hash, NULL, NULL, mono_seq_point_info_free);
@@ -3424,6 +3537,9 @@ mini_free_jit_domain_info (MonoDomain *domain)
 {
 	MonoJitDomainInfo *info = domain_jit_info (domain);
 
+	mono_tiered_free_domain (domain);
+	mono_compile_queue_free_domain (domain);
+
 	g_hash_table_foreach (info->jump_target_hash, delete_jump_list, NULL);
 	g_hash_table_destroy (info->jump_target_hash);
 	if (info->jump_target_got_slot_hash) {
@@ -3438,7 +3554,7 @@ mini_free_jit_domain_info (MonoDomain *domain)
 		g_hash_table_destroy (info->method_code_hash);
 	g_hash_table_destroy (info->jump_trampoline_hash);
 	g_hash_table_destroy (info->jit_trampoline_hash);
-	g_hash_table_destroy (info->delegate_trampoline_hash);
+	mono_conc_hashtable_destroy (info->delegate_trampoline_hash);
 	if (info->static_rgctx_trampoline_hash)
 		g_hash_table_destroy (info->static_rgctx_trampoline_hash);
 	g_hash_table_destroy (info->llvm_vcall_trampoline_hash);
@@ -3449,6 +3565,8 @@ mini_free_jit_domain_info (MonoDomain *domain)
 		mono_debugger_agent_free_domain_info (domain);
 	if (info->gsharedvt_arg_tramp_hash)
 		g_hash_table_destroy (info->gsharedvt_arg_tramp_hash);
+	if (info->gsharedvt_call_info_hash)
+		g_hash_table_destroy (info->gsharedvt_call_info_hash);
 	if (info->llvm_jit_callees) {
 		g_hash_table_foreach (info->llvm_jit_callees, free_jit_callee_list, NULL);
 		g_hash_table_destroy (info->llvm_jit_callees);
@@ -3505,9 +3623,13 @@ mini_init (const char *filename, const char *runtime_version)
 	MonoDomain *domain;
 	MonoRuntimeCallbacks callbacks;
 	MonoThreadInfoRuntimeCallbacks ticallbacks;
+	MonoStartupTraceStamp trace_stamp;
 
 	MONO_VES_INIT_BEGIN ();
 
+	if (mono_startup_trace_enabled)
+		mono_startup_trace_begin (MONO_STARTUP_RUNTIME_INIT, &trace_stamp);
+
 	CHECKED_MONO_INIT ();
 
 #if defined(__linux__) && !defined(__native_client__)
@@ -3559,6 +3681,7 @@ mini_init (const char *filename, const char *runtime_version)
 	callbacks.get_vtable_trampoline = mini_get_vtable_trampoline;
 	callbacks.get_imt_trampoline = mini_get_imt_trampoline;
 	callbacks.imt_entry_inited = mini_imt_entry_inited;
+	callbacks.get_imt_slot_methods = mono_aot_get_imt_slot_methods;
 	callbacks.init_delegate = mini_init_delegate;
 #define JIT_INVOKE_WORKS
 #ifdef JIT_INVOKE_WORKS
@@ -3590,6 +3713,11 @@ mini_init (const char *filename, const char *runtime_version)
 	if (g_getenv ("MONO_DEBUG") != NULL)
 		mini_parse_debug_options ();
 
+#ifndef DISABLE_REMOTING
+	if (g_getenv ("MONO_NO_REMOTING"))
+		mono_remoting_in_use = FALSE;
+#endif
+
 	mono_code_manager_init ();
 
 	mono_hwcap_init ();
@@ -3696,6 +3824,11 @@ mini_init (const char *filename, const char *runtime_version)
 
 	register_jit_stats ();
 
+	if (mono_tiered_enabled)
+		mono_tiered_init (default_opt);
+	mono_compile_queue_init (default_opt);
+	mono_startup_snapshot_init ();
+
 #define JIT_CALLS_WORK
 #ifdef JIT_CALLS_WORK
 	/* Needs to be called here since register_jit_icall depends on it */
@@ -3731,11 +3864,17 @@ mini_init (const char *filename, const char *runtime_version)
 	mono_thread_attach (domain);
 #endif
 
+	if (g_getenv ("MONO_COUNTERS_SHM"))
+		mono_counters_shm_start (atoi (g_getenv ("MONO_COUNTERS_SHM")));
+
 	if (mono_profiler_get_events () & MONO_PROFILE_STATISTICAL)
 		mono_runtime_setup_stat_profiler ();
 
 	mono_profiler_runtime_initialized ();
 
+	if (mono_startup_trace_enabled)
+		mono_startup_trace_end (MONO_STARTUP_RUNTIME_INIT, &trace_stamp, "mini_init");
+
 	MONO_VES_INIT_END ();
 
 	return domain;
@@ -3972,8 +4111,19 @@ register_icalls (void)
 	register_icall (mono_object_castclass_with_cache, "mono_object_castclass_with_cache", "object object ptr ptr", FALSE);
 	register_icall (mono_object_isinst_with_cache, "mono_object_isinst_with_cache", "object object ptr ptr", FALSE);
 	register_icall (mono_generic_class_init, "mono_generic_class_init", "void ptr", FALSE);
+#ifdef MONO_ARCH_HAVE_PATCHABLE_CLASS_INIT
+	register_icall (mono_generic_class_init_patch, "mono_generic_class_init_patch", "void ptr ptr ptr", FALSE);
+#endif
+	register_icall (mono_tiered_promote, "mono_tiered_promote", "void ptr", FALSE);
+	register_icall (mono_tiered_osr_get_code, "mono_tiered_osr_get_code", "ptr ptr int32", FALSE);
+	register_icall (mono_tiered_osr_set_state, "mono_tiered_osr_set_state", "void ptr", TRUE);
+	register_icall (mono_tiered_osr_take_state, "mono_tiered_osr_take_state", "ptr", TRUE);
 	register_icall (mono_fill_class_rgctx, "mono_fill_class_rgctx", "ptr ptr int", FALSE);
 	register_icall (mono_fill_method_rgctx, "mono_fill_method_rgctx", "ptr ptr int", FALSE);
+	register_icall (mono_rgctx_ic_update, "mono_rgctx_ic_update", "void ptr ptr ptr", TRUE);
+	register_icall (mono_iface_ic_update, "mono_iface_ic_update", "void ptr object ptr", FALSE);
+	register_icall (mono_gvm_ic_update, "mono_gvm_ic_update", "void ptr object ptr", FALSE);
+	register_icall (mono_get_create_instance_code, "mono_get_create_instance_code", "ptr ptr", FALSE);
 
 	register_icall (mono_debugger_agent_user_break, "mono_debugger_agent_user_break", "void", FALSE);
 
@@ -3997,6 +4147,7 @@ register_icalls (void)
 
 	register_icall_with_wrapper (mono_monitor_enter, "mono_monitor_enter", "void obj");
 	register_icall_with_wrapper (mono_monitor_enter_v4, "mono_monitor_enter_v4", "void obj ptr");
+	register_icall_with_wrapper (mono_monitor_exit, "mono_monitor_exit", "void obj");
 	register_icall_no_wrapper (mono_monitor_enter_fast, "mono_monitor_enter_fast", "int obj");
 	register_icall_no_wrapper (mono_monitor_enter_v4_fast, "mono_monitor_enter_v4_fast", "int obj ptr");
 
@@ -4047,12 +4198,87 @@ print_jit_stats (void)
 		g_print ("JIT info table inserts: %ld\n", mono_stats.jit_info_table_insert_count);
 		g_print ("JIT info table removes: %ld\n", mono_stats.jit_info_table_remove_count);
 		g_print ("JIT info table lookups: %ld\n", mono_stats.jit_info_table_lookup_count);
+		g_print ("JIT info table cache hits: %ld\n", mono_stats.jit_info_table_cache_hit_count);
 
 		g_free (mono_jit_stats.max_ratio_method);
 		mono_jit_stats.max_ratio_method = NULL;
 		g_free (mono_jit_stats.biggest_method);
 		mono_jit_stats.biggest_method = NULL;
 	}
+
+	mono_jit_stats_print_top ();
+}
+
+typedef struct {
+	MonoImage *image;
+	guint32 mempool_size, vtables_size, jit_code_size, aot_code_size, total;
+	int num_classes;
+} ImageMemoryStats;
+
+static void
+collect_image_memory_stats (gpointer data, gpointer user_data)
+{
+	MonoAssembly *assembly = (MonoAssembly *)data;
+	GPtrArray *all_stats = (GPtrArray *)user_data;
+	MonoImage *image = assembly->image;
+	ImageMemoryStats *stats;
+
+	if (!image)
+		return;
+
+	stats = g_new0 (ImageMemoryStats, 1);
+	stats->image = image;
+	stats->mempool_size = mono_mempool_get_allocated (image->mempool);
+	stats->vtables_size = image->vtables_size;
+	stats->jit_code_size = image->jit_code_size;
+	stats->aot_code_size = mono_aot_get_image_code_size (image);
+	stats->num_classes = image->class_cache.num_entries;
+	stats->total = stats->mempool_size + stats->vtables_size + stats->jit_code_size + stats->aot_code_size;
+	g_ptr_array_add (all_stats, stats);
+}
+
+static int
+compare_image_memory_stats (gconstpointer a, gconstpointer b)
+{
+	const ImageMemoryStats *stats1 = *(const ImageMemoryStats **)a;
+	const ImageMemoryStats *stats2 = *(const ImageMemoryStats **)b;
+
+	if (stats1->total == stats2->total)
+		return 0;
+	return stats1->total < stats2->total ? 1 : -1;
+}
+
+/*
+ * print_image_memory_stats:
+ *
+ *   Print the memory used for each loaded assembly, largest first, for --stats=memory.
+ * The mempool of an image contains its classes, methods and other metadata structures,
+ * the vtables and the JIT code are allocated from the domains.
+ */
+static void
+print_image_memory_stats (void)
+{
+	GPtrArray *all_stats;
+	int i;
+
+	if (!mono_jit_stats.memory_report)
+		return;
+
+	all_stats = g_ptr_array_new ();
+	mono_loader_lock ();
+	mono_assembly_foreach (collect_image_memory_stats, all_stats);
+	mono_loader_unlock ();
+	g_ptr_array_sort (all_stats, compare_image_memory_stats);
+
+	g_print ("\nMemory usage by image (bytes)\n");
+	g_print ("%10s %10s %8s %10s %10s %10s  %s\n", "Total", "Mempool", "Classes", "VTables", "JIT code", "AOT code", "Image");
+	for (i = 0; i < all_stats->len; ++i) {
+		ImageMemoryStats *stats = (ImageMemoryStats *)g_ptr_array_index (all_stats, i);
+
+		g_print ("%10u %10u %8d %10u %10u %10u  %s\n", stats->total, stats->mempool_size, stats->num_classes, stats->vtables_size, stats->jit_code_size, stats->aot_code_size, stats->image->name ? stats->image->name : stats->image->module_name);
+		g_free (stats);
+	}
+	g_ptr_array_free (all_stats, TRUE);
 }
 
 void
@@ -4073,8 +4299,11 @@ mini_cleanup (MonoDomain *domain)
 	mono_domain_finalize (domain, 2000);
 #endif
 
-	/* This accesses metadata so needs to be called before runtime shutdown */
+	/* These access metadata so need to be called before runtime shutdown */
+	mono_startup_snapshot_cleanup ();
+	mono_counters_shm_stop ();
 	print_jit_stats ();
+	print_image_memory_stats ();
 
 #ifndef MONO_CROSS_COMPILE
 	mono_runtime_cleanup (domain);
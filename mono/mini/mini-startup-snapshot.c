@@ -0,0 +1,246 @@
+/*
+ * mini-startup-snapshot.c: Replay the loaded assemblies and initialized classes of a previous run
+ *
+ * With --startup-snapshot=FILE, if FILE doesn't exist, the assemblies loaded by the
+ * process and the classes which were initialized in them are written to FILE at
+ * shutdown, or after the number of seconds given by --startup-snapshot-delay=N, which
+ * allows capturing the state of a long running process after its warm-up.
+ * If FILE exists, a background thread loads the same assemblies and initializes the
+ * same classes at startup, in the order they are listed, concurrently with the main
+ * thread, which finds them already loaded. Delete the file to record a new snapshot.
+ *
+ * The snapshot only contains the names of the assemblies and the tokens of the classes,
+ * not the runtime data structures themselves, since those point into the heap and the
+ * metadata of the images, and they are recreated by the normal code paths. Class
+ * constructors are not run by the background thread.
+ *
+ * The file format is line based:
+ * #VER:1
+ * A <path of the assembly>
+ * C <token of a class in the preceding assembly, in hex>
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <mono/metadata/appdomain.h>
+#include <mono/metadata/assembly.h>
+#include <mono/metadata/class-internals.h>
+#include <mono/metadata/metadata-internals.h>
+#include <mono/metadata/tabledefs.h>
+#include <mono/metadata/threads-types.h>
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-threads.h>
+
+#include "mini.h"
+
+#define SNAPSHOT_VERSION_LINE "#VER:1\n"
+
+static char *snapshot_file;
+static int snapshot_delay;
+/* Whenever the snapshot is replayed instead of being recorded */
+static gboolean replaying;
+
+static gint32 thread_started;
+static gint32 snapshot_written;
+
+static gint32 replayed_assemblies;
+static gint32 replayed_classes;
+
+/*
+ * mono_startup_snapshot_set_file:
+ *
+ *   Record the startup state into FILE, or replay it from FILE if it exists.
+ */
+void
+mono_startup_snapshot_set_file (const char *file)
+{
+	snapshot_file = g_strdup (file);
+}
+
+/*
+ * mono_startup_snapshot_set_delay:
+ *
+ *   Record the snapshot SECONDS seconds after startup instead of at shutdown.
+ */
+void
+mono_startup_snapshot_set_delay (int seconds)
+{
+	snapshot_delay = seconds;
+}
+
+static void
+write_assembly (gpointer data, gpointer user_data)
+{
+	MonoAssembly *assembly = (MonoAssembly *)data;
+	FILE *outfile = (FILE *)user_data;
+	MonoImage *image = assembly->image;
+	int i, rows;
+
+	if (!image || image_is_dynamic (image) || assembly->ref_only || !image->name)
+		return;
+
+	fprintf (outfile, "A %s\n", image->name);
+
+	rows = image->tables [MONO_TABLE_TYPEDEF].rows;
+	for (i = 1; i <= rows; ++i) {
+		guint32 token = MONO_TOKEN_TYPE_DEF | i;
+		MonoClass *klass;
+
+		/* Only look at the classes which are already created */
+		klass = (MonoClass *)mono_internal_hash_table_lookup (&image->class_cache, GUINT_TO_POINTER (token));
+		if (klass && klass->inited && !mono_class_has_failure (klass))
+			fprintf (outfile, "C %x\n", token);
+	}
+}
+
+static void
+write_snapshot (void)
+{
+	FILE *outfile;
+	char *tmp_name;
+
+	if (InterlockedCompareExchange (&snapshot_written, TRUE, FALSE) != FALSE)
+		return;
+
+	/* Write to a temporary file first, so a partial snapshot is never replayed */
+	tmp_name = g_strdup_printf ("%s.tmp", snapshot_file);
+	outfile = fopen (tmp_name, "w");
+	if (!outfile) {
+		g_warning ("Unable to create startup snapshot file '%s'.", tmp_name);
+		g_free (tmp_name);
+		return;
+	}
+
+	fputs (SNAPSHOT_VERSION_LINE, outfile);
+	/* The class caches are modified with the loader lock held */
+	mono_loader_lock ();
+	mono_assembly_foreach (write_assembly, outfile);
+	mono_loader_unlock ();
+
+	if (fclose (outfile) != 0 || rename (tmp_name, snapshot_file) != 0) {
+		g_warning ("Unable to write startup snapshot file '%s'.", snapshot_file);
+		unlink (tmp_name);
+	}
+	g_free (tmp_name);
+}
+
+static void
+replay_snapshot (void)
+{
+	MonoImage *image = NULL;
+	char line [4096];
+	FILE *infile;
+
+	infile = fopen (snapshot_file, "r");
+	if (!infile)
+		return;
+
+	if (!fgets (line, sizeof (line), infile) || strcmp (line, SNAPSHOT_VERSION_LINE) != 0) {
+		g_warning ("Ignoring startup snapshot file '%s' with an unknown format.", snapshot_file);
+		fclose (infile);
+		return;
+	}
+
+	while (fgets (line, sizeof (line), infile) && !mono_runtime_is_shutting_down ()) {
+		/* Kill the newline */
+		if (strlen (line) > 0 && line [strlen (line) - 1] == '\n')
+			line [strlen (line) - 1] = '\0';
+
+		if (line [0] == 'A' && line [1] == ' ') {
+			MonoImageOpenStatus status;
+			MonoAssembly *assembly;
+
+			assembly = mono_assembly_open_full (line + 2, &status, FALSE);
+			image = assembly ? mono_assembly_get_image (assembly) : NULL;
+			if (image)
+				InterlockedIncrement (&replayed_assemblies);
+		} else if (line [0] == 'C' && line [1] == ' ' && image) {
+			MonoError error;
+			MonoClass *klass;
+			guint32 token = strtoul (line + 2, NULL, 16);
+
+			if (mono_metadata_token_table (token) != MONO_TABLE_TYPEDEF || mono_metadata_token_index (token) > image->tables [MONO_TABLE_TYPEDEF].rows)
+				continue;
+			klass = mono_class_get_checked (image, token, &error);
+			if (!klass) {
+				mono_error_cleanup (&error);
+				continue;
+			}
+			if (mono_class_init (klass))
+				InterlockedIncrement (&replayed_classes);
+		}
+	}
+	fclose (infile);
+}
+
+static guint32
+snapshot_thread (gpointer unused)
+{
+	MonoError error;
+
+	mono_thread_set_name_internal (mono_thread_internal_current (), mono_string_new (mono_get_root_domain (), "Startup snapshot"), FALSE, &error);
+	mono_error_assert_ok (&error);
+
+	if (replaying) {
+		replay_snapshot ();
+	} else {
+		mono_thread_info_sleep (snapshot_delay * 1000, NULL);
+		if (!mono_runtime_is_shutting_down ())
+			write_snapshot ();
+	}
+
+	return 0;
+}
+
+static void
+startup_snapshot_assembly_loaded (MonoAssembly *assembly, gpointer user_data)
+{
+	MonoError error;
+
+	/* Threads can't be created before the runtime is up, start it on the first load after that */
+	if (thread_started || !mono_thread_internal_current ())
+		return;
+	if (InterlockedCompareExchange (&thread_started, TRUE, FALSE) != FALSE)
+		return;
+
+	/* Created as a threadpool thread so it is a background thread which doesn't keep the runtime alive */
+	if (!mono_thread_create_internal (mono_get_root_domain (), snapshot_thread, NULL, TRUE, 0, &error))
+		g_error ("startup_snapshot_assembly_loaded: mono_thread_create_internal () failed due to %s", mono_error_get_message (&error));
+}
+
+void
+mono_startup_snapshot_init (void)
+{
+	if (!snapshot_file)
+		return;
+
+	replaying = g_file_test (snapshot_file, G_FILE_TEST_EXISTS);
+
+	mono_counters_register ("Startup snapshot assemblies loaded", MONO_COUNTER_INT|MONO_COUNTER_JIT, &replayed_assemblies);
+	mono_counters_register ("Startup snapshot classes initialized", MONO_COUNTER_INT|MONO_COUNTER_JIT, &replayed_classes);
+
+	if (replaying || snapshot_delay > 0)
+		mono_install_assembly_load_hook (startup_snapshot_assembly_loaded, NULL);
+}
+
+/*
+ * mono_startup_snapshot_cleanup:
+ *
+ *   Called at shutdown, while metadata can still be accessed.
+ */
+void
+mono_startup_snapshot_cleanup (void)
+{
+	if (!snapshot_file || replaying)
+		return;
+
+	write_snapshot ();
+}
@@ -0,0 +1,565 @@
+/*
+ * mini-tiered.c: Tiered compilation support
+ *
+ * Methods are first compiled with a minimal set of optimizations (tier 0). The tier 0
+ * code counts its invocations and the iterations of its loops, and when one of the
+ * counters runs out, the method is queued for recompilation with the full set of
+ * optimizations (tier 1) on a background thread. The tier 1 code replaces the tier 0
+ * code in the domain's jit code hash, so every call which goes through a trampoline
+ * afterwards resolves to it. The trampolines don't patch call sites and vtable slots
+ * while the target is tier 0 code, see common_call_trampoline ().
+ *
+ * The tier 0 code also counts how often each of its call sites is executed, the tier 1
+ * compilation uses the counts to decide how large the methods inlined at each call site
+ * can be, see mono_tiered_get_inline_limit (). At virtual call sites, it records whenever
+ * the calls are made on receivers of a single class, in which case the tier 1 code calls
+ * that class's implementation directly behind a vtable check, see
+ * mono_tiered_get_dominant_receiver ().
+ *
+ * A method which doesn't return, like a Main method or the loop of a worker thread, keeps
+ * running its tier 0 code after the promotion. The tier 0 code has a second counter at the
+ * loop headers where the IL stack is empty, and when it runs out, the method is compiled
+ * with all optimizations again by the running thread, with an additional entry point at
+ * the loop header (OSR code, for on-stack replacement). The tier 0 code then copies its
+ * arguments and locals to a buffer on its stack, calls the OSR code, which loads them in its
+ * own entry block and continues with the loop, and returns whatever the OSR code returns.
+ * So the transfer doesn't need to rewrite the tier 0 frame, which stays on the stack below
+ * the OSR frame until the method returns. Methods which take the address of their locals or
+ * allocate on the stack don't get OSR code, since it could see pointers to the tier 0
+ * frame, and neither do loop headers inside clauses, since the exception handling of the
+ * clauses would stay with the tier 0 frame.
+ *
+ * With --llvm, only the tier 1 code is compiled by LLVM, so LLVM doesn't slow down
+ * startup and only runs on the tiered compilation thread for the methods which are hot.
+ * Tier 0 and OSR code are always compiled by the JIT.
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <mono/metadata/appdomain.h>
+#include <mono/metadata/gc-internals.h>
+#include <mono/metadata/threads-types.h>
+#include <mono/utils/mono-counters.h>
+#include <mono/utils/mono-coop-mutex.h>
+
+#include "mini.h"
+
+gboolean mono_tiered_enabled;
+
+enum {
+	TIERED_STATE_TIER0,
+	TIERED_STATE_QUEUED,
+	TIERED_STATE_TIER1
+};
+
+/* Optimizations which are kept in tier 0 code, they are cheap and don't need global analysis */
+#define TIERED_TIER0_OPTS (MONO_OPT_PEEPHOLE | MONO_OPT_BRANCH | MONO_OPT_CFOLD | MONO_OPT_INTRINS | MONO_OPT_SHARED | MONO_OPT_AOT | MONO_OPT_GSHARED | MONO_OPT_GSHAREDVT | MONO_OPT_FLOAT32)
+/* Optimizations added on top of the default ones in tier 1 code */
+#define TIERED_TIER1_OPTS (MONO_OPT_INLINE | MONO_OPT_CONSPROP | MONO_OPT_COPYPROP | MONO_OPT_DEADCE | MONO_OPT_LINEARS | MONO_OPT_CMOV | MONO_OPT_LOOP | MONO_OPT_SSA | MONO_OPT_ABCREM | MONO_OPT_ALIAS_ANALYSIS)
+
+static int tiered_call_threshold = 30;
+static int tiered_backedge_threshold = 1000;
+static int tiered_osr_threshold = 10000;
+static guint32 tiered_tier1_opts;
+
+/* Protects the fields below */
+static MonoCoopMutex tiered_mutex;
+static MonoCoopCond tiered_cond;
+/* Maps the start of tier 0 code to its MonoTieredInfo */
+static GHashTable *tiered_code_hash;
+static GSList *tiered_queue;
+static gboolean tiered_thread_started;
+/* The domain of the method being compiled by the tiered compilation thread */
+static MonoDomain *tiered_compiling_domain;
+
+static gint32 tier0_methods;
+static gint32 tier1_methods;
+static gint32 tier1_failed;
+static gint32 osr_methods;
+static gint32 osr_failed;
+
+/*
+ * mono_tiered_enable:
+ *
+ *   Enable tiered compilation. OPTIONS is NULL or has the form <calls>[,<backedges>[,<osr>]],
+ * the number of calls and loop iterations after which a method is recompiled with all
+ * optimizations, and the number of loop iterations after which a running method transfers
+ * to OSR code, 0 disables OSR.
+ */
+void
+mono_tiered_enable (const char *options)
+{
+#ifndef DISABLE_JIT
+	mono_tiered_enabled = TRUE;
+#endif
+
+	if (options) {
+		char **args = g_strsplit (options, ",", 3);
+
+		if (args [0] && atoi (args [0]) > 0)
+			tiered_call_threshold = atoi (args [0]);
+		if (args [0] && args [1] && atoi (args [1]) > 0)
+			tiered_backedge_threshold = atoi (args [1]);
+		if (args [0] && args [1] && args [2] && atoi (args [2]) >= 0)
+			tiered_osr_threshold = atoi (args [2]);
+		g_strfreev (args);
+	}
+}
+
+void
+mono_tiered_init (guint32 default_opt)
+{
+	guint32 exclude = 0;
+
+	mono_coop_mutex_init (&tiered_mutex);
+	mono_coop_cond_init (&tiered_cond);
+	tiered_code_hash = g_hash_table_new (NULL, NULL);
+
+	mono_arch_cpu_optimizations (&exclude);
+	tiered_tier1_opts = (default_opt | TIERED_TIER1_OPTS) & ~exclude;
+
+	mono_counters_register ("Tier 0 methods", MONO_COUNTER_JIT | MONO_COUNTER_INT, &tier0_methods);
+	mono_counters_register ("Tier 1 methods", MONO_COUNTER_JIT | MONO_COUNTER_INT, &tier1_methods);
+	mono_counters_register ("Tier 1 failed compilations", MONO_COUNTER_JIT | MONO_COUNTER_INT, &tier1_failed);
+	mono_counters_register ("OSR methods", MONO_COUNTER_JIT | MONO_COUNTER_INT, &osr_methods);
+	mono_counters_register ("OSR failed compilations", MONO_COUNTER_JIT | MONO_COUNTER_INT, &osr_failed);
+}
+
+/*
+ * mono_tiered_method_is_eligible:
+ *
+ *   Return whenever METHOD should be compiled as tier 0 code.
+ */
+gboolean
+mono_tiered_method_is_eligible (MonoMethod *method)
+{
+	if (!mono_tiered_enabled)
+		return FALSE;
+	if (method->wrapper_type != MONO_WRAPPER_NONE || method->dynamic)
+		return FALSE;
+	/* The tier 1 code is registered for a single method, so stay away from generic sharing */
+	if (method->is_generic || method->is_inflated || method->klass->generic_container || method->klass->generic_class)
+		return FALSE;
+	/* Breakpoints set in the tier 0 code would be lost */
+	if (mini_get_debug_options ()->gen_sdb_seq_points)
+		return FALSE;
+	if (mono_llvm_only)
+		return FALSE;
+	return TRUE;
+}
+
+guint32
+mono_tiered_get_tier0_opts (guint32 opts)
+{
+	return opts & TIERED_TIER0_OPTS;
+}
+
+MonoTieredInfo*
+mono_tiered_info_new (MonoMethod *method, MonoDomain *domain)
+{
+	MonoTieredInfo *info = g_new0 (MonoTieredInfo, 1);
+
+	info->method = method;
+	info->domain = domain;
+	info->calls = tiered_call_threshold;
+	info->backedges = tiered_backedge_threshold;
+	info->osr_backedges = tiered_osr_threshold;
+	info->state = TIERED_STATE_TIER0;
+	info->call_sites = g_hash_table_new_full (NULL, NULL, NULL, g_free);
+	info->osr_code = g_hash_table_new (NULL, NULL);
+	return info;
+}
+
+void
+mono_tiered_info_free (MonoTieredInfo *info)
+{
+	g_hash_table_destroy (info->call_sites);
+	g_hash_table_destroy (info->osr_code);
+	g_free (info);
+}
+
+/*
+ * mono_tiered_osr_enabled:
+ *
+ *   Return whenever tier 0 code should transfer to OSR code in long running loops.
+ */
+gboolean
+mono_tiered_osr_enabled (void)
+{
+	/* The buffer passing the locals is only scanned conservatively */
+	return tiered_osr_threshold > 0 && !mono_gc_precise_stack_mark_enabled ();
+}
+
+/*
+ * mono_tiered_register:
+ *
+ *   Called with the domain lock held after the tier 0 CODE described by INFO has been
+ * added to the jit code hash.
+ */
+void
+mono_tiered_register (MonoTieredInfo *info, gpointer code)
+{
+	info->code = code;
+
+	mono_coop_mutex_lock (&tiered_mutex);
+	g_hash_table_insert (tiered_code_hash, code, info);
+	mono_coop_mutex_unlock (&tiered_mutex);
+
+	InterlockedIncrement (&tier0_methods);
+}
+
+/*
+ * mono_tiered_is_tier0_code:
+ *
+ *   Return whenever CODE is tier 0 code which will be replaced later, so references to it
+ * shouldn't be patched into the caller.
+ */
+gboolean
+mono_tiered_is_tier0_code (gpointer code)
+{
+	MonoTieredInfo *info;
+
+	if (!mono_tiered_enabled)
+		return FALSE;
+
+	mono_coop_mutex_lock (&tiered_mutex);
+	info = (MonoTieredInfo *)g_hash_table_lookup (tiered_code_hash, mono_get_addr_from_ftnptr (code));
+	mono_coop_mutex_unlock (&tiered_mutex);
+
+	return info && info->state != TIERED_STATE_TIER1;
+}
+
+/*
+ * mono_tiered_lookup:
+ *
+ *   Return the MonoTieredInfo of the tier 0 code of METHOD in DOMAIN, or NULL if METHOD
+ * doesn't have tier 0 code anymore.
+ */
+MonoTieredInfo*
+mono_tiered_lookup (MonoDomain *domain, MonoMethod *method)
+{
+	MonoJitInfo *ji;
+	MonoTieredInfo *info;
+
+	if (!mono_tiered_enabled)
+		return NULL;
+
+	ji = (MonoJitInfo *)mono_lock_free_hashtable_lookup (domain->jit_code_hash, method);
+	if (!ji)
+		return NULL;
+
+	mono_coop_mutex_lock (&tiered_mutex);
+	info = (MonoTieredInfo *)g_hash_table_lookup (tiered_code_hash, ji->code_start);
+	mono_coop_mutex_unlock (&tiered_mutex);
+
+	return info;
+}
+
+/*
+ * mono_tiered_get_call_site:
+ *
+ *   Return the profile the tier 0 code described by INFO updates each time it executes
+ * the call at IL_OFFSET. Only called while the tier 0 code is being compiled.
+ */
+MonoTieredCallSite*
+mono_tiered_get_call_site (MonoTieredInfo *info, int il_offset)
+{
+	MonoTieredCallSite *site = (MonoTieredCallSite *)g_hash_table_lookup (info->call_sites, GINT_TO_POINTER (il_offset));
+
+	if (!site) {
+		site = g_new0 (MonoTieredCallSite, 1);
+		g_hash_table_insert (info->call_sites, GINT_TO_POINTER (il_offset), site);
+	}
+	return site;
+}
+
+/*
+ * mono_tiered_get_inline_limit:
+ *
+ *   Return the maximum IL size of the methods inlined at the call at IL_OFFSET, given the
+ * default LIMIT. Call sites which were executed as often as a method needs to be called
+ * to be promoted get a larger budget, call sites which were never executed by the tier 0
+ * code get a smaller one.
+ */
+int
+mono_tiered_get_inline_limit (MonoTieredInfo *info, int il_offset, int limit)
+{
+	MonoTieredCallSite *site = (MonoTieredCallSite *)g_hash_table_lookup (info->call_sites, GINT_TO_POINTER (il_offset));
+
+	if (!site)
+		return limit;
+	if (site->count == 0)
+		return limit / 2;
+	if (site->count >= (guint32)tiered_call_threshold)
+		return limit * 4;
+	return limit;
+}
+
+/*
+ * mono_tiered_get_dominant_receiver:
+ *
+ *   Return the vtable of the class of the receiver of at least 90% of the calls made by
+ * the virtual call at IL_OFFSET, if the call site is hot, NULL otherwise.
+ */
+MonoVTable*
+mono_tiered_get_dominant_receiver (MonoTieredInfo *info, int il_offset)
+{
+	MonoTieredCallSite *site = (MonoTieredCallSite *)g_hash_table_lookup (info->call_sites, GINT_TO_POINTER (il_offset));
+
+	if (!site || !site->receiver)
+		return NULL;
+	if (site->count < (guint32)tiered_call_threshold || site->receiver_misses > site->count / 10)
+		return NULL;
+	return site->receiver;
+}
+
+#ifndef DISABLE_JIT
+
+static void
+tiered_compile (MonoTieredInfo *info)
+{
+	MonoDomain *domain = info->domain;
+	MonoMethod *method = info->method;
+	MonoCompile *cfg;
+
+	/*
+	 * Class constructors are not ran from this thread, the tier 1 code checks for class
+	 * initialization itself just like AOT code.
+	 */
+	cfg = mini_method_compile (method, mono_get_optimizations_for_method (method, tiered_tier1_opts), domain, (JitFlags)0, 0, -1);
+
+	if (cfg->exception_type == MONO_EXCEPTION_NONE) {
+		mono_domain_lock (domain);
+		/* Lookups see either the tier 0 or the tier 1 code, never nothing */
+		mono_lock_free_hashtable_replace (domain->jit_code_hash, cfg->jit_info->d.method, cfg->jit_info);
+
+		mono_update_jit_stats (cfg);
+		mono_emit_jit_map (cfg->jit_info);
+		mono_domain_unlock (domain);
+
+		InterlockedIncrement (&tier1_methods);
+	} else {
+		/* Keep running the tier 0 code */
+		InterlockedIncrement (&tier1_failed);
+	}
+
+	mono_destroy_compile (cfg);
+
+	info->state = TIERED_STATE_TIER1;
+}
+
+static guint32
+tiered_compiler_thread (gpointer unused)
+{
+	MonoError error;
+	MonoTieredInfo *info;
+
+	mono_thread_set_name_internal (mono_thread_internal_current (), mono_string_new (mono_get_root_domain (), "Tiered JIT"), FALSE, &error);
+	mono_error_assert_ok (&error);
+
+	while (!mono_runtime_is_shutting_down ()) {
+		mono_coop_mutex_lock (&tiered_mutex);
+		while (!tiered_queue && !mono_runtime_is_shutting_down ())
+			mono_coop_cond_wait (&tiered_cond, &tiered_mutex);
+		if (!tiered_queue) {
+			mono_coop_mutex_unlock (&tiered_mutex);
+			break;
+		}
+		info = (MonoTieredInfo *)tiered_queue->data;
+		tiered_queue = g_slist_delete_link (tiered_queue, tiered_queue);
+		tiered_compiling_domain = info->domain;
+		mono_coop_mutex_unlock (&tiered_mutex);
+
+		if (mono_domain_set (info->domain, FALSE)) {
+			tiered_compile (info);
+			mono_domain_set (mono_get_root_domain (), TRUE);
+		}
+
+		mono_coop_mutex_lock (&tiered_mutex);
+		tiered_compiling_domain = NULL;
+		mono_coop_cond_broadcast (&tiered_cond);
+		mono_coop_mutex_unlock (&tiered_mutex);
+	}
+
+	return 0;
+}
+
+/*
+ * mono_tiered_promote:
+ *
+ *   JIT icall called by tier 0 code when one of the counters in INFO runs out. Queue the
+ * method for recompilation with all optimizations.
+ */
+void
+mono_tiered_promote (MonoTieredInfo *info)
+{
+	MonoError error;
+	gboolean start_thread = FALSE;
+
+	/* The counters are updated without atomics, so this can be reached more than once */
+	info->calls = G_MAXINT32;
+	info->backedges = G_MAXINT32;
+
+	if (InterlockedCompareExchange (&info->state, TIERED_STATE_QUEUED, TIERED_STATE_TIER0) != TIERED_STATE_TIER0)
+		return;
+
+	mono_coop_mutex_lock (&tiered_mutex);
+	tiered_queue = g_slist_append (tiered_queue, info);
+	if (!tiered_thread_started) {
+		tiered_thread_started = TRUE;
+		start_thread = TRUE;
+	}
+	mono_coop_cond_broadcast (&tiered_cond);
+	mono_coop_mutex_unlock (&tiered_mutex);
+
+	/* Created as a threadpool thread so it is a background thread which doesn't keep the runtime alive */
+	if (start_thread && !mono_thread_create_internal (mono_get_root_domain (), tiered_compiler_thread, NULL, TRUE, 0, &error))
+		g_error ("mono_tiered_promote: mono_thread_create_internal () failed due to %s", mono_error_get_message (&error));
+}
+
+/*
+ * mono_tiered_osr_get_code:
+ *
+ *   JIT icall called by tier 0 code when the OSR counter in INFO runs out at the loop
+ * header at IL_OFFSET. Return the OSR code entered at IL_OFFSET, compiling it first if
+ * needed, or NULL if it is not available, in which case the tier 0 code keeps running.
+ */
+gpointer
+mono_tiered_osr_get_code (MonoTieredInfo *info, int il_offset)
+{
+	MonoMethod *method = info->method;
+	MonoCompile *cfg;
+	gpointer code;
+
+	/* Asked again after the next round of iterations if the code is not available */
+	info->osr_backedges = tiered_osr_threshold;
+
+	mono_coop_mutex_lock (&tiered_mutex);
+	if (g_hash_table_lookup_extended (info->osr_code, GINT_TO_POINTER (il_offset), NULL, &code)) {
+		mono_coop_mutex_unlock (&tiered_mutex);
+		return code;
+	}
+	if (info->osr_compiling) {
+		mono_coop_mutex_unlock (&tiered_mutex);
+		return NULL;
+	}
+	info->osr_compiling = TRUE;
+	mono_coop_mutex_unlock (&tiered_mutex);
+
+	/* New calls of the method don't need OSR */
+	mono_tiered_promote (info);
+
+	cfg = mini_method_compile_osr (method, mono_get_optimizations_for_method (method, tiered_tier1_opts), info->domain, il_offset);
+
+	if (cfg->exception_type == MONO_EXCEPTION_NONE) {
+		code = cfg->native_code;
+
+		mono_domain_lock (info->domain);
+		mono_update_jit_stats (cfg);
+		mono_emit_jit_map (cfg->jit_info);
+		mono_domain_unlock (info->domain);
+
+		InterlockedIncrement (&osr_methods);
+	} else {
+		code = NULL;
+		InterlockedIncrement (&osr_failed);
+	}
+
+	mono_destroy_compile (cfg);
+
+	mono_coop_mutex_lock (&tiered_mutex);
+	g_hash_table_insert (info->osr_code, GINT_TO_POINTER (il_offset), code);
+	info->osr_compiling = FALSE;
+	mono_coop_mutex_unlock (&tiered_mutex);
+
+	return code;
+}
+
+#else /* DISABLE_JIT */
+
+void
+mono_tiered_promote (MonoTieredInfo *info)
+{
+	g_assert_not_reached ();
+}
+
+gpointer
+mono_tiered_osr_get_code (MonoTieredInfo *info, int il_offset)
+{
+	g_assert_not_reached ();
+	return NULL;
+}
+
+#endif /* DISABLE_JIT */
+
+/*
+ * mono_tiered_osr_set_state:
+ *
+ *   JIT icall called by tier 0 code right before it calls OSR code, STATE points to the
+ * copies of its arguments and locals.
+ */
+void
+mono_tiered_osr_set_state (gpointer state)
+{
+	MonoJitTlsData *jit_tls = (MonoJitTlsData *)mono_native_tls_get_value (mono_jit_tls_id);
+
+	jit_tls->osr_state = state;
+}
+
+/*
+ * mono_tiered_osr_take_state:
+ *
+ *   JIT icall called by the entry block of OSR code, return the state passed to
+ * mono_tiered_osr_set_state ().
+ */
+gpointer
+mono_tiered_osr_take_state (void)
+{
+	MonoJitTlsData *jit_tls = (MonoJitTlsData *)mono_native_tls_get_value (mono_jit_tls_id);
+	gpointer state = jit_tls->osr_state;
+
+	g_assert (state);
+	jit_tls->osr_state = NULL;
+	return state;
+}
+
+static gboolean
+tiered_info_in_domain (gpointer key, gpointer value, gpointer user_data)
+{
+	MonoTieredInfo *info = (MonoTieredInfo *)value;
+
+	if (info->domain != (MonoDomain *)user_data)
+		return FALSE;
+	mono_tiered_info_free (info);
+	return TRUE;
+}
+
+/*
+ * mono_tiered_free_domain:
+ *
+ *   Forget about the tier 0 methods of DOMAIN, waiting for it to be compiled first if it is
+ * being compiled by the tiered compilation thread.
+ */
+void
+mono_tiered_free_domain (MonoDomain *domain)
+{
+	GSList *l, *next;
+
+	if (!tiered_code_hash)
+		return;
+
+	mono_coop_mutex_lock (&tiered_mutex);
+	while (tiered_compiling_domain == domain)
+		mono_coop_cond_wait (&tiered_cond, &tiered_mutex);
+	for (l = tiered_queue; l; l = next) {
+		next = l->next;
+		if (((MonoTieredInfo *)l->data)->domain == domain)
+			tiered_queue = g_slist_delete_link (tiered_queue, l);
+	}
+	g_hash_table_foreach_remove (tiered_code_hash, tiered_info_in_domain, domain);
+	mono_coop_mutex_unlock (&tiered_mutex);
+}
@@ -709,6 +709,13 @@ common_call_trampoline (mgreg_t *regs, guint8 *code, MonoMethod *m, MonoVTable *
 
 	addr = mini_add_method_trampoline (m, compiled_method, need_rgctx_tramp, need_unbox_tramp);
 
+	/*
+	 * Tier 0 code is replaced by tier 1 code later, so keep calling through the trampoline
+	 * instead of patching the caller.
+	 */
+	if (mono_tiered_is_tier0_code (compiled_method))
+		return addr;
+
 	if (generic_virtual || variant_iface) {
 		MonoMethod *target = generic_virtual ? generic_virtual : variant_iface;
 
@@ -1225,7 +1232,17 @@ mono_delegate_trampoline (mgreg_t *regs, guint8 *code, gpointer *arg, guint8* tr
 				mono_error_set_pending_exception (&error);
 				return NULL;
 			}
-			addr = mini_add_method_trampoline (method, compiled_method, need_rgctx_tramp, need_unbox_tramp);
+			if (mono_tiered_is_tier0_code (compiled_method)) {
+				/* Call through a jump trampoline so the delegate picks up the tier 1 code, and don't cache it */
+				addr = mono_create_jump_trampoline (domain, method, FALSE, &error);
+				if (!mono_error_ok (&error)) {
+					mono_error_set_pending_exception (&error);
+					return NULL;
+				}
+				enable_caching = FALSE;
+			} else {
+				addr = mini_add_method_trampoline (method, compiled_method, need_rgctx_tramp, need_unbox_tramp);
+			}
 			delegate->method_ptr = addr;
 			if (enable_caching && delegate->method_code)
 				*delegate->method_code = (guint8 *)delegate->method_ptr;
@@ -1457,8 +1474,10 @@ mono_create_jump_trampoline (MonoDomain *domain, MonoMethod *method, gboolean ad
 	 * method from its native code address, so we use the
 	 * trampoline instead.
 	 * For synchronized methods, the trampoline adds the wrapper.
+	 * Tier 0 code is replaced by tier 1 code later, the trampoline resolves to
+	 * whichever is current when it is called.
 	 */
-	if (code && !ji->has_generic_jit_info && !(method->iflags & METHOD_IMPL_ATTRIBUTE_SYNCHRONIZED))
+	if (code && !ji->has_generic_jit_info && !(method->iflags & METHOD_IMPL_ATTRIBUTE_SYNCHRONIZED) && !mono_tiered_is_tier0_code (code))
 		return code;
 
 	if (mono_llvm_only) {
@@ -1579,15 +1598,14 @@ mono_create_delegate_trampoline_info (MonoDomain *domain, MonoClass *klass, Mono
 {
 	MonoMethod *invoke;
 	MonoError error;
-	MonoDelegateTrampInfo *tramp_info;
+	MonoDelegateTrampInfo *tramp_info, *tramp_info2;
 	MonoClassMethodPair pair, *dpair;
 	guint32 code_size = 0;
 
 	pair.klass = klass;
 	pair.method = method;
-	mono_domain_lock (domain);
-	tramp_info = (MonoDelegateTrampInfo *)g_hash_table_lookup (domain_jit_info (domain)->delegate_trampoline_hash, &pair);
-	mono_domain_unlock (domain);
+	/* Called for every delegate constructed by mono_delegate_ctor (), so this doesn't take the domain lock */
+	tramp_info = (MonoDelegateTrampInfo *)mono_conc_hashtable_lookup (domain_jit_info (domain)->delegate_trampoline_hash, &pair);
 	if (tramp_info)
 		return tramp_info;
 
@@ -1611,12 +1629,12 @@ mono_create_delegate_trampoline_info (MonoDomain *domain, MonoClass *klass, Mono
 	dpair = (MonoClassMethodPair *)mono_domain_alloc0 (domain, sizeof (MonoClassMethodPair));
 	memcpy (dpair, &pair, sizeof (MonoClassMethodPair));
 
-	/* store trampoline address */
+	/* store trampoline address, another thread might have been faster */
 	mono_domain_lock (domain);
-	g_hash_table_insert (domain_jit_info (domain)->delegate_trampoline_hash, dpair, tramp_info);
+	tramp_info2 = (MonoDelegateTrampInfo *)mono_conc_hashtable_insert (domain_jit_info (domain)->delegate_trampoline_hash, dpair, tramp_info);
 	mono_domain_unlock (domain);
 
-	return tramp_info;
+	return tramp_info2 ? tramp_info2 : tramp_info;
 }
 
 static void
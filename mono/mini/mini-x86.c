@@ -799,6 +799,15 @@ mono_arch_cpu_enumerate_simd_versions (void)
 	if (mono_hwcap_x86_has_sse4a)
 		sse_opts |= SIMD_VERSION_SSE4a;
 
+	if (mono_hwcap_x86_has_avx)
+		sse_opts |= SIMD_VERSION_AVX;
+
+	if (mono_hwcap_x86_has_avx2)
+		sse_opts |= SIMD_VERSION_AVX2;
+
+	if (mono_hwcap_x86_has_avx512f && mono_hwcap_x86_has_avx512bw && mono_hwcap_x86_has_avx512vl)
+		sse_opts |= SIMD_VERSION_AVX512;
+
 	return sse_opts;
 }
 
@@ -4974,6 +4983,10 @@ mono_arch_output_basic_block (MonoCompile *cfg, MonoBasicBlock *bb)
 
 			break;
 		}
+		case OP_GC_POLL_PAGE:
+			/* Faults while a suspend is requested, see handle_polling_page_fault () */
+			x86_test_membase_imm (code, ins->sreg1, 0, 1);
+			break;
 		case OP_GC_LIVENESS_DEF:
 		case OP_GC_LIVENESS_USE:
 		case OP_GC_PARAM_SLOT_LIVENESS_DEF:
@@ -1886,6 +1886,47 @@ mono_verify_cfg (MonoCompile *cfg)
 		mono_verify_bblock (bb);
 }
 
+/* The mempools of finished compilations are kept for reuse up to this size */
+#define JIT_MEMPOOL_MAX_REUSE_SIZE (512 * 1024)
+
+/*
+ * jit_mempool_new:
+ *
+ *   Return the mempool for a new MonoCompile. Each thread keeps the mempool of its last
+ * finished compilation, reset, so most compilations don't need to malloc their IR.
+ * Compilations can nest, the nested ones get a new mempool.
+ */
+static MonoMemPool*
+jit_mempool_new (void)
+{
+	MonoJitTlsData *jit_tls = (MonoJitTlsData *)mono_native_tls_get_value (mono_jit_tls_id);
+	MonoMemPool *mp;
+
+	if (jit_tls && jit_tls->jit_mempool) {
+		mp = jit_tls->jit_mempool;
+		jit_tls->jit_mempool = NULL;
+		InterlockedIncrement (&mono_jit_stats.mempools_reused);
+		return mp;
+	}
+	return mono_mempool_new ();
+}
+
+static void
+jit_mempool_free (MonoMemPool *mp)
+{
+	MonoJitTlsData *jit_tls = (MonoJitTlsData *)mono_native_tls_get_value (mono_jit_tls_id);
+	guint32 size = mono_mempool_get_allocated (mp);
+
+	InterlockedAdd64 (&mono_jit_stats.mempool_bytes, size);
+	if (size > mono_jit_stats.max_mempool_size)
+		mono_jit_stats.max_mempool_size = size;
+
+	if (jit_tls && !jit_tls->jit_mempool)
+		jit_tls->jit_mempool = mono_mempool_reset (mp, JIT_MEMPOOL_MAX_REUSE_SIZE);
+	else
+		mono_mempool_destroy (mp);
+}
+
 // This will free many fields in cfg to save
 // memory. Note that this must be safe to call
 // multiple times. It must be idempotent. 
@@ -1903,7 +1944,7 @@ mono_empty_compile (MonoCompile *cfg)
 
 	if (cfg->mempool) {
 	//mono_mempool_stats (cfg->mempool);
-		mono_mempool_destroy (cfg->mempool);
+		jit_mempool_free (cfg->mempool);
 		cfg->mempool = NULL;
 	}
 
@@ -2367,6 +2408,10 @@ mono_codegen (MonoCompile *cfg)
 	unwindlen = mono_arch_unwindinfo_get_size (cfg->arch.unwindinfo);
 #endif
 
+	if (cfg->thunk_area)
+		/* Align the thunks so the addresses stored in them can be patched atomically */
+		cfg->code_size = ((cfg->code_size + unwindlen + sizeof (gpointer) - 1) & ~(sizeof (gpointer) - 1)) - unwindlen;
+
 	if (cfg->method->dynamic) {
 		/* Allocate the code into a separate memory pool so it can be freed */
 		cfg->dynamic_info = g_new0 (MonoJitDynamicMethodInfo, 1);
@@ -2380,6 +2425,9 @@ mono_codegen (MonoCompile *cfg)
 			code = (guint8 *)mono_domain_code_reserve (code_domain, cfg->code_size + cfg->thunk_area + unwindlen);
 		else
 			code = (guint8 *)mono_code_manager_reserve (cfg->dynamic_info->code_mp, cfg->code_size + cfg->thunk_area + unwindlen);
+	} else if (cfg->method->wrapper_type != MONO_WRAPPER_NONE) {
+		/* Keep wrappers out of the way of the method bodies, they are rarely hot */
+		code = (guint8 *)mono_domain_code_reserve_cold (code_domain, cfg->code_size + cfg->thunk_area + unwindlen);
 	} else {
 		code = (guint8 *)mono_domain_code_reserve (code_domain, cfg->code_size + cfg->thunk_area + unwindlen);
 	}
@@ -2540,6 +2588,35 @@ static void mono_bb_ordering (MonoCompile *cfg)
 	}
 }
 
+/*
+ * recompute_loop_info:
+ *
+ *   Recompute the depth first ordering, the dominators and the loops of the method
+ * after a pass added bblocks to it.
+ */
+static void
+recompute_loop_info (MonoCompile *cfg)
+{
+	MonoBasicBlock *bb;
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		bb->dfn = 0;
+		bb->df_parent = NULL;
+		bb->idom = NULL;
+		bb->dominated = NULL;
+		bb->dominators = NULL;
+		bb->dfrontier = NULL;
+		bb->loop_blocks = NULL;
+		bb->nesting = 0;
+		bb->loop_body_start = 0;
+	}
+	cfg->comp_done &= ~(MONO_COMP_DOM | MONO_COMP_IDOM | MONO_COMP_DFRONTIER | MONO_COMP_LOOPS);
+
+	mono_bb_ordering (cfg);
+	mono_compile_dominator_info (cfg, MONO_COMP_DOM | MONO_COMP_IDOM);
+	mono_compute_natural_loops (cfg);
+}
+
 static void
 mono_handle_out_of_line_bblock (MonoCompile *cfg)
 {
@@ -2971,6 +3048,19 @@ mono_create_gc_safepoint (MonoCompile *cfg, MonoBasicBlock *bblock)
 	MONO_INST_NEW (cfg, ins, OP_GC_SAFE_POINT);
 	ins->sreg1 = poll_addr->dreg;
 
+#if defined(MONO_ARCH_HAVE_GC_POLLING_PAGE) && !defined(__native_client_codegen__)
+	/*
+	 * A load from the polling page needs neither a branch nor a call, the
+	 * fault is turned into a call to mono_threads_state_poll () by the
+	 * SIGSEGV handler. AOT code keeps testing the flag since the page is
+	 * only allocated at runtime.
+	 */
+	if (mono_polling_page && !cfg->compile_aot && !COMPILE_LLVM (cfg)) {
+		poll_addr->inst_p0 = mono_polling_page;
+		ins->opcode = OP_GC_POLL_PAGE;
+	}
+#endif
+
 	 if (bblock->flags & BB_EXCEPTION_HANDLER) {
 		MonoInst *eh_op = bblock->code;
 
@@ -3178,18 +3268,19 @@ init_backend (MonoBackend *backend)
 }
 
 /*
- * mini_method_compile:
+ * method_compile:
  * @method: the method to compile
  * @opts: the optimization flags to use
  * @domain: the domain where the method will be compiled in
  * @flags: compilation flags
  * @parts: debug flag
+ * @osr_il_offset: the IL offset of the loop header entered by OSR code, or -1
  *
  * Returns: a MonoCompile* pointer. Caller must check the exception_type
  * field in the returned struct to see if compilation succeded.
  */
-MonoCompile*
-mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFlags flags, int parts, int aot_method_index)
+static MonoCompile*
+method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFlags flags, int parts, int aot_method_index, int osr_il_offset)
 {
 	MonoMethodHeader *header;
 	MonoMethodSignature *sig;
@@ -3204,6 +3295,8 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 	gboolean full_aot = (flags & JIT_FLAG_FULL_AOT) ? 1 : 0;
 	gboolean disable_direct_icalls = (flags & JIT_FLAG_NO_DIRECT_ICALLS) ? 1 : 0;
 	gboolean gsharedvt_method = FALSE;
+	MonoTieredInfo *tier0_info = NULL;
+	MonoTieredInfo *call_profile = NULL;
 #ifdef ENABLE_LLVM
 	gboolean llvm = (flags & JIT_FLAG_LLVM) ? 1 : 0;
 #endif
@@ -3256,9 +3349,17 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 	}
 
 #ifdef ENABLE_LLVM
-	try_llvm = mono_use_llvm || llvm;
+	/* With tiered compilation, LLVM only compiles the tier 1 code, see mini-tiered.c */
+	try_llvm = (mono_use_llvm && !(flags & JIT_FLAG_TIER0) && osr_il_offset == -1) || llvm;
 #endif
 
+	/* Owned by the caller, see mono_jit_compile_method_inner () */
+	if (flags & JIT_FLAG_TIER0)
+		tier0_info = mono_tiered_info_new (method, domain);
+	else if (mono_tiered_enabled)
+		/* Recompiling tier 0 code, its call site counts guide inlining */
+		call_profile = mono_tiered_lookup (domain, method);
+
  restart_compile:
 	if (method_is_gshared) {
 		method_to_compile = method;
@@ -3273,7 +3374,7 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 
 	cfg = g_new0 (MonoCompile, 1);
 	cfg->method = method_to_compile;
-	cfg->mempool = mono_mempool_new ();
+	cfg->mempool = jit_mempool_new ();
 	cfg->opt = opts;
 	cfg->prof_options = mono_profiler_get_events ();
 	cfg->run_cctors = run_cctors;
@@ -3288,6 +3389,11 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 	cfg->gen_sdb_seq_points = debug_options.gen_sdb_seq_points;
 	cfg->llvm_only = (flags & JIT_FLAG_LLVM_ONLY) != 0;
 	cfg->backend = current_backend;
+	cfg->tier0_info = tier0_info;
+	cfg->call_profile = call_profile;
+	cfg->osr_il_offset = osr_il_offset;
+	if (mono_jit_stats.report_top)
+		cfg->pass_stats = (MonoJitPassStats *)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoJitPassStats) * MONO_JIT_MAX_PASS_STATS);
 
 #ifdef PLATFORM_ANDROID
 	if (cfg->method->wrapper_type != MONO_WRAPPER_NONE) {
@@ -3585,7 +3691,9 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		return cfg;
 	}
 
+	cfg->after_method_to_ir = TRUE;
 	cfg->stat_basic_blocks += cfg->num_bblocks;
+	cfg->stat_ir_size = mono_cfg_ir_size (cfg);
 
 	if (COMPILE_LLVM (cfg)) {
 		MonoInst *ins;
@@ -3678,6 +3786,11 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		MONO_TIME_TRACK (mono_jit_stats.jit_local_alias_analysis, mono_local_alias_analysis (cfg));
 		mono_cfg_dump_ir (cfg, "local_alias_analysis");
 	}
+	/* Disable this for LLVM, which lowers switches itself */
+	if ((cfg->opt & MONO_OPT_BRANCH) && !COMPILE_LLVM (cfg)) {
+		MONO_TIME_TRACK (mono_jit_stats.jit_lower_compare_chains, mono_lower_compare_chains (cfg));
+		mono_cfg_dump_ir (cfg, "lower_compare_chains");
+	}
 	/* Disable this for LLVM to make the IR easier to handle */
 	if (!COMPILE_LLVM (cfg)) {
 		MONO_TIME_TRACK (mono_jit_stats.jit_if_conversion, mono_if_conversion (cfg));
@@ -3704,6 +3817,20 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		MONO_TIME_TRACK (mono_jit_stats.jit_compute_natural_loops, mono_compute_natural_loops (cfg));
 	}
 
+	if ((cfg->opt & MONO_OPT_VECTORIZE) && (cfg->opt & MONO_OPT_SIMD) && (cfg->comp_done & MONO_COMP_LOOPS)) {
+		if (mono_vectorize_loops (cfg)) {
+			mono_cfg_dump_ir (cfg, "vectorize_loops");
+			recompute_loop_info (cfg);
+		}
+	}
+
+	if ((cfg->opt & MONO_OPT_ABCREM) && (cfg->opt & MONO_OPT_SSA) && !cfg->disable_ssa && (cfg->flags & MONO_CFG_HAS_LDELEMA) && (cfg->comp_done & MONO_COMP_LOOPS)) {
+		if (mono_abc_version_loops (cfg)) {
+			mono_cfg_dump_ir (cfg, "abc_version_loops");
+			recompute_loop_info (cfg);
+		}
+	}
+
 	MONO_TIME_TRACK (mono_jit_stats.jit_insert_safepoints, mono_insert_safepoints (cfg));
 	mono_cfg_dump_ir (cfg, "insert_safepoints");
 
@@ -3775,6 +3902,16 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 			mono_cfg_dump_ir (cfg, "perform_abc_removal");
 		}
 
+		if (cfg->opt & MONO_OPT_ESCAPE) {
+			mono_ssa_scalar_replace (cfg);
+			mono_cfg_dump_ir (cfg, "ssa_scalar_replace");
+		}
+
+		if (cfg->opt & MONO_OPT_GVN) {
+			mono_ssa_gvn (cfg);
+			mono_cfg_dump_ir (cfg, "ssa_gvn");
+		}
+
 		MONO_TIME_TRACK (mono_jit_stats.jit_ssa_remove, mono_ssa_remove (cfg));
 		mono_cfg_dump_ir (cfg, "ssa_remove");
 		MONO_TIME_TRACK (mono_jit_stats.jit_local_cprop2, mono_local_cprop (cfg));
@@ -4017,6 +4154,7 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 		mono_jit_stats.max_ratio_method = g_strdup_printf ("%s::%s)", method->klass->name, method->name);
 	}
 	mono_jit_stats.native_code_size += cfg->code_len;
+	InterlockedAdd (&method->klass->image->jit_code_size, cfg->code_len);
 
 	if (MONO_METHOD_COMPILE_END_ENABLED ())
 		MONO_PROBE_METHOD_COMPILE_END (method, TRUE);
@@ -4026,6 +4164,25 @@ mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFl
 	return cfg;
 }
 
+MonoCompile*
+mini_method_compile (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFlags flags, int parts, int aot_method_index)
+{
+	return method_compile (method, opts, domain, flags, parts, aot_method_index, -1);
+}
+
+/*
+ * mini_method_compile_osr:
+ *
+ *   Compile METHOD for on-stack replacement: the code is entered by tier 0 code of
+ * METHOD at the loop header at IL_OFFSET, see mini-tiered.c. It is not registered in the
+ * jit code hash.
+ */
+MonoCompile*
+mini_method_compile_osr (MonoMethod *method, guint32 opts, MonoDomain *domain, int il_offset)
+{
+	return method_compile (method, opts, domain, (JitFlags)0, 0, -1, il_offset);
+}
+
 void*
 mono_arch_instrument_epilog (MonoCompile *cfg, void *func, void *p, gboolean enable_arguments)
 {
@@ -4098,6 +4255,250 @@ void mono_time_track_end (double *time, GTimer *timer)
 	g_timer_destroy (timer);
 }
 
+/*
+ * mono_cfg_ir_size:
+ *
+ *   Return the number of IR instructions in the bblocks of CFG.
+ */
+int
+mono_cfg_ir_size (MonoCompile *cfg)
+{
+	MonoBasicBlock *bb;
+	MonoInst *ins;
+	int size = 0;
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb)
+		MONO_BB_FOR_EACH_INS (bb, ins)
+			size ++;
+	return size;
+}
+
+/*
+ * mono_time_track_pass_end:
+ *
+ *   Same as mono_time_track_end (), but also record the time and the resulting IR
+ * size of the pass NAME in CFG for the --jit-stats=top report.
+ */
+void
+mono_time_track_pass_end (MonoCompile *cfg, const char *name, double *time, GTimer *timer)
+{
+	MonoJitPassStats *pass;
+	double elapsed;
+	int i;
+
+	g_timer_stop (timer);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_timer_destroy (timer);
+	*time += elapsed;
+
+	if (!cfg->pass_stats)
+		return;
+
+	/* NAME is the stringified counter, so passes can be compared by pointer */
+	for (i = 0; i < cfg->num_pass_stats; ++i) {
+		if (cfg->pass_stats [i].name == name)
+			break;
+	}
+	if (i == cfg->num_pass_stats) {
+		if (i == MONO_JIT_MAX_PASS_STATS)
+			return;
+		cfg->pass_stats [i].name = name;
+		cfg->num_pass_stats ++;
+	}
+	pass = &cfg->pass_stats [i];
+	pass->time += elapsed;
+	pass->ir_size = mono_cfg_ir_size (cfg);
+}
+
+/* The number of passes listed for each method by --jit-stats=top */
+#define JIT_TOP_PASSES 3
+
+typedef struct {
+	char *name;
+	double time;
+	int ir_size;
+	MonoJitPassStats passes [JIT_TOP_PASSES];
+} JitTopMethod;
+
+typedef struct {
+	const char *name;
+	double time;
+	int methods;
+	int max_ir_size;
+} JitPassTotal;
+
+/* Protects the state below, which is only used with --jit-stats=top */
+static mono_mutex_t jit_top_mutex;
+/* The mono_jit_stats.report_top slowest compilations, sorted by decreasing time */
+static JitTopMethod *jit_top_methods;
+static int jit_top_count;
+/* Pass name -> JitPassTotal */
+static GHashTable *jit_pass_totals;
+
+/*
+ * mono_jit_stats_enable_top:
+ *
+ *   Enable the report of the methods and the passes which took the most JIT time,
+ * printed at shutdown. OPTIONS is "top" or "top,N" where N is the number of
+ * methods to report. Return FALSE if OPTIONS is not recognized.
+ */
+gboolean
+mono_jit_stats_enable_top (const char *options)
+{
+	int count = 20;
+
+	if (strncmp (options, "top", 3) != 0)
+		return FALSE;
+	options += 3;
+	if (*options == ',') {
+		char *end;
+
+		count = strtol (options + 1, &end, 10);
+		if (*end || count <= 0)
+			return FALSE;
+	} else if (*options) {
+		return FALSE;
+	}
+
+	if (!mono_jit_stats.report_top)
+		mono_os_mutex_init (&jit_top_mutex);
+	g_free (jit_top_methods);
+	jit_top_methods = g_new0 (JitTopMethod, count);
+	jit_top_count = 0;
+	mono_jit_stats.report_top = count;
+	return TRUE;
+}
+
+static void
+jit_stats_record_top (MonoCompile *cfg)
+{
+	JitTopMethod *entry;
+	JitPassTotal *total;
+	double time = 0;
+	int i, j, pos, ir_size = cfg->stat_ir_size;
+
+	for (i = 0; i < cfg->num_pass_stats; ++i) {
+		time += cfg->pass_stats [i].time;
+		ir_size = MAX (ir_size, cfg->pass_stats [i].ir_size);
+	}
+
+	mono_os_mutex_lock (&jit_top_mutex);
+
+	if (!jit_pass_totals)
+		jit_pass_totals = g_hash_table_new (g_str_hash, g_str_equal);
+	for (i = 0; i < cfg->num_pass_stats; ++i) {
+		MonoJitPassStats *pass = &cfg->pass_stats [i];
+
+		total = (JitPassTotal *)g_hash_table_lookup (jit_pass_totals, pass->name);
+		if (!total) {
+			total = g_new0 (JitPassTotal, 1);
+			total->name = pass->name;
+			g_hash_table_insert (jit_pass_totals, (char*)pass->name, total);
+		}
+		total->time += pass->time;
+		total->methods ++;
+		total->max_ir_size = MAX (total->max_ir_size, pass->ir_size);
+	}
+
+	for (pos = jit_top_count; pos > 0 && jit_top_methods [pos - 1].time < time; --pos)
+		;
+	if (pos == mono_jit_stats.report_top) {
+		mono_os_mutex_unlock (&jit_top_mutex);
+		return;
+	}
+	if (jit_top_count == mono_jit_stats.report_top)
+		g_free (jit_top_methods [--jit_top_count].name);
+	memmove (&jit_top_methods [pos + 1], &jit_top_methods [pos], (jit_top_count - pos) * sizeof (JitTopMethod));
+	jit_top_count ++;
+
+	entry = &jit_top_methods [pos];
+	memset (entry, 0, sizeof (JitTopMethod));
+	entry->name = mono_method_full_name (cfg->method, TRUE);
+	entry->time = time;
+	entry->ir_size = ir_size;
+	/* Keep the slowest passes of the method, sorted by decreasing time */
+	for (i = 0; i < cfg->num_pass_stats; ++i) {
+		MonoJitPassStats *pass = &cfg->pass_stats [i];
+
+		for (j = JIT_TOP_PASSES; j > 0 && (!entry->passes [j - 1].name || entry->passes [j - 1].time < pass->time); --j)
+			;
+		if (j == JIT_TOP_PASSES)
+			continue;
+		memmove (&entry->passes [j + 1], &entry->passes [j], (JIT_TOP_PASSES - j - 1) * sizeof (MonoJitPassStats));
+		entry->passes [j] = *pass;
+	}
+
+	mono_os_mutex_unlock (&jit_top_mutex);
+}
+
+static const char*
+jit_pass_name (const char *name)
+{
+	/* Strip the "mono_jit_stats.jit_" from the counter names used by MONO_TIME_TRACK */
+	const char *s = strrchr (name, '.');
+
+	s = s ? s + 1 : name;
+	return g_str_has_prefix (s, "jit_") ? s + 4 : s;
+}
+
+static gint
+compare_pass_totals (gconstpointer a, gconstpointer b)
+{
+	const JitPassTotal *t1 = *(const JitPassTotal**)a;
+	const JitPassTotal *t2 = *(const JitPassTotal**)b;
+
+	return t1->time < t2->time ? 1 : (t1->time > t2->time ? -1 : 0);
+}
+
+static void
+add_pass_total (gpointer key, gpointer value, gpointer user_data)
+{
+	g_ptr_array_add ((GPtrArray*)user_data, value);
+}
+
+/*
+ * mono_jit_stats_print_top:
+ *
+ *   Print the report enabled by mono_jit_stats_enable_top ().
+ */
+void
+mono_jit_stats_print_top (void)
+{
+	GPtrArray *totals;
+	int i, j;
+
+	if (!mono_jit_stats.report_top || !jit_top_count)
+		return;
+
+	mono_os_mutex_lock (&jit_top_mutex);
+
+	g_print ("\nMethods with the most JIT time:\n");
+	g_print ("%12s %10s  %s\n", "Time (ms)", "Max IR", "Method / slowest passes");
+	for (i = 0; i < jit_top_count; ++i) {
+		JitTopMethod *entry = &jit_top_methods [i];
+
+		g_print ("%12.3f %10d  %s\n", entry->time * 1000, entry->ir_size, entry->name);
+		for (j = 0; j < JIT_TOP_PASSES && entry->passes [j].name; ++j)
+			g_print ("%12.3f %10d      %s\n", entry->passes [j].time * 1000, entry->passes [j].ir_size, jit_pass_name (entry->passes [j].name));
+	}
+
+	totals = g_ptr_array_new ();
+	if (jit_pass_totals)
+		g_hash_table_foreach (jit_pass_totals, add_pass_total, totals);
+	g_ptr_array_sort (totals, compare_pass_totals);
+
+	g_print ("\nJIT passes by time:\n");
+	g_print ("%12s %10s %10s  %s\n", "Time (ms)", "Methods", "Max IR", "Pass");
+	for (i = 0; i < totals->len; ++i) {
+		JitPassTotal *total = (JitPassTotal *)g_ptr_array_index (totals, i);
+
+		g_print ("%12.3f %10d %10d  %s\n", total->time * 1000, total->methods, total->max_ir_size, jit_pass_name (total->name));
+	}
+	g_ptr_array_free (totals, TRUE);
+
+	mono_os_mutex_unlock (&jit_top_mutex);
+}
+
 void mono_update_jit_stats (MonoCompile *cfg)
 {
 	mono_jit_stats.allocate_var += cfg->stat_allocate_var;
@@ -4108,16 +4509,32 @@ void mono_update_jit_stats (MonoCompile *cfg)
 	mono_jit_stats.regvars += cfg->stat_n_regvars;
 	mono_jit_stats.inlineable_methods += cfg->stat_inlineable_methods;
 	mono_jit_stats.inlined_methods += cfg->stat_inlined_methods;
+	mono_jit_stats.guarded_devirt_calls += cfg->stat_guarded_devirt_calls;
+	mono_jit_stats.vectorized_loops += cfg->stat_vectorized_loops;
+	mono_jit_stats.scalar_replaced_objects += cfg->stat_scalar_replaced_objects;
+	mono_jit_stats.gvn_eliminated += cfg->stat_gvn_eliminated;
+	mono_jit_stats.abc_versioned_loops += cfg->stat_abc_versioned_loops;
 	mono_jit_stats.code_reallocs += cfg->stat_code_reallocs;
+	mono_jit_stats.devirt_comparer_calls += cfg->stat_devirt_comparer_calls;
+	mono_jit_stats.rgctx_inline_caches += cfg->stat_rgctx_inline_caches;
+	mono_jit_stats.iface_inline_caches += cfg->stat_iface_inline_caches;
+	mono_jit_stats.gvm_inline_caches += cfg->stat_gvm_inline_caches;
+	mono_jit_stats.lowered_compare_chains += cfg->stat_lowered_compare_chains;
+	mono_jit_stats.ir_instructions += cfg->stat_ir_size;
+	mono_jit_stats.max_ir_instructions = MAX (cfg->stat_ir_size, mono_jit_stats.max_ir_instructions);
+
+	if (cfg->pass_stats)
+		jit_stats_record_top (cfg);
 }
 
 /*
  * mono_jit_compile_method_inner:
  *
- *   Main entry point for the JIT.
+ *   Main entry point for the JIT. FLAGS is JIT_FLAG_RUN_CCTORS or 0, in the latter
+ * case the class of METHOD is not initialized either.
  */
 gpointer
-mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, int opt, MonoError *error)
+mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, int opt, JitFlags flags, MonoError *error)
 {
 	MonoCompile *cfg;
 	gpointer code = NULL;
@@ -4127,6 +4544,7 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 	guint32 prof_options;
 	GTimer *jit_timer;
 	MonoMethod *prof_method, *shared;
+	MonoTieredInfo *tier0_info;
 
 	mono_error_init (error);
 
@@ -4248,11 +4666,17 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 		return NULL;
 	}
 
+	if (mono_tiered_method_is_eligible (method)) {
+		opt = mono_tiered_get_tier0_opts (opt);
+		flags = (JitFlags)(flags | JIT_FLAG_TIER0);
+	}
+
 	jit_timer = mono_time_track_start ();
-	cfg = mini_method_compile (method, opt, target_domain, JIT_FLAG_RUN_CCTORS, 0, -1);
+	cfg = mini_method_compile (method, opt, target_domain, flags, 0, -1);
 	mono_time_track_end (&mono_jit_stats.jit_time, jit_timer);
 
 	prof_method = cfg->method;
+	tier0_info = cfg->tier0_info;
 
 	switch (cfg->exception_type) {
 	case MONO_EXCEPTION_NONE:
@@ -4297,6 +4721,8 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 		if (cfg->prof_options & MONO_PROFILE_JIT_COMPILATION)
 			mono_profiler_method_end_jit (method, NULL, MONO_PROFILE_FAILED);
 
+		if (tier0_info)
+			mono_tiered_info_free (tier0_info);
 		mono_destroy_compile (cfg);
 		mono_error_set_exception_instance (error, ex);
 
@@ -4323,12 +4749,15 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 	}
 	if (code == NULL) {
 		/* The lookup + insert is atomic since this is done inside the domain lock */
-		mono_domain_jit_code_hash_lock (target_domain);
-		mono_internal_hash_table_insert (&target_domain->jit_code_hash, cfg->jit_info->d.method, cfg->jit_info);
-		mono_domain_jit_code_hash_unlock (target_domain);
+		mono_lock_free_hashtable_replace (target_domain->jit_code_hash, cfg->jit_info->d.method, cfg->jit_info);
 
 		code = cfg->native_code;
 
+		if (tier0_info) {
+			mono_tiered_register (tier0_info, code);
+			tier0_info = NULL;
+		}
+
 		if (cfg->gshared && mono_method_is_generic_sharable (method, FALSE))
 			mono_stats.generics_shared_methods++;
 		if (cfg->gsharedvt)
@@ -4345,6 +4774,10 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 	 */
 	mono_update_jit_stats (cfg);
 
+	/* Another thread already compiled the method, so nothing runs our tier 0 code */
+	if (tier0_info)
+		mono_tiered_info_free (tier0_info);
+
 	mono_destroy_compile (cfg);
 
 #ifndef DISABLE_JIT
@@ -4418,7 +4851,7 @@ mono_jit_compile_method_inner (MonoMethod *method, MonoDomain *target_domain, in
 		}
 	}
 
-	if (!mono_runtime_class_init_full (vtable, error))
+	if ((flags & JIT_FLAG_RUN_CCTORS) && !mono_runtime_class_init_full (vtable, error))
 		return NULL;
 	return code;
 }
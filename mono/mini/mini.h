@@ -125,7 +125,7 @@
 #endif
 
 /* Version number of the AOT file format */
-#define MONO_AOT_FILE_VERSION 137
+#define MONO_AOT_FILE_VERSION 140
 
 //TODO: This is x86/amd64 specific.
 #define mono_simd_shuffle_mask(a,b,c,d) ((a) | ((b) << 2) | ((c) << 4) | ((d) << 6))
@@ -192,6 +192,8 @@ typedef enum {
 	MONO_AOT_FILE_FLAG_LLVM_ONLY = 16,
 	MONO_AOT_FILE_FLAG_SAFEPOINTS = 32,
 	MONO_AOT_FILE_FLAG_SEPARATE_DATA = 64,
+	/* Contains the deduplicated methods of the other images, see can_dedup () in aot-compiler.c */
+	MONO_AOT_FILE_FLAG_DEDUP = 128,
 } MonoAotFileFlags;
 
 typedef enum {
@@ -345,8 +347,8 @@ typedef struct
 	GHashTable *class_init_trampoline_hash;
 	GHashTable *jump_trampoline_hash;
 	GHashTable *jit_trampoline_hash;
-	GHashTable *delegate_trampoline_hash;
-	/* Maps ClassMethodPair -> MonoDelegateTrampInfo */
+	/* Maps ClassMethodPair -> MonoDelegateTrampInfo, lookups don't need the domain lock */
+	MonoConcurrentHashTable *delegate_trampoline_hash;
 	GHashTable *static_rgctx_trampoline_hash;
 	GHashTable *llvm_vcall_trampoline_hash;
 	/* maps MonoMethod -> MonoJitDynamicMethodInfo */
@@ -363,6 +365,8 @@ typedef struct
 	GHashTable *arch_seq_points;
 	/* Maps a GSharedVtTrampInfo structure to a trampoline address */
 	GHashTable *gsharedvt_arg_tramp_hash;
+	/* Maps a GSharedVtTrampInfo structure without an address to a GSharedVtCallInfo */
+	GHashTable *gsharedvt_call_info_hash;
 	/* memcpy/bzero methods specialized for small constant sizes */
 	gpointer *memcpy_addr [17];
 	gpointer *bzero_addr [17];
@@ -389,6 +393,34 @@ typedef struct {
 	GSList *list;
 } MonoJumpList;
 
+/* Per-method state of tiered compilation, see mini-tiered.c */
+typedef struct {
+	MonoMethod *method;
+	MonoDomain *domain;
+	/* Counted down by the tier 0 code on entry and at loop headers, the method is promoted when one drops below zero */
+	gint32 calls;
+	gint32 backedges;
+	gint32 state;
+	/* Counted down at the loop headers where the tier 0 code can transfer to OSR code */
+	gint32 osr_backedges;
+	/* The tier 0 code */
+	gpointer code;
+	/* Maps the IL offsets of the calls made by the method to their MonoTieredCallSite */
+	GHashTable *call_sites;
+	/* Maps IL offsets of loop headers to the OSR code entered there, NULL if it couldn't be compiled */
+	GHashTable *osr_code;
+	/* Whenever a thread is compiling OSR code for the method */
+	gboolean osr_compiling;
+} MonoTieredInfo;
+
+/* Profile of a call site in tier 0 code */
+typedef struct {
+	guint32 count;
+	/* For virtual calls, the vtable of the first receiver, and the number of calls made on other receivers */
+	MonoVTable *receiver;
+	guint32 receiver_misses;
+} MonoTieredCallSite;
+
 /* Arch-specific */
 typedef struct {
 	int dummy;
@@ -769,7 +801,9 @@ enum {
 	BB_EXCEPTION_UNSAFE     = 1 << 3,
 	BB_EXCEPTION_HANDLER    = 1 << 4,
 	/* for Native Client, mark the blocks that can be jumped to indirectly */
-	BB_INDIRECT_JUMP_TARGET = 1 << 5 
+	BB_INDIRECT_JUMP_TARGET = 1 << 5,
+	/* the target of a backward branch in the IL code */
+	BB_BACKWARD_BRANCH_TARGET = 1 << 6
 };
 
 typedef struct MonoMemcpyArgs {
@@ -1191,6 +1225,24 @@ typedef struct {
 	 * The calling assembly in llvmonly mode.
 	 */
 	MonoImage *calling_image;
+
+	/*
+	 * The locals of the tier 0 frame transferring to OSR code, see mini-tiered.c.
+	 */
+	gpointer osr_state;
+
+	/*
+	 * The mempool of the last compilation finished by this thread, kept for reuse.
+	 */
+	MonoMemPool *jit_mempool;
+
+	/*
+	 * The single step trampoline checked by the sequence points of the JITted code
+	 * running on this thread, see mono_arch_start_single_stepping_thread ().
+	 */
+	gpointer ss_trampoline;
+	/* Whenever single stepping is enabled for this thread only */
+	gboolean thread_single_stepping;
 } MonoJitTlsData;
 
 /*
@@ -1372,6 +1424,19 @@ typedef struct MonoJumpInfoImtTramp {
 
 typedef struct MonoJumpInfoGSharedVtCall MonoJumpInfoGSharedVtCall;
 
+/*
+ * The time spent in a pass of a single compilation and the number of IR
+ * instructions after it, recorded by MONO_TIME_TRACK for --jit-stats=top.
+ */
+typedef struct {
+	const char *name;
+	double time;
+	int ir_size;
+} MonoJitPassStats;
+
+/* Passes beyond this number are not recorded in MonoCompile.pass_stats */
+#define MONO_JIT_MAX_PASS_STATS 64
+
 /*
  * Represents the method which is called when a virtual call is made to METHOD
  * on a receiver of type KLASS.
@@ -1436,6 +1501,46 @@ struct MonoJumpInfoRgctxEntry {
 	MonoRgctxInfoType info_type;
 };
 
+/* A (rgctx, value) pair cached by an RGCTX fetch inline cache, immutable once published */
+typedef struct {
+	gpointer rgctx;
+	gpointer value;
+} MonoRgctxInlineCacheEntry;
+
+/*
+ * The per call site state of an RGCTX fetch inline cache. ENTRY is replaced as a
+ * whole, so the generated code never sees the value of a different rgctx.
+ */
+typedef struct {
+	MonoRgctxInlineCacheEntry *entry;
+	gint32 updates;
+} MonoRgctxInlineCache;
+
+/* Call sites which see more rgctx's stop updating their inline cache after this many misses */
+#define MONO_RGCTX_IC_MAX_UPDATES 4
+
+/* A (vtable, code) pair cached by an interface call inline cache, immutable once published */
+typedef struct {
+	MonoVTable *vtable;
+	gpointer code;
+} MonoIfaceInlineCacheEntry;
+
+/* Number of receiver vtables an interface call inline cache can hold */
+#define MONO_IFACE_IC_SIZE 4
+
+/*
+ * The per call site state of a polymorphic interface or generic virtual call inline
+ * cache. ENTRIES are filled in order, so the generated code can stop at the first
+ * empty entry.
+ */
+typedef struct {
+	MonoIfaceInlineCacheEntry *entries [MONO_IFACE_IC_SIZE];
+	gint32 updates;
+} MonoIfaceInlineCache;
+
+/* Call sites which miss this many times are megamorphic and only use the IMT thunk */
+#define MONO_IFACE_IC_MAX_UPDATES (MONO_IFACE_IC_SIZE * 2)
+
 /* Contains information about a gsharedvt call */
 struct MonoJumpInfoGSharedVtCall {
 	/* The original signature of the call */
@@ -1517,7 +1622,9 @@ typedef enum {
 	/* Whenever to compile in llvm-only mode */
 	JIT_FLAG_LLVM_ONLY = (1 << 6),
 	/* Whenever calls to pinvoke functions are made directly */
-	JIT_FLAG_DIRECT_PINVOKE = (1 << 7)
+	JIT_FLAG_DIRECT_PINVOKE = (1 << 7),
+	/* Whenever to compile tier 0 code, see mini-tiered.c */
+	JIT_FLAG_TIER0 = (1 << 8)
 } JitFlags;
 
 /* Bit-fields in the MonoBasicBlock.region */
@@ -1574,6 +1681,11 @@ typedef struct {
 	/* unsigned char   *cil_code; */
 	MonoMethod      *inlined_method; /* the method which is currently inlined */
 	MonoInst        *domainvar; /* a cache for the current domain */
+	MonoTieredInfo  *tier0_info; /* set when compiling tier 0 code */
+	MonoTieredInfo  *call_profile; /* the counters of the tier 0 code of the method, if any */
+	int              osr_il_offset; /* the IL offset of the loop header entered by OSR code, or -1 */
+	MonoInst        *default_comparer; /* the result of the last EqualityComparer<T>.Default call with a known class */
+	MonoClass       *default_comparer_class; /* the class of default_comparer */
 	MonoInst        *got_var; /* Global Offset Table variable */
 	MonoInst        **locals;
 	MonoInst	*rgctx_var; /* Runtime generic context variable (for static generic methods) */
@@ -1707,6 +1819,9 @@ typedef struct {
 	guint            uses_rgctx_reg : 1;
 	guint            uses_vtable_reg : 1;
 	guint            uses_simd_intrinsics : 1;
+	guint            after_method_to_ir : 1; /* no new bblocks can be created by the IR emitting code */
+	/* Set by the vectorizer when it emits 256 bit vector ops */
+	guint            uses_simd256 : 1;
 	guint            keep_cil_nops : 1;
 	guint            gen_seq_points : 1;
 	/* Generate seq points for use by the debugger */
@@ -1882,7 +1997,21 @@ typedef struct {
 	int stat_n_regvars;
 	int stat_inlineable_methods;
 	int stat_inlined_methods;
+	int stat_guarded_devirt_calls;
+	int stat_vectorized_loops;
+	int stat_scalar_replaced_objects;
+	int stat_gvn_eliminated;
+	int stat_abc_versioned_loops;
 	int stat_code_reallocs;
+	int stat_devirt_comparer_calls;
+	int stat_rgctx_inline_caches;
+	int stat_iface_inline_caches;
+	int stat_gvm_inline_caches;
+	int stat_lowered_compare_chains;
+	int stat_ir_size; /* number of IR instructions after mono_method_to_ir () */
+	/* Per pass time and IR size of this compilation, only set with --jit-stats=top */
+	MonoJitPassStats *pass_stats;
+	int num_pass_stats;
 } MonoCompile;
 
 typedef enum {
@@ -1912,6 +2041,11 @@ typedef struct {
 	gint32 allocated_seq_points_size;
 	gint32 inlineable_methods;
 	gint32 inlined_methods;
+	gint32 guarded_devirt_calls;
+	gint32 vectorized_loops;
+	gint32 scalar_replaced_objects;
+	gint32 gvn_eliminated;
+	gint32 abc_versioned_loops;
 	gint32 basic_blocks;
 	gint32 max_basic_blocks;
 	gint32 locals_stack_size;
@@ -1922,6 +2056,22 @@ typedef struct {
 	gint32 loads_eliminated;
 	gint32 stores_eliminated;
 	gint32 optimized_divisions;
+	gint64 mempool_bytes;
+	gint32 max_mempool_size;
+	gint32 mempools_reused;
+	gint64 ir_instructions;
+	gint32 max_ir_instructions;
+	gint32 devirt_comparer_calls;
+	gint32 rgctx_inline_caches;
+	gint32 iface_inline_caches;
+	gint32 iface_ic_hits;
+	gint32 iface_ic_misses;
+	gint32 iface_ic_megamorphic_misses;
+	gint32 gvm_inline_caches;
+	gint32 gvm_ic_hits;
+	gint32 gvm_ic_misses;
+	gint32 gvm_ic_megamorphic_misses;
+	gint32 lowered_compare_chains;
 	int methods_with_llvm;
 	int methods_without_llvm;
 	char *max_ratio_method;
@@ -1937,6 +2087,7 @@ typedef struct {
 	double jit_handle_global_vregs;
 	double jit_local_deadce;
 	double jit_local_alias_analysis;
+	double jit_lower_compare_chains;
 	double jit_if_conversion;
 	double jit_bb_ordering;
 	double jit_compile_dominator_info;
@@ -1966,6 +2117,10 @@ typedef struct {
 	double jit_save_seq_point_info;
 	double jit_time;
 	gboolean enabled;
+	/* Number of entries of the --jit-stats=top report, 0 if disabled */
+	int report_top;
+	/* Whenever the per image memory report of --stats=memory is enabled */
+	gboolean memory_report;
 } MonoJitStats;
 
 extern MonoJitStats mono_jit_stats;
@@ -1994,6 +2149,7 @@ enum {
 #define OP_PADD_IMM OP_LADD_IMM
 #define OP_PSUB_IMM OP_LSUB_IMM
 #define OP_PAND_IMM OP_LAND_IMM
+#define OP_PSHR_UN_IMM OP_LSHR_UN_IMM
 #define OP_PXOR_IMM OP_LXOR_IMM
 #define OP_PSUB OP_LSUB
 #define OP_PMUL OP_LMUL
@@ -2020,6 +2176,7 @@ enum {
 #define OP_PADD_IMM OP_IADD_IMM
 #define OP_PSUB_IMM OP_ISUB_IMM
 #define OP_PAND_IMM OP_IAND_IMM
+#define OP_PSHR_UN_IMM OP_ISHR_UN_IMM
 #define OP_PXOR_IMM OP_IXOR_IMM
 #define OP_PSUB OP_ISUB
 #define OP_PMUL OP_IMUL
@@ -2379,6 +2536,7 @@ void      mono_remove_bblock                (MonoCompile *cfg, MonoBasicBlock *b
 void      mono_nullify_basic_block          (MonoBasicBlock *bb);
 void      mono_merge_basic_blocks           (MonoCompile *cfg, MonoBasicBlock *bb, MonoBasicBlock *bbn);
 void      mono_optimize_branches            (MonoCompile *cfg);
+void      mono_lower_compare_chains         (MonoCompile *cfg);
 
 void      mono_blockset_print               (MonoCompile *cfg, MonoBitSet *set, const char *name, guint idom);
 const char*mono_ji_type_to_string           (MonoJumpInfoType type);
@@ -2412,7 +2570,7 @@ gpointer  mono_resolve_patch_target         (MonoMethod *method, MonoDomain *dom
 gpointer  mono_jit_find_compiled_method_with_jit_info (MonoDomain *domain, MonoMethod *method, MonoJitInfo **ji);
 gpointer  mono_jit_find_compiled_method     (MonoDomain *domain, MonoMethod *method);
 gpointer  mono_jit_compile_method           (MonoMethod *method, MonoError *error);
-gpointer  mono_jit_compile_method_inner     (MonoMethod *method, MonoDomain *target_domain, int opt, MonoError *error);
+gpointer  mono_jit_compile_method_inner     (MonoMethod *method, MonoDomain *target_domain, int opt, JitFlags flags, MonoError *error);
 MonoLMF * mono_get_lmf                      (void);
 MonoLMF** mono_get_lmf_addr                 (void);
 void      mono_set_lmf                      (MonoLMF *lmf);
@@ -2438,6 +2596,7 @@ void      mono_linear_scan                  (MonoCompile *cfg, GList *vars, GLis
 void      mono_global_regalloc              (MonoCompile *cfg);
 void      mono_create_jump_table            (MonoCompile *cfg, MonoInst *label, MonoBasicBlock **bbs, int num_blocks);
 MonoCompile *mini_method_compile            (MonoMethod *method, guint32 opts, MonoDomain *domain, JitFlags flags, int parts, int aot_method_index);
+MonoCompile *mini_method_compile_osr        (MonoMethod *method, guint32 opts, MonoDomain *domain, int il_offset);
 void      mono_destroy_compile              (MonoCompile *cfg);
 void      mono_empty_compile              (MonoCompile *cfg);
 MonoJitICallInfo *mono_find_jit_opcode_emulation (int opcode);
@@ -2493,6 +2652,7 @@ gboolean  mono_aot_is_got_entry             (guint8 *code, guint8 *addr);
 guint8*   mono_aot_get_plt_entry            (guint8 *code);
 guint32   mono_aot_get_plt_info_offset      (mgreg_t *regs, guint8 *code);
 gboolean  mono_aot_get_cached_class_info    (MonoClass *klass, MonoCachedClassInfo *res);
+gboolean  mono_aot_get_imt_slot_methods     (MonoClass *klass, int imt_slot, GPtrArray *methods, GArray *vt_slots);
 gboolean  mono_aot_get_class_from_name      (MonoImage *image, const char *name_space, const char *name, MonoClass **klass);
 MonoJitInfo* mono_aot_find_jit_info         (MonoDomain *domain, MonoImage *image, gpointer addr);
 gpointer mono_aot_plt_resolve               (gpointer aot_module, guint32 plt_info_offset, guint8 *code, MonoError *error);
@@ -2510,6 +2670,9 @@ guint8*  mono_aot_get_unwind_info           (MonoJitInfo *ji, guint32 *unwind_in
 guint32  mono_aot_method_hash               (MonoMethod *method);
 MonoMethod* mono_aot_get_array_helper_from_wrapper (MonoMethod *method);
 void     mono_aot_set_make_unreadable       (gboolean unreadable);
+void     mono_aot_set_preload_threads       (int count);
+gboolean mono_aot_has_debug_images          (void);
+guint32  mono_aot_get_image_code_size       (MonoImage *image);
 gboolean mono_aot_is_pagefault              (void *ptr);
 void     mono_aot_handle_pagefault          (void *ptr);
 void     mono_aot_register_jit_icall        (const char *name, gpointer addr);
@@ -2743,6 +2906,9 @@ void      mono_arch_set_breakpoint              (MonoJitInfo *ji, guint8 *ip);
 void      mono_arch_clear_breakpoint            (MonoJitInfo *ji, guint8 *ip);
 void      mono_arch_start_single_stepping       (void);
 void      mono_arch_stop_single_stepping        (void);
+gboolean  mono_arch_start_single_stepping_thread (MonoJitTlsData *jit_tls);
+void      mono_arch_stop_single_stepping_thread  (MonoJitTlsData *jit_tls);
+void      mono_arch_init_single_stepping_thread  (MonoJitTlsData *jit_tls);
 gboolean  mono_arch_is_single_step_event        (void *info, void *sigctx);
 gboolean  mono_arch_is_breakpoint_event         (void *info, void *sigctx);
 void     mono_arch_skip_breakpoint              (MonoContext *ctx, MonoJitInfo *ji);
@@ -2786,6 +2952,7 @@ gpointer  mono_arch_get_llvm_imt_trampoline     (MonoDomain *domain, MonoMethod
 gpointer mono_arch_get_gsharedvt_arg_trampoline (MonoDomain *domain, gpointer arg, gpointer addr);
 void     mono_arch_patch_callsite               (guint8 *method_start, guint8 *code, guint8 *addr);
 void     mono_arch_patch_plt_entry              (guint8 *code, gpointer *got, mgreg_t *regs, guint8 *addr);
+void     mono_arch_patch_class_init_site        (guint8 *site, guint8 *end);
 void     mono_arch_nullify_class_init_trampoline(guint8 *code, mgreg_t *regs);
 int      mono_arch_get_this_arg_reg             (guint8 *code);
 gpointer mono_arch_get_this_arg_from_call       (mgreg_t *regs, guint8 *code);
@@ -2891,6 +3058,9 @@ void        mono_ssa_deadce                     (MonoCompile *cfg);
 void        mono_ssa_strength_reduction         (MonoCompile *cfg);
 void        mono_free_loop_info                 (MonoCompile *cfg);
 void        mono_ssa_loop_invariant_code_motion (MonoCompile *cfg);
+void        mono_ssa_scalar_replace             (MonoCompile *cfg);
+void        mono_ssa_gvn                        (MonoCompile *cfg);
+gboolean    mono_vectorize_loops                (MonoCompile *cfg);
 
 void        mono_ssa_compute2                   (MonoCompile *cfg);
 void        mono_ssa_remove2                    (MonoCompile *cfg);
@@ -2914,6 +3084,41 @@ MONO_API void      mono_debugger_run_finally             (MonoContext *start_ctx
 
 MONO_API gboolean mono_breakpoint_clean_code (guint8 *method_start, guint8 *code, int offset, guint8 *buf, int size);
 
+/* Tiered compilation */
+extern gboolean mono_tiered_enabled;
+void           mono_tiered_enable               (const char *options);
+void           mono_tiered_init                 (guint32 default_opt);
+gboolean       mono_tiered_method_is_eligible   (MonoMethod *method);
+guint32        mono_tiered_get_tier0_opts       (guint32 opts);
+MonoTieredInfo *mono_tiered_info_new            (MonoMethod *method, MonoDomain *domain);
+void           mono_tiered_info_free            (MonoTieredInfo *info);
+void           mono_tiered_register             (MonoTieredInfo *info, gpointer code);
+gboolean       mono_tiered_is_tier0_code        (gpointer code);
+void           mono_tiered_promote              (MonoTieredInfo *info);
+MonoTieredInfo *mono_tiered_lookup              (MonoDomain *domain, MonoMethod *method);
+MonoTieredCallSite *mono_tiered_get_call_site   (MonoTieredInfo *info, int il_offset);
+int            mono_tiered_get_inline_limit     (MonoTieredInfo *info, int il_offset, int limit);
+MonoVTable    *mono_tiered_get_dominant_receiver (MonoTieredInfo *info, int il_offset);
+void           mono_tiered_free_domain          (MonoDomain *domain);
+gboolean       mono_tiered_osr_enabled          (void);
+gpointer       mono_tiered_osr_get_code         (MonoTieredInfo *info, int il_offset);
+void           mono_tiered_osr_set_state        (gpointer state);
+gpointer       mono_tiered_osr_take_state       (void);
+
+/* Background compilation */
+void           mono_compile_queue_set_threads   (int count);
+void           mono_compile_queue_enable_preload (void);
+void           mono_compile_queue_init          (guint32 default_opt);
+void           mono_compile_queue_add           (MonoDomain *domain, MonoMethod *method);
+gboolean       mono_compile_queue_wait          (MonoDomain *domain, MonoMethod *method);
+void           mono_compile_queue_free_domain   (MonoDomain *domain);
+
+/* Startup snapshots */
+void           mono_startup_snapshot_set_file   (const char *file);
+void           mono_startup_snapshot_set_delay  (int seconds);
+void           mono_startup_snapshot_init       (void);
+void           mono_startup_snapshot_cleanup    (void);
+
 /* Tracing */
 MonoTraceSpec *mono_trace_parse_options         (const char *options);
 void           mono_trace_set_assembly          (MonoAssembly *assembly);
@@ -2923,8 +3128,8 @@ extern void
 mono_perform_abc_removal (MonoCompile *cfg);
 extern void
 mono_perform_abc_removal (MonoCompile *cfg);
-extern void
-mono_perform_ssapre (MonoCompile *cfg);
+extern gboolean
+mono_abc_version_loops (MonoCompile *cfg);
 extern void
 mono_local_cprop (MonoCompile *cfg);
 extern void
@@ -3046,16 +3251,20 @@ void mono_cfg_add_try_hole (MonoCompile *cfg, MonoExceptionClause *clause, guint
 
 void mono_cfg_set_exception (MonoCompile *cfg, int type);
 void mono_cfg_set_exception_invalid_program (MonoCompile *cfg, char *msg);
+int  mono_cfg_ir_size (MonoCompile *cfg);
 
 #define MONO_TIME_TRACK(a, phase) \
 	{ \
 		GTimer *timer = mono_time_track_start (); \
 		(phase) ; \
-		mono_time_track_end (&(a), timer); \
+		mono_time_track_pass_end (cfg, #a, &(a), timer); \
 	}
 
 GTimer *mono_time_track_start (void);
 void mono_time_track_end (double *time, GTimer *timer);
+void mono_time_track_pass_end (MonoCompile *cfg, const char *name, double *time, GTimer *timer);
+gboolean mono_jit_stats_enable_top (const char *options);
+void mono_jit_stats_print_top (void);
 
 void mono_update_jit_stats (MonoCompile *cfg);
 
@@ -3093,15 +3302,20 @@ enum {
 	SIMD_VERSION_SSE41	= 1 << 4,
 	SIMD_VERSION_SSE42	= 1 << 5,
 	SIMD_VERSION_SSE4a	= 1 << 6,
+	SIMD_VERSION_AVX	= 1 << 7,
+	SIMD_VERSION_AVX2	= 1 << 8,
+	/* AVX-512 F, BW and VL */
+	SIMD_VERSION_AVX512	= 1 << 9,
 	SIMD_VERSION_ALL	= SIMD_VERSION_SSE1 | SIMD_VERSION_SSE2 |
 			  SIMD_VERSION_SSE3 | SIMD_VERSION_SSSE3 |
 			  SIMD_VERSION_SSE41 | SIMD_VERSION_SSE42 |
-			  SIMD_VERSION_SSE4a,
+			  SIMD_VERSION_SSE4a | SIMD_VERSION_AVX |
+			  SIMD_VERSION_AVX2 | SIMD_VERSION_AVX512,
 
 	/* this value marks the end of the bit indexes used in 
 	 * this emum.
 	 */
-	SIMD_VERSION_INDEX_END = 6 
+	SIMD_VERSION_INDEX_END = 9 
 };
 
 enum {
@@ -3139,13 +3353,20 @@ MonoType*   mini_native_type_replace_type (MonoType *type) MONO_LLVM_INTERNAL;
 /* maybe enable also for other systems? */
 #define ENABLE_JIT_MAP 1
 void mono_enable_jit_map (void);
+void mono_enable_jit_dump (void);
 void mono_emit_jit_map   (MonoJitInfo *jinfo);
 void mono_emit_jit_tramp (void *start, int size, const char *desc);
+void mono_emit_jit_tramp_unwind (void *start, int size, const char *desc, guint8 *uw_info, guint32 uw_info_len);
 gboolean mono_jit_map_is_enabled (void);
+/* jitdump.c */
+gboolean mono_jitdump_open (void);
+void mono_jitdump_emit_code (MonoJitInfo *jinfo, void *start, int size, const char *name, guint8 *uw_info, guint32 uw_info_len);
 #else
 #define mono_enable_jit_map()
+#define mono_enable_jit_dump()
 #define mono_emit_jit_map(ji)
 #define mono_emit_jit_tramp(s,z,d)
+#define mono_emit_jit_tramp_unwind(s,z,d,u,l)
 #define mono_jit_map_is_enabled() (0)
 #endif
 
@@ -86,6 +86,18 @@ class Sample {
 	}
 }
 
+class EscapePoint {
+	public int x, y;
+	public byte b;
+	public float f;
+	public EscapePoint next;
+
+	public EscapePoint (int x, int y) {
+		this.x = x;
+		this.y = y;
+	}
+}
+
 [StructLayout ( LayoutKind.Explicit )]
 struct StructWithBigOffsets {
 		[ FieldOffset(10000) ] public byte b;
@@ -1765,6 +1777,210 @@ ncells ) {
 	public static int test_142_byte_enum_arg_zero_extend () {
 		return enum_arg_zero_extend (ByteEnum2.High);
 	}
+
+	/* Scalar replacement, see mono_ssa_scalar_replace () */
+
+	public static int test_0_scalar_replace_no_escape () {
+		int sum = 0;
+		for (int i = 0; i < 10; ++i) {
+			var p = new EscapePoint (i, -i);
+			p.x += 3;
+			if ((i & 1) != 0)
+				p.y = p.x * 2;
+			sum += p.x + p.y;
+		}
+		/* x = i + 3, y = -i for even i and 2i + 6 for odd ones: 75 - 20 + 80 */
+		return sum == 135 ? 0 : sum;
+	}
+
+	public static int test_0_scalar_replace_field_conversions () {
+		var p = new EscapePoint (0, 0);
+		int v = 300;
+		double d = 0.1;
+		p.b = (byte)v;
+		p.f = (float)d;
+		if (p.b != 44)
+			return 1;
+		if (p.f != (float)0.1)
+			return 2;
+		/* Fields which are never stored read as zero */
+		if (p.next != null || p.x != 0)
+			return 3;
+		return 0;
+	}
+
+	static EscapePoint escaped_point;
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static void escape_point (EscapePoint p) {
+		escaped_point = p;
+	}
+
+	public static int test_0_scalar_replace_escape_call () {
+		var p = new EscapePoint (1, 2);
+		escape_point (p);
+		/* Seen through the escaped reference */
+		p.x = 5;
+		if (escaped_point.x != 5 || !Object.ReferenceEquals (escaped_point, p))
+			return 1;
+		escaped_point = null;
+		return 0;
+	}
+
+	public static int test_0_scalar_replace_escape_store () {
+		var holder = new EscapePoint (0, 0);
+		var p = new EscapePoint (1, 2);
+		holder.next = p;
+		p.y = 7;
+		if (holder.next.y != 7)
+			return 1;
+
+		var arr = new EscapePoint [1];
+		var q = new EscapePoint (3, 4);
+		arr [0] = q;
+		q.x = 8;
+		if (arr [0].x != 8)
+			return 2;
+		return 0;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static EscapePoint make_point (int x) {
+		var p = new EscapePoint (x, 0);
+		p.y = x * 2;
+		return p;
+	}
+
+	public static int test_0_scalar_replace_escape_return () {
+		var p = make_point (21);
+		return p.x == 21 && p.y == 42 ? 0 : 1;
+	}
+
+	public static int test_0_scalar_replace_phi () {
+		/* Both allocations reach the same use, so they escape */
+		int r = 0;
+		for (int i = 0; i < 2; ++i) {
+			var p = (i == 0) ? new EscapePoint (1, 0) : new EscapePoint (2, 0);
+			p.x *= 10;
+			r += p.x;
+		}
+		return r == 30 ? 0 : r;
+	}
+
+	/* Global value numbering, see mono_ssa_gvn () */
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static int gvn_aliased_store (EscapePoint a, EscapePoint b) {
+		int x1 = a.x;
+		/* b might be a */
+		b.x = x1 + 1;
+		int x2 = a.x;
+		return x1 * 100 + x2;
+	}
+
+	public static int test_0_gvn_load_after_aliased_store () {
+		var p = new EscapePoint (3, 0);
+		if (gvn_aliased_store (p, p) != 304)
+			return 1;
+		var q = new EscapePoint (5, 0);
+		if (gvn_aliased_store (q, new EscapePoint (0, 0)) != 505)
+			return 2;
+		return 0;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static int gvn_array_store (int[] a, int i, int j) {
+		int v1 = a [i];
+		/* j might be i */
+		a [j] = v1 + 10;
+		int v2 = a [i];
+		return v1 * 100 + v2;
+	}
+
+	public static int test_0_gvn_array_load_after_store () {
+		var a = new int [] { 1, 2 };
+		if (gvn_array_store (a, 0, 0) != 111)
+			return 1;
+		if (gvn_array_store (a, 1, 0) != 202)
+			return 2;
+		return 0;
+	}
+
+	public static int test_0_gvn_disjoint_fields () {
+		var p = new EscapePoint (4, 0);
+		escape_point (p);
+		int x1 = p.x;
+		p.y = 9;
+		/* A store to another field doesn't change x */
+		int x2 = p.x;
+		escaped_point = null;
+		return x1 == 4 && x2 == 4 && p.y == 9 ? 0 : 1;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static void gvn_bump (EscapePoint p) {
+		p.x += 7;
+	}
+
+	public static int test_0_gvn_load_after_call () {
+		var p = new EscapePoint (1, 0);
+		escape_point (p);
+		int x1 = p.x;
+		gvn_bump (p);
+		int x2 = p.x;
+		escaped_point = null;
+		return x1 == 1 && x2 == 8 ? 0 : 1;
+	}
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static void gvn_bump_and_throw (EscapePoint p) {
+		p.x += 7;
+		throw new Exception ();
+	}
+
+	public static int test_0_gvn_load_after_exception () {
+		var p = new EscapePoint (1, 0);
+		escape_point (p);
+		int x1 = p.x;
+		int x2 = 0;
+		try {
+			gvn_bump_and_throw (p);
+		} catch (Exception) {
+			/* Reached through the exception edge, after the store in the callee */
+			x2 = p.x;
+		}
+		int x3 = p.x;
+		escaped_point = null;
+		return x1 == 1 && x2 == 8 && x3 == 8 ? 0 : 1;
+	}
+
+	public static int test_0_gvn_load_in_try () {
+		var p = new EscapePoint (2, 0);
+		escape_point (p);
+		int x1 = p.x;
+		int x2 = 0;
+		try {
+			p.x = 6;
+			x2 = p.x;
+			gvn_bump_and_throw (p);
+		} catch (Exception) {
+		} finally {
+			x2 += p.x * 100;
+		}
+		escaped_point = null;
+		return x1 == 2 && x2 == 1306 ? 0 : x2;
+	}
+
+	public static int test_0_gvn_pure_redundant () {
+		int[] a = new int [7];
+		int s = 0;
+		for (int i = 0; i < a.Length; ++i) {
+			/* The same computations, once per iteration */
+			s += (i * 3 + a.Length) - (i * 3 + a.Length);
+			s += a.Length;
+		}
+		return s == 49 ? 0 : s;
+	}
 }
 
 #if __MOBILE__
@@ -0,0 +1,412 @@
+/*
+ * runtime-bench.c: Microbenchmarks of runtime internal hot paths
+ *
+ * Each benchmark times a tight loop over one runtime operation, in isolation
+ * from the JIT and from managed code. The results are written as JSON so they
+ * can be compared between builds:
+ *
+ *   MONO_PATH=<corlib dir> ./runtime-bench [--filter=SUBSTRING] [--samples=N]
+ *                                          [--time=MS] [--output=FILE]
+ *
+ * Every benchmark is first calibrated to run for about --time milliseconds,
+ * then timed --samples times. The minimum, median and maximum time per
+ * operation of the samples are reported in nanoseconds.
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+#include <config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <mono/jit/jit.h>
+#include <mono/metadata/appdomain.h>
+#include <mono/metadata/assembly.h>
+#include <mono/metadata/mempool.h>
+#include <mono/metadata/mono-config.h>
+#include <mono/metadata/mono-gc.h>
+#include <mono/utils/lock-free-alloc.h>
+#include <mono/utils/mono-conc-hashtable.h>
+#include <mono/utils/mono-mmap.h>
+#include <mono/utils/mono-os-mutex.h>
+#include <mono/utils/mono-time.h>
+
+#define HASH_ENTRIES 4096
+#define MEMPOOL_ALLOCS_PER_POOL 4096
+#define LOCK_FREE_BATCH 64
+
+typedef struct {
+	const char *name;
+	void (*setup) (void);
+	void (*run) (int iterations);
+	void (*teardown) (void);
+} Benchmark;
+
+typedef struct {
+	const char *name;
+	int iterations;
+	double min, median, max;
+	int bytes_per_op;
+} BenchmarkResult;
+
+static MonoDomain *domain;
+static volatile gpointer sink;
+static int bytes_per_op;
+
+/* Objects used by the benchmarks, kept alive and in place by a pinned handle */
+static MonoObject *target_object;
+static guint32 target_handle;
+
+static MonoConcurrentHashTable *hash;
+static mono_mutex_t hash_mutex;
+
+static MonoLockFreeAllocSizeClass lock_free_sc;
+static MonoLockFreeAllocator lock_free_heap;
+
+static MonoMemPool *mempool;
+
+static MonoClass *alloc_class;
+static char *jitted_code;
+
+static void
+setup_target_object (void)
+{
+	target_object = mono_object_new (domain, mono_get_object_class ());
+	target_handle = mono_gchandle_new (target_object, TRUE);
+}
+
+static void
+teardown_target_object (void)
+{
+	mono_gchandle_free (target_handle);
+	target_object = NULL;
+}
+
+static void
+setup_conc_hashtable (void)
+{
+	int i;
+
+	mono_os_mutex_init (&hash_mutex);
+	hash = mono_conc_hashtable_new (NULL, NULL);
+
+	/* Writers must be serialized, readers are lock free */
+	mono_os_mutex_lock (&hash_mutex);
+	for (i = 0; i < HASH_ENTRIES; ++i)
+		mono_conc_hashtable_insert (hash, GINT_TO_POINTER (i + 1), GINT_TO_POINTER (i + 1));
+	mono_os_mutex_unlock (&hash_mutex);
+}
+
+static void
+run_conc_hashtable_lookup (int iterations)
+{
+	int i;
+
+	for (i = 0; i < iterations; ++i)
+		sink = mono_conc_hashtable_lookup (hash, GINT_TO_POINTER ((i & (HASH_ENTRIES - 1)) + 1));
+}
+
+static void
+teardown_conc_hashtable (void)
+{
+	mono_conc_hashtable_destroy (hash);
+	mono_os_mutex_destroy (&hash_mutex);
+}
+
+static void
+setup_lock_free_alloc (void)
+{
+	mono_lock_free_allocator_init_size_class (&lock_free_sc, 32, mono_pagesize ());
+	mono_lock_free_allocator_init_allocator (&lock_free_heap, &lock_free_sc);
+	bytes_per_op = 32;
+}
+
+/* One operation is an allocation and the matching free */
+static void
+run_lock_free_alloc (int iterations)
+{
+	gpointer slots [LOCK_FREE_BATCH];
+	int i, j, n;
+
+	for (i = 0; i < iterations; i += n) {
+		n = MIN (LOCK_FREE_BATCH, iterations - i);
+		for (j = 0; j < n; ++j)
+			slots [j] = mono_lock_free_alloc (&lock_free_heap);
+		for (j = 0; j < n; ++j)
+			mono_lock_free_free (slots [j], mono_pagesize ());
+	}
+}
+
+static void
+setup_mempool (void)
+{
+	mempool = mono_mempool_new ();
+	bytes_per_op = 32;
+}
+
+/* Includes the cost of destroying a pool every MEMPOOL_ALLOCS_PER_POOL allocations */
+static void
+run_mempool_alloc (int iterations)
+{
+	int i;
+
+	for (i = 0; i < iterations; ++i) {
+		if ((i & (MEMPOOL_ALLOCS_PER_POOL - 1)) == MEMPOOL_ALLOCS_PER_POOL - 1) {
+			mono_mempool_destroy (mempool);
+			mempool = mono_mempool_new ();
+		}
+		sink = mono_mempool_alloc (mempool, 32);
+	}
+}
+
+static void
+teardown_mempool (void)
+{
+	mono_mempool_destroy (mempool);
+	mempool = NULL;
+}
+
+static void
+run_class_from_name (int iterations)
+{
+	MonoImage *corlib = mono_get_corlib ();
+	int i;
+
+	for (i = 0; i < iterations; ++i)
+		sink = mono_class_from_name (corlib, "System.Collections.Generic", "Dictionary`2");
+}
+
+static void
+setup_jit_info_table (void)
+{
+	MonoMethod *method = mono_class_get_method_from_name (mono_get_string_class (), "Concat", 2);
+
+	g_assert (method);
+	jitted_code = (char *) mono_compile_method (method);
+	g_assert (mono_jit_info_table_find (domain, jitted_code + 1));
+}
+
+static void
+run_jit_info_table_find (int iterations)
+{
+	int i;
+
+	for (i = 0; i < iterations; ++i)
+		sink = mono_jit_info_table_find (domain, jitted_code + 1);
+}
+
+static void
+run_monitor_enter_exit (int iterations)
+{
+	int i;
+
+	for (i = 0; i < iterations; ++i) {
+		mono_monitor_enter (target_object);
+		mono_monitor_exit (target_object);
+	}
+}
+
+/* One operation is an allocation and the matching free */
+static void
+run_gchandle_alloc_free (int iterations)
+{
+	int i;
+
+	for (i = 0; i < iterations; ++i)
+		mono_gchandle_free (mono_gchandle_new (target_object, FALSE));
+}
+
+static void
+setup_string_new (void)
+{
+	bytes_per_op = mono_object_get_size ((MonoObject *) mono_string_new (domain, "The quick brown fox"));
+}
+
+static void
+run_string_new (int iterations)
+{
+	int i;
+
+	for (i = 0; i < iterations; ++i)
+		sink = mono_string_new (domain, "The quick brown fox");
+}
+
+static void
+setup_nursery_alloc (void)
+{
+	alloc_class = mono_get_object_class ();
+	bytes_per_op = mono_class_instance_size (alloc_class);
+}
+
+static void
+run_nursery_alloc (int iterations)
+{
+	int i;
+
+	for (i = 0; i < iterations; ++i)
+		sink = mono_object_new (domain, alloc_class);
+}
+
+static void
+setup_nursery_alloc_array (void)
+{
+	bytes_per_op = mono_object_get_size ((MonoObject *) mono_array_new (domain, mono_get_byte_class (), 64));
+}
+
+static void
+run_nursery_alloc_array (int iterations)
+{
+	MonoClass *byte_class = mono_get_byte_class ();
+	int i;
+
+	for (i = 0; i < iterations; ++i)
+		sink = mono_array_new (domain, byte_class, 64);
+}
+
+static const Benchmark benchmarks [] = {
+	{ "conc_hashtable_lookup", setup_conc_hashtable, run_conc_hashtable_lookup, teardown_conc_hashtable },
+	{ "lock_free_alloc_free", setup_lock_free_alloc, run_lock_free_alloc, NULL },
+	{ "mempool_alloc", setup_mempool, run_mempool_alloc, teardown_mempool },
+	{ "class_from_name", NULL, run_class_from_name, NULL },
+	{ "jit_info_table_find", setup_jit_info_table, run_jit_info_table_find, NULL },
+	{ "monitor_enter_exit", setup_target_object, run_monitor_enter_exit, teardown_target_object },
+	{ "gchandle_alloc_free", setup_target_object, run_gchandle_alloc_free, teardown_target_object },
+	{ "string_new", setup_string_new, run_string_new, NULL },
+	{ "nursery_alloc_object", setup_nursery_alloc, run_nursery_alloc, NULL },
+	{ "nursery_alloc_byte_array", setup_nursery_alloc_array, run_nursery_alloc_array, NULL },
+};
+
+/* In nanoseconds */
+static double
+time_run (const Benchmark *bench, int iterations)
+{
+	gint64 start = mono_100ns_ticks ();
+
+	bench->run (iterations);
+	return (mono_100ns_ticks () - start) * 100.0;
+}
+
+static int
+compare_doubles (const void *a, const void *b)
+{
+	double da = *(const double *) a;
+	double db = *(const double *) b;
+
+	return da < db ? -1 : da > db ? 1 : 0;
+}
+
+static void
+run_benchmark (const Benchmark *bench, int samples, int time_ms, BenchmarkResult *result)
+{
+	double *per_op = g_new (double, samples);
+	double elapsed;
+	int iterations = 1000;
+	int i;
+
+	bytes_per_op = 0;
+	if (bench->setup)
+		bench->setup ();
+
+	/* Warm up and find an iteration count which runs for about time_ms */
+	while ((elapsed = time_run (bench, iterations)) < 10 * 1000 * 1000 && iterations < (G_MAXINT / 2))
+		iterations *= 2;
+	if (elapsed < time_ms * 1000000.0)
+		iterations = (int) MIN ((double) G_MAXINT, iterations * (time_ms * 1000000.0 / MAX (elapsed, 1.0)));
+
+	for (i = 0; i < samples; ++i)
+		per_op [i] = time_run (bench, iterations) / iterations;
+	qsort (per_op, samples, sizeof (double), compare_doubles);
+
+	if (bench->teardown)
+		bench->teardown ();
+
+	result->name = bench->name;
+	result->iterations = iterations;
+	result->min = per_op [0];
+	result->median = per_op [samples / 2];
+	result->max = per_op [samples - 1];
+	result->bytes_per_op = bytes_per_op;
+	g_free (per_op);
+}
+
+static void
+write_results (FILE *f, BenchmarkResult *results, int count, int samples)
+{
+	char *build_info = mono_get_runtime_build_info ();
+	int i;
+
+	fprintf (f, "{\n\t\"runtime\": \"%s\",\n\t\"samples\": %d,\n\t\"unit\": \"ns/op\",\n\t\"benchmarks\": [\n", build_info, samples);
+	for (i = 0; i < count; ++i) {
+		BenchmarkResult *r = &results [i];
+
+		fprintf (f, "\t\t{ \"name\": \"%s\", \"iterations\": %d, \"min\": %.3f, \"median\": %.3f, \"max\": %.3f",
+			r->name, r->iterations, r->min, r->median, r->max);
+		if (r->bytes_per_op)
+			fprintf (f, ", \"bytes_per_op\": %d, \"mb_per_sec\": %.1f", r->bytes_per_op, r->bytes_per_op * 1000.0 / r->median);
+		fprintf (f, " }%s\n", i < count - 1 ? "," : "");
+	}
+	fprintf (f, "\t]\n}\n");
+	g_free (build_info);
+}
+
+static void
+usage (void)
+{
+	int i;
+
+	fprintf (stderr, "Usage: runtime-bench [--filter=SUBSTRING] [--samples=N] [--time=MS] [--output=FILE]\n\nBenchmarks:\n");
+	for (i = 0; i < G_N_ELEMENTS (benchmarks); ++i)
+		fprintf (stderr, "\t%s\n", benchmarks [i].name);
+	exit (1);
+}
+
+int
+main (int argc, char *argv [])
+{
+	BenchmarkResult results [G_N_ELEMENTS (benchmarks)];
+	const char *filter = NULL;
+	const char *output = NULL;
+	int samples = 5;
+	int time_ms = 100;
+	int i, count = 0;
+	FILE *f = stdout;
+
+	for (i = 1; i < argc; ++i) {
+		if (strncmp (argv [i], "--filter=", 9) == 0)
+			filter = argv [i] + 9;
+		else if (strncmp (argv [i], "--samples=", 10) == 0)
+			samples = atoi (argv [i] + 10);
+		else if (strncmp (argv [i], "--time=", 7) == 0)
+			time_ms = atoi (argv [i] + 7);
+		else if (strncmp (argv [i], "--output=", 9) == 0)
+			output = argv [i] + 9;
+		else
+			usage ();
+	}
+	if (samples <= 0 || time_ms <= 0)
+		usage ();
+
+	mono_config_parse (NULL);
+	domain = mono_jit_init ("runtime-bench");
+
+	for (i = 0; i < G_N_ELEMENTS (benchmarks); ++i) {
+		if (filter && !strstr (benchmarks [i].name, filter))
+			continue;
+		fprintf (stderr, "Running %s\n", benchmarks [i].name);
+		run_benchmark (&benchmarks [i], samples, time_ms, &results [count++]);
+	}
+
+	if (output) {
+		f = fopen (output, "w");
+		if (!f) {
+			fprintf (stderr, "Could not open '%s'\n", output);
+			return 1;
+		}
+	}
+	write_results (f, results, count, samples);
+	if (f != stdout)
+		fclose (f);
+
+	mono_jit_cleanup (domain);
+	return 0;
+}
@@ -1475,6 +1475,12 @@ simd_version_name (guint32 version)
 		return "sse42";
 	case SIMD_VERSION_SSE4a:
 		return "sse4a";
+	case SIMD_VERSION_AVX:
+		return "avx";
+	case SIMD_VERSION_AVX2:
+		return "avx2";
+	case SIMD_VERSION_AVX512:
+		return "avx512";
 	}
 	return "n/a";
 }
@@ -13,6 +13,7 @@
 #include <mono/metadata/debug-helpers.h>
 #include <mono/metadata/mempool.h>
 #include <mono/metadata/mempool-internals.h>
+#include <mono/metadata/abi-details.h>
 
 #ifndef DISABLE_JIT
 
@@ -1515,4 +1516,987 @@ mono_ssa_loop_invariant_code_motion (MonoCompile *cfg)
 	}
 }
 
+typedef struct {
+	/* The OP_NEWOBJ allocating the object */
+	MonoInst *alloc;
+	MonoBasicBlock *bb;
+	gboolean escapes;
+	int size;
+	/* The field accessed at each offset, whenever it is loaded, and its replacement */
+	MonoClassField **fields;
+	gboolean *loaded;
+	MonoInst **vars;
+} ScalarReplaceInfo;
+
+static MonoClassField*
+find_instance_field (MonoClass *klass, int offset)
+{
+	MonoClassField *field;
+	gpointer iter;
+
+	for (; klass; klass = klass->parent) {
+		iter = NULL;
+		while ((field = mono_class_get_fields (klass, &iter))) {
+			if (!(field->type->attrs & FIELD_ATTRIBUTE_STATIC) && field->offset == offset)
+				return field;
+		}
+	}
+	return NULL;
+}
+
+static int
+store_imm_to_store_reg (int opcode)
+{
+	switch (opcode) {
+	case OP_STORE_MEMBASE_IMM:
+		return OP_STORE_MEMBASE_REG;
+	case OP_STOREI1_MEMBASE_IMM:
+		return OP_STOREI1_MEMBASE_REG;
+	case OP_STOREI2_MEMBASE_IMM:
+		return OP_STOREI2_MEMBASE_REG;
+	case OP_STOREI4_MEMBASE_IMM:
+		return OP_STOREI4_MEMBASE_REG;
+	case OP_STOREI8_MEMBASE_IMM:
+		return OP_STOREI8_MEMBASE_REG;
+	default:
+		return opcode;
+	}
+}
+
+/*
+ * check_field_access:
+ *
+ *   Check that INS, a load or a store at OFFSET in the object described by INFO,
+ * accesses a whole scalar field with the opcode the JIT uses for its type.
+ */
+static gboolean
+check_field_access (MonoCompile *cfg, ScalarReplaceInfo *info, MonoInst *ins, gboolean is_load)
+{
+	MonoClassField *field;
+	MonoType *type;
+	int offset = ins->inst_offset;
+
+	if (offset < (int)sizeof (MonoObject) || offset >= info->size)
+		return FALSE;
+
+	field = info->fields [offset];
+	if (!field) {
+		field = find_instance_field (info->alloc->klass, offset);
+		if (!field)
+			return FALSE;
+		type = mini_get_underlying_type (field->type);
+		if (type->type == MONO_TYPE_VAR || type->type == MONO_TYPE_MVAR || MONO_TYPE_ISSTRUCT (type))
+			return FALSE;
+		if (type->type == MONO_TYPE_R4 || type->type == MONO_TYPE_R8) {
+			/* The fp stack and soft float can't keep the values in vregs the same way */
+			if (MONO_ARCH_USE_FPSTACK || mono_arch_is_soft_float ())
+				return FALSE;
+		}
+		info->fields [offset] = field;
+	}
+
+	if (is_load) {
+		if (ins->opcode != mono_type_to_load_membase (cfg, field->type))
+			return FALSE;
+		info->loaded [offset] = TRUE;
+	} else {
+		if (store_imm_to_store_reg (ins->opcode) != mono_type_to_store_membase (cfg, field->type))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static inline void
+mark_escape (ScalarReplaceInfo *infos, int *owner, int nvregs, int vreg)
+{
+	if (vreg >= 0 && vreg < nvregs && owner [vreg] != -1)
+		infos [owner [vreg]].escapes = TRUE;
+}
+
+static inline gboolean
+is_owned (int *owner, int nvregs, int vreg)
+{
+	return vreg >= 0 && vreg < nvregs && owner [vreg] != -1;
+}
+
+static inline ScalarReplaceInfo*
+get_replaced_info (ScalarReplaceInfo *infos, int *owner, int nvregs, int vreg)
+{
+	if (!is_owned (owner, nvregs, vreg) || infos [owner [vreg]].escapes)
+		return NULL;
+	return &infos [owner [vreg]];
+}
+
+/*
+ * emit_field_zero:
+ *
+ *   Initialize the replacement of a field the same way the GC clears new objects.
+ */
+static void
+emit_field_zero (MonoCompile *cfg, ScalarReplaceInfo *info, MonoClassField *field, MonoInst *var)
+{
+	static double r8_0 = 0.0;
+	static float r4_0 = 0.0;
+	MonoInst *ins;
+	int load_op = mono_type_to_load_membase (cfg, field->type);
+
+	if (load_op == OP_LOADR4_MEMBASE && cfg->r4fp) {
+		MONO_INST_NEW (cfg, ins, OP_R4CONST);
+		ins->type = STACK_R4;
+		ins->inst_p0 = (void*)&r4_0;
+	} else if (load_op == OP_LOADR4_MEMBASE || load_op == OP_LOADR8_MEMBASE) {
+		MONO_INST_NEW (cfg, ins, OP_R8CONST);
+		ins->type = STACK_R8;
+		ins->inst_p0 = (void*)&r8_0;
+	} else if (load_op == OP_LOADI8_MEMBASE) {
+		MONO_INST_NEW (cfg, ins, OP_I8CONST);
+		ins->type = STACK_I8;
+		ins->inst_l = 0;
+	} else if (load_op == OP_LOAD_MEMBASE) {
+		MONO_INST_NEW (cfg, ins, OP_PCONST);
+		ins->type = STACK_PTR;
+		ins->inst_p0 = NULL;
+	} else {
+		MONO_INST_NEW (cfg, ins, OP_ICONST);
+		ins->type = STACK_I4;
+		ins->inst_c0 = 0;
+	}
+	ins->dreg = var->dreg;
+	mono_bblock_insert_before_ins (info->bb, info->alloc, ins);
+}
+
+/*
+ * replace_field_store:
+ *
+ *   Convert INS, a store to a field of a replaced object, to a definition of VAR,
+ * applying the conversion the store would do.
+ */
+static void
+replace_field_store (MonoCompile *cfg, MonoClassField *field, MonoInst *var, MonoInst *ins)
+{
+	int load_op = mono_type_to_load_membase (cfg, field->type);
+
+	if (store_imm_to_store_reg (ins->opcode) != ins->opcode) {
+		gint64 imm = ins->inst_imm;
+
+		switch (load_op) {
+		case OP_LOADI1_MEMBASE:
+			imm = (gint8)imm;
+			break;
+		case OP_LOADU1_MEMBASE:
+			imm = (guint8)imm;
+			break;
+		case OP_LOADI2_MEMBASE:
+			imm = (gint16)imm;
+			break;
+		case OP_LOADU2_MEMBASE:
+			imm = (guint16)imm;
+			break;
+		default:
+			break;
+		}
+
+		if (load_op == OP_LOADI8_MEMBASE || (load_op == OP_LOAD_MEMBASE && SIZEOF_REGISTER == 8)) {
+			ins->opcode = OP_I8CONST;
+			ins->inst_l = imm;
+		} else {
+			ins->opcode = OP_ICONST;
+			ins->inst_c0 = (gint32)imm;
+		}
+		ins->sreg1 = -1;
+	} else {
+		switch (load_op) {
+		case OP_LOADI1_MEMBASE:
+			ins->opcode = OP_ICONV_TO_I1;
+			break;
+		case OP_LOADU1_MEMBASE:
+			ins->opcode = OP_ICONV_TO_U1;
+			break;
+		case OP_LOADI2_MEMBASE:
+			ins->opcode = OP_ICONV_TO_I2;
+			break;
+		case OP_LOADU2_MEMBASE:
+			ins->opcode = OP_ICONV_TO_U2;
+			break;
+		case OP_LOADR4_MEMBASE:
+			/* Round to single precision */
+			ins->opcode = cfg->r4fp ? OP_RMOVE : OP_FCONV_TO_R4;
+			break;
+		default:
+			ins->opcode = mono_type_to_regmove (cfg, field->type);
+			break;
+		}
+	}
+	ins->dreg = var->dreg;
+	ins->flags &= ~MONO_INST_FAULT;
+}
+
+/*
+ * mono_ssa_scalar_replace:
+ *
+ *   Escape analysis and scalar replacement of the objects allocated by OP_NEWOBJ.
+ * An object doesn't escape if its references are only copied between single
+ * assignment vregs, used as the base of loads and stores of its scalar fields,
+ * null checked, or used to compute the address for a write barrier. Phi nodes
+ * are treated as escapes, so every use of a reference sees the object allocated
+ * by the most recent execution of its OP_NEWOBJ. The fields of such objects are
+ * replaced by new variables, and the allocation by their zero initialization.
+ * The remaining OP_NEWOBJ instructions are decomposed into allocator calls by
+ * mono_decompose_array_access_opts ().
+ */
+void
+mono_ssa_scalar_replace (MonoCompile *cfg)
+{
+	MonoBasicBlock *bb;
+	MonoInst *ins;
+	ScalarReplaceInfo *infos, *info;
+	int *owner, *ptr_owner, *defs, *uses, *wb_uses;
+	int nvregs = cfg->next_vreg;
+	int nallocs, i, j, offset;
+	gboolean changed;
+
+	g_assert (cfg->comp_done & MONO_COMP_SSA);
+
+	nallocs = 0;
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		for (ins = bb->code; ins; ins = ins->next) {
+			if (ins->opcode == OP_NEWOBJ)
+				nallocs ++;
+		}
+	}
+	if (!nallocs)
+		return;
+
+	infos = (ScalarReplaceInfo *)mono_mempool_alloc0 (cfg->mempool, sizeof (ScalarReplaceInfo) * nallocs);
+	owner = (int *)mono_mempool_alloc (cfg->mempool, sizeof (int) * nvregs);
+	ptr_owner = (int *)mono_mempool_alloc (cfg->mempool, sizeof (int) * nvregs);
+	defs = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * nvregs);
+	uses = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * nvregs);
+	wb_uses = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * nvregs);
+	for (i = 0; i < nvregs; ++i)
+		owner [i] = ptr_owner [i] = -1;
+
+	/* Count the definitions and uses of every vreg */
+	nallocs = 0;
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		for (ins = bb->code; ins; ins = ins->next) {
+			const char *spec = INS_INFO (ins->opcode);
+
+			if (ins->opcode == OP_NOP)
+				continue;
+			if (MONO_IS_PHI (ins)) {
+				defs [ins->dreg] ++;
+				for (j = 1; j <= ins->inst_phi_args [0]; ++j)
+					uses [ins->inst_phi_args [j]] ++;
+				continue;
+			}
+			if (ins->dreg >= 0 && ins->dreg < nvregs) {
+				if (spec [MONO_INST_DEST] != ' ' && !MONO_IS_STORE_MEMBASE (ins))
+					defs [ins->dreg] ++;
+				else
+					uses [ins->dreg] ++;
+			}
+			if (ins->sreg1 >= 0 && ins->sreg1 < nvregs) {
+				uses [ins->sreg1] ++;
+				if (ins->opcode == OP_CARD_TABLE_WBARRIER)
+					wb_uses [ins->sreg1] ++;
+			}
+			if (ins->sreg2 >= 0 && ins->sreg2 < nvregs)
+				uses [ins->sreg2] ++;
+			if (ins->sreg3 >= 0 && ins->sreg3 < nvregs)
+				uses [ins->sreg3] ++;
+
+			if (ins->opcode == OP_NEWOBJ) {
+				info = &infos [nallocs];
+				info->alloc = ins;
+				info->bb = bb;
+				info->size = mono_class_instance_size (ins->klass);
+				info->fields = (MonoClassField **)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoClassField*) * info->size);
+				info->loaded = (gboolean *)mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * info->size);
+				info->vars = (MonoInst **)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoInst*) * info->size);
+				owner [ins->dreg] = nallocs;
+				nallocs ++;
+			}
+		}
+	}
+
+	for (i = 0; i < nallocs; ++i) {
+		if (defs [infos [i].alloc->dreg] != 1)
+			infos [i].escapes = TRUE;
+	}
+
+	/* Compute the vregs holding a reference to each object */
+	do {
+		changed = FALSE;
+		for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+			for (ins = bb->code; ins; ins = ins->next) {
+				MonoInst *var;
+
+				if (ins->opcode != OP_MOVE || !is_owned (owner, nvregs, ins->sreg1) || is_owned (owner, nvregs, ins->dreg))
+					continue;
+				var = get_vreg_to_inst (cfg, ins->dreg);
+				if (ins->dreg >= nvregs || defs [ins->dreg] != 1 || (var && (var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT)))) {
+					mark_escape (infos, owner, nvregs, ins->sreg1);
+					continue;
+				}
+				owner [ins->dreg] = owner [ins->sreg1];
+				changed = TRUE;
+			}
+		}
+	} while (changed);
+
+	/* Check the uses of the references */
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		for (ins = bb->code; ins; ins = ins->next) {
+			gboolean dreg_ok = FALSE, sreg1_ok = FALSE;
+
+			if (ins->opcode == OP_NOP)
+				continue;
+			if (MONO_IS_PHI (ins)) {
+				for (j = 1; j <= ins->inst_phi_args [0]; ++j)
+					mark_escape (infos, owner, nvregs, ins->inst_phi_args [j]);
+				continue;
+			}
+
+			if (is_owned (owner, nvregs, ins->dreg) && bb->region != infos [owner [ins->dreg]].bb->region)
+				mark_escape (infos, owner, nvregs, ins->dreg);
+			if (is_owned (owner, nvregs, ins->sreg1) && bb->region != infos [owner [ins->sreg1]].bb->region)
+				mark_escape (infos, owner, nvregs, ins->sreg1);
+
+			switch (ins->opcode) {
+			case OP_NEWOBJ:
+				dreg_ok = TRUE;
+				break;
+			case OP_MOVE:
+				/* Handled above */
+				dreg_ok = sreg1_ok = TRUE;
+				break;
+			case OP_CHECK_THIS:
+			case OP_NOT_NULL:
+			case OP_DUMMY_USE:
+				sreg1_ok = TRUE;
+				break;
+			case OP_COMPARE_IMM:
+				/* Explicit null checks */
+				sreg1_ok = ins->inst_imm == 0 && ins->next && ins->next->opcode == OP_COND_EXC_EQ;
+				break;
+			case OP_ADD_IMM:
+			case OP_PADD_IMM:
+				/* The address of a field passed to a write barrier */
+				if (is_owned (owner, nvregs, ins->sreg1) && ins->dreg < nvregs && !get_vreg_to_inst (cfg, ins->dreg) &&
+					defs [ins->dreg] == 1 && uses [ins->dreg] == wb_uses [ins->dreg]) {
+					ptr_owner [ins->dreg] = owner [ins->sreg1];
+					sreg1_ok = TRUE;
+				}
+				break;
+			default:
+				if (MONO_IS_LOAD_MEMBASE (ins) && is_owned (owner, nvregs, ins->sreg1)) {
+					sreg1_ok = TRUE;
+					if (!check_field_access (cfg, &infos [owner [ins->sreg1]], ins, TRUE))
+						mark_escape (infos, owner, nvregs, ins->sreg1);
+				} else if (MONO_IS_STORE_MEMBASE (ins) && is_owned (owner, nvregs, ins->dreg)) {
+					dreg_ok = TRUE;
+					if (!check_field_access (cfg, &infos [owner [ins->dreg]], ins, FALSE))
+						mark_escape (infos, owner, nvregs, ins->dreg);
+				}
+				break;
+			}
+
+			if (!dreg_ok)
+				mark_escape (infos, owner, nvregs, ins->dreg);
+			if (!sreg1_ok)
+				mark_escape (infos, owner, nvregs, ins->sreg1);
+			mark_escape (infos, owner, nvregs, ins->sreg2);
+			mark_escape (infos, owner, nvregs, ins->sreg3);
+		}
+	}
+
+	/* Replace the fields of the objects which don't escape by variables */
+	for (i = 0; i < nallocs; ++i) {
+		info = &infos [i];
+		if (info->escapes)
+			continue;
+
+		for (offset = 0; offset < info->size; ++offset) {
+			if (!info->loaded [offset])
+				continue;
+			info->vars [offset] = mono_compile_create_var (cfg, info->fields [offset]->type, OP_LOCAL);
+			emit_field_zero (cfg, info, info->fields [offset], info->vars [offset]);
+		}
+
+		if (cfg->verbose_level > 1)
+			printf ("SCALAR REPLACED R%d (%s) in BB%d\n", info->alloc->dreg, mono_type_get_full_name (info->alloc->klass), info->bb->block_num);
+		NULLIFY_INS (info->alloc);
+		cfg->stat_scalar_replaced_objects ++;
+	}
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		for (ins = bb->code; ins; ins = ins->next) {
+			MonoInst *var;
+
+			switch (ins->opcode) {
+			case OP_MOVE:
+			case OP_CHECK_THIS:
+			case OP_NOT_NULL:
+			case OP_DUMMY_USE:
+				if (get_replaced_info (infos, owner, nvregs, ins->sreg1))
+					NULLIFY_INS (ins);
+				break;
+			case OP_COMPARE_IMM:
+				if (get_replaced_info (infos, owner, nvregs, ins->sreg1)) {
+					NULLIFY_INS (ins->next);
+					NULLIFY_INS (ins);
+				}
+				break;
+			case OP_ADD_IMM:
+			case OP_PADD_IMM:
+				if (get_replaced_info (infos, owner, nvregs, ins->sreg1))
+					NULLIFY_INS (ins);
+				break;
+			case OP_CARD_TABLE_WBARRIER:
+				if (ins->sreg1 >= 0 && ins->sreg1 < nvregs && ptr_owner [ins->sreg1] != -1 && !infos [ptr_owner [ins->sreg1]].escapes)
+					NULLIFY_INS (ins);
+				break;
+			default:
+				if (MONO_IS_LOAD_MEMBASE (ins) && (info = get_replaced_info (infos, owner, nvregs, ins->sreg1))) {
+					var = info->vars [ins->inst_offset];
+					ins->opcode = mono_type_to_regmove (cfg, info->fields [ins->inst_offset]->type);
+					ins->sreg1 = var->dreg;
+					ins->flags &= ~MONO_INST_FAULT;
+				} else if (MONO_IS_STORE_MEMBASE (ins) && (info = get_replaced_info (infos, owner, nvregs, ins->dreg))) {
+					var = info->vars [ins->inst_offset];
+					if (var)
+						replace_field_store (cfg, info->fields [ins->inst_offset], var, ins);
+					else
+						/* Never loaded */
+						NULLIFY_INS (ins);
+				}
+				break;
+			}
+		}
+	}
+}
+
+typedef struct _GVNEntry GVNEntry;
+
+struct _GVNEntry {
+	/* The key */
+	int opcode;
+	int vn1, vn2;
+	gint64 imm;
+	/* The first computation of the value */
+	MonoInst *ins;
+	MonoBasicBlock *bb;
+	/* The memory generation the value of a load belongs to, -1 for non-loads */
+	int mem_gen;
+	/* For loads: the size of the access and whenever its base is an object reference */
+	int size;
+	gboolean obj_base;
+	gboolean killed;
+	/* The entry with the same key shadowed by this one */
+	GVNEntry *prev;
+};
+
+typedef struct {
+	MonoCompile *cfg;
+	GHashTable *table;
+	/* Entries in insertion order, loads in insertion order, killed loads */
+	GPtrArray *scope, *loads, *killed;
+	int *defs, *vn;
+	gboolean *is_obj, *writes;
+	int *visited;
+	MonoBasicBlock **stack;
+	int nvregs, next_gen, visit_stamp;
+} GVNState;
+
+static guint
+gvn_entry_hash (gconstpointer key)
+{
+	const GVNEntry *e = (const GVNEntry *)key;
+
+	return (e->opcode * 31 + e->vn1) * 31 + e->vn2 + (guint)e->imm * 17;
+}
+
+static gboolean
+gvn_entry_equal (gconstpointer ka, gconstpointer kb)
+{
+	const GVNEntry *a = (const GVNEntry *)ka;
+	const GVNEntry *b = (const GVNEntry *)kb;
+
+	return a->opcode == b->opcode && a->vn1 == b->vn1 && a->vn2 == b->vn2 && a->imm == b->imm;
+}
+
+/*
+ * gvn_mem_size:
+ *
+ *   Return the number of bytes accessed by the load/store INS, or -1 if unknown.
+ */
+static int
+gvn_mem_size (MonoInst *ins)
+{
+	switch (ins->opcode) {
+	case OP_LOADI1_MEMBASE:
+	case OP_LOADU1_MEMBASE:
+	case OP_STOREI1_MEMBASE_REG:
+	case OP_STOREI1_MEMBASE_IMM:
+		return 1;
+	case OP_LOADI2_MEMBASE:
+	case OP_LOADU2_MEMBASE:
+	case OP_STOREI2_MEMBASE_REG:
+	case OP_STOREI2_MEMBASE_IMM:
+		return 2;
+	case OP_LOADI4_MEMBASE:
+	case OP_LOADU4_MEMBASE:
+	case OP_LOADR4_MEMBASE:
+	case OP_STOREI4_MEMBASE_REG:
+	case OP_STOREI4_MEMBASE_IMM:
+	case OP_STORER4_MEMBASE_REG:
+		return 4;
+	case OP_LOADI8_MEMBASE:
+	case OP_LOADR8_MEMBASE:
+	case OP_STOREI8_MEMBASE_REG:
+	case OP_STOREI8_MEMBASE_IMM:
+	case OP_STORER8_MEMBASE_REG:
+		return 8;
+	case OP_LOAD_MEMBASE:
+	case OP_STORE_MEMBASE_REG:
+	case OP_STORE_MEMBASE_IMM:
+		return SIZEOF_VOID_P;
+	default:
+		return -1;
+	}
+}
+
+/*
+ * gvn_is_pure:
+ *
+ *   Return whenever INS computes its result only from its sregs and immediate.
+ */
+static gboolean
+gvn_is_pure (MonoInst *ins)
+{
+	switch (ins->opcode) {
+	case OP_IADD:
+	case OP_ISUB:
+	case OP_IMUL:
+	case OP_IAND:
+	case OP_IOR:
+	case OP_IXOR:
+	case OP_ISHL:
+	case OP_ISHR:
+	case OP_ISHR_UN:
+	case OP_INEG:
+	case OP_INOT:
+	case OP_IADD_IMM:
+	case OP_ISUB_IMM:
+	case OP_IMUL_IMM:
+	case OP_IAND_IMM:
+	case OP_IOR_IMM:
+	case OP_IXOR_IMM:
+	case OP_ISHL_IMM:
+	case OP_ISHR_IMM:
+	case OP_ISHR_UN_IMM:
+	case OP_LADD:
+	case OP_LSUB:
+	case OP_LMUL:
+	case OP_LAND:
+	case OP_LOR:
+	case OP_LXOR:
+	case OP_LSHL:
+	case OP_LSHR:
+	case OP_LSHR_UN:
+	case OP_LNEG:
+	case OP_LNOT:
+	case OP_LADD_IMM:
+	case OP_LSUB_IMM:
+	case OP_LMUL_IMM:
+	case OP_LAND_IMM:
+	case OP_LOR_IMM:
+	case OP_LXOR_IMM:
+	case OP_LSHL_IMM:
+	case OP_LSHR_IMM:
+	case OP_LSHR_UN_IMM:
+	case OP_ICONV_TO_I1:
+	case OP_ICONV_TO_U1:
+	case OP_ICONV_TO_I2:
+	case OP_ICONV_TO_U2:
+	case OP_SEXT_I4:
+	case OP_ZEXT_I4:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static gboolean
+gvn_is_commutative (int opcode)
+{
+	switch (opcode) {
+	case OP_IADD:
+	case OP_IMUL:
+	case OP_IAND:
+	case OP_IOR:
+	case OP_IXOR:
+	case OP_LADD:
+	case OP_LMUL:
+	case OP_LAND:
+	case OP_LOR:
+	case OP_LXOR:
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
+static inline gboolean
+gvn_is_load (MonoInst *ins)
+{
+	return MONO_IS_LOAD_MEMBASE (ins) && !(ins->opcode >= OP_ATOMIC_LOAD_I1 && ins->opcode <= OP_ATOMIC_LOAD_R8);
+}
+
+/*
+ * gvn_writes_memory:
+ *
+ *   Return whenever INS might write memory read by a load, i.e. it is not one of
+ * the instructions known to be free of memory side effects.
+ */
+static gboolean
+gvn_writes_memory (MonoInst *ins)
+{
+	if (MONO_INS_HAS_NO_SIDE_EFFECT (ins) || gvn_is_pure (ins) || gvn_is_load (ins))
+		return FALSE;
+	if (MONO_IS_PHI (ins) || MONO_IS_BRANCH_OP (ins) || MONO_IS_COND_EXC (ins) || MONO_IS_SETCC (ins))
+		return FALSE;
+
+	switch (ins->opcode) {
+	case OP_ICONST:
+	case OP_I8CONST:
+	case OP_R4CONST:
+	case OP_R8CONST:
+	case OP_AOTCONST:
+	case OP_COMPARE:
+	case OP_COMPARE_IMM:
+	case OP_ICOMPARE:
+	case OP_ICOMPARE_IMM:
+	case OP_LCOMPARE:
+	case OP_LCOMPARE_IMM:
+	case OP_FCOMPARE:
+	case OP_RCOMPARE:
+	case OP_LDLEN:
+	case OP_STRLEN:
+	case OP_CHECK_THIS:
+	case OP_DUMMY_USE:
+	case OP_BOUNDS_CHECK:
+	case OP_CARD_TABLE_WBARRIER:
+	case OP_SEQ_POINT:
+	case OP_LIVERANGE_START:
+	case OP_LIVERANGE_END:
+	case OP_GC_LIVENESS_DEF:
+	case OP_GC_LIVENESS_USE:
+		return FALSE;
+	default:
+		return TRUE;
+	}
+}
+
+/*
+ * gvn_region_writes:
+ *
+ *   Return whenever a block on a path from the immediate dominator of BB to BB
+ * might write memory. Such paths might bypass the blocks visited by the walk of
+ * the dominator tree, like the arms of a conditional, or go around a loop headed
+ * by BB.
+ */
+static gboolean
+gvn_region_writes (GVNState *state, MonoBasicBlock *bb)
+{
+	MonoBasicBlock *idom = bb->idom;
+	int i, sp;
+
+	if (bb->in_count == 1 && bb->in_bb [0] == idom)
+		return FALSE;
+
+	state->visit_stamp ++;
+	sp = 0;
+	for (i = 0; i < bb->in_count; ++i)
+		state->stack [sp ++] = bb->in_bb [i];
+	while (sp > 0) {
+		MonoBasicBlock *pred = state->stack [-- sp];
+
+		if (pred == idom || pred == bb || state->visited [pred->block_num] == state->visit_stamp)
+			continue;
+		state->visited [pred->block_num] = state->visit_stamp;
+		if (state->writes [pred->block_num])
+			return TRUE;
+		for (i = 0; i < pred->in_count; ++i)
+			state->stack [sp ++] = pred->in_bb [i];
+	}
+	return FALSE;
+}
+
+static inline int
+gvn_get_vn (GVNState *state, int vreg)
+{
+	if (vreg < 0 || vreg >= state->nvregs)
+		return -1;
+	return state->vn [vreg];
+}
+
+/*
+ * gvn_kill_loads:
+ *
+ *   Kill the available loads which might read the memory written by the store INS.
+ * Accesses at disjoint offsets don't alias if they have the same base, or if both
+ * bases are object references, since objects don't overlap.
+ */
+static void
+gvn_kill_loads (GVNState *state, MonoInst *ins)
+{
+	int size = gvn_mem_size (ins);
+	int base = gvn_get_vn (state, ins->inst_destbasereg);
+	gboolean obj_base = base != -1 && state->is_obj [ins->inst_destbasereg];
+	int i;
+
+	for (i = 0; i < state->loads->len; ++i) {
+		GVNEntry *e = (GVNEntry *)g_ptr_array_index (state->loads, i);
+
+		if (e->killed)
+			continue;
+		if (size != -1 && base != -1 && (e->vn1 == base || (e->obj_base && obj_base))) {
+			if (ins->inst_offset + size <= e->imm || e->imm + e->size <= ins->inst_offset)
+				continue;
+		}
+		e->killed = TRUE;
+		g_ptr_array_add (state->killed, e);
+	}
+}
+
+static void
+gvn_replace (GVNState *state, GVNEntry *e, MonoBasicBlock *bb, MonoInst *ins)
+{
+	MonoCompile *cfg = state->cfg;
+	MonoInst *leader = e->ins;
+
+	if (!get_vreg_to_inst (cfg, leader->dreg)) {
+		/* The value is now live across bblocks */
+		if (state->is_obj [leader->dreg])
+			mono_compile_create_var_for_vreg (cfg, &mono_defaults.object_class->byval_arg, OP_LOCAL, leader->dreg);
+		else
+			mono_compile_create_var_for_vreg (cfg, &mono_defaults.int_class->byval_arg, OP_LOCAL, leader->dreg);
+	}
+
+	if (cfg->verbose_level > 1) {
+		printf ("GVN in BB%d, R%d is redundant with R%d from BB%d: ", bb->block_num, ins->dreg, leader->dreg, e->bb->block_num);
+		mono_print_ins (ins);
+	}
+
+	ins->opcode = OP_MOVE;
+	ins->sreg1 = leader->dreg;
+	ins->sreg2 = -1;
+	ins->flags &= ~(MONO_INST_FAULT | MONO_INST_INVARIANT_LOAD);
+	state->vn [ins->dreg] = leader->dreg;
+	cfg->stat_gvn_eliminated ++;
+}
+
+static void
+gvn_visit_bb (GVNState *state, MonoBasicBlock *bb, int mem_gen)
+{
+	MonoCompile *cfg = state->cfg;
+	MonoInst *ins;
+	GSList *l;
+	int scope_len = state->scope->len;
+	int loads_len = state->loads->len;
+	int killed_len = state->killed->len;
+	int i;
+
+	for (ins = bb->code; ins; ins = ins->next) {
+		const char *spec = INS_INFO (ins->opcode);
+		GVNEntry key, *e;
+		gboolean is_load = FALSE;
+
+		if (ins->opcode == OP_NOP || MONO_IS_PHI (ins))
+			continue;
+
+		if (MONO_IS_STORE_MEMBASE (ins) && ins->opcode != OP_STOREV_MEMBASE && !(ins->opcode >= OP_ATOMIC_STORE_I1 && ins->opcode <= OP_ATOMIC_STORE_R8)) {
+			gvn_kill_loads (state, ins);
+			continue;
+		}
+		if (gvn_writes_memory (ins)) {
+			mem_gen = state->next_gen ++;
+			continue;
+		}
+
+		if (spec [MONO_INST_DEST] != 'i' || ins->dreg >= state->nvregs || state->vn [ins->dreg] != ins->dreg)
+			continue;
+		if (spec [MONO_INST_SRC1] != ' ' && spec [MONO_INST_SRC1] != 'i')
+			continue;
+		if (spec [MONO_INST_SRC2] != ' ' && spec [MONO_INST_SRC2] != 'i')
+			continue;
+
+		memset (&key, 0, sizeof (key));
+		key.opcode = ins->opcode;
+		key.vn1 = spec [MONO_INST_SRC1] != ' ' ? gvn_get_vn (state, ins->sreg1) : -2;
+		key.vn2 = spec [MONO_INST_SRC2] != ' ' ? gvn_get_vn (state, ins->sreg2) : -2;
+		key.mem_gen = -1;
+		if (key.vn1 == -1 || key.vn2 == -1)
+			continue;
+
+		if (gvn_is_pure (ins)) {
+			if (gvn_is_commutative (ins->opcode) && key.vn1 > key.vn2) {
+				int tmp = key.vn1;
+
+				key.vn1 = key.vn2;
+				key.vn2 = tmp;
+			}
+			if (spec [MONO_INST_SRC2] == ' ')
+				key.imm = ins->inst_imm;
+		} else if (ins->opcode == OP_LDLEN || ins->opcode == OP_STRLEN) {
+			/* The length of arrays and strings never changes */
+		} else if (gvn_is_load (ins)) {
+			is_load = TRUE;
+			key.imm = ins->inst_offset;
+			key.size = gvn_mem_size (ins);
+			key.obj_base = state->is_obj [ins->sreg1];
+			/* The vtable of an object never changes */
+			if (!(ins->flags & MONO_INST_INVARIANT_LOAD) && !(ins->opcode == OP_LOAD_MEMBASE && key.obj_base && ins->inst_offset == MONO_STRUCT_OFFSET (MonoObject, vtable)))
+				key.mem_gen = mem_gen;
+		} else {
+			continue;
+		}
+
+		e = (GVNEntry *)g_hash_table_lookup (state->table, &key);
+		if (e && !e->killed && e->mem_gen == key.mem_gen && e->bb->region == bb->region) {
+			gvn_replace (state, e, bb, ins);
+			continue;
+		}
+
+		if (state->defs [ins->dreg] != 1)
+			continue;
+		e = (GVNEntry *)mono_mempool_alloc0 (cfg->mempool, sizeof (GVNEntry));
+		*e = key;
+		e->ins = ins;
+		e->bb = bb;
+		e->prev = (GVNEntry *)g_hash_table_lookup (state->table, &key);
+		g_hash_table_replace (state->table, e, e);
+		g_ptr_array_add (state->scope, e);
+		if (is_load)
+			g_ptr_array_add (state->loads, e);
+	}
+
+	for (l = bb->dominated; l; l = l->next) {
+		MonoBasicBlock *child = (MonoBasicBlock *)l->data;
+
+		gvn_visit_bb (state, child, gvn_region_writes (state, child) ? state->next_gen ++ : mem_gen);
+	}
+
+	/* Restore the state at the entry of BB */
+	for (i = state->killed->len - 1; i >= killed_len; --i)
+		((GVNEntry *)g_ptr_array_index (state->killed, i))->killed = FALSE;
+	g_ptr_array_set_size (state->killed, killed_len);
+	g_ptr_array_set_size (state->loads, loads_len);
+	for (i = state->scope->len - 1; i >= scope_len; --i) {
+		GVNEntry *e = (GVNEntry *)g_ptr_array_index (state->scope, i);
+
+		if (e->prev)
+			g_hash_table_replace (state->table, e->prev, e->prev);
+		else
+			g_hash_table_remove (state->table, e);
+	}
+	g_ptr_array_set_size (state->scope, scope_len);
+}
+
+/*
+ * mono_ssa_gvn:
+ *
+ *   Dominator based global value numbering. A computation is redundant if an
+ * equivalent one dominates it, so the walk of the dominator tree keeps a scoped
+ * table of the available values, keyed by the opcode, the value numbers of the
+ * sregs and the immediate or offset. The value number of a single def vreg is
+ * the vreg of the first computation of its value. Pure integer operations, array
+ * and string lengths, vtable loads and invariant loads are always available.
+ * Other loads are killed by calls and unknown instructions, and by the stores
+ * which might alias them: accesses at disjoint offsets from the same base or from
+ * two object references don't alias. Locals whose address is taken are not in
+ * SSA form, so their loads and stores are not numbered. Redundant instructions
+ * are replaced by moves from the first computation, which is made a variable.
+ */
+void
+mono_ssa_gvn (MonoCompile *cfg)
+{
+	MonoBasicBlock *bb;
+	MonoInst *ins;
+	GVNState state;
+	int i, nedges;
+
+	g_assert (cfg->comp_done & MONO_COMP_SSA);
+	if (!(cfg->comp_done & MONO_COMP_IDOM))
+		return;
+
+	memset (&state, 0, sizeof (state));
+	state.cfg = cfg;
+	state.nvregs = cfg->next_vreg;
+	state.defs = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * state.nvregs);
+	state.vn = (int *)mono_mempool_alloc (cfg->mempool, sizeof (int) * state.nvregs);
+	state.is_obj = (gboolean *)mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * state.nvregs);
+	state.writes = (gboolean *)mono_mempool_alloc0 (cfg->mempool, sizeof (gboolean) * cfg->num_bblocks);
+	state.visited = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * cfg->num_bblocks);
+
+	nedges = 0;
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		nedges += bb->in_count;
+		for (ins = bb->code; ins; ins = ins->next) {
+			const char *spec = INS_INFO (ins->opcode);
+
+			if (ins->opcode == OP_NOP)
+				continue;
+			if (gvn_writes_memory (ins))
+				state.writes [bb->block_num] = TRUE;
+			if (MONO_IS_STORE_MEMBASE (ins) || MONO_IS_STORE_MEMINDEX (ins))
+				continue;
+			if ((spec [MONO_INST_DEST] != ' ' || MONO_IS_PHI (ins)) && ins->dreg >= 0 && ins->dreg < state.nvregs) {
+				state.defs [ins->dreg] ++;
+				if (ins->type == STACK_OBJ)
+					state.is_obj [ins->dreg] = TRUE;
+			}
+		}
+	}
+
+	for (i = 0; i < state.nvregs; ++i) {
+		MonoInst *var = get_vreg_to_inst (cfg, i);
+
+		if (var) {
+			state.is_obj [i] = !var->inst_vtype->byref && MONO_TYPE_IS_REFERENCE (var->inst_vtype);
+			if (var->flags & (MONO_INST_VOLATILE|MONO_INST_INDIRECT)) {
+				state.vn [i] = -1;
+				continue;
+			}
+		} else if (state.defs [i] != 1) {
+			state.is_obj [i] = FALSE;
+		}
+		state.vn [i] = (i >= MONO_MAX_IREGS && state.defs [i] <= 1) ? i : -1;
+	}
+
+	state.stack = (MonoBasicBlock **)mono_mempool_alloc (cfg->mempool, sizeof (MonoBasicBlock*) * (nedges + 1));
+	state.table = g_hash_table_new (gvn_entry_hash, gvn_entry_equal);
+	state.scope = g_ptr_array_new ();
+	state.loads = g_ptr_array_new ();
+	state.killed = g_ptr_array_new ();
+	state.next_gen = 1;
+
+	gvn_visit_bb (&state, cfg->bb_entry, 0);
+
+	g_hash_table_destroy (state.table);
+	g_ptr_array_free (state.scope, TRUE);
+	g_ptr_array_free (state.loads, TRUE);
+	g_ptr_array_free (state.killed, TRUE);
+
+	/* The def-use chains are stale */
+	cfg->comp_done &= ~MONO_COMP_SSA_DEF_USE;
+	for (i = 0; i < cfg->num_varinfo; i++) {
+		MonoMethodVar *info = MONO_VARINFO (cfg, i);
+		info->def = NULL;
+		info->uses = NULL;
+	}
+}
+
 #endif /* DISABLE_JIT */
@@ -33,6 +33,29 @@
 
 #define IS_REX(inst) (((inst) >= 0x40) && ((inst) <= 0x4f))
 
+/*
+ * The specific trampolines of the root domain are allocated from prebuilt trampoline
+ * pages, like the AOT trampoline pages. A block of 2 * TRAMP_PAGE_SIZE bytes holds a data
+ * page followed by a code page filled with stubs calling the generic trampoline of one
+ * trampoline type. The argument of the stub at offset O of the code page is stored at
+ * offset O of the data page, so creating a trampoline is just a store to its data slot,
+ * without code generation or icache flushes.
+ */
+#define TRAMP_PAGE_SIZE 4096
+#define TRAMP_PAGE_STUB_SIZE 8
+#define TRAMP_PAGE_NUM_STUBS (TRAMP_PAGE_SIZE / TRAMP_PAGE_STUB_SIZE)
+
+typedef struct {
+	/* The start of the current code page */
+	guint8 *code;
+	/* The index of the next free stub */
+	int next;
+	/* Set if the generic trampoline can't be reached from the pages */
+	gboolean disabled;
+} TrampPage;
+
+static TrampPage tramp_pages [MONO_TRAMPOLINE_NUM];
+
 /*
  * mono_arch_get_unbox_trampoline:
  * @m: method pointer
@@ -134,6 +157,7 @@ mono_arch_patch_callsite (guint8 *method_start, guint8 *orig_code, guint8 *addr)
 	/* mov 64-bit imm into r11 (followed by call reg?)  or direct call*/
 	if (((code [-13] == 0x49) && (code [-12] == 0xbb)) || (code [-5] == 0xe8)) {
 		if (code [-5] != 0xe8) {
+			/* emit_call_body () aligns the immediate to 8 bytes, so this store is atomic */
 			if (can_write) {
 				InterlockedExchangePointer ((gpointer*)(orig_code - 11), addr);
 				VALGRIND_DISCARD_TRANSLATIONS (orig_code - 11, sizeof (gpointer));
@@ -171,6 +195,29 @@ mono_arch_patch_callsite (guint8 *method_start, guint8 *orig_code, guint8 *addr)
 	}
 }
 
+/*
+ * mono_arch_patch_class_init_site:
+ *
+ *   Replace the initialized check of a patchable OP_GENERIC_CLASS_INIT sequence
+ * starting at SITE with a jump to END, the end of the sequence. SITE is 2 byte
+ * aligned, so other threads see either the check or the jump.
+ */
+void
+mono_arch_patch_class_init_site (guint8 *site, guint8 *end)
+{
+	guint8 buf [2];
+	guint8 *code = buf;
+
+	g_assert (!((gsize)site & 1));
+	g_assert (end - (site + 2) <= 127);
+
+	x86_jump8 (code, end - (site + 2));
+	/* Aligned 2 byte stores are atomic */
+	*(volatile gint16*)site = *(gint16*)buf;
+	mono_arch_flush_icache (site, 2);
+	VALGRIND_DISCARD_TRANSLATIONS (site, 2);
+}
+
 guint8*
 mono_arch_create_llvm_native_thunk (MonoDomain *domain, guint8 *addr)
 {
@@ -219,13 +266,13 @@ guchar*
 mono_arch_create_generic_trampoline (MonoTrampolineType tramp_type, MonoTrampInfo **info, gboolean aot)
 {
 	char *tramp_name;
-	guint8 *buf, *code, *tramp, *br [2], *r11_save_code, *after_r11_save_code, *br_ex_check;
+	guint8 *buf, *code, *tramp, *br [4], *r11_save_code, *after_r11_save_code, *br_ex_check;
 	int i, lmf_offset, offset, res_offset, arg_offset, rax_offset, ex_offset, tramp_offset, ctx_offset, saved_regs_offset;
 	int r11_save_offset, saved_fpregs_offset, rbp_offset, framesize, orig_rsp_to_rbp_offset, cfa_offset;
 	gboolean has_caller;
 	GSList *unwind_ops = NULL;
 	MonoJumpInfo *ji = NULL;
-	const guint kMaxCodeSize = 630;
+	const guint kMaxCodeSize = 650;
 
 	if (tramp_type == MONO_TRAMPOLINE_JUMP || tramp_type == MONO_TRAMPOLINE_HANDLER_BLOCK_GUARD)
 		has_caller = FALSE;
@@ -393,10 +440,19 @@ mono_arch_create_generic_trampoline (MonoTrampolineType tramp_type, MonoTrampInf
 			amd64_mov_reg_membase (code, AMD64_R11, AMD64_R11, 6, 4);
 			br [1] = code;
 			x86_jump8 (code, 10);
-			/* 64 bit immediate */
 			mono_amd64_patch (br [0], code);
+			amd64_alu_reg_imm_size (code, X86_CMP, AMD64_RAX, 8, 1);
+			br [2] = code;
+			x86_branch8 (code, X86_CC_NE, 6, FALSE);
+			/* 64 bit immediate */
 			amd64_mov_reg_membase (code, AMD64_R11, AMD64_R11, 6, 8);
+			br [3] = code;
+			x86_jump8 (code, 10);
+			/* Trampoline page, the argument is in the data page, see create_page_trampoline () */
+			mono_amd64_patch (br [2], code);
+			amd64_mov_reg_membase (code, AMD64_R11, AMD64_R11, -TRAMP_PAGE_SIZE, 8);
 			mono_amd64_patch (br [1], code);
+			mono_amd64_patch (br [3], code);
 		}
 		amd64_mov_membase_reg (code, AMD64_RBP, arg_offset, AMD64_R11, sizeof(gpointer));
 	} else {
@@ -557,6 +613,54 @@ mono_arch_create_generic_trampoline (MonoTrampolineType tramp_type, MonoTrampInf
 	return buf;
 }
 
+/*
+ * create_page_trampoline:
+ *
+ *   Return a stub from the trampoline pages of TRAMP_TYPE, whose argument is ARG1, or NULL
+ * if they can't be used.
+ */
+static guint8*
+create_page_trampoline (gpointer arg1, MonoTrampolineType tramp_type, MonoDomain *domain)
+{
+	TrampPage *page = &tramp_pages [tramp_type];
+	guint8 *code, *tramp;
+	int i;
+
+	if (page->disabled)
+		return NULL;
+
+	mono_domain_lock (domain);
+	if (!page->code || page->next == TRAMP_PAGE_NUM_STUBS) {
+		tramp = mono_get_trampoline_code (tramp_type);
+		code = (guint8 *)mono_global_codeman_reserve (2 * TRAMP_PAGE_SIZE) + TRAMP_PAGE_SIZE;
+		if (!amd64_is_imm32 ((gint64)tramp - (gint64)code) || !amd64_is_imm32 ((gint64)tramp - (gint64)(code + TRAMP_PAGE_SIZE))) {
+			page->disabled = TRUE;
+			mono_domain_unlock (domain);
+			return NULL;
+		}
+
+		for (i = 0; i < TRAMP_PAGE_NUM_STUBS; ++i) {
+			guint8 *stub = code + (i * TRAMP_PAGE_STUB_SIZE);
+
+			amd64_call_code (stub, tramp);
+			/* Tells the generic trampoline to load the argument from the data page */
+			*stub = 0;
+		}
+		mono_arch_flush_icache (code, TRAMP_PAGE_SIZE);
+		mono_profiler_code_buffer_new (code, TRAMP_PAGE_SIZE, MONO_PROFILER_CODE_BUFFER_SPECIFIC_TRAMPOLINE, mono_get_generic_trampoline_simple_name (tramp_type));
+
+		page->code = code;
+		page->next = 0;
+	}
+
+	code = page->code + (page->next * TRAMP_PAGE_STUB_SIZE);
+	page->next ++;
+	*(gpointer*)(code - TRAMP_PAGE_SIZE) = arg1;
+	mono_domain_unlock (domain);
+
+	return code;
+}
+
 gpointer
 mono_arch_create_specific_trampoline (gpointer arg1, MonoTrampolineType tramp_type, MonoDomain *domain, guint32 *code_len)
 {
@@ -564,6 +668,16 @@ mono_arch_create_specific_trampoline (gpointer arg1, MonoTrampolineType tramp_ty
 	int size;
 	gboolean far_addr = FALSE;
 
+	/* The pages are never freed, so only use them for trampolines which are never freed either */
+	if (domain == mono_get_root_domain ()) {
+		code = create_page_trampoline (arg1, tramp_type, domain);
+		if (code) {
+			if (code_len)
+				*code_len = TRAMP_PAGE_STUB_SIZE;
+			return code;
+		}
+	}
+
 	tramp = mono_get_trampoline_code (tramp_type);
 
 	if ((((guint64)arg1) >> 32) == 0)
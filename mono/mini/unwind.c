@@ -486,6 +486,95 @@ typedef struct {
 	int cfa_reg, cfa_offset;
 } UnwindState;
 
+/*
+ * Cache of the result of decoding the unwind ops up to an ip, keyed by the unwind info
+ * and the offset of the ip. Stack walks mostly see the same call sites, so most frames
+ * don't need to be decoded. The cache is direct mapped and bounded in size. It is
+ * used from signal handlers, so it doesn't allocate or take locks: each entry has a
+ * sequence number which is odd while it is being written, readers which see it change
+ * ignore the entry.
+ */
+#define UNWIND_CACHE_SIZE 1024
+#define UNWIND_CACHE_MAX_SAVED_REGS 16
+
+typedef struct {
+	gint32 seq;
+	guint8 *unwind_info;
+	guint32 unwind_info_len;
+	guint32 ip_offset;
+	int cfa_reg, cfa_offset;
+	int nsaved;
+	guint8 saved_regs [UNWIND_CACHE_MAX_SAVED_REGS];
+	int saved_offsets [UNWIND_CACHE_MAX_SAVED_REGS];
+} UnwindCacheEntry;
+
+static UnwindCacheEntry unwind_cache [UNWIND_CACHE_SIZE];
+/* Statistics */
+static gint32 unwind_cache_hits, unwind_cache_misses;
+
+static inline UnwindCacheEntry*
+unwind_cache_get_entry (guint8 *unwind_info, guint32 ip_offset)
+{
+	gsize hash = ((gsize)unwind_info >> 2) ^ (ip_offset * 2654435761U);
+
+	return &unwind_cache [(hash ^ (hash >> 10)) % UNWIND_CACHE_SIZE];
+}
+
+static gboolean
+unwind_cache_lookup (guint8 *unwind_info, guint32 unwind_info_len, guint32 ip_offset, int *cfa_reg, int *cfa_offset,
+					 int *nsaved, guint8 *saved_regs, int *saved_offsets)
+{
+	UnwindCacheEntry *entry = unwind_cache_get_entry (unwind_info, ip_offset);
+	gint32 seq;
+	int i, n;
+
+	seq = entry->seq;
+	if (seq & 1)
+		return FALSE;
+	mono_memory_read_barrier ();
+	if (entry->unwind_info != unwind_info || entry->unwind_info_len != unwind_info_len || entry->ip_offset != ip_offset)
+		return FALSE;
+	*cfa_reg = entry->cfa_reg;
+	*cfa_offset = entry->cfa_offset;
+	n = entry->nsaved;
+	if (n > UNWIND_CACHE_MAX_SAVED_REGS)
+		return FALSE;
+	for (i = 0; i < n; ++i) {
+		saved_regs [i] = entry->saved_regs [i];
+		saved_offsets [i] = entry->saved_offsets [i];
+	}
+	*nsaved = n;
+	mono_memory_read_barrier ();
+	return entry->seq == seq;
+}
+
+static void
+unwind_cache_add (guint8 *unwind_info, guint32 unwind_info_len, guint32 ip_offset, int cfa_reg, int cfa_offset,
+				  int nsaved, guint8 *saved_regs, int *saved_offsets)
+{
+	UnwindCacheEntry *entry = unwind_cache_get_entry (unwind_info, ip_offset);
+	gint32 seq;
+	int i;
+
+	seq = entry->seq;
+	/* Another thread, or the code interrupted by this signal handler, is writing it */
+	if ((seq & 1) || InterlockedCompareExchange (&entry->seq, seq + 1, seq) != seq)
+		return;
+	mono_memory_write_barrier ();
+	entry->unwind_info = unwind_info;
+	entry->unwind_info_len = unwind_info_len;
+	entry->ip_offset = ip_offset;
+	entry->cfa_reg = cfa_reg;
+	entry->cfa_offset = cfa_offset;
+	entry->nsaved = nsaved;
+	for (i = 0; i < nsaved; ++i) {
+		entry->saved_regs [i] = saved_regs [i];
+		entry->saved_offsets [i] = saved_offsets [i];
+	}
+	mono_memory_write_barrier ();
+	entry->seq = seq + 2;
+}
+
 /*
  * Given the state of the current frame as stored in REGS, execute the unwind 
  * operations in unwind_info until the location counter reaches POS. The result is 
@@ -510,6 +599,17 @@ mono_unwind_frame (guint8 *unwind_info, guint32 unwind_info_len,
 	guint8 *cfa_val;
 	UnwindState state_stack [1];
 	int state_stack_pos;
+	guint8 saved_regs [NUM_HW_REGS];
+	int saved_offsets [NUM_HW_REGS];
+	int i, nsaved;
+	guint32 ip_offset = ip - start_ip;
+	gboolean cacheable = TRUE;
+
+	if (unwind_cache_lookup (unwind_info, unwind_info_len, ip_offset, &cfa_reg, &cfa_offset, &nsaved, saved_regs, saved_offsets)) {
+		unwind_cache_hits ++;
+		goto apply;
+	}
+	unwind_cache_misses ++;
 
 	memset (reg_saved, 0, sizeof (reg_saved));
 	state_stack [0].cfa_reg = -1;
@@ -603,6 +703,8 @@ mono_unwind_frame (guint8 *unwind_info, guint32 unwind_info_len,
 			case DW_CFA_mono_advance_loc:
 				g_assert (mark_locations [0]);
 				pos = mark_locations [0] - start_ip;
+				/* The result depends on MARK_LOCATIONS */
+				cacheable = FALSE;
 				break;
 			default:
 				g_assert_not_reached ();
@@ -614,22 +716,37 @@ mono_unwind_frame (guint8 *unwind_info, guint32 unwind_info_len,
 		}
 	}
 
+	nsaved = 0;
+	for (hwreg = 0; hwreg < NUM_HW_REGS; ++hwreg) {
+		if (reg_saved [hwreg] && locations [hwreg].loc_type == LOC_OFFSET) {
+			saved_regs [nsaved] = hwreg;
+			saved_offsets [nsaved] = locations [hwreg].offset;
+			nsaved ++;
+		}
+	}
+
+	g_assert (cfa_reg != -1);
+	if (cacheable && nsaved <= UNWIND_CACHE_MAX_SAVED_REGS)
+		unwind_cache_add (unwind_info, unwind_info_len, ip_offset, cfa_reg, cfa_offset, nsaved, saved_regs, saved_offsets);
+
+ apply:
 	if (save_locations)
 		memset (save_locations, 0, save_locations_len * sizeof (mgreg_t*));
 
 	g_assert (cfa_reg != -1);
 	cfa_val = (guint8*)regs [mono_dwarf_reg_to_hw_reg (cfa_reg)] + cfa_offset;
-	for (hwreg = 0; hwreg < NUM_HW_REGS; ++hwreg) {
-		if (reg_saved [hwreg] && locations [hwreg].loc_type == LOC_OFFSET) {
-			int dwarfreg = mono_hw_reg_to_dwarf_reg (hwreg);
-			g_assert (hwreg < nregs);
-			if (IS_DOUBLE_REG (dwarfreg))
-				regs [hwreg] = *(guint64*)(cfa_val + locations [hwreg].offset);
-			else
-				regs [hwreg] = *(mgreg_t*)(cfa_val + locations [hwreg].offset);
-			if (save_locations && hwreg < save_locations_len)
-				save_locations [hwreg] = (mgreg_t*)(cfa_val + locations [hwreg].offset);
-		}
+	for (i = 0; i < nsaved; ++i) {
+		int dwarfreg;
+
+		hwreg = saved_regs [i];
+		dwarfreg = mono_hw_reg_to_dwarf_reg (hwreg);
+		g_assert (hwreg < nregs);
+		if (IS_DOUBLE_REG (dwarfreg))
+			regs [hwreg] = *(guint64*)(cfa_val + saved_offsets [i]);
+		else
+			regs [hwreg] = *(mgreg_t*)(cfa_val + saved_offsets [i]);
+		if (save_locations && hwreg < save_locations_len)
+			save_locations [hwreg] = (mgreg_t*)(cfa_val + saved_offsets [i]);
 	}
 
 	*out_cfa = cfa_val;
@@ -641,6 +758,8 @@ mono_unwind_init (void)
 	mono_os_mutex_init_recursive (&unwind_mutex);
 
 	mono_counters_register ("Unwind info size", MONO_COUNTER_JIT | MONO_COUNTER_INT, &unwind_info_size);
+	mono_counters_register ("Unwind cache hits", MONO_COUNTER_JIT | MONO_COUNTER_INT, &unwind_cache_hits);
+	mono_counters_register ("Unwind cache misses", MONO_COUNTER_JIT | MONO_COUNTER_INT, &unwind_cache_misses);
 }
 
 void
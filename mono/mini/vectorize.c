@@ -0,0 +1,1039 @@
+/*
+ * vectorize.c: Vectorization of simple array loops
+ *
+ * The pass recognizes innermost counted loops which step an int32 index by one and
+ * access one element of one or more arrays per iteration at the index, like
+ *
+ *   for (int i = 0; i < a.Length; ++i)
+ *       c [i] = a [i] + b [i];
+ *
+ * and adds a vector copy of the loop in front of them, which processes as many elements
+ * per iteration as fit into a SIMD register using the packed OP_ opcodes, or the 256 bit
+ * OP_Y opcodes on amd64 cpus with AVX2. The vector loop
+ * only runs while all the elements accessed by the next iteration are within the bounds
+ * of the arrays, so it contains no bounds checks. The original loop stays in place and
+ * handles the remaining elements, along with any exceptions.
+ *
+ * The pass runs on the IR after mono_handle_global_vregs (), before the conversion to
+ * SSA form, so SSA and the array bounds check removal see the vector loop too. It only
+ * handles loops whose bodies consist of element loads and stores, constants, invariant
+ * values, and additions, subtractions, multiplications, and the bitwise operations, see
+ * process_ins ().
+ *
+ * The pass is only built for x86 and amd64. AVX-512 is detected but not used, and arm64
+ * has no lowering to NEON yet, since its backend has no SIMD register bank.
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include "config.h"
+
+#include <mono/metadata/abi-details.h>
+
+#include "mini.h"
+#include "ir-emit.h"
+
+#ifndef DISABLE_JIT
+
+#if defined(MONO_ARCH_SIMD_INTRINSICS) && (defined(TARGET_X86) || defined(TARGET_AMD64))
+
+/* The size of the SSE vector registers */
+#define VECTOR_SIZE 16
+
+/* The maximum number of instructions in the body of a vectorized loop */
+#define MAX_BODY_INS 64
+
+typedef enum {
+	VAL_NONE,
+	/* The induction variable, possibly sign extended */
+	VAL_INDEX,
+	/* The induction variable plus one */
+	VAL_INDEX_NEXT,
+	/* The address of the current element of an array */
+	VAL_ADDR,
+	/* A value computed for the current element */
+	VAL_LANE,
+	/* An integer constant */
+	VAL_CONST,
+	/* A floating point constant */
+	VAL_FCONST,
+	/* A copy of a variable which is not changed by the loop */
+	VAL_INVARIANT,
+	/* The length of an array which is not changed by the loop */
+	VAL_LEN
+} VecValueKind;
+
+typedef struct {
+	guint8 kind;
+	guint8 is_float;
+	/* Whenever the lane value can be computed in single precision without changing the result */
+	guint8 exact;
+	/* The array of VAL_ADDR/VAL_LEN, the source of VAL_INVARIANT */
+	int src;
+	/* The instruction defining VAL_CONST/VAL_FCONST values */
+	MonoInst *def;
+	/* The vreg holding the value in the vector loop */
+	int vreg;
+} VecValue;
+
+typedef struct {
+	MonoCompile *cfg;
+	/* The bblock containing the loop condition */
+	MonoBasicBlock *header;
+	/* The second bblock of two bblock loops, the header for one bblock loops */
+	MonoBasicBlock *latch;
+	MonoBasicBlock *preheader;
+	/* The body of the vector loop, not yet linked into the cfg */
+	MonoBasicBlock *vbody;
+	/* The induction variable */
+	int iv;
+	/* The index register in the vector loop */
+	int index_reg;
+	int esize;
+	/* The size of the vectors, VECTOR_SIZE or 32 if 256 bit vectors are used */
+	int vsize;
+	/* The target of the branches leaving the vector loop */
+	MonoBasicBlock *exit;
+	gboolean has_store;
+	gboolean incremented;
+	/* The bound of the loop, a variable or an immediate, or the length of BOUND_ARRAY */
+	int bound_reg;
+	int bound_imm;
+	int bound_array;
+	/* The vregs of the arrays accessed by the loop */
+	GSList *arrays;
+	int nvregs;
+	VecValue *values;
+	int ninstrs;
+} VecLoop;
+
+static gboolean
+is_var (VecLoop *loop, int vreg)
+{
+	return vreg >= 0 && vreg < loop->nvregs && get_vreg_to_inst (loop->cfg, vreg) != NULL;
+}
+
+/*
+ * invariant_source:
+ *
+ *   Return the variable holding the value of VREG if it is not changed by the loop,
+ * -1 otherwise. Since the loop can't define any variable other than the induction
+ * variable, every other variable it reads is invariant.
+ */
+static int
+invariant_source (VecLoop *loop, int vreg)
+{
+	if (vreg < 0 || vreg >= loop->nvregs || vreg == loop->iv)
+		return -1;
+	if (loop->values [vreg].kind == VAL_INVARIANT)
+		return loop->values [vreg].src;
+	if (loop->values [vreg].kind == VAL_NONE && is_var (loop, vreg))
+		return vreg;
+	return -1;
+}
+
+static gboolean
+is_invariant_array (VecLoop *loop, int vreg)
+{
+	int src = invariant_source (loop, vreg);
+
+	return src != -1 && src == vreg && get_vreg_to_inst (loop->cfg, src)->type == STACK_OBJ;
+}
+
+static void
+add_array (VecLoop *loop, int vreg)
+{
+	if (!g_slist_find (loop->arrays, GINT_TO_POINTER (vreg)))
+		loop->arrays = g_slist_append_mempool (loop->cfg->mempool, loop->arrays, GINT_TO_POINTER (vreg));
+}
+
+static int
+get_vector_size (MonoCompile *cfg)
+{
+#ifdef MONO_ARCH_SIMD256
+	/* AOT code can run on a different cpu */
+	if (!cfg->compile_aot && (mono_arch_cpu_enumerate_simd_versions () & SIMD_VERSION_AVX2))
+		return 32;
+#endif
+	return VECTOR_SIZE;
+}
+
+/*
+ * vector_opcode:
+ *
+ *   Return the variant of the 128 bit vector opcode OPCODE matching the vector size
+ * of LOOP.
+ */
+static int
+vector_opcode (VecLoop *loop, int opcode)
+{
+#ifdef MONO_ARCH_SIMD256
+	if (loop->vsize == 32) {
+		switch (opcode) {
+		case OP_LOADX_MEMBASE:
+			return OP_LOADY_MEMBASE;
+		case OP_STOREX_MEMBASE:
+			return OP_STOREY_MEMBASE;
+		case OP_PADDB:
+			return OP_YPADDB;
+		case OP_PADDW:
+			return OP_YPADDW;
+		case OP_PADDD:
+			return OP_YPADDD;
+		case OP_PSUBB:
+			return OP_YPSUBB;
+		case OP_PSUBW:
+			return OP_YPSUBW;
+		case OP_PSUBD:
+			return OP_YPSUBD;
+		case OP_PAND:
+			return OP_YPAND;
+		case OP_POR:
+			return OP_YPOR;
+		case OP_PXOR:
+			return OP_YPXOR;
+		case OP_PMULW:
+			return OP_YPMULW;
+		case OP_PMULD:
+			return OP_YPMULD;
+		case OP_ADDPS:
+			return OP_YADDPS;
+		case OP_SUBPS:
+			return OP_YSUBPS;
+		case OP_MULPS:
+			return OP_YMULPS;
+		case OP_DIVPS:
+			return OP_YDIVPS;
+		case OP_EXPAND_I1:
+			return OP_YEXPAND_I1;
+		case OP_EXPAND_I2:
+			return OP_YEXPAND_I2;
+		case OP_EXPAND_I4:
+			return OP_YEXPAND_I4;
+		case OP_EXPAND_R4:
+			return OP_YEXPAND_R4;
+		default:
+			g_assert_not_reached ();
+		}
+	}
+#endif
+	return opcode;
+}
+
+static int
+emit_vector_ins (VecLoop *loop, int opcode, int sreg1, int sreg2)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *ins;
+
+	MONO_INST_NEW (cfg, ins, vector_opcode (loop, opcode));
+	ins->dreg = alloc_ireg (cfg);
+	ins->sreg1 = sreg1;
+	ins->sreg2 = sreg2;
+	ins->type = STACK_VTYPE;
+	MONO_ADD_INS (loop->vbody, ins);
+	return ins->dreg;
+}
+
+static int
+emit_expand (VecLoop *loop, int sreg, gboolean is_float)
+{
+	MonoCompile *cfg = loop->cfg;
+	int opcode;
+	int dreg;
+
+	if (is_float)
+		opcode = OP_EXPAND_R4;
+	else if (loop->esize == 1)
+		opcode = OP_EXPAND_I1;
+	else if (loop->esize == 2)
+		opcode = OP_EXPAND_I2;
+	else
+		opcode = OP_EXPAND_I4;
+
+	dreg = emit_vector_ins (loop, opcode, sreg, -1);
+	if (opcode == OP_EXPAND_R4)
+		loop->vbody->last_ins->backend.spill_var = mini_get_int_to_float_spill_area (cfg);
+	return dreg;
+}
+
+static int
+emit_expand_imm (VecLoop *loop, gssize imm)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoInst *ins;
+
+	MONO_INST_NEW (cfg, ins, OP_ICONST);
+	ins->dreg = alloc_ireg (cfg);
+	ins->inst_c0 = imm;
+	ins->type = STACK_I4;
+	MONO_ADD_INS (loop->vbody, ins);
+	return emit_expand (loop, ins->dreg, FALSE);
+}
+
+/*
+ * get_lane:
+ *
+ *   Return the vreg holding VREG for each element in the vector loop, broadcasting
+ * constants and invariant values. If NEED_EXACT is set, floating point values have
+ * to be exactly representable in single precision, since the scalar loop computes in
+ * double precision unless cfg->r4fp is set. Return -1 if VREG can't be vectorized.
+ */
+static int
+get_lane (VecLoop *loop, int vreg, gboolean is_float, gboolean need_exact)
+{
+	MonoCompile *cfg = loop->cfg;
+	VecValue *val;
+	int src;
+
+	if (vreg < 0 || vreg >= loop->nvregs)
+		return -1;
+	val = &loop->values [vreg];
+
+	switch (val->kind) {
+	case VAL_LANE:
+		if (val->is_float != is_float)
+			return -1;
+		if (is_float && need_exact && !val->exact && !cfg->r4fp)
+			return -1;
+		return val->vreg;
+	case VAL_CONST:
+		if (is_float)
+			return -1;
+		if (!val->vreg)
+			val->vreg = emit_expand_imm (loop, val->def->inst_c0);
+		return val->vreg;
+	case VAL_FCONST: {
+		MonoInst *ins;
+
+		if (!is_float)
+			return -1;
+		if (!val->vreg) {
+			MONO_INST_NEW (cfg, ins, val->def->opcode);
+			ins->dreg = alloc_freg (cfg);
+			ins->inst_p0 = val->def->inst_p0;
+			ins->type = val->def->type;
+			MONO_ADD_INS (loop->vbody, ins);
+			val->vreg = emit_expand (loop, ins->dreg, TRUE);
+		}
+		return val->vreg;
+	}
+	case VAL_NONE:
+	case VAL_INVARIANT:
+		src = invariant_source (loop, vreg);
+		if (src == -1 || is_float || get_vreg_to_inst (cfg, src)->type != STACK_I4)
+			return -1;
+		if (!val->vreg)
+			val->vreg = emit_expand (loop, src, FALSE);
+		return val->vreg;
+	default:
+		return -1;
+	}
+}
+
+static void
+set_lane (VecLoop *loop, int vreg, int xreg, gboolean is_float, gboolean exact)
+{
+	VecValue *val = &loop->values [vreg];
+
+	val->kind = VAL_LANE;
+	val->is_float = is_float;
+	val->exact = exact;
+	val->vreg = xreg;
+}
+
+static int
+int_binop_to_vector_op (VecLoop *loop, int opcode)
+{
+	switch (opcode) {
+	case OP_IADD:
+	case OP_IADD_IMM:
+		return loop->esize == 1 ? OP_PADDB : (loop->esize == 2 ? OP_PADDW : OP_PADDD);
+	case OP_ISUB:
+	case OP_ISUB_IMM:
+		return loop->esize == 1 ? OP_PSUBB : (loop->esize == 2 ? OP_PSUBW : OP_PSUBD);
+	case OP_IMUL:
+	case OP_IMUL_IMM:
+		if (loop->esize == 2)
+			return OP_PMULW;
+		if (loop->esize == 4 && (mono_arch_cpu_enumerate_simd_versions () & SIMD_VERSION_SSE41))
+			return OP_PMULD;
+		return -1;
+	case OP_IAND:
+	case OP_IAND_IMM:
+		return OP_PAND;
+	case OP_IOR:
+	case OP_IOR_IMM:
+		return OP_POR;
+	case OP_IXOR:
+	case OP_IXOR_IMM:
+		return OP_PXOR;
+	default:
+		return -1;
+	}
+}
+
+static int
+float_binop_to_vector_op (int opcode)
+{
+	switch (opcode) {
+	case OP_FADD:
+	case OP_RADD:
+		return OP_ADDPS;
+	case OP_FSUB:
+	case OP_RSUB:
+		return OP_SUBPS;
+	case OP_FMUL:
+	case OP_RMUL:
+		return OP_MULPS;
+	case OP_FDIV:
+	case OP_RDIV:
+		return OP_DIVPS;
+	default:
+		return -1;
+	}
+}
+
+static int
+access_size (int opcode)
+{
+	switch (opcode) {
+	case OP_LOADI1_MEMBASE:
+	case OP_LOADU1_MEMBASE:
+	case OP_STOREI1_MEMBASE_REG:
+	case OP_STOREI1_MEMBASE_IMM:
+		return 1;
+	case OP_LOADI2_MEMBASE:
+	case OP_LOADU2_MEMBASE:
+	case OP_STOREI2_MEMBASE_REG:
+	case OP_STOREI2_MEMBASE_IMM:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
+/*
+ * process_ins:
+ *
+ *   Analyze INS from the body of the loop and emit its vector equivalent into
+ * LOOP->vbody. Return FALSE if the loop can't be vectorized.
+ */
+static gboolean
+process_ins (VecLoop *loop, MonoInst *ins)
+{
+	MonoCompile *cfg = loop->cfg;
+	const char *spec = INS_INFO (ins->opcode);
+	VecValue *values = loop->values;
+	gboolean is_float;
+	int esize, opcode, x1, x2;
+
+	if (ins->opcode == OP_NOP || ins->opcode == OP_IL_SEQ_POINT)
+		return TRUE;
+
+	if (++loop->ninstrs > MAX_BODY_INS)
+		return FALSE;
+
+	if (ins->dreg >= loop->nvregs || ins->sreg1 >= loop->nvregs || ins->sreg2 >= loop->nvregs)
+		return FALSE;
+
+	if (spec [MONO_INST_DEST] != ' ' && !MONO_IS_STORE_MEMBASE (ins) && is_var (loop, ins->dreg)) {
+		/* The only variable the loop can change is the induction variable */
+		if (ins->dreg != loop->iv || loop->incremented)
+			return FALSE;
+		if (ins->opcode == OP_IADD_IMM && ins->sreg1 == loop->iv && ins->inst_imm == 1)
+			;
+		else if (ins->opcode == OP_MOVE && values [ins->sreg1].kind == VAL_INDEX_NEXT)
+			;
+		else
+			return FALSE;
+		loop->incremented = TRUE;
+		return TRUE;
+	}
+
+	/* Only the loop condition can follow the increment */
+	if (loop->incremented && ins->opcode != OP_LDLEN)
+		return FALSE;
+
+	switch (ins->opcode) {
+	case OP_SEXT_I4:
+		if (values [ins->sreg1].kind != VAL_INDEX)
+			return FALSE;
+		values [ins->dreg].kind = VAL_INDEX;
+		break;
+	case OP_IADD_IMM:
+		if (ins->sreg1 == loop->iv && ins->inst_imm == 1) {
+			values [ins->dreg].kind = VAL_INDEX_NEXT;
+			break;
+		}
+		/* Fall through */
+	case OP_ISUB_IMM:
+	case OP_IMUL_IMM:
+	case OP_IAND_IMM:
+	case OP_IOR_IMM:
+	case OP_IXOR_IMM:
+		opcode = int_binop_to_vector_op (loop, ins->opcode);
+		if (opcode == -1)
+			return FALSE;
+		x1 = get_lane (loop, ins->sreg1, FALSE, FALSE);
+		if (x1 == -1)
+			return FALSE;
+		x2 = emit_expand_imm (loop, ins->inst_imm);
+		set_lane (loop, ins->dreg, emit_vector_ins (loop, opcode, x1, x2), FALSE, FALSE);
+		break;
+	case OP_IADD:
+	case OP_ISUB:
+	case OP_IMUL:
+	case OP_IAND:
+	case OP_IOR:
+	case OP_IXOR:
+		opcode = int_binop_to_vector_op (loop, ins->opcode);
+		if (opcode == -1)
+			return FALSE;
+		x1 = get_lane (loop, ins->sreg1, FALSE, FALSE);
+		x2 = get_lane (loop, ins->sreg2, FALSE, FALSE);
+		if (x1 == -1 || x2 == -1)
+			return FALSE;
+		set_lane (loop, ins->dreg, emit_vector_ins (loop, opcode, x1, x2), FALSE, FALSE);
+		break;
+	case OP_FADD:
+	case OP_FSUB:
+	case OP_FMUL:
+	case OP_FDIV:
+	case OP_RADD:
+	case OP_RSUB:
+	case OP_RMUL:
+	case OP_RDIV:
+		if (loop->esize != 4)
+			return FALSE;
+		x1 = get_lane (loop, ins->sreg1, TRUE, TRUE);
+		x2 = get_lane (loop, ins->sreg2, TRUE, TRUE);
+		if (x1 == -1 || x2 == -1)
+			return FALSE;
+		set_lane (loop, ins->dreg, emit_vector_ins (loop, float_binop_to_vector_op (ins->opcode), x1, x2), TRUE, FALSE);
+		break;
+	case OP_ICONV_TO_I1:
+	case OP_ICONV_TO_U1:
+	case OP_ICONV_TO_I2:
+	case OP_ICONV_TO_U2:
+		/* The lanes already truncate the values to the element size */
+		esize = (ins->opcode == OP_ICONV_TO_I1 || ins->opcode == OP_ICONV_TO_U1) ? 1 : 2;
+		if (esize != loop->esize)
+			return FALSE;
+		x1 = get_lane (loop, ins->sreg1, FALSE, FALSE);
+		if (x1 == -1)
+			return FALSE;
+		set_lane (loop, ins->dreg, x1, FALSE, FALSE);
+		break;
+	case OP_FCONV_TO_R4:
+	case OP_RCONV_TO_R4:
+		x1 = get_lane (loop, ins->sreg1, TRUE, FALSE);
+		if (x1 == -1)
+			return FALSE;
+		set_lane (loop, ins->dreg, x1, TRUE, TRUE);
+		break;
+	case OP_MOVE:
+	case OP_FMOVE:
+	case OP_RMOVE:
+		if (values [ins->sreg1].kind == VAL_NONE) {
+			if (invariant_source (loop, ins->sreg1) == -1)
+				return FALSE;
+			values [ins->dreg].kind = VAL_INVARIANT;
+			values [ins->dreg].src = ins->sreg1;
+		} else {
+			values [ins->dreg] = values [ins->sreg1];
+		}
+		break;
+	case OP_ICONST:
+		values [ins->dreg].kind = VAL_CONST;
+		values [ins->dreg].def = ins;
+		break;
+	case OP_R4CONST:
+		values [ins->dreg].kind = VAL_FCONST;
+		values [ins->dreg].def = ins;
+		break;
+	case OP_R8CONST: {
+		double d = *(double*)ins->inst_p0;
+
+		/* EXPAND_R4 expects a single precision value if r4fp is set */
+		if (cfg->r4fp || (double)(float)d != d)
+			return FALSE;
+		values [ins->dreg].kind = VAL_FCONST;
+		values [ins->dreg].def = ins;
+		break;
+	}
+	case OP_LDLEN:
+		if (!is_invariant_array (loop, ins->sreg1))
+			return FALSE;
+		values [ins->dreg].kind = VAL_LEN;
+		values [ins->dreg].src = ins->sreg1;
+		break;
+	case OP_BOUNDS_CHECK:
+		/* The vector loop checks the length of the array before each iteration */
+		if (!is_invariant_array (loop, ins->sreg1) || values [ins->sreg2].kind != VAL_INDEX)
+			return FALSE;
+		add_array (loop, ins->sreg1);
+		break;
+	case OP_X86_LEA: {
+		MonoInst *lea;
+
+		if (!is_invariant_array (loop, ins->sreg1) || values [ins->sreg2].kind != VAL_INDEX)
+			return FALSE;
+		if (ins->inst_imm != MONO_STRUCT_OFFSET (MonoArray, vector) || ins->backend.shift_amount > 2)
+			return FALSE;
+		esize = 1 << ins->backend.shift_amount;
+		if (loop->esize && loop->esize != esize)
+			return FALSE;
+		loop->esize = esize;
+		add_array (loop, ins->sreg1);
+
+		MONO_INST_NEW (cfg, lea, OP_X86_LEA);
+		lea->dreg = alloc_ireg_mp (cfg);
+		lea->sreg1 = ins->sreg1;
+		lea->sreg2 = loop->index_reg;
+		lea->inst_imm = ins->inst_imm;
+		lea->backend.shift_amount = ins->backend.shift_amount;
+		lea->type = STACK_MP;
+		MONO_ADD_INS (loop->vbody, lea);
+		values [ins->dreg].kind = VAL_ADDR;
+		values [ins->dreg].src = ins->sreg1;
+		values [ins->dreg].vreg = lea->dreg;
+		break;
+	}
+	case OP_LOADI1_MEMBASE:
+	case OP_LOADU1_MEMBASE:
+	case OP_LOADI2_MEMBASE:
+	case OP_LOADU2_MEMBASE:
+	case OP_LOADI4_MEMBASE:
+	case OP_LOADU4_MEMBASE:
+	case OP_LOADR4_MEMBASE: {
+		MonoInst *load;
+
+		esize = access_size (ins->opcode);
+		is_float = ins->opcode == OP_LOADR4_MEMBASE;
+		if (values [ins->sreg1].kind != VAL_ADDR || ins->inst_offset != 0 || esize != loop->esize)
+			return FALSE;
+
+		MONO_INST_NEW (cfg, load, vector_opcode (loop, OP_LOADX_MEMBASE));
+		load->dreg = alloc_ireg (cfg);
+		load->sreg1 = values [ins->sreg1].vreg;
+		load->inst_offset = 0;
+		load->type = STACK_VTYPE;
+		MONO_ADD_INS (loop->vbody, load);
+		set_lane (loop, ins->dreg, load->dreg, is_float, TRUE);
+		break;
+	}
+	case OP_STOREI1_MEMBASE_REG:
+	case OP_STOREI2_MEMBASE_REG:
+	case OP_STOREI4_MEMBASE_REG:
+	case OP_STORER4_MEMBASE_REG:
+	case OP_STOREI1_MEMBASE_IMM:
+	case OP_STOREI2_MEMBASE_IMM:
+	case OP_STOREI4_MEMBASE_IMM: {
+		MonoInst *store;
+
+		esize = access_size (ins->opcode);
+		is_float = ins->opcode == OP_STORER4_MEMBASE_REG;
+		if (ins->dreg >= loop->nvregs || values [ins->dreg].kind != VAL_ADDR || ins->inst_offset != 0 || esize != loop->esize)
+			return FALSE;
+		if (ins->opcode == OP_STOREI1_MEMBASE_IMM || ins->opcode == OP_STOREI2_MEMBASE_IMM || ins->opcode == OP_STOREI4_MEMBASE_IMM)
+			x1 = emit_expand_imm (loop, ins->inst_imm);
+		else
+			x1 = get_lane (loop, ins->sreg1, is_float, FALSE);
+		if (x1 == -1)
+			return FALSE;
+
+		MONO_INST_NEW (cfg, store, vector_opcode (loop, OP_STOREX_MEMBASE));
+		store->dreg = values [ins->dreg].vreg;
+		store->sreg1 = x1;
+		store->inst_offset = 0;
+		MONO_ADD_INS (loop->vbody, store);
+		loop->has_store = TRUE;
+		break;
+	}
+	default:
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+static gboolean
+process_bblock (VecLoop *loop, MonoBasicBlock *bb, MonoInst *end)
+{
+	MonoInst *ins;
+
+	for (ins = bb->code; ins && ins != end; ins = ins->next) {
+		if (!process_ins (loop, ins))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/*
+ * analyze_loop:
+ *
+ *   Check whenever the loop whose header is HEADER can be vectorized, emitting the body
+ * of the vector loop in the process. The loop has to consist of one bblock ending with
+ * the loop condition, or of a header with the loop condition and one other bblock.
+ */
+static VecLoop*
+analyze_loop (MonoCompile *cfg, MonoBasicBlock *header)
+{
+	VecLoop *loop;
+	MonoBasicBlock *latch, *preheader, *body_start, *exit_bb;
+	MonoInst *branch, *cmp, *ins, *var;
+	int iv, nblocks, src;
+
+	nblocks = g_list_length (header->loop_blocks);
+	if (nblocks == 1)
+		latch = header;
+	else if (nblocks == 2)
+		latch = (MonoBasicBlock *)(header->loop_blocks->data == header ? header->loop_blocks->next->data : header->loop_blocks->data);
+	else
+		return NULL;
+
+	/* The header has to be entered from a single preheader */
+	if (header->in_count != 2 || header->out_count != 2)
+		return NULL;
+	if (header->in_bb [0] == latch)
+		preheader = header->in_bb [1];
+	else if (header->in_bb [1] == latch)
+		preheader = header->in_bb [0];
+	else
+		return NULL;
+	if (preheader == latch || preheader == cfg->bb_entry || preheader->out_count != 1)
+		return NULL;
+	if (preheader->last_ins && MONO_IS_BRANCH_OP (preheader->last_ins)) {
+		if (preheader->last_ins->opcode != OP_BR)
+			return NULL;
+	} else if (preheader->next_bb != header) {
+		return NULL;
+	}
+
+	if (preheader->region != header->region || latch->region != header->region)
+		return NULL;
+	if ((header->flags | latch->flags) & (BB_EXCEPTION_HANDLER | BB_INDIRECT_JUMP_TARGET))
+		return NULL;
+	if (header->try_start || latch->try_start)
+		return NULL;
+
+	if (latch != header) {
+		if (latch->in_count != 1 || latch->out_count != 1 || latch->out_bb [0] != header)
+			return NULL;
+		if (latch->last_ins && MONO_IS_BRANCH_OP (latch->last_ins) && latch->last_ins->opcode != OP_BR)
+			return NULL;
+	}
+
+	/* The loop condition, i < n */
+	branch = header->last_ins;
+	if (!branch || (branch->opcode != OP_IBLT && branch->opcode != OP_IBGE) || !branch->inst_true_bb || !branch->inst_false_bb)
+		return NULL;
+	cmp = branch->prev;
+	if (!cmp || (cmp->opcode != OP_ICOMPARE && cmp->opcode != OP_ICOMPARE_IMM))
+		return NULL;
+	body_start = latch != header ? latch : header;
+	if (branch->opcode == OP_IBLT) {
+		if (branch->inst_true_bb != body_start)
+			return NULL;
+		exit_bb = branch->inst_false_bb;
+	} else {
+		if (branch->inst_false_bb != body_start)
+			return NULL;
+		exit_bb = branch->inst_true_bb;
+	}
+	if (exit_bb == header || exit_bb == latch)
+		return NULL;
+
+	/* One bblock loops test the incremented induction variable */
+	iv = cmp->sreg1;
+	if (latch == header && !get_vreg_to_inst (cfg, iv)) {
+		for (ins = header->code; ins != cmp; ins = ins->next) {
+			if (ins->opcode == OP_IADD_IMM && ins->dreg == cmp->sreg1 && ins->inst_imm == 1) {
+				iv = ins->sreg1;
+				break;
+			}
+		}
+	}
+	var = get_vreg_to_inst (cfg, iv);
+	if (!var || var->type != STACK_I4 || (var->flags & (MONO_INST_VOLATILE | MONO_INST_INDIRECT)))
+		return NULL;
+
+	loop = (VecLoop *)mono_mempool_alloc0 (cfg->mempool, sizeof (VecLoop));
+	loop->cfg = cfg;
+	loop->header = header;
+	loop->latch = latch;
+	loop->preheader = preheader;
+	loop->iv = iv;
+	loop->bound_reg = -1;
+	loop->bound_array = -1;
+	loop->vsize = get_vector_size (cfg);
+	loop->nvregs = cfg->next_vreg;
+	loop->values = (VecValue *)mono_mempool_alloc0 (cfg->mempool, sizeof (VecValue) * loop->nvregs);
+	loop->values [iv].kind = VAL_INDEX;
+	loop->vbody = (MonoBasicBlock *)mono_mempool_alloc0 (cfg->mempool, sizeof (MonoBasicBlock));
+
+#if SIZEOF_REGISTER == 8
+	MONO_INST_NEW (cfg, ins, OP_SEXT_I4);
+	ins->dreg = alloc_preg (cfg);
+	ins->sreg1 = iv;
+	MONO_ADD_INS (loop->vbody, ins);
+	loop->index_reg = ins->dreg;
+#else
+	loop->index_reg = iv;
+#endif
+
+	if (!process_bblock (loop, header, cmp))
+		return NULL;
+	if (latch != header && !process_bblock (loop, latch, (latch->last_ins && latch->last_ins->opcode == OP_BR) ? latch->last_ins : NULL))
+		return NULL;
+
+	if (!loop->incremented || !loop->has_store || !loop->esize)
+		return NULL;
+	if (cmp->sreg1 != iv && loop->values [cmp->sreg1].kind != VAL_INDEX_NEXT)
+		return NULL;
+
+	if (cmp->opcode == OP_ICOMPARE_IMM) {
+		/* Not worth it for short loops */
+		if (cmp->inst_imm < loop->vsize / loop->esize)
+			return NULL;
+		loop->bound_imm = cmp->inst_imm;
+	} else if (loop->values [cmp->sreg2].kind == VAL_LEN) {
+		loop->bound_array = loop->values [cmp->sreg2].src;
+		add_array (loop, loop->bound_array);
+	} else {
+		src = invariant_source (loop, cmp->sreg2);
+		if (src == -1 || get_vreg_to_inst (cfg, src)->type != STACK_I4)
+			return NULL;
+		loop->bound_reg = src;
+	}
+
+	return loop;
+}
+
+static void
+add_bblock (VecLoop *loop, MonoBasicBlock *bb, MonoBasicBlock **prev)
+{
+	bb->block_num = loop->cfg->num_bblocks++;
+	bb->region = loop->header->region;
+	bb->real_offset = loop->header->real_offset;
+	bb->next_bb = (*prev)->next_bb;
+	(*prev)->next_bb = bb;
+	*prev = bb;
+}
+
+static MonoBasicBlock*
+new_bblock (VecLoop *loop, MonoBasicBlock **prev)
+{
+	MonoBasicBlock *bb = (MonoBasicBlock *)mono_mempool_alloc0 (loop->cfg->mempool, sizeof (MonoBasicBlock));
+
+	add_bblock (loop, bb, prev);
+	return bb;
+}
+
+static void
+emit_br (MonoCompile *cfg, MonoBasicBlock *target)
+{
+	MonoInst *ins;
+
+	MONO_INST_NEW (cfg, ins, OP_BR);
+	ins->inst_target_bb = target;
+	MONO_ADD_INS (cfg->cbb, ins);
+	mono_link_bblock (cfg, cfg->cbb, target);
+}
+
+/*
+ * Branch to the scalar loop if the preceding compare succeeds, continue in NEXT
+ * otherwise.
+ */
+static void
+emit_exit_branch (VecLoop *loop, int opcode, MonoBasicBlock *next)
+{
+	MonoCompile *cfg = loop->cfg;
+
+	MONO_EMIT_NEW_BRANCH_BLOCK2 (cfg, opcode, loop->exit, next);
+	cfg->cbb = next;
+}
+
+/*
+ * emit_vector_loop:
+ *
+ *   Link the vector loop into the cfg between LOOP's preheader and header:
+ *
+ *   if (i < 0 || n < 0 || a == null || b == null ...)
+ *       goto scalar;
+ *   len_a = a.Length; ...
+ * cond:
+ *   t = i + W;
+ *   if (t > n || t > len_a ...)
+ *       goto scalar;
+ *   <vector body>
+ *   i += W;
+ *   goto cond;
+ * scalar:
+ *   <the original loop>
+ *
+ * The comparisons are unsigned, which can't overflow since both sides are known to
+ * be positive. With 256 bit vectors, the second exit goes through a bblock executing
+ * vzeroupper.
+ */
+static void
+emit_vector_loop (VecLoop *loop)
+{
+	MonoCompile *cfg = loop->cfg;
+	MonoBasicBlock *prev, *first, *vcond, *next, *old_cbb;
+	MonoInst *ins, *var, *tvar;
+	GSList *l;
+	int width = loop->vsize / loop->esize;
+	int narrays = g_slist_length (loop->arrays);
+	int *len_regs = (int *)mono_mempool_alloc0 (cfg->mempool, sizeof (int) * narrays);
+	int bound_len = -1;
+	int cond_op, i;
+
+	old_cbb = cfg->cbb;
+
+	/* mono_bb_ordering () sets num_bblocks to the number of reachable bblocks */
+	cfg->num_bblocks = MAX (cfg->num_bblocks, cfg->max_block_num);
+
+	loop->exit = loop->header;
+	prev = loop->preheader;
+	first = new_bblock (loop, &prev);
+	cfg->cbb = first;
+
+	/* Leave negative indexes and bounds and null arrays to the scalar loop */
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, loop->iv, 0);
+	emit_exit_branch (loop, OP_IBLT, new_bblock (loop, &prev));
+	if (loop->bound_reg != -1) {
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, loop->bound_reg, 0);
+		emit_exit_branch (loop, OP_IBLT, new_bblock (loop, &prev));
+	}
+	for (l = loop->arrays; l; l = l->next) {
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_COMPARE_IMM, -1, GPOINTER_TO_INT (l->data), 0);
+		emit_exit_branch (loop, OP_PBEQ, new_bblock (loop, &prev));
+	}
+
+	for (l = loop->arrays, i = 0; l; l = l->next, ++i) {
+		var = mono_compile_create_var (cfg, &mono_defaults.int32_class->byval_arg, OP_LOCAL);
+		MONO_INST_NEW (cfg, ins, OP_LDLEN);
+		ins->dreg = var->dreg;
+		ins->sreg1 = GPOINTER_TO_INT (l->data);
+		ins->type = STACK_I4;
+		MONO_ADD_INS (cfg->cbb, ins);
+		cfg->cbb->has_array_access = TRUE;
+		len_regs [i] = var->dreg;
+		if (GPOINTER_TO_INT (l->data) == loop->bound_array)
+			bound_len = var->dreg;
+	}
+	cfg->flags |= MONO_CFG_HAS_ARRAY_ACCESS;
+
+	vcond = new_bblock (loop, &prev);
+	emit_br (cfg, vcond);
+
+#ifdef MONO_ARCH_SIMD256
+	if (loop->vsize == 32) {
+		/* Avoid the AVX-SSE transition penalty in the scalar loop and the rest of the method */
+		loop->exit = new_bblock (loop, &prev);
+		cfg->cbb = loop->exit;
+		MONO_INST_NEW (cfg, ins, OP_VZEROUPPER);
+		MONO_ADD_INS (cfg->cbb, ins);
+		emit_br (cfg, loop->header);
+		cfg->uses_simd256 = TRUE;
+	}
+#endif
+
+	cfg->cbb = vcond;
+
+	/*
+	 * One bblock loops execute their body before testing the condition, so the
+	 * vector loop has to leave at least one iteration to the scalar loop.
+	 */
+	cond_op = loop->latch == loop->header ? OP_IBGE_UN : OP_IBGT_UN;
+
+	tvar = mono_compile_create_var (cfg, &mono_defaults.int32_class->byval_arg, OP_LOCAL);
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, tvar->dreg, loop->iv, width);
+	if (bound_len != -1)
+		MONO_EMIT_NEW_BIALU (cfg, OP_ICOMPARE, -1, tvar->dreg, bound_len);
+	else if (loop->bound_reg != -1)
+		MONO_EMIT_NEW_BIALU (cfg, OP_ICOMPARE, -1, tvar->dreg, loop->bound_reg);
+	else
+		MONO_EMIT_NEW_BIALU_IMM (cfg, OP_ICOMPARE_IMM, -1, tvar->dreg, loop->bound_imm);
+	for (i = 0; i < narrays; ++i) {
+		emit_exit_branch (loop, cond_op, new_bblock (loop, &prev));
+		cond_op = OP_IBGT_UN;
+		MONO_EMIT_NEW_BIALU (cfg, OP_ICOMPARE, -1, tvar->dreg, len_regs [i]);
+	}
+	next = loop->vbody;
+	add_bblock (loop, next, &prev);
+	emit_exit_branch (loop, cond_op, next);
+
+	MONO_EMIT_NEW_BIALU_IMM (cfg, OP_IADD_IMM, loop->iv, loop->iv, width);
+	emit_br (cfg, vcond);
+
+	/* Enter the vector loop from the preheader */
+	mono_unlink_bblock (cfg, loop->preheader, loop->header);
+	if (loop->preheader->last_ins && loop->preheader->last_ins->opcode == OP_BR) {
+		loop->preheader->last_ins->inst_target_bb = first;
+		mono_link_bblock (cfg, loop->preheader, first);
+	} else {
+		cfg->cbb = loop->preheader;
+		emit_br (cfg, first);
+	}
+
+	cfg->cbb = old_cbb;
+}
+
+/*
+ * mono_vectorize_loops:
+ *
+ *   Add vector versions of the simple array loops of the method. This requires the
+ * loop info computed by mono_compute_natural_loops (). Returns whenever the cfg
+ * changed, in which case the caller has to recompute the dominators and the loops.
+ */
+gboolean
+mono_vectorize_loops (MonoCompile *cfg)
+{
+	MonoBasicBlock *bb;
+	GSList *headers = NULL, *l;
+	VecLoop *loop;
+	MonoBasicBlock *old_cbb = cfg->cbb;
+	gboolean changed = FALSE;
+
+	if (COMPILE_LLVM (cfg) || cfg->gsharedvt || cfg->gen_sdb_seq_points)
+		return FALSE;
+
+	for (bb = cfg->bb_entry; bb; bb = bb->next_bb) {
+		if (bb->loop_blocks && g_list_length (bb->loop_blocks) <= 2)
+			headers = g_slist_prepend (headers, bb);
+	}
+
+	for (l = headers; l; l = l->next) {
+		bb = (MonoBasicBlock *)l->data;
+
+		loop = analyze_loop (cfg, bb);
+		cfg->cbb = old_cbb;
+		if (!loop)
+			continue;
+
+		emit_vector_loop (loop);
+		cfg->stat_vectorized_loops++;
+		changed = TRUE;
+
+		if (cfg->verbose_level > 1)
+			printf ("VECTORIZED LOOP BB%d: %d elements per iteration\n", bb->block_num, loop->vsize / loop->esize);
+	}
+	g_slist_free (headers);
+
+	return changed;
+}
+
+#else
+
+gboolean
+mono_vectorize_loops (MonoCompile *cfg)
+{
+	return FALSE;
+}
+
+#endif
+
+#endif /* !DISABLE_JIT */
@@ -37,6 +37,7 @@
 #include <dlfcn.h>
 #endif
 #include <fcntl.h>
+#include <math.h>
 #ifdef HAVE_LINK_H
 #include <link.h>
 #endif
@@ -81,15 +82,20 @@ static int command_port = 0;
 static int heapshot_requested = 0;
 static int sample_freq = 0;
 static int do_mono_sample = 0;
+// Walk frame pointers in the sampling signal handler and symbolize on the dumper thread.
+static gboolean sample_fp_walk;
 static int do_debug = 0;
 static int do_coverage = 0;
 static gboolean only_coverage;
 static gboolean debug_coverage = FALSE;
 static MonoProfileSamplingMode sampling_mode = MONO_PROFILER_STAT_MODE_PROCESS;
 static int max_allocated_sample_hits;
+// Mean number of bytes between recorded allocations, 0 records all of them.
+static uint64_t alloc_sample_interval;
 
 // Statistics for internal profiler data structures.
 static gint32 sample_allocations_ctr,
+              sample_drops_ctr,
               buffer_allocations_ctr;
 
 // Statistics for profiler events.
@@ -98,6 +104,7 @@ static gint32 sync_points_ctr,
               heap_starts_ctr,
               heap_ends_ctr,
               heap_roots_ctr,
+              heap_frees_ctr,
               gc_events_ctr,
               gc_resizes_ctr,
               gc_allocs_ctr,
@@ -223,10 +230,15 @@ static MonoLinkedListSet profiler_thread_list;
  *
  * type alloc format:
  * type: TYPE_ALLOC
- * exinfo: flags: TYPE_ALLOC_BT
+ * exinfo: flags: TYPE_ALLOC_BT, TYPE_ALLOC_SAMPLED
  * [ptr: sleb128] class as a byte difference from ptr_base
  * [obj: sleb128] object address as a byte difference from obj_base
  * [size: uleb128] size of the object in the heap
+ * If the TYPE_ALLOC_SAMPLED flag is set:
+ *	[interval: uleb128] mean number of allocated bytes between recorded
+ *	allocations; the distance between samples is exponentially distributed,
+ *	so an allocation of size bytes was recorded with probability
+ *	1 - exp (-size / interval)
  * If the TYPE_ALLOC_BT flag is set, a backtrace follows.
  *
  * type GC format:
@@ -319,7 +331,15 @@ static MonoLinkedListSet profiler_thread_list;
  *
  * type heap format
  * type: TYPE_HEAP
- * exinfo: one of TYPE_HEAP_START, TYPE_HEAP_END, TYPE_HEAP_OBJECT, TYPE_HEAP_ROOT
+ * exinfo: one of TYPE_HEAP_START, TYPE_HEAP_DELTA_START, TYPE_HEAP_END, TYPE_HEAP_OBJECT,
+ * TYPE_HEAP_ROOT, TYPE_HEAP_FREED
+ * if exinfo == TYPE_HEAP_DELTA_START
+ * 	the heap shot only contains the objects that are new or changed since the
+ * 	previous heap shot: the objects of the previous heap shot are carried
+ * 	over, a TYPE_HEAP_OBJECT event replaces a carried over object at the
+ * 	same address and TYPE_HEAP_FREED events remove them. Objects that moved
+ * 	show up as removed at the old address and new at the new one. The first
+ * 	incremental heap shot is relative to an empty heap.
  * if exinfo == TYPE_HEAP_OBJECT
  * 	[object: sleb128] the object as a difference from obj_base
  * 	[class: sleb128] the object MonoClass* as a difference from ptr_base
@@ -339,6 +359,10 @@ static MonoLinkedListSet profiler_thread_list;
  * 	[root_type: byte] the root_type: MonoProfileGCRootType (profiler.h)
  * 	[extra_info: uleb128] the extra_info value
  * 	object, root_type and extra_info are repeated num_roots times
+ * if exinfo == TYPE_HEAP_FREED
+ * 	[num_objects: uleb128] number of objects that follow
+ * 	[object: sleb128]+ objects of the previous heap shot that are no longer
+ * 	alive at that address, as differences from obj_base
  *
  * type sample format
  * type: TYPE_SAMPLE
@@ -456,6 +480,33 @@ struct _LogBuffer {
 	unsigned char buf [1];
 };
 
+/*
+ * With samplewalk=fp, the sampling signal handler only copies the raw call
+ * chain into a ring buffer owned by the sampled thread. The dumper thread
+ * drains the rings and resolves the instruction pointers to methods. Rings
+ * outlive their threads: once orphaned and drained, a new thread reuses them.
+ *
+ * Each record is a header word holding the number of IPs, the timestamp, the
+ * domain and the IPs themselves, innermost first. Records wrap around the end
+ * of `data`.
+ */
+#define SAMPLE_RING_WORDS (8 * 1024)
+#define SAMPLE_RECORD_WORDS(COUNT) (3 + (COUNT))
+
+typedef struct _SampleRing SampleRing;
+struct _SampleRing {
+	SampleRing *next;
+	// Set when the owning thread is gone, the ring can be reused once it's empty.
+	volatile gint32 orphaned;
+	uintptr_t tid;
+	// Free running, only the owner changes write_pos and only the dumper read_pos.
+	volatile guint32 write_pos;
+	volatile guint32 read_pos;
+	uint64_t data [SAMPLE_RING_WORDS];
+};
+
+static SampleRing * volatile sample_rings;
+
 typedef struct {
 	MonoLinkedListSetNode node;
 
@@ -477,6 +528,21 @@ typedef struct {
 	// Indicates whether this thread is currently writing to its `buffer`.
 	gboolean busy;
 
+	// Bytes left to allocate before the next allocation is recorded.
+	int64_t alloc_sample_countdown;
+
+	// State of the random number generator for allocation sampling.
+	uint64_t alloc_sample_seed;
+
+	// Log section nesting depth, see `buffer_lock ()`.
+	int log_nesting;
+
+	// Non-zero while the thread is inside a log section. Read by sync points.
+	volatile gint32 log_active;
+
+	// Raw call chains recorded by the sampling signal handler, see `SampleRing`.
+	SampleRing *sample_ring;
+
 	// Has this thread written a thread end event to `buffer`?
 	gboolean ended;
 } MonoProfilerThread;
@@ -560,17 +626,17 @@ init_time (void)
 /*
  * These macros should be used when writing an event to a log buffer. They take
  * care of a bunch of stuff that can be repetitive and error-prone, such as
- * acquiring/releasing the buffer lock, incrementing the event counter,
+ * entering/leaving the log section, incrementing the event counter,
  * expanding the log buffer, processing requests, etc. They also create a scope
  * so that it's harder to leak the LogBuffer pointer, which can be problematic
- * as the pointer is unstable when the buffer lock isn't acquired.
+ * as the pointer is unstable outside of the log section.
  */
 
 #define ENTER_LOG(COUNTER, BUFFER, SIZE) \
 	do { \
 		MonoProfilerThread *thread__ = PROF_TLS_GET (); \
 		if (thread__->attached) \
-			buffer_lock (); \
+			buffer_lock (thread__); \
 		g_assert (!thread__->busy && "Why are we trying to write a new event while already writing one?"); \
 		thread__->busy = TRUE; \
 		InterlockedIncrement ((COUNTER)); \
@@ -581,7 +647,7 @@ init_time (void)
 		if ((SEND)) \
 			send_log_unsafe (TRUE); \
 		if (thread__->attached) \
-			buffer_unlock (); \
+			buffer_unlock (thread__); \
 		if ((REQUESTS)) \
 			process_requests (); \
 	} while (0)
@@ -594,66 +660,92 @@ init_time (void)
 
 #define EXIT_LOG EXIT_LOG_EXPLICIT (DO_SEND, DO_REQUESTS)
 
-static volatile gint32 buffer_rwlock_count;
-static volatile gpointer buffer_rwlock_exclusive;
+/*
+ * Sync points need a consistent view of all thread buffers, so no thread may
+ * be writing an event while one is in progress. Rather than having every event
+ * update a shared reader count, each thread publishes whether it is inside a
+ * log section in its own MonoProfilerThread, and a sync point bumps a global
+ * epoch to an odd value and waits for the threads that are still inside one.
+ * Threads that try to enter a section while the epoch is odd wait for it to
+ * advance again.
+ */
+static volatile gint32 buffer_sync_epoch;
+static volatile gpointer buffer_sync_owner;
 
 // Can be used recursively.
 static void
-buffer_lock (void)
+buffer_lock (MonoProfilerThread *thread)
 {
 	/*
-	 * If the thread holding the exclusive lock tries to modify the
-	 * reader count, just make it a no-op. This way, we also avoid
-	 * invoking the GC safe point macros below, which could break if
-	 * done from a thread that is currently the initiator of STW.
+	 * If the thread running a sync point tries to enter a log section,
+	 * just make it a no-op. This way, we also avoid invoking the GC safe
+	 * point macros below, which could break if done from a thread that is
+	 * currently the initiator of STW.
 	 *
-	 * In other words, we rely on the fact that the GC thread takes
-	 * the exclusive lock in the gc_event () callback when the world
-	 * is about to stop.
+	 * In other words, we rely on the fact that the GC thread starts a sync
+	 * point in the gc_event () callback when the world is about to stop.
 	 */
-	if (InterlockedReadPointer (&buffer_rwlock_exclusive) != (gpointer) thread_id ()) {
-		MONO_ENTER_GC_SAFE;
+	if (InterlockedReadPointer (&buffer_sync_owner) != (gpointer) thread_id () && !thread->log_nesting++) {
+		while (TRUE) {
+			InterlockedWrite (&thread->log_active, 1);
 
-		while (InterlockedReadPointer (&buffer_rwlock_exclusive))
-			mono_thread_info_yield ();
+			// Pairs with the epoch increment in buffer_sync_begin ().
+			mono_memory_barrier ();
 
-		InterlockedIncrement (&buffer_rwlock_count);
+			gint32 epoch = InterlockedRead (&buffer_sync_epoch);
 
-		MONO_EXIT_GC_SAFE;
+			if (!(epoch & 1))
+				break;
+
+			InterlockedWrite (&thread->log_active, 0);
+
+			MONO_ENTER_GC_SAFE;
+
+			while (InterlockedRead (&buffer_sync_epoch) == epoch)
+				mono_thread_info_yield ();
+
+			MONO_EXIT_GC_SAFE;
+		}
 	}
 
 	mono_memory_barrier ();
 }
 
 static void
-buffer_unlock (void)
+buffer_unlock (MonoProfilerThread *thread)
 {
 	mono_memory_barrier ();
 
 	// See the comment in buffer_lock ().
-	if (InterlockedReadPointer (&buffer_rwlock_exclusive) == (gpointer) thread_id ())
+	if (InterlockedReadPointer (&buffer_sync_owner) == (gpointer) thread_id ())
 		return;
 
-	g_assert (InterlockedRead (&buffer_rwlock_count) && "Why are we trying to decrement a zero reader count?");
+	g_assert (thread->log_nesting && "Why are we trying to leave a log section we're not in?");
 
-	InterlockedDecrement (&buffer_rwlock_count);
+	if (!--thread->log_nesting)
+		InterlockedWrite (&thread->log_active, 0);
 }
 
 // Cannot be used recursively.
 static void
-buffer_lock_excl (void)
+buffer_sync_begin (void)
 {
 	gpointer tid = (gpointer) thread_id ();
 
-	g_assert (InterlockedReadPointer (&buffer_rwlock_exclusive) != tid && "Why are we taking the exclusive lock twice?");
+	g_assert (InterlockedReadPointer (&buffer_sync_owner) != tid && "Why are we starting a sync point twice?");
 
 	MONO_ENTER_GC_SAFE;
 
-	while (InterlockedCompareExchangePointer (&buffer_rwlock_exclusive, tid, 0))
+	// Only one sync point (GC or periodic) can be in progress at a time.
+	while (InterlockedCompareExchangePointer (&buffer_sync_owner, tid, 0))
 		mono_thread_info_yield ();
 
-	while (InterlockedRead (&buffer_rwlock_count))
-		mono_thread_info_yield ();
+	InterlockedIncrement (&buffer_sync_epoch);
+
+	MONO_LLS_FOREACH_SAFE (&profiler_thread_list, MonoProfilerThread, thread) {
+		while (InterlockedRead (&thread->log_active))
+			mono_thread_info_yield ();
+	} MONO_LLS_FOREACH_SAFE_END
 
 	MONO_EXIT_GC_SAFE;
 
@@ -661,15 +753,16 @@ buffer_lock_excl (void)
 }
 
 static void
-buffer_unlock_excl (void)
+buffer_sync_end (void)
 {
 	mono_memory_barrier ();
 
-	g_assert (InterlockedReadPointer (&buffer_rwlock_exclusive) && "Why is the exclusive lock not held?");
-	g_assert (InterlockedReadPointer (&buffer_rwlock_exclusive) == (gpointer) thread_id () && "Why does another thread hold the exclusive lock?");
-	g_assert (!InterlockedRead (&buffer_rwlock_count) && "Why are there readers when the exclusive lock is held?");
+	g_assert (InterlockedReadPointer (&buffer_sync_owner) && "Why is no sync point in progress?");
+	g_assert (InterlockedReadPointer (&buffer_sync_owner) == (gpointer) thread_id () && "Why does another thread run the sync point?");
+	g_assert ((InterlockedRead (&buffer_sync_epoch) & 1) && "Why is the sync epoch even during a sync point?");
 
-	InterlockedWritePointer (&buffer_rwlock_exclusive, NULL);
+	InterlockedIncrement (&buffer_sync_epoch);
+	InterlockedWritePointer (&buffer_sync_owner, NULL);
 }
 
 typedef struct _BinaryObject BinaryObject;
@@ -792,11 +885,46 @@ create_buffer (uintptr_t tid)
 }
 
 /*
- * Must be called with the reader lock held if thread is the current thread, or
- * the exclusive lock if thread is a different thread. However, if thread is
+ * Must be called inside a log section if thread is the current thread, or
+ * during a sync point if thread is a different thread. However, if thread is
  * the current thread, and init_thread () was called with add_to_lls = FALSE,
  * then no locking is necessary.
  */
+static SampleRing *
+acquire_sample_ring (uintptr_t tid)
+{
+	SampleRing *ring, *head;
+
+	for (ring = sample_rings; ring; ring = ring->next) {
+		if (ring->orphaned && ring->read_pos == ring->write_pos && InterlockedCompareExchange (&ring->orphaned, 0, 1) == 1)
+			goto found;
+	}
+
+	ring = g_new0 (SampleRing, 1);
+	do {
+		head = sample_rings;
+		ring->next = head;
+	} while (InterlockedCompareExchangePointer ((gpointer volatile *) &sample_rings, ring, head) != head);
+
+found:
+	ring->tid = tid;
+	return ring;
+}
+
+static void
+release_sample_ring (MonoProfilerThread *thread)
+{
+	SampleRing *ring = thread->sample_ring;
+
+	if (!ring)
+		return;
+
+	// Keep the signal handler from writing to the ring once it's reused.
+	thread->sample_ring = NULL;
+	mono_memory_barrier ();
+	ring->orphaned = 1;
+}
+
 static void
 init_buffer_state (MonoProfilerThread *thread)
 {
@@ -837,10 +965,19 @@ init_thread (MonoProfiler *prof, gboolean add_to_lls)
 	thread->attached = add_to_lls;
 	thread->call_depth = 0;
 	thread->busy = 0;
+	thread->alloc_sample_seed = (thread->node.key ^ current_time ()) | 1;
+	thread->alloc_sample_countdown = 0;
+	thread->log_nesting = 0;
+	thread->log_active = 0;
+	thread->sample_ring = NULL;
 	thread->ended = FALSE;
 
 	init_buffer_state (thread);
 
+	// Only threads known to the runtime get call chains from the signal handler.
+	if (sample_fp_walk && add_to_lls)
+		thread->sample_ring = acquire_sample_ring (thread->node.key);
+
 	/*
 	 * Some internal profiler threads don't need to be cleaned up
 	 * by the main thread on shutdown.
@@ -1174,8 +1311,8 @@ dump_header (MonoProfiler *profiler)
 }
 
 /*
- * Must be called with the reader lock held if thread is the current thread, or
- * the exclusive lock if thread is a different thread. However, if thread is
+ * Must be called inside a log section if thread is the current thread, or
+ * during a sync point if thread is a different thread. However, if thread is
  * the current thread, and init_thread () was called with add_to_lls = FALSE,
  * then no locking is necessary.
  */
@@ -1217,6 +1354,7 @@ free_thread (gpointer p)
 		emit_ptr (buf, (void *) thread->node.key);
 	}
 
+	release_sample_ring (thread);
 	send_buffer (thread);
 
 	g_free (thread);
@@ -1299,11 +1437,11 @@ send_log_unsafe (gboolean if_needed)
 	}
 }
 
-// Assumes that the exclusive lock is held.
+// Assumes that a sync point is in progress.
 static void
 sync_point_flush (void)
 {
-	g_assert (InterlockedReadPointer (&buffer_rwlock_exclusive) == (gpointer) thread_id () && "Why don't we hold the exclusive lock?");
+	g_assert (InterlockedReadPointer (&buffer_sync_owner) == (gpointer) thread_id () && "Why aren't we running the sync point?");
 
 	MONO_LLS_FOREACH_SAFE (&profiler_thread_list, MonoProfilerThread, thread) {
 		g_assert (thread->attached && "Why is a thread in the LLS not attached?");
@@ -1313,11 +1451,11 @@ sync_point_flush (void)
 	} MONO_LLS_FOREACH_SAFE_END
 }
 
-// Assumes that the exclusive lock is held.
+// Assumes that a sync point is in progress.
 static void
 sync_point_mark (MonoProfilerSyncPointType type)
 {
-	g_assert (InterlockedReadPointer (&buffer_rwlock_exclusive) == (gpointer) thread_id () && "Why don't we hold the exclusive lock?");
+	g_assert (InterlockedReadPointer (&buffer_sync_owner) == (gpointer) thread_id () && "Why aren't we running the sync point?");
 
 	ENTER_LOG (&sync_points_ctr, logbuffer,
 		EVENT_SIZE /* event */ +
@@ -1332,7 +1470,7 @@ sync_point_mark (MonoProfilerSyncPointType type)
 	send_log_unsafe (FALSE);
 }
 
-// Assumes that the exclusive lock is held.
+// Assumes that a sync point is in progress.
 static void
 sync_point (MonoProfilerSyncPointType type)
 {
@@ -1340,13 +1478,9 @@ sync_point (MonoProfilerSyncPointType type)
 	sync_point_mark (type);
 }
 
-static int
-gc_reference (MonoObject *obj, MonoClass *klass, uintptr_t size, uintptr_t num, MonoObject **refs, uintptr_t *offsets, void *data)
+static void
+emit_heap_object (MonoObject *obj, MonoClass *klass, uintptr_t size, uintptr_t num, MonoObject **refs, uintptr_t *offsets)
 {
-	/* account for object alignment in the heap */
-	size += 7;
-	size &= ~7;
-
 	ENTER_LOG (&heap_objects_ctr, logbuffer,
 		EVENT_SIZE /* event */ +
 		LEB128_SIZE /* obj */ +
@@ -1374,6 +1508,200 @@ gc_reference (MonoObject *obj, MonoClass *klass, uintptr_t size, uintptr_t num,
 	}
 
 	EXIT_LOG_EXPLICIT (DO_SEND, NO_REQUESTS);
+}
+
+/*
+ * For incremental heap shots, we remember a digest of the class, size and
+ * references of every object seen by the previous heap shot. Only objects
+ * that are new, moved or changed since then are written out, followed by the
+ * objects of the previous heap shot that are gone. The table is only touched
+ * from heap_walk (), which runs on the thread that stopped the world.
+ */
+typedef struct {
+	uintptr_t obj;
+	guint32 digest;
+	guint32 shot;
+} HeapShotEntry;
+
+// Number of references emitted in a single TYPE_HEAP_OBJECT event.
+#define HEAP_OBJECT_CHUNK 128
+// Number of objects emitted in a single TYPE_HEAP_FREED event.
+#define HEAP_FREED_CHUNK 1024
+
+static gboolean hs_incremental;
+static HeapShotEntry *hs_entries;
+static uintptr_t hs_entries_size;
+static uintptr_t hs_entries_count;
+static guint32 hs_shot;
+
+// The object being walked, since sgen reports its references in chunks.
+static MonoObject *hs_obj;
+static MonoClass *hs_klass;
+static uintptr_t hs_size;
+static uintptr_t hs_num_refs;
+static uintptr_t hs_refs_size;
+static MonoObject **hs_refs;
+static uintptr_t *hs_offsets;
+
+static HeapShotEntry *
+heap_shot_entry_find (HeapShotEntry *entries, uintptr_t size, uintptr_t obj)
+{
+	uintptr_t i = ((obj >> 3) * 2654435761u) & (size - 1);
+
+	while (entries [i].obj && entries [i].obj != obj)
+		i = (i + 1) & (size - 1);
+
+	return &entries [i];
+}
+
+static void
+heap_shot_entries_resize (uintptr_t size, gboolean drop_freed)
+{
+	HeapShotEntry *entries = g_new0 (HeapShotEntry, size);
+	uintptr_t count = 0;
+
+	for (uintptr_t i = 0; i < hs_entries_size; ++i) {
+		if (hs_entries [i].obj && (!drop_freed || hs_entries [i].shot == hs_shot)) {
+			*heap_shot_entry_find (entries, size, hs_entries [i].obj) = hs_entries [i];
+			count++;
+		}
+	}
+
+	g_free (hs_entries);
+	hs_entries = entries;
+	hs_entries_size = size;
+	hs_entries_count = count;
+}
+
+static guint32
+heap_shot_digest (void)
+{
+	guint32 h = 2166136261u;
+
+#define DIGEST(v) do { h = (h ^ (guint32) (v)) * 16777619u; h = (h ^ (guint32) ((guint64) (v) >> 32)) * 16777619u; } while (0)
+	DIGEST ((uintptr_t) hs_klass);
+	DIGEST (hs_size);
+
+	for (uintptr_t i = 0; i < hs_num_refs; ++i) {
+		DIGEST (hs_offsets [i]);
+		DIGEST ((uintptr_t) hs_refs [i]);
+	}
+#undef DIGEST
+
+	return h;
+}
+
+static void
+heap_shot_flush_object (void)
+{
+	if (!hs_obj)
+		return;
+
+	if (hs_entries_count * 2 >= hs_entries_size)
+		heap_shot_entries_resize (hs_entries_size ? hs_entries_size * 2 : 1024, FALSE);
+
+	HeapShotEntry *entry = heap_shot_entry_find (hs_entries, hs_entries_size, (uintptr_t) hs_obj);
+	guint32 digest = heap_shot_digest ();
+	gboolean changed = !entry->obj || entry->digest != digest;
+
+	if (!entry->obj) {
+		entry->obj = (uintptr_t) hs_obj;
+		hs_entries_count++;
+	}
+
+	entry->digest = digest;
+	entry->shot = hs_shot;
+
+	if (changed) {
+		uintptr_t i = 0;
+
+		do {
+			uintptr_t num = MIN (hs_num_refs - i, HEAP_OBJECT_CHUNK);
+
+			emit_heap_object (hs_obj, hs_klass, i ? 0 : hs_size, num, hs_refs + i, hs_offsets + i);
+			i += num;
+		} while (i < hs_num_refs);
+	}
+
+	hs_obj = NULL;
+}
+
+static void
+heap_shot_emit_freed (void)
+{
+	uintptr_t i = 0;
+
+	while (i < hs_entries_size) {
+		uintptr_t num = 0;
+
+		for (uintptr_t j = i; j < hs_entries_size && num < HEAP_FREED_CHUNK; ++j)
+			if (hs_entries [j].obj && hs_entries [j].shot != hs_shot)
+				num++;
+
+		if (!num)
+			break;
+
+		ENTER_LOG (&heap_frees_ctr, logbuffer,
+			EVENT_SIZE /* event */ +
+			LEB128_SIZE /* num */ +
+			num * (
+				LEB128_SIZE /* object */
+			)
+		);
+
+		emit_event (logbuffer, TYPE_HEAP_FREED | TYPE_HEAP);
+		emit_value (logbuffer, num);
+
+		for (uintptr_t n = 0; n < num; ++i) {
+			if (hs_entries [i].obj && hs_entries [i].shot != hs_shot) {
+				emit_obj (logbuffer, (void *) hs_entries [i].obj);
+				n++;
+			}
+		}
+
+		EXIT_LOG_EXPLICIT (DO_SEND, NO_REQUESTS);
+	}
+
+	// Drop the objects that are gone, shrinking the table if the heap did.
+	uintptr_t size = 1024;
+
+	while (size < hs_entries_count * 4)
+		size *= 2;
+
+	heap_shot_entries_resize (size, TRUE);
+}
+
+static int
+gc_reference (MonoObject *obj, MonoClass *klass, uintptr_t size, uintptr_t num, MonoObject **refs, uintptr_t *offsets, void *data)
+{
+	/* account for object alignment in the heap */
+	size += 7;
+	size &= ~7;
+
+	if (!hs_incremental) {
+		emit_heap_object (obj, klass, size, num, refs, offsets);
+		return 0;
+	}
+
+	// A non-zero size starts a new object, see the TYPE_HEAP_OBJECT format.
+	if (size) {
+		heap_shot_flush_object ();
+
+		hs_obj = obj;
+		hs_klass = klass;
+		hs_size = size;
+		hs_num_refs = 0;
+	}
+
+	if (hs_num_refs + num > hs_refs_size) {
+		hs_refs_size = MAX (hs_refs_size * 2, hs_num_refs + num);
+		hs_refs = g_renew (MonoObject *, hs_refs, hs_refs_size);
+		hs_offsets = g_renew (uintptr_t, hs_offsets, hs_refs_size);
+	}
+
+	memcpy (hs_refs + hs_num_refs, refs, num * sizeof (MonoObject *));
+	memcpy (hs_offsets + hs_num_refs, offsets, num * sizeof (uintptr_t));
+	hs_num_refs += num;
 
 	return 0;
 }
@@ -1392,12 +1720,19 @@ heap_walk (MonoProfiler *profiler)
 		EVENT_SIZE /* event */
 	);
 
-	emit_event (logbuffer, TYPE_HEAP_START | TYPE_HEAP);
+	emit_event (logbuffer, (hs_incremental ? TYPE_HEAP_DELTA_START : TYPE_HEAP_START) | TYPE_HEAP);
 
 	EXIT_LOG_EXPLICIT (DO_SEND, NO_REQUESTS);
 
+	hs_shot++;
+
 	mono_gc_walk_heap (0, gc_reference, NULL);
 
+	if (hs_incremental) {
+		heap_shot_flush_object ();
+		heap_shot_emit_freed ();
+	}
+
 	ENTER_LOG (&heap_ends_ctr, logbuffer,
 		EVENT_SIZE /* event */
 	);
@@ -1470,7 +1805,7 @@ gc_event (MonoProfiler *profiler, MonoGCEvent ev, int generation)
 		 * Ensure that no thread can be in the middle of writing to
 		 * a buffer when the world stops...
 		 */
-		buffer_lock_excl ();
+		buffer_sync_begin ();
 		break;
 	case MONO_GC_EVENT_POST_STOP_WORLD:
 		/*
@@ -1504,7 +1839,7 @@ gc_event (MonoProfiler *profiler, MonoGCEvent ev, int generation)
 		 * Finally, it is safe to allow other threads to write to
 		 * their buffers again.
 		 */
-		buffer_unlock_excl ();
+		buffer_sync_end ();
 		break;
 	default:
 		break;
@@ -1578,18 +1913,54 @@ emit_bt (MonoProfiler *prof, LogBuffer *logbuffer, FrameData *data)
 	}
 }
 
+/*
+ * Returns the number of bytes until the next recorded allocation. The
+ * distances are exponentially distributed, so every allocated byte has the
+ * same chance to be picked regardless of the allocation pattern.
+ */
+static int64_t
+next_alloc_sample (MonoProfilerThread *thread)
+{
+	uint64_t x = thread->alloc_sample_seed;
+
+	// xorshift64*
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	thread->alloc_sample_seed = x;
+
+	// Uniform in (0, 1].
+	double u = ((x * 0x2545F4914F6CDD1DULL) >> 11) * (1.0 / 9007199254740992.0) + (1.0 / 9007199254740992.0);
+
+	return (int64_t) (-log (u) * alloc_sample_interval) + 1;
+}
+
 static void
 gc_alloc (MonoProfiler *prof, MonoObject *obj, MonoClass *klass)
 {
-	init_thread (prof, TRUE);
+	MonoProfilerThread *thread = init_thread (prof, TRUE);
 
-	int do_bt = (nocalls && InterlockedRead (&runtime_inited) && !notraces) ? TYPE_ALLOC_BT : 0;
 	FrameData data;
 	uintptr_t len = mono_object_get_size (obj);
 	/* account for object alignment in the heap */
 	len += 7;
 	len &= ~7;
 
+	int sampled = 0;
+
+	if (alloc_sample_interval) {
+		// Only pay for the event and the backtrace once per interval.
+		thread->alloc_sample_countdown -= len;
+
+		if (thread->alloc_sample_countdown > 0)
+			return;
+
+		thread->alloc_sample_countdown = next_alloc_sample (thread);
+		sampled = TYPE_ALLOC_SAMPLED;
+	}
+
+	int do_bt = (nocalls && InterlockedRead (&runtime_inited) && !notraces) ? TYPE_ALLOC_BT : 0;
+
 	if (do_bt)
 		collect_bt (&data);
 
@@ -1598,6 +1969,7 @@ gc_alloc (MonoProfiler *prof, MonoObject *obj, MonoClass *klass)
 		LEB128_SIZE /* klass */ +
 		LEB128_SIZE /* obj */ +
 		LEB128_SIZE /* size */ +
+		(sampled ? LEB128_SIZE /* interval */ : 0) +
 		(do_bt ? (
 			LEB128_SIZE /* count */ +
 			data.count * (
@@ -1606,11 +1978,14 @@ gc_alloc (MonoProfiler *prof, MonoObject *obj, MonoClass *klass)
 		) : 0)
 	);
 
-	emit_event (logbuffer, do_bt | TYPE_ALLOC);
+	emit_event (logbuffer, do_bt | sampled | TYPE_ALLOC);
 	emit_ptr (logbuffer, klass);
 	emit_obj (logbuffer, obj);
 	emit_value (logbuffer, len);
 
+	if (sampled)
+		emit_uvalue (logbuffer, alloc_sample_interval);
+
 	if (do_bt)
 		emit_bt (prof, logbuffer, &data);
 
@@ -2172,6 +2547,7 @@ thread_end (MonoProfiler *prof, uintptr_t tid)
 	MonoProfilerThread *thread = PROF_TLS_GET ();
 
 	thread->ended = TRUE;
+	release_sample_ring (thread);
 	remove_thread (thread);
 
 	PROF_TLS_SET (NULL);
@@ -2380,6 +2756,53 @@ mono_sample_hit (MonoProfiler *profiler, unsigned char *ip, void *context)
 	mono_thread_hazardous_try_free (sample, enqueue_sample_hit);
 }
 
+static void
+mono_sample_call_chain (MonoProfiler *profiler, int call_chain_depth, guchar **ips, void *context)
+{
+	/*
+	 * Like mono_sample_hit (), this runs in the signal handler. The runtime
+	 * already walked the frame pointers, so all we do here is copy the IPs.
+	 */
+
+	if (InterlockedRead (&in_shutdown))
+		return;
+
+	MonoProfilerThread *thread = PROF_TLS_GET ();
+	SampleRing *ring = thread ? thread->sample_ring : NULL;
+
+	if (!ring) {
+		InterlockedIncrement (&sample_drops_ctr);
+		return;
+	}
+
+	guint32 read = ring->read_pos;
+	guint32 write = ring->write_pos;
+	guint32 size = SAMPLE_RECORD_WORDS (call_chain_depth);
+
+	if (SAMPLE_RING_WORDS - (write - read) < size) {
+		InterlockedIncrement (&sample_drops_ctr);
+		mono_os_sem_post (&profiler->dumper_queue_sem);
+		return;
+	}
+
+	// The dumper is done with the space we are about to use.
+	mono_memory_barrier ();
+
+	ring->data [write++ % SAMPLE_RING_WORDS] = call_chain_depth;
+	ring->data [write++ % SAMPLE_RING_WORDS] = current_time ();
+	ring->data [write++ % SAMPLE_RING_WORDS] = (uintptr_t) mono_domain_get ();
+
+	for (int i = 0; i < call_chain_depth; ++i)
+		ring->data [write++ % SAMPLE_RING_WORDS] = (uintptr_t) ips [i];
+
+	mono_memory_write_barrier ();
+	ring->write_pos = write;
+
+	// Don't wait for the next drain if the ring fills up.
+	if (write - read > SAMPLE_RING_WORDS / 2)
+		mono_os_sem_post (&profiler->dumper_queue_sem);
+}
+
 static uintptr_t *code_pages = 0;
 static int num_code_pages = 0;
 static int size_code_pages = 0;
@@ -3898,6 +4321,10 @@ log_shutdown (MonoProfiler *prof)
 		g_free (cur);
 	}
 
+	g_free (hs_entries);
+	g_free (hs_refs);
+	g_free (hs_offsets);
+
 	/*
 	 * Ensure that we empty the LLS completely, even if some nodes are
 	 * not immediately removed upon calling mono_lls_remove (), by
@@ -3943,8 +4370,8 @@ log_shutdown (MonoProfiler *prof)
 	 */
 	mono_thread_hazardous_try_free_all ();
 
-	g_assert (!InterlockedRead (&buffer_rwlock_count) && "Why is the reader count still non-zero?");
-	g_assert (!InterlockedReadPointer (&buffer_rwlock_exclusive) && "Why does someone still hold the exclusive lock?");
+	g_assert (!(InterlockedRead (&buffer_sync_epoch) & 1) && "Why is the sync epoch still odd?");
+	g_assert (!InterlockedReadPointer (&buffer_sync_owner) && "Why is a sync point still in progress?");
 
 #if defined (HAVE_SYS_ZLIB)
 	if (prof->gzfile)
@@ -4097,11 +4524,11 @@ helper_thread (void *arg)
 		if (!no_counters)
 			counters_and_perfcounters_sample (prof);
 
-		buffer_lock_excl ();
+		buffer_sync_begin ();
 
 		sync_point (SYNC_POINT_PERIODIC);
 
-		buffer_unlock_excl ();
+		buffer_sync_end ();
 
 		// Are we shutting down?
 		if (FD_ISSET (prof->pipes [0], &rfds)) {
@@ -4360,6 +4787,105 @@ reuse_sample_hit (gpointer p)
 	mono_lock_free_queue_enqueue (&sample->prof->sample_reuse_queue, &sample->node);
 }
 
+/* How often the dumper thread drains the sample rings, in ms */
+#define SAMPLE_RING_DRAIN_INTERVAL 100
+#define SAMPLE_SYMBOL_CACHE_SIZE 4096
+
+typedef struct {
+	uintptr_t ip;
+	MonoDomain *domain;
+	MonoMethod *method;
+} SampleSymbol;
+
+// Only used by the dumper thread. Cleared for every drain, since code can be freed in between.
+static SampleSymbol sample_symbol_cache [SAMPLE_SYMBOL_CACHE_SIZE];
+
+static MonoMethod *
+resolve_sample_ip (MonoDomain *domain, uintptr_t ip)
+{
+	SampleSymbol *sym = &sample_symbol_cache [(ip >> 2) % SAMPLE_SYMBOL_CACHE_SIZE];
+
+	if (sym->ip == ip && sym->domain == domain)
+		return sym->method;
+
+	MonoJitInfo *ji = domain ? mono_jit_info_table_find (domain, (char *) ip) : NULL;
+
+	sym->ip = ip;
+	sym->domain = domain;
+	sym->method = ji && !ji->is_trampoline ? mono_jit_info_get_method (ji) : NULL;
+
+	return sym->method;
+}
+
+static void
+drain_sample_ring (SampleRing *ring)
+{
+	guint32 read = ring->read_pos;
+	guint32 write = ring->write_pos;
+	MonoMethod *methods [MAX_FRAMES];
+
+	// The records were written before write_pos.
+	mono_memory_read_barrier ();
+
+	while (read != write) {
+		int count = ring->data [read++ % SAMPLE_RING_WORDS];
+		uint64_t time = ring->data [read++ % SAMPLE_RING_WORDS];
+		MonoDomain *domain = (MonoDomain *) (uintptr_t) ring->data [read++ % SAMPLE_RING_WORDS];
+		uintptr_t ip = count ? ring->data [read % SAMPLE_RING_WORDS] : 0;
+		int managed = 0;
+
+		for (int i = 0; i < count; ++i) {
+			MonoMethod *method = resolve_sample_ip (domain, ring->data [read++ % SAMPLE_RING_WORDS]);
+
+			if (method && managed < num_frames)
+				methods [managed++] = method;
+		}
+
+		// Done with the record before the owner can overwrite it.
+		mono_memory_barrier ();
+		ring->read_pos = read;
+
+		ENTER_LOG (&sample_hits_ctr, logbuffer,
+			EVENT_SIZE /* event */ +
+			BYTE_SIZE /* type */ +
+			LEB128_SIZE /* tid */ +
+			LEB128_SIZE /* count */ +
+			1 * (
+				LEB128_SIZE /* ip */
+			) +
+			LEB128_SIZE /* managed count */ +
+			managed * (
+				LEB128_SIZE /* method */
+			)
+		);
+
+		emit_event_time (logbuffer, TYPE_SAMPLE | TYPE_SAMPLE_HIT, time);
+		emit_byte (logbuffer, SAMPLE_CYCLES);
+		emit_ptr (logbuffer, (void *) ring->tid);
+		emit_value (logbuffer, 1);
+		emit_ptr (logbuffer, (void *) ip);
+		add_code_pointer (ip);
+
+		emit_uvalue (logbuffer, managed);
+
+		for (int i = 0; i < managed; ++i)
+			emit_method (logbuffer, methods [i]);
+
+		EXIT_LOG_EXPLICIT (DO_SEND, NO_REQUESTS);
+	}
+}
+
+static void
+drain_sample_rings (MonoProfiler *prof)
+{
+	memset (sample_symbol_cache, 0, sizeof (sample_symbol_cache));
+
+	for (SampleRing *ring = sample_rings; ring; ring = ring->next)
+		drain_sample_ring (ring);
+
+	dump_unmanaged_coderefs (prof);
+}
+
 static gboolean
 handle_dumper_queue_entry (MonoProfiler *prof)
 {
@@ -4434,13 +4960,21 @@ dumper_thread (void *arg)
 	MonoProfilerThread *thread = init_thread (prof, FALSE);
 
 	while (InterlockedRead (&prof->run_dumper_thread)) {
-		mono_os_sem_wait (&prof->dumper_queue_sem, MONO_SEM_FLAGS_NONE);
+		if (sample_fp_walk) {
+			mono_os_sem_timedwait (&prof->dumper_queue_sem, SAMPLE_RING_DRAIN_INTERVAL, MONO_SEM_FLAGS_NONE);
+			drain_sample_rings (prof);
+		} else
+			mono_os_sem_wait (&prof->dumper_queue_sem, MONO_SEM_FLAGS_NONE);
+
 		handle_dumper_queue_entry (prof);
 	}
 
 	/* Drain any remaining entries on shutdown. */
 	while (handle_dumper_queue_entry (prof));
 
+	if (sample_fp_walk)
+		drain_sample_rings (prof);
+
 	send_log_unsafe (FALSE);
 	deinit_thread (thread);
 
@@ -4472,6 +5006,7 @@ runtime_initialized (MonoProfiler *profiler)
 	InterlockedWrite (&runtime_inited, 1);
 
 	register_counter ("Sample events allocated", &sample_allocations_ctr);
+	register_counter ("Sample events dropped", &sample_drops_ctr);
 	register_counter ("Log buffers allocated", &buffer_allocations_ctr);
 
 	register_counter ("Event: Sync points", &sync_points_ctr);
@@ -4479,6 +5014,7 @@ runtime_initialized (MonoProfiler *profiler)
 	register_counter ("Event: Heap starts", &heap_starts_ctr);
 	register_counter ("Event: Heap ends", &heap_ends_ctr);
 	register_counter ("Event: Heap roots", &heap_roots_ctr);
+	register_counter ("Event: Heap frees", &heap_frees_ctr);
 	register_counter ("Event: GC events", &gc_events_ctr);
 	register_counter ("Event: GC resizes", &gc_resizes_ctr);
 	register_counter ("Event: GC allocations", &gc_allocs_ctr);
@@ -4631,13 +5167,18 @@ usage (int do_exit)
 	printf ("Options:\n");
 	printf ("\thelp                 show this usage info\n");
 	printf ("\t[no]alloc            enable/disable recording allocation info\n");
+	printf ("\tallocsample[=BYTES]  record one allocation every BYTES bytes on average (default 512k)\n");
 	printf ("\t[no]calls            enable/disable recording enter/leave method events\n");
 	printf ("\theapshot[=MODE]      record heap shot info (by default at each major collection)\n");
 	printf ("\t                     MODE: every XXms milliseconds, every YYgc collections, ondemand\n");
+	printf ("\theapshot-incremental[=MODE] like heapshot, but only record the changes since the previous heap shot\n");
 	printf ("\tcounters             sample counters every 1s\n");
 	printf ("\tsample[=TYPE]        use statistical sampling mode (by default cycles/100)\n");
 	printf ("\t                     TYPE: cycles,instr,cacherefs,cachemiss,branches,branchmiss\n");
 	printf ("\t                     TYPE can be followed by /FREQUENCY\n");
+	printf ("\tsamplewalk=MODE      how sample stacks are collected (by default managed)\n");
+	printf ("\t                     MODE: managed (walk managed frames in the signal handler),\n");
+	printf ("\t                     fp (copy the frame pointer chain, resolve it on a helper thread)\n");
 	printf ("\tmaxframes=NUM        collect up to NUM stack frames\n");
 	printf ("\tcalldepth=NUM        ignore method events for call chain depth bigger than NUM\n");
 	printf ("\toutput=FILENAME      write the data to file FILENAME (-FILENAME to overwrite)\n");
@@ -4824,6 +5365,13 @@ mono_profiler_startup (const char *desc)
 			allocs_enabled = 1;
 			continue;
 		}
+		if ((opt = match_option (p, "allocsample", &val)) != p) {
+			char *end;
+			allocs_enabled = 1;
+			alloc_sample_interval = val ? strtoull (val, &end, 10) : 512 * 1024;
+			g_free (val);
+			continue;
+		}
 		if ((opt = match_option (p, "noalloc", NULL)) != p) {
 			events &= ~MONO_PROFILE_ALLOCATIONS;
 			events &= ~MONO_PROFILE_GC_MOVES;
@@ -4856,6 +5404,16 @@ mono_profiler_startup (const char *desc)
 			sampling_mode = MONO_PROFILER_STAT_MODE_PROCESS;
 			continue;
 		}
+		if ((opt = match_option (p, "heapshot-incremental", &val)) != p) {
+			events &= ~MONO_PROFILE_ALLOCATIONS;
+			events &= ~MONO_PROFILE_GC_MOVES;
+			events &= ~MONO_PROFILE_ENTER_LEAVE;
+			nocalls = 1;
+			do_heap_shot = 1;
+			hs_incremental = TRUE;
+			set_hsmode (val, 1);
+			continue;
+		}
 		if ((opt = match_option (p, "heapshot", &val)) != p) {
 			events &= ~MONO_PROFILE_ALLOCATIONS;
 			events &= ~MONO_PROFILE_GC_MOVES;
@@ -4865,6 +5423,16 @@ mono_profiler_startup (const char *desc)
 			set_hsmode (val, 1);
 			continue;
 		}
+		if ((opt = match_option (p, "samplewalk", &val)) != p) {
+			if (!val || !strcmp (val, "managed"))
+				sample_fp_walk = FALSE;
+			else if (!strcmp (val, "fp"))
+				sample_fp_walk = TRUE;
+			else
+				usage (1);
+			g_free (val);
+			continue;
+		}
 		if ((opt = match_option (p, "sample", &val)) != p) {
 			events &= ~MONO_PROFILE_ALLOCATIONS;
 			events &= ~MONO_PROFILE_GC_MOVES;
@@ -5023,6 +5591,8 @@ mono_profiler_startup (const char *desc)
 		events |= MONO_PROFILE_STATISTICAL;
 		mono_profiler_set_statistical_mode (sampling_mode, sample_freq);
 		mono_profiler_install_statistical (mono_sample_hit);
+		if (sample_fp_walk)
+			mono_profiler_install_statistical_call_chain (mono_sample_call_chain, num_frames + 1, MONO_PROFILER_CALL_CHAIN_NATIVE);
 	}
 
 	mono_profiler_set_events ((MonoProfileFlags)events);
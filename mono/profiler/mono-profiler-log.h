@@ -5,7 +5,7 @@
 #define LOG_HEADER_ID 0x4D505A01
 #define LOG_VERSION_MAJOR 1
 #define LOG_VERSION_MINOR 1
-#define LOG_DATA_VERSION 13
+#define LOG_DATA_VERSION 14
 
 /*
  * Changes in major/minor versions:
@@ -58,6 +58,9 @@
                moved the time field in TYPE_SAMPLE_HIT to right after the event byte, now encoded as a regular time field
                changed the time field in TYPE_SAMPLE_COUNTERS to be encoded as a regular time field (in nanoseconds)
                added TYPE_GC_FINALIZE_{START,END,OBJECT_START,OBJECT_END}
+ * version 14: added TYPE_ALLOC_SAMPLED
+               added TYPE_HEAP_DELTA_START and TYPE_HEAP_FREED
+               added MONO_GC_EVENT_{PIN,SCAN_REMSETS,SCAN_ROOTS,DRAIN_GRAY,FINALIZATION,BRIDGE}_{START,END}
  */
 
 enum {
@@ -77,6 +80,8 @@ enum {
 	TYPE_HEAP_END    = 1 << 4,
 	TYPE_HEAP_OBJECT = 2 << 4,
 	TYPE_HEAP_ROOT   = 3 << 4,
+	TYPE_HEAP_DELTA_START = 4 << 4,
+	TYPE_HEAP_FREED  = 5 << 4,
 	/* extended type for TYPE_METADATA */
 	TYPE_END_LOAD     = 2 << 4,
 	TYPE_END_UNLOAD   = 4 << 4,
@@ -104,6 +109,7 @@ enum {
 	/* extended type for TYPE_ALLOC */
 	TYPE_ALLOC_NO_BT  = 0 << 4,
 	TYPE_ALLOC_BT     = 1 << 4,
+	TYPE_ALLOC_SAMPLED = 2 << 4,
 	/* extended type for TYPE_MONITOR */
 	TYPE_MONITOR_NO_BT  = 0 << 7,
 	TYPE_MONITOR_BT     = 1 << 7,
@@ -59,6 +59,7 @@
 #include <assert.h>
 #include <stdio.h>
 #include <time.h>
+#include <math.h>
 #if !defined(__APPLE__) && !defined(__FreeBSD__)
 #include <malloc.h>
 #endif
@@ -615,11 +616,15 @@ struct _ClassDesc {
 	intptr_t klass;
 	char *name;
 	intptr_t allocs;
+	/* Estimated number of allocations, when allocations were sampled */
+	double sampled_allocs;
 	uint64_t alloc_size;
 	TraceDesc traces;
 };
 
 static ClassDesc* class_hash [HASH_SIZE] = {0};
+/* Set when the counts in the allocation summary are estimates */
+static int alloc_sampling;
 static int num_classes = 0;
 
 static ClassDesc*
@@ -1035,6 +1040,110 @@ dump_samples (void)
 	}
 }
 
+typedef struct {
+	uintptr_t ip;
+	/* Managed frames, outermost first, separated by ';' */
+	char *stack;
+} FoldedSample;
+
+static FILE* folded_outfile = NULL;
+static GHashTable *folded_stacks = NULL;
+static FoldedSample *folded_samples = NULL;
+static int num_folded_samples = 0;
+static int size_folded_samples = 0;
+
+static void
+add_folded_sample (uintptr_t ip, MethodDesc **frames, int count)
+{
+	GString *str = g_string_new (NULL);
+	char *stack;
+	int i;
+
+	for (i = count - 1; i >= 0; --i) {
+		if (str->len)
+			g_string_append_c (str, ';');
+		g_string_append (str, frames [i]->name);
+	}
+
+	if (!folded_stacks)
+		folded_stacks = g_hash_table_new (g_str_hash, g_str_equal);
+	stack = (char *) g_hash_table_lookup (folded_stacks, str->str);
+	if (stack) {
+		g_string_free (str, TRUE);
+	} else {
+		stack = g_string_free (str, FALSE);
+		g_hash_table_insert (folded_stacks, stack, stack);
+	}
+
+	if (num_folded_samples == size_folded_samples) {
+		size_folded_samples *= 2;
+		if (!size_folded_samples)
+			size_folded_samples = 32;
+		folded_samples = (FoldedSample *) g_realloc (folded_samples, size_folded_samples * sizeof (FoldedSample));
+	}
+	folded_samples [num_folded_samples].ip = ip;
+	folded_samples [num_folded_samples++].stack = stack;
+}
+
+static void
+print_folded_stack (gpointer key, gpointer value, gpointer user_data)
+{
+	fprintf (folded_outfile, "%s %u\n", (char *) key, GPOINTER_TO_UINT (value));
+}
+
+/*
+ * Write the sample hits in the folded format used by flame graph tools: one
+ * line per distinct stack, frames separated by ';', followed by the number
+ * of samples. An unmanaged leaf is appended to the managed frames.
+ */
+static void
+dump_folded_stacks (void)
+{
+	GHashTable *leaves = g_hash_table_new (NULL, NULL);
+	GHashTable *lines = g_hash_table_new (g_str_hash, g_str_equal);
+	int i;
+
+	qsort (usymbols, usymbols_num, sizeof (UnmanagedSymbol*), compare_usymbol_addr);
+	for (i = 0; i < num_folded_samples; ++i) {
+		FoldedSample *sample = &folded_samples [i];
+		const char *leaf = (const char *) g_hash_table_lookup (leaves, (gpointer) sample->ip);
+		char *line;
+		gpointer count;
+
+		if (!leaf) {
+			/* The managed leaf is already the innermost frame of the stack */
+			if (lookup_method_by_ip (sample->ip)) {
+				leaf = "";
+			} else {
+				UnmanagedSymbol *usym = lookup_unmanaged_symbol (sample->ip);
+				if (!usym)
+					usym = lookup_unmanaged_binary (sample->ip);
+				leaf = usym ? usym->name : "[unknown]";
+			}
+			g_hash_table_insert (leaves, (gpointer) sample->ip, (gpointer) leaf);
+		}
+
+		if (!*leaf)
+			line = g_strdup (sample->stack);
+		else if (*sample->stack)
+			line = g_strdup_printf ("%s;%s", sample->stack, leaf);
+		else
+			line = g_strdup (leaf);
+		if (!*line) {
+			g_free (line);
+			continue;
+		}
+
+		count = g_hash_table_lookup (lines, line);
+		if (count)
+			g_free (line);
+		g_hash_table_insert (lines, line, GUINT_TO_POINTER (GPOINTER_TO_UINT (count) + 1));
+	}
+	g_hash_table_foreach (lines, print_folded_stack, NULL);
+	g_hash_table_destroy (lines);
+	g_hash_table_destroy (leaves);
+}
+
 typedef struct _HeapClassDesc HeapClassDesc;
 typedef struct {
 	HeapClassDesc *klass;
@@ -1108,6 +1217,7 @@ add_heap_class_rev (HeapClassDesc *from, HeapClassDesc *to)
 typedef struct {
 	uintptr_t objaddr;
 	HeapClassDesc *hklass;
+	uint64_t size;
 	uintptr_t num_refs;
 	uintptr_t refs [0];
 } HeapObjectDesc;
@@ -1127,10 +1237,14 @@ struct _HeapShot {
 	uintptr_t *roots;
 	uintptr_t *roots_extra;
 	int *roots_types;
+	/* Only the changes since the previous incremental heap shot were logged */
+	int incremental;
 };
 
 static HeapShot *heap_shots = NULL;
 static int num_heap_shots = 0;
+/* The incremental heap shot whose objects the next one starts from */
+static HeapShot *last_incremental_heap_shot = NULL;
 
 static HeapShot*
 new_heap_shot (uint64_t timestamp)
@@ -1228,11 +1342,12 @@ add_heap_shot_class (HeapShot *hs, ClassDesc *klass, uint64_t size)
 }
 
 static HeapObjectDesc*
-alloc_heap_obj (uintptr_t objaddr, HeapClassDesc *hklass, uintptr_t num_refs)
+alloc_heap_obj (uintptr_t objaddr, HeapClassDesc *hklass, uint64_t size, uintptr_t num_refs)
 {
 	HeapObjectDesc* ho = (HeapObjectDesc *) g_calloc (sizeof (HeapObjectDesc) + num_refs * sizeof (uintptr_t), 1);
 	ho->objaddr = objaddr;
 	ho->hklass = hklass;
+	ho->size = size;
 	ho->num_refs = num_refs;
 	return ho;
 }
@@ -1266,7 +1381,7 @@ heap_shot_obj_add_refs (HeapShot *hs, uintptr_t objaddr, uintptr_t num, uintptr_
 	HeapObjectDesc **hash = hs->objects_hash;
 	uintptr_t i = heap_shot_find_obj_slot (hs, objaddr);
 	if (i >= 0) {
-		HeapObjectDesc* ho = alloc_heap_obj (objaddr, hash [i]->hklass, hash [i]->num_refs + num);
+		HeapObjectDesc* ho = alloc_heap_obj (objaddr, hash [i]->hklass, hash [i]->size, hash [i]->num_refs + num);
 		*ref_offset = hash [i]->num_refs;
 		memcpy (ho->refs, hash [i]->refs, hash [i]->num_refs * sizeof (uintptr_t));
 		g_free (hash [i]);
@@ -1325,6 +1440,51 @@ add_heap_shot_obj (HeapShot *hs, HeapObjectDesc *obj)
 	hs->objects_count += add_heap_hashed_obj (hs->objects_hash, hs->objects_hash_size, obj);
 }
 
+static void
+heap_shot_remove_obj (HeapShot *hs, uintptr_t objaddr)
+{
+	uintptr_t i, j;
+	HeapObjectDesc *ho;
+	if (!hs->objects_hash_size)
+		return;
+	i = heap_shot_find_obj_slot (hs, objaddr);
+	if (i == -1)
+		return;
+	ho = hs->objects_hash [i];
+	ho->hklass->count--;
+	ho->hklass->total_size -= ho->size;
+	g_free (ho);
+	hs->objects_hash [i] = NULL;
+	hs->objects_count--;
+	/* reinsert the rest of the cluster, so that lookups don't stop at the hole */
+	for (j = (i + 1) % hs->objects_hash_size; hs->objects_hash [j]; j = (j + 1) % hs->objects_hash_size) {
+		ho = hs->objects_hash [j];
+		hs->objects_hash [j] = NULL;
+		add_heap_hashed_obj (hs->objects_hash, hs->objects_hash_size, ho);
+	}
+}
+
+/*
+ * An incremental heap shot starts from the objects of the previous one, the
+ * log only contains the objects that were added, changed or removed since.
+ */
+static void
+heap_shot_carry_objects (HeapShot *hs, HeapShot *prev)
+{
+	uintptr_t i;
+	hs->objects_hash = prev->objects_hash;
+	hs->objects_hash_size = prev->objects_hash_size;
+	hs->objects_count = prev->objects_count;
+	prev->objects_hash = NULL;
+	prev->objects_hash_size = 0;
+	prev->objects_count = 0;
+	for (i = 0; i < hs->objects_hash_size; ++i) {
+		HeapObjectDesc *ho = hs->objects_hash [i];
+		if (ho)
+			ho->hklass = add_heap_shot_class (hs, ho->hklass->klass, ho->size);
+	}
+}
+
 static void
 heap_shot_resolve_reverse_refs (HeapShot *hs)
 {
@@ -1529,6 +1689,34 @@ typedef struct {
 	RemCtxContext *current_remctx;
 } ProfContext;
 
+/* Phases of a GC pause, each delimited by a pair of GC events */
+enum {
+	GC_PHASE_SUSPEND,
+	GC_PHASE_PIN,
+	GC_PHASE_SCAN_REMSETS,
+	GC_PHASE_SCAN_ROOTS,
+	GC_PHASE_DRAIN_GRAY,
+	GC_PHASE_FINALIZATION,
+	GC_PHASE_BRIDGE,
+	GC_PHASE_RESTART,
+	GC_PHASE_NUM
+};
+
+static const struct {
+	const char *name;
+	int start_event;
+	int end_event;
+} gc_phases [GC_PHASE_NUM] = {
+	{ "suspend", MONO_GC_EVENT_PRE_STOP_WORLD, MONO_GC_EVENT_POST_STOP_WORLD },
+	{ "pin", MONO_GC_EVENT_PIN_START, MONO_GC_EVENT_PIN_END },
+	{ "remsets", MONO_GC_EVENT_SCAN_REMSETS_START, MONO_GC_EVENT_SCAN_REMSETS_END },
+	{ "roots", MONO_GC_EVENT_SCAN_ROOTS_START, MONO_GC_EVENT_SCAN_ROOTS_END },
+	{ "mark", MONO_GC_EVENT_DRAIN_GRAY_START, MONO_GC_EVENT_DRAIN_GRAY_END },
+	{ "finalization", MONO_GC_EVENT_FINALIZATION_START, MONO_GC_EVENT_FINALIZATION_END },
+	{ "bridge", MONO_GC_EVENT_BRIDGE_START, MONO_GC_EVENT_BRIDGE_END },
+	{ "restart", MONO_GC_EVENT_PRE_START_WORLD, MONO_GC_EVENT_POST_START_WORLD },
+};
+
 struct _ThreadContext {
 	ThreadContext *next;
 	intptr_t thread_id;
@@ -1549,6 +1737,10 @@ struct _ThreadContext {
 	uintptr_t *roots_extra;
 	int *roots_types;
 	uint64_t gc_start_times [3];
+	/* The GC pause in progress on this thread */
+	uint64_t pause_start_time;
+	uint64_t phase_start_times [GC_PHASE_NUM];
+	uint64_t phase_times [GC_PHASE_NUM];
 };
 
 struct _DomainContext {
@@ -1841,6 +2033,9 @@ typedef struct {
 	int count;
 } GCDesc;
 static GCDesc gc_info [3];
+/* count is the number of pauses the phase was part of, max_time the longest of them */
+static GCDesc gc_phase_info [3][GC_PHASE_NUM];
+static FILE* gc_phases_outfile = NULL;
 static uint64_t max_heap_size;
 static uint64_t gc_object_moves;
 static int gc_resizes;
@@ -1870,11 +2065,67 @@ gc_event_name (int ev)
 	case MONO_GC_EVENT_PRE_START_WORLD: return "pre start";
 	case MONO_GC_EVENT_POST_START_WORLD: return "post start";
 	case MONO_GC_EVENT_POST_START_WORLD_UNLOCKED: return "post start unlock";
+	case MONO_GC_EVENT_PIN_START: return "pin start";
+	case MONO_GC_EVENT_PIN_END: return "pin end";
+	case MONO_GC_EVENT_SCAN_REMSETS_START: return "scan remsets start";
+	case MONO_GC_EVENT_SCAN_REMSETS_END: return "scan remsets end";
+	case MONO_GC_EVENT_SCAN_ROOTS_START: return "scan roots start";
+	case MONO_GC_EVENT_SCAN_ROOTS_END: return "scan roots end";
+	case MONO_GC_EVENT_DRAIN_GRAY_START: return "drain gray start";
+	case MONO_GC_EVENT_DRAIN_GRAY_END: return "drain gray end";
+	case MONO_GC_EVENT_FINALIZATION_START: return "finalization start";
+	case MONO_GC_EVENT_FINALIZATION_END: return "finalization end";
+	case MONO_GC_EVENT_BRIDGE_START: return "bridge start";
+	case MONO_GC_EVENT_BRIDGE_END: return "bridge end";
 	default:
 		return "unknown";
 	}
 }
 
+static void
+gc_phase_event (ThreadContext *thread, int ev, int gen, uint64_t timestamp)
+{
+	int i;
+
+	if (ev == MONO_GC_EVENT_PRE_STOP_WORLD) {
+		thread->pause_start_time = timestamp;
+		memset (thread->phase_times, 0, sizeof (thread->phase_times));
+	}
+
+	for (i = 0; i < GC_PHASE_NUM; ++i) {
+		if (ev == gc_phases [i].start_event)
+			thread->phase_start_times [i] = timestamp;
+		else if (ev == gc_phases [i].end_event && thread->phase_start_times [i])
+			thread->phase_times [i] += timestamp - thread->phase_start_times [i];
+	}
+
+	if (ev != MONO_GC_EVENT_POST_START_WORLD || !thread->pause_start_time)
+		return;
+
+	for (i = 0; i < GC_PHASE_NUM; ++i) {
+		GCDesc *info = &gc_phase_info [gen][i];
+
+		if (!thread->phase_times [i])
+			continue;
+		info->count++;
+		info->total_time += thread->phase_times [i];
+		if (thread->phase_times [i] > info->max_time)
+			info->max_time = thread->phase_times [i];
+	}
+
+	if (gc_phases_outfile) {
+		fprintf (gc_phases_outfile, "pause %d %llu %llu", gen,
+			(unsigned long long) (thread->pause_start_time - startup_time),
+			(unsigned long long) (timestamp - thread->pause_start_time));
+		for (i = 0; i < GC_PHASE_NUM; ++i)
+			fprintf (gc_phases_outfile, " %llu", (unsigned long long) thread->phase_times [i]);
+		fprintf (gc_phases_outfile, "\n");
+	}
+
+	thread->pause_start_time = 0;
+	memset (thread->phase_start_times, 0, sizeof (thread->phase_start_times));
+}
+
 static const char*
 sync_point_name (int type)
 {
@@ -2364,6 +2615,7 @@ decode_buffer (ProfContext *ctx)
 					fprintf (outfile, "incorrect gc gen: %d\n", gen);
 					break;
 				}
+				gc_phase_event (thread, ev, gen, time_base);
 				if (ev == MONO_GC_EVENT_START) {
 					thread->gc_start_times [gen] = time_base;
 					gc_info [gen].count++;
@@ -2552,6 +2804,8 @@ decode_buffer (ProfContext *ctx)
 		}
 		case TYPE_ALLOC: {
 			int has_bt = *p & TYPE_ALLOC_BT;
+			int sampled = *p & TYPE_ALLOC_SAMPLED;
+			uint64_t interval = 0;
 			uint64_t tdiff = decode_uleb128 (p + 1, &p);
 			intptr_t ptrdiff = decode_sleb128 (p, &p);
 			intptr_t objdiff = decode_sleb128 (p, &p);
@@ -2561,6 +2815,8 @@ decode_buffer (ProfContext *ctx)
 			MethodDesc** frames = sframes;
 			ClassDesc *cd = lookup_class (ptr_base + ptrdiff);
 			len = decode_uleb128 (p, &p);
+			if (sampled)
+				interval = decode_uleb128 (p, &p);
 			LOG_TIME (time_base, tdiff);
 			time_base += tdiff;
 			if (debug)
@@ -2575,12 +2831,26 @@ decode_buffer (ProfContext *ctx)
 			}
 			if ((thread_filter && thread_filter == thread->thread_id) || (time_base >= time_from && time_base < time_to)) {
 				BackTrace *bt;
-				cd->allocs++;
-				cd->alloc_size += len;
+				uint64_t size = len;
+				if (sampled && interval) {
+					/*
+					 * The allocation stands for all the allocations of this
+					 * size that weren't recorded, see TYPE_ALLOC_SAMPLED.
+					 */
+					double weight = 1.0 / (1.0 - exp (-(double) len / interval));
+					cd->sampled_allocs += weight;
+					size = (uint64_t) (len * weight + 0.5);
+					cd->allocs = (intptr_t) (cd->sampled_allocs + 0.5);
+					alloc_sampling = 1;
+				} else {
+					cd->allocs++;
+					cd->sampled_allocs += 1;
+				}
+				cd->alloc_size += size;
 				if (has_bt)
-					bt = add_trace_methods (frames, num_bt, &cd->traces, len);
+					bt = add_trace_methods (frames, num_bt, &cd->traces, size);
 				else
-					bt = add_trace_thread (thread, &cd->traces, len);
+					bt = add_trace_thread (thread, &cd->traces, size);
 				if (find_size && len >= find_size) {
 					if (!find_name || strstr (cd->name, find_name))
 						found_object (OBJ_ADDR (objdiff));
@@ -2649,16 +2919,21 @@ decode_buffer (ProfContext *ctx)
 				uintptr_t ref_offset = 0;
 				uintptr_t last_obj_offset = 0;
 				ClassDesc *cd = lookup_class (ptr_base + ptrdiff);
+				HeapShot *hs = thread->current_heap_shot;
+				/* incremental heap shots need the objects to carry them over to the next one */
+				int keep_objects = collect_traces || hs->incremental;
 				if (size) {
-					HeapClassDesc *hcd = add_heap_shot_class (thread->current_heap_shot, cd, size);
-					if (collect_traces) {
-						ho = alloc_heap_obj (OBJ_ADDR (objdiff), hcd, num);
-						add_heap_shot_obj (thread->current_heap_shot, ho);
+					if (hs->incremental)
+						heap_shot_remove_obj (hs, OBJ_ADDR (objdiff));
+					HeapClassDesc *hcd = add_heap_shot_class (hs, cd, size);
+					if (keep_objects) {
+						ho = alloc_heap_obj (OBJ_ADDR (objdiff), hcd, size, num);
+						add_heap_shot_obj (hs, ho);
 						ref_offset = 0;
 					}
 				} else {
-					if (collect_traces)
-						ho = heap_shot_obj_add_refs (thread->current_heap_shot, OBJ_ADDR (objdiff), num, &ref_offset);
+					if (keep_objects)
+						ho = heap_shot_obj_add_refs (hs, OBJ_ADDR (objdiff), num, &ref_offset);
 				}
 				for (i = 0; i < num; ++i) {
 					/* FIXME: use object distance to measure how good
@@ -2667,7 +2942,7 @@ decode_buffer (ProfContext *ctx)
 					uintptr_t offset = ctx->data_version > 1? last_obj_offset + decode_uleb128 (p, &p): -1;
 					intptr_t obj1diff = decode_sleb128 (p, &p);
 					last_obj_offset = offset;
-					if (collect_traces)
+					if (keep_objects)
 						ho->refs [ref_offset + i] = OBJ_ADDR (obj1diff);
 					if (num_tracked_objects)
 						track_obj_reference (OBJ_ADDR (obj1diff), OBJ_ADDR (objdiff), cd);
@@ -2725,16 +3000,35 @@ decode_buffer (ProfContext *ctx)
 					thread->roots_types = NULL;
 					heap_shot_resolve_reverse_refs (hs);
 					heap_shot_mark_objects (hs);
-					heap_shot_free_objects (hs);
+					if (!hs->incremental)
+						heap_shot_free_objects (hs);
 				}
 				thread->current_heap_shot = NULL;
-			} else if (subtype == TYPE_HEAP_START) {
+			} else if (subtype == TYPE_HEAP_START || subtype == TYPE_HEAP_DELTA_START) {
 				uint64_t tdiff = decode_uleb128 (p + 1, &p);
 				LOG_TIME (time_base, tdiff);
 				time_base += tdiff;
 				if (debug)
-					fprintf (outfile, "heap shot start\n");
+					fprintf (outfile, "heap shot start%s\n", subtype == TYPE_HEAP_DELTA_START ? " (incremental)" : "");
 				thread->current_heap_shot = new_heap_shot (time_base);
+				if (subtype == TYPE_HEAP_DELTA_START) {
+					thread->current_heap_shot->incremental = 1;
+					if (last_incremental_heap_shot)
+						heap_shot_carry_objects (thread->current_heap_shot, last_incremental_heap_shot);
+					last_incremental_heap_shot = thread->current_heap_shot;
+				}
+			} else if (subtype == TYPE_HEAP_FREED) {
+				uint64_t tdiff = decode_uleb128 (p + 1, &p);
+				LOG_TIME (time_base, tdiff);
+				time_base += tdiff;
+				uintptr_t num = decode_uleb128 (p, &p);
+				int i;
+				for (i = 0; i < num; ++i) {
+					intptr_t objdiff = decode_sleb128 (p, &p);
+					if (debug)
+						fprintf (outfile, "object %p is gone\n", (void*)OBJ_ADDR (objdiff));
+					heap_shot_remove_obj (thread->current_heap_shot, OBJ_ADDR (objdiff));
+				}
 			}
 			break;
 		}
@@ -2901,8 +3195,13 @@ decode_buffer (ProfContext *ctx)
 				if (ctx->data_version > 10)
 					tid = (void *) (ptr_base + decode_sleb128 (p, &p));
 				int count = decode_uleb128 (p, &p);
+				uintptr_t leaf_ip = 0;
+				MethodDesc *frames [128];
+				int num_frames = 0;
 				for (i = 0; i < count; ++i) {
 					uintptr_t ip = ptr_base + decode_sleb128 (p, &p);
+					if (!i)
+						leaf_ip = ip;
 					if ((tstamp >= time_from && tstamp < time_to))
 						add_stat_sample (sample_type, ip);
 					if (debug)
@@ -2915,6 +3214,8 @@ decode_buffer (ProfContext *ctx)
 						int64_t ptrdiff = decode_sleb128 (p, &p);
 						method_base += ptrdiff;
 						method = lookup_method (method_base);
+						if (num_frames < G_N_ELEMENTS (frames))
+							frames [num_frames++] = method;
 						if (debug)
 							fprintf (outfile, "sample hit bt %d: %s\n", i, method->name);
 						if (ctx->data_version < 13) {
@@ -2923,6 +3224,8 @@ decode_buffer (ProfContext *ctx)
 						}
 					}
 				}
+				if (folded_outfile && (leaf_ip || num_frames) && (tstamp >= time_from && tstamp < time_to))
+					add_folded_sample (leaf_ip, frames, num_frames);
 			} else if (subtype == TYPE_SAMPLE_USYM) {
 				/* un unmanaged symbol description */
 				uintptr_t addr;
@@ -3457,6 +3760,19 @@ dump_gcs (void)
 			(unsigned long long) (gc_info [i].total_time / 1000),
 			(unsigned long long) (gc_info [i].total_time / gc_info [i].count / 1000));
 	}
+	for (i = 0; i < 3; ++i) {
+		int j;
+		for (j = 0; j < GC_PHASE_NUM; ++j) {
+			GCDesc *info = &gc_phase_info [i][j];
+			if (!info->count)
+				continue;
+			fprintf (outfile, "\tGen%d pause phase %s: pauses: %d, max time: %lluus, total time: %lluus, average: %lluus\n",
+				i, gc_phases [j].name, info->count,
+				(unsigned long long) (info->max_time / 1000),
+				(unsigned long long) (info->total_time / 1000),
+				(unsigned long long) (info->total_time / info->count / 1000));
+		}
+	}
 	for (i = 0; i < 3; ++i) {
 		if (!handle_info [i].max_live)
 			continue;
@@ -3530,6 +3846,8 @@ dump_allocations (void)
 	}
 	if (allocs)
 		fprintf (outfile, "Total memory allocated: %llu bytes in %zd objects\n", (unsigned long long) size, allocs);
+	if (allocs && alloc_sampling)
+		fprintf (outfile, "Allocations were sampled, the numbers above are estimates\n");
 }
 
 enum {
@@ -3697,7 +4015,8 @@ heap_shot_summary (HeapShot *hs, int hs_num, HeapShot *last_hs)
 	sorted = (HeapClassDesc **) g_malloc (sizeof (void*) * hs->class_count);
 	for (i = 0; i < hs->hash_size; ++i) {
 		cd = hs->class_hash [i];
-		if (!cd)
+		/* all the objects of the class may be gone in an incremental heap shot */
+		if (!cd || !cd->count)
 			continue;
 		count += cd->count;
 		size += cd->total_size;
@@ -3961,6 +4280,8 @@ dump_stats (void)
 
 	DUMP_EVENT_STAT (TYPE_ALLOC, TYPE_ALLOC_NO_BT);
 	DUMP_EVENT_STAT (TYPE_ALLOC, TYPE_ALLOC_BT);
+	DUMP_EVENT_STAT (TYPE_ALLOC, TYPE_ALLOC_SAMPLED);
+	DUMP_EVENT_STAT (TYPE_ALLOC, TYPE_ALLOC_SAMPLED | TYPE_ALLOC_BT);
 
 	DUMP_EVENT_STAT (TYPE_GC, TYPE_GC_EVENT);
 	DUMP_EVENT_STAT (TYPE_GC, TYPE_GC_RESIZE);
@@ -3989,6 +4310,8 @@ dump_stats (void)
 	DUMP_EVENT_STAT (TYPE_HEAP, TYPE_HEAP_END);
 	DUMP_EVENT_STAT (TYPE_HEAP, TYPE_HEAP_OBJECT);
 	DUMP_EVENT_STAT (TYPE_HEAP, TYPE_HEAP_ROOT);
+	DUMP_EVENT_STAT (TYPE_HEAP, TYPE_HEAP_DELTA_START);
+	DUMP_EVENT_STAT (TYPE_HEAP, TYPE_HEAP_FREED);
 
 	DUMP_EVENT_STAT (TYPE_SAMPLE, TYPE_SAMPLE_HIT);
 	DUMP_EVENT_STAT (TYPE_SAMPLE, TYPE_SAMPLE_USYM);
@@ -4166,13 +4489,15 @@ usage (void)
 	printf ("\t--verbose            increase verbosity level\n");
 	printf ("\t--debug              display decoding debug info for mprof-report devs\n");
 	printf ("\t--coverage-out=FILE  write the coverage info to FILE as XML\n");
+	printf ("\t--gc-phases-out=FILE write the duration of each GC pause and its phases to FILE\n");
+	printf ("\t--folded-out=FILE    write the sample stacks to FILE in the folded format of flame graph tools\n");
 }
 
 int
 main (int argc, char *argv[])
 {
 	ProfContext *ctx;
-	int i;
+	int i, j;
 	outfile = stdout;
 	for (i = 1; i < argc; ++i) {
 		if (strcmp ("--debug", argv [i]) == 0) {
@@ -4277,6 +4602,24 @@ main (int argc, char *argv[])
 		} else if (strcmp ("--traces", argv [i]) == 0) {
 			show_traces = 1;
 			collect_traces = 1;
+		} else if (strncmp ("--gc-phases-out=", argv [i], 16) == 0) {
+			const char *val = argv [i] + 16;
+			gc_phases_outfile = fopen (val, "w");
+			if (!gc_phases_outfile) {
+				printf ("Cannot open output file: %s\n", val);
+				return 1;
+			}
+			fprintf (gc_phases_outfile, "# pause GEN START DURATION");
+			for (j = 0; j < GC_PHASE_NUM; ++j)
+				fprintf (gc_phases_outfile, " %s", gc_phases [j].name);
+			fprintf (gc_phases_outfile, "\n");
+		} else if (strncmp ("--folded-out=", argv [i], 13) == 0) {
+			const char *val = argv [i] + 13;
+			folded_outfile = fopen (val, "w");
+			if (!folded_outfile) {
+				printf ("Cannot open output file: %s\n", val);
+				return 1;
+			}
 		} else if (strncmp ("--coverage-out=", argv [i], 15) == 0) {
 			const char *val = argv [i] + 15;
 			coverage_outfile = fopen (val, "w");
@@ -4302,5 +4645,11 @@ main (int argc, char *argv[])
 	if (num_tracked_objects)
 		return 0;
 	print_reports (ctx, reports, 0);
+	if (gc_phases_outfile)
+		fclose (gc_phases_outfile);
+	if (folded_outfile) {
+		dump_folded_stacks ();
+		fclose (folded_outfile);
+	}
 	return 0;
 }
@@ -44,9 +44,14 @@
 static guint64 stat_objects_alloced = 0;
 static guint64 stat_bytes_alloced = 0;
 static guint64 stat_bytes_alloced_los = 0;
-
+static guint64 stat_tlab_refills = 0;
+static guint64 stat_tlab_grows = 0;
+static guint64 stat_tlab_shrinks = 0;
 #endif
 
+static guint64 stat_pretenure_samples = 0;
+static guint64 stat_pretenured_classes = 0;
+
 /*
  * Allocation is done from a Thread Local Allocation Buffer (TLAB). TLABs are allocated
  * from nursery fragments.
@@ -62,11 +67,15 @@ static guint64 stat_bytes_alloced_los = 0;
 #define TLAB_NEXT	(sgen_thread_info->tlab_next)
 #define TLAB_TEMP_END	(sgen_thread_info->tlab_temp_end)
 #define TLAB_REAL_END	(sgen_thread_info->tlab_real_end)
+#define TLAB_DESIRED_SIZE	(sgen_thread_info->tlab_desired_size)
+#define TLAB_REFILLS	(sgen_thread_info->tlab_refills)
 #else
 #define TLAB_START	(__thread_info__->tlab_start)
 #define TLAB_NEXT	(__thread_info__->tlab_next)
 #define TLAB_TEMP_END	(__thread_info__->tlab_temp_end)
 #define TLAB_REAL_END	(__thread_info__->tlab_real_end)
+#define TLAB_DESIRED_SIZE	(__thread_info__->tlab_desired_size)
+#define TLAB_REFILLS	(__thread_info__->tlab_refills)
 #endif
 
 static GCObject*
@@ -103,8 +112,10 @@ zero_tlab_if_necessary (void *p, size_t size)
 		 * TLABs.  TLABs originate from fragments, which are
 		 * initialized to be faux arrays.  The remainder of
 		 * the fragments are zeroed out at initialization for
-		 * CLEAR_AT_GC, so here we just need to make sure that
-		 * the array header is zeroed.  Since we don't know
+		 * CLEAR_AT_GC, and by the background clearing thread
+		 * or the nursery allocator for CLEAR_IN_BACKGROUND, so
+		 * here we just need to make sure that the array
+		 * header is zeroed.  Since we don't know
 		 * whether we're called for the start of a fragment or
 		 * for somewhere in between, we zero in any case, just
 		 * to make sure.
@@ -173,6 +184,8 @@ sgen_alloc_obj_nolock (GCVTable vtable, size_t size)
 
 	if (real_size > SGEN_MAX_SMALL_OBJ_SIZE) {
 		p = (void **)sgen_los_alloc_large_inner (vtable, ALIGN_UP (real_size));
+	} else if (G_UNLIKELY (pretenuring_enabled) && sgen_client_vtable_is_pretenured (vtable)) {
+		return alloc_degraded (vtable, size, TRUE);
 	} else {
 		/* tlab_next and tlab_temp_end are TLS vars so accessing them might be expensive */
 
@@ -221,7 +234,7 @@ sgen_alloc_obj_nolock (GCVTable vtable, size_t size)
 				return alloc_degraded (vtable, size, FALSE);
 
 			available_in_tlab = (int)(TLAB_REAL_END - TLAB_NEXT);//We'll never have tlabs > 2Gb
-			if (size > tlab_size || available_in_tlab > SGEN_MAX_NURSERY_WASTE) {
+			if (size > TLAB_DESIRED_SIZE || available_in_tlab > SGEN_MAX_NURSERY_WASTE) {
 				/* Allocate directly from the nursery */
 				p = (void **)sgen_nursery_alloc (size);
 				if (!p) {
@@ -252,20 +265,24 @@ sgen_alloc_obj_nolock (GCVTable vtable, size_t size)
 				zero_tlab_if_necessary (p, size);
 			} else {
 				size_t alloc_size = 0;
+				size_t desired_size = TLAB_DESIRED_SIZE;
 				if (TLAB_START)
 					SGEN_LOG (3, "Retire TLAB: %p-%p [%ld]", TLAB_START, TLAB_REAL_END, (long)(TLAB_REAL_END - TLAB_NEXT - size));
 				sgen_nursery_retire_region (p, available_in_tlab);
 
-				p = (void **)sgen_nursery_alloc_range (tlab_size, size, &alloc_size);
+				p = (void **)sgen_nursery_alloc_range (desired_size, size, &alloc_size);
 				if (!p) {
 					/* See comment above in similar case. */
-					sgen_ensure_free_space (tlab_size, GENERATION_NURSERY);
+					sgen_ensure_free_space (desired_size, GENERATION_NURSERY);
 					if (!degraded_mode)
-						p = (void **)sgen_nursery_alloc_range (tlab_size, size, &alloc_size);
+						p = (void **)sgen_nursery_alloc_range (desired_size, size, &alloc_size);
 				}
 				if (!p)
 					return alloc_degraded (vtable, size, FALSE);
 
+				++TLAB_REFILLS;
+				HEAVY_STAT (++stat_tlab_refills);
+
 				/* Allocate a new TLAB from the current nursery fragment */
 				TLAB_START = (char*)p;
 				TLAB_NEXT = TLAB_START;
@@ -318,7 +335,11 @@ sgen_try_alloc_obj_nolock (GCVTable vtable, size_t size)
 	if (real_size > SGEN_MAX_SMALL_OBJ_SIZE)
 		return NULL;
 
-	if (G_UNLIKELY (size > tlab_size)) {
+	/* Pretenured objects need the GC lock, see sgen_alloc_obj_nolock () */
+	if (G_UNLIKELY (pretenuring_enabled) && sgen_client_vtable_is_pretenured (vtable))
+		return NULL;
+
+	if (G_UNLIKELY (size > TLAB_DESIRED_SIZE)) {
 		/* Allocate directly from the nursery */
 		p = (void **)sgen_nursery_alloc (size);
 		if (!p)
@@ -360,11 +381,14 @@ sgen_try_alloc_obj_nolock (GCVTable vtable, size_t size)
 			size_t alloc_size = 0;
 
 			sgen_nursery_retire_region (p, available_in_tlab);
-			new_next = (char *)sgen_nursery_alloc_range (tlab_size, size, &alloc_size);
+			new_next = (char *)sgen_nursery_alloc_range (TLAB_DESIRED_SIZE, size, &alloc_size);
 			p = (void**)new_next;
 			if (!p)
 				return NULL;
 
+			++TLAB_REFILLS;
+			HEAVY_STAT (++stat_tlab_refills);
+
 			TLAB_START = (char*)new_next;
 			TLAB_NEXT = new_next + size;
 			TLAB_REAL_END = new_next + alloc_size;
@@ -444,8 +468,10 @@ sgen_alloc_obj_pinned (GCVTable vtable, size_t size)
 	LOCK_GC;
 
 	if (size > SGEN_MAX_SMALL_OBJ_SIZE) {
-		/* large objects are always pinned anyway */
+		/* large objects are only moved by LOS compaction, which leaves these alone */
 		p = (GCObject *)sgen_los_alloc_large_inner (vtable, size);
+		if (p)
+			sgen_los_set_object_unmovable (p);
 	} else {
 		SGEN_ASSERT (9, sgen_client_vtable_is_inited (vtable), "class %s:%s is not initialized", sgen_client_vtable_get_namespace (vtable), sgen_client_vtable_get_name (vtable));
 		p = major_collector.alloc_small_pinned_obj (vtable, size, SGEN_VTABLE_HAS_REFERENCES (vtable));
@@ -474,13 +500,55 @@ sgen_alloc_obj_mature (GCVTable vtable, size_t size)
 	return res;
 }
 
+/*
+ * Resize the TLAB of a thread based on its allocation behaviour since the last
+ * collection.  Threads that keep refilling get bigger TLABs, so they go through the
+ * slow path less often, while threads that leave most of their TLAB unused give
+ * nursery space back to the others.  Must be called with the world stopped, before
+ * the TLAB pointers are cleared.
+ */
+static void
+adapt_tlab_size (SgenThreadInfo *info, guint32 max_size)
+{
+	guint32 desired = info->tlab_desired_size;
+	size_t unused = 0;
+
+	if (info->tlab_start)
+		unused = info->tlab_real_end - info->tlab_next;
+
+	if (info->tlab_refills >= SGEN_TLAB_GROW_REFILLS) {
+		if (desired < max_size) {
+			desired = MIN (desired * 2, max_size);
+			HEAVY_STAT (++stat_tlab_grows);
+		}
+	} else if (info->tlab_refills <= 1 && unused > desired / 2) {
+		if (desired > tlab_size) {
+			desired = MAX (desired / 2, tlab_size);
+			HEAVY_STAT (++stat_tlab_shrinks);
+		}
+	}
+
+	if (desired != info->tlab_desired_size)
+		SGEN_LOG (4, "Adapting TLAB size of thread %p: %u -> %u (%u refills, %zd bytes unused)",
+				info, info->tlab_desired_size, desired, info->tlab_refills, unused);
+
+	info->tlab_desired_size = desired;
+	info->tlab_refills = 0;
+}
+
 /*
  * Clear the thread local TLAB variables for all threads.
  */
 void
 sgen_clear_tlabs (void)
 {
+	/* Don't let a single thread reserve a big chunk of a small nursery. */
+	guint32 max_size = MAX (tlab_size, MIN (max_tlab_size, (guint32)(sgen_nursery_size >> 4)));
+
 	FOREACH_THREAD (info) {
+		if (adaptive_tlab_enabled)
+			adapt_tlab_size (info, max_size);
+
 		/* A new TLAB will be allocated when the thread does its first allocation */
 		info->tlab_start = NULL;
 		info->tlab_next = NULL;
@@ -489,13 +557,111 @@ sgen_clear_tlabs (void)
 	} FOREACH_THREAD_END
 }
 
+/*
+ * Pretenuring
+ *
+ * Every SGEN_PRETENURE_SAMPLE_INTERVAL nursery collections we walk the nursery after
+ * marking and count, per vtable, how many bytes were allocated and how many of them
+ * survived.  Classes whose objects almost always survive get their vtable marked as
+ * pretenured, and from then on their objects are allocated directly in the major heap,
+ * which saves us from copying them out of the nursery.  The managed allocator checks
+ * the bit, too, so that such allocations go through the slow path.
+ *
+ * Pinned objects are not counted, since they are not copied anyway.  A class doesn't
+ * get un-pretenured, because its objects don't show up in the nursery anymore.
+ */
+
+typedef struct {
+	size_t allocated;
+	size_t survived;
+} PretenureSampleEntry;
+
+static SgenHashTable pretenure_sample_hash = SGEN_HASH_TABLE_INIT (INTERNAL_MEM_PRETENURE_TABLE, INTERNAL_MEM_PRETENURE_ENTRY, sizeof (PretenureSampleEntry), sgen_aligned_addr_hash, NULL);
+
+static int collections_since_pretenure_sample;
+
+/*
+ * Returns whether this nursery collection should be sampled.  If it returns TRUE,
+ * `sgen_pretenure_sample_nursery()` must be called after the nursery has been marked,
+ * before the fragments are rebuilt.  Must be called with the world stopped, after the
+ * nursery objects have been pinned and before the roots are scanned.
+ */
+gboolean
+sgen_pretenure_should_sample (void)
+{
+	if (!pretenuring_enabled)
+		return FALSE;
+	if (++collections_since_pretenure_sample < SGEN_PRETENURE_SAMPLE_INTERVAL)
+		return FALSE;
+	collections_since_pretenure_sample = 0;
+
+	/* The free parts of the nursery must be walkable. */
+	sgen_clear_nursery_fragments ();
+	return TRUE;
+}
+
+static void
+pretenure_count_object (GCObject *obj, size_t size, void *data)
+{
+	PretenureSampleEntry *entry;
+	GCVTable vtable;
+	/* We get called with the copy of an object that was promoted. */
+	gboolean survived = !sgen_ptr_in_nursery (obj);
+
+	if (!survived && SGEN_OBJECT_IS_PINNED (obj))
+		return;
+
+	vtable = SGEN_LOAD_VTABLE (obj);
+	entry = (PretenureSampleEntry *)sgen_hash_table_lookup (&pretenure_sample_hash, vtable);
+	if (!entry) {
+		PretenureSampleEntry empty_entry = { 0, 0 };
+		sgen_hash_table_replace (&pretenure_sample_hash, vtable, &empty_entry, NULL);
+		entry = (PretenureSampleEntry *)sgen_hash_table_lookup (&pretenure_sample_hash, vtable);
+	}
+
+	entry->allocated += size;
+	if (survived)
+		entry->survived += size;
+}
+
+void
+sgen_pretenure_sample_nursery (char *start, char *end)
+{
+	GCVTable vtable;
+	PretenureSampleEntry *entry;
+
+	sgen_scan_area_with_callback (start, end, pretenure_count_object, NULL, TRUE, FALSE);
+
+	SGEN_HASH_TABLE_FOREACH (&pretenure_sample_hash, GCVTable, vtable, PretenureSampleEntry *, entry) {
+		if (entry->allocated < SGEN_PRETENURE_MIN_SAMPLE_SIZE)
+			continue;
+		if (entry->survived < entry->allocated * SGEN_PRETENURE_SURVIVAL_RATIO)
+			continue;
+
+		SGEN_LOG (1, "Pretenuring %s.%s: %zd of %zd sampled bytes survived",
+				sgen_client_vtable_get_namespace (vtable), sgen_client_vtable_get_name (vtable),
+				entry->survived, entry->allocated);
+		sgen_client_vtable_set_pretenured (vtable);
+		++stat_pretenured_classes;
+	} SGEN_HASH_TABLE_FOREACH_END;
+
+	sgen_hash_table_clean (&pretenure_sample_hash);
+	++stat_pretenure_samples;
+}
+
 void
 sgen_init_allocator (void)
 {
+	mono_counters_register ("# pretenure samples", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_pretenure_samples);
+	mono_counters_register ("# pretenured classes", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_pretenured_classes);
+
 #ifdef HEAVY_STATISTICS
 	mono_counters_register ("# objects allocated", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_objects_alloced);
 	mono_counters_register ("bytes allocated", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_bytes_alloced);
 	mono_counters_register ("bytes allocated in LOS", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_bytes_alloced_los);
+	mono_counters_register ("# TLAB refills", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_tlab_refills);
+	mono_counters_register ("# TLAB grows", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_tlab_grows);
+	mono_counters_register ("# TLAB shrinks", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_tlab_shrinks);
 #endif
 }
 
@@ -40,6 +40,27 @@ guint8 *sgen_cardtable;
 
 static gboolean need_mod_union;
 
+/* How many mod union cards precleaning found dirty since the last reset. */
+static volatile size_t num_precleaned_cards;
+
+/*
+ * Bulk copies into reference arrays don't mark cards if the major collector isn't
+ * concurrent.  Instead they record the slice of the array between the first and the last
+ * slot that now points into the nursery, and the next nursery collection scans exactly
+ * those slots.  If we run out of slices we fall back to marking cards.
+ */
+typedef struct {
+	GCObject **start;
+	size_t count;
+} ArraySlice;
+
+#define ARRAY_SLICES_MAX	1024
+/* Copies shorter than a card's worth of slots keep marking cards. */
+#define ARRAY_SLICE_MIN_COPY	(CARD_SIZE_IN_BYTES / sizeof (gpointer))
+
+static ArraySlice array_slices [ARRAY_SLICES_MAX];
+static volatile gint32 num_array_slices;
+
 #ifdef HEAVY_STATISTICS
 guint64 marked_cards;
 guint64 scanned_cards;
@@ -72,12 +93,84 @@ sgen_card_table_wbarrier_set_field (GCObject *obj, gpointer field_ptr, GCObject*
 	sgen_dummy_use (value);
 }
 
+static gboolean
+record_array_slice (GCObject **start, size_t count)
+{
+	gint32 index;
+
+	if (num_array_slices >= ARRAY_SLICES_MAX)
+		return FALSE;
+
+	index = InterlockedIncrement (&num_array_slices) - 1;
+	if (index >= ARRAY_SLICES_MAX)
+		return FALSE;
+
+	array_slices [index].start = start;
+	array_slices [index].count = count;
+	return TRUE;
+}
+
+static void
+wbarrier_arrayref_copy_to_slice (gpointer *dest, gpointer *src, int count)
+{
+	gpointer *first = NULL, *last = NULL;
+	int i;
+
+	TLAB_ACCESS_INIT;
+
+	/* The nursery is scanned in full, so there's nothing to remember. */
+	if (sgen_ptr_in_nursery (dest)) {
+		mono_gc_memmove_aligned (dest, src, count * sizeof (gpointer));
+		return;
+	}
+
+	/* A collection must not see the copy without the slice, so we do both in a critical region. */
+	ENTER_CRITICAL_REGION;
+
+	/*overlapping that required backward copying*/
+	if (src < dest && (src + count) > dest) {
+		for (i = count - 1; i >= 0; --i) {
+			gpointer value = src [i];
+			SGEN_UPDATE_REFERENCE_ALLOW_NULL (&dest [i], value);
+			if (sgen_ptr_in_nursery (value)) {
+				if (!last)
+					last = &dest [i];
+				first = &dest [i];
+			}
+		}
+	} else {
+		for (i = 0; i < count; ++i) {
+			gpointer value = src [i];
+			SGEN_UPDATE_REFERENCE_ALLOW_NULL (&dest [i], value);
+			if (sgen_ptr_in_nursery (value)) {
+				if (!first)
+					first = &dest [i];
+				last = &dest [i];
+			}
+		}
+	}
+
+	if (first && !record_array_slice ((GCObject**)first, last - first + 1)) {
+		for (; first <= last; ++first) {
+			if (sgen_ptr_in_nursery (*first))
+				sgen_card_table_mark_address ((mword)first);
+		}
+	}
+
+	EXIT_CRITICAL_REGION;
+}
+
 static void
 sgen_card_table_wbarrier_arrayref_copy (gpointer dest_ptr, gpointer src_ptr, int count)
 {
 	gpointer *dest = (gpointer *)dest_ptr;
 	gpointer *src = (gpointer *)src_ptr;
 
+	if (!need_mod_union && count >= ARRAY_SLICE_MIN_COPY && num_array_slices < ARRAY_SLICES_MAX) {
+		wbarrier_arrayref_copy_to_slice (dest, src, count);
+		return;
+	}
+
 	/*overlapping that required backward copying*/
 	if (src < dest && (src + count) > dest) {
 		gpointer *start = dest;
@@ -238,11 +331,7 @@ sgen_card_table_is_range_marked (guint8 *cards, mword address, mword size)
 	guint8 *end = cards + sgen_card_table_number_of_cards_in_range (address, size);
 
 	/*This is safe since this function is only called by code that only passes continuous card blocks*/
-	while (cards != end) {
-		if (*cards++)
-			return TRUE;
-	}
-	return FALSE;
+	return sgen_card_table_find_marked_card (cards, end) != end;
 
 }
 
@@ -255,7 +344,17 @@ sgen_card_table_record_pointer (gpointer address)
 static gboolean
 sgen_card_table_find_address (char *addr)
 {
-	return sgen_card_table_address_is_marked ((mword)addr);
+	int i, num_slices = MIN (num_array_slices, ARRAY_SLICES_MAX);
+
+	if (sgen_card_table_address_is_marked ((mword)addr))
+		return TRUE;
+
+	for (i = 0; i < num_slices; ++i) {
+		GCObject **start = array_slices [i].start;
+		if ((GCObject**)addr >= start && (GCObject**)addr < start + array_slices [i].count)
+			return TRUE;
+	}
+	return FALSE;
 }
 
 static gboolean
@@ -335,14 +434,17 @@ sgen_card_table_update_mod_union (guint8 *dest, char *obj, mword obj_size, size_
 void
 sgen_card_table_preclean_mod_union (guint8 *cards, guint8 *cards_preclean, size_t num_cards)
 {
-	size_t i;
+	size_t i, num_dirty = 0;
 
 	memcpy (cards_preclean, cards, num_cards);
 	for (i = 0; i < num_cards; i++) {
 		if (cards_preclean [i]) {
 			cards [i] = 0;
+			++num_dirty;
 		}
 	}
+	if (num_dirty)
+		SGEN_ATOMIC_ADD_P (num_precleaned_cards, num_dirty);
 	/*
 	 * When precleaning we need to make sure the card cleaning
 	 * takes place before the object is scanned. If we don't
@@ -354,6 +456,15 @@ sgen_card_table_preclean_mod_union (guint8 *cards, guint8 *cards_preclean, size_
 	mono_memory_barrier ();
 }
 
+/* Returns how many cards precleaning found dirty since the last call, and resets the count. */
+size_t
+sgen_card_table_take_num_precleaned_cards (void)
+{
+	size_t num = num_precleaned_cards;
+	num_precleaned_cards = 0;
+	return num;
+}
+
 #ifdef SGEN_HAVE_OVERLAPPING_CARDS
 
 static void
@@ -412,20 +523,38 @@ sgen_card_table_clear_cards (void)
 	/*XXX we could do this in 2 ways. using mincore or iterating over all sections/los objects */
 	sgen_major_collector_iterate_block_ranges (clear_cards);
 	sgen_los_iterate_live_block_ranges (clear_cards);
+	num_array_slices = 0;
 }
 
 static void
 sgen_card_table_finish_minor_collection (void)
 {
 	sgen_card_tables_collect_stats (FALSE);
+	num_array_slices = 0;
 }
 
+/*
+ * Slots that still point into the nursery after this, to pinned objects, get their cards
+ * marked by the copy function.
+ */
 static void
-sgen_card_table_scan_remsets (ScanCopyContext ctx)
+scan_array_slices (ScanCopyContext ctx, int job_index, int job_split_count)
 {
-	SGEN_TV_DECLARE (atv);
-	SGEN_TV_DECLARE (btv);
+	ScanPtrFieldFunc scan_ptr_field_func = ctx.ops->scan_ptr_field;
+	int i, num_slices = MIN (num_array_slices, ARRAY_SLICES_MAX);
+
+	for (i = job_index; i < num_slices; i += job_split_count) {
+		GCObject **slot = array_slices [i].start;
+		GCObject **end = slot + array_slices [i].count;
 
+		for (; slot < end; ++slot)
+			scan_ptr_field_func (NULL, slot, ctx.queue);
+	}
+}
+
+static void
+sgen_card_table_start_scan_remsets (void)
+{
 	sgen_card_tables_collect_stats (TRUE);
 
 #ifdef SGEN_HAVE_OVERLAPPING_CARDS
@@ -437,15 +566,28 @@ sgen_card_table_scan_remsets (ScanCopyContext ctx)
 	/*Then we clear*/
 	sgen_card_table_clear_cards ();
 #endif
+}
+
+/*
+ * If the scan is split into several jobs, the total times add up those of all jobs, and
+ * the last times are those of whichever job finished last.
+ */
+static void
+sgen_card_table_scan_remsets (ScanCopyContext ctx, int job_index, int job_split_count)
+{
+	SGEN_TV_DECLARE (atv);
+	SGEN_TV_DECLARE (btv);
+
 	SGEN_TV_GETTIME (atv);
-	sgen_get_major_collector ()->scan_card_table (CARDTABLE_SCAN_GLOBAL, ctx);
+	sgen_get_major_collector ()->scan_card_table (CARDTABLE_SCAN_GLOBAL, ctx, job_index, job_split_count);
 	SGEN_TV_GETTIME (btv);
 	last_major_scan_time = SGEN_TV_ELAPSED (atv, btv); 
 	major_card_scan_time += last_major_scan_time;
-	sgen_los_scan_card_table (CARDTABLE_SCAN_GLOBAL, ctx);
+	sgen_los_scan_card_table (CARDTABLE_SCAN_GLOBAL, ctx, job_index, job_split_count);
 	SGEN_TV_GETTIME (atv);
 	last_los_scan_time = SGEN_TV_ELAPSED (btv, atv);
 	los_card_scan_time += last_los_scan_time;
+	scan_array_slices (ctx, job_index, job_split_count);
 }
 
 guint8*
@@ -599,6 +741,7 @@ sgen_card_table_init (SgenRememberedSet *remset)
 	remset->wbarrier_generic_nostore = sgen_card_table_wbarrier_generic_nostore;
 	remset->record_pointer = sgen_card_table_record_pointer;
 
+	remset->start_scan_remsets = sgen_card_table_start_scan_remsets;
 	remset->scan_remsets = sgen_card_table_scan_remsets;
 
 	remset->finish_minor_collection = sgen_card_table_finish_minor_collection;
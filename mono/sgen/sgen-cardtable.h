@@ -7,6 +7,14 @@
 #ifndef __MONO_SGEN_CARD_TABLE_INLINES_H__
 #define __MONO_SGEN_CARD_TABLE_INLINES_H__
 
+#if defined(__SSE2__) && defined(__GNUC__)
+#include <emmintrin.h>
+#define SGEN_CARD_TABLE_SSE2	1
+#elif defined(__aarch64__) && defined(__GNUC__)
+#include <arm_neon.h>
+#define SGEN_CARD_TABLE_NEON	1
+#endif
+
 /*WARNING: This function returns the number of cards regardless of overflow in case of overlapping cards.*/
 mword sgen_card_table_number_of_cards_in_range (mword address, mword size);
 
@@ -24,6 +32,7 @@ void sgen_card_table_free_mod_union (guint8 *mod_union, char *obj, mword obj_siz
 void sgen_card_table_update_mod_union_from_cards (guint8 *dest, guint8 *start_card, size_t num_cards);
 void sgen_card_table_update_mod_union (guint8 *dest, char *obj, mword obj_size, size_t *out_num_cards);
 void sgen_card_table_preclean_mod_union (guint8 *cards, guint8 *cards_preclean, size_t num_cards);
+size_t sgen_card_table_take_num_precleaned_cards (void);
 
 guint8* sgen_get_card_table_configuration (int *shift_bits, gpointer *mask);
 
@@ -125,4 +134,137 @@ sgen_card_table_get_card_offset (char *ptr, char *base)
 	return (ptr - base) >> CARD_BITS;
 }
 
+/*
+ * Card scanning kernels.  Card tables are mostly clean, so we test 64 cards at a time
+ * with SSE2 or NEON when available, and a word at a time otherwise.  Cards can be
+ * marked concurrently by the mutators, so these only ever read them.
+ */
+
+#if !defined(SGEN_CARD_TABLE_SSE2) && !defined(SGEN_CARD_TABLE_NEON)
+#define SGEN_CARD_WORD_MASK (sizeof (mword) - 1)
+
+static inline int
+sgen_card_table_find_card_offset (mword card)
+{
+/*XXX Use assembly as this generates some pretty bad code */
+#if defined(__i386__) && defined(__GNUC__)
+	return  (__builtin_ffs (card) - 1) / 8;
+#elif defined(__x86_64__) && defined(__GNUC__)
+	return (__builtin_ffsll (card) - 1) / 8;
+#elif defined(__s390x__)
+	return (__builtin_ffsll (GUINT64_TO_LE(card)) - 1) / 8;
+#else
+	int i;
+	guint8 *ptr = (guint8 *) &card;
+	for (i = 0; i < sizeof (mword); ++i) {
+		if (ptr[i])
+			return i;
+	}
+	return 0;
+#endif
+}
+#endif
+
+/*
+ * Returns the first marked card in [card_data, end), or `end` if there is none.
+ */
+static inline guint8*
+sgen_card_table_find_marked_card (guint8 *card_data, guint8 *end)
+{
+#if defined(SGEN_CARD_TABLE_SSE2)
+	__m128i zero = _mm_setzero_si128 ();
+	int mask;
+
+	while (end - card_data >= 64) {
+		__m128i v = _mm_or_si128 (
+			_mm_or_si128 (_mm_loadu_si128 ((__m128i*)card_data), _mm_loadu_si128 ((__m128i*)(card_data + 16))),
+			_mm_or_si128 (_mm_loadu_si128 ((__m128i*)(card_data + 32)), _mm_loadu_si128 ((__m128i*)(card_data + 48))));
+		if (_mm_movemask_epi8 (_mm_cmpeq_epi8 (v, zero)) != 0xffff)
+			break;
+		card_data += 64;
+	}
+	while (end - card_data >= 16) {
+		mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((__m128i*)card_data), zero));
+		if (mask != 0xffff)
+			return card_data + __builtin_ctz (~mask);
+		card_data += 16;
+	}
+#elif defined(SGEN_CARD_TABLE_NEON)
+	while (end - card_data >= 64) {
+		uint8x16_t v = vorrq_u8 (
+			vorrq_u8 (vld1q_u8 (card_data), vld1q_u8 (card_data + 16)),
+			vorrq_u8 (vld1q_u8 (card_data + 32), vld1q_u8 (card_data + 48)));
+		if (vmaxvq_u8 (v))
+			break;
+		card_data += 64;
+	}
+	while (end - card_data >= 16) {
+		if (vmaxvq_u8 (vld1q_u8 (card_data)))
+			break;
+		card_data += 16;
+	}
+#else
+	mword *cards, *cards_end;
+	mword card;
+
+	while ((((mword)card_data) & SGEN_CARD_WORD_MASK) && card_data < end) {
+		if (*card_data)
+			return card_data;
+		++card_data;
+	}
+
+	if (card_data == end)
+		return end;
+
+	cards = (mword*)card_data;
+	cards_end = (mword*)((mword)end & ~SGEN_CARD_WORD_MASK);
+	while (cards < cards_end) {
+		card = *cards;
+		if (card)
+			return (guint8*)cards + sgen_card_table_find_card_offset (card);
+		++cards;
+	}
+
+	card_data = (guint8*)cards_end;
+#endif
+	while (card_data < end) {
+		if (*card_data)
+			return card_data;
+		++card_data;
+	}
+
+	return end;
+}
+
+/*
+ * Returns the number of marked cards among the `num_cards` cards starting at `cards`.
+ */
+static inline size_t
+sgen_card_table_count_marked_cards (guint8 *cards, size_t num_cards)
+{
+	guint8 *end = cards + num_cards;
+	size_t marked = 0;
+
+#if defined(SGEN_CARD_TABLE_SSE2)
+	__m128i zero = _mm_setzero_si128 ();
+	while (end - cards >= 16) {
+		int mask = _mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((__m128i*)cards), zero));
+		marked += 16 - __builtin_popcount (mask);
+		cards += 16;
+	}
+#elif defined(SGEN_CARD_TABLE_NEON)
+	while (end - cards >= 16) {
+		uint8x16_t v = vld1q_u8 (cards);
+		marked += vaddvq_u8 (vshrq_n_u8 (vtstq_u8 (v, v), 7));
+		cards += 16;
+	}
+#endif
+	while (cards < end) {
+		if (*cards++)
+			++marked;
+	}
+
+	return marked;
+}
+
 #endif
@@ -142,6 +142,21 @@ gboolean sgen_client_vtable_is_inited (GCVTable vtable);
 const char* sgen_client_vtable_get_namespace (GCVTable vtable);
 const char* sgen_client_vtable_get_name (GCVTable vtable);
 
+/*
+ * Pretenuring state of a vtable, kept in `SGEN_GC_BIT_PRETENURE` of its GC bits.  The bit
+ * is only ever set with the world stopped.
+ */
+gboolean sgen_client_vtable_is_pretenured (GCVTable vtable);
+void sgen_client_vtable_set_pretenured (GCVTable vtable);
+
+/*
+ * A mask of up to 16 bits for the objects of `vtable`.  The major collector keeps the union
+ * of the tags of the objects in each block, so the client can walk only the blocks which
+ * might hold the objects it's looking for with `iterate_objects_with_tags`.  Called for
+ * every object allocated in the major heap, including promotions, so it must be cheap.
+ */
+guint16 sgen_client_vtable_get_region_tag (GCVTable vtable);
+
 /*
  * Called before starting collections.  The world is already stopped.  No action is
  * necessary.
@@ -197,6 +212,12 @@ void sgen_client_bridge_register_finalized_object (GCObject *object);
 void sgen_client_mark_togglerefs (char *start, char *end, ScanCopyContext ctx);
 void sgen_client_clear_togglerefs (char *start, char *end, ScanCopyContext ctx);
 
+/*
+ * Called after the togglerefs are cleared, to drop or update the client's own
+ * references to objects in [start, end) which it doesn't want to keep alive.
+ */
+void sgen_client_clear_lock_words (char *start, char *end, ScanCopyContext ctx);
+
 /*
  * Called to handle `MONO_GC_PARAMS` and `MONO_GC_DEBUG` options.  The `handle` functions
  * must return TRUE if they have recognized and processed the option, FALSE otherwise.
@@ -159,6 +159,86 @@ typedef mword SgenDescriptor;
 */
 #define SGEN_MAX_NURSERY_WASTE 512
 
+/*
+ * Adaptive TLAB sizing parameters.
+ *
+ * A thread that refills its TLAB at least SGEN_TLAB_GROW_REFILLS times between two
+ * collections gets its TLAB doubled, up to `max-tlab-size`, which itself is capped by
+ * SGEN_MAX_TLAB_SIZE.  A thread that refilled at most once and left more than half of its
+ * last TLAB unused gets it halved, down to the default TLAB size.
+ */
+#define SGEN_TLAB_GROW_REFILLS	8
+#define SGEN_MAX_TLAB_SIZE	(1024 * 1024)
+
+/*
+ * NUMA partitioned nursery parameters.
+ *
+ * With `numa-nursery` the nursery is split into one slice per node, up to
+ * SGEN_MAX_NUMA_NODES slices.  Slices smaller than SGEN_MIN_NUMA_NURSERY_SLICE_SIZE
+ * are not worth it, so in that case the nursery is not split.  Processors with a
+ * number of SGEN_MAX_NUMA_CPUS or above always allocate from the first slice.
+ */
+#define SGEN_MAX_NUMA_NODES	8
+#define SGEN_MAX_NUMA_CPUS	1024
+#define SGEN_MIN_NUMA_NURSERY_SLICE_SIZE	(512 * 1024)
+
+/*
+ * Concurrent mark precleaning parameters.
+ *
+ * When the workers run out of marking work they preclean the mod union card tables, so
+ * that the finishing pause has fewer cards left to scan.  As long as a round finds more
+ * than SGEN_PRECLEAN_DIRTY_CARDS_RATIO of the heap's cards dirty, the mutators are
+ * likely to have dirtied about as many again, so we do another round, up to
+ * SGEN_MAX_PRECLEAN_ROUNDS in total.
+ */
+#define SGEN_MAX_PRECLEAN_ROUNDS	4
+#define SGEN_PRECLEAN_DIRTY_CARDS_RATIO	0.01
+
+/*
+ * Pretenuring parameters.
+ *
+ * With `pretenure` every SGEN_PRETENURE_SAMPLE_INTERVAL-th nursery collection counts the
+ * allocated and surviving bytes per class.  A class that had at least
+ * SGEN_PRETENURE_MIN_SAMPLE_SIZE bytes in the nursery, of which at least
+ * SGEN_PRETENURE_SURVIVAL_RATIO survived, is allocated in the major heap from then on.
+ */
+#define SGEN_PRETENURE_SAMPLE_INTERVAL	8
+#define SGEN_PRETENURE_MIN_SAMPLE_SIZE	(64 * 1024)
+#define SGEN_PRETENURE_SURVIVAL_RATIO	0.9
+
+/*
+ * Hierarchical copy parameters.
+ *
+ * With `hierarchical-copy` the first SGEN_HIERARCHICAL_COPY_CHILDREN children an object
+ * scan copies are scanned right away, up to SGEN_HIERARCHICAL_COPY_DEPTH levels deep,
+ * instead of later from the gray stack.
+ */
+#define SGEN_HIERARCHICAL_COPY_CHILDREN	2
+#define SGEN_HIERARCHICAL_COPY_DEPTH	8
+
+/*
+ * GC handle magazine parameters.
+ *
+ * Each thread caches up to SGEN_GCHANDLE_MAGAZINE_SIZE free GC handle slots per handle
+ * type, so that allocating and freeing handles doesn't touch the shared table in the
+ * common case.  Slots move between a magazine and the table SGEN_GCHANDLE_MAGAZINE_BATCH
+ * at a time.
+ */
+#define SGEN_GCHANDLE_MAGAZINE_SIZE	64
+#define SGEN_GCHANDLE_MAGAZINE_BATCH	32
+
+/*
+ * Parallel nursery collections split the nulling of weak links across the workers once
+ * a weak handle table has at least SGEN_MIN_PARALLEL_WEAK_LINKS slots.
+ */
+#define SGEN_MIN_PARALLEL_WEAK_LINKS	4096
+
+/*
+ * The finalizer thread takes up to SGEN_FINALIZER_BATCH_SIZE objects off the
+ * finalization queues per acquisition of the GC lock.
+ */
+#define SGEN_FINALIZER_BATCH_SIZE	64
+
 
 /*
  * Minimum allowance for nursery allocations, as a multiple of the size of nursery.
@@ -179,6 +259,29 @@ typedef mword SgenDescriptor;
  */
 #define SGEN_DEFAULT_ALLOWANCE_HEAP_SIZE_RATIO 0.33
 
+/*
+ * Goal driven heap sizing.
+ *
+ * With a `pause-target` or a `gc-cpu-target` the major collection allowance computed
+ * from the ratios above is scaled after every major collection.  If the longest major
+ * pause exceeded the pause target the scale is multiplied by SGEN_ALLOWANCE_SCALE_SHRINK,
+ * otherwise, if the fraction of time spent in GC pauses exceeded the CPU target, it is
+ * multiplied by SGEN_ALLOWANCE_SCALE_GROW.  If both targets were met, the scale moves
+ * back toward 1.0 by a factor of SGEN_ALLOWANCE_SCALE_DECAY, so a transient spike doesn't
+ * skew the heap size for the rest of the run.  The scale stays within
+ * SGEN_MIN_ALLOWANCE_SCALE - SGEN_MAX_ALLOWANCE_SCALE.
+ */
+#define SGEN_MIN_PAUSE_TARGET_MS	0.1
+#define SGEN_MAX_PAUSE_TARGET_MS	10000.0
+#define SGEN_MIN_GC_CPU_TARGET	0.01
+#define SGEN_MAX_GC_CPU_TARGET	0.9
+
+#define SGEN_ALLOWANCE_SCALE_SHRINK	0.8
+#define SGEN_ALLOWANCE_SCALE_GROW	1.25
+#define SGEN_ALLOWANCE_SCALE_DECAY	0.95
+#define SGEN_MIN_ALLOWANCE_SCALE	0.25
+#define SGEN_MAX_ALLOWANCE_SCALE	4.0
+
 /*
  * Default ratio of memory we want to release in a major collection in relation to the the current heap size.
  *
@@ -27,6 +27,14 @@
  *
  * Called when no space for `obj` could be allocated.  It must pin `obj` and enqueue it into
  * `queue` for scanning.
+ *
+ * If the includer also defines
+ *
+ *     COLLECTOR_PARALLEL_ALLOC_FOR_PROMOTION(vt, obj, objsize, has_refs)
+ *     collector_pin_object_par(obj, queue)
+ *
+ * which must be thread safe, `copy_object_no_checks_par ()` is defined as well, which
+ * can be used by several threads at once.
  */
 
 extern guint64 stat_copy_object_called_nursery;
@@ -95,5 +103,62 @@ copy_object_no_checks (GCObject *obj, SgenGrayQueue *queue)
 	return (GCObject *)destination;
 }
 
+#ifdef COLLECTOR_PARALLEL_ALLOC_FOR_PROMOTION
+/*
+ * Like copy_object_no_checks(), but other threads might be copying `obj` at the same
+ * time.  Whoever installs the forwarding pointer first wins.  The losers turn their
+ * copies into filler, so that scanning the major heap block doesn't find stale nursery
+ * references, and use the winner's copy.
+ *
+ * This can return OBJ itself on OOM, or if it was pinned by another thread.
+ */
+static MONO_NEVER_INLINE GCObject *
+copy_object_no_checks_par (GCObject *obj, SgenGrayQueue *queue)
+{
+	mword vtable_word = *(mword*)obj;
+	GCVTable vt;
+	gboolean has_references;
+	mword objsize;
+	void *destination;
+	mword final_word;
+
+	if (SGEN_POINTER_IS_TAGGED_FORWARDED (vtable_word))
+		return (GCObject *)SGEN_POINTER_UNTAG_VTABLE (vtable_word);
+	if (SGEN_POINTER_IS_TAGGED_PINNED (vtable_word))
+		return obj;
+
+	vt = (GCVTable)SGEN_POINTER_UNTAG_VTABLE (vtable_word);
+	has_references = SGEN_VTABLE_HAS_REFERENCES (vt);
+	objsize = SGEN_ALIGN_UP (sgen_client_par_object_get_size (vt, obj));
+	destination = COLLECTOR_PARALLEL_ALLOC_FOR_PROMOTION (vt, obj, objsize, has_references);
+
+	if (G_UNLIKELY (!destination))
+		return collector_pin_object_par (obj, queue);
+
+	/* We only enqueue the copy once we know it's the one that survives. */
+	par_copy_object_no_checks ((char *)destination, vt, obj, objsize, NULL);
+
+	/* The CAS is a full barrier, so the copy is visible before the forwarding pointer. */
+	final_word = (mword)InterlockedCompareExchangePointer ((volatile gpointer *)obj, SGEN_POINTER_TAG_FORWARDED (destination), (gpointer)vtable_word);
+	if (final_word == vtable_word) {
+		if (has_references) {
+			SGEN_LOG (9, "Enqueuing gray object %p (%s)", destination, sgen_client_vtable_get_name (vt));
+			GRAY_OBJECT_ENQUEUE (queue, (GCObject *)destination, sgen_vtable_get_descriptor (vt));
+		}
+		return (GCObject *)destination;
+	}
+
+	HEAVY_STAT (++stat_slots_allocated_in_vain);
+	sgen_client_array_fill_range ((char *)destination, objsize);
+
+	if (SGEN_POINTER_IS_TAGGED_FORWARDED (final_word))
+		return (GCObject *)SGEN_POINTER_UNTAG_VTABLE (final_word);
+	SGEN_ASSERT (0, SGEN_POINTER_IS_TAGGED_PINNED (final_word), "Who else could have changed the vtable word?");
+	return obj;
+}
+#endif
+
 #undef COLLECTOR_SERIAL_ALLOC_FOR_PROMOTION
+#undef COLLECTOR_PARALLEL_ALLOC_FOR_PROMOTION
 #undef collector_pin_object
+#undef collector_pin_object_par
@@ -186,18 +186,34 @@ sgen_gc_descr_has_references (SgenDescriptor desc)
  * choosen run-length, instead: add an assert to check.
  */
 #ifdef __GNUC__
+/*
+ * Auto layout puts the references of a class before its other fields, so the
+ * bitmap of most small objects is a single run of references right after the
+ * header. A lone reference and such runs are scanned without testing the bits
+ * one by one, the other bitmaps skip over the clear bits with ctz.
+ */
 #define OBJ_BITMAP_FOREACH_PTR(desc,obj)	do {		\
 		/* there are pointers */			\
 		void **_objptr = (void**)(obj);			\
 		gsize _bmap = (desc) >> LOW_TYPE_BITS;		\
 		_objptr += OBJECT_HEADER_WORDS;			\
-		do {						\
-			int _index = GNUC_BUILTIN_CTZ (_bmap);	\
-			_objptr += _index;			\
-			_bmap >>= (_index + 1);			\
+		if (_bmap == 1) {				\
 			HANDLE_PTR ((GCObject**)_objptr, (obj));	\
-			++_objptr;				\
-		} while (_bmap);				\
+		} else if (!(_bmap & (_bmap + 1))) {		\
+			void **_objptr_end = _objptr + GNUC_BUILTIN_CTZ (~_bmap);	\
+			do {					\
+				HANDLE_PTR ((GCObject**)_objptr, (obj));	\
+				++_objptr;			\
+			} while (_objptr < _objptr_end);	\
+		} else {					\
+			do {					\
+				int _index = GNUC_BUILTIN_CTZ (_bmap);	\
+				_objptr += _index;		\
+				_bmap >>= (_index + 1);		\
+				HANDLE_PTR ((GCObject**)_objptr, (obj));	\
+				++_objptr;			\
+			} while (_bmap);			\
+		}						\
 	} while (0)
 #else
 #define OBJ_BITMAP_FOREACH_PTR(desc,obj)	do {	\
@@ -215,6 +231,36 @@ sgen_gc_descr_has_references (SgenDescriptor desc)
 	} while (0)
 #endif
 
+#ifdef __GNUC__
+/*
+ * Each bitmap word covers GC_BITS_PER_WORD words of the object, several cache
+ * lines, so the first reference of the next word is prefetched while the
+ * references of the current one are handled.
+ */
+#define OBJ_COMPLEX_FOREACH_PTR(desc,obj)	do {	\
+		/* there are pointers */	\
+		void **_objptr;	\
+		gsize *bitmap_data = sgen_get_complex_descriptor ((desc)); \
+		gsize bwords = (*bitmap_data) - 1;	\
+		void **start_run = (void**)(obj);	\
+		bitmap_data++;	\
+		while (bwords-- > 0) {	\
+			gsize _bmap = *bitmap_data++;	\
+			if (bwords && *bitmap_data)	\
+				PREFETCH_READ (start_run + GC_BITS_PER_WORD + GNUC_BUILTIN_CTZ (*bitmap_data));	\
+			_objptr = start_run;	\
+			while (_bmap) {	\
+				int _index = GNUC_BUILTIN_CTZ (_bmap);	\
+				_objptr += _index;	\
+				_bmap >>= _index;	\
+				_bmap >>= 1;	\
+				HANDLE_PTR ((GCObject**)_objptr, (obj));	\
+				++_objptr;	\
+			}	\
+			start_run += GC_BITS_PER_WORD;	\
+		}	\
+	} while (0)
+#else
 #define OBJ_COMPLEX_FOREACH_PTR(desc,obj)	do {	\
 		/* there are pointers */	\
 		void **_objptr = (void**)(obj);	\
@@ -236,6 +282,7 @@ sgen_gc_descr_has_references (SgenDescriptor desc)
 			start_run += GC_BITS_PER_WORD;	\
 		}	\
 	} while (0)
+#endif
 
 /* this one is untested */
 #define OBJ_COMPLEX_ARR_FOREACH_PTR(desc,obj)	do {	\
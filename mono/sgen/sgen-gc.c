@@ -235,6 +235,7 @@ static gboolean do_dump_nursery_content = FALSE;
 static gboolean enable_nursery_canaries = FALSE;
 
 static gboolean precleaning_enabled = TRUE;
+static gboolean los_compaction_enabled = FALSE;
 
 #ifdef HEAVY_STATISTICS
 guint64 stat_objects_alloced_degraded = 0;
@@ -263,6 +264,7 @@ static guint64 stat_wbarrier_set_root = 0;
 #endif
 
 static guint64 stat_pinned_objects = 0;
+static guint64 stat_major_preclean_rounds = 0;
 
 static guint64 time_minor_pre_collection_fragment_clear = 0;
 static guint64 time_minor_pinning = 0;
@@ -375,9 +377,18 @@ static mword roots_size = 0; /* amount of memory in the root set */
 /* The bigger the value, the less often we have to go to the slow path to allocate a new 
  * one, but the more space is wasted by threads not allocating much memory.
  * FIXME: Tune this.
- * FIXME: Make this self-tuning for each thread.
  */
 guint32 tlab_size = (1024 * 4);
+/*
+ * With adaptive TLABs every thread starts out with `tlab_size` and is allowed to
+ * grow up to `max_tlab_size`, depending on how often it refills between collections.
+ */
+guint32 max_tlab_size = (1024 * 64);
+gboolean adaptive_tlab_enabled = FALSE;
+/* See sgen_pretenure_sample_nursery () */
+gboolean pretenuring_enabled = FALSE;
+/* How deep hierarchical scans nest, 0 if disabled.  See sgen-gray.h. */
+int sgen_hierarchical_copy_depth = 0;
 
 #define MAX_SMALL_OBJ_SIZE	SGEN_MAX_SMALL_OBJ_SIZE
 
@@ -392,6 +403,13 @@ MonoNativeThreadId main_gc_thread = NULL;
 /*Object was pinned during the current collection*/
 static mword objects_pinned;
 
+/*
+ * Taken by the workers of a parallel nursery collection for the bookkeeping that isn't
+ * thread safe: staging late pinned objects and adding global remsets, which might cement
+ * objects.
+ */
+static mono_mutex_t parallel_minor_lock;
+
 /*
  * ######################################################################
  * ########  Macros and function declarations.
@@ -403,6 +421,7 @@ static void scan_from_registered_roots (char *addr_start, char *addr_end, int ro
 
 static void pin_from_roots (void *start_nursery, void *end_nursery, ScanCopyContext ctx);
 static void finish_gray_stack (int generation, ScanCopyContext ctx);
+static void null_links (int generation, ScanCopyContext ctx, gboolean track);
 
 
 SgenMajorCollector major_collector;
@@ -500,6 +519,20 @@ sgen_add_to_global_remset (gpointer ptr, GCObject *obj)
 	binary_protocol_global_remset (ptr, obj, (gpointer)SGEN_LOAD_VTABLE (obj));
 }
 
+/*
+ * sgen_add_to_global_remset_par:
+ *
+ *   Like sgen_add_to_global_remset(), for the workers of parallel nursery
+ * collections.
+ */
+void
+sgen_add_to_global_remset_par (gpointer ptr, GCObject *obj)
+{
+	mono_os_mutex_lock (&parallel_minor_lock);
+	sgen_add_to_global_remset (ptr, obj);
+	mono_os_mutex_unlock (&parallel_minor_lock);
+}
+
 /*
  * sgen_drain_gray_stack:
  *
@@ -728,6 +761,101 @@ sgen_pin_object (GCObject *object, SgenGrayQueue *queue)
 	GRAY_OBJECT_ENQUEUE (queue, object, sgen_obj_get_descriptor_safe (object));
 }
 
+/*
+ * Like sgen_pin_object(), plus sgen_set_pinned_from_failed_allocation(), for the workers
+ * of parallel nursery collections.  Another worker might forward or pin the object at the
+ * same time, so we set the pin bit with a CAS.  Returns where the object ends up, which is
+ * the forwarded copy if another worker won.
+ */
+GCObject*
+sgen_pin_object_par (GCObject *object, SgenGrayQueue *queue)
+{
+	mword vtable_word;
+
+	SGEN_ASSERT (0, sgen_ptr_in_nursery (object), "We're only supposed to use this for pinning nursery objects when out of memory.");
+
+	do {
+		vtable_word = *(mword*)object;
+		if (SGEN_POINTER_IS_TAGGED_FORWARDED (vtable_word))
+			return (GCObject *)SGEN_POINTER_UNTAG_VTABLE (vtable_word);
+		if (SGEN_POINTER_IS_TAGGED_PINNED (vtable_word))
+			return object;
+	} while (InterlockedCompareExchangePointer ((volatile gpointer *)object, SGEN_POINTER_TAG_PINNED (vtable_word), (gpointer)vtable_word) != (gpointer)vtable_word);
+
+	binary_protocol_pin (object, (gpointer)LOAD_VTABLE (object), safe_object_get_size (object));
+
+	mono_os_mutex_lock (&parallel_minor_lock);
+	sgen_pin_stage_ptr (object);
+	++objects_pinned;
+	bytes_pinned_from_failed_allocation += safe_object_get_size (object);
+	sgen_pin_stats_register_object (object, GENERATION_NURSERY);
+	mono_os_mutex_unlock (&parallel_minor_lock);
+
+	GRAY_OBJECT_ENQUEUE (queue, object, sgen_obj_get_descriptor_safe (object));
+	return object;
+}
+
+/*
+ * Large pin queues are sorted with an LSD radix sort instead.  Only the bits in which the
+ * addresses differ need sorting, and for a queue of nursery addresses those are few, so
+ * it takes just a couple of linear passes.  We fall back to the heap sort if it would
+ * take more than RADIX_SORT_MAX_PASSES.
+ */
+#define RADIX_SORT_MIN_SIZE	512
+#define RADIX_SORT_BITS	8
+#define RADIX_SORT_BUCKETS	(1 << RADIX_SORT_BITS)
+#define RADIX_SORT_MAX_PASSES	4
+
+static gboolean
+radix_sort_addresses (void **array, size_t size)
+{
+	size_t counts [RADIX_SORT_BUCKETS];
+	void **src, **dst, **tmp;
+	mword diff_bits = 0;
+	int low, high, shift;
+	size_t i;
+
+	for (i = 1; i < size; ++i)
+		diff_bits |= (mword)array [i] ^ (mword)array [0];
+	if (!diff_bits)
+		return TRUE;
+
+	for (low = 0; !(diff_bits & ((mword)1 << low)); ++low)
+		;
+	for (high = sizeof (mword) * 8 - 1; !(diff_bits & ((mword)1 << high)); --high)
+		;
+	if (high - low + 1 > RADIX_SORT_BITS * RADIX_SORT_MAX_PASSES)
+		return FALSE;
+
+	src = array;
+	dst = tmp = (void **)sgen_alloc_internal_dynamic (sizeof (void*) * size, INTERNAL_MEM_PIN_QUEUE, TRUE);
+
+	for (shift = low; shift <= high; shift += RADIX_SORT_BITS) {
+		size_t sum = 0;
+		void **swap;
+
+		memset (counts, 0, sizeof (counts));
+		for (i = 0; i < size; ++i)
+			++counts [((mword)src [i] >> shift) & (RADIX_SORT_BUCKETS - 1)];
+		for (i = 0; i < RADIX_SORT_BUCKETS; ++i) {
+			size_t count = counts [i];
+			counts [i] = sum;
+			sum += count;
+		}
+		for (i = 0; i < size; ++i)
+			dst [counts [((mword)src [i] >> shift) & (RADIX_SORT_BUCKETS - 1)]++] = src [i];
+
+		swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if (src != array)
+		memcpy (array, src, sizeof (void*) * size);
+	sgen_free_internal_dynamic (tmp, sizeof (void*) * size, INTERNAL_MEM_PIN_QUEUE);
+	return TRUE;
+}
+
 /* Sort the addresses in array in increasing order.
  * Done using a by-the book heap sort. Which has decent and stable performance, is pretty cache efficient.
  */
@@ -737,6 +865,9 @@ sgen_sort_addresses (void **array, size_t size)
 	size_t i;
 	void *tmp;
 
+	if (size >= RADIX_SORT_MIN_SIZE && radix_sort_addresses (array, size))
+		return;
+
 	for (i = 1; i < size; ++i) {
 		size_t child = i;
 		while (child > 0) {
@@ -788,6 +919,7 @@ void
 sgen_conservatively_pin_objects_from (void **start, void **end, void *start_nursery, void *end_nursery, int pin_type)
 {
 	int count = 0;
+	mword nursery_range = (mword)end_nursery - (mword)start_nursery;
 
 	SGEN_ASSERT (0, ((mword)start & (SIZEOF_VOID_P - 1)) == 0, "Why are we scanning for references in unaligned memory ?");
 
@@ -815,7 +947,8 @@ sgen_conservatively_pin_objects_from (void **start, void **end, void *start_nurs
 		 */
 		mword addr = (mword)*start;
 		addr &= ~(ALLOC_ALIGN - 1);
-		if (addr >= (mword)start_nursery && addr < (mword)end_nursery) {
+		/* A single unsigned compare checks both bounds. */
+		if (G_UNLIKELY (addr - (mword)start_nursery < nursery_range)) {
 			SGEN_LOG (6, "Pinning address %p from %p", (void*)addr, start);
 			sgen_pin_stage_ptr ((void*)addr);
 			binary_protocol_pin_stage (start, (void*)addr);
@@ -1066,10 +1199,14 @@ finish_gray_stack (int generation, ScanCopyContext ctx)
 	 *   To achieve better cache locality and cache usage, we drain the gray stack 
 	 * frequently, after each object is copied, and just finish the work here.
 	 */
+	sgen_client_gc_phase_start (generation, SGEN_GC_PHASE_DRAIN_GRAY);
 	sgen_drain_gray_stack (ctx);
+	sgen_client_gc_phase_end (generation, SGEN_GC_PHASE_DRAIN_GRAY);
 	TV_GETTIME (atv);
 	SGEN_LOG (2, "%s generation done", generation_name (generation));
 
+	sgen_client_gc_phase_start (generation, SGEN_GC_PHASE_FINALIZATION);
+
 	/*
 	Reset bridge data, we might have lingering data from a previous collection if this is a major
 	collection trigged by minor overflow.
@@ -1099,6 +1236,9 @@ finish_gray_stack (int generation, ScanCopyContext ctx)
 	} while (!done_with_ephemerons);
 
 	if (sgen_client_bridge_need_processing ()) {
+		sgen_client_gc_phase_end (generation, SGEN_GC_PHASE_FINALIZATION);
+		sgen_client_gc_phase_start (generation, SGEN_GC_PHASE_BRIDGE);
+
 		/*Make sure the gray stack is empty before we process bridge objects so we get liveness right*/
 		sgen_drain_gray_stack (ctx);
 		sgen_collect_bridge_objects (generation, ctx);
@@ -1118,6 +1258,9 @@ finish_gray_stack (int generation, ScanCopyContext ctx)
 		be a big deal.
 		*/
 		sgen_client_bridge_processing_stw_step ();
+
+		sgen_client_gc_phase_end (generation, SGEN_GC_PHASE_BRIDGE);
+		sgen_client_gc_phase_start (generation, SGEN_GC_PHASE_FINALIZATION);
 	}
 
 	/*
@@ -1130,9 +1273,9 @@ finish_gray_stack (int generation, ScanCopyContext ctx)
 	We must clear weak links that don't track resurrection before processing object ready for
 	finalization so they can be cleared before that.
 	*/
-	sgen_null_link_in_range (generation, ctx, FALSE);
+	null_links (generation, ctx, FALSE);
 	if (generation == GENERATION_OLD)
-		sgen_null_link_in_range (GENERATION_NURSERY, ctx, FALSE);
+		null_links (GENERATION_NURSERY, ctx, FALSE);
 
 
 	/* walk the finalization queue and move also the objects that need to be
@@ -1165,6 +1308,7 @@ finish_gray_stack (int generation, ScanCopyContext ctx)
 	 * user finalizers to correctly interact with TR objects.
 	*/
 	sgen_client_clear_togglerefs (start_addr, end_addr, ctx);
+	sgen_client_clear_lock_words (start_addr, end_addr, ctx);
 
 	TV_GETTIME (btv);
 	SGEN_LOG (2, "Finalize queue handling scan for %s generation: %lld usecs %d ephemeron rounds", generation_name (generation), (long long)TV_ELAPSED (atv, btv), ephemeron_rounds);
@@ -1179,9 +1323,9 @@ finish_gray_stack (int generation, ScanCopyContext ctx)
 	 */
 	g_assert (sgen_gray_object_queue_is_empty (queue));
 	for (;;) {
-		sgen_null_link_in_range (generation, ctx, TRUE);
+		null_links (generation, ctx, TRUE);
 		if (generation == GENERATION_OLD)
-			sgen_null_link_in_range (GENERATION_NURSERY, ctx, TRUE);
+			null_links (GENERATION_NURSERY, ctx, TRUE);
 		if (sgen_gray_object_queue_is_empty (queue))
 			break;
 		sgen_drain_gray_stack (ctx);
@@ -1190,6 +1334,7 @@ finish_gray_stack (int generation, ScanCopyContext ctx)
 	g_assert (sgen_gray_object_queue_is_empty (queue));
 
 	sgen_gray_object_queue_trim_free_list (queue);
+	sgen_client_gc_phase_end (generation, SGEN_GC_PHASE_FINALIZATION);
 	binary_protocol_finish_gray_stack_end (sgen_timestamp (), generation);
 }
 
@@ -1254,6 +1399,13 @@ init_stats (void)
 	mono_counters_register ("Major fragment creation", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_TIME, &time_major_fragment_creation);
 
 	mono_counters_register ("Number of pinned objects", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_pinned_objects);
+	mono_counters_register ("# major preclean rounds", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_preclean_rounds);
+
+	mono_counters_register ("LOS section free bytes", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_BYTES | MONO_COUNTER_VARIABLE, &stat_los_section_free_bytes);
+	mono_counters_register ("LOS section fragmented bytes", MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_BYTES | MONO_COUNTER_VARIABLE, &stat_los_section_fragmented_bytes);
+	mono_counters_register ("# LOS sections alloced", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_los_sections_alloced);
+	mono_counters_register ("# LOS sections freed", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_los_sections_freed);
+	mono_counters_register ("# LOS objects evacuated", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_los_objects_evacuated);
 
 #ifdef HEAVY_STATISTICS
 	mono_counters_register ("WBarrier remember pointer", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_wbarrier_add_to_global_remset);
@@ -1333,10 +1485,19 @@ scan_copy_context_for_scan_job (void *worker_data_untyped, ScanJob *job)
 	return CONTEXT_FROM_OBJECT_OPERATIONS (job->ops, sgen_workers_get_job_gray_queue (worker_data, job->gc_thread_gray_queue));
 }
 
+typedef struct {
+	ScanJob scan_job;
+	int job_index;
+	int job_split_count;
+} ParallelScanJob;
+
 static void
 job_remembered_set_scan (void *worker_data_untyped, SgenThreadPoolJob *job)
 {
-	remset.scan_remsets (scan_copy_context_for_scan_job (worker_data_untyped, (ScanJob*)job));
+	ParallelScanJob *job_data = (ParallelScanJob*)job;
+	ScanCopyContext ctx = scan_copy_context_for_scan_job (worker_data_untyped, &job_data->scan_job);
+
+	remset.scan_remsets (ctx, job_data->job_index, job_data->job_split_count);
 }
 
 typedef struct {
@@ -1391,7 +1552,7 @@ job_scan_major_mod_union_card_table (void *worker_data_untyped, SgenThreadPoolJo
 	ScanCopyContext ctx = scan_copy_context_for_scan_job (worker_data_untyped, job_data);
 
 	g_assert (concurrent_collection_in_progress);
-	major_collector.scan_card_table (CARDTABLE_SCAN_MOD_UNION, ctx);
+	major_collector.scan_card_table (CARDTABLE_SCAN_MOD_UNION, ctx, 0, 1);
 }
 
 static void
@@ -1401,21 +1562,132 @@ job_scan_los_mod_union_card_table (void *worker_data_untyped, SgenThreadPoolJob
 	ScanCopyContext ctx = scan_copy_context_for_scan_job (worker_data_untyped, job_data);
 
 	g_assert (concurrent_collection_in_progress);
-	sgen_los_scan_card_table (CARDTABLE_SCAN_MOD_UNION, ctx);
+	sgen_los_scan_card_table (CARDTABLE_SCAN_MOD_UNION, ctx, 0, 1);
+}
+
+static void
+job_major_mod_union_preclean (void *worker_data_untyped, SgenThreadPoolJob *job)
+{
+	ParallelScanJob *job_data = (ParallelScanJob*)job;
+	ScanCopyContext ctx = scan_copy_context_for_scan_job (worker_data_untyped, &job_data->scan_job);
+
+	g_assert (concurrent_collection_in_progress);
+	major_collector.scan_card_table (CARDTABLE_SCAN_MOD_UNION_PRECLEAN, ctx, job_data->job_index, job_data->job_split_count);
+}
+
+static void
+job_los_mod_union_preclean (void *worker_data_untyped, SgenThreadPoolJob *job)
+{
+	ParallelScanJob *job_data = (ParallelScanJob*)job;
+	ScanCopyContext ctx = scan_copy_context_for_scan_job (worker_data_untyped, &job_data->scan_job);
+
+	g_assert (concurrent_collection_in_progress);
+	sgen_los_scan_card_table (CARDTABLE_SCAN_MOD_UNION_PRECLEAN, ctx, job_data->job_index, job_data->job_split_count);
 }
 
 static void
-job_mod_union_preclean (void *worker_data_untyped, SgenThreadPoolJob *job)
+job_scan_last_pinned (void *worker_data_untyped, SgenThreadPoolJob *job)
 {
 	ScanJob *job_data = (ScanJob*)job;
 	ScanCopyContext ctx = scan_copy_context_for_scan_job (worker_data_untyped, job_data);
 
 	g_assert (concurrent_collection_in_progress);
+	sgen_scan_pin_queue_objects (ctx);
+}
 
-	major_collector.scan_card_table (CARDTABLE_SCAN_MOD_UNION_PRECLEAN, ctx);
-	sgen_los_scan_card_table (CARDTABLE_SCAN_MOD_UNION_PRECLEAN, ctx);
+/* The object operations the preclean jobs mark with. */
+static SgenObjectOperations *preclean_object_ops;
+static int preclean_rounds;
 
-	sgen_scan_pin_queue_objects (ctx);
+typedef struct {
+	ParallelScanJob scan_job;
+	gboolean track;
+} NullLinksJob;
+
+static void
+job_null_links (void *worker_data_untyped, SgenThreadPoolJob *job)
+{
+	NullLinksJob *job_data = (NullLinksJob*)job;
+	ScanCopyContext ctx = scan_copy_context_for_scan_job (worker_data_untyped, &job_data->scan_job.scan_job);
+
+	sgen_null_link_in_range_split (GENERATION_NURSERY, ctx, job_data->track, job_data->scan_job.job_index, job_data->scan_job.job_split_count);
+}
+
+/*
+ * In parallel nursery collections large weak handle tables are split into ranges that
+ * are processed on the workers.
+ */
+static void
+null_links (int generation, ScanCopyContext ctx, gboolean track)
+{
+	int i, split_count;
+
+	if (generation != GENERATION_NURSERY || !sgen_minor_collector.is_parallel || sgen_concurrent_collection_in_progress () ||
+			sgen_gchandle_get_num_slots (track ? HANDLE_WEAK_TRACK : HANDLE_WEAK) < SGEN_MIN_PARALLEL_WEAK_LINKS) {
+		sgen_null_link_in_range (generation, ctx, track);
+		return;
+	}
+
+	split_count = sgen_workers_get_job_split_count ();
+	for (i = 0; i < split_count; ++i) {
+		NullLinksJob *nlj = (NullLinksJob*)sgen_thread_pool_job_alloc ("null links", job_null_links, sizeof (NullLinksJob));
+		nlj->scan_job.scan_job.ops = &sgen_minor_collector.parallel_ops;
+		nlj->scan_job.scan_job.gc_thread_gray_queue = ctx.queue;
+		nlj->scan_job.job_index = i;
+		nlj->scan_job.job_split_count = split_count;
+		nlj->track = track;
+		sgen_workers_add_parallel_job (&nlj->scan_job.scan_job.job);
+	}
+	sgen_workers_run_parallel_jobs (&sgen_minor_collector.parallel_ops, ctx.queue);
+}
+
+/*
+ * Hands out a round of preclean jobs to the workers when they run out of marking work.
+ * The jobs are split by block ranges, so that all the workers can take part if the major
+ * collector is parallel.  Another round follows as long as the last one found enough dirty
+ * cards to make it worthwhile.
+ */
+static gboolean
+workers_finish_callback (void)
+{
+	int i, split_count = major_collector.is_parallel ? sgen_workers_get_job_split_count () : 1;
+	size_t num_dirty_cards = sgen_card_table_take_num_precleaned_cards ();
+
+	if (preclean_rounds > 0) {
+		size_t num_cards = (major_collector.get_num_major_sections () * major_collector.section_size + los_memory_usage) / CARD_SIZE_IN_BYTES;
+
+		if (preclean_rounds >= SGEN_MAX_PRECLEAN_ROUNDS || num_dirty_cards <= num_cards * SGEN_PRECLEAN_DIRTY_CARDS_RATIO)
+			return FALSE;
+	}
+
+	for (i = 0; i < split_count; ++i) {
+		ParallelScanJob *psj = (ParallelScanJob*)sgen_thread_pool_job_alloc ("preclean major mod union cardtable", job_major_mod_union_preclean, sizeof (ParallelScanJob));
+		psj->scan_job.ops = preclean_object_ops;
+		psj->scan_job.gc_thread_gray_queue = NULL;
+		psj->job_index = i;
+		psj->job_split_count = split_count;
+		sgen_workers_add_concurrent_job (&psj->scan_job.job);
+	}
+
+	for (i = 0; i < split_count; ++i) {
+		ParallelScanJob *psj = (ParallelScanJob*)sgen_thread_pool_job_alloc ("preclean los mod union cardtable", job_los_mod_union_preclean, sizeof (ParallelScanJob));
+		psj->scan_job.ops = preclean_object_ops;
+		psj->scan_job.gc_thread_gray_queue = NULL;
+		psj->job_index = i;
+		psj->job_split_count = split_count;
+		sgen_workers_add_concurrent_job (&psj->scan_job.job);
+	}
+
+	if (!preclean_rounds) {
+		ScanJob *sj = (ScanJob*)sgen_thread_pool_job_alloc ("scan last pinned", job_scan_last_pinned, sizeof (ScanJob));
+		sj->ops = preclean_object_ops;
+		sj->gc_thread_gray_queue = NULL;
+		sgen_workers_add_concurrent_job (&sj->job);
+	}
+
+	++preclean_rounds;
+	++stat_major_preclean_rounds;
+	return TRUE;
 }
 
 static void
@@ -1423,11 +1695,37 @@ init_gray_queue (SgenGrayQueue *gc_thread_gray_queue, gboolean use_workers)
 {
 	if (use_workers)
 		sgen_workers_init_distribute_gray_queue ();
-	sgen_gray_object_queue_init (gc_thread_gray_queue, NULL, TRUE);
+	sgen_gray_object_queue_init (gc_thread_gray_queue, NULL, TRUE, FALSE);
 }
 
 static void
-enqueue_scan_from_roots_jobs (SgenGrayQueue *gc_thread_gray_queue, char *heap_start, char *heap_end, SgenObjectOperations *ops, gboolean enqueue)
+enqueue_scan_job (SgenThreadPoolJob *job, gboolean enqueue, gboolean is_parallel)
+{
+	if (is_parallel)
+		sgen_workers_add_parallel_job (job);
+	else
+		sgen_workers_enqueue_job (job, enqueue);
+}
+
+static void
+enqueue_scan_remembered_set_jobs (SgenGrayQueue *gc_thread_gray_queue, SgenObjectOperations *ops, gboolean is_parallel)
+{
+	int i, split_count = is_parallel ? sgen_workers_get_job_split_count () : 1;
+
+	remset.start_scan_remsets ();
+
+	for (i = 0; i < split_count; ++i) {
+		ParallelScanJob *psj = (ParallelScanJob*)sgen_thread_pool_job_alloc ("scan remset", job_remembered_set_scan, sizeof (ParallelScanJob));
+		psj->scan_job.ops = ops;
+		psj->scan_job.gc_thread_gray_queue = gc_thread_gray_queue;
+		psj->job_index = i;
+		psj->job_split_count = split_count;
+		enqueue_scan_job (&psj->scan_job.job, FALSE, is_parallel);
+	}
+}
+
+static void
+enqueue_scan_from_roots_jobs (SgenGrayQueue *gc_thread_gray_queue, char *heap_start, char *heap_end, SgenObjectOperations *ops, gboolean enqueue, gboolean is_parallel)
 {
 	ScanFromRegisteredRootsJob *scrrj;
 	ScanThreadDataJob *stdj;
@@ -1441,7 +1739,7 @@ enqueue_scan_from_roots_jobs (SgenGrayQueue *gc_thread_gray_queue, char *heap_st
 	scrrj->heap_start = heap_start;
 	scrrj->heap_end = heap_end;
 	scrrj->root_type = ROOT_TYPE_NORMAL;
-	sgen_workers_enqueue_job (&scrrj->scan_job.job, enqueue);
+	enqueue_scan_job (&scrrj->scan_job.job, enqueue, is_parallel);
 
 	scrrj = (ScanFromRegisteredRootsJob*)sgen_thread_pool_job_alloc ("scan from registered roots wbarrier", job_scan_from_registered_roots, sizeof (ScanFromRegisteredRootsJob));
 	scrrj->scan_job.ops = ops;
@@ -1449,7 +1747,7 @@ enqueue_scan_from_roots_jobs (SgenGrayQueue *gc_thread_gray_queue, char *heap_st
 	scrrj->heap_start = heap_start;
 	scrrj->heap_end = heap_end;
 	scrrj->root_type = ROOT_TYPE_WBARRIER;
-	sgen_workers_enqueue_job (&scrrj->scan_job.job, enqueue);
+	enqueue_scan_job (&scrrj->scan_job.job, enqueue, is_parallel);
 
 	/* Threads */
 
@@ -1458,7 +1756,7 @@ enqueue_scan_from_roots_jobs (SgenGrayQueue *gc_thread_gray_queue, char *heap_st
 	stdj->scan_job.gc_thread_gray_queue = gc_thread_gray_queue;
 	stdj->heap_start = heap_start;
 	stdj->heap_end = heap_end;
-	sgen_workers_enqueue_job (&stdj->scan_job.job, enqueue);
+	enqueue_scan_job (&stdj->scan_job.job, enqueue, is_parallel);
 
 	/* Scan the list of objects ready for finalization. */
 
@@ -1466,13 +1764,13 @@ enqueue_scan_from_roots_jobs (SgenGrayQueue *gc_thread_gray_queue, char *heap_st
 	sfej->scan_job.ops = ops;
 	sfej->scan_job.gc_thread_gray_queue = gc_thread_gray_queue;
 	sfej->queue = &fin_ready_queue;
-	sgen_workers_enqueue_job (&sfej->scan_job.job, enqueue);
+	enqueue_scan_job (&sfej->scan_job.job, enqueue, is_parallel);
 
 	sfej = (ScanFinalizerEntriesJob*)sgen_thread_pool_job_alloc ("scan critical finalizer entries", job_scan_finalizer_entries, sizeof (ScanFinalizerEntriesJob));
 	sfej->scan_job.ops = ops;
 	sfej->scan_job.gc_thread_gray_queue = gc_thread_gray_queue;
 	sfej->queue = &critical_fin_queue;
-	sgen_workers_enqueue_job (&sfej->scan_job.job, enqueue);
+	enqueue_scan_job (&sfej->scan_job.job, enqueue, is_parallel);
 }
 
 /*
@@ -1487,9 +1785,9 @@ collect_nursery (const char *reason, gboolean is_overflow, SgenGrayQueue *unpin_
 	size_t max_garbage_amount;
 	char *nursery_next;
 	mword fragment_total;
-	ScanJob *sj;
 	SgenGrayQueue gc_thread_gray_queue;
-	SgenObjectOperations *object_ops;
+	SgenObjectOperations *object_ops, *object_ops_par;
+	gboolean is_parallel, sample_pretenuring;
 	ScanCopyContext ctx;
 	TV_DECLARE (atv);
 	TV_DECLARE (btv);
@@ -1509,6 +1807,14 @@ collect_nursery (const char *reason, gboolean is_overflow, SgenGrayQueue *unpin_
 	else
 		object_ops = &sgen_minor_collector.serial_ops;
 
+	/*
+	 * The workers can't help while they're busy with a concurrent collection.  In a
+	 * parallel collection only the scan jobs use the parallel operations, the main GC
+	 * thread's own work is serial.
+	 */
+	is_parallel = sgen_minor_collector.is_parallel && !sgen_concurrent_collection_in_progress ();
+	object_ops_par = is_parallel ? &sgen_minor_collector.parallel_ops : object_ops;
+
 	if (do_verify_nursery || do_dump_nursery_content)
 		sgen_debug_verify_nursery (do_dump_nursery_content);
 
@@ -1554,6 +1860,7 @@ collect_nursery (const char *reason, gboolean is_overflow, SgenGrayQueue *unpin_
 	/* pin from pinned handles */
 	sgen_init_pinning ();
 	sgen_client_binary_protocol_mark_start (GENERATION_NURSERY);
+	sgen_client_gc_phase_start (GENERATION_NURSERY, SGEN_GC_PHASE_PIN);
 	pin_from_roots (sgen_get_nursery_start (), nursery_next, ctx);
 	/* pin cemented objects */
 	sgen_pin_cemented_objects ();
@@ -1563,6 +1870,7 @@ collect_nursery (const char *reason, gboolean is_overflow, SgenGrayQueue *unpin_
 
 	pin_objects_in_nursery (FALSE, ctx);
 	sgen_pinning_trim_queue_to_section (nursery_section);
+	sgen_client_gc_phase_end (GENERATION_NURSERY, SGEN_GC_PHASE_PIN);
 
 	if (remset_consistency_checks)
 		sgen_check_remset_consistency ();
@@ -1572,15 +1880,20 @@ collect_nursery (const char *reason, gboolean is_overflow, SgenGrayQueue *unpin_
 		sgen_check_whole_heap (FALSE);
 	}
 
+	sample_pretenuring = sgen_pretenure_should_sample ();
+
 	TV_GETTIME (atv);
 	time_minor_pinning += TV_ELAPSED (btv, atv);
 	SGEN_LOG (2, "Finding pinned pointers: %zd in %lld usecs", sgen_get_pinned_count (), (long long)TV_ELAPSED (btv, atv));
 	SGEN_LOG (4, "Start scan with %zd pinned objects", sgen_get_pinned_count ());
 
-	sj = (ScanJob*)sgen_thread_pool_job_alloc ("scan remset", job_remembered_set_scan, sizeof (ScanJob));
-	sj->ops = object_ops;
-	sj->gc_thread_gray_queue = &gc_thread_gray_queue;
-	sgen_workers_enqueue_job (&sj->job, FALSE);
+	/*
+	 * In a parallel collection the remembered set is scanned together with the roots,
+	 * so its time is accounted as root scanning.
+	 */
+	sgen_client_gc_phase_start (GENERATION_NURSERY, SGEN_GC_PHASE_SCAN_REMSETS);
+	enqueue_scan_remembered_set_jobs (&gc_thread_gray_queue, object_ops_par, is_parallel);
+	sgen_client_gc_phase_end (GENERATION_NURSERY, SGEN_GC_PHASE_SCAN_REMSETS);
 
 	/* we don't have complete write barrier yet, so we scan all the old generation sections */
 	TV_GETTIME (btv);
@@ -1595,7 +1908,12 @@ collect_nursery (const char *reason, gboolean is_overflow, SgenGrayQueue *unpin_
 	TV_GETTIME (atv);
 	time_minor_scan_pinned += TV_ELAPSED (btv, atv);
 
-	enqueue_scan_from_roots_jobs (&gc_thread_gray_queue, sgen_get_nursery_start (), nursery_next, object_ops, FALSE);
+	sgen_client_gc_phase_start (GENERATION_NURSERY, SGEN_GC_PHASE_SCAN_ROOTS);
+	enqueue_scan_from_roots_jobs (&gc_thread_gray_queue, sgen_get_nursery_start (), nursery_next, object_ops_par, FALSE, is_parallel);
+
+	if (is_parallel)
+		sgen_workers_run_parallel_jobs (object_ops_par, &gc_thread_gray_queue);
+	sgen_client_gc_phase_end (GENERATION_NURSERY, SGEN_GC_PHASE_SCAN_ROOTS);
 
 	TV_GETTIME (btv);
 	time_minor_scan_roots += TV_ELAPSED (atv, btv);
@@ -1618,6 +1936,10 @@ collect_nursery (const char *reason, gboolean is_overflow, SgenGrayQueue *unpin_
 	if (remset_consistency_checks)
 		sgen_check_remset_consistency ();
 
+	/* Same here, the sample relies on the pin and forwarding bits. */
+	if (sample_pretenuring)
+		sgen_pretenure_sample_nursery (sgen_get_nursery_start (), nursery_next);
+
 	/* walk the pin_queue, build up the fragment list of free memory, unmark
 	 * pinned objects as we go, memzero() the empty fragments so they are ready for the
 	 * next allocations.
@@ -1740,6 +2062,7 @@ major_copy_or_mark_from_roots (SgenGrayQueue *gc_thread_gray_queue, size_t *old_
 	sgen_process_fin_stage_entries ();
 
 	TV_GETTIME (atv);
+	sgen_client_gc_phase_start (GENERATION_OLD, SGEN_GC_PHASE_PIN);
 	sgen_init_pinning ();
 	SGEN_LOG (6, "Collecting pinned addresses");
 	pin_from_roots ((void*)lowest_heap_address, (void*)highest_heap_address, ctx);
@@ -1805,6 +2128,7 @@ major_copy_or_mark_from_roots (SgenGrayQueue *gc_thread_gray_queue, size_t *old_
 	major_collector.pin_objects (gc_thread_gray_queue);
 	if (old_next_pin_slot)
 		*old_next_pin_slot = sgen_get_pinned_count ();
+	sgen_client_gc_phase_end (GENERATION_OLD, SGEN_GC_PHASE_PIN);
 
 	TV_GETTIME (btv);
 	time_major_pinning += TV_ELAPSED (atv, btv);
@@ -1820,7 +2144,7 @@ major_copy_or_mark_from_roots (SgenGrayQueue *gc_thread_gray_queue, size_t *old_
 			 * We force the finish of the worker with the new object ops context
 			 * which can also do copying. We need to have finished pinning.
 			 */
-			sgen_workers_start_all_workers (object_ops, NULL);
+			sgen_workers_start_all_workers (object_ops, NULL, NULL);
 			sgen_workers_join ();
 		}
 	}
@@ -1836,7 +2160,9 @@ major_copy_or_mark_from_roots (SgenGrayQueue *gc_thread_gray_queue, size_t *old_
 
 	sgen_client_collecting_major_3 (&fin_ready_queue, &critical_fin_queue);
 
-	enqueue_scan_from_roots_jobs (gc_thread_gray_queue, heap_start, heap_end, object_ops, FALSE);
+	sgen_client_gc_phase_start (GENERATION_OLD, SGEN_GC_PHASE_SCAN_ROOTS);
+	enqueue_scan_from_roots_jobs (gc_thread_gray_queue, heap_start, heap_end, object_ops, FALSE, FALSE);
+	sgen_client_gc_phase_end (GENERATION_OLD, SGEN_GC_PHASE_SCAN_ROOTS);
 
 	TV_GETTIME (btv);
 	time_major_scan_roots += TV_ELAPSED (atv, btv);
@@ -1847,15 +2173,15 @@ major_copy_or_mark_from_roots (SgenGrayQueue *gc_thread_gray_queue, size_t *old_
 	 * the roots.
 	 */
 	if (mode == COPY_OR_MARK_FROM_ROOTS_START_CONCURRENT) {
+		SgenObjectOperations *object_ops_par = major_collector.is_parallel ? &major_collector.major_ops_conc_par_start : NULL;
+
 		if (precleaning_enabled) {
-			ScanJob *sj;
-			/* Mod union preclean job */
-			sj = (ScanJob*)sgen_thread_pool_job_alloc ("preclean mod union cardtable", job_mod_union_preclean, sizeof (ScanJob));
-			sj->ops = object_ops;
-			sj->gc_thread_gray_queue = NULL;
-			sgen_workers_start_all_workers (object_ops, &sj->job);
+			/* The preclean jobs run on the workers alongside marking. */
+			preclean_object_ops = object_ops_par ? object_ops_par : object_ops;
+			preclean_rounds = 0;
+			sgen_workers_start_all_workers (object_ops, object_ops_par, workers_finish_callback);
 		} else {
-			sgen_workers_start_all_workers (object_ops, NULL);
+			sgen_workers_start_all_workers (object_ops, object_ops_par, NULL);
 		}
 		gray_queue_enable_redirect (gc_thread_gray_queue);
 	}
@@ -1864,6 +2190,7 @@ major_copy_or_mark_from_roots (SgenGrayQueue *gc_thread_gray_queue, size_t *old_
 		ScanJob *sj;
 
 		/* Mod union card table */
+		sgen_client_gc_phase_start (GENERATION_OLD, SGEN_GC_PHASE_SCAN_REMSETS);
 		sj = (ScanJob*)sgen_thread_pool_job_alloc ("scan mod union cardtable", job_scan_major_mod_union_card_table, sizeof (ScanJob));
 		sj->ops = object_ops;
 		sj->gc_thread_gray_queue = gc_thread_gray_queue;
@@ -1873,6 +2200,7 @@ major_copy_or_mark_from_roots (SgenGrayQueue *gc_thread_gray_queue, size_t *old_
 		sj->ops = object_ops;
 		sj->gc_thread_gray_queue = gc_thread_gray_queue;
 		sgen_workers_enqueue_job (&sj->job, FALSE);
+		sgen_client_gc_phase_end (GENERATION_OLD, SGEN_GC_PHASE_SCAN_REMSETS);
 
 		TV_GETTIME (atv);
 		time_major_scan_mod_union += TV_ELAPSED (btv, atv);
@@ -1929,6 +2257,13 @@ major_start_collection (SgenGrayQueue *gc_thread_gray_queue, const char *reason,
 	if (major_collector.start_major_collection)
 		major_collector.start_major_collection ();
 
+	/*
+	 * Objects can only be moved if we know that we'll see all references to them
+	 * while marking, so we don't compact in concurrent collections.
+	 */
+	if (los_compaction_enabled && !concurrent)
+		sgen_los_start_evacuation ();
+
 	major_copy_or_mark_from_roots (gc_thread_gray_queue, old_next_pin_slot, concurrent ? COPY_OR_MARK_FROM_ROOTS_START_CONCURRENT : COPY_OR_MARK_FROM_ROOTS_SERIAL, object_ops);
 }
 
@@ -2428,40 +2763,48 @@ sgen_gc_invoke_finalizers (void)
 
 	g_assert (!pending_unqueued_finalizer);
 
-	/* FIXME: batch to reduce lock contention */
 	while (sgen_have_pending_finalizers ()) {
-		GCObject *obj;
+		/* The batch is on the stack so its objects are pinned. */
+		GCObject *batch [SGEN_FINALIZER_BATCH_SIZE];
+		SgenPointerQueue *queue;
+		int i, num = 0;
 
 		LOCK_GC;
 
+		if (!sgen_pointer_queue_is_empty (&fin_ready_queue))
+			queue = &fin_ready_queue;
+		else if (!sgen_pointer_queue_is_empty (&critical_fin_queue))
+			queue = &critical_fin_queue;
+		else
+			queue = NULL;
+
 		/*
 		 * We need to set `pending_unqueued_finalizer` before dequeing the
-		 * finalizable object.
+		 * finalizable objects.
 		 */
-		if (!sgen_pointer_queue_is_empty (&fin_ready_queue)) {
+		if (queue) {
 			pending_unqueued_finalizer = TRUE;
 			mono_memory_write_barrier ();
-			obj = (GCObject *)sgen_pointer_queue_pop (&fin_ready_queue);
-		} else if (!sgen_pointer_queue_is_empty (&critical_fin_queue)) {
-			pending_unqueued_finalizer = TRUE;
-			mono_memory_write_barrier ();
-			obj = (GCObject *)sgen_pointer_queue_pop (&critical_fin_queue);
-		} else {
-			obj = NULL;
+			while (num < SGEN_FINALIZER_BATCH_SIZE && !sgen_pointer_queue_is_empty (queue)) {
+				batch [num] = (GCObject *)sgen_pointer_queue_pop (queue);
+				SGEN_LOG (7, "Finalizing object %p (%s)", batch [num], sgen_client_vtable_get_name (SGEN_LOAD_VTABLE (batch [num])));
+				++num;
+			}
 		}
 
-		if (obj)
-			SGEN_LOG (7, "Finalizing object %p (%s)", obj, sgen_client_vtable_get_name (SGEN_LOAD_VTABLE (obj)));
-
 		UNLOCK_GC;
 
-		if (!obj)
+		if (!num)
 			break;
 
-		count++;
-		/* the object is on the stack so it is pinned */
-		/*g_print ("Calling finalizer for object: %p (%s)\n", obj, sgen_client_object_safe_name (obj));*/
-		sgen_client_run_finalize (obj);
+		/* Like the queues, the rest of the batch isn't finalized once finalizers are suspended. */
+		for (i = 0; i < num && !sgen_suspend_finalizers; ++i) {
+			GCObject *obj = batch [i];
+			batch [i] = NULL;
+			count++;
+			/*g_print ("Calling finalizer for object: %p (%s)\n", obj, sgen_client_object_safe_name (obj));*/
+			sgen_client_run_finalize (obj);
+		}
 	}
 
 	if (pending_unqueued_finalizer) {
@@ -2556,6 +2899,9 @@ void*
 sgen_thread_register (SgenThreadInfo* info, void *stack_bottom_fallback)
 {
 	info->tlab_start = info->tlab_next = info->tlab_temp_end = info->tlab_real_end = NULL;
+	info->tlab_desired_size = tlab_size;
+	info->tlab_refills = 0;
+	memset (info->gchandle_magazines, 0, sizeof (info->gchandle_magazines));
 
 	sgen_client_thread_register (info, stack_bottom_fallback);
 
@@ -2566,6 +2912,8 @@ void
 sgen_thread_unregister (SgenThreadInfo *p)
 {
 	sgen_client_thread_unregister (p);
+	/* The thread detach callback may have freed handles into the magazines, so do this last. */
+	sgen_gchandle_release_magazines (p);
 }
 
 /*
@@ -2762,7 +3110,7 @@ sgen_gc_init (void)
 	size_t soft_limit = 0;
 	int result;
 	gboolean debug_print_allowance = FALSE;
-	double allowance_ratio = 0, save_target = 0;
+	double allowance_ratio = 0, save_target = 0, pause_target = 0, gc_cpu_target = 0;
 	gboolean cement_enabled = TRUE;
 
 	do {
@@ -2831,11 +3179,13 @@ sgen_gc_init (void)
 	sgen_client_init ();
 
 	if (!minor_collector_opt) {
-		sgen_simple_nursery_init (&sgen_minor_collector);
+		sgen_simple_nursery_init (&sgen_minor_collector, FALSE);
 	} else {
 		if (!strcmp (minor_collector_opt, "simple")) {
 		use_simple_nursery:
-			sgen_simple_nursery_init (&sgen_minor_collector);
+			sgen_simple_nursery_init (&sgen_minor_collector, FALSE);
+		} else if (!strcmp (minor_collector_opt, "simple-par")) {
+			sgen_simple_nursery_init (&sgen_minor_collector, TRUE);
 		} else if (!strcmp (minor_collector_opt, "split")) {
 			sgen_split_nursery_init (&sgen_minor_collector);
 		} else {
@@ -2851,6 +3201,8 @@ sgen_gc_init (void)
 		sgen_marksweep_init (&major_collector);
 	} else if (!strcmp (major_collector_opt, "marksweep-conc")) {
 		sgen_marksweep_conc_init (&major_collector);
+	} else if (!strcmp (major_collector_opt, "marksweep-conc-par")) {
+		sgen_marksweep_conc_par_init (&major_collector);
 	} else {
 		sgen_env_var_error (MONO_GC_PARAMS_NAME, "Using `" DEFAULT_MAJOR_NAME "` instead.", "Unknown major collector `%s'.", major_collector_opt);
 		goto use_default_major;
@@ -2941,6 +3293,25 @@ sgen_gc_init (void)
 				continue;
 			}
 
+			if (g_str_has_prefix (opt, "pause-target=")) {
+				double val;
+				opt = strchr (opt, '=') + 1;
+				if (parse_double_in_interval (MONO_GC_PARAMS_NAME, "pause-target", opt,
+						SGEN_MIN_PAUSE_TARGET_MS, SGEN_MAX_PAUSE_TARGET_MS, &val)) {
+					pause_target = val;
+				}
+				continue;
+			}
+			if (g_str_has_prefix (opt, "gc-cpu-target=")) {
+				double val;
+				opt = strchr (opt, '=') + 1;
+				if (parse_double_in_interval (MONO_GC_PARAMS_NAME, "gc-cpu-target", opt,
+						SGEN_MIN_GC_CPU_TARGET, SGEN_MAX_GC_CPU_TARGET, &val)) {
+					gc_cpu_target = val;
+				}
+				continue;
+			}
+
 			if (!strcmp (opt, "cementing")) {
 				cement_enabled = TRUE;
 				continue;
@@ -2950,6 +3321,70 @@ sgen_gc_init (void)
 				continue;
 			}
 
+			if (!strcmp (opt, "numa-nursery")) {
+				if (sgen_minor_collector.is_split)
+					sgen_env_var_error (MONO_GC_PARAMS_NAME, "Ignoring.", "`numa-nursery` only works with the `simple` minor collector.");
+				else
+					sgen_numa_nursery_enabled = TRUE;
+				continue;
+			}
+			if (!strcmp (opt, "no-numa-nursery")) {
+				sgen_numa_nursery_enabled = FALSE;
+				continue;
+			}
+
+			if (!strcmp (opt, "adaptive-tlab")) {
+				adaptive_tlab_enabled = TRUE;
+				continue;
+			}
+			if (!strcmp (opt, "no-adaptive-tlab")) {
+				adaptive_tlab_enabled = FALSE;
+				continue;
+			}
+			if (!strcmp (opt, "pretenure")) {
+				if (sgen_minor_collector.is_split)
+					sgen_env_var_error (MONO_GC_PARAMS_NAME, "Ignoring.", "`pretenure` only works with the `simple` minor collector.");
+				else
+					pretenuring_enabled = TRUE;
+				continue;
+			}
+			if (!strcmp (opt, "no-pretenure")) {
+				pretenuring_enabled = FALSE;
+				continue;
+			}
+			if (!strcmp (opt, "hierarchical-copy")) {
+				sgen_hierarchical_copy_depth = SGEN_HIERARCHICAL_COPY_DEPTH;
+				continue;
+			}
+			if (!strcmp (opt, "no-hierarchical-copy")) {
+				sgen_hierarchical_copy_depth = 0;
+				continue;
+			}
+			if (g_str_has_prefix (opt, "max-tlab-size=")) {
+				size_t val;
+				opt = strchr (opt, '=') + 1;
+				if (*opt && mono_gc_parse_environment_string_extract_number (opt, &val)) {
+					if (val < tlab_size || val > SGEN_MAX_TLAB_SIZE) {
+						sgen_env_var_error (MONO_GC_PARAMS_NAME, "Using default value.",
+								"`max-tlab-size` must be between %d and %d bytes.", tlab_size, SGEN_MAX_TLAB_SIZE);
+						continue;
+					}
+					max_tlab_size = (guint32)SGEN_ALIGN_UP (val);
+				} else {
+					sgen_env_var_error (MONO_GC_PARAMS_NAME, "Using default value.", "`max-tlab-size` must be an integer.");
+				}
+				continue;
+			}
+
+			if (!strcmp (opt, "los-compaction")) {
+				los_compaction_enabled = TRUE;
+				continue;
+			}
+			if (!strcmp (opt, "no-los-compaction")) {
+				los_compaction_enabled = FALSE;
+				continue;
+			}
+
 			if (!strcmp (opt, "precleaning")) {
 				precleaning_enabled = TRUE;
 				continue;
@@ -2977,10 +3412,16 @@ sgen_gc_init (void)
 			fprintf (stderr, "  max-heap-size=N (where N is an integer, possibly with a k, m or a g suffix)\n");
 			fprintf (stderr, "  soft-heap-limit=n (where N is an integer, possibly with a k, m or a g suffix)\n");
 			fprintf (stderr, "  nursery-size=N (where N is an integer, possibly with a k, m or a g suffix)\n");
-			fprintf (stderr, "  major=COLLECTOR (where COLLECTOR is `marksweep', `marksweep-conc', `marksweep-par')\n");
-			fprintf (stderr, "  minor=COLLECTOR (where COLLECTOR is `simple' or `split')\n");
+			fprintf (stderr, "  major=COLLECTOR (where COLLECTOR is `marksweep', `marksweep-conc', `marksweep-conc-par')\n");
+			fprintf (stderr, "  minor=COLLECTOR (where COLLECTOR is `simple', `simple-par' or `split')\n");
 			fprintf (stderr, "  wbarrier=WBARRIER (where WBARRIER is `remset' or `cardtable')\n");
 			fprintf (stderr, "  [no-]cementing\n");
+			fprintf (stderr, "  [no-]adaptive-tlab\n");
+			fprintf (stderr, "  [no-]pretenure\n");
+			fprintf (stderr, "  [no-]hierarchical-copy\n");
+			fprintf (stderr, "  [no-]numa-nursery\n");
+			fprintf (stderr, "  [no-]los-compaction\n");
+			fprintf (stderr, "  max-tlab-size=N (where N is an integer, possibly with a k suffix)\n");
 			if (major_collector.print_gc_param_usage)
 				major_collector.print_gc_param_usage ();
 			if (sgen_minor_collector.print_gc_param_usage)
@@ -2989,6 +3430,8 @@ sgen_gc_init (void)
 			fprintf (stderr, " Experimental options:\n");
 			fprintf (stderr, "  save-target-ratio=R (where R must be between %.2f - %.2f).\n", SGEN_MIN_SAVE_TARGET_RATIO, SGEN_MAX_SAVE_TARGET_RATIO);
 			fprintf (stderr, "  default-allowance-ratio=R (where R must be between %.2f - %.2f).\n", SGEN_MIN_ALLOWANCE_NURSERY_SIZE_RATIO, SGEN_MAX_ALLOWANCE_NURSERY_SIZE_RATIO);
+			fprintf (stderr, "  pause-target=N (where N is the target maximum major pause in milliseconds, between %.2f - %.2f).\n", SGEN_MIN_PAUSE_TARGET_MS, SGEN_MAX_PAUSE_TARGET_MS);
+			fprintf (stderr, "  gc-cpu-target=R (where R is the target fraction of time spent in GC pauses, between %.2f - %.2f).\n", SGEN_MIN_GC_CPU_TARGET, SGEN_MAX_GC_CPU_TARGET);
 			fprintf (stderr, "\n");
 
 			usage_printed = TRUE;
@@ -3075,6 +3518,8 @@ sgen_gc_init (void)
 				nursery_clear_policy = CLEAR_AT_TLAB_CREATION;
 			} else if (!strcmp (opt, "debug-clear-at-tlab-creation")) {
 				nursery_clear_policy = CLEAR_AT_TLAB_CREATION_DEBUG;
+			} else if (!strcmp (opt, "clear-in-background")) {
+				nursery_clear_policy = CLEAR_IN_BACKGROUND;
 			} else if (!strcmp (opt, "check-scan-starts")) {
 				do_scan_starts_check = TRUE;
 			} else if (!strcmp (opt, "verify-nursery-at-minor-gc")) {
@@ -3108,6 +3553,14 @@ sgen_gc_init (void)
 					*colon = '\0';
 				}
 				binary_protocol_init (filename, (long long)limit);
+			} else if (g_str_has_prefix (opt, "binary-protocol-sample=")) {
+				int interval = atoi (strchr (opt, '=') + 1);
+				if (interval > 0)
+					binary_protocol_set_sample_interval (interval);
+				else
+					sgen_env_var_error (MONO_GC_DEBUG_NAME, "Recording all collections.", "`binary-protocol-sample` must be a positive integer.");
+			} else if (!strcmp (opt, "binary-protocol-async")) {
+				binary_protocol_set_async (TRUE);
 			} else if (!strcmp (opt, "nursery-canaries")) {
 				do_verify_nursery = TRUE;
 				enable_nursery_canaries = TRUE;
@@ -3133,11 +3586,14 @@ sgen_gc_init (void)
 				fprintf (stderr, "  clear-[nursery-]at-gc\n");
 				fprintf (stderr, "  clear-at-tlab-creation\n");
 				fprintf (stderr, "  debug-clear-at-tlab-creation\n");
+				fprintf (stderr, "  clear-in-background\n");
 				fprintf (stderr, "  check-scan-starts\n");
 				fprintf (stderr, "  print-allowance\n");
 				fprintf (stderr, "  print-pinning\n");
 				fprintf (stderr, "  heap-dump=<filename>\n");
 				fprintf (stderr, "  binary-protocol=<filename>[:<file-size-limit>]\n");
+				fprintf (stderr, "  binary-protocol-sample=N (record only every N-th collection)\n");
+				fprintf (stderr, "  binary-protocol-async (write the binary protocol from a background thread)\n");
 				fprintf (stderr, "  nursery-canaries\n");
 				sgen_client_print_gc_debug_usage ();
 				fprintf (stderr, "\n");
@@ -3157,10 +3613,21 @@ sgen_gc_init (void)
 	if (major_collector.post_param_init)
 		major_collector.post_param_init (&major_collector);
 
-	if (major_collector.needs_thread_pool)
+	if (sgen_minor_collector.is_parallel && !major_collector.alloc_object_par) {
+		sgen_env_var_error (MONO_GC_PARAMS_NAME, "Using `simple` instead.", "The major collector doesn't support parallel nursery collections.");
+		sgen_simple_nursery_init (&sgen_minor_collector, FALSE);
+	}
+
+	if (sgen_minor_collector.is_parallel)
+		mono_os_mutex_init (&parallel_minor_lock);
+
+	if (sgen_minor_collector.is_parallel || major_collector.is_parallel || major_collector.sweeps_in_parallel) {
+		sgen_workers_init (MAX (1, MIN (mono_cpu_count (), SGEN_THREADPOOL_MAX_NUM_THREADS)));
+	} else if (major_collector.needs_thread_pool) {
 		sgen_workers_init (1);
+	}
 
-	sgen_memgov_init (max_heap, soft_limit, debug_print_allowance, allowance_ratio, save_target);
+	sgen_memgov_init (max_heap, soft_limit, debug_print_allowance, allowance_ratio, save_target, pause_target, gc_cpu_target);
 
 	memset (&remset, 0, sizeof (remset));
 
@@ -3244,6 +3711,9 @@ sgen_stop_world (int generation)
 
 	world_is_stopped = TRUE;
 
+	/* The nursery fragments belong to the collector again */
+	sgen_nursery_stop_background_clear ();
+
 	if (binary_protocol_is_heavy_enabled ())
 		count_cards (&major_total, &major_marked, &los_total, &los_marked);
 	binary_protocol_world_stopped (generation, sgen_timestamp (), major_total, major_marked, los_total, los_marked);
@@ -3268,6 +3738,8 @@ sgen_restart_world (int generation)
 
 	binary_protocol_world_restarted (generation, sgen_timestamp ());
 
+	sgen_nursery_start_background_clear ();
+
 	if (sgen_client_bridge_need_processing ())
 		sgen_client_bridge_processing_finish (generation);
 
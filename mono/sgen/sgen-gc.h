@@ -39,15 +39,35 @@ typedef struct _SgenThreadInfo SgenThreadInfo;
 /* Clearing at nursery collections is the safest, but has bad interactions with caches.
  * Clearing at TLAB creation is much faster, but more complex and it might expose hard
  * to find bugs.
+ * Clearing in the background is like clearing at TLAB creation, except that a
+ * background thread zeroes the free fragments after the world restarts, and TLABs
+ * are preferably handed out from fragments it has finished.
  */
 typedef enum {
 	CLEAR_AT_GC,
 	CLEAR_AT_TLAB_CREATION,
-	CLEAR_AT_TLAB_CREATION_DEBUG
+	CLEAR_AT_TLAB_CREATION_DEBUG,
+	CLEAR_IN_BACKGROUND
 } NurseryClearPolicy;
 
 NurseryClearPolicy sgen_get_nursery_clear_policy (void);
 
+/* Whether the free parts of the nursery contain garbage between collections */
+#define sgen_nursery_clear_policy_is_lazy(p) ((p) == CLEAR_AT_TLAB_CREATION || (p) == CLEAR_AT_TLAB_CREATION_DEBUG || (p) == CLEAR_IN_BACKGROUND)
+
+/*
+ * Phases of a stop-the-world pause that are reported to the client, see
+ * sgen_client_gc_phase_start () and sgen_client_gc_phase_end ().
+ */
+typedef enum {
+	SGEN_GC_PHASE_PIN,
+	SGEN_GC_PHASE_SCAN_REMSETS,
+	SGEN_GC_PHASE_SCAN_ROOTS,
+	SGEN_GC_PHASE_DRAIN_GRAY,
+	SGEN_GC_PHASE_FINALIZATION,
+	SGEN_GC_PHASE_BRIDGE
+} SgenGCPhase;
+
 #if !defined(__MACH__) && !MONO_MACH_ARCH_SUPPORTED && defined(HAVE_PTHREAD_KILL)
 #define SGEN_POSIX_STW 1
 #endif
@@ -291,6 +311,8 @@ enum {
 	SGEN_GC_BIT_BRIDGE_OBJECT = 1,
 	SGEN_GC_BIT_BRIDGE_OPAQUE_OBJECT = 2,
 	SGEN_GC_BIT_FINALIZER_AWARE = 4,
+	// Objects of this class are allocated in the major heap, see sgen_pretenure_sample_nursery ().
+	SGEN_GC_BIT_PRETENURE = 8,
 };
 
 void sgen_gc_init (void);
@@ -344,6 +366,8 @@ enum {
 	INTERNAL_MEM_TEMPORARY,
 	INTERNAL_MEM_LOG_ENTRY,
 	INTERNAL_MEM_COMPLEX_DESCRIPTORS,
+	INTERNAL_MEM_PRETENURE_TABLE,
+	INTERNAL_MEM_PRETENURE_ENTRY,
 	INTERNAL_MEM_FIRST_CLIENT
 };
 
@@ -400,6 +424,12 @@ typedef void (*IterateObjectCallbackFunc) (GCObject*, size_t, void*);
 
 void sgen_scan_area_with_callback (char *start, char *end, IterateObjectCallbackFunc callback, void *data, gboolean allow_flags, gboolean fail_on_canaries);
 
+/* A per-thread cache of reserved, free GC handle slots, see sgen-gchandles.c */
+typedef struct {
+	guint32 count;
+	guint32 slots [SGEN_GCHANDLE_MAGAZINE_SIZE];
+} SgenGCHandleMagazine;
+
 /* eventually share with MonoThread? */
 /*
  * This structure extends the MonoThreadInfo structure.
@@ -411,6 +441,12 @@ struct _SgenThreadInfo {
 	char *tlab_next;
 	char *tlab_temp_end;
 	char *tlab_real_end;
+
+	/* Adaptive TLAB sizing, see sgen_clear_tlabs () */
+	guint32 tlab_desired_size;
+	guint32 tlab_refills;
+
+	SgenGCHandleMagazine gchandle_magazines [HANDLE_TYPE_MAX];
 };
 
 gboolean sgen_is_worker_thread (MonoNativeThreadId thread);
@@ -459,6 +495,7 @@ void sgen_pin_stats_report (void);
 
 void sgen_sort_addresses (void **array, size_t size);
 void sgen_add_to_global_remset (gpointer ptr, GCObject *obj);
+void sgen_add_to_global_remset_par (gpointer ptr, GCObject *obj);
 
 int sgen_get_current_collection_generation (void);
 gboolean sgen_collection_is_concurrent (void);
@@ -472,6 +509,21 @@ struct _SgenFragment {
 	char *fragment_next; /* the current soft limit for allocation */
 	char *fragment_end;
 	SgenFragment *next_in_order; /* We use a different entry for all active fragments so we can avoid SMR. */
+	volatile gint32 clear_state; /* SGEN_FRAGMENT_*, only used with CLEAR_IN_BACKGROUND */
+	char * volatile clear_next; /* end of the chunk the background thread is zeroing */
+};
+
+enum {
+	/* Zeroed, allocations from it don't need clearing */
+	SGEN_FRAGMENT_CLEARED,
+	/* Garbage, not claimed yet */
+	SGEN_FRAGMENT_DIRTY,
+	/* Being zeroed by the background clearing thread */
+	SGEN_FRAGMENT_CLEARING,
+	/* Being taken over from the background clearing thread by a mutator */
+	SGEN_FRAGMENT_TAKING_OVER,
+	/* Garbage, claimed by a mutator, which clears each allocation from it */
+	SGEN_FRAGMENT_MUTATOR_CLEARS
 };
 
 typedef struct {
@@ -546,11 +598,14 @@ sgen_nursery_is_object_alive (GCObject *obj)
 
 typedef struct {
 	gboolean is_split;
+	gboolean is_parallel;
 
 	GCObject* (*alloc_for_promotion) (GCVTable vtable, GCObject *obj, size_t objsize, gboolean has_references);
 
 	SgenObjectOperations serial_ops;
 	SgenObjectOperations serial_ops_with_concurrent_major;
+	/* Only for parallel collectors.  Must not be used while a concurrent collection is in progress. */
+	SgenObjectOperations parallel_ops;
 
 	void (*prepare_to_space) (char *to_space_bitmap, size_t space_bitmap_size);
 	void (*clear_fragments) (void);
@@ -565,7 +620,7 @@ typedef struct {
 
 extern SgenMinorCollector sgen_minor_collector;
 
-void sgen_simple_nursery_init (SgenMinorCollector *collector);
+void sgen_simple_nursery_init (SgenMinorCollector *collector, gboolean parallel);
 void sgen_split_nursery_init (SgenMinorCollector *collector);
 
 /* Updating references */
@@ -578,7 +633,7 @@ sgen_update_reference (GCObject **p, GCObject *o, gboolean allow_null)
 {
 	if (!allow_null)
 		SGEN_ASSERT (0, o, "Cannot update a reference with a NULL pointer");
-	SGEN_ASSERT (0, !sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()), "Can't update a reference in the worker thread");
+	SGEN_ASSERT (0, sgen_minor_collector.is_parallel || !sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()), "Can't update a reference in the worker thread");
 	*p = o;
 }
 
@@ -620,7 +675,11 @@ typedef struct _SgenMajorCollector SgenMajorCollector;
 struct _SgenMajorCollector {
 	size_t section_size;
 	gboolean is_concurrent;
+	/* Whether several workers can mark at once in concurrent collections. */
+	gboolean is_parallel;
 	gboolean needs_thread_pool;
+	/* Whether the sweep is shared between all the thread pool threads. */
+	gboolean sweeps_in_parallel;
 	gboolean supports_cardtable;
 	gboolean sweeps_lazily;
 
@@ -632,8 +691,12 @@ struct _SgenMajorCollector {
 	SgenObjectOperations major_ops_serial;
 	SgenObjectOperations major_ops_concurrent_start;
 	SgenObjectOperations major_ops_concurrent_finish;
+	/* Like `major_ops_concurrent_start`, but safe to use from several workers at once. */
+	SgenObjectOperations major_ops_conc_par_start;
 
 	GCObject* (*alloc_object) (GCVTable vtable, size_t size, gboolean has_references);
+	/* Like `alloc_object`, but can be called from several workers at once during a nursery collection. */
+	GCObject* (*alloc_object_par) (GCVTable vtable, size_t size, gboolean has_references);
 	void (*free_pinned_object) (GCObject *obj, size_t size);
 
 	/*
@@ -641,11 +704,17 @@ struct _SgenMajorCollector {
 	 * debugging.  Can assume the world is stopped.
 	 */
 	void (*iterate_objects) (IterateObjectsFlags flags, IterateObjectCallbackFunc callback, void *data);
+	/*
+	 * Like `iterate_objects`, but may skip objects whose region tag (see
+	 * `sgen_client_vtable_get_region_tag ()`) doesn't intersect `tags`.
+	 */
+	void (*iterate_objects_with_tags) (IterateObjectsFlags flags, guint16 tags, IterateObjectCallbackFunc callback, void *data);
 
 	void (*free_non_pinned_object) (GCObject *obj, size_t size);
 	void (*pin_objects) (SgenGrayQueue *queue);
 	void (*pin_major_object) (GCObject *obj, SgenGrayQueue *queue);
-	void (*scan_card_table) (CardTableScanType scan_type, ScanCopyContext ctx);
+	/* Only scans every `job_split_count`th block, starting with block `job_index`. */
+	void (*scan_card_table) (CardTableScanType scan_type, ScanCopyContext ctx, int job_index, int job_split_count);
 	void (*iterate_live_block_ranges) (sgen_cardtable_block_callback callback);
 	void (*iterate_block_ranges) (sgen_cardtable_block_callback callback);
 	void (*update_cardtable_mod_union) (void);
@@ -683,6 +752,7 @@ void sgen_marksweep_fixed_init (SgenMajorCollector *collector);
 void sgen_marksweep_par_init (SgenMajorCollector *collector);
 void sgen_marksweep_fixed_par_init (SgenMajorCollector *collector);
 void sgen_marksweep_conc_init (SgenMajorCollector *collector);
+void sgen_marksweep_conc_par_init (SgenMajorCollector *collector);
 SgenMajorCollector* sgen_get_major_collector (void);
 
 
@@ -694,7 +764,9 @@ typedef struct _SgenRememberedSet {
 	void (*wbarrier_generic_nostore) (gpointer ptr);
 	void (*record_pointer) (gpointer ptr);
 
-	void (*scan_remsets) (ScanCopyContext ctx);
+	/* Must be called once before `scan_remsets`, which can then be split into several jobs. */
+	void (*start_scan_remsets) (void);
+	void (*scan_remsets) (ScanCopyContext ctx, int job_index, int job_split_count);
 
 	void (*clear_cards) (void);
 
@@ -802,6 +874,7 @@ const char* sgen_generation_name (int generation);
 
 void sgen_finalize_in_range (int generation, ScanCopyContext ctx);
 void sgen_null_link_in_range (int generation, ScanCopyContext ctx, gboolean track);
+void sgen_null_link_in_range_split (int generation, ScanCopyContext ctx, gboolean track, int job_index, int job_split_count);
 void sgen_process_fin_stage_entries (void);
 gboolean sgen_have_pending_finalizers (void);
 void sgen_object_register_for_finalization (GCObject *obj, void *user_data);
@@ -823,6 +896,7 @@ enum {
 };
 
 void sgen_pin_object (GCObject *object, SgenGrayQueue *queue);
+GCObject* sgen_pin_object_par (GCObject *object, SgenGrayQueue *queue);
 void sgen_set_pinned_from_failed_allocation (mword objsize);
 
 void sgen_ensure_free_space (size_t size, int generation);
@@ -858,6 +932,11 @@ struct _LOSObject {
 extern LOSObject *los_object_list;
 extern mword los_memory_usage;
 extern mword los_memory_usage_total;
+extern guint64 stat_los_section_free_bytes;
+extern guint64 stat_los_section_fragmented_bytes;
+extern guint64 stat_los_sections_alloced;
+extern guint64 stat_los_sections_freed;
+extern guint64 stat_los_objects_evacuated;
 
 void sgen_los_free_object (LOSObject *obj);
 void* sgen_los_alloc_large_inner (GCVTable vtable, size_t size);
@@ -865,7 +944,7 @@ void sgen_los_sweep (void);
 gboolean sgen_ptr_is_in_los (char *ptr, char **start);
 void sgen_los_iterate_objects (IterateObjectCallbackFunc cb, void *user_data);
 void sgen_los_iterate_live_block_ranges (sgen_cardtable_block_callback callback);
-void sgen_los_scan_card_table (CardTableScanType scan_type, ScanCopyContext ctx);
+void sgen_los_scan_card_table (CardTableScanType scan_type, ScanCopyContext ctx, int job_index, int job_split_count);
 void sgen_los_update_cardtable_mod_union (void);
 void sgen_los_count_cards (long long *num_total_cards, long long *num_marked_cards);
 gboolean sgen_los_is_valid_object (char *object);
@@ -873,12 +952,20 @@ gboolean mono_sgen_los_describe_pointer (char *ptr);
 LOSObject* sgen_los_header_for_object (GCObject *data);
 mword sgen_los_object_size (LOSObject *obj);
 void sgen_los_pin_object (GCObject *obj);
+gboolean sgen_los_pin_object_par (GCObject *obj);
 gboolean sgen_los_object_is_pinned (GCObject *obj);
 void sgen_los_mark_mod_union_card (GCObject *mono_obj, void **ptr);
+void sgen_los_set_object_unmovable (GCObject *data);
+void sgen_los_start_evacuation (void);
+gboolean sgen_los_is_evacuating (void);
+gboolean sgen_los_object_should_evacuate (GCObject *data);
+GCObject* sgen_los_evacuate_object (GCObject *data);
 
 
 /* nursery allocator */
 
+extern gboolean sgen_numa_nursery_enabled;
+
 void sgen_clear_nursery_fragments (void);
 void sgen_nursery_allocator_prepare_for_pinning (void);
 void sgen_nursery_allocator_set_nursery_bounds (char *nursery_start, char *nursery_end);
@@ -894,6 +981,8 @@ void sgen_nursery_retire_region (void *address, ptrdiff_t size);
 
 void sgen_nursery_alloc_prepare_for_minor (void);
 void sgen_nursery_alloc_prepare_for_major (void);
+void sgen_nursery_start_background_clear (void);
+void sgen_nursery_stop_background_clear (void);
 
 GCObject* sgen_alloc_for_promotion (GCObject *obj, size_t objsize, gboolean has_references);
 
@@ -954,9 +1043,11 @@ void sgen_null_links_if (SgenObjectPredicateFunc predicate, void *data, int gene
 typedef gpointer (*SgenGCHandleIterateCallback) (gpointer hidden, GCHandleType handle_type, int max_generation, gpointer user);
 
 void sgen_gchandle_iterate (GCHandleType handle_type, int max_generation, SgenGCHandleIterateCallback callback, gpointer user);
+guint32 sgen_gchandle_get_num_slots (GCHandleType handle_type);
 void sgen_gchandle_set_target (guint32 gchandle, GCObject *obj);
 void sgen_mark_normal_gc_handles (void *addr, SgenUserMarkFunc mark_func, void *gc_data);
 gpointer sgen_gchandle_get_metadata (guint32 gchandle);
+void sgen_gchandle_release_magazines (SgenThreadInfo *info);
 
 /* Other globals */
 
@@ -967,6 +1058,9 @@ extern gboolean has_per_allocation_action;
 extern size_t degraded_mode;
 extern int default_nursery_size;
 extern guint32 tlab_size;
+extern guint32 max_tlab_size;
+extern gboolean adaptive_tlab_enabled;
+extern gboolean pretenuring_enabled;
 extern NurseryClearPolicy nursery_clear_policy;
 extern gboolean sgen_try_free_some_memory;
 extern mword total_promoted_size;
@@ -998,6 +1092,9 @@ typedef enum {
 
 void sgen_clear_tlabs (void);
 
+gboolean sgen_pretenure_should_sample (void);
+void sgen_pretenure_sample_nursery (char *start, char *end);
+
 GCObject* sgen_alloc_obj (GCVTable vtable, size_t size);
 GCObject* sgen_alloc_obj_pinned (GCVTable vtable, size_t size);
 GCObject* sgen_alloc_obj_mature (GCVTable vtable, size_t size);
@@ -29,8 +29,26 @@ static volatile guint32 stat_gc_handles_max_allocated = 0;
  * object pointer. If the reference is NULL, and 'GC_HANDLE_TYPE_IS_WEAK' is
  * true for 'type', then the pointer is a metadata pointer--this allows us to
  * retrieve the domain ID of an expired weak reference in Mono.
+ *
+ * To keep threads from contending on the table, each thread caches a magazine
+ * of free slots per handle type in its 'SgenThreadInfo'.  Those slots hold
+ * 'GC_HANDLE_RESERVED', which is not occupied, so the GC skips them, but is
+ * set, so no other thread can claim them.  Allocating a handle from, or freeing
+ * it into, the current thread's magazine is then a plain store.  Slots move
+ * between the magazine and the table in batches.
  */
 
+#define GC_HANDLE_RESERVED	((gpointer)(mword)MONO_GC_HANDLE_VALID_MASK)
+
+/* Passed as the data to 'try_occupy_slot' to reserve a slot for a magazine. */
+#define GC_HANDLE_RESERVE_DATA	(-1)
+
+#ifdef HAVE_KW_THREAD
+#define GCHANDLE_MAGAZINES	(sgen_thread_info ? sgen_thread_info->gchandle_magazines : NULL)
+#else
+#define GCHANDLE_MAGAZINES	(__thread_info__ ? __thread_info__->gchandle_magazines : NULL)
+#endif
+
 typedef struct {
 	SgenArrayList entries_array;
 	guint8 type;
@@ -75,17 +93,19 @@ static inline gboolean
 is_slot_set (volatile gpointer *slot)
 {
 	gpointer entry = *slot;
-	if (MONO_GC_HANDLE_OCCUPIED (entry))
+	if (MONO_GC_HANDLE_OCCUPIED (entry) || entry == GC_HANDLE_RESERVED)
 		return TRUE;
 	return FALSE;
 }
 
-/* Try to claim a slot by setting its occupied bit. */
+/* Try to claim a slot by setting its occupied bit, or reserve it for a magazine. */
 static inline gboolean
 try_occupy_slot (volatile gpointer *slot, gpointer obj, int data)
 {
 	if (is_slot_set (slot))
 		return FALSE;
+	if (data == GC_HANDLE_RESERVE_DATA)
+		return InterlockedCompareExchangePointer (slot, GC_HANDLE_RESERVED, NULL) == NULL;
 	return try_set_slot (slot, (GCObject *)obj, NULL, (GCHandleType)data) != NULL;
 }
 
@@ -132,11 +152,82 @@ sgen_mark_normal_gc_handles (void *addr, SgenUserMarkFunc mark_func, void *gc_da
 }
 
 
+/*
+ * Reserves a batch of slots from the table for the magazine.  Like in
+ * `alloc_handle ()`, `next_slot` is updated before the slots are reserved, so
+ * the GC will scan them once they are used.
+ */
+static void
+refill_magazine (HandleData *handles, SgenGCHandleMagazine *magazine)
+{
+	SgenArrayList *array = &handles->entries_array;
+
+	while (magazine->count < SGEN_GCHANDLE_MAGAZINE_BATCH)
+		magazine->slots [magazine->count++] = sgen_array_list_add (array, NULL, GC_HANDLE_RESERVE_DATA, TRUE);
+}
+
+/* Returns `count` slots of the magazine to the table. */
+static void
+flush_magazine (HandleData *handles, SgenGCHandleMagazine *magazine, guint32 count)
+{
+	SgenArrayList *array = &handles->entries_array;
+
+	SGEN_ASSERT (0, count <= magazine->count, "Can't flush more slots than the magazine holds");
+	while (count--) {
+		volatile gpointer *slot = sgen_array_list_get_slot (array, magazine->slots [--magazine->count]);
+		SGEN_ASSERT (0, *slot == GC_HANDLE_RESERVED, "Why is a magazine slot not reserved?");
+		*slot = NULL;
+	}
+}
+
+/*
+ * Returns the slots cached by a thread to the table when it unregisters.  Its thread
+ * info must already be unset, so handles it frees from now on go to the table
+ * directly, otherwise their slots would stay reserved forever.
+ */
+void
+sgen_gchandle_release_magazines (SgenThreadInfo *info)
+{
+	int type;
+	TLAB_ACCESS_INIT;
+
+	SGEN_ASSERT (0, GCHANDLE_MAGAZINES != info->gchandle_magazines, "Why is an unregistering thread still using its magazines?");
+
+	for (type = 0; type < HANDLE_TYPE_MAX; ++type) {
+		SgenGCHandleMagazine *magazine = &info->gchandle_magazines [type];
+		flush_magazine (gc_handles_for_type ((GCHandleType)type), magazine, magazine->count);
+	}
+}
+
 static guint32
 alloc_handle (HandleData *handles, GCObject *obj, gboolean track)
 {
 	guint32 res, index;
 	SgenArrayList *array = &handles->entries_array;
+	SgenGCHandleMagazine *magazines;
+	TLAB_ACCESS_INIT;
+
+	magazines = GCHANDLE_MAGAZINES;
+	if (magazines) {
+		SgenGCHandleMagazine *magazine = &magazines [handles->type];
+		volatile gpointer *slot;
+		gpointer new_;
+
+		if (!magazine->count)
+			refill_magazine (handles, magazine);
+
+		/* The slot is reserved for this thread, so nobody else can write it. */
+		index = magazine->slots [--magazine->count];
+		slot = sgen_array_list_get_slot (array, index);
+		SGEN_ASSERT (0, *slot == GC_HANDLE_RESERVED, "Why is a magazine slot not reserved?");
+		if (obj)
+			new_ = MONO_GC_HANDLE_OBJECT_POINTER (obj, GC_HANDLE_TYPE_IS_WEAK (handles->type));
+		else
+			new_ = MONO_GC_HANDLE_METADATA_POINTER (sgen_client_default_metadata (), GC_HANDLE_TYPE_IS_WEAK (handles->type));
+		*slot = new_;
+		protocol_gchandle_update (handles->type, (gpointer)slot, GC_HANDLE_RESERVED, new_);
+		goto done;
+	}
 
 	/*
 	 * If a GC happens shortly after a new bucket is allocated, the entire
@@ -151,6 +242,7 @@ alloc_handle (HandleData *handles, GCObject *obj, gboolean track)
 	 * but hopefully some day it won't be anymore.
 	 */
 	index = sgen_array_list_add (array, obj, handles->type, TRUE);
+done:
 #ifdef HEAVY_STATISTICS
 	InterlockedIncrement ((volatile gint32 *)&stat_gc_handles_allocated);
 	if (stat_gc_handles_allocated > stat_gc_handles_max_allocated)
@@ -169,26 +261,19 @@ object_older_than (GCObject *object, int generation)
 	return generation == GENERATION_NURSERY && !sgen_ptr_in_nursery (object);
 }
 
-/*
- * Maps a function over all GC handles.
- * This assumes that the world is stopped!
- */
-void
-sgen_gchandle_iterate (GCHandleType handle_type, int max_generation, SgenGCHandleIterateCallback callback, gpointer user)
+static void
+gchandle_iterate_range (GCHandleType handle_type, guint32 begin, guint32 end, int max_generation, SgenGCHandleIterateCallback callback, gpointer user)
 {
 	HandleData *handle_data = gc_handles_for_type (handle_type);
 	SgenArrayList *array = &handle_data->entries_array;
 	gpointer hidden, result, occupied;
 	volatile gpointer *slot;
+	guint32 index;
 
-	/* If a new bucket has been allocated, but the capacity has not yet been
-	 * increased, nothing can yet have been allocated in the bucket because the
-	 * world is stopped, so we shouldn't miss any handles during iteration.
-	 */
-	SGEN_ARRAY_LIST_FOREACH_SLOT (array, slot) {
+	SGEN_ARRAY_LIST_FOREACH_SLOT_RANGE (array, begin, end, slot, index) {
 		hidden = *slot;
 		occupied = (gpointer) MONO_GC_HANDLE_OCCUPIED (hidden);
-		g_assert (hidden ? !!occupied : !occupied);
+		g_assert (hidden ? (occupied || hidden == GC_HANDLE_RESERVED) : !occupied);
 		if (!occupied)
 			continue;
 		result = callback (hidden, handle_type, max_generation, user);
@@ -198,7 +283,31 @@ sgen_gchandle_iterate (GCHandleType handle_type, int max_generation, SgenGCHandl
 			HEAVY_STAT (InterlockedDecrement ((volatile gint32 *)&stat_gc_handles_allocated));
 		protocol_gchandle_update (handle_type, (gpointer)slot, hidden, result);
 		*slot = result;
-	} SGEN_ARRAY_LIST_END_FOREACH_SLOT;
+	} SGEN_ARRAY_LIST_END_FOREACH_SLOT_RANGE;
+}
+
+/*
+ * Maps a function over all GC handles.
+ * This assumes that the world is stopped!
+ */
+void
+sgen_gchandle_iterate (GCHandleType handle_type, int max_generation, SgenGCHandleIterateCallback callback, gpointer user)
+{
+	/* If a new bucket has been allocated, but the capacity has not yet been
+	 * increased, nothing can yet have been allocated in the bucket because the
+	 * world is stopped, so we shouldn't miss any handles during iteration.
+	 */
+	gchandle_iterate_range (handle_type, 0, sgen_gchandle_get_num_slots (handle_type), max_generation, callback, user);
+}
+
+/*
+ * Returns the number of slots the GC has to look at for `handle_type`.
+ * This assumes that the world is stopped.
+ */
+guint32
+sgen_gchandle_get_num_slots (GCHandleType handle_type)
+{
+	return gc_handles_for_type (handle_type)->entries_array.next_slot;
 }
 
 /**
@@ -399,6 +508,9 @@ mono_gchandle_free (guint32 gchandle)
 	HandleData *handles = gc_handles_for_type (type);
 	volatile gpointer *slot;
 	gpointer entry;
+	SgenGCHandleMagazine *magazines;
+	TLAB_ACCESS_INIT;
+
 	if (!handles)
 		return;
 
@@ -406,7 +518,16 @@ mono_gchandle_free (guint32 gchandle)
 	entry = *slot;
 
 	if (index < handles->entries_array.capacity && MONO_GC_HANDLE_OCCUPIED (entry)) {
-		*slot = NULL;
+		magazines = GCHANDLE_MAGAZINES;
+		if (magazines) {
+			SgenGCHandleMagazine *magazine = &magazines [handles->type];
+			if (magazine->count == SGEN_GCHANDLE_MAGAZINE_SIZE)
+				flush_magazine (handles, magazine, SGEN_GCHANDLE_MAGAZINE_BATCH);
+			*slot = GC_HANDLE_RESERVED;
+			magazine->slots [magazine->count++] = index;
+		} else {
+			*slot = NULL;
+		}
 		protocol_gchandle_update (handles->type, (gpointer)slot, entry, NULL);
 		HEAVY_STAT (InterlockedDecrement ((volatile gint32 *)&stat_gc_handles_allocated));
 	} else {
@@ -456,6 +577,24 @@ sgen_null_link_in_range (int generation, ScanCopyContext ctx, gboolean track)
 	sgen_gchandle_iterate (track ? HANDLE_WEAK_TRACK : HANDLE_WEAK, generation, null_link_if_necessary, &ctx);
 }
 
+/*
+ * Like `sgen_null_link_in_range ()`, but only processes the `job_index`-th of
+ * `job_split_count` equal ranges of the weak handle table, so that several workers
+ * can null the links in parallel.  `ctx` must be safe to use concurrently.
+ *
+ * LOCKING: requires that the GC lock is held
+ */
+void
+sgen_null_link_in_range_split (int generation, ScanCopyContext ctx, gboolean track, int job_index, int job_split_count)
+{
+	GCHandleType handle_type = track ? HANDLE_WEAK_TRACK : HANDLE_WEAK;
+	guint64 num_slots = sgen_gchandle_get_num_slots (handle_type);
+	guint32 begin = (guint32)(num_slots * job_index / job_split_count);
+	guint32 end = (guint32)(num_slots * (job_index + 1) / job_split_count);
+
+	gchandle_iterate_range (handle_type, begin, end, generation, null_link_if_necessary, &ctx);
+}
+
 typedef struct {
 	SgenObjectPredicateFunc predicate;
 	gpointer data;
@@ -44,6 +44,71 @@ guint64 stat_gray_queue_dequeue_slow_path;
  */
 static GrayQueueSection *last_gray_queue_free_list;
 
+/*
+ * Makes `section` the first section of the queue.  The cursor must be set by the caller.
+ *
+ * In a parallel queue the section must be linked in before we publish it by incrementing
+ * the number of sections.
+ */
+static void
+push_section (SgenGrayQueue *queue, GrayQueueSection *section)
+{
+	section->prev = NULL;
+	section->next = queue->first;
+	if (queue->first)
+		queue->first->prev = section;
+	else
+		queue->last = section;
+	queue->first = section;
+
+	if (queue->parallel)
+		InterlockedIncrement (&queue->num_sections);
+	else
+		queue->num_sections++;
+}
+
+/*
+ * Unlinks the first section of the queue and returns it.  The cursor must be set by the
+ * caller.
+ *
+ * Decrementing the number of sections reserves the first section for us.  If there's no
+ * other section left a thief might be in the middle of stealing the one we're trying to
+ * pop, so we have to take the lock to wait for it.
+ */
+static GrayQueueSection*
+pop_section (SgenGrayQueue *queue)
+{
+	GrayQueueSection *section;
+	gint32 sections_remaining;
+	gboolean take_lock;
+
+	if (queue->parallel) {
+		sections_remaining = InterlockedDecrement (&queue->num_sections);
+		take_lock = sections_remaining <= 0;
+	} else {
+		sections_remaining = --queue->num_sections;
+		take_lock = FALSE;
+	}
+
+	if (take_lock)
+		mono_os_mutex_lock (&queue->steal_mutex);
+
+	section = queue->first;
+	queue->first = section->next;
+	if (queue->first) {
+		queue->first->prev = NULL;
+	} else {
+		SGEN_ASSERT (0, !sections_remaining, "Why do we have an inconsistent number of sections?");
+		queue->last = NULL;
+	}
+
+	if (take_lock)
+		mono_os_mutex_unlock (&queue->steal_mutex);
+
+	section->next = NULL;
+	return section;
+}
+
 void
 sgen_gray_object_alloc_queue_section (SgenGrayQueue *queue)
 {
@@ -70,8 +135,7 @@ sgen_gray_object_alloc_queue_section (SgenGrayQueue *queue)
 	STATE_TRANSITION (section, GRAY_QUEUE_SECTION_STATE_FLOATING, GRAY_QUEUE_SECTION_STATE_ENQUEUED);
 
 	/* Link it with the others */
-	section->next = queue->first;
-	queue->first = section;
+	push_section (queue, section);
 	queue->cursor = section->entries - 1;
 }
 
@@ -144,8 +208,7 @@ sgen_gray_object_dequeue (SgenGrayQueue *queue)
 #endif
 
 	if (G_UNLIKELY (queue->cursor < GRAY_FIRST_CURSOR_POSITION (queue->first))) {
-		GrayQueueSection *section = queue->first;
-		queue->first = section->next;
+		GrayQueueSection *section = pop_section (queue);
 		section->next = queue->free_list;
 
 		STATE_TRANSITION (section, GRAY_QUEUE_SECTION_STATE_ENQUEUED, GRAY_QUEUE_SECTION_STATE_FREE_LIST);
@@ -165,11 +228,8 @@ sgen_gray_object_dequeue_section (SgenGrayQueue *queue)
 	if (!queue->first)
 		return NULL;
 
-	section = queue->first;
-	queue->first = section->next;
-
-	section->next = NULL;
-	section->size = queue->cursor - section->entries + 1;
+	queue->first->size = queue->cursor - queue->first->entries + 1;
+	section = pop_section (queue);
 
 	queue->cursor = queue->first ? queue->first->entries + queue->first->size - 1 : NULL;
 
@@ -186,8 +246,7 @@ sgen_gray_object_enqueue_section (SgenGrayQueue *queue, GrayQueueSection *sectio
 	if (queue->first)
 		queue->first->size = queue->cursor - queue->first->entries + 1;
 
-	section->next = queue->first;
-	queue->first = section;
+	push_section (queue, section);
 	queue->cursor = queue->first->entries + queue->first->size - 1;
 #ifdef SGEN_CHECK_GRAY_OBJECT_ENQUEUE
 	if (queue->enqueue_check_func) {
@@ -198,6 +257,47 @@ sgen_gray_object_enqueue_section (SgenGrayQueue *queue, GrayQueueSection *sectio
 #endif
 }
 
+/*
+ * Steals the last section of a parallel queue, which can be done by any thread.  Returns
+ * NULL if the queue has fewer than two sections, because the owner works on the first
+ * one, or if some other thief is busy with the queue.
+ */
+GrayQueueSection*
+sgen_gray_object_steal_section (SgenGrayQueue *queue)
+{
+	GrayQueueSection *section = NULL;
+	gint32 sections_remaining;
+
+	SGEN_ASSERT (0, queue->parallel, "Why are we stealing from a queue that's not parallel?");
+
+	if (queue->num_sections <= 1)
+		return NULL;
+
+	/* Give up if there's contention on the last section. */
+	if (mono_os_mutex_trylock (&queue->steal_mutex) != 0)
+		return NULL;
+
+	sections_remaining = InterlockedDecrement (&queue->num_sections);
+	if (sections_remaining <= 0) {
+		/* The section we tried to reserve might be the one the owner works on. */
+		InterlockedIncrement (&queue->num_sections);
+	} else {
+		/* The last section is ours now, and it can't be the first one. */
+		section = queue->last;
+		SGEN_ASSERT (0, section && !section->next, "Why aren't we stealing the last section?");
+		queue->last = section->prev;
+		SGEN_ASSERT (0, queue->last, "Why are we stealing the only section?");
+		queue->last->next = NULL;
+		section->prev = NULL;
+
+		STATE_TRANSITION (section, GRAY_QUEUE_SECTION_STATE_ENQUEUED, GRAY_QUEUE_SECTION_STATE_FLOATING);
+	}
+
+	mono_os_mutex_unlock (&queue->steal_mutex);
+
+	return section;
+}
+
 void
 sgen_gray_object_queue_trim_free_list (SgenGrayQueue *queue)
 {
@@ -218,7 +318,7 @@ sgen_gray_object_queue_trim_free_list (SgenGrayQueue *queue)
 }
 
 void
-sgen_gray_object_queue_init (SgenGrayQueue *queue, GrayQueueEnqueueCheckFunc enqueue_check_func, gboolean reuse_free_list)
+sgen_gray_object_queue_init (SgenGrayQueue *queue, GrayQueueEnqueueCheckFunc enqueue_check_func, gboolean reuse_free_list, gboolean is_parallel)
 {
 	memset (queue, 0, sizeof (SgenGrayQueue));
 
@@ -226,6 +326,10 @@ sgen_gray_object_queue_init (SgenGrayQueue *queue, GrayQueueEnqueueCheckFunc enq
 	queue->enqueue_check_func = enqueue_check_func;
 #endif
 
+	queue->parallel = is_parallel;
+	if (is_parallel)
+		mono_os_mutex_init (&queue->steal_mutex);
+
 	if (reuse_free_list) {
 		queue->free_list = last_gray_queue_free_list;
 		last_gray_queue_free_list = NULL;
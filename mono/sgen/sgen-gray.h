@@ -41,9 +41,9 @@
 
 /* SGEN_GRAY_QUEUE_HEADER_SIZE is number of machine words */
 #ifdef SGEN_CHECK_GRAY_OBJECT_SECTIONS
-#define SGEN_GRAY_QUEUE_HEADER_SIZE	4
+#define SGEN_GRAY_QUEUE_HEADER_SIZE	5
 #else
-#define SGEN_GRAY_QUEUE_HEADER_SIZE	2
+#define SGEN_GRAY_QUEUE_HEADER_SIZE	3
 #endif
 
 #define SGEN_GRAY_QUEUE_SECTION_SIZE	(128 - SGEN_GRAY_QUEUE_HEADER_SIZE)
@@ -80,7 +80,7 @@ struct _GrayQueueSection {
 	GrayQueueSectionState state;
 #endif
 	int size;
-	GrayQueueSection *next;
+	GrayQueueSection *next, *prev;
 	GrayQueueEntry entries [SGEN_GRAY_QUEUE_SECTION_SIZE];
 };
 
@@ -89,14 +89,26 @@ typedef struct _SgenGrayQueue SgenGrayQueue;
 typedef void (*GrayQueueAllocPrepareFunc) (SgenGrayQueue*);
 typedef void (*GrayQueueEnqueueCheckFunc) (GCObject*);
 
+/*
+ * The sections form a deque.  The owner of the queue pushes and pops sections at the
+ * `first` end.  In a parallel queue other threads can steal whole sections from the
+ * `last` end with `sgen_gray_object_steal_section ()`, in the manner of a Chase-Lev
+ * deque: both ends reserve a section by decrementing `num_sections`, and only when that
+ * leaves no other section do they have to take `steal_mutex` to resolve the race.
+ */
 struct _SgenGrayQueue {
 	GrayQueueEntry *cursor;
-	GrayQueueSection *first;
+	GrayQueueSection *first, *last;
 	GrayQueueSection *free_list;
 	GrayQueueAllocPrepareFunc alloc_prepare_func;
 #ifdef SGEN_CHECK_GRAY_OBJECT_ENQUEUE
 	GrayQueueEnqueueCheckFunc enqueue_check_func;
 #endif
+	volatile gint32 num_sections;
+	gboolean parallel;
+	mono_mutex_t steal_mutex;
+	/* Nesting of hierarchical scans, see SGEN_HIERARCHICAL_COPY_CHILD () */
+	int hierarchical_depth;
 };
 
 typedef struct _SgenSectionGrayQueue SgenSectionGrayQueue;
@@ -128,8 +140,9 @@ void sgen_gray_object_enqueue (SgenGrayQueue *queue, GCObject *obj, SgenDescript
 GrayQueueEntry sgen_gray_object_dequeue (SgenGrayQueue *queue);
 GrayQueueSection* sgen_gray_object_dequeue_section (SgenGrayQueue *queue);
 void sgen_gray_object_enqueue_section (SgenGrayQueue *queue, GrayQueueSection *section);
+GrayQueueSection* sgen_gray_object_steal_section (SgenGrayQueue *queue);
 void sgen_gray_object_queue_trim_free_list (SgenGrayQueue *queue);
-void sgen_gray_object_queue_init (SgenGrayQueue *queue, GrayQueueEnqueueCheckFunc enqueue_check_func, gboolean reuse_free_list);
+void sgen_gray_object_queue_init (SgenGrayQueue *queue, GrayQueueEnqueueCheckFunc enqueue_check_func, gboolean reuse_free_list, gboolean is_parallel);
 void sgen_gray_object_queue_dispose (SgenGrayQueue *queue);
 void sgen_gray_queue_set_alloc_prepare (SgenGrayQueue *queue, GrayQueueAllocPrepareFunc alloc_prepare_func);
 void sgen_gray_object_queue_deinit (SgenGrayQueue *queue);
@@ -201,4 +214,51 @@ GRAY_OBJECT_DEQUEUE (SgenGrayQueue *queue, GCObject** obj, SgenDescriptor *desc)
 #endif
 }
 
+/*
+ * Hierarchical copy order.
+ *
+ * Objects are normally scanned in gray stack order, so by the time an object is scanned
+ * and its children are copied, lots of other objects have been copied in between, and
+ * parents end up far from their children.  With `hierarchical-copy`, when a scan copies
+ * one of the first few children of an object, the copy is taken off the gray stack
+ * again and scanned right away, so its own children are copied next to it.  Pointer
+ * chasing through trees and lists then touches fewer cache lines and pages.
+ *
+ * Only done for serial queues, and only if OBJ is the top of the stack, which is the
+ * case if it has just been copied and has references.
+ */
+extern int sgen_hierarchical_copy_depth;
+
+static inline MONO_ALWAYS_INLINE gboolean
+sgen_gray_object_take_for_hierarchical_scan (SgenGrayQueue *queue, GCObject *obj, SgenDescriptor *desc)
+{
+	if (queue->parallel || queue->hierarchical_depth >= sgen_hierarchical_copy_depth)
+		return FALSE;
+	if (!queue->first || queue->cursor == GRAY_FIRST_CURSOR_POSITION (queue->first) || queue->cursor->obj != obj)
+		return FALSE;
+
+	*desc = queue->cursor->desc;
+	--queue->cursor;
+#ifdef SGEN_HEAVY_BINARY_PROTOCOL
+	binary_protocol_gray_dequeue (queue, queue->cursor + 1, obj);
+#endif
+	return TRUE;
+}
+
+#define SGEN_HIERARCHICAL_COPY_DECLARE	int __hierarchical_children = 0
+
+/* To be used in HANDLE_PTR, after COPY has been copied from OLD. */
+#define SGEN_HIERARCHICAL_COPY_CHILD(copy,old,queue,scan_func)	do {	\
+		GCObject *__child = (GCObject*)(copy);			\
+		SgenDescriptor __child_desc;				\
+		if (G_UNLIKELY (sgen_hierarchical_copy_depth) && __child != (GCObject*)(old) && \
+				__hierarchical_children < SGEN_HIERARCHICAL_COPY_CHILDREN && \
+				sgen_gray_object_take_for_hierarchical_scan ((queue), __child, &__child_desc)) { \
+			++__hierarchical_children;			\
+			++(queue)->hierarchical_depth;			\
+			scan_func (__child, __child_desc, (queue));	\
+			--(queue)->hierarchical_depth;			\
+		}							\
+	} while (0)
+
 #endif
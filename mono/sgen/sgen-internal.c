@@ -16,6 +16,8 @@
 #include "mono/utils/lock-free-alloc.h"
 #include "mono/sgen/sgen-memory-governor.h"
 #include "mono/sgen/sgen-client.h"
+#include "mono/sgen/sgen-thread-pool.h"
+#include "mono/utils/mono-tls.h"
 
 /* keep each size a multiple of ALLOC_ALIGN */
 #if SIZEOF_VOID_P == 4
@@ -43,6 +45,62 @@ static MonoLockFreeAllocator allocators [NUM_ALLOCATORS];
 static int allocator_sizes_stats [NUM_ALLOCATORS];
 #endif
 
+/*
+ * GC worker threads allocate and free internal memory, gray queue sections
+ * in particular, at a high rate during parallel collections.  Each of them
+ * gets a cache of free slots per allocator so that most of those don't
+ * touch the shared descriptors.  Workers live as long as the GC, so their
+ * caches never need to be flushed.  Other threads have NO_CACHES in the
+ * TLS slot.
+ */
+static MonoNativeTlsKey thread_caches_key;
+
+#define NO_CACHES	((MonoLockFreeAllocCache*)(gsize)1)
+
+static MonoLockFreeAllocCache*
+get_thread_caches (void)
+{
+	MonoLockFreeAllocCache *caches = (MonoLockFreeAllocCache *)mono_native_tls_get_value (thread_caches_key);
+	int i;
+
+	if (G_LIKELY (caches))
+		return caches == NO_CACHES ? NULL : caches;
+
+	if (!sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ())) {
+		mono_native_tls_set_value (thread_caches_key, NO_CACHES);
+		return NULL;
+	}
+
+	caches = (MonoLockFreeAllocCache *)sgen_alloc_os_memory (sizeof (MonoLockFreeAllocCache) * NUM_ALLOCATORS,
+			(SgenAllocFlags)(SGEN_ALLOC_INTERNAL | SGEN_ALLOC_ACTIVATE), "internal allocator caches");
+	for (i = 0; i < NUM_ALLOCATORS; ++i)
+		mono_lock_free_alloc_cache_init (&caches [i], &allocators [i]);
+	mono_native_tls_set_value (thread_caches_key, caches);
+
+	return caches;
+}
+
+static void*
+alloc_slot (int index)
+{
+	MonoLockFreeAllocCache *caches = get_thread_caches ();
+
+	if (caches)
+		return mono_lock_free_alloc_cached (&caches [index]);
+	return mono_lock_free_alloc (&allocators [index]);
+}
+
+static void
+free_slot (void *addr, int index)
+{
+	MonoLockFreeAllocCache *caches = get_thread_caches ();
+
+	if (caches)
+		mono_lock_free_free_cached (&caches [index], addr);
+	else
+		free_slot (addr, index);
+}
+
 static size_t
 block_size (size_t slot_size)
 {
@@ -143,6 +201,8 @@ description_for_type (int type)
 	case INTERNAL_MEM_TEMPORARY: return "temporary";
 	case INTERNAL_MEM_LOG_ENTRY: return "log-entry";
 	case INTERNAL_MEM_COMPLEX_DESCRIPTORS: return "complex-descriptors";
+	case INTERNAL_MEM_PRETENURE_TABLE: return "pretenure-table";
+	case INTERNAL_MEM_PRETENURE_ENTRY: return "pretenure-entry";
 	default: {
 		const char *description = sgen_client_description_for_internal_mem_type (type);
 		SGEN_ASSERT (0, description, "Unknown internal mem type");
@@ -168,7 +228,7 @@ sgen_alloc_internal_dynamic (size_t size, int type, gboolean assert_on_failure)
 		++ allocator_sizes_stats [index];
 #endif
 
-		p = mono_lock_free_alloc (&allocators [index]);
+		p = alloc_slot (index);
 		if (!p)
 			sgen_assert_memory_alloc (NULL, size, description_for_type (type));
 		memset (p, 0, size);
@@ -185,7 +245,7 @@ sgen_free_internal_dynamic (void *addr, size_t size, int type)
 	if (size > allocator_sizes [NUM_ALLOCATORS - 1])
 		sgen_free_os_memory (addr, size, SGEN_ALLOC_INTERNAL);
 	else
-		mono_lock_free_free (addr, block_size (size));
+		free_slot (addr, index_for_size (size));
 }
 
 void*
@@ -203,7 +263,7 @@ sgen_alloc_internal (int type)
 
 	size = allocator_sizes [index];
 
-	p = mono_lock_free_alloc (&allocators [index]);
+	p = alloc_slot (index);
 	memset (p, 0, size);
 
 	return p;
@@ -257,6 +317,8 @@ sgen_init_internal_allocator (void)
 	for (i = 0; i < INTERNAL_MEM_MAX; ++i)
 		fixed_type_allocator_indexes [i] = -1;
 
+	mono_native_tls_alloc (&thread_caches_key, NULL);
+
 	for (i = 0; i < NUM_ALLOCATORS; ++i) {
 		allocator_block_sizes [i] = block_size (allocator_sizes [i]);
 		mono_lock_free_allocator_init_size_class (&size_classes [i], allocator_sizes [i], allocator_block_sizes [i]);
@@ -19,6 +19,21 @@ static unsigned long count_bitmap_overflow;
 static unsigned long count_ref_array;
 static unsigned long count_vtype_array;
 
+/*
+ * Locality of the major heap: how far the major objects that major collections scan
+ * are from the major objects they reference.
+ */
+enum {
+	DISTANCE_CACHE_LINE,	/* less than 64 bytes */
+	DISTANCE_PAGE,		/* less than 4k */
+	DISTANCE_BLOCK,		/* less than 16k, the mark&sweep block size */
+	DISTANCE_FAR,
+	NUM_DISTANCES
+};
+
+static const char *distance_names [NUM_DISTANCES] = { "cache-line", "page", "block", "far" };
+static unsigned long count_reference_distance [NUM_DISTANCES];
+
 void
 sgen_object_layout_scanned_bitmap (unsigned int bitmap)
 {
@@ -44,6 +59,27 @@ sgen_object_layout_scanned_vtype_array (void)
 	++count_vtype_array;
 }
 
+void
+sgen_object_layout_scanned_reference (void *obj, void *ref)
+{
+	size_t distance;
+	int i;
+
+	if (!ref || sgen_ptr_in_nursery (obj) || sgen_ptr_in_nursery (ref))
+		return;
+
+	distance = (char*)ref > (char*)obj ? (char*)ref - (char*)obj : (char*)obj - (char*)ref;
+	if (distance < 64)
+		i = DISTANCE_CACHE_LINE;
+	else if (distance < 4096)
+		i = DISTANCE_PAGE;
+	else if (distance < 16 * 1024)
+		i = DISTANCE_BLOCK;
+	else
+		i = DISTANCE_FAR;
+	++count_reference_distance [i];
+}
+
 void
 sgen_object_layout_dump (FILE *out)
 {
@@ -57,6 +93,8 @@ sgen_object_layout_dump (FILE *out)
 	fprintf (out, "bitmap-overflow %lu\n", count_bitmap_overflow);
 	fprintf (out, "ref-array %lu\n", count_ref_array);
 	fprintf (out, "vtype-array %lu\n", count_vtype_array);
+	for (i = 0; i < NUM_DISTANCES; ++i)
+		fprintf (out, "reference-distance-%s %lu\n", distance_names [i], count_reference_distance [i]);
 }
 
 #endif
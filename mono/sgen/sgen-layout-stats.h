@@ -14,6 +14,7 @@ void sgen_object_layout_scanned_bitmap (unsigned int bitmap);
 void sgen_object_layout_scanned_bitmap_overflow (void);
 void sgen_object_layout_scanned_ref_array (void);
 void sgen_object_layout_scanned_vtype_array (void);
+void sgen_object_layout_scanned_reference (void *obj, void *ref);
 
 void sgen_object_layout_dump (FILE *out);
 
@@ -31,6 +32,7 @@ void sgen_object_layout_dump (FILE *out);
 		else							\
 			sgen_object_layout_scanned_bitmap (__object_layout_bitmap); \
 	} while (0)
+#define SGEN_OBJECT_LAYOUT_STATISTICS_MARK_DISTANCE(o,r)	sgen_object_layout_scanned_reference ((o), (r))
 
 #else
 
@@ -38,12 +40,14 @@ void sgen_object_layout_dump (FILE *out);
 #define sgen_object_layout_scanned_bitmap_overflow()
 #define sgen_object_layout_scanned_ref_array()
 #define sgen_object_layout_scanned_vtype_array()
+#define sgen_object_layout_scanned_reference(obj,ref)
 
 #define sgen_object_layout_dump(out)
 
 #define SGEN_OBJECT_LAYOUT_STATISTICS_DECLARE_BITMAP
 #define SGEN_OBJECT_LAYOUT_STATISTICS_MARK_BITMAP(o,p)
 #define SGEN_OBJECT_LAYOUT_STATISTICS_COMMIT_BITMAP
+#define SGEN_OBJECT_LAYOUT_STATISTICS_MARK_DISTANCE(o,r)
 
 #endif
 
@@ -47,11 +47,29 @@
 #define LOS_SECTION_FOR_OBJ(obj)	((LOSSection*)((mword)(obj) & ~(mword)(LOS_SECTION_SIZE - 1)))
 #define LOS_CHUNK_INDEX(obj,section)	(((char*)(obj) - (char*)(section)) >> LOS_CHUNK_BITS)
 
-#define LOS_NUM_FAST_SIZES		32
+/*
+ * There is one free list for each possible number of chunks in a free run, so taking the
+ * first run from the first non-empty list that's big enough is a best fit.
+ */
+#define LOS_NUM_FREE_LISTS		(LOS_SECTION_NUM_CHUNKS + 1)
+
+/*
+ * With `los-compaction`, sections with fewer than 1/LOS_EVACUATION_OCCUPANCY_DIVISOR of
+ * their chunks in use are evacuated in non-concurrent major collections.
+ */
+#define LOS_EVACUATION_OCCUPANCY_DIVISOR	4
+
+/* Set in `LOSObject.size` for objects that must never be moved. */
+#define LOS_OBJECT_UNMOVABLE_BIT	2
 
+/*
+ * Free chunks are coalesced as soon as they're freed, so every maximal run of free
+ * chunks in a section is exactly one `LOSFreeChunks`, which lives in its first chunk.
+ */
 typedef struct _LOSFreeChunks LOSFreeChunks;
 struct _LOSFreeChunks {
 	LOSFreeChunks *next_size;
+	LOSFreeChunks *prev_size;
 	size_t size;
 };
 
@@ -60,6 +78,11 @@ struct _LOSSection {
 	LOSSection *next;
 	size_t num_free_chunks;
 	unsigned char *free_chunk_map;
+	/*
+	 * The free chunks of evacuating sections are not on the free lists, so that we
+	 * don't allocate the evacuated objects' copies in them.  Sweep puts them back.
+	 */
+	gboolean evacuating;
 };
 
 /* We allow read only access on the list while sweep is not running */
@@ -70,9 +93,17 @@ mword los_memory_usage = 0;
 mword los_memory_usage_total = 0;
 
 static LOSSection *los_sections = NULL;
-static LOSFreeChunks *los_fast_free_lists [LOS_NUM_FAST_SIZES]; /* 0 is for larger sizes */
+static LOSFreeChunks *los_free_lists [LOS_NUM_FREE_LISTS]; /* 0 is unused */
 static mword los_num_objects = 0;
 static int los_num_sections = 0;
+static gboolean los_evacuating = FALSE;
+
+/* Free memory in LOS sections, and how much of it is not in the largest free run of its section.  Updated by sweep. */
+guint64 stat_los_section_free_bytes = 0;
+guint64 stat_los_section_fragmented_bytes = 0;
+guint64 stat_los_sections_alloced = 0;
+guint64 stat_los_sections_freed = 0;
+guint64 stat_los_objects_evacuated = 0;
 
 //#define USE_MALLOC
 //#define LOS_CONSISTENCY_CHECK
@@ -88,7 +119,7 @@ static int los_segment_index = 0;
 mword
 sgen_los_object_size (LOSObject *obj)
 {
-	return obj->size & ~1L;
+	return obj->size & ~(mword)(1 | LOS_OBJECT_UNMOVABLE_BIT);
 }
 
 #ifdef LOS_CONSISTENCY_CHECK
@@ -102,7 +133,7 @@ los_consistency_check (void)
 
 	for (obj = los_object_list; obj; obj = obj->next) {
 		mword obj_size = sgen_los_object_size (obj);
-		char *end = obj->data + obj_size;
+		char *end = (char*)obj->data + obj_size;
 		int start_index, num_chunks;
 
 		memory_usage += obj_size;
@@ -120,21 +151,26 @@ los_consistency_check (void)
 			g_assert (!section->free_chunk_map [i]);
 	}
 
-	for (i = 0; i < LOS_NUM_FAST_SIZES; ++i) {
-		LOSFreeChunks *size_chunks;
-		for (size_chunks = los_fast_free_lists [i]; size_chunks; size_chunks = size_chunks->next_size) {
+	g_assert (!los_free_lists [0]);
+	for (i = 1; i < LOS_NUM_FREE_LISTS; ++i) {
+		LOSFreeChunks *size_chunks, *prev = NULL;
+		for (size_chunks = los_free_lists [i]; size_chunks; size_chunks = size_chunks->next_size) {
 			LOSSection *section = LOS_SECTION_FOR_OBJ (size_chunks);
 			int j, num_chunks, start_index;
 
-			if (i == 0)
-				g_assert (size_chunks->size >= LOS_NUM_FAST_SIZES * LOS_CHUNK_SIZE);
-			else
-				g_assert (size_chunks->size == i * LOS_CHUNK_SIZE);
+			g_assert (size_chunks->size == i * LOS_CHUNK_SIZE);
+			g_assert (size_chunks->prev_size == prev);
 
 			num_chunks = size_chunks->size >> LOS_CHUNK_BITS;
 			start_index = LOS_CHUNK_INDEX (size_chunks, section);
 			for (j = start_index; j < start_index + num_chunks; ++j)
 				g_assert (section->free_chunk_map [j]);
+
+			/* Free runs must be maximal. */
+			g_assert (!section->free_chunk_map [start_index - 1]);
+			g_assert (start_index + num_chunks > LOS_SECTION_NUM_CHUNKS || !section->free_chunk_map [start_index + num_chunks]);
+
+			prev = size_chunks;
 		}
 	}
 
@@ -147,41 +183,53 @@ add_free_chunk (LOSFreeChunks *free_chunks, size_t size)
 {
 	size_t num_chunks = size >> LOS_CHUNK_BITS;
 
+	g_assert (num_chunks > 0 && num_chunks < LOS_NUM_FREE_LISTS);
+
 	free_chunks->size = size;
+	free_chunks->prev_size = NULL;
+	free_chunks->next_size = los_free_lists [num_chunks];
+	if (free_chunks->next_size)
+		free_chunks->next_size->prev_size = free_chunks;
+	los_free_lists [num_chunks] = free_chunks;
+}
 
-	if (num_chunks >= LOS_NUM_FAST_SIZES)
-		num_chunks = 0;
-	free_chunks->next_size = los_fast_free_lists [num_chunks];
-	los_fast_free_lists [num_chunks] = free_chunks;
+static void
+remove_free_chunk (LOSFreeChunks *free_chunks)
+{
+	if (free_chunks->prev_size)
+		free_chunks->prev_size->next_size = free_chunks->next_size;
+	else
+		los_free_lists [free_chunks->size >> LOS_CHUNK_BITS] = free_chunks->next_size;
+	if (free_chunks->next_size)
+		free_chunks->next_size->prev_size = free_chunks->prev_size;
 }
 
 static LOSFreeChunks*
-get_from_size_list (LOSFreeChunks **list, size_t size)
+get_from_size_lists (size_t size)
 {
 	LOSFreeChunks *free_chunks = NULL;
 	LOSSection *section;
 	size_t i, num_chunks, start_index;
 
-
 	g_assert ((size & (LOS_CHUNK_SIZE - 1)) == 0);
 
-	while (*list) {
-		free_chunks = *list;
-		if (free_chunks->size >= size)
+	num_chunks = size >> LOS_CHUNK_BITS;
+
+	for (i = num_chunks; i < LOS_NUM_FREE_LISTS; ++i) {
+		free_chunks = los_free_lists [i];
+		if (free_chunks)
 			break;
-		list = &(*list)->next_size;
 	}
 
-	if (!*list)
+	if (!free_chunks)
 		return NULL;
 
-	*list = free_chunks->next_size;
+	remove_free_chunk (free_chunks);
 
+	/* The chunk after the run is in use, so the remainder doesn't need coalescing. */
 	if (free_chunks->size > size)
 		add_free_chunk ((LOSFreeChunks*)((char*)free_chunks + size), free_chunks->size - size);
 
-	num_chunks = size >> LOS_CHUNK_BITS;
-
 	section = LOS_SECTION_FOR_OBJ (free_chunks);
 
 	start_index = LOS_CHUNK_INDEX (free_chunks, section);
@@ -231,19 +279,7 @@ get_los_section_memory (size_t size)
 	g_assert (num_chunks > 0);
 
  retry:
-	if (num_chunks >= LOS_NUM_FAST_SIZES) {
-		free_chunks = get_from_size_list (&los_fast_free_lists [0], size);
-	} else {
-		size_t i;
-		for (i = num_chunks; i < LOS_NUM_FAST_SIZES; ++i) {
-			free_chunks = get_from_size_list (&los_fast_free_lists [i], size);
-			if (free_chunks)
-				break;
-		}
-		if (!free_chunks)
-			free_chunks = get_from_size_list (&los_fast_free_lists [0], size);
-	}
-
+	free_chunks = get_from_size_lists (size);
 	if (free_chunks) {
 		return randomize_los_object_start (free_chunks, obj_size, size, LOS_CHUNK_SIZE);
 	}
@@ -256,14 +292,12 @@ get_los_section_memory (size_t size)
 	if (!section)
 		return NULL;
 
-	free_chunks = (LOSFreeChunks*)((char*)section + LOS_CHUNK_SIZE);
-	free_chunks->size = LOS_SECTION_SIZE - LOS_CHUNK_SIZE;
-	free_chunks->next_size = los_fast_free_lists [0];
-	los_fast_free_lists [0] = free_chunks;
+	add_free_chunk ((LOSFreeChunks*)((char*)section + LOS_CHUNK_SIZE), LOS_SECTION_SIZE - LOS_CHUNK_SIZE);
 
 	section->num_free_chunks = LOS_SECTION_NUM_CHUNKS;
 
 	section->free_chunk_map = (unsigned char*)section + sizeof (LOSSection);
+	section->evacuating = FALSE;
 	g_assert (sizeof (LOSSection) + LOS_SECTION_NUM_CHUNKS + 1 <= LOS_CHUNK_SIZE);
 	section->free_chunk_map [0] = 0;
 	memset (section->free_chunk_map + 1, 1, LOS_SECTION_NUM_CHUNKS);
@@ -273,6 +307,7 @@ get_los_section_memory (size_t size)
 
 	los_memory_usage_total += LOS_SECTION_SIZE;
 	++los_num_sections;
+	++stat_los_sections_alloced;
 
 	goto retry;
 }
@@ -281,7 +316,7 @@ static void
 free_los_section_memory (LOSObject *obj, size_t size)
 {
 	LOSSection *section = LOS_SECTION_FOR_OBJ (obj);
-	size_t num_chunks, i, start_index;
+	size_t num_chunks, i, start_index, end_index;
 
 	size = SGEN_ALIGN_UP_TO (size, LOS_CHUNK_SIZE);
 
@@ -295,17 +330,34 @@ free_los_section_memory (LOSObject *obj, size_t size)
 
 	/*
 	 * We could free the LOS section here if it's empty, but we
-	 * can't unless we also remove its free chunks from the fast
-	 * free lists.  Instead, we do it in los_sweep().
+	 * leave that to los_sweep(), which also decides whether to
+	 * keep it around for future allocations.
 	 */
 
 	start_index = LOS_CHUNK_INDEX (obj, section);
-	for (i = start_index; i < start_index + num_chunks; ++i) {
+	end_index = start_index + num_chunks;
+	for (i = start_index; i < end_index; ++i) {
 		g_assert (!section->free_chunk_map [i]);
 		section->free_chunk_map [i] = 1;
 	}
 
-	add_free_chunk ((LOSFreeChunks*)SGEN_ALIGN_DOWN_TO ((mword)obj, LOS_CHUNK_SIZE), size);
+	if (section->evacuating)
+		return;
+
+	/* Coalesce with the free runs right after and right before us. */
+	if (end_index <= LOS_SECTION_NUM_CHUNKS && section->free_chunk_map [end_index]) {
+		LOSFreeChunks *next = (LOSFreeChunks*)((char*)section + (end_index << LOS_CHUNK_BITS));
+		end_index += next->size >> LOS_CHUNK_BITS;
+		remove_free_chunk (next);
+	}
+	if (section->free_chunk_map [start_index - 1]) {
+		/* The first chunk holds the section header, so it's never free. */
+		while (section->free_chunk_map [start_index - 1])
+			--start_index;
+		remove_free_chunk ((LOSFreeChunks*)((char*)section + (start_index << LOS_CHUNK_BITS)));
+	}
+
+	add_free_chunk ((LOSFreeChunks*)((char*)section + (start_index << LOS_CHUNK_BITS)), (end_index - start_index) << LOS_CHUNK_BITS);
 }
 
 void
@@ -435,6 +487,8 @@ sgen_los_sweep (void)
 	LOSSection *section, *prev;
 	int i;
 	int num_sections = 0;
+	gboolean kept_empty_section = FALSE;
+	guint64 free_bytes = 0, fragmented_bytes = 0;
 
 	/* sweep the big objects list */
 	prevbo = NULL;
@@ -466,55 +520,82 @@ sgen_los_sweep (void)
 		bigobj = bigobj->next;
 	}
 
-	/* Try to free memory */
-	for (i = 0; i < LOS_NUM_FAST_SIZES; ++i)
-		los_fast_free_lists [i] = NULL;
-
+	/*
+	 * Try to free memory.  We keep one empty section, so that a program that keeps
+	 * allocating and dropping large objects doesn't map and unmap a section for every
+	 * major collection.
+	 */
 	prev = NULL;
 	section = los_sections;
 	while (section) {
-		if (section->num_free_chunks == LOS_SECTION_NUM_CHUNKS) {
+		size_t largest_run = 0;
+
+		if (section->evacuating) {
+			for (i = 1; i <= LOS_SECTION_NUM_CHUNKS; ++i) {
+				if (section->free_chunk_map [i]) {
+					int j;
+					for (j = i + 1; j <= LOS_SECTION_NUM_CHUNKS && section->free_chunk_map [j]; ++j)
+						;
+					add_free_chunk ((LOSFreeChunks*)((char*)section + (i << LOS_CHUNK_BITS)), (j - i) << LOS_CHUNK_BITS);
+					i = j - 1;
+				}
+			}
+			section->evacuating = FALSE;
+		}
+
+		if (section->num_free_chunks == LOS_SECTION_NUM_CHUNKS && kept_empty_section) {
 			LOSSection *next = section->next;
 			if (prev)
 				prev->next = next;
 			else
 				los_sections = next;
+			remove_free_chunk ((LOSFreeChunks*)((char*)section + LOS_CHUNK_SIZE));
 			sgen_free_os_memory (section, LOS_SECTION_SIZE, SGEN_ALLOC_HEAP);
 			sgen_memgov_release_space (LOS_SECTION_SIZE, SPACE_LOS);
 			section = next;
 			--los_num_sections;
+			++stat_los_sections_freed;
 			los_memory_usage_total -= LOS_SECTION_SIZE;
 			continue;
 		}
 
-		for (i = 0; i <= LOS_SECTION_NUM_CHUNKS; ++i) {
+		if (section->num_free_chunks == LOS_SECTION_NUM_CHUNKS)
+			kept_empty_section = TRUE;
+
+		for (i = 1; i <= LOS_SECTION_NUM_CHUNKS; ++i) {
 			if (section->free_chunk_map [i]) {
-				int j;
-				for (j = i + 1; j <= LOS_SECTION_NUM_CHUNKS && section->free_chunk_map [j]; ++j)
-					;
-				add_free_chunk ((LOSFreeChunks*)((char*)section + (i << LOS_CHUNK_BITS)), (j - i) << LOS_CHUNK_BITS);
-				i = j - 1;
+				LOSFreeChunks *free_chunks = (LOSFreeChunks*)((char*)section + (i << LOS_CHUNK_BITS));
+				largest_run = MAX (largest_run, free_chunks->size);
+				i += (free_chunks->size >> LOS_CHUNK_BITS) - 1;
 			}
 		}
 
+		free_bytes += section->num_free_chunks << LOS_CHUNK_BITS;
+		fragmented_bytes += (section->num_free_chunks << LOS_CHUNK_BITS) - largest_run;
+
 		prev = section;
 		section = section->next;
 
 		++num_sections;
 	}
 
+	stat_los_section_free_bytes = free_bytes;
+	stat_los_section_fragmented_bytes = fragmented_bytes;
+	los_evacuating = FALSE;
+
 #ifdef LOS_CONSISTENCY_CHECK
 	los_consistency_check ();
 #endif
 
 	/*
 	g_print ("LOS sections: %d  objects: %d  usage: %d\n", num_sections, los_num_objects, los_memory_usage);
-	for (i = 0; i < LOS_NUM_FAST_SIZES; ++i) {
+	for (i = 1; i < LOS_NUM_FREE_LISTS; ++i) {
 		int num_chunks = 0;
 		LOSFreeChunks *free_chunks;
-		for (free_chunks = los_fast_free_lists [i]; free_chunks; free_chunks = free_chunks->next_size)
+		for (free_chunks = los_free_lists [i]; free_chunks; free_chunks = free_chunks->next_size)
 			++num_chunks;
-		g_print ("  %d: %d\n", i, num_chunks);
+		if (num_chunks)
+			g_print ("  %d: %d\n", i, num_chunks);
 	}
 	*/
 
@@ -545,8 +626,12 @@ sgen_los_iterate_objects (IterateObjectCallbackFunc cb, void *user_data)
 {
 	LOSObject *obj;
 
-	for (obj = los_object_list; obj; obj = obj->next)
+	for (obj = los_object_list; obj; obj = obj->next) {
+		/* Evacuated objects are only in the list until sweep frees them. */
+		if (SGEN_OBJECT_IS_FORWARDED (obj->data))
+			continue;
 		cb (obj->data, sgen_los_object_size (obj), user_data);
+	}
 }
 
 gboolean
@@ -624,15 +709,19 @@ get_cardtable_mod_union_for_object (LOSObject *obj)
 }
 
 void
-sgen_los_scan_card_table (CardTableScanType scan_type, ScanCopyContext ctx)
+sgen_los_scan_card_table (CardTableScanType scan_type, ScanCopyContext ctx, int job_index, int job_split_count)
 {
 	LOSObject *obj;
+	int i = 0;
 
 	binary_protocol_los_card_table_scan_start (sgen_timestamp (), scan_type & CARDTABLE_SCAN_MOD_UNION);
-	for (obj = los_object_list; obj; obj = obj->next) {
+	for (obj = los_object_list; obj; obj = obj->next, ++i) {
 		mword num_cards = 0;
 		guint8 *cards;
 
+		if (i % job_split_count != job_index)
+			continue;
+
 		if (!SGEN_OBJECT_HAS_REFERENCES (obj->data))
 			continue;
 
@@ -672,7 +761,6 @@ sgen_los_count_cards (long long *num_total_cards, long long *num_marked_cards)
 	long long marked_cards = 0;
 
 	for (obj = los_object_list; obj; obj = obj->next) {
-		int i;
 		guint8 *cards = sgen_card_table_get_card_scan_address ((mword) obj->data);
 		guint8 *cards_end = sgen_card_table_get_card_scan_address ((mword) obj->data + sgen_los_object_size (obj) - 1);
 		mword num_cards = (cards_end - cards) + 1;
@@ -681,10 +769,7 @@ sgen_los_count_cards (long long *num_total_cards, long long *num_marked_cards)
 			continue;
 
 		total_cards += num_cards;
-		for (i = 0; i < num_cards; ++i) {
-			if (cards [i])
-				++marked_cards;
-		}
+		marked_cards += sgen_card_table_count_marked_cards (cards, num_cards);
 	}
 
 	*num_total_cards = total_cards;
@@ -722,11 +807,151 @@ sgen_los_pin_object (GCObject *data)
 	binary_protocol_pin (data, (gpointer)SGEN_LOAD_VTABLE (data), sgen_safe_object_get_size (data));
 }
 
+/*
+ * Like `sgen_los_pin_object ()`, but can be called by several threads at once.  Returns
+ * whether we pinned the object, i.e., whether it wasn't pinned already.
+ */
+gboolean
+sgen_los_pin_object_par (GCObject *data)
+{
+	LOSObject *obj = sgen_los_header_for_object (data);
+	mword old_size = obj->size;
+
+	if (old_size & 1)
+		return FALSE;
+	/* Only the pin bit can change under our feet. */
+	if (SGEN_CAS_PTR ((gpointer*)&obj->size, (gpointer)(old_size | 1), (gpointer)old_size) != (gpointer)old_size)
+		return FALSE;
+
+	binary_protocol_pin (data, (gpointer)SGEN_LOAD_VTABLE (data), sgen_safe_object_get_size (data));
+	return TRUE;
+}
+
 static void
 sgen_los_unpin_object (GCObject *data)
 {
 	LOSObject *obj = sgen_los_header_for_object (data);
-	obj->size = sgen_los_object_size (obj);
+	obj->size &= ~(mword)1;
+}
+
+/*
+ * Objects that are allocated pinned must stay where they are even when their section is
+ * evacuated.
+ */
+void
+sgen_los_set_object_unmovable (GCObject *data)
+{
+	LOSObject *obj = sgen_los_header_for_object (data);
+	obj->size |= LOS_OBJECT_UNMOVABLE_BIT;
+}
+
+/*
+ * Picks the sections to evacuate in this collection.  Must be called with the world
+ * stopped at the start of a non-concurrent major collection, before anything is marked.
+ *
+ * We only evacuate as many sparse sections as the free chunks of the other sections can
+ * take, so compacting shouldn't have to map new sections.
+ */
+void
+sgen_los_start_evacuation (void)
+{
+	LOSSection *section;
+	size_t num_free_chunks = 0, num_moved_chunks = 0;
+	int i;
+
+	SGEN_ASSERT (0, !los_evacuating, "Why are we evacuating again?");
+
+	for (section = los_sections; section; section = section->next) {
+		size_t num_used_chunks = LOS_SECTION_NUM_CHUNKS - section->num_free_chunks;
+		if (!num_used_chunks || num_used_chunks * LOS_EVACUATION_OCCUPANCY_DIVISOR >= LOS_SECTION_NUM_CHUNKS)
+			num_free_chunks += section->num_free_chunks;
+	}
+
+	for (section = los_sections; section; section = section->next) {
+		size_t num_used_chunks = LOS_SECTION_NUM_CHUNKS - section->num_free_chunks;
+		if (!num_used_chunks || num_used_chunks * LOS_EVACUATION_OCCUPANCY_DIVISOR >= LOS_SECTION_NUM_CHUNKS)
+			continue;
+		if (num_moved_chunks + num_used_chunks > num_free_chunks)
+			break;
+		num_moved_chunks += num_used_chunks;
+
+		for (i = 1; i <= LOS_SECTION_NUM_CHUNKS; ++i) {
+			if (section->free_chunk_map [i]) {
+				LOSFreeChunks *free_chunks = (LOSFreeChunks*)((char*)section + (i << LOS_CHUNK_BITS));
+				remove_free_chunk (free_chunks);
+				i += (free_chunks->size >> LOS_CHUNK_BITS) - 1;
+			}
+		}
+		section->evacuating = TRUE;
+		los_evacuating = TRUE;
+	}
+}
+
+gboolean
+sgen_los_is_evacuating (void)
+{
+	return los_evacuating;
+}
+
+/*
+ * Whether `data`, which must not be marked yet, should be moved out of its section.
+ */
+gboolean
+sgen_los_object_should_evacuate (GCObject *data)
+{
+	LOSObject *obj;
+
+	if (!los_evacuating)
+		return FALSE;
+
+	obj = sgen_los_header_for_object (data);
+	if (obj->size & LOS_OBJECT_UNMOVABLE_BIT)
+		return FALSE;
+	if (sgen_los_object_size (obj) > LOS_SECTION_OBJECT_LIMIT)
+		return FALSE;
+
+	return LOS_SECTION_FOR_OBJ (obj)->evacuating;
+}
+
+/*
+ * Copies `data` to a section that's not being evacuated, marks the copy and forwards
+ * `data` to it.  The old object is freed by sweep, like any other unmarked object.
+ * Returns NULL if we can't get the memory, in which case the object must be marked in
+ * place.
+ */
+GCObject*
+sgen_los_evacuate_object (GCObject *data)
+{
+	LOSObject *obj = sgen_los_header_for_object (data);
+	mword size = sgen_los_object_size (obj);
+	GCVTable vt = SGEN_LOAD_VTABLE (data);
+	LOSObject *new_obj;
+
+	SGEN_ASSERT (0, !sgen_los_object_is_pinned (data), "Why are we evacuating a marked object?");
+
+	new_obj = get_los_section_memory (size + sizeof (LOSObject));
+	if (!new_obj)
+		return NULL;
+
+	SGEN_ASSERT (0, !LOS_SECTION_FOR_OBJ (new_obj)->evacuating, "Why did we get memory from an evacuating section?");
+
+	new_obj->cardtable_mod_union = NULL;
+	new_obj->size = size | 1;
+
+	sgen_client_pre_copy_checks ((char*)new_obj->data, vt, data, size);
+	binary_protocol_copy (data, new_obj->data, vt, size);
+	memcpy (new_obj->data, data, size);
+	sgen_client_update_copied_object ((char*)new_obj->data, vt, data, size);
+
+	new_obj->next = los_object_list;
+	los_object_list = new_obj;
+	los_memory_usage += size;
+	los_num_objects++;
+	++stat_los_objects_evacuated;
+
+	SGEN_FORWARD_OBJECT (data, new_obj->data);
+
+	return new_obj->data;
 }
 
 gboolean
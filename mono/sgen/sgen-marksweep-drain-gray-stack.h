@@ -17,9 +17,21 @@
  * DRAIN_GRAY_STACK_FUNCTION_NAME must be defined to be the function name of the gray stack
  * draining function.
  *
+ * DRAIN_GRAY_STACK_PREFETCH_FUNCTION_NAME can be defined to be the function name of a gray
+ * stack draining function that prefetches objects a few iterations before scanning them.
+ *
  * Define COPY_OR_MARK_WITH_EVACUATION to support evacuation.
+ *
+ * Define COPY_OR_MARK_PARALLEL, together with one of the concurrent variants, if several
+ * workers mark at the same time.  Mark bits and LOS pin bits are then set atomically.
  */
 
+#ifdef COPY_OR_MARK_PARALLEL
+#define MARK_OBJECT_AND_ENQUEUE MS_MARK_OBJECT_AND_ENQUEUE_PAR
+#else
+#define MARK_OBJECT_AND_ENQUEUE MS_MARK_OBJECT_AND_ENQUEUE
+#endif
+
 /* Returns whether the object is still in the nursery. */
 static inline MONO_ALWAYS_INLINE gboolean
 COPY_OR_MARK_FUNCTION_NAME (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
@@ -173,15 +185,32 @@ COPY_OR_MARK_FUNCTION_NAME (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
 			}
 #endif
 
-			MS_MARK_OBJECT_AND_ENQUEUE (obj, desc, block, queue);
+			MARK_OBJECT_AND_ENQUEUE (obj, desc, block, queue);
 		} else {
 			HEAVY_STAT (++stat_optimized_copy_major_large);
 
+#ifdef COPY_OR_MARK_WITH_EVACUATION
+			if (G_UNLIKELY (sgen_los_object_should_evacuate (obj)) && !sgen_los_object_is_pinned (obj)) {
+				GCObject *new_obj = sgen_los_evacuate_object (obj);
+				if (new_obj) {
+					SGEN_UPDATE_REFERENCE (ptr, new_obj);
+					if (SGEN_OBJECT_HAS_REFERENCES (new_obj))
+						GRAY_OBJECT_ENQUEUE (queue, new_obj, sgen_obj_get_descriptor (new_obj));
+					return FALSE;
+				}
+			}
+#endif
+
+#ifdef COPY_OR_MARK_PARALLEL
+			if (!sgen_los_pin_object_par (obj))
+				return FALSE;
+#else
 			if (sgen_los_object_is_pinned (obj))
 				return FALSE;
 			binary_protocol_pin (obj, (gpointer)SGEN_LOAD_VTABLE (obj), sgen_safe_object_get_size (obj));
 
 			sgen_los_pin_object (obj);
+#endif
 			if (SGEN_OBJECT_HAS_REFERENCES (obj))
 				GRAY_OBJECT_ENQUEUE (queue, obj, sgen_obj_get_descriptor (obj));
 		}
@@ -191,10 +220,19 @@ COPY_OR_MARK_FUNCTION_NAME (GCObject **ptr, GCObject *obj, SgenGrayQueue *queue)
 	return TRUE;
 }
 
+/* Only non-concurrent collections copy in hierarchical order, see sgen-gray.h. */
+#undef HIERARCHICAL_COPY_DECLARE
+#if defined(COPY_OR_MARK_CONCURRENT) || defined(COPY_OR_MARK_CONCURRENT_WITH_EVACUATION)
+#define HIERARCHICAL_COPY_DECLARE
+#else
+#define HIERARCHICAL_COPY_DECLARE	SGEN_HIERARCHICAL_COPY_DECLARE
+#endif
+
 static void
 SCAN_OBJECT_FUNCTION_NAME (GCObject *full_object, SgenDescriptor desc, SgenGrayQueue *queue)
 {
 	char *start = (char*)full_object;
+	HIERARCHICAL_COPY_DECLARE;
 
 #ifdef HEAVY_STATISTICS
 	++stat_optimized_major_scan;
@@ -213,6 +251,7 @@ SCAN_OBJECT_FUNCTION_NAME (GCObject *full_object, SgenDescriptor desc, SgenGrayQ
 #define HANDLE_PTR(ptr,obj)	do {					\
 		GCObject *__old = *(ptr);				\
 		binary_protocol_scan_process_reference ((full_object), (ptr), __old); \
+		SGEN_OBJECT_LAYOUT_STATISTICS_MARK_DISTANCE ((full_object), __old); \
 		if (__old && !sgen_ptr_in_nursery (__old)) {            \
 			if (G_UNLIKELY (!sgen_ptr_in_nursery (ptr) &&	\
 					sgen_safe_object_is_small (__old, sgen_obj_get_descriptor (__old) & DESC_TYPE_MASK) && \
@@ -231,6 +270,7 @@ SCAN_OBJECT_FUNCTION_NAME (GCObject *full_object, SgenDescriptor desc, SgenGrayQ
 #define HANDLE_PTR(ptr,obj)	do {					\
 		GCObject *__old = *(ptr);				\
 		binary_protocol_scan_process_reference ((full_object), (ptr), __old); \
+		SGEN_OBJECT_LAYOUT_STATISTICS_MARK_DISTANCE ((full_object), __old); \
 		if (__old && !sgen_ptr_in_nursery (__old)) {            \
 			PREFETCH_READ (__old);			\
 			COPY_OR_MARK_FUNCTION_NAME ((ptr), __old, queue); \
@@ -243,12 +283,14 @@ SCAN_OBJECT_FUNCTION_NAME (GCObject *full_object, SgenDescriptor desc, SgenGrayQ
 #define HANDLE_PTR(ptr,obj)	do {					\
 		GCObject *__old = *(ptr);					\
 		binary_protocol_scan_process_reference ((full_object), (ptr), __old); \
+		SGEN_OBJECT_LAYOUT_STATISTICS_MARK_DISTANCE ((full_object), __old); \
 		if (__old) {						\
 			gboolean __still_in_nursery = COPY_OR_MARK_FUNCTION_NAME ((ptr), __old, queue); \
 			if (G_UNLIKELY (__still_in_nursery && !sgen_ptr_in_nursery ((ptr)) && !SGEN_OBJECT_IS_CEMENTED (*(ptr)))) { \
 				GCObject *__copy = *(ptr);			\
 				sgen_add_to_global_remset ((ptr), __copy); \
 			}						\
+			SGEN_HIERARCHICAL_COPY_CHILD (*(ptr), __old, queue, SCAN_OBJECT_FUNCTION_NAME); \
 		}							\
 	} while (0)
 #endif
@@ -262,6 +304,7 @@ static void
 SCAN_VTYPE_FUNCTION_NAME (GCObject *full_object, char *start, SgenDescriptor desc, SgenGrayQueue *queue BINARY_PROTOCOL_ARG (size_t size))
 {
 	SGEN_OBJECT_LAYOUT_STATISTICS_DECLARE_BITMAP;
+	HIERARCHICAL_COPY_DECLARE;
 
 #ifdef HEAVY_STATISTICS
 	/* FIXME: We're half scanning this object.  How do we account for that? */
@@ -284,6 +327,8 @@ SCAN_VTYPE_FUNCTION_NAME (GCObject *full_object, char *start, SgenDescriptor des
 static void
 SCAN_PTR_FIELD_FUNCTION_NAME (GCObject *full_object, GCObject **ptr, SgenGrayQueue *queue)
 {
+	HIERARCHICAL_COPY_DECLARE;
+
 	HANDLE_PTR (ptr, NULL);
 }
 #endif
@@ -311,11 +356,75 @@ DRAIN_GRAY_STACK_FUNCTION_NAME (SgenGrayQueue *queue)
 	return FALSE;
 }
 
+#ifdef DRAIN_GRAY_STACK_PREFETCH_FUNCTION_NAME
+/*
+ * Objects go through a small FIFO on their way from the gray stack to being scanned.  We
+ * prefetch an object when it enters the FIFO, so by the time we scan it, after
+ * MS_MARK_PREFETCH_DISTANCE other objects, its header is hopefully in the cache.  Objects
+ * in the gray stack are already marked, so there's no point in prefetching their mark
+ * words, too.
+ */
+static gboolean
+DRAIN_GRAY_STACK_PREFETCH_FUNCTION_NAME (SgenGrayQueue *queue)
+{
+	GrayQueueEntry fifo [MS_MARK_PREFETCH_DISTANCE];
+	int fifo_start = 0, fifo_size = 0;
+#if defined(COPY_OR_MARK_CONCURRENT) || defined(COPY_OR_MARK_CONCURRENT_WITH_EVACUATION)
+	int i;
+	for (i = 0; i < 32; i++) {
+#else
+	for (;;) {
+#endif
+		GrayQueueEntry entry;
+
+		HEAVY_STAT (++stat_drain_loops);
+
+		while (fifo_size < MS_MARK_PREFETCH_DISTANCE) {
+			GCObject *obj;
+			SgenDescriptor desc;
+
+			GRAY_OBJECT_DEQUEUE (queue, &obj, &desc);
+			if (!obj) {
+				HEAVY_STAT (++stat_drain_prefetch_fill_failures);
+				break;
+			}
+			HEAVY_STAT (++stat_drain_prefetch_fills);
+
+			PREFETCH_READ (obj);
+			entry.obj = obj;
+			entry.desc = desc;
+			fifo [(fifo_start + fifo_size++) % MS_MARK_PREFETCH_DISTANCE] = entry;
+		}
+
+		if (!fifo_size)
+			return TRUE;
+
+		entry = fifo [fifo_start];
+		fifo_start = (fifo_start + 1) % MS_MARK_PREFETCH_DISTANCE;
+		--fifo_size;
+
+		SCAN_OBJECT_FUNCTION_NAME (entry.obj, entry.desc, queue);
+	}
+
+#if defined(COPY_OR_MARK_CONCURRENT) || defined(COPY_OR_MARK_CONCURRENT_WITH_EVACUATION)
+	/* Put back the objects we haven't scanned yet. */
+	while (fifo_size--) {
+		GrayQueueEntry *entry = &fifo [(fifo_start + fifo_size) % MS_MARK_PREFETCH_DISTANCE];
+		GRAY_OBJECT_ENQUEUE (queue, entry->obj, entry->desc);
+	}
+#endif
+	return FALSE;
+}
+#endif
+
+#undef MARK_OBJECT_AND_ENQUEUE
 #undef COPY_OR_MARK_FUNCTION_NAME
 #undef COPY_OR_MARK_WITH_EVACUATION
+#undef COPY_OR_MARK_PARALLEL
 #undef COPY_OR_MARK_CONCURRENT
 #undef COPY_OR_MARK_CONCURRENT_WITH_EVACUATION
 #undef SCAN_OBJECT_FUNCTION_NAME
 #undef SCAN_VTYPE_FUNCTION_NAME
 #undef SCAN_PTR_FIELD_FUNCTION_NAME
 #undef DRAIN_GRAY_STACK_FUNCTION_NAME
+#undef DRAIN_GRAY_STACK_PREFETCH_FUNCTION_NAME
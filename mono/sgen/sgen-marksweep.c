@@ -31,6 +31,7 @@
 #include "mono/sgen/sgen-thread-pool.h"
 #include "mono/sgen/sgen-client.h"
 #include "mono/utils/mono-memory-model.h"
+#include "mono/utils/mono-tls.h"
 
 #if defined(ARCH_MIN_MS_BLOCK_SIZE) && defined(ARCH_MIN_MS_BLOCK_SIZE_SHIFT)
 #define MS_BLOCK_SIZE	ARCH_MIN_MS_BLOCK_SIZE
@@ -100,6 +101,12 @@ struct _MSBlockInfo {
 	/* FIXME: Reduce this - it only needs a byte. */
 	volatile gint32 state;
 	gint16 nused;
+	/*
+	 * Union of the region tags of the objects allocated in the block, see
+	 * `sgen_client_vtable_get_region_tag ()`.  It's a superset, the tags of
+	 * objects that died are only dropped by `major_iterate_objects_with_tags ()`.
+	 */
+	guint16 region_tags;
 	unsigned int pinned : 1;
 	unsigned int has_references : 1;
 	unsigned int has_pinned : 1;	/* means cannot evacuate */
@@ -139,6 +146,19 @@ typedef struct {
 
 #define MS_MARK_BIT(bl,w,b)	((bl)->mark_words [(w)] & (ONE_P << (b)))
 #define MS_SET_MARK_BIT(bl,w,b)	((bl)->mark_words [(w)] |= (ONE_P << (b)))
+/* Sets `first` to whether we were the ones to set the mark bit. */
+#define MS_SET_MARK_BIT_PAR(bl,w,b,first)	do {			\
+		mword __old_word = (bl)->mark_words [(w)];		\
+		(first) = FALSE;					\
+		while (!(__old_word & (ONE_P << (b)))) {		\
+			mword __prev_word = (mword)SGEN_CAS_PTR ((gpointer*)&(bl)->mark_words [(w)], (gpointer)(__old_word | (ONE_P << (b))), (gpointer)__old_word); \
+			if (__prev_word == __old_word) {		\
+				(first) = TRUE;				\
+				break;					\
+			}						\
+			__old_word = __prev_word;			\
+		}							\
+	} while (0)
 
 #define MS_OBJ_ALLOCED(o,b)	(*(void**)(o) && (*(char**)(o) < MS_BLOCK_FOR_BLOCK_INFO (b) || *(char**)(o) >= MS_BLOCK_FOR_BLOCK_INFO (b) + MS_BLOCK_SIZE))
 
@@ -176,6 +196,8 @@ static volatile int sweep_state = SWEEP_STATE_SWEPT;
 
 static gboolean concurrent_mark;
 static gboolean concurrent_sweep = TRUE;
+static gboolean parallel_sweep = FALSE;
+static gboolean mark_prefetch = FALSE;
 
 #define BLOCK_IS_TAGGED_HAS_REFERENCES(bl)	SGEN_POINTER_IS_TAGGED_1 ((bl))
 #define BLOCK_TAG_HAS_REFERENCES(bl)		SGEN_POINTER_TAG_1 ((bl))
@@ -194,6 +216,29 @@ static SgenArrayList allocated_blocks = SGEN_ARRAY_LIST_INIT (NULL, NULL, NULL,
 static void *empty_blocks = NULL;
 static size_t num_empty_blocks = 0;
 
+/*
+ * Empty blocks whose memory has been given back to the OS, see decommit_empty_blocks ().
+ * They're not linked through their first word, because writing that would commit the
+ * page again.  Protected by `decommitted_blocks_lock`.
+ *
+ * Their address space is never unmapped.  Blocks are mapped in chunks of up to
+ * MS_BLOCK_ALLOC_NUM, which aren't tracked, so we can't tell when all the blocks of a
+ * chunk are decommitted.  The heap's reserved size doesn't shrink with decommitting.
+ */
+static SgenPointerQueue decommitted_blocks = SGEN_POINTER_QUEUE_INIT (INTERNAL_MEM_MS_TABLES);
+static mono_mutex_t decommitted_blocks_lock;
+
+/*
+ * With `decommit` we keep the first `decommit_retained_size` bytes of empty blocks
+ * committed and decommit at most MS_DECOMMIT_BLOCKS_PER_COLLECTION of the others in each
+ * major collection.
+ */
+#define MS_DECOMMIT_BLOCKS_PER_COLLECTION	256
+#define MS_DEFAULT_DECOMMIT_RETAINED_SIZE	(4 * 1024 * 1024)
+
+static gboolean decommit_enabled = FALSE;
+static size_t decommit_retained_size = MS_DEFAULT_DECOMMIT_RETAINED_SIZE;
+
 /*
  * We can iterate the block list also while sweep is in progress but we
  * need to account for blocks that will be checked for sweeping and even
@@ -239,6 +284,9 @@ static MSBlockInfo * volatile *free_block_lists [MS_BLOCK_TYPE_MAX];
 static guint64 stat_major_blocks_alloced = 0;
 static guint64 stat_major_blocks_freed = 0;
 static guint64 stat_major_blocks_lazy_swept = 0;
+static guint64 stat_major_free_blocks_background_swept = 0;
+static guint64 stat_major_blocks_decommitted = 0;
+static guint64 stat_major_blocks_recommitted = 0;
 
 #if SIZEOF_VOID_P != 8
 static guint64 stat_major_blocks_freed_ideal = 0;
@@ -287,6 +335,17 @@ ms_find_block_obj_size_index (size_t size)
 #define FREE_BLOCKS_FROM(lists,p,r)	(lists [((p) ? MS_BLOCK_FLAG_PINNED : 0) | ((r) ? MS_BLOCK_FLAG_REFS : 0)])
 #define FREE_BLOCKS(p,r)		(FREE_BLOCKS_FROM (free_block_lists, (p), (r)))
 
+/*
+ * In parallel nursery collections each worker takes whole blocks off the free lists and
+ * allocates from them without contention.  The blocks that still have free slots are put
+ * back in the free lists when the collection finishes.
+ */
+static MonoNativeTlsKey worker_free_block_lists_key;
+static MSBlockInfo * volatile **worker_free_block_lists [SGEN_THREADPOOL_MAX_NUM_THREADS];
+static volatile gint32 num_worker_free_block_lists;
+/* ms_alloc_block () is not thread safe. */
+static mono_mutex_t worker_alloc_block_lock;
+
 #define MS_BLOCK_OBJ_SIZE_INDEX(s)				\
 	(((s)+7)>>3 < MS_NUM_FAST_BLOCK_OBJ_SIZE_INDEXES ?	\
 	 fast_block_obj_size_indexes [((s)+7)>>3] :		\
@@ -310,6 +369,31 @@ update_heap_boundaries_for_block (MSBlockInfo *block)
 	sgen_update_heap_boundaries ((mword)MS_BLOCK_FOR_BLOCK_INFO (block), (mword)MS_BLOCK_FOR_BLOCK_INFO (block) + MS_BLOCK_SIZE);
 }
 
+/*
+ * Moves up to MS_BLOCK_ALLOC_NUM decommitted blocks back to the empty list.  They are
+ * committed again as soon as they're touched.  Returns whether there were any.
+ */
+static gboolean
+ms_take_decommitted_blocks (void)
+{
+	void *block, *empty;
+	int i;
+
+	mono_os_mutex_lock (&decommitted_blocks_lock);
+	for (i = 0; i < MS_BLOCK_ALLOC_NUM && !sgen_pointer_queue_is_empty (&decommitted_blocks); ++i) {
+		block = sgen_pointer_queue_pop (&decommitted_blocks);
+		do {
+			empty = empty_blocks;
+			*(void**)block = empty;
+		} while (SGEN_CAS_PTR ((gpointer*)&empty_blocks, block, empty) != empty);
+		SGEN_ATOMIC_ADD_P (num_empty_blocks, 1);
+	}
+	mono_os_mutex_unlock (&decommitted_blocks_lock);
+
+	stat_major_blocks_recommitted += i;
+	return i > 0;
+}
+
 /*
  * Thread safe
  */
@@ -321,7 +405,7 @@ ms_get_empty_block (void)
 	void *block, *empty, *next;
 
  retry:
-	if (!empty_blocks) {
+	if (!empty_blocks && !(decommitted_blocks.next_slot && ms_take_decommitted_blocks ())) {
 		/*
 		 * We try allocating MS_BLOCK_ALLOC_NUM blocks first.  If that's
 		 * unsuccessful, we halve the number of blocks and try again, until we're at
@@ -526,6 +610,7 @@ ms_alloc_block (int size_index, gboolean pinned, gboolean has_references)
 	info->pinned = pinned;
 	info->has_references = has_references;
 	info->has_pinned = pinned;
+	info->region_tags = 0;
 	/*
 	 * Blocks that are to-space are not evacuated from.  During an major collection
 	 * blocks are allocated for two reasons: evacuating objects from the nursery and
@@ -669,6 +754,7 @@ alloc_obj (GCVTable vtable, size_t size, gboolean pinned, gboolean has_reference
 	}
 
 	obj = unlink_slot_from_free_list_uncontested (free_blocks, size_index);
+	MS_BLOCK_FOR_OBJ (obj)->region_tags |= sgen_client_vtable_get_region_tag (vtable);
 
 	/* FIXME: assumes object layout */
 	*(GCVTable*)obj = vtable;
@@ -684,6 +770,98 @@ major_alloc_object (GCVTable vtable, size_t size, gboolean has_references)
 	return alloc_obj (vtable, size, FALSE, has_references);
 }
 
+static MSBlockInfo * volatile **
+get_worker_free_block_lists (void)
+{
+	MSBlockInfo * volatile **lists = (MSBlockInfo * volatile **)mono_native_tls_get_value (worker_free_block_lists_key);
+	int i, index;
+
+	if (G_LIKELY (lists))
+		return lists;
+
+	lists = (MSBlockInfo * volatile **)sgen_alloc_internal_dynamic (sizeof (MSBlockInfo * volatile *) * MS_BLOCK_TYPE_MAX, INTERNAL_MEM_MS_TABLES, TRUE);
+	for (i = 0; i < MS_BLOCK_TYPE_MAX; ++i)
+		lists [i] = (MSBlockInfo * volatile *)sgen_alloc_internal_dynamic (sizeof (MSBlockInfo*) * num_block_obj_sizes, INTERNAL_MEM_MS_TABLES, TRUE);
+
+	index = InterlockedIncrement (&num_worker_free_block_lists) - 1;
+	SGEN_ASSERT (0, index < SGEN_THREADPOOL_MAX_NUM_THREADS, "Why are there more workers than thread pool threads?");
+	worker_free_block_lists [index] = lists;
+	mono_native_tls_set_value (worker_free_block_lists_key, lists);
+
+	return lists;
+}
+
+/*
+ * Only workers take blocks off the free lists during parallel nursery collections, and
+ * nobody puts them back until it's over, so the CAS can't suffer from ABA.
+ */
+static GCObject*
+alloc_obj_par (GCVTable vtable, size_t size, gboolean pinned, gboolean has_references)
+{
+	int size_index = MS_BLOCK_OBJ_SIZE_INDEX (size);
+	MSBlockInfo * volatile * free_blocks = FREE_BLOCKS (pinned, has_references);
+	MSBlockInfo * volatile * free_blocks_local = FREE_BLOCKS_FROM (get_worker_free_block_lists (), pinned, has_references);
+	void *obj;
+
+	while (!free_blocks_local [size_index]) {
+		MSBlockInfo *block = free_blocks [size_index];
+
+		if (!block) {
+			gboolean success;
+
+			mono_os_mutex_lock (&worker_alloc_block_lock);
+			success = ms_alloc_block (size_index, pinned, has_references);
+			mono_os_mutex_unlock (&worker_alloc_block_lock);
+
+			if (G_UNLIKELY (!success))
+				return NULL;
+			continue;
+		}
+
+		if (SGEN_CAS_PTR ((volatile gpointer *)&free_blocks [size_index], block->next_free, block) != block)
+			continue;
+
+		block->next_free = NULL;
+		free_blocks_local [size_index] = block;
+	}
+
+	obj = unlink_slot_from_free_list_uncontested (free_blocks_local, size_index);
+	/* The block is on this worker's local free list, so nobody else allocates from it */
+	MS_BLOCK_FOR_OBJ (obj)->region_tags |= sgen_client_vtable_get_region_tag (vtable);
+
+	/* FIXME: assumes object layout */
+	*(GCVTable*)obj = vtable;
+
+	SGEN_ATOMIC_ADD_P (total_allocated_major, block_obj_sizes [size_index]);
+
+	return (GCObject *)obj;
+}
+
+static GCObject*
+major_alloc_object_par (GCVTable vtable, size_t size, gboolean has_references)
+{
+	return alloc_obj_par (vtable, size, FALSE, has_references);
+}
+
+static void
+return_worker_free_blocks (void)
+{
+	int i, j, k;
+
+	for (i = 0; i < num_worker_free_block_lists; ++i) {
+		for (j = 0; j < MS_BLOCK_TYPE_MAX; ++j) {
+			MSBlockInfo * volatile *free_blocks_local = worker_free_block_lists [i][j];
+			for (k = 0; k < num_block_obj_sizes; ++k) {
+				MSBlockInfo *block = free_blocks_local [k];
+				if (!block)
+					continue;
+				free_blocks_local [k] = NULL;
+				add_free_block (free_block_lists [j], k, block);
+			}
+		}
+	}
+}
+
 /*
  * We're not freeing the block if it's empty.  We leave that work for
  * the next major collection.
@@ -895,6 +1073,48 @@ major_iterate_objects (IterateObjectsFlags flags, IterateObjectCallbackFunc call
 	} END_FOREACH_BLOCK_NO_LOCK;
 }
 
+/*
+ * Like `major_iterate_objects ()`, but skips the blocks whose region tags don't
+ * intersect `tags`.  The tags of the visited blocks are recomputed from the
+ * objects left after calling `callback`, which may free them.
+ */
+static void
+major_iterate_objects_with_tags (IterateObjectsFlags flags, guint16 tags, IterateObjectCallbackFunc callback, void *data)
+{
+	gboolean sweep = flags & ITERATE_OBJECTS_SWEEP;
+	gboolean non_pinned = flags & ITERATE_OBJECTS_NON_PINNED;
+	gboolean pinned = flags & ITERATE_OBJECTS_PINNED;
+	MSBlockInfo *block;
+
+	major_finish_sweep_checking ();
+	FOREACH_BLOCK_NO_LOCK (block) {
+		int count = MS_BLOCK_FREE / block->obj_size;
+		guint16 block_tags = 0;
+		int i;
+
+		if (!(block->region_tags & tags))
+			continue;
+		if (block->pinned && !pinned)
+			continue;
+		if (!block->pinned && !non_pinned)
+			continue;
+		if (sweep && lazy_sweep && !block_is_swept_or_marking (block)) {
+			sweep_block (block);
+			SGEN_ASSERT (6, block->state == BLOCK_STATE_SWEPT, "Block must be swept after sweeping");
+		}
+
+		for (i = 0; i < count; ++i) {
+			void **obj = (void**) MS_BLOCK_OBJ (block, i);
+			if (!MS_OBJ_ALLOCED (obj, block))
+				continue;
+			callback ((GCObject*)obj, block->obj_size, data);
+			if (MS_OBJ_ALLOCED (obj, block))
+				block_tags |= sgen_client_vtable_get_region_tag (SGEN_LOAD_VTABLE (obj));
+		}
+		block->region_tags = block_tags;
+	} END_FOREACH_BLOCK_NO_LOCK;
+}
+
 static gboolean
 major_is_valid_object (char *object)
 {
@@ -1092,6 +1312,20 @@ major_block_is_evacuating (MSBlockInfo *block)
 		}							\
 	} while (0)
 
+#define MS_MARK_OBJECT_AND_ENQUEUE_PAR(obj,desc,block,queue) do {	\
+		int __word, __bit;					\
+		gboolean __first;					\
+		MS_CALC_MARK_BIT (__word, __bit, (obj));		\
+		SGEN_ASSERT (9, MS_OBJ_ALLOCED ((obj), (block)), "object %p not allocated", obj); \
+		MS_SET_MARK_BIT_PAR ((block), __word, __bit, __first);	\
+		if (__first) {						\
+			if (sgen_gc_descr_has_references (desc))			\
+				GRAY_OBJECT_ENQUEUE ((queue), (obj), (desc)); \
+			binary_protocol_mark ((obj), (gpointer)SGEN_LOAD_VTABLE ((obj)), sgen_safe_object_get_size ((obj))); \
+			INC_NUM_MAJOR_OBJECTS_MARKED ();		\
+		}							\
+	} while (0)
+
 static void
 pin_major_object (GCObject *obj, SgenGrayQueue *queue)
 {
@@ -1150,9 +1384,16 @@ static guint64 stat_drain_prefetch_fill_failures;
 static guint64 stat_drain_loops;
 #endif
 
+/*
+ * With `mark-prefetch` the gray stack is drained through a FIFO of this many objects.
+ * Each object is prefetched when it enters the FIFO and scanned when it leaves it.
+ */
+#define MS_MARK_PREFETCH_DISTANCE	8
+
 #define COPY_OR_MARK_FUNCTION_NAME	major_copy_or_mark_object_no_evacuation
 #define SCAN_OBJECT_FUNCTION_NAME	major_scan_object_no_evacuation
 #define DRAIN_GRAY_STACK_FUNCTION_NAME	drain_gray_stack_no_evacuation
+#define DRAIN_GRAY_STACK_PREFETCH_FUNCTION_NAME	drain_gray_stack_prefetch_no_evacuation
 #include "sgen-marksweep-drain-gray-stack.h"
 
 #define COPY_OR_MARK_WITH_EVACUATION
@@ -1160,6 +1401,7 @@ static guint64 stat_drain_loops;
 #define SCAN_OBJECT_FUNCTION_NAME	major_scan_object_with_evacuation
 #define SCAN_VTYPE_FUNCTION_NAME	major_scan_vtype_with_evacuation
 #define DRAIN_GRAY_STACK_FUNCTION_NAME	drain_gray_stack_with_evacuation
+#define DRAIN_GRAY_STACK_PREFETCH_FUNCTION_NAME	drain_gray_stack_prefetch_with_evacuation
 #define SCAN_PTR_FIELD_FUNCTION_NAME	major_scan_ptr_field_with_evacuation
 #include "sgen-marksweep-drain-gray-stack.h"
 
@@ -1167,6 +1409,7 @@ static guint64 stat_drain_loops;
 #define COPY_OR_MARK_FUNCTION_NAME	major_copy_or_mark_object_concurrent_no_evacuation
 #define SCAN_OBJECT_FUNCTION_NAME	major_scan_object_concurrent_no_evacuation
 #define DRAIN_GRAY_STACK_FUNCTION_NAME	drain_gray_stack_concurrent_no_evacuation
+#define DRAIN_GRAY_STACK_PREFETCH_FUNCTION_NAME	drain_gray_stack_prefetch_concurrent_no_evacuation
 #include "sgen-marksweep-drain-gray-stack.h"
 
 #define COPY_OR_MARK_CONCURRENT_WITH_EVACUATION
@@ -1175,6 +1418,25 @@ static guint64 stat_drain_loops;
 #define SCAN_VTYPE_FUNCTION_NAME	major_scan_vtype_concurrent_with_evacuation
 #define SCAN_PTR_FIELD_FUNCTION_NAME	major_scan_ptr_field_concurrent_with_evacuation
 #define DRAIN_GRAY_STACK_FUNCTION_NAME	drain_gray_stack_concurrent_with_evacuation
+#define DRAIN_GRAY_STACK_PREFETCH_FUNCTION_NAME	drain_gray_stack_prefetch_concurrent_with_evacuation
+#include "sgen-marksweep-drain-gray-stack.h"
+
+#define COPY_OR_MARK_PARALLEL
+#define COPY_OR_MARK_CONCURRENT
+#define COPY_OR_MARK_FUNCTION_NAME	major_copy_or_mark_object_concurrent_par_no_evacuation
+#define SCAN_OBJECT_FUNCTION_NAME	major_scan_object_concurrent_par_no_evacuation
+#define DRAIN_GRAY_STACK_FUNCTION_NAME	drain_gray_stack_concurrent_par_no_evacuation
+#define DRAIN_GRAY_STACK_PREFETCH_FUNCTION_NAME	drain_gray_stack_prefetch_concurrent_par_no_evacuation
+#include "sgen-marksweep-drain-gray-stack.h"
+
+#define COPY_OR_MARK_PARALLEL
+#define COPY_OR_MARK_CONCURRENT_WITH_EVACUATION
+#define COPY_OR_MARK_FUNCTION_NAME	major_copy_or_mark_object_concurrent_par_with_evacuation
+#define SCAN_OBJECT_FUNCTION_NAME	major_scan_object_concurrent_par_with_evacuation
+#define SCAN_VTYPE_FUNCTION_NAME	major_scan_vtype_concurrent_par_with_evacuation
+#define SCAN_PTR_FIELD_FUNCTION_NAME	major_scan_ptr_field_concurrent_par_with_evacuation
+#define DRAIN_GRAY_STACK_FUNCTION_NAME	drain_gray_stack_concurrent_par_with_evacuation
+#define DRAIN_GRAY_STACK_PREFETCH_FUNCTION_NAME	drain_gray_stack_prefetch_concurrent_par_with_evacuation
 #include "sgen-marksweep-drain-gray-stack.h"
 
 static inline gboolean
@@ -1187,25 +1449,49 @@ major_is_evacuating (void)
 		}
 	}
 
-	return FALSE;
+	return sgen_los_is_evacuating ();
 }
 
 static gboolean
 drain_gray_stack (SgenGrayQueue *queue)
 {
-	if (major_is_evacuating ())
+	if (major_is_evacuating ()) {
+		if (mark_prefetch)
+			return drain_gray_stack_prefetch_with_evacuation (queue);
 		return drain_gray_stack_with_evacuation (queue);
-	else
+	} else {
+		if (mark_prefetch)
+			return drain_gray_stack_prefetch_no_evacuation (queue);
 		return drain_gray_stack_no_evacuation (queue);
+	}
 }
 
 static gboolean
 drain_gray_stack_concurrent (SgenGrayQueue *queue)
 {
-	if (major_is_evacuating ())
+	if (major_is_evacuating ()) {
+		if (mark_prefetch)
+			return drain_gray_stack_prefetch_concurrent_with_evacuation (queue);
 		return drain_gray_stack_concurrent_with_evacuation (queue);
-	else
+	} else {
+		if (mark_prefetch)
+			return drain_gray_stack_prefetch_concurrent_no_evacuation (queue);
 		return drain_gray_stack_concurrent_no_evacuation (queue);
+	}
+}
+
+static gboolean
+drain_gray_stack_concurrent_par (SgenGrayQueue *queue)
+{
+	if (major_is_evacuating ()) {
+		if (mark_prefetch)
+			return drain_gray_stack_prefetch_concurrent_par_with_evacuation (queue);
+		return drain_gray_stack_concurrent_par_with_evacuation (queue);
+	} else {
+		if (mark_prefetch)
+			return drain_gray_stack_prefetch_concurrent_par_no_evacuation (queue);
+		return drain_gray_stack_concurrent_par_no_evacuation (queue);
+	}
 }
 
 static void
@@ -1220,6 +1506,12 @@ major_copy_or_mark_object_concurrent_canonical (GCObject **ptr, SgenGrayQueue *q
 	major_copy_or_mark_object_concurrent_with_evacuation (ptr, *ptr, queue);
 }
 
+static void
+major_copy_or_mark_object_concurrent_par_canonical (GCObject **ptr, SgenGrayQueue *queue)
+{
+	major_copy_or_mark_object_concurrent_par_with_evacuation (ptr, *ptr, queue);
+}
+
 static void
 major_copy_or_mark_object_concurrent_finish_canonical (GCObject **ptr, SgenGrayQueue *queue)
 {
@@ -1529,10 +1821,14 @@ ensure_block_is_checked_for_sweeping (guint32 block_index, gboolean wait, gboole
 		if (!lazy_sweep)
 			sweep_block (block);
 
+		/*
+		 * Several threads can be checking blocks at the same time: the sweep
+		 * thread, its parallel helpers and nursery collections.
+		 */
 		if (!has_pinned) {
-			++sweep_num_blocks [obj_size_index];
-			sweep_slots_used [obj_size_index] += nused;
-			sweep_slots_available [obj_size_index] += count;
+			SGEN_ATOMIC_ADD_P (sweep_num_blocks [obj_size_index], 1);
+			SGEN_ATOMIC_ADD_P (sweep_slots_used [obj_size_index], nused);
+			SGEN_ATOMIC_ADD_P (sweep_slots_available [obj_size_index], count);
 		}
 
 		/*
@@ -1577,23 +1873,139 @@ ensure_block_is_checked_for_sweeping (guint32 block_index, gboolean wait, gboole
 	return !!tagged_block;
 }
 
+/*
+ * With `parallel-sweep` the block array is processed in chunks of this many blocks, which
+ * the thread that drives the sweep and its helpers on the other thread pool threads claim
+ * one at a time, from high to low.
+ */
+#define SWEEP_CHUNK_NUM_BLOCKS	256
+
+typedef struct {
+	void (*func) (guint32 block_index);
+	guint32 num_blocks;
+	volatile gint32 next_chunk;
+	volatile gint32 num_helpers_running;
+} SweepChunks;
+
+typedef struct {
+	SgenThreadPoolJob job;
+	SweepChunks *chunks;
+} SweepChunksHelperJob;
+
+static void
+sweep_chunks_process (SweepChunks *chunks)
+{
+	gint32 chunk;
+
+	while ((chunk = InterlockedDecrement (&chunks->next_chunk)) >= 0) {
+		guint32 start = (guint32)chunk * SWEEP_CHUNK_NUM_BLOCKS;
+		guint32 end = MIN (start + SWEEP_CHUNK_NUM_BLOCKS, chunks->num_blocks);
+		guint32 block_index;
+
+		for (block_index = end; block_index-- > start;)
+			chunks->func (block_index);
+	}
+}
+
+static void
+sweep_chunks_helper_job_func (void *thread_data_untyped, SgenThreadPoolJob *job)
+{
+	SweepChunks *chunks = ((SweepChunksHelperJob*)job)->chunks;
+
+	sweep_chunks_process (chunks);
+
+	mono_memory_write_barrier ();
+	InterlockedDecrement (&chunks->num_helpers_running);
+}
+
+/*
+ * Calls `func` on the block indexes from `num_blocks - 1` down to zero.  With
+ * `parallel-sweep` the work is shared with all the other thread pool threads, and we
+ * only return once they're done.
+ */
+static void
+sweep_blocks_in_chunks (void (*func) (guint32 block_index), guint32 num_blocks)
+{
+	SweepChunks chunks;
+	int num_chunks = (num_blocks + SWEEP_CHUNK_NUM_BLOCKS - 1) / SWEEP_CHUNK_NUM_BLOCKS;
+	int num_helpers = 0;
+	int i;
+
+	if (parallel_sweep)
+		num_helpers = MIN (sgen_thread_pool_get_num_threads () - 1, num_chunks - 1);
+
+	chunks.func = func;
+	chunks.num_blocks = num_blocks;
+	chunks.next_chunk = num_chunks;
+	chunks.num_helpers_running = MAX (num_helpers, 0);
+
+	for (i = 0; i < num_helpers; ++i) {
+		SweepChunksHelperJob *job = (SweepChunksHelperJob*)sgen_thread_pool_job_alloc ("sweep chunks", sweep_chunks_helper_job_func, sizeof (SweepChunksHelperJob));
+		job->job.parallel = TRUE;
+		job->chunks = &chunks;
+		sgen_thread_pool_job_enqueue (&job->job);
+	}
+
+	sweep_chunks_process (&chunks);
+
+	/* The helpers reference `chunks`, which lives on our stack. */
+	while (chunks.num_helpers_running > 0) {
+		/* FIXME: do this more elegantly */
+		g_usleep (100);
+	}
+	mono_memory_barrier ();
+}
+
+static void
+sweep_block_at_index (guint32 block_index)
+{
+	MSBlockInfo *bl = BLOCK_UNTAG (*sgen_array_list_get_slot (&allocated_blocks, block_index));
+	if (bl)
+		sweep_block (bl);
+}
+
 static void
 sweep_blocks_job_func (void *thread_data_untyped, SgenThreadPoolJob *job)
 {
-	volatile gpointer *slot;
 	MSBlockInfo *bl;
+	int i, j;
 
-	SGEN_ARRAY_LIST_FOREACH_SLOT (&allocated_blocks, slot) {
-		bl = BLOCK_UNTAG (*slot);
-		if (bl)
-			sweep_block (bl);
-	} SGEN_ARRAY_LIST_END_FOREACH_SLOT;
+	/*
+	 * Blocks on the free lists are the ones the mutators are going to allocate from
+	 * next, so we sweep those first, which makes it less likely that an allocation
+	 * has to sweep a block on demand.  The free lists change under us, but no block
+	 * is freed until the next major collection, which waits for us, so following a
+	 * stale `next_free` link at worst makes us miss some blocks.  Those are swept
+	 * by the pass over the block array below.
+	 */
+	for (i = 0; i < MS_BLOCK_TYPE_MAX; ++i) {
+		for (j = 0; j < num_block_obj_sizes; ++j) {
+			for (bl = free_block_lists [i][j]; bl; bl = bl->next_free) {
+				if (sweep_block (bl))
+					++stat_major_free_blocks_background_swept;
+			}
+		}
+	}
+
+	/* Blocks added to the array after this point are already swept. */
+	sweep_blocks_in_chunks (sweep_block_at_index, allocated_blocks.next_slot);
 
 	mono_memory_write_barrier ();
 
 	sweep_blocks_job = NULL;
 }
 
+static void
+check_block_at_index (guint32 block_index)
+{
+	/*
+	 * The block might have been freed by another thread doing some checking
+	 * work.
+	 */
+	if (!ensure_block_is_checked_for_sweeping (block_index, TRUE, NULL))
+		SGEN_ATOMIC_ADD_P (num_major_sections_freed_in_sweep, 1);
+}
+
 static void
 sweep_job_func (void *thread_data_untyped, SgenThreadPoolJob *job)
 {
@@ -1608,14 +2020,7 @@ sweep_job_func (void *thread_data_untyped, SgenThreadPoolJob *job)
 	 * cooperate with the sweep thread to finish sweeping, and they will traverse from
 	 * low to high, to avoid constantly colliding on the same blocks.
 	 */
-	for (block_index = num_blocks; block_index-- > 0;) {
-		/*
-		 * The block might have been freed by another thread doing some checking
-		 * work.
-		 */
-		if (!ensure_block_is_checked_for_sweeping (block_index, TRUE, NULL))
-			++num_major_sections_freed_in_sweep;
-	}
+	sweep_blocks_in_chunks (check_block_at_index, num_blocks);
 
 	while (!try_set_sweep_state (SWEEP_STATE_COMPACTING, SWEEP_STATE_SWEEPING)) {
 		/*
@@ -1805,6 +2210,8 @@ major_start_nursery_collection (void)
 static void
 major_finish_nursery_collection (void)
 {
+	return_worker_free_blocks ();
+
 #ifdef MARKSWEEP_CONSISTENCY_CHECK
 	consistency_check ();
 #endif
@@ -1953,11 +2360,8 @@ compare_pointers (const void *va, const void *vb) {
 }
 #endif
 
-/*
- * This is called with sweep completed and the world stopped.
- */
 static void
-major_free_swept_blocks (size_t allowance)
+release_empty_blocks (size_t allowance)
 {
 	/* FIXME: This is probably too much.  It's assuming all objects are small. */
 	size_t section_reserve = allowance / MS_BLOCK_SIZE;
@@ -2111,6 +2515,53 @@ major_free_swept_blocks (size_t allowance)
 	}
 }
 
+/*
+ * Gives the memory of the empty blocks beyond the first `decommit_retained_size` bytes
+ * back to the OS, while keeping their address space.  The empty list is LIFO, so the
+ * blocks we keep are the ones that were freed most recently.  To keep the pause short we
+ * only do a limited number of blocks at a time, so after a spike RSS goes down over a
+ * few collections.
+ */
+static void
+decommit_empty_blocks (void)
+{
+	size_t retained = decommit_retained_size / MS_BLOCK_SIZE;
+	int budget = MS_DECOMMIT_BLOCKS_PER_COLLECTION;
+	void **prev = (void**)&empty_blocks;
+	size_t i;
+
+	if (!decommit_enabled || num_empty_blocks <= retained)
+		return;
+
+	for (i = 0; i < retained && *prev; ++i)
+		prev = (void**)*prev;
+
+	mono_os_mutex_lock (&decommitted_blocks_lock);
+	while (*prev && budget > 0) {
+		void *block = *prev;
+		*prev = *(void**)block;
+		/* Needs not be atomic because this is running single-threaded. */
+		--num_empty_blocks;
+
+		sgen_decommit_os_memory (block, MS_BLOCK_SIZE, SGEN_ALLOC_HEAP);
+		sgen_pointer_queue_add (&decommitted_blocks, block);
+
+		--budget;
+		++stat_major_blocks_decommitted;
+	}
+	mono_os_mutex_unlock (&decommitted_blocks_lock);
+}
+
+/*
+ * This is called with sweep completed and the world stopped.
+ */
+static void
+major_free_swept_blocks (size_t allowance)
+{
+	release_empty_blocks (allowance);
+	decommit_empty_blocks ();
+}
+
 static void
 major_pin_objects (SgenGrayQueue *queue)
 {
@@ -2202,6 +2653,33 @@ major_handle_gc_param (const char *opt)
 	} else if (!strcmp (opt, "no-concurrent-sweep")) {
 		concurrent_sweep = FALSE;
 		return TRUE;
+	} else if (!strcmp (opt, "parallel-sweep")) {
+		parallel_sweep = TRUE;
+		return TRUE;
+	} else if (!strcmp (opt, "no-parallel-sweep")) {
+		parallel_sweep = FALSE;
+		return TRUE;
+	} else if (!strcmp (opt, "mark-prefetch")) {
+		mark_prefetch = TRUE;
+		return TRUE;
+	} else if (!strcmp (opt, "no-mark-prefetch")) {
+		mark_prefetch = FALSE;
+		return TRUE;
+	} else if (!strcmp (opt, "decommit")) {
+		decommit_enabled = TRUE;
+		return TRUE;
+	} else if (!strcmp (opt, "no-decommit")) {
+		decommit_enabled = FALSE;
+		return TRUE;
+	} else if (g_str_has_prefix (opt, "decommit-retained-size=")) {
+		const char *arg = strchr (opt, '=') + 1;
+		size_t val;
+		if (!*arg || !mono_gc_parse_environment_string_extract_number (arg, &val)) {
+			fprintf (stderr, "decommit-retained-size must be an integer.\n");
+			exit (1);
+		}
+		decommit_retained_size = val;
+		return TRUE;
 	}
 
 	return FALSE;
@@ -2215,6 +2693,10 @@ major_print_gc_param_usage (void)
 			"  evacuation-threshold=P (where P is a percentage, an integer in 0-100)\n"
 			"  (no-)lazy-sweep\n"
 			"  (no-)concurrent-sweep\n"
+			"  (no-)parallel-sweep\n"
+			"  (no-)mark-prefetch\n"
+			"  (no-)decommit\n"
+			"  decommit-retained-size=N (where N is an integer, possibly with a k, m or a g suffix)\n"
 			);
 }
 
@@ -2253,42 +2735,6 @@ extern guint64 scanned_objects;
 extern guint64 remarked_cards;
 #endif
 
-#define CARD_WORDS_PER_BLOCK (CARDS_PER_BLOCK / SIZEOF_VOID_P)
-/*
- * MS blocks are 16K aligned.
- * Cardtables are 4K aligned, at least.
- * This means that the cardtable of a given block is 32 bytes aligned.
- */
-static guint8*
-initial_skip_card (guint8 *card_data)
-{
-	mword *cards = (mword*)card_data;
-	mword card;
-	int i;
-	for (i = 0; i < CARD_WORDS_PER_BLOCK; ++i) {
-		card = cards [i];
-		if (card)
-			break;
-	}
-
-	if (i == CARD_WORDS_PER_BLOCK)
-		return card_data + CARDS_PER_BLOCK;
-
-#if defined(__i386__) && defined(__GNUC__)
-	return card_data + i * 4 +  (__builtin_ffs (card) - 1) / 8;
-#elif defined(__x86_64__) && defined(__GNUC__)
-	return card_data + i * 8 +  (__builtin_ffsll (card) - 1) / 8;
-#elif defined(__s390x__) && defined(__GNUC__)
-	return card_data + i * 8 +  (__builtin_ffsll (GUINT64_TO_LE(card)) - 1) / 8;
-#else
-	for (i = i * SIZEOF_VOID_P; i < CARDS_PER_BLOCK; ++i) {
-		if (card_data [i])
-			return &card_data [i];
-	}
-	return card_data;
-#endif
-}
-
 #define MS_BLOCK_OBJ_INDEX_FAST(o,b,os)	(((char*)(o) - ((b) + MS_BLOCK_SKIP)) / (os))
 #define MS_BLOCK_OBJ_FAST(b,os,i)			((b) + MS_BLOCK_SKIP + (os) * (i))
 #define MS_OBJ_ALLOCED_FAST(o,b)		(*(void**)(o) && (*(char**)(o) < (b) || *(char**)(o) >= (b) + MS_BLOCK_SIZE))
@@ -2351,8 +2797,9 @@ scan_card_table_for_block (MSBlockInfo *block, CardTableScanType scan_type, Scan
 
 	card_data += MS_BLOCK_SKIP >> CARD_BITS;
 
-	card_data = initial_skip_card (card_data);
-	while (card_data < card_data_end) {
+	for (card_data = sgen_card_table_find_marked_card (card_data, card_data_end);
+			card_data < card_data_end;
+			card_data = sgen_card_table_find_marked_card (card_data, card_data_end)) {
 		size_t card_index, first_object_index;
 		char *start;
 		char *end;
@@ -2360,11 +2807,6 @@ scan_card_table_for_block (MSBlockInfo *block, CardTableScanType scan_type, Scan
 
 		HEAVY_STAT (++scanned_cards);
 
-		if (!*card_data) {
-			++card_data;
-			continue;
-		}
-
 		card_index = card_data - card_base;
 		start = (char*)(block_start + card_index * CARD_SIZE_IN_BYTES);
 		end = start + CARD_SIZE_IN_BYTES;
@@ -2429,7 +2871,7 @@ scan_card_table_for_block (MSBlockInfo *block, CardTableScanType scan_type, Scan
 }
 
 static void
-major_scan_card_table (CardTableScanType scan_type, ScanCopyContext ctx)
+major_scan_card_table (CardTableScanType scan_type, ScanCopyContext ctx, int job_index, int job_split_count)
 {
 	MSBlockInfo *block;
 	gboolean has_references, was_sweeping, skip_scan;
@@ -2456,6 +2898,9 @@ major_scan_card_table (CardTableScanType scan_type, ScanCopyContext ctx)
                 }
 #endif
 
+		if (__index % job_split_count != job_index)
+			continue;
+
 		if (!has_references)
 			continue;
 		skip_scan = FALSE;
@@ -2508,16 +2953,12 @@ major_count_cards (long long *num_total_cards, long long *num_marked_cards)
 
 	FOREACH_BLOCK_HAS_REFERENCES_NO_LOCK (block, has_references) {
 		guint8 *cards = sgen_card_table_get_card_scan_address ((mword) MS_BLOCK_FOR_BLOCK_INFO (block));
-		int i;
 
 		if (!has_references)
 			continue;
 
 		total_cards += CARDS_PER_BLOCK;
-		for (i = 0; i < CARDS_PER_BLOCK; ++i) {
-			if (cards [i])
-				++marked_cards;
-		}
+		marked_cards += sgen_card_table_count_marked_cards (cards, CARDS_PER_BLOCK);
 	} END_FOREACH_BLOCK_NO_LOCK;
 
 	*num_total_cards = total_cards;
@@ -2554,11 +2995,12 @@ static void
 post_param_init (SgenMajorCollector *collector)
 {
 	collector->sweeps_lazily = lazy_sweep;
-	collector->needs_thread_pool = concurrent_mark || concurrent_sweep;
+	collector->needs_thread_pool = concurrent_mark || concurrent_sweep || parallel_sweep;
+	collector->sweeps_in_parallel = parallel_sweep;
 }
 
 static void
-sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurrent)
+sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurrent, gboolean is_parallel)
 {
 	int i;
 
@@ -2596,6 +3038,9 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 	mono_counters_register ("# major blocks allocated", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_blocks_alloced);
 	mono_counters_register ("# major blocks freed", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_blocks_freed);
 	mono_counters_register ("# major blocks lazy swept", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_blocks_lazy_swept);
+	mono_counters_register ("# major free list blocks swept in background", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_free_blocks_background_swept);
+	mono_counters_register ("# major blocks decommitted", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_blocks_decommitted);
+	mono_counters_register ("# major blocks recommitted", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_blocks_recommitted);
 #if SIZEOF_VOID_P != 8
 	mono_counters_register ("# major blocks freed ideally", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_blocks_freed_ideal);
 	mono_counters_register ("# major blocks freed less ideally", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_major_blocks_freed_less_ideal);
@@ -2607,6 +3052,7 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 
 	concurrent_mark = is_concurrent;
 	collector->is_concurrent = is_concurrent;
+	collector->is_parallel = is_parallel;
 	collector->needs_thread_pool = is_concurrent || concurrent_sweep;
 	collector->get_and_reset_num_major_objects_marked = major_get_and_reset_num_major_objects_marked;
 	collector->supports_cardtable = TRUE;
@@ -2617,8 +3063,10 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 	collector->alloc_degraded = major_alloc_degraded;
 
 	collector->alloc_object = major_alloc_object;
+	collector->alloc_object_par = major_alloc_object_par;
 	collector->free_pinned_object = free_pinned_object;
 	collector->iterate_objects = major_iterate_objects;
+	collector->iterate_objects_with_tags = major_iterate_objects_with_tags;
 	collector->free_non_pinned_object = major_free_non_pinned_object;
 	collector->pin_objects = major_pin_objects;
 	collector->pin_major_object = pin_major_object;
@@ -2663,6 +3111,14 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 		collector->major_ops_concurrent_start.scan_ptr_field = major_scan_ptr_field_concurrent_with_evacuation;
 		collector->major_ops_concurrent_start.drain_gray_stack = drain_gray_stack_concurrent;
 
+		if (is_parallel) {
+			collector->major_ops_conc_par_start.copy_or_mark_object = major_copy_or_mark_object_concurrent_par_canonical;
+			collector->major_ops_conc_par_start.scan_object = major_scan_object_concurrent_par_with_evacuation;
+			collector->major_ops_conc_par_start.scan_vtype = major_scan_vtype_concurrent_par_with_evacuation;
+			collector->major_ops_conc_par_start.scan_ptr_field = major_scan_ptr_field_concurrent_par_with_evacuation;
+			collector->major_ops_conc_par_start.drain_gray_stack = drain_gray_stack_concurrent_par;
+		}
+
 		collector->major_ops_concurrent_finish.copy_or_mark_object = major_copy_or_mark_object_concurrent_finish_canonical;
 		collector->major_ops_concurrent_finish.scan_object = major_scan_object_with_evacuation;
 		collector->major_ops_concurrent_finish.scan_vtype = major_scan_vtype_with_evacuation;
@@ -2692,6 +3148,10 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 	mono_os_mutex_init (&scanned_objects_list_lock);
 #endif
 
+	mono_os_mutex_init (&worker_alloc_block_lock);
+	mono_os_mutex_init (&decommitted_blocks_lock);
+	mono_native_tls_alloc (&worker_free_block_lists_key, NULL);
+
 	SGEN_ASSERT (0, SGEN_MAX_SMALL_OBJ_SIZE <= MS_BLOCK_FREE / 2, "MAX_SMALL_OBJ_SIZE must be at most MS_BLOCK_FREE / 2");
 
 	/*cardtable requires major pages to be 8 cards aligned*/
@@ -2701,13 +3161,19 @@ sgen_marksweep_init_internal (SgenMajorCollector *collector, gboolean is_concurr
 void
 sgen_marksweep_init (SgenMajorCollector *collector)
 {
-	sgen_marksweep_init_internal (collector, FALSE);
+	sgen_marksweep_init_internal (collector, FALSE, FALSE);
 }
 
 void
 sgen_marksweep_conc_init (SgenMajorCollector *collector)
 {
-	sgen_marksweep_init_internal (collector, TRUE);
+	sgen_marksweep_init_internal (collector, TRUE, FALSE);
+}
+
+void
+sgen_marksweep_conc_par_init (SgenMajorCollector *collector)
+{
+	sgen_marksweep_init_internal (collector, TRUE, TRUE);
 }
 
 #endif
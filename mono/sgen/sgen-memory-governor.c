@@ -40,6 +40,16 @@ static mword soft_heap_limit = ((mword)0) - ((mword)1);
 static double default_allowance_nursery_size_ratio = SGEN_DEFAULT_ALLOWANCE_NURSERY_SIZE_RATIO;
 static double save_target_ratio = SGEN_DEFAULT_SAVE_TARGET_RATIO;
 
+/* Goal driven heap sizing, see adapt_allowance_scale (). */
+static gboolean heap_sizing_goals;
+static gint64 pause_target;
+static double gc_cpu_target;
+static double allowance_scale = 1.0;
+static gint64 cycle_pause_time;
+static gint64 cycle_max_major_pause;
+static gboolean major_cycle_finished;
+static SGEN_TV_DECLARE(cycle_start);
+
 /**/
 static mword allocated_heap;
 static mword total_alloc = 0;
@@ -88,7 +98,7 @@ sgen_memgov_calculate_minor_collection_allowance (void)
 	 * We allow the heap to grow by one third its current size before we start the next
 	 * major collection.
 	 */
-	allowance_target = new_heap_size * SGEN_DEFAULT_ALLOWANCE_HEAP_SIZE_RATIO;
+	allowance_target = new_heap_size * SGEN_DEFAULT_ALLOWANCE_HEAP_SIZE_RATIO * allowance_scale;
 
 	allowance = MAX (allowance_target, MIN_MINOR_COLLECTION_ALLOWANCE);
 
@@ -119,7 +129,7 @@ sgen_memgov_calculate_minor_collection_allowance (void)
 
 	if (debug_print_allowance) {
 		SGEN_LOG (0, "Surviving sweep: %ld bytes (%ld major, %ld LOS)", (long)new_heap_size, (long)new_major, (long)last_collection_los_memory_usage);
-		SGEN_LOG (0, "Allowance: %ld bytes", (long)allowance);
+		SGEN_LOG (0, "Allowance: %ld bytes (scale %.2f)", (long)allowance, allowance_scale);
 		SGEN_LOG (0, "Trigger size: %ld bytes", (long)major_collection_trigger_size);
 	}
 }
@@ -273,6 +283,7 @@ sgen_memgov_major_collection_end (gboolean forced, gboolean concurrent, const ch
 
 	last_collection_los_memory_usage = los_memory_usage;
 	total_allocated_major_end = total_allocated_major;
+	major_cycle_finished = TRUE;
 	if (forced) {
 		sgen_get_major_collector ()->finish_sweeping ();
 		sgen_memgov_calculate_minor_collection_allowance ();
@@ -337,9 +348,58 @@ sgen_output_log_entry (SgenLogEntry *entry, gint64 stw_time, int generation)
 	}
 }
 
+/*
+ * Called at the end of every major cycle, i.e., the time from the end of one major
+ * collection to the end of the next one, including its pauses.  The pause target takes
+ * precedence: a smaller allowance means less garbage accumulates in the major heap
+ * between collections, whereas a bigger one makes major collections less frequent,
+ * which reduces the time spent in collections.  When both targets are met the scale
+ * decays back toward 1.0.  The nursery size is fixed when the nursery is allocated, so
+ * it's not adapted.
+ */
+static void
+adapt_allowance_scale (void)
+{
+	SGEN_TV_DECLARE (now);
+	gint64 cycle_time;
+	double old_scale = allowance_scale;
+	double cpu_fraction;
+
+	SGEN_TV_GETTIME (now);
+	cycle_time = SGEN_TV_ELAPSED (cycle_start, now);
+	cpu_fraction = cycle_time > 0 ? (double)cycle_pause_time / cycle_time : 0;
+
+	if (pause_target && cycle_max_major_pause > pause_target)
+		allowance_scale = MAX (allowance_scale * SGEN_ALLOWANCE_SCALE_SHRINK, SGEN_MIN_ALLOWANCE_SCALE);
+	else if (gc_cpu_target && cpu_fraction > gc_cpu_target)
+		allowance_scale = MIN (allowance_scale * SGEN_ALLOWANCE_SCALE_GROW, SGEN_MAX_ALLOWANCE_SCALE);
+	else if (allowance_scale > 1.0)
+		allowance_scale = MAX (allowance_scale * SGEN_ALLOWANCE_SCALE_DECAY, 1.0);
+	else if (allowance_scale < 1.0)
+		allowance_scale = MIN (allowance_scale / SGEN_ALLOWANCE_SCALE_DECAY, 1.0);
+
+	if (debug_print_allowance || allowance_scale != old_scale)
+		SGEN_LOG (1, "Major cycle: max major pause %.2fms, GC pauses %.1f%% of %.2fms, allowance scale %.2f -> %.2f",
+				cycle_max_major_pause / 10000.0f, cpu_fraction * 100, cycle_time / 10000.0f, old_scale, allowance_scale);
+
+	cycle_start = now;
+	cycle_pause_time = 0;
+	cycle_max_major_pause = 0;
+}
+
 void
 sgen_memgov_collection_end (int generation, gint64 stw_time)
 {
+	if (heap_sizing_goals) {
+		cycle_pause_time += stw_time;
+		if (generation == GENERATION_OLD)
+			cycle_max_major_pause = MAX (cycle_max_major_pause, stw_time);
+		if (major_cycle_finished) {
+			adapt_allowance_scale ();
+			major_cycle_finished = FALSE;
+		}
+	}
+
 	/*
 	 * At this moment the world has been restarted which means we can log all pending entries
 	 * without risking deadlocks.
@@ -429,6 +489,18 @@ sgen_free_os_memory (void *addr, size_t size, SgenAllocFlags flags)
 	total_alloc_max = MAX (total_alloc_max, total_alloc);
 }
 
+/*
+ * Give the physical memory backing `addr` back to the OS, but keep the address range.  The
+ * memory reads as zero afterwards and is committed again when it's written to.
+ */
+void
+sgen_decommit_os_memory (void *addr, size_t size, SgenAllocFlags flags)
+{
+	g_assert (!(flags & ~SGEN_ALLOC_HEAP));
+
+	mono_mprotect (addr, size, MONO_MMAP_READ | MONO_MMAP_WRITE | MONO_MMAP_DISCARD);
+}
+
 size_t
 sgen_gc_get_total_heap_allocation (void)
 {
@@ -458,7 +530,8 @@ gboolean
 sgen_memgov_try_alloc_space (mword size, int space)
 {
 	if (sgen_memgov_available_free_space () < size) {
-		SGEN_ASSERT (4, !sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()), "Memory shouldn't run out in worker thread");
+		/* Parallel nursery collections promote in worker threads, which can run out of memory. */
+		SGEN_ASSERT (4, sgen_get_current_collection_generation () == GENERATION_NURSERY || !sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()), "Memory shouldn't run out in worker thread");
 		return FALSE;
 	}
 
@@ -468,11 +541,20 @@ sgen_memgov_try_alloc_space (mword size, int space)
 }
 
 void
-sgen_memgov_init (size_t max_heap, size_t soft_limit, gboolean debug_allowance, double allowance_ratio, double save_target)
+sgen_memgov_init (size_t max_heap, size_t soft_limit, gboolean debug_allowance, double allowance_ratio, double save_target, double pause_target_ms, double gc_cpu_target_fraction)
 {
 	if (soft_limit)
 		soft_heap_limit = soft_limit;
 
+	if (pause_target_ms || gc_cpu_target_fraction) {
+		heap_sizing_goals = TRUE;
+		/* Pause times are measured in 100ns ticks. */
+		pause_target = (gint64)(pause_target_ms * 10000);
+		gc_cpu_target = gc_cpu_target_fraction;
+		SGEN_TV_GETTIME (cycle_start);
+		mono_counters_register ("Memgov allowance scale", MONO_COUNTER_GC | MONO_COUNTER_DOUBLE | MONO_COUNTER_VARIABLE, &allowance_scale);
+	}
+
 	debug_print_allowance = debug_allowance;
 	major_collection_trigger_size = MIN_MINOR_COLLECTION_ALLOWANCE;
 
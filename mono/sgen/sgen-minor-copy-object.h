@@ -13,7 +13,10 @@
 
 #if defined(SGEN_SIMPLE_NURSERY)
 
-#ifdef SGEN_CONCURRENT_MAJOR
+#ifdef SGEN_SIMPLE_PAR_NURSERY
+#define SERIAL_COPY_OBJECT simple_par_nursery_copy_object
+#define SERIAL_COPY_OBJECT_FROM_OBJ simple_par_nursery_copy_object_from_obj
+#elif defined (SGEN_CONCURRENT_MAJOR)
 #define SERIAL_COPY_OBJECT simple_nursery_serial_with_concurrent_major_copy_object
 #define SERIAL_COPY_OBJECT_FROM_OBJ simple_nursery_serial_with_concurrent_major_copy_object_from_obj
 #else
@@ -38,6 +41,16 @@
 
 extern guint64 stat_nursery_copy_object_failed_to_space; /* from sgen-gc.c */
 
+#undef COPY_OBJECT_NO_CHECKS
+#undef ADD_TO_GLOBAL_REMSET
+#ifdef SGEN_SIMPLE_PAR_NURSERY
+#define COPY_OBJECT_NO_CHECKS copy_object_no_checks_par
+#define ADD_TO_GLOBAL_REMSET sgen_add_to_global_remset_par
+#else
+#define COPY_OBJECT_NO_CHECKS copy_object_no_checks
+#define ADD_TO_GLOBAL_REMSET sgen_add_to_global_remset
+#endif
+
 /*
  * This is how the copying happens from the nursery to the old generation.
  * We assume that at this time all the pinned objects have been identified and
@@ -107,7 +120,7 @@ SERIAL_COPY_OBJECT (GCObject **obj_slot, SgenGrayQueue *queue)
 
 	HEAVY_STAT (++stat_objects_copied_nursery);
 
-	copy = copy_object_no_checks (obj, queue);
+	copy = COPY_OBJECT_NO_CHECKS (obj, queue);
 	SGEN_UPDATE_REFERENCE (obj_slot, copy);
 }
 
@@ -151,7 +164,7 @@ SERIAL_COPY_OBJECT_FROM_OBJ (GCObject **obj_slot, SgenGrayQueue *queue)
 		SGEN_UPDATE_REFERENCE (obj_slot, forwarded);
 #ifndef SGEN_SIMPLE_NURSERY
 		if (G_UNLIKELY (sgen_ptr_in_nursery (forwarded) && !sgen_ptr_in_nursery (obj_slot) && !SGEN_OBJECT_IS_CEMENTED (forwarded)))
-			sgen_add_to_global_remset (obj_slot, forwarded);
+			ADD_TO_GLOBAL_REMSET (obj_slot, forwarded);
 #endif
 		return;
 	}
@@ -160,7 +173,7 @@ SERIAL_COPY_OBJECT_FROM_OBJ (GCObject **obj_slot, SgenGrayQueue *queue)
 		SGEN_LOG (9, " (pinned, no change)");
 		HEAVY_STAT (++stat_nursery_copy_object_failed_pinned);
 		if (!sgen_ptr_in_nursery (obj_slot) && !SGEN_OBJECT_IS_CEMENTED (obj))
-			sgen_add_to_global_remset (obj_slot, obj);
+			ADD_TO_GLOBAL_REMSET (obj_slot, obj);
 		return;
 	}
 
@@ -205,7 +218,7 @@ SERIAL_COPY_OBJECT_FROM_OBJ (GCObject **obj_slot, SgenGrayQueue *queue)
 		 * most once would be the icing on the cake.
 		 */
 		if (!sgen_ptr_in_nursery (obj_slot) && !SGEN_OBJECT_IS_CEMENTED (obj))
-			sgen_add_to_global_remset (obj_slot, obj);
+			ADD_TO_GLOBAL_REMSET (obj_slot, obj);
 
 		return;
 	}
@@ -213,7 +226,7 @@ SERIAL_COPY_OBJECT_FROM_OBJ (GCObject **obj_slot, SgenGrayQueue *queue)
 
 	HEAVY_STAT (++stat_objects_copied_nursery);
 
-	copy = copy_object_no_checks (obj, queue);
+	copy = COPY_OBJECT_NO_CHECKS (obj, queue);
 #ifdef SGEN_CONCURRENT_MAJOR
 	/*
 	 * If an object is evacuated to the major heap and a reference to it, from the major
@@ -227,12 +240,12 @@ SERIAL_COPY_OBJECT_FROM_OBJ (GCObject **obj_slot, SgenGrayQueue *queue)
 	SGEN_UPDATE_REFERENCE (obj_slot, copy);
 #ifndef SGEN_SIMPLE_NURSERY
 	if (G_UNLIKELY (sgen_ptr_in_nursery (copy) && !sgen_ptr_in_nursery (obj_slot) && !SGEN_OBJECT_IS_CEMENTED (copy)))
-		sgen_add_to_global_remset (obj_slot, copy);
+		ADD_TO_GLOBAL_REMSET (obj_slot, copy);
 #else
 	/* copy_object_no_checks () can return obj on OOM */
 	if (G_UNLIKELY (obj == copy)) {
 		if (G_UNLIKELY (sgen_ptr_in_nursery (copy) && !sgen_ptr_in_nursery (obj_slot) && !SGEN_OBJECT_IS_CEMENTED (copy)))
-			sgen_add_to_global_remset (obj_slot, copy);
+			ADD_TO_GLOBAL_REMSET (obj_slot, copy);
 	}
 #endif
 }
@@ -16,7 +16,11 @@ extern guint64 stat_scan_object_called_nursery;
 
 #if defined(SGEN_SIMPLE_NURSERY)
 
-#ifdef SGEN_CONCURRENT_MAJOR
+#ifdef SGEN_SIMPLE_PAR_NURSERY
+#define SERIAL_SCAN_OBJECT simple_par_nursery_scan_object
+#define SERIAL_SCAN_VTYPE simple_par_nursery_scan_vtype
+#define SERIAL_SCAN_PTR_FIELD simple_par_nursery_scan_ptr_field
+#elif defined (SGEN_CONCURRENT_MAJOR)
 #define SERIAL_SCAN_OBJECT simple_nursery_serial_with_concurrent_major_scan_object
 #define SERIAL_SCAN_VTYPE simple_nursery_serial_with_concurrent_major_scan_vtype
 #define SERIAL_SCAN_PTR_FIELD simple_nursery_serial_with_concurrent_major_scan_ptr_field
@@ -51,6 +55,7 @@ extern guint64 stat_scan_object_called_nursery;
 		if (__old) {	\
 			SERIAL_COPY_OBJECT_FROM_OBJ ((ptr), queue);	\
 			SGEN_COND_LOG (9, __old != *(ptr), "Overwrote field at %p with %p (was: %p)", (ptr), *(ptr), __old); \
+			SGEN_HIERARCHICAL_COPY_CHILD (*(ptr), __old, queue, SERIAL_SCAN_OBJECT); \
 		}	\
 	} while (0)
 
@@ -60,6 +65,7 @@ SERIAL_SCAN_OBJECT (GCObject *full_object, SgenDescriptor desc, SgenGrayQueue *q
 	char *start = (char*)full_object;
 
 	SGEN_OBJECT_LAYOUT_STATISTICS_DECLARE_BITMAP;
+	SGEN_HIERARCHICAL_COPY_DECLARE;
 
 #ifdef HEAVY_STATISTICS
 	sgen_descriptor_count_scanned_object (desc);
@@ -78,6 +84,7 @@ static void
 SERIAL_SCAN_VTYPE (GCObject *full_object, char *start, SgenDescriptor desc, SgenGrayQueue *queue BINARY_PROTOCOL_ARG (size_t size))
 {
 	SGEN_OBJECT_LAYOUT_STATISTICS_DECLARE_BITMAP;
+	SGEN_HIERARCHICAL_COPY_DECLARE;
 
 	SGEN_ASSERT (9, sgen_get_current_collection_generation () == GENERATION_NURSERY, "Must not use minor scan during major collection.");
 
@@ -92,6 +99,9 @@ SERIAL_SCAN_VTYPE (GCObject *full_object, char *start, SgenDescriptor desc, Sgen
 static void
 SERIAL_SCAN_PTR_FIELD (GCObject *full_object, GCObject **ptr, SgenGrayQueue *queue)
 {
+	SGEN_OBJECT_LAYOUT_STATISTICS_DECLARE_BITMAP;
+	SGEN_HIERARCHICAL_COPY_DECLARE;
+
 	HANDLE_PTR (ptr, NULL);
 }
 
@@ -55,12 +55,31 @@
 #include "mono/sgen/sgen-pinning.h"
 #include "mono/sgen/sgen-client.h"
 #include "mono/utils/mono-membar.h"
+#include "mono/utils/mono-mmap.h"
+#include "mono/utils/mono-os-mutex.h"
+#ifndef SGEN_WITHOUT_MONO
+#include "mono/utils/mono-threads.h"
+#endif
+#include "mono/utils/mono-mmap-internals.h"
+#include "mono/utils/mono-proclib.h"
 
 /* Enable it so nursery allocation diagnostic data is collected */
 //#define NALLOC_DEBUG 1
 
-/* The mutator allocs from here. */
-static SgenFragmentAllocator mutator_allocator;
+/*
+ * The mutator allocs from here.  With a NUMA partitioned nursery, the nursery is
+ * split into one slice per node, and each slice has its own allocator.
+ */
+static SgenFragmentAllocator mutator_allocators [SGEN_MAX_NUMA_NODES];
+static int mutator_allocator_count = 1;
+
+gboolean sgen_numa_nursery_enabled = FALSE;
+
+/* Size of all slices but the last one, which also gets the remainder. */
+static size_t nursery_slice_size;
+/* Maps a processor number to the slice of its NUMA node. */
+static int *cpu_to_slice;
+static int cpu_to_slice_size;
 
 /* freeelist of fragment structures */
 static SgenFragment *fragment_freelist = NULL;
@@ -92,6 +111,9 @@ static guint64 stat_nursery_alloc_range_requests = 0;
 static guint64 stat_alloc_range_iterations = 0;
 static guint64 stat_alloc_range_retries = 0;
 
+static mword stat_bytes_cleared_in_background = 0;
+static mword stat_bytes_cleared_by_mutator = 0;
+
 #endif
 
 /************************************Nursery allocation debugging *********************************************/
@@ -232,6 +254,36 @@ get_mark (gpointer n)
 	return (uintptr_t)n & 0x1;
 }
 
+static inline int
+slice_of_address (char *addr)
+{
+	size_t index;
+
+	if (mutator_allocator_count == 1)
+		return 0;
+
+	index = (addr - sgen_nursery_start) / nursery_slice_size;
+	return MIN ((int)index, mutator_allocator_count - 1);
+}
+
+/*
+ * The slice local to the processor we're running on.  Threads might migrate, so
+ * this is only a hint.
+ */
+static int
+current_slice (void)
+{
+	int cpu;
+
+	if (mutator_allocator_count == 1)
+		return 0;
+
+	cpu = mono_cpu_current ();
+	if (cpu < 0 || cpu >= cpu_to_slice_size || cpu_to_slice [cpu] < 0)
+		return 0;
+	return cpu_to_slice [cpu];
+}
+
 /*MUST be called with world stopped*/
 SgenFragment*
 sgen_fragment_allocator_alloc (void)
@@ -256,6 +308,8 @@ sgen_fragment_allocator_add (SgenFragmentAllocator *allocator, char *start, char
 	fragment->fragment_start = start;
 	fragment->fragment_next = start;
 	fragment->fragment_end = end;
+	fragment->clear_state = SGEN_FRAGMENT_CLEARED;
+	fragment->clear_next = start;
 	fragment->next_in_order = fragment->next = (SgenFragment *)unmask (allocator->region_head);
 
 	allocator->region_head = allocator->alloc_head = fragment;
@@ -362,7 +416,7 @@ par_alloc_from_fragment (SgenFragmentAllocator *allocator, SgenFragment *frag, s
 		 * allocating from this dying fragment as it doesn't respect SGEN_MAX_NURSERY_WASTE
 		 * when doing second chance allocation.
 		 */
-		if ((sgen_get_nursery_clear_policy () == CLEAR_AT_TLAB_CREATION || sgen_get_nursery_clear_policy () == CLEAR_AT_TLAB_CREATION_DEBUG) && claim_remaining_size (frag, end)) {
+		if (sgen_nursery_clear_policy_is_lazy (sgen_get_nursery_clear_policy ()) && claim_remaining_size (frag, end)) {
 			sgen_clear_range (end, frag->fragment_end);
 			HEAVY_STAT (stat_wasted_bytes_trailer += frag->fragment_end - end);
 #ifdef NALLOC_DEBUG
@@ -427,10 +481,98 @@ serial_alloc_from_fragment (SgenFragment **previous, SgenFragment *frag, size_t
 	return p;
 }
 
+/* How much the background clearing thread zeroes between checks for cancellation or takeover */
+#define BACKGROUND_CLEAR_CHUNK_SIZE (64 * 1024)
+
+/*
+ * Take FRAG over from the background clearing thread instead of waiting for it, which
+ * runs at idle priority and might not get to run for a long time.  The thread checks
+ * the state after publishing the end of each chunk and before zeroing it, so it might
+ * still be zeroing the chunk ending at clear_next, but won't touch anything past it.
+ * We skip that chunk, zeroing it ourselves in case the thread backed off, and clear
+ * what we allocate from the rest.
+ */
+static void
+take_over_fragment (SgenFragment *frag)
+{
+	char *limit, *hole_start;
+
+	if (InterlockedCompareExchange (&frag->clear_state, SGEN_FRAGMENT_TAKING_OVER, SGEN_FRAGMENT_CLEARING) != SGEN_FRAGMENT_CLEARING)
+		return;
+
+	/* Nothing was allocated from FRAG while it was being cleared. */
+	SGEN_ASSERT (0, frag->fragment_next == frag->fragment_start, "Allocated from a fragment that's being cleared");
+
+	limit = frag->clear_next;
+	if (limit - frag->fragment_start > BACKGROUND_CLEAR_CHUNK_SIZE)
+		hole_start = limit - BACKGROUND_CLEAR_CHUNK_SIZE;
+	else
+		hole_start = frag->fragment_start;
+	memset (hole_start, 0, limit - hole_start);
+	frag->fragment_next = limit;
+
+	/* The skip must be visible before anybody allocates from FRAG. */
+	mono_memory_write_barrier ();
+	frag->clear_state = SGEN_FRAGMENT_MUTATOR_CLEARS;
+}
+
+/*
+ * With CLEAR_IN_BACKGROUND, whether we can allocate from FRAG.  If CLEARED_ONLY is
+ * set, only fragments which don't need clearing by the mutator qualify, otherwise
+ * fragments the background thread hasn't finished yet are claimed for the mutators.
+ */
+static gboolean
+fragment_ready_for_alloc (SgenFragment *frag, gboolean cleared_only)
+{
+	for (;;) {
+		switch (frag->clear_state) {
+		case SGEN_FRAGMENT_CLEARED:
+			/* The zeroes must be visible before we hand out the memory. */
+			mono_memory_barrier ();
+			return TRUE;
+		case SGEN_FRAGMENT_MUTATOR_CLEARS:
+			/* So must the skip done by take_over_fragment (). */
+			mono_memory_barrier ();
+			return !cleared_only;
+		case SGEN_FRAGMENT_DIRTY:
+			if (cleared_only)
+				return FALSE;
+			InterlockedCompareExchange (&frag->clear_state, SGEN_FRAGMENT_MUTATOR_CLEARS, SGEN_FRAGMENT_DIRTY);
+			break;
+		case SGEN_FRAGMENT_CLEARING:
+			if (cleared_only)
+				return FALSE;
+			take_over_fragment (frag);
+			break;
+		case SGEN_FRAGMENT_TAKING_OVER:
+			/* Another mutator is zeroing at most one chunk. */
+			if (cleared_only)
+				return FALSE;
+			g_usleep (1);
+			break;
+		default:
+			g_assert_not_reached ();
+		}
+	}
+}
+
+/* The range must be allocated from FRAG, which must be ready for allocation. */
+static void
+clear_allocated_range_if_necessary (SgenFragment *frag, void *p, size_t size)
+{
+	if (frag->clear_state == SGEN_FRAGMENT_MUTATOR_CLEARS) {
+		memset (p, 0, size);
+		HEAVY_STAT (stat_bytes_cleared_by_mutator += size);
+	}
+}
+
 void*
 sgen_fragment_allocator_par_alloc (SgenFragmentAllocator *allocator, size_t size)
 {
 	SgenFragment *frag;
+	gboolean clear_in_background = sgen_get_nursery_clear_policy () == CLEAR_IN_BACKGROUND;
+	/* When clearing in the background, first look for fragments that are already clear. */
+	gboolean cleared_only = clear_in_background;
 
 #ifdef NALLOC_DEBUG
 	InterlockedIncrement (&alloc_count);
@@ -441,17 +583,28 @@ restart:
 		HEAVY_STAT (++stat_alloc_iterations);
 
 		if (size <= (size_t)(frag->fragment_end - frag->fragment_next)) {
-			void *p = par_alloc_from_fragment (allocator, frag, size);
+			void *p;
+
+			if (clear_in_background && !fragment_ready_for_alloc (frag, cleared_only))
+				continue;
+
+			p = par_alloc_from_fragment (allocator, frag, size);
 			if (!p) {
 				HEAVY_STAT (++stat_alloc_retries);
 				goto restart;
 			}
+			if (clear_in_background)
+				clear_allocated_range_if_necessary (frag, p, size);
 #ifdef NALLOC_DEBUG
 			add_alloc_record (p, size, FIXED_ALLOC);
 #endif
 			return p;
 		}
 	}
+	if (cleared_only) {
+		cleared_only = FALSE;
+		goto restart;
+	}
 	return NULL;
 }
 
@@ -538,6 +691,9 @@ sgen_fragment_allocator_par_range_alloc (SgenFragmentAllocator *allocator, size_
 {
 	SgenFragment *frag, *min_frag;
 	size_t current_minimum;
+	gboolean clear_in_background = sgen_get_nursery_clear_policy () == CLEAR_IN_BACKGROUND;
+	/* When clearing in the background, first look for fragments that are already clear. */
+	gboolean cleared_only = clear_in_background;
 
 restart:
 	min_frag = NULL;
@@ -554,6 +710,10 @@ restart:
 
 		if (desired_size <= frag_size) {
 			void *p;
+
+			if (clear_in_background && !fragment_ready_for_alloc (frag, cleared_only))
+				continue;
+
 			*out_alloc_size = desired_size;
 
 			p = par_alloc_from_fragment (allocator, frag, desired_size);
@@ -561,12 +721,14 @@ restart:
 				HEAVY_STAT (++stat_alloc_range_retries);
 				goto restart;
 			}
+			if (clear_in_background)
+				clear_allocated_range_if_necessary (frag, p, desired_size);
 #ifdef NALLOC_DEBUG
 			add_alloc_record (p, desired_size, RANGE_ALLOC);
 #endif
 			return p;
 		}
-		if (current_minimum <= frag_size) {
+		if (current_minimum <= frag_size && !(cleared_only && frag->clear_state != SGEN_FRAGMENT_CLEARED)) {
 			min_frag = frag;
 			current_minimum = frag_size;
 		}
@@ -583,6 +745,9 @@ restart:
 		if (frag_size < minimum_size)
 			goto restart;
 
+		if (clear_in_background && !fragment_ready_for_alloc (min_frag, cleared_only))
+			goto restart;
+
 		*out_alloc_size = frag_size;
 
 		mono_memory_barrier ();
@@ -593,12 +758,18 @@ restart:
 			HEAVY_STAT (++stat_alloc_retries);
 			goto restart;
 		}
+		if (clear_in_background)
+			clear_allocated_range_if_necessary (min_frag, p, frag_size);
 #ifdef NALLOC_DEBUG
 		add_alloc_record (p, frag_size, RANGE_ALLOC);
 #endif
 		return p;
 	}
 
+	if (cleared_only) {
+		cleared_only = FALSE;
+		goto restart;
+	}
 	return NULL;
 }
 
@@ -620,8 +791,11 @@ sgen_clear_allocator_fragments (SgenFragmentAllocator *allocator)
 void
 sgen_clear_nursery_fragments (void)
 {
-	if (sgen_get_nursery_clear_policy () == CLEAR_AT_TLAB_CREATION || sgen_get_nursery_clear_policy () == CLEAR_AT_TLAB_CREATION_DEBUG) {
-		sgen_clear_allocator_fragments (&mutator_allocator);
+	if (sgen_nursery_clear_policy_is_lazy (sgen_get_nursery_clear_policy ())) {
+		int i;
+		sgen_nursery_stop_background_clear ();
+		for (i = 0; i < mutator_allocator_count; ++i)
+			sgen_clear_allocator_fragments (&mutator_allocators [i]);
 		sgen_minor_collector.clear_fragments ();
 	}
 }
@@ -652,7 +826,9 @@ sgen_clear_range (char *start, char *end)
 void
 sgen_nursery_allocator_prepare_for_pinning (void)
 {
-	sgen_clear_allocator_fragments (&mutator_allocator);
+	int i;
+	for (i = 0; i < mutator_allocator_count; ++i)
+		sgen_clear_allocator_fragments (&mutator_allocators [i]);
 	sgen_minor_collector.clear_fragments ();
 }
 
@@ -663,7 +839,7 @@ static mword fragment_total = 0;
  * allocation.
  */
 static void
-add_nursery_frag (SgenFragmentAllocator *allocator, size_t frag_size, char* frag_start, char* frag_end)
+add_nursery_frag_to_allocator (SgenFragmentAllocator *allocator, size_t frag_size, char* frag_start, char* frag_end)
 {
 	SGEN_LOG (4, "Found empty fragment: %p-%p, size: %zd", frag_start, frag_end, frag_size);
 	binary_protocol_empty (frag_start, frag_size);
@@ -681,6 +857,8 @@ add_nursery_frag (SgenFragmentAllocator *allocator, size_t frag_size, char* frag
 		*/
 #endif
 		sgen_fragment_allocator_add (allocator, frag_start, frag_end);
+		if (sgen_get_nursery_clear_policy () == CLEAR_IN_BACKGROUND)
+			allocator->region_head->clear_state = SGEN_FRAGMENT_DIRTY;
 		fragment_total += frag_size;
 	} else {
 		/* Clear unused fragments, pinning depends on this */
@@ -689,6 +867,23 @@ add_nursery_frag (SgenFragmentAllocator *allocator, size_t frag_size, char* frag
 	}
 }
 
+/*
+ * Add the fragment to the allocator of the nursery slice it's in, splitting it
+ * if it crosses slice boundaries.
+ */
+static void
+add_nursery_frag (size_t frag_size, char* frag_start, char* frag_end)
+{
+	int slice;
+
+	while ((slice = slice_of_address (frag_start)) != slice_of_address (frag_end - 1)) {
+		char *slice_end = sgen_nursery_start + (slice + 1) * nursery_slice_size;
+		add_nursery_frag_to_allocator (&mutator_allocators [slice], slice_end - frag_start, frag_start, slice_end);
+		frag_start = slice_end;
+	}
+	add_nursery_frag_to_allocator (&mutator_allocators [slice], frag_end - frag_start, frag_start, frag_end);
+}
+
 static void
 fragment_list_reverse (SgenFragmentAllocator *allocator)
 {
@@ -711,12 +906,15 @@ sgen_build_nursery_fragments (GCMemSection *nursery_section, SgenGrayQueue *unpi
 	size_t frag_size;
 	SgenFragment *frags_ranges;
 	void **pin_start, **pin_entry, **pin_end;
+	gboolean fully_pinned = TRUE;
+	int i;
 
 #ifdef NALLOC_DEBUG
 	reset_alloc_records ();
 #endif
 	/*The mutator fragments are done. We no longer need them. */
-	sgen_fragment_allocator_release (&mutator_allocator);
+	for (i = 0; i < mutator_allocator_count; ++i)
+		sgen_fragment_allocator_release (&mutator_allocators [i]);
 
 	frag_start = sgen_nursery_start;
 	fragment_total = 0;
@@ -764,7 +962,7 @@ sgen_build_nursery_fragments (GCMemSection *nursery_section, SgenGrayQueue *unpi
 		g_assert (frag_size >= 0);
 		g_assert (size > 0);
 		if (frag_size && size)
-			add_nursery_frag (&mutator_allocator, frag_size, frag_start, frag_end);	
+			add_nursery_frag (frag_size, frag_start, frag_end);
 
 		frag_size = size;
 #ifdef NALLOC_DEBUG
@@ -777,18 +975,27 @@ sgen_build_nursery_fragments (GCMemSection *nursery_section, SgenGrayQueue *unpi
 	frag_end = sgen_nursery_end;
 	frag_size = frag_end - frag_start;
 	if (frag_size)
-		add_nursery_frag (&mutator_allocator, frag_size, frag_start, frag_end);
+		add_nursery_frag (frag_size, frag_start, frag_end);
 
 	/* Now it's safe to release the fragments exclude list. */
 	sgen_minor_collector.build_fragments_release_exclude_head ();
 
-	/* First we reorder the fragment list to be in ascending address order. This makes H/W prefetchers happier. */
-	fragment_list_reverse (&mutator_allocator);
+	/*
+	 * Only the simple nursery, whose build_fragments_finish is a no-op, is used with
+	 * more than one allocator.
+	 */
+	for (i = 0; i < mutator_allocator_count; ++i) {
+		/* First we reorder the fragment list to be in ascending address order. This makes H/W prefetchers happier. */
+		fragment_list_reverse (&mutator_allocators [i]);
+
+		/*The collector might want to do something with the final nursery fragment list.*/
+		sgen_minor_collector.build_fragments_finish (&mutator_allocators [i]);
 
-	/*The collector might want to do something with the final nursery fragment list.*/
-	sgen_minor_collector.build_fragments_finish (&mutator_allocator);
+		if (unmask (mutator_allocators [i].alloc_head))
+			fully_pinned = FALSE;
+	}
 
-	if (!unmask (mutator_allocator.alloc_head)) {
+	if (fully_pinned) {
 		SGEN_LOG (1, "Nursery fully pinned");
 		for (pin_entry = pin_start; pin_entry < pin_end; ++pin_entry) {
 			GCObject *p = (GCObject *)*pin_entry;
@@ -816,15 +1023,18 @@ gboolean
 sgen_can_alloc_size (size_t size)
 {
 	SgenFragment *frag;
+	int i;
 
 	if (!SGEN_CAN_ALIGN_UP (size))
 		return FALSE;
 
 	size = SGEN_ALIGN_UP (size);
 
-	for (frag = (SgenFragment *)unmask (mutator_allocator.alloc_head); frag; frag = (SgenFragment *)unmask (frag->next)) {
-		if ((size_t)(frag->fragment_end - frag->fragment_next) >= size)
-			return TRUE;
+	for (i = 0; i < mutator_allocator_count; ++i) {
+		for (frag = (SgenFragment *)unmask (mutator_allocators [i].alloc_head); frag; frag = (SgenFragment *)unmask (frag->next)) {
+			if ((size_t)(frag->fragment_end - frag->fragment_next) >= size)
+				return TRUE;
+		}
 	}
 	return FALSE;
 }
@@ -839,7 +1049,18 @@ sgen_nursery_alloc (size_t size)
 
 	HEAVY_STAT (++stat_nursery_alloc_requests);
 
-	return sgen_fragment_allocator_par_alloc (&mutator_allocator, size);
+	if (mutator_allocator_count > 1) {
+		int i, slice = current_slice ();
+		/* Prefer the local slice, and only go remote if it's exhausted. */
+		for (i = 0; i < mutator_allocator_count; ++i) {
+			void *p = sgen_fragment_allocator_par_alloc (&mutator_allocators [(slice + i) % mutator_allocator_count], size);
+			if (p)
+				return p;
+		}
+		return NULL;
+	}
+
+	return sgen_fragment_allocator_par_alloc (&mutator_allocators [0], size);
 }
 
 void*
@@ -849,7 +1070,158 @@ sgen_nursery_alloc_range (size_t desired_size, size_t minimum_size, size_t *out_
 
 	HEAVY_STAT (++stat_nursery_alloc_range_requests);
 
-	return sgen_fragment_allocator_par_range_alloc (&mutator_allocator, desired_size, minimum_size, out_alloc_size);
+	if (mutator_allocator_count > 1) {
+		int i, slice = current_slice ();
+		for (i = 0; i < mutator_allocator_count; ++i) {
+			void *p = sgen_fragment_allocator_par_range_alloc (&mutator_allocators [(slice + i) % mutator_allocator_count], desired_size, minimum_size, out_alloc_size);
+			if (p)
+				return p;
+		}
+		return NULL;
+	}
+
+	return sgen_fragment_allocator_par_range_alloc (&mutator_allocators [0], desired_size, minimum_size, out_alloc_size);
+}
+
+/*** Background clearing ***/
+
+/*
+ * With CLEAR_IN_BACKGROUND, a low priority thread zeroes the fragments of the mutator
+ * allocators after the world restarts, with non-temporal stores so the zeroes don't
+ * push anything out of the caches.  A fragment is claimed by the thread or by the first
+ * mutator that needs it, which takes it over from the thread if need be, see
+ * fragment_ready_for_alloc ().  The thread is stopped before the collector looks at the
+ * fragments again.
+ */
+
+static gboolean background_clear_thread_started;
+static mono_mutex_t background_clear_lock;
+static mono_cond_t background_clear_cond;
+/* Protected by the lock */
+static gboolean background_clear_requested;
+static gboolean background_clear_running;
+static volatile gboolean background_clear_cancelled;
+
+/*
+ * Returns FALSE if cancelled.  A mutator may take FRAG over, see take_over_fragment (),
+ * in which case we leave the rest to it.
+ */
+static gboolean
+background_clear_fragment (SgenFragment *frag)
+{
+	char *p;
+
+	if (InterlockedCompareExchange (&frag->clear_state, SGEN_FRAGMENT_CLEARING, SGEN_FRAGMENT_DIRTY) != SGEN_FRAGMENT_DIRTY)
+		return TRUE;
+
+	for (p = frag->fragment_start; p < frag->fragment_end; p += BACKGROUND_CLEAR_CHUNK_SIZE) {
+		char *chunk_end = p + MIN (BACKGROUND_CLEAR_CHUNK_SIZE, frag->fragment_end - p);
+
+		if (background_clear_cancelled) {
+			/* The mutators will clear what they allocate from it. */
+			InterlockedCompareExchange (&frag->clear_state, SGEN_FRAGMENT_DIRTY, SGEN_FRAGMENT_CLEARING);
+			return FALSE;
+		}
+
+		/* Publish the chunk before checking whether a mutator took over. */
+		frag->clear_next = chunk_end;
+		mono_memory_barrier ();
+		if (frag->clear_state != SGEN_FRAGMENT_CLEARING)
+			return TRUE;
+
+		mono_gc_bzero_nontemporal (p, chunk_end - p);
+	}
+
+	/* The zeroes must be visible before the state, which the CAS takes care of. */
+	if (InterlockedCompareExchange (&frag->clear_state, SGEN_FRAGMENT_CLEARED, SGEN_FRAGMENT_CLEARING) != SGEN_FRAGMENT_CLEARING)
+		return TRUE;
+	HEAVY_STAT (stat_bytes_cleared_in_background += frag->fragment_end - frag->fragment_start);
+	return TRUE;
+}
+
+static mono_native_thread_return_t
+background_clear_thread_func (void *arg)
+{
+#if defined(HAVE_PTHREAD_H) && defined(SCHED_IDLE)
+	struct sched_param param;
+
+	memset (&param, 0, sizeof (param));
+	pthread_setschedparam (pthread_self (), SCHED_IDLE, &param);
+#endif
+
+	mono_os_mutex_lock (&background_clear_lock);
+	for (;;) {
+		int i;
+
+		while (!background_clear_requested)
+			mono_os_cond_wait (&background_clear_cond, &background_clear_lock);
+		background_clear_requested = FALSE;
+		background_clear_running = TRUE;
+		mono_os_mutex_unlock (&background_clear_lock);
+
+		/* Fragments are in address order, which is also the order they are handed out in. */
+		for (i = 0; i < mutator_allocator_count; ++i) {
+			SgenFragment *frag;
+
+			for (frag = mutator_allocators [i].region_head; frag; frag = frag->next_in_order) {
+				if (!background_clear_fragment (frag))
+					goto done;
+			}
+		}
+	done:
+		mono_os_mutex_lock (&background_clear_lock);
+		background_clear_running = FALSE;
+		mono_os_cond_broadcast (&background_clear_cond);
+	}
+
+	return (mono_native_thread_return_t)0;
+}
+
+/*
+ * Start clearing the fragments built by the last collection.
+ *
+ * LOCKING: assumes the GC lock is held.
+ */
+void
+sgen_nursery_start_background_clear (void)
+{
+	if (sgen_get_nursery_clear_policy () != CLEAR_IN_BACKGROUND)
+		return;
+
+	if (!background_clear_thread_started) {
+		MonoNativeThreadId tid;
+
+		mono_os_mutex_init (&background_clear_lock);
+		mono_os_cond_init (&background_clear_cond);
+		background_clear_thread_started = TRUE;
+		mono_native_thread_create (&tid, background_clear_thread_func, NULL);
+	}
+
+	mono_os_mutex_lock (&background_clear_lock);
+	background_clear_requested = TRUE;
+	mono_os_cond_broadcast (&background_clear_cond);
+	mono_os_mutex_unlock (&background_clear_lock);
+}
+
+/*
+ * Cancel the background clearing and wait for the thread to let go of the fragments.
+ * Fragments it didn't finish are left to the mutators.
+ *
+ * LOCKING: assumes the GC lock is held.
+ */
+void
+sgen_nursery_stop_background_clear (void)
+{
+	if (!background_clear_thread_started)
+		return;
+
+	background_clear_cancelled = TRUE;
+	mono_os_mutex_lock (&background_clear_lock);
+	background_clear_requested = FALSE;
+	while (background_clear_running)
+		mono_os_cond_wait (&background_clear_cond, &background_clear_lock);
+	background_clear_cancelled = FALSE;
+	mono_os_mutex_unlock (&background_clear_lock);
 }
 
 /*** Initialization ***/
@@ -870,6 +1242,9 @@ sgen_nursery_allocator_init_heavy_stats (void)
 	mono_counters_register ("# nursery alloc range requests", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_nursery_alloc_range_requests);
 	mono_counters_register ("# nursery alloc range iterations", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_alloc_range_iterations);
 	mono_counters_register ("# nursery alloc range restries", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_alloc_range_retries);
+
+	mono_counters_register ("bytes cleared in background", MONO_COUNTER_GC | MONO_COUNTER_WORD | MONO_COUNTER_BYTES, &stat_bytes_cleared_in_background);
+	mono_counters_register ("bytes cleared by mutator", MONO_COUNTER_GC | MONO_COUNTER_WORD | MONO_COUNTER_BYTES, &stat_bytes_cleared_by_mutator);
 }
 
 #endif
@@ -895,9 +1270,62 @@ sgen_nursery_alloc_prepare_for_major (void)
 	sgen_minor_collector.prepare_to_space (sgen_space_bitmap, sgen_space_bitmap_size);
 }
 
+/*
+ * Split the nursery into one slice per NUMA node and bind each slice's memory to its
+ * node.  If anything about the topology doesn't work out we stay with a single
+ * allocator.
+ */
+static void
+init_numa_slices (char *start, char *end)
+{
+	int nodes = mono_numa_node_count ();
+	int *cpu_to_node;
+	int cpu, slice;
+	size_t page_size = mono_pagesize ();
+
+	if (nodes <= 1) {
+		SGEN_LOG (1, "NUMA nursery requested, but there's only one node.");
+		return;
+	}
+	nodes = MIN (nodes, SGEN_MAX_NUMA_NODES);
+
+	nursery_slice_size = ((end - start) / nodes) & ~(page_size - 1);
+	if (nursery_slice_size < SGEN_MIN_NUMA_NURSERY_SLICE_SIZE) {
+		SGEN_LOG (1, "Nursery too small to be split across %d NUMA nodes.", nodes);
+		return;
+	}
+
+	cpu_to_slice_size = SGEN_MAX_NUMA_CPUS;
+	cpu_to_node = g_new (int, cpu_to_slice_size);
+	if (!mono_numa_get_cpu_nodes (cpu_to_node, cpu_to_slice_size)) {
+		SGEN_LOG (1, "Could not determine the NUMA node of the processors.");
+		g_free (cpu_to_node);
+		cpu_to_slice_size = 0;
+		return;
+	}
+	/* Nodes beyond the ones we support share slices. */
+	for (cpu = 0; cpu < cpu_to_slice_size; ++cpu) {
+		if (cpu_to_node [cpu] >= 0)
+			cpu_to_node [cpu] %= nodes;
+	}
+	cpu_to_slice = cpu_to_node;
+
+	mutator_allocator_count = nodes;
+	for (slice = 0; slice < nodes; ++slice) {
+		char *slice_start = start + slice * nursery_slice_size;
+		char *slice_end = slice == nodes - 1 ? end : slice_start + nursery_slice_size;
+		if (mono_vbind_numa_node (slice_start, slice_end - slice_start, slice))
+			SGEN_LOG (1, "Could not bind nursery slice %p-%p to NUMA node %d.", slice_start, slice_end, slice);
+	}
+
+	SGEN_LOG (1, "Nursery split into %d NUMA slices of %zd bytes.", nodes, nursery_slice_size);
+}
+
 void
 sgen_nursery_allocator_set_nursery_bounds (char *start, char *end)
 {
+	int i;
+
 	sgen_nursery_start = start;
 	sgen_nursery_end = end;
 
@@ -909,8 +1337,15 @@ sgen_nursery_allocator_set_nursery_bounds (char *start, char *end)
 	sgen_space_bitmap_size = (end - start + SGEN_TO_SPACE_GRANULE_IN_BYTES * 8 - 1) / (SGEN_TO_SPACE_GRANULE_IN_BYTES * 8);
 	sgen_space_bitmap = (char *)g_malloc0 (sgen_space_bitmap_size);
 
-	/* Setup the single first large fragment */
-	sgen_minor_collector.init_nursery (&mutator_allocator, start, end);
+	if (sgen_numa_nursery_enabled && !sgen_minor_collector.is_split)
+		init_numa_slices (start, end);
+
+	/* Setup the first large fragment of each slice */
+	for (i = 0; i < mutator_allocator_count; ++i) {
+		char *slice_start = start + i * nursery_slice_size;
+		char *slice_end = i == mutator_allocator_count - 1 ? end : slice_start + nursery_slice_size;
+		sgen_minor_collector.init_nursery (&mutator_allocators [i], slice_start, slice_end);
+	}
 }
 
 #endif
@@ -20,6 +20,10 @@
 #include "sgen-client.h"
 #include "mono/utils/mono-membar.h"
 #include "mono/utils/mono-proclib.h"
+#include "mono/utils/mono-os-mutex.h"
+#ifndef SGEN_WITHOUT_MONO
+#include "mono/utils/mono-threads.h"
+#endif
 
 #include <errno.h>
 #include <string.h>
@@ -52,6 +56,36 @@ static int current_file_index = 0;
 static long long current_file_size = 0;
 static long long file_size_limit;
 
+/*
+ * With `binary-protocol-async` the buffers collected when the world is stopped are handed
+ * to a writer thread instead of being written out during the pause.  The writer thread
+ * isn't registered with the runtime, so it's never stopped and can't hold on to the
+ * queue lock while the world is stopped.  The file lock serializes the writer thread
+ * with forced flushes.  The thread is created through the Mono thread utilities, so
+ * without them (SGEN_WITHOUT_MONO) the buffers are always written during the pause.
+ */
+static gboolean async_writes = FALSE;
+static gboolean writer_thread_started = FALSE;
+#ifndef SGEN_WITHOUT_MONO
+static MonoNativeThreadId writer_thread;
+#endif
+static mono_mutex_t writer_queue_lock;
+static mono_cond_t writer_queue_cond;
+static mono_mutex_t file_lock;
+/* Oldest first, linked through `next`. */
+static BinaryProtocolBuffer *writer_queue_head, *writer_queue_tail;
+#endif
+
+/*
+ * With `binary-protocol-sample=N` only every N-th collection is recorded.  Entries between
+ * collections belong to the collection before them.
+ */
+static int sample_interval = 1;
+static int num_collections = 0;
+static volatile gboolean collection_sampled = TRUE;
+
+#ifdef HAVE_UNISTD_H
+
 static char*
 filename_for_index (int index)
 {
@@ -122,6 +156,8 @@ binary_protocol_init (const char *filename, long long limit)
 #ifdef HAVE_UNISTD_H
 	file_size_limit = limit;
 
+	mono_os_mutex_init (&file_lock);
+
 	/* Original name length + . + pid length in hex + null terminator */
 	filename_or_prefix = g_strdup_printf ("%s", filename);
 	binary_protocol_open_file (FALSE);
@@ -144,6 +180,21 @@ binary_protocol_init (const char *filename, long long limit)
 #endif
 }
 
+void
+binary_protocol_set_sample_interval (int interval)
+{
+	SGEN_ASSERT (0, interval > 0, "The sample interval must be positive");
+	sample_interval = interval;
+}
+
+void
+binary_protocol_set_async (gboolean async)
+{
+#if defined(HAVE_UNISTD_H) && !defined(SGEN_WITHOUT_MONO)
+	async_writes = async;
+#endif
+}
+
 gboolean
 binary_protocol_is_enabled (void)
 {
@@ -255,6 +306,91 @@ binary_protocol_check_file_overflow (void)
 }
 #endif
 
+#ifdef HAVE_UNISTD_H
+static BinaryProtocolBuffer*
+writer_queue_dequeue_all (void)
+{
+	BinaryProtocolBuffer *buf;
+
+	if (!writer_thread_started)
+		return NULL;
+
+	mono_os_mutex_lock (&writer_queue_lock);
+	buf = writer_queue_head;
+	writer_queue_head = writer_queue_tail = NULL;
+	mono_os_mutex_unlock (&writer_queue_lock);
+
+	return buf;
+}
+
+static void
+write_buffer_list (BinaryProtocolBuffer *buf)
+{
+	while (buf) {
+		BinaryProtocolBuffer *next = buf->next;
+		if (binary_protocol_file != -1) {
+			binary_protocol_flush_buffer (buf);
+			binary_protocol_check_file_overflow ();
+		} else {
+			sgen_free_os_memory (buf, sizeof (BinaryProtocolBuffer), SGEN_ALLOC_INTERNAL);
+		}
+		buf = next;
+	}
+}
+
+/*
+ * Writes out a list of buffers, oldest first, and frees them.  The buffers still queued
+ * for the writer thread are older, so they go first.  They are dequeued with the file
+ * lock held, which is also how the writer thread dequeues them, so a forced flush can't
+ * overtake a batch the thread is in the middle of writing.
+ */
+static void
+binary_protocol_write_buffers (BinaryProtocolBuffer *buf)
+{
+	mono_os_mutex_lock (&file_lock);
+	write_buffer_list (writer_queue_dequeue_all ());
+	write_buffer_list (buf);
+	mono_os_mutex_unlock (&file_lock);
+}
+
+#ifndef SGEN_WITHOUT_MONO
+static mono_native_thread_return_t
+writer_thread_func (void *unused)
+{
+	for (;;) {
+		mono_os_mutex_lock (&writer_queue_lock);
+		while (!writer_queue_head)
+			mono_os_cond_wait (&writer_queue_cond, &writer_queue_lock);
+		mono_os_mutex_unlock (&writer_queue_lock);
+
+		binary_protocol_write_buffers (NULL);
+	}
+
+	return (mono_native_thread_return_t)0;
+}
+
+static void
+writer_queue_enqueue (BinaryProtocolBuffer *head, BinaryProtocolBuffer *tail)
+{
+	if (!writer_thread_started) {
+		mono_os_mutex_init (&writer_queue_lock);
+		mono_os_cond_init (&writer_queue_cond);
+		mono_native_thread_create (&writer_thread, writer_thread_func, NULL);
+		writer_thread_started = TRUE;
+	}
+
+	mono_os_mutex_lock (&writer_queue_lock);
+	if (writer_queue_tail)
+		writer_queue_tail->next = head;
+	else
+		writer_queue_head = head;
+	writer_queue_tail = tail;
+	mono_os_cond_signal (&writer_queue_cond);
+	mono_os_mutex_unlock (&writer_queue_lock);
+}
+#endif
+#endif
+
 /*
  * Flushing buffers takes an exclusive lock, so it must only be done when the world is
  * stopped, otherwise we might end up with a deadlock because a stopped thread owns the
@@ -266,10 +402,7 @@ gboolean
 binary_protocol_flush_buffers (gboolean force)
 {
 #ifdef HAVE_UNISTD_H
-	int num_buffers = 0, i;
-	BinaryProtocolBuffer *header;
-	BinaryProtocolBuffer *buf;
-	BinaryProtocolBuffer **bufs;
+	BinaryProtocolBuffer *buf, *next, *oldest = NULL, *newest;
 
 	if (binary_protocol_file == -1)
 		return FALSE;
@@ -277,26 +410,28 @@ binary_protocol_flush_buffers (gboolean force)
 	if (!force && !try_lock_exclusive ())
 		return FALSE;
 
-	header = binary_protocol_buffers;
-	for (buf = header; buf != NULL; buf = buf->next)
-		++num_buffers;
-	bufs = (BinaryProtocolBuffer **)sgen_alloc_internal_dynamic (num_buffers * sizeof (BinaryProtocolBuffer*), INTERNAL_MEM_BINARY_PROTOCOL, TRUE);
-	for (buf = header, i = 0; buf != NULL; buf = buf->next, i++)
-		bufs [i] = buf;
-	SGEN_ASSERT (0, i == num_buffers, "Binary protocol buffer count error");
-
 	/*
 	 * This might be incorrect when forcing, but all bets are off in that case, anyway,
 	 * because we're trying to figure out a bug in the debugger.
 	 */
+	newest = binary_protocol_buffers;
 	binary_protocol_buffers = NULL;
 
-	for (i = num_buffers - 1; i >= 0; --i) {
-		binary_protocol_flush_buffer (bufs [i]);
-		binary_protocol_check_file_overflow ();
+	/* The list is newest first, but we must write the oldest buffer first. */
+	for (buf = newest; buf != NULL; buf = next) {
+		next = buf->next;
+		buf->next = oldest;
+		oldest = buf;
 	}
 
-	sgen_free_internal_dynamic (buf, num_buffers * sizeof (BinaryProtocolBuffer*), INTERNAL_MEM_BINARY_PROTOCOL);
+	if (oldest) {
+#ifndef SGEN_WITHOUT_MONO
+		if (async_writes && !force)
+			writer_queue_enqueue (oldest, newest);
+		else
+#endif
+			binary_protocol_write_buffers (oldest);
+	}
 
 	if (!force)
 		unlock_exclusive ();
@@ -338,6 +473,11 @@ protocol_entry (unsigned char type, gpointer data, int size)
 	if (binary_protocol_file == -1)
 		return;
 
+	if (type == PROTOCOL_ID (binary_protocol_collection_begin))
+		collection_sampled = num_collections++ % sample_interval == 0;
+	if (!collection_sampled)
+		return;
+
 	if (sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()))
 		type |= 0x80;
 
@@ -152,6 +152,8 @@ enum {
 /* missing: finalizers, roots, non-store wbarriers */
 
 void binary_protocol_init (const char *filename, long long limit);
+void binary_protocol_set_sample_interval (int interval);
+void binary_protocol_set_async (gboolean async);
 gboolean binary_protocol_is_enabled (void);
 
 gboolean binary_protocol_flush_buffers (gboolean force);
@@ -128,6 +128,34 @@ for the allocator space.
 */
 static float alloc_ratio = 60.f/100.f;
 
+/*
+With an adaptive promotion age we adjust `promote_age` after every collection, based on
+how well the objects of the ages around it survived.  If fewer than
+PROMOTION_AGE_LOW_SURVIVAL of the objects that reached the promotion age survive the
+next collection, aging them once more pays off, so we increase it.  If at least
+PROMOTION_AGE_HIGH_SURVIVAL of the objects one age below survive, they would have been
+better off promoted, so we decrease it.  Ages with fewer than PROMOTION_AGE_MIN_SAMPLE_SIZE
+bytes don't tell us anything, and nor do collections where the to-space overflowed,
+except that we're aging too much.
+*/
+static gboolean adaptive_promote_age = FALSE;
+
+#define PROMOTION_AGE_LOW_SURVIVAL	0.5
+#define PROMOTION_AGE_HIGH_SURVIVAL	0.9
+#define PROMOTION_AGE_MIN_SAMPLE_SIZE	(64 * 1024)
+
+/*
+Survivor histograms.  `survivor_bytes [age]` is the number of bytes in objects with that
+age that were evacuated in the current collection, either aged or promoted.  `aged_bytes
+[age]` is the number of bytes that were aged into that age.  The `last_` versions are the
+ones of the previous collection, and what's exposed through the counters.
+*/
+static guint64 survivor_bytes [MAX_AGE];
+static guint64 aged_bytes [MAX_AGE];
+static guint64 last_survivor_bytes [MAX_AGE];
+static guint64 last_aged_bytes [MAX_AGE];
+static gboolean to_space_overflowed;
+
 
 static char *region_age;
 static size_t region_age_size;
@@ -254,6 +282,7 @@ alloc_for_promotion (GCVTable vtable, GCObject *obj, size_t objsize, gboolean ha
 	int age;
 
 	age = get_object_age (obj);
+	survivor_bytes [age] += objsize;
 	if (age >= promote_age) {
 		total_promoted_size += objsize;
 		return major_collector.alloc_object (vtable, objsize, has_references);
@@ -268,10 +297,12 @@ alloc_for_promotion (GCVTable vtable, GCObject *obj, size_t objsize, gboolean ha
 	} else {
 		p = alloc_for_promotion_slow_path (age, objsize);
 		if (!p) {
+			to_space_overflowed = TRUE;
 			total_promoted_size += objsize;
 			return major_collector.alloc_object (vtable, objsize, has_references);
 		}
 	}
+	aged_bytes [age] += objsize;
 
 	/* FIXME: assumes object layout */
 	*(GCVTable*)p = vtable;
@@ -310,12 +341,60 @@ build_fragments_release_exclude_head (void)
 	sgen_fragment_allocator_release (&collector_allocator);
 }
 
+/*
+Fraction of the bytes aged into `age` by the previous collection that survived this one,
+or -1 if there weren't enough of them.
+*/
+static double
+age_survival_rate (int age)
+{
+	if (last_aged_bytes [age] < PROMOTION_AGE_MIN_SAMPLE_SIZE)
+		return -1;
+	return (double)survivor_bytes [age] / last_aged_bytes [age];
+}
+
+static void
+adapt_promote_age (void)
+{
+	int old_promote_age = promote_age;
+
+	if (to_space_overflowed) {
+		if (promote_age > 1)
+			--promote_age;
+	} else if (promote_age < MAX_AGE - 1 && age_survival_rate (promote_age) >= 0 && age_survival_rate (promote_age) < PROMOTION_AGE_LOW_SURVIVAL) {
+		++promote_age;
+	} else if (promote_age > 1 && age_survival_rate (promote_age - 1) >= PROMOTION_AGE_HIGH_SURVIVAL) {
+		--promote_age;
+	}
+
+	if (promote_age != old_promote_age)
+		SGEN_LOG (2, "Promotion age %d -> %d%s", old_promote_age, promote_age, to_space_overflowed ? " (to-space overflowed)" : "");
+}
+
+/*
+Called once at the end of every collection that evacuated the nursery.
+*/
+static void
+update_survivor_histograms (void)
+{
+	if (adaptive_promote_age)
+		adapt_promote_age ();
+
+	memcpy (last_survivor_bytes, survivor_bytes, sizeof (survivor_bytes));
+	memcpy (last_aged_bytes, aged_bytes, sizeof (aged_bytes));
+	memset (survivor_bytes, 0, sizeof (survivor_bytes));
+	memset (aged_bytes, 0, sizeof (aged_bytes));
+	to_space_overflowed = FALSE;
+}
+
 static void
 build_fragments_finish (SgenFragmentAllocator *allocator)
 {
 	/* We split the fragment list based on the promotion barrier. */
 	collector_allocator = *allocator;
 	fragment_list_split (&collector_allocator);
+
+	update_survivor_histograms ();
 }
 
 static void
@@ -367,6 +446,19 @@ clear_fragments (void)
 	sgen_clear_allocator_fragments (&collector_allocator);
 }
 
+static void
+register_counters (void)
+{
+	int age;
+
+	mono_counters_register ("Split nursery promotion age", MONO_COUNTER_GC | MONO_COUNTER_INT | MONO_COUNTER_VARIABLE, &promote_age);
+	for (age = 0; age < MAX_AGE; ++age) {
+		char name [64];
+		g_snprintf (name, sizeof (name), "Split nursery age %d survivor bytes", age);
+		mono_counters_register (name, MONO_COUNTER_GC | MONO_COUNTER_ULONG | MONO_COUNTER_BYTES | MONO_COUNTER_VARIABLE, &last_survivor_bytes [age]);
+	}
+}
+
 static void
 init_nursery (SgenFragmentAllocator *allocator, char *start, char *end)
 {
@@ -377,6 +469,8 @@ init_nursery (SgenFragmentAllocator *allocator, char *start, char *end)
 
 	region_age_size = (end - start) >> SGEN_TO_SPACE_GRANULE_BITS;
 	region_age = (char *)g_malloc0 (region_age_size);
+
+	register_counters ();
 }
 
 static gboolean
@@ -402,6 +496,15 @@ handle_gc_param (const char *opt)
 		}
 		return TRUE;
 	}
+
+	if (!strcmp (opt, "adaptive-promotion-age")) {
+		adaptive_promote_age = TRUE;
+		return TRUE;
+	}
+	if (!strcmp (opt, "no-adaptive-promotion-age")) {
+		adaptive_promote_age = FALSE;
+		return TRUE;
+	}
 	return FALSE;
 }
 
@@ -411,7 +514,8 @@ print_gc_param_usage (void)
 	fprintf (stderr,
 			""
 			"  alloc-ratio=P (where P is a percentage, an integer in 1-100)\n"
-			"  promotion-age=P (where P is a number, an integer in 1-%d)\n",
+			"  promotion-age=P (where P is a number, an integer in 1-%d)\n"
+			"  [no-]adaptive-promotion-age\n",
 			MAX_AGE - 1
 			);
 }
@@ -451,6 +555,7 @@ void
 sgen_split_nursery_init (SgenMinorCollector *collector)
 {
 	collector->is_split = TRUE;
+	collector->is_parallel = FALSE;
 
 	collector->alloc_for_promotion = minor_alloc_for_promotion;
 
@@ -21,7 +21,9 @@ static mono_mutex_t lock;
 static mono_cond_t work_cond;
 static mono_cond_t done_cond;
 
-static MonoNativeThreadId thread;
+static MonoNativeThreadId threads [SGEN_THREADPOOL_MAX_NUM_THREADS];
+static void *threads_data [SGEN_THREADPOOL_MAX_NUM_THREADS];
+static int threads_num;
 
 /* Only accessed with the lock held. */
 static SgenPointerQueue job_queue;
@@ -31,7 +33,7 @@ static SgenThreadPoolIdleJobFunc idle_job_func;
 static SgenThreadPoolContinueIdleJobFunc continue_idle_job_func;
 
 static volatile gboolean threadpool_shutdown;
-static volatile gboolean thread_finished;
+static volatile int threads_finished;
 
 enum {
 	STATE_WAITING,
@@ -39,12 +41,18 @@ enum {
 	STATE_DONE
 };
 
-/* Assumes that the lock is held. */
+/*
+ * Assumes that the lock is held.
+ *
+ * Only the first thread runs serial jobs, the other threads only pick up parallel jobs.
+ */
 static SgenThreadPoolJob*
-get_job_and_set_in_progress (void)
+get_job_and_set_in_progress (gboolean parallel_only)
 {
 	for (size_t i = 0; i < job_queue.next_slot; ++i) {
 		SgenThreadPoolJob *job = (SgenThreadPoolJob *)job_queue.data [i];
+		if (parallel_only && !job->parallel)
+			continue;
 		if (job->state == STATE_WAITING) {
 			job->state = STATE_IN_PROGRESS;
 			return job;
@@ -78,16 +86,21 @@ remove_job (SgenThreadPoolJob *job)
 }
 
 static gboolean
-continue_idle_job (void)
+continue_idle_job (void *thread_data)
 {
 	if (!continue_idle_job_func)
 		return FALSE;
-	return continue_idle_job_func ();
+	return continue_idle_job_func (thread_data);
 }
 
 static mono_native_thread_return_t
-thread_func (void *thread_data)
+thread_func (void *thread_index_untyped)
 {
+	int thread_index = GPOINTER_TO_INT (thread_index_untyped);
+	void *thread_data = threads_data [thread_index];
+	/* Serial jobs are only done by the first thread. */
+	gboolean is_primary = thread_index == 0;
+
 	thread_init_func (thread_data);
 
 	mono_os_mutex_lock (&lock);
@@ -98,8 +111,8 @@ thread_func (void *thread_data)
 		 * main thread might then set continue idle and signal us before we can take
 		 * the lock, and we'd lose the signal.
 		 */
-		gboolean do_idle = continue_idle_job ();
-		SgenThreadPoolJob *job = get_job_and_set_in_progress ();
+		gboolean do_idle = continue_idle_job (thread_data);
+		SgenThreadPoolJob *job = get_job_and_set_in_progress (!is_primary);
 
 		if (!job && !do_idle && !threadpool_shutdown) {
 			/*
@@ -130,7 +143,7 @@ thread_func (void *thread_data)
 			SGEN_ASSERT (0, idle_job_func, "Why do we have idle work when there's no idle job function?");
 			do {
 				idle_job_func (thread_data);
-				do_idle = continue_idle_job ();
+				do_idle = continue_idle_job (thread_data);
 			} while (do_idle && !job_queue.next_slot);
 
 			mono_os_mutex_lock (&lock);
@@ -140,7 +153,7 @@ thread_func (void *thread_data)
 		} else {
 			SGEN_ASSERT (0, threadpool_shutdown, "Why did we unlock if no jobs and not shutting down?");
 			mono_os_mutex_lock (&lock);
-			thread_finished = TRUE;
+			++threads_finished;
 			mono_os_cond_signal (&done_cond);
 			mono_os_mutex_unlock (&lock);
 			return 0;
@@ -153,7 +166,9 @@ thread_func (void *thread_data)
 void
 sgen_thread_pool_init (int num_threads, SgenThreadPoolThreadInitFunc init_func, SgenThreadPoolIdleJobFunc idle_func, SgenThreadPoolContinueIdleJobFunc continue_idle_func, void **thread_datas)
 {
-	SGEN_ASSERT (0, num_threads == 1, "We only support 1 thread pool thread for now.");
+	int i;
+
+	SGEN_ASSERT (0, num_threads >= 1 && num_threads <= SGEN_THREADPOOL_MAX_NUM_THREADS, "Invalid number of thread pool threads %d.", num_threads);
 
 	mono_os_mutex_init (&lock);
 	mono_os_cond_init (&work_cond);
@@ -163,19 +178,23 @@ sgen_thread_pool_init (int num_threads, SgenThreadPoolThreadInitFunc init_func,
 	idle_job_func = idle_func;
 	continue_idle_job_func = continue_idle_func;
 
-	mono_native_thread_create (&thread, thread_func, thread_datas ? thread_datas [0] : NULL);
+	threads_num = num_threads;
+	for (i = 0; i < threads_num; ++i) {
+		threads_data [i] = thread_datas ? thread_datas [i] : NULL;
+		mono_native_thread_create (&threads [i], thread_func, GINT_TO_POINTER (i));
+	}
 }
 
 void
 sgen_thread_pool_shutdown (void)
 {
-	if (!thread)
+	if (!threads_num)
 		return;
 
 	mono_os_mutex_lock (&lock);
 	threadpool_shutdown = TRUE;
-	mono_os_cond_signal (&work_cond);
-	while (!thread_finished)
+	mono_os_cond_broadcast (&work_cond);
+	while (threads_finished < threads_num)
 		mono_os_cond_wait (&done_cond, &lock);
 	mono_os_mutex_unlock (&lock);
 
@@ -192,6 +211,7 @@ sgen_thread_pool_job_alloc (const char *name, SgenThreadPoolJobFunc func, size_t
 	job->size = size;
 	job->state = STATE_WAITING;
 	job->func = func;
+	job->parallel = FALSE;
 	return job;
 }
 
@@ -208,10 +228,10 @@ sgen_thread_pool_job_enqueue (SgenThreadPoolJob *job)
 
 	sgen_pointer_queue_add (&job_queue, job);
 	/*
-	 * FIXME: We could check whether there is a job in progress.  If there is, there's
-	 * no need to signal the condition, at least as long as we have only one thread.
+	 * We have to broadcast because not every thread can run every job: signalling a
+	 * single thread that can't take the job would lose the wakeup.
 	 */
-	mono_os_cond_signal (&work_cond);
+	mono_os_cond_broadcast (&work_cond);
 
 	mono_os_mutex_unlock (&lock);
 }
@@ -236,8 +256,8 @@ sgen_thread_pool_idle_signal (void)
 
 	mono_os_mutex_lock (&lock);
 
-	if (continue_idle_job_func ())
-		mono_os_cond_signal (&work_cond);
+	if (continue_idle_job_func (NULL))
+		mono_os_cond_broadcast (&work_cond);
 
 	mono_os_mutex_unlock (&lock);
 }
@@ -249,7 +269,7 @@ sgen_thread_pool_idle_wait (void)
 
 	mono_os_mutex_lock (&lock);
 
-	while (continue_idle_job_func ())
+	while (continue_idle_job_func (NULL))
 		mono_os_cond_wait (&done_cond, &lock);
 
 	mono_os_mutex_unlock (&lock);
@@ -266,10 +286,22 @@ sgen_thread_pool_wait_for_all_jobs (void)
 	mono_os_mutex_unlock (&lock);
 }
 
+int
+sgen_thread_pool_get_num_threads (void)
+{
+	return threads_num;
+}
+
 gboolean
 sgen_thread_pool_is_thread_pool_thread (MonoNativeThreadId some_thread)
 {
-	return some_thread == thread;
+	int i;
+
+	for (i = 0; i < threads_num; ++i) {
+		if (some_thread == threads [i])
+			return TRUE;
+	}
+	return FALSE;
 }
 
 #endif
@@ -9,6 +9,8 @@
 #ifndef __MONO_SGEN_THREAD_POOL_H__
 #define __MONO_SGEN_THREAD_POOL_H__
 
+#define SGEN_THREADPOOL_MAX_NUM_THREADS 8
+
 typedef struct _SgenThreadPoolJob SgenThreadPoolJob;
 
 typedef void (*SgenThreadPoolJobFunc) (void *thread_data, SgenThreadPoolJob *job);
@@ -18,11 +20,20 @@ struct _SgenThreadPoolJob {
 	SgenThreadPoolJobFunc func;
 	size_t size;
 	volatile gint32 state;
+	/*
+	 * Serial jobs, the default, only ever run on the first thread, one after the
+	 * other.  Parallel jobs can run on any thread, concurrently with each other.
+	 */
+	gboolean parallel;
 };
 
 typedef void (*SgenThreadPoolThreadInitFunc) (void*);
 typedef void (*SgenThreadPoolIdleJobFunc) (void*);
-typedef gboolean (*SgenThreadPoolContinueIdleJobFunc) (void);
+/*
+ * Called with the data of the thread that wants to know whether it should do idle work,
+ * or with NULL to ask whether any thread should.
+ */
+typedef gboolean (*SgenThreadPoolContinueIdleJobFunc) (void*);
 
 void sgen_thread_pool_init (int num_threads, SgenThreadPoolThreadInitFunc init_func, SgenThreadPoolIdleJobFunc idle_func, SgenThreadPoolContinueIdleJobFunc continue_idle_func, void **thread_datas);
 
@@ -41,6 +52,8 @@ void sgen_thread_pool_idle_wait (void);
 
 void sgen_thread_pool_wait_for_all_jobs (void);
 
+int sgen_thread_pool_get_num_threads (void);
+
 gboolean sgen_thread_pool_is_thread_pool_thread (MonoNativeThreadId thread);
 
 #endif
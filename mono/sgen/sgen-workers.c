@@ -20,6 +20,8 @@
 #include "mono/sgen/sgen-client.h"
 
 static int workers_num;
+/* How many of the workers mark in concurrent collections. */
+static int active_workers_num;
 static volatile gboolean forced_stop;
 static WorkerData *workers_data;
 
@@ -31,15 +33,17 @@ static gboolean workers_distribute_gray_queue_inited;
  *
  * | from \ to          | NOT WORKING | WORKING | WORK ENQUEUED |
  * |--------------------+-------------+---------+---------------+
- * | NOT WORKING        | -           | -       | main          |
- * | WORKING            | worker      | -       | main          |
+ * | NOT WORKING        | -           | -       | main / worker |
+ * | WORKING            | worker      | -       | main / worker |
  * | WORK ENQUEUED      | -           | worker  | -             |
  *
- * The WORK ENQUEUED state guarantees that the worker thread will inspect the queue again at
- * least once.  Only after looking at the queue will it go back to WORKING, and then,
- * eventually, to NOT WORKING.  After enqueuing work the main thread transitions the state
- * to WORK ENQUEUED.  Signalling the worker thread to wake up is only necessary if the old
- * state was NOT WORKING.
+ * Each worker has its own state.  The WORK ENQUEUED state guarantees that the worker
+ * thread will inspect the queues again at least once.  Only after looking at the queues
+ * will it go back to WORKING, and then, eventually, to NOT WORKING.  After enqueuing work
+ * the main thread transitions the states of the active workers to WORK ENQUEUED.  A worker
+ * that has plenty of work to share does the same, to wake up the others so they can steal
+ * it.  Signalling the worker threads to wake up is only necessary if one of the old states
+ * was NOT WORKING.
  */
 
 enum {
@@ -50,15 +54,50 @@ enum {
 
 typedef gint32 State;
 
-static volatile State workers_state;
+/*
+ * A worker that has at least this many sections in its gray queue wakes up the workers
+ * that ran out of work, so they can steal from it.
+ */
+#define WORKERS_MIN_SECTIONS_SIGNAL	4
+
+/* Taken while a worker decides whether it's the last one to finish. */
+static mono_mutex_t finished_lock;
+static volatile gboolean workers_finished;
+/* Bounds how often busy workers wake up the others in one collection. */
+static volatile gint32 worker_awakenings;
 
 static SgenObjectOperations * volatile idle_func_object_ops;
-static SgenThreadPoolJob * volatile preclean_job;
+static volatile SgenWorkersFinishCallback finish_callback;
+
+/*
+ * Jobs handed out by the finish callback.  The workers take them one at a time whenever
+ * they run out of marking work, so they run on all the active workers, but only while
+ * those are working, which keeps the last worker from finishing while a job is running.
+ */
+static SgenPointerQueue concurrent_jobs;
+static volatile gint32 concurrent_next_job;
 
 static guint64 stat_workers_num_finished;
+static guint64 stat_workers_sections_stolen;
+
+/*
+ * Parallel nursery collections.
+ *
+ * The main GC thread collects the scan jobs with `sgen_workers_add_parallel_job ()` and
+ * then runs them with `sgen_workers_run_parallel_jobs ()`, which starts one parallel
+ * thread pool job per worker.  Each worker takes scan jobs off the list until it's
+ * empty, draining its private gray queue after each of them.  Workers that are out of
+ * work steal sections from the distribute gray queue, which holds the main thread's work,
+ * and from the private gray queues of the others.  We're done when no worker is active
+ * and there's nothing left to steal.
+ */
+static SgenPointerQueue parallel_jobs;
+static volatile gint32 parallel_next_job;
+static volatile gint32 parallel_active_workers;
+static SgenObjectOperations * volatile parallel_object_ops;
 
 static gboolean
-set_state (State old_state, State new_state)
+set_state (WorkerData *data, State old_state, State new_state)
 {
 	SGEN_ASSERT (0, old_state != new_state, "Why are we transitioning to the same state?");
 	if (new_state == STATE_NOT_WORKING)
@@ -68,7 +107,7 @@ set_state (State old_state, State new_state)
 	if (new_state == STATE_NOT_WORKING || new_state == STATE_WORKING)
 		SGEN_ASSERT (6, sgen_thread_pool_is_thread_pool_thread (mono_native_thread_id_get ()), "Only the worker thread is allowed to transition to NOT_WORKING or WORKING");
 
-	return InterlockedCompareExchange (&workers_state, new_state, old_state) == old_state;
+	return InterlockedCompareExchange (&data->state, new_state, old_state) == old_state;
 }
 
 static gboolean
@@ -80,41 +119,90 @@ state_is_working_or_enqueued (State state)
 static void
 sgen_workers_ensure_awake (void)
 {
-	State old_state;
-	gboolean did_set_state;
+	int i;
+	gboolean need_signal = FALSE;
 
-	do {
-		old_state = workers_state;
+	for (i = 0; i < active_workers_num; ++i) {
+		State old_state;
+		gboolean did_set_state;
 
-		if (old_state == STATE_WORK_ENQUEUED)
-			break;
+		do {
+			old_state = workers_data [i].state;
 
-		did_set_state = set_state (old_state, STATE_WORK_ENQUEUED);
-	} while (!did_set_state);
+			if (old_state == STATE_WORK_ENQUEUED)
+				break;
 
-	if (!state_is_working_or_enqueued (old_state))
+			did_set_state = set_state (&workers_data [i], old_state, STATE_WORK_ENQUEUED);
+		} while (!did_set_state);
+
+		if (!state_is_working_or_enqueued (old_state))
+			need_signal = TRUE;
+	}
+
+	if (need_signal)
 		sgen_thread_pool_idle_signal ();
 }
 
 static void
-worker_try_finish (void)
+worker_try_finish (WorkerData *data)
 {
 	State old_state;
+	int i, working = 0;
 
 	++stat_workers_num_finished;
 
+	mono_os_mutex_lock (&finished_lock);
+
+	for (i = 0; i < workers_num; ++i) {
+		if (state_is_working_or_enqueued (workers_data [i].state))
+			++working;
+	}
+
+	if (working == 1) {
+		SgenWorkersFinishCallback callback = finish_callback;
+
+		SGEN_ASSERT (0, data->state != STATE_NOT_WORKING, "How did we get from doing idle work to NOT WORKING without setting it ourselves?");
+
+		/*
+		 * We're the last one left.  Ask the finish callback for more jobs if we have one
+		 * and wake everybody up, so they can run them and help with the work they produce.
+		 */
+		if (callback) {
+			SGEN_ASSERT (0, concurrent_next_job >= (gint32)concurrent_jobs.next_slot, "Why are we finishing with concurrent jobs left?");
+			sgen_pointer_queue_clear (&concurrent_jobs);
+			concurrent_next_job = 0;
+
+			if (callback ()) {
+				mono_memory_write_barrier ();
+				worker_awakenings = 0;
+				sgen_workers_ensure_awake ();
+				SGEN_ASSERT (0, data->state == STATE_WORK_ENQUEUED, "Why did we fail to set our own state to ENQUEUED?");
+				goto work_available;
+			}
+			finish_callback = NULL;
+		}
+	}
+
 	do {
-		old_state = workers_state;
+		old_state = data->state;
 
 		SGEN_ASSERT (0, old_state != STATE_NOT_WORKING, "How did we get from doing idle work to NOT WORKING without setting it ourselves?");
 		if (old_state == STATE_WORK_ENQUEUED)
-			return;
+			goto work_available;
 		SGEN_ASSERT (0, old_state == STATE_WORKING, "What other possibility is there?");
+	} while (!set_state (data, old_state, STATE_NOT_WORKING));
 
-		/* We are the last thread to go to sleep. */
-	} while (!set_state (old_state, STATE_NOT_WORKING));
+	workers_finished = TRUE;
+
+	mono_os_mutex_unlock (&finished_lock);
 
 	binary_protocol_worker_finish (sgen_timestamp (), forced_stop);
+
+	sgen_gray_object_queue_trim_free_list (&data->private_gray_queue);
+	return;
+
+ work_available:
+	mono_os_mutex_unlock (&finished_lock);
 }
 
 void
@@ -143,14 +231,69 @@ sgen_workers_wait_for_jobs_finished (void)
 	sgen_workers_ensure_awake ();
 }
 
+/*
+ * Steals a section from one of the first `num_workers` workers other than us.  We start
+ * looking with the worker after us, so that the thieves spread out over the victims.
+ */
+static gboolean
+workers_steal_work (WorkerData *data, int num_workers)
+{
+	int current = (int)(data - workers_data);
+	int i;
+
+	for (i = 1; i < num_workers; ++i) {
+		WorkerData *victim = &workers_data [(current + i) % num_workers];
+		GrayQueueSection *section = sgen_gray_object_steal_section (&victim->private_gray_queue);
+		if (section) {
+			sgen_gray_object_enqueue_section (&data->private_gray_queue, section);
+			++stat_workers_sections_stolen;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+/* Whether one of the first `num_workers` workers has a section we could steal. */
+static gboolean
+workers_have_stealable_work (int num_workers)
+{
+	int i;
+
+	if (!sgen_section_gray_queue_is_empty (&workers_distribute_gray_queue))
+		return TRUE;
+
+	for (i = 0; i < num_workers; ++i) {
+		if (workers_data [i].private_gray_queue.num_sections > 1)
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+static SgenThreadPoolJob*
+concurrent_take_job (void)
+{
+	gint32 index;
+
+	if (concurrent_next_job >= (gint32)concurrent_jobs.next_slot)
+		return NULL;
+
+	index = InterlockedIncrement (&concurrent_next_job) - 1;
+	if (index >= (gint32)concurrent_jobs.next_slot)
+		return NULL;
+	return (SgenThreadPoolJob *)concurrent_jobs.data [index];
+}
+
 static gboolean
 workers_get_work (WorkerData *data)
 {
 	SgenMajorCollector *major;
+	SgenThreadPoolJob *job;
 
 	g_assert (sgen_gray_object_queue_is_empty (&data->private_gray_queue));
 
-	/* If we're concurrent, steal from the workers distribute gray queue. */
+	/* If we're concurrent, take the work the main thread handed to the workers ... */
 	major = sgen_get_major_collector ();
 	if (major->is_concurrent) {
 		GrayQueueSection *section = sgen_section_gray_queue_dequeue (&workers_distribute_gray_queue);
@@ -160,6 +303,18 @@ workers_get_work (WorkerData *data)
 		}
 	}
 
+	/* ... or steal from the other workers ... */
+	if (workers_steal_work (data, active_workers_num))
+		return TRUE;
+
+	/* ... or run the jobs the finish callback handed out. */
+	while ((job = concurrent_take_job ())) {
+		job->func (data, job);
+		sgen_thread_pool_job_free (job);
+		if (!sgen_gray_object_queue_is_empty (&data->private_gray_queue))
+			return TRUE;
+	}
+
 	/* Nobody to steal from */
 	g_assert (sgen_gray_object_queue_is_empty (&data->private_gray_queue));
 	return FALSE;
@@ -168,6 +323,10 @@ workers_get_work (WorkerData *data)
 static void
 concurrent_enqueue_check (GCObject *obj)
 {
+	/* Parallel nursery collections use the same queues. */
+	if (sgen_get_current_collection_generation () == GENERATION_NURSERY && !sgen_concurrent_collection_in_progress ())
+		return;
+
 	g_assert (sgen_concurrent_collection_in_progress ());
 	g_assert (!sgen_ptr_in_nursery (obj));
 	g_assert (SGEN_LOAD_VTABLE (obj));
@@ -178,7 +337,7 @@ init_private_gray_queue (WorkerData *data)
 {
 	sgen_gray_object_queue_init (&data->private_gray_queue,
 			sgen_get_major_collector ()->is_concurrent ? concurrent_enqueue_check : NULL,
-			FALSE);
+			FALSE, workers_num > 1);
 }
 
 static void
@@ -189,16 +348,28 @@ thread_pool_init_func (void *data_untyped)
 
 	sgen_client_thread_register_worker ();
 
-	if (!major->is_concurrent)
+	if (!major->is_concurrent && !sgen_minor_collector.is_parallel)
 		return;
 
 	init_private_gray_queue (data);
 }
 
 static gboolean
-continue_idle_func (void)
+continue_idle_func (void *data_untyped)
 {
-	return state_is_working_or_enqueued (workers_state);
+	int i;
+
+	if (data_untyped) {
+		WorkerData *data = (WorkerData *)data_untyped;
+		return state_is_working_or_enqueued (data->state);
+	}
+
+	/* Is any of the workers working? */
+	for (i = 0; i < workers_num; ++i) {
+		if (state_is_working_or_enqueued (workers_data [i].state))
+			return TRUE;
+	}
+	return FALSE;
 }
 
 static void
@@ -206,12 +377,12 @@ marker_idle_func (void *data_untyped)
 {
 	WorkerData *data = (WorkerData *)data_untyped;
 
-	SGEN_ASSERT (0, continue_idle_func (), "Why are we called when we're not supposed to work?");
+	SGEN_ASSERT (0, continue_idle_func (data_untyped), "Why are we called when we're not supposed to work?");
 	SGEN_ASSERT (0, sgen_concurrent_collection_in_progress (), "The worker should only mark in concurrent collections.");
 
-	if (workers_state == STATE_WORK_ENQUEUED) {
-		set_state (STATE_WORK_ENQUEUED, STATE_WORKING);
-		SGEN_ASSERT (0, workers_state != STATE_NOT_WORKING, "How did we get from WORK ENQUEUED to NOT WORKING?");
+	if (data->state == STATE_WORK_ENQUEUED) {
+		set_state (data, STATE_WORK_ENQUEUED, STATE_WORKING);
+		SGEN_ASSERT (0, data->state != STATE_NOT_WORKING, "How did we get from WORK ENQUEUED to NOT WORKING?");
 	}
 
 	if (!forced_stop && (!sgen_gray_object_queue_is_empty (&data->private_gray_queue) || workers_get_work (data))) {
@@ -220,14 +391,23 @@ marker_idle_func (void *data_untyped)
 		SGEN_ASSERT (0, !sgen_gray_object_queue_is_empty (&data->private_gray_queue), "How is our gray queue empty if we just got work?");
 
 		sgen_drain_gray_stack (ctx);
-	} else {
-		SgenThreadPoolJob *job = preclean_job;
-		if (job) {
-			sgen_thread_pool_job_enqueue (job);
-			preclean_job = NULL;
-		} else {
-			worker_try_finish ();
+
+		/*
+		 * If some workers ran out of work while we have plenty, wake them up so they can
+		 * steal from us.
+		 */
+		if (workers_finished && data->private_gray_queue.num_sections >= WORKERS_MIN_SECTIONS_SIGNAL &&
+				worker_awakenings < active_workers_num) {
+			mono_os_mutex_lock (&finished_lock);
+			if (workers_finished) {
+				workers_finished = FALSE;
+				++worker_awakenings;
+				sgen_workers_ensure_awake ();
+			}
+			mono_os_mutex_unlock (&finished_lock);
 		}
+	} else {
+		worker_try_finish (data);
 	}
 }
 
@@ -258,8 +438,10 @@ sgen_workers_init (int num_workers)
 {
 	int i;
 	void **workers_data_ptrs = (void **)alloca(num_workers * sizeof(void *));
+	gboolean is_concurrent = sgen_get_major_collector ()->is_concurrent;
+	gboolean is_parallel = sgen_minor_collector.is_parallel;
 
-	if (!sgen_get_major_collector ()->is_concurrent) {
+	if (!is_concurrent && !is_parallel) {
 		sgen_thread_pool_init (num_workers, thread_pool_init_func, NULL, NULL, NULL);
 		return;
 	}
@@ -267,6 +449,8 @@ sgen_workers_init (int num_workers)
 	//g_print ("initing %d workers\n", num_workers);
 
 	workers_num = num_workers;
+	active_workers_num = 1;
+	mono_os_mutex_init (&finished_lock);
 
 	workers_data = (WorkerData *)sgen_alloc_internal_dynamic (sizeof (WorkerData) * num_workers, INTERNAL_MEM_WORKER_DATA, TRUE);
 	memset (workers_data, 0, sizeof (WorkerData) * num_workers);
@@ -276,29 +460,73 @@ sgen_workers_init (int num_workers)
 	for (i = 0; i < workers_num; ++i)
 		workers_data_ptrs [i] = (void *) &workers_data [i];
 
-	sgen_thread_pool_init (num_workers, thread_pool_init_func, marker_idle_func, continue_idle_func, workers_data_ptrs);
+	/* Only the concurrent collector has idle work. */
+	if (is_concurrent)
+		sgen_thread_pool_init (num_workers, thread_pool_init_func, marker_idle_func, continue_idle_func, workers_data_ptrs);
+	else
+		sgen_thread_pool_init (num_workers, thread_pool_init_func, NULL, NULL, workers_data_ptrs);
 
-	mono_counters_register ("# workers finished", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_workers_num_finished);
+	if (is_concurrent)
+		mono_counters_register ("# workers finished", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_workers_num_finished);
+	mono_counters_register ("# workers sections stolen", MONO_COUNTER_GC | MONO_COUNTER_ULONG, &stat_workers_sections_stolen);
 }
 
 void
 sgen_workers_stop_all_workers (void)
 {
-	preclean_job = NULL;
+	finish_callback = NULL;
 	mono_memory_write_barrier ();
 	forced_stop = TRUE;
 
 	sgen_thread_pool_wait_for_all_jobs ();
 	sgen_thread_pool_idle_wait ();
-	SGEN_ASSERT (0, workers_state == STATE_NOT_WORKING, "Can only signal enqueue work when in no work state");
+	SGEN_ASSERT (0, sgen_workers_all_done (), "Can only signal enqueue work when in no work state");
+
+	/* The jobs we didn't get to are only an optimization, so we drop them. */
+	while (concurrent_next_job < (gint32)concurrent_jobs.next_slot)
+		sgen_thread_pool_job_free ((SgenThreadPoolJob *)concurrent_jobs.data [concurrent_next_job++]);
+	sgen_pointer_queue_clear (&concurrent_jobs);
+	concurrent_next_job = 0;
+}
+
+/*
+ * Hands the work left in the private gray queues of the workers, which must be stopped,
+ * to the first worker via the distribute gray queue.
+ */
+static void
+workers_gather_work (void)
+{
+	int i;
+
+	for (i = 1; i < workers_num; ++i) {
+		GrayQueueSection *section;
+		while ((section = sgen_gray_object_dequeue_section (&workers_data [i].private_gray_queue)))
+			sgen_section_gray_queue_enqueue (&workers_distribute_gray_queue, section);
+	}
 }
 
+/*
+ * If `object_ops_par` is given and the major collector supports it, all the workers
+ * mark with it.  Otherwise only the first worker works, with `object_ops_nopar`.
+ */
 void
-sgen_workers_start_all_workers (SgenObjectOperations *object_ops, SgenThreadPoolJob *job)
+sgen_workers_start_all_workers (SgenObjectOperations *object_ops_nopar, SgenObjectOperations *object_ops_par, SgenWorkersFinishCallback callback)
 {
+	SGEN_ASSERT (0, sgen_workers_all_done (), "Why are we starting workers that are still working?");
+
+	if (object_ops_par && sgen_get_major_collector ()->is_parallel && workers_num > 1) {
+		idle_func_object_ops = object_ops_par;
+		active_workers_num = workers_num;
+	} else {
+		idle_func_object_ops = object_ops_nopar;
+		active_workers_num = 1;
+		workers_gather_work ();
+	}
+
 	forced_stop = FALSE;
-	idle_func_object_ops = object_ops;
-	preclean_job = job;
+	workers_finished = FALSE;
+	worker_awakenings = 0;
+	finish_callback = callback;
 	mono_memory_write_barrier ();
 
 	sgen_workers_ensure_awake ();
@@ -311,7 +539,7 @@ sgen_workers_join (void)
 
 	sgen_thread_pool_wait_for_all_jobs ();
 	sgen_thread_pool_idle_wait ();
-	SGEN_ASSERT (0, workers_state == STATE_NOT_WORKING, "Can only signal enqueue work when in no work state");
+	SGEN_ASSERT (0, sgen_workers_all_done (), "Can only signal enqueue work when in no work state");
 
 	/* At this point all the workers have stopped. */
 
@@ -345,14 +573,14 @@ sgen_workers_have_idle_work (void)
 gboolean
 sgen_workers_all_done (void)
 {
-	return workers_state == STATE_NOT_WORKING;
+	return !continue_idle_func (NULL);
 }
 
 /* Must only be used for debugging */
 gboolean
 sgen_workers_are_working (void)
 {
-	return state_is_working_or_enqueued (workers_state);
+	return continue_idle_func (NULL);
 }
 
 void
@@ -361,6 +589,136 @@ sgen_workers_assert_gray_queue_is_empty (void)
 	SGEN_ASSERT (0, sgen_section_gray_queue_is_empty (&workers_distribute_gray_queue), "Why is the workers gray queue not empty?");
 }
 
+/*
+ * Must only be called from the finish callback.  The job is run by one of the active
+ * workers, with its private gray queue.
+ */
+void
+sgen_workers_add_concurrent_job (SgenThreadPoolJob *job)
+{
+	sgen_pointer_queue_add (&concurrent_jobs, job);
+}
+
+void
+sgen_workers_add_parallel_job (SgenThreadPoolJob *job)
+{
+	SGEN_ASSERT (0, sgen_minor_collector.is_parallel, "Why are we adding parallel jobs without a parallel minor collector?");
+	sgen_pointer_queue_add (&parallel_jobs, job);
+}
+
+/*
+ * How many jobs work that can be divided, like scanning the card table, should be split
+ * into for parallel collections.
+ */
+int
+sgen_workers_get_job_split_count (void)
+{
+	return workers_num;
+}
+
+static SgenThreadPoolJob*
+parallel_take_job (void)
+{
+	gint32 index = InterlockedIncrement (&parallel_next_job) - 1;
+
+	if (index >= (gint32)parallel_jobs.next_slot)
+		return NULL;
+	return (SgenThreadPoolJob *)parallel_jobs.data [index];
+}
+
+static gboolean
+parallel_steal_work (WorkerData *data)
+{
+	GrayQueueSection *section = sgen_section_gray_queue_dequeue (&workers_distribute_gray_queue);
+
+	if (section) {
+		sgen_gray_object_enqueue_section (&data->private_gray_queue, section);
+		return TRUE;
+	}
+	return workers_steal_work (data, workers_num);
+}
+
+static void
+parallel_worker_func (void *data_untyped, SgenThreadPoolJob *job)
+{
+	WorkerData *data = (WorkerData *)data_untyped;
+	ScanCopyContext ctx = CONTEXT_FROM_OBJECT_OPERATIONS (parallel_object_ops, &data->private_gray_queue);
+	SgenThreadPoolJob *scan_job;
+
+	SGEN_ASSERT (0, sgen_gray_object_queue_is_empty (&data->private_gray_queue), "Why does the worker have work before starting?");
+
+	InterlockedIncrement (&parallel_active_workers);
+
+	/* The scan jobs put their work into our private gray queue. */
+	while ((scan_job = parallel_take_job ())) {
+		scan_job->func (data, scan_job);
+		sgen_thread_pool_job_free (scan_job);
+		sgen_drain_gray_stack (ctx);
+	}
+
+	for (;;) {
+		if (parallel_steal_work (data)) {
+			sgen_drain_gray_stack (ctx);
+			continue;
+		}
+
+		/*
+		 * We're out of work.  Only active workers produce work, so if there are none
+		 * left and nothing is up for stealing, we're all done.
+		 */
+		InterlockedDecrement (&parallel_active_workers);
+		for (;;) {
+			if (workers_have_stealable_work (workers_num)) {
+				InterlockedIncrement (&parallel_active_workers);
+				break;
+			}
+			if (!parallel_active_workers)
+				goto done;
+			g_usleep (10);
+		}
+	}
+
+ done:
+	sgen_gray_object_queue_trim_free_list (&data->private_gray_queue);
+}
+
+/*
+ * Runs the jobs added with `sgen_workers_add_parallel_job ()` on all workers, with
+ * `object_ops`, which must be safe to use from several threads at once.  The work in
+ * `gc_thread_gray_queue` is shared out, too.  Returns when all the work is done.
+ */
+void
+sgen_workers_run_parallel_jobs (SgenObjectOperations *object_ops, SgenGrayQueue *gc_thread_gray_queue)
+{
+	GrayQueueSection *section;
+	int i;
+
+	SGEN_ASSERT (0, !sgen_concurrent_collection_in_progress (), "Parallel jobs can't run while the concurrent collector uses the workers.");
+	SGEN_ASSERT (0, sgen_section_gray_queue_is_empty (&workers_distribute_gray_queue), "Why is there work left in the distribute gray queue?");
+
+	while ((section = sgen_gray_object_dequeue_section (gc_thread_gray_queue)))
+		sgen_section_gray_queue_enqueue (&workers_distribute_gray_queue, section);
+
+	parallel_object_ops = object_ops;
+	parallel_next_job = 0;
+	parallel_active_workers = 0;
+	mono_memory_write_barrier ();
+
+	for (i = 0; i < workers_num; ++i) {
+		SgenThreadPoolJob *job = sgen_thread_pool_job_alloc ("parallel worker", parallel_worker_func, sizeof (SgenThreadPoolJob));
+		job->parallel = TRUE;
+		sgen_thread_pool_job_enqueue (job);
+	}
+	sgen_thread_pool_wait_for_all_jobs ();
+
+	SGEN_ASSERT (0, parallel_next_job >= (gint32)parallel_jobs.next_slot, "Why are there parallel jobs left?");
+	SGEN_ASSERT (0, sgen_section_gray_queue_is_empty (&workers_distribute_gray_queue), "Why is there still work left to do?");
+	for (i = 0; i < workers_num; ++i)
+		SGEN_ASSERT (0, sgen_gray_object_queue_is_empty (&workers_data [i].private_gray_queue), "Why is there still work left to do?");
+
+	sgen_pointer_queue_clear (&parallel_jobs);
+}
+
 void
 sgen_workers_take_from_queue_and_awake (SgenGrayQueue *queue)
 {
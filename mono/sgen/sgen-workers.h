@@ -14,12 +14,22 @@
 
 typedef struct _WorkerData WorkerData;
 struct _WorkerData {
-	SgenGrayQueue private_gray_queue; /* only read/written by worker thread */
+	/* See the state machine in sgen-workers.c. */
+	volatile gint32 state;
+	/* Only the worker pushes and pops, but other workers can steal sections. */
+	SgenGrayQueue private_gray_queue;
 };
 
+/*
+ * Called by the last worker to run out of work in a concurrent collection.  It can hand
+ * out more work with `sgen_workers_add_concurrent_job ()`, in which case it must return
+ * TRUE.  Once it returns FALSE it's not called again.
+ */
+typedef gboolean (*SgenWorkersFinishCallback) (void);
+
 void sgen_workers_init (int num_workers);
 void sgen_workers_stop_all_workers (void);
-void sgen_workers_start_all_workers (SgenObjectOperations *object_ops, SgenThreadPoolJob *finish_job);
+void sgen_workers_start_all_workers (SgenObjectOperations *object_ops_nopar, SgenObjectOperations *object_ops_par, SgenWorkersFinishCallback finish_callback);
 void sgen_workers_init_distribute_gray_queue (void);
 void sgen_workers_enqueue_job (SgenThreadPoolJob *job, gboolean enqueue);
 void sgen_workers_wait_for_jobs_finished (void);
@@ -31,5 +41,9 @@ gboolean sgen_workers_all_done (void);
 gboolean sgen_workers_are_working (void);
 void sgen_workers_assert_gray_queue_is_empty (void);
 void sgen_workers_take_from_queue_and_awake (SgenGrayQueue *queue);
+void sgen_workers_add_concurrent_job (SgenThreadPoolJob *job);
+void sgen_workers_add_parallel_job (SgenThreadPoolJob *job);
+void sgen_workers_run_parallel_jobs (SgenObjectOperations *object_ops, SgenGrayQueue *gc_thread_gray_queue);
+int sgen_workers_get_job_split_count (void);
 
 #endif
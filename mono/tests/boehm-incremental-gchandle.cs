@@ -0,0 +1,59 @@
+using System;
+using System.Runtime.InteropServices;
+
+/*
+ * With incremental Boehm collections, objects which are only referenced from
+ * the GCHandle table must survive the collections running while the handles
+ * are created, the table grows and the targets are replaced.
+ */
+class Payload {
+	int[] data;
+
+	public Payload (int id) {
+		data = new int [16];
+		for (int i = 0; i < data.Length; ++i)
+			data [i] = id + i;
+	}
+
+	public bool Check (int id) {
+		for (int i = 0; i < data.Length; ++i) {
+			if (data [i] != id + i)
+				return false;
+		}
+		return true;
+	}
+}
+
+class Driver {
+	const int Count = 20000;
+	const int Rounds = 10;
+
+	static int Main () {
+		var handles = new GCHandle [Count];
+
+		for (int round = 0; round < Rounds; ++round) {
+			for (int i = 0; i < Count; ++i) {
+				if (round == 0)
+					handles [i] = GCHandle.Alloc (new Payload (i));
+				else
+					handles [i].Target = new Payload (i + round);
+
+				/* Garbage, so that collections run in between */
+				var junk = new byte [256];
+				junk [0] = 1;
+			}
+
+			for (int i = 0; i < Count; ++i) {
+				var payload = handles [i].Target as Payload;
+				if (payload == null || !payload.Check (i + round)) {
+					Console.WriteLine ("round {0}: handle {1} lost its target", round, i);
+					return 1;
+				}
+			}
+		}
+
+		for (int i = 0; i < Count; ++i)
+			handles [i].Free ();
+		return 0;
+	}
+}
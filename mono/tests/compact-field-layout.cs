@@ -0,0 +1,101 @@
+using System;
+
+/*
+ * Auto layout classes have their fields packed to minimize padding, with the
+ * fields of subclasses going into the padding at the end of their parent.
+ * Check that no two fields overlap and that references survive collections.
+ */
+
+class Base {
+	public byte b1;
+	public long l;
+	public byte b2;
+	public object o;
+	public int i;
+}
+
+class Derived : Base {
+	public byte d1;
+	public string s;
+	public short sh;
+	public double d;
+}
+
+class Derived2 : Derived {
+	public byte x;
+	public object o2;
+}
+
+class Tests {
+	struct Range {
+		public long start, end;
+		public string name;
+	}
+
+	static int Check (Range[] ranges)
+	{
+		for (int i = 0; i < ranges.Length; ++i) {
+			for (int j = i + 1; j < ranges.Length; ++j) {
+				if (ranges [i].start < ranges [j].end && ranges [j].start < ranges [i].end) {
+					Console.WriteLine ("{0} overlaps {1}", ranges [i].name, ranges [j].name);
+					return 1;
+				}
+			}
+		}
+		return 0;
+	}
+
+	static unsafe Range R (void *p, int size, string name)
+	{
+		return new Range { start = (long)p, end = (long)p + size, name = name };
+	}
+
+	static unsafe int CheckOverlap (Derived2 o)
+	{
+		fixed (byte *b1 = &o.b1, b2 = &o.b2, d1 = &o.d1, x = &o.x) {
+			fixed (long *l = &o.l) {
+				fixed (int *i = &o.i) {
+					fixed (short *sh = &o.sh) {
+						fixed (double *d = &o.d) {
+							var ranges = new Range [] {
+								R (b1, 1, "b1"), R (b2, 1, "b2"), R (d1, 1, "d1"), R (x, 1, "x"),
+								R (l, 8, "l"), R (i, 4, "i"), R (sh, 2, "sh"), R (d, 8, "d")
+							};
+							return Check (ranges);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	public static unsafe int Main ()
+	{
+		var o = new Derived2 ();
+
+		if (CheckOverlap (o) != 0)
+			return 1;
+
+		o.b1 = 1;
+		o.l = 0x1122334455667788;
+		o.b2 = 2;
+		o.o = new object ();
+		o.i = 0x01020304;
+		o.d1 = 3;
+		o.s = "hello";
+		o.sh = 0x0506;
+		o.d = 1.5;
+		o.x = 4;
+		o.o2 = "world";
+
+		GC.Collect ();
+
+		if (o.b1 != 1 || o.l != 0x1122334455667788 || o.b2 != 2 || o.i != 0x01020304)
+			return 2;
+		if (o.d1 != 3 || o.sh != 0x0506 || o.d != 1.5 || o.x != 4)
+			return 3;
+		if (o.o == null || o.s != "hello" || (string)o.o2 != "world")
+			return 4;
+		return 0;
+	}
+}
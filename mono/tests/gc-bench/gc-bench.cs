@@ -0,0 +1,225 @@
+//
+// gc-bench.cs: GC workloads for comparing SGen configurations
+//
+// Each workload does a fixed amount of work, so the elapsed times of two
+// runtimes or two sets of MONO_GC_PARAMS can be compared directly. The
+// result line is parsed by run-gc-bench.py, which combines it with the GC
+// log of the run.
+//
+// Usage: mono gc-bench.exe WORKLOAD [SCALE]
+//
+
+using System;
+using System.Collections.Generic;
+using System.Diagnostics;
+using System.IO;
+using System.Threading;
+
+class Node {
+	public Node left, right;
+}
+
+class Entry {
+	public int key;
+	public byte[] data;
+}
+
+// The name is what MONO_GC_DEBUG=bridge=Bridge looks for
+public class Bridge {
+	public object[] links = new object [4];
+}
+
+class Finalizable {
+	public static int finalized;
+	byte[] payload = new byte [32];
+
+	~Finalizable () {
+		Interlocked.Increment (ref finalized);
+	}
+}
+
+class Driver {
+	static int scale = 1;
+
+	static Node MakeTree (int depth) {
+		var n = new Node ();
+		if (depth > 0) {
+			n.left = MakeTree (depth - 1);
+			n.right = MakeTree (depth - 1);
+		}
+		return n;
+	}
+
+	static int CheckTree (Node n) {
+		return n.left == null ? 1 : 1 + CheckTree (n.left) + CheckTree (n.right);
+	}
+
+	// The classic binary trees benchmark: a long lived tree and many short lived ones
+	static long BinaryTrees () {
+		const int max_depth = 18;
+		long ops = 0;
+		var long_lived = MakeTree (max_depth);
+
+		for (int depth = 4; depth <= max_depth; depth += 2) {
+			int iterations = (1 << (max_depth - depth + 4)) * scale;
+			for (int i = 0; i < iterations; ++i)
+				ops += CheckTree (MakeTree (depth));
+		}
+		ops += CheckTree (long_lived);
+		return ops;
+	}
+
+	// A bounded cache with random accesses, evicted entries become garbage in the old generation
+	static long LruCache () {
+		const int capacity = 100000;
+		var map = new Dictionary<int, LinkedListNode<Entry>> ();
+		var lru = new LinkedList<Entry> ();
+		var rand = new Random (42);
+		long ops = 2000000L * scale;
+
+		for (long i = 0; i < ops; ++i) {
+			int key = rand.Next (capacity * 4);
+			LinkedListNode<Entry> node;
+			if (map.TryGetValue (key, out node)) {
+				lru.Remove (node);
+				lru.AddFirst (node);
+				continue;
+			}
+			if (map.Count == capacity) {
+				map.Remove (lru.Last.Value.key);
+				lru.RemoveLast ();
+			}
+			var entry = new Entry { key = key, data = new byte [64 + rand.Next (448)] };
+			map [key] = lru.AddFirst (entry);
+		}
+		return ops;
+	}
+
+	// Arrays big enough for the large object space, replaced at random
+	static long LargeArrays () {
+		var arrays = new byte [64][];
+		var rand = new Random (42);
+		long ops = 20000L * scale;
+
+		for (long i = 0; i < ops; ++i)
+			arrays [rand.Next (arrays.Length)] = new byte [100 * 1024 + rand.Next (900 * 1024)];
+		return ops;
+	}
+
+	// Short lived allocations from many threads, with a few objects surviving for a while
+	static long ManyThreads () {
+		int count = Environment.ProcessorCount * 2;
+		long per_thread = 5000000L * scale / count;
+		var threads = new Thread [count];
+
+		for (int i = 0; i < count; ++i) {
+			threads [i] = new Thread (() => {
+				var survivors = new List<object> ();
+				for (long j = 0; j < per_thread; ++j) {
+					var o = new object [2];
+					if ((j % 100) == 0)
+						survivors.Add (o);
+					if (survivors.Count == 10000)
+						survivors = new List<object> ();
+				}
+			});
+			threads [i].Start ();
+		}
+		foreach (var t in threads)
+			t.Join ();
+		return per_thread * count;
+	}
+
+	// Random graphs of bridge objects, which must be processed by the bridge at every collection
+	static long BridgeGraphs () {
+		const int nodes = 20000;
+		var rand = new Random (42);
+		var kept = new List<Bridge[]> ();
+		long rounds = 50L * scale;
+
+		for (long r = 0; r < rounds; ++r) {
+			var graph = new Bridge [nodes];
+			for (int i = 0; i < nodes; ++i)
+				graph [i] = new Bridge ();
+			for (int i = 0; i < nodes; ++i) {
+				for (int l = 0; l < graph [i].links.Length; ++l)
+					graph [i].links [l] = rand.Next (3) == 0 ? (object)new object [2] : graph [rand.Next (nodes)];
+			}
+			// Keep a few graphs alive across collections
+			if ((r % 10) == 0)
+				kept.Add (graph);
+		}
+		return rounds * nodes;
+	}
+
+	static long Finalizers () {
+		long ops = 2000000L * scale;
+
+		for (long i = 0; i < ops; ++i)
+			new Finalizable ();
+		GC.Collect ();
+		GC.WaitForPendingFinalizers ();
+		return ops;
+	}
+
+	// Weak references to objects of which about half stay reachable
+	static long WeakReferences () {
+		var weak = new List<WeakReference> ();
+		var strong = new List<object> ();
+		long ops = 2000000L * scale;
+
+		for (long i = 0; i < ops; ++i) {
+			var o = new object [1];
+			weak.Add (new WeakReference (o, (i % 3) == 0));
+			if ((i & 1) == 0)
+				strong.Add (o);
+			if (weak.Count == 200000) {
+				weak = new List<WeakReference> ();
+				strong = new List<object> ();
+			}
+		}
+		return ops;
+	}
+
+	static long PeakRssKB () {
+		try {
+			foreach (var line in File.ReadAllLines ("/proc/self/status")) {
+				if (line.StartsWith ("VmHWM:"))
+					return long.Parse (line.Substring (6).Trim ().Split (' ') [0]);
+			}
+		} catch (IOException) {
+		} catch (UnauthorizedAccessException) {
+		}
+		return Process.GetCurrentProcess ().PeakWorkingSet64 / 1024;
+	}
+
+	static int Main (string[] args) {
+		var workloads = new Dictionary<string, Func<long>> {
+			{ "binary-trees", BinaryTrees },
+			{ "lru-cache", LruCache },
+			{ "large-arrays", LargeArrays },
+			{ "many-threads", ManyThreads },
+			{ "bridge", BridgeGraphs },
+			{ "finalizers", Finalizers },
+			{ "weak-references", WeakReferences },
+		};
+		Func<long> workload;
+
+		if (args.Length < 1 || !workloads.TryGetValue (args [0], out workload)) {
+			Console.Error.WriteLine ("Usage: gc-bench.exe WORKLOAD [SCALE]");
+			Console.Error.WriteLine ("Workloads: {0}", string.Join (", ", workloads.Keys));
+			return 1;
+		}
+		if (args.Length > 1)
+			scale = int.Parse (args [1]);
+
+		var sw = Stopwatch.StartNew ();
+		long ops = workload ();
+		sw.Stop ();
+
+		Console.WriteLine ("GC_BENCH_RESULT: workload {0} ops {1} time {2}ms peak_rss {3}K collections {4} {5} {6}",
+			args [0], ops, sw.ElapsedMilliseconds, PeakRssKB (),
+			GC.CollectionCount (0), GC.CollectionCount (1), GC.CollectionCount (2));
+		return 0;
+	}
+}
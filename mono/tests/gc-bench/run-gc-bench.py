@@ -0,0 +1,114 @@
+#!/usr/bin/env python
+#
+# Runs the gc-bench.exe workloads with the GC log enabled and reports, for
+# every workload, the throughput, the pause time distribution, the peak RSS
+# and how much the nursery collections promoted.
+#
+# Pause times and promotion come from the GC_MINOR/GC_MAJOR entries logged by
+# sgen-memory-governor.c, so they are what the runtime measured itself.
+#
+import json
+import os
+import re
+import subprocess
+import sys
+from optparse import OptionParser
+
+WORKLOADS = ['binary-trees', 'lru-cache', 'large-arrays', 'many-threads', 'bridge', 'finalizers', 'weak-references']
+
+parser = OptionParser (usage = "Usage: %prog [options] GC-BENCH-EXE")
+parser.add_option ('--mono', dest = 'mono', default = 'mono', help = "runtime to run the workloads with")
+parser.add_option ('--workloads', dest = 'workloads', default = ','.join (WORKLOADS), help = "comma separated workloads to run")
+parser.add_option ('--scale', dest = 'scale', type = 'int', default = 1, help = "multiply the work done by each workload")
+parser.add_option ('--gc-params', dest = 'gc_params', help = "MONO_GC_PARAMS for the runs")
+parser.add_option ('--json', dest = 'json', help = "also write the results as JSON to this file")
+(options, args) = parser.parse_args ()
+
+if len (args) != 1:
+    parser.print_help ()
+    sys.exit (1)
+
+result_re = re.compile (r'GC_BENCH_RESULT: workload (\S+) ops (\d+) time (\d+)ms peak_rss (\d+)K collections (\d+) (\d+) (\d+)')
+minor_re = re.compile (r'GC_MINOR(_OVERFLOW)?: \(.*?\) time ([\d.]+)ms, (?:stw ([\d.]+)ms)? promoted (\d+)K')
+major_re = re.compile (r'GC_MAJOR(?:_OVERFLOW|_CONCURRENT_FINISH)?: \(.*?\) time ([\d.]+)ms, (?:stw ([\d.]+)ms)? los size')
+
+def percentile (values, p):
+    if not values:
+        return 0.0
+    values = sorted (values)
+    return values [min (len (values) - 1, int (len (values) * p / 100.0))]
+
+def run_workload (workload):
+    env = dict (os.environ)
+    env ['MONO_LOG_LEVEL'] = 'info'
+    env ['MONO_LOG_MASK'] = 'gc'
+    if options.gc_params:
+        env ['MONO_GC_PARAMS'] = options.gc_params
+    if workload == 'bridge':
+        env ['MONO_GC_DEBUG'] = 'bridge=Bridge'
+
+    proc = subprocess.Popen ([options.mono, args [0], workload, str (options.scale)], env = env, stdout = subprocess.PIPE, stderr = subprocess.STDOUT, universal_newlines = True)
+    output = proc.communicate () [0]
+    if proc.returncode != 0:
+        sys.stderr.write ('Error: workload `%s` failed:\n%s\n' % (workload, output))
+        sys.exit (1)
+
+    result = None
+    minor_pauses = []
+    major_pauses = []
+    promoted_kb = 0
+    for line in output.splitlines ():
+        m = result_re.search (line)
+        if m:
+            result = m
+            continue
+        m = minor_re.search (line)
+        if m:
+            # Overflow entries don't have a separate stop the world time
+            minor_pauses.append (float (m.group (3) or m.group (2)))
+            promoted_kb += int (m.group (4))
+            continue
+        m = major_re.search (line)
+        if m:
+            major_pauses.append (float (m.group (2) or m.group (1)))
+
+    if not result:
+        sys.stderr.write ('Error: no result from workload `%s`.\n' % workload)
+        sys.exit (1)
+
+    ops = int (result.group (2))
+    time_ms = int (result.group (3))
+    pauses = minor_pauses + major_pauses
+    return {
+        'workload': workload,
+        'ops': ops,
+        'time_ms': time_ms,
+        'ops_per_sec': ops * 1000.0 / max (time_ms, 1),
+        'peak_rss_kb': int (result.group (4)),
+        'collections': [int (result.group (i)) for i in range (5, 8)],
+        'minor_count': len (minor_pauses),
+        'major_count': len (major_pauses),
+        'pause_total_ms': sum (pauses),
+        'pause_p50_ms': percentile (pauses, 50),
+        'pause_p99_ms': percentile (pauses, 99),
+        'pause_max_ms': max (pauses) if pauses else 0.0,
+        'promoted_kb': promoted_kb,
+        'promoted_kb_per_minor': promoted_kb / float (max (len (minor_pauses), 1)),
+        'promoted_mb_per_sec': promoted_kb / 1024.0 * 1000.0 / max (time_ms, 1),
+    }
+
+results = []
+for workload in options.workloads.split (','):
+    if workload not in WORKLOADS:
+        sys.stderr.write ('Error: unknown workload `%s`.\n' % workload)
+        sys.exit (1)
+    results.append (run_workload (workload))
+
+sys.stdout.write ('%-16s %12s %9s %8s %8s %8s %10s %7s %7s %11s\n' % ('workload', 'ops/s', 'time ms', 'p50 ms', 'p99 ms', 'max ms', 'rss KB', 'minors', 'majors', 'promo MB/s'))
+for r in results:
+    sys.stdout.write ('%-16s %12.0f %9d %8.2f %8.2f %8.2f %10d %7d %7d %11.2f\n' % (r ['workload'], r ['ops_per_sec'], r ['time_ms'],
+        r ['pause_p50_ms'], r ['pause_p99_ms'], r ['pause_max_ms'], r ['peak_rss_kb'], r ['minor_count'], r ['major_count'], r ['promoted_mb_per_sec']))
+
+if options.json:
+    with open (options.json, 'w') as f:
+        json.dump ({'gc_params': options.gc_params or '', 'scale': options.scale, 'results': results}, f, indent = 4)
@@ -4061,6 +4061,118 @@ done:
 	return ret;
 }
 
+/**
+ * test_method_thunk_unboxed:
+ *
+ * @test_id: the test number
+ * @test_method_handle: MonoMethod* of the thunks.cs:TestStruct test method
+ *
+ * Same as the TestStruct tests of test_method_thunk (), using the thunks
+ * returned by mono_method_get_unmanaged_thunk_unboxed ().
+ */
+LIBTEST_API int STDCALL  
+test_method_thunk_unboxed (int test_id, gpointer test_method_handle)
+{
+	int ret = 0;
+
+	gpointer (*mono_method_get_unmanaged_thunk_unboxed)(gpointer)
+		= (gpointer (*)(gpointer))lookup_mono_symbol ("mono_method_get_unmanaged_thunk_unboxed");
+
+	gpointer (*mono_threads_enter_gc_unsafe_region) (gpointer)
+		= (gpointer (*)(gpointer))lookup_mono_symbol ("mono_threads_enter_gc_unsafe_region");
+
+	void (*mono_threads_exit_gc_unsafe_region) (gpointer, gpointer)
+		= (void (*)(gpointer, gpointer))lookup_mono_symbol ("mono_threads_exit_gc_unsafe_region");
+
+	gpointer test_method, ex = NULL;
+	TestStruct s;
+
+	MONO_BEGIN_EFRAME;
+
+	if (!mono_method_get_unmanaged_thunk_unboxed) {
+		ret = 1;
+		goto done;
+	}
+
+	test_method = mono_method_get_unmanaged_thunk_unboxed (test_method_handle);
+	if (!test_method) {
+		ret = 2;
+		goto done;
+	}
+
+	switch (test_id) {
+
+	case 0: {
+		/* thunks.cs:TestStruct.Test0 */
+		int (STDCALL *F)(TestStruct*, gpointer*) = (int (STDCALL *)(TestStruct *, gpointer *))test_method;
+
+		s.A = 42;
+		s.B = 3.1415;
+
+		if (!F (&s, &ex) || ex) {
+			ret = 4;
+			goto done;
+		}
+
+		/* check whether the call was really by value */
+		if (s.A != 42 || s.B != 3.1415) {
+			ret = 5;
+			goto done;
+		}
+		break;
+	}
+
+	case 1:
+	case 2: {
+		/* thunks.cs:TestStruct.Test1, the struct is passed by ref */
+		/* thunks.cs:TestStruct.Test2, the struct is returned into the buffer */
+		void (STDCALL *F)(TestStruct*, gpointer*) = (void (STDCALL *)(TestStruct *, gpointer *))test_method;
+
+		memset (&s, 0, sizeof (s));
+
+		F (&s, &ex);
+		if (ex) {
+			ret = 4;
+			goto done;
+		}
+
+		if (s.A != 42 || !(fabs (s.B - 3.1415) < 0.001)) {
+			ret = 5;
+			goto done;
+		}
+		break;
+	}
+
+	case 3: {
+		/* thunks.cs:TestStruct.Test3 */
+		void (STDCALL *F)(TestStruct*, gpointer*) = (void (STDCALL *)(TestStruct *, gpointer *))test_method;
+
+		s.A = 42;
+		s.B = 3.1415;
+
+		F (&s, &ex);
+		if (ex) {
+			ret = 4;
+			goto done;
+		}
+
+		if (s.A != 1 || s.B != 17) {
+			ret = 5;
+			goto done;
+		}
+		break;
+	}
+
+	default:
+		ret = 9;
+	}
+
+done:
+	MONO_END_EFRAME;
+
+	return ret;
+}
+
 typedef struct 
 {
 	char a;
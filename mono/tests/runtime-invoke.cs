@@ -265,4 +265,57 @@ class Tests
 		return 0;
 	}
 
+	public struct Point {
+		public int x, y;
+	}
+
+	public static Point add_points (Point a, Point b) {
+		Point res;
+		res.x = a.x + b.x;
+		res.y = a.y + b.y;
+		return res;
+	}
+
+	public static int? nullable_ret (int? a) {
+		return a;
+	}
+
+	public string concat (string s, int i, double d) {
+		return s + i + d;
+	}
+
+	public static int test_0_repeated_invoke () {
+		/* Repeated invokes go through a specialized invoke wrapper after a while */
+		MethodInfo add = typeof (Tests).GetMethod ("add_points");
+		MethodInfo nullable = typeof (Tests).GetMethod ("nullable_ret");
+		MethodInfo concat = typeof (Tests).GetMethod ("concat");
+		Tests t = new Tests ();
+
+		for (int i = 0; i < 100; ++i) {
+			Point a = new Point (), b = new Point ();
+			a.x = i;
+			a.y = 1;
+			b.x = 2;
+			b.y = i;
+			Point p = (Point)add.Invoke (null, new object [] { a, b });
+			if (p.x != i + 2 || p.y != i + 1)
+				return 1;
+
+			/* null vtype arguments are replaced by a default instance */
+			object[] args = new object [] { null, b };
+			p = (Point)add.Invoke (null, args);
+			if (p.x != 2 || p.y != i || args [0] == null)
+				return 2;
+
+			if ((int)nullable.Invoke (null, new object [] { i }) != i)
+				return 3;
+			if (nullable.Invoke (null, new object [] { null }) != null)
+				return 4;
+
+			if ((string)concat.Invoke (t, new object [] { "A", i, 0.5 }) != "A" + i + 0.5)
+				return 5;
+		}
+		return 0;
+	}
+
 }
@@ -8,6 +8,9 @@ public class Test
 		public static extern int test_method_thunk (int test_id, IntPtr testMethodHandle,
 		IntPtr createObjectHandle);
 
+	[DllImport ("libtest")]
+		public static extern int test_method_thunk_unboxed (int test_id, IntPtr testMethodHandle);
+
 	static void RunTests(int series, Type type)
 	{
 		const string Prefix = "Test";
@@ -29,10 +32,31 @@ public class Test
 		}
 	}
 
+	static void RunUnboxedTests (Type type)
+	{
+		const string Prefix = "Test";
+
+		foreach (MethodInfo mi in type.GetMethods ()) {
+			string name = mi.Name;
+			if (!name.StartsWith (Prefix))
+				continue;
+
+			int id = Convert.ToInt32 (name.Substring (Prefix.Length));
+
+			int res = test_method_thunk_unboxed (id, mi.MethodHandle.Value);
+
+			if (res != 0) {
+				Console.WriteLine ("{0} (unboxed) returned {1}", mi, res);
+				Environment.Exit ((id << 3) + res);
+			}
+		}
+	}
+
 	public static int Main ()
 	{
 		RunTests (0, typeof (Test));
 		RunTests (100, typeof (TestStruct));
+		RunUnboxedTests (typeof (TestStruct));
 		return 0;
 	}
 
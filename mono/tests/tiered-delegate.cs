@@ -0,0 +1,73 @@
+using System;
+using System.Threading;
+using System.Runtime.CompilerServices;
+
+/*
+ * Delegates and function pointers created while their target is still tier 0
+ * code must keep working after the target is promoted to tier 1, and so must
+ * the ones created afterwards. Run with a low --tiered threshold.
+ */
+class Counter {
+	public int total;
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	public int Add (int n) {
+		total += n;
+		return total;
+	}
+}
+
+class Driver {
+	const int Rounds = 20;
+	const int Calls = 1000;
+
+	[MethodImplAttribute (MethodImplOptions.NoInlining)]
+	static int Sum (int a, int b) {
+		int res = 0;
+		for (int i = 0; i < a; ++i)
+			res += b;
+		return res;
+	}
+
+	static int Check (Func<int, int, int> f, int round) {
+		for (int i = 0; i < Calls; ++i) {
+			if (f (i % 7, round) != (i % 7) * round)
+				return 1;
+		}
+		return 0;
+	}
+
+	static int Main () {
+		/* Created and invoked while Sum is tier 0 code */
+		Func<int, int, int> early = Sum;
+		if (early (3, 4) != 12)
+			return 1;
+
+		var counter = new Counter ();
+		Func<int, int> early_add = counter.Add;
+		int expected = 0;
+
+		for (int round = 1; round <= Rounds; ++round) {
+			if (Check (early, round) != 0)
+				return 2;
+
+			/* Created after the promotion was requested, and maybe after the tier 1 code replaced the tier 0 code */
+			Func<int, int, int> late = Sum;
+			if (Check (late, round) != 0)
+				return 3;
+
+			for (int i = 0; i < Calls; ++i) {
+				expected += round;
+				if (early_add (round) != expected)
+					return 4;
+			}
+
+			/* Give the tiered compilation thread time to finish */
+			Thread.Sleep (10);
+		}
+
+		if (Sum (6, 7) != 42)
+			return 5;
+		return 0;
+	}
+}
@@ -61,6 +61,39 @@ struct DoubleStruct {
 	public DoubleStruct (double x) { this.x = x; }
 }
 
+enum Color : byte {
+	Red, Green
+}
+
+struct Inner {
+	public short s;
+	public string name;
+	public Inner (short s, string name) { this.s = s; this.name = name; }
+}
+
+struct Mixed {
+	public byte b;
+	public Color color;
+	public int i;
+	public long l;
+	public double d;
+	public string str;
+	public object obj;
+	public Inner inner;
+	public decimal dec;
+
+	public Mixed (int i, string str, object obj, double d, string inner_name) {
+		b = 1;
+		color = Color.Green;
+		this.i = i;
+		l = -1;
+		this.d = d;
+		this.str = str;
+		this.obj = obj;
+		inner = new Inner (7, inner_name);
+		dec = 1.5m;
+	}
+}
 
 public class Driver {
 	static void AssertEqual (object a, object b) {
@@ -73,6 +106,29 @@ public class Driver {
 			throw new Exception (String.Format ("must not be equal {0} {1}", a, b));
 	}
 
+	/* Constrained calls, which the JIT replaces by specialized versions of the ValueType methods */
+	static bool GenericEquals<T> (T a, T b) {
+		return a.Equals (b);
+	}
+
+	static int GenericHashCode<T> (T a) {
+		return a.GetHashCode ();
+	}
+
+	static void AssertGenericEqual<T> (T a, T b) {
+		if (!GenericEquals (a, b) || !((object)a).Equals (b))
+			throw new Exception (String.Format ("must be equal {0} {1}", a, b));
+		if (GenericHashCode (a) != ((object)a).GetHashCode () || GenericHashCode (a) != GenericHashCode (b))
+			throw new Exception (String.Format ("hash codes must be equal {0} {1}", a, b));
+	}
+
+	static void AssertGenericNotEqual<T> (T a, T b) {
+		if (GenericEquals (a, b) || ((object)a).Equals (b))
+			throw new Exception (String.Format ("must not be equal {0} {1}", a, b));
+		if (GenericHashCode (a) != ((object)a).GetHashCode ())
+			throw new Exception (String.Format ("hash codes must be equal {0}", a));
+	}
+
 	public static int Main () {
 		AssertEqual (new BoolStruct (true), new BoolStruct (true));
 		AssertNotEqual (new BoolStruct (false), new BoolStruct (true));
@@ -130,6 +186,25 @@ public class Driver {
 		AssertNotEqual (new DoubleStruct (44), new DoubleStruct (1));
 		AssertNotEqual (new DoubleStruct (0), new DoubleStruct (55));
 
+		var key = new object ();
+		AssertGenericEqual (new Mixed (1, "a", key, 2.5, "x"), new Mixed (1, "a", key, 2.5, "x"));
+		AssertGenericEqual (new Mixed (1, null, null, 2.5, null), new Mixed (1, null, null, 2.5, null));
+		AssertGenericEqual (new Mixed (1, "a", 42, 2.5, "x"), new Mixed (1, new string ('a', 1), 42, 2.5, "x"));
+		AssertGenericNotEqual (new Mixed (1, "a", key, 2.5, "x"), new Mixed (2, "a", key, 2.5, "x"));
+		AssertGenericNotEqual (new Mixed (1, "a", key, 2.5, "x"), new Mixed (1, "b", key, 2.5, "x"));
+		AssertGenericNotEqual (new Mixed (1, "a", key, 2.5, "x"), new Mixed (1, "a", new object (), 2.5, "x"));
+		AssertGenericNotEqual (new Mixed (1, "a", null, 2.5, "x"), new Mixed (1, "a", key, 2.5, "x"));
+		AssertGenericNotEqual (new Mixed (1, "a", key, 2.5, "x"), new Mixed (1, "a", key, 2.5, "y"));
+		AssertGenericNotEqual (new Mixed (1, "a", key, double.NaN, "x"), new Mixed (1, "a", key, double.NaN, "x"));
+		var m = new Mixed (1, "a", key, 2.5, "x");
+		m.color = Color.Red;
+		AssertGenericNotEqual (m, new Mixed (1, "a", key, 2.5, "x"));
+		m = new Mixed (1, "a", key, 2.5, "x");
+		m.dec = 2;
+		AssertGenericNotEqual (m, new Mixed (1, "a", key, 2.5, "x"));
+		AssertGenericEqual (new Inner (1, "a"), new Inner (1, "a"));
+		AssertGenericNotEqual (new Inner (1, "a"), new Inner (2, "a"));
+
 		return 0;
 	}
 }
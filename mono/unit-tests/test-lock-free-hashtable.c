@@ -0,0 +1,219 @@
+/*
+ * test-lock-free-hashtable.c: Unit test for the lock free hashtable.
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include "config.h"
+
+#include "utils/mono-threads.h"
+#include "utils/lock-free-hashtable.h"
+#include "utils/checked-build.h"
+#include "utils/w32handle.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <pthread.h>
+
+/* Values need their low bit clear */
+#define VALUE(i) GINT_TO_POINTER ((i) * 2)
+
+static int
+serial (void)
+{
+	MonoLockFreeHashTable *h;
+	int i, res = 0;
+
+	h = mono_lock_free_hashtable_new (NULL, NULL);
+
+	/* Enough to resize a couple of times */
+	for (i = 1; i < 1000; ++i) {
+		if (mono_lock_free_hashtable_insert (h, GINT_TO_POINTER (i), VALUE (i)) != NULL) {
+			res = 1;
+			goto done;
+		}
+	}
+	if (mono_lock_free_hashtable_insert (h, GINT_TO_POINTER (10), VALUE (11)) != VALUE (10))
+		res = 2;
+	if (mono_lock_free_hashtable_replace (h, GINT_TO_POINTER (10), VALUE (11)) != VALUE (10))
+		res = 3;
+	if (mono_lock_free_hashtable_lookup (h, GINT_TO_POINTER (10)) != VALUE (11))
+		res = 4;
+	if (mono_lock_free_hashtable_remove (h, GINT_TO_POINTER (10)) != VALUE (11))
+		res = 5;
+	if (mono_lock_free_hashtable_lookup (h, GINT_TO_POINTER (10)) != NULL)
+		res = 6;
+	if (mono_lock_free_hashtable_remove (h, GINT_TO_POINTER (10)) != NULL)
+		res = 7;
+	if (mono_lock_free_hashtable_insert (h, GINT_TO_POINTER (10), VALUE (12)) != NULL)
+		res = 8;
+	if (mono_lock_free_hashtable_lookup (h, GINT_TO_POINTER (10)) != VALUE (12))
+		res = 9;
+
+	for (i = 1; i < 1000; ++i) {
+		if (i != 10 && mono_lock_free_hashtable_lookup (h, GINT_TO_POINTER (i)) != VALUE (i)) {
+			res = 10;
+			break;
+		}
+	}
+
+	/* Churn through keys, so the table fills up with tombstones */
+	for (i = 1000; i < 10000; ++i) {
+		mono_lock_free_hashtable_insert (h, GINT_TO_POINTER (i), VALUE (i));
+		if (mono_lock_free_hashtable_remove (h, GINT_TO_POINTER (i)) != VALUE (i)) {
+			res = 11;
+			break;
+		}
+	}
+	if (mono_lock_free_hashtable_lookup (h, GINT_TO_POINTER (999)) != VALUE (999))
+		res = 12;
+
+done:
+	mono_lock_free_hashtable_destroy (h);
+	if (res)
+		printf ("SERIAL TEST FAILED %d\n", res);
+	return res;
+}
+
+static MonoLockFreeHashTable *hash;
+static volatile int running;
+
+static void*
+insert_race_thread (void *arg)
+{
+	int i, winner = GPOINTER_TO_INT (arg);
+	mono_thread_info_attach ((gpointer)&arg);
+
+	/* All threads insert the same keys, exactly one of them must win each */
+	for (i = 1; i < 10000; ++i) {
+		gpointer old = mono_lock_free_hashtable_insert (hash, GINT_TO_POINTER (i), VALUE (i * 4 + winner));
+		if (old && ((GPOINTER_TO_INT (old) / 2) >> 2) != i)
+			return GINT_TO_POINTER (i);
+	}
+	return NULL;
+}
+
+static int
+parallel_insert (void)
+{
+	pthread_t a, b, c;
+	gpointer ra, rb, rc;
+	int i, res = 0;
+
+	hash = mono_lock_free_hashtable_new (NULL, NULL);
+
+	pthread_create (&a, NULL, insert_race_thread, GINT_TO_POINTER (1));
+	pthread_create (&b, NULL, insert_race_thread, GINT_TO_POINTER (2));
+	pthread_create (&c, NULL, insert_race_thread, GINT_TO_POINTER (3));
+
+	pthread_join (a, &ra);
+	pthread_join (b, &rb);
+	pthread_join (c, &rc);
+	res = GPOINTER_TO_INT (ra) + GPOINTER_TO_INT (rb) + GPOINTER_TO_INT (rc);
+
+	for (i = 1; i < 10000 && !res; ++i) {
+		int val = GPOINTER_TO_INT (mono_lock_free_hashtable_lookup (hash, GINT_TO_POINTER (i))) / 2;
+		if ((val >> 2) != i)
+			res = i;
+	}
+
+	mono_lock_free_hashtable_destroy (hash);
+	if (res)
+		printf ("PARALLEL_INSERT TEST FAILED %d\n", res);
+	return res;
+}
+
+static void*
+reader_thread (void *arg)
+{
+	int key;
+	mono_thread_info_attach ((gpointer)&arg);
+
+	while (running) {
+		for (key = 1; key < 3 * 1000 + 1; key++) {
+			int val = GPOINTER_TO_INT (mono_lock_free_hashtable_lookup (hash, GINT_TO_POINTER (key)));
+			if (val && val != GPOINTER_TO_INT (VALUE (key)))
+				return GINT_TO_POINTER (key);
+		}
+	}
+	return NULL;
+}
+
+static void*
+writer_thread (void *arg)
+{
+	int i, j, idx = 1000 * GPOINTER_TO_INT (arg);
+	mono_thread_info_attach ((gpointer)&arg);
+
+	for (j = 0; j < 20; ++j) {
+		for (i = idx + 1; i <= idx + 1000; i++)
+			mono_lock_free_hashtable_insert (hash, GINT_TO_POINTER (i), VALUE (i));
+		for (i = idx + 1; i <= idx + 1000; i++) {
+			if (mono_lock_free_hashtable_remove (hash, GINT_TO_POINTER (i)) != VALUE (i))
+				return GINT_TO_POINTER (i);
+		}
+	}
+	return NULL;
+}
+
+static int
+parallel_writer_parallel_reader (void)
+{
+	pthread_t wa, wb, wc, ra, rb;
+	gpointer a, b, c, d, e;
+	int res;
+
+	hash = mono_lock_free_hashtable_new (NULL, NULL);
+	running = 1;
+
+	pthread_create (&ra, NULL, reader_thread, NULL);
+	pthread_create (&rb, NULL, reader_thread, NULL);
+	pthread_create (&wa, NULL, writer_thread, GINT_TO_POINTER (0));
+	pthread_create (&wb, NULL, writer_thread, GINT_TO_POINTER (1));
+	pthread_create (&wc, NULL, writer_thread, GINT_TO_POINTER (2));
+
+	pthread_join (wa, &a);
+	pthread_join (wb, &b);
+	pthread_join (wc, &c);
+	running = 0;
+	pthread_join (ra, &d);
+	pthread_join (rb, &e);
+
+	res = GPOINTER_TO_INT (a) + GPOINTER_TO_INT (b) + GPOINTER_TO_INT (c) + GPOINTER_TO_INT (d) + GPOINTER_TO_INT (e);
+
+	mono_lock_free_hashtable_destroy (hash);
+	if (res)
+		printf ("PAR_WRITER_PAR_READER TEST FAILED %d\n", res);
+	return res;
+}
+
+static void
+thread_state_init (MonoThreadUnwindState *ctx)
+{
+}
+
+int
+main (void)
+{
+	MonoThreadInfoCallbacks cb = { NULL };
+	MonoThreadInfoRuntimeCallbacks ticallbacks;
+	int res = 0;
+
+	CHECKED_MONO_INIT ();
+	mono_threads_init (&cb, sizeof (MonoThreadInfo));
+	memset (&ticallbacks, 0, sizeof (ticallbacks));
+	ticallbacks.thread_state_init = thread_state_init;
+	mono_threads_runtime_init (&ticallbacks);
+#ifndef HOST_WIN32
+	mono_w32handle_init ();
+#endif
+
+	mono_thread_info_attach ((gpointer)&cb);
+
+	res += serial ();
+	res += parallel_insert ();
+	res += parallel_writer_parallel_reader ();
+
+	return res;
+}
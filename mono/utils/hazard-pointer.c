@@ -8,6 +8,7 @@
 #include <config.h>
 
 #include <string.h>
+#include <stdlib.h>
 
 #include <mono/utils/hazard-pointer.h>
 #include <mono/utils/mono-membar.h>
@@ -61,6 +62,25 @@ static int highest_small_id = -1;
 static MonoBitSet *small_id_table;
 static int hazardous_pointer_count;
 
+/*
+ * Epoch based reclamation. Retired pointers go into the limbo queue of the
+ * epoch they were retired in. The number of queues is a power of two, so the
+ * queue index stays right when the epoch counter wraps around.
+ */
+#define EPOCH_LIMBO_COUNT	4
+/* How many retired pointers between attempts to advance the epoch */
+#define EPOCH_ADVANCE_INTERVAL	64
+
+static volatile guint32 global_epoch;
+static volatile gint32 epoch_retired_count;
+static mono_mutex_t epoch_mutex;
+static MonoLockFreeArrayQueue epoch_limbo [EPOCH_LIMBO_COUNT] = {
+	MONO_LOCK_FREE_ARRAY_QUEUE_INIT (sizeof (DelayedFreeItem)),
+	MONO_LOCK_FREE_ARRAY_QUEUE_INIT (sizeof (DelayedFreeItem)),
+	MONO_LOCK_FREE_ARRAY_QUEUE_INIT (sizeof (DelayedFreeItem)),
+	MONO_LOCK_FREE_ARRAY_QUEUE_INIT (sizeof (DelayedFreeItem))
+};
+
 /*
  * Allocate a small thread id.
  *
@@ -149,6 +169,9 @@ mono_thread_small_id_free (int id)
 	g_assert (mono_bitset_test_fast (small_id_table, id));
 	mono_bitset_clear_fast (small_id_table, id);
 
+	g_assert (!hazard_table [id].epoch_nesting);
+	hazard_table [id].epoch = 0;
+
 	mono_os_mutex_unlock (&small_id_mutex);
 }
 
@@ -171,6 +194,62 @@ is_pointer_hazardous (gpointer p)
 	return FALSE;
 }
 
+/*
+ * A sorted copy of all the hazard pointers, so a batch of pointers can be
+ * checked against it with a single scan of the hazard table.
+ */
+typedef struct {
+	gpointer *pointers;
+	int count;
+} HazardSnapshot;
+
+static int
+compare_pointers (const void *a, const void *b)
+{
+	gsize pa = (gsize)*(const gpointer*)a;
+	gsize pb = (gsize)*(const gpointer*)b;
+
+	return pa < pb ? -1 : pa > pb ? 1 : 0;
+}
+
+static void
+hazard_snapshot_take (HazardSnapshot *snapshot)
+{
+	int i, j;
+	int highest = highest_small_id;
+
+	g_assert (highest < hazard_table_size);
+
+	snapshot->pointers = g_new (gpointer, (highest + 1) * HAZARD_POINTER_COUNT);
+	snapshot->count = 0;
+
+	/* The pointers we check were made unreachable before this */
+	mono_memory_barrier ();
+
+	for (i = 0; i <= highest; ++i) {
+		for (j = 0; j < HAZARD_POINTER_COUNT; ++j) {
+			gpointer p = hazard_table [i].hazard_pointers [j];
+			if (p)
+				snapshot->pointers [snapshot->count++] = p;
+			LOAD_LOAD_FENCE;
+		}
+	}
+
+	qsort (snapshot->pointers, snapshot->count, sizeof (gpointer), compare_pointers);
+}
+
+static gboolean
+hazard_snapshot_contains (HazardSnapshot *snapshot, gpointer p)
+{
+	return bsearch (&p, snapshot->pointers, snapshot->count, sizeof (gpointer), compare_pointers) != NULL;
+}
+
+static void
+hazard_snapshot_free (HazardSnapshot *snapshot)
+{
+	g_free (snapshot->pointers);
+}
+
 MonoThreadHazardPointers*
 mono_hazard_pointer_get (void)
 {
@@ -348,39 +427,143 @@ mono_hazard_pointer_install_free_queue_size_callback (MonoHazardFreeQueueSizeCal
 static void
 try_free_delayed_free_items (guint32 limit)
 {
-	GArray *hazardous = NULL;
+	GArray *batch = NULL;
+	HazardSnapshot snapshot;
 	DelayedFreeItem item;
-	guint32 freed = 0;
 
-	// Free all the items we can and re-add the ones we can't to the queue.
-	while (mono_lock_free_array_queue_pop (&delayed_free_queue, &item)) {
-		if (is_pointer_hazardous (item.p)) {
-			if (!hazardous)
-				hazardous = g_array_sized_new (FALSE, FALSE, sizeof (DelayedFreeItem), delayed_free_queue.num_used_entries);
+	// Take the items out of the queue first, so the hazard table only has to be scanned once for all of them.
+	while ((!limit || !batch || batch->len < limit) && mono_lock_free_array_queue_pop (&delayed_free_queue, &item)) {
+		if (!batch)
+			batch = g_array_sized_new (FALSE, FALSE, sizeof (DelayedFreeItem), limit ? limit : delayed_free_queue.num_used_entries + 1);
 
-			g_array_append_val (hazardous, item);
-			continue;
-		}
+		g_array_append_val (batch, item);
+	}
 
-		item.free_func (item.p);
-		freed++;
+	if (!batch)
+		return;
 
-		if (limit && freed == limit)
-			break;
+	// Free all the items we can and re-add the ones we can't to the queue.
+	hazard_snapshot_take (&snapshot);
+
+	for (gint i = 0; i < batch->len; i++) {
+		item = g_array_index (batch, DelayedFreeItem, i);
+
+		if (hazard_snapshot_contains (&snapshot, item.p))
+			mono_lock_free_array_queue_push (&delayed_free_queue, &item);
+		else
+			item.free_func (item.p);
 	}
 
-	if (hazardous) {
-		for (gint i = 0; i < hazardous->len; i++)
-			mono_lock_free_array_queue_push (&delayed_free_queue, &g_array_index (hazardous, DelayedFreeItem, i));
+	hazard_snapshot_free (&snapshot);
+	g_array_free (batch, TRUE);
+}
+
+/*
+ * Free what was retired in the previous epoch and move to the next one, if
+ * all the threads in a critical section entered it in the current epoch.
+ */
+static void
+epoch_try_advance (void)
+{
+	DelayedFreeItem item;
+	guint32 epoch, active;
+	int i, highest;
+
+	if (mono_os_mutex_trylock (&epoch_mutex) != 0)
+		return;
+
+	epoch = global_epoch;
+	active = (epoch << 1) | 1;
 
-		g_array_free (hazardous, TRUE);
+	mono_memory_barrier ();
+
+	highest = highest_small_id;
+	for (i = 0; i <= highest; ++i) {
+		guint32 e = hazard_table [i].epoch;
+		if (e && e != active)
+			goto done;
 	}
+
+	/*
+	 * Threads can only have reached pointers retired in the previous epoch if
+	 * they entered their critical section before the current epoch started.
+	 */
+	while (mono_lock_free_array_queue_pop (&epoch_limbo [(epoch - 1) % EPOCH_LIMBO_COUNT], &item))
+		item.free_func (item.p);
+
+	mono_memory_barrier ();
+	global_epoch = epoch + 1;
+
+done:
+	mono_os_mutex_unlock (&epoch_mutex);
+}
+
+/**
+ * mono_thread_epoch_enter:
+ *
+ * Start a critical section, pointers retired with mono_thread_epoch_retire ()
+ * while the thread is in it won't be freed until it calls mono_thread_epoch_exit ().
+ * Critical sections can be nested.
+ */
+void
+mono_thread_epoch_enter (void)
+{
+	MonoThreadHazardPointers *hp = mono_hazard_pointer_get ();
+
+	if (hp->epoch_nesting++)
+		return;
+
+	hp->epoch = (global_epoch << 1) | 1;
+	/* The epoch must be visible before we read any of the shared pointers */
+	mono_memory_barrier ();
+}
+
+void
+mono_thread_epoch_exit (void)
+{
+	MonoThreadHazardPointers *hp = mono_hazard_pointer_get ();
+
+	g_assert (hp->epoch_nesting > 0);
+	if (--hp->epoch_nesting)
+		return;
+
+	mono_memory_barrier ();
+	hp->epoch = 0;
+}
+
+/**
+ * mono_thread_epoch_retire:
+ * @p: the pointer to free
+ * @free_func: the function that can free the pointer
+ *
+ * Free @p once all the threads which might still access it have left their
+ * critical sections. @p must already be unreachable for threads entering a
+ * new one.
+ *
+ * @free_func might be called by any thread retiring a pointer or pumping the
+ * hazard free queue, so it must be safe to call from all of those contexts.
+ */
+void
+mono_thread_epoch_retire (gpointer p, MonoHazardousFreeFunc free_func)
+{
+	DelayedFreeItem item = { p, free_func };
+
+	/* Pointers pushed with a stale epoch are only freed later, which is safe */
+	mono_memory_barrier ();
+	mono_lock_free_array_queue_push (&epoch_limbo [global_epoch % EPOCH_LIMBO_COUNT], &item);
+
+	if (InterlockedIncrement (&epoch_retired_count) % EPOCH_ADVANCE_INTERVAL == 0)
+		epoch_try_advance ();
 }
 
 void
 mono_thread_hazardous_try_free_all (void)
 {
 	try_free_delayed_free_items (0);
+
+	/* Twice, to get to the pointers retired in the current epoch too */
+	epoch_try_advance ();
+	epoch_try_advance ();
 }
 
 void
@@ -395,6 +578,7 @@ mono_thread_smr_init (void)
 	int i;
 
 	mono_os_mutex_init_recursive(&small_id_mutex);
+	mono_os_mutex_init (&epoch_mutex);
 	mono_counters_register ("Hazardous pointers", MONO_COUNTER_JIT | MONO_COUNTER_INT, &hazardous_pointer_count);
 
 	for (i = 0; i < HAZARD_TABLE_OVERFLOW; ++i) {
@@ -406,9 +590,13 @@ mono_thread_smr_init (void)
 void
 mono_thread_smr_cleanup (void)
 {
+	int i;
+
 	mono_thread_hazardous_try_free_all ();
 
 	mono_lock_free_array_queue_cleanup (&delayed_free_queue);
+	for (i = 0; i < EPOCH_LIMBO_COUNT; ++i)
+		mono_lock_free_array_queue_cleanup (&epoch_limbo [i]);
 
 	/*FIXME, can't we release the small id table here?*/
 }
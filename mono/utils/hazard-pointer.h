@@ -16,6 +16,9 @@
 
 typedef struct {
 	gpointer hazard_pointers [HAZARD_POINTER_COUNT];
+	/* Epoch the thread entered its critical section in, see mono_thread_epoch_enter () */
+	volatile guint32 epoch;
+	int epoch_nesting;
 } MonoThreadHazardPointers;
 
 typedef void (*MonoHazardousFreeFunc) (gpointer p);
@@ -44,6 +47,17 @@ gpointer mono_get_hazardous_pointer (gpointer volatile *pp, MonoThreadHazardPoin
 	} while (0)
 
 
+/*
+ * Epoch based reclamation, for data structures whose readers go through many
+ * nodes, where publishing each of them in a hazard pointer is too costly.
+ * Readers bracket the whole traversal with mono_thread_epoch_enter () and
+ * mono_thread_epoch_exit (), and retired nodes are freed once no thread can
+ * be in a critical section which started before they were unlinked.
+ */
+MONO_API void mono_thread_epoch_enter (void);
+MONO_API void mono_thread_epoch_exit (void);
+MONO_API void mono_thread_epoch_retire (gpointer p, MonoHazardousFreeFunc free_func);
+
 void mono_thread_small_id_free (int id);
 int mono_thread_small_id_alloc (void);
 
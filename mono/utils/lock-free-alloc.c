@@ -64,6 +64,7 @@
 
 #include <glib.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <mono/utils/atomic.h>
 #ifdef SGEN_WITHOUT_MONO
@@ -509,6 +510,119 @@ mono_lock_free_free (gpointer ptr, size_t block_size)
 	}
 }
 
+/*
+ * Take up to @n slots from a descriptor with a single CAS on its anchor.
+ * Owning the descriptor means no other allocation can pop from its free
+ * list, so the list can be walked safely.  Concurrent frees only push new
+ * heads, which makes our CAS fail and the walk restart.
+ */
+static unsigned int
+alloc_batch_from_active_or_partial (MonoLockFreeAllocator *heap, gpointer *slots, unsigned int n)
+{
+	Descriptor *desc;
+	Anchor old_anchor, new_anchor;
+	unsigned int i;
+
+ retry:
+	desc = heap->active;
+	if (desc) {
+		if (InterlockedCompareExchangePointer ((gpointer * volatile)&heap->active, NULL, desc) != desc)
+			goto retry;
+	} else {
+		desc = heap_get_partial (heap);
+		if (!desc)
+			return 0;
+	}
+
+	/* Now we own the desc. */
+
+	do {
+		unsigned int avail;
+		new_anchor = old_anchor = *(volatile Anchor*)&desc->anchor.value;
+		if (old_anchor.data.state == STATE_EMPTY) {
+			/* We must free it because we own it. */
+			desc_retire (desc);
+			goto retry;
+		}
+		g_assert (old_anchor.data.state == STATE_PARTIAL);
+		g_assert (old_anchor.data.count > 0);
+
+		mono_memory_read_barrier ();
+
+		avail = old_anchor.data.avail;
+		for (i = 0; i < n && i < old_anchor.data.count; ++i) {
+			slots [i] = (char*)desc->sb + avail * desc->slot_size;
+			avail = *(unsigned int*)slots [i];
+		}
+		g_assert (i == old_anchor.data.count || avail < LOCK_FREE_ALLOC_SB_USABLE_SIZE (desc->block_size) / desc->slot_size);
+
+		new_anchor.data.avail = avail;
+		new_anchor.data.count -= i;
+
+		if (new_anchor.data.count == 0)
+			new_anchor.data.state = STATE_FULL;
+	} while (!set_anchor (desc, old_anchor, new_anchor));
+
+	/* If the desc is partial we have to give it back. */
+	if (new_anchor.data.state == STATE_PARTIAL) {
+		if (InterlockedCompareExchangePointer ((gpointer * volatile)&heap->active, desc, NULL) != NULL)
+			heap_put_partial (desc);
+	}
+
+	return i;
+}
+
+void
+mono_lock_free_alloc_cache_init (MonoLockFreeAllocCache *cache, MonoLockFreeAllocator *heap)
+{
+	cache->heap = heap;
+	cache->count = 0;
+}
+
+/*
+ * Allocations and frees through a cache only touch the shared descriptors
+ * when the cache runs empty or full, and then move half a cache's worth of
+ * slots at a time.
+ */
+gpointer
+mono_lock_free_alloc_cached (MonoLockFreeAllocCache *cache)
+{
+	if (G_LIKELY (cache->count))
+		return cache->slots [--cache->count];
+
+	cache->count = alloc_batch_from_active_or_partial (cache->heap, cache->slots, LOCK_FREE_ALLOC_CACHE_SIZE / 2);
+	if (cache->count)
+		return cache->slots [--cache->count];
+
+	return mono_lock_free_alloc (cache->heap);
+}
+
+void
+mono_lock_free_free_cached (MonoLockFreeAllocCache *cache, gpointer ptr)
+{
+	if (G_UNLIKELY (cache->count == LOCK_FREE_ALLOC_CACHE_SIZE)) {
+		unsigned int i, half = LOCK_FREE_ALLOC_CACHE_SIZE / 2;
+		size_t block_size = cache->heap->sc->block_size;
+
+		/* Give back the slots that have been in the cache the longest. */
+		for (i = 0; i < half; ++i)
+			mono_lock_free_free (cache->slots [i], block_size);
+		memmove (cache->slots, cache->slots + half, sizeof (gpointer) * (LOCK_FREE_ALLOC_CACHE_SIZE - half));
+		cache->count -= half;
+	}
+
+	cache->slots [cache->count++] = ptr;
+}
+
+void
+mono_lock_free_alloc_cache_flush (MonoLockFreeAllocCache *cache)
+{
+	size_t block_size = cache->heap->sc->block_size;
+
+	while (cache->count)
+		mono_lock_free_free (cache->slots [--cache->count], block_size);
+}
+
 #define g_assert_OR_PRINT(c, format, ...)	do {				\
 		if (!(c)) {						\
 			if (print)					\
@@ -43,6 +43,18 @@ typedef struct {
 	MonoLockFreeAllocSizeClass *sc;
 } MonoLockFreeAllocator;
 
+/*
+ * A per-thread cache of free slots for one allocator.  It must only be used
+ * by a single thread at a time, and flushed before it is abandoned.
+ */
+#define LOCK_FREE_ALLOC_CACHE_SIZE					32
+
+typedef struct {
+	MonoLockFreeAllocator *heap;
+	unsigned int count;
+	gpointer slots [LOCK_FREE_ALLOC_CACHE_SIZE];
+} MonoLockFreeAllocCache;
+
 #define LOCK_FREE_ALLOC_SB_MAX_SIZE					16384
 #define LOCK_FREE_ALLOC_SB_HEADER_SIZE				(sizeof (MonoLockFreeAllocator))
 #define LOCK_FREE_ALLOC_SB_USABLE_SIZE(block_size)	((block_size) - LOCK_FREE_ALLOC_SB_HEADER_SIZE)
@@ -53,6 +65,11 @@ MONO_API void mono_lock_free_allocator_init_allocator (MonoLockFreeAllocator *he
 MONO_API gpointer mono_lock_free_alloc (MonoLockFreeAllocator *heap);
 MONO_API void mono_lock_free_free (gpointer ptr, size_t block_size);
 
+MONO_API void mono_lock_free_alloc_cache_init (MonoLockFreeAllocCache *cache, MonoLockFreeAllocator *heap);
+MONO_API gpointer mono_lock_free_alloc_cached (MonoLockFreeAllocCache *cache);
+MONO_API void mono_lock_free_free_cached (MonoLockFreeAllocCache *cache, gpointer ptr);
+MONO_API void mono_lock_free_alloc_cache_flush (MonoLockFreeAllocCache *cache);
+
 MONO_API gboolean mono_lock_free_allocator_check_consistency (MonoLockFreeAllocator *heap);
 
 #endif
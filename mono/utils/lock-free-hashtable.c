@@ -0,0 +1,580 @@
+/*
+ * lock-free-hashtable.c: A fully concurrent hashtable
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+/*
+ * An open addressing table with linear probing, like MonoConcurrentHashTable,
+ * but modifications synchronize with CAS instead of an external lock.
+ *
+ * A key slot, once claimed with a CAS, is never reused for another key.
+ * Removal stores a tombstone in the value, and inserting the key again revives
+ * the slot. Values are only ever changed with a CAS.
+ *
+ * Resizing publishes a new table in table->next. Writers that see it copy a
+ * chunk of the old table before doing their own operation, so the copy is
+ * shared by everybody modifying the table. Copying a slot happens in three
+ * steps:
+ *
+ * - The value is frozen by setting its low bit. From then on no writer can
+ *   change it in the old table.
+ * - The frozen value is installed in the new table, but only if the key has
+ *   no value there yet.
+ * - The value is replaced by VALUE_MOVED.
+ *
+ * Empty slots are sealed by setting their key to KEY_MOVED, so nothing can be
+ * inserted into them anymore. A writer that runs into a frozen or moved slot
+ * finishes copying it and retries in the new table. A key therefore only gets
+ * a value in the new table once its slot in the old table can't change
+ * anymore. Lookups return frozen values, and go to the next table for moved
+ * and sealed slots. When all slots are copied, the new table replaces the old
+ * one, which is freed through hazard pointers.
+ *
+ * Only the current table may start a resize, so there are at most two tables
+ * at a time. HP0 protects the current table and HP1 the one it is being
+ * copied to.
+ */
+
+#include "lock-free-hashtable.h"
+#include <mono/utils/hazard-pointer.h>
+#include <mono/utils/atomic.h>
+#include <mono/utils/mono-membar.h>
+
+/* Configuration knobs. */
+
+#define INITIAL_SIZE 32
+#define LOAD_FACTOR 0.75f
+/* Number of slots a writer copies when it finds a resize in progress */
+#define COPY_CHUNK 64
+
+/* Key of an empty slot sealed by a resize */
+#define KEY_MOVED ((gpointer)(gssize)-1)
+/* Value of a removed entry */
+#define VALUE_TOMBSTONE ((gpointer)(gssize)-2)
+/* Value of a slot which has been copied to the next table */
+#define VALUE_MOVED ((gpointer)(gssize)-4)
+
+#define IS_FROZEN(v) (((gsize)(v)) & 1)
+#define FREEZE(v) ((gpointer)(((gsize)(v)) | 1))
+#define THAW(v) ((gpointer)(((gsize)(v)) & ~(gsize)1))
+#define IS_LIVE(v) ((v) && (v) != VALUE_TOMBSTONE)
+
+typedef struct {
+	gpointer volatile key;
+	gpointer volatile value;
+} key_value_pair;
+
+typedef struct _lf_table lf_table;
+struct _lf_table {
+	int table_size;
+	int overflow_count;
+	/* Number of key slots claimed */
+	volatile gint32 claimed;
+	/* Next chunk to copy and number of slots copied to next */
+	volatile gint32 copy_index;
+	volatile gint32 copied;
+	lf_table * volatile next;
+	key_value_pair *kvs;
+};
+
+struct _MonoLockFreeHashTable {
+	lf_table * volatile table; /* goes to HP0, table->next goes to HP1 */
+	GHashFunc hash_func;
+	GEqualFunc equal_func;
+	volatile gint32 element_count;
+};
+
+typedef enum {
+	PUT_IF_ABSENT,
+	PUT_REPLACE,
+	PUT_REMOVE,
+	/* Install a value copied from the previous table */
+	PUT_COPY
+} PutMode;
+
+typedef enum {
+	STATUS_DONE,
+	/* Continue in table->next */
+	STATUS_NEXT,
+	/* The table is full, start a resize */
+	STATUS_RESIZE,
+	/* A resize we are not protected against got in the way, start over */
+	STATUS_RESTART
+} OpStatus;
+
+static lf_table*
+lf_table_new (int size)
+{
+	lf_table *res = g_new0 (lf_table, 1);
+	res->table_size = size;
+	res->overflow_count = (int)(size * LOAD_FACTOR);
+	res->kvs = g_new0 (key_value_pair, size);
+	return res;
+}
+
+static void
+lf_table_free (gpointer ptr)
+{
+	lf_table *table = (lf_table *)ptr;
+	g_free (table->kvs);
+	g_free (table);
+}
+
+/* See mix_hash () in mono-conc-hashtable.c */
+static MONO_ALWAYS_INLINE int
+mix_hash (int hash)
+{
+	return ((hash * 215497) >> 16) ^ (hash * 1823231 + hash);
+}
+
+static MONO_ALWAYS_INLINE gboolean
+keys_equal (MonoLockFreeHashTable *hash_table, gpointer key, gpointer other)
+{
+	return key == other || (hash_table->equal_func && hash_table->equal_func (key, other));
+}
+
+static gpointer table_put (MonoLockFreeHashTable *hash_table, lf_table *table, lf_table *next, int reserved, int hash, gpointer key, gpointer value, PutMode mode, OpStatus *status);
+
+/*
+ * Copy slot @i of @table to table->next, which must be protected by the caller.
+ * Returns once the slot is moved or sealed.
+ */
+static void
+copy_slot (MonoLockFreeHashTable *hash_table, lf_table *table, int i)
+{
+	key_value_pair *kv = &table->kvs [i];
+	gpointer key, value;
+	OpStatus status;
+
+	for (;;) {
+		key = kv->key;
+		if (!key) {
+			if (InterlockedCompareExchangePointer (&kv->key, KEY_MOVED, NULL) == NULL)
+				return;
+			continue;
+		}
+		if (key == KEY_MOVED)
+			return;
+
+		value = kv->value;
+		if (value == VALUE_MOVED)
+			return;
+		if (!IS_FROZEN (value)) {
+			if (InterlockedCompareExchangePointer (&kv->value, FREEZE (value), value) != value)
+				continue;
+			value = FREEZE (value);
+		}
+
+		if (IS_LIVE (THAW (value)))
+			table_put (hash_table, table->next, NULL, 0, mix_hash (hash_table->hash_func (key)), key, THAW (value), PUT_COPY, &status);
+
+		InterlockedCompareExchangePointer (&kv->value, VALUE_MOVED, value);
+		return;
+	}
+}
+
+static void
+promote (MonoLockFreeHashTable *hash_table, lf_table *table)
+{
+	if (InterlockedCompareExchangePointer ((gpointer volatile*)&hash_table->table, table->next, table) == table)
+		mono_thread_hazardous_try_free (table, lf_table_free);
+}
+
+/*
+ * Copy a chunk of @table to table->next, or all of it if @all is set, and
+ * replace @table by the next table once everything is copied.
+ */
+static void
+help_copy (MonoLockFreeHashTable *hash_table, lf_table *table, gboolean all)
+{
+	int start, end, i;
+
+	if (all) {
+		/* Don't wait for other helpers, slots which are already moved are cheap to skip */
+		for (i = 0; i < table->table_size; ++i)
+			copy_slot (hash_table, table, i);
+		promote (hash_table, table);
+		return;
+	}
+
+	if (table->copy_index >= table->table_size)
+		return;
+	start = InterlockedAdd (&table->copy_index, COPY_CHUNK) - COPY_CHUNK;
+	if (start >= table->table_size)
+		return;
+	end = MIN (start + COPY_CHUNK, table->table_size);
+	for (i = start; i < end; ++i)
+		copy_slot (hash_table, table, i);
+	if (InterlockedAdd (&table->copied, end - start) == table->table_size)
+		promote (hash_table, table);
+}
+
+static void
+start_resize (MonoLockFreeHashTable *hash_table, lf_table *table)
+{
+	lf_table *next;
+	int size = table->table_size;
+
+	if (table->next)
+		return;
+
+	/* Tables filled up mostly by tombstones are copied to a table of the same size */
+	if (hash_table->element_count >= size / 4)
+		size *= 2;
+
+	next = lf_table_new (size);
+	if (InterlockedCompareExchangePointer ((gpointer volatile*)&table->next, next, NULL) != NULL)
+		lf_table_free (next);
+}
+
+/*
+ * Load the current table into HP0 and the table it's being copied to, if any,
+ * into HP1. Returns NULL if the tables changed under us.
+ */
+static lf_table*
+get_tables (MonoLockFreeHashTable *hash_table, MonoThreadHazardPointers *hp, lf_table **next)
+{
+	lf_table *table = (lf_table *)mono_get_hazardous_pointer ((gpointer volatile*)&hash_table->table, hp, 0);
+	lf_table *n = table->next;
+
+	if (n) {
+		mono_hazard_pointer_set (hp, 1, n);
+		mono_memory_barrier ();
+		/* n can only be freed once it has been the current table */
+		if (hash_table->table != table && hash_table->table != n) {
+			mono_hazard_pointer_clear (hp, 1);
+			return NULL;
+		}
+	}
+
+	*next = n;
+	return table;
+}
+
+/*
+ * Slots of @table can only be copied if @next is the table they are copied to,
+ * since that means it is protected.
+ */
+static MONO_ALWAYS_INLINE gboolean
+can_copy (lf_table *table, lf_table *next)
+{
+	return next && table->next == next;
+}
+
+/*
+ * Insert, replace or remove @key in @table. @next is the protected table @table is
+ * being copied to, if any. @reserved key slots are kept free for slots copied from
+ * the previous table.
+ */
+static gpointer
+table_put (MonoLockFreeHashTable *hash_table, lf_table *table, lf_table *next, int reserved, int hash, gpointer key, gpointer value, PutMode mode, OpStatus *status)
+{
+	key_value_pair *kvs = table->kvs;
+	int table_mask = table->table_size - 1;
+	int i = hash & table_mask;
+	int probes = 0;
+	gpointer k, v;
+
+	*status = STATUS_DONE;
+
+	for (;;) {
+		k = kvs [i].key;
+		if (!k) {
+			/* The key is in neither this table nor the next one */
+			if (mode == PUT_REMOVE)
+				return NULL;
+			if (mode != PUT_COPY && table->claimed + reserved >= table->overflow_count) {
+				if (!table->next)
+					*status = STATUS_RESIZE;
+				else if (!can_copy (table, next))
+					*status = STATUS_RESTART;
+				else {
+					/* Seal the slot before inserting into the next table, so lookups don't stop here */
+					copy_slot (hash_table, table, i);
+					continue;
+				}
+				return NULL;
+			}
+			k = InterlockedCompareExchangePointer (&kvs [i].key, key, NULL);
+			if (!k) {
+				InterlockedIncrement (&table->claimed);
+				k = key;
+			}
+		}
+		if (k == KEY_MOVED) {
+			*status = mode == PUT_COPY ? STATUS_DONE : STATUS_NEXT;
+			return NULL;
+		}
+		if (keys_equal (hash_table, key, k))
+			break;
+		if (++probes == table->table_size) {
+			g_assert (mode != PUT_COPY);
+			if (table->next)
+				*status = STATUS_NEXT;
+			else if (mode != PUT_REMOVE)
+				*status = STATUS_RESIZE;
+			return NULL;
+		}
+		i = (i + 1) & table_mask;
+	}
+
+	for (;;) {
+		v = kvs [i].value;
+		if (v == VALUE_MOVED || IS_FROZEN (v)) {
+			/* The table we copy to is only resized once the copy is complete */
+			if (mode == PUT_COPY)
+				return NULL;
+			if (can_copy (table, next)) {
+				copy_slot (hash_table, table, i);
+				*status = STATUS_NEXT;
+			} else {
+				*status = STATUS_RESTART;
+			}
+			return NULL;
+		}
+
+		switch (mode) {
+		case PUT_IF_ABSENT:
+			if (IS_LIVE (v))
+				return v;
+			break;
+		case PUT_REMOVE:
+			if (!IS_LIVE (v))
+				return NULL;
+			value = VALUE_TOMBSTONE;
+			break;
+		case PUT_COPY:
+			/* The key got a value in this table after the copy, which is newer */
+			if (v)
+				return NULL;
+			break;
+		case PUT_REPLACE:
+			break;
+		}
+
+		if (InterlockedCompareExchangePointer (&kvs [i].value, value, v) == v) {
+			if (mode == PUT_REMOVE)
+				InterlockedDecrement (&hash_table->element_count);
+			else if (mode != PUT_COPY && !IS_LIVE (v))
+				InterlockedIncrement (&hash_table->element_count);
+			return IS_LIVE (v) ? v : NULL;
+		}
+	}
+}
+
+static gpointer
+table_get (MonoLockFreeHashTable *hash_table, lf_table *table, int hash, gpointer key, OpStatus *status)
+{
+	key_value_pair *kvs = table->kvs;
+	int table_mask = table->table_size - 1;
+	int i = hash & table_mask;
+	int probes = 0;
+	gpointer k, v;
+
+	*status = STATUS_DONE;
+
+	for (;;) {
+		k = kvs [i].key;
+		if (!k)
+			return NULL;
+		if (k == KEY_MOVED) {
+			*status = STATUS_NEXT;
+			return NULL;
+		}
+		if (keys_equal (hash_table, key, k)) {
+			/* The read of keys must happen before the read of values */
+			mono_memory_read_barrier ();
+			v = kvs [i].value;
+			if (v == VALUE_MOVED) {
+				*status = STATUS_NEXT;
+				return NULL;
+			}
+			v = THAW (v);
+			return IS_LIVE (v) ? v : NULL;
+		}
+		if (++probes == table->table_size) {
+			if (table->next)
+				*status = STATUS_NEXT;
+			return NULL;
+		}
+		i = (i + 1) & table_mask;
+	}
+}
+
+static gpointer
+hashtable_put (MonoLockFreeHashTable *hash_table, gpointer key, gpointer value, PutMode mode)
+{
+	MonoThreadHazardPointers *hp = mono_hazard_pointer_get ();
+	int hash = mix_hash (hash_table->hash_func (key));
+	lf_table *table, *next;
+	OpStatus status;
+	gpointer res;
+
+	g_assert (key != NULL && key != KEY_MOVED);
+
+	for (;;) {
+		table = get_tables (hash_table, hp, &next);
+		if (!table)
+			continue;
+
+		if (next)
+			help_copy (hash_table, table, FALSE);
+
+		res = table_put (hash_table, table, next, 0, hash, key, value, mode, &status);
+		if (status == STATUS_RESIZE) {
+			start_resize (hash_table, table);
+			continue;
+		}
+		if (status == STATUS_DONE)
+			break;
+		if (status == STATUS_RESTART || !next)
+			continue;
+		/* Make sure everything in table still fits into next */
+		res = table_put (hash_table, next, NULL, table->claimed, hash, key, value, mode, &status);
+		if (status == STATUS_RESIZE) {
+			/* Only the current table may be resized, so finish the copy first */
+			help_copy (hash_table, table, TRUE);
+			continue;
+		}
+		if (status == STATUS_DONE)
+			break;
+	}
+
+	mono_hazard_pointer_clear (hp, 0);
+	mono_hazard_pointer_clear (hp, 1);
+	return res;
+}
+
+MonoLockFreeHashTable*
+mono_lock_free_hashtable_new (GHashFunc hash_func, GEqualFunc key_equal_func)
+{
+	MonoLockFreeHashTable *res = g_new0 (MonoLockFreeHashTable, 1);
+	res->hash_func = hash_func ? hash_func : g_direct_hash;
+	res->equal_func = key_equal_func;
+	res->table = lf_table_new (INITIAL_SIZE);
+	return res;
+}
+
+/*
+ * mono_lock_free_hashtable_destroy:
+ *
+ *   Nobody may access the table concurrently.
+ */
+void
+mono_lock_free_hashtable_destroy (MonoLockFreeHashTable *hash_table)
+{
+	lf_table *table = hash_table->table;
+
+	if (table->next)
+		lf_table_free (table->next);
+	lf_table_free (table);
+	g_free (hash_table);
+}
+
+gpointer
+mono_lock_free_hashtable_lookup (MonoLockFreeHashTable *hash_table, gpointer key)
+{
+	MonoThreadHazardPointers *hp = mono_hazard_pointer_get ();
+	int hash = mix_hash (hash_table->hash_func (key));
+	lf_table *table, *next;
+	OpStatus status;
+	gpointer res;
+
+	for (;;) {
+		table = get_tables (hash_table, hp, &next);
+		if (!table)
+			continue;
+
+		res = table_get (hash_table, table, hash, key, &status);
+		if (status == STATUS_DONE)
+			break;
+
+		if (!next)
+			continue;
+		res = table_get (hash_table, next, hash, key, &status);
+		if (status == STATUS_DONE)
+			break;
+	}
+
+	mono_hazard_pointer_clear (hp, 0);
+	mono_hazard_pointer_clear (hp, 1);
+	return res;
+}
+
+/**
+ * mono_lock_free_hashtable_insert:
+ *
+ * Insert a value into the hashtable unless @key is already present.
+ * @Returns the existing value if key is already present or null
+ */
+gpointer
+mono_lock_free_hashtable_insert (MonoLockFreeHashTable *hash_table, gpointer key, gpointer value)
+{
+	g_assert (value != NULL && !IS_FROZEN (value) && value != VALUE_TOMBSTONE && value != VALUE_MOVED);
+	return hashtable_put (hash_table, key, value, PUT_IF_ABSENT);
+}
+
+/**
+ * mono_lock_free_hashtable_replace:
+ *
+ * Insert a value into the hashtable, replacing the value of @key if it is already
+ * present. Concurrent lookups see either the old or the new value, never NULL.
+ * @Returns the old value if key is already present or null
+ */
+gpointer
+mono_lock_free_hashtable_replace (MonoLockFreeHashTable *hash_table, gpointer key, gpointer value)
+{
+	g_assert (value != NULL && !IS_FROZEN (value) && value != VALUE_TOMBSTONE && value != VALUE_MOVED);
+	return hashtable_put (hash_table, key, value, PUT_REPLACE);
+}
+
+/**
+ * mono_lock_free_hashtable_remove:
+ *
+ * Remove a value from the hashtable.
+ * @Returns the old value if key is already present or null
+ */
+gpointer
+mono_lock_free_hashtable_remove (MonoLockFreeHashTable *hash_table, gpointer key)
+{
+	return hashtable_put (hash_table, key, NULL, PUT_REMOVE);
+}
+
+/**
+ * mono_lock_free_hashtable_foreach:
+ *
+ * Calls @func for each value in the hashtable. Entries which are inserted or
+ * removed concurrently might or might not be visited.
+ */
+void
+mono_lock_free_hashtable_foreach (MonoLockFreeHashTable *hash_table, GHFunc func, gpointer userdata)
+{
+	MonoThreadHazardPointers *hp = mono_hazard_pointer_get ();
+	lf_table *table, *next;
+	int i;
+
+	for (;;) {
+		table = get_tables (hash_table, hp, &next);
+		if (!table)
+			continue;
+		if (!next)
+			break;
+		help_copy (hash_table, table, TRUE);
+	}
+
+	for (i = 0; i < table->table_size; ++i) {
+		gpointer key = table->kvs [i].key;
+		gpointer value;
+
+		if (!key || key == KEY_MOVED)
+			continue;
+		mono_memory_read_barrier ();
+		value = THAW (table->kvs [i].value);
+		if (IS_LIVE (value) && value != VALUE_MOVED)
+			func (key, value, userdata);
+	}
+
+	mono_hazard_pointer_clear (hp, 0);
+	mono_hazard_pointer_clear (hp, 1);
+}
@@ -0,0 +1,29 @@
+/*
+ * lock-free-hashtable.h: A fully concurrent hashtable
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#ifndef __MONO_LOCK_FREE_HASHTABLE_H__
+#define __MONO_LOCK_FREE_HASHTABLE_H__
+
+#include <mono/utils/mono-publib.h>
+#include <mono/utils/mono-compiler.h>
+#include <glib.h>
+
+/*
+ * Unlike MonoConcurrentHashTable, inserts, replaces and removals don't need any
+ * external locking. Values must be non-NULL and at least 2-byte aligned, since
+ * the low bit is used to freeze a slot while the table is resized.
+ */
+typedef struct _MonoLockFreeHashTable MonoLockFreeHashTable;
+
+MONO_API MonoLockFreeHashTable* mono_lock_free_hashtable_new (GHashFunc hash_func, GEqualFunc key_equal_func);
+MONO_API void mono_lock_free_hashtable_destroy (MonoLockFreeHashTable *hash_table);
+MONO_API gpointer mono_lock_free_hashtable_lookup (MonoLockFreeHashTable *hash_table, gpointer key);
+MONO_API gpointer mono_lock_free_hashtable_insert (MonoLockFreeHashTable *hash_table, gpointer key, gpointer value);
+MONO_API gpointer mono_lock_free_hashtable_replace (MonoLockFreeHashTable *hash_table, gpointer key, gpointer value);
+MONO_API gpointer mono_lock_free_hashtable_remove (MonoLockFreeHashTable *hash_table, gpointer key);
+MONO_API void mono_lock_free_hashtable_foreach (MonoLockFreeHashTable *hash_table, GHFunc func, gpointer userdata);
+
+#endif
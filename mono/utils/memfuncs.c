@@ -28,6 +28,31 @@
 #include <string.h>
 
 #include "memfuncs.h"
+#include "mono-hwcap.h"
+
+/*
+ * On x86, large blocks are zeroed and copied with vector instructions. The stores are to
+ * vector aligned addresses, so every word in a vector is written at once, just like with
+ * the word loops: a vector store never straddles a word, and an aligned one never
+ * straddles a cache line. The loads only need to be word aligned for the same reason.
+ * Blocks which are larger than the caches are written with non-temporal stores, which
+ * bypass the caches instead of evicting everything else from them.
+ *
+ * AVX2 is used when mono_hwcap_init () found it, SSE2 is always there on amd64.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define MEMFUNCS_SIMD 1
+#include <emmintrin.h>
+#if defined(__clang__) || __GNUC__ >= 5
+#define MEMFUNCS_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+/* Blocks smaller than this are handled by the word loops */
+#define SIMD_THRESHOLD 128
+/* Blocks at least this large are written with non-temporal stores */
+#define NON_TEMPORAL_THRESHOLD (1024 * 1024)
 
 #define ptr_mask ((sizeof (void*) - 1))
 #define _toi(ptr) ((size_t)ptr)
@@ -51,6 +76,246 @@
 	} while (0)
 
 
+#ifdef MEMFUNCS_SIMD
+
+#define SIMD_WORD_STORE(d,s) (*(void * volatile *)(d) = *(void **)(s))
+#define SIMD_WORD_ZERO(d) (*(void * volatile *)(d) = NULL)
+
+/*
+ * The vector stores go through volatile pointers for the same reason as the word
+ * stores above, the non-temporal ones are never turned into library calls.
+ */
+
+static void
+bzero_words_sse2 (char *d, size_t size, gboolean nontemporal)
+{
+	char *end = d + size;
+	__m128i zero = _mm_setzero_si128 ();
+
+	for (; _toi (d) & 15; d += sizeof (void*))
+		SIMD_WORD_ZERO (d);
+
+	if (nontemporal) {
+		for (; d + 64 <= end; d += 64) {
+			_mm_stream_si128 ((__m128i*)d, zero);
+			_mm_stream_si128 ((__m128i*)(d + 16), zero);
+			_mm_stream_si128 ((__m128i*)(d + 32), zero);
+			_mm_stream_si128 ((__m128i*)(d + 48), zero);
+		}
+		_mm_sfence ();
+	}
+	for (; d + 16 <= end; d += 16)
+		*(volatile __m128i*)d = zero;
+
+	for (; d < end; d += sizeof (void*))
+		SIMD_WORD_ZERO (d);
+}
+
+static void
+memmove_words_upward_sse2 (char *d, const char *s, size_t size)
+{
+	char *end = d + size;
+
+	for (; _toi (d) & 15; d += sizeof (void*), s += sizeof (void*))
+		SIMD_WORD_STORE (d, s);
+
+	/* The loads of an iteration are done before its stores, so overlapping moves to lower addresses work */
+	if (size >= NON_TEMPORAL_THRESHOLD) {
+		for (; d + 64 <= end; d += 64, s += 64) {
+			__m128i v0 = _mm_loadu_si128 ((const __m128i*)s);
+			__m128i v1 = _mm_loadu_si128 ((const __m128i*)(s + 16));
+			__m128i v2 = _mm_loadu_si128 ((const __m128i*)(s + 32));
+			__m128i v3 = _mm_loadu_si128 ((const __m128i*)(s + 48));
+			_mm_stream_si128 ((__m128i*)d, v0);
+			_mm_stream_si128 ((__m128i*)(d + 16), v1);
+			_mm_stream_si128 ((__m128i*)(d + 32), v2);
+			_mm_stream_si128 ((__m128i*)(d + 48), v3);
+		}
+		_mm_sfence ();
+	}
+	for (; d + 64 <= end; d += 64, s += 64) {
+		__m128i v0 = _mm_loadu_si128 ((const __m128i*)s);
+		__m128i v1 = _mm_loadu_si128 ((const __m128i*)(s + 16));
+		__m128i v2 = _mm_loadu_si128 ((const __m128i*)(s + 32));
+		__m128i v3 = _mm_loadu_si128 ((const __m128i*)(s + 48));
+		*(volatile __m128i*)d = v0;
+		*(volatile __m128i*)(d + 16) = v1;
+		*(volatile __m128i*)(d + 32) = v2;
+		*(volatile __m128i*)(d + 48) = v3;
+	}
+	for (; d + 16 <= end; d += 16, s += 16)
+		*(volatile __m128i*)d = _mm_loadu_si128 ((const __m128i*)s);
+
+	for (; d < end; d += sizeof (void*), s += sizeof (void*))
+		SIMD_WORD_STORE (d, s);
+}
+
+static void
+memmove_words_downward_sse2 (char *start, const char *src, size_t size)
+{
+	char *d = start + size;
+	const char *s = src + size;
+
+	for (; _toi (d) & 15; d -= sizeof (void*), s -= sizeof (void*))
+		SIMD_WORD_STORE (d - sizeof (void*), s - sizeof (void*));
+
+	for (; d - 64 >= start; d -= 64, s -= 64) {
+		__m128i v3 = _mm_loadu_si128 ((const __m128i*)(s - 16));
+		__m128i v2 = _mm_loadu_si128 ((const __m128i*)(s - 32));
+		__m128i v1 = _mm_loadu_si128 ((const __m128i*)(s - 48));
+		__m128i v0 = _mm_loadu_si128 ((const __m128i*)(s - 64));
+		*(volatile __m128i*)(d - 16) = v3;
+		*(volatile __m128i*)(d - 32) = v2;
+		*(volatile __m128i*)(d - 48) = v1;
+		*(volatile __m128i*)(d - 64) = v0;
+	}
+	for (; d - 16 >= start; d -= 16, s -= 16)
+		*(volatile __m128i*)(d - 16) = _mm_loadu_si128 ((const __m128i*)(s - 16));
+
+	for (; d > start; d -= sizeof (void*), s -= sizeof (void*))
+		SIMD_WORD_STORE (d - sizeof (void*), s - sizeof (void*));
+}
+
+#ifdef MEMFUNCS_AVX2
+
+__attribute__((target("avx2"))) static void
+bzero_words_avx2 (char *d, size_t size, gboolean nontemporal)
+{
+	char *end = d + size;
+	__m256i zero = _mm256_setzero_si256 ();
+
+	for (; _toi (d) & 31; d += sizeof (void*))
+		SIMD_WORD_ZERO (d);
+
+	if (nontemporal) {
+		for (; d + 128 <= end; d += 128) {
+			_mm256_stream_si256 ((__m256i*)d, zero);
+			_mm256_stream_si256 ((__m256i*)(d + 32), zero);
+			_mm256_stream_si256 ((__m256i*)(d + 64), zero);
+			_mm256_stream_si256 ((__m256i*)(d + 96), zero);
+		}
+		_mm_sfence ();
+	}
+	for (; d + 32 <= end; d += 32)
+		*(volatile __m256i*)d = zero;
+
+	for (; d < end; d += sizeof (void*))
+		SIMD_WORD_ZERO (d);
+}
+
+__attribute__((target("avx2"))) static void
+memmove_words_upward_avx2 (char *d, const char *s, size_t size)
+{
+	char *end = d + size;
+
+	for (; _toi (d) & 31; d += sizeof (void*), s += sizeof (void*))
+		SIMD_WORD_STORE (d, s);
+
+	if (size >= NON_TEMPORAL_THRESHOLD) {
+		for (; d + 128 <= end; d += 128, s += 128) {
+			__m256i v0 = _mm256_loadu_si256 ((const __m256i*)s);
+			__m256i v1 = _mm256_loadu_si256 ((const __m256i*)(s + 32));
+			__m256i v2 = _mm256_loadu_si256 ((const __m256i*)(s + 64));
+			__m256i v3 = _mm256_loadu_si256 ((const __m256i*)(s + 96));
+			_mm256_stream_si256 ((__m256i*)d, v0);
+			_mm256_stream_si256 ((__m256i*)(d + 32), v1);
+			_mm256_stream_si256 ((__m256i*)(d + 64), v2);
+			_mm256_stream_si256 ((__m256i*)(d + 96), v3);
+		}
+		_mm_sfence ();
+	}
+	for (; d + 128 <= end; d += 128, s += 128) {
+		__m256i v0 = _mm256_loadu_si256 ((const __m256i*)s);
+		__m256i v1 = _mm256_loadu_si256 ((const __m256i*)(s + 32));
+		__m256i v2 = _mm256_loadu_si256 ((const __m256i*)(s + 64));
+		__m256i v3 = _mm256_loadu_si256 ((const __m256i*)(s + 96));
+		*(volatile __m256i*)d = v0;
+		*(volatile __m256i*)(d + 32) = v1;
+		*(volatile __m256i*)(d + 64) = v2;
+		*(volatile __m256i*)(d + 96) = v3;
+	}
+	for (; d + 32 <= end; d += 32, s += 32)
+		*(volatile __m256i*)d = _mm256_loadu_si256 ((const __m256i*)s);
+
+	for (; d < end; d += sizeof (void*), s += sizeof (void*))
+		SIMD_WORD_STORE (d, s);
+}
+
+__attribute__((target("avx2"))) static void
+memmove_words_downward_avx2 (char *start, const char *src, size_t size)
+{
+	char *d = start + size;
+	const char *s = src + size;
+
+	for (; _toi (d) & 31; d -= sizeof (void*), s -= sizeof (void*))
+		SIMD_WORD_STORE (d - sizeof (void*), s - sizeof (void*));
+
+	for (; d - 128 >= start; d -= 128, s -= 128) {
+		__m256i v3 = _mm256_loadu_si256 ((const __m256i*)(s - 32));
+		__m256i v2 = _mm256_loadu_si256 ((const __m256i*)(s - 64));
+		__m256i v1 = _mm256_loadu_si256 ((const __m256i*)(s - 96));
+		__m256i v0 = _mm256_loadu_si256 ((const __m256i*)(s - 128));
+		*(volatile __m256i*)(d - 32) = v3;
+		*(volatile __m256i*)(d - 64) = v2;
+		*(volatile __m256i*)(d - 96) = v1;
+		*(volatile __m256i*)(d - 128) = v0;
+	}
+	for (; d - 32 >= start; d -= 32, s -= 32)
+		*(volatile __m256i*)(d - 32) = _mm256_loadu_si256 ((const __m256i*)(s - 32));
+
+	for (; d > start; d -= sizeof (void*), s -= sizeof (void*))
+		SIMD_WORD_STORE (d - sizeof (void*), s - sizeof (void*));
+}
+
+#endif /* MEMFUNCS_AVX2 */
+
+/*
+ * Word aligned DEST/SRC, SIZE a multiple of the word size. Return FALSE if the block
+ * is too small for the vector loops to pay off.
+ */
+static gboolean
+bzero_words_simd (void *dest, size_t size, gboolean nontemporal)
+{
+	if (size < SIMD_THRESHOLD)
+		return FALSE;
+#ifdef MEMFUNCS_AVX2
+	if (mono_hwcap_x86_has_avx2) {
+		bzero_words_avx2 ((char*)dest, size, nontemporal);
+		return TRUE;
+	}
+#endif
+	bzero_words_sse2 ((char*)dest, size, nontemporal);
+	return TRUE;
+}
+
+static gboolean
+memmove_words_simd (void *dest, const void *src, size_t size, gboolean downward)
+{
+	if (size < SIMD_THRESHOLD)
+		return FALSE;
+#ifdef MEMFUNCS_AVX2
+	if (mono_hwcap_x86_has_avx2) {
+		if (downward)
+			memmove_words_downward_avx2 ((char*)dest, (const char*)src, size);
+		else
+			memmove_words_upward_avx2 ((char*)dest, (const char*)src, size);
+		return TRUE;
+	}
+#endif
+	if (downward)
+		memmove_words_downward_sse2 ((char*)dest, (const char*)src, size);
+	else
+		memmove_words_upward_sse2 ((char*)dest, (const char*)src, size);
+	return TRUE;
+}
+
+#else
+
+#define bzero_words_simd(dest,size,nontemporal) FALSE
+#define memmove_words_simd(dest,src,size,downward) FALSE
+
+#endif /* MEMFUNCS_SIMD */
+
 /**
  * mono_gc_bzero_aligned:
  * @dest: address to start to clear
@@ -85,7 +350,8 @@ mono_gc_bzero_aligned (void *dest, size_t size)
 		BZERO_WORDS (d, 4);
 		break;
 	default:
-		BZERO_WORDS (d, bytes_to_words (word_bytes));
+		if (!bzero_words_simd ((void*)d, word_bytes, word_bytes >= NON_TEMPORAL_THRESHOLD))
+			BZERO_WORDS (d, bytes_to_words (word_bytes));
 	}
 
 	tail_bytes = unaligned_bytes (size);
@@ -97,6 +363,25 @@ mono_gc_bzero_aligned (void *dest, size_t size)
 	}
 }
 
+/**
+ * mono_gc_bzero_nontemporal:
+ * @dest: address to start to clear
+ * @size: size of the region to clear
+ *
+ * Like mono_gc_bzero_aligned (), but the zeroes bypass the caches whatever
+ * the size, where the CPU allows it. For clearing memory which won't be used
+ * soon, like free nursery fragments.
+ */
+void
+mono_gc_bzero_nontemporal (void *dest, size_t size)
+{
+	g_assert (unaligned_bytes (dest) == 0);
+
+	if (!unaligned_bytes (size) && bzero_words_simd (dest, size, TRUE))
+		return;
+	mono_gc_bzero_aligned (dest, size);
+}
+
 /**
  * mono_gc_bzero_atomic:
  * @dest: address to start to clear
@@ -181,14 +466,16 @@ mono_gc_memmove_aligned (void *dest, const void *src, size_t size)
 			bytes_to_memmove = p - word_start;
 			p -= bytes_to_memmove;
 			s -= bytes_to_memmove;
-			MEMMOVE_WORDS_DOWNWARD (p, s, bytes_to_words (bytes_to_memmove));
+			if (!memmove_words_simd ((void*)p, s, bytes_to_memmove, TRUE))
+				MEMMOVE_WORDS_DOWNWARD (p, s, bytes_to_words (bytes_to_memmove));
 	} else {
 		volatile char *d = (char*)dest;
 		const char *s = (const char*)src;
 		size_t tail_bytes;
 
 		/* copy all words with memmove */
-		MEMMOVE_WORDS_UPWARD (d, s, bytes_to_words (align_down (size)));
+		if (!memmove_words_simd ((void*)d, s, (size_t)align_down (size), FALSE))
+			MEMMOVE_WORDS_UPWARD (d, s, bytes_to_words (align_down (size)));
 
 		tail_bytes = unaligned_bytes (size);
 		if (tail_bytes) {
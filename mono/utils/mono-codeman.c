@@ -7,6 +7,9 @@
 #include <string.h>
 #include <assert.h>
 #include <glib.h>
+#if HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 /* For dlmalloc.h */
 #define USE_DL_PREFIX 1
@@ -14,6 +17,7 @@
 #include "mono-codeman.h"
 #include "mono-mmap.h"
 #include "mono-counters.h"
+#include "atomic.h"
 #include "dlmalloc.h"
 #include <mono/io-layer/io-layer.h>
 #include <mono/metadata/profiler-private.h>
@@ -28,6 +32,10 @@ static uintptr_t code_memory_used = 0;
 static size_t dynamic_code_alloc_count;
 static size_t dynamic_code_bytes_count;
 static size_t dynamic_code_frees_count;
+static size_t dynamic_heap_bytes_count;
+static size_t dynamic_heap_reused_count;
+static size_t region_code_bytes_count;
+static size_t cold_region_code_bytes_count;
 
 /*
  * AMD64 processors maintain icache coherency only for pages which are 
@@ -65,7 +73,8 @@ typedef struct _CodeChunck CodeChunk;
 
 enum {
 	CODE_FLAG_MMAP,
-	CODE_FLAG_MALLOC
+	CODE_FLAG_MALLOC,
+	CODE_FLAG_DYN_HEAP
 };
 
 struct _CodeChunck {
@@ -81,11 +90,74 @@ struct _CodeChunck {
 struct _MonoCodeManager {
 	int dynamic;
 	int read_only;
+	/* Whenever the chunks are allocated from the cold code region */
+	int cold;
 	CodeChunk *current;
 	CodeChunk *full;
 	CodeChunk *last;
+	/* Holds the cold code of this code manager, see mono_code_manager_reserve_cold () */
+	MonoCodeManager *cold_cman;
+};
+
+/*
+ * When enabled with mono_code_manager_set_region_size (), the chunks of the non-dynamic
+ * code managers are carved sequentially out of a single large reservation aligned to
+ * CODE_REGION_ALIGN, which the kernel can back with huge pages, instead of being mapped
+ * separately. This keeps the JITted code contiguous, reducing the number of i-TLB entries
+ * it needs and the number of far branches between methods. Code which is rarely executed
+ * is allocated from a separate, smaller region so it doesn't dilute the hot one.
+ * Chunks freed when a domain is unloaded are kept in a per-region freelist, since parts
+ * of a region can't be returned to the OS on all platforms. Once a region is exhausted,
+ * chunks are mapped separately as before.
+ */
+typedef struct {
+	char *start;
+	char *pos;
+	char *end;
+	/* Maps chunk sizes to a list of free chunks of that size */
+	GHashTable *freelists;
+} CodeRegion;
+
+#define CODE_REGION_ALIGN (2 * 1024 * 1024)
+/* The cold code region gets 1/COLD_REGION_RATIO of the space of the hot one */
+#define COLD_REGION_RATIO 4
+
+static size_t code_region_size;
+static CodeRegion hot_region;
+static CodeRegion cold_region;
+
+/*
+ * The chunks of the dynamic code managers, which hold the code of a single dynamic
+ * method each, are allocated from a shared heap with power of two size classes, instead
+ * of from dlmalloc, so the space of the freed methods can be reused without
+ * fragmentation. The blocks are carved out of slabs of DYN_SLAB_SIZE bytes.
+ * A freed block can't be reused right away, since another thread could still be
+ * executing the code which was in it: the block goes to a pending queue, and it only
+ * becomes reusable after mono_code_manager_safepoint () is called, i.e. every thread has
+ * been suspended and restarted by the GC since it was freed.
+ * Chunks larger than the largest size class are still allocated from dlmalloc.
+ */
+typedef struct _DynFreeBlock DynFreeBlock;
+
+struct _DynFreeBlock {
+	char *data;
+	int cls;
+	/* The value of dyn_epoch when the block was freed */
+	gint32 epoch;
+	DynFreeBlock *next;
 };
 
+#define DYN_MIN_CLASS_SHIFT 6
+#define DYN_NUM_CLASSES 9
+#define DYN_MAX_CLASS_SIZE (1 << (DYN_MIN_CLASS_SHIFT + DYN_NUM_CLASSES - 1))
+#define DYN_SLAB_SIZE (256 * 1024)
+
+static DynFreeBlock *dyn_freelists [DYN_NUM_CLASSES];
+/* Blocks waiting for a safepoint, in the order they were freed */
+static DynFreeBlock *dyn_pending, *dyn_pending_tail;
+static char *dyn_slab_pos, *dyn_slab_end;
+static volatile gint32 dyn_epoch;
+
 #define ALIGN_INT(val,alignment) (((val) + (alignment - 1)) & ~(alignment - 1))
 
 #define VALLOC_FREELIST_SIZE 16
@@ -93,16 +165,87 @@ struct _MonoCodeManager {
 static mono_mutex_t valloc_mutex;
 static GHashTable *valloc_freelists;
 
+static void
+code_region_init (CodeRegion *region, size_t size)
+{
+	size = ALIGN_INT (size, CODE_REGION_ALIGN);
+	region->start = (char *) mono_valloc_aligned (size, CODE_REGION_ALIGN, MONO_PROT_RWX | ARCH_MAP_FLAGS);
+	if (!region->start) {
+		g_warning ("Unable to reserve a code region of %d MB.", (int)(size / (1024 * 1024)));
+		return;
+	}
+#if defined(HAVE_SYS_MMAN_H) && defined(MADV_HUGEPAGE)
+	/* Ask for transparent huge pages, this is only a hint */
+	madvise (region->start, size, MADV_HUGEPAGE);
+#endif
+	region->pos = region->start;
+	region->end = region->start + size;
+	region->freelists = g_hash_table_new (NULL, NULL);
+}
+
+static gboolean
+code_region_contains (CodeRegion *region, void *ptr)
+{
+	return region->start && (char *) ptr >= region->start && (char *) ptr < region->end;
+}
+
+/*
+ * code_region_alloc:
+ *
+ *   Allocate SIZE bytes from REGION, or return NULL if it is not enabled or it is full.
+ * LOCKING: Assumes the valloc mutex is held.
+ */
 static void*
-codechunk_valloc (void *preferred, guint32 size)
+code_region_alloc (CodeRegion *region, guint32 size)
 {
-	void *ptr;
 	GSList *freelist;
+	void *ptr;
+
+	if (!region->start)
+		return NULL;
+
+	freelist = (GSList *) g_hash_table_lookup (region->freelists, GUINT_TO_POINTER (size));
+	if (freelist) {
+		ptr = freelist->data;
+		memset (ptr, 0, size);
+		freelist = g_slist_delete_link (freelist, freelist);
+		g_hash_table_insert (region->freelists, GUINT_TO_POINTER (size), freelist);
+		return ptr;
+	}
+
+	if (region->pos + size > region->end)
+		return NULL;
+	ptr = region->pos;
+	region->pos += size;
+	if (region == &cold_region)
+		cold_region_code_bytes_count += size;
+	else
+		region_code_bytes_count += size;
+	return ptr;
+}
 
+static void
+codechunk_valloc_init (void)
+{
 	if (!valloc_freelists) {
 		mono_os_mutex_init_recursive (&valloc_mutex);
 		valloc_freelists = g_hash_table_new (NULL, NULL);
 	}
+}
+
+static void*
+codechunk_valloc (void *preferred, guint32 size, int cold)
+{
+	void *ptr;
+	GSList *freelist;
+
+	codechunk_valloc_init ();
+
+	mono_os_mutex_lock (&valloc_mutex);
+	ptr = code_region_alloc (cold ? &cold_region : &hot_region, size);
+	mono_os_mutex_unlock (&valloc_mutex);
+	if (ptr)
+		return ptr;
 
 	/*
 	 * Keep a small freelist of memory blocks to decrease pressure on the kernel memory subsystem to avoid #3321.
@@ -127,8 +270,21 @@ static void
 codechunk_vfree (void *ptr, guint32 size)
 {
 	GSList *freelist;
+	CodeRegion *region = NULL;
 
 	mono_os_mutex_lock (&valloc_mutex);
+	if (code_region_contains (&hot_region, ptr))
+		region = &hot_region;
+	else if (code_region_contains (&cold_region, ptr))
+		region = &cold_region;
+	if (region) {
+		freelist = (GSList *) g_hash_table_lookup (region->freelists, GUINT_TO_POINTER (size));
+		freelist = g_slist_prepend (freelist, ptr);
+		g_hash_table_insert (region->freelists, GUINT_TO_POINTER (size), freelist);
+		mono_os_mutex_unlock (&valloc_mutex);
+		return;
+	}
+
 	freelist = (GSList *) g_hash_table_lookup (valloc_freelists, GUINT_TO_POINTER (size));
 	if (!freelist || g_slist_length (freelist) < VALLOC_FREELIST_SIZE) {
 		freelist = g_slist_prepend (freelist, ptr);
@@ -139,6 +295,96 @@ codechunk_vfree (void *ptr, guint32 size)
 	mono_os_mutex_unlock (&valloc_mutex);
 }		
 
+static int
+dyn_heap_class (int size)
+{
+	int cls = 0;
+
+	while ((1 << (DYN_MIN_CLASS_SHIFT + cls)) < size)
+		cls ++;
+	return cls;
+}
+
+/*
+ * dyn_heap_alloc:
+ *
+ *   Allocate a block of the size class CLS from the shared dynamic code heap.
+ */
+static void*
+dyn_heap_alloc (int cls)
+{
+	DynFreeBlock *block;
+	guint32 block_size = 1 << (DYN_MIN_CLASS_SHIFT + cls);
+	void *ptr;
+
+	codechunk_valloc_init ();
+
+	mono_os_mutex_lock (&valloc_mutex);
+	/* Make the blocks freed before the last safepoint reusable */
+	while (dyn_pending && dyn_pending->epoch != dyn_epoch) {
+		block = dyn_pending;
+		dyn_pending = block->next;
+		if (!dyn_pending)
+			dyn_pending_tail = NULL;
+		block->next = dyn_freelists [block->cls];
+		dyn_freelists [block->cls] = block;
+	}
+
+	block = dyn_freelists [cls];
+	if (block) {
+		dyn_freelists [cls] = block->next;
+		ptr = block->data;
+		g_free (block);
+		++dynamic_heap_reused_count;
+	} else {
+		if (dyn_slab_pos + block_size > dyn_slab_end) {
+			/* The rest of the slab is wasted, it is smaller than the block */
+			dyn_slab_pos = (char *) codechunk_valloc (NULL, DYN_SLAB_SIZE, FALSE);
+			if (!dyn_slab_pos) {
+				dyn_slab_end = NULL;
+				mono_os_mutex_unlock (&valloc_mutex);
+				return NULL;
+			}
+			dyn_slab_end = dyn_slab_pos + DYN_SLAB_SIZE;
+			dynamic_heap_bytes_count += DYN_SLAB_SIZE;
+		}
+		ptr = dyn_slab_pos;
+		dyn_slab_pos += block_size;
+	}
+	mono_os_mutex_unlock (&valloc_mutex);
+	return ptr;
+}
+
+static void
+dyn_heap_free (void *ptr, int size)
+{
+	DynFreeBlock *block = g_new0 (DynFreeBlock, 1);
+
+	block->data = (char *) ptr;
+	block->cls = dyn_heap_class (size);
+
+	mono_os_mutex_lock (&valloc_mutex);
+	block->epoch = dyn_epoch;
+	if (dyn_pending_tail)
+		dyn_pending_tail->next = block;
+	else
+		dyn_pending = block;
+	dyn_pending_tail = block;
+	mono_os_mutex_unlock (&valloc_mutex);
+}
+
+/**
+ * mono_code_manager_safepoint:
+ *
+ * Called by the GC after it restarted the world. The dynamic code freed before this
+ * call can no longer be executing, so its memory can be reused.
+ */
+void
+mono_code_manager_safepoint (void)
+{
+	InterlockedIncrement (&dyn_epoch);
+}
+
 static void
 codechunk_cleanup (void)
 {
@@ -158,6 +404,20 @@ codechunk_cleanup (void)
 		g_slist_free (freelist);
 	}
 	g_hash_table_destroy (valloc_freelists);
+	/* The code regions themselves stay mapped until the process exits */
+}
+
+/**
+ * mono_code_manager_set_region_size:
+ * @size: size of the code region in bytes
+ *
+ * Make the code managers allocate their chunks from a @size bytes region reserved at
+ * startup, see the comment for CodeRegion. Must be called before mono_code_manager_init ().
+ */
+void
+mono_code_manager_set_region_size (size_t size)
+{
+	code_region_size = size;
 }
 
 void
@@ -166,6 +426,17 @@ mono_code_manager_init (void)
 	mono_counters_register ("Dynamic code allocs", MONO_COUNTER_JIT | MONO_COUNTER_ULONG, &dynamic_code_alloc_count);
 	mono_counters_register ("Dynamic code bytes", MONO_COUNTER_JIT | MONO_COUNTER_ULONG, &dynamic_code_bytes_count);
 	mono_counters_register ("Dynamic code frees", MONO_COUNTER_JIT | MONO_COUNTER_ULONG, &dynamic_code_frees_count);
+	mono_counters_register ("Dynamic code heap bytes", MONO_COUNTER_JIT | MONO_COUNTER_ULONG, &dynamic_heap_bytes_count);
+	mono_counters_register ("Dynamic code heap reuses", MONO_COUNTER_JIT | MONO_COUNTER_ULONG, &dynamic_heap_reused_count);
+
+	if (code_region_size && !hot_region.start) {
+		codechunk_valloc_init ();
+		code_region_init (&hot_region, code_region_size);
+		if (hot_region.start)
+			code_region_init (&cold_region, code_region_size / COLD_REGION_RATIO);
+		mono_counters_register ("Code region bytes", MONO_COUNTER_JIT | MONO_COUNTER_ULONG, &region_code_bytes_count);
+		mono_counters_register ("Cold code region bytes", MONO_COUNTER_JIT | MONO_COUNTER_ULONG, &cold_region_code_bytes_count);
+	}
 }
 
 void
@@ -232,6 +503,8 @@ free_chunklist (CodeChunk *chunk)
 			/* valgrind_unregister(dead->data); */
 		} else if (dead->flags == CODE_FLAG_MALLOC) {
 			dlfree (dead->data);
+		} else if (dead->flags == CODE_FLAG_DYN_HEAP) {
+			dyn_heap_free (dead->data, dead->size);
 		}
 		code_memory_used -= dead->size;
 		g_free (dead);
@@ -247,6 +520,10 @@ free_chunklist (CodeChunk *chunk)
 void
 mono_code_manager_destroy (MonoCodeManager *cman)
 {
+	if (cman->cold_cman)
+		mono_code_manager_destroy (cman->cold_cman);
+	if (cman->dynamic)
+		++dynamic_code_frees_count;
 	free_chunklist (cman->full);
 	free_chunklist (cman->current);
 	g_free (cman);
@@ -275,6 +552,8 @@ mono_code_manager_invalidate (MonoCodeManager *cman)
 		memset (chunk->data, fill_value, chunk->size);
 	for (chunk = cman->full; chunk; chunk = chunk->next)
 		memset (chunk->data, fill_value, chunk->size);
+	if (cman->cold_cman)
+		mono_code_manager_invalidate (cman->cold_cman);
 }
 
 /**
@@ -287,6 +566,8 @@ void
 mono_code_manager_set_read_only (MonoCodeManager *cman)
 {
 	cman->read_only = TRUE;
+	if (cman->cold_cman)
+		cman->cold_cman->read_only = TRUE;
 }
 
 /**
@@ -310,6 +591,8 @@ mono_code_manager_foreach (MonoCodeManager *cman, MonoCodeManagerFunc func, void
 		if (func (chunk->data, chunk->size, chunk->bsize, user_data))
 			return;
 	}
+	if (cman->cold_cman)
+		mono_code_manager_foreach (cman->cold_cman, func, user_data);
 }
 
 /* BIND_ROOM is the divisor for the chunck of code size dedicated
@@ -325,7 +608,7 @@ mono_code_manager_foreach (MonoCodeManager *cman, MonoCodeManagerFunc func, void
 #endif
 
 static CodeChunk*
-new_codechunk (CodeChunk *last, int dynamic, int size)
+new_codechunk (CodeChunk *last, int dynamic, int cold, int size)
 {
 	int minsize, flags = CODE_FLAG_MMAP;
 	int chunk_size, bsize = 0;
@@ -376,7 +659,21 @@ new_codechunk (CodeChunk *last, int dynamic, int size)
 	}
 #endif
 
-	if (flags == CODE_FLAG_MALLOC) {
+#ifndef FORCE_MALLOC
+	if (dynamic && chunk_size <= DYN_MAX_CLASS_SIZE) {
+		/* The block sizes are multiples of MIN_ALIGN, so the blocks are aligned to it */
+		int cls = dyn_heap_class (chunk_size);
+
+		chunk_size = 1 << (DYN_MIN_CLASS_SHIFT + cls);
+		flags = CODE_FLAG_DYN_HEAP;
+	}
+#endif
+
+	if (flags == CODE_FLAG_DYN_HEAP) {
+		ptr = dyn_heap_alloc (dyn_heap_class (chunk_size));
+		if (!ptr)
+			return NULL;
+	} else if (flags == CODE_FLAG_MALLOC) {
 		ptr = dlmemalign (MIN_ALIGN, chunk_size + MIN_ALIGN - 1);
 		if (!ptr)
 			return NULL;
@@ -384,14 +681,14 @@ new_codechunk (CodeChunk *last, int dynamic, int size)
 		/* Try to allocate code chunks next to each other to help the VM */
 		ptr = NULL;
 		if (last)
-			ptr = codechunk_valloc ((guint8*)last->data + last->size, chunk_size);
+			ptr = codechunk_valloc ((guint8*)last->data + last->size, chunk_size, cold);
 		if (!ptr)
-			ptr = codechunk_valloc (NULL, chunk_size);
+			ptr = codechunk_valloc (NULL, chunk_size, cold);
 		if (!ptr)
 			return NULL;
 	}
 
-	if (flags == CODE_FLAG_MALLOC) {
+	if (flags == CODE_FLAG_MALLOC || flags == CODE_FLAG_DYN_HEAP) {
 #ifdef BIND_ROOM
 		/* Make sure the thunks area is zeroed */
 		memset (ptr, 0, bsize);
@@ -402,6 +699,8 @@ new_codechunk (CodeChunk *last, int dynamic, int size)
 	if (!chunk) {
 		if (flags == CODE_FLAG_MALLOC)
 			dlfree (ptr);
+		else if (flags == CODE_FLAG_DYN_HEAP)
+			dyn_heap_free (ptr, chunk_size);
 		else
 			mono_vfree (ptr, chunk_size);
 		return NULL;
@@ -450,7 +749,7 @@ mono_code_manager_reserve_align (MonoCodeManager *cman, int size, int alignment)
 	}
 
 	if (!cman->current) {
-		cman->current = new_codechunk (cman->last, cman->dynamic, size);
+		cman->current = new_codechunk (cman->last, cman->dynamic, cman->cold, size);
 		if (!cman->current)
 			return NULL;
 		cman->last = cman->current;
@@ -483,7 +782,7 @@ mono_code_manager_reserve_align (MonoCodeManager *cman, int size, int alignment)
 		cman->full = chunk;
 		break;
 	}
-	chunk = new_codechunk (cman->last, cman->dynamic, size);
+	chunk = new_codechunk (cman->last, cman->dynamic, cman->cold, size);
 	if (!chunk)
 		return NULL;
 	chunk->next = cman->current;
@@ -512,6 +811,31 @@ mono_code_manager_reserve (MonoCodeManager *cman, int size)
 	return mono_code_manager_reserve_align (cman, size, MIN_ALIGN);
 }
 
+/**
+ * mono_code_manager_reserve_cold:
+ * @cman: a code manager
+ * @size: size of memory to allocate
+ *
+ * Same as mono_code_manager_reserve (), but for code which is rarely executed, like
+ * wrappers. If a code region is used, the memory is allocated from the cold code region,
+ * so it doesn't take space in the hot one. The memory belongs to @cman, and it can be
+ * passed to mono_code_manager_commit () on @cman.
+ *
+ * Returns: the pointer to the allocated memory or #NULL on failure
+ */
+void*
+mono_code_manager_reserve_cold (MonoCodeManager *cman, int size)
+{
+	if (cman->dynamic || !cold_region.start)
+		return mono_code_manager_reserve (cman, size);
+
+	if (!cman->cold_cman) {
+		cman->cold_cman = mono_code_manager_new ();
+		cman->cold_cman->cold = 1;
+	}
+	return mono_code_manager_reserve (cman->cold_cman, size);
+}
+
 /**
  * mono_code_manager_commit:
  * @cman: a code manager
@@ -531,6 +855,8 @@ mono_code_manager_commit (MonoCodeManager *cman, void *data, int size, int newsi
 	if (cman->current && (size != newsize) && (data == cman->current->data + cman->current->pos - size)) {
 		cman->current->pos -= size - newsize;
 	}
+	if (cman->cold_cman)
+		mono_code_manager_commit (cman->cold_cman, data, size, newsize);
 }
 
 /**
@@ -558,6 +884,12 @@ mono_code_manager_size (MonoCodeManager *cman, int *used_size)
 		size += chunk->size;
 		used += chunk->pos;
 	}
+	if (cman->cold_cman) {
+		int cold_used;
+
+		size += mono_code_manager_size (cman->cold_cman, &cold_used);
+		used += cold_used;
+	}
 	if (used_size)
 		*used_size = used;
 	return size;
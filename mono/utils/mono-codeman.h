@@ -14,10 +14,13 @@ MONO_API void             mono_code_manager_set_read_only (MonoCodeManager *cman
 MONO_API void*            mono_code_manager_reserve_align (MonoCodeManager *cman, int size, int alignment);
 
 MONO_API void*            mono_code_manager_reserve (MonoCodeManager *cman, int size);
+void*                     mono_code_manager_reserve_cold (MonoCodeManager *cman, int size);
 MONO_API void             mono_code_manager_commit  (MonoCodeManager *cman, void *data, int size, int newsize);
 MONO_API int              mono_code_manager_size    (MonoCodeManager *cman, int *used_size);
 MONO_API void             mono_code_manager_init (void);
 MONO_API void             mono_code_manager_cleanup (void);
+void                      mono_code_manager_set_region_size (size_t size);
+void                      mono_code_manager_safepoint (void);
 
 /* find the extra block allocated to resolve branches close to code */
 typedef int    (*MonoCodeManagerFunc)      (void *data, int csize, int size, void *user_data);
@@ -343,6 +343,47 @@ mono_conc_hashtable_insert (MonoConcurrentHashTable *hash_table, gpointer key, g
 	}
 }
 
+/**
+ * mono_conc_hashtable_replace:
+ *
+ * Insert a value into the hashtable, replacing the value of @key if it is already
+ * present. Concurrent lookups see either the old or the new value, never NULL.
+ * Requires external locking.
+ * @Returns the old value if key is already present or null
+ */
+gpointer
+mono_conc_hashtable_replace (MonoConcurrentHashTable *hash_table, gpointer key, gpointer value)
+{
+	conc_table *table;
+	key_value_pair *kvs;
+	int hash, i, table_mask;
+
+	g_assert (key != NULL && key != TOMBSTONE);
+	g_assert (value != NULL);
+
+	hash = mix_hash (hash_table->hash_func (key));
+
+	table = (conc_table*)hash_table->table;
+	kvs = table->kvs;
+	table_mask = table->table_size - 1;
+	i = hash & table_mask;
+
+	while (kvs [i].key) {
+		if (kvs [i].key != TOMBSTONE && (hash_table->equal_func ? hash_table->equal_func (key, kvs [i].key) : key == kvs [i].key)) {
+			gpointer old_value = kvs [i].value;
+
+			mono_memory_barrier ();
+			kvs [i].value = value;
+			if (hash_table->value_destroy_func != NULL)
+				(*hash_table->value_destroy_func) (old_value);
+			return old_value;
+		}
+		i = (i + 1) & table_mask;
+	}
+
+	return mono_conc_hashtable_insert (hash_table, key, value);
+}
+
 /**
  * mono_conc_hashtable_foreach:
  *
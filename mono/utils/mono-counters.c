@@ -10,10 +10,21 @@
 #include "mono-counters.h"
 #include "mono-proclib.h"
 #include "mono-os-mutex.h"
+#include "mono-os-semaphore.h"
+#include "mono-membar.h"
+#include "mono-time.h"
+#include "mono-threads.h"
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#if defined(HAVE_SHM_OPEN) && !defined(HOST_WIN32)
+#include <errno.h>
+#include <string.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 struct _MonoCounter {
 	MonoCounter *next;
@@ -179,6 +190,9 @@ register_internal (const char *name, int type, void *addr, int size)
 
 	set_mask |= type;
 
+	/* The shared memory exporter walks the list without taking the lock */
+	mono_memory_write_barrier ();
+
 	/* Append */
 	if (counters) {
 		MonoCounter *item = counters;
@@ -518,6 +532,236 @@ mono_counters_sample (MonoCounter *counter, void *buffer, int buffer_size)
 	return sample_internal (counter, buffer, buffer_size);
 }
 
+#if defined(HAVE_SHM_OPEN) && !defined(HOST_WIN32)
+
+#define SHM_MAX_COUNTERS 1024
+#define SHM_NAMES_SIZE (64 * 1024)
+
+static MonoCountersShmHeader *shm_header;
+static size_t shm_size;
+static guint32 shm_names_used;
+/* Last counter which got an entry */
+static MonoCounter *shm_last;
+static guint64 shm_values [SHM_MAX_COUNTERS];
+static char shm_name [64];
+static MonoNativeThreadId shm_thread;
+static MonoSemType shm_stop_sem;
+static volatile gboolean shm_stop_requested;
+
+static MonoCountersShmEntry*
+shm_entries (void)
+{
+	return (MonoCountersShmEntry *) ((char *) shm_header + shm_header->entries_offset);
+}
+
+/* Add entries for the counters registered since the last update */
+static void
+shm_add_counters (void)
+{
+	MonoCountersShmEntry *entries = shm_entries ();
+	MonoCounter *counter = shm_last ? shm_last->next : counters;
+
+	for (; counter; counter = counter->next) {
+		guint32 index = shm_header->num_counters;
+		size_t len = strlen (counter->name) + 1;
+
+		if (index == shm_header->max_counters || shm_names_used + len > shm_size)
+			break;
+
+		entries [index].type = counter->type;
+		entries [index].name_offset = shm_names_used;
+		memcpy ((char *) shm_header + shm_names_used, counter->name, len);
+		shm_names_used += len;
+
+		mono_memory_write_barrier ();
+		shm_header->num_counters = index + 1;
+		shm_last = counter;
+	}
+}
+
+static guint64
+shm_sample (MonoCounter *counter)
+{
+	union {
+		int i;
+		guint u;
+		gint64 l;
+		guint64 ul;
+		gssize w;
+		double d;
+	} value;
+
+	if (mono_counter_get_type (counter) == MONO_COUNTER_STRING || sample_internal (counter, &value, sizeof (value)) < 0)
+		return 0;
+
+	switch (mono_counter_get_type (counter)) {
+	case MONO_COUNTER_INT:
+		return (guint64) (gint64) value.i;
+	case MONO_COUNTER_UINT:
+		return value.u;
+	case MONO_COUNTER_WORD:
+		return (guint64) (gint64) value.w;
+	case MONO_COUNTER_DOUBLE: {
+		guint64 bits;
+		memcpy (&bits, &value.d, sizeof (bits));
+		return bits;
+	}
+	default:
+		return value.ul;
+	}
+}
+
+static void
+shm_update (void)
+{
+	MonoCountersShmEntry *entries;
+	MonoCounter *counter;
+	guint32 i, num;
+
+	shm_add_counters ();
+
+	/* Sample before starting the update, so readers don't retry while callbacks run */
+	num = shm_header->num_counters;
+	for (i = 0, counter = counters; i < num; ++i, counter = counter->next)
+		shm_values [i] = shm_sample (counter);
+
+	entries = shm_entries ();
+
+	shm_header->sequence++;
+	mono_memory_write_barrier ();
+
+	for (i = 0; i < num; ++i)
+		entries [i].value = shm_values [i];
+	shm_header->timestamp = mono_100ns_datetime ();
+
+	mono_memory_write_barrier ();
+	shm_header->sequence++;
+}
+
+static void*
+shm_thread_func (void *arg)
+{
+	mono_threads_attach_tools_thread ();
+	mono_native_thread_set_name (mono_native_thread_id_get (), "Counters exporter");
+
+	while (!shm_stop_requested) {
+		shm_update ();
+		mono_os_sem_timedwait (&shm_stop_sem, shm_header->interval_ms, MONO_SEM_FLAGS_NONE);
+	}
+
+	return NULL;
+}
+
+/**
+ * mono_counters_shm_start:
+ * @interval_ms: how often the values are updated
+ *
+ * Export the counters through a shared memory segment, see MonoCountersShmHeader.
+ *
+ * Returns: TRUE if the segment and the thread updating it could be created.
+ */
+mono_bool
+mono_counters_shm_start (int interval_ms)
+{
+	MonoCountersShmHeader *header;
+	void *res;
+	int fd;
+
+	if (!initialized || shm_header)
+		return FALSE;
+
+	if (interval_ms <= 0)
+		interval_ms = 1000;
+
+	shm_size = sizeof (MonoCountersShmHeader) + SHM_MAX_COUNTERS * sizeof (MonoCountersShmEntry) + SHM_NAMES_SIZE;
+
+	g_snprintf (shm_name, sizeof (shm_name), "/mono-counters.%d", getpid ());
+
+	fd = shm_open (shm_name, O_CREAT|O_EXCL|O_RDWR, S_IRUSR|S_IWUSR|S_IRGRP);
+	if (fd == -1 && errno == EEXIST) {
+		/* leftover of a dead process with the same pid */
+		shm_unlink (shm_name);
+		fd = shm_open (shm_name, O_CREAT|O_EXCL|O_RDWR, S_IRUSR|S_IWUSR|S_IRGRP);
+	}
+	if (fd == -1)
+		return FALSE;
+
+	if (ftruncate (fd, shm_size) != 0) {
+		close (fd);
+		shm_unlink (shm_name);
+		return FALSE;
+	}
+
+	res = mmap (NULL, shm_size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	/* we don't need the file descriptor anymore */
+	close (fd);
+	if (res == MAP_FAILED) {
+		shm_unlink (shm_name);
+		return FALSE;
+	}
+
+	header = (MonoCountersShmHeader *) res;
+	header->version = MONO_COUNTERS_SHM_VERSION;
+	header->size = shm_size;
+	header->interval_ms = interval_ms;
+	header->max_counters = SHM_MAX_COUNTERS;
+	header->entries_offset = sizeof (MonoCountersShmHeader);
+	shm_names_used = header->entries_offset + SHM_MAX_COUNTERS * sizeof (MonoCountersShmEntry);
+
+	/* Readers check the magic first */
+	mono_memory_write_barrier ();
+	header->magic = MONO_COUNTERS_SHM_MAGIC;
+
+	shm_header = header;
+	mono_os_sem_init (&shm_stop_sem, 0);
+
+	if (!mono_native_thread_create (&shm_thread, shm_thread_func, NULL)) {
+		mono_os_sem_destroy (&shm_stop_sem);
+		shm_header = NULL;
+		munmap (res, shm_size);
+		shm_unlink (shm_name);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/**
+ * mono_counters_shm_stop:
+ *
+ * Stop updating the shared memory segment created by mono_counters_shm_start () and remove it.
+ */
+void
+mono_counters_shm_stop (void)
+{
+	if (!shm_header)
+		return;
+
+	shm_stop_requested = TRUE;
+	mono_os_sem_post (&shm_stop_sem);
+	mono_native_thread_join (shm_thread);
+	mono_os_sem_destroy (&shm_stop_sem);
+
+	munmap (shm_header, shm_size);
+	shm_header = NULL;
+	shm_unlink (shm_name);
+}
+
+#else
+
+mono_bool
+mono_counters_shm_start (int interval_ms)
+{
+	return FALSE;
+}
+
+void
+mono_counters_shm_stop (void)
+{
+}
+
+#endif
+
 #define ENTRY_FMT "%-36s: "
 static void
 dump_counter (MonoCounter *counter, FILE *outfile) {
@@ -641,6 +885,8 @@ mono_counters_cleanup (void)
 	if (!initialized)
 		return;
 
+	mono_counters_shm_stop ();
+
 	mono_os_mutex_lock (&counters_mutex);
 
 	counter = counters;
@@ -75,6 +75,49 @@ MONO_API void mono_counters_foreach (CountersEnumCallback cb, void *user_data);
 
 MONO_API int mono_counters_sample (MonoCounter *counter, void *buffer, int buffer_size);
 
+/*
+ * Shared memory export of the counters.
+ *
+ * mono_counters_shm_start () creates the POSIX shared memory segment
+ * "/mono-counters.<pid>" and a thread which copies the value of every counter
+ * into it each @interval_ms milliseconds. External agents map the segment
+ * read only and read the values without any involvement of the runtime:
+ *
+ * - Check the magic and the version.
+ * - Read the sequence number, wait while it is odd.
+ * - Copy the entries, then read the sequence number again. If it changed, the
+ *   copy raced with an update and has to be redone.
+ *
+ * Entries are only ever appended, and names are NUL-terminated strings at
+ * name_offset from the start of the segment. Integer values are sign or zero
+ * extended to 64 bits, doubles are stored as their bit pattern and strings are
+ * not exported.
+ */
+#define MONO_COUNTERS_SHM_MAGIC 0x544e434d
+#define MONO_COUNTERS_SHM_VERSION 1
+
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t size;
+	uint32_t interval_ms;
+	volatile uint32_t sequence;
+	volatile uint32_t num_counters;
+	uint32_t max_counters;
+	uint32_t entries_offset;
+	/* 100ns units since the Unix epoch */
+	volatile int64_t timestamp;
+} MonoCountersShmHeader;
+
+typedef struct {
+	uint32_t type;
+	uint32_t name_offset;
+	volatile uint64_t value;
+} MonoCountersShmEntry;
+
+MONO_API mono_bool mono_counters_shm_start (int interval_ms);
+MONO_API void mono_counters_shm_stop (void);
+
 MONO_API const char* mono_counter_get_name (MonoCounter *name);
 MONO_API int mono_counter_get_type (MonoCounter *counter);
 MONO_API int mono_counter_get_section (MonoCounter *counter);
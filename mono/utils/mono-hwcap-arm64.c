@@ -7,7 +7,27 @@
 
 #include "mono/utils/mono-hwcap.h"
 
+#if defined(HAVE_SYS_AUXV_H) && !defined(PLATFORM_ANDROID)
+#include <sys/auxv.h>
+#endif
+
 void
 mono_hwcap_arch_init (void)
 {
+#if defined(HAVE_SYS_AUXV_H) && !defined(PLATFORM_ANDROID)
+	unsigned long hwcap;
+
+	if ((hwcap = getauxval(AT_HWCAP))) {
+		/* HWCAP_ASIMD, detection only, the JIT doesn't emit NEON code yet */
+		if (hwcap & 0x00000002)
+			mono_hwcap_arm64_has_neon = TRUE;
+
+		/* HWCAP_ATOMICS */
+		if (hwcap & 0x00000100)
+			mono_hwcap_arm64_has_lse = TRUE;
+	}
+#elif defined(__APPLE__)
+	/* All Apple ARM64 devices have Advanced SIMD */
+	mono_hwcap_arm64_has_neon = TRUE;
+#endif
 }
@@ -13,7 +13,8 @@ MONO_HWCAP_VAR(arm_has_thumb2)
 
 #elif defined (TARGET_ARM64)
 
-// Nothing here yet.
+MONO_HWCAP_VAR(arm64_has_neon)
+MONO_HWCAP_VAR(arm64_has_lse)
 
 #elif defined (TARGET_IA64)
 
@@ -52,5 +53,11 @@ MONO_HWCAP_VAR(x86_has_ssse3)
 MONO_HWCAP_VAR(x86_has_sse41)
 MONO_HWCAP_VAR(x86_has_sse42)
 MONO_HWCAP_VAR(x86_has_sse4a)
+MONO_HWCAP_VAR(x86_has_avx)
+MONO_HWCAP_VAR(x86_has_avx2)
+MONO_HWCAP_VAR(x86_has_fma)
+MONO_HWCAP_VAR(x86_has_avx512f)
+MONO_HWCAP_VAR(x86_has_avx512bw)
+MONO_HWCAP_VAR(x86_has_avx512vl)
 
 #endif
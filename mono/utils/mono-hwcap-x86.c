@@ -77,9 +77,10 @@ cpuid (int id, int *p_eax, int *p_ebx, int *p_ecx, int *p_edx)
 #endif
 
 	/* Now issue the actual cpuid instruction. We can use
-	   MSVC's __cpuid on both 32-bit and 64-bit. */
+	   MSVC's __cpuidex on both 32-bit and 64-bit. The
+	   subleaf in ecx is always 0. */
 #if defined(_MSC_VER)
-	__cpuid (info, id);
+	__cpuidex (info, id, 0);
 	*p_eax = info [0];
 	*p_ebx = info [1];
 	*p_ecx = info [2];
@@ -92,23 +93,47 @@ cpuid (int id, int *p_eax, int *p_ebx, int *p_ecx, int *p_edx)
 		"cpuid\n\t"
 		"xchgl\t%%ebx, %k1\n\t"
 		: "=a" (*p_eax), "=&r" (*p_ebx), "=c" (*p_ecx), "=d" (*p_edx)
-		: "0" (id)
+		: "0" (id), "2" (0)
 	);
 #else
 	__asm__ __volatile__ (
 		"cpuid\n\t"
 		: "=a" (*p_eax), "=b" (*p_ebx), "=c" (*p_ecx), "=d" (*p_edx)
-		: "a" (id)
+		: "a" (id), "c" (0)
 	);
 #endif
 
 	return TRUE;
 }
 
+/*
+ * Return the state components the OS saves on context switches (XCR0). Only
+ * valid if cpuid reports OSXSAVE.
+ */
+static guint64
+xgetbv (void)
+{
+#if defined(_MSC_VER)
+	return _xgetbv (0);
+#else
+	guint32 eax, edx;
+
+	/* xgetbv, not known to older assemblers */
+	__asm__ __volatile__ (
+		".byte 0x0f, 0x01, 0xd0\n\t"
+		: "=a" (eax), "=d" (edx)
+		: "c" (0)
+	);
+
+	return ((guint64) edx << 32) | eax;
+#endif
+}
+
 void
 mono_hwcap_arch_init (void)
 {
 	int eax, ebx, ecx, edx;
+	guint64 xcr0 = 0;
 
 	if (cpuid (1, &eax, &ebx, &ecx, &edx)) {
 		if (edx & (1 << 15)) {
@@ -135,6 +160,33 @@ mono_hwcap_arch_init (void)
 
 		if (ecx & (1 << 20))
 			mono_hwcap_x86_has_sse42 = TRUE;
+
+		/* The AVX registers are only usable if the OS saves them (OSXSAVE, XMM and YMM state) */
+		if (ecx & (1 << 27))
+			xcr0 = xgetbv ();
+
+		if ((ecx & (1 << 28)) && (xcr0 & 0x6) == 0x6) {
+			mono_hwcap_x86_has_avx = TRUE;
+
+			if (ecx & (1 << 12))
+				mono_hwcap_x86_has_fma = TRUE;
+		}
+	}
+
+	if (mono_hwcap_x86_has_avx && cpuid (0, &eax, &ebx, &ecx, &edx) && eax >= 7 && cpuid (7, &eax, &ebx, &ecx, &edx)) {
+		if (ebx & (1 << 5))
+			mono_hwcap_x86_has_avx2 = TRUE;
+
+		/* AVX-512 additionally needs the opmask and ZMM state */
+		if ((ebx & (1 << 16)) && (xcr0 & 0xe6) == 0xe6) {
+			mono_hwcap_x86_has_avx512f = TRUE;
+
+			if (ebx & (1 << 30))
+				mono_hwcap_x86_has_avx512bw = TRUE;
+
+			if (ebx & 0x80000000)
+				mono_hwcap_x86_has_avx512vl = TRUE;
+		}
 	}
 
 	if (cpuid (0x80000000, &eax, &ebx, &ecx, &edx)) {
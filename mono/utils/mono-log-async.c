@@ -0,0 +1,307 @@
+/*
+ * mono-log-async.c: Asynchronous backend for the logger
+ *
+ * When MONO_LOG_ASYNC is set, log messages are copied into a ring buffer
+ * owned by the thread logging them and a background thread hands them to
+ * the real destination (log file, syslog, ...). Logging threads never wait
+ * for the destination: if their buffer is full the message is dropped, and
+ * the writer thread reports how many messages were dropped.
+ *
+ * Messages logged by different threads can be written in a different order
+ * than they were logged in. Errors are written synchronously, after the
+ * pending messages, since writing them aborts.
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+#include <config.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <glib.h>
+#include "mono-logger-internals.h"
+#include "mono-threads.h"
+#include "mono-os-mutex.h"
+#include "mono-os-semaphore.h"
+#include "mono-tls.h"
+#include "mono-membar.h"
+#include "atomic.h"
+
+#define LOG_BUFFER_SIZE (64 * 1024)
+/* How often the writer thread looks for new messages, in ms */
+#define LOG_WRITER_INTERVAL 50
+#define RECORD_ALIGN 16
+
+enum {
+	RECORD_MESSAGE,
+	/* Fills the end of the buffer when a record doesn't fit there */
+	RECORD_PADDING
+};
+
+typedef struct {
+	guint32 size;
+	guint16 kind;
+	guint8 hdr;
+	guint8 has_domain;
+	gint32 level;
+	/* Followed by the NUL terminated domain, if any, and message */
+} LogRecord;
+
+typedef struct _LogBuffer LogBuffer;
+struct _LogBuffer {
+	LogBuffer *next;
+	/* Set when the owning thread exited, the buffer can be reused once it's empty */
+	volatile gint32 orphaned;
+	/* Free running, only the owner changes write_pos and only the writer read_pos */
+	volatile guint32 write_pos;
+	volatile guint32 read_pos;
+	char data [LOG_BUFFER_SIZE];
+};
+
+static LogBuffer * volatile buffers;
+static MonoNativeTlsKey buffer_key;
+static volatile gint32 dropped_count;
+static gint32 reported_dropped_count;
+
+/* The logger the messages are written to */
+static MonoLogCallParm target;
+
+static gboolean inited;
+static mono_mutex_t drain_mutex;
+static MonoSemType writer_sem;
+static MonoNativeThreadId writer_thread;
+static gboolean writer_running;
+static volatile gboolean writer_stop;
+
+static void
+buffer_orphan (void *data)
+{
+	LogBuffer *buf = (LogBuffer *) data;
+
+	mono_memory_barrier ();
+	buf->orphaned = 1;
+}
+
+static LogBuffer*
+get_buffer (void)
+{
+	LogBuffer *buf = (LogBuffer *) mono_native_tls_get_value (buffer_key);
+	LogBuffer *head;
+
+	if (buf)
+		return buf;
+
+	for (buf = buffers; buf; buf = buf->next) {
+		if (buf->orphaned && buf->read_pos == buf->write_pos && InterlockedCompareExchange (&buf->orphaned, 0, 1) == 1)
+			goto found;
+	}
+
+	buf = g_new0 (LogBuffer, 1);
+	do {
+		head = buffers;
+		buf->next = head;
+	} while (InterlockedCompareExchangePointer ((gpointer volatile *) &buffers, buf, head) != head);
+
+found:
+	mono_native_tls_set_value (buffer_key, buf);
+	return buf;
+}
+
+static void
+drain_buffer (LogBuffer *buf)
+{
+	guint32 read = buf->read_pos;
+	guint32 write = buf->write_pos;
+
+	/* The record contents were written before write_pos */
+	mono_memory_read_barrier ();
+
+	while (read != write) {
+		LogRecord *rec = (LogRecord *) (buf->data + read % LOG_BUFFER_SIZE);
+
+		if (rec->kind == RECORD_MESSAGE) {
+			const char *domain = (const char *) (rec + 1);
+			const char *message = rec->has_domain ? domain + strlen (domain) + 1 : domain;
+
+			target.writer (rec->has_domain ? domain : NULL, (GLogLevelFlags) rec->level, rec->hdr, message);
+		}
+
+		read += rec->size;
+		/* Done with the record before the owner can overwrite it */
+		mono_memory_barrier ();
+		buf->read_pos = read;
+	}
+}
+
+static void
+drain_all (void)
+{
+	LogBuffer *buf;
+	gint32 dropped;
+
+	mono_os_mutex_lock (&drain_mutex);
+
+	for (buf = buffers; buf; buf = buf->next)
+		drain_buffer (buf);
+
+	dropped = dropped_count;
+	if (dropped != reported_dropped_count) {
+		char message [64];
+
+		g_snprintf (message, sizeof (message), "%d log messages were dropped", dropped - reported_dropped_count);
+		target.writer ("Mono", G_LOG_LEVEL_WARNING, mono_trace_log_header, message);
+		reported_dropped_count = dropped;
+	}
+
+	mono_os_mutex_unlock (&drain_mutex);
+}
+
+static void*
+writer_thread_func (void *arg)
+{
+	mono_native_thread_set_name (mono_native_thread_id_get (), "Log writer");
+
+	while (!writer_stop) {
+		mono_os_sem_timedwait (&writer_sem, LOG_WRITER_INTERVAL, MONO_SEM_FLAGS_NONE);
+		drain_all ();
+	}
+
+	return NULL;
+}
+
+static void
+flush_at_exit (void)
+{
+	if (writer_running)
+		drain_all ();
+}
+
+/**
+ * mono_log_async_set_target:
+ *
+ * 	Set the logger the async backend writes to.
+ */
+void
+mono_log_async_set_target (MonoLogCallParm *logger)
+{
+	target = *logger;
+}
+
+/**
+ * mono_log_open_async:
+ *
+ * 	Open the target logger and start the writer thread.
+ */
+void
+mono_log_open_async (const char *path, void *userData)
+{
+	target.opener (path, userData);
+
+	if (!inited) {
+#ifdef HOST_WIN32
+		/* No TLS destructors, so buffers of exited threads are not reused */
+		mono_native_tls_alloc (&buffer_key, NULL);
+#else
+		mono_native_tls_alloc (&buffer_key, (void *) buffer_orphan);
+#endif
+		mono_os_mutex_init (&drain_mutex);
+		mono_os_sem_init (&writer_sem, 0);
+		atexit (flush_at_exit);
+		inited = TRUE;
+	}
+
+	writer_stop = FALSE;
+	writer_running = mono_native_thread_create (&writer_thread, writer_thread_func, NULL);
+}
+
+/**
+ * mono_log_write_async:
+ *
+ * 	Queue a message for the writer thread.
+ *
+ * 	@domain - Identifier string
+ * 	@level - Logging level flags
+ * 	@hdr - Whether to add the pid/date/time header
+ * 	@message - The message
+ */
+void
+mono_log_write_async (const char *log_domain, GLogLevelFlags level, mono_bool hdr, const char *message)
+{
+	LogBuffer *buf;
+	LogRecord *rec;
+	size_t domain_len, message_len;
+	guint32 read, write, offset, contiguous, size;
+
+	if (!writer_running || (level & G_LOG_LEVEL_ERROR)) {
+		if (writer_running)
+			drain_all ();
+		target.writer (log_domain, level, hdr, message);
+		return;
+	}
+
+	domain_len = log_domain ? strlen (log_domain) + 1 : 0;
+	message_len = strlen (message) + 1;
+	if (sizeof (LogRecord) + domain_len + message_len > LOG_BUFFER_SIZE / 4) {
+		InterlockedIncrement (&dropped_count);
+		return;
+	}
+	size = (sizeof (LogRecord) + domain_len + message_len + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+
+	buf = get_buffer ();
+	read = buf->read_pos;
+	write = buf->write_pos;
+	offset = write % LOG_BUFFER_SIZE;
+	contiguous = LOG_BUFFER_SIZE - offset;
+
+	if (LOG_BUFFER_SIZE - (write - read) < size + (contiguous < size ? contiguous : 0)) {
+		InterlockedIncrement (&dropped_count);
+		mono_os_sem_post (&writer_sem);
+		return;
+	}
+
+	/* The writer is done with the space we are about to use */
+	mono_memory_barrier ();
+
+	if (contiguous < size) {
+		rec = (LogRecord *) (buf->data + offset);
+		rec->size = contiguous;
+		rec->kind = RECORD_PADDING;
+		write += contiguous;
+		offset = 0;
+	}
+
+	rec = (LogRecord *) (buf->data + offset);
+	rec->size = size;
+	rec->kind = RECORD_MESSAGE;
+	rec->hdr = hdr;
+	rec->has_domain = log_domain != NULL;
+	rec->level = level;
+	if (log_domain)
+		memcpy (rec + 1, log_domain, domain_len);
+	memcpy ((char *) (rec + 1) + domain_len, message, message_len);
+
+	mono_memory_write_barrier ();
+	buf->write_pos = write + size;
+
+	/* Don't wait for the next interval if the buffer fills up */
+	if (write + size - read > LOG_BUFFER_SIZE / 2)
+		mono_os_sem_post (&writer_sem);
+}
+
+/**
+ * mono_log_close_async:
+ *
+ * 	Stop the writer thread, write the pending messages and close the target logger.
+ */
+void
+mono_log_close_async (void)
+{
+	if (writer_running) {
+		writer_stop = TRUE;
+		mono_os_sem_post (&writer_sem);
+		mono_native_thread_join (writer_thread);
+		drain_all ();
+		writer_running = FALSE;
+	}
+
+	target.closer ();
+}
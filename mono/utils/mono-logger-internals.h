@@ -33,6 +33,7 @@ typedef enum {
 
 extern GLogLevelFlags mono_internal_current_level;
 extern MonoTraceMask mono_internal_current_mask;
+extern gboolean mono_trace_log_header;
 
 void 
 mono_trace_init (void);
@@ -175,6 +176,11 @@ void mono_log_open_logfile (const char *, void *);
 void mono_log_write_logfile (const char *, GLogLevelFlags, mono_bool, const char *);
 void mono_log_close_logfile (void);
 
+void mono_log_async_set_target (MonoLogCallParm *logger);
+void mono_log_open_async (const char *, void *);
+void mono_log_write_async (const char *, GLogLevelFlags, mono_bool, const char *);
+void mono_log_close_async (void);
+
 #if PLATFORM_ANDROID
 void mono_log_open_logcat (const char *path, void *userData);
 void mono_log_write_logcat (const char *log_domain, GLogLevelFlags level, mono_bool hdr, const char *message);
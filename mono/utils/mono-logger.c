@@ -14,6 +14,7 @@ typedef struct {
 GLogLevelFlags mono_internal_current_level	= INT_MAX;
 MonoTraceMask  mono_internal_current_mask	= MONO_TRACE_ALL;
 gboolean mono_trace_log_header			= FALSE;
+static gboolean mono_trace_log_async		= FALSE;
 
 static GQueue		*level_stack		= NULL;
 static const char	*mono_log_domain	= "Mono";
@@ -46,6 +47,7 @@ mono_trace_init (void)
 		mono_trace_set_mask_string(g_getenv("MONO_LOG_MASK"));
 		mono_trace_set_level_string(g_getenv("MONO_LOG_LEVEL"));
 		mono_trace_set_logheader_string(g_getenv("MONO_LOG_HEADER"));
+		mono_trace_log_async = g_getenv("MONO_LOG_ASYNC") != NULL;
 		mono_trace_set_logdest_string(g_getenv("MONO_LOG_DEST"));
 	}
 }
@@ -81,7 +83,11 @@ mono_trace_cleanup (void)
 void 
 mono_tracev_inner (GLogLevelFlags level, MonoTraceMask mask, const char *format, va_list args)
 {
+	char buffer [256];
 	char *log_message;
+	va_list args_copy;
+	int len;
+
 	if (level_stack == NULL) {
 		mono_trace_init ();
 		if(level > mono_internal_current_level || !(mask & mono_internal_current_mask))
@@ -90,6 +96,15 @@ mono_tracev_inner (GLogLevelFlags level, MonoTraceMask mask, const char *format,
 
 	g_assert (logCallback.opener); // mono_trace_init should have provided us with one!
 
+	/* Most messages are short, avoid allocating for them */
+	va_copy (args_copy, args);
+	len = g_vsnprintf (buffer, sizeof (buffer), format, args_copy);
+	va_end (args_copy);
+	if (len >= 0 && len < sizeof (buffer)) {
+		logCallback.writer (mono_log_domain, level, logCallback.header, buffer);
+		return;
+	}
+
 	if (g_vasprintf (&log_message, format, args) < 0)
 		return;
 	logCallback.writer (mono_log_domain, level, logCallback.header, log_message);
@@ -446,9 +461,17 @@ mono_trace_set_log_handler_internal (MonoLogCallParm *callback, void *user_data)
 	g_assert (callback);
 	if (logCallback.closer != NULL)
 		logCallback.closer();
-	logCallback.opener = callback->opener;
-	logCallback.writer = callback->writer;
-	logCallback.closer = callback->closer;
+	if (mono_trace_log_async) {
+		/* Write through a background thread, see mono-log-async.c */
+		mono_log_async_set_target (callback);
+		logCallback.opener = mono_log_open_async;
+		logCallback.writer = mono_log_write_async;
+		logCallback.closer = mono_log_close_async;
+	} else {
+		logCallback.opener = callback->opener;
+		logCallback.writer = callback->writer;
+		logCallback.closer = callback->closer;
+	}
 	logCallback.header = mono_trace_log_header;
 	logCallback.dest   = callback->dest;
 	logCallback.opener (logCallback.dest, user_data);
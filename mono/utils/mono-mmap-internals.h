@@ -12,6 +12,8 @@
 #include "mono-compiler.h"
 
 int mono_pages_not_faulted (void *addr, size_t length);
+int mono_vbind_numa_node (void *addr, size_t length, int node);
+int mono_vprefetch (void *addr, size_t length);
 
 #endif /* __MONO_UTILS_MMAP_INTERNAL_H__ */
 
@@ -29,6 +29,9 @@
 #include <unistd.h>
 #include <stdlib.h>
 #include <errno.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #endif
 
 #include "mono-mmap.h"
@@ -815,3 +818,55 @@ mono_pages_not_faulted (void *addr, size_t size)
 	return -1;
 #endif
 }
+
+/*
+ * mono_vbind_numa_node:
+ *
+ * Ask the OS to back the memory area at @addr for @length bytes with pages
+ * from NUMA node @node.  The area must not have been touched yet for the
+ * binding to have any effect.  This is only a placement hint: if the node
+ * runs out of memory pages can still come from other nodes.
+ *
+ * Returns: 0 on success, -1 on failure or if not supported on this platform.
+ */
+int
+mono_vbind_numa_node (void *addr, size_t length, int node)
+{
+#if defined(__linux__) && defined(SYS_mbind) && !defined(PLATFORM_ANDROID)
+	/* From <numaif.h>, which we don't want to depend on. */
+	const int mpol_preferred = 1;
+	unsigned long nodemask [4];
+	const int bits_per_word = sizeof (unsigned long) * 8;
+
+	if (node < 0 || node >= (int)(G_N_ELEMENTS (nodemask) * bits_per_word))
+		return -1;
+
+	memset (nodemask, 0, sizeof (nodemask));
+	nodemask [node / bits_per_word] = 1UL << (node % bits_per_word);
+
+	return syscall (SYS_mbind, addr, length, mpol_preferred, nodemask, G_N_ELEMENTS (nodemask) * bits_per_word, 0) == 0 ? 0 : -1;
+#else
+	return -1;
+#endif
+}
+
+/*
+ * mono_vprefetch:
+ *
+ * Tell the OS that the mapped pages at @addr for @length bytes will be accessed
+ * soon, so it can start reading them in the background instead of faulting them
+ * in one at a time.
+ *
+ * Returns: 0 on success, -1 on failure or if not supported on this platform.
+ */
+int
+mono_vprefetch (void *addr, size_t length)
+{
+#if defined(HAVE_MADVISE) && defined(MADV_WILLNEED)
+	char *start = (char *)((gsize)addr & ~(gsize)(mono_pagesize () - 1));
+
+	return madvise (start, length + ((char *)addr - start), MADV_WILLNEED) == 0 ? 0 : -1;
+#else
+	return -1;
+#endif
+}
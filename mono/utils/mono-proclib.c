@@ -15,7 +15,7 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
-#ifdef HAVE_SCHED_GETAFFINITY
+#if defined(HAVE_SCHED_GETAFFINITY) || defined(HAVE_SCHED_GETCPU)
 #include <sched.h>
 #endif
 
@@ -869,6 +869,105 @@ mono_cpu_get_data (int cpu_id, MonoCpuData data, MonoProcessError *error)
 	return value;
 }
 
+/**
+ * mono_cpu_current:
+ *
+ * Return the index of the processor the calling thread is running on, or -1
+ * if it can't be determined.  The result is only a hint, since the thread
+ * may be migrated at any time.
+ */
+int
+mono_cpu_current (void)
+{
+#ifdef HAVE_SCHED_GETCPU
+	return sched_getcpu ();
+#else
+	return -1;
+#endif
+}
+
+/**
+ * mono_numa_node_count:
+ *
+ * Return the number of NUMA nodes on the system, or 1 if the system is not
+ * a NUMA system or the topology can't be determined.
+ */
+int
+mono_numa_node_count (void)
+{
+#ifdef __linux__
+	int count = 0;
+	char path [64];
+
+	for (;;) {
+		g_snprintf (path, sizeof (path), "/sys/devices/system/node/node%d", count);
+		if (!g_file_test (path, G_FILE_TEST_IS_DIR))
+			break;
+		++count;
+	}
+	if (count > 0)
+		return count;
+#endif
+	return 1;
+}
+
+/**
+ * mono_numa_get_cpu_nodes:
+ * @cpu_to_node: an array indexed by processor number
+ * @max_cpus: the number of elements in @cpu_to_node
+ *
+ * Fill @cpu_to_node with the NUMA node of every processor below @max_cpus.
+ * Processors that aren't listed under any node are set to -1.
+ *
+ * Returns: the number of nodes found, or 0 if the topology can't be determined.
+ */
+int
+mono_numa_get_cpu_nodes (int *cpu_to_node, int max_cpus)
+{
+	int i, nodes = 0;
+#ifdef __linux__
+	int node;
+#endif
+
+	for (i = 0; i < max_cpus; ++i)
+		cpu_to_node [i] = -1;
+
+#ifdef __linux__
+	for (node = 0; ; ++node) {
+		char path [64];
+		char *list, *s;
+
+		g_snprintf (path, sizeof (path), "/sys/devices/system/node/node%d/cpulist", node);
+		if (!g_file_get_contents (path, &list, NULL, NULL))
+			break;
+		++nodes;
+
+		/* The format is a comma separated list of ranges like "0-3,8-11" */
+		for (s = list; *s && *s != '\n';) {
+			char *end;
+			long first, last;
+
+			first = last = strtol (s, &end, 10);
+			if (end == s)
+				break;
+			if (*end == '-') {
+				s = end + 1;
+				last = strtol (s, &end, 10);
+				if (end == s)
+					break;
+			}
+			for (i = first; i <= last && i < max_cpus; ++i)
+				cpu_to_node [i] = node;
+			s = end;
+			if (*s == ',')
+				++s;
+		}
+		g_free (list);
+	}
+#endif
+	return nodes;
+}
+
 int
 mono_atexit (void (*func)(void))
 {
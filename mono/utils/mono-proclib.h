@@ -70,6 +70,10 @@ int       mono_process_current_pid (void);
 int       mono_cpu_count    (void);
 gint64    mono_cpu_get_data (int cpu_id, MonoCpuData data, MonoProcessError *error);
 gint32    mono_cpu_usage (MonoCpuUsageState *prev);
+int       mono_cpu_current (void);
+
+int       mono_numa_node_count (void);
+int       mono_numa_get_cpu_nodes (int *cpu_to_node, int max_cpus);
 
 int       mono_atexit (void (*func)(void));
 
@@ -0,0 +1,304 @@
+/*
+ * mono-startup-trace.c: Startup time tracing
+ *
+ * With --trace-startup, the runtime records the wall clock and thread CPU time
+ * of each startup phase: runtime initialization, assembly loads, AOT image
+ * loads, static constructors and JIT compilations. Tracing stops when the
+ * entry point is about to run, and the events are then written as JSON along
+ * with the total time of each phase.
+ *
+ * Events can nest, for example an assembly load inside a static constructor.
+ * Each event has its inclusive time, and an event nested inside an event of
+ * the same phase is not counted again in that phase's total.
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#include <config.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "mono-startup-trace.h"
+#include "mono-os-mutex.h"
+#include "mono-threads.h"
+#include "mono-time.h"
+#include "mono-tls.h"
+#include "json.h"
+
+/* Keep the trace bounded if startup compiles a lot of methods */
+#define MAX_EVENTS 100000
+
+typedef struct {
+	MonoStartupPhase phase;
+	char *name;
+	gint64 start;
+	gint64 wall;
+	gint64 cpu;
+	int depth;
+	gboolean nested;
+	gsize thread;
+} StartupEvent;
+
+typedef struct {
+	int depth;
+	int active [MONO_STARTUP_PHASE_NUM];
+} ThreadNesting;
+
+gboolean mono_startup_trace_enabled;
+
+static char *trace_path;
+static gboolean finished;
+static mono_mutex_t trace_mutex;
+static MonoNativeTlsKey nesting_key;
+static GArray *events;
+static gint32 dropped_events;
+static MonoStartupTraceStamp start_stamp;
+
+static const char *phase_names [] = {
+	"runtime_init",
+	"assembly_load",
+	"aot_load",
+	"class_init",
+	"jit",
+};
+
+static gint64
+thread_cpu_ticks (void)
+{
+#if defined(CLOCK_THREAD_CPUTIME_ID) && !defined(HOST_WIN32)
+	struct timespec ts;
+
+	if (clock_gettime (CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+		return (gint64) ts.tv_sec * 10000000 + ts.tv_nsec / 100;
+#endif
+	return 0;
+}
+
+static ThreadNesting*
+get_nesting (void)
+{
+	ThreadNesting *nesting = (ThreadNesting *) mono_native_tls_get_value (nesting_key);
+
+	if (!nesting) {
+		nesting = g_new0 (ThreadNesting, 1);
+		mono_native_tls_set_value (nesting_key, nesting);
+	}
+	return nesting;
+}
+
+/**
+ * mono_startup_trace_init:
+ *
+ *   Start recording startup events, which are written to @path, or to
+ * stdout if it's NULL.
+ */
+void
+mono_startup_trace_init (const char *path)
+{
+	if (mono_startup_trace_enabled)
+		return;
+
+	trace_path = g_strdup (path);
+	mono_os_mutex_init (&trace_mutex);
+	mono_native_tls_alloc (&nesting_key, NULL);
+	events = g_array_new (FALSE, FALSE, sizeof (StartupEvent));
+	start_stamp.wall = mono_100ns_ticks ();
+	start_stamp.cpu = thread_cpu_ticks ();
+	mono_startup_trace_enabled = TRUE;
+}
+
+/**
+ * mono_startup_trace_begin:
+ *
+ *   Start timing an event of @phase, which is recorded by the matching
+ * mono_startup_trace_end () call.
+ */
+void
+mono_startup_trace_begin (MonoStartupPhase phase, MonoStartupTraceStamp *stamp)
+{
+	ThreadNesting *nesting = get_nesting ();
+
+	nesting->depth++;
+	nesting->active [phase]++;
+	stamp->cpu = thread_cpu_ticks ();
+	stamp->wall = mono_100ns_ticks ();
+}
+
+/**
+ * mono_startup_trace_end:
+ *
+ *   Record the event of @phase started with @stamp. @name identifies the
+ * assembly, class or method, it's copied.
+ */
+void
+mono_startup_trace_end (MonoStartupPhase phase, MonoStartupTraceStamp *stamp, const char *name)
+{
+	ThreadNesting *nesting = get_nesting ();
+	StartupEvent ev;
+
+	ev.wall = mono_100ns_ticks () - stamp->wall;
+	ev.cpu = thread_cpu_ticks () - stamp->cpu;
+	ev.start = stamp->wall - start_stamp.wall;
+	ev.phase = phase;
+	nesting->depth--;
+	nesting->active [phase]--;
+	ev.depth = nesting->depth;
+	ev.nested = nesting->active [phase] > 0;
+	ev.thread = MONO_NATIVE_THREAD_ID_TO_UINT (mono_native_thread_id_get ());
+
+	mono_os_mutex_lock (&trace_mutex);
+	if (finished) {
+		mono_os_mutex_unlock (&trace_mutex);
+		return;
+	}
+	if (events->len >= MAX_EVENTS) {
+		dropped_events++;
+		mono_os_mutex_unlock (&trace_mutex);
+		return;
+	}
+	ev.name = g_strdup (name ? name : "");
+	g_array_append_val (events, ev);
+	mono_os_mutex_unlock (&trace_mutex);
+}
+
+static void
+write_string (JsonWriter *writer, const char *s)
+{
+	mono_json_writer_printf (writer, "\"");
+	for (; *s; ++s) {
+		if (*s == '"' || *s == '\\')
+			mono_json_writer_printf (writer, "\\%c", *s);
+		else if ((guchar) *s < 0x20)
+			mono_json_writer_printf (writer, "\\u%04x", (guchar) *s);
+		else
+			mono_json_writer_printf (writer, "%c", *s);
+	}
+	mono_json_writer_printf (writer, "\"");
+}
+
+static gint
+compare_events (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const StartupEvent *ea = (const StartupEvent *) a;
+	const StartupEvent *eb = (const StartupEvent *) b;
+
+	if (ea->start != eb->start)
+		return ea->start < eb->start ? -1 : 1;
+	/* Enclosing events start first */
+	return ea->depth - eb->depth;
+}
+
+static void
+write_trace (gint64 total_wall, gint64 total_cpu)
+{
+	JsonWriter writer;
+	gint64 phase_wall [MONO_STARTUP_PHASE_NUM] = { 0 };
+	gint64 phase_cpu [MONO_STARTUP_PHASE_NUM] = { 0 };
+	int phase_count [MONO_STARTUP_PHASE_NUM] = { 0 };
+	FILE *f;
+	guint i;
+
+	/* Events are recorded when they end */
+	g_qsort_with_data (events->data, events->len, sizeof (StartupEvent), compare_events, NULL);
+
+	for (i = 0; i < events->len; ++i) {
+		StartupEvent *ev = &g_array_index (events, StartupEvent, i);
+
+		phase_count [ev->phase]++;
+		if (ev->nested)
+			continue;
+		phase_wall [ev->phase] += ev->wall;
+		phase_cpu [ev->phase] += ev->cpu;
+	}
+
+	mono_json_writer_init (&writer);
+	mono_json_writer_object_begin (&writer);
+
+	mono_json_writer_indent (&writer);
+	mono_json_writer_object_key (&writer, "wall_ms");
+	mono_json_writer_printf (&writer, "%.3f,\n", total_wall / 10000.0);
+	mono_json_writer_indent (&writer);
+	mono_json_writer_object_key (&writer, "cpu_ms");
+	mono_json_writer_printf (&writer, "%.3f,\n", total_cpu / 10000.0);
+	mono_json_writer_indent (&writer);
+	mono_json_writer_object_key (&writer, "dropped_events");
+	mono_json_writer_printf (&writer, "%d,\n", dropped_events);
+
+	mono_json_writer_indent (&writer);
+	mono_json_writer_object_key (&writer, "phases");
+	mono_json_writer_object_begin (&writer);
+	for (i = 0; i < MONO_STARTUP_PHASE_NUM; ++i) {
+		mono_json_writer_indent (&writer);
+		mono_json_writer_object_key (&writer, "%s", phase_names [i]);
+		mono_json_writer_printf (&writer, "{ \"count\" : %d, \"wall_ms\" : %.3f, \"cpu_ms\" : %.3f }%s\n",
+			phase_count [i], phase_wall [i] / 10000.0, phase_cpu [i] / 10000.0, i < MONO_STARTUP_PHASE_NUM - 1 ? "," : "");
+	}
+	mono_json_writer_indent_pop (&writer);
+	mono_json_writer_indent (&writer);
+	mono_json_writer_object_end (&writer);
+	mono_json_writer_printf (&writer, ",\n");
+
+	mono_json_writer_indent (&writer);
+	mono_json_writer_object_key (&writer, "events");
+	mono_json_writer_array_begin (&writer);
+	for (i = 0; i < events->len; ++i) {
+		StartupEvent *ev = &g_array_index (events, StartupEvent, i);
+
+		mono_json_writer_indent (&writer);
+		mono_json_writer_printf (&writer, "{ \"phase\" : \"%s\", \"name\" : ", phase_names [ev->phase]);
+		write_string (&writer, ev->name);
+		mono_json_writer_printf (&writer, ", \"start_ms\" : %.3f, \"wall_ms\" : %.3f, \"cpu_ms\" : %.3f, \"depth\" : %d, \"thread\" : %" G_GSIZE_FORMAT " }%s\n",
+			ev->start / 10000.0, ev->wall / 10000.0, ev->cpu / 10000.0, ev->depth, ev->thread, i < events->len - 1 ? "," : "");
+	}
+	/* mono_json_writer_array_end () would unindent once more */
+	mono_json_writer_indent_pop (&writer);
+	mono_json_writer_indent (&writer);
+	mono_json_writer_printf (&writer, "]\n");
+
+	mono_json_writer_indent_pop (&writer);
+	mono_json_writer_object_end (&writer);
+	mono_json_writer_printf (&writer, "\n");
+
+	f = trace_path ? fopen (trace_path, "w") : stdout;
+	if (f) {
+		fputs (writer.text->str, f);
+		if (f != stdout)
+			fclose (f);
+		else
+			fflush (f);
+	} else {
+		g_warning ("Could not open startup trace file '%s'", trace_path);
+	}
+
+	mono_json_writer_destroy (&writer);
+}
+
+/**
+ * mono_startup_trace_finish:
+ *
+ *   Stop tracing and write the events recorded since mono_startup_trace_init ().
+ */
+void
+mono_startup_trace_finish (void)
+{
+	gint64 total_wall, total_cpu;
+	guint i;
+
+	if (!mono_startup_trace_enabled)
+		return;
+
+	total_wall = mono_100ns_ticks () - start_stamp.wall;
+	total_cpu = thread_cpu_ticks () - start_stamp.cpu;
+
+	mono_os_mutex_lock (&trace_mutex);
+	finished = TRUE;
+	mono_startup_trace_enabled = FALSE;
+	mono_os_mutex_unlock (&trace_mutex);
+
+	write_trace (total_wall, total_cpu);
+
+	for (i = 0; i < events->len; ++i)
+		g_free (((StartupEvent *) events->data) [i].name);
+	g_array_set_size (events, 0);
+}
@@ -0,0 +1,42 @@
+/*
+ * mono-startup-trace.h: Startup time tracing
+ *
+ * Licensed under the MIT license. See LICENSE file in the project root for full license information.
+ */
+
+#ifndef __MONO_UTILS_STARTUP_TRACE_H__
+#define __MONO_UTILS_STARTUP_TRACE_H__
+
+#include <glib.h>
+
+typedef enum {
+	MONO_STARTUP_RUNTIME_INIT,
+	MONO_STARTUP_ASSEMBLY_LOAD,
+	MONO_STARTUP_AOT_LOAD,
+	MONO_STARTUP_CLASS_INIT,
+	MONO_STARTUP_JIT,
+	MONO_STARTUP_PHASE_NUM
+} MonoStartupPhase;
+
+typedef struct {
+	/* In 100ns ticks */
+	gint64 wall;
+	gint64 cpu;
+} MonoStartupTraceStamp;
+
+/* Set by --trace-startup until the entry point runs */
+extern gboolean mono_startup_trace_enabled;
+
+void
+mono_startup_trace_init (const char *path);
+
+void
+mono_startup_trace_begin (MonoStartupPhase phase, MonoStartupTraceStamp *stamp);
+
+void
+mono_startup_trace_end (MonoStartupPhase phase, MonoStartupTraceStamp *stamp, const char *name);
+
+void
+mono_startup_trace_finish (void);
+
+#endif /* __MONO_UTILS_STARTUP_TRACE_H__ */
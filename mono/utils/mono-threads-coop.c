@@ -41,6 +41,13 @@
 
 volatile size_t mono_polling_required;
 
+/*
+ * Page read by JITted safepoints instead of testing mono_polling_required.
+ * It is made unreadable while a global suspend is in progress, so polling
+ * threads fault and the JIT's SIGSEGV handler calls mono_threads_state_poll.
+ */
+gpointer mono_polling_page;
+
 // FIXME: This would be more efficient if instead of instantiating the stack it just pushed a simple depth counter up and down,
 // perhaps with a per-thread cookie in the high bits.
 #ifdef ENABLE_CHECKED_BUILD_GC
@@ -198,6 +205,13 @@ mono_threads_enter_gc_safe_region_with_info (MonoThreadInfo *info, gpointer *sta
 {
 	gpointer cookie;
 
+	/* The threadpool replaces its workers blocking for too long, see threadpool-ms.c */
+	if (G_UNLIKELY (info && info->track_blocking)) {
+		info->blocking_since = mono_msec_ticks ();
+		if (!mono_threads_is_coop_enabled ())
+			return info;
+	}
+
 	if (!mono_threads_is_coop_enabled ())
 		return NULL;
 
@@ -247,6 +261,10 @@ retry:
 void
 mono_threads_exit_gc_safe_region (gpointer cookie, gpointer *stackdata)
 {
+	/* Without coop the cookie is only set when tracking blocking regions */
+	if (cookie)
+		((MonoThreadInfo *)cookie)->blocking_since = 0;
+
 	if (!mono_threads_is_coop_enabled ())
 		return;
 
@@ -427,6 +445,11 @@ mono_threads_coop_init (void)
 	mono_counters_register ("Coop Do Blocking", MONO_COUNTER_GC | MONO_COUNTER_INT, &coop_do_blocking_count);
 	mono_counters_register ("Coop Do Polling", MONO_COUNTER_GC | MONO_COUNTER_INT, &coop_do_polling_count);
 	mono_counters_register ("Coop Save Count", MONO_COUNTER_GC | MONO_COUNTER_INT, &coop_save_count);
+
+	if (!g_getenv ("MONO_COOP_DISABLE_POLLING_PAGE")) {
+		mono_polling_page = mono_valloc (NULL, mono_pagesize (), MONO_MMAP_READ | MONO_MMAP_PRIVATE | MONO_MMAP_ANON);
+		g_assert (mono_polling_page);
+	}
 	//See the above for what's wrong here.
 
 #ifdef ENABLE_CHECKED_BUILD_GC
@@ -437,13 +460,19 @@ mono_threads_coop_init (void)
 void
 mono_threads_coop_begin_global_suspend (void)
 {
-	if (mono_threads_is_coop_enabled ())
+	if (mono_threads_is_coop_enabled ()) {
 		mono_polling_required = 1;
+		if (mono_polling_page)
+			mono_mprotect (mono_polling_page, mono_pagesize (), MONO_MMAP_NONE);
+	}
 }
 
 void
 mono_threads_coop_end_global_suspend (void)
 {
-	if (mono_threads_is_coop_enabled ())
+	if (mono_threads_is_coop_enabled ()) {
 		mono_polling_required = 0;
+		if (mono_polling_page)
+			mono_mprotect (mono_polling_page, mono_pagesize (), MONO_MMAP_READ);
+	}
 }
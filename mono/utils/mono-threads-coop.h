@@ -16,11 +16,19 @@
 #include "checked-build.h"
 #include "mono-threads.h"
 #include "mono-threads-api.h"
+#include "mono-mmap.h"
 
 G_BEGIN_DECLS
 
 /* JIT specific interface */
 extern volatile size_t mono_polling_required;
+extern gpointer mono_polling_page;
+
+static inline gboolean
+mono_threads_is_polling_page_fault (gpointer addr)
+{
+	return mono_polling_page && (guint8*)addr >= (guint8*)mono_polling_page && (guint8*)addr < (guint8*)mono_polling_page + mono_pagesize ();
+}
 
 /* Runtime consumable API */
 
@@ -85,12 +85,29 @@ static guint32 sleepWarnDuration = SLEEP_DURATION_BEFORE_WARNING,
 
 static int suspend_posts, resume_posts, abort_posts, waits_done, pending_ops;
 
+/*
+ * Number of notifications the initiator is still waiting for, plus a bias
+ * that the initiator only removes once it starts waiting. Targets can notify
+ * before they are added to the pending set, so without the bias the count
+ * could drop to zero early. Whoever brings it to zero posts suspend_semaphore,
+ * so the initiator sleeps once per wait instead of once per thread.
+ */
+#define PENDING_NOTIFICATIONS_BIAS (1 << 30)
+static gint32 pending_notifications = PENDING_NOTIFICATIONS_BIAS;
+
+static void
+notify_initiator (void)
+{
+	if (InterlockedDecrement (&pending_notifications) == 0)
+		mono_os_sem_post (&suspend_semaphore);
+}
+
 void
 mono_threads_notify_initiator_of_abort (MonoThreadInfo* info)
 {
 	THREADS_SUSPEND_DEBUG ("[INITIATOR-NOTIFY-ABORT] %p\n", mono_thread_info_get_tid (info));
 	InterlockedIncrement (&abort_posts);
-	mono_os_sem_post (&suspend_semaphore);
+	notify_initiator ();
 }
 
 void
@@ -98,7 +115,7 @@ mono_threads_notify_initiator_of_suspend (MonoThreadInfo* info)
 {
 	THREADS_SUSPEND_DEBUG ("[INITIATOR-NOTIFY-SUSPEND] %p\n", mono_thread_info_get_tid (info));
 	InterlockedIncrement (&suspend_posts);
-	mono_os_sem_post (&suspend_semaphore);
+	notify_initiator ();
 }
 
 void
@@ -106,7 +123,7 @@ mono_threads_notify_initiator_of_resume (MonoThreadInfo* info)
 {
 	THREADS_SUSPEND_DEBUG ("[INITIATOR-NOTIFY-RESUME] %p\n", mono_thread_info_get_tid (info));
 	InterlockedIncrement (&resume_posts);
-	mono_os_sem_post (&suspend_semaphore);
+	notify_initiator ();
 }
 
 static gboolean
@@ -170,6 +187,7 @@ mono_threads_add_to_pending_operation_set (MonoThreadInfo* info)
 	THREADS_SUSPEND_DEBUG ("added %p to pending suspend\n", mono_thread_info_get_tid (info));
 	++pending_suspends;
 	InterlockedIncrement (&pending_ops);
+	InterlockedIncrement (&pending_notifications);
 }
 
 void
@@ -227,26 +245,27 @@ dump_threads (void)
 gboolean
 mono_threads_wait_pending_operations (void)
 {
-	int i;
 	int c = pending_suspends;
 
 	/* Wait threads to park */
 	THREADS_SUSPEND_DEBUG ("[INITIATOR-WAIT-COUNT] %d\n", c);
 	if (pending_suspends) {
 		MonoStopwatch suspension_time;
+		gint32 outstanding;
 		mono_stopwatch_start (&suspension_time);
-		for (i = 0; i < pending_suspends; ++i) {
-			THREADS_SUSPEND_DEBUG ("[INITIATOR-WAIT-WAITING]\n");
-			InterlockedIncrement (&waits_done);
-			if (mono_os_sem_timedwait (&suspend_semaphore, sleepAbortDuration, MONO_SEM_FLAGS_NONE) == MONO_SEM_TIMEDWAIT_RET_SUCCESS)
-				continue;
+		THREADS_SUSPEND_DEBUG ("[INITIATOR-WAIT-WAITING]\n");
+		InterlockedAdd (&waits_done, (gint32)pending_suspends);
+		outstanding = InterlockedAdd (&pending_notifications, -PENDING_NOTIFICATIONS_BIAS);
+		if (outstanding != 0 && mono_os_sem_timedwait (&suspend_semaphore, sleepAbortDuration, MONO_SEM_FLAGS_NONE) != MONO_SEM_TIMEDWAIT_RET_SUCCESS) {
 			mono_stopwatch_stop (&suspension_time);
 
 			dump_threads ();
 
-			MOSTLY_ASYNC_SAFE_PRINTF ("WAITING for %d threads, got %d suspended\n", (int)pending_suspends, i);
+			MOSTLY_ASYNC_SAFE_PRINTF ("WAITING for %d threads, got %d suspended\n", (int)pending_suspends, (int)pending_suspends - (int)pending_notifications);
 			g_error ("suspend_thread suspend took %d ms, which is more than the allowed %d ms", (int)mono_stopwatch_elapsed_ms (&suspension_time), sleepAbortDuration);
 		}
+		/* Every target has notified, so the count is back to zero */
+		InterlockedAdd (&pending_notifications, PENDING_NOTIFICATIONS_BIAS);
 		mono_stopwatch_stop (&suspension_time);
 		THREADS_SUSPEND_DEBUG ("Suspending %d threads took %d ms.\n", (int)pending_suspends, (int)mono_stopwatch_elapsed_ms (&suspension_time));
 
@@ -242,6 +242,14 @@ typedef struct {
 	/* Stack mark for targets that explicitly require one */
 	gpointer stack_mark;
 
+	/* Set while the thread updates the lock word of an object biased towards it, see monitor.c */
+	volatile gint32 monitor_bias_busy;
+
+	/* Set by the threadpool while a worker runs work items, so blocking_since is maintained */
+	gboolean track_blocking;
+	/* mono_msec_ticks () when the thread entered its current GC safe region, 0 outside of one */
+	volatile gint64 blocking_since;
+
 #if defined(_POSIX_VERSION) || defined(__native_client__)
 	/* This is the data that was stored in the w32 handle */
 	GPtrArray *owned_mutexes;
@@ -420,6 +428,17 @@ mono_thread_info_get_stack_bounds (guint8 **staddr, size_t *stsize);
 MONO_API gboolean
 mono_thread_info_yield (void);
 
+/* Hint the cpu that the current thread is spinning, without giving up its time slice */
+static inline void
+mono_cpu_relax (void)
+{
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+	__asm__ __volatile__ ("pause");
+#elif defined(__GNUC__) && defined(__aarch64__)
+	__asm__ __volatile__ ("yield");
+#endif
+}
+
 gint
 mono_thread_info_sleep (guint32 ms, gboolean *alerted);
 
@@ -25,7 +25,9 @@ typedef enum {
 	TLS_KEY_SGEN_THREAD_INFO = 4,
 	TLS_KEY_BOEHM_GC_THREAD = 5,
 	TLS_KEY_LMF_ADDR = 6,
-	TLS_KEY_NUM = 7
+	/* MonoInternalThread.static_data of the current thread */
+	TLS_KEY_THREAD_STATIC_DATA = 7,
+	TLS_KEY_NUM = 8
 } MonoTlsKey;
 
 #ifdef HOST_WIN32
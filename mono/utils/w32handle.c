@@ -58,12 +58,31 @@
 
 #define INFINITE 0xFFFFFFFF
 
+/*
+ * A thread waiting for multiple handles. It is linked in the waiters list of each
+ * of the handles, so signalling a handle only wakes up the threads waiting on it.
+ */
+typedef struct {
+	mono_mutex_t mutex;
+	mono_cond_t cond;
+	gboolean signalled;
+	gint32 ref;
+} MonoW32HandleWaiter;
+
+typedef struct _MonoW32HandleWaitNode MonoW32HandleWaitNode;
+struct _MonoW32HandleWaitNode {
+	MonoW32HandleWaiter *waiter;
+	MonoW32HandleWaitNode *next;
+};
+
 typedef struct {
 	MonoW32HandleType type;
 	guint ref;
 	gboolean signalled;
 	mono_mutex_t signal_mutex;
 	mono_cond_t signal_cond;
+	/* Threads waiting for multiple handles including this one, protected by signal_mutex */
+	MonoW32HandleWaitNode *waiters;
 	gpointer specific;
 } MonoW32HandleBase;
 
@@ -83,14 +102,6 @@ static guint32 private_handles_slots_count = 0;
 
 guint32 mono_w32handle_fd_reserve;
 
-/*
- * This is an internal handle which is used for handling waiting for multiple handles.
- * Threads which wait for multiple handles wait on this one handle, and when a handle
- * is signalled, this handle is signalled too.
- */
-static mono_mutex_t global_signal_mutex;
-static mono_cond_t global_signal_cond;
-
 static mono_mutex_t scan_mutex;
 
 static gboolean shutting_down = FALSE;
@@ -141,6 +152,38 @@ mono_w32handle_get_type (gpointer handle)
 	return handle_data->type;
 }
 
+static MonoW32HandleWaiter*
+mono_w32handle_waiter_new (void)
+{
+	MonoW32HandleWaiter *waiter;
+
+	waiter = g_new0 (MonoW32HandleWaiter, 1);
+	mono_os_mutex_init (&waiter->mutex);
+	mono_os_cond_init (&waiter->cond);
+	waiter->ref = 1;
+
+	return waiter;
+}
+
+static void
+mono_w32handle_waiter_unref (MonoW32HandleWaiter *waiter)
+{
+	if (InterlockedDecrement (&waiter->ref) == 0) {
+		mono_os_cond_destroy (&waiter->cond);
+		mono_os_mutex_destroy (&waiter->mutex);
+		g_free (waiter);
+	}
+}
+
+static void
+mono_w32handle_waiter_signal (MonoW32HandleWaiter *waiter)
+{
+	mono_os_mutex_lock (&waiter->mutex);
+	waiter->signalled = TRUE;
+	mono_os_cond_signal (&waiter->cond);
+	mono_os_mutex_unlock (&waiter->mutex);
+}
+
 void
 mono_w32handle_set_signal_state (gpointer handle, gboolean state, gboolean broadcast)
 {
@@ -156,30 +199,25 @@ mono_w32handle_set_signal_state (gpointer handle, gboolean state, gboolean broad
 #endif
 
 	if (state == TRUE) {
-		/* Tell everyone blocking on a single handle */
-
-		/* The condition the global signal cond is waiting on is the signalling of
-		 * _any_ handle. So lock it before setting the signalled state.
-		 */
-		mono_os_mutex_lock (&global_signal_mutex);
+		MonoW32HandleWaitNode *node;
 
 		/* This function _must_ be called with
 		 * handle->signal_mutex locked
 		 */
 		handle_data->signalled=state;
 
+		/* Tell everyone blocking on a single handle */
 		if (broadcast == TRUE) {
 			mono_os_cond_broadcast (&handle_data->signal_cond);
 		} else {
 			mono_os_cond_signal (&handle_data->signal_cond);
 		}
 
-		/* Tell everyone blocking on multiple handles that something
-		 * was signalled
+		/* Tell everyone blocking on multiple handles including
+		 * this one that something was signalled
 		 */
-		mono_os_cond_broadcast (&global_signal_cond);
-
-		mono_os_mutex_unlock (&global_signal_mutex);
+		for (node = handle_data->waiters; node; node = node->next)
+			mono_w32handle_waiter_signal (node->waiter);
 	} else {
 		handle_data->signalled=state;
 	}
@@ -197,30 +235,6 @@ mono_w32handle_issignalled (gpointer handle)
 	return handle_data->signalled;
 }
 
-static int
-mono_w32handle_lock_signal_mutex (void)
-{
-#ifdef DEBUG
-	g_message ("%s: lock global signal mutex", __func__);
-#endif
-
-	mono_os_mutex_lock (&global_signal_mutex);
-
-	return 0;
-}
-
-static int
-mono_w32handle_unlock_signal_mutex (void)
-{
-#ifdef DEBUG
-	g_message ("%s: unlock global signal mutex", __func__);
-#endif
-
-	mono_os_mutex_unlock (&global_signal_mutex);
-
-	return 0;
-}
-
 int
 mono_w32handle_lock_handle (gpointer handle)
 {
@@ -316,8 +330,6 @@ mono_w32handle_init (void)
 
 	mono_os_mutex_init (&scan_mutex);
 
-	mono_os_cond_init (&global_signal_cond);
-	mono_os_mutex_init (&global_signal_mutex);
 
 	initialized = TRUE;
 }
@@ -359,6 +371,7 @@ static void mono_w32handle_init_handle (MonoW32HandleBase *handle,
 {
 	handle->type = type;
 	handle->signalled = FALSE;
+	handle->waiters = NULL;
 	handle->ref = 1;
 
 	mono_os_cond_init (&handle->signal_cond);
@@ -1005,42 +1018,102 @@ mono_w32handle_timedwait_signal_naked (mono_cond_t *cond, mono_mutex_t *mutex, g
 }
 
 static void
-signal_global (gpointer unused)
+signal_waiter_and_unref (gpointer data)
 {
+	MonoW32HandleWaiter *waiter = (MonoW32HandleWaiter *)data;
+
 	/* If we reach here, then interrupt token is set to the flag value, which
 	 * means that the target thread is either
 	 * - before the first CAS in timedwait, which means it won't enter the wait.
 	 * - it is after the first CAS, so it is already waiting, or it will enter
-	 *    the wait, and it will be interrupted by the broadcast. */
-	mono_os_mutex_lock (&global_signal_mutex);
-	mono_os_cond_broadcast (&global_signal_cond);
-	mono_os_mutex_unlock (&global_signal_mutex);
+	 *    the wait, and it will be interrupted by the signal. */
+	mono_w32handle_waiter_signal (waiter);
+
+	mono_w32handle_waiter_unref (waiter);
 }
 
 static int
-mono_w32handle_timedwait_signal (guint32 timeout, gboolean poll, gboolean *alerted)
+mono_w32handle_timedwait_signal_waiter (MonoW32HandleWaiter *waiter, guint32 timeout, gboolean poll, gboolean *alerted)
 {
-	int res;
+	int res = 0;
 
-	mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_W32HANDLE, "%s: waiting for global", __func__);
+	mono_trace (G_LOG_LEVEL_DEBUG, MONO_TRACE_W32HANDLE, "%s: waiting for multiple handles", __func__);
 
 	if (alerted)
 		*alerted = FALSE;
 
 	if (alerted) {
-		mono_thread_info_install_interrupt (signal_global, NULL, alerted);
+		mono_thread_info_install_interrupt (signal_waiter_and_unref, waiter, alerted);
 		if (*alerted)
 			return 0;
+		InterlockedIncrement (&waiter->ref);
 	}
 
-	res = mono_w32handle_timedwait_signal_naked (&global_signal_cond, &global_signal_mutex, timeout, poll, alerted);
+	mono_os_mutex_lock (&waiter->mutex);
+	/* A handle might have been signalled since the waiter was registered */
+	if (!waiter->signalled)
+		res = mono_w32handle_timedwait_signal_naked (&waiter->cond, &waiter->mutex, timeout, poll, alerted);
+	mono_os_mutex_unlock (&waiter->mutex);
 
-	if (alerted)
+	if (alerted) {
 		mono_thread_info_uninstall_interrupt (alerted);
+		if (!*alerted) {
+			/* if it is alerted, then the waiter is unref in the interrupt callback */
+			mono_w32handle_waiter_unref (waiter);
+		}
+	}
 
 	return res;
 }
 
+/*
+ * mono_w32handle_waiters_add:
+ *
+ *   Link NODE in the waiters list of every handle. The handles must be locked.
+ */
+static void
+mono_w32handle_waiters_add (gpointer *handles, gsize nhandles, MonoW32HandleWaitNode *nodes, MonoW32HandleWaiter *waiter)
+{
+	gsize i;
+
+	for (i = 0; i < nhandles; ++i) {
+		MonoW32HandleBase *handle_data;
+
+		if (!mono_w32handle_lookup_data (handles [i], &handle_data))
+			g_error ("cannot wait on unknown handle %p", handles [i]);
+
+		nodes [i].waiter = waiter;
+		nodes [i].next = handle_data->waiters;
+		handle_data->waiters = &nodes [i];
+	}
+}
+
+/*
+ * mono_w32handle_waiters_remove:
+ *
+ *   Unlink the NODES added by mono_w32handle_waiters_add (). The handles must be locked.
+ */
+static void
+mono_w32handle_waiters_remove (gpointer *handles, gsize nhandles, MonoW32HandleWaitNode *nodes)
+{
+	gsize i;
+
+	for (i = 0; i < nhandles; ++i) {
+		MonoW32HandleBase *handle_data;
+		MonoW32HandleWaitNode **prev;
+
+		if (!mono_w32handle_lookup_data (handles [i], &handle_data))
+			g_error ("cannot wait on unknown handle %p", handles [i]);
+
+		for (prev = &handle_data->waiters; *prev; prev = &(*prev)->next) {
+			if (*prev == &nodes [i]) {
+				*prev = nodes [i].next;
+				break;
+			}
+		}
+	}
+}
+
 static void
 signal_handle_and_unref (gpointer handle)
 {
@@ -1260,10 +1333,12 @@ MonoW32HandleWaitRet
 mono_w32handle_wait_multiple (gpointer *handles, gsize nhandles, gboolean waitall, guint32 timeout, gboolean alertable)
 {
 	MonoW32HandleWaitRet ret;
-	gboolean alerted, poll;
-	gint i, thr_ret;
+	gboolean alerted, poll, registered;
+	gint i;
 	gint64 start;
 	gpointer handles_sorted [MONO_W32HANDLE_MAXIMUM_WAIT_OBJECTS];
+	MonoW32HandleWaitNode nodes [MONO_W32HANDLE_MAXIMUM_WAIT_OBJECTS];
+	MonoW32HandleWaiter *waiter;
 
 	if (nhandles == 0)
 		return MONO_W32HANDLE_WAIT_RET_FAILED;
@@ -1311,8 +1386,7 @@ mono_w32handle_wait_multiple (gpointer *handles, gsize nhandles, gboolean waital
 		}
 	}
 
-	if (timeout != INFINITE)
-		start = mono_msec_ticks ();
+	start = mono_msec_ticks ();
 
 	for (i = 0; i < nhandles; ++i) {
 		/* Add a reference, as we need to ensure the handle wont
@@ -1321,6 +1395,9 @@ mono_w32handle_wait_multiple (gpointer *handles, gsize nhandles, gboolean waital
 		mono_w32handle_ref (handles [i]);
 	}
 
+	waiter = mono_w32handle_waiter_new ();
+	registered = FALSE;
+
 	for (;;) {
 		gsize count, lowest;
 		gboolean signalled;
@@ -1331,6 +1408,11 @@ mono_w32handle_wait_multiple (gpointer *handles, gsize nhandles, gboolean waital
 
 		mono_w32handle_lock_handles (handles, nhandles);
 
+		if (registered) {
+			mono_w32handle_waiters_remove (handles, nhandles, nodes);
+			registered = FALSE;
+		}
+
 		for (i = 0; i < nhandles; i++) {
 			if ((mono_w32handle_test_capabilities (handles [i], MONO_W32HANDLE_CAP_OWN) && mono_w32handle_ops_isowned (handles [i]))
 				 || mono_w32handle_issignalled (handles [i]))
@@ -1347,6 +1429,11 @@ mono_w32handle_wait_multiple (gpointer *handles, gsize nhandles, gboolean waital
 		if (signalled) {
 			for (i = 0; i < nhandles; i++)
 				own_if_signalled (handles [i]);
+		} else {
+			/* Register while the handles are locked, so no signal gets lost after the check */
+			waiter->signalled = FALSE;
+			mono_w32handle_waiters_add (handles, nhandles, nodes, waiter);
+			registered = TRUE;
 		}
 
 		mono_w32handle_unlock_handles (handles, nhandles);
@@ -1366,51 +1453,19 @@ mono_w32handle_wait_multiple (gpointer *handles, gsize nhandles, gboolean waital
 			}
 		}
 
-		thr_ret = mono_w32handle_lock_signal_mutex ();
-		g_assert (thr_ret == 0);
-
-		if (waitall) {
-			signalled = TRUE;
-			for (i = 0; i < nhandles; ++i) {
-				if (!mono_w32handle_issignalled (handles [i])) {
-					signalled = FALSE;
-					break;
-				}
-			}
+		if (timeout == INFINITE) {
+			waited = mono_w32handle_timedwait_signal_waiter (waiter, INFINITE, poll, alertable ? &alerted : NULL);
 		} else {
-			signalled = FALSE;
-			for (i = 0; i < nhandles; ++i) {
-				if (mono_w32handle_issignalled (handles [i])) {
-					signalled = TRUE;
-					break;
-				}
-			}
-		}
-
-		waited = 0;
-
-		if (!signalled) {
-			if (timeout == INFINITE) {
-				waited = mono_w32handle_timedwait_signal (INFINITE, poll, alertable ? &alerted : NULL);
-			} else {
-				gint64 elapsed;
-
-				elapsed = mono_msec_ticks () - start;
-				if (elapsed > timeout) {
-					ret = MONO_W32HANDLE_WAIT_RET_TIMEOUT;
-
-					thr_ret = mono_w32handle_unlock_signal_mutex ();
-					g_assert (thr_ret == 0);
-
-					goto done;
-				}
+			gint64 elapsed;
 
-				waited = mono_w32handle_timedwait_signal (timeout - elapsed, poll, alertable ? &alerted : NULL);
+			elapsed = mono_msec_ticks () - start;
+			if (elapsed > timeout) {
+				ret = MONO_W32HANDLE_WAIT_RET_TIMEOUT;
+				goto done;
 			}
-		}
 
-		thr_ret = mono_w32handle_unlock_signal_mutex ();
-		g_assert (thr_ret == 0);
+			waited = mono_w32handle_timedwait_signal_waiter (waiter, timeout - elapsed, poll, alertable ? &alerted : NULL);
+		}
 
 		if (alerted) {
 			ret = MONO_W32HANDLE_WAIT_RET_ALERTED;
@@ -1424,6 +1479,14 @@ mono_w32handle_wait_multiple (gpointer *handles, gsize nhandles, gboolean waital
 	}
 
 done:
+	if (registered) {
+		mono_w32handle_lock_handles (handles, nhandles);
+		mono_w32handle_waiters_remove (handles, nhandles, nodes);
+		mono_w32handle_unlock_handles (handles, nhandles);
+	}
+
+	mono_w32handle_waiter_unref (waiter);
+
 	for (i = 0; i < nhandles; i++) {
 		/* Unref everything we reffed above */
 		mono_w32handle_unref (handles [i]);
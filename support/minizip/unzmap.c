@@ -0,0 +1,505 @@
+/* unzmap.c -- random access to the entries of a .zip file through mmap
+
+   Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+   Read unzmap.h for more info
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "zlib.h"
+#include "unzip.h"
+#include "unzmap.h"
+
+#ifdef _WIN32
+#  include <windows.h>
+#else
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+
+#ifndef local
+#  define local static
+#endif
+
+#define SIG_LOCAL_HEADER    0x04034b50
+#define SIG_CENTRAL_HEADER  0x02014b50
+#define SIG_END_OF_CENTRAL  0x06054b50
+#define SIG_ZIP64_END       0x06064b50
+#define SIG_ZIP64_LOCATOR   0x07064b50
+
+#define END_OF_CENTRAL_SIZE 22
+#define CENTRAL_HEADER_SIZE 46
+#define LOCAL_HEADER_SIZE   30
+
+/* avail_in, avail_out and the crc32 length are uInt, feed large entries in pieces */
+#define INFLATE_CHUNK       (1U << 30)
+
+typedef struct unzMap_s
+{
+    const unsigned char *base;  /* the mapping */
+    z_off64_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#endif
+    unzMapEntry *entries;
+    long count;
+    char *names;                /* the names of all entries, NUL terminated */
+    long *buckets;              /* open addressing, -1 for empty slots */
+    unsigned long mask;
+} unzMap_s;
+
+local uLong get16(p)
+    const unsigned char *p;
+{
+    return (uLong)p[0] | ((uLong)p[1] << 8);
+}
+
+local uLong get32(p)
+    const unsigned char *p;
+{
+    return get16(p) | (get16(p + 2) << 16);
+}
+
+local z_off64_t get64(p)
+    const unsigned char *p;
+{
+    /* z_off64_t is only a long without large file support, make offsets that don't fit invalid */
+    if (sizeof(z_off64_t) < 8)
+        return get32(p + 4) != 0 || get32(p) > 0x7fffffffUL ? -1 : (z_off64_t)get32(p);
+    return (z_off64_t)get32(p) | ((z_off64_t)get32(p + 4) << 16 << 16);
+}
+
+local int fold(c)
+    int c;
+{
+    return c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c;
+}
+
+/* FNV-1a of the name with ASCII case folded, so both kinds of lookup can use the same table */
+local unsigned long name_hash(name)
+    const char *name;
+{
+    unsigned long h = 2166136261UL;
+
+    while (*name) {
+        h ^= (unsigned char)fold((unsigned char)*name++);
+        h *= 16777619UL;
+    }
+    return h;
+}
+
+local int map_file(map, path)
+    unzMap_s *map;
+    const char *path;
+{
+#ifdef _WIN32
+    LARGE_INTEGER size;
+
+    map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (map->file == INVALID_HANDLE_VALUE)
+        return UNZ_ERRNO;
+    if (!GetFileSizeEx(map->file, &size) || size.QuadPart == 0) {
+        CloseHandle(map->file);
+        return UNZ_BADZIPFILE;
+    }
+    map->mapping = CreateFileMappingA(map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (map->mapping == NULL) {
+        CloseHandle(map->file);
+        return UNZ_ERRNO;
+    }
+    map->base = (const unsigned char *)MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (map->base == NULL) {
+        CloseHandle(map->mapping);
+        CloseHandle(map->file);
+        return UNZ_ERRNO;
+    }
+    map->size = size.QuadPart;
+#else
+    struct stat st;
+    void *base;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return UNZ_ERRNO;
+    if (fstat(fd, &st) == -1 || st.st_size == 0 || (z_off64_t)(size_t)st.st_size != st.st_size) {
+        close(fd);
+        return UNZ_BADZIPFILE;
+    }
+    base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    /* The mapping keeps the file alive */
+    close(fd);
+    if (base == MAP_FAILED)
+        return UNZ_ERRNO;
+    map->base = (const unsigned char *)base;
+    map->size = st.st_size;
+#endif
+    return UNZ_OK;
+}
+
+local void unmap_file(map)
+    unzMap_s *map;
+{
+#ifdef _WIN32
+    UnmapViewOfFile(map->base);
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+#else
+    munmap((void *)map->base, (size_t)map->size);
+#endif
+}
+
+/* Find the central directory, from the zip64 end record if there is one */
+local int find_central_dir(map, offset, size, count)
+    unzMap_s *map;
+    z_off64_t *offset;
+    z_off64_t *size;
+    z_off64_t *count;
+{
+    const unsigned char *p, *end, *stop;
+
+    if (map->size < END_OF_CENTRAL_SIZE)
+        return UNZ_BADZIPFILE;
+
+    /* The end record is followed by a comment of up to 64KB */
+    end = map->base + map->size - END_OF_CENTRAL_SIZE;
+    stop = map->size > END_OF_CENTRAL_SIZE + 0xffff ? end - 0xffff : map->base;
+    for (p = end; p >= stop; p--) {
+        if (get32(p) == SIG_END_OF_CENTRAL)
+            break;
+    }
+    if (p < stop)
+        return UNZ_BADZIPFILE;
+    if (get16(p + 4) != 0 || get16(p + 6) != 0)
+        return UNZ_BADZIPFILE;     /* spanned */
+
+    *count = get16(p + 10);
+    *size = get32(p + 12);
+    *offset = get32(p + 16);
+
+    /* Zip64 end of central directory locator, and the record it points to */
+    if (p - map->base >= 20 && get32(p - 20) == SIG_ZIP64_LOCATOR) {
+        z_off64_t rec = get64(p - 20 + 8);
+
+        if (rec < 0 || rec > map->size - 56 || get32(map->base + rec) != SIG_ZIP64_END)
+            return UNZ_BADZIPFILE;
+        *count = get64(map->base + rec + 32);
+        *size = get64(map->base + rec + 40);
+        *offset = get64(map->base + rec + 48);
+    }
+
+    if (*offset < 0 || *size < 0 || *count < 0 || *offset > map->size || *size > map->size - *offset)
+        return UNZ_BADZIPFILE;
+    return UNZ_OK;
+}
+
+/* Replace the 0xffffffff sizes and offset of a zip64 entry with the ones from its extra field */
+local int read_zip64_extra(entry, extra, extra_len)
+    unzMapEntry *entry;
+    const unsigned char *extra;
+    uLong extra_len;
+{
+    const unsigned char *p = extra, *end = extra + extra_len, *field_end;
+    uLong id, len;
+
+    while (p + 4 <= end) {
+        id = get16(p);
+        len = get16(p + 2);
+        p += 4;
+        if (p + len > end)
+            return UNZ_BADZIPFILE;
+        if (id == 0x0001) {
+            field_end = p + len;
+            /* The fields are there in this order, only if the header has 0xffffffff */
+            if (entry->uncompressed_size == 0xffffffffL) {
+                if (p + 8 > field_end)
+                    return UNZ_BADZIPFILE;
+                entry->uncompressed_size = get64(p);
+                p += 8;
+            }
+            if (entry->compressed_size == 0xffffffffL) {
+                if (p + 8 > field_end)
+                    return UNZ_BADZIPFILE;
+                entry->compressed_size = get64(p);
+                p += 8;
+            }
+            if (entry->local_header_offset == 0xffffffffL) {
+                if (p + 8 > field_end)
+                    return UNZ_BADZIPFILE;
+                entry->local_header_offset = get64(p);
+            }
+            return UNZ_OK;
+        }
+        p += len;
+    }
+    return UNZ_OK;
+}
+
+local int read_central_dir(map)
+    unzMap_s *map;
+{
+    z_off64_t offset, size, count, names_size;
+    const unsigned char *p, *end;
+    unzMapEntry *entry;
+    uLong name_len, extra_len, comment_len;
+    unsigned long buckets, slot;
+    char *name;
+    long i;
+    int err;
+
+    err = find_central_dir(map, &offset, &size, &count);
+    if (err != UNZ_OK)
+        return err;
+    /* Each entry takes at least CENTRAL_HEADER_SIZE bytes, which bounds what we allocate */
+    if (count > size / CENTRAL_HEADER_SIZE || count > 0x7fffffffL / 2)
+        return UNZ_BADZIPFILE;
+
+    map->count = (long)count;
+    map->entries = (unzMapEntry *)calloc((size_t)count + 1, sizeof(unzMapEntry));
+    /* The names and their NULs take less room than the headers */
+    names_size = size;
+    map->names = (char *)malloc((size_t)names_size + 1);
+    for (buckets = 16; buckets < (unsigned long)count * 2; buckets *= 2)
+        ;
+    map->buckets = (long *)malloc(buckets * sizeof(long));
+    map->mask = buckets - 1;
+    if (map->entries == NULL || map->names == NULL || map->buckets == NULL)
+        return UNZ_INTERNALERROR;
+    memset(map->buckets, 0xff, buckets * sizeof(long));
+
+    p = map->base + offset;
+    end = p + size;
+    name = map->names;
+    for (i = 0; i < map->count; i++) {
+        if (p + CENTRAL_HEADER_SIZE > end || get32(p) != SIG_CENTRAL_HEADER)
+            return UNZ_BADZIPFILE;
+        name_len = get16(p + 28);
+        extra_len = get16(p + 30);
+        comment_len = get16(p + 32);
+        if (p + CENTRAL_HEADER_SIZE + name_len + extra_len + comment_len > end)
+            return UNZ_BADZIPFILE;
+
+        entry = &map->entries[i];
+        entry->flag = get16(p + 8);
+        entry->compression_method = get16(p + 10);
+        entry->dosDate = get32(p + 12);
+        entry->crc = get32(p + 16);
+        entry->compressed_size = get32(p + 20);
+        entry->uncompressed_size = get32(p + 24);
+        entry->local_header_offset = get32(p + 42);
+        err = read_zip64_extra(entry, p + CENTRAL_HEADER_SIZE + name_len, extra_len);
+        if (err != UNZ_OK)
+            return err;
+
+        memcpy(name, p + CENTRAL_HEADER_SIZE, name_len);
+        name[name_len] = '\0';
+        entry->name = name;
+        name += name_len + 1;
+
+        /* Keep the first of several entries with the same name, like a linear search would */
+        for (slot = name_hash(entry->name) & map->mask; map->buckets[slot] != -1; slot = (slot + 1) & map->mask) {
+            if (strcmp(map->entries[map->buckets[slot]].name, entry->name) == 0)
+                break;
+        }
+        if (map->buckets[slot] == -1)
+            map->buckets[slot] = i;
+
+        p += CENTRAL_HEADER_SIZE + name_len + extra_len + comment_len;
+    }
+    return UNZ_OK;
+}
+
+extern int ZEXPORT unzMapClose(map)
+    unzMap map;
+{
+    if (map == NULL)
+        return UNZ_PARAMERROR;
+    if (map->base != NULL)
+        unmap_file(map);
+    free(map->entries);
+    free(map->names);
+    free(map->buckets);
+    free(map);
+    return UNZ_OK;
+}
+
+extern unzMap ZEXPORT unzMapOpen(path)
+    const char *path;
+{
+    unzMap_s *map;
+
+    map = (unzMap_s *)calloc(1, sizeof(unzMap_s));
+    if (map == NULL)
+        return NULL;
+    if (map_file(map, path) != UNZ_OK) {
+        free(map);
+        return NULL;
+    }
+    if (read_central_dir(map) != UNZ_OK) {
+        unzMapClose(map);
+        return NULL;
+    }
+    return map;
+}
+
+extern long ZEXPORT unzMapGetEntryCount(map)
+    unzMap map;
+{
+    return map == NULL ? 0 : map->count;
+}
+
+extern const unzMapEntry* ZEXPORT unzMapGetEntry(map, index)
+    unzMap map;
+    long index;
+{
+    if (map == NULL || index < 0 || index >= map->count)
+        return NULL;
+    return &map->entries[index];
+}
+
+local int names_equal(a, b, case_sensitive)
+    const char *a;
+    const char *b;
+    int case_sensitive;
+{
+    if (case_sensitive)
+        return strcmp(a, b) == 0;
+    while (*a && fold((unsigned char)*a) == fold((unsigned char)*b)) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+extern long ZEXPORT unzMapLocate(map, name, iCaseSensitivity)
+    unzMap map;
+    const char *name;
+    int iCaseSensitivity;
+{
+    unsigned long slot;
+    long index, found = UNZ_END_OF_LIST_OF_FILE;
+    int case_sensitive;
+
+    if (map == NULL || name == NULL)
+        return UNZ_PARAMERROR;
+
+    /* Same meaning as in unzStringFileNameCompare */
+    if (iCaseSensitivity == 0) {
+#ifdef CASESENSITIVITYDEFAULT_NO
+        iCaseSensitivity = 2;
+#else
+        iCaseSensitivity = 1;
+#endif
+    }
+    case_sensitive = iCaseSensitivity == 1;
+
+    /* Names differing only in case share a bucket chain, take the first entry in the archive */
+    for (slot = name_hash(name) & map->mask; (index = map->buckets[slot]) != -1; slot = (slot + 1) & map->mask) {
+        if (names_equal(map->entries[index].name, name, case_sensitive) && (found < 0 || index < found))
+            found = index;
+    }
+    return found;
+}
+
+/* Where the data of an entry starts in the mapping, NULL if the entry doesn't fit in it */
+local const unsigned char *entry_data(map, entry)
+    unzMap_s *map;
+    const unzMapEntry *entry;
+{
+    const unsigned char *p;
+    z_off64_t data;
+
+    if (entry->local_header_offset < 0 || entry->local_header_offset > map->size - LOCAL_HEADER_SIZE)
+        return NULL;
+    p = map->base + entry->local_header_offset;
+    if (get32(p) != SIG_LOCAL_HEADER)
+        return NULL;
+    data = entry->local_header_offset + LOCAL_HEADER_SIZE + get16(p + 26) + get16(p + 28);
+    if (data > map->size || entry->compressed_size < 0 || entry->compressed_size > map->size - data)
+        return NULL;
+    return map->base + data;
+}
+
+extern const unsigned char* ZEXPORT unzMapGetStored(map, index)
+    unzMap map;
+    long index;
+{
+    const unzMapEntry *entry = unzMapGetEntry(map, index);
+
+    if (entry == NULL || entry->compression_method != 0 || (entry->flag & 1) != 0 ||
+        entry->compressed_size != entry->uncompressed_size)
+        return NULL;
+    return entry_data(map, entry);
+}
+
+extern int ZEXPORT unzMapRead(map, index, buf, len)
+    unzMap map;
+    long index;
+    voidp buf;
+    z_off64_t len;
+{
+    const unzMapEntry *entry = unzMapGetEntry(map, index);
+    const unsigned char *data;
+    z_off64_t in_left, out_left, chunk;
+    uLong crc;
+    z_stream zs;
+    int err;
+
+    if (entry == NULL || buf == NULL)
+        return UNZ_PARAMERROR;
+    if (len < entry->uncompressed_size)
+        return UNZ_PARAMERROR;
+    if ((entry->flag & 1) != 0)
+        return UNZ_BADZIPFILE;     /* encrypted */
+    data = entry_data(map, entry);
+    if (data == NULL)
+        return UNZ_BADZIPFILE;
+
+    if (entry->compression_method == 0) {
+        if (entry->compressed_size != entry->uncompressed_size)
+            return UNZ_BADZIPFILE;
+        memcpy(buf, data, (size_t)entry->uncompressed_size);
+    } else if (entry->compression_method == Z_DEFLATED) {
+        memset(&zs, 0, sizeof(zs));
+        if (inflateInit2(&zs, -MAX_WBITS) != Z_OK)
+            return UNZ_INTERNALERROR;
+        zs.next_in = (Bytef *)data;
+        zs.next_out = (Bytef *)buf;
+        in_left = entry->compressed_size;
+        out_left = entry->uncompressed_size;
+        do {
+            /* avail_in and avail_out are only 32 bits */
+            chunk = in_left < INFLATE_CHUNK ? in_left : INFLATE_CHUNK;
+            zs.avail_in = (uInt)chunk;
+            in_left -= chunk;
+            chunk = out_left < INFLATE_CHUNK ? out_left : INFLATE_CHUNK;
+            zs.avail_out = (uInt)chunk;
+            out_left -= chunk;
+            err = inflate(&zs, Z_SYNC_FLUSH);
+            in_left += zs.avail_in;
+            out_left += zs.avail_out;
+        } while (err == Z_OK && (zs.avail_in == 0 || zs.avail_out == 0) && (in_left > 0 || out_left > 0));
+        inflateEnd(&zs);
+        if (err != Z_STREAM_END || out_left != 0)
+            return UNZ_BADZIPFILE;
+    } else {
+        return UNZ_BADZIPFILE;
+    }
+
+    crc = crc32(0L, Z_NULL, 0);
+    out_left = entry->uncompressed_size;
+    data = (const unsigned char *)buf;
+    while (out_left > 0) {
+        chunk = out_left < INFLATE_CHUNK ? out_left : INFLATE_CHUNK;
+        crc = crc32(crc, data, (uInt)chunk);
+        data += chunk;
+        out_left -= chunk;
+    }
+    return crc == entry->crc ? UNZ_OK : UNZ_CRCERROR;
+}
@@ -0,0 +1,98 @@
+/* unzmap.h -- random access to the entries of a .zip file through mmap
+
+   Licensed under the MIT license. See LICENSE file in the project root for full license information.
+
+   unzOpen and unzLocateFile go through the ioapi callbacks and walk the
+   central directory from the start for every lookup, which is slow for
+   archives with tens of thousands of entries.  This reader maps the whole
+   file, reads the central directory once into an array indexed by a hash
+   table of the entry names, and then:
+
+   - returns stored entries as pointers into the mapping, without copying,
+   - inflates deflated entries straight into the caller's buffer.
+
+   Zip64 archives are supported, spanned and encrypted ones are not.
+   The mapping is read only, so a map can be shared by several threads.
+*/
+
+#ifndef _unzmap_H
+#define _unzmap_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef _ZLIB_H
+#include "zlib.h"
+#endif
+
+#ifndef _unz_H
+#include "unzip.h"
+#endif
+
+typedef struct unzMap_s *unzMap;
+
+typedef struct unzMapEntry_s
+{
+    const char *name;           /* NUL terminated copy of the name */
+    uLong flag;                 /* general purpose bit flag */
+    uLong compression_method;   /* 0 (stored) or Z_DEFLATED */
+    uLong dosDate;              /* last mod file date in Dos fmt */
+    uLong crc;                  /* crc-32 of the uncompressed data */
+    z_off64_t compressed_size;
+    z_off64_t uncompressed_size;
+    z_off64_t local_header_offset;
+} unzMapEntry;
+
+extern unzMap ZEXPORT unzMapOpen OF((const char *path));
+/*
+  Map the .zip file at path and index its central directory.
+  Returns NULL if the file can't be mapped or isn't a valid zip file.
+*/
+
+extern int ZEXPORT unzMapClose OF((unzMap map));
+/*
+  Unmap the file.  Pointers returned by unzMapGetStored become invalid.
+*/
+
+extern long ZEXPORT unzMapGetEntryCount OF((unzMap map));
+
+extern const unzMapEntry* ZEXPORT unzMapGetEntry OF((unzMap map, long index));
+/*
+  Entries are in central directory order, index goes from 0 to
+  unzMapGetEntryCount () - 1.  Returns NULL if index is out of range.
+*/
+
+extern long ZEXPORT unzMapLocate OF((unzMap map,
+                                     const char *name,
+                                     int iCaseSensitivity));
+/*
+  Find the entry called name with a hash lookup.  iCaseSensitivity is
+  interpreted like in unzStringFileNameCompare.  Returns the index of the
+  entry, or UNZ_END_OF_LIST_OF_FILE if there is none.
+*/
+
+extern const unsigned char* ZEXPORT unzMapGetStored OF((unzMap map, long index));
+/*
+  Return a pointer to the data of a stored, unencrypted entry inside the
+  mapping, which is valid until unzMapClose.  The data is
+  uncompressed_size bytes long and its crc hasn't been checked.
+  Returns NULL for other entries.
+*/
+
+extern int ZEXPORT unzMapRead OF((unzMap map,
+                                  long index,
+                                  voidp buf,
+                                  z_off64_t len));
+/*
+  Decompress the whole entry into buf, which must be at least
+  uncompressed_size bytes long, and check its crc.
+  Returns UNZ_OK, UNZ_PARAMERROR if buf is too small, UNZ_BADZIPFILE for
+  unsupported or corrupt entries and UNZ_CRCERROR on a crc mismatch.
+*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _unzmap_H */
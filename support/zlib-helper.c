@@ -16,6 +16,13 @@
 #include <glib.h>
 #include <string.h>
 #include <stdlib.h>
+#ifdef _MSC_VER
+#include <windows.h>
+#endif
+#if defined(HAVE_PTHREAD_H) && !defined(_MSC_VER)
+#include <pthread.h>
+#define ZSTREAM_PARALLEL 1
+#endif
 
 #ifndef MONO_API
 #define MONO_API
@@ -26,33 +33,63 @@
 #define TRUE 1
 #endif
 
-#define BUFFER_SIZE 4096
+/* Each full buffer is a call into managed code, so don't make it too small */
+#define BUFFER_SIZE 32768
 #define ARGUMENT_ERROR -10
 #define IO_ERROR -11
 
+/* Idle streams kept for reuse, for each of the four compress/gzip combinations */
+#define POOL_SIZE 8
+
+/* Parallel compression works on blocks of this size, primed with the end of the previous one */
+#define PARALLEL_BLOCK_SIZE (128 * 1024)
+#define PARALLEL_DICT_SIZE 32768
+#define PARALLEL_MAX_THREADS 64
+
 #define z_malloc(size)          ((gpointer) malloc(size))
 #define z_malloc0(size)         ((gpointer) calloc(1,size))
 #define z_new(type,size)        ((type *) z_malloc (sizeof (type) * (size)))
 #define z_new0(type,size)       ((type *) z_malloc0 (sizeof (type)* (size)))
 
 typedef gint (*read_write_func) (guchar *buffer, gint length, void *gchandle);
+typedef struct _ZParallel ZParallel;
 struct _ZStream {
 	z_stream *stream;
 	guchar *buffer;
 	read_write_func func;
 	void *gchandle;
 	guchar compress;
+	guchar gzip;
 	guchar eof;
 	guint32 total_in;
+	ZParallel *parallel;
 };
 typedef struct _ZStream ZStream;
 
+#ifdef _MSC_VER
+#define z_cas_ptr(dest,exch,comp) InterlockedCompareExchangePointer ((PVOID volatile *) (dest), (exch), (comp))
+#else
+#define z_cas_ptr(dest,exch,comp) __sync_val_compare_and_swap ((dest), (comp), (exch))
+#endif
+
+/*
+ * Setting up a deflate stream allocates and clears a few hundred KB, which
+ * dominates the cost of compressing small HTTP responses. Closed streams are
+ * reset and kept here instead, slots are claimed and released with a CAS.
+ */
+static ZStream * volatile stream_pool [4][POOL_SIZE];
+
 MONO_API ZStream *CreateZStream (gint compress, guchar gzip, read_write_func func, void *gchandle);
 MONO_API gint CloseZStream (ZStream *zstream);
 MONO_API gint Flush (ZStream *stream);
 MONO_API gint ReadZStream (ZStream *stream, guchar *buffer, gint length);
 MONO_API gint WriteZStream (ZStream *stream, guchar *buffer, gint length);
+MONO_API gint ProcessZStream (ZStream *stream, guchar *in, gint in_length, gint *consumed, guchar *out, gint out_length, gint finish);
+MONO_API gint SetZStreamParallel (ZStream *stream, gint threads);
 static gint flush_internal (ZStream *stream, gboolean is_final);
+static gint parallel_write (ZStream *stream, guchar *buffer, gint length);
+static gint parallel_flush (ZStream *stream, gboolean is_final);
+static void parallel_free (ZStream *stream);
 
 static void *
 z_alloc (void *opaque, unsigned int nitems, unsigned int item_size)
@@ -66,6 +103,51 @@ z_free (void *opaque, void *ptr)
 	free (ptr);
 }
 
+static ZStream * volatile *
+pool_slots (gint compress, guchar gzip)
+{
+	return stream_pool [(compress ? 2 : 0) + (gzip ? 1 : 0)];
+}
+
+static ZStream *
+pool_get (gint compress, guchar gzip)
+{
+	ZStream * volatile *slots = pool_slots (compress, gzip);
+	ZStream *result;
+	gint i;
+
+	for (i = 0; i < POOL_SIZE; i++) {
+		result = slots [i];
+		if (result != NULL && z_cas_ptr (&slots [i], NULL, result) == result)
+			return result;
+	}
+	return NULL;
+}
+
+static gboolean
+pool_put (ZStream *zstream)
+{
+	ZStream * volatile *slots = pool_slots (zstream->compress, zstream->gzip);
+	gint retval;
+	gint i;
+
+	retval = zstream->compress ? deflateReset (zstream->stream) : inflateReset (zstream->stream);
+	if (retval != Z_OK)
+		return FALSE;
+
+	zstream->func = NULL;
+	zstream->gchandle = NULL;
+	for (i = 0; i < POOL_SIZE; i++) {
+		if (slots [i] == NULL && z_cas_ptr (&slots [i], zstream, NULL) == NULL)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+/*
+ * @func can be NULL if the stream is only going to be used with
+ * ProcessZStream ().
+ */
 ZStream *
 CreateZStream (gint compress, guchar gzip, read_write_func func, void *gchandle)
 {
@@ -73,14 +155,24 @@ CreateZStream (gint compress, guchar gzip, read_write_func func, void *gchandle)
 	gint retval;
 	ZStream *result;
 
-	if (func == NULL)
-		return NULL;
-
 #if !defined(ZLIB_VERNUM) || (ZLIB_VERNUM < 0x1204)
 	/* Older versions of zlib do not support raw deflate or gzip */
 	return NULL;
 #endif
 
+	result = pool_get (compress, gzip);
+	if (result != NULL) {
+		result->func = func;
+		result->gchandle = gchandle;
+		result->eof = FALSE;
+		result->total_in = 0;
+		result->stream->next_in = NULL;
+		result->stream->avail_in = 0;
+		result->stream->next_out = result->buffer;
+		result->stream->avail_out = BUFFER_SIZE;
+		return result;
+	}
+
 	z = z_new0 (z_stream, 1);
 	if (compress) {
 		retval = deflateInit2 (z, Z_DEFAULT_COMPRESSION, Z_DEFLATED, gzip ? 31 : -15, 8, Z_DEFAULT_STRATEGY);
@@ -99,6 +191,7 @@ CreateZStream (gint compress, guchar gzip, read_write_func func, void *gchandle)
 	result->func = func;
 	result->gchandle = gchandle;
 	result->compress = compress;
+	result->gzip = gzip;
 	result->buffer = z_new (guchar, BUFFER_SIZE);
 	result->stream->next_out = result->buffer;
 	result->stream->avail_out = BUFFER_SIZE;
@@ -116,7 +209,11 @@ CloseZStream (ZStream *zstream)
 		return ARGUMENT_ERROR;
 
 	status = 0;
-	if (zstream->compress) {
+	if (zstream->parallel) {
+		status = parallel_flush (zstream, TRUE);
+		parallel_free (zstream);
+	} else if (zstream->compress && zstream->func != NULL) {
+		/* Streams used with ProcessZStream () are finished by the caller */
 		if (zstream->stream->total_in > 0) {
 			do {
 				status = deflate (zstream->stream, Z_FINISH);
@@ -125,6 +222,11 @@ CloseZStream (ZStream *zstream)
 			if (status == Z_STREAM_END)
 				status = flush_status;
 		}
+	}
+	if (status == 0 && pool_put (zstream))
+		return status;
+
+	if (zstream->compress) {
 		deflateEnd (zstream->stream);
 	} else {
 		inflateEnd (zstream->stream);
@@ -172,6 +274,11 @@ flush_internal (ZStream *stream, gboolean is_final)
 gint
 Flush (ZStream *stream)
 {
+	if (stream == NULL || stream->func == NULL)
+		return ARGUMENT_ERROR;
+
+	if (stream->parallel)
+		return parallel_flush (stream, FALSE);
 	return flush_internal (stream, FALSE);
 }
 
@@ -182,7 +289,7 @@ ReadZStream (ZStream *stream, guchar *buffer, gint length)
 	gint status;
 	z_stream *zs;
 
-	if (stream == NULL || buffer == NULL || length < 0)
+	if (stream == NULL || stream->func == NULL || buffer == NULL || length < 0)
 		return ARGUMENT_ERROR;
 
 	if (stream->eof)
@@ -224,12 +331,15 @@ WriteZStream (ZStream *stream, guchar *buffer, gint length)
 	gint status;
 	z_stream *zs;
 
-	if (stream == NULL || buffer == NULL || length < 0)
+	if (stream == NULL || stream->func == NULL || buffer == NULL || length < 0)
 		return ARGUMENT_ERROR;
 
 	if (stream->eof)
 		return IO_ERROR;
 
+	if (stream->parallel)
+		return parallel_write (stream, buffer, length);
+
 	zs = stream->stream;
 	zs->next_in = buffer;
 	zs->avail_in = length;
@@ -251,3 +361,437 @@ WriteZStream (ZStream *stream, guchar *buffer, gint length)
 	return length;
 }
 
+/*
+ * Compress or decompress straight from @in to @out, which the caller has
+ * pinned, without going through the stream buffer and the managed callback.
+ * Stores how much of @in was used in @consumed, and returns how much was
+ * written to @out. When compressing, @finish ends the stream, and the call
+ * must be repeated until it returns less than @out_length.
+ */
+gint
+ProcessZStream (ZStream *stream, guchar *in, gint in_length, gint *consumed, guchar *out, gint out_length, gint finish)
+{
+	gint status;
+	z_stream *zs;
+
+	if (stream == NULL || stream->parallel || consumed == NULL || (in == NULL && in_length != 0) || in_length < 0 || out == NULL || out_length < 0)
+		return ARGUMENT_ERROR;
+
+	*consumed = 0;
+	if (stream->eof)
+		return stream->compress ? IO_ERROR : 0;
+
+	zs = stream->stream;
+	zs->next_in = in;
+	zs->avail_in = in_length;
+	zs->next_out = out;
+	zs->avail_out = out_length;
+	if (stream->compress)
+		status = deflate (zs, finish ? Z_FINISH : Z_NO_FLUSH);
+	else
+		status = inflate (zs, Z_SYNC_FLUSH);
+
+	*consumed = in_length - zs->avail_in;
+	out_length -= zs->avail_out;
+
+	/* Don't keep pointers into the caller's buffers */
+	zs->next_in = NULL;
+	zs->avail_in = 0;
+	zs->next_out = stream->buffer;
+	zs->avail_out = BUFFER_SIZE;
+
+	if (status == Z_STREAM_END)
+		stream->eof = TRUE;
+	else if (status != Z_OK && status != Z_BUF_ERROR) /* Z_BUF_ERROR: no progress possible, not fatal */
+		return status;
+
+	return out_length;
+}
+
+/*
+ * Parallel compression, like pigz: the input is cut into blocks which are
+ * compressed as raw deflate on worker threads, each primed with the last
+ * 32KB of the block before it so the ratio stays close to a serial stream.
+ * Every block but the last ends with a sync flush, so the compressed blocks
+ * can be written one after the other as a single deflate stream. For gzip,
+ * the header is written here and the CRC of the whole input is combined
+ * from the CRCs of the blocks. Only the thread calling WriteZStream () and
+ * CloseZStream () calls back into managed code.
+ */
+#ifdef ZSTREAM_PARALLEL
+
+typedef struct {
+	guchar *in;
+	gint in_len;
+	guchar dict [PARALLEL_DICT_SIZE];
+	gint dict_len;
+	guchar *out;
+	gint out_len;
+	gint out_size;
+	uLong crc;
+	gboolean last;
+	gint status;
+	gboolean done;
+} ZJob;
+
+struct _ZParallel {
+	pthread_t *threads;
+	gint nthreads;
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+	gboolean shutdown;
+	/* Ring of max_jobs jobs: [head, run) are being compressed, [run, tail) are waiting */
+	ZJob *jobs;
+	gint max_jobs;
+	guint64 head;
+	guint64 run;
+	guint64 tail;
+	/* The block being filled by WriteZStream () */
+	guchar *block;
+	gint block_len;
+	guchar dict [PARALLEL_DICT_SIZE];
+	gint dict_len;
+	gboolean header_written;
+	gboolean finished;
+	uLong crc;
+	guint32 isize;
+};
+
+static gint
+compress_job (z_stream *zs, ZJob *job)
+{
+	gint status;
+
+	if (deflateReset (zs) != Z_OK)
+		return Z_STREAM_ERROR;
+	if (job->dict_len > 0 && deflateSetDictionary (zs, job->dict, job->dict_len) != Z_OK)
+		return Z_STREAM_ERROR;
+
+	job->crc = crc32 (0L, Z_NULL, 0);
+	job->crc = crc32 (job->crc, job->in, job->in_len);
+	job->out_len = 0;
+	zs->next_in = job->in;
+	zs->avail_in = job->in_len;
+	do {
+		if (job->out_len == job->out_size) {
+			job->out_size *= 2;
+			job->out = (guchar *) realloc (job->out, job->out_size);
+			if (job->out == NULL)
+				return Z_MEM_ERROR;
+		}
+		zs->next_out = job->out + job->out_len;
+		zs->avail_out = job->out_size - job->out_len;
+		status = deflate (zs, job->last ? Z_FINISH : Z_SYNC_FLUSH);
+		job->out_len = job->out_size - zs->avail_out;
+		if (status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR)
+			return status;
+	} while (zs->avail_out == 0 || (job->last && status != Z_STREAM_END));
+
+	return Z_OK;
+}
+
+static void *
+parallel_worker (void *arg)
+{
+	ZParallel *par = (ZParallel *) arg;
+	z_stream zs;
+	ZJob *job;
+	gint status;
+
+	memset (&zs, 0, sizeof (zs));
+	status = deflateInit2 (&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+
+	pthread_mutex_lock (&par->lock);
+	for (;;) {
+		while (!par->shutdown && par->run == par->tail)
+			pthread_cond_wait (&par->work_cond, &par->lock);
+		if (par->shutdown)
+			break;
+		job = &par->jobs [par->run++ % par->max_jobs];
+		pthread_mutex_unlock (&par->lock);
+
+		job->status = status == Z_OK ? compress_job (&zs, job) : status;
+
+		pthread_mutex_lock (&par->lock);
+		job->done = TRUE;
+		pthread_cond_broadcast (&par->done_cond);
+	}
+	pthread_mutex_unlock (&par->lock);
+
+	if (status == Z_OK)
+		deflateEnd (&zs);
+	return NULL;
+}
+
+static gint
+emit (ZStream *stream, guchar *data, gint length)
+{
+	gint n, chunk;
+
+	while (length > 0) {
+		chunk = length < BUFFER_SIZE ? length : BUFFER_SIZE;
+		n = stream->func (data, chunk, stream->gchandle);
+		if (n < 0)
+			return IO_ERROR;
+		data += chunk;
+		length -= chunk;
+	}
+	return 0;
+}
+
+/* Write out the oldest job, waiting for it if @wait, returns 1 if there was nothing to write */
+static gint
+emit_oldest (ZStream *stream, gboolean wait)
+{
+	ZParallel *par = stream->parallel;
+	ZJob *job;
+	gboolean done;
+	gint status;
+
+	pthread_mutex_lock (&par->lock);
+	if (par->head == par->tail) {
+		pthread_mutex_unlock (&par->lock);
+		return 1;
+	}
+	job = &par->jobs [par->head % par->max_jobs];
+	while (wait && !job->done)
+		pthread_cond_wait (&par->done_cond, &par->lock);
+	done = job->done;
+	pthread_mutex_unlock (&par->lock);
+	if (!done)
+		return 1;
+
+	if (job->status != Z_OK)
+		return job->status;
+
+	if (stream->gzip && !par->header_written) {
+		/* What deflate () writes without a gz_header: no name, no mtime, OS code 3 (Unix) */
+		static guchar gzip_header [10] = { 0x1f, 0x8b, Z_DEFLATED, 0, 0, 0, 0, 0, 0, 3 };
+
+		status = emit (stream, gzip_header, sizeof (gzip_header));
+		if (status != 0)
+			return status;
+		par->header_written = TRUE;
+	}
+	status = emit (stream, job->out, job->out_len);
+	if (status != 0)
+		return status;
+
+	par->crc = crc32_combine (par->crc, job->crc, job->in_len);
+	par->isize += job->in_len;
+	if (job->last && stream->gzip) {
+		guchar trailer [8];
+		gint i;
+
+		for (i = 0; i < 4; i++) {
+			trailer [i] = (par->crc >> (8 * i)) & 0xff;
+			trailer [4 + i] = (par->isize >> (8 * i)) & 0xff;
+		}
+		status = emit (stream, trailer, sizeof (trailer));
+		if (status != 0)
+			return status;
+	}
+
+	pthread_mutex_lock (&par->lock);
+	job->done = FALSE;
+	par->head++;
+	pthread_mutex_unlock (&par->lock);
+	return 0;
+}
+
+/* Hand the current block to the workers, writing out finished blocks to make room */
+static gint
+submit_block (ZStream *stream, gboolean last)
+{
+	ZParallel *par = stream->parallel;
+	ZJob *job;
+	guchar *in;
+	gint status, keep;
+
+	while (par->tail - par->head == par->max_jobs) {
+		status = emit_oldest (stream, TRUE);
+		if (status < 0)
+			return status;
+	}
+
+	job = &par->jobs [par->tail % par->max_jobs];
+	/* Swap buffers with the job instead of copying the block */
+	in = job->in;
+	job->in = par->block;
+	job->in_len = par->block_len;
+	par->block = in;
+	par->block_len = 0;
+	memcpy (job->dict, par->dict, par->dict_len);
+	job->dict_len = par->dict_len;
+	job->last = last;
+
+	/* The end of this block primes the next one */
+	keep = job->in_len < PARALLEL_DICT_SIZE ? job->in_len : PARALLEL_DICT_SIZE;
+	if (par->dict_len + keep > PARALLEL_DICT_SIZE) {
+		gint drop = par->dict_len + keep - PARALLEL_DICT_SIZE;
+
+		memmove (par->dict, par->dict + drop, par->dict_len - drop);
+		par->dict_len -= drop;
+	}
+	memcpy (par->dict + par->dict_len, job->in + job->in_len - keep, keep);
+	par->dict_len += keep;
+
+	pthread_mutex_lock (&par->lock);
+	par->tail++;
+	pthread_cond_signal (&par->work_cond);
+	pthread_mutex_unlock (&par->lock);
+
+	/* Write whatever is already done, without waiting */
+	while ((status = emit_oldest (stream, FALSE)) == 0)
+		;
+	return status < 0 ? status : 0;
+}
+
+static gint
+parallel_write (ZStream *stream, guchar *buffer, gint length)
+{
+	ZParallel *par = stream->parallel;
+	gint chunk, status, written = 0;
+
+	while (written < length) {
+		chunk = PARALLEL_BLOCK_SIZE - par->block_len;
+		if (chunk > length - written)
+			chunk = length - written;
+		memcpy (par->block + par->block_len, buffer + written, chunk);
+		par->block_len += chunk;
+		written += chunk;
+		stream->total_in += chunk;
+		if (par->block_len == PARALLEL_BLOCK_SIZE) {
+			status = submit_block (stream, FALSE);
+			if (status < 0)
+				return status;
+		}
+	}
+	return length;
+}
+
+static gint
+parallel_flush (ZStream *stream, gboolean is_final)
+{
+	ZParallel *par = stream->parallel;
+	gint status;
+
+	if (par->finished)
+		return 0;
+	/* Like the serial path, an empty stream produces no output at all */
+	if (is_final && stream->total_in == 0)
+		return 0;
+	if (is_final || par->block_len > 0) {
+		status = submit_block (stream, is_final);
+		if (status < 0)
+			return status;
+	}
+	while ((status = emit_oldest (stream, TRUE)) == 0)
+		;
+	if (status < 0)
+		return status;
+	par->finished = is_final;
+	return 0;
+}
+
+static void
+parallel_free (ZStream *stream)
+{
+	ZParallel *par = stream->parallel;
+	gint i;
+
+	pthread_mutex_lock (&par->lock);
+	par->shutdown = TRUE;
+	pthread_cond_broadcast (&par->work_cond);
+	pthread_mutex_unlock (&par->lock);
+	for (i = 0; i < par->nthreads; i++)
+		pthread_join (par->threads [i], NULL);
+
+	for (i = 0; i < par->max_jobs; i++) {
+		free (par->jobs [i].in);
+		free (par->jobs [i].out);
+	}
+	pthread_mutex_destroy (&par->lock);
+	pthread_cond_destroy (&par->work_cond);
+	pthread_cond_destroy (&par->done_cond);
+	free (par->jobs);
+	free (par->threads);
+	free (par->block);
+	free (par);
+	stream->parallel = NULL;
+}
+
+/*
+ * Opt in to compressing @stream on @threads worker threads. This only pays
+ * off for inputs of a few MB or more, and must be done before anything is
+ * written. Returns ARGUMENT_ERROR if parallel compression isn't possible
+ * for this stream, which then stays serial.
+ */
+gint
+SetZStreamParallel (ZStream *stream, gint threads)
+{
+	ZParallel *par;
+	gint i;
+
+	if (stream == NULL || !stream->compress || stream->func == NULL || stream->parallel || stream->total_in > 0 || threads < 1)
+		return ARGUMENT_ERROR;
+	if (threads > PARALLEL_MAX_THREADS)
+		threads = PARALLEL_MAX_THREADS;
+
+	par = z_new0 (ZParallel, 1);
+	par->nthreads = threads;
+	par->max_jobs = threads * 2;
+	par->jobs = z_new0 (ZJob, par->max_jobs);
+	par->threads = z_new0 (pthread_t, threads);
+	par->block = z_new (guchar, PARALLEL_BLOCK_SIZE);
+	for (i = 0; i < par->max_jobs; i++) {
+		par->jobs [i].in = z_new (guchar, PARALLEL_BLOCK_SIZE);
+		par->jobs [i].out_size = PARALLEL_BLOCK_SIZE + PARALLEL_BLOCK_SIZE / 8;
+		par->jobs [i].out = z_new (guchar, par->jobs [i].out_size);
+	}
+	par->crc = crc32 (0L, Z_NULL, 0);
+	pthread_mutex_init (&par->lock, NULL);
+	pthread_cond_init (&par->work_cond, NULL);
+	pthread_cond_init (&par->done_cond, NULL);
+	stream->parallel = par;
+
+	for (i = 0; i < threads; i++) {
+		if (pthread_create (&par->threads [i], NULL, parallel_worker, par) != 0)
+			break;
+	}
+	par->nthreads = i;
+	if (i == 0) {
+		parallel_free (stream);
+		return ARGUMENT_ERROR;
+	}
+	return 0;
+}
+
+#else
+
+static gint
+parallel_write (ZStream *stream, guchar *buffer, gint length)
+{
+	return IO_ERROR;
+}
+
+static gint
+parallel_flush (ZStream *stream, gboolean is_final)
+{
+	return IO_ERROR;
+}
+
+static void
+parallel_free (ZStream *stream)
+{
+}
+
+gint
+SetZStreamParallel (ZStream *stream, gint threads)
+{
+	/* No threads, the stream stays serial */
+	return ARGUMENT_ERROR;
+}
+
+#endif /* ZSTREAM_PARALLEL */
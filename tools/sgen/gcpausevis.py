@@ -8,12 +8,14 @@ import re
 import sys
 from optparse import OptionParser
 import subprocess
+import tempfile
 
-parser = OptionParser (usage = "Usage: %prog [options] BINARY-PROTOCOL")
+parser = OptionParser (usage = "Usage: %prog [options] BINARY-PROTOCOL\n       %prog --phases LOG-PROFILER-OUTPUT")
 parser.add_option ('--histogram', action = 'store_true', dest = 'histogram', help = "pause time histogram")
 parser.add_option ('--scatter', action = 'store_true', dest = 'scatter', help = "pause time scatterplot")
 parser.add_option ('--minor', action = 'store_true', dest = 'minor', help = "only show minor collections in histogram")
 parser.add_option ('--major', action = 'store_true', dest = 'major', help = "only show major collections in histogram")
+parser.add_option ('--phases', action = 'store_true', dest = 'phases', help = "pause time breakdown by GC phase, from a log profiler output file")
 (options, files) = parser.parse_args ()
 
 show_histogram = False
@@ -31,6 +33,51 @@ if options.scatter:
 if (options.minor or options.major) and not options.scatter:
     show_histogram = True
 
+if options.phases:
+    if len (files) != 1:
+        parser.print_help ()
+        sys.exit (1)
+
+    phases_file = tempfile.NamedTemporaryFile (suffix = '.txt')
+    if subprocess.call (['mprof-report', '--reports=header', '--gc-phases-out=' + phases_file.name, files [0]], stdout = open (os.devnull, 'w')) != 0:
+        sys.stderr.write ('Error: `mprof-report` failed to read `%s`.\n' % files [0])
+        sys.exit (1)
+
+    phase_names = None
+    pauses = []
+    for line in open (phases_file.name):
+        fields = line.split ()
+        if line.startswith ('#'):
+            phase_names = fields [5:]
+            continue
+        if fields and fields [0] == 'pause':
+            generation = int (fields [1])
+            if (generation == 0 and not show_minor) or (generation != 0 and not show_major):
+                continue
+            # nanoseconds to milliseconds
+            pauses.append ([int (field) / 1000.0 / 1000.0 for field in fields [2:]])
+
+    if not pauses:
+        sys.stderr.write ('Error: no GC pauses found, was the log profiler run with a runtime that reports GC phases?\n')
+        sys.exit (1)
+
+    colors = ['gray', 'orange', 'cyan', 'green', 'blue', 'purple', 'magenta', 'black']
+    indices = np.arange (len (pauses))
+    bottom = np.zeros (len (pauses))
+    for i, name in enumerate (phase_names):
+        times = np.array ([pause [2 + i] for pause in pauses])
+        plt.bar (indices, times, bottom = bottom, color = colors [i % len (colors)], label = name)
+        bottom += times
+    # Whatever is not covered by a phase (bookkeeping, fragment creation, sweeping, ...)
+    other = np.array ([pause [1] for pause in pauses]) - bottom
+    plt.bar (indices, np.maximum (other, 0), bottom = bottom, color = 'red', label = 'other')
+
+    plt.ylabel ('Pause Time (ms)')
+    plt.xlabel ('Pause')
+    plt.legend (loc = 'upper left')
+    plt.show ()
+    sys.exit (0)
+
 script_path = os.path.realpath (__file__)
 sgen_grep_path = os.path.join (os.path.dirname (script_path), 'sgen-grep-binprot')
 